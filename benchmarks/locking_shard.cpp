@@ -0,0 +1,326 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Lock and apply throughput of a single locking shard over a preseeded
+// UHS, as a baseline for changes to the UHS set and its striping. Each
+// iteration locks and applies one dtx batch of attested compact
+// transactions, so the attestation checks in lock_outputs are included.
+// Two pre-signed batches alternate: the first spends preseeded UHS IDs and
+// creates new ones, which the second spends to recreate the originals.
+// Optional reader threads call check_unspent concurrently. The preseed
+// file is generated once per UHS size. UHS sizes beyond the default 10M
+// are selected with LOCKING_SHARD_BENCH_UHS_MILLIONS, a comma-separated
+// list, as large ones need tens of gigabytes of memory.
+
+#include "uhs/transaction/validation.hpp"
+#include "uhs/twophase/locking_shard/locking_shard.hpp"
+#include "util/common/config.hpp"
+#include "util/common/keys.hpp"
+#include "util/common/logging.hpp"
+#include "util/common/mapped_hash_array.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+    constexpr int64_t g_million = 1000000;
+
+    auto random_hash(std::mt19937_64& rng) -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        for(size_t j{0}; j < ret.size(); j += sizeof(uint64_t)) {
+            auto word = rng();
+            std::memcpy(&ret[j], &word, sizeof(word));
+        }
+        return ret;
+    }
+
+    /// Preseed files written by this process, removed at exit.
+    class preseed_files {
+      public:
+        preseed_files() = default;
+        preseed_files(const preseed_files&) = delete;
+        auto operator=(const preseed_files&) -> preseed_files& = delete;
+        preseed_files(preseed_files&&) = delete;
+        auto operator=(preseed_files&&) -> preseed_files& = delete;
+
+        ~preseed_files() {
+            for(const auto& path : m_paths) {
+                std::filesystem::remove(path);
+            }
+        }
+
+        /// Returns the path of a preseed file of the given number of
+        /// pseudorandom UHS IDs, writing it first if needed.
+        auto get(size_t count) -> std::string {
+            auto path = "locking_shard_bench_" + std::to_string(count)
+                      + ".dat";
+            if(std::find(m_paths.begin(), m_paths.end(), path)
+               != m_paths.end()) {
+                return path;
+            }
+            auto out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+            if(!cbdc::mapped_hash_array::write_header(out, count)) {
+                return {};
+            }
+            auto rng = std::mt19937_64(count);
+            auto buf = std::vector<cbdc::hash_t>(1 << 16);
+            for(size_t written{0}; written < count; written += buf.size()) {
+                auto n = std::min(buf.size(), count - written);
+                for(size_t i{0}; i < n; i++) {
+                    buf[i] = random_hash(rng);
+                }
+                out.write(reinterpret_cast<const char*>(buf.data()),
+                          static_cast<std::streamsize>(
+                              n * sizeof(cbdc::hash_t)));
+            }
+            if(!out.good()) {
+                return {};
+            }
+            m_paths.push_back(path);
+            return path;
+        }
+
+      private:
+        std::vector<std::string> m_paths;
+    };
+
+    auto g_preseed_files = preseed_files();
+
+    /// Options for a shard covering the whole UHS ID range, accepting
+    /// attestations from one sentinel.
+    auto make_options(const cbdc::privkey_t& skey, secp256k1_context* secp)
+        -> cbdc::config::options {
+        auto opts = cbdc::config::options();
+        opts.m_twophase_mode = true;
+        opts.m_attestation_threshold = 1;
+        opts.m_sentinel_public_keys.insert(
+            cbdc::pubkey_from_privkey(skey, secp));
+        return opts;
+    }
+
+    /// Builds attested transactions, each spending n_inputs of the given
+    /// inputs and creating the same number of outputs.
+    auto make_batch(const std::vector<cbdc::hash_t>& inputs,
+                    const std::vector<cbdc::hash_t>& outputs,
+                    size_t n_inputs,
+                    std::mt19937_64& rng,
+                    const cbdc::privkey_t& skey,
+                    secp256k1_context* secp)
+        -> std::vector<cbdc::locking_shard::tx> {
+        auto txs = std::vector<cbdc::locking_shard::tx>(inputs.size()
+                                                        / n_inputs);
+        for(size_t i{0}; i < txs.size(); i++) {
+            auto& ctx = txs[i].m_tx;
+            ctx.m_id = random_hash(rng);
+            const auto first = inputs.begin()
+                             + static_cast<std::ptrdiff_t>(i * n_inputs);
+            ctx.m_inputs.assign(first,
+                                first + static_cast<std::ptrdiff_t>(n_inputs));
+            const auto first_out
+                = outputs.begin() + static_cast<std::ptrdiff_t>(i * n_inputs);
+            ctx.m_uhs_outputs.assign(
+                first_out,
+                first_out + static_cast<std::ptrdiff_t>(n_inputs));
+            ctx.m_attestations.insert(ctx.sign(secp, skey));
+        }
+        return txs;
+    }
+
+    auto sentinel_key() -> cbdc::privkey_t {
+        auto skey = cbdc::privkey_t{};
+        skey[skey.size() - 1] = 1;
+        return skey;
+    }
+
+    /// Arguments: UHS size in millions, dtx batch size, inputs per
+    /// transaction and number of concurrent check_unspent readers.
+    void locking_shard_lock_apply(benchmark::State& state) {
+        const auto uhs_size
+            = static_cast<size_t>(state.range(0) * g_million);
+        const auto batch_size = static_cast<size_t>(state.range(1));
+        const auto n_inputs = static_cast<size_t>(state.range(2));
+        const auto n_readers = static_cast<size_t>(state.range(3));
+
+        auto preseed_path = g_preseed_files.get(uhs_size);
+        auto preseed = cbdc::mapped_hash_array(preseed_path);
+        if(preseed_path.empty() || !preseed.open()) {
+            state.SkipWithError("Failed to write preseed file");
+            return;
+        }
+
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>(
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy);
+        const auto skey = sentinel_key();
+        auto log = std::make_shared<cbdc::logging::log>(
+            cbdc::logging::log_level::warn);
+        auto opts = make_options(skey, secp.get());
+        const auto cache_size = opts.m_shard_completed_txs_cache_size;
+        auto shard = cbdc::locking_shard::locking_shard({0, UINT8_MAX},
+                                                        log,
+                                                        cache_size,
+                                                        preseed_path,
+                                                        opts);
+
+        auto rng = std::mt19937_64(batch_size * n_inputs);
+        const auto n_spent = std::min(batch_size * n_inputs, uhs_size);
+        auto seeded = std::vector<cbdc::hash_t>(preseed.data(),
+                                                preseed.data() + n_spent);
+        auto created = std::vector<cbdc::hash_t>(n_spent);
+        for(auto& h : created) {
+            h = random_hash(rng);
+        }
+        const auto batches = std::array<std::vector<cbdc::locking_shard::tx>,
+                                        2>{
+            make_batch(seeded, created, n_inputs, rng, skey, secp.get()),
+            make_batch(created, seeded, n_inputs, rng, skey, secp.get())};
+
+        auto running = std::atomic<bool>(true);
+        auto lookups = std::atomic<uint64_t>(0);
+        auto readers = std::vector<std::thread>();
+        for(size_t r{0}; r < n_readers; r++) {
+            readers.emplace_back([&, r]() {
+                auto reader_rng = std::mt19937_64(r);
+                auto dist = std::uniform_int_distribution<size_t>(
+                    0,
+                    preseed.size() - 1);
+                uint64_t n{0};
+                while(running.load(std::memory_order_relaxed)) {
+                    benchmark::DoNotOptimize(
+                        shard.check_unspent(preseed.data()[dist(reader_rng)]));
+                    n++;
+                }
+                lookups += n;
+            });
+        }
+
+        auto lock_time = std::chrono::nanoseconds(0);
+        auto apply_time = std::chrono::nanoseconds(0);
+        uint64_t dtx_seq{0};
+        for(auto _ : state) {
+            auto txs = batches[dtx_seq % batches.size()];
+            auto dtx_id = cbdc::hash_t();
+            std::memcpy(dtx_id.data(), &dtx_seq, sizeof(dtx_seq));
+            dtx_seq++;
+
+            const auto start = std::chrono::steady_clock::now();
+            auto res = shard.lock_outputs(std::move(txs), dtx_id);
+            const auto locked = std::chrono::steady_clock::now();
+            if(!res.has_value()
+               || std::find(res->begin(), res->end(), false) != res->end()) {
+                state.SkipWithError("Failed to lock transactions");
+                break;
+            }
+            if(!shard.apply_outputs(std::move(res.value()), dtx_id)) {
+                state.SkipWithError("Failed to apply transactions");
+                break;
+            }
+            apply_time += std::chrono::steady_clock::now() - locked;
+            lock_time += locked - start;
+
+            state.PauseTiming();
+            shard.discard_dtx(dtx_id);
+            state.ResumeTiming();
+        }
+
+        running = false;
+        for(auto& t : readers) {
+            t.join();
+        }
+
+        const auto iters = std::max<double>(
+            static_cast<double>(state.iterations()),
+            1.0);
+        state.counters["lock_us"]
+            = std::chrono::duration<double, std::micro>(lock_time).count()
+            / iters;
+        state.counters["apply_us"]
+            = std::chrono::duration<double, std::micro>(apply_time).count()
+            / iters;
+        state.counters["lookups"]
+            = benchmark::Counter(static_cast<double>(lookups),
+                                 benchmark::Counter::kIsRate);
+        state.SetItemsProcessed(state.iterations()
+                                * static_cast<int64_t>(batches[0].size()));
+    }
+
+    /// UHS sizes in millions from LOCKING_SHARD_BENCH_UHS_MILLIONS, or 10.
+    auto uhs_sizes() -> std::vector<int64_t> {
+        auto ret = std::vector<int64_t>();
+        if(const auto* env = std::getenv("LOCKING_SHARD_BENCH_UHS_MILLIONS")) {
+            auto ss = std::stringstream(env);
+            auto item = std::string();
+            while(std::getline(ss, item, ',')) {
+                auto val = std::strtoll(item.c_str(), nullptr, 10);
+                if(val > 0) {
+                    ret.push_back(val);
+                }
+            }
+        }
+        if(ret.empty()) {
+            ret.push_back(10);
+        }
+        return ret;
+    }
+
+    void lock_apply_args(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"uhs_m", "batch", "inputs", "readers"});
+        b->ArgsProduct({uhs_sizes(), {1000, 10000, 50000}, {1, 2, 8}, {0, 4}});
+        b->Unit(benchmark::kMillisecond);
+        b->UseRealTime();
+    }
+
+    /// Cost of the attestation checks alone, on the calling thread.
+    /// Arguments: inputs per transaction.
+    void locking_shard_check_attestations(benchmark::State& state) {
+        constexpr size_t batch_size = 1000;
+        const auto n_inputs = static_cast<size_t>(state.range(0));
+
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>(
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy);
+        const auto skey = sentinel_key();
+        auto opts = make_options(skey, secp.get());
+        auto rng = std::mt19937_64(n_inputs);
+        auto hashes = std::vector<cbdc::hash_t>(batch_size * n_inputs);
+        for(auto& h : hashes) {
+            h = random_hash(rng);
+        }
+        auto txs
+            = make_batch(hashes, hashes, n_inputs, rng, skey, secp.get());
+
+        for(auto _ : state) {
+            for(const auto& t : txs) {
+                if(!cbdc::transaction::validation::check_attestations(
+                       t.m_tx,
+                       opts.m_sentinel_public_keys,
+                       opts.m_attestation_threshold)) {
+                    state.SkipWithError("Invalid attestation");
+                    return;
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations()
+                                * static_cast<int64_t>(txs.size()));
+    }
+}
+
+BENCHMARK(locking_shard_lock_apply)->Apply(lock_apply_args);
+BENCHMARK(locking_shard_check_attestations)
+    ->ArgName("inputs")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(8);
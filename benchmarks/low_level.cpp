@@ -9,8 +9,10 @@
 #include "uhs/transaction/transaction.hpp"
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
+#include "util/common/buffer.hpp"
 #include "util/serialization/istream_serializer.hpp"
 #include "util/serialization/ostream_serializer.hpp"
+#include "util/serialization/util.hpp"
 
 #include <benchmark/benchmark.h>
 #include <filesystem>
@@ -122,6 +124,25 @@ BENCHMARK_F(low_level, deserialize_compact_tx)(benchmark::State& state) {
     m_if.close();
 }
 
+// serialize full tx into a buffer
+BENCHMARK_F(low_level, serialize_tx_buffer)(benchmark::State& state) {
+    m_valid_tx = wallet1.send_to(2, wallet2.generate_key(), true).value();
+    for(auto _ : state) {
+        auto buf = cbdc::make_buffer(m_valid_tx);
+        benchmark::DoNotOptimize(buf);
+    }
+}
+
+// deserialize full tx from a buffer
+BENCHMARK_F(low_level, deserialize_tx_buffer)(benchmark::State& state) {
+    m_valid_tx = wallet1.send_to(2, wallet2.generate_key(), true).value();
+    auto buf = cbdc::make_buffer(m_valid_tx);
+    for(auto _ : state) {
+        auto read_tx = cbdc::from_buffer<cbdc::transaction::full_tx>(buf);
+        benchmark::DoNotOptimize(read_tx);
+    }
+}
+
 // wallet sign tx
 BENCHMARK_F(low_level, sign_tx)(benchmark::State& state) {
     // sign 1-1 tx
@@ -177,4 +198,19 @@ BENCHMARK_F(low_level, calculate_uhs_id)(benchmark::State& state) {
     }
 }
 
+// hex round trip of a transaction-sized payload, as done for every
+// EVM JSON-RPC request and response
+static void hex_round_trip(benchmark::State& state) {
+    auto buf = cbdc::buffer();
+    auto data = std::string(static_cast<size_t>(state.range(0)), 'x');
+    buf.append(data.data(), data.size());
+    for(auto _ : state) {
+        auto hex = buf.to_hex();
+        auto decoded = cbdc::buffer::from_hex(hex);
+        benchmark::DoNotOptimize(decoded);
+    }
+}
+
+BENCHMARK(hex_round_trip)->Arg(32)->Arg(512)->Arg(4096);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,302 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Loopback echo throughput and round-trip latency of the network transport,
+// both for raw connection_manager packets and for RPCs through tcp_client
+// and blocking_tcp_server. Each iteration has every client peer send a
+// window of messages, keeping up to the pipelining depth in flight, and
+// waits for all the echoes. Round-trip latency percentiles are reported as
+// counters, in microseconds.
+
+#include "util/network/connection_manager.hpp"
+#include "util/rpc/blocking_server.hpp"
+#include "util/rpc/tcp_client.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+
+namespace {
+    constexpr unsigned short g_cm_port = 5700;
+    constexpr unsigned short g_rpc_port = 5701;
+    constexpr size_t g_window = 1024;
+
+    using clock_type = std::chrono::steady_clock;
+
+    /// Limits the number of messages a sender has in flight, and collects
+    /// the round-trip latency of each.
+    class pipeline {
+      public:
+        explicit pipeline(size_t depth) : m_depth(depth) {}
+
+        /// Waits for a free slot, then returns the index under which to
+        /// record the message's send time.
+        auto acquire() -> size_t {
+            std::unique_lock l(m_mut);
+            m_cv.wait(l, [&]() {
+                return m_in_flight < m_depth;
+            });
+            m_in_flight++;
+            m_sent.push_back(clock_type::now());
+            return m_sent.size() - 1;
+        }
+
+        /// Frees the slot of the message with the given index, recording
+        /// its latency.
+        void release(size_t idx) {
+            const auto now = clock_type::now();
+            {
+                std::unique_lock l(m_mut);
+                m_latencies.push_back(
+                    std::chrono::duration<double, std::micro>(now
+                                                              - m_sent[idx])
+                        .count());
+                m_in_flight--;
+            }
+            m_cv.notify_all();
+        }
+
+        /// Waits until no messages are in flight.
+        void drain() {
+            std::unique_lock l(m_mut);
+            m_cv.wait(l, [&]() {
+                return m_in_flight == 0;
+            });
+        }
+
+        /// Moves the collected latencies to the given vector and starts a
+        /// new window. Call after \ref drain.
+        void collect(std::vector<double>& latencies) {
+            std::unique_lock l(m_mut);
+            latencies.insert(latencies.end(),
+                             m_latencies.begin(),
+                             m_latencies.end());
+            m_latencies.clear();
+            m_sent.clear();
+        }
+
+      private:
+        size_t m_depth;
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        size_t m_in_flight{0};
+        std::vector<clock_type::time_point> m_sent;
+        std::vector<double> m_latencies;
+    };
+
+    /// Returns a payload of the given size, at least large enough to carry
+    /// a message index.
+    auto make_payload(size_t size) -> cbdc::buffer {
+        auto buf = cbdc::buffer();
+        buf.extend(std::max(size, sizeof(size_t)));
+        std::memset(buf.data(), 0, buf.size());
+        return buf;
+    }
+
+    auto percentile(const std::vector<double>& sorted, double p) -> double {
+        if(sorted.empty()) {
+            return 0.0;
+        }
+        auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size()
+                                                               - 1));
+        return sorted[idx];
+    }
+
+    void report(benchmark::State& state,
+                std::vector<double>& latencies,
+                size_t payload_size) {
+        std::sort(latencies.begin(), latencies.end());
+        state.counters["p50_us"] = percentile(latencies, 0.5);
+        state.counters["p99_us"] = percentile(latencies, 0.99);
+        state.counters["p999_us"] = percentile(latencies, 0.999);
+        state.SetItemsProcessed(static_cast<int64_t>(latencies.size()));
+        state.SetBytesProcessed(state.items_processed()
+                                * static_cast<int64_t>(payload_size));
+    }
+
+    /// Runs one window of messages from each peer on its own thread.
+    template<typename F>
+    void run_peers(size_t n_peers, F&& send_window) {
+        auto threads = std::vector<std::thread>();
+        for(size_t p{0}; p < n_peers; p++) {
+            threads.emplace_back([&, p]() {
+                send_window(p);
+            });
+        }
+        for(auto& t : threads) {
+            t.join();
+        }
+    }
+
+    /// Arguments: payload size in bytes, number of client peers and
+    /// pipelining depth per peer.
+    void connection_manager_echo(benchmark::State& state) {
+        const auto payload_size = static_cast<size_t>(state.range(0));
+        const auto n_peers = static_cast<size_t>(state.range(1));
+        const auto depth = static_cast<size_t>(state.range(2));
+
+        const auto ep
+            = cbdc::network::endpoint_t{cbdc::network::localhost, g_cm_port};
+        auto server = cbdc::network::connection_manager();
+        auto server_thread = server.start_server(
+            ep,
+            [](cbdc::network::message_t&& msg)
+                -> std::optional<cbdc::buffer> {
+                return std::move(*msg.m_pkt);
+            });
+        if(!server_thread.has_value()) {
+            state.SkipWithError("Failed to start server");
+            return;
+        }
+
+        auto pipelines = std::vector<std::unique_ptr<pipeline>>();
+        auto clients
+            = std::vector<std::unique_ptr<cbdc::network::connection_manager>>();
+        auto client_threads = std::vector<std::thread>();
+        auto ok = true;
+        for(size_t p{0}; p < n_peers && ok; p++) {
+            auto& pl = pipelines.emplace_back(
+                std::make_unique<pipeline>(depth));
+            auto& client = clients.emplace_back(
+                std::make_unique<cbdc::network::connection_manager>());
+            auto thr = client->start_cluster_handler(
+                {ep},
+                [pl = pl.get()](cbdc::network::message_t&& msg)
+                    -> std::optional<cbdc::buffer> {
+                    size_t idx{};
+                    std::memcpy(&idx, msg.m_pkt->data(), sizeof(idx));
+                    pl->release(idx);
+                    return std::nullopt;
+                });
+            if(thr.has_value()) {
+                client_threads.push_back(std::move(thr.value()));
+            } else {
+                ok = false;
+            }
+        }
+
+        const auto payload = make_payload(payload_size);
+        auto latencies = std::vector<double>();
+        for(auto _ : state) {
+            if(!ok) {
+                state.SkipWithError("Failed to connect clients");
+                break;
+            }
+            run_peers(n_peers, [&](size_t p) {
+                auto& pl = *pipelines[p];
+                for(size_t i{0}; i < g_window; i++) {
+                    auto pkt = std::make_shared<cbdc::buffer>(payload);
+                    auto idx = pl.acquire();
+                    std::memcpy(pkt->data(), &idx, sizeof(idx));
+                    clients[p]->broadcast(pkt);
+                }
+                pl.drain();
+            });
+            for(auto& pl : pipelines) {
+                pl->collect(latencies);
+            }
+        }
+
+        for(auto& client : clients) {
+            client->close();
+        }
+        for(auto& t : client_threads) {
+            t.join();
+        }
+        server.close();
+        server_thread->join();
+        report(state, latencies, payload_size);
+    }
+
+    /// Arguments: payload size in bytes, number of client peers and
+    /// maximum requests in flight per peer.
+    void rpc_tcp_echo(benchmark::State& state) {
+        const auto payload_size = static_cast<size_t>(state.range(0));
+        const auto n_peers = static_cast<size_t>(state.range(1));
+        const auto depth = static_cast<size_t>(state.range(2));
+
+        using server_type
+            = cbdc::rpc::blocking_tcp_server<cbdc::buffer, cbdc::buffer>;
+        using client_type = cbdc::rpc::tcp_client<cbdc::buffer, cbdc::buffer>;
+
+        const auto ep
+            = cbdc::network::endpoint_t{cbdc::network::localhost, g_rpc_port};
+        auto server = server_type(ep);
+        server.register_handler_callback(
+            [](cbdc::buffer req) -> std::optional<cbdc::buffer> {
+                return req;
+            });
+        if(!server.init()) {
+            state.SkipWithError("Failed to start RPC server");
+            return;
+        }
+
+        auto client_opts = cbdc::rpc::tcp_client_options{};
+        client_opts.m_max_in_flight = depth;
+        auto clients = std::vector<std::unique_ptr<client_type>>();
+        for(size_t p{0}; p < n_peers; p++) {
+            auto& client = clients.emplace_back(
+                std::make_unique<client_type>(
+                    std::vector<cbdc::network::endpoint_t>{ep},
+                    client_opts));
+            if(!client->init()) {
+                state.SkipWithError("Failed to connect RPC client");
+                return;
+            }
+        }
+
+        const auto payload = make_payload(payload_size);
+        auto pipelines = std::vector<std::unique_ptr<pipeline>>();
+        for(size_t p{0}; p < n_peers; p++) {
+            pipelines.push_back(std::make_unique<pipeline>(depth));
+        }
+        auto latencies = std::vector<double>();
+        auto failed = std::atomic<bool>(false);
+        for(auto _ : state) {
+            run_peers(n_peers, [&](size_t p) {
+                auto& pl = *pipelines[p];
+                for(size_t i{0}; i < g_window; i++) {
+                    auto idx = pl.acquire();
+                    auto sent = clients[p]->call(
+                        payload,
+                        [&, idx](std::optional<cbdc::buffer> resp) {
+                            if(!resp.has_value()) {
+                                failed = true;
+                            }
+                            pl.release(idx);
+                        });
+                    if(!sent) {
+                        failed = true;
+                        pl.release(idx);
+                    }
+                }
+                pl.drain();
+            });
+            for(auto& pl : pipelines) {
+                pl->collect(latencies);
+            }
+            if(failed) {
+                state.SkipWithError("RPC failed");
+                break;
+            }
+        }
+
+        report(state, latencies, payload_size);
+    }
+
+    void echo_args(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"payload", "peers", "depth"});
+        b->ArgsProduct({{64, 1024, 65536}, {1, 4, 16}, {1, 16, 128}});
+        b->Unit(benchmark::kMillisecond);
+        b->UseRealTime();
+    }
+}
+
+BENCHMARK(connection_manager_echo)->Apply(echo_args);
+BENCHMARK(rpc_tcp_echo)->Apply(echo_args);
@@ -0,0 +1,241 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Note: Contains call to BENCHMARK_MAIN
+
+// Persistence throughput and latency for 32-byte hash records, comparing
+// one round trip per row, array inserts, group commit and the write-behind
+// queue. By default every strategy runs against a mock sink that charges a
+// fixed round trip per append plus a small cost per row, so the benchmark
+// runs without database credentials and shows how each strategy amortizes
+// round trips. Set ORACLE_BENCH_BACKEND=oracle to run against the database
+// configured for oracleDB instead, inserting into admin.oracle_bench
+// (tx_hash RAW(32)). ORACLE_BENCH_RTT_US overrides the mock round trip.
+
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+#include "util/persistence/factory.hpp"
+#include "util/persistence/group_commit.hpp"
+#include "util/persistence/write_behind_queue.hpp"
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr auto g_table = "admin.oracle_bench";
+    constexpr int64_t g_default_rtt_us = 200;
+    constexpr auto g_mock_row_cost = std::chrono::nanoseconds(100);
+    constexpr size_t g_max_batch = 4096;
+
+    /// Sink standing in for a remote database: each append costs one round
+    /// trip plus a per-row transfer cost, and the commit rides along with
+    /// the append.
+    class mock_sink final : public cbdc::persistence::sink {
+      public:
+        explicit mock_sink(std::chrono::microseconds round_trip)
+            : sink(1),
+              m_round_trip(round_trip) {}
+
+        auto append(const cbdc::hash_t* /* records */, size_t count)
+            -> bool override {
+            std::this_thread::sleep_for(
+                m_round_trip
+                + g_mock_row_cost * static_cast<int64_t>(count));
+            return true;
+        }
+
+        auto flush() -> bool override {
+            return true;
+        }
+
+      private:
+        std::chrono::microseconds m_round_trip;
+    };
+
+    auto logger() -> const std::shared_ptr<cbdc::logging::log>& {
+        static const auto log = std::make_shared<cbdc::logging::log>(
+            cbdc::logging::log_level::warn);
+        return log;
+    }
+
+    auto use_oracle() -> bool {
+        const auto* backend = std::getenv("ORACLE_BENCH_BACKEND");
+        return backend != nullptr && std::string(backend) == "oracle";
+    }
+
+    auto mock_round_trip() -> std::chrono::microseconds {
+        auto rtt_us = g_default_rtt_us;
+        if(const auto* rtt = std::getenv("ORACLE_BENCH_RTT_US")) {
+            rtt_us = std::strtoll(rtt, nullptr, 10);
+        }
+        return std::chrono::microseconds(rtt_us);
+    }
+
+    auto make_bench_sink() -> std::unique_ptr<cbdc::persistence::sink> {
+        if(use_oracle()) {
+            auto opts = cbdc::config::options();
+            opts.m_persistence_backend
+                = cbdc::config::persistence_backend::oracle;
+            opts.m_oracle_batch_size = g_max_batch;
+            return cbdc::persistence::make_sink(opts,
+                                                logger(),
+                                                g_table,
+                                                {"tx_hash"});
+        }
+        return std::make_unique<mock_sink>(mock_round_trip());
+    }
+
+    /// Builds the group commit the way the persistence factory does, with
+    /// one leader thread per session, each flushing groups of up to
+    /// max_rows records.
+    auto make_bench_group(size_t max_rows)
+        -> std::unique_ptr<cbdc::persistence::group_commit> {
+        auto opts = cbdc::config::options();
+        opts.m_oracle_batch_size = g_max_batch;
+        opts.m_oracle_group_commit_max_rows = max_rows;
+        if(use_oracle()) {
+            opts.m_persistence_backend
+                = cbdc::config::persistence_backend::oracle;
+            return cbdc::persistence::make_group_commit(opts,
+                                                        logger(),
+                                                        g_table,
+                                                        {"tx_hash"});
+        }
+        auto sinks = std::vector<std::unique_ptr<cbdc::persistence::sink>>();
+        for(size_t i = 0; i < opts.m_oracle_group_commit_threads; i++) {
+            sinks.emplace_back(std::make_unique<mock_sink>(mock_round_trip()));
+        }
+        return std::make_unique<cbdc::persistence::group_commit>(
+            logger(),
+            std::move(sinks),
+            std::chrono::microseconds(opts.m_oracle_group_commit_window_us),
+            opts.m_oracle_group_commit_max_rows);
+    }
+
+    /// Returns a hash unique to the calling benchmark thread and sequence
+    /// number, without the cost of a real hash function.
+    auto make_record(int thread, uint64_t seq) -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        const auto t = static_cast<uint64_t>(thread);
+        std::memcpy(ret.data(), &seq, sizeof(seq));
+        std::memcpy(ret.data() + sizeof(seq), &t, sizeof(t));
+        return ret;
+    }
+
+    std::unique_ptr<cbdc::persistence::group_commit> g_group;
+    std::unique_ptr<cbdc::persistence::write_behind_queue> g_queue;
+}
+
+// One append, and so one round trip and one commit, per row.
+static void oracle_single_row(benchmark::State& state) {
+    auto sink = make_bench_sink();
+    uint64_t seq{0};
+    for(auto _ : state) {
+        auto rec = make_record(state.thread_index(), seq++);
+        if(!sink->append(&rec, 1)) {
+            state.SkipWithError("append failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// One array insert per batch of state.range(0) rows.
+static void oracle_array_dml(benchmark::State& state) {
+    auto sink = make_bench_sink();
+    const auto batch = static_cast<size_t>(state.range(0));
+    auto records = std::vector<cbdc::hash_t>(batch);
+    uint64_t seq{0};
+    for(auto _ : state) {
+        state.PauseTiming();
+        for(auto& rec : records) {
+            rec = make_record(state.thread_index(), seq++);
+        }
+        state.ResumeTiming();
+        if(!sink->append(records.data(), batch)) {
+            state.SkipWithError("append failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Each thread waits for its row to commit, sharing commits with the other
+// threads in groups of up to state.range(0) rows.
+static void oracle_group_commit(benchmark::State& state) {
+    if(state.thread_index() == 0) {
+        g_group = make_bench_group(static_cast<size_t>(state.range(0)));
+        if(!g_group || !g_group->start()) {
+            state.SkipWithError("failed to start group commit");
+        }
+    }
+    uint64_t seq{0};
+    for(auto _ : state) {
+        auto rec = make_record(state.thread_index(), seq++);
+        if(!g_group || !g_group->submit(rec).get()) {
+            state.SkipWithError("commit failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if(state.thread_index() == 0) {
+        g_group.reset();
+    }
+}
+
+// Threads enqueue rows without waiting for them to persist; the queue
+// drains in batches of up to state.range(0) rows. The drain_ms counter is
+// the time to persist what was still queued when the threads finished.
+static void oracle_write_behind(benchmark::State& state) {
+    if(state.thread_index() == 0) {
+        g_queue = std::make_unique<cbdc::persistence::write_behind_queue>(
+            logger(),
+            make_bench_sink(),
+            cbdc::config::defaults::oracle_queue_high_water_mark,
+            static_cast<size_t>(state.range(0)));
+        g_queue->start();
+    }
+    uint64_t seq{0};
+    for(auto _ : state) {
+        auto rec = make_record(state.thread_index(), seq++);
+        if(!g_queue->push(rec)) {
+            state.SkipWithError("push failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if(state.thread_index() == 0) {
+        const auto start = std::chrono::steady_clock::now();
+        g_queue.reset();
+        const auto drain = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start);
+        state.counters["drain_ms"] = drain.count();
+    }
+}
+
+BENCHMARK(oracle_single_row)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(oracle_array_dml)
+    ->RangeMultiplier(16)
+    ->Range(1, g_max_batch)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(oracle_group_commit)
+    ->RangeMultiplier(16)
+    ->Range(16, g_max_batch)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+BENCHMARK(oracle_write_behind)
+    ->RangeMultiplier(16)
+    ->Range(16, g_max_batch)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Raft log store throughput, comparing the LevelDB and segment file
+// implementations on the operations on the replication path: appending a
+// batch of entries followed by a synced flush, reading back recent entries
+// for followers, and packing entries for a catch-up.
+
+#include "util/raft/log_store.hpp"
+#include "util/raft/segment_log_store.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cassert>
+#include <filesystem>
+#include <vector>
+
+namespace {
+    constexpr auto g_log_dir = "raft_log_store_bench";
+    constexpr size_t g_batch_size = 64;
+
+    template<typename Store>
+    class log_store_bench {
+      public:
+        explicit log_store_bench(size_t entry_size) {
+            std::filesystem::remove_all(g_log_dir);
+            [[maybe_unused]] const auto loaded = m_store.load(g_log_dir);
+            assert(loaded);
+            for(size_t i{0}; i < g_batch_size; i++) {
+                auto buf = nuraft::buffer::alloc(entry_size);
+                std::fill_n(buf->data_begin(),
+                            entry_size,
+                            static_cast<unsigned char>(i));
+                m_entries.push_back(
+                    nuraft::cs_new<nuraft::log_entry>(1, buf));
+            }
+        }
+
+        log_store_bench(const log_store_bench&) = delete;
+        auto operator=(const log_store_bench&) -> log_store_bench& = delete;
+        log_store_bench(log_store_bench&&) = delete;
+        auto operator=(log_store_bench&&) -> log_store_bench& = delete;
+
+        ~log_store_bench() {
+            std::filesystem::remove_all(g_log_dir);
+        }
+
+        void append_batch() {
+            for(auto& entry : m_entries) {
+                m_store.append(entry);
+            }
+        }
+
+        Store m_store{};
+        std::vector<nuraft::ptr<nuraft::log_entry>> m_entries;
+    };
+
+    template<typename Store>
+    void raft_log_append_flush(benchmark::State& state) {
+        auto bench
+            = log_store_bench<Store>(static_cast<size_t>(state.range(0)));
+        for(auto _ : state) {
+            bench.append_batch();
+            benchmark::DoNotOptimize(bench.m_store.flush());
+        }
+        state.SetItemsProcessed(state.iterations()
+                                * static_cast<int64_t>(g_batch_size));
+        state.SetBytesProcessed(state.items_processed() * state.range(0));
+    }
+
+    template<typename Store>
+    void raft_log_read_recent(benchmark::State& state) {
+        auto bench
+            = log_store_bench<Store>(static_cast<size_t>(state.range(0)));
+        for(size_t i{0}; i < g_batch_size; i++) {
+            bench.append_batch();
+        }
+        bench.m_store.flush();
+        const auto end = bench.m_store.next_slot();
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(
+                bench.m_store.log_entries(end - g_batch_size, end));
+        }
+        state.SetItemsProcessed(state.iterations()
+                                * static_cast<int64_t>(g_batch_size));
+    }
+
+    template<typename Store>
+    void raft_log_pack(benchmark::State& state) {
+        auto bench
+            = log_store_bench<Store>(static_cast<size_t>(state.range(0)));
+        for(size_t i{0}; i < g_batch_size; i++) {
+            bench.append_batch();
+        }
+        bench.m_store.flush();
+        const auto start = bench.m_store.start_index();
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(
+                bench.m_store.pack(start, static_cast<int32_t>(g_batch_size)));
+        }
+        state.SetItemsProcessed(state.iterations()
+                                * static_cast<int64_t>(g_batch_size));
+    }
+}
+
+BENCHMARK_TEMPLATE(raft_log_append_flush, cbdc::raft::log_store)
+    ->Arg(256)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(raft_log_append_flush, cbdc::raft::segment_log_store)
+    ->Arg(256)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(raft_log_read_recent, cbdc::raft::log_store)
+    ->Arg(256)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(raft_log_read_recent, cbdc::raft::segment_log_store)
+    ->Arg(256)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(raft_log_pack, cbdc::raft::log_store)
+    ->Arg(256)
+    ->Arg(4096);
+BENCHMARK_TEMPLATE(raft_log_pack, cbdc::raft::segment_log_store)
+    ->Arg(256)
+    ->Arg(4096);
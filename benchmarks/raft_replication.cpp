@@ -0,0 +1,283 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Raft replication throughput and commit latency of an in-process cluster
+// on loopback, for tuning raft_max_batch, the heartbeat interval and the
+// snapshot distance against each log store backend. Each iteration
+// replicates a window of entries asynchronously from the leader and waits
+// for all of them to commit. Commit latency percentiles are reported as
+// counters, in microseconds.
+
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+#include "util/raft/node.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <condition_variable>
+#include <filesystem>
+#include <thread>
+
+namespace {
+    constexpr auto g_node_type = "raft_bench";
+    constexpr unsigned short g_base_port = 5400;
+    constexpr size_t g_window = 256;
+
+    class counting_sm : public nuraft::state_machine {
+      public:
+        auto commit(uint64_t log_idx, nuraft::buffer& /* data */)
+            -> nuraft::ptr<nuraft::buffer> override {
+            m_last_commit_index = log_idx;
+            return nuraft::buffer::alloc(1);
+        }
+
+        auto read_logical_snp_obj(nuraft::snapshot& /* s */,
+                                  void*& /* user_snp_ctx */,
+                                  uint64_t /* obj_id */,
+                                  nuraft::ptr<nuraft::buffer>& /* data_out */,
+                                  bool& /* is_last_obj */) -> int override {
+            return 0;
+        }
+
+        void save_logical_snp_obj(nuraft::snapshot& /* s */,
+                                  uint64_t& /* obj_id */,
+                                  nuraft::buffer& /* data */,
+                                  bool /* is_first_obj */,
+                                  bool /* is_last_obj */) override {}
+
+        auto apply_snapshot(nuraft::snapshot& /* s */) -> bool override {
+            return true;
+        }
+
+        auto last_snapshot() -> nuraft::ptr<nuraft::snapshot> override {
+            return m_snapshot;
+        }
+
+        auto last_commit_index() -> uint64_t override {
+            return m_last_commit_index;
+        }
+
+        void create_snapshot(
+            nuraft::snapshot& s,
+            nuraft::async_result<bool>::handler_type& when_done) override {
+            auto snp_buf = s.serialize();
+            m_snapshot = nuraft::snapshot::deserialize(*snp_buf);
+            nuraft::ptr<std::exception> except(nullptr);
+            bool ret = true;
+            when_done(ret, except);
+        }
+
+      private:
+        std::atomic<uint64_t> m_last_commit_index{0};
+        nuraft::ptr<nuraft::snapshot> m_snapshot{};
+    };
+
+    void remove_files(size_t n_nodes) {
+        for(size_t i{0}; i < n_nodes; i++) {
+            const auto id = std::to_string(i);
+            const auto prefix = std::string(g_node_type);
+            std::filesystem::remove_all(prefix + "_raft_log_" + id);
+            std::filesystem::remove_all(prefix + "_raft_config_" + id
+                                        + ".dat");
+            std::filesystem::remove_all(prefix + "_raft_state_" + id
+                                        + ".dat");
+        }
+    }
+
+    class cluster {
+      public:
+        cluster(size_t n_nodes,
+                cbdc::raft::log_store_options log_opts,
+                const nuraft::raft_params& params)
+            : m_n_nodes(n_nodes) {
+            remove_files(m_n_nodes);
+            auto endpoints = std::vector<cbdc::network::endpoint_t>();
+            for(size_t i{0}; i < m_n_nodes; i++) {
+                endpoints.emplace_back(
+                    "127.0.0.1",
+                    static_cast<unsigned short>(g_base_port + i));
+            }
+            for(size_t i{0}; i < m_n_nodes; i++) {
+                m_nodes.emplace_back(std::make_unique<cbdc::raft::node>(
+                    static_cast<int>(i),
+                    endpoints,
+                    g_node_type,
+                    false,
+                    nuraft::cs_new<counting_sm>(),
+                    0,
+                    m_log,
+                    nullptr,
+                    log_opts));
+            }
+
+            // Followers must be listening before node 0 elects itself
+            auto init_threads = std::vector<std::thread>();
+            for(size_t i{1}; i < m_n_nodes; i++) {
+                init_threads.emplace_back([&, i]() {
+                    m_nodes[i]->init(params);
+                });
+            }
+            m_initialized = m_nodes[0]->init(params);
+            for(auto& thr : init_threads) {
+                thr.join();
+            }
+            m_initialized = m_initialized && m_nodes[0]->is_leader();
+        }
+
+        cluster(const cluster&) = delete;
+        auto operator=(const cluster&) -> cluster& = delete;
+        cluster(cluster&&) = delete;
+        auto operator=(cluster&&) -> cluster& = delete;
+
+        ~cluster() {
+            for(auto& node : m_nodes) {
+                node->stop();
+            }
+            m_nodes.clear();
+            remove_files(m_n_nodes);
+        }
+
+        [[nodiscard]] auto initialized() const -> bool {
+            return m_initialized;
+        }
+
+        /// Replicate the given entries from the leader and wait for all of
+        /// them to commit, recording the commit latency of each.
+        auto replicate(const std::vector<nuraft::ptr<nuraft::buffer>>& entries,
+                       std::vector<double>& latencies) -> bool {
+            auto mut = std::mutex();
+            auto cv = std::condition_variable();
+            size_t pending{entries.size()};
+            auto ok = true;
+            for(const auto& entry : entries) {
+                const auto start = std::chrono::steady_clock::now();
+                auto result_fn = [&, start](cbdc::raft::result_type& r,
+                                            nuraft::ptr<std::exception>& err) {
+                    const auto elapsed
+                        = std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start);
+                    std::unique_lock l(mut);
+                    latencies.push_back(elapsed.count());
+                    if(err
+                       || r.get_result_code() != nuraft::cmd_result_code::OK) {
+                        ok = false;
+                    }
+                    if(--pending == 0) {
+                        cv.notify_one();
+                    }
+                };
+                // Each log entry needs its own buffer as NuRaft moves the
+                // buffer position when serializing it
+                if(!m_nodes[0]->replicate(nuraft::buffer::clone(*entry),
+                                          result_fn)) {
+                    std::unique_lock l(mut);
+                    ok = false;
+                    pending--;
+                }
+            }
+            std::unique_lock l(mut);
+            cv.wait(l, [&]() {
+                return pending == 0;
+            });
+            return ok;
+        }
+
+      private:
+        size_t m_n_nodes;
+        std::shared_ptr<cbdc::logging::log> m_log{
+            std::make_shared<cbdc::logging::log>(
+                cbdc::logging::log_level::warn)};
+        std::vector<std::unique_ptr<cbdc::raft::node>> m_nodes;
+        bool m_initialized{false};
+    };
+
+    auto percentile(const std::vector<double>& sorted, double p) -> double {
+        if(sorted.empty()) {
+            return 0.0;
+        }
+        auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size()
+                                                               - 1));
+        return sorted[idx];
+    }
+
+    /// Arguments: cluster size, entry size in bytes, raft_max_batch,
+    /// heartbeat interval in milliseconds and snapshot distance.
+    void raft_replicate(benchmark::State& state,
+                        cbdc::config::raft_log_backend backend) {
+        const auto n_nodes = static_cast<size_t>(state.range(0));
+        const auto entry_size = static_cast<size_t>(state.range(1));
+
+        auto params = nuraft::raft_params();
+        params.max_append_size_ = static_cast<int32_t>(state.range(2));
+        params.heart_beat_interval_ = static_cast<int32_t>(state.range(3));
+        params.election_timeout_lower_bound_
+            = std::max(cbdc::config::defaults::election_timeout_lower_bound,
+                       4 * params.heart_beat_interval_);
+        params.election_timeout_upper_bound_
+            = 2 * params.election_timeout_lower_bound_;
+        params.snapshot_distance_ = static_cast<int32_t>(state.range(4));
+
+        auto log_opts = cbdc::raft::log_store_options{};
+        log_opts.m_backend = backend;
+
+        auto clu = cluster(n_nodes, log_opts, params);
+        if(!clu.initialized()) {
+            state.SkipWithError("Failed to start raft cluster");
+            return;
+        }
+
+        auto entries = std::vector<nuraft::ptr<nuraft::buffer>>();
+        for(size_t i{0}; i < g_window; i++) {
+            auto buf = nuraft::buffer::alloc(entry_size);
+            std::fill_n(buf->data_begin(),
+                        entry_size,
+                        static_cast<unsigned char>(i));
+            entries.push_back(std::move(buf));
+        }
+
+        auto latencies = std::vector<double>();
+        for(auto _ : state) {
+            if(!clu.replicate(entries, latencies)) {
+                state.SkipWithError("Replication failed");
+                break;
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        state.counters["p50_us"] = percentile(latencies, 0.5);
+        state.counters["p99_us"] = percentile(latencies, 0.99);
+        state.counters["p999_us"] = percentile(latencies, 0.999);
+        state.SetItemsProcessed(state.iterations()
+                                * static_cast<int64_t>(g_window));
+        state.SetBytesProcessed(state.items_processed()
+                                * static_cast<int64_t>(entry_size));
+    }
+
+    void replication_args(benchmark::internal::Benchmark* b) {
+        b->ArgNames(
+            {"nodes", "entry_bytes", "max_batch", "heartbeat_ms", "snp_dist"});
+        for(int64_t nodes : {3, 5}) {
+            for(int64_t entry_size : {256, 4096}) {
+                for(int64_t max_batch : {64, 100000}) {
+                    b->Args({nodes, entry_size, max_batch, 100, 0});
+                }
+            }
+        }
+        // Heartbeat and snapshot distance sensitivity for a 3-node cluster
+        b->Args({3, 256, 100000, 1000, 0});
+        b->Args({3, 256, 100000, 100, 1000});
+        b->Unit(benchmark::kMillisecond);
+        b->UseRealTime();
+    }
+}
+
+BENCHMARK_CAPTURE(raft_replicate,
+                  leveldb,
+                  cbdc::config::raft_log_backend::leveldb)
+    ->Apply(replication_args);
+BENCHMARK_CAPTURE(raft_replicate,
+                  segment,
+                  cbdc::config::raft_log_backend::segment)
+    ->Apply(replication_args);
@@ -41,21 +41,21 @@ void reset_wallets(cbdc::transaction::wallet& w1,
 /// @brief Time an N-in, 1-out transaction.
 /// @brief Note: handles benchmark timing, do not time outside function.
 /// @param sender
-/// @param reciever
+/// @param receiver
 /// @param n_in
 /// @param state
 /// @return
 inline bool generate_Nto1_tx(cbdc::transaction::wallet& sender,
-                             cbdc::transaction::wallet& reciever,
+                             cbdc::transaction::wallet& receiver,
                              uint32_t n_in,
                              benchmark::State& state) {
     std::optional<cbdc::transaction::full_tx> maybe_tx{};
     state.ResumeTiming();
-    maybe_tx = sender.send_to(n_in * 2, reciever.generate_key(), true).value();
+    maybe_tx = sender.send_to(n_in * 2, receiver.generate_key(), true).value();
     state.PauseTiming();
     if(maybe_tx.has_value()) {
         sender.confirm_transaction(*maybe_tx);
-        reciever.confirm_transaction(*maybe_tx);
+        receiver.confirm_transaction(*maybe_tx);
         return true;
     }
     return false;
@@ -64,22 +64,22 @@ inline bool generate_Nto1_tx(cbdc::transaction::wallet& sender,
 /// @brief Time an N-in, 2-out transaction.
 /// @brief Note: handles benchmark timing, do not time outside function.
 /// @param sender
-/// @param reciever
+/// @param receiver
 /// @param n_in
 /// @param state
 /// @return
 inline bool generate_Nto2_tx(cbdc::transaction::wallet& sender,
-                             cbdc::transaction::wallet& reciever,
+                             cbdc::transaction::wallet& receiver,
                              uint32_t n_in,
                              benchmark::State& state) {
     std::optional<cbdc::transaction::full_tx> maybe_tx{};
     state.ResumeTiming();
     maybe_tx
-        = sender.send_to(n_in * 2 - 1, reciever.generate_key(), true).value();
+        = sender.send_to(n_in * 2 - 1, receiver.generate_key(), true).value();
     state.PauseTiming();
     if(maybe_tx.has_value()) {
         sender.confirm_transaction(*maybe_tx);
-        reciever.confirm_transaction(*maybe_tx);
+        receiver.confirm_transaction(*maybe_tx);
         return true;
     }
     return false;
@@ -133,6 +133,48 @@ static void Nto2_tx(benchmark::State& state) {
     state.SetComplexityN(state.range(0));
 }
 
+// Generates an N in 1 out transaction spending outputs paid to one key
+auto make_shared_key_tx(cbdc::transaction::wallet& sender,
+                        cbdc::transaction::wallet& receiver,
+                        uint32_t n_in) -> cbdc::transaction::full_tx {
+    auto mint_tx = sender.mint_new_coins(1, n_in * 2);
+    sender.confirm_transaction(mint_tx);
+    auto fan_tx = sender.fan(n_in, 2, sender.generate_key(), true).value();
+    sender.confirm_transaction(fan_tx);
+    return sender.send_to(n_in * 2, receiver.generate_key(), true).value();
+}
+
+// Validates an N in 1 out transaction with check_tx, which verifies each
+// distinct witness once
+static void Nto1_validate(benchmark::State& state) {
+    cbdc::transaction::wallet wallet_a;
+    cbdc::transaction::wallet wallet_b;
+    auto tx = make_shared_key_tx(wallet_a,
+                                 wallet_b,
+                                 static_cast<uint32_t>(state.range(0)));
+    for(auto _ : state) {
+        auto err = cbdc::transaction::validation::check_tx(tx);
+        benchmark::DoNotOptimize(err);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+// Baseline for Nto1_validate: checks every witness individually
+static void Nto1_validate_individual(benchmark::State& state) {
+    cbdc::transaction::wallet wallet_a;
+    cbdc::transaction::wallet wallet_b;
+    auto tx = make_shared_key_tx(wallet_a,
+                                 wallet_b,
+                                 static_cast<uint32_t>(state.range(0)));
+    for(auto _ : state) {
+        for(size_t idx = 0; idx < tx.m_witness.size(); idx++) {
+            auto err = cbdc::transaction::validation::check_witness(tx, idx);
+            benchmark::DoNotOptimize(err);
+        }
+    }
+    state.SetComplexityN(state.range(0));
+}
+
 // Benchmark declarations
 BENCHMARK(Nto1_tx)
     ->RangeMultiplier(2)
@@ -144,3 +186,12 @@ BENCHMARK(Nto2_tx)
     ->Range(1, SWEEP_MAX)
     ->Complexity(benchmark::oAuto);
 
+BENCHMARK(Nto1_validate)
+    ->RangeMultiplier(2)
+    ->Range(1, SWEEP_MAX)
+    ->Complexity(benchmark::oAuto);
+
+BENCHMARK(Nto1_validate_individual)
+    ->RangeMultiplier(2)
+    ->Range(1, SWEEP_MAX)
+    ->Complexity(benchmark::oAuto);
@@ -0,0 +1,318 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// End-to-end throughput and latency of the two-phase commit pipeline, with
+// a sentinel, a coordinator and several locking shards running in one
+// process and talking over loopback RPC. Each iteration submits a window
+// of signed one-input, one-output transactions directly to the sentinel
+// controller and waits for all of them to complete. The outputs are
+// returned to the wallet and spent again by later iterations. Latency from
+// submission to the sentinel's response is reported as counters, in
+// microseconds, so a regression in any stage of the pipeline shows up.
+
+#include "uhs/transaction/wallet.hpp"
+#include "uhs/twophase/coordinator/controller.hpp"
+#include "uhs/twophase/locking_shard/controller.hpp"
+#include "uhs/twophase/sentinel_2pc/controller.hpp"
+#include "util/common/config.hpp"
+#include "util/common/keys.hpp"
+#include "util/common/logging.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <thread>
+
+namespace {
+    constexpr unsigned short g_base_port = 5600;
+    constexpr size_t g_window = 2048;
+    constexpr size_t g_mint_outputs = 256;
+    constexpr uint32_t g_mint_value = 100;
+
+    void remove_files(size_t n_shards) {
+        for(size_t i{0}; i < n_shards; i++) {
+            const auto prefix = "shard" + std::to_string(i);
+            std::filesystem::remove_all(prefix + "_raft_log_0");
+            std::filesystem::remove_all(prefix + "_raft_config_0.dat");
+            std::filesystem::remove_all(prefix + "_raft_state_0.dat");
+            std::filesystem::remove_all("shard_snps_" + std::to_string(i)
+                                        + "_0");
+        }
+        std::filesystem::remove_all("coordinator0_raft_log_0");
+        std::filesystem::remove_all("coordinator0_raft_config_0.dat");
+        std::filesystem::remove_all("coordinator0_raft_state_0.dat");
+    }
+
+    /// Options for one sentinel, one single-node coordinator cluster and
+    /// n_shards single-node locking shards splitting the UHS ID range
+    /// evenly.
+    auto make_options(size_t n_shards, size_t batch_size)
+        -> cbdc::config::options {
+        auto opts = cbdc::config::options();
+        opts.m_twophase_mode = true;
+        opts.m_batch_size = batch_size;
+        opts.m_sentinel_batch_size = batch_size;
+        opts.m_attestation_threshold = 1;
+
+        auto port = g_base_port;
+        auto next_endpoint = [&]() {
+            return cbdc::network::endpoint_t{"127.0.0.1", port++};
+        };
+
+        opts.m_sentinel_endpoints.push_back(next_endpoint());
+        auto secp = std::unique_ptr<secp256k1_context,
+                                    decltype(&secp256k1_context_destroy)>(
+            secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+            &secp256k1_context_destroy);
+        auto skey = cbdc::privkey_t{};
+        skey[skey.size() - 1] = 1;
+        opts.m_sentinel_private_keys[0] = skey;
+        opts.m_sentinel_public_keys.insert(
+            cbdc::pubkey_from_privkey(skey, secp.get()));
+
+        opts.m_coordinator_endpoints.push_back({next_endpoint()});
+        opts.m_coordinator_raft_endpoints.push_back({next_endpoint()});
+
+        constexpr size_t prefixes = 256;
+        for(size_t i{0}; i < n_shards; i++) {
+            auto start = static_cast<uint8_t>(i * prefixes / n_shards);
+            auto end = static_cast<uint8_t>((i + 1) * prefixes / n_shards - 1);
+            opts.m_shard_ranges.emplace_back(start, end);
+            opts.m_locking_shard_endpoints.push_back({next_endpoint()});
+            opts.m_locking_shard_raft_endpoints.push_back({next_endpoint()});
+            opts.m_locking_shard_readonly_endpoints.push_back(
+                {next_endpoint()});
+        }
+        return opts;
+    }
+
+    class pipeline {
+      public:
+        pipeline(size_t n_shards, size_t batch_size)
+            : m_n_shards(n_shards),
+              m_opts(make_options(n_shards, batch_size)) {
+            remove_files(m_n_shards);
+            for(size_t i{0}; i < m_n_shards; i++) {
+                auto shard
+                    = std::make_unique<cbdc::locking_shard::controller>(
+                        i,
+                        0,
+                        m_opts,
+                        m_log);
+                if(!shard->init()) {
+                    return;
+                }
+                m_shards.push_back(std::move(shard));
+            }
+
+            // The coordinator connects to the shards once it becomes leader
+            m_coordinator
+                = std::make_unique<cbdc::coordinator::controller>(0,
+                                                                  0,
+                                                                  m_opts,
+                                                                  m_log);
+            if(!m_coordinator->init()) {
+                return;
+            }
+
+            m_sentinel
+                = std::make_unique<cbdc::sentinel_2pc::controller>(0,
+                                                                   m_opts,
+                                                                   m_log);
+            if(!m_sentinel->init()) {
+                return;
+            }
+
+            m_payee = m_wallet.generate_key();
+            m_initialized = mint(g_window);
+        }
+
+        pipeline(const pipeline&) = delete;
+        auto operator=(const pipeline&) -> pipeline& = delete;
+        pipeline(pipeline&&) = delete;
+        auto operator=(pipeline&&) -> pipeline& = delete;
+
+        ~pipeline() {
+            m_sentinel.reset();
+            m_coordinator.reset();
+            m_shards.clear();
+            remove_files(m_n_shards);
+        }
+
+        [[nodiscard]] auto initialized() const -> bool {
+            return m_initialized;
+        }
+
+        /// Creates and signs the next window of transactions, each spending
+        /// one of the wallet's outputs back to the wallet.
+        auto make_window() -> std::vector<cbdc::transaction::full_tx> {
+            auto txs = std::vector<cbdc::transaction::full_tx>();
+            txs.reserve(g_window);
+            for(size_t i{0}; i < g_window; i++) {
+                auto tx = m_wallet.send_to(1, 1, m_payee, true);
+                if(!tx.has_value()) {
+                    break;
+                }
+                txs.push_back(std::move(tx.value()));
+            }
+            return txs;
+        }
+
+        /// Submits the given transactions to the sentinel and waits for all
+        /// of them to complete, recording the latency of each. Returns the
+        /// outputs of confirmed transactions to the wallet.
+        auto execute(const std::vector<cbdc::transaction::full_tx>& txs,
+                     std::vector<double>& latencies) -> bool {
+            auto mut = std::mutex();
+            auto cv = std::condition_variable();
+            size_t pending{txs.size()};
+            auto confirmed = std::vector<bool>(txs.size());
+            for(size_t i{0}; i < txs.size(); i++) {
+                const auto start = std::chrono::steady_clock::now();
+                auto result_fn =
+                    [&, i, start](
+                        std::optional<cbdc::sentinel::execute_response> res) {
+                        const auto elapsed
+                            = std::chrono::duration<double, std::micro>(
+                                std::chrono::steady_clock::now() - start);
+                        std::unique_lock l(mut);
+                        latencies.push_back(elapsed.count());
+                        confirmed[i] = res.has_value()
+                                    && res->m_tx_status
+                                           == cbdc::sentinel::tx_status::
+                                               confirmed;
+                        if(--pending == 0) {
+                            cv.notify_one();
+                        }
+                    };
+                if(!m_sentinel->execute_transaction(txs[i], result_fn)) {
+                    std::unique_lock l(mut);
+                    pending--;
+                }
+            }
+            {
+                std::unique_lock l(mut);
+                cv.wait(l, [&]() {
+                    return pending == 0;
+                });
+            }
+
+            auto ok = true;
+            for(size_t i{0}; i < txs.size(); i++) {
+                if(confirmed[i]) {
+                    m_wallet.confirm_transaction(txs[i]);
+                } else {
+                    ok = false;
+                }
+            }
+            return ok;
+        }
+
+      private:
+        size_t m_n_shards;
+        cbdc::config::options m_opts;
+        std::shared_ptr<cbdc::logging::log> m_log{
+            std::make_shared<cbdc::logging::log>(
+                cbdc::logging::log_level::warn)};
+        std::vector<std::unique_ptr<cbdc::locking_shard::controller>>
+            m_shards;
+        std::unique_ptr<cbdc::coordinator::controller> m_coordinator;
+        std::unique_ptr<cbdc::sentinel_2pc::controller> m_sentinel;
+        cbdc::transaction::wallet m_wallet;
+        cbdc::pubkey_t m_payee{};
+        std::unique_ptr<secp256k1_context,
+                        decltype(&secp256k1_context_destroy)>
+            m_secp{secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+                   &secp256k1_context_destroy};
+        bool m_initialized{false};
+
+        /// Mints the given number of outputs into the wallet. Sentinels
+        /// reject transactions without inputs, so the mint transactions
+        /// are attested here and sent to the coordinator directly, retrying
+        /// until it has become leader and connected to the shards.
+        auto mint(size_t n_outputs) -> bool {
+            constexpr auto retry_delay = std::chrono::milliseconds(100);
+            constexpr size_t max_attempts = 100;
+            for(size_t minted{0}; minted < n_outputs;
+                minted += g_mint_outputs) {
+                auto tx = m_wallet.mint_new_coins(
+                    std::min(g_mint_outputs, n_outputs - minted),
+                    g_mint_value);
+                auto ctx = cbdc::transaction::compact_tx(tx);
+                ctx.m_attestations.insert(
+                    ctx.sign(m_secp.get(), m_opts.m_sentinel_private_keys[0]));
+                auto success = false;
+                for(size_t i{0}; i < max_attempts && !success; i++) {
+                    auto done = std::promise<std::optional<bool>>();
+                    auto done_fut = done.get_future();
+                    if(m_coordinator->execute_transaction(
+                           ctx,
+                           [&](std::optional<bool> res) {
+                               done.set_value(res);
+                           })) {
+                        success = done_fut.get().value_or(false);
+                    }
+                    if(!success) {
+                        std::this_thread::sleep_for(retry_delay);
+                    }
+                }
+                if(!success) {
+                    return false;
+                }
+                m_wallet.confirm_transaction(tx);
+            }
+            return true;
+        }
+    };
+
+    auto percentile(const std::vector<double>& sorted, double p) -> double {
+        if(sorted.empty()) {
+            return 0.0;
+        }
+        auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size()
+                                                               - 1));
+        return sorted[idx];
+    }
+
+    /// Arguments: number of locking shards and the batch size the sentinel
+    /// and coordinator use.
+    void twophase_pipeline(benchmark::State& state) {
+        const auto n_shards = static_cast<size_t>(state.range(0));
+        const auto batch_size = static_cast<size_t>(state.range(1));
+
+        auto pl = pipeline(n_shards, batch_size);
+        if(!pl.initialized()) {
+            state.SkipWithError("Failed to start 2PC pipeline");
+            return;
+        }
+
+        auto latencies = std::vector<double>();
+        int64_t n_txs{0};
+        for(auto _ : state) {
+            state.PauseTiming();
+            auto txs = pl.make_window();
+            state.ResumeTiming();
+            if(!pl.execute(txs, latencies)) {
+                state.SkipWithError("Transaction execution failed");
+                break;
+            }
+            n_txs += static_cast<int64_t>(txs.size());
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        state.counters["p50_us"] = percentile(latencies, 0.5);
+        state.counters["p99_us"] = percentile(latencies, 0.99);
+        state.counters["p999_us"] = percentile(latencies, 0.999);
+        state.SetItemsProcessed(n_txs);
+    }
+}
+
+BENCHMARK(twophase_pipeline)
+    ->ArgNames({"shards", "batch"})
+    ->ArgsProduct({{1, 2, 4}, {1, 100, 2000}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
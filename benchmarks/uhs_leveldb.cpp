@@ -6,19 +6,36 @@
 #include "uhs/transaction/transaction.hpp"
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
+#include "util/common/leveldb_options.hpp"
 
 #include <benchmark/benchmark.h>
+#include <cstring>
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
+#include <random>
 #include <vector>
 
 static constexpr auto g_shard_test_dir = "test_shard_db";
 
+// number of UHS IDs written before timing lookups
+static constexpr size_t g_lookup_db_keys = 500000;
+
+// tuning profiles compared by the lookup benchmarks, selected by argument:
+// 0 is LevelDB's own defaults, without Bloom filters, 1 the atomizer
+// shard's default profile
+static auto lookup_profile(int64_t idx) -> cbdc::config::leveldb_profile {
+    if(idx == 0) {
+        return cbdc::config::leveldb_profile{0, 4UL * 1024 * 1024, 0, true};
+    }
+    return cbdc::config::options{}.m_shard_leveldb;
+}
+
 // container for database variables
 struct db_container {
     leveldb::DB* db_ptr{};
+    cbdc::leveldb_options db_opts;
     leveldb::Options opt;
     leveldb::WriteBatch batch;
     leveldb::WriteOptions write_opt;
@@ -39,9 +56,10 @@ struct db_container {
     // default constructor
     // this is intended to mimic what benchmark fixtures
     // do, while permitting benchmark modificaitons
-    db_container() {
-        opt.create_if_missing = true;
-
+    explicit db_container(const cbdc::config::leveldb_profile& profile
+                          = cbdc::config::options{}.m_shard_leveldb)
+        : db_opts(profile),
+          opt(db_opts.get()) {
         auto mint_tx1 = wallet1.mint_new_coins(2, 100);
         auto mint_tx2 = wallet2.mint_new_coins(1, 100);
         wallet1.confirm_transaction(mint_tx1);
@@ -196,7 +214,62 @@ static void uhs_leveldb_shard_sim_brief(benchmark::State& state) {
     db.tear_down();
 }
 
+// point lookups of UHS IDs against a compacted database, as the shard does
+// when checking transaction inputs; half the lookups miss
+static void uhs_leveldb_point_lookup(benchmark::State& state) {
+    auto db_opts = cbdc::leveldb_options(lookup_profile(state.range(0)));
+    leveldb::DB* db_ptr{};
+    auto res = leveldb::DB::Open(db_opts.get(), g_shard_test_dir, &db_ptr);
+    auto db = std::unique_ptr<leveldb::DB>(db_ptr);
+    if(!res.ok()) {
+        state.SkipWithError(res.ToString().c_str());
+        return;
+    }
+
+    auto rng = std::mt19937_64(0);
+    const auto next_key = [&]() {
+        cbdc::hash_t key{};
+        for(size_t i = 0; i < key.size(); i += sizeof(uint64_t)) {
+            const auto word = rng();
+            std::memcpy(&key[i], &word, sizeof(word));
+        }
+        return key;
+    };
+    const auto as_slice = [](const cbdc::hash_t& key) {
+        return leveldb::Slice(reinterpret_cast<const char*>(key.data()),
+                              key.size());
+    };
+
+    auto present = std::vector<cbdc::hash_t>();
+    present.reserve(g_lookup_db_keys);
+    leveldb::WriteBatch batch;
+    for(size_t i = 0; i < g_lookup_db_keys; i++) {
+        present.push_back(next_key());
+        batch.Put(as_slice(present.back()), leveldb::Slice());
+        if(batch.ApproximateSize() > 4UL * 1024 * 1024) {
+            db->Write(leveldb::WriteOptions(), &batch);
+            batch.Clear();
+        }
+    }
+    db->Write(leveldb::WriteOptions(), &batch);
+    db->CompactRange(nullptr, nullptr);
+
+    std::string val;
+    size_t i{0};
+    for(auto _ : state) {
+        const auto key = (i % 2 == 0) ? present[i % present.size()]
+                                      : next_key();
+        i++;
+        benchmark::DoNotOptimize(
+            db->Get(leveldb::ReadOptions(), as_slice(key), &val));
+    }
+
+    db.reset();
+    std::filesystem::remove_all(g_shard_test_dir);
+}
+
 BENCHMARK(uhs_leveldb_put_new)->Threads(1);
 BENCHMARK(uhs_leveldb_item_delete)->Threads(1);
 BENCHMARK(uhs_leveldb_shard_sim)->Threads(1);
 BENCHMARK(uhs_leveldb_shard_sim_brief)->Threads(1);
+BENCHMARK(uhs_leveldb_point_lookup)->ArgName("profile")->Arg(0)->Arg(1);
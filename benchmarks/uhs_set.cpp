@@ -6,13 +6,16 @@
 #include "uhs/transaction/transaction.hpp"
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
+#include "util/common/flat_hash_set.hpp"
 #include "util/common/hash.hpp"
 #include "util/common/hashmap.hpp"
 
 #include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
+#include <random>
 #include <unordered_set>
 #include <variant>
+#include <vector>
 
 class uhs_set : public ::benchmark::Fixture {
   protected:
@@ -31,6 +34,7 @@ class uhs_set : public ::benchmark::Fixture {
     cbdc::transaction::compact_tx m_cp_tx;
 
     std::unordered_set<cbdc::hash_t, cbdc::hashing::null> set;
+    cbdc::flat_hash_set flat_set;
 };
 
 // benchmark how long it takes to emplace new values into an unordered set
@@ -62,3 +66,77 @@ BENCHMARK_F(uhs_set, erase_item)(benchmark::State& state) {
         m_cp_tx = cbdc::transaction::compact_tx(m_valid_tx);
     }
 }
+
+// benchmark how long it takes to emplace new values into a flat set
+BENCHMARK_F(uhs_set, flat_insert_new)(benchmark::State& state) {
+    for(auto _ : state) {
+        m_valid_tx = wallet1.send_to(2, wallet1.generate_key(), true).value();
+        wallet1.confirm_transaction(m_valid_tx);
+        m_cp_tx = cbdc::transaction::compact_tx(m_valid_tx);
+
+        state.ResumeTiming();
+        flat_set.insert(m_cp_tx.m_id);
+        state.PauseTiming();
+    }
+}
+
+// benchmark how long it takes to remove values from a flat set
+BENCHMARK_F(uhs_set, flat_erase_item)(benchmark::State& state) {
+    for(auto _ : state) {
+        m_valid_tx = wallet1.send_to(2, wallet1.generate_key(), true).value();
+        wallet1.confirm_transaction(m_valid_tx);
+        m_cp_tx = cbdc::transaction::compact_tx(m_valid_tx);
+        flat_set.insert(m_cp_tx.m_id);
+        state.ResumeTiming();
+        flat_set.erase(m_cp_tx.m_id);
+        state.PauseTiming();
+    }
+}
+
+namespace {
+    auto random_hashes(size_t n) -> std::vector<cbdc::hash_t> {
+        auto rng = std::mt19937_64{n};
+        auto ret = std::vector<cbdc::hash_t>(n);
+        for(auto& h : ret) {
+            for(auto& b : h) {
+                b = static_cast<unsigned char>(rng());
+            }
+        }
+        return ret;
+    }
+}
+
+// benchmark lookups of present and absent keys in a large unordered set
+static void unordered_lookup(benchmark::State& state) {
+    const auto n = static_cast<size_t>(state.range(0));
+    auto keys = random_hashes(n * 2);
+    auto set = std::unordered_set<cbdc::hash_t, cbdc::hashing::null>();
+    set.reserve(n);
+    for(size_t i{0}; i < n; i++) {
+        set.emplace(keys[i]);
+    }
+    size_t i{0};
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(set.find(keys[i]) != set.end());
+        i = (i + 1) % keys.size();
+    }
+}
+
+// benchmark lookups of present and absent keys in a large flat set
+static void flat_lookup(benchmark::State& state) {
+    const auto n = static_cast<size_t>(state.range(0));
+    auto keys = random_hashes(n * 2);
+    auto set = cbdc::flat_hash_set();
+    set.reserve(n);
+    for(size_t i{0}; i < n; i++) {
+        set.insert(keys[i]);
+    }
+    size_t i{0};
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(set.contains(keys[i]));
+        i = (i + 1) % keys.size();
+    }
+}
+
+BENCHMARK(unordered_lookup)->RangeMultiplier(10)->Range(10000, 10000000);
+BENCHMARK(flat_lookup)->RangeMultiplier(10)->Range(10000, 10000000);
@@ -89,3 +89,4 @@ run_test_suite () {
 }
 
 run_test_suite "benchmarks/run_benchmarks"
+run_test_suite "benchmarks/oracle_bench"
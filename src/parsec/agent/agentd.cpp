@@ -70,8 +70,10 @@ auto main(int argc, char** argv) -> int {
         return 1;
     }
 
-    auto directory
-        = std::make_shared<cbdc::parsec::directory::impl>(shards.size());
+    auto directory = std::make_shared<cbdc::parsec::directory::impl>(
+        cbdc::parsec::directory::make_placement(cfg->m_placement,
+                                                shards.size(),
+                                                cfg->m_placement_prefix_len));
     auto broker
         = std::make_shared<cbdc::parsec::broker::impl>(cfg->m_component_id,
                                                        shards,
@@ -134,9 +136,15 @@ auto main(int argc, char** argv) -> int {
             log,
             cfg.value());
     } else if(cfg->m_runner_type == cbdc::parsec::runner_type::evm) {
+        auto http_opts = cbdc::rpc::json_rpc_http_server::options{};
+        http_opts.m_listeners = cfg->m_agent_http_listeners;
+        http_opts.m_connection_timeout = cfg->m_agent_http_timeout;
+        http_opts.m_connection_limit = cfg->m_agent_http_connection_limit;
+        http_opts.m_keep_alive = cfg->m_agent_http_keep_alive;
         auto rpc_server = std::make_unique<cbdc::rpc::json_rpc_http_server>(
             cfg->m_agent_endpoints[cfg->m_component_id],
-            true);
+            true,
+            http_opts);
         server = std::make_unique<cbdc::parsec::agent::rpc::http_server>(
             std::move(rpc_server),
             broker,
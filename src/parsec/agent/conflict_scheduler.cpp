@@ -0,0 +1,82 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "conflict_scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace cbdc::parsec::agent {
+    void conflict_scheduler::submit(
+        size_t id,
+        std::vector<runtime_locking_shard::key_type> keys,
+        start_callback_type start) {
+        {
+            std::unique_lock l(m_mut);
+            auto& tx = m_txs[id];
+            for(auto& key : keys) {
+                auto& queue = m_queues[key];
+                // Skip duplicate keys, which were queued just before
+                if(!queue.empty() && queue.back() == id) {
+                    continue;
+                }
+                queue.push_back(id);
+                tx.m_keys.emplace_back(std::move(key));
+            }
+            if(!is_ready(id)) {
+                tx.m_start = std::move(start);
+                return;
+            }
+            tx.m_started = true;
+        }
+        start();
+    }
+
+    void conflict_scheduler::release(size_t id) {
+        auto ready = std::vector<start_callback_type>();
+        {
+            std::unique_lock l(m_mut);
+            auto it = m_txs.find(id);
+            if(it == m_txs.end()) {
+                return;
+            }
+            auto keys = std::move(it->second.m_keys);
+            m_txs.erase(it);
+            for(const auto& key : keys) {
+                auto qit = m_queues.find(key);
+                assert(qit != m_queues.end());
+                auto& queue = qit->second;
+                assert(!queue.empty() && queue.front() == id);
+                queue.pop_front();
+                if(queue.empty()) {
+                    m_queues.erase(qit);
+                    continue;
+                }
+                auto& next = m_txs.at(queue.front());
+                if(!next.m_started && is_ready(queue.front())) {
+                    next.m_started = true;
+                    ready.emplace_back(std::move(next.m_start));
+                }
+            }
+        }
+        for(auto& start : ready) {
+            start();
+        }
+    }
+
+    auto conflict_scheduler::size() const -> size_t {
+        std::unique_lock l(m_mut);
+        return m_txs.size();
+    }
+
+    auto conflict_scheduler::is_ready(size_t id) const -> bool {
+        const auto& keys = m_txs.at(id).m_keys;
+        return std::all_of(keys.begin(),
+                           keys.end(),
+                           [&](const runtime_locking_shard::key_type& key) {
+                               return m_queues.at(key).front() == id;
+                           });
+    }
+}
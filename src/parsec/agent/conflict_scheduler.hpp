@@ -0,0 +1,74 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_CONFLICT_SCHEDULER_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_CONFLICT_SCHEDULER_H_
+
+#include "parsec/runtime_locking_shard/interface.hpp"
+#include "util/common/hashmap.hpp"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace cbdc::parsec::agent {
+    /// Admits transactions for execution so that transactions predicted to
+    /// write the same key run one after another, in arrival order, while
+    /// transactions without predicted conflicts run in parallel. Left to
+    /// the shards, such transactions wound each other and retry repeatedly
+    /// when a key is hot. Predictions need not be complete: conflicts on
+    /// keys not predicted are still resolved by the shards.
+    class conflict_scheduler {
+      public:
+        /// Callback which starts executing a transaction.
+        using start_callback_type = std::function<void()>;
+
+        /// Submits a transaction for execution. Starts it immediately if
+        /// none of its keys are predicted to be written by earlier
+        /// unfinished transactions, otherwise once those finish.
+        /// \param id unique transaction ID.
+        /// \param keys keys the transaction is predicted to write.
+        /// \param start function to call to start the transaction. Called
+        ///              without the scheduler's lock held, on the thread
+        ///              calling submit or release.
+        void submit(size_t id,
+                    std::vector<runtime_locking_shard::key_type> keys,
+                    start_callback_type start);
+
+        /// Marks a transaction as finished, starting any transactions which
+        /// were waiting only for it. Must be called once for each submitted
+        /// transaction, after it completes or fails permanently.
+        /// \param id transaction ID passed to submit.
+        void release(size_t id);
+
+        /// Returns the number of submitted transactions which have not
+        /// finished.
+        /// \return number of running and waiting transactions.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
+        struct tx_type {
+            std::vector<runtime_locking_shard::key_type> m_keys;
+            start_callback_type m_start;
+            bool m_started{false};
+        };
+
+        mutable std::mutex m_mut;
+        std::unordered_map<size_t, tx_type> m_txs;
+        /// Transactions predicted to write each key, in arrival order.
+        std::unordered_map<runtime_locking_shard::key_type,
+                           std::deque<size_t>,
+                           hashing::const_sip_hash<buffer>>
+            m_queues;
+
+        /// Returns true if the transaction is first in the queue of each of
+        /// its keys.
+        [[nodiscard]] auto is_ready(size_t id) const -> bool;
+    };
+}
+
+#endif
@@ -21,7 +21,8 @@ namespace cbdc::parsec::agent {
                broker::lock_type initial_lock_type,
                bool is_readonly_run,
                std::shared_ptr<secp256k1_context> secp,
-               std::shared_ptr<thread_pool> t_pool)
+               std::shared_ptr<thread_pool> t_pool,
+               std::shared_ptr<read_cache> cache)
         : interface(std::move(function),
                     std::move(param),
                     std::move(result_callback)),
@@ -33,7 +34,8 @@ namespace cbdc::parsec::agent {
                                               : initial_lock_type),
           m_is_readonly_run(is_readonly_run),
           m_secp(std::move(secp)),
-          m_threads(std::move(t_pool)) {}
+          m_threads(std::move(t_pool)),
+          m_read_cache(std::move(cache)) {}
 
     auto impl::exec() -> bool {
         std::unique_lock l(m_mut);
@@ -151,14 +153,21 @@ namespace cbdc::parsec::agent {
         } else {
             m_log->trace("do_start ", get_function().to_hex());
 
-            auto tl_success = m_broker->try_lock(
-                m_ticket_number.value(),
-                get_function(),
-                m_initial_lock_type,
-                [this](
-                    const broker::interface::try_lock_return_type& lock_res) {
-                    handle_function(lock_res);
-                });
+            auto tl_success = false;
+            if(m_is_readonly_run) {
+                tl_success = do_read_request(
+                    {get_function()},
+                    [this](broker::interface::try_lock_batch_return_type res) {
+                        handle_function(to_try_lock_result(std::move(res)));
+                    });
+            } else {
+                tl_success = m_broker->try_lock(
+                    m_ticket_number.value(),
+                    get_function(),
+                    m_initial_lock_type,
+                    [this](const broker::interface::try_lock_return_type&
+                               lock_res) { handle_function(lock_res); });
+            }
             if(!tl_success) {
                 m_state = state::function_get_failed;
                 m_log->error("Failed to contact broker to retrieve "
@@ -219,24 +228,192 @@ namespace cbdc::parsec::agent {
             return true;
         }
 
+        // Read-only runs take no locks, so they read the last committed
+        // values instead
+        if(m_is_readonly_run) {
+            if(m_read_cache) {
+                if(auto cached = m_read_cache->get(key)) {
+                    handle_try_lock_response(res_cb,
+                                             std::move(cached.value()));
+                    return true;
+                }
+            }
+            return do_read_request(
+                {std::move(key)},
+                [this, cb = std::move(res_cb)](
+                    broker::interface::try_lock_batch_return_type res) {
+                    handle_try_lock_response(
+                        cb,
+                        to_try_lock_result(std::move(res)));
+                });
+        }
+
         auto it = m_requested_locks.find(key);
         if(it == m_requested_locks.end()
            || it->second == broker::lock_type::read) {
             m_requested_locks[key] = locktype;
         }
 
-        auto actual_lock_type
-            = m_is_readonly_run ? broker::lock_type::read : locktype;
         return m_broker->try_lock(
             m_ticket_number.value(),
             std::move(key),
-            actual_lock_type,
+            locktype,
             [this, cb = std::move(res_cb)](
                 broker::interface::try_lock_return_type res) {
                 handle_try_lock_response(cb, std::move(res));
             });
     }
 
+    auto impl::do_read_request(
+        std::vector<broker::key_type> keys,
+        broker::interface::try_lock_batch_callback_type res_cb) -> bool {
+        auto cache_keys = std::vector<broker::key_type>();
+        if(m_read_cache) {
+            cache_keys = keys;
+        }
+        return m_broker->read(
+            std::move(keys),
+            [this, cb = std::move(res_cb), cache_keys](
+                broker::interface::read_return_type res) {
+                std::visit(
+                    overloaded{
+                        [&](std::vector<runtime_locking_shard::committed_value>&
+                                vals) {
+                            auto values = std::vector<broker::value_type>();
+                            values.reserve(vals.size());
+                            for(size_t i = 0; i < vals.size(); i++) {
+                                if(!cache_keys.empty()) {
+                                    m_read_cache->put(cache_keys[i],
+                                                      vals[i].m_value,
+                                                      vals[i].m_version);
+                                }
+                                values.emplace_back(
+                                    std::move(vals[i].m_value));
+                            }
+                            cb(std::move(values));
+                        },
+                        [&](broker::interface::error_code e) {
+                            cb(e);
+                        }},
+                    res);
+            });
+    }
+
+    auto impl::to_try_lock_result(
+        broker::interface::try_lock_batch_return_type res)
+        -> broker::interface::try_lock_return_type {
+        return std::visit(
+            overloaded{[](std::vector<broker::value_type>& vals)
+                           -> broker::interface::try_lock_return_type {
+                           assert(vals.size() == 1);
+                           return std::move(vals.front());
+                       },
+                       [](broker::interface::error_code e)
+                           -> broker::interface::try_lock_return_type {
+                           return e;
+                       },
+                       [](runtime_locking_shard::shard_error& e)
+                           -> broker::interface::try_lock_return_type {
+                           return std::move(e);
+                       }},
+            res);
+    }
+
+    void impl::handle_try_lock_batch_response(
+        const broker::interface::try_lock_batch_callback_type& res_cb,
+        broker::interface::try_lock_batch_return_type res) {
+        std::unique_lock l(m_mut);
+        if(m_state != state::function_started) {
+            m_log->error("try_lock_batch response while not in "
+                         "function_started state");
+            return;
+        }
+        if(std::holds_alternative<runtime_locking_shard::shard_error>(res)) {
+            auto& err = std::get<runtime_locking_shard::shard_error>(res);
+            if(err.m_error_code
+               == runtime_locking_shard::error_code::wounded) {
+                m_wounded = true;
+            }
+        }
+        res_cb(std::move(res));
+    }
+
+    auto impl::do_try_lock_batch_request(
+        std::vector<broker::lock_request_type> locks,
+        broker::interface::try_lock_batch_callback_type res_cb) -> bool {
+        std::unique_lock l(m_mut);
+        assert(m_ticket_number.has_value());
+        if(m_state != state::function_started) {
+            m_log->warn("do_try_lock_batch_request while not in "
+                        "function_started state");
+            return false;
+        }
+
+        for(const auto& lock : locks) {
+            if(m_is_readonly_run && lock.second == broker::lock_type::write) {
+                m_log->warn("do_try_lock_batch_request of type write when "
+                            "m_is_readonly_run = true");
+                return false;
+            }
+        }
+
+        if(m_wounded) {
+            m_log->debug(
+                "Skipping lock request because ticket is already wounded");
+            handle_try_lock_batch_response(
+                res_cb,
+                runtime_locking_shard::shard_error{
+                    runtime_locking_shard::error_code::wounded,
+                    std::nullopt});
+            return true;
+        }
+
+        if(m_is_readonly_run) {
+            if(m_read_cache) {
+                auto values = std::vector<broker::value_type>();
+                values.reserve(locks.size());
+                for(const auto& lock : locks) {
+                    auto cached = m_read_cache->get(lock.first);
+                    if(!cached.has_value()) {
+                        break;
+                    }
+                    values.emplace_back(std::move(cached.value()));
+                }
+                if(values.size() == locks.size()) {
+                    handle_try_lock_batch_response(res_cb, std::move(values));
+                    return true;
+                }
+            }
+            auto keys = std::vector<broker::key_type>();
+            keys.reserve(locks.size());
+            for(auto& lock : locks) {
+                keys.emplace_back(std::move(lock.first));
+            }
+            return do_read_request(
+                std::move(keys),
+                [this, cb = std::move(res_cb)](
+                    broker::interface::try_lock_batch_return_type res) {
+                    handle_try_lock_batch_response(cb, std::move(res));
+                });
+        }
+
+        for(auto& [key, locktype] : locks) {
+            auto it = m_requested_locks.find(key);
+            if(it == m_requested_locks.end()
+               || it->second == broker::lock_type::read) {
+                m_requested_locks[key] = locktype;
+            }
+        }
+
+        return m_broker->try_lock_batch(
+            m_ticket_number.value(),
+            std::move(locks),
+            [this, cb = std::move(res_cb)](
+                broker::interface::try_lock_batch_return_type res) {
+                handle_try_lock_batch_response(cb, std::move(res));
+            });
+    }
+
     void
     impl::handle_function(const broker::interface::try_lock_return_type& res) {
         std::unique_lock l(m_mut);
@@ -249,54 +426,39 @@ namespace cbdc::parsec::agent {
             overloaded{
                 [&](const broker::value_type& v) {
                     m_state = state::function_started;
-                    auto reacq_locks
-                        = std::make_shared<broker::held_locks_set_type>();
-                    (*reacq_locks).swap(m_requested_locks);
+                    auto reacq_locks = broker::held_locks_set_type();
+                    reacq_locks.swap(m_requested_locks);
 
-                    if(reacq_locks->empty()) {
+                    if(reacq_locks.empty()) {
                         do_runner(v);
                         return;
                     }
 
                     // Re-acquire previously held locks upon retries
-                    // immediately
-                    m_log->trace("Re-acquiring locks for",
+                    // immediately, in a single batch
+                    m_log->trace("Re-acquiring",
+                                 reacq_locks.size(),
+                                 "locks for",
                                  m_ticket_number.value());
-                    auto reacquired = std::make_shared<std::atomic<size_t>>();
-                    for(auto& it : *reacq_locks) {
-                        m_log->trace("Re-acquiring lock on",
-                                     it.first.to_hex(),
-                                     "type",
-                                     static_cast<int>(it.second),
-                                     "for",
-                                     m_ticket_number.value());
-                        auto success = do_try_lock_request(
-                            it.first,
-                            it.second,
-                            [this, reacquired, v, reacq_locks](
-                                const broker::interface::
-                                    try_lock_return_type&) {
-                                std::unique_lock ll(m_mut);
-                                auto reacq = (*reacquired)++;
-                                m_log->trace("Re-acquired",
-                                             reacq + 1,
-                                             "of",
-                                             reacq_locks->size(),
-                                             "locks for",
-                                             m_ticket_number.value());
-
-                                if(reacq + 1 == reacq_locks->size()) {
-                                    do_runner(v);
-                                }
-                            });
-                        if(!success) {
-                            m_log->error("Try lock request failed for",
+                    auto locks = std::vector<broker::lock_request_type>(
+                        reacq_locks.begin(),
+                        reacq_locks.end());
+                    auto success = do_try_lock_batch_request(
+                        std::move(locks),
+                        [this, v](const broker::interface::
+                                      try_lock_batch_return_type&) {
+                            std::unique_lock ll(m_mut);
+                            m_log->trace("Re-acquired locks for",
                                          m_ticket_number.value());
-                            m_state = state::function_get_failed;
-                            m_result = error_code::function_retrieval;
-                            do_result();
-                            return;
-                        }
+                            do_runner(v);
+                        });
+                    if(!success) {
+                        m_log->error("Try lock request failed for",
+                                     m_ticket_number.value());
+                        m_state = state::function_get_failed;
+                        m_result = error_code::function_retrieval;
+                        do_result();
+                        return;
                     }
                 },
                 [&](broker::interface::error_code /* e */) {
@@ -338,6 +500,12 @@ namespace cbdc::parsec::agent {
                                            locktype,
                                            std::move(res_cb));
             },
+            [this](std::vector<broker::lock_request_type> locks,
+                   broker::interface::try_lock_batch_callback_type res_cb)
+                -> bool {
+                return do_try_lock_batch_request(std::move(locks),
+                                                 std::move(res_cb));
+            },
             m_secp,
             m_restarted ? nullptr : m_threads,
             m_ticket_number.value());
@@ -468,6 +636,11 @@ namespace cbdc::parsec::agent {
             m_log->trace(this,
                          "Agent handled commit for",
                          m_ticket_number.value());
+            if(m_read_cache && !m_is_readonly_run) {
+                m_read_cache->update(
+                    std::get<broker::state_update_type>(m_result.value()),
+                    m_ticket_number.value());
+            }
             do_finish();
         }
     }
@@ -651,7 +824,7 @@ namespace cbdc::parsec::agent {
 
     impl::~impl() {
         std::unique_lock l(m_mut);
-        if(m_state != state::finish_complete) {
+        if(m_state != state::finish_complete && m_state != state::init) {
             m_log->fatal(
                 this,
                 "Agent state wasn't finished at destruction, state was:",
@@ -669,4 +842,50 @@ namespace cbdc::parsec::agent {
         std::unique_lock l(m_mut);
         return m_state;
     }
+
+    auto impl::get_write_keys() const -> std::vector<broker::key_type> {
+        std::unique_lock l(m_mut);
+        auto ret = std::vector<broker::key_type>();
+        for(const auto& [key, locktype] : m_requested_locks) {
+            if(locktype == broker::lock_type::write) {
+                ret.emplace_back(key);
+            }
+        }
+        return ret;
+    }
+
+    auto impl::recycle() -> bool {
+        std::unique_lock l(m_mut);
+        if(m_state != state::finish_complete) {
+            return false;
+        }
+        // The runner may still be returning from the callback which
+        // finished the agent, so it is released on reuse instead
+        m_ticket_number = std::nullopt;
+        m_result = std::nullopt;
+        m_state = state::init;
+        m_permanent_error = false;
+        m_tx_id = std::nullopt;
+        m_wounded = false;
+        m_requested_locks.clear();
+        m_restarted = false;
+        set_request({}, {}, nullptr);
+        return true;
+    }
+
+    void impl::reuse(runtime_locking_shard::key_type function,
+                     parameter_type param,
+                     exec_callback_type result_callback,
+                     broker::lock_type initial_lock_type,
+                     bool is_readonly_run) {
+        std::unique_lock l(m_mut);
+        assert(m_state == state::init);
+        m_runner.reset();
+        set_request(std::move(function),
+                    std::move(param),
+                    std::move(result_callback));
+        m_initial_lock_type
+            = is_readonly_run ? broker::lock_type::read : initial_lock_type;
+        m_is_readonly_run = is_readonly_run;
+    }
 }
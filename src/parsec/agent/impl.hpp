@@ -9,6 +9,7 @@
 #include "interface.hpp"
 #include "parsec/agent/runners/interface.hpp"
 #include "parsec/broker/interface.hpp"
+#include "read_cache.hpp"
 #include "util/common/logging.hpp"
 
 namespace cbdc::parsec::agent {
@@ -70,6 +71,9 @@ namespace cbdc::parsec::agent {
         /// \param is_readonly_run true if the agent should skip writing state changes.
         /// \param secp secp256k1 context.
         /// \param t_pool shared thread pool between all agents.
+        /// \param cache cache serving the reads of read-only runs and
+        ///              updated with committed state, or nullptr to always
+        ///              read through the shards.
         impl(std::shared_ptr<logging::log> logger,
              cbdc::parsec::config cfg,
              runner::interface::factory_type runner_factory,
@@ -80,9 +84,11 @@ namespace cbdc::parsec::agent {
              broker::lock_type initial_lock_type,
              bool is_readonly_run,
              std::shared_ptr<secp256k1_context> secp,
-             std::shared_ptr<thread_pool> t_pool);
+             std::shared_ptr<thread_pool> t_pool,
+             std::shared_ptr<read_cache> cache = nullptr);
 
-        /// Ensures function execution is complete before destruction.
+        /// Ensures function execution is complete, or was never started,
+        /// before destruction.
         ~impl() override;
 
         impl(const impl&) = delete;
@@ -104,6 +110,37 @@ namespace cbdc::parsec::agent {
         /// \return ticket state.
         auto get_state() const -> state;
 
+        /// Returns the keys the agent requested write locks on during its
+        /// latest attempt. After the agent is wounded, these are the keys
+        /// most likely to have been contended.
+        /// \return write-locked keys.
+        auto get_write_keys() const -> std::vector<broker::key_type>;
+
+        /// Clears the state of a finished agent and releases its request,
+        /// so the agent can be pooled and later reused with \ref reuse
+        /// instead of constructing a new one.
+        /// \return false if the agent has not finished, in which case it is
+        ///         left unchanged and cannot be reused.
+        auto recycle() -> bool;
+
+        /// Sets up a recycled agent to execute another request, as if newly
+        /// constructed with the given arguments and the remaining arguments
+        /// of the original constructor. Releases the runner of the previous
+        /// request.
+        /// \param function key containing function bytecode.
+        /// \param param function parameter.
+        /// \param result_callback function to call with function execution
+        ///                        result.
+        /// \param initial_lock_type type of lock to acquire on initial
+        ///                          function code.
+        /// \param is_readonly_run true if the agent should skip writing
+        ///                        state changes.
+        void reuse(runtime_locking_shard::key_type function,
+                   parameter_type param,
+                   exec_callback_type result_callback,
+                   broker::lock_type initial_lock_type,
+                   bool is_readonly_run);
+
       private:
         std::shared_ptr<logging::log> m_log;
         const cbdc::parsec::config m_cfg;
@@ -123,6 +160,7 @@ namespace cbdc::parsec::agent {
         bool m_wounded{false};
         broker::held_locks_set_type m_requested_locks{};
         bool m_restarted{false};
+        std::shared_ptr<read_cache> m_read_cache;
 
         void handle_begin(broker::interface::ticketnum_or_errcode_type res);
 
@@ -153,6 +191,12 @@ namespace cbdc::parsec::agent {
                             broker::interface::try_lock_callback_type res_cb)
             -> bool;
 
+        /// Request the broker to attempt to lock several keys at once
+        /// \return true is returned unless the system is in an unexpected state
+        [[nodiscard]] auto do_try_lock_batch_request(
+            std::vector<broker::lock_request_type> locks,
+            broker::interface::try_lock_batch_callback_type res_cb) -> bool;
+
         void
         handle_rollback(broker::interface::rollback_return_type rollback_res);
 
@@ -161,6 +205,23 @@ namespace cbdc::parsec::agent {
         void handle_try_lock_response(
             const broker::interface::try_lock_callback_type& res_cb,
             broker::interface::try_lock_return_type res);
+
+        /// Reads the last committed values of keys for a read-only run,
+        /// without locking them, and caches the values if there is a read
+        /// cache.
+        [[nodiscard]] auto
+        do_read_request(std::vector<broker::key_type> keys,
+                        broker::interface::try_lock_batch_callback_type res_cb)
+            -> bool;
+
+        /// Converts the result of reading a single key to a try lock result.
+        static auto
+        to_try_lock_result(broker::interface::try_lock_batch_return_type res)
+            -> broker::interface::try_lock_return_type;
+
+        void handle_try_lock_batch_response(
+            const broker::interface::try_lock_batch_callback_type& res_cb,
+            broker::interface::try_lock_batch_return_type res);
     };
 }
 
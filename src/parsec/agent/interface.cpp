@@ -13,6 +13,14 @@ namespace cbdc::parsec::agent {
           m_param(std::move(param)),
           m_result_callback(std::move(result_callback)) {}
 
+    void interface::set_request(runtime_locking_shard::key_type function,
+                                parameter_type param,
+                                exec_callback_type result_callback) {
+        m_function = std::move(function);
+        m_param = std::move(param);
+        m_result_callback = std::move(result_callback);
+    }
+
     auto interface::get_function() const -> runtime_locking_shard::key_type {
         return m_function;
     }
@@ -77,6 +77,16 @@ namespace cbdc::parsec::agent {
         /// \return result callback function.
         [[nodiscard]] auto get_result_callback() const -> exec_callback_type;
 
+      protected:
+        /// Replaces the function, parameter and result callback, so a
+        /// finished agent can execute another request.
+        /// \param function key where function bytecode is located.
+        /// \param param parameter to call function with.
+        /// \param result_callback function to call with execution result.
+        void set_request(runtime_locking_shard::key_type function,
+                         parameter_type param,
+                         exec_callback_type result_callback);
+
       private:
         runtime_locking_shard::key_type m_function;
         parameter_type m_param;
@@ -0,0 +1,71 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "read_cache.hpp"
+
+namespace cbdc::parsec::agent {
+    read_cache::read_cache(std::chrono::milliseconds max_age, size_t capacity)
+        : m_max_age(max_age),
+          m_capacity(capacity) {}
+
+    auto read_cache::get(const broker::key_type& key)
+        -> std::optional<broker::value_type> {
+        std::unique_lock l(m_mut);
+        auto it = m_entries.find(key);
+        if(it == m_entries.end()) {
+            return std::nullopt;
+        }
+        if(std::chrono::steady_clock::now() - it->second.m_time > m_max_age) {
+            return std::nullopt;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_pos);
+        return it->second.m_value;
+    }
+
+    void read_cache::put(const broker::key_type& key,
+                         broker::value_type value,
+                         broker::ticket_number_type version) {
+        auto now = std::chrono::steady_clock::now();
+        std::unique_lock l(m_mut);
+        put_locked(key, std::move(value), version, now);
+    }
+
+    void read_cache::update(const broker::state_update_type& updates,
+                            broker::ticket_number_type version) {
+        auto now = std::chrono::steady_clock::now();
+        std::unique_lock l(m_mut);
+        for(const auto& [key, value] : updates) {
+            put_locked(key, value, version, now);
+        }
+    }
+
+    void read_cache::put_locked(const broker::key_type& key,
+                                broker::value_type value,
+                                broker::ticket_number_type version,
+                                std::chrono::steady_clock::time_point now) {
+        if(m_capacity == 0) {
+            return;
+        }
+        auto it = m_entries.find(key);
+        if(it != m_entries.end()) {
+            if(version < it->second.m_version) {
+                return;
+            }
+            m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_pos);
+            it->second.m_value = std::move(value);
+            it->second.m_version = version;
+            it->second.m_time = now;
+            return;
+        }
+        if(m_entries.size() >= m_capacity) {
+            m_entries.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+        m_lru.push_front(key);
+        m_entries.emplace(
+            key,
+            entry_type{std::move(value), version, now, m_lru.begin()});
+    }
+}
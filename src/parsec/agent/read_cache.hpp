@@ -0,0 +1,83 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_READ_CACHE_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_READ_CACHE_H_
+
+#include "parsec/broker/interface.hpp"
+#include "util/common/hashmap.hpp"
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace cbdc::parsec::agent {
+    /// Cache of committed values, fed by the state updates agents commit
+    /// and the values read-only agents read. Read-only runs are served
+    /// from it without locking keys on the shards. Entries are only served
+    /// up to a maximum age, as commits by other agent processes are not
+    /// seen until an entry expires. Each entry is stamped with the ticket
+    /// which wrote or read it, and is never replaced by a value from an
+    /// earlier ticket.
+    class read_cache {
+      public:
+        /// Default maximum number of cached keys.
+        static constexpr size_t default_capacity = 65536;
+
+        /// Constructor.
+        /// \param max_age maximum age of the values served.
+        /// \param capacity maximum number of cached keys.
+        explicit read_cache(std::chrono::milliseconds max_age,
+                            size_t capacity = default_capacity);
+
+        /// Returns the cached value of the given key.
+        /// \param key key to look up.
+        /// \return value, or std::nullopt if the key is not cached or its
+        ///         value is older than the maximum age.
+        auto get(const broker::key_type& key)
+            -> std::optional<broker::value_type>;
+
+        /// Caches the value of a key.
+        /// \param key key to cache.
+        /// \param value committed value of the key.
+        /// \param version ticket number which read or wrote the value.
+        void put(const broker::key_type& key,
+                 broker::value_type value,
+                 broker::ticket_number_type version);
+
+        /// Caches the values of committed state updates.
+        /// \param updates updates committed by the ticket.
+        /// \param version ticket number which committed the updates.
+        void update(const broker::state_update_type& updates,
+                    broker::ticket_number_type version);
+
+      private:
+        struct entry_type {
+            broker::value_type m_value;
+            broker::ticket_number_type m_version{};
+            std::chrono::steady_clock::time_point m_time;
+            std::list<broker::key_type>::iterator m_lru_pos;
+        };
+
+        std::mutex m_mut;
+        std::chrono::milliseconds m_max_age;
+        size_t m_capacity;
+        std::unordered_map<broker::key_type,
+                           entry_type,
+                           hashing::const_sip_hash<broker::key_type>>
+            m_entries;
+        /// Cached keys, most recently used first.
+        std::list<broker::key_type> m_lru;
+
+        void put_locked(const broker::key_type& key,
+                        broker::value_type value,
+                        broker::ticket_number_type version,
+                        std::chrono::steady_clock::time_point now);
+    };
+}
+
+#endif
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "code_cache.hpp"
+
+#include "crypto/sha256.h"
+#include "format.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+namespace cbdc::parsec::agent::runner {
+    auto make_evm_code(evm_account_code code) -> evm_code_ptr {
+        auto ret = std::make_shared<evm_code>();
+        ret->m_code = std::move(code);
+        auto sha = CSHA256();
+        sha.Write(ret->m_code.data(), ret->m_code.size());
+        sha.Finalize(&ret->m_hash.bytes[0]);
+        return ret;
+    }
+
+    evm_code_cache::evm_code_cache(size_t capacity) : m_capacity(capacity) {}
+
+    auto evm_code_cache::get(const evmc::address& addr, const buffer& value)
+        -> evm_code_ptr {
+        {
+            std::unique_lock l(m_mut);
+            auto it = m_entries.find(addr);
+            if(it != m_entries.end() && it->second.m_value == value) {
+                m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_pos);
+                return it->second.m_code;
+            }
+        }
+
+        auto maybe_code = from_buffer<evm_account_code>(value);
+        if(!maybe_code.has_value()) {
+            return nullptr;
+        }
+        auto code = make_evm_code(std::move(maybe_code.value()));
+
+        std::unique_lock l(m_mut);
+        auto it = m_entries.find(addr);
+        if(it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_pos);
+            it->second.m_value = value;
+            it->second.m_code = code;
+            return code;
+        }
+        if(m_entries.size() >= m_capacity) {
+            if(m_capacity == 0) {
+                return code;
+            }
+            m_entries.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+        m_lru.push_front(addr);
+        m_entries.emplace(addr, entry_type{value, code, m_lru.begin()});
+        return code;
+    }
+
+    auto evm_code_cache::global() -> evm_code_cache& {
+        static auto cache = evm_code_cache();
+        return cache;
+    }
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNERS_EVM_CODE_CACHE_H_
+#define OPENCBDC_TX_SRC_PARSEC_AGENT_RUNNERS_EVM_CODE_CACHE_H_
+
+#include "messages.hpp"
+#include "util/common/buffer.hpp"
+
+#include <evmc/evmc.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace cbdc::parsec::agent::runner {
+    /// Immutable contract code shared between hosts.
+    struct evm_code {
+        /// Contract bytecode.
+        evm_account_code m_code;
+        /// SHA256 hash of the bytecode.
+        evmc::bytes32 m_hash{};
+    };
+
+    /// Shared pointer to contract code.
+    using evm_code_ptr = std::shared_ptr<const evm_code>;
+
+    /// Hashes the given bytecode and wraps it for sharing.
+    /// \param code contract bytecode.
+    /// \return shared contract code.
+    auto make_evm_code(evm_account_code code) -> evm_code_ptr;
+
+    /// Process-wide cache of deployed contract code, keyed by account
+    /// address. Hosts still read-lock the code key of every contract they
+    /// call, so execution remains serializable. Each entry is checked
+    /// against the value returned with the lock, so a contract redeployed
+    /// to the same address is decoded again rather than served stale.
+    /// Hits skip decoding and hashing the code, and share one copy of it
+    /// between all concurrent calls.
+    class evm_code_cache {
+      public:
+        /// Default maximum number of cached contracts.
+        static constexpr size_t default_capacity = 1024;
+
+        /// Constructor.
+        /// \param capacity maximum number of cached contracts.
+        explicit evm_code_cache(size_t capacity = default_capacity);
+
+        /// Returns the code stored in the given code key value.
+        /// \param addr contract address.
+        /// \param value serialized code read from the contract's code key.
+        /// \return contract code, or nullptr if the value is malformed.
+        auto get(const evmc::address& addr, const buffer& value)
+            -> evm_code_ptr;
+
+        /// Returns the cache shared by all hosts in the process.
+        /// \return global code cache.
+        static auto global() -> evm_code_cache&;
+
+      private:
+        struct entry_type {
+            buffer m_value;
+            evm_code_ptr m_code;
+            std::list<evmc::address>::iterator m_lru_pos;
+        };
+
+        std::mutex m_mut;
+        size_t m_capacity;
+        std::unordered_map<evmc::address, entry_type> m_entries;
+        /// Cached addresses, most recently used first.
+        std::list<evmc::address> m_lru;
+    };
+}
+
+#endif
@@ -165,4 +165,17 @@ namespace cbdc {
         -> serializer& {
         return ser << idx.m_ticket_number << idx.m_txid << idx.m_logs;
     }
+
+    auto operator>>(serializer& deser,
+                    parsec::agent::runner::evm_block_summary& s)
+        -> serializer& {
+        return deser >> s.m_ticket_number >> s.m_txids >> s.m_receipt_hashes
+            >> s.m_gas_used >> s.m_timestamp >> s.m_logs_bloom;
+    }
+    auto operator<<(serializer& ser,
+                    const parsec::agent::runner::evm_block_summary& s)
+        -> serializer& {
+        return ser << s.m_ticket_number << s.m_txids << s.m_receipt_hashes
+                   << s.m_gas_used << s.m_timestamp << s.m_logs_bloom;
+    }
 }
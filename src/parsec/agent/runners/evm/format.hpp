@@ -85,6 +85,13 @@ namespace cbdc {
     auto operator<<(serializer& ser,
                     const parsec::agent::runner::evm_log_index& idx)
         -> serializer&;
+
+    auto operator>>(serializer& deser,
+                    parsec::agent::runner::evm_block_summary& s)
+        -> serializer&;
+    auto operator<<(serializer& ser,
+                    const parsec::agent::runner::evm_block_summary& s)
+        -> serializer&;
 }
 
 #endif
@@ -7,15 +7,12 @@
 
 #include <cstring>
 #include <ethash/keccak.hpp>
-#include <iomanip>
-#include <vector>
 
 namespace cbdc {
     auto keccak_data(const void* data, size_t len) -> hash_t {
         hash_t ret{};
-        auto data_vec = std::vector<unsigned char>(len);
-        std::memcpy(data_vec.data(), data, len);
-        auto resp = ethash::keccak256(data_vec.data(), data_vec.size());
+        // Hash the caller's bytes in place rather than copying them
+        auto resp = ethash::keccak256(static_cast<const uint8_t*>(data), len);
         std::memcpy(ret.data(), &resp, sizeof(resp));
         return ret;
     }
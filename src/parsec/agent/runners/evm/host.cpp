@@ -68,7 +68,13 @@ namespace cbdc::parsec::agent::runner {
         }
 
         m_accessed_addresses.insert(addr);
-        auto& v = maybe_v.value();
+        return cache_account(addr, maybe_v.value(), write);
+    }
+
+    auto evm_host::cache_account(const evmc::address& addr,
+                                 const broker::value_type& v,
+                                 bool write) const
+        -> std::optional<evm_account> {
         if(v.size() == 0) {
             m_accounts[addr] = {std::nullopt, write};
             return std::nullopt;
@@ -166,8 +172,8 @@ namespace cbdc::parsec::agent::runner {
             // non-zero for the call to work
             return 1;
         }
-        auto maybe_code = get_account_code(addr, false);
-        return maybe_code.value_or(evm_account_code{}).size();
+        auto code = get_account_code(addr, false);
+        return code ? code->m_code.size() : 0;
     }
 
     auto evm_host::get_code_hash(const evmc::address& addr) const noexcept
@@ -175,16 +181,11 @@ namespace cbdc::parsec::agent::runner {
         const auto* log_str = "evm_get_code_hash";
         m_log->trace(log_str, to_hex(addr));
 
-        auto maybe_code = get_account_code(addr, false);
-        if(!maybe_code.has_value()) {
+        auto code = get_account_code(addr, false);
+        if(!code) {
             return {};
         }
-        auto& code = maybe_code.value();
-        auto sha = CSHA256();
-        sha.Write(code.data(), code.size());
-        auto ret = evmc::bytes32();
-        sha.Finalize(&ret.bytes[0]);
-        return ret;
+        return code->m_hash;
     }
 
     auto evm_host::copy_code(const evmc::address& addr,
@@ -195,11 +196,11 @@ namespace cbdc::parsec::agent::runner {
         m_log->trace(log_str, to_hex(addr), code_offset);
 
         auto maybe_code = get_account_code(addr, false);
-        if(!maybe_code.has_value()) {
+        if(!maybe_code) {
             return 0;
         }
 
-        const auto& code = maybe_code.value();
+        const auto& code = maybe_code->m_code;
 
         if(code_offset >= code.size()) {
             return 0;
@@ -271,14 +272,13 @@ namespace cbdc::parsec::agent::runner {
             auto& acc = maybe_acc.value();
             m_accounts[new_addr] = {acc, !m_is_readonly_run};
 
-            auto maybe_code = get_account_code(new_addr, !m_is_readonly_run);
-            if(!maybe_code.has_value()) {
-                maybe_code = evm_account_code();
-            }
-            auto& code = maybe_code.value();
-            code.resize(res.output_size);
-            std::memcpy(code.data(), res.output_data, res.output_size);
-            m_account_code[new_addr] = {code, !m_is_readonly_run};
+            // Lock the code key before replacing its value
+            [[maybe_unused]] auto old_code
+                = get_account_code(new_addr, !m_is_readonly_run);
+            auto code = evm_account_code(res.output_data,
+                                         res.output_data + res.output_size);
+            m_account_code[new_addr]
+                = {make_evm_code(std::move(code)), !m_is_readonly_run};
         }
 
         if(msg.depth == 0) {
@@ -329,10 +329,11 @@ namespace cbdc::parsec::agent::runner {
             return evmc::result(res);
         }
 
-        auto code_buf = std::vector<uint8_t>(code_size);
-        [[maybe_unused]] auto n
-            = copy_code(code_addr, 0, code_buf.data(), code_buf.size());
-        assert(n == code_size);
+        auto code = get_account_code(code_addr, false);
+        if(!code) {
+            // Precompiles have no code, run them as code_size zero bytes
+            code = make_evm_code(evm_account_code(code_size));
+        }
 
         auto inp = cbdc::buffer();
         inp.append(msg.input_data, msg.input_size);
@@ -343,7 +344,7 @@ namespace cbdc::parsec::agent::runner {
                      msg.depth,
                      inp.to_hex());
 
-        auto res = execute(msg, code_buf.data(), code_buf.size());
+        auto res = execute(msg, code->m_code.data(), code->m_code.size());
 
         if(msg.depth == 0) {
             // TODO: refactor branch into call epilog method
@@ -443,15 +444,73 @@ namespace cbdc::parsec::agent::runner {
         return make_buffer(log_index_hash);
     }
 
+    auto evm_host::log_bloom_key(
+        std::optional<interface::ticket_number_type> tn) const
+        -> cbdc::buffer {
+        if(!tn) {
+            tn = m_ticket_number;
+        }
+        // Distinguishes the key from the ticket number key
+        static constexpr unsigned char bloom_key_suffix = 'b';
+        auto tn_buf = cbdc::make_buffer(tn.value());
+        CSHA256 sha;
+        hash_t bloom_hash;
+        sha.Write(tn_buf.c_ptr(), tn_buf.size());
+        sha.Write(&bloom_key_suffix, sizeof(bloom_key_suffix));
+        sha.Finalize(bloom_hash.data());
+
+        return make_buffer(bloom_hash);
+    }
+
+    auto evm_host::block_summary_key(
+        std::optional<interface::ticket_number_type> tn) const
+        -> cbdc::buffer {
+        if(!tn) {
+            tn = m_ticket_number;
+        }
+        // Distinguishes the key from the ticket number and bloom keys
+        static constexpr unsigned char summary_key_suffix = 's';
+        auto tn_buf = cbdc::make_buffer(tn.value());
+        CSHA256 sha;
+        hash_t summary_hash;
+        sha.Write(tn_buf.c_ptr(), tn_buf.size());
+        sha.Write(&summary_key_suffix, sizeof(summary_key_suffix));
+        sha.Finalize(summary_hash.data());
+
+        return make_buffer(summary_hash);
+    }
+
+    auto evm_host::get_block_summary() const -> evm_block_summary {
+        auto blk = evm_pretend_block();
+        blk.m_ticket_number = m_ticket_number;
+        blk.m_transactions.push_back(m_receipt);
+        return make_block_summary(blk);
+    }
+
     auto evm_host::get_log_index_keys() const -> std::vector<cbdc::buffer> {
         auto logs = get_sorted_logs();
         auto keys = std::vector<cbdc::buffer>();
         for(auto& log : logs) {
             keys.push_back(log_index_key(log.first));
         }
+        if(!keys.empty()) {
+            keys.push_back(log_bloom_key());
+        }
         return keys;
     }
 
+    auto evm_host::get_logs_bloom() const -> cbdc::buffer {
+        auto bloom = cbdc::buffer();
+        bloom.extend(evm_bloom_size);
+        for(const auto& log : m_receipt.m_logs) {
+            add_to_bloom(bloom, cbdc::make_buffer(log.m_addr));
+            for(const auto& topic : log.m_topics) {
+                add_to_bloom(bloom, cbdc::make_buffer(topic));
+            }
+        }
+        return bloom;
+    }
+
     auto evm_host::get_sorted_logs() const
         -> std::unordered_map<evmc::address, std::vector<evm_log>> {
         auto ret = std::unordered_map<evmc::address, std::vector<evm_log>>();
@@ -482,11 +541,11 @@ namespace cbdc::parsec::agent::runner {
 
         for(auto& [addr, acc_code] : m_account_code) {
             auto& [code, write] = acc_code;
-            if(!code.has_value() || !write) {
+            if(!code || !write) {
                 continue;
             }
             auto key = make_buffer(code_key{addr});
-            auto val = make_buffer(*code);
+            auto val = make_buffer(code->m_code);
             ret[key] = val;
         }
 
@@ -508,6 +567,7 @@ namespace cbdc::parsec::agent::runner {
         auto r = make_buffer(m_receipt);
         ret[tid] = r;
         ret[ticket_number_key()] = tid;
+        ret[block_summary_key()] = make_buffer(get_block_summary());
 
         auto ordered_logs = get_sorted_logs();
         for(auto& addr_log : ordered_logs) {
@@ -517,6 +577,9 @@ namespace cbdc::parsec::agent::runner {
             log_idx.m_logs = addr_log.second;
             ret[log_index_key(addr_log.first)] = make_buffer(log_idx);
         }
+        if(!ordered_logs.empty()) {
+            ret[log_bloom_key()] = get_logs_bloom();
+        }
         return ret;
     }
 
@@ -531,6 +594,84 @@ namespace cbdc::parsec::agent::runner {
         m_init_state = m_accounts;
     }
 
+    auto evm_host::prefetch_locks(const evmc::address& from)
+        -> std::vector<broker::lock_request_type> {
+        m_prefetched.clear();
+        auto accounts = std::set<evmc::address>{from};
+        auto add_account = [&](const evmc::address& addr, bool write) {
+            if(is_precompile(addr) || !accounts.insert(addr).second) {
+                return;
+            }
+            m_prefetched.push_back({prefetch_kind::account, addr, {}, write});
+            m_prefetched.push_back({prefetch_kind::code, addr, {}, false});
+        };
+        if(m_tx.m_to.has_value()) {
+            add_account(m_tx.m_to.value(),
+                        m_tx.m_value != evmc::uint256be());
+        }
+        auto storage_keys = std::set<std::pair<evmc::address, evmc::bytes32>>();
+        for(const auto& tuple : m_tx.m_access_list) {
+            add_account(tuple.m_address, false);
+            if(is_precompile(tuple.m_address)) {
+                continue;
+            }
+            for(const auto& key : tuple.m_storage_keys) {
+                if(storage_keys.emplace(tuple.m_address, key).second) {
+                    m_prefetched.push_back(
+                        {prefetch_kind::storage, tuple.m_address, key, false});
+                }
+            }
+        }
+
+        auto locks = std::vector<broker::lock_request_type>();
+        locks.reserve(m_prefetched.size());
+        for(const auto& k : m_prefetched) {
+            auto type = k.m_write ? broker::lock_type::write
+                                  : broker::lock_type::read;
+            switch(k.m_kind) {
+                case prefetch_kind::account:
+                    locks.emplace_back(make_buffer(k.m_addr), type);
+                    break;
+                case prefetch_kind::code:
+                    locks.emplace_back(make_buffer(code_key{k.m_addr}), type);
+                    break;
+                case prefetch_kind::storage:
+                    locks.emplace_back(
+                        make_buffer(storage_key{k.m_addr, k.m_key}),
+                        type);
+                    break;
+            }
+        }
+        return locks;
+    }
+
+    auto
+    evm_host::insert_prefetched(const std::vector<broker::value_type>& values)
+        -> bool {
+        if(values.size() != m_prefetched.size()) {
+            return false;
+        }
+        for(size_t i{0}; i < values.size(); i++) {
+            const auto& k = m_prefetched[i];
+            switch(k.m_kind) {
+                case prefetch_kind::account:
+                    cache_account(k.m_addr, values[i], k.m_write);
+                    break;
+                case prefetch_kind::code:
+                    cache_account_code(k.m_addr, values[i], k.m_write);
+                    break;
+                case prefetch_kind::storage:
+                    cache_account_storage(k.m_addr,
+                                          k.m_key,
+                                          values[i],
+                                          k.m_write);
+                    break;
+            }
+        }
+        m_init_state = m_accounts;
+        return true;
+    }
+
     void evm_host::transfer(const evmc::address& from,
                             const evmc::address& to,
                             const evmc::uint256be& value) {
@@ -622,7 +763,14 @@ namespace cbdc::parsec::agent::runner {
         }
 
         m_accessed_addresses.insert(addr);
-        auto& v = maybe_v.value();
+        return cache_account_storage(addr, key, maybe_v.value(), write);
+    }
+
+    auto evm_host::cache_account_storage(const evmc::address& addr,
+                                         const evmc::bytes32& key,
+                                         const broker::value_type& v,
+                                         bool write) const
+        -> std::optional<evmc::bytes32> {
         if(v.size() == 0) {
             m_account_storage[addr][key] = {std::nullopt, write};
             return std::nullopt;
@@ -636,13 +784,13 @@ namespace cbdc::parsec::agent::runner {
 
     auto evm_host::get_account_code(const evmc::address& addr,
                                     bool write) const
-        -> std::optional<evm_account_code> {
+        -> evm_code_ptr {
         m_log->trace("EVM request account code:", to_hex(addr));
 
         if(is_precompile(addr)) {
             // Precompile contract, return empty account
             m_accessed_addresses.insert(addr);
-            return std::nullopt;
+            return nullptr;
         }
 
         auto it = m_account_code.find(addr);
@@ -653,18 +801,22 @@ namespace cbdc::parsec::agent::runner {
         auto elem_key = make_buffer(code_key{addr});
         auto maybe_v = get_key(elem_key, write);
         if(!maybe_v.has_value()) {
-            return std::nullopt;
+            return nullptr;
         }
 
         m_accessed_addresses.insert(addr);
-        auto& v = maybe_v.value();
+        return cache_account_code(addr, maybe_v.value(), write);
+    }
+
+    auto evm_host::cache_account_code(const evmc::address& addr,
+                                      const broker::value_type& v,
+                                      bool write) const -> evm_code_ptr {
         if(v.size() == 0) {
-            m_account_code[addr] = {std::nullopt, write};
-            return std::nullopt;
+            m_account_code[addr] = {nullptr, write};
+            return nullptr;
         }
-        auto maybe_code = from_buffer<evm_account_code>(v);
-        assert(maybe_code.has_value());
-        auto& code = maybe_code.value();
+        auto code = evm_code_cache::global().get(addr, v);
+        assert(code);
         m_account_code[addr] = {code, write};
         return code;
     }
@@ -730,24 +882,24 @@ namespace cbdc::parsec::agent::runner {
     auto evm_host::execute(const evmc_message& msg,
                            const uint8_t* code,
                            size_t code_size) -> evmc::result {
-        // Make VM instance if we didn't already
-        if(!m_vm) {
-            m_vm = std::make_unique<evmc::VM>(evmc_create_evmone());
-            if(!(*m_vm) || !m_vm->is_abi_compatible()) {
-                m_log->error("Unable to load EVM implementation");
-                auto res = evmc::make_result(evmc_status_code::EVMC_FAILURE,
-                                             msg.gas,
-                                             nullptr,
-                                             0);
-                return evmc::result(res);
-            }
+        // Each worker thread reuses one VM instance across transactions.
+        // Execution is synchronous, so nested calls on the same thread use
+        // it in turn.
+        static thread_local auto vm = evmc::VM(evmc_create_evmone());
+        if(!vm || !vm.is_abi_compatible()) {
+            m_log->error("Unable to load EVM implementation");
+            auto res = evmc::make_result(evmc_status_code::EVMC_FAILURE,
+                                         msg.gas,
+                                         nullptr,
+                                         0);
+            return evmc::result(res);
         }
 
-        auto res = m_vm->execute(*this,
-                                 EVMC_LATEST_STABLE_REVISION,
-                                 msg,
-                                 code,
-                                 code_size);
+        auto res = vm.execute(*this,
+                              EVMC_LATEST_STABLE_REVISION,
+                              msg,
+                              code,
+                              code_size);
 
         return res;
     }
@@ -6,6 +6,7 @@
 #ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_EVM_HOST_H_
 #define OPENCBDC_TX_SRC_PARSEC_AGENT_EVM_HOST_H_
 
+#include "parsec/agent/runners/evm/code_cache.hpp"
 #include "parsec/agent/runners/evm/messages.hpp"
 #include "parsec/agent/runners/interface.hpp"
 #include "util/serialization/util.hpp"
@@ -13,6 +14,7 @@
 #include <evmc/evmc.hpp>
 #include <map>
 #include <set>
+#include <vector>
 
 namespace cbdc::parsec::agent::runner {
     /// Implementation of the evmc::Host interface using PARSEC as the backend
@@ -103,7 +105,8 @@ namespace cbdc::parsec::agent::runner {
         /// Return the keys of the log indexes - these are sha256(addr, ticket)
         /// and will get value 1 - to indicate there are logs for the given
         /// address in the given ticket. The logs for the specific ticket can
-        /// then be fetched and filtered on topic and address.
+        /// then be fetched and filtered on topic and address. If there are
+        /// any logs, the key of the ticket's logs bloom is included too.
         /// \return list of keys to set to 1 for the log index
         auto get_log_index_keys() const -> std::vector<cbdc::buffer>;
 
@@ -124,6 +127,27 @@ namespace cbdc::parsec::agent::runner {
         /// \param acc account metadata.
         void insert_account(const evmc::address& addr, const evm_account& acc);
 
+        /// \brief Returns the keys to lock alongside the sender's account
+        ///        before execution.
+        ///
+        /// These are the recipient's account and code, and every account,
+        /// code and storage key declared in the transaction's access list,
+        /// each once. Storage and code are locked for reading, and accounts
+        /// for writing only if the transaction transfers value to them.
+        /// \param from sender's account, which the caller locks itself.
+        /// \return lock requests, in the order \ref insert_prefetched
+        ///         expects their values.
+        auto prefetch_locks(const evmc::address& from)
+            -> std::vector<broker::lock_request_type>;
+
+        /// Seeds the host's caches with the values of the keys from
+        /// \ref prefetch_locks, so execution does not request their locks
+        /// again.
+        /// \param values values in the order the keys were returned.
+        /// \return false if the number of values does not match the keys.
+        auto insert_prefetched(const std::vector<broker::value_type>& values)
+            -> bool;
+
         /// Finalizes the state updates resulting from the transaction.
         /// \param gas_left remaining unspent gas.
         /// \param gas_used total gas consumed by the transaction.
@@ -146,6 +170,27 @@ namespace cbdc::parsec::agent::runner {
                            std::optional<interface::ticket_number_type> tn
                            = std::nullopt) const -> cbdc::buffer;
 
+        /// Return the key for the bloom of the addresses and topics of all
+        /// logs emitted at a particular ticket, as Ethereum keeps for each
+        /// block. Log queries read the blooms of a range of tickets first,
+        /// and only fetch the log indexes the blooms may match.
+        /// \param tn ticket number, or the host's ticket number if empty.
+        /// \return logs bloom key.
+        auto log_bloom_key(std::optional<interface::ticket_number_type> tn
+                           = std::nullopt) const -> cbdc::buffer;
+
+        /// Return the key for the summary of the pretend block of a
+        /// particular ticket, written when the ticket commits.
+        /// \param tn ticket number, or the host's ticket number if empty.
+        /// \return block summary key.
+        auto block_summary_key(std::optional<interface::ticket_number_type> tn
+                               = std::nullopt) const -> cbdc::buffer;
+
+        /// Return the summary of the pretend block of the host's ticket,
+        /// holding the host's transaction.
+        /// \return block summary.
+        auto get_block_summary() const -> evm_block_summary;
+
       private:
         std::shared_ptr<logging::log> m_log;
         runner::interface::try_lock_callback_type m_try_lock_callback;
@@ -157,11 +202,9 @@ namespace cbdc::parsec::agent::runner {
             std::map<evmc::bytes32,
                      std::pair<std::optional<evmc::bytes32>, bool>>>
             m_account_storage;
-        mutable std::map<evmc::address,
-                         std::pair<std::optional<evm_account_code>, bool>>
+        mutable std::map<evmc::address, std::pair<evm_code_ptr, bool>>
             m_account_code;
         evmc_tx_context m_tx_context;
-        std::unique_ptr<evmc::VM> m_vm;
         evm_tx m_tx;
         bool m_is_readonly_run;
 
@@ -179,6 +222,23 @@ namespace cbdc::parsec::agent::runner {
 
         interface::ticket_number_type m_ticket_number;
 
+        /// Kind of key locked by \ref prefetch_locks.
+        enum class prefetch_kind : uint8_t {
+            account,
+            code,
+            storage
+        };
+
+        /// Key locked by \ref prefetch_locks.
+        struct prefetched_key {
+            prefetch_kind m_kind;
+            evmc::address m_addr;
+            evmc::bytes32 m_key{};
+            bool m_write{false};
+        };
+
+        std::vector<prefetched_key> m_prefetched;
+
         [[nodiscard]] auto get_account(const evmc::address& addr,
                                        bool write) const
             -> std::optional<evm_account>;
@@ -190,11 +250,27 @@ namespace cbdc::parsec::agent::runner {
 
         [[nodiscard]] auto get_account_code(const evmc::address& addr,
                                             bool write) const
-            -> std::optional<evm_account_code>;
+            -> evm_code_ptr;
+
+        auto cache_account(const evmc::address& addr,
+                           const broker::value_type& v,
+                           bool write) const -> std::optional<evm_account>;
+
+        auto cache_account_storage(const evmc::address& addr,
+                                   const evmc::bytes32& key,
+                                   const broker::value_type& v,
+                                   bool write) const
+            -> std::optional<evmc::bytes32>;
+
+        auto cache_account_code(const evmc::address& addr,
+                                const broker::value_type& v,
+                                bool write) const -> evm_code_ptr;
 
         auto get_sorted_logs() const
             -> std::unordered_map<evmc::address, std::vector<evm_log>>;
 
+        auto get_logs_bloom() const -> cbdc::buffer;
+
         void transfer(const evmc::address& from,
                       const evmc::address& to,
                       const evmc::uint256be& value);
@@ -15,7 +15,9 @@
 #include "util/common/hash.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
 #include <future>
+#include <unordered_set>
 
 using namespace cbdc::parsec::agent::runner;
 
@@ -373,40 +375,33 @@ namespace cbdc::parsec::agent::rpc {
             return false;
         }
         auto runner_params = std::move(maybe_runner_params.value());
-        return exec_tx(
-            callback,
-            runner::evm_runner_function::read_account,
-            runner_params,
-            true,
-            [callback, runner_params](interface::exec_return_type res) {
-                auto ret = Json::Value();
-
-                auto& updates = std::get<return_type>(res);
-                auto it = updates.find(runner_params);
-
-                if(it == updates.end() || it->second.size() == 0) {
-                    // For accounts that don't exist yet, return 1
-                    ret["result"] = to_hex_trimmed(evmc::uint256be(1));
-                    callback(ret);
-                    return;
-                }
+        auto respond = [callback](cbdc::buffer value) {
+            auto ret = Json::Value();
+            if(value.size() == 0) {
+                // For accounts that don't exist yet, return 1
+                ret["result"] = to_hex_trimmed(evmc::uint256be(1));
+                callback(ret);
+                return;
+            }
 
-                auto maybe_acc
-                    = cbdc::from_buffer<runner::evm_account>(it->second);
-                if(!maybe_acc.has_value()) {
-                    ret["error"] = Json::Value();
-                    ret["error"]["code"] = error_code::internal_error;
-                    ret["error"]["message"] = "Internal error";
-                    callback(ret);
-                    return;
-                }
+            auto maybe_acc = cbdc::from_buffer<runner::evm_account>(value);
+            if(!maybe_acc.has_value()) {
+                ret["error"] = Json::Value();
+                ret["error"]["code"] = error_code::internal_error;
+                ret["error"]["message"] = "Internal error";
+                callback(ret);
+                return;
+            }
 
-                auto& acc = maybe_acc.value();
+            auto& acc = maybe_acc.value();
 
-                auto tx_count = acc.m_nonce + evmc::uint256be(1);
-                ret["result"] = to_hex_trimmed(tx_count);
-                callback(ret);
-            });
+            auto tx_count = acc.m_nonce + evmc::uint256be(1);
+            ret["result"] = to_hex_trimmed(tx_count);
+            callback(ret);
+        };
+        return read_account(std::move(runner_params),
+                            callback,
+                            std::move(respond));
     }
 
     auto http_server::handle_get_balance(
@@ -425,35 +420,60 @@ namespace cbdc::parsec::agent::rpc {
             return false;
         }
         auto runner_params = std::move(maybe_runner_params.value());
+        auto respond = [callback](cbdc::buffer value) {
+            auto ret = Json::Value();
+            if(value.size() == 0) {
+                // Return 0 for non-existent accounts
+                ret["result"] = "0x0";
+                callback(ret);
+                return;
+            }
+
+            auto maybe_acc = cbdc::from_buffer<runner::evm_account>(value);
+            if(!maybe_acc.has_value()) {
+                ret["error"] = Json::Value();
+                ret["error"]["code"] = error_code::internal_error;
+                ret["error"]["message"] = "Internal error";
+                callback(ret);
+                return;
+            }
+
+            auto& acc = maybe_acc.value();
+            ret["result"] = to_hex_trimmed(acc.m_balance);
+            callback(ret);
+        };
+        return read_account(std::move(runner_params),
+                            callback,
+                            std::move(respond));
+    }
+
+    auto http_server::read_account(
+        cbdc::buffer addr,
+        const server_type::result_callback_type& callback,
+        std::function<void(cbdc::buffer)> respond) -> bool {
+        // Wallets query the nonce and balance before every transaction, so
+        // recently read or written accounts are answered from memory
+        // without running an agent
+        if(m_read_cache) {
+            if(auto cached = m_read_cache->get(addr)) {
+                respond(std::move(cached.value()));
+                return true;
+            }
+        }
         return exec_tx(
             callback,
             runner::evm_runner_function::read_account,
-            runner_params,
+            addr,
             true,
-            [callback, runner_params](interface::exec_return_type res) {
-                auto ret = Json::Value();
+            [addr, respond = std::move(respond)](
+                interface::exec_return_type res) {
                 auto& updates = std::get<return_type>(res);
-                auto it = updates.find(runner_params);
-                if(it == updates.end() || it->second.size() == 0) {
-                    // Return 0 for non-existent accounts
-                    ret["result"] = "0x0";
-                    callback(ret);
+                auto it = updates.find(addr);
+                if(it == updates.end()) {
+                    respond(cbdc::buffer());
                     return;
                 }
-
-                auto maybe_acc
-                    = cbdc::from_buffer<runner::evm_account>(it->second);
-                if(!maybe_acc.has_value()) {
-                    ret["error"] = Json::Value();
-                    ret["error"]["code"] = error_code::internal_error;
-                    ret["error"]["message"] = "Internal error";
-                    callback(ret);
-                    return;
-                }
-
-                auto& acc = maybe_acc.value();
-                ret["result"] = to_hex_trimmed(acc.m_balance);
-                callback(ret);
+                respond(std::move(it->second));
             });
     }
 
@@ -763,21 +783,18 @@ namespace cbdc::parsec::agent::rpc {
         }
 
         auto& logs = maybe_logs.value();
+        auto want_topics = std::unordered_set<evmc::bytes32>(
+            qry.m_topics.begin(),
+            qry.m_topics.end());
         ret["result"] = Json::Value(Json::arrayValue);
         for(auto& log_idx : logs) {
             for(auto& log : log_idx.m_logs) {
-                auto match = false;
-                for(auto& have_topic : log.m_topics) {
-                    for(const auto& want_topic : qry.m_topics) {
-                        if(have_topic == want_topic) {
-                            match = true;
-                            break;
-                        }
-                    }
-                    if(match) {
-                        break;
-                    }
-                }
+                auto match = std::any_of(log.m_topics.begin(),
+                                         log.m_topics.end(),
+                                         [&](const evmc::bytes32& topic) {
+                                             return want_topics.count(topic)
+                                                  > 0;
+                                         });
                 if(match) {
                     ret["result"].append(
                         tx_log_to_json(log,
@@ -949,7 +966,8 @@ namespace cbdc::parsec::agent::rpc {
         Json::Value params,
         const server_type::result_callback_type& callback,
         const std::function<void(interface::exec_return_type, cbdc::buffer)>&
-            res_cb) -> bool {
+            res_cb,
+        runner::evm_runner_function f_type) -> bool {
         if(!params.isArray() || params.empty() || !params[0].isString()
            || (params.size() > 1 && !params[1].isBool())) {
             m_log->warn("Invalid parameters to getBlock", params.size());
@@ -983,7 +1001,7 @@ namespace cbdc::parsec::agent::rpc {
 
         return exec_tx(
             callback,
-            runner::evm_runner_function::get_block,
+            f_type,
             runner_params,
             true,
             [res_cb, runner_params](interface::exec_return_type res) {
@@ -991,16 +1009,88 @@ namespace cbdc::parsec::agent::rpc {
             });
     }
 
+    auto http_server::summary_from_result(
+        interface::exec_return_type& res,
+        const cbdc::buffer& runner_params,
+        const server_type::result_callback_type& callback)
+        -> std::optional<runner::evm_block_summary> {
+        auto& updates = std::get<return_type>(res);
+        auto it = updates.find(runner_params);
+        auto ret = Json::Value();
+        if(it == updates.end() || it->second.size() == 0) {
+            ret["error"] = Json::Value();
+            ret["error"]["code"] = error_code::not_found;
+            ret["error"]["message"] = "Data was not found";
+            callback(ret);
+            return std::nullopt;
+        }
+
+        auto maybe_summary = cbdc::from_buffer<evm_block_summary>(it->second);
+        if(!maybe_summary) {
+            ret["error"] = Json::Value();
+            ret["error"]["code"] = error_code::internal_error;
+            ret["error"]["message"] = "Internal error";
+            callback(ret);
+        }
+        return maybe_summary;
+    }
+
+    auto http_server::block_json(const runner::evm_block_summary& summary)
+        -> Json::Value {
+        auto ret = Json::Value();
+        auto tn256 = evmc::uint256be(summary.m_ticket_number);
+        ret["number"] = to_hex_trimmed(tn256);
+        ret["hash"] = "0x" + to_hex(tn256);
+        ret["parentHash"]
+            = "0x" + to_hex(evmc::uint256be(summary.m_ticket_number - 1));
+        ret["gasLimit"] = "0xffffffff";
+        ret["gasUsed"] = "0x0";
+        ret["baseFeePerGas"] = "0x0";
+        ret["miner"] = "0x0000000000000000000000000000000000000000";
+        ret["transactions"] = Json::Value(Json::arrayValue);
+        ret["nonce"] = "0x0000000000000000";
+        ret["timestamp"] = to_hex_trimmed(evmc::uint256be(summary.m_timestamp));
+        ret["extraData"] = "0x" + to_hex(evmc::uint256be(0));
+        ret["logsBloom"] = summary.m_logs_bloom.to_hex_prefixed();
+        // We don't have any uncles ever
+        ret["uncles"] = Json::Value(Json::arrayValue);
+        return ret;
+    }
+
     auto http_server::handle_get_block(
         Json::Value params,
         const server_type::result_callback_type& callback) -> bool {
         auto include_tx_details = params[1].asBool();
+        if(!include_tx_details) {
+            // The stored summary holds everything but the transactions
+            // themselves, so it is read alone
+            return fetch_block(
+                params,
+                callback,
+                [callback](interface::exec_return_type res,
+                           const cbdc::buffer& runner_params) {
+                    auto maybe_summary
+                        = summary_from_result(res, runner_params, callback);
+                    if(!maybe_summary) {
+                        return;
+                    }
+                    auto& summary = maybe_summary.value();
+                    auto ret = Json::Value();
+                    ret["result"] = block_json(summary);
+                    for(auto& txid : summary.m_txids) {
+                        ret["result"]["transactions"].append(
+                            "0x" + to_string(txid));
+                    }
+                    callback(ret);
+                },
+                runner::evm_runner_function::get_block_summary);
+        }
+
         return fetch_block(
             params,
             callback,
-            [this, callback, include_tx_details](
-                interface::exec_return_type res,
-                const cbdc::buffer& runner_params) {
+            [this, callback](interface::exec_return_type res,
+                             const cbdc::buffer& runner_params) {
                 auto& updates = std::get<return_type>(res);
                 auto it = updates.find(runner_params);
                 auto ret = Json::Value();
@@ -1021,52 +1111,16 @@ namespace cbdc::parsec::agent::rpc {
                     callback(ret);
                     return;
                 }
-                ret["result"] = Json::Value();
-                auto blk = maybe_pretend_block.value();
+                auto& blk = maybe_pretend_block.value();
+                ret["result"] = block_json(runner::make_block_summary(blk));
                 auto tn256 = evmc::uint256be(blk.m_ticket_number);
-                ret["result"]["number"] = to_hex_trimmed(tn256);
-                ret["result"]["hash"] = "0x" + to_hex(tn256);
-                ret["result"]["parentHash"]
-                    = "0x" + to_hex(evmc::uint256be(blk.m_ticket_number - 1));
-                ret["result"]["gasLimit"] = "0xffffffff";
-                ret["result"]["gasUsed"] = "0x0";
-                ret["result"]["baseFeePerGas"] = "0x0";
-                ret["result"]["miner"]
-                    = "0x0000000000000000000000000000000000000000";
-                ret["result"]["transactions"] = Json::Value(Json::arrayValue);
-                ret["result"]["nonce"] = "0x0000000000000000";
-
-                auto bloom = cbdc::buffer();
-                constexpr auto bits_in_32_bytes = 256;
-                bloom.extend(bits_in_32_bytes);
-                uint64_t timestamp = 0;
                 for(auto& tx_rcpt : blk.m_transactions) {
-                    if(tx_rcpt.m_timestamp > timestamp) {
-                        timestamp = tx_rcpt.m_timestamp;
-                    }
-                    for(auto& l : tx_rcpt.m_logs) {
-                        add_to_bloom(bloom, cbdc::make_buffer(l.m_addr));
-                        for(auto& t : l.m_topics) {
-                            add_to_bloom(bloom, cbdc::make_buffer(t));
-                        }
-                    }
-                    if(include_tx_details) {
-                        auto json_tx = tx_to_json(tx_rcpt.m_tx, m_secp);
-                        json_tx["blockHash"] = "0x" + to_hex(tn256);
-                        json_tx["blockNumber"] = to_hex_trimmed(tn256);
-                        json_tx["transactionIndex"] = "0x0";
-                        ret["result"]["transactions"].append(json_tx);
-                    } else {
-                        ret["result"]["transactions"].append(
-                            "0x" + to_string(tx_id(tx_rcpt.m_tx)));
-                    }
+                    auto json_tx = tx_to_json(tx_rcpt.m_tx, m_secp);
+                    json_tx["blockHash"] = "0x" + to_hex(tn256);
+                    json_tx["blockNumber"] = to_hex_trimmed(tn256);
+                    json_tx["transactionIndex"] = "0x0";
+                    ret["result"]["transactions"].append(json_tx);
                 }
-                ret["result"]["timestamp"]
-                    = to_hex_trimmed(evmc::uint256be(timestamp));
-                ret["result"]["extraData"] = "0x" + to_hex(evmc::uint256be(0));
-                ret["result"]["logsBloom"] = bloom.to_hex_prefixed();
-                // We don't have any uncles ever
-                ret["result"]["uncles"] = Json::Value(Json::arrayValue);
                 callback(ret);
             });
     }
@@ -1079,31 +1133,17 @@ namespace cbdc::parsec::agent::rpc {
             callback,
             [callback](interface::exec_return_type res,
                        const cbdc::buffer& runner_params) {
-                auto& updates = std::get<return_type>(res);
-                auto it = updates.find(runner_params);
-                auto ret = Json::Value();
-                if(it == updates.end() || it->second.size() == 0) {
-                    ret["error"] = Json::Value();
-                    ret["error"]["code"] = error_code::not_found;
-                    ret["error"]["message"] = "Data was not found";
-                    callback(ret);
+                auto maybe_summary
+                    = summary_from_result(res, runner_params, callback);
+                if(!maybe_summary) {
                     return;
                 }
-
-                auto maybe_pretend_block
-                    = cbdc::from_buffer<evm_pretend_block>(it->second);
-                if(!maybe_pretend_block) {
-                    ret["error"] = Json::Value();
-                    ret["error"]["code"] = error_code::internal_error;
-                    ret["error"]["message"] = "Internal error";
-                    callback(ret);
-                    return;
-                }
-                auto blk = maybe_pretend_block.value();
+                auto ret = Json::Value();
                 ret["result"] = to_hex_trimmed(
-                    evmc::uint256be(blk.m_transactions.size()));
+                    evmc::uint256be(maybe_summary.value().m_txids.size()));
                 callback(ret);
-            });
+            },
+            runner::evm_runner_function::get_block_summary);
     }
 
     auto
@@ -1401,15 +1441,17 @@ namespace cbdc::parsec::agent::rpc {
                 interface::exec_return_type res) {
                 const auto success = std::holds_alternative<return_type>(res);
                 if(success) {
+                    agent_done(id, true);
                     res_success_cb(res);
-                    m_cleanup_queue.push(id);
+                    release_agent(id);
                 } else {
                     // Handle error:
                     const auto ec = std::get<interface::error_code>(res);
 
                     if(ec == interface::error_code::retry) {
-                        m_retry_queue.push(id);
+                        schedule_retry(id);
                     } else {
+                        agent_done(id, false);
                         auto ret = Json::Value();
                         ret["error"] = Json::Value();
                         ret["error"]["code"] = error_code::execution_error
@@ -1420,25 +1462,36 @@ namespace cbdc::parsec::agent::rpc {
                 }
             };
 
-        auto a = [&]() {
-            auto agent = std::make_shared<impl>(
-                m_log,
-                m_cfg,
-                &runner::factory<runner::evm_runner>::create,
-                m_broker,
-                function,
-                runner_params,
-                res_cb_for_agent,
-                runner::evm_runner::initial_lock_type,
-                is_readonly_run,
-                m_secp,
-                m_threads);
-            {
-                std::unique_lock l(m_agents_mut);
-                m_agents.emplace(id, agent);
+        auto a = make_agent(id,
+                            &runner::factory<runner::evm_runner>::create,
+                            function,
+                            runner_params,
+                            res_cb_for_agent,
+                            runner::evm_runner::initial_lock_type,
+                            is_readonly_run);
+
+        if(f_type != runner::evm_runner_function::execute_transaction
+           || is_readonly_run) {
+            return a->exec();
+        }
+
+        // Hold back transactions predicted to conflict with ones already
+        // running, rather than letting them wound each other in the shards
+        auto keys = std::vector<runtime_locking_shard::key_type>();
+        auto maybe_tx = cbdc::from_buffer<runner::evm_tx>(runner_params);
+        if(maybe_tx.has_value()) {
+            auto maybe_keys
+                = runner::evm_runner::predicted_write_keys(maybe_tx.value(),
+                                                           m_secp);
+            if(maybe_keys.has_value()) {
+                keys = std::move(maybe_keys.value());
             }
-            return agent;
-        }();
-        return a->exec();
+        }
+        m_scheduler.submit(id, std::move(keys), [this, a]() {
+            if(!a->exec()) {
+                m_log->error("Error executing agent");
+            }
+        });
+        return true;
     }
 }
@@ -197,8 +197,22 @@ namespace cbdc::parsec::agent::rpc {
         auto fetch_block(Json::Value params,
                          const server_type::result_callback_type& callback,
                          const std::function<void(interface::exec_return_type,
-                                                  cbdc::buffer)>& res_cb)
-            -> bool;
+                                                  cbdc::buffer)>& res_cb,
+                         runner::evm_runner_function f_type
+                         = runner::evm_runner_function::get_block) -> bool;
+
+        /// Decodes the block summary returned by the runner, replying with
+        /// an error if it is missing or invalid.
+        static auto
+        summary_from_result(interface::exec_return_type& res,
+                            const cbdc::buffer& runner_params,
+                            const server_type::result_callback_type& callback)
+            -> std::optional<runner::evm_block_summary>;
+
+        /// Returns the block fields of a getBlock response, without the
+        /// transactions, from the block's summary.
+        static auto block_json(const runner::evm_block_summary& summary)
+            -> Json::Value;
 
         auto
         exec_tx(const server_type::result_callback_type& json_ret_callback,
@@ -208,6 +222,15 @@ namespace cbdc::parsec::agent::rpc {
                 const std::function<void(interface::exec_return_type)>&
                     res_success_cb) -> bool;
 
+        /// Reads an account and passes its serialized value to respond,
+        /// or an empty buffer if the account does not exist. Served from
+        /// the read cache when it holds the account, otherwise by a
+        /// read-only agent run.
+        auto read_account(cbdc::buffer addr,
+                          const server_type::result_callback_type& callback,
+                          std::function<void(cbdc::buffer)> respond)
+            -> bool;
+
         auto
         handle_unsupported(const std::string& method,
                            const Json::Value& params,
@@ -14,7 +14,9 @@
 #include "util.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
 #include <future>
+#include <unordered_set>
 
 namespace cbdc::parsec::agent::runner {
     evm_runner::evm_runner(std::shared_ptr<logging::log> logger,
@@ -24,6 +26,7 @@ namespace cbdc::parsec::agent::runner {
                            bool is_readonly_run,
                            run_callback_type result_callback,
                            try_lock_callback_type try_lock_callback,
+                           try_lock_batch_callback_type try_lock_batch_callback,
                            std::shared_ptr<secp256k1_context> secp,
                            std::shared_ptr<thread_pool> t_pool,
                            ticket_number_type ticket_number)
@@ -34,6 +37,7 @@ namespace cbdc::parsec::agent::runner {
                     is_readonly_run,
                     std::move(result_callback),
                     std::move(try_lock_callback),
+                    std::move(try_lock_batch_callback),
                     std::move(secp),
                     std::move(t_pool),
                     ticket_number) {}
@@ -57,8 +61,7 @@ namespace cbdc::parsec::agent::runner {
         static constexpr uint8_t invalid_function = 255;
         uint8_t f = invalid_function;
         std::memcpy(&f, m_function.data(), sizeof(uint8_t));
-        if(f
-           > static_cast<uint8_t>(evm_runner_function::read_account_storage)) {
+        if(f > static_cast<uint8_t>(evm_runner_function::get_block_summary)) {
             m_log->error("Unknown EVM runner function ", f);
             m_result_callback(error_code::function_load);
             return;
@@ -97,6 +100,9 @@ namespace cbdc::parsec::agent::runner {
                 success = run_get_account(); // m_param contains the right key
                                              // already
                 break;
+            case evm_runner_function::get_block_summary:
+                success = run_get_block_summary();
+                break;
             default:
                 m_result_callback(error_code::function_load);
                 break;
@@ -161,20 +167,14 @@ namespace cbdc::parsec::agent::runner {
             broker::lock_type::read,
             [this, tn](const broker::interface::try_lock_return_type& res) {
                 if(!std::holds_alternative<broker::value_type>(res)) {
-                    auto ret = runtime_locking_shard::state_update_type();
-                    auto blk = make_pretend_block(tn);
-                    ret[m_param] = make_buffer(blk);
-                    m_result_callback(ret);
+                    return_block(make_pretend_block(tn));
                     return;
                 }
 
                 auto v = std::get<broker::value_type>(res);
                 auto maybe_txid = from_buffer<cbdc::hash_t>(v);
                 if(!maybe_txid) {
-                    auto ret = runtime_locking_shard::state_update_type();
-                    auto blk = make_pretend_block(tn);
-                    ret[m_param] = make_buffer(blk);
-                    m_result_callback(ret);
+                    return_block(make_pretend_block(tn));
                     return;
                 }
 
@@ -184,6 +184,45 @@ namespace cbdc::parsec::agent::runner {
         return success;
     }
 
+    auto evm_runner::run_get_block_summary() -> bool {
+        auto maybe_tn = cbdc::from_buffer<evmc::uint256be>(m_param);
+        if(!maybe_tn) {
+            return false;
+        }
+        auto tn = to_uint64(maybe_tn.value());
+        return m_try_lock_callback(
+            m_host->block_summary_key(tn),
+            broker::lock_type::read,
+            [this](const broker::interface::try_lock_return_type& res) {
+                if(std::holds_alternative<broker::value_type>(res)) {
+                    auto v = std::get<broker::value_type>(res);
+                    if(from_buffer<evm_block_summary>(v).has_value()) {
+                        auto ret = runtime_locking_shard::state_update_type();
+                        ret[m_param] = std::move(v);
+                        m_result_callback(ret);
+                        return;
+                    }
+                }
+
+                // Tickets committed before summaries were stored only have
+                // their receipts, so summarize the block from those
+                m_summarize_block = true;
+                if(!run_get_block()) {
+                    m_result_callback(error_code::internal_error);
+                }
+            });
+    }
+
+    void evm_runner::return_block(const evm_pretend_block& blk) {
+        auto ret = runtime_locking_shard::state_update_type();
+        if(m_summarize_block) {
+            ret[m_param] = make_buffer(make_block_summary(blk));
+        } else {
+            ret[m_param] = make_buffer(blk);
+        }
+        m_result_callback(ret);
+    }
+
     void evm_runner::lock_tx_receipt(const broker::value_type& value,
                                      const ticket_number_type& ticket_number) {
         auto cb = [this, ticket_number](
@@ -203,12 +242,9 @@ namespace cbdc::parsec::agent::runner {
                 return;
             }
 
-            auto ret = runtime_locking_shard::state_update_type();
             auto blk = make_pretend_block(ticket_number);
             blk.m_transactions.push_back(maybe_tx_receipt.value());
-            ret[m_param] = make_buffer(blk);
-            m_result_callback(ret);
-            return;
+            return_block(blk);
         };
 
         if(!m_try_lock_callback(value, broker::lock_type::read, cb)) {
@@ -226,110 +262,147 @@ namespace cbdc::parsec::agent::runner {
         }
         auto qry = maybe_qry.value();
 
-        // First, determine the keys to query for log existence
-        auto keys = std::vector<cbdc::buffer>();
+        // First, read the logs bloom of each block in the range. Only the
+        // log indexes of blocks whose bloom may match the query are read
+        // after that.
+        auto locks = std::vector<broker::lock_request_type>();
         for(auto blk = qry.m_from_block; blk <= qry.m_to_block; blk++) {
-            for(auto& it : qry.m_addresses) {
-                keys.push_back(m_host->log_index_key(it, blk));
-            }
+            locks.emplace_back(m_host->log_bloom_key(blk),
+                               broker::lock_type::read);
+        }
+        if(locks.empty()) {
+            handle_complete_get_logs(qry, {});
+            return true;
         }
 
         m_log->info(m_ticket_number,
                     "getting",
-                    keys.size(),
-                    "keys from shards");
-
-        auto log_indexes_mut = std::make_shared<std::mutex>();
-        auto log_indexes = std::make_shared<std::vector<evm_log_index>>();
-        auto acquired = std::make_shared<std::atomic<size_t>>();
-        for(auto& key : keys) {
-            auto success = m_try_lock_callback(
-                key,
-                broker::lock_type::read,
-                [this,
-                 acquired,
-                 log_indexes,
-                 log_indexes_mut,
-                 key_count = keys.size(),
-                 qry](const broker::interface::try_lock_return_type& res) {
-                    handle_get_logs_try_lock_response(qry,
-                                                      log_indexes,
-                                                      acquired,
-                                                      log_indexes_mut,
-                                                      key_count,
-                                                      res);
-                });
-            if(!success) {
-                m_log->error("Unable to lock logs index key");
-                m_result_callback(error_code::internal_error);
-                return false;
-            }
+                    locks.size(),
+                    "log blooms from shards");
+
+        auto success = m_try_lock_batch_callback(
+            std::move(locks),
+            [this, qry](const broker::interface::try_lock_batch_return_type&
+                            res) {
+                handle_get_logs_blooms(qry, res);
+            });
+        if(!success) {
+            m_log->error("Unable to lock log bloom keys");
+            m_result_callback(error_code::internal_error);
         }
-
-        return true;
+        return success;
     }
 
-    void evm_runner::handle_get_logs_try_lock_response(
+    void evm_runner::handle_get_logs_blooms(
         const evm_log_query& qry,
-        const std::shared_ptr<std::vector<evm_log_index>>& log_indexes,
-        const std::shared_ptr<std::atomic<size_t>>& acquired,
-        const std::shared_ptr<std::mutex>& log_indexes_mut,
-        size_t key_count,
-        const broker::interface::try_lock_return_type& res) {
-        if(!std::holds_alternative<broker::value_type>(res)) {
-            m_log->error("Unable to read log key");
+        const broker::interface::try_lock_batch_return_type& res) {
+        if(!std::holds_alternative<std::vector<broker::value_type>>(res)) {
+            m_log->error("Unable to read log bloom keys");
             m_result_callback(error_code::function_load);
             return;
         }
+        const auto& blooms = std::get<std::vector<broker::value_type>>(res);
 
-        m_log->info(m_ticket_number, "got value from shard");
+        auto addresses = std::vector<cbdc::buffer>();
+        for(const auto& addr : qry.m_addresses) {
+            addresses.emplace_back(make_buffer(addr));
+        }
+        auto topics = std::vector<cbdc::buffer>();
+        for(const auto& topic : qry.m_topics) {
+            topics.emplace_back(make_buffer(topic));
+        }
 
-        auto v = std::get<broker::value_type>(res);
-        auto maybe_logs = cbdc::from_buffer<evm_log_index>(v);
-        if(maybe_logs) {
-            // Found potentially relevant logs, add
-            std::unique_lock<std::mutex> lck(*log_indexes_mut);
-            log_indexes->push_back(maybe_logs.value());
+        auto locks = std::vector<broker::lock_request_type>();
+        for(size_t i{0}; i < blooms.size(); i++) {
+            const auto& bloom = blooms[i];
+            auto may_match_topic
+                = std::any_of(topics.begin(),
+                              topics.end(),
+                              [&](const cbdc::buffer& topic) {
+                                  return bloom_contains(bloom, topic);
+                              });
+            if(!may_match_topic) {
+                continue;
+            }
+            auto blk = qry.m_from_block + i;
+            for(size_t j{0}; j < addresses.size(); j++) {
+                if(bloom_contains(bloom, addresses[j])) {
+                    locks.emplace_back(
+                        m_host->log_index_key(qry.m_addresses[j], blk),
+                        broker::lock_type::read);
+                }
+            }
+        }
+        if(locks.empty()) {
+            handle_complete_get_logs(qry, {});
+            return;
         }
-        if(++(*acquired) == key_count) {
-            handle_complete_get_logs(qry, log_indexes_mut, log_indexes);
+
+        m_log->info(m_ticket_number,
+                    "getting",
+                    locks.size(),
+                    "log indexes from shards");
+
+        auto success = m_try_lock_batch_callback(
+            std::move(locks),
+            [this, qry](const broker::interface::try_lock_batch_return_type&
+                            idx_res) {
+                handle_get_logs_indexes(qry, idx_res);
+            });
+        if(!success) {
+            m_log->error("Unable to lock logs index keys");
+            m_result_callback(error_code::internal_error);
         }
     }
 
+    void evm_runner::handle_get_logs_indexes(
+        const evm_log_query& qry,
+        const broker::interface::try_lock_batch_return_type& res) {
+        if(!std::holds_alternative<std::vector<broker::value_type>>(res)) {
+            m_log->error("Unable to read log index keys");
+            m_result_callback(error_code::function_load);
+            return;
+        }
+        auto log_indexes = std::vector<evm_log_index>();
+        for(const auto& v : std::get<std::vector<broker::value_type>>(res)) {
+            // Blooms can match falsely, so some indexes may not exist
+            auto maybe_logs = cbdc::from_buffer<evm_log_index>(v);
+            if(maybe_logs) {
+                log_indexes.emplace_back(std::move(maybe_logs.value()));
+            }
+        }
+        handle_complete_get_logs(qry, log_indexes);
+    }
+
     void evm_runner::handle_complete_get_logs(
         const evm_log_query& qry,
-        const std::shared_ptr<std::mutex>& log_indexes_mut,
-        const std::shared_ptr<std::vector<evm_log_index>>& log_indexes) {
+        const std::vector<evm_log_index>& log_indexes) {
         m_log->info(m_ticket_number,
                     "completed all queries, filtering",
-                    log_indexes->size(),
+                    log_indexes.size(),
                     "logs");
 
-        // Scanned them all - finish
-        std::unique_lock<std::mutex> lck(*log_indexes_mut);
-
         // Filter the final logs by topics
+        auto want_topics = std::unordered_set<evmc::bytes32>(
+            qry.m_topics.begin(),
+            qry.m_topics.end());
         auto final_logs = std::vector<evm_log_index>();
-        for(auto& log_idx : *log_indexes) {
-            auto match = false;
-            for(auto& log : log_idx.m_logs) {
-                for(auto& have_topic : log.m_topics) {
-                    for(const auto& want_topic : qry.m_topics) {
-                        if(have_topic == want_topic) {
-                            match = true;
-                            break;
-                        }
-                    }
-                    if(match) {
-                        break;
-                    }
-                }
-            }
+        for(const auto& log_idx : log_indexes) {
+            auto match = std::any_of(
+                log_idx.m_logs.begin(),
+                log_idx.m_logs.end(),
+                [&](const evm_log& log) {
+                    return std::any_of(log.m_topics.begin(),
+                                       log.m_topics.end(),
+                                       [&](const evmc::bytes32& topic) {
+                                           return want_topics.count(topic)
+                                                > 0;
+                                       });
+                });
             if(match) {
                 final_logs.push_back(log_idx);
             }
         }
-        lck.unlock();
 
         m_log->info(m_ticket_number,
                     "returning",
@@ -539,21 +612,9 @@ namespace cbdc::parsec::agent::runner {
         m_msg = msg;
 
         if(!is_readonly_run) {
-            m_log->trace(m_ticket_number,
-                         "reading from account [",
-                         to_hex(from),
-                         "]");
-            auto addr_key = cbdc::make_buffer(from);
-            auto r = m_try_lock_callback(
-                addr_key,
-                broker::lock_type::write,
-                [this](const broker::interface::try_lock_return_type& res) {
-                    m_log->trace(m_ticket_number, "read from account");
-                    handle_lock_from_account(res);
-                });
-            if(!r) {
+            if(!lock_initial_keys(from)) {
                 m_log->error(
-                    "Failed to send try_lock request for from account");
+                    "Failed to send try_lock request for initial keys");
                 m_result_callback(error_code::internal_error);
                 return false;
             }
@@ -601,33 +662,105 @@ namespace cbdc::parsec::agent::runner {
             callback();
             return;
         }
-        auto acquired = std::make_shared<std::atomic<size_t>>();
+        auto locks = std::vector<broker::lock_request_type>();
+        locks.reserve(keys.size());
         for(auto& key : keys) {
-            auto success = m_try_lock_callback(
-                key,
-                broker::lock_type::write,
-                [acquired, callback, key_count = keys.size()](
-                    const broker::interface::try_lock_return_type&) {
-                    if(++(*acquired) == key_count) {
-                        callback();
-                    }
-                });
-            if(!success) {
-                m_log->error("Unable to lock logs index key");
-                m_result_callback(error_code::internal_error);
-                return;
+            locks.emplace_back(std::move(key), broker::lock_type::write);
+        }
+        auto success = m_try_lock_batch_callback(
+            std::move(locks),
+            [callback](const broker::interface::try_lock_batch_return_type&) {
+                callback();
+            });
+        if(!success) {
+            m_log->error("Unable to lock logs index keys");
+            m_result_callback(error_code::internal_error);
+        }
+    }
+
+    auto evm_runner::predicted_write_keys(
+        const evm_tx& tx,
+        const std::shared_ptr<secp256k1_context>& secp)
+        -> std::optional<std::vector<runtime_locking_shard::key_type>> {
+        auto maybe_from = check_signature(tx, secp);
+        if(!maybe_from.has_value()) {
+            return std::nullopt;
+        }
+        auto keys = std::vector<runtime_locking_shard::key_type>();
+        keys.emplace_back(make_buffer(maybe_from.value()));
+        if(tx.m_to.has_value() && tx.m_value != evmc::uint256be()) {
+            keys.emplace_back(make_buffer(tx.m_to.value()));
+        }
+        for(const auto& tuple : tx.m_access_list) {
+            for(const auto& key : tuple.m_storage_keys) {
+                keys.emplace_back(
+                    make_buffer(storage_key{tuple.m_address, key}));
             }
         }
+        return keys;
     }
 
-    void evm_runner::handle_lock_from_account(
-        const broker::interface::try_lock_return_type& res) {
-        if(!std::holds_alternative<broker::value_type>(res)) {
-            m_log->debug("Failed to read account from shards");
+    auto evm_runner::lock_initial_keys(const evmc::address& from) -> bool {
+        // The from account, the TXID key to store the receipt, the ticket
+        // number key and the block summary key are always written. The
+        // recipient and everything declared in the access list are likely
+        // to be read, so the host prefetches them in the same batch and
+        // well-formed transactions execute without another lock round
+        // trip. The host upgrades any of these locks it later needs to
+        // write.
+        auto locks = std::vector<broker::lock_request_type>();
+        locks.emplace_back(make_buffer(from), broker::lock_type::write);
+        locks.emplace_back(make_buffer(tx_id(m_tx)), broker::lock_type::write);
+        locks.emplace_back(m_host->ticket_number_key(),
+                           broker::lock_type::write);
+        locks.emplace_back(m_host->block_summary_key(),
+                           broker::lock_type::write);
+        m_n_fixed_initial_locks = locks.size();
+        auto prefetch = m_host->prefetch_locks(from);
+        locks.insert(locks.end(),
+                     std::make_move_iterator(prefetch.begin()),
+                     std::make_move_iterator(prefetch.end()));
+
+        m_log->trace(m_ticket_number,
+                     "locking",
+                     locks.size(),
+                     "initial keys from account [",
+                     to_hex(from),
+                     "]");
+
+        return m_try_lock_batch_callback(
+            std::move(locks),
+            [this](const broker::interface::try_lock_batch_return_type& res) {
+                handle_lock_initial_keys(res);
+            });
+    }
+
+    void evm_runner::handle_lock_initial_keys(
+        const broker::interface::try_lock_batch_return_type& res) {
+        if(!std::holds_alternative<std::vector<broker::value_type>>(res)) {
+            m_log->debug("Failed to lock initial keys");
             m_result_callback(error_code::wounded);
             return;
         }
-        auto v = std::get<broker::value_type>(res);
+        m_log->trace(m_ticket_number, "locked initial keys");
+        const auto& values = std::get<std::vector<broker::value_type>>(res);
+        auto prefetched = std::vector<broker::value_type>();
+        if(values.size() > m_n_fixed_initial_locks) {
+            prefetched.assign(
+                values.begin()
+                    + static_cast<std::ptrdiff_t>(m_n_fixed_initial_locks),
+                values.end());
+        }
+        if(values.size() < m_n_fixed_initial_locks
+           || !m_host->insert_prefetched(prefetched)) {
+            m_log->error("Unexpected number of initial key values");
+            m_result_callback(error_code::internal_error);
+            return;
+        }
+        handle_lock_from_account(values.front());
+    }
+
+    void evm_runner::handle_lock_from_account(const broker::value_type& v) {
         auto from_acc = evm_account();
 
         // TODO: Start at zero?
@@ -669,48 +802,7 @@ namespace cbdc::parsec::agent::runner {
         from_acc.m_nonce = from_acc.m_nonce + evmc::uint256be(1);
         m_host->insert_account(m_msg.sender, from_acc);
 
-        const auto txid_key = make_buffer(tx_id(m_tx));
-
-        m_log->trace(m_ticket_number, "locking TXID", txid_key.to_hex());
-
-        // Lock TXID key to store receipt later
-        auto maybe_sent = m_try_lock_callback(
-            txid_key,
-            broker::lock_type::write,
-            [this](const broker::interface::try_lock_return_type& r) {
-                if(!std::holds_alternative<broker::value_type>(r)) {
-                    m_log->debug("Failed to lock key for TX receipt");
-                    m_result_callback(error_code::wounded);
-                    return;
-                }
-                m_log->trace(m_ticket_number, "locked TXID key");
-                lock_ticket_number_key();
-            });
-        if(!maybe_sent) {
-            m_log->error("Failed to send try_lock request for TX receipt");
-            m_result_callback(error_code::internal_error);
-            return;
-        }
-    }
-
-    void evm_runner::lock_ticket_number_key() {
-        auto maybe_sent = m_try_lock_callback(
-            m_host->ticket_number_key(),
-            broker::lock_type::write,
-            [this](const broker::interface::try_lock_return_type& r) {
-                if(!std::holds_alternative<broker::value_type>(r)) {
-                    m_log->debug("Failed to lock key for ticket_number");
-                    m_result_callback(error_code::wounded);
-                    return;
-                }
-                m_log->trace(m_ticket_number, "locked ticket_number key");
-                schedule_exec();
-            });
-        if(!maybe_sent) {
-            m_log->error(
-                "Failed to send try_lock request for ticket_number key");
-            m_result_callback(error_code::internal_error);
-        }
+        schedule_exec();
     }
 
     void evm_runner::schedule_exec() {
@@ -41,6 +41,9 @@ namespace cbdc::parsec::agent::runner {
         get_logs,
         /// Read a specific key of an account's storage
         read_account_storage,
+        /// Return the summary of a pretend block, without the full
+        /// transactions
+        get_block_summary,
     };
 
     /// Executes EVM transactions, implementing the runner interface.
@@ -54,6 +57,7 @@ namespace cbdc::parsec::agent::runner {
                    bool is_readonly_run,
                    run_callback_type result_callback,
                    try_lock_callback_type try_lock_callback,
+                   try_lock_batch_callback_type try_lock_batch_callback,
                    std::shared_ptr<secp256k1_context> secp,
                    std::shared_ptr<thread_pool> t_pool,
                    ticket_number_type ticket_number);
@@ -76,12 +80,30 @@ namespace cbdc::parsec::agent::runner {
         /// function key.
         static constexpr auto initial_lock_type = broker::lock_type::write;
 
+        /// Returns the keys a transaction is predicted to write, for
+        /// scheduling it apart from conflicting transactions. These are the
+        /// sender's account, the recipient's account if the transaction
+        /// transfers value, and the storage keys in its access list.
+        /// \param tx transaction.
+        /// \param secp secp256k1 context to recover the sender with.
+        /// \return predicted keys, or std::nullopt if the transaction
+        ///         signature is invalid.
+        static auto
+        predicted_write_keys(const evm_tx& tx,
+                             const std::shared_ptr<secp256k1_context>& secp)
+            -> std::optional<std::vector<runtime_locking_shard::key_type>>;
+
       private:
         std::vector<std::thread> m_evm_threads;
 
         std::unique_ptr<evm_host> m_host;
         evm_tx m_tx;
+        /// Whether a block summary was requested, so blocks read from
+        /// their receipts should be summarized.
+        bool m_summarize_block{false};
         evmc_message m_msg{};
+        /// Number of initial locks preceding those prefetched by the host.
+        size_t m_n_fixed_initial_locks{0};
 
         void exec();
         auto run_execute_real_transaction() -> bool;
@@ -93,6 +115,7 @@ namespace cbdc::parsec::agent::runner {
                                      bool is_readonly_run) -> bool;
         auto run_get_account() -> bool;
         auto run_get_block() -> bool;
+        auto run_get_block_summary() -> bool;
         auto run_get_logs() -> bool;
         auto run_get_block_number() -> bool;
         [[nodiscard]] static auto check_base_gas(const evm_tx& tx,
@@ -107,10 +130,11 @@ namespace cbdc::parsec::agent::runner {
                                  bool is_readonly_run)
             -> std::pair<evmc_message, bool>;
 
-        void handle_lock_from_account(
-            const broker::interface::try_lock_return_type& res);
+        auto lock_initial_keys(const evmc::address& from) -> bool;
+        void handle_lock_initial_keys(
+            const broker::interface::try_lock_batch_return_type& res);
+        void handle_lock_from_account(const broker::value_type& v);
 
-        void lock_ticket_number_key();
         void lock_index_keys(const std::function<void()>& callback);
         void schedule_exec();
 
@@ -121,21 +145,24 @@ namespace cbdc::parsec::agent::runner {
         static auto make_pretend_block(interface::ticket_number_type tn)
             -> evm_pretend_block;
 
-        void handle_get_logs_try_lock_response(
+        void handle_get_logs_blooms(
+            const evm_log_query& qry,
+            const broker::interface::try_lock_batch_return_type& res);
+
+        void handle_get_logs_indexes(
             const evm_log_query& qry,
-            const std::shared_ptr<std::vector<evm_log_index>>& log_indexes,
-            const std::shared_ptr<std::atomic<size_t>>& acquired,
-            const std::shared_ptr<std::mutex>& log_indexes_mut,
-            size_t key_count,
-            const broker::interface::try_lock_return_type& res);
+            const broker::interface::try_lock_batch_return_type& res);
 
         void handle_complete_get_logs(
             const evm_log_query& qry,
-            const std::shared_ptr<std::mutex>& log_indexes_mut,
-            const std::shared_ptr<std::vector<evm_log_index>>& log_indexes);
+            const std::vector<evm_log_index>& log_indexes);
 
         void lock_tx_receipt(const broker::value_type& value,
                              const ticket_number_type& ticket_number);
+
+        /// Returns a pretend block as the runner result, or its summary if
+        /// the summary was requested but not stored.
+        void return_block(const evm_pretend_block& blk);
     };
 }
 
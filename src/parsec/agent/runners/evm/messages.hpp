@@ -169,6 +169,24 @@ namespace cbdc::parsec::agent::runner {
         std::vector<evm_log> m_logs;
     };
 
+    /// Summary of a pretend block, computed when its ticket commits and
+    /// stored under a key derived from the ticket number, so that block
+    /// queries which do not need full transactions read a single key.
+    struct evm_block_summary {
+        /// Ticket number
+        interface::ticket_number_type m_ticket_number {};
+        /// TXIDs of the transactions executed by the ticket
+        std::vector<cbdc::hash_t> m_txids{};
+        /// Keccak256 hashes of the serialized transaction receipts
+        std::vector<cbdc::hash_t> m_receipt_hashes{};
+        /// Total gas used by the transactions
+        evmc::uint256be m_gas_used{};
+        /// Latest timestamp of the transactions
+        uint64_t m_timestamp{};
+        /// Bloom of the addresses and topics of all logs emitted
+        cbdc::buffer m_logs_bloom{};
+    };
+
     // Type for account code keys.
     struct code_key {
         /// Address for the account code.
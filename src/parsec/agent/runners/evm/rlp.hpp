@@ -115,6 +115,74 @@ namespace cbdc {
         rlp_value_type m_type{};
     };
 
+    /// Non-owning view of an RLP-encoded item, decoded in place from the
+    /// encoded bytes rather than copied into nested rlp_value objects. The
+    /// bytes must outlive the view and any views taken from it.
+    class rlp_view {
+      public:
+        /// Decodes the item at the start of the given bytes. Any bytes
+        /// following the item are ignored.
+        /// \param data start of the encoded item.
+        /// \param size number of bytes available.
+        /// \return view of the item, or std::nullopt if its header is
+        ///         malformed or it extends past the available bytes.
+        static auto decode(const unsigned char* data, size_t size)
+            -> std::optional<rlp_view>;
+
+        /// Get the type of the item.
+        /// \return type of the item.
+        [[nodiscard]] auto type() const -> rlp_value_type;
+
+        /// Returns the item's payload: the bytes of a buffer, or the
+        /// encoded items of an array.
+        /// \return pointer to the payload.
+        [[nodiscard]] auto data() const -> const unsigned char*;
+
+        /// Get the size of the item's payload.
+        /// \return number of payload bytes.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Decodes the items of an array.
+        /// \return views of the items, or std::nullopt if this is not an
+        ///         array or one of its items is malformed.
+        [[nodiscard]] auto items() const
+            -> std::optional<std::vector<rlp_view>>;
+
+        /// Return a buffer item as address or byte array.
+        /// \tparam address or byte array type.
+        /// \return byte array or address, or std::nullopt if this is an
+        ///         array or longer than the requested type.
+        template<typename T>
+        [[nodiscard]] auto value() const -> typename std::enable_if_t<
+            std::is_same<T, evmc::bytes32>::value
+                || std::is_same<T, evmc::address>::value,
+            std::optional<T>> {
+            auto res = T();
+            if(m_type != rlp_value_type::buffer
+               || m_size > sizeof(res.bytes)) {
+                return std::nullopt;
+            }
+            if(m_size > 0) {
+                std::memcpy(&res.bytes[sizeof(res.bytes) - m_size],
+                            m_data,
+                            m_size);
+            }
+            return res;
+        }
+
+      private:
+        rlp_view(rlp_value_type type,
+                 const unsigned char* data,
+                 size_t size,
+                 size_t header_size);
+
+        rlp_value_type m_type;
+        const unsigned char* m_data;
+        size_t m_size;
+        /// Number of header bytes preceding the payload.
+        size_t m_header_size;
+    };
+
     /// Turns an existing value into an rlp_value by first serializing it as
     /// a cbdc::buffer, and then turning that into an rlp_value.
     /// \param obj object to serialize and wrap in rlp_value
@@ -187,6 +255,12 @@ namespace cbdc {
     auto rlp_decode_access_list(const rlp_value& rlp)
         -> std::optional<parsec::agent::runner::evm_access_list>;
 
+    /// Decodes an access list from an rlp_view of an array
+    /// \param rlp view to decode from
+    /// \return evm_access_list that was decoded or std::nullopt on failure
+    auto rlp_decode_access_list(const rlp_view& rlp)
+        -> std::optional<parsec::agent::runner::evm_access_list>;
+
     /// Decodes a binary representation for sizes that exceed the single-byte
     /// presentation into size_t
     /// \param buf buffer containing the binary representation to decode
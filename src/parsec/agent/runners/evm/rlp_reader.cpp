@@ -89,6 +89,122 @@ namespace cbdc {
         return ret;
     }
 
+    rlp_view::rlp_view(rlp_value_type type,
+                       const unsigned char* data,
+                       size_t size,
+                       size_t header_size)
+        : m_type(type),
+          m_data(data),
+          m_size(size),
+          m_header_size(header_size) {}
+
+    auto rlp_view::decode(const unsigned char* data, size_t size)
+        -> std::optional<rlp_view> {
+        static constexpr unsigned char byte_size_offset = 0x80;
+        static constexpr unsigned char array_size_offset = 0xc0;
+        static constexpr unsigned char max_onebyte_length = 55;
+        if(size == 0) {
+            return std::nullopt;
+        }
+
+        const auto b = data[0];
+        if(b < byte_size_offset) {
+            return rlp_view(rlp_value_type::buffer, data, 1, 0);
+        }
+
+        auto type = rlp_value_type::buffer;
+        auto offset = byte_size_offset;
+        if(b >= array_size_offset) {
+            type = rlp_value_type::array;
+            offset = array_size_offset;
+        }
+
+        size_t header_size = 1;
+        auto payload_size = static_cast<size_t>(b - offset);
+        if(payload_size > max_onebyte_length) {
+            // The length is stored big-endian in the following bytes
+            auto len_len = payload_size - max_onebyte_length;
+            if(len_len > sizeof(size_t) || len_len >= size) {
+                return std::nullopt;
+            }
+            payload_size = 0;
+            for(size_t i = 1; i <= len_len; i++) {
+                static constexpr auto bits_in_byte = 8;
+                payload_size = (payload_size << bits_in_byte) | data[i];
+            }
+            header_size += len_len;
+        }
+
+        if(payload_size > size - header_size) {
+            return std::nullopt;
+        }
+        return rlp_view(type, &data[header_size], payload_size, header_size);
+    }
+
+    auto rlp_view::type() const -> rlp_value_type {
+        return m_type;
+    }
+
+    auto rlp_view::data() const -> const unsigned char* {
+        return m_data;
+    }
+
+    auto rlp_view::size() const -> size_t {
+        return m_size;
+    }
+
+    auto rlp_view::items() const -> std::optional<std::vector<rlp_view>> {
+        if(m_type != rlp_value_type::array) {
+            return std::nullopt;
+        }
+        auto ret = std::vector<rlp_view>();
+        size_t pos = 0;
+        while(pos < m_size) {
+            auto item = decode(&m_data[pos], m_size - pos);
+            if(!item.has_value()) {
+                return std::nullopt;
+            }
+            pos += item->m_header_size + item->m_size;
+            ret.push_back(item.value());
+        }
+        return ret;
+    }
+
+    auto rlp_decode_access_list(const rlp_view& rlp)
+        -> std::optional<parsec::agent::runner::evm_access_list> {
+        auto maybe_tuples = rlp.items();
+        if(!maybe_tuples.has_value()) {
+            return std::nullopt;
+        }
+
+        auto access_list = cbdc::parsec::agent::runner::evm_access_list();
+        access_list.reserve(maybe_tuples->size());
+        for(const auto& rlp_tuple : maybe_tuples.value()) {
+            auto maybe_fields = rlp_tuple.items();
+            if(!maybe_fields.has_value() || maybe_fields->size() != 2) {
+                return std::nullopt;
+            }
+            auto& fields = maybe_fields.value();
+            auto maybe_addr = fields[0].value<evmc::address>();
+            auto maybe_keys = fields[1].items();
+            if(!maybe_addr.has_value() || !maybe_keys.has_value()) {
+                return std::nullopt;
+            }
+            auto& access_tuple = access_list.emplace_back();
+            access_tuple.m_address = maybe_addr.value();
+            access_tuple.m_storage_keys.reserve(maybe_keys->size());
+            for(const auto& rlp_key : maybe_keys.value()) {
+                auto maybe_key = rlp_key.value<evmc::bytes32>();
+                if(!maybe_key.has_value()) {
+                    return std::nullopt;
+                }
+                access_tuple.m_storage_keys.push_back(maybe_key.value());
+            }
+        }
+
+        return access_list;
+    }
+
     auto rlp_decode_access_list(const rlp_value& rlp)
         -> std::optional<parsec::agent::runner::evm_access_list> {
         if(rlp.type() != rlp_value_type::array) {
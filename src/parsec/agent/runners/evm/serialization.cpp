@@ -24,21 +24,21 @@ namespace cbdc::parsec::agent::runner {
         return keccak_data(tx_ser.data(), tx_ser.size());
     }
 
-    auto is_valid_rlp_tx(evm_tx_type type, const rlp_value& rlp_tx) -> bool {
+    auto is_valid_rlp_tx(evm_tx_type type, size_t n_elements) -> bool {
         static constexpr size_t elements_in_dynamic_fee_transaction = 12;
         static constexpr size_t elements_in_access_list_transaction = 11;
         static constexpr size_t elements_in_legacy_transaction = 9;
 
         if(type == evm_tx_type::dynamic_fee
-           && rlp_tx.size() != elements_in_dynamic_fee_transaction) {
+           && n_elements != elements_in_dynamic_fee_transaction) {
             return false;
         }
         if(type == evm_tx_type::access_list
-           && rlp_tx.size() != elements_in_access_list_transaction) {
+           && n_elements != elements_in_access_list_transaction) {
             return false;
         }
         if(type == evm_tx_type::legacy
-           && rlp_tx.size() != elements_in_legacy_transaction) {
+           && n_elements != elements_in_legacy_transaction) {
             return false;
         }
         return true;
@@ -48,7 +48,10 @@ namespace cbdc::parsec::agent::runner {
         const cbdc::buffer& buf,
         const std::shared_ptr<logging::log>& logger,
         const std::shared_ptr<cbdc::parsec::agent::runner::evm_tx>& tx)
-        -> std::optional<rlp_value> {
+        -> std::optional<std::vector<rlp_view>> {
+        if(buf.size() == 0) {
+            return std::nullopt;
+        }
         uint8_t type_byte{};
         std::memcpy(&type_byte, buf.data_at(0), 1);
         size_t rlp_offset = 0;
@@ -57,22 +60,24 @@ namespace cbdc::parsec::agent::runner {
             rlp_offset = 1;
         }
 
-        auto buf_cpy = cbdc::buffer();
-        buf_cpy.append(buf.data_at(rlp_offset), buf.size() - rlp_offset);
-        auto maybe_rlp_tx = cbdc::from_buffer<rlp_value>(buf_cpy);
+        // Decode the fields in place rather than copying each into an
+        // rlp_value
+        auto maybe_rlp_tx = rlp_view::decode(buf.c_ptr() + rlp_offset,
+                                             buf.size() - rlp_offset);
         if(!maybe_rlp_tx.has_value()) {
             return std::nullopt;
         }
-        auto rlp_tx = maybe_rlp_tx.value();
+        auto maybe_fields = maybe_rlp_tx->items();
 
-        if(!is_valid_rlp_tx(tx->m_type, rlp_tx)) {
+        if(!maybe_fields.has_value()
+           || !is_valid_rlp_tx(tx->m_type, maybe_fields->size())) {
             if(logger) {
                 logger->error("tx is not valid rlp");
             }
             return std::nullopt;
         }
 
-        return rlp_tx;
+        return maybe_fields;
     }
 
     auto tx_decode(const cbdc::buffer& buf,
@@ -81,18 +86,24 @@ namespace cbdc::parsec::agent::runner {
         -> std::optional<
             std::shared_ptr<cbdc::parsec::agent::runner::evm_tx>> {
         auto tx = std::make_shared<cbdc::parsec::agent::runner::evm_tx>();
-        auto maybe_rlp_tx = check_tx_decode(buf, logger, tx);
-        if(!maybe_rlp_tx.has_value()) {
+        auto maybe_fields = check_tx_decode(buf, logger, tx);
+        if(!maybe_fields.has_value()) {
             return std::nullopt;
         }
-        auto rlp_tx = maybe_rlp_tx.value();
+        const auto& fields = maybe_fields.value();
 
         auto element = size_t{};
+        auto valid = true;
+        auto next_word = [&]() {
+            auto word = fields[element++].value<evmc::uint256be>();
+            valid = valid && word.has_value();
+            return word.value_or(evmc::uint256be());
+        };
+
         if(tx->m_type == evm_tx_type::dynamic_fee
            || tx->m_type == evm_tx_type::access_list) {
-            auto tx_chain_id
-                = rlp_tx.value_at(element++).value<evmc::uint256be>();
-            if(to_uint64(tx_chain_id) != chain_id) {
+            auto tx_chain_id = next_word();
+            if(valid && to_uint64(tx_chain_id) != chain_id) {
                 if(logger) {
                     logger->error("tx is wrong chain ID");
                 }
@@ -100,38 +111,36 @@ namespace cbdc::parsec::agent::runner {
             }
         }
 
-        tx->m_nonce = rlp_tx.value_at(element++).value<evmc::uint256be>();
+        tx->m_nonce = next_word();
 
         if(tx->m_type == evm_tx_type::dynamic_fee) {
-            tx->m_gas_tip_cap
-                = rlp_tx.value_at(element++).value<evmc::uint256be>();
-            tx->m_gas_fee_cap
-                = rlp_tx.value_at(element++).value<evmc::uint256be>();
+            tx->m_gas_tip_cap = next_word();
+            tx->m_gas_fee_cap = next_word();
         } else {
-            tx->m_gas_price
-                = rlp_tx.value_at(element++).value<evmc::uint256be>();
+            tx->m_gas_price = next_word();
         }
-        tx->m_gas_limit = rlp_tx.value_at(element++).value<evmc::uint256be>();
-        auto to = rlp_tx.value_at(element++);
+        tx->m_gas_limit = next_word();
+        const auto& to = fields[element++];
         if(to.size() > 0) {
-            tx->m_to = to.value<evmc::address>();
+            auto maybe_to = to.value<evmc::address>();
+            valid = valid && maybe_to.has_value();
+            tx->m_to = maybe_to;
         }
-        tx->m_value = rlp_tx.value_at(element++).value<evmc::uint256be>();
-        auto data = rlp_tx.value_at(element++);
-        tx->m_input.resize(data.size());
-        std::memcpy(tx->m_input.data(), data.data(), data.size());
+        tx->m_value = next_word();
+        const auto& data = fields[element++];
+        valid = valid && data.type() == rlp_value_type::buffer;
+        tx->m_input.assign(data.data(), data.data() + data.size());
 
         if(tx->m_type == evm_tx_type::dynamic_fee
            || tx->m_type == evm_tx_type::access_list) {
-            auto rlp_access_list = rlp_tx.value_at(element++);
-            auto access_list = rlp_decode_access_list(rlp_access_list);
+            auto access_list = rlp_decode_access_list(fields[element++]);
             if(access_list.has_value()) {
-                tx->m_access_list = access_list.value();
+                tx->m_access_list = std::move(access_list.value());
             }
         }
 
-        tx->m_sig.m_v = rlp_tx.value_at(element++).value<evmc::uint256be>();
-        if(tx->m_type == evm_tx_type::legacy) {
+        tx->m_sig.m_v = next_word();
+        if(valid && tx->m_type == evm_tx_type::legacy) {
             auto small_v = to_uint64(tx->m_sig.m_v);
             if(small_v >= eip155_v_offset) {
                 auto tx_chain_id = (small_v - eip155_v_offset) / 2;
@@ -147,8 +156,15 @@ namespace cbdc::parsec::agent::runner {
             }
         }
 
-        tx->m_sig.m_r = rlp_tx.value_at(element++).value<evmc::uint256be>();
-        tx->m_sig.m_s = rlp_tx.value_at(element++).value<evmc::uint256be>();
+        tx->m_sig.m_r = next_word();
+        tx->m_sig.m_s = next_word();
+
+        if(!valid) {
+            if(logger) {
+                logger->error("tx has malformed fields");
+            }
+            return std::nullopt;
+        }
         return tx;
     }
 
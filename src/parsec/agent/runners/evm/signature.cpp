@@ -13,12 +13,71 @@
 #include "serialization.hpp"
 #include "util.hpp"
 #include "util/common/hash.hpp"
+#include "util/common/hashmap.hpp"
 #include "util/serialization/util.hpp"
 
+#include <array>
+#include <deque>
+#include <mutex>
 #include <optional>
 #include <secp256k1.h>
+#include <unordered_map>
 
 namespace cbdc::parsec::agent::runner {
+    namespace {
+        /// Sighash followed by the recoverable signature over it.
+        using signed_hash_type
+            = std::array<unsigned char,
+                         sizeof(hash_t)
+                             + sizeof(secp256k1_ecdsa_recoverable_signature)>;
+
+        /// Bounded cache of the signers recovered from signed hashes. A
+        /// transaction is checked when submitted and again each time it is
+        /// executed, including retries, so most recoveries repeat one
+        /// already done. Recovery is deterministic, so a hit returns
+        /// exactly what recovering again would.
+        class signer_cache {
+          public:
+            static constexpr size_t capacity = 16384;
+
+            auto find(const signed_hash_type& key)
+                -> std::optional<evmc::address> {
+                std::unique_lock l(m_mut);
+                auto it = m_signers.find(key);
+                if(it == m_signers.end()) {
+                    return std::nullopt;
+                }
+                return it->second;
+            }
+
+            void add(const signed_hash_type& key, const evmc::address& addr) {
+                std::unique_lock l(m_mut);
+                if(!m_signers.emplace(key, addr).second) {
+                    return;
+                }
+                m_order.push_back(key);
+                if(m_order.size() > capacity) {
+                    m_signers.erase(m_order.front());
+                    m_order.pop_front();
+                }
+            }
+
+          private:
+            std::mutex m_mut;
+            std::unordered_map<signed_hash_type,
+                               evmc::address,
+                               hashing::const_sip_hash<signed_hash_type>>
+                m_signers;
+            /// Cached keys, oldest first.
+            std::deque<signed_hash_type> m_order;
+        };
+
+        auto signers() -> signer_cache& {
+            static auto cache = signer_cache();
+            return cache;
+        }
+    }
+
     auto secp256k1_ecdsa_recoverable_signature_to_evm_sig(
         secp256k1_ecdsa_recoverable_signature& sig,
         evm_tx_type type,
@@ -117,6 +176,13 @@ namespace cbdc::parsec::agent::runner {
 
         auto sig = maybe_sig.value();
 
+        auto key = signed_hash_type();
+        std::memcpy(key.data(), sighash.data(), sighash.size());
+        std::memcpy(&key[sighash.size()], sig.data, sizeof(sig.data));
+        if(auto cached = signers().find(key)) {
+            return cached;
+        }
+
         // Recover pubkey
         auto pk = std::make_unique<secp256k1_pubkey>();
         [[maybe_unused]] const auto rec_ret
@@ -128,7 +194,9 @@ namespace cbdc::parsec::agent::runner {
             return std::nullopt;
         }
 
-        return eth_addr(pk, ctx);
+        auto addr = eth_addr(pk, ctx);
+        signers().add(key, addr);
+        return addr;
     }
 
     auto sig_hash(const cbdc::parsec::agent::runner::evm_tx& tx,
@@ -12,9 +12,12 @@
 #include "math.hpp"
 #include "parsec/util.hpp"
 #include "rlp.hpp"
+#include "serialization.hpp"
 #include "util/common/hash.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
+#include <array>
 #include <future>
 #include <optional>
 #include <secp256k1.h>
@@ -25,52 +28,68 @@ namespace cbdc::parsec::agent::runner {
     }
 
     auto to_hex(const evmc::address& addr) -> std::string {
-        return evmc::hex(evmc::bytes(addr.bytes, sizeof(addr.bytes)));
+        auto ret = std::string(sizeof(addr.bytes) * 2, '\0');
+        hex_encode(&addr.bytes[0], sizeof(addr.bytes), ret.data());
+        return ret;
     }
 
     auto to_hex(const evmc::bytes32& b) -> std::string {
-        return evmc::hex(evmc::bytes(b.bytes, sizeof(b.bytes)));
+        auto ret = std::string(sizeof(b.bytes) * 2, '\0');
+        hex_encode(&b.bytes[0], sizeof(b.bytes), ret.data());
+        return ret;
     }
 
     auto to_hex_trimmed(const evmc::bytes32& b, const std::string& prefix)
         -> std::string {
-        auto b_vec = std::vector<uint8_t>();
-        b_vec.resize(sizeof(b.bytes));
-        std::memcpy(b_vec.data(), &b.bytes[0], sizeof(b.bytes));
         size_t offset = 0;
-        while(offset < b_vec.size() && b_vec.at(offset) == 0x00) {
+        while(offset < sizeof(b.bytes) && b.bytes[offset] == 0x00) {
             offset++;
         }
         if(offset >= sizeof(b.bytes)) {
             return prefix + "0";
         }
 
-        auto str
-            = evmc::hex(evmc::bytes(&b_vec.at(offset), b_vec.size() - offset));
-        if(str.substr(0, 1) == "0") {
-            str = str.substr(1);
+        // Drop the leading zero digit of the first non-zero byte, if any
+        auto len = sizeof(b.bytes) - offset;
+        auto str = std::string(prefix.size() + len * 2, '\0');
+        std::memcpy(str.data(), prefix.data(), prefix.size());
+        hex_encode(&b.bytes[offset], len, str.data() + prefix.size());
+        if(str[prefix.size()] == '0') {
+            str.erase(prefix.size(), 1);
+        }
+        return str;
+    }
+
+    namespace {
+        /// Returns the byte index and bit mask of each of the three bloom
+        /// bits for the given entry.
+        auto bloom_bits(const cbdc::buffer& entry)
+            -> std::array<std::pair<size_t, uint8_t>, 3> {
+            auto hash = keccak_data(entry.data(), entry.size());
+
+            auto ret = std::array<std::pair<size_t, uint8_t>, 3>();
+            for(size_t i = 0; i <= 4; i += 2) {
+                // Read in host byte order, as deserializing a uint16_t does
+                uint16_t byte_pair{};
+                std::memcpy(&byte_pair, &hash[i], sizeof(byte_pair));
+                static constexpr uint16_t bloom_bits = 0x07FF;
+                auto bit_to_set = byte_pair & bloom_bits;
+                auto bit_index = bloom_bits - bit_to_set;
+                constexpr auto bits_in_byte = 8;
+                auto byte_index
+                    = static_cast<size_t>(bit_index / bits_in_byte);
+                auto bit_value = static_cast<uint8_t>(
+                    1 << ((bits_in_byte - 1) - (bit_index % bits_in_byte)));
+                ret[i / 2] = {byte_index, bit_value};
+            }
+            return ret;
         }
-        return prefix + str;
     }
 
     // Taken from: ethereum.github.io/execution-specs/autoapi/ethereum/
     // frontier/bloom/index.html#logs-bloom
     void add_to_bloom(cbdc::buffer& bloom, const cbdc::buffer& entry) {
-        auto hash = cbdc::make_buffer(keccak_data(entry.data(), entry.size()));
-
-        for(size_t i = 0; i <= 4; i += 2) {
-            auto uint16_buf = cbdc::buffer();
-            uint16_buf.extend(2);
-            std::memcpy(uint16_buf.data(), hash.data_at(i), 2);
-            uint16_t byte_pair
-                = cbdc::from_buffer<uint16_t>(uint16_buf).value();
-            static constexpr uint16_t bloom_bits = 0x07FF;
-            auto bit_to_set = byte_pair & bloom_bits;
-            auto bit_index = bloom_bits - bit_to_set;
-            constexpr auto bits_in_byte = 8;
-            auto byte_index = static_cast<size_t>(bit_index / bits_in_byte);
-            auto bit_value = static_cast<uint8_t>(
-                1 << ((bits_in_byte - 1) - (bit_index % bits_in_byte)));
+        for(auto [byte_index, bit_value] : bloom_bits(entry)) {
             uint8_t bloom_byte{};
             std::memcpy(&bloom_byte, bloom.data_at(byte_index), 1);
             bloom_byte |= bit_value;
@@ -78,6 +97,46 @@ namespace cbdc::parsec::agent::runner {
         }
     }
 
+    auto bloom_contains(const cbdc::buffer& bloom, const cbdc::buffer& entry)
+        -> bool {
+        if(bloom.size() != evm_bloom_size) {
+            return false;
+        }
+        for(auto [byte_index, bit_value] : bloom_bits(entry)) {
+            uint8_t bloom_byte{};
+            std::memcpy(&bloom_byte, bloom.data_at(byte_index), 1);
+            if((bloom_byte & bit_value) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto make_block_summary(const evm_pretend_block& blk)
+        -> evm_block_summary {
+        auto summary = evm_block_summary();
+        summary.m_ticket_number = blk.m_ticket_number;
+        summary.m_logs_bloom.extend(evm_bloom_size);
+        auto gas_used = evmc::uint256be();
+        for(const auto& rcpt : blk.m_transactions) {
+            summary.m_txids.push_back(tx_id(rcpt.m_tx));
+            auto rcpt_buf = make_buffer(rcpt);
+            summary.m_receipt_hashes.push_back(
+                keccak_data(rcpt_buf.data(), rcpt_buf.size()));
+            gas_used = gas_used + rcpt.m_gas_used;
+            summary.m_timestamp
+                = std::max(summary.m_timestamp, rcpt.m_timestamp);
+            for(const auto& l : rcpt.m_logs) {
+                add_to_bloom(summary.m_logs_bloom, make_buffer(l.m_addr));
+                for(const auto& t : l.m_topics) {
+                    add_to_bloom(summary.m_logs_bloom, make_buffer(t));
+                }
+            }
+        }
+        summary.m_gas_used = gas_used;
+        return summary;
+    }
+
     auto uint256be_from_hex(const std::string& hex)
         -> std::optional<evmc::uint256be> {
         auto maybe_bytes = cbdc::buffer::from_hex_prefixed(hex);
@@ -110,34 +169,29 @@ namespace cbdc::parsec::agent::runner {
             = evmc::uint256be(initial_mint) * evmc::uint256be(decimals);
         auto acc_buf = cbdc::make_buffer(acc);
 
-        auto successes = std::vector<std::future<bool>>();
-
+        auto rows = cbdc::parsec::broker::state_update_type();
         for(const auto& init_addr_hex :
             cbdc::parsec::agent::init_addresses_for_testing) {
             log->info("Seeding address ", init_addr_hex);
             auto init_addr = cbdc::buffer::from_hex(init_addr_hex).value();
-            auto seed_success = std::make_shared<std::promise<bool>>();
-            auto seed_fut = seed_success->get_future();
-            successes.emplace_back(std::move(seed_fut));
-            auto success
-                = cbdc::parsec::put_row(broker,
-                                        init_addr,
-                                        acc_buf,
-                                        [seed_success](bool s) {
-                                            seed_success->set_value(s);
-                                        });
-            if(!success) {
-                log->error("Error requesting seeding account");
-                return false;
-            }
+            rows.emplace(std::move(init_addr), acc_buf);
         }
 
-        for(auto& f : successes) {
-            auto seed_res = f.get();
-            if(!seed_res) {
-                log->error("Error during seeding");
-                return false;
-            }
+        auto seed_success = std::make_shared<std::promise<bool>>();
+        auto seed_fut = seed_success->get_future();
+        auto success = cbdc::parsec::put_rows(broker,
+                                              std::move(rows),
+                                              [seed_success](bool s) {
+                                                  seed_success->set_value(s);
+                                              });
+        if(!success) {
+            log->error("Error requesting seeding accounts");
+            return false;
+        }
+
+        if(!seed_fut.get()) {
+            log->error("Error during seeding");
+            return false;
         }
 
         return true;
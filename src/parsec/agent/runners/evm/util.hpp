@@ -10,6 +10,7 @@
 #include "parsec/broker/interface.hpp"
 #include "util/common/buffer.hpp"
 #include "util/common/hash.hpp"
+#include "util/common/hex.hpp"
 #include "util/common/keys.hpp"
 #include "util/common/logging.hpp"
 
@@ -32,7 +33,9 @@ namespace cbdc::parsec::agent::runner {
     /// \return hex string representation of v.
     template<typename T>
     auto to_hex(const T& v) -> std::string {
-        return evmc::hex(evmc::bytes(v.bytes, sizeof(v.bytes)));
+        auto ret = std::string(sizeof(v.bytes) * 2, '\0');
+        cbdc::hex_encode(&v.bytes[0], sizeof(v.bytes), ret.data());
+        return ret;
     }
 
     auto to_hex_trimmed(const evmc::bytes32& b,
@@ -45,6 +48,23 @@ namespace cbdc::parsec::agent::runner {
     ///      paris/bloom/index.html
     void add_to_bloom(cbdc::buffer& bloom, const cbdc::buffer& entry);
 
+    /// Size of a bloom value in bytes.
+    static constexpr size_t evm_bloom_size = 256;
+
+    /// Checks whether an entry may have been added to a bloom value.
+    /// \param bloom bloom value of evm_bloom_size bytes.
+    /// \param entry the entry to look for.
+    /// \return false if the entry was certainly not added to the bloom, or
+    ///         if the bloom is not of the right size.
+    auto bloom_contains(const cbdc::buffer& bloom, const cbdc::buffer& entry)
+        -> bool;
+
+    /// Computes the summary of a pretend block from its receipts.
+    /// \param blk pretend block.
+    /// \return block summary.
+    auto make_block_summary(const evm_pretend_block& blk)
+        -> evm_block_summary;
+
     /// Parses hexadecimal representation in string format to T
     /// \tparam T type to convert from hex to.
     /// \param hex hex string to parse. May be prefixed with 0x
@@ -13,6 +13,7 @@ namespace cbdc::parsec::agent::runner {
                          bool is_readonly_run,
                          run_callback_type result_callback,
                          try_lock_callback_type try_lock_callback,
+                         try_lock_batch_callback_type try_lock_batch_callback,
                          std::shared_ptr<secp256k1_context> secp,
                          std::shared_ptr<thread_pool> t_pool,
                          ticket_number_type ticket_number)
@@ -23,6 +24,7 @@ namespace cbdc::parsec::agent::runner {
           m_is_readonly_run(is_readonly_run),
           m_result_callback(std::move(result_callback)),
           m_try_lock_callback(std::move(try_lock_callback)),
+          m_try_lock_batch_callback(std::move(try_lock_batch_callback)),
           m_secp(std::move(secp)),
           m_threads(std::move(t_pool)),
           m_ticket_number(ticket_number) {}
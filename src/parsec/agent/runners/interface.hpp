@@ -65,6 +65,14 @@ namespace cbdc::parsec::agent::runner {
                                  broker::lock_type,
                                  broker::interface::try_lock_callback_type)>;
 
+        /// Callback function type for acquiring several locks at once, such
+        /// as the keys a function is known to access before it executes.
+        /// Accepts the keys to lock and a function to call with the batch
+        /// lock result. Returns true if request was initiated successfully.
+        using try_lock_batch_callback_type = std::function<
+            bool(std::vector<broker::lock_request_type>,
+                 broker::interface::try_lock_batch_callback_type)>;
+
         /// Factory function type for instantiating new runners.
         using factory_type = std::function<std::unique_ptr<interface>(
             std::shared_ptr<logging::log> logger,
@@ -74,6 +82,8 @@ namespace cbdc::parsec::agent::runner {
             bool is_readonly_run,
             runner::interface::run_callback_type result_callback,
             runner::interface::try_lock_callback_type try_lock_callback,
+            runner::interface::try_lock_batch_callback_type
+                try_lock_batch_callback,
             std::shared_ptr<secp256k1_context>,
             std::shared_ptr<thread_pool> t_pool,
             ticket_number_type ticket_number)>;
@@ -89,6 +99,9 @@ namespace cbdc::parsec::agent::runner {
         ///                        result.
         /// \param try_lock_callback function to call for the function to
         ///                          request key locks.
+        /// \param try_lock_batch_callback function to call for the function
+        ///                                to request several key locks at
+        ///                                once.
         /// \param secp shared context for libsecp256k1.
         /// \param t_pool shared thread pool between agents.
         /// \param ticket_number ticket number for the ticket managed by this
@@ -100,6 +113,7 @@ namespace cbdc::parsec::agent::runner {
                   bool is_readonly_run,
                   run_callback_type result_callback,
                   try_lock_callback_type try_lock_callback,
+                  try_lock_batch_callback_type try_lock_batch_callback,
                   std::shared_ptr<secp256k1_context> secp,
                   std::shared_ptr<thread_pool> t_pool,
                   ticket_number_type ticket_number);
@@ -127,6 +141,7 @@ namespace cbdc::parsec::agent::runner {
         bool m_is_readonly_run;
         run_callback_type m_result_callback;
         try_lock_callback_type m_try_lock_callback;
+        try_lock_batch_callback_type m_try_lock_batch_callback;
         std::shared_ptr<secp256k1_context> m_secp;
         std::shared_ptr<thread_pool> m_threads;
         ticket_number_type m_ticket_number;
@@ -148,6 +163,8 @@ namespace cbdc::parsec::agent::runner {
                bool is_readonly_run,
                runner::interface::run_callback_type result_callback,
                runner::interface::try_lock_callback_type try_lock_callback,
+               runner::interface::try_lock_batch_callback_type
+                   try_lock_batch_callback,
                std::shared_ptr<secp256k1_context> secp,
                std::shared_ptr<thread_pool> t_pool,
                runner::interface::ticket_number_type ticket_number)
@@ -159,6 +176,7 @@ namespace cbdc::parsec::agent::runner {
                                        is_readonly_run,
                                        std::move(result_callback),
                                        std::move(try_lock_callback),
+                                       std::move(try_lock_batch_callback),
                                        std::move(secp),
                                        std::move(t_pool),
                                        ticket_number);
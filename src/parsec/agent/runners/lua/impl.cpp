@@ -6,19 +6,119 @@
 #include "impl.hpp"
 
 #include "crypto/sha256.h"
+#include "util/common/cache_set.hpp"
+#include "util/common/hashmap.hpp"
 #include "util/common/keys.hpp"
 #include "util/common/variant_overloaded.hpp"
 
 #include <cassert>
+#include <list>
+#include <mutex>
 #include <secp256k1.h>
 #include <secp256k1_schnorrsig.h>
+#include <unordered_map>
+#include <vector>
 
 namespace cbdc::parsec::agent::runner {
-    static const auto secp_context
-        = std::unique_ptr<secp256k1_context,
-                          decltype(&secp256k1_context_destroy)>(
-            secp256k1_context_create(SECP256K1_CONTEXT_VERIFY),
-            &secp256k1_context_destroy);
+    /// Lua state with the standard libraries and check_sig loaded, along
+    /// with the contract functions most recently loaded into it.
+    struct lua_runner::pooled_state {
+        /// Maximum number of idle states kept in the pool.
+        static constexpr size_t max_pooled = 64;
+        /// Maximum number of loaded functions each state keeps.
+        static constexpr size_t max_cached_functions = 64;
+
+        /// Function loaded into the state and kept alive in its registry.
+        struct cached_function {
+            buffer m_bytecode;
+            int m_ref{LUA_NOREF};
+        };
+
+        pooled_state() {
+            // TODO: use custom allocator to limit memory allocation
+            m_state = luaL_newstate();
+            if(m_state == nullptr) {
+                return;
+            }
+            // TODO: provide custom environment limited only to safe library
+            //       methods
+            luaL_openlibs(m_state);
+            lua_register(m_state, "check_sig", &lua_runner::check_sig);
+        }
+
+        ~pooled_state() {
+            if(m_state != nullptr) {
+                lua_close(m_state);
+            }
+        }
+
+        pooled_state(const pooled_state&) = delete;
+        auto operator=(const pooled_state&) -> pooled_state& = delete;
+        pooled_state(pooled_state&&) = delete;
+        auto operator=(pooled_state&&) -> pooled_state& = delete;
+
+        /// Pushes the function with the given bytecode onto the stack of a
+        /// coroutine of this state, loading it only if it is not cached.
+        /// The bytecode itself is the cache key, so a contract updated in
+        /// the shard is loaded afresh while the stale copy ages out.
+        /// \param thread coroutine to push the function onto.
+        /// \param bytecode function bytecode.
+        /// \return true if the function was pushed.
+        auto push_function(lua_State* thread, const buffer& bytecode)
+            -> bool {
+            static constexpr auto function_name = "contract";
+
+            auto h = hashing::const_sip_hash<buffer>{}(bytecode);
+            auto [first, last] = m_index.equal_range(h);
+            for(auto it = first; it != last; it++) {
+                if(it->second->m_bytecode == bytecode) {
+                    m_functions.splice(m_functions.begin(),
+                                       m_functions,
+                                       it->second);
+                    lua_rawgeti(m_state, LUA_REGISTRYINDEX, it->second->m_ref);
+                    lua_xmove(m_state, thread, 1);
+                    return true;
+                }
+            }
+
+            auto load_ret = luaL_loadbufferx(m_state,
+                                             bytecode.c_str(),
+                                             bytecode.size(),
+                                             function_name,
+                                             "b");
+            if(load_ret != LUA_OK) {
+                lua_pop(m_state, 1);
+                return false;
+            }
+            lua_pushvalue(m_state, -1);
+            auto ref = luaL_ref(m_state, LUA_REGISTRYINDEX);
+            lua_xmove(m_state, thread, 1);
+
+            if(m_functions.size() == max_cached_functions) {
+                auto& oldest = m_functions.back();
+                auto oldest_h
+                    = hashing::const_sip_hash<buffer>{}(oldest.m_bytecode);
+                auto [o_first, o_last] = m_index.equal_range(oldest_h);
+                for(auto it = o_first; it != o_last; it++) {
+                    if(it->second == std::prev(m_functions.end())) {
+                        m_index.erase(it);
+                        break;
+                    }
+                }
+                luaL_unref(m_state, LUA_REGISTRYINDEX, oldest.m_ref);
+                m_functions.pop_back();
+            }
+            m_functions.push_front(cached_function{bytecode, ref});
+            m_index.emplace(h, m_functions.begin());
+            return true;
+        }
+
+        lua_State* m_state{};
+        /// Cached functions, most recently used first.
+        std::list<cached_function> m_functions;
+        std::unordered_multimap<uint64_t, std::list<cached_function>::iterator>
+            m_index;
+    };
 
     lua_runner::lua_runner(std::shared_ptr<logging::log> logger,
                            const cbdc::parsec::config& cfg,
@@ -27,6 +127,7 @@ namespace cbdc::parsec::agent::runner {
                            bool is_readonly_run,
                            run_callback_type result_callback,
                            try_lock_callback_type try_lock_callback,
+                           try_lock_batch_callback_type try_lock_batch_callback,
                            std::shared_ptr<secp256k1_context> secp,
                            std::shared_ptr<thread_pool> t_pool,
                            ticket_number_type ticket_number)
@@ -37,43 +138,79 @@ namespace cbdc::parsec::agent::runner {
                     is_readonly_run,
                     std::move(result_callback),
                     std::move(try_lock_callback),
+                    std::move(try_lock_batch_callback),
                     std::move(secp),
                     std::move(t_pool),
                     ticket_number) {}
 
-    auto lua_runner::run() -> bool {
-        // TODO: use custom allocator to limit memory allocation
-        m_state
-            = std::shared_ptr<lua_State>(luaL_newstate(), [](lua_State* s) {
-                  lua_close(s);
-              });
+    lua_runner::~lua_runner() {
+        if(m_pooled) {
+            luaL_unref(m_pooled->m_state, LUA_REGISTRYINDEX, m_state_ref);
+        }
+    }
+
+    auto lua_runner::acquire_state() -> std::shared_ptr<pooled_state> {
+        // Idle states shared by all runners. Runners hop between threads as
+        // lock responses arrive, so a state is usually released on a
+        // different thread from the one that acquired it.
+        static std::mutex pool_mut;
+        static std::vector<std::unique_ptr<pooled_state>> idle;
+
+        auto release = [](pooled_state* s) {
+            auto state = std::unique_ptr<pooled_state>(s);
+            lua_settop(state->m_state, 0);
+            std::unique_lock l(pool_mut);
+            if(idle.size() < pooled_state::max_pooled) {
+                idle.emplace_back(std::move(state));
+            }
+        };
 
-        if(!m_state) {
+        {
+            std::unique_lock l(pool_mut);
+            if(!idle.empty()) {
+                auto state = std::move(idle.back());
+                idle.pop_back();
+                return {state.release(), release};
+            }
+        }
+
+        auto state = std::make_unique<pooled_state>();
+        if(state->m_state == nullptr) {
+            return nullptr;
+        }
+        return {state.release(), release};
+    }
+
+    auto lua_runner::run() -> bool {
+        m_pooled = acquire_state();
+        if(!m_pooled) {
             m_log->error("Failed to allocate new lua state");
             m_result_callback(error_code::internal_error);
             return true;
         }
 
-        // TODO: provide custom environment limited only to safe library
-        //       methods
-        luaL_openlibs(m_state.get());
+        auto* main_state = m_pooled->m_state;
+        m_state = lua_newthread(main_state);
+        m_state_ref = luaL_ref(main_state, LUA_REGISTRYINDEX);
 
-        lua_register(m_state.get(), "check_sig", &lua_runner::check_sig);
-
-        static constexpr auto function_name = "contract";
-
-        auto load_ret = luaL_loadbufferx(m_state.get(),
-                                         m_function.c_str(),
-                                         m_function.size(),
-                                         function_name,
-                                         "b");
-        if(load_ret != LUA_OK) {
+        if(!m_pooled->push_function(m_state, m_function)) {
             m_log->error("Failed to load function chunk");
             m_result_callback(error_code::function_load);
             return true;
         }
 
-        if(lua_pushlstring(m_state.get(), m_param.c_str(), m_param.size())
+        // Give the function a fresh global environment which reads through
+        // to the state's globals, replacing its _ENV upvalue
+        lua_newtable(m_state);
+        lua_newtable(m_state);
+        lua_pushglobaltable(m_state);
+        lua_setfield(m_state, -2, "__index");
+        lua_setmetatable(m_state, -2);
+        if(lua_setupvalue(m_state, -2, 1) == nullptr) {
+            lua_pop(m_state, 1);
+        }
+
+        if(lua_pushlstring(m_state, m_param.c_str(), m_param.size())
            == nullptr) {
             m_log->error("Failed to push function params");
             m_result_callback(error_code::internal_error);
@@ -92,7 +229,7 @@ namespace cbdc::parsec::agent::runner {
             return;
         }
 
-        if(lua_istable(m_state.get(), -1) != 1) {
+        if(lua_istable(m_state, -1) != 1) {
             m_log->error("Contract did not return a table");
             m_result_callback(error_code::result_type);
             return;
@@ -100,8 +237,8 @@ namespace cbdc::parsec::agent::runner {
 
         auto results = runtime_locking_shard::state_update_type();
 
-        lua_pushnil(m_state.get());
-        while(lua_next(m_state.get(), -2) != 0) {
+        lua_pushnil(m_state);
+        while(lua_next(m_state, -2) != 0) {
             auto key_buf = get_stack_string(-2);
             if(!key_buf.has_value()) {
                 m_log->error("Result key is not a string");
@@ -118,7 +255,7 @@ namespace cbdc::parsec::agent::runner {
             results.emplace(std::move(key_buf.value()),
                             std::move(value_buf.value()));
 
-            lua_pop(m_state.get(), 1);
+            lua_pop(m_state, 1);
         }
 
         m_log->trace(this, "running calling result callback");
@@ -127,11 +264,11 @@ namespace cbdc::parsec::agent::runner {
     }
 
     auto lua_runner::get_stack_string(int index) -> std::optional<buffer> {
-        if(lua_isstring(m_state.get(), index) != 1) {
+        if(lua_isstring(m_state, index) != 1) {
             return std::nullopt;
         }
         size_t sz{};
-        const auto* str = lua_tolstring(m_state.get(), index, &sz);
+        const auto* str = lua_tolstring(m_state, index, &sz);
         assert(str != nullptr);
         auto buf = buffer();
         buf.append(str, sz);
@@ -140,7 +277,7 @@ namespace cbdc::parsec::agent::runner {
 
     void lua_runner::schedule_contract() {
         int n_results{};
-        auto resume_ret = lua_resume(m_state.get(), nullptr, 1, &n_results);
+        auto resume_ret = lua_resume(m_state, nullptr, 1, &n_results);
         if(resume_ret == LUA_YIELD) {
             if(n_results != 1) {
                 m_log->error("Contract yielded more than one key");
@@ -153,7 +290,7 @@ namespace cbdc::parsec::agent::runner {
                 m_result_callback(error_code::yield_type);
                 return;
             }
-            lua_pop(m_state.get(), n_results);
+            lua_pop(m_state, n_results);
             auto success
                 = m_try_lock_callback(std::move(key_buf.value()),
                                       broker::lock_type::write,
@@ -165,7 +302,7 @@ namespace cbdc::parsec::agent::runner {
                 m_result_callback(error_code::internal_error);
             }
         } else if(resume_ret != LUA_OK) {
-            const auto* err = lua_tostring(m_state.get(), -1);
+            const auto* err = lua_tostring(m_state, -1);
             m_log->error("Error running contract:", err);
             m_result_callback(error_code::exec_error);
         } else {
@@ -178,7 +315,7 @@ namespace cbdc::parsec::agent::runner {
         auto maybe_error = std::visit(
             overloaded{
                 [&](const broker::value_type& v) -> std::optional<error_code> {
-                    if(lua_pushlstring(m_state.get(), v.c_str(), v.size())
+                    if(lua_pushlstring(m_state, v.c_str(), v.size())
                        == nullptr) {
                         m_log->error("Failed to push yield params");
                         return error_code::internal_error;
@@ -239,8 +376,31 @@ namespace cbdc::parsec::agent::runner {
         }
         std::memcpy(sig.data(), str, sz);
 
+        str = lua_tolstring(L, 3, &sz);
+        assert(str != nullptr);
+        auto sha = CSHA256();
+        sha.Write(reinterpret_cast<const unsigned char*>(str), sz);
+        hash_t sighash{};
+        sha.Finalize(sighash.data());
+
+        // Contracts are run again from the start after being wounded, so
+        // the same signatures are checked repeatedly under contention. A
+        // digest of a combination which verified before is remembered
+        // instead of verifying it again.
+        static auto verified = cache_set<hash_t, hashing::null>(
+            verified_sig_cache_size);
+        auto cache_sha = CSHA256();
+        cache_sha.Write(key.data(), key.size());
+        cache_sha.Write(sig.data(), sig.size());
+        cache_sha.Write(sighash.data(), sighash.size());
+        hash_t cache_key{};
+        cache_sha.Finalize(cache_key.data());
+        if(verified.contains(cache_key)) {
+            return 0;
+        }
+
         secp256k1_xonly_pubkey pubkey{};
-        if(secp256k1_xonly_pubkey_parse(secp_context.get(),
+        if(secp256k1_xonly_pubkey_parse(secp_context().get(),
                                         &pubkey,
                                         key.data())
            != 1) {
@@ -248,16 +408,7 @@ namespace cbdc::parsec::agent::runner {
             lua_error(L);
         }
 
-        str = lua_tolstring(L, 3, &sz);
-        assert(str != nullptr);
-        auto sha = CSHA256();
-        auto unsigned_str = std::vector<unsigned char>(sz);
-        std::memcpy(unsigned_str.data(), str, sz);
-        sha.Write(unsigned_str.data(), sz);
-        hash_t sighash{};
-        sha.Finalize(sighash.data());
-
-        if(secp256k1_schnorrsig_verify(secp_context.get(),
+        if(secp256k1_schnorrsig_verify(secp_context().get(),
                                        sig.data(),
                                        sighash.data(),
                                        &pubkey)
@@ -265,6 +416,7 @@ namespace cbdc::parsec::agent::runner {
             lua_pushliteral(L, "invalid signature");
             lua_error(L);
         }
+        verified.add(cache_key);
 
         return 0;
     }
@@ -18,6 +18,14 @@ namespace cbdc::parsec::agent::runner {
     /// function execution, signature checking and commiting execution results.
     /// Class cannot be re-used for different functions/transactions, manages
     /// the lifecycle of a single transaction.
+    ///
+    /// Contracts run in coroutines of Lua states taken from a shared pool,
+    /// which already have the standard libraries loaded. Each state caches
+    /// the functions it has loaded, keyed by their bytecode, so a contract
+    /// is only parsed again after its code changes or it has been evicted.
+    /// Each run gets its own global environment, which falls back to the
+    /// state's globals, so globals set by a contract do not leak into later
+    /// runs.
     class lua_runner : public interface {
       public:
         /// \copydoc interface::interface()
@@ -28,6 +36,7 @@ namespace cbdc::parsec::agent::runner {
                    bool is_readonly_run,
                    run_callback_type result_callback,
                    try_lock_callback_type try_lock_callback,
+                   try_lock_batch_callback_type try_lock_batch_callback,
                    std::shared_ptr<secp256k1_context> secp,
                    std::shared_ptr<thread_pool> t_pool,
                    ticket_number_type ticket_number);
@@ -40,8 +49,23 @@ namespace cbdc::parsec::agent::runner {
         /// Lock type to acquire when requesting the function code.
         static constexpr auto initial_lock_type = broker::lock_type::read;
 
+        /// Number of verified signatures check_sig remembers across all
+        /// runners.
+        static constexpr size_t verified_sig_cache_size = 65536;
+
+        /// Destructor. Returns the Lua state to the pool.
+        ~lua_runner() override;
+
       private:
-        std::shared_ptr<lua_State> m_state;
+        struct pooled_state;
+
+        std::shared_ptr<pooled_state> m_pooled;
+        /// Coroutine running the contract.
+        lua_State* m_state{};
+        /// Registry reference keeping the coroutine alive.
+        int m_state_ref{LUA_NOREF};
+
+        static auto acquire_state() -> std::shared_ptr<pooled_state>;
 
         void contract_epilogue(int n_results);
 
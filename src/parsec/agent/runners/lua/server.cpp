@@ -45,36 +45,26 @@ namespace cbdc::parsec::agent::rpc {
                      " and param size ",
                      req.m_param.size());
         auto id = m_next_id++;
-        auto a = [&]() {
-            auto agent = std::make_shared<impl>(
-                m_log,
-                m_cfg,
-                &runner::factory<runner::lua_runner>::create,
-                m_broker,
-                req.m_function,
-                req.m_param,
-                [this, id, callback](interface::exec_return_type res) {
-                    auto success = std::holds_alternative<return_type>(res);
-                    if(!success) {
-                        auto ec = std::get<interface::error_code>(res);
-                        if(ec == interface::error_code::retry) {
-                            m_retry_queue.push(id);
-                            return;
-                        }
+        auto a = make_agent(
+            id,
+            &runner::factory<runner::lua_runner>::create,
+            std::move(req.m_function),
+            std::move(req.m_param),
+            [this, id, callback](interface::exec_return_type res) {
+                auto success = std::holds_alternative<return_type>(res);
+                if(!success) {
+                    auto ec = std::get<interface::error_code>(res);
+                    if(ec == interface::error_code::retry) {
+                        schedule_retry(id);
+                        return;
                     }
-                    callback(res);
-                    m_cleanup_queue.push(id);
-                },
-                runner::lua_runner::initial_lock_type,
-                req.m_is_readonly_run,
-                m_secp,
-                m_threads);
-            {
-                std::unique_lock l(m_agents_mut);
-                m_agents.emplace(id, agent);
-            }
-            return agent;
-        }();
+                }
+                agent_done(id, success);
+                callback(res);
+                release_agent(id);
+            },
+            runner::lua_runner::initial_lock_type,
+            req.m_is_readonly_run);
         return a->exec();
     }
 }
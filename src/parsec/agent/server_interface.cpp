@@ -5,6 +5,7 @@
 
 #include "server_interface.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace cbdc::parsec::agent::rpc {
@@ -14,41 +15,174 @@ namespace cbdc::parsec::agent::rpc {
         const cbdc::parsec::config& cfg)
         : m_broker(std::move(broker)),
           m_log(std::move(log)),
-          m_cfg(cfg) {
+          m_cfg(cfg),
+          m_threads(std::make_shared<thread_pool>(cfg.m_agent_threads,
+                                                  cfg.m_agent_pin_threads)) {
+        if(cfg.m_read_cache_max_age_ms > 0) {
+            m_read_cache = std::make_shared<read_cache>(
+                std::chrono::milliseconds(cfg.m_read_cache_max_age_ms));
+        }
         m_cleanup_thread = std::thread([&]() {
-            size_t id{};
-            while(m_cleanup_queue.pop(id)) {
-                std::unique_lock l(m_agents_mut);
-                m_agents.erase(id);
+            auto ids = std::vector<size_t>();
+            while(m_cleanup_queue.pop_batch(ids, cleanup_batch_size) != 0) {
+                for(auto id : ids) {
+                    auto a = [&]() {
+                        auto& bucket = bucket_for(id);
+                        std::unique_lock l(bucket.m_mut);
+                        auto it = bucket.m_agents.find(id);
+                        assert(it != bucket.m_agents.end());
+                        auto ret = std::move(it->second);
+                        bucket.m_agents.erase(it);
+                        return ret;
+                    }();
+                    // Agents which did not finish cleanly, or do not fit in
+                    // the pool, are destroyed instead
+                    if(a->recycle()) {
+                        [[maybe_unused]] auto pooled
+                            = m_agent_pool.try_push(std::move(a));
+                    }
+                }
+                ids.clear();
             }
         });
         m_retry_thread = std::thread([&]() {
-            size_t id{};
-            while(m_retry_queue.pop(id)) {
-                auto a = [&]() {
-                    std::unique_lock l(m_agents_mut);
-                    auto it = m_agents.find(id);
-                    assert(it != m_agents.end());
-                    return it->second;
-                }();
-                if(!a->exec()) {
-                    m_log->fatal("Error retrying agent");
+            std::unique_lock l(m_retry_mut);
+            while(!m_retry_stop) {
+                if(m_retry_queue.empty()) {
+                    m_retry_cv.wait(l);
+                    continue;
                 }
+                auto [due, id] = m_retry_queue.top();
+                if(std::chrono::steady_clock::now() < due) {
+                    m_retry_cv.wait_until(l, due);
+                    continue;
+                }
+                m_retry_queue.pop();
+                l.unlock();
+                retry(id);
+                l.lock();
             }
         });
     }
 
     server_interface::~server_interface() {
-        m_retry_queue.clear();
+        {
+            std::unique_lock l(m_retry_mut);
+            m_retry_stop = true;
+        }
+        m_retry_cv.notify_one();
         m_retry_thread.join();
         m_log->trace("Stopped retry thread");
+        auto stats = get_retry_stats();
+        m_log->info("Agents committed:",
+                    stats.m_committed,
+                    "retries:",
+                    stats.m_retries);
         m_cleanup_queue.clear();
         m_cleanup_thread.join();
         m_log->trace("Stopped runner cleanup thread");
-        {
-            std::unique_lock l(m_agents_mut);
-            m_agents.clear();
+        for(auto& bucket : m_agent_buckets) {
+            std::unique_lock l(bucket.m_mut);
+            bucket.m_agents.clear();
         }
+        m_agent_pool.clear();
         m_log->trace("Cleaned up all runners");
     }
+
+    auto server_interface::get_retry_stats() const -> retry_stats {
+        return {m_committed, m_retries};
+    }
+
+    void server_interface::schedule_retry(size_t id) {
+        m_retries++;
+        // Let agents waiting on the keys of this attempt go ahead
+        m_retry_scheduler.release(id);
+
+        {
+            std::unique_lock l(m_retry_mut);
+            auto attempt = m_retry_counts[id]++;
+            static constexpr size_t max_doublings = 16;
+            auto backoff = initial_retry_backoff
+                         * (int64_t{1} << std::min(attempt, max_doublings));
+            auto bound = std::min<std::chrono::microseconds>(
+                backoff,
+                max_retry_backoff);
+            auto delay_dist
+                = std::uniform_int_distribution<int64_t>(0, bound.count());
+            auto delay = std::chrono::microseconds(delay_dist(m_retry_rng));
+            m_retry_queue.emplace(std::chrono::steady_clock::now() + delay,
+                                  id);
+        }
+        m_retry_cv.notify_one();
+    }
+
+    void server_interface::retry(size_t id) {
+        auto a = [&]() {
+            auto& bucket = bucket_for(id);
+            std::unique_lock l(bucket.m_mut);
+            auto it = bucket.m_agents.find(id);
+            assert(it != bucket.m_agents.end());
+            return it->second;
+        }();
+        m_retry_scheduler.submit(id, a->get_write_keys(), [this, a]() {
+            if(!a->exec()) {
+                m_log->fatal("Error retrying agent");
+            }
+        });
+    }
+
+    void server_interface::agent_done(size_t id, bool success) {
+        if(success) {
+            m_committed++;
+        }
+        {
+            std::unique_lock l(m_retry_mut);
+            m_retry_counts.erase(id);
+        }
+        m_retry_scheduler.release(id);
+        m_scheduler.release(id);
+    }
+
+    auto server_interface::make_agent(
+        size_t id,
+        runner::interface::factory_type runner_factory,
+        runtime_locking_shard::key_type function,
+        parameter_type param,
+        interface::exec_callback_type result_callback,
+        broker::lock_type initial_lock_type,
+        bool is_readonly_run) -> std::shared_ptr<agent::impl> {
+        auto a = std::shared_ptr<agent::impl>();
+        if(m_agent_pool.try_pop(a)) {
+            a->reuse(std::move(function),
+                     std::move(param),
+                     std::move(result_callback),
+                     initial_lock_type,
+                     is_readonly_run);
+        } else {
+            a = std::make_shared<agent::impl>(m_log,
+                                              m_cfg,
+                                              std::move(runner_factory),
+                                              m_broker,
+                                              std::move(function),
+                                              std::move(param),
+                                              std::move(result_callback),
+                                              initial_lock_type,
+                                              is_readonly_run,
+                                              m_secp,
+                                              m_threads,
+                                              m_read_cache);
+        }
+        auto& bucket = bucket_for(id);
+        std::unique_lock l(bucket.m_mut);
+        bucket.m_agents.emplace(id, a);
+        return a;
+    }
+
+    void server_interface::release_agent(size_t id) {
+        m_cleanup_queue.push(id);
+    }
+
+    auto server_interface::bucket_for(size_t id) -> agent_bucket& {
+        return m_agent_buckets[id % agent_bucket_count];
+    }
 }
@@ -6,16 +6,24 @@
 #ifndef OPENCBDC_TX_SRC_PARSEC_AGENT_SERVER_INTERFACE_H_
 #define OPENCBDC_TX_SRC_PARSEC_AGENT_SERVER_INTERFACE_H_
 
+#include "conflict_scheduler.hpp"
 #include "interface.hpp"
 #include "messages.hpp"
 #include "parsec/agent/impl.hpp"
 #include "parsec/broker/interface.hpp"
 #include "parsec/directory/interface.hpp"
-#include "util/common/blocking_queue.hpp"
+#include "read_cache.hpp"
+#include "util/common/keys.hpp"
+#include "util/common/mpmc_queue.hpp"
 #include "util/common/thread_pool.hpp"
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <queue>
+#include <random>
 #include <secp256k1.h>
 #include <thread>
 
@@ -39,6 +47,20 @@ namespace cbdc::parsec::agent::rpc {
         /// Initializes the server, starts processing requests.
         virtual auto init() -> bool = 0;
 
+        /// Counters of agent outcomes since the server started.
+        struct retry_stats {
+            /// Agents which completed successfully.
+            uint64_t m_committed{};
+            /// Retries after transient failures, almost all of which are
+            /// wounds.
+            uint64_t m_retries{};
+        };
+
+        /// Returns the retry counters. m_retries / m_committed is the
+        /// number of wounds per committed transaction.
+        /// \return retry counters.
+        [[nodiscard]] auto get_retry_stats() const -> retry_stats;
+
         server_interface(const server_interface&) = delete;
         auto operator=(const server_interface&) -> server_interface& = delete;
         server_interface(server_interface&&) = delete;
@@ -52,23 +74,121 @@ namespace cbdc::parsec::agent::rpc {
         std::shared_ptr<logging::log> m_log;
         const cbdc::parsec::config& m_cfg;
 
-        mutable std::mutex m_agents_mut;
         std::atomic<size_t> m_next_id{};
-        std::unordered_map<size_t, std::shared_ptr<agent::impl>> m_agents;
 
-        blocking_queue<size_t> m_cleanup_queue;
+        /// Number of independently locked partitions of the running agents.
+        static constexpr size_t agent_bucket_count = 64;
+
+        /// Partition of the running agents, holding the agents whose ID
+        /// modulo agent_bucket_count is the bucket's index.
+        struct agent_bucket {
+            std::mutex m_mut;
+            std::unordered_map<size_t, std::shared_ptr<agent::impl>>
+                m_agents;
+        };
+
+        std::array<agent_bucket, agent_bucket_count> m_agent_buckets;
+
+        /// Maximum number of finished agents kept for reuse.
+        static constexpr size_t agent_pool_size = 1024;
+        /// Finished agents, recycled and ready to execute another request.
+        mpmc_queue<std::shared_ptr<agent::impl>> m_agent_pool{
+            agent_pool_size};
+
+        /// Capacity of the queue of finished agent IDs.
+        static constexpr size_t cleanup_queue_size = size_t{1} << 16;
+        /// Maximum number of finished agents cleaned up per wake-up.
+        static constexpr size_t cleanup_batch_size = 256;
+        /// IDs of agents which have finished, drained by the cleanup
+        /// thread.
+        mpmc_queue<size_t> m_cleanup_queue{cleanup_queue_size};
         std::thread m_cleanup_thread;
 
-        blocking_priority_queue<size_t, std::greater<>> m_retry_queue;
+        /// Delay before the first retry of an agent. Each further retry
+        /// doubles the delay, up to max_retry_backoff, and the actual delay
+        /// is drawn uniformly from zero up to that bound.
+        static constexpr auto initial_retry_backoff
+            = std::chrono::microseconds(500);
+        /// Upper bound on the delay before retrying an agent.
+        static constexpr auto max_retry_backoff
+            = std::chrono::milliseconds(50);
+
+        using retry_entry_type
+            = std::pair<std::chrono::steady_clock::time_point, size_t>;
+
+        std::mutex m_retry_mut;
+        std::condition_variable m_retry_cv;
+        bool m_retry_stop{false};
+        /// Agents waiting for their backoff to expire, earliest first.
+        std::priority_queue<retry_entry_type,
+                            std::vector<retry_entry_type>,
+                            std::greater<>>
+            m_retry_queue;
+        /// Number of times each agent has been retried.
+        std::unordered_map<size_t, size_t> m_retry_counts;
+        std::default_random_engine m_retry_rng{std::random_device{}()};
         std::thread m_retry_thread;
 
-        std::shared_ptr<thread_pool> m_threads{
-            std::make_shared<thread_pool>()};
+        /// Serializes retries of agents wounded on the same keys.
+        conflict_scheduler m_retry_scheduler;
+
+        std::atomic<uint64_t> m_committed{};
+        std::atomic<uint64_t> m_retries{};
+
+        std::shared_ptr<thread_pool> m_threads;
+
+        /// Orders the execution of transactions predicted to conflict.
+        conflict_scheduler m_scheduler;
+
+        /// Serves the reads of read-only runs, or nullptr if disabled.
+        std::shared_ptr<read_cache> m_read_cache;
+
+        /// Schedules an agent to be retried after a transient failure,
+        /// usually a wound. The retry waits for a jittered exponential
+        /// backoff, then for any retrying agent which wrote the same keys
+        /// to finish its attempt, so agents contending for a hot key retry
+        /// one at a time instead of wounding each other again.
+        /// \param id agent ID.
+        void schedule_retry(size_t id);
+
+        /// Records that an agent has finished for good, releasing the keys
+        /// it holds in the schedulers.
+        /// \param id agent ID.
+        /// \param success true if the agent completed successfully.
+        void agent_done(size_t id, bool success);
+
+        void retry(size_t id);
+
+        /// Returns an agent set up to execute the given request and
+        /// registers it under the given ID. Reuses a pooled agent if there
+        /// is one, otherwise constructs a new agent.
+        /// \param id agent ID.
+        /// \param runner_factory function which constructs the runner.
+        /// \param function key containing function bytecode.
+        /// \param param function parameter.
+        /// \param result_callback function to call with function execution
+        ///                        result.
+        /// \param initial_lock_type type of lock to acquire on initial
+        ///                          function code.
+        /// \param is_readonly_run true if the agent should skip writing
+        ///                        state changes.
+        /// \return the agent.
+        auto make_agent(size_t id,
+                        runner::interface::factory_type runner_factory,
+                        runtime_locking_shard::key_type function,
+                        parameter_type param,
+                        interface::exec_callback_type result_callback,
+                        broker::lock_type initial_lock_type,
+                        bool is_readonly_run) -> std::shared_ptr<agent::impl>;
+
+        /// Queues a finished agent to be unregistered and returned to the
+        /// pool by the cleanup thread.
+        /// \param id agent ID.
+        void release_agent(size_t id);
+
+        auto bucket_for(size_t id) -> agent_bucket&;
 
-        std::shared_ptr<secp256k1_context> m_secp{
-            secp256k1_context_create(SECP256K1_CONTEXT_SIGN
-                                     | SECP256K1_CONTEXT_VERIFY),
-            &secp256k1_context_destroy};
+        std::shared_ptr<secp256k1_context> m_secp{secp_context()};
     };
 }
 
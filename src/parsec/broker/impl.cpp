@@ -7,6 +7,7 @@
 
 #include "util/common/variant_overloaded.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace cbdc::parsec::broker {
@@ -23,48 +24,147 @@ namespace cbdc::parsec::broker {
           m_log(std::move(logger)) {}
 
     auto impl::begin(begin_callback_type result_callback) -> bool {
-        if(!m_ticketer->get_ticket_number(
-               [this, result_callback](
-                   std::optional<parsec::ticket_machine::interface::
-                                     get_ticket_number_return_type> res) {
-                   handle_ticket_number(result_callback, res);
-               })) {
-            m_log->error("Failed to request a ticket number");
-            result_callback(error_code::ticket_machine_unreachable);
+        auto ticket_number = std::optional<ticket_number_type>();
+        auto fetch = false;
+        {
+            std::unique_lock l(m_mut);
+            ticket_number = take_leased_ticket();
+            if(!ticket_number.has_value()) {
+                m_begin_callbacks.push(std::move(result_callback));
+            }
+            // Lease the next range before this one runs out
+            if(!m_fetching_tickets
+               && (!m_begin_callbacks.empty()
+                   || m_leased_count <= m_lease_size / 2)) {
+                m_fetching_tickets = true;
+                fetch = true;
+            }
+        }
+
+        if(fetch) {
+            fetch_ticket_range();
+        }
+
+        if(ticket_number.has_value()) {
+            result_callback(ticket_number.value());
         }
 
         return true;
     }
 
-    void impl::handle_ticket_number(
-        begin_callback_type result_callback,
+    auto impl::take_leased_ticket() -> std::optional<ticket_number_type> {
+        if(m_leases.empty()) {
+            return std::nullopt;
+        }
+        auto& range = m_leases.front();
+        auto ticket_number = range.first++;
+        if(range.first == range.second) {
+            m_leases.pop_front();
+        }
+        m_leased_count--;
+        if(m_highest_ticket < ticket_number) {
+            m_highest_ticket = ticket_number;
+        }
+        auto& bucket = bucket_for(ticket_number);
+        std::unique_lock l(bucket.m_mut);
+        bucket.m_tickets.emplace(
+            ticket_number,
+            std::make_shared<state>(state{ticket_state::begun, {}}));
+        return ticket_number;
+    }
+
+    auto impl::bucket_for(ticket_number_type ticket_number)
+        -> ticket_bucket& {
+        return m_buckets[ticket_number % ticket_bucket_count];
+    }
+
+    auto impl::has_tickets() -> bool {
+        for(auto& bucket : m_buckets) {
+            std::unique_lock l(bucket.m_mut);
+            if(!bucket.m_tickets.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void impl::fetch_ticket_range() {
+        if(!m_ticketer->get_ticket_number(
+               [this](std::optional<parsec::ticket_machine::interface::
+                                        get_ticket_number_return_type> res) {
+                   handle_ticket_range(res);
+               })) {
+            m_log->error("Failed to request a ticket number range");
+            fail_begin_callbacks(error_code::ticket_machine_unreachable);
+        }
+    }
+
+    void impl::handle_ticket_range(
         std::optional<
             parsec::ticket_machine::interface::get_ticket_number_return_type>
             res) {
-        if(!res.has_value()) {
-            result_callback(error_code::ticket_number_assignment);
+        if(!res.has_value()
+           || !std::holds_alternative<
+               parsec::ticket_machine::interface::ticket_number_range_type>(
+               res.value())) {
+            fail_begin_callbacks(error_code::ticket_number_assignment);
             return;
         }
-        std::visit(overloaded{[&](const parsec::ticket_machine::interface::
-                                      ticket_number_range_type& n) {
-                                  {
-                                      std::unique_lock l(m_mut);
-                                      if(m_highest_ticket < n.second) {
-                                          m_highest_ticket = n.second;
-                                      }
-                                      m_tickets.emplace(
-                                          n.first,
-                                          std::make_shared<state>(
-                                              state{ticket_state::begun, {}}));
-                                  }
-                                  result_callback(n.first);
-                              },
-                              [&](const parsec::ticket_machine::interface::
-                                      error_code& /* e */) {
-                                  result_callback(
-                                      error_code::ticket_number_assignment);
-                              }},
-                   res.value());
+        auto range = std::get<
+            parsec::ticket_machine::interface::ticket_number_range_type>(
+            res.value());
+        if(range.second <= range.first) {
+            m_log->error("Ticket machine returned an empty range");
+            fail_begin_callbacks(error_code::ticket_number_assignment);
+            return;
+        }
+
+        auto assigned = std::vector<
+            std::pair<begin_callback_type, ticket_number_type>>();
+        auto fetch = false;
+        {
+            std::unique_lock l(m_mut);
+            m_fetching_tickets = false;
+            m_lease_size = range.second - range.first;
+            m_leased_count += m_lease_size;
+            m_leases.push_back(range);
+            while(!m_begin_callbacks.empty()) {
+                auto ticket_number = take_leased_ticket();
+                if(!ticket_number.has_value()) {
+                    break;
+                }
+                assigned.emplace_back(std::move(m_begin_callbacks.front()),
+                                      ticket_number.value());
+                m_begin_callbacks.pop();
+            }
+            // Only fetch again if the range was too small for the waiting
+            // calls. Otherwise the next begin call prefetches.
+            if(!m_begin_callbacks.empty()) {
+                m_fetching_tickets = true;
+                fetch = true;
+            }
+        }
+
+        if(fetch) {
+            fetch_ticket_range();
+        }
+
+        for(auto& [cb, ticket_number] : assigned) {
+            cb(ticket_number);
+        }
+    }
+
+    void impl::fail_begin_callbacks(error_code err) {
+        auto callbacks = decltype(m_begin_callbacks)();
+        {
+            std::unique_lock l(m_mut);
+            m_fetching_tickets = false;
+            callbacks.swap(m_begin_callbacks);
+        }
+        while(!callbacks.empty()) {
+            callbacks.front()(err);
+            callbacks.pop();
+        }
     }
 
     auto impl::highest_ticket() -> ticket_number_type {
@@ -82,9 +182,10 @@ namespace cbdc::parsec::broker {
             overloaded{
                 [&](parsec::runtime_locking_shard::value_type v)
                     -> try_lock_return_type {
-                    std::unique_lock l(m_mut);
-                    auto it = m_tickets.find(ticket_number);
-                    if(it == m_tickets.end()) {
+                    auto& bucket = bucket_for(ticket_number);
+                    std::unique_lock l(bucket.m_mut);
+                    auto it = bucket.m_tickets.find(ticket_number);
+                    if(it == bucket.m_tickets.end()) {
                         return error_code::unknown_ticket;
                     }
 
@@ -134,25 +235,8 @@ namespace cbdc::parsec::broker {
                         lock_type locktype,
                         try_lock_callback_type result_callback) -> bool {
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
-                return error_code::unknown_ticket;
-            }
-
-            auto t_state = it->second;
-            switch(t_state->m_state) {
-                case ticket_state::begun:
-                    break;
-                case ticket_state::prepared:
-                    return error_code::prepared;
-                case ticket_state::committed:
-                    return error_code::committed;
-                case ticket_state::aborted:
-                    t_state->m_state = ticket_state::begun;
-                    t_state->m_shard_states.clear();
-                    m_log->trace(this, "broker restarting", ticket_number);
-                    break;
+            if(auto err = check_lockable(ticket_number); err.has_value()) {
+                return err;
             }
 
             if(!m_directory->key_location(
@@ -180,15 +264,622 @@ namespace cbdc::parsec::broker {
         return true;
     }
 
+    auto impl::check_lockable(ticket_number_type ticket_number)
+        -> std::optional<error_code> {
+        auto& bucket = bucket_for(ticket_number);
+        std::unique_lock l(bucket.m_mut);
+        auto it = bucket.m_tickets.find(ticket_number);
+        if(it == bucket.m_tickets.end()) {
+            return error_code::unknown_ticket;
+        }
+
+        auto t_state = it->second;
+        switch(t_state->m_state) {
+            case ticket_state::begun:
+                break;
+            case ticket_state::prepared:
+                return error_code::prepared;
+            case ticket_state::committed:
+                return error_code::committed;
+            case ticket_state::aborted:
+                t_state->m_state = ticket_state::begun;
+                t_state->m_shard_states.clear();
+                m_log->trace(this, "broker restarting", ticket_number);
+                break;
+        }
+
+        return std::nullopt;
+    }
+
+    auto impl::try_lock_batch(ticket_number_type ticket_number,
+                              std::vector<lock_request_type> locks,
+                              try_lock_batch_callback_type result_callback)
+        -> bool {
+        auto maybe_result = [&]() -> std::optional<try_lock_batch_return_type> {
+            if(auto err = check_lockable(ticket_number); err.has_value()) {
+                return err.value();
+            }
+
+            if(locks.empty()) {
+                return std::vector<value_type>();
+            }
+
+            auto batch = std::make_shared<batch_lock_state>();
+            batch->m_shard_idxs.resize(locks.size());
+            batch->m_values.resize(locks.size());
+            batch->m_pending_locations = locks.size();
+            batch->m_locks = std::move(locks);
+            batch->m_callback = result_callback;
+
+            for(size_t i{0}; i < batch->m_locks.size(); i++) {
+                if(!m_directory->key_location(
+                       batch->m_locks[i].first,
+                       [=](std::optional<parsec::directory::interface::
+                                             key_location_return_type> res) {
+                           handle_batch_find_key(ticket_number, batch, i, res);
+                       })) {
+                    m_log->error(
+                        "Failed to make key location directory request");
+                    // The batch cannot complete without this location, so
+                    // responses to earlier requests are ignored.
+                    return error_code::directory_unreachable;
+                }
+            }
+
+            return std::nullopt;
+        }();
+
+        if(maybe_result.has_value()) {
+            result_callback(std::move(maybe_result.value()));
+        }
+
+        return true;
+    }
+
+    void impl::handle_batch_find_key(
+        ticket_number_type ticket_number,
+        const std::shared_ptr<batch_lock_state>& batch,
+        size_t idx,
+        std::optional<parsec::directory::interface::key_location_return_type>
+            res) {
+        // The batch is protected by the mutex of the ticket's bucket
+        auto& bucket = bucket_for(ticket_number);
+        auto requests = shard_requests_type();
+        auto issued = false;
+        auto maybe_result = [&]() -> std::optional<try_lock_batch_return_type> {
+            std::unique_lock l(bucket.m_mut);
+            if(!res.has_value()) {
+                if(!batch->m_error.has_value()) {
+                    batch->m_error = error_code::directory_unreachable;
+                }
+            } else {
+                assert(res.value() < m_shards.size());
+                batch->m_shard_idxs[idx] = res.value();
+            }
+
+            if(--batch->m_pending_locations != 0) {
+                return std::nullopt;
+            }
+
+            if(batch->m_error.has_value()) {
+                return batch->m_error;
+            }
+
+            auto err = do_try_lock_batch(ticket_number, batch, requests);
+            issued = !err.has_value();
+            return err;
+        }();
+
+        if(issued) {
+            for(auto& request : requests) {
+                if(!request()) {
+                    std::unique_lock l(bucket.m_mut);
+                    if(!batch->m_error.has_value()) {
+                        batch->m_error = error_code::shard_unreachable;
+                    }
+                    batch->m_pending_shards--;
+                }
+            }
+            maybe_result = [&]() {
+                std::unique_lock l(bucket.m_mut);
+                return complete_batch_lock(*batch);
+            }();
+        }
+
+        if(maybe_result.has_value()) {
+            batch->m_callback(std::move(maybe_result.value()));
+        }
+    }
+
+    auto impl::do_try_lock_batch(ticket_number_type ticket_number,
+                                 const std::shared_ptr<batch_lock_state>& batch,
+                                 shard_requests_type& requests)
+        -> std::optional<try_lock_batch_return_type> {
+        auto& bucket = bucket_for(ticket_number);
+        auto ticket = bucket.m_tickets.find(ticket_number);
+        if(ticket == bucket.m_tickets.end()) {
+            m_log->error("Unknown ticket number");
+            return error_code::unknown_ticket;
+        }
+
+        auto tss = ticket->second;
+        switch(tss->m_state) {
+            case ticket_state::begun:
+                break;
+            case ticket_state::prepared:
+                return error_code::prepared;
+            case ticket_state::committed:
+                return error_code::committed;
+            case ticket_state::aborted:
+                return error_code::aborted;
+        }
+
+        // Group the keys by shard. Keys already locked by the ticket are
+        // answered from the broker's state, and keys requested more than
+        // once are locked once with the strongest lock type requested.
+        struct shard_request {
+            std::vector<lock_request_type> m_locks;
+            std::vector<std::vector<size_t>> m_idxs;
+            std::unordered_map<key_type,
+                               size_t,
+                               hashing::const_sip_hash<key_type>>
+                m_positions;
+        };
+        auto shard_reqs = std::unordered_map<uint64_t, shard_request>();
+        for(size_t i{0}; i < batch->m_locks.size(); i++) {
+            const auto& [key, locktype] = batch->m_locks[i];
+            auto shard_idx = batch->m_shard_idxs[i];
+            auto& ss = tss->m_shard_states[shard_idx];
+            auto it = ss.m_key_states.find(key);
+            if(it != ss.m_key_states.end()
+               && it->second.m_key_state == key_state::locked
+               && it->second.m_locktype >= locktype) {
+                assert(it->second.m_value.has_value());
+                batch->m_values[i] = it->second.m_value.value();
+                continue;
+            }
+
+            auto& req = shard_reqs[shard_idx];
+            auto [pos, inserted]
+                = req.m_positions.try_emplace(key, req.m_locks.size());
+            if(inserted) {
+                req.m_locks.emplace_back(key, locktype);
+                req.m_idxs.emplace_back();
+            } else if(req.m_locks[pos->second].second < locktype) {
+                req.m_locks[pos->second].second = locktype;
+            }
+            req.m_idxs[pos->second].push_back(i);
+        }
+
+        // Hold one pending count while issuing the requests so that shards
+        // responding immediately cannot complete the batch early.
+        batch->m_pending_shards = shard_reqs.size() + 1;
+        for(auto& [shard_idx, req] : shard_reqs) {
+            auto& ss = tss->m_shard_states[shard_idx];
+            auto first_lock = ss.m_key_states.empty();
+            for(const auto& [key, locktype] : req.m_locks) {
+                auto& ks = ss.m_key_states[key];
+                ks.m_key_state = key_state::locking;
+                ks.m_locktype = locktype;
+            }
+
+            requests.emplace_back(
+                [=,
+                 sidx = shard_idx,
+                 locks = std::move(req.m_locks),
+                 idxs = std::move(req.m_idxs)]() {
+                    auto res = m_shards[sidx]->try_lock_batch(
+                        ticket_number,
+                        m_broker_id,
+                        locks,
+                        first_lock,
+                        [=](const parsec::runtime_locking_shard::interface::
+                                try_lock_batch_return_type& lock_res) {
+                            handle_batch_lock(ticket_number,
+                                              batch,
+                                              sidx,
+                                              locks,
+                                              idxs,
+                                              lock_res);
+                        });
+                    if(!res) {
+                        m_log->error(
+                            "Failed to make try_lock_batch shard request");
+                    }
+                    return res;
+                });
+        }
+
+        return std::nullopt;
+    }
+
+    void impl::handle_batch_lock(
+        ticket_number_type ticket_number,
+        const std::shared_ptr<batch_lock_state>& batch,
+        uint64_t shard_idx,
+        const std::vector<lock_request_type>& locks,
+        const std::vector<std::vector<size_t>>& idxs,
+        const parsec::runtime_locking_shard::interface::
+            try_lock_batch_return_type& res) {
+        auto& bucket = bucket_for(ticket_number);
+        auto maybe_result = [&]() -> std::optional<try_lock_batch_return_type> {
+            std::unique_lock l(bucket.m_mut);
+            auto maybe_error = std::visit(
+                overloaded{
+                    [&](const std::vector<value_type>& vals)
+                        -> std::optional<try_lock_batch_return_type> {
+                        assert(vals.size() == locks.size());
+                        auto it = bucket.m_tickets.find(ticket_number);
+                        if(it == bucket.m_tickets.end()) {
+                            return error_code::unknown_ticket;
+                        }
+
+                        auto& s_state = it->second->m_shard_states[shard_idx];
+                        for(size_t j{0}; j < locks.size(); j++) {
+                            auto k_it
+                                = s_state.m_key_states.find(locks[j].first);
+                            if(k_it == s_state.m_key_states.end()
+                               || k_it->second.m_key_state
+                                      != key_state::locking) {
+                                m_log->error("Shard state not locking");
+                                return error_code::invalid_shard_state;
+                            }
+
+                            k_it->second.m_key_state = key_state::locked;
+                            k_it->second.m_value = vals[j];
+                            for(auto idx : idxs[j]) {
+                                batch->m_values[idx] = vals[j];
+                            }
+                        }
+
+                        m_log->trace(this,
+                                     "Broker locked",
+                                     locks.size(),
+                                     "keys for",
+                                     ticket_number);
+                        return std::nullopt;
+                    },
+                    [&](const parsec::runtime_locking_shard::shard_error& e)
+                        -> std::optional<try_lock_batch_return_type> {
+                        m_log->trace(this,
+                                     "Shard error",
+                                     static_cast<int>(e.m_error_code),
+                                     "locking keys for",
+                                     ticket_number);
+                        return e;
+                    }},
+                res);
+
+            if(maybe_error.has_value() && !batch->m_error.has_value()) {
+                batch->m_error = std::move(maybe_error);
+            }
+
+            return complete_batch_lock(*batch);
+        }();
+
+        if(maybe_result.has_value()) {
+            batch->m_callback(std::move(maybe_result.value()));
+        }
+    }
+
+    auto impl::complete_batch_lock(batch_lock_state& batch)
+        -> std::optional<try_lock_batch_return_type> {
+        if(--batch.m_pending_shards != 0) {
+            return std::nullopt;
+        }
+
+        if(batch.m_error.has_value()) {
+            return batch.m_error;
+        }
+
+        return std::move(batch.m_values);
+    }
+
+    auto impl::read(std::vector<key_type> keys,
+                    read_callback_type result_callback) -> bool {
+        if(keys.empty()) {
+            result_callback(
+                std::vector<runtime_locking_shard::committed_value>());
+            return true;
+        }
+
+        auto state = std::make_shared<read_state>();
+        state->m_shard_idxs.resize(keys.size());
+        state->m_values.resize(keys.size());
+        state->m_pending_locations = keys.size();
+        state->m_keys = std::move(keys);
+        state->m_callback = std::move(result_callback);
+
+        for(size_t i{0}; i < state->m_keys.size(); i++) {
+            if(!m_directory->key_location(
+                   state->m_keys[i],
+                   [=](std::optional<parsec::directory::interface::
+                                         key_location_return_type> res) {
+                       handle_read_find_key(state, i, res);
+                   })) {
+                m_log->error("Failed to make key location directory request");
+                // Hold back the result until the locations already
+                // requested have been returned
+                auto maybe_result = [&]() -> std::optional<read_return_type> {
+                    std::unique_lock l(state->m_mut);
+                    state->m_error = error_code::directory_unreachable;
+                    state->m_pending_locations -= state->m_keys.size() - i;
+                    if(state->m_pending_locations != 0) {
+                        return std::nullopt;
+                    }
+                    return state->m_error.value();
+                }();
+                if(maybe_result.has_value()) {
+                    state->m_callback(std::move(maybe_result.value()));
+                }
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void impl::handle_read_find_key(
+        const std::shared_ptr<read_state>& state,
+        size_t idx,
+        std::optional<parsec::directory::interface::key_location_return_type>
+            res) {
+        auto last = false;
+        auto maybe_error = [&]() -> std::optional<error_code> {
+            std::unique_lock l(state->m_mut);
+            if(!res.has_value()) {
+                if(!state->m_error.has_value()) {
+                    state->m_error = error_code::directory_unreachable;
+                }
+            } else {
+                assert(res.value() < m_shards.size());
+                state->m_shard_idxs[idx] = res.value();
+            }
+
+            if(--state->m_pending_locations != 0) {
+                return std::nullopt;
+            }
+            last = true;
+            return state->m_error;
+        }();
+
+        if(maybe_error.has_value()) {
+            state->m_callback(maybe_error.value());
+        } else if(last) {
+            do_read(state);
+        }
+    }
+
+    void impl::do_read(const std::shared_ptr<read_state>& state) {
+        // Group the keys by shard, reading keys requested more than once
+        // a single time
+        struct shard_request {
+            std::vector<key_type> m_keys;
+            std::vector<std::vector<size_t>> m_idxs;
+            std::unordered_map<key_type,
+                               size_t,
+                               hashing::const_sip_hash<key_type>>
+                m_positions;
+        };
+        auto requests = std::unordered_map<uint64_t, shard_request>();
+        for(size_t i{0}; i < state->m_keys.size(); i++) {
+            const auto& key = state->m_keys[i];
+            auto& req = requests[state->m_shard_idxs[i]];
+            auto [pos, inserted]
+                = req.m_positions.try_emplace(key, req.m_keys.size());
+            if(inserted) {
+                req.m_keys.push_back(key);
+                req.m_idxs.emplace_back();
+            }
+            req.m_idxs[pos->second].push_back(i);
+        }
+
+        // Hold one pending count while issuing the requests so that shards
+        // responding immediately cannot complete the read early.
+        {
+            std::unique_lock l(state->m_mut);
+            state->m_pending_shards = requests.size() + 1;
+        }
+        for(auto& [shard_idx, req] : requests) {
+            if(!m_shards[shard_idx]->read(
+                   req.m_keys,
+                   [state, idxs = std::move(req.m_idxs)](
+                       parsec::runtime_locking_shard::interface::
+                           read_return_type read_res) {
+                       handle_read(state, idxs, std::move(read_res));
+                   })) {
+                m_log->error("Failed to make read shard request");
+                std::unique_lock l(state->m_mut);
+                if(!state->m_error.has_value()) {
+                    state->m_error = error_code::shard_unreachable;
+                }
+                state->m_pending_shards--;
+            }
+        }
+
+        auto maybe_result = [&]() {
+            std::unique_lock l(state->m_mut);
+            return complete_read(*state);
+        }();
+        if(maybe_result.has_value()) {
+            state->m_callback(std::move(maybe_result.value()));
+        }
+    }
+
+    void impl::handle_read(
+        const std::shared_ptr<read_state>& state,
+        const std::vector<std::vector<size_t>>& idxs,
+        parsec::runtime_locking_shard::interface::read_return_type res) {
+        auto maybe_result = [&]() {
+            std::unique_lock l(state->m_mut);
+            assert(res.size() == idxs.size());
+            for(size_t j{0}; j < res.size(); j++) {
+                for(auto idx : idxs[j]) {
+                    state->m_values[idx] = res[j];
+                }
+            }
+            return complete_read(*state);
+        }();
+        if(maybe_result.has_value()) {
+            state->m_callback(std::move(maybe_result.value()));
+        }
+    }
+
+    auto impl::complete_read(read_state& state)
+        -> std::optional<read_return_type> {
+        if(--state.m_pending_shards != 0) {
+            return std::nullopt;
+        }
+
+        if(state.m_error.has_value()) {
+            return state.m_error.value();
+        }
+
+        return std::move(state.m_values);
+    }
+
+    auto impl::load(state_update_type state,
+                    load_callback_type result_callback) -> bool {
+        if(state.empty()) {
+            result_callback(std::nullopt);
+            return true;
+        }
+
+        auto ls = std::make_shared<load_state>();
+        ls->m_entries.reserve(state.size());
+        for(auto& [k, v] : state) {
+            ls->m_entries.emplace_back(k, std::move(v));
+        }
+        ls->m_shard_idxs.resize(ls->m_entries.size());
+        ls->m_pending_locations = ls->m_entries.size();
+        ls->m_callback = std::move(result_callback);
+
+        for(size_t i{0}; i < ls->m_entries.size(); i++) {
+            if(!m_directory->key_location(
+                   ls->m_entries[i].first,
+                   [=](std::optional<parsec::directory::interface::
+                                         key_location_return_type> res) {
+                       handle_load_find_key(ls, i, res);
+                   })) {
+                m_log->error("Failed to make key location directory request");
+                // Hold back the result until the locations already
+                // requested have been returned
+                auto done = [&]() {
+                    std::unique_lock l(ls->m_mut);
+                    ls->m_error = error_code::directory_unreachable;
+                    ls->m_pending_locations -= ls->m_entries.size() - i;
+                    return ls->m_pending_locations == 0;
+                }();
+                if(done) {
+                    ls->m_callback(ls->m_error);
+                }
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void impl::handle_load_find_key(
+        const std::shared_ptr<load_state>& state,
+        size_t idx,
+        std::optional<parsec::directory::interface::key_location_return_type>
+            res) {
+        auto maybe_error = std::optional<error_code>();
+        auto last = [&]() {
+            std::unique_lock l(state->m_mut);
+            if(!res.has_value()) {
+                if(!state->m_error.has_value()) {
+                    state->m_error = error_code::directory_unreachable;
+                }
+            } else {
+                assert(res.value() < m_shards.size());
+                state->m_shard_idxs[idx] = res.value();
+            }
+            maybe_error = state->m_error;
+            return --state->m_pending_locations == 0;
+        }();
+
+        if(!last) {
+            return;
+        }
+        if(maybe_error.has_value()) {
+            state->m_callback(maybe_error);
+            return;
+        }
+        do_load(state);
+    }
+
+    void impl::do_load(const std::shared_ptr<load_state>& state) {
+        auto requests = std::unordered_map<uint64_t, state_update_type>();
+        for(size_t i{0}; i < state->m_entries.size(); i++) {
+            auto& [k, v] = state->m_entries[i];
+            requests[state->m_shard_idxs[i]].insert_or_assign(std::move(k),
+                                                              std::move(v));
+        }
+        state->m_entries.clear();
+
+        // Hold one pending count while issuing the requests so that shards
+        // responding immediately cannot complete the load early.
+        {
+            std::unique_lock l(state->m_mut);
+            state->m_pending_shards = requests.size() + 1;
+        }
+        for(auto& [shard_idx, req] : requests) {
+            if(!m_shards[shard_idx]->load(
+                   std::move(req),
+                   [state](parsec::runtime_locking_shard::interface::
+                               load_return_type load_res) {
+                       handle_load(state, load_res);
+                   })) {
+                m_log->error("Failed to make load shard request");
+                std::unique_lock l(state->m_mut);
+                if(!state->m_error.has_value()) {
+                    state->m_error = error_code::shard_unreachable;
+                }
+                state->m_pending_shards--;
+            }
+        }
+
+        auto done = [&]() {
+            std::unique_lock l(state->m_mut);
+            return complete_load(*state);
+        }();
+        if(done) {
+            state->m_callback(state->m_error);
+        }
+    }
+
+    void impl::handle_load(
+        const std::shared_ptr<load_state>& state,
+        parsec::runtime_locking_shard::interface::load_return_type res) {
+        auto done = [&]() {
+            std::unique_lock l(state->m_mut);
+            if(res.has_value() && !state->m_error.has_value()) {
+                state->m_error = error_code::load_error;
+            }
+            return complete_load(*state);
+        }();
+        if(done) {
+            state->m_callback(state->m_error);
+        }
+    }
+
+    auto impl::complete_load(load_state& state) -> bool {
+        return --state.m_pending_shards == 0;
+    }
+
     void impl::handle_prepare(
         const commit_callback_type& commit_cb,
         ticket_number_type ticket_number,
         uint64_t shard_idx,
         parsec::runtime_locking_shard::interface::prepare_return_type res) {
+        auto requests = shard_requests_type();
         auto maybe_error = [&]() -> std::optional<commit_return_type> {
-            std::unique_lock ll(m_mut);
-            auto itt = m_tickets.find(ticket_number);
-            if(itt == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock ll(bucket.m_mut);
+            auto itt = bucket.m_tickets.find(ticket_number);
+            if(itt == bucket.m_tickets.end()) {
                 return error_code::unknown_ticket;
             }
 
@@ -208,11 +899,16 @@ namespace cbdc::parsec::broker {
                                      ticket_number,
                                      ts,
                                      shard_idx,
-                                     res);
+                                     res,
+                                     requests);
         }();
 
         m_log->trace(this, "Broker handled prepare for", ticket_number);
 
+        if(!maybe_error.has_value() && !send_requests(requests)) {
+            maybe_error = error_code::shard_unreachable;
+        }
+
         if(maybe_error.has_value()) {
             m_log->trace(this,
                          "Broker calling prepare callback with error for",
@@ -227,7 +923,8 @@ namespace cbdc::parsec::broker {
         const std::shared_ptr<state>& ts,
         uint64_t shard_idx,
         const parsec::runtime_locking_shard::interface::prepare_return_type&
-            res) -> std::optional<commit_return_type> {
+            res,
+        shard_requests_type& requests) -> std::optional<commit_return_type> {
         auto& ss = ts->m_shard_states[shard_idx].m_state;
         if(ss != shard_state_type::preparing) {
             m_log->trace(this,
@@ -272,39 +969,130 @@ namespace cbdc::parsec::broker {
 
         ts->m_state = ticket_state::prepared;
 
-        auto maybe_error = do_commit(commit_cb, ticket_number, ts);
-        if(maybe_error.has_value()) {
-            return maybe_error.value();
-        }
+        do_commit(commit_cb, ticket_number, ts, requests);
         return std::nullopt;
     }
 
-    auto impl::do_commit(const commit_callback_type& commit_cb,
+    void impl::do_commit(const commit_callback_type& commit_cb,
                          ticket_number_type ticket_number,
-                         const std::shared_ptr<state>& ts)
-        -> std::optional<error_code> {
+                         const std::shared_ptr<state>& ts,
+                         shard_requests_type& requests) {
         for(auto& shard : ts->m_shard_states) {
-            if(ts->m_state == ticket_state::aborted) {
-                m_log->trace("Broker aborted during commit for",
-                             ticket_number);
-                break;
-            }
             if(shard.second.m_state == shard_state_type::committed) {
                 continue;
             }
             shard.second.m_state = shard_state_type::committing;
             auto sidx = shard.first;
-            if(!m_shards[sidx]->commit(
+            requests.emplace_back([=]() {
+                if(!m_shards[sidx]->commit(
+                       ticket_number,
+                       [=](const parsec::runtime_locking_shard::interface::
+                               commit_return_type& comm_res) {
+                           handle_commit(commit_cb,
+                                         ticket_number,
+                                         sidx,
+                                         comm_res);
+                       })) {
+                    m_log->error("Failed to make commit shard request");
+                    return false;
+                }
+                return true;
+            });
+        }
+    }
+
+    void impl::do_one_phase_commit(const commit_callback_type& commit_cb,
+                                   ticket_number_type ticket_number,
+                                   const std::shared_ptr<state>& ts,
+                                   state_update_type state_updates,
+                                   shard_requests_type& requests) {
+        assert(ts->m_shard_states.size() == 1);
+        auto& [sidx, ss] = *ts->m_shard_states.begin();
+        ss.m_state = shard_state_type::committing;
+        // Only keys the ticket locked are updated, as in do_prepare
+        for(auto it = state_updates.begin(); it != state_updates.end();) {
+            if(ss.m_key_states.find(it->first) == ss.m_key_states.end()) {
+                it = state_updates.erase(it);
+            } else {
+                it++;
+            }
+        }
+        requests.emplace_back([=, shard_idx = sidx]() {
+            if(!m_shards[shard_idx]->one_phase_commit(
                    ticket_number,
+                   m_broker_id,
+                   state_updates,
                    [=](const parsec::runtime_locking_shard::interface::
                            commit_return_type& comm_res) {
-                       handle_commit(commit_cb, ticket_number, sidx, comm_res);
+                       handle_one_phase_commit(commit_cb,
+                                               ticket_number,
+                                               shard_idx,
+                                               comm_res);
                    })) {
-                m_log->error("Failed to make commit shard request");
-                return error_code::shard_unreachable;
+                m_log->error("Failed to make one-phase commit shard request");
+                return false;
             }
-        }
-        return std::nullopt;
+            return true;
+        });
+    }
+
+    void impl::handle_one_phase_commit(
+        const commit_callback_type& commit_cb,
+        ticket_number_type ticket_number,
+        uint64_t shard_idx,
+        parsec::runtime_locking_shard::interface::commit_return_type res) {
+        auto result = [&]() -> commit_return_type {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock l(bucket.m_mut);
+            auto it = bucket.m_tickets.find(ticket_number);
+            if(it == bucket.m_tickets.end()) {
+                return error_code::unknown_ticket;
+            }
+
+            auto ts = it->second;
+            switch(ts->m_state) {
+                case ticket_state::begun:
+                    break;
+                case ticket_state::prepared:
+                    return error_code::prepared;
+                case ticket_state::committed:
+                    return error_code::committed;
+                case ticket_state::aborted:
+                    return error_code::aborted;
+            }
+
+            auto& ss = ts->m_shard_states[shard_idx].m_state;
+            if(ss != shard_state_type::committing) {
+                m_log->error("One-phase commit result when shard not "
+                             "committing");
+                return error_code::invalid_shard_state;
+            }
+
+            if(res.has_value()) {
+                // The ticket may have been prepared on the shard before the
+                // commit failed, which a rollback also cancels
+                if(res.value().m_error_code
+                   == runtime_locking_shard::error_code::wounded) {
+                    m_log->trace("Shard",
+                                 shard_idx,
+                                 "wounded ticket",
+                                 ticket_number);
+                    ss = shard_state_type::wounded;
+                } else {
+                    m_log->error("Shard error with one-phase commit for",
+                                 ticket_number);
+                    ss = shard_state_type::begun;
+                }
+                return res.value();
+            }
+
+            ss = shard_state_type::committed;
+            ts->m_state = ticket_state::committed;
+            m_log->trace(this, "Broker handled commit for", ticket_number);
+            return std::nullopt;
+        }();
+
+        commit_cb(result);
     }
 
     void impl::handle_commit(
@@ -314,9 +1102,10 @@ namespace cbdc::parsec::broker {
         parsec::runtime_locking_shard::interface::commit_return_type res) {
         auto callback = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock lll(m_mut);
-            auto ittt = m_tickets.find(ticket_number);
-            if(ittt == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock lll(bucket.m_mut);
+            auto ittt = bucket.m_tickets.find(ticket_number);
+            if(ittt == bucket.m_tickets.end()) {
                 return error_code::unknown_ticket;
             }
 
@@ -378,10 +1167,13 @@ namespace cbdc::parsec::broker {
                       state_update_type state_updates,
                       commit_callback_type result_callback) -> bool {
         m_log->trace(this, "Broker got commit request for", ticket_number);
+        auto done = false;
+        auto requests = shard_requests_type();
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock l(bucket.m_mut);
+            auto it = bucket.m_tickets.find(ticket_number);
+            if(it == bucket.m_tickets.end()) {
                 return error_code::unknown_ticket;
             }
 
@@ -406,40 +1198,57 @@ namespace cbdc::parsec::broker {
                 }
             }
 
+            // Tickets which never reached a shard, such as read-only runs,
+            // have nothing to prepare or commit
+            if(t_state->m_shard_states.empty()) {
+                t_state->m_state = ticket_state::committed;
+                done = true;
+                return std::nullopt;
+            }
+
             if(t_state->m_state == ticket_state::prepared) {
-                return do_commit(result_callback, ticket_number, t_state);
+                do_commit(result_callback, ticket_number, t_state, requests);
+            } else if(t_state->m_shard_states.size() == 1) {
+                // No other shard needs to agree, so skip the separate
+                // prepare round trip
+                do_one_phase_commit(result_callback,
+                                    ticket_number,
+                                    t_state,
+                                    std::move(state_updates),
+                                    requests);
+            } else {
+                do_prepare(result_callback,
+                           ticket_number,
+                           t_state,
+                           state_updates,
+                           requests);
             }
-            return do_prepare(result_callback,
-                              ticket_number,
-                              t_state,
-                              state_updates);
+            return std::nullopt;
         }();
 
+        if(!maybe_error.has_value() && !send_requests(requests)) {
+            maybe_error = error_code::shard_unreachable;
+        }
+
         if(maybe_error.has_value()) {
             m_log->trace(
                 this,
                 "Broker calling commit callback with error from commit for",
                 ticket_number);
             result_callback(maybe_error.value());
+        } else if(done) {
+            result_callback(std::nullopt);
         }
 
         return true;
     }
 
-    auto impl::do_prepare(const commit_callback_type& result_callback,
+    void impl::do_prepare(const commit_callback_type& result_callback,
                           ticket_number_type ticket_number,
                           const std::shared_ptr<state>& t_state,
-                          const state_update_type& state_updates)
-        -> std::optional<error_code> {
+                          const state_update_type& state_updates,
+                          shard_requests_type& requests) {
         for(auto& shard : t_state->m_shard_states) {
-            // Shard states might get nuked in this loop if there's a
-            // rollback Before iterating, make sure we're still good to
-            // do more prepares Only nuke shard states on restart
-            if(t_state->m_state == ticket_state::aborted) {
-                m_log->trace("Broker aborted during prepare for",
-                             ticket_number);
-                break;
-            }
             if(shard.second.m_state == shard_state_type::prepared) {
                 continue;
             }
@@ -451,35 +1260,48 @@ namespace cbdc::parsec::broker {
                     shard_updates.emplace(update);
                 }
             }
-            if(!m_shards[shard.first]->prepare(
-                   ticket_number,
-                   m_broker_id,
-                   std::move(shard_updates),
-                   [this,
-                    result_callback,
-                    ticket_number,
-                    shard_idx
-                    = shard.first](const parsec::runtime_locking_shard::
-                                       interface::prepare_return_type& res) {
-                       handle_prepare(result_callback,
-                                      ticket_number,
-                                      shard_idx,
-                                      res);
-                   })) {
-                m_log->error("Failed to make prepare shard request");
-                return error_code::shard_unreachable;
+            requests.emplace_back([this,
+                                   result_callback,
+                                   ticket_number,
+                                   shard_idx = shard.first,
+                                   updates = std::move(shard_updates)]() {
+                if(!m_shards[shard_idx]->prepare(
+                       ticket_number,
+                       m_broker_id,
+                       updates,
+                       [=](const parsec::runtime_locking_shard::interface::
+                               prepare_return_type& res) {
+                           handle_prepare(result_callback,
+                                          ticket_number,
+                                          shard_idx,
+                                          res);
+                       })) {
+                    m_log->error("Failed to make prepare shard request");
+                    return false;
+                }
+                return true;
+            });
+        }
+    }
+
+    auto impl::send_requests(shard_requests_type& requests) -> bool {
+        for(auto& request : requests) {
+            if(!request()) {
+                return false;
             }
         }
-        return std::nullopt;
+        return true;
     }
 
     auto impl::finish(ticket_number_type ticket_number,
                       finish_callback_type result_callback) -> bool {
         auto done = false;
+        auto requests = shard_requests_type();
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock l(bucket.m_mut);
+            auto it = bucket.m_tickets.find(ticket_number);
+            if(it == bucket.m_tickets.end()) {
                 m_log->trace(this,
                              "Broker failing finish: [Unknown ticket] for ",
                              ticket_number);
@@ -503,11 +1325,17 @@ namespace cbdc::parsec::broker {
                     break;
                 case ticket_state::aborted:
                     // Ticket already rolled back. Just delete the ticket.
-                    m_tickets.erase(it);
+                    bucket.m_tickets.erase(it);
                     done = true;
                     return std::nullopt;
             }
 
+            if(t_state->m_shard_states.empty()) {
+                bucket.m_tickets.erase(it);
+                done = true;
+                return std::nullopt;
+            }
+
             for(auto& shard : t_state->m_shard_states) {
                 m_log->trace(this,
                              "Broker requesting finish on",
@@ -526,23 +1354,30 @@ namespace cbdc::parsec::broker {
                 auto sidx = shard.first;
                 assert(sidx < m_shards.size());
                 shard.second.m_state = shard_state_type::finishing;
-                if(!m_shards[sidx]->finish(
-                       ticket_number,
-                       [=](const parsec::runtime_locking_shard::interface::
-                               finish_return_type& res) {
-                           handle_finish(result_callback,
-                                         ticket_number,
-                                         sidx,
-                                         res);
-                       })) {
-                    m_log->error("Failed to make finish shard request");
-                    return error_code::shard_unreachable;
-                }
+                requests.emplace_back([=]() {
+                    if(!m_shards[sidx]->finish(
+                           ticket_number,
+                           [=](const parsec::runtime_locking_shard::interface::
+                                   finish_return_type& res) {
+                               handle_finish(result_callback,
+                                             ticket_number,
+                                             sidx,
+                                             res);
+                           })) {
+                        m_log->error("Failed to make finish shard request");
+                        return false;
+                    }
+                    return true;
+                });
             }
 
             return std::nullopt;
         }();
 
+        if(!maybe_error.has_value() && !send_requests(requests)) {
+            maybe_error = error_code::shard_unreachable;
+        }
+
         if(maybe_error.has_value()) {
             result_callback(maybe_error.value());
         } else if(done) {
@@ -556,10 +1391,12 @@ namespace cbdc::parsec::broker {
                         rollback_callback_type result_callback) -> bool {
         m_log->trace(this, "Broker got rollback request for", ticket_number);
         auto callback = false;
+        auto requests = shard_requests_type();
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock l(m_mut);
-            auto it = m_tickets.find(ticket_number);
-            if(it == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock l(bucket.m_mut);
+            auto it = bucket.m_tickets.find(ticket_number);
+            if(it == bucket.m_tickets.end()) {
                 return error_code::unknown_ticket;
             }
 
@@ -599,23 +1436,30 @@ namespace cbdc::parsec::broker {
                 auto sidx = shard.first;
                 assert(sidx < m_shards.size());
                 shard.second.m_state = shard_state_type::rolling_back;
-                if(!m_shards[sidx]->rollback(
-                       ticket_number,
-                       [=](const parsec::runtime_locking_shard::interface::
-                               rollback_return_type& res) {
-                           handle_rollback(result_callback,
-                                           ticket_number,
-                                           sidx,
-                                           res);
-                       })) {
-                    m_log->error("Failed to make rollback shard request");
-                    return error_code::shard_unreachable;
-                }
+                requests.emplace_back([=]() {
+                    if(!m_shards[sidx]->rollback(
+                           ticket_number,
+                           [=](const parsec::runtime_locking_shard::interface::
+                                   rollback_return_type& res) {
+                               handle_rollback(result_callback,
+                                               ticket_number,
+                                               sidx,
+                                               res);
+                           })) {
+                        m_log->error("Failed to make rollback shard request");
+                        return false;
+                    }
+                    return true;
+                });
             }
 
             return std::nullopt;
         }();
 
+        if(!maybe_error.has_value() && !send_requests(requests)) {
+            maybe_error = error_code::shard_unreachable;
+        }
+
         m_log->trace(this,
                      "Broker initiated rollback request for",
                      ticket_number);
@@ -640,9 +1484,10 @@ namespace cbdc::parsec::broker {
         parsec::runtime_locking_shard::interface::rollback_return_type res) {
         auto callback = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock lll(m_mut);
-            auto ittt = m_tickets.find(ticket_number);
-            if(ittt == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock lll(bucket.m_mut);
+            auto ittt = bucket.m_tickets.find(ticket_number);
+            if(ittt == bucket.m_tickets.end()) {
                 return error_code::unknown_ticket;
             }
 
@@ -719,11 +1564,13 @@ namespace cbdc::parsec::broker {
         try_lock_callback_type result_callback,
         std::optional<parsec::directory::interface::key_location_return_type>
             res) {
+        auto request = std::function<bool()>();
         auto maybe_error = [&]() -> std::optional<try_lock_return_type> {
-            std::unique_lock l(m_mut);
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock l(bucket.m_mut);
             assert(res < m_shards.size());
-            auto ticket = m_tickets.find(ticket_number);
-            if(ticket == m_tickets.end()) {
+            auto ticket = bucket.m_tickets.find(ticket_number);
+            if(ticket == bucket.m_tickets.end()) {
                 m_log->error("Unknown ticket number");
                 return error_code::unknown_ticket;
             }
@@ -760,28 +1607,33 @@ namespace cbdc::parsec::broker {
             ks.m_key_state = key_state::locking;
             ks.m_locktype = locktype;
 
-            if(!m_shards[shard_idx]->try_lock(
-                   ticket_number,
-                   m_broker_id,
-                   key,
-                   locktype,
-                   first_lock,
-                   [=](const parsec::runtime_locking_shard::interface::
-                           try_lock_return_type& lock_res) {
-                       handle_lock(ticket_number,
-                                   key,
-                                   shard_idx,
-                                   result_callback,
-                                   lock_res);
-                   })) {
-                m_log->error("Failed to make try_lock shard request");
-                return error_code::shard_unreachable;
-            }
+            request = [=]() {
+                return m_shards[shard_idx]->try_lock(
+                    ticket_number,
+                    m_broker_id,
+                    key,
+                    locktype,
+                    first_lock,
+                    [=](const parsec::runtime_locking_shard::interface::
+                            try_lock_return_type& lock_res) {
+                        handle_lock(ticket_number,
+                                    key,
+                                    shard_idx,
+                                    result_callback,
+                                    lock_res);
+                    });
+            };
             return std::nullopt;
         }();
 
         if(maybe_error.has_value()) {
             result_callback(maybe_error.value());
+            return;
+        }
+
+        if(!request()) {
+            m_log->error("Failed to make try_lock shard request");
+            result_callback(error_code::shard_unreachable);
         }
     }
 
@@ -792,9 +1644,10 @@ namespace cbdc::parsec::broker {
         parsec::runtime_locking_shard::interface::finish_return_type res) {
         auto callback = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock lll(m_mut);
-            auto ittt = m_tickets.find(ticket_number);
-            if(ittt == m_tickets.end()) {
+            auto& bucket = bucket_for(ticket_number);
+            std::unique_lock lll(bucket.m_mut);
+            auto ittt = bucket.m_tickets.find(ticket_number);
+            if(ittt == bucket.m_tickets.end()) {
                 return error_code::unknown_ticket;
             }
 
@@ -850,7 +1703,7 @@ namespace cbdc::parsec::broker {
 
             m_log->trace(this, "All shards finished for", ticket_number);
 
-            m_tickets.erase(ittt);
+            bucket.m_tickets.erase(ittt);
 
             callback = true;
             return std::nullopt;
@@ -865,116 +1718,196 @@ namespace cbdc::parsec::broker {
 
     auto impl::recover(recover_callback_type result_callback) -> bool {
         // Do not allow recovery when tickets are in-flight
-        auto maybe_tickets = [&]() {
-            std::unique_lock l(m_mut);
-            return !m_tickets.empty();
-        }();
-        if(maybe_tickets) {
+        if(has_tickets()) {
             return false;
         }
+        {
+            std::unique_lock l(m_mut);
+            m_recovery_starts.assign(m_shards.size(), ticket_number_type{});
+            m_recovery_pending.clear();
+            m_recovery_reported = false;
+        }
         for(uint64_t i = 0; i < m_shards.size(); i++) {
-            auto& s = m_shards[i];
-            auto success = s->get_tickets(
-                m_broker_id,
-                [&, result_callback, i](
-                    const parsec::runtime_locking_shard::interface::
-                        get_tickets_return_type& res) {
-                    handle_get_tickets(result_callback, i, res);
-                });
-            if(!success) {
+            if(!request_tickets_page(result_callback, i, 0)) {
                 return false;
             }
         }
         return true;
     }
 
+    auto
+    impl::request_tickets_page(const recover_callback_type& result_callback,
+                               uint64_t shard_idx,
+                               ticket_number_type start) -> bool {
+        return m_shards[shard_idx]->get_tickets(
+            m_broker_id,
+            start,
+            recovery_page_size,
+            [&, result_callback, shard_idx](
+                const parsec::runtime_locking_shard::interface::
+                    get_tickets_return_type& res) {
+                handle_get_tickets(result_callback, shard_idx, res);
+            });
+    }
+
     void
     impl::handle_get_tickets(const recover_callback_type& result_callback,
                              uint64_t shard_idx,
                              const parsec::runtime_locking_shard::interface::
                                  get_tickets_return_type& res) {
-        auto done = false;
-        auto maybe_error = std::visit(
-            overloaded{[&](const runtime_locking_shard::interface::
-                               get_tickets_success_type& tickets)
-                           -> std::optional<error_code> {
-                           std::unique_lock l(m_mut);
-                           m_recovery_tickets.emplace(shard_idx, tickets);
-                           if(m_recovery_tickets.size() != m_shards.size()) {
-                               return std::nullopt;
-                           }
-                           for(auto& [s, ts] : m_recovery_tickets) {
-                               for(auto& [ticket_number, t_state] : ts) {
-                                   auto& ticket = m_tickets[ticket_number];
-                                   if(!ticket) {
-                                       ticket = std::make_shared<state>();
-                                   }
-                                   switch(t_state) {
-                                       case runtime_locking_shard::
-                                           ticket_state::begun:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::begun;
-                                           break;
-                                       case runtime_locking_shard::
-                                           ticket_state::committed:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::committed;
-                                           break;
-                                       case runtime_locking_shard::
-                                           ticket_state::prepared:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::prepared;
-                                           break;
-                                       case runtime_locking_shard::
-                                           ticket_state::wounded:
-                                           ticket->m_shard_states[s].m_state
-                                               = shard_state_type::wounded;
-                                           break;
-                                   }
-                               }
-                           }
-                           if(m_tickets.empty()) {
-                               done = true;
-                               return std::nullopt;
-                           }
-                           m_recovery_tickets.clear();
-                           return do_recovery(result_callback);
-                       },
-                       [&](const runtime_locking_shard::error_code& /* e */)
-                           -> std::optional<error_code> {
-                           return error_code::get_tickets_error;
-                       }},
-            res);
-        if(maybe_error.has_value()) {
-            result_callback(maybe_error.value());
-        } else if(done) {
-            result_callback(std::nullopt);
+        if(!std::holds_alternative<
+               runtime_locking_shard::interface::get_tickets_success_type>(
+               res)) {
+            report_recovery(result_callback, error_code::get_tickets_error);
+            return;
         }
+        const auto& page = std::get<
+            runtime_locking_shard::interface::get_tickets_success_type>(res);
 
-        m_log->trace(this, "Broker handled get_tickets for shard", shard_idx);
+        auto next_start = std::optional<ticket_number_type>();
+        auto tickets_to_recover = recovery_tickets_type();
+        {
+            std::unique_lock l(m_mut);
+            if(m_recovery_reported) {
+                return;
+            }
+            for(const auto& [ticket_number, t_state] : page.m_tickets) {
+                auto& bucket = bucket_for(ticket_number);
+                std::unique_lock ll(bucket.m_mut);
+                auto& ticket = bucket.m_tickets[ticket_number];
+                if(!ticket) {
+                    ticket = std::make_shared<state>();
+                }
+                auto& shard_state = ticket->m_shard_states[shard_idx].m_state;
+                switch(t_state) {
+                    case runtime_locking_shard::ticket_state::begun:
+                        shard_state = shard_state_type::begun;
+                        break;
+                    case runtime_locking_shard::ticket_state::committed:
+                        shard_state = shard_state_type::committed;
+                        break;
+                    case runtime_locking_shard::ticket_state::prepared:
+                        shard_state = shard_state_type::prepared;
+                        break;
+                    case runtime_locking_shard::ticket_state::wounded:
+                        shard_state = shard_state_type::wounded;
+                        break;
+                }
+                m_recovery_pending.emplace(ticket_number, ticket);
+            }
+            if(page.m_more) {
+                assert(!page.m_tickets.empty());
+                next_start = page.m_tickets.back().first + 1;
+            }
+            m_recovery_starts[shard_idx] = next_start;
+
+            // Every shard has returned all its tickets numbered below the
+            // lowest start, so those tickets can be recovered already
+            auto lowest = std::optional<ticket_number_type>();
+            for(const auto& s : m_recovery_starts) {
+                if(s.has_value() && (!lowest || s.value() < lowest.value())) {
+                    lowest = s;
+                }
+            }
+            auto end = lowest.has_value()
+                         ? m_recovery_pending.lower_bound(lowest.value())
+                         : m_recovery_pending.end();
+            tickets_to_recover.assign(m_recovery_pending.begin(), end);
+            m_recovery_pending.erase(m_recovery_pending.begin(), end);
+        }
+
+        m_log->trace(this,
+                     "Broker handled get_tickets page for shard",
+                     shard_idx,
+                     "recovering",
+                     tickets_to_recover.size(),
+                     "tickets");
+
+        if(!tickets_to_recover.empty()) {
+            auto maybe_error
+                = do_recovery(result_callback, tickets_to_recover);
+            if(maybe_error.has_value()) {
+                report_recovery(result_callback, maybe_error.value());
+                return;
+            }
+        }
+
+        if(next_start.has_value()) {
+            if(!request_tickets_page(result_callback,
+                                     shard_idx,
+                                     next_start.value())) {
+                report_recovery(result_callback,
+                                error_code::shard_unreachable);
+            }
+            return;
+        }
+
+        complete_recovery(result_callback);
+    }
+
+    void impl::complete_recovery(const recover_callback_type& result_callback) {
+        {
+            std::unique_lock l(m_mut);
+            auto paging = std::any_of(m_recovery_starts.begin(),
+                                      m_recovery_starts.end(),
+                                      [](const auto& s) {
+                                          return s.has_value();
+                                      });
+            if(paging || !m_recovery_pending.empty()) {
+                return;
+            }
+        }
+        if(has_tickets()) {
+            return;
+        }
+        report_recovery(result_callback, std::nullopt);
+    }
+
+    void impl::report_recovery(const recover_callback_type& result_callback,
+                               recover_return_type res) {
+        {
+            std::unique_lock l(m_mut);
+            if(m_recovery_reported) {
+                return;
+            }
+            m_recovery_reported = true;
+        }
+        result_callback(res);
     }
 
-    auto impl::do_recovery(const recover_callback_type& result_callback)
+    auto impl::do_recovery(const recover_callback_type& result_callback,
+                           const recovery_tickets_type& tickets)
         -> std::optional<error_code> {
-        for(auto [ticket_number, ticket] : m_tickets) {
+        for(const auto& [ticket_number, ticket] : tickets) {
             size_t committed{};
-            for(auto& [sidx, t_state] : ticket->m_shard_states) {
-                switch(t_state.m_state) {
-                    case shard_state_type::begun:
-                    case shard_state_type::prepared:
-                    case shard_state_type::wounded:
-                        break;
-                    case shard_state_type::committed:
-                        committed++;
-                        break;
-                    default:
-                        m_log->fatal(this,
-                                     "Found invalid shard "
-                                     "state during recovery");
+            size_t n_shards{};
+            {
+                std::unique_lock l(bucket_for(ticket_number).m_mut);
+                n_shards = ticket->m_shard_states.size();
+                for(auto& [sidx, t_state] : ticket->m_shard_states) {
+                    switch(t_state.m_state) {
+                        case shard_state_type::begun:
+                        case shard_state_type::prepared:
+                        case shard_state_type::wounded:
+                            break;
+                        case shard_state_type::committed:
+                            committed++;
+                            break;
+                        default:
+                            m_log->fatal(this,
+                                         "Found invalid shard "
+                                         "state during recovery");
+                    }
+                }
+                if(committed == n_shards) {
+                    ticket->m_state = ticket_state::committed;
+                } else if(committed > 0) {
+                    ticket->m_state = ticket_state::prepared;
+                } else {
+                    ticket->m_state = ticket_state::begun;
                 }
             }
-            if(committed == ticket->m_shard_states.size()) {
-                ticket->m_state = ticket_state::committed;
+            if(committed == n_shards) {
                 auto success = finish(
                     ticket_number,
                     [&, result_callback](finish_return_type fin_res) {
@@ -984,7 +1917,6 @@ namespace cbdc::parsec::broker {
                     return error_code::shard_unreachable;
                 }
             } else if(committed > 0) {
-                ticket->m_state = ticket_state::prepared;
                 auto success = commit(
                     ticket_number,
                     {},
@@ -996,7 +1928,6 @@ namespace cbdc::parsec::broker {
                     return error_code::shard_unreachable;
                 }
             } else {
-                ticket->m_state = ticket_state::begun;
                 auto success
                     = rollback(ticket_number,
                                [&, result_callback, tn = ticket_number](
@@ -1018,7 +1949,7 @@ namespace cbdc::parsec::broker {
                                  ticket_number_type ticket_number,
                                  const commit_return_type& res) {
         if(res.has_value()) {
-            result_callback(error_code::commit_error);
+            report_recovery(result_callback, error_code::commit_error);
             return;
         }
 
@@ -1028,7 +1959,7 @@ namespace cbdc::parsec::broker {
                          handle_recovery_finish(result_callback, fin_res);
                      });
         if(!success) {
-            result_callback(error_code::shard_unreachable);
+            report_recovery(result_callback, error_code::shard_unreachable);
         }
     }
 
@@ -1036,16 +1967,10 @@ namespace cbdc::parsec::broker {
     impl::handle_recovery_finish(const recover_callback_type& result_callback,
                                  finish_return_type res) {
         if(res.has_value()) {
-            result_callback(error_code::finish_error);
+            report_recovery(result_callback, error_code::finish_error);
             return;
         }
-        auto done = [&]() {
-            std::unique_lock l(m_mut);
-            return m_tickets.empty();
-        }();
-        if(done) {
-            result_callback(std::nullopt);
-        }
+        complete_recovery(result_callback);
     }
 
     void impl::handle_recovery_rollback(
@@ -1053,7 +1978,7 @@ namespace cbdc::parsec::broker {
         ticket_number_type ticket_number,
         rollback_return_type res) {
         if(res.has_value()) {
-            result_callback(error_code::rollback_error);
+            report_recovery(result_callback, error_code::rollback_error);
             return;
         }
         auto success
@@ -1062,7 +1987,7 @@ namespace cbdc::parsec::broker {
                          handle_recovery_finish(result_callback, fin_res);
                      });
         if(!success) {
-            result_callback(error_code::shard_unreachable);
+            report_recovery(result_callback, error_code::shard_unreachable);
         }
     }
 }
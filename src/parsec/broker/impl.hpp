@@ -10,7 +10,13 @@
 #include "parsec/directory/interface.hpp"
 #include "util/common/logging.hpp"
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <queue>
 
 namespace cbdc::parsec::broker {
     /// Implementation of a broker. Stores ticket states in memory.
@@ -30,10 +36,13 @@ namespace cbdc::parsec::broker {
              std::shared_ptr<directory::interface> directory,
              std::shared_ptr<logging::log> logger);
 
-        /// Requests a new ticket number from the ticket machine.
+        /// Assigns a new ticket number from the range of ticket numbers
+        /// leased from the ticket machine. Leases a new range when the
+        /// current one is exhausted, and prefetches the next range once
+        /// fewer than half the tickets of the last range remain, so most
+        /// calls complete without contacting the ticket machine.
         /// \param result_callback function to call with the begin result.
-        /// \return true if the request to the ticket machine was initiated
-        ///         successfully.
+        /// \return true.
         auto begin(begin_callback_type result_callback) -> bool override;
 
         /// Determines the shard responsible for the given key and issues a try
@@ -50,6 +59,35 @@ namespace cbdc::parsec::broker {
                       lock_type locktype,
                       try_lock_callback_type result_callback) -> bool override;
 
+        /// Determines the shards responsible for the given keys and issues a
+        /// single batch try lock request to each of them, in parallel. Keys
+        /// the ticket has already locked are not requested again.
+        /// \param ticket_number ticket number.
+        /// \param locks keys to lock and the type of lock for each.
+        /// \param result_callback function to call with batch try lock
+        ///                        result.
+        /// \return true.
+        auto try_lock_batch(ticket_number_type ticket_number,
+                            std::vector<lock_request_type> locks,
+                            try_lock_batch_callback_type result_callback)
+            -> bool override;
+
+        /// Determines the shards responsible for the given keys and issues a
+        /// single lock-free read request to each of them, in parallel.
+        /// \param keys keys to read.
+        /// \param result_callback function to call with read result.
+        /// \return true.
+        auto read(std::vector<key_type> keys,
+                  read_callback_type result_callback) -> bool override;
+
+        /// Determines the shards responsible for the given keys and issues a
+        /// single load request to each of them, in parallel.
+        /// \param state keys and values to write.
+        /// \param result_callback function to call with load result.
+        /// \return true.
+        auto load(state_update_type state,
+                  load_callback_type result_callback) -> bool override;
+
         /// Commits the ticket on all shards involved in the ticket.
         /// \param ticket_number ticket number.
         /// \param state_updates state updates to apply if ticket commits.
@@ -102,8 +140,22 @@ namespace cbdc::parsec::broker {
         std::shared_ptr<directory::interface> m_directory;
         std::shared_ptr<logging::log> m_log;
 
-        mutable std::recursive_mutex m_mut;
-        ticket_number_type m_highest_ticket{};
+        /// Protects the leases, waiting begin calls and recovery state.
+        /// Ticket state is protected by the mutex of its bucket instead.
+        std::mutex m_mut;
+        std::atomic<ticket_number_type> m_highest_ticket{};
+
+        /// Unused ticket number ranges leased from the ticket machine, in
+        /// the order they were leased.
+        std::deque<ticket_machine::interface::ticket_number_range_type>
+            m_leases;
+        /// Number of ticket numbers left in m_leases.
+        ticket_number_type m_leased_count{};
+        /// Size of the most recently leased range.
+        ticket_number_type m_lease_size{};
+        bool m_fetching_tickets{false};
+        /// begin calls waiting for the next leased range.
+        std::queue<begin_callback_type> m_begin_callbacks;
 
         enum class shard_state_type : uint8_t {
             begun,
@@ -144,14 +196,73 @@ namespace cbdc::parsec::broker {
             shard_states m_shard_states;
         };
 
-        std::unordered_map<ticket_number_type, std::shared_ptr<state>>
-            m_tickets;
+        /// Number of independently locked partitions of the ticket state.
+        static constexpr size_t ticket_bucket_count = 64;
+
+        /// Partition of the ticket state, holding the tickets whose number
+        /// modulo ticket_bucket_count is the bucket's index.
+        struct ticket_bucket {
+            std::mutex m_mut;
+            std::unordered_map<ticket_number_type, std::shared_ptr<state>>
+                m_tickets;
+        };
+
+        std::array<ticket_bucket, ticket_bucket_count> m_buckets;
+
+        /// Shard requests collected while holding a bucket mutex, to be sent
+        /// once it has been released. Each returns false if its request
+        /// could not be sent.
+        using shard_requests_type = std::vector<std::function<bool()>>;
+
+        /// State of an in-flight batch try lock operation, protected by the
+        /// mutex of the ticket's bucket.
+        struct batch_lock_state {
+            std::vector<lock_request_type> m_locks;
+            std::vector<uint64_t> m_shard_idxs;
+            std::vector<value_type> m_values;
+            size_t m_pending_locations{};
+            size_t m_pending_shards{};
+            std::optional<try_lock_batch_return_type> m_error;
+            try_lock_batch_callback_type m_callback;
+        };
+
+        /// State of an in-flight read operation.
+        struct read_state {
+            std::mutex m_mut;
+            std::vector<key_type> m_keys;
+            std::vector<uint64_t> m_shard_idxs;
+            std::vector<runtime_locking_shard::committed_value> m_values;
+            size_t m_pending_locations{};
+            size_t m_pending_shards{};
+            std::optional<error_code> m_error;
+            read_callback_type m_callback;
+        };
+
+        /// State of an in-flight load operation.
+        struct load_state {
+            std::mutex m_mut;
+            std::vector<std::pair<key_type, value_type>> m_entries;
+            std::vector<uint64_t> m_shard_idxs;
+            size_t m_pending_locations{};
+            size_t m_pending_shards{};
+            std::optional<error_code> m_error;
+            load_callback_type m_callback;
+        };
 
-        std::unordered_map<
-            uint64_t,
-            std::unordered_map<ticket_number_type,
-                               runtime_locking_shard::ticket_state>>
-            m_recovery_tickets;
+        /// Number of tickets requested from a shard per page during
+        /// recovery.
+        static constexpr size_t recovery_page_size = 1000;
+
+        /// For each shard, the ticket number from which its tickets are
+        /// still to be received during recovery, or std::nullopt once the
+        /// shard has returned all its tickets.
+        std::vector<std::optional<ticket_number_type>> m_recovery_starts;
+        /// Tickets received during recovery which shards still paging may
+        /// also hold, so cannot be recovered yet.
+        std::map<ticket_number_type, std::shared_ptr<state>>
+            m_recovery_pending;
+        /// Set once the result of the recovery has been reported.
+        bool m_recovery_reported{false};
 
         void handle_prepare(
             const commit_callback_type& commit_cb,
@@ -172,11 +283,78 @@ namespace cbdc::parsec::broker {
                          const parsec::runtime_locking_shard::interface::
                              try_lock_return_type& res);
 
-        void handle_ticket_number(
-            begin_callback_type result_callback,
+        void handle_batch_find_key(
+            ticket_number_type ticket_number,
+            const std::shared_ptr<batch_lock_state>& batch,
+            size_t idx,
+            std::optional<
+                parsec::directory::interface::key_location_return_type> res);
+
+        auto do_try_lock_batch(ticket_number_type ticket_number,
+                               const std::shared_ptr<batch_lock_state>& batch,
+                               shard_requests_type& requests)
+            -> std::optional<try_lock_batch_return_type>;
+
+        void handle_batch_lock(
+            ticket_number_type ticket_number,
+            const std::shared_ptr<batch_lock_state>& batch,
+            uint64_t shard_idx,
+            const std::vector<lock_request_type>& locks,
+            const std::vector<std::vector<size_t>>& idxs,
+            const parsec::runtime_locking_shard::interface::
+                try_lock_batch_return_type& res);
+
+        static auto complete_batch_lock(batch_lock_state& batch)
+            -> std::optional<try_lock_batch_return_type>;
+
+        void handle_read_find_key(
+            const std::shared_ptr<read_state>& state,
+            size_t idx,
+            std::optional<
+                parsec::directory::interface::key_location_return_type> res);
+
+        void do_read(const std::shared_ptr<read_state>& state);
+
+        static void handle_read(
+            const std::shared_ptr<read_state>& state,
+            const std::vector<std::vector<size_t>>& idxs,
+            parsec::runtime_locking_shard::interface::read_return_type res);
+
+        static auto complete_read(read_state& state)
+            -> std::optional<read_return_type>;
+
+        void handle_load_find_key(
+            const std::shared_ptr<load_state>& state,
+            size_t idx,
+            std::optional<
+                parsec::directory::interface::key_location_return_type> res);
+
+        void do_load(const std::shared_ptr<load_state>& state);
+
+        static void handle_load(
+            const std::shared_ptr<load_state>& state,
+            parsec::runtime_locking_shard::interface::load_return_type res);
+
+        static auto complete_load(load_state& state) -> bool;
+
+        auto check_lockable(ticket_number_type ticket_number)
+            -> std::optional<error_code>;
+
+        auto take_leased_ticket() -> std::optional<ticket_number_type>;
+
+        auto bucket_for(ticket_number_type ticket_number) -> ticket_bucket&;
+
+        /// Returns true if any bucket holds a ticket.
+        auto has_tickets() -> bool;
+
+        void fetch_ticket_range();
+
+        void handle_ticket_range(
             std::optional<parsec::ticket_machine::interface::
                               get_ticket_number_return_type> res);
 
+        void fail_begin_callbacks(error_code err);
+
         void handle_rollback(
             const rollback_callback_type& result_callback,
             ticket_number_type ticket_number,
@@ -203,6 +381,19 @@ namespace cbdc::parsec::broker {
                                 const parsec::runtime_locking_shard::
                                     interface::get_tickets_return_type& res);
 
+        auto request_tickets_page(const recover_callback_type& result_callback,
+                                  uint64_t shard_idx,
+                                  ticket_number_type start) -> bool;
+
+        /// Reports the result of the recovery once every shard has returned
+        /// all its tickets and all the tickets have been finished.
+        void complete_recovery(const recover_callback_type& result_callback);
+
+        /// Calls the recovery callback with the given result, unless a
+        /// result has already been reported.
+        void report_recovery(const recover_callback_type& result_callback,
+                             recover_return_type res);
+
         void
         handle_recovery_commit(const recover_callback_type& result_callback,
                                ticket_number_type ticket_number,
@@ -217,26 +408,50 @@ namespace cbdc::parsec::broker {
                                  ticket_number_type ticket_number,
                                  rollback_return_type res);
 
-        auto do_commit(const commit_callback_type& commit_cb,
+        void do_commit(const commit_callback_type& commit_cb,
                        ticket_number_type ticket_number,
-                       const std::shared_ptr<state>& ts)
-            -> std::optional<error_code>;
+                       const std::shared_ptr<state>& ts,
+                       shard_requests_type& requests);
+
+        void do_one_phase_commit(const commit_callback_type& commit_cb,
+                                 ticket_number_type ticket_number,
+                                 const std::shared_ptr<state>& ts,
+                                 state_update_type state_updates,
+                                 shard_requests_type& requests);
+
+        void handle_one_phase_commit(
+            const commit_callback_type& commit_cb,
+            ticket_number_type ticket_number,
+            uint64_t shard_idx,
+            parsec::runtime_locking_shard::interface::commit_return_type res);
 
         auto do_handle_prepare(const commit_callback_type& commit_cb,
                                ticket_number_type ticket_number,
                                const std::shared_ptr<state>& ts,
                                uint64_t shard_idx,
                                const parsec::runtime_locking_shard::interface::
-                                   prepare_return_type& res)
+                                   prepare_return_type& res,
+                               shard_requests_type& requests)
             -> std::optional<commit_return_type>;
 
-        auto do_prepare(const commit_callback_type& result_callback,
+        void do_prepare(const commit_callback_type& result_callback,
                         ticket_number_type ticket_number,
                         const std::shared_ptr<state>& t_state,
-                        const state_update_type& state_updates)
-            -> std::optional<error_code>;
+                        const state_update_type& state_updates,
+                        shard_requests_type& requests);
+
+        /// Sends shard requests collected while holding a bucket mutex, in
+        /// order.
+        /// \param requests requests to send.
+        /// \return false if a request could not be sent, in which case the
+        ///         remaining requests are not sent.
+        auto send_requests(shard_requests_type& requests) -> bool;
+
+        using recovery_tickets_type = std::vector<
+            std::pair<ticket_number_type, std::shared_ptr<state>>>;
 
-        auto do_recovery(const recover_callback_type& result_callback)
+        auto do_recovery(const recover_callback_type& result_callback,
+                         const recovery_tickets_type& tickets)
             -> std::optional<error_code>;
     };
 }
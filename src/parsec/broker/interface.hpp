@@ -20,6 +20,8 @@ namespace cbdc::parsec::broker {
     using state_update_type = runtime_locking_shard::state_update_type;
     /// Shard lock type.
     using lock_type = runtime_locking_shard::lock_type;
+    /// Shard lock request type.
+    using lock_request_type = runtime_locking_shard::lock_request_type;
     /// Set of held locks
     using held_locks_set_type = std::
         unordered_map<key_type, lock_type, hashing::const_sip_hash<key_type>>;
@@ -76,7 +78,9 @@ namespace cbdc::parsec::broker {
             /// Shard error during finish.
             finish_error,
             /// Shard error during get tickets.
-            get_tickets_error
+            get_tickets_error,
+            /// Shard error during load.
+            load_error
         };
 
         /// Return type from a begin operation. Either a new ticket number or
@@ -117,6 +121,72 @@ namespace cbdc::parsec::broker {
                  try_lock_callback_type result_callback) -> bool
             = 0;
 
+        /// Return type from a batch try lock operation. Either the values
+        /// associated with the requested keys, in request order, a broker
+        /// error, or a shard error.
+        using try_lock_batch_return_type
+            = std::variant<std::vector<value_type>,
+                           error_code,
+                           runtime_locking_shard::shard_error>;
+        /// Callback function type for a batch try lock operation.
+        using try_lock_batch_callback_type
+            = std::function<void(try_lock_batch_return_type)>;
+
+        /// Attempts to acquire several locks at once. Requests to the shards
+        /// responsible for the keys are made in parallel, with a single
+        /// request per shard.
+        /// \param ticket_number ticket number.
+        /// \param locks keys to lock and the type of lock for each.
+        /// \param result_callback function to call with batch try lock
+        ///                        result.
+        /// \return true if the operation was initiated successfully.
+        [[nodiscard]] virtual auto
+        try_lock_batch(ticket_number_type ticket_number,
+                       std::vector<lock_request_type> locks,
+                       try_lock_batch_callback_type result_callback) -> bool
+            = 0;
+
+        /// Return type from a read operation. Either the committed values of
+        /// the requested keys, in request order, or a broker error.
+        using read_return_type
+            = std::variant<std::vector<runtime_locking_shard::committed_value>,
+                           error_code>;
+        /// Callback function type for a read operation.
+        using read_callback_type = std::function<void(read_return_type)>;
+
+        /// Reads the last committed values of the given keys without locking
+        /// them, outside of any ticket. Requests to the shards responsible
+        /// for the keys are made in parallel, with a single request per
+        /// shard. Values from different shards may reflect different sets of
+        /// committed tickets.
+        /// \param keys keys to read.
+        /// \param result_callback function to call with read result.
+        /// \return true if the operation was initiated successfully.
+        [[nodiscard]] virtual auto read(std::vector<key_type> keys,
+                                        read_callback_type result_callback)
+            -> bool
+            = 0;
+
+        /// Return type from a load operation. A broker error, if applicable.
+        using load_return_type = std::optional<error_code>;
+        /// Callback function type for a load operation.
+        using load_callback_type = std::function<void(load_return_type)>;
+
+        /// Writes the given keys and values directly to the committed state
+        /// of the shards responsible for them, outside of any ticket. Used
+        /// to seed the system with initial state much faster than writing
+        /// each key with its own ticket. Requests to the shards are made in
+        /// parallel, with a single request per shard, so the keys should
+        /// not be in use by tickets while loading. If a shard fails, the
+        /// values may have been written to some of the other shards.
+        /// \param state keys and values to write.
+        /// \param result_callback function to call with load result.
+        /// \return true if the operation was initiated successfully.
+        [[nodiscard]] virtual auto load(state_update_type state,
+                                        load_callback_type result_callback)
+            -> bool
+            = 0;
+
         /// Return type from a commit operation. Broker or shard error code, if
         /// applicable.
         using commit_return_type = std::optional<
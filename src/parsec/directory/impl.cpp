@@ -6,16 +6,16 @@
 #include "impl.hpp"
 
 namespace cbdc::parsec::directory {
-    impl::impl(size_t n_shards) : m_n_shards(n_shards) {}
+    impl::impl(size_t n_shards)
+        : m_placement(std::make_shared<hash_placement>(n_shards)) {}
+
+    impl::impl(std::shared_ptr<placement_policy> placement)
+        : m_placement(std::move(placement)) {}
 
     auto impl::key_location(runtime_locking_shard::key_type key,
                             key_location_callback_type result_callback)
         -> bool {
-        auto key_hash = m_siphash(key);
-        // NOTE: using modulo creates a small bias from a true
-        // uniform distribution
-        auto shard = key_hash % m_n_shards;
-        result_callback(shard);
+        result_callback(m_placement->shard_for(key));
         return true;
     }
 }
@@ -7,15 +7,24 @@
 #define OPENCBDC_TX_SRC_PARSEC_DIRECTORY_IMPL_H_
 
 #include "interface.hpp"
+#include "placement.hpp"
+
+#include <memory>
 
 namespace cbdc::parsec::directory {
-    /// Implementation of a directory which map keys to shard IDs. Thread-safe.
+    /// Implementation of a directory which map keys to shard IDs using a
+    /// \ref placement_policy. Thread-safe.
     class impl : public interface {
       public:
-        /// Constructor.
+        /// Constructor. Places keys with a \ref hash_placement of the whole
+        /// key.
         /// \param n_shards number of shards available to the directory.
         explicit impl(size_t n_shards);
 
+        /// Constructor.
+        /// \param placement policy placing keys on shards.
+        explicit impl(std::shared_ptr<placement_policy> placement);
+
         /// Returns the shard ID responsible for the given key. Calls the
         /// callback before returning.
         /// \param key key to locate.
@@ -26,8 +35,7 @@ namespace cbdc::parsec::directory {
             -> bool override;
 
       private:
-        size_t m_n_shards{};
-        hashing::const_sip_hash<runtime_locking_shard::key_type> m_siphash{};
+        std::shared_ptr<placement_policy> m_placement;
     };
 }
 
@@ -0,0 +1,150 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "placement.hpp"
+
+#include "crypto/siphash.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace cbdc::parsec::directory {
+    namespace {
+        // Same key as hashing::const_sip_hash, so hashing a whole key
+        // places it where the directory always has.
+        constexpr uint64_t siphash_k0 = 0x1337;
+        constexpr uint64_t siphash_k1 = 0x1337;
+
+        auto prefix_hash(const runtime_locking_shard::key_type& key,
+                         size_t prefix_len) -> uint64_t {
+            auto len = key.size();
+            if(prefix_len != 0 && prefix_len < len) {
+                len = prefix_len;
+            }
+            CSipHasher hasher(siphash_k0, siphash_k1);
+            hasher.Write(key.c_ptr(), len);
+            return hasher.Finalize();
+        }
+
+        auto key_less(const runtime_locking_shard::key_type& lhs,
+                      const runtime_locking_shard::key_type& rhs) -> bool {
+            return std::lexicographical_compare(lhs.c_ptr(),
+                                                lhs.c_ptr() + lhs.size(),
+                                                rhs.c_ptr(),
+                                                rhs.c_ptr() + rhs.size());
+        }
+    }
+
+    hash_placement::hash_placement(size_t n_shards, size_t prefix_len)
+        : m_n_shards(n_shards),
+          m_prefix_len(prefix_len) {
+        assert(m_n_shards > 0);
+    }
+
+    auto hash_placement::shard_for(
+        const runtime_locking_shard::key_type& key) const -> uint64_t {
+        // NOTE: using modulo creates a small bias from a true
+        // uniform distribution
+        return prefix_hash(key, m_prefix_len) % m_n_shards;
+    }
+
+    range_placement::range_placement(size_t n_shards) {
+        constexpr size_t prefixes
+            = size_t{std::numeric_limits<unsigned char>::max()} + 1;
+        assert(n_shards > 0 && n_shards <= prefixes);
+        for(size_t i{1}; i < n_shards; i++) {
+            auto first_byte = static_cast<unsigned char>(i * prefixes
+                                                         / n_shards);
+            auto split = runtime_locking_shard::key_type();
+            split.append(&first_byte, sizeof(first_byte));
+            m_split_points.emplace_back(std::move(split));
+        }
+    }
+
+    range_placement::range_placement(
+        std::vector<runtime_locking_shard::key_type> split_points)
+        : m_split_points(std::move(split_points)) {
+        assert(std::is_sorted(m_split_points.begin(),
+                              m_split_points.end(),
+                              key_less));
+    }
+
+    auto range_placement::shard_for(
+        const runtime_locking_shard::key_type& key) const -> uint64_t {
+        auto it = std::upper_bound(m_split_points.begin(),
+                                   m_split_points.end(),
+                                   key,
+                                   key_less);
+        return static_cast<uint64_t>(
+            std::distance(m_split_points.begin(), it));
+    }
+
+    consistent_hash_placement::consistent_hash_placement(size_t n_shards,
+                                                         size_t prefix_len,
+                                                         size_t vnodes)
+        : m_prefix_len(prefix_len) {
+        assert(n_shards > 0 && vnodes > 0);
+        m_ring.reserve(n_shards * vnodes);
+        for(uint64_t shard{0}; shard < n_shards; shard++) {
+            for(uint64_t vnode{0}; vnode < vnodes; vnode++) {
+                CSipHasher hasher(siphash_k0, siphash_k1);
+                hasher.Write(shard).Write(vnode);
+                m_ring.emplace_back(hasher.Finalize(), shard);
+            }
+        }
+        std::sort(m_ring.begin(), m_ring.end());
+    }
+
+    auto consistent_hash_placement::shard_for(
+        const runtime_locking_shard::key_type& key) const -> uint64_t {
+        auto h = prefix_hash(key, m_prefix_len);
+        // The first point at or after the key's hash owns it, wrapping
+        // around to the first point on the ring
+        auto it = std::lower_bound(
+            m_ring.begin(),
+            m_ring.end(),
+            h,
+            [](const std::pair<uint64_t, uint64_t>& point, uint64_t val) {
+                return point.first < val;
+            });
+        if(it == m_ring.end()) {
+            it = m_ring.begin();
+        }
+        return it->second;
+    }
+
+    auto parse_placement_type(const std::string& name)
+        -> std::optional<placement_type> {
+        if(name == "hash") {
+            return placement_type::hash;
+        }
+        if(name == "range") {
+            return placement_type::range;
+        }
+        if(name == "consistent_hash") {
+            return placement_type::consistent_hash;
+        }
+        return std::nullopt;
+    }
+
+    auto make_placement(placement_type type,
+                        size_t n_shards,
+                        size_t prefix_len)
+        -> std::shared_ptr<placement_policy> {
+        switch(type) {
+            case placement_type::hash:
+                return std::make_shared<hash_placement>(n_shards,
+                                                        prefix_len);
+            case placement_type::range:
+                return std::make_shared<range_placement>(n_shards);
+            case placement_type::consistent_hash:
+                return std::make_shared<consistent_hash_placement>(
+                    n_shards,
+                    prefix_len);
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_DIRECTORY_PLACEMENT_H_
+#define OPENCBDC_TX_SRC_PARSEC_DIRECTORY_PLACEMENT_H_
+
+#include "parsec/runtime_locking_shard/interface.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cbdc::parsec::directory {
+    /// Policy deciding which shard stores each key.
+    class placement_policy {
+      public:
+        virtual ~placement_policy() = default;
+
+        placement_policy() = default;
+        placement_policy(const placement_policy&) = delete;
+        auto operator=(const placement_policy&) -> placement_policy& = delete;
+        placement_policy(placement_policy&&) = delete;
+        auto operator=(placement_policy&&) -> placement_policy& = delete;
+
+        /// Returns the shard responsible for the given key.
+        /// \param key key to place.
+        /// \return shard ID.
+        [[nodiscard]] virtual auto
+        shard_for(const runtime_locking_shard::key_type& key) const
+            -> uint64_t
+            = 0;
+    };
+
+    /// Places keys by the SipHash of their first prefix_len bytes modulo
+    /// the number of shards. Keys sharing a prefix land on the same shard,
+    /// so, for example, EVM account, code and storage keys, which all start
+    /// with the account address, can be kept together.
+    class hash_placement final : public placement_policy {
+      public:
+        /// Constructor.
+        /// \param n_shards number of shards.
+        /// \param prefix_len number of leading key bytes to hash. Zero, or
+        ///                   a length longer than the key, hashes the whole
+        ///                   key.
+        explicit hash_placement(size_t n_shards, size_t prefix_len = 0);
+
+        [[nodiscard]] auto
+        shard_for(const runtime_locking_shard::key_type& key) const
+            -> uint64_t override;
+
+      private:
+        size_t m_n_shards;
+        size_t m_prefix_len;
+    };
+
+    /// Places keys in contiguous ranges of the key space ordered
+    /// lexicographically, so keys sharing a prefix are kept together
+    /// except where the prefix straddles a split point.
+    class range_placement final : public placement_policy {
+      public:
+        /// Constructor. Splits the key space evenly by first byte.
+        /// \param n_shards number of shards. At most 256.
+        explicit range_placement(size_t n_shards);
+
+        /// Constructor.
+        /// \param split_points key at which each shard after the first
+        ///                     begins, in ascending order.
+        explicit range_placement(
+            std::vector<runtime_locking_shard::key_type> split_points);
+
+        [[nodiscard]] auto
+        shard_for(const runtime_locking_shard::key_type& key) const
+            -> uint64_t override;
+
+      private:
+        std::vector<runtime_locking_shard::key_type> m_split_points;
+    };
+
+    /// Places keys on a consistent hash ring with several virtual nodes per
+    /// shard, hashing the first prefix_len bytes of each key as \ref
+    /// hash_placement does. Adding a shard only moves the keys the new
+    /// shard takes over, rather than most keys as with \ref hash_placement.
+    class consistent_hash_placement final : public placement_policy {
+      public:
+        /// Default number of points on the ring for each shard.
+        static constexpr size_t default_vnodes = 64;
+
+        /// Constructor.
+        /// \param n_shards number of shards.
+        /// \param prefix_len number of leading key bytes to hash, as for
+        ///                   \ref hash_placement.
+        /// \param vnodes number of points on the ring for each shard.
+        explicit consistent_hash_placement(size_t n_shards,
+                                           size_t prefix_len = 0,
+                                           size_t vnodes = default_vnodes);
+
+        [[nodiscard]] auto
+        shard_for(const runtime_locking_shard::key_type& key) const
+            -> uint64_t override;
+
+      private:
+        size_t m_prefix_len;
+        /// Ring points and the shard owning each, sorted by point.
+        std::vector<std::pair<uint64_t, uint64_t>> m_ring;
+    };
+
+    /// Available placement policies.
+    enum class placement_type {
+        /// \ref hash_placement.
+        hash,
+        /// \ref range_placement with an even split by first byte.
+        range,
+        /// \ref consistent_hash_placement.
+        consistent_hash
+    };
+
+    /// Parses a placement policy name: "hash", "range" or
+    /// "consistent_hash".
+    /// \param name policy name.
+    /// \return placement type, or std::nullopt if the name is unknown.
+    auto parse_placement_type(const std::string& name)
+        -> std::optional<placement_type>;
+
+    /// Constructs a placement policy.
+    /// \param type policy to construct.
+    /// \param n_shards number of shards.
+    /// \param prefix_len number of leading key bytes hash-based policies
+    ///                   place keys by. Zero for the whole key.
+    /// \return placement policy.
+    auto make_placement(placement_type type,
+                        size_t n_shards,
+                        size_t prefix_len)
+        -> std::shared_ptr<placement_policy>;
+}
+
+#endif
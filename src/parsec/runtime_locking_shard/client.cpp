@@ -38,6 +38,51 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
             });
     }
 
+    auto client::try_lock_batch(ticket_number_type ticket_number,
+                                broker_id_type broker_id,
+                                std::vector<lock_request_type> locks,
+                                bool first_lock,
+                                try_lock_batch_callback_type result_callback)
+        -> bool {
+        auto req = try_lock_batch_request{ticket_number,
+                                          broker_id,
+                                          std::move(locks),
+                                          first_lock};
+        return m_client->call(
+            std::move(req),
+            [result_callback](std::optional<response> resp) {
+                assert(resp.has_value());
+                assert(std::holds_alternative<try_lock_batch_return_type>(
+                    resp.value()));
+                result_callback(
+                    std::get<try_lock_batch_return_type>(resp.value()));
+            });
+    }
+
+    auto client::read(std::vector<key_type> keys,
+                      read_callback_type result_callback) -> bool {
+        auto req = read_request{std::move(keys)};
+        return m_client->call(
+            std::move(req),
+            [result_callback](std::optional<response> resp) {
+                assert(resp.has_value());
+                assert(std::holds_alternative<read_return_type>(resp.value()));
+                result_callback(std::get<read_return_type>(resp.value()));
+            });
+    }
+
+    auto client::load(state_update_type state,
+                      load_callback_type result_callback) -> bool {
+        auto req = load_request{std::move(state)};
+        return m_client->call(
+            std::move(req),
+            [result_callback](std::optional<response> resp) {
+                assert(resp.has_value());
+                assert(std::holds_alternative<load_return_type>(resp.value()));
+                result_callback(std::get<load_return_type>(resp.value()));
+            });
+    }
+
     auto client::prepare(ticket_number_type ticket_number,
                          broker_id_type broker_id,
                          state_update_type state_update,
@@ -66,6 +111,24 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
             });
     }
 
+    auto client::one_phase_commit(ticket_number_type ticket_number,
+                                  broker_id_type broker_id,
+                                  state_update_type state_update,
+                                  commit_callback_type result_callback)
+        -> bool {
+        auto req = one_phase_commit_request{ticket_number,
+                                            std::move(state_update),
+                                            broker_id};
+        return m_client->call(
+            std::move(req),
+            [result_callback](std::optional<response> resp) {
+                assert(resp.has_value());
+                assert(
+                    std::holds_alternative<commit_return_type>(resp.value()));
+                result_callback(std::get<commit_return_type>(resp.value()));
+            });
+    }
+
     auto client::rollback(ticket_number_type ticket_number,
                           rollback_callback_type result_callback) -> bool {
         auto req = rollback_request{ticket_number};
@@ -93,9 +156,11 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
     }
 
     auto client::get_tickets(broker_id_type broker_id,
+                             ticket_number_type start,
+                             size_t max_tickets,
                              get_tickets_callback_type result_callback)
         -> bool {
-        auto req = get_tickets_request{broker_id};
+        auto req = get_tickets_request{broker_id, start, max_tickets};
         return m_client->call(
             req,
             [result_callback](std::optional<response> resp) {
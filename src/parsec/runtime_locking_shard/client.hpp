@@ -45,6 +45,35 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                       bool first_lock,
                       try_lock_callback_type result_callback) -> bool override;
 
+        /// Requests a batch try lock operation from the remote shard.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param locks keys to lock and the type of lock for each.
+        /// \param first_lock true if these are the first locks.
+        /// \param result_callback function to call with batch try lock
+        ///                        result.
+        /// \return true if the request was sent successfully.
+        auto try_lock_batch(ticket_number_type ticket_number,
+                            broker_id_type broker_id,
+                            std::vector<lock_request_type> locks,
+                            bool first_lock,
+                            try_lock_batch_callback_type result_callback)
+            -> bool override;
+
+        /// Requests a read operation from the remote shard.
+        /// \param keys keys to read.
+        /// \param result_callback function to call with the values.
+        /// \return true if the request was sent successfully.
+        auto read(std::vector<key_type> keys,
+                  read_callback_type result_callback) -> bool override;
+
+        /// Requests a load operation from the remote shard.
+        /// \param state keys and values to write.
+        /// \param result_callback function to call with the load result.
+        /// \return true if the request was sent successfully.
+        auto load(state_update_type state,
+                  load_callback_type result_callback) -> bool override;
+
         /// Requests a prepare operation from the remote shard.
         /// \param ticket_number ticket number.
         /// \param broker_id ID of broker managing ticket.
@@ -63,6 +92,18 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         auto commit(ticket_number_type ticket_number,
                     commit_callback_type result_callback) -> bool override;
 
+        /// Requests a one-phase commit operation from the remote shard.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param state_update state updates to apply.
+        /// \param result_callback function to call with commit result.
+        /// \return true if the request was sent successfully.
+        auto one_phase_commit(ticket_number_type ticket_number,
+                              broker_id_type broker_id,
+                              state_update_type state_update,
+                              commit_callback_type result_callback)
+            -> bool override;
+
         /// Requests a rollback operation from the remote shard.
         /// \param ticket_number ticket number.
         /// \param result_callback function to call with the rollback result.
@@ -77,12 +118,16 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         auto finish(ticket_number_type ticket_number,
                     finish_callback_type result_callback) -> bool override;
 
-        /// Requests a get tickets operation from the remote shard.
+        /// Requests a page of tickets from the remote shard.
         /// \param broker_id broker ID.
+        /// \param start lowest ticket number to return.
+        /// \param max_tickets maximum number of tickets to return.
         /// \param result_callback function to call with the get tickets
         ///                        result.
         /// \return true if the request was sent successfully.
         auto get_tickets(broker_id_type broker_id,
+                         ticket_number_type start,
+                         size_t max_tickets,
                          get_tickets_callback_type result_callback)
             -> bool override;
 
@@ -16,7 +16,8 @@ namespace cbdc::parsec::runtime_locking_shard {
                            size_t node_id,
                            network::endpoint_t server_endpoint,
                            std::vector<network::endpoint_t> raft_endpoints,
-                           std::shared_ptr<logging::log> logger)
+                           std::shared_ptr<logging::log> logger,
+                           replicated_shard_client_options client_opts)
         : m_logger(std::move(logger)),
           m_state_machine(nuraft::cs_new<state_machine>()),
           m_raft_serv(std::make_shared<raft::node>(
@@ -31,8 +32,9 @@ namespace cbdc::parsec::runtime_locking_shard {
                   return raft_callback(std::forward<decltype(res)>(res),
                                        std::forward<decltype(err)>(err));
               })),
-          m_raft_client(
-              std::make_shared<replicated_shard_client>(m_raft_serv)),
+          m_raft_client(std::make_shared<replicated_shard_client>(
+              m_raft_serv,
+              client_opts)),
           m_raft_endpoints(std::move(raft_endpoints)),
           m_server_endpoint(std::move(server_endpoint)) {}
 
@@ -54,6 +56,12 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    void controller::transfer_leadership() {
+        static_cast<void>(m_raft_serv->transfer_leadership(
+            std::chrono::milliseconds(
+                cbdc::config::defaults::leadership_transfer_timeout)));
+    }
+
     auto controller::raft_callback(nuraft::cb_func::Type type,
                                    nuraft::cb_func::Param* /* param */)
         -> nuraft::cb_func::ReturnCode {
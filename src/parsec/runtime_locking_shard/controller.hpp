@@ -24,11 +24,14 @@ namespace cbdc::parsec::runtime_locking_shard {
         /// \param raft_endpoints vector of raft endpoints for nodes in the
         ///                       cluster.
         /// \param logger log to use for output.
+        /// \param client_opts group commit settings of the leader's
+        ///                    replicated shard client.
         controller(size_t component_id,
                    size_t node_id,
                    network::endpoint_t server_endpoint,
                    std::vector<network::endpoint_t> raft_endpoints,
-                   std::shared_ptr<logging::log> logger);
+                   std::shared_ptr<logging::log> logger,
+                   replicated_shard_client_options client_opts = {});
         ~controller() = default;
 
         controller() = delete;
@@ -42,6 +45,11 @@ namespace cbdc::parsec::runtime_locking_shard {
         /// \return true if initialization was successful.
         auto init() -> bool;
 
+        /// Hands raft leadership to an up-to-date follower if this node
+        /// leads, so the new leader can recover and serve without an
+        /// election. Call before shutting down.
+        void transfer_leadership();
+
       private:
         auto raft_callback(nuraft::cb_func::Type type,
                            nuraft::cb_func::Param* param)
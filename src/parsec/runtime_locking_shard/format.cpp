@@ -22,6 +22,21 @@ namespace cbdc {
             >> req.m_locktype >> req.m_first_lock;
     }
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::try_lock_batch_request& req)
+        -> serializer& {
+        return ser << req.m_ticket_number << req.m_broker_id << req.m_locks
+                   << req.m_first_lock;
+    }
+    auto
+    operator>>(serializer& deser,
+               parsec::runtime_locking_shard::rpc::try_lock_batch_request& req)
+        -> serializer& {
+        return deser >> req.m_ticket_number >> req.m_broker_id >> req.m_locks
+            >> req.m_first_lock;
+    }
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::commit_request& req)
@@ -48,6 +63,20 @@ namespace cbdc {
             >> req.m_broker_id;
     }
 
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::rpc::
+                        one_phase_commit_request& req) -> serializer& {
+        return ser << req.m_ticket_number << req.m_state_updates
+                   << req.m_broker_id;
+    }
+    auto operator>>(
+        serializer& deser,
+        parsec::runtime_locking_shard::rpc::one_phase_commit_request& req)
+        -> serializer& {
+        return deser >> req.m_ticket_number >> req.m_state_updates
+            >> req.m_broker_id;
+    }
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::rollback_request& req)
@@ -76,13 +105,59 @@ namespace cbdc {
         serializer& ser,
         const parsec::runtime_locking_shard::rpc::get_tickets_request& req)
         -> serializer& {
-        return ser << req.m_broker_id;
+        return ser << req.m_broker_id << req.m_start << req.m_max_tickets;
     }
     auto
     operator>>(serializer& deser,
                parsec::runtime_locking_shard::rpc::get_tickets_request& req)
         -> serializer& {
-        return deser >> req.m_broker_id;
+        return deser >> req.m_broker_id >> req.m_start >> req.m_max_tickets;
+    }
+
+    auto
+    operator<<(serializer& ser,
+               const parsec::runtime_locking_shard::rpc::read_request& req)
+        -> serializer& {
+        return ser << req.m_keys;
+    }
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::rpc::read_request& req)
+        -> serializer& {
+        return deser >> req.m_keys;
+    }
+
+    auto
+    operator<<(serializer& ser,
+               const parsec::runtime_locking_shard::rpc::load_request& req)
+        -> serializer& {
+        return ser << req.m_state;
+    }
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::rpc::load_request& req)
+        -> serializer& {
+        return deser >> req.m_state;
+    }
+
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::committed_value& val)
+        -> serializer& {
+        return ser << val.m_value << val.m_version;
+    }
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::committed_value& val)
+        -> serializer& {
+        return deser >> val.m_value >> val.m_version;
+    }
+
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::tickets_page& page)
+        -> serializer& {
+        return ser << page.m_tickets << page.m_more;
+    }
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::tickets_page& page)
+        -> serializer& {
+        return deser >> page.m_tickets >> page.m_more;
     }
 
     auto operator<<(serializer& ser,
@@ -122,6 +197,19 @@ namespace cbdc {
             >> req.m_state_update;
     }
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::replicated_load_request& req)
+        -> serializer& {
+        return ser << req.m_state;
+    }
+    auto operator>>(
+        serializer& deser,
+        parsec::runtime_locking_shard::rpc::replicated_load_request& req)
+        -> serializer& {
+        return deser >> req.m_state;
+    }
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::rpc::
                         replicated_get_tickets_request& /* req */)
@@ -135,6 +223,18 @@ namespace cbdc {
         return deser;
     }
 
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::rpc::
+                        replicated_batch_request& req) -> serializer& {
+        return ser << req.m_requests;
+    }
+    auto operator>>(
+        serializer& deser,
+        parsec::runtime_locking_shard::rpc::replicated_batch_request& req)
+        -> serializer& {
+        return deser >> req.m_requests;
+    }
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::
                         replicated_shard_interface::ticket_type& t)
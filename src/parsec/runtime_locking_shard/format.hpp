@@ -18,6 +18,15 @@ namespace cbdc {
                     parsec::runtime_locking_shard::rpc::try_lock_request& req)
         -> serializer&;
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::try_lock_batch_request& req)
+        -> serializer&;
+    auto
+    operator>>(serializer& deser,
+               parsec::runtime_locking_shard::rpc::try_lock_batch_request& req)
+        -> serializer&;
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::commit_request& req)
@@ -34,6 +43,14 @@ namespace cbdc {
                     parsec::runtime_locking_shard::rpc::prepare_request& req)
         -> serializer&;
 
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::rpc::
+                        one_phase_commit_request& req) -> serializer&;
+    auto operator>>(
+        serializer& deser,
+        parsec::runtime_locking_shard::rpc::one_phase_commit_request& req)
+        -> serializer&;
+
     auto
     operator<<(serializer& ser,
                const parsec::runtime_locking_shard::rpc::rollback_request& req)
@@ -59,6 +76,36 @@ namespace cbdc {
                parsec::runtime_locking_shard::rpc::get_tickets_request& req)
         -> serializer&;
 
+    auto
+    operator<<(serializer& ser,
+               const parsec::runtime_locking_shard::rpc::read_request& req)
+        -> serializer&;
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::rpc::read_request& req)
+        -> serializer&;
+
+    auto
+    operator<<(serializer& ser,
+               const parsec::runtime_locking_shard::rpc::load_request& req)
+        -> serializer&;
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::rpc::load_request& req)
+        -> serializer&;
+
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::committed_value& val)
+        -> serializer&;
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::committed_value& val)
+        -> serializer&;
+
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::tickets_page& page)
+        -> serializer&;
+    auto operator>>(serializer& deser,
+                    parsec::runtime_locking_shard::tickets_page& page)
+        -> serializer&;
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::shard_error& err)
         -> serializer&;
@@ -82,6 +129,15 @@ namespace cbdc {
         parsec::runtime_locking_shard::rpc::replicated_prepare_request& req)
         -> serializer&;
 
+    auto operator<<(
+        serializer& ser,
+        const parsec::runtime_locking_shard::rpc::replicated_load_request& req)
+        -> serializer&;
+    auto operator>>(
+        serializer& deser,
+        parsec::runtime_locking_shard::rpc::replicated_load_request& req)
+        -> serializer&;
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::rpc::
                         replicated_get_tickets_request& req) -> serializer&;
@@ -90,6 +146,14 @@ namespace cbdc {
         parsec::runtime_locking_shard::rpc::replicated_get_tickets_request&
             req) -> serializer&;
 
+    auto operator<<(serializer& ser,
+                    const parsec::runtime_locking_shard::rpc::
+                        replicated_batch_request& req) -> serializer&;
+    auto operator>>(
+        serializer& deser,
+        parsec::runtime_locking_shard::rpc::replicated_batch_request& req)
+        -> serializer&;
+
     auto operator<<(serializer& ser,
                     const parsec::runtime_locking_shard::
                         replicated_shard_interface::ticket_type& t)
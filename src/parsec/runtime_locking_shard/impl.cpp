@@ -5,12 +5,50 @@
 
 #include "impl.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace cbdc::parsec::runtime_locking_shard {
     impl::impl(std::shared_ptr<logging::log> logger)
         : m_log(std::move(logger)) {}
 
+    auto impl::stripe_index(const key_type& key) -> size_t {
+        return state_table::hash(key) % stripe_count;
+    }
+
+    auto impl::table(uint64_t key_hash) -> state_table& {
+        return m_stripes[key_hash % stripe_count].m_state;
+    }
+
+    auto impl::element(const key_type& key) -> state_table::element_type& {
+        const auto h = state_table::hash(key);
+        return table(h).get_or_insert(key, h);
+    }
+
+    auto impl::find_ticket(ticket_number_type ticket_number)
+        -> std::shared_ptr<ticket_state_type> {
+        std::unique_lock l(m_tickets_mut);
+        auto it = m_tickets.find(ticket_number);
+        if(it == m_tickets.end()) {
+            return nullptr;
+        }
+        return it->second;
+    }
+
+    void impl::erase_ticket(ticket_number_type ticket_number) {
+        std::unique_lock l(m_tickets_mut);
+        auto it = m_tickets.find(ticket_number);
+        if(it == m_tickets.end()) {
+            return;
+        }
+        auto broker_id = [&]() {
+            std::unique_lock tl(it->second->m_mut);
+            return it->second->m_broker_id;
+        }();
+        m_ticket_index.erase({broker_id, ticket_number});
+        m_tickets.erase(it);
+    }
+
     auto impl::try_lock(ticket_number_type ticket_number,
                         broker_id_type broker_id,
                         key_type key,
@@ -19,91 +57,124 @@ namespace cbdc::parsec::runtime_locking_shard {
                         try_lock_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto w_details = std::optional<wounded_details>();
+        auto needs_wound = false;
         auto maybe_error = [&]() -> std::optional<error_code> {
-            std::unique_lock<std::mutex> l(m_mut);
+            std::shared_lock l(m_mut);
+            const auto key_hash = state_table::hash(key);
+            auto& stripe = m_stripes[key_hash % stripe_count];
+            std::unique_lock sl(stripe.m_mut);
 
             m_log->trace(ticket_number,
                          "requesting lock on",
                          key.to_hex(),
                          static_cast<int>(locktype));
 
-            auto it = m_tickets.find(ticket_number);
-            if(first_lock && it != m_tickets.end()) {
-                m_log->fatal(ticket_number,
-                             "called try_lock with first lock but ticket "
-                             "already exists");
-            }
-            if(it == m_tickets.end()) {
-                if(!first_lock) {
-                    m_log->error(ticket_number,
-                                 "called try_lock with unknown ticket");
-                    return error_code::unknown_ticket;
+            auto ticket_ptr = [&]() -> std::shared_ptr<ticket_state_type> {
+                std::unique_lock tl(m_tickets_mut);
+                auto it = m_tickets.find(ticket_number);
+                if(first_lock && it != m_tickets.end()) {
+                    m_log->fatal(ticket_number,
+                                 "called try_lock with first lock but "
+                                 "ticket already exists");
+                }
+                if(it == m_tickets.end()) {
+                    if(!first_lock) {
+                        return nullptr;
+                    }
+                    auto ticket = std::make_shared<ticket_state_type>();
+                    ticket->m_broker_id = broker_id;
+                    it = m_tickets.emplace(ticket_number, std::move(ticket))
+                             .first;
+                    m_ticket_index.emplace(broker_id, ticket_number);
                 }
-                it = m_tickets.emplace(ticket_number, ticket_state_type{})
-                         .first;
+                return it->second;
+            }();
+            if(!ticket_ptr) {
+                m_log->error(ticket_number,
+                             "called try_lock with unknown ticket");
+                return error_code::unknown_ticket;
             }
-            auto& ticket = it->second;
 
-            // Callers shouldn't be using try_lock after prepare
-            if(ticket.m_state == ticket_state::prepared) {
-                m_log->error(ticket_number, "called try_lock after prepare");
-                return error_code::prepared;
-            }
+            {
+                auto& ticket = *ticket_ptr;
+                std::unique_lock tl(ticket.m_mut);
 
-            if(ticket.m_state == ticket_state::committed) {
-                m_log->error(ticket_number, "called try_lock after commit");
-                return error_code::committed;
-            }
+                // Callers shouldn't be using try_lock after prepare
+                if(ticket.m_state == ticket_state::prepared) {
+                    m_log->error(ticket_number,
+                                 "called try_lock after prepare");
+                    return error_code::prepared;
+                }
 
-            // If the ticket way wounded don't bother trying to acquire any
-            // locks
-            if(ticket.m_state == ticket_state::wounded) {
-                m_log->trace(ticket_number,
-                             "called try_lock after being wounded");
-                w_details = ticket.m_wounded_details;
-                return error_code::wounded;
-            }
+                if(ticket.m_state == ticket_state::committed) {
+                    m_log->error(ticket_number,
+                                 "called try_lock after commit");
+                    return error_code::committed;
+                }
 
-            // Make sure the ticket doesn't already hold a lock on the key
-            if(auto lock_it = ticket.m_locks_held.find(key);
-               lock_it != ticket.m_locks_held.end()
-               && lock_it->second >= locktype) {
-                m_log->warn(this,
-                            ticket_number,
-                            "tried to acquire already held lock");
-                return error_code::lock_held;
-            }
+                // If the ticket way wounded don't bother trying to acquire
+                // any locks
+                if(ticket.m_state == ticket_state::wounded) {
+                    m_log->trace(ticket_number,
+                                 "called try_lock after being wounded");
+                    w_details = ticket.m_wounded_details;
+                    return error_code::wounded;
+                }
 
-            if(ticket.m_queued_locks.find(key)
-               != ticket.m_queued_locks.end()) {
-                m_log->warn(ticket_number,
-                            "tried to acquire already queued lock");
-                return error_code::lock_queued;
-            }
+                // Make sure the ticket doesn't already hold a lock on the
+                // key
+                if(auto lock_it = ticket.m_locks_held.find(key);
+                   lock_it != ticket.m_locks_held.end()
+                   && lock_it->second >= locktype) {
+                    m_log->warn(this,
+                                ticket_number,
+                                "tried to acquire already held lock");
+                    return error_code::lock_held;
+                }
 
-            ticket.m_broker_id = broker_id;
+                if(ticket.m_queued_locks.find(key)
+                   != ticket.m_queued_locks.end()) {
+                    m_log->warn(ticket_number,
+                                "tried to acquire already queued lock");
+                    return error_code::lock_queued;
+                }
 
-            // Grab the requested state element
-            auto& state_element = m_state[key];
-            auto& lock = state_element.m_lock;
+                ticket.m_broker_id = broker_id;
+                ticket.m_queued_locks.insert(key);
+            }
 
             // Queue the lock
-            lock.m_queue.emplace(
-                ticket_number,
-                lock_queue_element_type{locktype, std::move(result_callback)});
-            ticket.m_queued_locks.insert(key);
-
-            // Determine if the ticket will wait on any locks
-            auto waiting_on = get_waiting_on(ticket_number, locktype, lock);
-            callbacks
-                = wound_tickets(std::move(key), waiting_on, ticket_number);
+            auto& lock = stripe.m_state.get_or_insert(key, key_hash).m_lock;
+            lock.enqueue({ticket_number, locktype, std::move(result_callback)});
+
+            // Wounding younger tickets releases their locks in other
+            // stripes, so it happens below, with the shard locked
+            // exclusively
+            auto waiting_on = lock.younger_holders(ticket_number, locktype);
+            if(!waiting_on.empty()) {
+                needs_wound = true;
+                return std::nullopt;
+            }
 
-            w_details = ticket.m_wounded_details;
+            callbacks = acquire_locks({key});
 
             m_log->trace(this, "shard handled try_lock for", ticket_number);
             return std::nullopt;
         }();
 
+        if(needs_wound) {
+            std::unique_lock l(m_mut);
+            // The lock may have been granted, or this ticket wounded, since
+            // the shared lock was released
+            auto& lock = element(key).m_lock;
+            if(auto* queued = lock.find_queued(ticket_number)) {
+                auto waiting_on
+                    = lock.younger_holders(ticket_number, queued->m_type);
+                callbacks = wound_tickets(key, waiting_on, ticket_number);
+            }
+            m_log->trace(this, "shard handled try_lock for", ticket_number);
+        }
+
         if(maybe_error.has_value()) {
             result_callback(shard_error{maybe_error.value(), w_details});
         } else {
@@ -116,6 +187,122 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    auto impl::try_lock_batch(ticket_number_type ticket_number,
+                              broker_id_type broker_id,
+                              std::vector<lock_request_type> locks,
+                              bool first_lock,
+                              try_lock_batch_callback_type result_callback)
+        -> bool {
+        if(locks.empty()) {
+            result_callback(std::vector<value_type>());
+            return true;
+        }
+
+        struct batch_state {
+            std::mutex m_mut;
+            std::vector<value_type> m_values;
+            std::optional<shard_error> m_error;
+            size_t m_pending{};
+            try_lock_batch_callback_type m_callback;
+        };
+        auto batch = std::make_shared<batch_state>();
+        batch->m_values.resize(locks.size());
+        batch->m_pending = locks.size();
+        batch->m_callback = std::move(result_callback);
+
+        // Only the first request may create the ticket. try_lock creates it
+        // before returning, so the remaining requests find it in place.
+        for(size_t i{0}; i < locks.size(); i++) {
+            auto& [key, locktype] = locks[i];
+            try_lock(ticket_number,
+                     broker_id,
+                     std::move(key),
+                     locktype,
+                     first_lock && i == 0,
+                     [batch, i](try_lock_return_type res) {
+                         auto done = [&]() {
+                             std::unique_lock l(batch->m_mut);
+                             if(std::holds_alternative<value_type>(res)) {
+                                 batch->m_values[i]
+                                     = std::move(std::get<value_type>(res));
+                             } else if(!batch->m_error.has_value()) {
+                                 batch->m_error = std::get<shard_error>(res);
+                             }
+                             return --batch->m_pending == 0;
+                         }();
+                         if(!done) {
+                             return;
+                         }
+                         if(batch->m_error.has_value()) {
+                             batch->m_callback(batch->m_error.value());
+                         } else {
+                             batch->m_callback(std::move(batch->m_values));
+                         }
+                     });
+        }
+
+        return true;
+    }
+
+    auto impl::read(std::vector<key_type> keys,
+                    read_callback_type result_callback) -> bool {
+        auto result = [&]() {
+            std::shared_lock l(m_mut);
+            auto hashes = std::vector<uint64_t>();
+            hashes.reserve(keys.size());
+            auto stripe_idxs = std::vector<size_t>();
+            stripe_idxs.reserve(keys.size());
+            for(const auto& key : keys) {
+                const auto h = state_table::hash(key);
+                hashes.push_back(h);
+                stripe_idxs.push_back(h % stripe_count);
+            }
+
+            // Lock the stripes in index order, as commit does
+            std::sort(stripe_idxs.begin(), stripe_idxs.end());
+            stripe_idxs.erase(
+                std::unique(stripe_idxs.begin(), stripe_idxs.end()),
+                stripe_idxs.end());
+            auto stripe_locks = std::vector<std::unique_lock<std::mutex>>();
+            stripe_locks.reserve(stripe_idxs.size());
+            for(auto idx : stripe_idxs) {
+                stripe_locks.emplace_back(m_stripes[idx].m_mut);
+            }
+
+            auto ret = read_return_type();
+            ret.reserve(keys.size());
+            for(size_t i{0}; i < keys.size(); i++) {
+                auto& tbl = table(hashes[i]);
+                auto& val = ret.emplace_back();
+                if(const auto* elem = tbl.find(keys[i], hashes[i])) {
+                    val.m_value = tbl.value(*elem);
+                    val.m_version = elem->m_version;
+                }
+            }
+            return ret;
+        }();
+
+        result_callback(std::move(result));
+        return true;
+    }
+
+    auto impl::load(state_update_type state,
+                    load_callback_type result_callback) -> bool {
+        {
+            std::unique_lock l(m_mut);
+            for(const auto& [k, v] : state) {
+                const auto h = state_table::hash(k);
+                auto& tbl = table(h);
+                auto& elem = tbl.get_or_insert(k, h);
+                tbl.set_value(elem, v);
+                elem.m_version = 0;
+            }
+        }
+
+        result_callback(std::nullopt);
+        return true;
+    }
+
     auto impl::wound_tickets(
         key_type key,
         const std::vector<ticket_number_type>& blocking_tickets,
@@ -123,16 +310,21 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto callbacks = pending_callbacks_list_type();
         auto keys = key_set_type();
         for(auto blocking_ticket_number : blocking_tickets) {
-            auto& blocking_ticket = m_tickets[blocking_ticket_number];
-            // Tickets can't be deadlocked by prepared tickets and
-            // we're not allowed to wound them anyway
-            if(blocking_ticket.m_state == ticket_state::prepared) {
-                continue;
-            }
+            auto blocking_ticket_ptr = find_ticket(blocking_ticket_number);
+            assert(blocking_ticket_ptr);
+            auto& blocking_ticket = *blocking_ticket_ptr;
+            {
+                std::unique_lock tl(blocking_ticket.m_mut);
+                // Tickets can't be deadlocked by prepared tickets and
+                // we're not allowed to wound them anyway
+                if(blocking_ticket.m_state == ticket_state::prepared) {
+                    continue;
+                }
 
-            // Mark the ticket as wounded
-            blocking_ticket.m_state = ticket_state::wounded;
-            blocking_ticket.m_wounded_details = {blocked_ticket, key};
+                // Mark the ticket as wounded
+                blocking_ticket.m_state = ticket_state::wounded;
+                blocking_ticket.m_wounded_details = {blocked_ticket, key};
+            }
 
             auto [wounded_callbacks, affected_keys]
                 = release_locks(blocking_ticket_number, blocking_ticket);
@@ -153,45 +345,22 @@ namespace cbdc::parsec::runtime_locking_shard {
         return callbacks;
     }
 
-    auto impl::get_waiting_on(ticket_number_type ticket_number,
-                              lock_type locktype,
-                              rw_lock_type& lock)
-        -> std::vector<ticket_number_type> {
-        auto waiting_on = std::vector<ticket_number_type>();
-        auto younger_ticket = [&](auto blocking_ticket_number) {
-            return ticket_number < blocking_ticket_number;
-        };
-        // Write locks wait on readers
-        if(locktype == lock_type::write) {
-            std::copy_if(lock.m_readers.begin(),
-                         lock.m_readers.end(),
-                         std::back_inserter(waiting_on),
-                         younger_ticket);
-        }
-        // All locks wait on writers
-        if(lock.m_writer.has_value()) {
-            if(younger_ticket(lock.m_writer.value())) {
-                waiting_on.push_back(lock.m_writer.value());
-            }
-        }
-        return waiting_on;
-    }
-
     auto impl::prepare(ticket_number_type ticket_number,
                        broker_id_type /* broker_id */,
                        state_update_type state_update,
                        prepare_callback_type result_callback) -> bool {
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
+            std::shared_lock l(m_mut);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket_ptr = find_ticket(ticket_number);
+            if(!ticket_ptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for prepare");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
+            auto& ticket = *ticket_ptr;
+            std::unique_lock tl(ticket.m_mut);
 
             // If the ticket is already prepared, return the result as such
             if(ticket.m_state == ticket_state::prepared) {
@@ -248,25 +417,55 @@ namespace cbdc::parsec::runtime_locking_shard {
                       commit_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
+            std::shared_lock l(m_mut);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket_ptr = find_ticket(ticket_number);
+            if(!ticket_ptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for commit");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
+            auto& ticket = *ticket_ptr;
+
+            // A prepared ticket can't gain or lose locks, so the stripes it
+            // holds locks in can be determined before locking them
+            auto stripe_idxs = std::vector<size_t>();
+            {
+                std::unique_lock tl(ticket.m_mut);
+                // If the ticket is not prepared we can't commit
+                if(ticket.m_state != ticket_state::prepared) {
+                    m_log->warn(ticket_number,
+                                "called commit but not prepared");
+                    return shard_error{error_code::not_prepared,
+                                       std::nullopt};
+                }
+                ticket.m_state = ticket_state::committed;
+                for(const auto& [key, lt] : ticket.m_locks_held) {
+                    stripe_idxs.push_back(stripe_index(key));
+                }
+            }
 
-            // If the ticket is not prepared we can't commit
-            if(ticket.m_state != ticket_state::prepared) {
-                m_log->warn(ticket_number, "called commit but not prepared");
-                return shard_error{error_code::not_prepared, std::nullopt};
+            // Lock the stripes in index order to avoid deadlocks
+            std::sort(stripe_idxs.begin(), stripe_idxs.end());
+            stripe_idxs.erase(
+                std::unique(stripe_idxs.begin(), stripe_idxs.end()),
+                stripe_idxs.end());
+            auto stripe_locks = std::vector<std::unique_lock<std::mutex>>();
+            stripe_locks.reserve(stripe_idxs.size());
+            for(auto idx : stripe_idxs) {
+                stripe_locks.emplace_back(m_stripes[idx].m_mut);
             }
 
-            for(auto&& [key, value] : ticket.m_state_update) {
-                m_state[key].m_value = std::move(value);
+            {
+                std::unique_lock tl(ticket.m_mut);
+                for(const auto& [key, value] : ticket.m_state_update) {
+                    const auto h = state_table::hash(key);
+                    auto& tbl = table(h);
+                    auto& elem = tbl.get_or_insert(key, h);
+                    tbl.set_value(elem, value);
+                    elem.m_version = ticket_number;
+                }
             }
 
             auto [wounded_callbacks, affected_keys]
@@ -278,8 +477,6 @@ namespace cbdc::parsec::runtime_locking_shard {
                 std::make_move_iterator(wounded_callbacks.begin()),
                 std::make_move_iterator(wounded_callbacks.end()));
 
-            ticket.m_state = ticket_state::committed;
-
             m_log->trace(this, "Shard executed commit for", ticket_number);
             return std::nullopt;
         }();
@@ -298,16 +495,32 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    auto impl::one_phase_commit(ticket_number_type ticket_number,
+                                broker_id_type broker_id,
+                                state_update_type state_update,
+                                commit_callback_type result_callback) -> bool {
+        return prepare(
+            ticket_number,
+            broker_id,
+            std::move(state_update),
+            [&](const prepare_return_type& res) {
+                if(res.has_value()) {
+                    result_callback(res);
+                    return;
+                }
+                commit(ticket_number, result_callback);
+            });
+    }
+
     auto impl::release_locks(ticket_number_type ticket_number,
                              ticket_state_type& ticket)
         -> std::pair<pending_callbacks_list_type, key_set_type> {
+        std::unique_lock tl(ticket.m_mut);
         auto callbacks = pending_callbacks_list_type();
         // Unqueue any pending locks
         for(const auto& lock_key : ticket.m_queued_locks) {
-            auto& queued_element = m_state[lock_key];
-            auto& lk = queued_element.m_lock;
-            auto queue_node = lk.m_queue.extract(ticket_number);
-            auto& queued_lock_element = queue_node.mapped();
+            auto& lk = element(lock_key).m_lock;
+            auto queued_lock_element = lk.dequeue(ticket_number);
             // Notify the ticket the queued lock was aborted
             callbacks.emplace_back(pending_callback_element_type{
                 std::move(queued_lock_element.m_callback),
@@ -319,15 +532,14 @@ namespace cbdc::parsec::runtime_locking_shard {
 
         for(auto& [lock_key, lt] : ticket.m_locks_held) {
             // Release any locks held by the blocking ticket
-            auto& locked_element = m_state[lock_key];
-            auto& lk = locked_element.m_lock;
+            auto& lk = element(lock_key).m_lock;
             // Release the read lock held by the wounded ticket
             if(lt == lock_type::read) {
                 m_log->trace("Releasing read lock on",
                              lock_key.to_hex(),
                              "held by",
                              ticket_number);
-                lk.m_readers.erase(ticket_number);
+                lk.remove_reader(ticket_number);
             }
             // Release the write lock held by the wounded ticket
             if(lt == lock_type::write) {
@@ -358,19 +570,20 @@ namespace cbdc::parsec::runtime_locking_shard {
                         rollback_callback_type result_callback) -> bool {
         auto callbacks = pending_callbacks_list_type();
         auto result = [&]() -> std::optional<shard_error> {
-            std::unique_lock<std::mutex> l(m_mut);
+            // The ticket may still be queuing for locks, which other stripes
+            // can grant at any time, so lock the whole shard
+            std::unique_lock l(m_mut);
             // Grab the ticket and ensure it exists
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            auto ticket_ptr = find_ticket(ticket_number);
+            if(!ticket_ptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for rollback");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
-            auto& ticket = ticket_it->second;
 
             auto [wounded_callbacks, affected_keys]
-                = release_locks(ticket_number, ticket);
+                = release_locks(ticket_number, *ticket_ptr);
             callbacks = acquire_locks(affected_keys);
             callbacks.insert(
                 callbacks.end(),
@@ -380,7 +593,7 @@ namespace cbdc::parsec::runtime_locking_shard {
             // We erase the ticket here as we won't need the ticket for
             // recovery. No need for a "rolled back" state and subsequent
             // finish.
-            m_tickets.erase(ticket_it);
+            erase_ticket(ticket_number);
 
             m_log->trace(this, "Shard handled rollback for", ticket_number);
 
@@ -398,25 +611,27 @@ namespace cbdc::parsec::runtime_locking_shard {
     auto impl::finish(ticket_number_type ticket_number,
                       finish_callback_type result_callback) -> bool {
         auto maybe_error = [&]() -> std::optional<shard_error> {
-            std::unique_lock l(m_mut);
-            auto ticket_it = m_tickets.find(ticket_number);
-            if(ticket_it == m_tickets.end()) {
+            std::shared_lock l(m_mut);
+            auto ticket_ptr = find_ticket(ticket_number);
+            if(!ticket_ptr) {
                 m_log->error(this,
                              ticket_number,
                              "does not exist on shard for finish");
                 return shard_error{error_code::unknown_ticket, std::nullopt};
             }
 
-            auto& ticket = ticket_it->second;
-
-            if(ticket.m_state != ticket_state::committed) {
-                m_log->error(this,
-                             ticket_number,
-                             "finish requested but not committed");
-                return shard_error{error_code::not_committed, std::nullopt};
+            {
+                std::unique_lock tl(ticket_ptr->m_mut);
+                if(ticket_ptr->m_state != ticket_state::committed) {
+                    m_log->error(this,
+                                 ticket_number,
+                                 "finish requested but not committed");
+                    return shard_error{error_code::not_committed,
+                                       std::nullopt};
+                }
             }
 
-            m_tickets.erase(ticket_it);
+            erase_ticket(ticket_number);
 
             m_log->trace(this, "Shard handled finish for", ticket_number);
 
@@ -429,15 +644,27 @@ namespace cbdc::parsec::runtime_locking_shard {
     }
 
     auto impl::get_tickets(broker_id_type broker_id,
+                           ticket_number_type start,
+                           size_t max_tickets,
                            get_tickets_callback_type result_callback) -> bool {
+        assert(max_tickets > 0);
         auto result = [&]() -> get_tickets_success_type {
-            std::unique_lock l(m_mut);
+            std::shared_lock l(m_mut);
+            std::unique_lock tl(m_tickets_mut);
             auto ret = get_tickets_success_type();
-            for(auto& [ticket_number, ticket] : m_tickets) {
-                if(ticket.m_broker_id == broker_id) {
-                    ret.emplace(ticket_number, ticket.m_state);
-                }
+            // The index orders tickets by broker, then ticket number, so
+            // the page starts at the cursor and stops at the broker's last
+            // ticket or the page size, whichever comes first
+            auto it = m_ticket_index.lower_bound({broker_id, start});
+            for(; it != m_ticket_index.end() && it->first == broker_id
+                  && ret.m_tickets.size() < max_tickets;
+                ++it) {
+                const auto& ticket = m_tickets.at(it->second);
+                std::unique_lock ttl(ticket->m_mut);
+                ret.m_tickets.emplace_back(it->second, ticket->m_state);
             }
+            ret.m_more
+                = it != m_ticket_index.end() && it->first == broker_id;
             return ret;
         }();
 
@@ -449,31 +676,43 @@ namespace cbdc::parsec::runtime_locking_shard {
     auto impl::recover(const replicated_shard::state_type& state,
                        const replicated_shard::tickets_type& tickets) -> bool {
         std::unique_lock l(m_mut);
-        if(!m_tickets.empty() && !m_state.empty()) {
+        std::unique_lock tl(m_tickets_mut);
+        auto empty_state
+            = std::all_of(m_stripes.begin(),
+                          m_stripes.end(),
+                          [](const stripe_type& stripe) {
+                              return stripe.m_state.empty();
+                          });
+        if(!m_tickets.empty() && !empty_state) {
             m_log->error("Shard state is not empty, cannot recover");
             return false;
         }
-        m_state.reserve(state.size());
-        for(auto&& [k, v] : state) {
-            m_state.emplace(k, state_element_type{v, {}});
+        for(auto& stripe : m_stripes) {
+            stripe.m_state.reserve(state.size() / stripe_count);
+        }
+        for(const auto& [k, v] : state) {
+            const auto h = state_table::hash(k);
+            auto& tbl = table(h);
+            tbl.set_value(tbl.get_or_insert(k, h), v);
         }
         m_tickets.reserve(tickets.size());
         for(auto&& [tn, t] : tickets) {
-            auto ticket = ticket_state_type{};
-            ticket.m_broker_id = t.m_broker_id;
+            auto ticket = std::make_shared<ticket_state_type>();
+            ticket->m_broker_id = t.m_broker_id;
             switch(t.m_state) {
                 case replicated_shard::ticket_state::committed:
-                    ticket.m_state = ticket_state::committed;
+                    ticket->m_state = ticket_state::committed;
                     break;
                 case replicated_shard::ticket_state::prepared:
-                    ticket.m_state = ticket_state::prepared;
+                    ticket->m_state = ticket_state::prepared;
                     for(const auto& [k, v] : t.m_state_update) {
-                        ticket.m_locks_held.emplace(k, lock_type::write);
-                        m_state[k].m_lock.m_writer = tn;
+                        ticket->m_locks_held.emplace(k, lock_type::write);
+                        element(k).m_lock.m_writer = tn;
                     }
                     break;
             }
-            ticket.m_state_update = t.m_state_update;
+            ticket->m_state_update = t.m_state_update;
+            m_ticket_index.emplace(t.m_broker_id, tn);
             m_tickets.emplace(tn, std::move(ticket));
         }
         return true;
@@ -481,16 +720,17 @@ namespace cbdc::parsec::runtime_locking_shard {
 
     auto impl::acquire_lock(const key_type& key,
                             pending_callbacks_list_type& callbacks) -> bool {
-        auto& locked_element = m_state[key];
+        const auto h = state_table::hash(key);
+        auto& tbl = table(h);
+        auto& locked_element = tbl.get_or_insert(key, h);
         auto& lk = locked_element.m_lock;
-        if(lk.m_queue.empty()) {
+        auto* front = lk.front();
+        if(front == nullptr) {
             return false;
         }
         auto acquire_next = true;
-        auto queue_node = lk.m_queue.begin();
-        const auto& queued_ticket_number = queue_node->first;
-        auto& queued_lock_element = queue_node->second;
-        auto& queued_ticket = m_tickets[queued_ticket_number];
+        auto& queued_lock_element = *front;
+        const auto queued_ticket_number = queued_lock_element.m_ticket_number;
         // Acquire the read lock if the ticket requested a
         // read
         if(queued_lock_element.m_type == lock_type::read) {
@@ -502,7 +742,7 @@ namespace cbdc::parsec::runtime_locking_shard {
                          key.to_hex(),
                          "to",
                          queued_ticket_number);
-            lk.m_readers.insert(queued_ticket_number);
+            lk.add_reader(queued_ticket_number);
         }
         // Acquire the write lock if the ticket requested a
         // write
@@ -528,14 +768,19 @@ namespace cbdc::parsec::runtime_locking_shard {
             lk.m_writer = queued_ticket_number;
             acquire_next = false;
         }
-        queued_ticket.m_queued_locks.erase(key);
-        queued_ticket.m_locks_held[key] = queued_lock_element.m_type;
+        {
+            auto queued_ticket = find_ticket(queued_ticket_number);
+            assert(queued_ticket);
+            std::unique_lock tl(queued_ticket->m_mut);
+            queued_ticket->m_queued_locks.erase(key);
+            queued_ticket->m_locks_held[key] = queued_lock_element.m_type;
+        }
         // Notify the ticket that the lock was acquired
         callbacks.emplace_back(pending_callback_element_type{
             std::move(queued_lock_element.m_callback),
-            locked_element.m_value,
+            tbl.value(locked_element),
             queued_ticket_number});
-        lk.m_queue.erase(queue_node);
+        lk.pop_front();
         return acquire_next;
     }
 }
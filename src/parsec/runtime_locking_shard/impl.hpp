@@ -8,17 +8,26 @@
 
 #include "interface.hpp"
 #include "replicated_shard.hpp"
+#include "state_table.hpp"
 #include "util/common/hashmap.hpp"
 #include "util/common/logging.hpp"
 
-#include <map>
+#include <array>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace cbdc::parsec::runtime_locking_shard {
     /// Implementation of a runtime locking shard. Stores keys in memory using
-    /// a hash map. Thread-safe.
+    /// a \ref state_table. Thread-safe. The key space is partitioned into
+    /// stripes, each with its own table and mutex, so operations on
+    /// disjoint keys proceed in parallel. Each ticket's metadata has its
+    /// own mutex. Wounding other tickets and rolling back a ticket affect
+    /// locks across stripes, so they hold a shard-wide lock exclusively,
+    /// which the other operations hold shared.
     class impl : public interface {
       public:
         /// Constructor.
@@ -42,6 +51,40 @@ namespace cbdc::parsec::runtime_locking_shard {
                       bool first_lock,
                       try_lock_callback_type result_callback) -> bool override;
 
+        /// Locks each of the given keys for a ticket, as with \ref try_lock,
+        /// and returns the associated values once all the locks are held.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param locks keys to lock and the type of lock for each.
+        /// \param first_lock true if these are the first locks.
+        /// \param result_callback function to call with the values, or the
+        ///                        first error returned for any key.
+        /// \return true.
+        auto try_lock_batch(ticket_number_type ticket_number,
+                            broker_id_type broker_id,
+                            std::vector<lock_request_type> locks,
+                            bool first_lock,
+                            try_lock_batch_callback_type result_callback)
+            -> bool override;
+
+        /// Returns the last committed values of the given keys without
+        /// locking them. Holds the stripes containing the keys for the
+        /// duration of the read so no commit is observed partially.
+        /// \param keys keys to read.
+        /// \param result_callback function to call with the values.
+        /// \return true.
+        auto read(std::vector<key_type> keys,
+                  read_callback_type result_callback) -> bool override;
+
+        /// Writes the given values directly to the committed state. Holds
+        /// the shard exclusively for the duration of the load, so tickets
+        /// see all of the batch or none of it.
+        /// \param state keys and values to write.
+        /// \param result_callback function to call with the load result.
+        /// \return true.
+        auto load(state_update_type state,
+                  load_callback_type result_callback) -> bool override;
+
         /// Prepares a ticket with the given state updates.
         /// \param ticket_number ticket number.
         /// \param broker_id ID of broker managing ticket.
@@ -61,6 +104,19 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto commit(ticket_number_type ticket_number,
                     commit_callback_type result_callback) -> bool override;
 
+        /// Prepares a ticket with the given state updates and commits it
+        /// immediately.
+        /// \param ticket_number ticket number.
+        /// \param broker_id ID of broker managing ticket.
+        /// \param state_update state changes to apply.
+        /// \param result_callback function to call with the commit result.
+        /// \return true.
+        auto one_phase_commit(ticket_number_type ticket_number,
+                              broker_id_type broker_id,
+                              state_update_type state_update,
+                              commit_callback_type result_callback)
+            -> bool override;
+
         /// Rolls back an uncommitted ticket. Releases any locks held by
         /// the ticket and assigns the locks to tickets queuing for the lock.
         /// \param ticket_number ticket number.
@@ -76,11 +132,15 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto finish(ticket_number_type ticket_number,
                     finish_callback_type result_callback) -> bool override;
 
-        /// Returns tickets managed by the given broker.
+        /// Returns a page of the tickets managed by the given broker.
         /// \param broker_id broker ID.
+        /// \param start lowest ticket number to return.
+        /// \param max_tickets maximum number of tickets to return.
         /// \param result_callback function to call with get_tickets result.
         /// \return true.
         auto get_tickets(broker_id_type broker_id,
+                         ticket_number_type start,
+                         size_t max_tickets,
                          get_tickets_callback_type result_callback)
             -> bool override;
 
@@ -93,26 +153,13 @@ namespace cbdc::parsec::runtime_locking_shard {
                      const replicated_shard::tickets_type& tickets) -> bool;
 
       private:
-        struct lock_queue_element_type {
-            lock_type m_type;
-            try_lock_callback_type m_callback;
-        };
-
-        struct rw_lock_type {
-            std::optional<ticket_number_type> m_writer;
-            std::unordered_set<ticket_number_type> m_readers;
-            std::map<ticket_number_type, lock_queue_element_type> m_queue;
-        };
-
-        struct state_element_type {
-            value_type m_value;
-            rw_lock_type m_lock;
-        };
-
         using key_set_type
             = std::unordered_set<key_type, hashing::const_sip_hash<key_type>>;
 
         struct ticket_state_type {
+            /// Guards the ticket's fields. Taken after any stripe mutexes,
+            /// and never while holding another ticket's mutex.
+            std::mutex m_mut;
             ticket_state m_state{ticket_state::begun};
             std::unordered_map<key_type,
                                lock_type,
@@ -133,14 +180,46 @@ namespace cbdc::parsec::runtime_locking_shard {
         using pending_callbacks_list_type
             = std::vector<pending_callback_element_type>;
 
-        mutable std::mutex m_mut;
+        struct stripe_type {
+            std::mutex m_mut;
+            state_table m_state;
+        };
+
+        static constexpr size_t stripe_count = 64;
+
+        /// Held shared by operations confined to the stripes they lock, and
+        /// exclusively by operations which may touch any stripe without
+        /// locking it.
+        mutable std::shared_mutex m_mut;
         std::shared_ptr<logging::log> m_log;
 
-        std::unordered_map<key_type,
-                           state_element_type,
-                           hashing::const_sip_hash<key_type>>
-            m_state;
-        std::unordered_map<ticket_number_type, ticket_state_type> m_tickets;
+        std::array<stripe_type, stripe_count> m_stripes;
+
+        /// Guards the ticket map and index, but not the tickets themselves.
+        mutable std::mutex m_tickets_mut;
+        std::unordered_map<ticket_number_type,
+                           std::shared_ptr<ticket_state_type>>
+            m_tickets;
+        /// Broker ID and ticket number of every ticket in m_tickets, so
+        /// get_tickets can page through one broker's tickets in order.
+        std::set<std::pair<broker_id_type, ticket_number_type>>
+            m_ticket_index;
+
+        static auto stripe_index(const key_type& key) -> size_t;
+
+        /// Returns the state table of the stripe for the given key hash.
+        auto table(uint64_t key_hash) -> state_table&;
+
+        /// Returns the state element for the given key. The caller must hold
+        /// the key's stripe mutex, or m_mut exclusively.
+        auto element(const key_type& key) -> state_table::element_type&;
+
+        auto find_ticket(ticket_number_type ticket_number)
+            -> std::shared_ptr<ticket_state_type>;
+
+        /// Removes the ticket from the ticket map and index. The caller
+        /// must not hold the ticket's mutex.
+        void erase_ticket(ticket_number_type ticket_number);
 
         auto
         wound_tickets(key_type key,
@@ -148,11 +227,6 @@ namespace cbdc::parsec::runtime_locking_shard {
                       ticket_number_type blocked_ticket)
             -> pending_callbacks_list_type;
 
-        static auto get_waiting_on(ticket_number_type ticket_number,
-                                   lock_type locktype,
-                                   rw_lock_type& lock)
-            -> std::vector<ticket_number_type>;
-
         auto release_locks(ticket_number_type ticket_number,
                            ticket_state_type& ticket)
             -> std::pair<pending_callbacks_list_type, key_set_type>;
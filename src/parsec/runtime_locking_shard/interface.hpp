@@ -12,6 +12,8 @@
 
 #include <functional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace cbdc::parsec::runtime_locking_shard {
     /// Type for a ticket number.
@@ -35,6 +37,9 @@ namespace cbdc::parsec::runtime_locking_shard {
         write = 1,
     };
 
+    /// Type for a request to lock a key, as part of a batch.
+    using lock_request_type = std::pair<key_type, lock_type>;
+
     /// Error codes returned by methods on shards.
     enum class error_code : uint8_t {
         /// Request invalid because ticket is in the prepared state.
@@ -81,6 +86,15 @@ namespace cbdc::parsec::runtime_locking_shard {
         std::optional<wounded_details> m_wounded_details;
     };
 
+    /// A committed value and the ticket which committed it.
+    struct committed_value {
+        /// Value of the key.
+        value_type m_value;
+        /// Ticket which committed the value, or zero if the value has not
+        /// been written since the shard started or recovered.
+        ticket_number_type m_version{};
+    };
+
     /// Ticket states returned by shards for broker recovery purposes.
     enum class ticket_state : uint8_t {
         /// Begun, may still hold locks or be rolled-back.
@@ -93,6 +107,16 @@ namespace cbdc::parsec::runtime_locking_shard {
         committed
     };
 
+    /// A page of the unfinished tickets managed by a broker.
+    struct tickets_page {
+        /// Ticket numbers and their states, in ascending ticket number
+        /// order.
+        std::vector<std::pair<ticket_number_type, ticket_state>> m_tickets;
+        /// True if the broker has further tickets, numbered after the last
+        /// ticket in this page.
+        bool m_more{false};
+    };
+
     /// Interface for a runtime locking shard. Shard implements the three-phase
     /// commit protocol and two-phase locking. Deadlocks are avoided by
     /// assigning each transaction a monotonically increasing ticket number.
@@ -144,6 +168,69 @@ namespace cbdc::parsec::runtime_locking_shard {
                               try_lock_callback_type result_callback) -> bool
             = 0;
 
+        /// Return type from a batch try lock operation. Either the values at
+        /// the requested keys, in request order, or the first error code
+        /// returned for any of the keys.
+        using try_lock_batch_return_type
+            = std::variant<std::vector<value_type>, shard_error>;
+        /// Function type for batch try lock operation results.
+        using try_lock_batch_callback_type
+            = std::function<void(try_lock_batch_return_type)>;
+
+        /// Requests locks on several keys in one operation. Equivalent to
+        /// calling \ref try_lock for each key, but completes once all the
+        /// locks have been acquired, or any request fails.
+        /// \param ticket_number ticket number requesting the locks.
+        /// \param broker_id broker ID managing the ticket.
+        /// \param locks keys to lock and the type of lock for each. Keys must
+        ///              be distinct.
+        /// \param first_lock true if these are the ticket's first locks.
+        /// \param result_callback function to call with the values or error
+        ///                        code.
+        /// \return true if the operation was initiated successfully.
+        virtual auto
+        try_lock_batch(ticket_number_type ticket_number,
+                       broker_id_type broker_id,
+                       std::vector<lock_request_type> locks,
+                       bool first_lock,
+                       try_lock_batch_callback_type result_callback) -> bool
+            = 0;
+
+        /// Return type from a read operation. The committed values of the
+        /// requested keys, in request order.
+        using read_return_type = std::vector<committed_value>;
+        /// Function type for read operation results.
+        using read_callback_type = std::function<void(read_return_type)>;
+
+        /// Returns the last committed values of the given keys without
+        /// acquiring any locks. Reads never wait for, or wound, tickets
+        /// holding locks on the keys, and see none of their uncommitted
+        /// updates. The values returned for keys on this shard are
+        /// consistent with each other.
+        /// \param keys keys to read.
+        /// \param result_callback function to call with the values.
+        /// \return true if the operation was initiated successfully.
+        virtual auto read(std::vector<key_type> keys,
+                          read_callback_type result_callback) -> bool
+            = 0;
+
+        /// Return type from a load operation. An error, if applicable.
+        using load_return_type = std::optional<shard_error>;
+        /// Callback function type for the result of a load operation.
+        using load_callback_type = std::function<void(load_return_type)>;
+
+        /// Writes the given values directly to the committed state, outside
+        /// of any ticket, in one operation. Used to seed the shard with
+        /// initial state. Values are written regardless of any locks held
+        /// on the keys, so the keys should not be in use by tickets while
+        /// loading.
+        /// \param state keys and values to write.
+        /// \param result_callback function to call with the load result.
+        /// \return true if the operation was initiated successfully.
+        virtual auto load(state_update_type state,
+                          load_callback_type result_callback) -> bool
+            = 0;
+
         /// Return type from a prepare operation. An error, if applicable.
         using prepare_return_type = std::optional<shard_error>;
         /// Callback function type for the result of a prepare operation.
@@ -178,6 +265,23 @@ namespace cbdc::parsec::runtime_locking_shard {
                             commit_callback_type result_callback) -> bool
             = 0;
 
+        /// Prepares a ticket with the given state updates and commits it in
+        /// one operation. Used when all of a ticket's locks are held on this
+        /// shard, so no other shard needs to agree before the ticket
+        /// commits. If the commit fails after the ticket has been prepared,
+        /// the ticket remains prepared.
+        /// \param ticket_number ticket to commit.
+        /// \param broker_id broker ID managing the ticket.
+        /// \param state_update state changes to apply.
+        /// \param result_callback function to call with the commit result.
+        /// \return true if the operation was initiated successfully.
+        virtual auto one_phase_commit(ticket_number_type ticket_number,
+                                      broker_id_type broker_id,
+                                      state_update_type state_update,
+                                      commit_callback_type result_callback)
+            -> bool
+            = 0;
+
         /// Return type from a rollback operation. An error code, if
         /// applicable.
         using rollback_return_type = std::optional<shard_error>;
@@ -212,11 +316,10 @@ namespace cbdc::parsec::runtime_locking_shard {
                             finish_callback_type result_callback) -> bool
             = 0;
 
-        /// Return type from a successful get tickets operation. A map of
-        /// ticket numbers to their state.
-        using get_tickets_success_type
-            = std::unordered_map<ticket_number_type, ticket_state>;
-        /// Return type from a get tickets operation. Either a map of ticket
+        /// Return type from a successful get tickets operation. A page of
+        /// ticket numbers and their states.
+        using get_tickets_success_type = tickets_page;
+        /// Return type from a get tickets operation. Either a page of ticket
         /// states or an error code.
         using get_tickets_return_type
             = std::variant<get_tickets_success_type, error_code>;
@@ -224,11 +327,19 @@ namespace cbdc::parsec::runtime_locking_shard {
         using get_tickets_callback_type
             = std::function<void(get_tickets_return_type)>;
 
-        /// Returns all unfinished tickets managed with the given broker ID.
+        /// Returns a page of the unfinished tickets managed with the given
+        /// broker ID, holding the lowest numbered tickets from the given
+        /// ticket number onwards. Request the next page from the ticket
+        /// after the last one returned, while the page has more.
         /// \param broker_id broker ID.
+        /// \param start lowest ticket number to return.
+        /// \param max_tickets maximum number of tickets to return. Must be
+        ///                    non-zero.
         /// \param result_callback function to call with get tickets result.
         /// \return true if the operation was initiated successfully.
         virtual auto get_tickets(broker_id_type broker_id,
+                                 ticket_number_type start,
+                                 size_t max_tickets,
                                  get_tickets_callback_type result_callback)
             -> bool
             = 0;
@@ -24,6 +24,30 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         bool m_first_lock{false};
     };
 
+    /// Batch try lock request message.
+    struct try_lock_batch_request {
+        /// Ticket number.
+        ticket_number_type m_ticket_number{};
+        /// ID of broker managing ticket.
+        broker_id_type m_broker_id{};
+        /// Keys for which to request locks, and the lock type for each.
+        std::vector<lock_request_type> m_locks;
+        /// Flag for when these are the first locks.
+        bool m_first_lock{false};
+    };
+
+    /// Read request message.
+    struct read_request {
+        /// Keys to read.
+        std::vector<key_type> m_keys;
+    };
+
+    /// Load request message.
+    struct load_request {
+        /// Keys and values to write.
+        state_update_type m_state;
+    };
+
     /// Prepare request message.
     struct prepare_request {
         /// Ticket number.
@@ -40,6 +64,16 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         ticket_number_type m_ticket_number;
     };
 
+    /// One-phase commit request message.
+    struct one_phase_commit_request {
+        /// Ticket number.
+        ticket_number_type m_ticket_number{};
+        /// State updates to apply.
+        state_update_type m_state_updates;
+        /// ID of broker managing ticket.
+        broker_id_type m_broker_id{};
+    };
+
     /// Rollback request message.
     struct rollback_request {
         /// Ticket number.
@@ -56,6 +90,10 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
     struct get_tickets_request {
         /// Broker ID.
         broker_id_type m_broker_id;
+        /// Lowest ticket number to return.
+        ticket_number_type m_start{};
+        /// Maximum number of tickets to return.
+        uint64_t m_max_tickets{};
     };
 
     /// RPC request message type.
@@ -64,11 +102,17 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                                  commit_request,
                                  rollback_request,
                                  finish_request,
-                                 get_tickets_request>;
+                                 get_tickets_request,
+                                 try_lock_batch_request,
+                                 read_request,
+                                 one_phase_commit_request,
+                                 load_request>;
     /// RPC response message type.
     using response = std::variant<interface::try_lock_return_type,
                                   interface::prepare_return_type,
-                                  interface::get_tickets_return_type>;
+                                  interface::get_tickets_return_type,
+                                  interface::try_lock_batch_return_type,
+                                  interface::read_return_type>;
 
     /// Message for replicating a prepare request.
     struct replicated_prepare_request {
@@ -80,20 +124,47 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         replicated_shard_interface::state_type m_state_update;
     };
 
+    /// Message for replicating a load request.
+    struct replicated_load_request {
+        /// Keys and values to store.
+        replicated_shard_interface::state_type m_state;
+    };
+
     /// Message for retrieving unfinished tickets from the replicated state
     /// machine.
     struct replicated_get_tickets_request {};
 
+    /// Ticket request which can be replicated as part of a batch.
+    using replicated_ticket_request
+        = std::variant<replicated_prepare_request,
+                       commit_request,
+                       finish_request>;
+
+    /// Message for replicating the requests of many tickets in a single log
+    /// entry.
+    struct replicated_batch_request {
+        /// Requests to apply, in order.
+        std::vector<replicated_ticket_request> m_requests;
+    };
+
     /// Shard replicated state machine request type.
     using replicated_request = std::variant<replicated_prepare_request,
                                             commit_request,
                                             finish_request,
-                                            replicated_get_tickets_request>;
+                                            replicated_get_tickets_request,
+                                            replicated_batch_request,
+                                            replicated_load_request>;
+
+    /// Results of the requests in a \ref replicated_batch_request, in the
+    /// same order.
+    using replicated_batch_response
+        = std::vector<replicated_shard_interface::return_type>;
 
     /// Shard replicated state machine response type.
     using replicated_response
         = std::variant<replicated_shard_interface::return_type,
-                       replicated_shard_interface::get_tickets_return_type>;
+                       replicated_shard_interface::get_tickets_return_type,
+                       replicated_batch_response>;
 }
 
 #endif
@@ -52,6 +52,18 @@ namespace cbdc::parsec::runtime_locking_shard {
         return true;
     }
 
+    auto replicated_shard::load(state_type state,
+                                callback_type result_callback) -> bool {
+        {
+            std::unique_lock l(m_mut);
+            for(auto&& [k, v] : state) {
+                m_state[k] = std::move(v);
+            }
+        }
+        result_callback(std::nullopt);
+        return true;
+    }
+
     auto replicated_shard::get_tickets(
         get_tickets_callback_type result_callback) const -> bool {
         auto ret = [&]() -> get_tickets_return_type {
@@ -32,6 +32,11 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto finish(ticket_number_type ticket_number,
                     callback_type result_callback) -> bool override;
 
+        /// \copydoc replicated_shard_interface::load
+        /// \return true.
+        auto load(state_type state, callback_type result_callback)
+            -> bool override;
+
         /// \copydoc replicated_shard_interface::get_tickets
         /// \return true.
         auto get_tickets(get_tickets_callback_type result_callback) const
@@ -12,62 +12,137 @@
 
 namespace cbdc::parsec::runtime_locking_shard {
     replicated_shard_client::replicated_shard_client(
-        std::shared_ptr<raft::node> raft_node)
-        : m_raft(std::move(raft_node)) {}
+        std::shared_ptr<raft::node> raft_node,
+        replicated_shard_client_options opts)
+        : m_raft(std::move(raft_node)),
+          m_opts(opts) {
+        m_flush_thread = std::thread([&]() {
+            flush_loop();
+        });
+    }
+
+    replicated_shard_client::~replicated_shard_client() {
+        {
+            std::unique_lock l(m_mut);
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if(m_flush_thread.joinable()) {
+            m_flush_thread.join();
+        }
+    }
 
     auto replicated_shard_client::prepare(ticket_number_type ticket_number,
                                           broker_id_type broker_id,
                                           state_type state_update,
                                           callback_type result_callback)
         -> bool {
-        auto req = rpc::replicated_prepare_request{ticket_number,
-                                                   broker_id,
-                                                   std::move(state_update)};
-        auto success = replicate_request(
-            std::move(req),
-            [result_callback](
-                std::optional<rpc::replicated_response> maybe_res) {
-                if(!maybe_res.has_value()) {
-                    result_callback(error_code::internal_error);
-                    return;
-                }
-                auto&& res = maybe_res.value();
-                assert(std::holds_alternative<
-                       replicated_shard_interface::return_type>(res));
-                auto&& resp_val
-                    = std::get<replicated_shard_interface::return_type>(res);
-                result_callback(resp_val);
-            });
-        return success;
+        return enqueue(rpc::replicated_prepare_request{ticket_number,
+                                                       broker_id,
+                                                       std::move(
+                                                           state_update)},
+                       std::move(result_callback));
     }
 
     auto replicated_shard_client::commit(ticket_number_type ticket_number,
                                          callback_type result_callback)
         -> bool {
-        auto req = rpc::commit_request{ticket_number};
+        return enqueue(rpc::commit_request{ticket_number},
+                       std::move(result_callback));
+    }
+
+    auto replicated_shard_client::finish(ticket_number_type ticket_number,
+                                         callback_type result_callback)
+        -> bool {
+        return enqueue(rpc::finish_request{ticket_number},
+                       std::move(result_callback));
+    }
+
+    auto
+    replicated_shard_client::enqueue(rpc::replicated_ticket_request req,
+                                     callback_type result_callback) -> bool {
+        if(!m_raft->is_leader()) {
+            return false;
+        }
+        auto full = false;
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return false;
+            }
+            m_requests.emplace_back(std::move(req));
+            m_callbacks.emplace_back(std::move(result_callback));
+            full = m_requests.size() >= m_opts.m_max_batch_size;
+        }
+        if(full) {
+            m_cv.notify_one();
+        }
+        return true;
+    }
+
+    void replicated_shard_client::flush_loop() {
+        std::unique_lock l(m_mut);
+        for(;;) {
+            if(m_requests.empty()) {
+                if(!m_running) {
+                    return;
+                }
+                m_cv.wait(l);
+                continue;
+            }
+            if(m_running && m_requests.size() < m_opts.m_max_batch_size) {
+                // Give concurrent tickets a chance to join the batch
+                m_cv.wait_for(l, m_opts.m_max_delay, [&]() {
+                    return !m_running
+                        || m_requests.size() >= m_opts.m_max_batch_size;
+                });
+            }
+            auto batch = rpc::replicated_batch_request{std::move(m_requests)};
+            auto callbacks = std::move(m_callbacks);
+            m_requests.clear();
+            m_callbacks.clear();
+            l.unlock();
+            replicate_batch(std::move(batch), std::move(callbacks));
+            l.lock();
+        }
+    }
+
+    void replicated_shard_client::replicate_batch(
+        rpc::replicated_batch_request batch,
+        std::vector<callback_type> callbacks) {
+        auto cbs = std::make_shared<std::vector<callback_type>>(
+            std::move(callbacks));
+        auto fail_all = [](std::vector<callback_type>& c) {
+            for(auto& cb : c) {
+                cb(error_code::internal_error);
+            }
+        };
         auto success = replicate_request(
-            req,
-            [result_callback](
-                std::optional<rpc::replicated_response> maybe_res) {
+            std::move(batch),
+            [cbs, fail_all](std::optional<rpc::replicated_response> maybe_res) {
                 if(!maybe_res.has_value()) {
-                    result_callback(error_code::internal_error);
+                    fail_all(*cbs);
                     return;
                 }
                 auto&& res = maybe_res.value();
-                assert(std::holds_alternative<
-                       replicated_shard_interface::return_type>(res));
-                auto&& resp_val
-                    = std::get<replicated_shard_interface::return_type>(res);
-                result_callback(resp_val);
+                assert(std::holds_alternative<rpc::replicated_batch_response>(
+                    res));
+                auto&& results = std::get<rpc::replicated_batch_response>(res);
+                assert(results.size() == cbs->size());
+                for(size_t i{0}; i < cbs->size(); i++) {
+                    (*cbs)[i](results[i]);
+                }
             });
-        return success;
+        if(!success) {
+            fail_all(*cbs);
+        }
     }
 
-    auto replicated_shard_client::finish(ticket_number_type ticket_number,
-                                         callback_type result_callback)
+    auto replicated_shard_client::load(state_type state,
+                                       callback_type result_callback)
         -> bool {
-        auto req = rpc::finish_request{ticket_number};
-        auto success = replicate_request(
+        auto req = rpc::replicated_load_request{std::move(state)};
+        return replicate_request(
             req,
             [result_callback](
                 std::optional<rpc::replicated_response> maybe_res) {
@@ -78,11 +153,9 @@ namespace cbdc::parsec::runtime_locking_shard {
                 auto&& res = maybe_res.value();
                 assert(std::holds_alternative<
                        replicated_shard_interface::return_type>(res));
-                auto&& resp_val
-                    = std::get<replicated_shard_interface::return_type>(res);
-                result_callback(resp_val);
+                result_callback(
+                    std::get<replicated_shard_interface::return_type>(res));
             });
-        return success;
     }
 
     auto replicated_shard_client::get_tickets(
@@ -8,46 +8,94 @@
 
 #include "messages.hpp"
 #include "replicated_shard_interface.hpp"
+#include "util/common/config.hpp"
 #include "util/raft/node.hpp"
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace cbdc::parsec::runtime_locking_shard {
+    /// Group commit settings for a \ref replicated_shard_client.
+    struct replicated_shard_client_options {
+        /// Number of pending requests which triggers replicating a batch.
+        size_t m_max_batch_size{
+            cbdc::config::defaults::shard_group_commit_batch};
+        /// Longest time a pending request waits for others to join its
+        /// batch before the batch is replicated.
+        std::chrono::microseconds m_max_delay{std::chrono::microseconds(
+            cbdc::config::defaults::shard_group_commit_delay_us)};
+    };
+
     /// Client for asynchronously interacting with a raft replicated shard on
-    /// the leader node of the cluster.
+    /// the leader node of the cluster. Prepare, commit and finish requests
+    /// from concurrent tickets are coalesced into a single raft log entry,
+    /// so they share the cost of one round of replication. A background
+    /// thread replicates the pending requests once the batch is full or
+    /// its first request has waited for the maximum delay, and calls each
+    /// request's callback with its result once the entry is applied.
     class replicated_shard_client final : public replicated_shard_interface {
       public:
-        /// Constructs a shard client.
+        /// Constructs a shard client and starts its batching thread.
         /// \param raft_node pointer to the raft node to control.
+        /// \param opts group commit settings.
         explicit replicated_shard_client(
-            std::shared_ptr<raft::node> raft_node);
+            std::shared_ptr<raft::node> raft_node,
+            replicated_shard_client_options opts = {});
+
+        /// Destructor. Replicates any pending requests and stops the
+        /// batching thread.
+        ~replicated_shard_client() override;
 
-        /// Replicates a prepare request in the state machine and returns the
-        /// response via a callback function.
+        replicated_shard_client(const replicated_shard_client&) = delete;
+        auto operator=(const replicated_shard_client&)
+            -> replicated_shard_client& = delete;
+        replicated_shard_client(replicated_shard_client&&) = delete;
+        auto operator=(replicated_shard_client&&)
+            -> replicated_shard_client& = delete;
+
+        /// Queues a prepare request for replication in the state machine and
+        /// returns the response via a callback function.
         /// \param ticket_number ticket to prepare.
         /// \param broker_id broker managing the ticket.
         /// \param state_update keys and values to update after commit.
         /// \param result_callback function to call with prepare result.
-        /// \return true if request replication was initiated successfully.
+        /// \return true if the request was queued for replication, false if
+        ///         this node is not the leader or the client is stopping.
         auto prepare(ticket_number_type ticket_number,
                      broker_id_type broker_id,
                      state_type state_update,
                      callback_type result_callback) -> bool override;
 
-        /// Replicates a commit request in the state machine and returns the
-        /// response via a callback function.
+        /// Queues a commit request for replication in the state machine and
+        /// returns the response via a callback function.
         /// \param ticket_number ticket to commit.
         /// \param result_callback function to call with commit result.
-        /// \return true if request replication was initiated successfully.
+        /// \return true if the request was queued for replication, false if
+        ///         this node is not the leader or the client is stopping.
         auto commit(ticket_number_type ticket_number,
                     callback_type result_callback) -> bool override;
 
-        /// Replicates a finish request in the state machine and returns the
-        /// response via a callback function.
+        /// Queues a finish request for replication in the state machine and
+        /// returns the response via a callback function.
         /// \param ticket_number ticket to finish.
         /// \param result_callback function to call with finish result.
-        /// \return true if request replication was initiated successfully.
+        /// \return true if the request was queued for replication, false if
+        ///         this node is not the leader or the client is stopping.
         auto finish(ticket_number_type ticket_number,
                     callback_type result_callback) -> bool override;
 
+        /// Replicates a load request in the state machine and returns the
+        /// response via a callback function. Loads are not batched with
+        /// ticket requests, each is replicated as its own log entry.
+        /// \param state keys and values to store.
+        /// \param result_callback function to call with load result.
+        /// \return true if request replication was initiated successfully.
+        auto load(state_type state, callback_type result_callback)
+            -> bool override;
+
         /// Replicates a get tickets request in the state machine and returns
         /// the response via a callback function.
         /// \param result_callback function to call with the tickets held by
@@ -59,6 +107,22 @@ namespace cbdc::parsec::runtime_locking_shard {
 
       private:
         std::shared_ptr<raft::node> m_raft;
+        replicated_shard_client_options m_opts;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<rpc::replicated_ticket_request> m_requests;
+        std::vector<callback_type> m_callbacks;
+        bool m_running{true};
+        std::thread m_flush_thread;
+
+        auto enqueue(rpc::replicated_ticket_request req,
+                     callback_type result_callback) -> bool;
+
+        void flush_loop();
+
+        void replicate_batch(rpc::replicated_batch_request batch,
+                             std::vector<callback_type> callbacks);
 
         auto replicate_request(
             const rpc::replicated_request& req,
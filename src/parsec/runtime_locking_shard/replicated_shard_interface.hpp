@@ -94,6 +94,15 @@ namespace cbdc::parsec::runtime_locking_shard {
                             callback_type result_callback) -> bool
             = 0;
 
+        /// Stores keys and values directly in the state machine, outside of
+        /// any ticket. Used to seed the shard with initial state.
+        /// \param state keys and values to store.
+        /// \param result_callback function to call with load result.
+        /// \return true if operation was initiated successfully.
+        virtual auto load(state_type state, callback_type result_callback)
+            -> bool
+            = 0;
+
         /// Return type from a get tickets operation. Either a map of ticket
         /// states or an error code.
         using get_tickets_return_type = std::variant<tickets_type, error_code>;
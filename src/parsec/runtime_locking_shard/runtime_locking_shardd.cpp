@@ -5,6 +5,7 @@
 
 #include "controller.hpp"
 #include "util.hpp"
+#include "util/common/affinity.hpp"
 #include "util/common/logging.hpp"
 
 #include <csignal>
@@ -18,6 +19,10 @@ auto main(int argc, char** argv) -> int {
         return 1;
     }
     log->set_loglevel(cfg->m_loglevel);
+    cbdc::set_thread_cpus(cfg->m_thread_cpus);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        log->warn("Failed to pin main thread to its CPUs");
+    }
 
     if(cfg->m_shard_endpoints.size() <= cfg->m_component_id) {
         log->error("No endpoint for component id");
@@ -41,7 +46,10 @@ auto main(int argc, char** argv) -> int {
         *cfg->m_node_id,
         cfg->m_shard_endpoints[cfg->m_component_id][*cfg->m_node_id],
         raft_endpoints,
-        log);
+        log,
+        cbdc::parsec::runtime_locking_shard::replicated_shard_client_options{
+            cfg->m_shard_group_commit_batch,
+            std::chrono::microseconds(cfg->m_shard_group_commit_delay_us)});
     if(!controller.init()) {
         log->error("Failed to start raft server");
         return 1;
@@ -49,9 +57,11 @@ auto main(int argc, char** argv) -> int {
 
     static auto running = std::atomic_bool{true};
 
-    std::signal(SIGINT, [](int /* signal */) {
+    auto stop = [](int /* signal */) {
         running = false;
-    });
+    };
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
 
     log->info("Shard running");
 
@@ -60,5 +70,7 @@ auto main(int argc, char** argv) -> int {
     }
 
     log->info("Shutting down...");
+
+    controller.transfer_leadership();
     return 0;
 }
@@ -7,6 +7,8 @@
 
 #include "util/common/variant_overloaded.hpp"
 
+#include <algorithm>
+
 namespace cbdc::parsec::runtime_locking_shard::rpc {
     server::server(
         std::shared_ptr<logging::log> logger,
@@ -40,6 +42,31 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                             callback(std::move(ret));
                         });
                 },
+                [&](const rpc::try_lock_batch_request& msg) {
+                    return m_impl->try_lock_batch(
+                        msg.m_ticket_number,
+                        msg.m_broker_id,
+                        msg.m_locks,
+                        msg.m_first_lock,
+                        [callback](interface::try_lock_batch_return_type ret) {
+                            callback(std::move(ret));
+                        });
+                },
+                [&](const rpc::read_request& msg) {
+                    return m_impl->read(
+                        msg.m_keys,
+                        [callback](interface::read_return_type ret) {
+                            callback(std::move(ret));
+                        });
+                },
+                [&](const rpc::load_request& msg) {
+                    return m_repl->load(
+                        msg.m_state,
+                        [this, callback, msg](
+                            replicated_shard_interface::return_type ret) {
+                            handle_load(ret, msg, callback);
+                        });
+                },
                 [&](const rpc::prepare_request& msg) {
                     return m_impl->prepare(
                         msg.m_ticket_number,
@@ -58,6 +85,18 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                             handle_commit(ret, msg, callback);
                         });
                 },
+                [&](const rpc::one_phase_commit_request& msg) {
+                    return m_impl->prepare(
+                        msg.m_ticket_number,
+                        msg.m_broker_id,
+                        msg.m_state_updates,
+                        [this, callback, msg](
+                            interface::prepare_return_type ret) {
+                            handle_one_phase_commit(std::move(ret),
+                                                    msg,
+                                                    callback);
+                        });
+                },
                 [&](rpc::rollback_request msg) {
                     return m_repl->finish(
                         msg.m_ticket_number,
@@ -75,8 +114,16 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                         });
                 },
                 [&](rpc::get_tickets_request msg) {
+                    // The page size comes from the remote broker, so keep
+                    // it within what the shard is willing to return
+                    const auto max_tickets = std::clamp<uint64_t>(
+                        msg.m_max_tickets,
+                        1,
+                        max_tickets_page);
                     return m_impl->get_tickets(
                         msg.m_broker_id,
+                        msg.m_start,
+                        static_cast<size_t>(max_tickets),
                         [callback](interface::get_tickets_return_type ret) {
                             callback(std::move(ret));
                         });
@@ -132,6 +179,67 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
         }
     }
 
+    void server::handle_load(replicated_shard_interface::return_type ret,
+                             const rpc::load_request& msg,
+                             const callback_type& callback) {
+        if(ret.has_value()) {
+            m_log->error("Error response during load replication");
+            callback(error_code::internal_error);
+            return;
+        }
+
+        auto success
+            = m_impl->load(msg.m_state,
+                           [callback](interface::load_return_type res) {
+                               callback(std::move(res));
+                           });
+        if(!success) {
+            m_log->error("Error initiating load with internal shard");
+            callback(error_code::internal_error);
+        }
+    }
+
+    void server::handle_one_phase_commit(
+        interface::prepare_return_type ret,
+        const rpc::one_phase_commit_request& msg,
+        const callback_type& callback) {
+        if(ret.has_value()) {
+            m_log->trace("Error response during one-phase commit");
+            callback(std::move(ret));
+            return;
+        }
+
+        // The replicated shard client batches requests in the order they
+        // are made, so the commit is replicated after the prepare and
+        // usually in the same log entry. If replicating the prepare fails,
+        // the commit fails too as the ticket is not prepared.
+        auto success = m_repl->prepare(
+            msg.m_ticket_number,
+            msg.m_broker_id,
+            msg.m_state_updates,
+            [this](replicated_shard_interface::return_type res) {
+                if(res.has_value()) {
+                    m_log->error("Error response during prepare replication");
+                }
+            });
+        if(!success) {
+            m_log->error("Error replicating prepare");
+            callback(error_code::internal_error);
+            return;
+        }
+
+        auto req = rpc::commit_request{msg.m_ticket_number};
+        success = m_repl->commit(
+            req.m_ticket_number,
+            [this, callback, req](replicated_shard_interface::return_type res) {
+                handle_commit(res, req, callback);
+            });
+        if(!success) {
+            m_log->error("Error replicating commit");
+            callback(error_code::internal_error);
+        }
+    }
+
     void server::do_rollback(replicated_shard_interface::return_type ret,
                              rpc::rollback_request msg,
                              const callback_type& callback) {
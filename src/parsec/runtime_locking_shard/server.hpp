@@ -28,6 +28,9 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
             std::unique_ptr<cbdc::rpc::async_server<request, response>> srv);
 
       private:
+        /// Largest page of tickets returned for one get_tickets request.
+        static constexpr uint64_t max_tickets_page = 10000;
+
         std::shared_ptr<logging::log> m_log;
         std::shared_ptr<interface> m_impl;
         std::shared_ptr<replicated_shard_interface> m_repl;
@@ -46,6 +49,14 @@ namespace cbdc::parsec::runtime_locking_shard::rpc {
                            rpc::commit_request msg,
                            const callback_type& callback);
 
+        void handle_one_phase_commit(interface::prepare_return_type ret,
+                                     const rpc::one_phase_commit_request& msg,
+                                     const callback_type& callback);
+
+        void handle_load(replicated_shard_interface::return_type ret,
+                         const rpc::load_request& msg,
+                         const callback_type& callback);
+
         void do_rollback(replicated_shard_interface::return_type ret,
                          rpc::rollback_request msg,
                          const callback_type& callback);
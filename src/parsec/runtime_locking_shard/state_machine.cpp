@@ -55,39 +55,83 @@ namespace cbdc::parsec::runtime_locking_shard {
 
     auto state_machine::process_request(const rpc::replicated_request& req)
         -> rpc::replicated_response {
-        auto ret = rpc::replicated_response();
-        [[maybe_unused]] auto success = std::visit(
+        return std::visit(
             overloaded{
-                [&](const rpc::replicated_prepare_request& msg) {
-                    return m_shard->prepare(
-                        msg.m_ticket_number,
-                        msg.m_broker_id,
-                        msg.m_state_update,
-                        [&](replicated_shard::return_type res) {
-                            ret = res;
-                        });
-                },
-                [&](rpc::commit_request msg) {
-                    return m_shard->commit(
-                        msg.m_ticket_number,
-                        [&](replicated_shard::return_type res) {
+                [&](const rpc::replicated_get_tickets_request& /* msg */)
+                    -> rpc::replicated_response {
+                    auto ret = rpc::replicated_response();
+                    [[maybe_unused]] auto success = m_shard->get_tickets(
+                        [&](replicated_shard::get_tickets_return_type res) {
                             ret = res;
                         });
+                    assert(success);
+                    return ret;
                 },
-                [&](rpc::finish_request msg) {
-                    return m_shard->finish(
-                        msg.m_ticket_number,
-                        [&](replicated_shard::return_type res) {
-                            ret = res;
-                        });
+                [&](const rpc::replicated_batch_request& msg)
+                    -> rpc::replicated_response {
+                    auto ret = rpc::replicated_batch_response();
+                    ret.reserve(msg.m_requests.size());
+                    for(const auto& ticket_req : msg.m_requests) {
+                        ret.push_back(std::visit(
+                            [&](const auto& r) {
+                                return apply(r);
+                            },
+                            ticket_req));
+                    }
+                    return ret;
                 },
-                [&](rpc::replicated_get_tickets_request /* msg */) {
-                    return m_shard->get_tickets(
-                        [&](replicated_shard::get_tickets_return_type res) {
-                            ret = res;
-                        });
+                [&](const auto& msg) -> rpc::replicated_response {
+                    return apply(msg);
                 }},
             req);
+    }
+
+    auto state_machine::apply(const rpc::replicated_prepare_request& req)
+        -> replicated_shard::return_type {
+        auto ret = replicated_shard::return_type();
+        [[maybe_unused]] auto success
+            = m_shard->prepare(req.m_ticket_number,
+                               req.m_broker_id,
+                               req.m_state_update,
+                               [&](replicated_shard::return_type res) {
+                                   ret = res;
+                               });
+        assert(success);
+        return ret;
+    }
+
+    auto state_machine::apply(const rpc::commit_request& req)
+        -> replicated_shard::return_type {
+        auto ret = replicated_shard::return_type();
+        [[maybe_unused]] auto success
+            = m_shard->commit(req.m_ticket_number,
+                              [&](replicated_shard::return_type res) {
+                                  ret = res;
+                              });
+        assert(success);
+        return ret;
+    }
+
+    auto state_machine::apply(const rpc::finish_request& req)
+        -> replicated_shard::return_type {
+        auto ret = replicated_shard::return_type();
+        [[maybe_unused]] auto success
+            = m_shard->finish(req.m_ticket_number,
+                              [&](replicated_shard::return_type res) {
+                                  ret = res;
+                              });
+        assert(success);
+        return ret;
+    }
+
+    auto state_machine::apply(const rpc::replicated_load_request& req)
+        -> replicated_shard::return_type {
+        auto ret = replicated_shard::return_type();
+        [[maybe_unused]] auto success
+            = m_shard->load(req.m_state,
+                            [&](replicated_shard::return_type res) {
+                                ret = res;
+                            });
         assert(success);
         return ret;
     }
@@ -53,6 +53,15 @@ namespace cbdc::parsec::runtime_locking_shard {
         auto process_request(const rpc::replicated_request& req)
             -> rpc::replicated_response;
 
+        auto apply(const rpc::replicated_prepare_request& req)
+            -> replicated_shard::return_type;
+        auto apply(const rpc::commit_request& req)
+            -> replicated_shard::return_type;
+        auto apply(const rpc::finish_request& req)
+            -> replicated_shard::return_type;
+        auto apply(const rpc::replicated_load_request& req)
+            -> replicated_shard::return_type;
+
         std::atomic<uint64_t> m_last_committed_idx{0};
 
         std::shared_ptr<replicated_shard> m_shard{
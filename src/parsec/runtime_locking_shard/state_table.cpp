@@ -0,0 +1,293 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "state_table.hpp"
+
+#include "util/common/hashmap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+namespace cbdc::parsec::runtime_locking_shard {
+    namespace {
+        /// Smallest index the table allocates, in slots.
+        constexpr size_t min_slots = 16;
+
+        /// Number of slots needed to hold count keys at a load factor of at
+        /// most 3/4. Always a power of two.
+        auto slots_for(size_t count) -> size_t {
+            auto slots = min_slots;
+            while(slots / 4 * 3 < count) {
+                slots *= 2;
+            }
+            return slots;
+        }
+    }
+
+    auto state_table::lock_state_type::queue_begin()
+        -> std::vector<queued_lock_type>::iterator {
+        return m_queue.begin() + static_cast<std::ptrdiff_t>(m_queue_head);
+    }
+
+    auto state_table::lock_state_type::find_queued(
+        ticket_number_type ticket_number) -> queued_lock_type* {
+        auto it = std::lower_bound(
+            queue_begin(),
+            m_queue.end(),
+            ticket_number,
+            [](const queued_lock_type& req, ticket_number_type tn) {
+                return req.m_ticket_number < tn;
+            });
+        if(it == m_queue.end() || it->m_ticket_number != ticket_number) {
+            return nullptr;
+        }
+        return &*it;
+    }
+
+    void state_table::lock_state_type::enqueue(queued_lock_type req) {
+        // Tickets mostly queue in ticket number order, so insert from the
+        // back
+        auto it = m_queue.end();
+        if(it != queue_begin()
+           && std::prev(it)->m_ticket_number > req.m_ticket_number) {
+            it = std::lower_bound(
+                queue_begin(),
+                m_queue.end(),
+                req.m_ticket_number,
+                [](const queued_lock_type& r, ticket_number_type tn) {
+                    return r.m_ticket_number < tn;
+                });
+        }
+        assert(it == m_queue.end()
+               || it->m_ticket_number != req.m_ticket_number);
+        m_queue.insert(it, std::move(req));
+    }
+
+    auto state_table::lock_state_type::dequeue(
+        ticket_number_type ticket_number) -> queued_lock_type {
+        auto* req = find_queued(ticket_number);
+        assert(req != nullptr);
+        if(req == front()) {
+            return pop_front();
+        }
+        auto ret = std::move(*req);
+        m_queue.erase(m_queue.begin() + (req - m_queue.data()));
+        return ret;
+    }
+
+    auto state_table::lock_state_type::front() -> queued_lock_type* {
+        if(m_queue_head == m_queue.size()) {
+            return nullptr;
+        }
+        return &m_queue[m_queue_head];
+    }
+
+    auto state_table::lock_state_type::pop_front() -> queued_lock_type {
+        assert(m_queue_head < m_queue.size());
+        auto ret = std::move(m_queue[m_queue_head]);
+        m_queue_head++;
+        if(m_queue_head == m_queue.size()) {
+            m_queue.clear();
+            m_queue_head = 0;
+        } else if(m_queue_head * 2 >= m_queue.size()) {
+            // Drop the popped entries once they are at least half the
+            // vector, so each entry is shifted a constant number of times
+            // on average
+            m_queue.erase(m_queue.begin(), queue_begin());
+            m_queue_head = 0;
+        }
+        return ret;
+    }
+
+    auto state_table::lock_state_type::queue_size() const -> size_t {
+        return m_queue.size() - m_queue_head;
+    }
+
+    void
+    state_table::lock_state_type::add_reader(ticket_number_type ticket_number) {
+        auto it = std::lower_bound(m_readers.begin(),
+                                   m_readers.end(),
+                                   ticket_number);
+        if(it == m_readers.end() || *it != ticket_number) {
+            m_readers.insert(it, ticket_number);
+        }
+    }
+
+    void state_table::lock_state_type::remove_reader(
+        ticket_number_type ticket_number) {
+        auto it = std::lower_bound(m_readers.begin(),
+                                   m_readers.end(),
+                                   ticket_number);
+        if(it != m_readers.end() && *it == ticket_number) {
+            m_readers.erase(it);
+        }
+    }
+
+    auto state_table::lock_state_type::younger_holders(
+        ticket_number_type ticket_number,
+        lock_type type) const -> std::vector<ticket_number_type> {
+        auto ret = std::vector<ticket_number_type>();
+        // Write requests wait on readers
+        if(type == lock_type::write) {
+            ret.assign(std::upper_bound(m_readers.begin(),
+                                        m_readers.end(),
+                                        ticket_number),
+                       m_readers.end());
+        }
+        // All requests wait on the writer
+        if(m_writer.has_value() && ticket_number < m_writer.value()) {
+            ret.push_back(m_writer.value());
+        }
+        return ret;
+    }
+
+    auto state_table::hash(const key_type& key) -> uint64_t {
+        return hashing::const_sip_hash<key_type>{}(key);
+    }
+
+    auto state_table::home_slot(uint64_t h) const -> size_t {
+        // Callers select a table by the low bits of the hash, so spread all
+        // of its bits over the slot index with a Fibonacci multiplier
+        constexpr uint64_t multiplier = 0x9e3779b97f4a7c15;
+        return static_cast<size_t>((h * multiplier) >> m_shift);
+    }
+
+    auto state_table::key_equals(const element_type& elem,
+                                 const key_type& key) const -> bool {
+        return elem.m_key_size == key.size()
+            && (key.size() == 0
+                || std::memcmp(&m_keys[elem.m_key_offset],
+                               key.data(),
+                               key.size())
+                       == 0);
+    }
+
+    auto state_table::find(const key_type& key, uint64_t h)
+        -> element_type* {
+        if(m_slots.empty()) {
+            return nullptr;
+        }
+        const auto mask = m_slots.size() - 1;
+        for(auto i = home_slot(h);; i = (i + 1) & mask) {
+            const auto& slot = m_slots[i];
+            if(slot.m_element == npos) {
+                return nullptr;
+            }
+            if(slot.m_hash == h) {
+                auto& elem = m_elements[slot.m_element];
+                if(key_equals(elem, key)) {
+                    return &elem;
+                }
+            }
+        }
+    }
+
+    auto state_table::get_or_insert(const key_type& key, uint64_t h)
+        -> element_type& {
+        if(auto* elem = find(key, h)) {
+            return *elem;
+        }
+        if(m_slots.size() / 4 * 3 < m_elements.size() + 1) {
+            rehash(slots_for(m_elements.size() + 1));
+        }
+
+        auto& elem = m_elements.emplace_back();
+        elem.m_key_offset = m_keys.size();
+        elem.m_key_size = static_cast<uint32_t>(key.size());
+        elem.m_value_offset = m_values.size();
+        m_keys.insert(m_keys.end(), key.c_ptr(), key.c_ptr() + key.size());
+
+        const auto mask = m_slots.size() - 1;
+        auto i = home_slot(h);
+        while(m_slots[i].m_element != npos) {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = slot_type{h, m_elements.size() - 1};
+        return elem;
+    }
+
+    auto state_table::value(const element_type& elem) const -> value_type {
+        auto ret = value_type();
+        if(elem.m_value_size > 0) {
+            ret.append(&m_values[elem.m_value_offset], elem.m_value_size);
+        }
+        return ret;
+    }
+
+    void state_table::set_value(element_type& elem, const value_type& val) {
+        const auto size = static_cast<uint32_t>(val.size());
+        if(size > elem.m_value_capacity) {
+            m_unused_value_bytes += elem.m_value_capacity;
+            elem.m_value_offset = m_values.size();
+            elem.m_value_capacity = size;
+            m_values.resize(m_values.size() + size);
+        }
+        if(size > 0) {
+            std::memcpy(&m_values[elem.m_value_offset], val.data(), size);
+        }
+        elem.m_value_size = size;
+
+        if(m_unused_value_bytes > min_compact_bytes
+           && m_unused_value_bytes > m_values.size() / 2) {
+            compact_values();
+        }
+    }
+
+    void state_table::compact_values() {
+        auto values = std::vector<unsigned char>();
+        values.reserve(m_values.size() - m_unused_value_bytes);
+        for(auto& elem : m_elements) {
+            const auto offset = values.size();
+            values.insert(values.end(),
+                          m_values.begin()
+                              + static_cast<std::ptrdiff_t>(
+                                  elem.m_value_offset),
+                          m_values.begin()
+                              + static_cast<std::ptrdiff_t>(
+                                  elem.m_value_offset + elem.m_value_size));
+            elem.m_value_offset = offset;
+            elem.m_value_capacity = elem.m_value_size;
+        }
+        m_values = std::move(values);
+        m_unused_value_bytes = 0;
+    }
+
+    void state_table::rehash(size_t slot_count) {
+        auto old_slots = std::move(m_slots);
+        m_slots = std::vector<slot_type>(slot_count);
+        m_shift = 64;
+        for(auto n = slot_count; n > 1; n >>= 1) {
+            m_shift--;
+        }
+        const auto mask = slot_count - 1;
+        for(const auto& slot : old_slots) {
+            if(slot.m_element == npos) {
+                continue;
+            }
+            auto i = home_slot(slot.m_hash);
+            while(m_slots[i].m_element != npos) {
+                i = (i + 1) & mask;
+            }
+            m_slots[i] = slot;
+        }
+    }
+
+    void state_table::reserve(size_t count) {
+        const auto slots = slots_for(count);
+        if(slots > m_slots.size()) {
+            rehash(slots);
+        }
+    }
+
+    auto state_table::size() const -> size_t {
+        return m_elements.size();
+    }
+
+    auto state_table::empty() const -> bool {
+        return m_elements.empty();
+    }
+}
@@ -0,0 +1,202 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PARSEC_RUNTIME_LOCKING_SHARD_STATE_TABLE_H_
+#define OPENCBDC_TX_SRC_PARSEC_RUNTIME_LOCKING_SHARD_STATE_TABLE_H_
+
+#include "interface.hpp"
+#include "util/common/small_vector.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace cbdc::parsec::runtime_locking_shard {
+    /// \brief Compact store of the keys, values and lock state of a locking
+    ///        shard.
+    ///
+    /// Key and value bytes live in two arenas rather than in a heap buffer
+    /// each. Elements are allocated from a slab and never move, so
+    /// references to them stay valid until the table is destroyed. The
+    /// index is an open-addressing table of precomputed key hashes and
+    /// element indices probed linearly, so most lookups compare a single
+    /// hash before touching the key bytes. Lock state is held inline in
+    /// each element, with a small vector of readers and a vector of queued
+    /// requests sorted by ticket number, in place of a hash set and a
+    /// tree.
+    ///
+    /// A value which outgrows its space in the arena is moved to the end
+    /// of the arena, and the arena is compacted once most of it is unused.
+    ///
+    /// \warning Not thread safe.
+    class state_table {
+      public:
+        /// A lock request waiting in a key's queue.
+        struct queued_lock_type {
+            ticket_number_type m_ticket_number{};
+            lock_type m_type{};
+            interface::try_lock_callback_type m_callback;
+        };
+
+        /// \brief Readers-writer lock on a key, and the requests queuing
+        ///        for it.
+        ///
+        /// Readers and queued requests are kept in ticket number order, so
+        /// the holders a request waits on, and the next request to grant,
+        /// are found without scanning the rest. Granted requests are popped
+        /// by advancing the head of the queue rather than shifting the
+        /// requests behind them.
+        struct lock_state_type {
+            std::optional<ticket_number_type> m_writer;
+            /// Readers in ascending ticket number order.
+            small_vector<ticket_number_type, 2> m_readers;
+
+            /// Returns the request the given ticket has queued.
+            /// \param ticket_number ticket number.
+            /// \return queued request, or nullptr if there is none.
+            auto find_queued(ticket_number_type ticket_number)
+                -> queued_lock_type*;
+
+            /// Queues a request in ticket number order. The ticket must not
+            /// already have a request queued.
+            /// \param req request to queue.
+            void enqueue(queued_lock_type req);
+
+            /// Removes the request the given ticket has queued. The ticket
+            /// must have a request queued.
+            /// \param ticket_number ticket number.
+            /// \return the removed request.
+            auto dequeue(ticket_number_type ticket_number)
+                -> queued_lock_type;
+
+            /// Returns the queued request with the lowest ticket number.
+            /// \return queued request, or nullptr if the queue is empty.
+            auto front() -> queued_lock_type*;
+
+            /// Removes the queued request with the lowest ticket number in
+            /// amortized constant time. The queue must not be empty.
+            /// \return the removed request.
+            auto pop_front() -> queued_lock_type;
+
+            /// Returns the number of queued requests.
+            /// \return queue length.
+            [[nodiscard]] auto queue_size() const -> size_t;
+
+            /// Adds a reader unless it already holds the read lock.
+            /// \param ticket_number ticket number.
+            void add_reader(ticket_number_type ticket_number);
+
+            /// Removes a reader if it holds the read lock.
+            /// \param ticket_number ticket number.
+            void remove_reader(ticket_number_type ticket_number);
+
+            /// Returns the holders younger than the given ticket which a
+            /// request of the given type from it waits on: the writer, and
+            /// for write requests the readers.
+            /// \param ticket_number ticket number of the request.
+            /// \param type type of the request.
+            /// \return younger holders.
+            [[nodiscard]] auto younger_holders(ticket_number_type ticket_number,
+                                               lock_type type) const
+                -> std::vector<ticket_number_type>;
+
+          private:
+            /// Queued requests in ascending ticket number order, from
+            /// m_queue_head. Entries before the head have been popped.
+            std::vector<queued_lock_type> m_queue;
+            size_t m_queue_head{0};
+
+            [[nodiscard]] auto queue_begin()
+                -> std::vector<queued_lock_type>::iterator;
+        };
+
+        /// A key, its value and the lock on it.
+        struct element_type {
+            lock_state_type m_lock;
+            /// Ticket which last committed the value.
+            ticket_number_type m_version{};
+
+          private:
+            friend class state_table;
+            size_t m_key_offset{};
+            size_t m_value_offset{};
+            uint32_t m_key_size{};
+            uint32_t m_value_size{};
+            uint32_t m_value_capacity{};
+        };
+
+        state_table() = default;
+
+        /// Returns the hash of a key, to pass to the other methods.
+        /// \param key key to hash.
+        /// \return key hash.
+        static auto hash(const key_type& key) -> uint64_t;
+
+        /// Returns the element for the given key.
+        /// \param key key to find.
+        /// \param h hash of the key from \ref hash.
+        /// \return element, or nullptr if the key is not in the table.
+        auto find(const key_type& key, uint64_t h) -> element_type*;
+
+        /// Returns the element for the given key, adding it with an empty
+        /// value and no locks if it is not in the table.
+        /// \param key key to find.
+        /// \param h hash of the key from \ref hash.
+        /// \return element.
+        auto get_or_insert(const key_type& key, uint64_t h) -> element_type&;
+
+        /// Returns a copy of the value of the given element.
+        /// \param elem element in this table.
+        /// \return value.
+        [[nodiscard]] auto value(const element_type& elem) const
+            -> value_type;
+
+        /// Replaces the value of the given element.
+        /// \param elem element in this table.
+        /// \param val new value.
+        void set_value(element_type& elem, const value_type& val);
+
+        /// Grows the table so it can hold the given number of keys without
+        /// rehashing the index.
+        /// \param count number of keys.
+        void reserve(size_t count);
+
+        /// Returns the number of keys in the table.
+        /// \return key count.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Checks whether the table is empty.
+        /// \return true if the table holds no keys.
+        [[nodiscard]] auto empty() const -> bool;
+
+      private:
+        struct slot_type {
+            uint64_t m_hash{};
+            size_t m_element{npos};
+        };
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+        /// Arena bytes below which unused value space is not reclaimed.
+        static constexpr size_t min_compact_bytes = 4096;
+
+        std::deque<element_type> m_elements;
+        std::vector<slot_type> m_slots;
+        /// Shift mapping a mixed hash onto a slot index.
+        unsigned m_shift{64};
+        std::vector<unsigned char> m_keys;
+        std::vector<unsigned char> m_values;
+        /// Bytes of m_values no longer used by any value.
+        size_t m_unused_value_bytes{0};
+
+        [[nodiscard]] auto key_equals(const element_type& elem,
+                                      const key_type& key) const -> bool;
+        [[nodiscard]] auto home_slot(uint64_t h) const -> size_t;
+        void rehash(size_t slot_count);
+        void compact_values();
+    };
+}
+
+#endif
@@ -30,28 +30,17 @@ namespace cbdc::parsec::ticket_machine::rpc {
         /// \return true if the client initialized successfully.
         auto init() -> bool;
 
-        /// Requests a new batch of ticket numbers from the remote ticket
-        /// machine. Always returns a single ticket number (range size of 1).
-        /// Caches ticket numbers to avoid making an RPC request per call. If a
-        /// ticket number is available in the cache, calls the callback before
-        /// returning.
-        /// \param result_callback function to call with the new ticket number.
+        /// Requests a new range of ticket numbers from the remote ticket
+        /// machine. Callers lease the whole range, so the ticket machine is
+        /// contacted once per range rather than once per ticket.
+        /// \param result_callback function to call with the new ticket number
+        ///                        range.
         /// \return true if the request was initiated successfully.
         auto get_ticket_number(get_ticket_number_callback_type result_callback)
             -> bool override;
 
       private:
         std::unique_ptr<cbdc::rpc::tcp_client<request, response>> m_client;
-        std::queue<ticket_number_type> m_tickets;
-        bool m_fetching_tickets{false};
-
-        mutable std::mutex m_mut;
-
-        std::queue<get_ticket_number_callback_type> m_callbacks;
-
-        auto fetch_tickets() -> bool;
-
-        void handle_ticket_numbers(ticket_number_range_type range);
     };
 }
 
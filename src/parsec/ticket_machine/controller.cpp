@@ -45,6 +45,12 @@ namespace cbdc::parsec::ticket_machine {
         return true;
     }
 
+    void controller::transfer_leadership() {
+        static_cast<void>(m_raft_serv->transfer_leadership(
+            std::chrono::milliseconds(
+                cbdc::config::defaults::leadership_transfer_timeout)));
+    }
+
     auto controller::raft_callback(nuraft::cb_func::Type type,
                                    nuraft::cb_func::Param* /* param */)
         -> nuraft::cb_func::ReturnCode {
@@ -39,6 +39,11 @@ namespace cbdc::parsec::ticket_machine {
         /// \return true if initialization was successful.
         auto init() -> bool;
 
+        /// Hands raft leadership to an up-to-date follower if this node
+        /// leads, so ticket issuance resumes without an election. Call
+        /// before shutting down.
+        void transfer_leadership();
+
       private:
         auto raft_callback(nuraft::cb_func::Type type,
                            nuraft::cb_func::Param* param)
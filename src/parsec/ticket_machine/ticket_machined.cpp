@@ -45,9 +45,11 @@ auto main(int argc, char** argv) -> int {
 
     static auto running = std::atomic_bool{true};
 
-    std::signal(SIGINT, [](int /* signal */) {
+    auto stop = [](int /* signal */) {
         running = false;
-    });
+    };
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
 
     log->info("Ticket machine running");
 
@@ -57,5 +59,7 @@ auto main(int argc, char** argv) -> int {
 
     log->info("Shutting down...");
 
+    raft_server.transfer_leadership();
+
     return 0;
 }
@@ -175,6 +175,107 @@ namespace cbdc::parsec {
             cfg.m_loadgen_accounts = std::stoull(it->second);
         }
 
+        constexpr auto loadgen_http_connections_key
+            = "loadgen_http_connections";
+        it = opts->find(loadgen_http_connections_key);
+        if(it != opts->end()) {
+            cfg.m_loadgen_http_connections = std::stoull(it->second);
+        }
+
+        constexpr auto agent_threads_key = "agent_threads";
+        it = opts->find(agent_threads_key);
+        if(it != opts->end()) {
+            cfg.m_agent_threads = std::stoull(it->second);
+        }
+
+        constexpr auto agent_pin_threads_key = "agent_pin_threads";
+        it = opts->find(agent_pin_threads_key);
+        if(it != opts->end()) {
+            cfg.m_agent_pin_threads = std::stoull(it->second) != 0;
+        }
+
+        constexpr auto placement_key = "placement";
+        it = opts->find(placement_key);
+        if(it != opts->end()) {
+            auto maybe_placement
+                = directory::parse_placement_type(it->second);
+            if(!maybe_placement.has_value()) {
+                return std::nullopt;
+            }
+            cfg.m_placement = maybe_placement.value();
+        }
+
+        constexpr auto placement_prefix_len_key = "placement_prefix_len";
+        it = opts->find(placement_prefix_len_key);
+        if(it != opts->end()) {
+            cfg.m_placement_prefix_len = std::stoull(it->second);
+        }
+
+        constexpr auto read_cache_max_age_key = "read_cache_max_age_ms";
+        it = opts->find(read_cache_max_age_key);
+        if(it != opts->end()) {
+            cfg.m_read_cache_max_age_ms = std::stoull(it->second);
+        }
+
+        constexpr auto agent_http_listeners_key = "agent_http_listeners";
+        it = opts->find(agent_http_listeners_key);
+        if(it != opts->end()) {
+            cfg.m_agent_http_listeners = std::stoull(it->second);
+        }
+
+        constexpr auto agent_http_timeout_key = "agent_http_timeout";
+        it = opts->find(agent_http_timeout_key);
+        if(it != opts->end()) {
+            cfg.m_agent_http_timeout
+                = static_cast<unsigned int>(std::stoul(it->second));
+        }
+
+        constexpr auto agent_http_connection_limit_key
+            = "agent_http_connection_limit";
+        it = opts->find(agent_http_connection_limit_key);
+        if(it != opts->end()) {
+            cfg.m_agent_http_connection_limit = std::stoull(it->second);
+        }
+
+        constexpr auto agent_http_keep_alive_key = "agent_http_keep_alive";
+        it = opts->find(agent_http_keep_alive_key);
+        if(it != opts->end()) {
+            cfg.m_agent_http_keep_alive = std::stoull(it->second) != 0;
+        }
+
+        constexpr auto shard_group_commit_batch_key
+            = "shard_group_commit_batch";
+        it = opts->find(shard_group_commit_batch_key);
+        if(it != opts->end()) {
+            cfg.m_shard_group_commit_batch = std::stoull(it->second);
+        }
+
+        constexpr auto shard_group_commit_delay_key
+            = "shard_group_commit_delay_us";
+        it = opts->find(shard_group_commit_delay_key);
+        if(it != opts->end()) {
+            cfg.m_shard_group_commit_delay_us = std::stoull(it->second);
+        }
+
+        static const auto cpus_keys
+            = std::vector<std::pair<std::string, thread_role>>{
+                {cbdc::config::cpus_main_key, thread_role::main},
+                {cbdc::config::cpus_network_key, thread_role::network},
+                {cbdc::config::cpus_raft_key, thread_role::raft},
+                {cbdc::config::cpus_executor_key, thread_role::executor},
+                {cbdc::config::cpus_persistence_key, thread_role::persistence}};
+        for(const auto& [key, role] : cpus_keys) {
+            it = opts->find(key);
+            if(it == opts->end()) {
+                continue;
+            }
+            auto cpus = parse_cpu_list(it->second);
+            if(!cpus.has_value()) {
+                return std::nullopt;
+            }
+            cfg.m_thread_cpus[role] = std::move(cpus.value());
+        }
+
         constexpr auto runner_type_key = "runner_type";
         it = opts->find(runner_type_key);
         if(it != opts->end()) {
@@ -244,4 +345,13 @@ namespace cbdc::parsec {
         });
         return begin_res;
     }
+
+    auto put_rows(const std::shared_ptr<broker::interface>& broker,
+                  broker::state_update_type rows,
+                  const std::function<void(bool)>& result_callback) -> bool {
+        return broker->load(std::move(rows),
+                            [=](broker::interface::load_return_type res) {
+                                result_callback(!res.has_value());
+                            });
+    }
 }
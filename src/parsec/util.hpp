@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_PARSEC_UTIL_H_
 
 #include "broker/interface.hpp"
+#include "directory/placement.hpp"
 #include "util/common/config.hpp"
 #include "util/common/logging.hpp"
 
@@ -46,11 +47,57 @@ namespace cbdc::parsec {
         runner_type m_runner_type{runner_type::evm};
         /// The number of simultaneous load generator threads
         size_t m_loadgen_accounts;
+        /// Maximum number of HTTP connections an EVM load generator keeps
+        /// open to each agent. Calls beyond the limit wait for a free
+        /// connection. Zero for no limit.
+        size_t m_loadgen_http_connections{0};
         /// Type of transactions load generators should produce
         load_type m_load_type;
         /// The percentage of transactions that are using the same account
         /// to simulate contention
         double m_contention_rate;
+        /// Number of worker threads on which an agent runs contracts. Zero
+        /// for one per hardware thread.
+        size_t m_agent_threads{0};
+        /// Whether to pin each agent worker thread to a CPU.
+        bool m_agent_pin_threads{false};
+        /// Policy the directory uses to place keys on shards.
+        directory::placement_type m_placement{
+            directory::placement_type::hash};
+        /// Number of leading key bytes hash-based placement policies place
+        /// keys by, so keys sharing the prefix share a shard. Zero for the
+        /// whole key.
+        size_t m_placement_prefix_len{0};
+        /// Maximum age in milliseconds of the cached values agents serve
+        /// read-only runs from without locking keys. EVM agents also answer
+        /// eth_getTransactionCount and eth_getBalance from it without
+        /// running an agent. Zero disables the cache. Commits made through
+        /// other agents are only seen once cached values expire.
+        size_t m_read_cache_max_age_ms{0};
+        /// Number of HTTP listener threads of an EVM agent, each bound to
+        /// the agent endpoint with SO_REUSEPORT. One for a single listener
+        /// served by a thread pool. Zero for one per hardware thread.
+        size_t m_agent_http_listeners{1};
+        /// Seconds an idle HTTP connection to an EVM agent is kept open.
+        unsigned int m_agent_http_timeout{3};
+        /// Maximum number of open HTTP connections to an EVM agent. Zero
+        /// for no limit beyond what the event loop supports.
+        size_t m_agent_http_connection_limit{0};
+        /// Whether an EVM agent keeps HTTP connections open between
+        /// requests.
+        bool m_agent_http_keep_alive{true};
+        /// Number of pending prepare, commit and finish requests which
+        /// makes a runtime locking shard leader replicate them as one raft
+        /// log entry.
+        size_t m_shard_group_commit_batch{
+            cbdc::config::defaults::shard_group_commit_batch};
+        /// Longest time in microseconds a pending runtime locking shard
+        /// request waits for others to join its raft log entry.
+        size_t m_shard_group_commit_delay_us{
+            cbdc::config::defaults::shard_group_commit_delay_us};
+        /// CPUs to which each kind of thread is pinned, from the
+        /// cpus_<role> options, as in config::options::m_thread_cpus.
+        thread_cpus m_thread_cpus;
     };
 
     /// Reads the configuration parameters from the program arguments.
@@ -71,6 +118,18 @@ namespace cbdc::parsec {
                  broker::key_type key,
                  broker::value_type value,
                  const std::function<void(bool)>& result_callback) -> bool;
+
+    /// Asynchronously writes the given rows directly to the committed state
+    /// of the cluster, bypassing tickets. Much faster than inserting each
+    /// row with \ref put_row, so used to seed initial state. The keys must
+    /// not be in use by other transactions while loading.
+    /// \param broker broker to use for loading the rows.
+    /// \param rows keys and values to write.
+    /// \param result_callback function to call on load success or failure.
+    /// \return true if request was initiated successfully.
+    auto put_rows(const std::shared_ptr<broker::interface>& broker,
+                  broker::state_update_type rows,
+                  const std::function<void(bool)>& result_callback) -> bool;
 }
 
 #endif
@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "controller.hpp"
+#include "util/common/affinity.hpp"
+#include "util/network/io_loop.hpp"
 #include "util/serialization/format.hpp"
 
 #include <csignal>
@@ -32,6 +34,12 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     const auto archiver_id = std::stoull(args[2]);
 
@@ -42,6 +50,9 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_archiver_loglevels[archiver_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
 
     auto ctl = cbdc::archiver::controller(static_cast<uint32_t>(archiver_id),
                                           opts,
@@ -0,0 +1,491 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "block_archive.hpp"
+
+#include "crypto/siphash.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+namespace cbdc::archiver {
+    namespace {
+        constexpr auto segment_prefix = "blocks_";
+        constexpr size_t segment_name_digits = 20;
+
+        /// Each record starts with its block height, compressed length,
+        /// uncompressed length and checksum, followed by the compressed
+        /// block.
+        constexpr size_t header_size = 4 * sizeof(uint64_t);
+        constexpr uint64_t checksum_k0 = 0x617263;
+        constexpr uint64_t checksum_k1 = 0x626c6b;
+
+        struct record_header {
+            uint64_t m_height{};
+            uint64_t m_len{};
+            uint64_t m_raw_len{};
+            uint64_t m_checksum{};
+        };
+
+        auto read_u64(const unsigned char* p) -> uint64_t {
+            uint64_t ret{};
+            std::memcpy(&ret, p, sizeof(ret));
+            return ret;
+        }
+
+        void write_u64(unsigned char* p, uint64_t val) {
+            std::memcpy(p, &val, sizeof(val));
+        }
+
+        auto read_header(const unsigned char* p) -> record_header {
+            return {read_u64(p),
+                    read_u64(p + sizeof(uint64_t)),
+                    read_u64(p + 2 * sizeof(uint64_t)),
+                    read_u64(p + 3 * sizeof(uint64_t))};
+        }
+
+        auto record_checksum(uint64_t height,
+                             uint64_t raw_len,
+                             const unsigned char* data,
+                             size_t len) -> uint64_t {
+            return CSipHasher(checksum_k0, checksum_k1)
+                .Write(height)
+                .Write(raw_len)
+                .Write(data, len)
+                .Finalize();
+        }
+
+        auto segment_name(uint64_t first_height) -> std::string {
+            const auto digits = std::to_string(first_height);
+            return segment_prefix
+                 + std::string(segment_name_digits - digits.size(), '0')
+                 + digits;
+        }
+
+        auto parse_segment_name(const std::string& name)
+            -> std::optional<uint64_t> {
+            const auto prefix_len = std::strlen(segment_prefix);
+            if(name.size() != prefix_len + segment_name_digits
+               || name.compare(0, prefix_len, segment_prefix) != 0) {
+                return std::nullopt;
+            }
+            const auto digits = name.substr(prefix_len);
+            if(!std::all_of(digits.begin(), digits.end(), [](char c) {
+                   return c >= '0' && c <= '9';
+               })) {
+                return std::nullopt;
+            }
+            return std::stoull(digits);
+        }
+
+        auto read_all(int fd, unsigned char* data, size_t len, uint64_t off)
+            -> bool {
+            while(len > 0) {
+                const auto n = ::pread(fd, data, len, static_cast<off_t>(off));
+                if(n <= 0) {
+                    return false;
+                }
+                const auto read = static_cast<size_t>(n);
+                data += read;
+                len -= read;
+                off += read;
+            }
+            return true;
+        }
+
+        auto write_all(int fd,
+                       const unsigned char* data,
+                       size_t len,
+                       uint64_t off) -> bool {
+            while(len > 0) {
+                const auto n
+                    = ::pwrite(fd, data, len, static_cast<off_t>(off));
+                if(n <= 0) {
+                    return false;
+                }
+                const auto written = static_cast<size_t>(n);
+                data += written;
+                len -= written;
+                off += written;
+            }
+            return true;
+        }
+
+        auto sync_fd(int fd) -> bool {
+#ifdef __APPLE__
+            return ::fsync(fd) == 0;
+#else
+            return ::fdatasync(fd) == 0;
+#endif
+        }
+
+        auto sync_dir(const std::string& dir) -> bool {
+            auto fd = ::open(dir.c_str(), O_RDONLY);
+            if(fd < 0) {
+                return false;
+            }
+            const auto ret = ::fsync(fd) == 0;
+            ::close(fd);
+            return ret;
+        }
+    }
+
+    /// An open segment file.
+    struct block_archive::segment {
+        segment(uint64_t first_height, std::string path)
+            : m_first_height(first_height),
+              m_path(std::move(path)) {}
+
+        ~segment() {
+            if(m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        segment(const segment&) = delete;
+        auto operator=(const segment&) -> segment& = delete;
+        segment(segment&&) = delete;
+        auto operator=(segment&&) -> segment& = delete;
+
+        /// Open the segment file, creating it if create is true.
+        auto open(bool create) -> bool {
+            auto flags = O_RDWR;
+            if(create) {
+                flags |= O_CREAT | O_TRUNC;
+            }
+            m_fd = ::open(m_path.c_str(), flags, S_IRUSR | S_IWUSR);
+            if(m_fd < 0) {
+                return false;
+            }
+            struct stat st {};
+            if(::fstat(m_fd, &st) != 0 || st.st_size < 0) {
+                return false;
+            }
+            m_size = static_cast<uint64_t>(st.st_size);
+            return true;
+        }
+
+        uint64_t m_first_height;
+        std::string m_path;
+        int m_fd{-1};
+        /// Offset after the last record.
+        uint64_t m_size{};
+    };
+
+    block_archive::block_archive(size_t segment_bytes, int compression_level)
+        : m_segment_bytes(segment_bytes),
+          m_compression_level(compression_level) {}
+
+    block_archive::~block_archive() {
+        std::unique_lock l(m_mut);
+        flush_locked();
+    }
+
+    auto block_archive::load(const std::string& dir) -> bool {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if(!std::filesystem::is_directory(dir, ec)) {
+            return false;
+        }
+
+        auto files = std::vector<std::pair<uint64_t, std::string>>();
+        for(const auto& file : std::filesystem::directory_iterator(dir, ec)) {
+            const auto first_height
+                = parse_segment_name(file.path().filename().string());
+            if(first_height.has_value()) {
+                files.emplace_back(first_height.value(),
+                                   file.path().string());
+            }
+        }
+        if(ec) {
+            return false;
+        }
+        std::sort(files.begin(), files.end());
+
+        std::unique_lock l(m_mut);
+        m_dir = dir;
+        m_segments.clear();
+        m_index.clear();
+        m_first_height = files.empty() ? 0 : files.front().first;
+        auto valid = true;
+        for(size_t i{0}; i < files.size(); i++) {
+            auto& [first_height, path] = files[i];
+            // Segments after a gap or a torn record hold blocks written
+            // after ones which were lost, so they are not part of the
+            // archive
+            if(!valid || first_height != m_first_height + m_index.size()) {
+                valid = false;
+                std::filesystem::remove(path, ec);
+                m_dir_dirty = true;
+                if(ec) {
+                    return false;
+                }
+                continue;
+            }
+            auto seg = std::make_unique<segment>(first_height, path);
+            if(!seg->open(false)) {
+                return false;
+            }
+            // Earlier segments were synced before the next was started
+            const auto last = i + 1 == files.size();
+            m_segments.push_back(std::move(seg));
+            valid = load_segment(*m_segments.back(), last);
+        }
+
+        if(m_index.empty()) {
+            // Only empty segments remain, so start from the next block
+            for(const auto& seg : m_segments) {
+                std::filesystem::remove(seg->m_path, ec);
+                m_dir_dirty = true;
+                if(ec) {
+                    return false;
+                }
+            }
+            m_segments.clear();
+            m_first_height = 0;
+        }
+
+        return flush_locked();
+    }
+
+    auto block_archive::load_segment(segment& seg, bool verify) -> bool {
+        uint64_t off{0};
+        auto hdr_buf = std::array<unsigned char, header_size>();
+        auto data = std::vector<unsigned char>();
+        while(off + header_size <= seg.m_size) {
+            if(!read_all(seg.m_fd, hdr_buf.data(), header_size, off)) {
+                break;
+            }
+            const auto hdr = read_header(hdr_buf.data());
+            if(hdr.m_height != m_first_height + m_index.size()
+               || hdr.m_len == 0
+               || hdr.m_len > seg.m_size - off - header_size) {
+                break;
+            }
+            if(verify) {
+                data.resize(hdr.m_len);
+                if(!read_all(seg.m_fd,
+                             data.data(),
+                             data.size(),
+                             off + header_size)
+                   || record_checksum(hdr.m_height,
+                                      hdr.m_raw_len,
+                                      data.data(),
+                                      data.size())
+                          != hdr.m_checksum) {
+                    break;
+                }
+            }
+            m_index.push_back({m_segments.size() - 1, off, hdr.m_len});
+            off += header_size + hdr.m_len;
+        }
+
+        if(off == seg.m_size) {
+            return true;
+        }
+        if(::ftruncate(seg.m_fd, static_cast<off_t>(off)) == 0) {
+            seg.m_size = off;
+            m_dirty = true;
+        }
+        return false;
+    }
+
+    auto block_archive::start_segment(uint64_t first_height) -> bool {
+        // Only the last segment may hold unsynced records
+        if(!flush_locked()) {
+            return false;
+        }
+        auto seg = std::make_unique<segment>(
+            first_height,
+            m_dir + "/" + segment_name(first_height));
+        if(!seg->open(true)) {
+            return false;
+        }
+        m_segments.push_back(std::move(seg));
+        m_dir_dirty = true;
+        return true;
+    }
+
+    auto block_archive::make_record(uint64_t height, const buffer& blk) const
+        -> std::optional<record> {
+        const auto bound = ZSTD_compressBound(blk.size());
+        auto rec = record(header_size + bound);
+        const auto len = ZSTD_compress(rec.data() + header_size,
+                                       bound,
+                                       blk.data(),
+                                       blk.size(),
+                                       m_compression_level);
+        if(ZSTD_isError(len) != 0) {
+            return std::nullopt;
+        }
+        rec.resize(header_size + len);
+        write_u64(rec.data(), height);
+        write_u64(rec.data() + sizeof(uint64_t), len);
+        write_u64(rec.data() + 2 * sizeof(uint64_t), blk.size());
+        write_u64(rec.data() + 3 * sizeof(uint64_t),
+                  record_checksum(height,
+                                  blk.size(),
+                                  rec.data() + header_size,
+                                  len));
+        return rec;
+    }
+
+    auto block_archive::append(uint64_t height, const buffer& blk) -> bool {
+        auto rec = make_record(height, blk);
+        if(!rec.has_value()) {
+            return false;
+        }
+        return append({std::move(rec.value())});
+    }
+
+    auto block_archive::append(const std::vector<record>& recs) -> bool {
+        std::unique_lock l(m_mut);
+        auto next_height = m_index.empty()
+                             ? (recs.empty() ? 0 : read_u64(recs[0].data()))
+                             : m_first_height + m_index.size();
+        for(size_t i{0}; i < recs.size(); i++) {
+            if(read_u64(recs[i].data()) != next_height + i) {
+                return false;
+            }
+        }
+        if(m_index.empty()) {
+            m_first_height = next_height;
+        }
+
+        auto bytes = std::vector<unsigned char>();
+        for(size_t i{0}; i < recs.size();) {
+            if(m_segments.empty()
+               || (m_segments.back()->m_size > 0
+                   && m_segments.back()->m_size + recs[i].size()
+                          > m_segment_bytes)) {
+                if(!start_segment(next_height + i)) {
+                    return false;
+                }
+            }
+
+            // Write the records which fit in the segment at once
+            auto& seg = *m_segments.back();
+            bytes.clear();
+            auto j = i;
+            do {
+                bytes.insert(bytes.end(), recs[j].begin(), recs[j].end());
+                j++;
+            } while(j < recs.size()
+                    && seg.m_size + bytes.size() + recs[j].size()
+                           <= m_segment_bytes);
+            if(!write_all(seg.m_fd, bytes.data(), bytes.size(), seg.m_size)) {
+                return false;
+            }
+            for(; i < j; i++) {
+                m_index.push_back({m_segments.size() - 1,
+                                   seg.m_size,
+                                   recs[i].size() - header_size});
+                seg.m_size += recs[i].size();
+            }
+            m_dirty = true;
+        }
+        return true;
+    }
+
+    auto block_archive::get(uint64_t height) const -> std::optional<buffer> {
+        auto blks = get_range(height, 1);
+        if(blks.empty()) {
+            return std::nullopt;
+        }
+        return std::move(blks.front());
+    }
+
+    auto block_archive::get_range(uint64_t height, size_t count) const
+        -> std::vector<buffer> {
+        auto ret = std::vector<buffer>();
+        std::shared_lock l(m_mut);
+        if(height < m_first_height
+           || height >= m_first_height + m_index.size()) {
+            return ret;
+        }
+        const auto begin = height - m_first_height;
+        const auto end = begin + std::min<uint64_t>(count,
+                                                    m_index.size() - begin);
+        ret.reserve(end - begin);
+
+        auto data = std::vector<unsigned char>();
+        for(auto i = begin; i < end;) {
+            // Read the run of records in the same segment at once
+            const auto& first = m_index[i];
+            auto j = i + 1;
+            while(j < end && m_index[j].m_segment == first.m_segment) {
+                j++;
+            }
+            const auto& last = m_index[j - 1];
+            const auto span_end = last.m_offset + header_size + last.m_len;
+            data.resize(span_end - first.m_offset);
+            const auto& seg = *m_segments[first.m_segment];
+            if(!read_all(seg.m_fd, data.data(), data.size(), first.m_offset)) {
+                return ret;
+            }
+
+            for(; i < j; i++) {
+                const auto* rec
+                    = data.data() + (m_index[i].m_offset - first.m_offset);
+                const auto hdr = read_header(rec);
+                if(hdr.m_height != m_first_height + i
+                   || record_checksum(hdr.m_height,
+                                      hdr.m_raw_len,
+                                      rec + header_size,
+                                      hdr.m_len)
+                          != hdr.m_checksum) {
+                    return ret;
+                }
+                auto blk = buffer();
+                blk.extend(hdr.m_raw_len);
+                const auto raw_len = ZSTD_decompress(blk.data(),
+                                                     blk.size(),
+                                                     rec + header_size,
+                                                     hdr.m_len);
+                if(ZSTD_isError(raw_len) != 0 || raw_len != hdr.m_raw_len) {
+                    return ret;
+                }
+                ret.push_back(std::move(blk));
+            }
+        }
+        return ret;
+    }
+
+    auto block_archive::last_height() const -> uint64_t {
+        std::shared_lock l(m_mut);
+        if(m_index.empty()) {
+            return 0;
+        }
+        return m_first_height + m_index.size() - 1;
+    }
+
+    auto block_archive::flush() -> bool {
+        std::unique_lock l(m_mut);
+        return flush_locked();
+    }
+
+    auto block_archive::flush_locked() -> bool {
+        if(m_dirty && !m_segments.empty()) {
+            if(!sync_fd(m_segments.back()->m_fd)) {
+                return false;
+            }
+            m_dirty = false;
+        }
+        if(m_dir_dirty) {
+            if(!sync_dir(m_dir)) {
+                return false;
+            }
+            m_dir_dirty = false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ARCHIVER_BLOCK_ARCHIVE_H_
+#define OPENCBDC_TX_SRC_ARCHIVER_BLOCK_ARCHIVE_H_
+
+#include "util/common/buffer.hpp"
+
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace cbdc::archiver {
+    /// \brief Append-only archive of serialized blocks in segment files.
+    ///
+    /// Blocks are compressed with zstd and appended in height order to
+    /// segment files, each named by the height of its first block. A new
+    /// segment is started once the current one reaches the configured
+    /// size. Each record carries its height, lengths and a checksum, and an
+    /// in-memory index maps heights to record offsets, so reading a range
+    /// of blocks is a single sequential read per segment. Appends are made
+    /// durable in groups by \ref flush. Only the last segment can hold
+    /// unsynced records, so loading verifies the checksums of its records
+    /// and truncates it after the last valid one.
+    class block_archive {
+      public:
+        /// Default size at which a new segment file is started, in bytes.
+        static constexpr size_t default_segment_bytes = 256UL * 1024 * 1024;
+        /// Default zstd compression level.
+        static constexpr int default_compression_level = 3;
+
+        /// Constructor.
+        /// \param segment_bytes size at which a new segment file is started.
+        /// \param compression_level zstd compression level for new blocks.
+        explicit block_archive(
+            size_t segment_bytes = default_segment_bytes,
+            int compression_level = default_compression_level);
+
+        /// Destructor. Flushes appended blocks.
+        ~block_archive();
+
+        block_archive(const block_archive&) = delete;
+        auto operator=(const block_archive&) -> block_archive& = delete;
+        block_archive(block_archive&&) = delete;
+        auto operator=(block_archive&&) -> block_archive& = delete;
+
+        /// Loads the archive from the segment files in the given directory,
+        /// creating it if needed.
+        /// \param dir segment directory.
+        /// \return true if loading the archive succeeded.
+        [[nodiscard]] auto load(const std::string& dir) -> bool;
+
+        /// A block compressed into an archive record by \ref make_record.
+        using record = std::vector<unsigned char>;
+
+        /// Compresses a serialized block into a record to append. Thread
+        /// safe, so blocks can be compressed in parallel.
+        /// \param height height of the block.
+        /// \param blk serialized block.
+        /// \return the record, or std::nullopt if compression failed.
+        [[nodiscard]] auto make_record(uint64_t height,
+                                       const buffer& blk) const
+            -> std::optional<record>;
+
+        /// Appends records for consecutive blocks, writing the records
+        /// which share a segment at once. The blocks are not durable until
+        /// the next call to \ref flush.
+        /// \param recs records from \ref make_record. The first must follow
+        ///             the last block in the archive, unless the archive is
+        ///             empty.
+        /// \return true if all the blocks were appended.
+        [[nodiscard]] auto append(const std::vector<record>& recs) -> bool;
+
+        /// Appends a serialized block. The block is not durable until the
+        /// next call to \ref flush.
+        /// \param height height of the block. Must follow the last block in
+        ///               the archive, unless the archive is empty.
+        /// \param blk serialized block.
+        /// \return true if the block was appended.
+        [[nodiscard]] auto append(uint64_t height, const buffer& blk) -> bool;
+
+        /// Returns the serialized block at the given height.
+        /// \param height block height.
+        /// \return serialized block, or std::nullopt if the archive does not
+        ///         hold the block or its record is corrupted.
+        [[nodiscard]] auto get(uint64_t height) const
+            -> std::optional<buffer>;
+
+        /// Returns consecutive serialized blocks, reading each segment the
+        /// range covers with a single read.
+        /// \param height height of the first block.
+        /// \param count maximum number of blocks to return.
+        /// \return serialized blocks from the given height, stopping at the
+        ///         end of the archive or at a corrupted record.
+        [[nodiscard]] auto get_range(uint64_t height, size_t count) const
+            -> std::vector<buffer>;
+
+        /// Returns the height of the last block in the archive.
+        /// \return block height, or zero if the archive is empty.
+        [[nodiscard]] auto last_height() const -> uint64_t;
+
+        /// Syncs blocks appended since the last flush to disk.
+        /// \return true if the flush was successful.
+        auto flush() -> bool;
+
+      private:
+        struct segment;
+
+        /// Location of a record in the archive.
+        struct location {
+            size_t m_segment{};
+            uint64_t m_offset{};
+            uint64_t m_len{};
+        };
+
+        std::string m_dir;
+        size_t m_segment_bytes;
+        int m_compression_level;
+        mutable std::shared_mutex m_mut;
+        std::vector<std::unique_ptr<segment>> m_segments;
+        /// Record locations in height order, from m_first_height.
+        std::vector<location> m_index;
+        uint64_t m_first_height{0};
+        /// True if segment files were created since the last flush.
+        bool m_dir_dirty{false};
+        /// True if records were appended since the last flush.
+        bool m_dirty{false};
+
+        auto load_segment(segment& seg, bool verify) -> bool;
+        auto start_segment(uint64_t first_height) -> bool;
+        auto flush_locked() -> bool;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ARCHIVER_BLOCK_ARCHIVE_H_
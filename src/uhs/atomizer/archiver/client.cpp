@@ -5,9 +5,11 @@
 
 #include "client.hpp"
 
+#include "format.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
 #include <utility>
 
 namespace cbdc::archiver {
@@ -20,10 +22,26 @@ namespace cbdc::archiver {
         return m_sock.connect(m_endpoint);
     }
 
+    auto client::ensure_connected() -> bool {
+        // A range may have failed part way through its stream and closed
+        // the connection
+        if(m_sock.connected()) {
+            return true;
+        }
+        if(!m_sock.reconnect()) {
+            m_logger->error("Error reconnecting to archiver.");
+            return false;
+        }
+        return true;
+    }
+
     auto client::get_block(uint64_t height)
         -> std::optional<cbdc::atomizer::block> {
         m_logger->info("Requesting block", height, "from archiver...");
-        if(!m_sock.send(height)) {
+        if(!ensure_connected()) {
+            return std::nullopt;
+        }
+        if(!m_sock.send(request{height})) {
             m_logger->error("Error requesting block from archiver.");
             return std::nullopt;
         }
@@ -43,4 +61,59 @@ namespace cbdc::archiver {
 
         return resp.value();
     }
+
+    auto client::get_blocks(uint64_t from,
+                            uint64_t to,
+                            const block_handler_t& handler) -> bool {
+        m_logger->info("Requesting blocks", from, "to", to, "from archiver...");
+        if(!ensure_connected()) {
+            return false;
+        }
+        // Abandons a stream part way through. The rest of its responses
+        // would otherwise be read as the answers to later requests.
+        auto abandon = [&]() {
+            m_sock.disconnect();
+            return false;
+        };
+        for(auto height = from; height <= to;) {
+            const auto window_end
+                = height + std::min(to - height, m_range_window - 1);
+            if(!m_sock.send(request{range_request{height, window_end}})) {
+                m_logger->error("Error requesting blocks from archiver.");
+                return abandon();
+            }
+
+            while(true) {
+                cbdc::buffer resp_pkt;
+                if(!m_sock.receive(resp_pkt)) {
+                    m_logger->error("Error receiving block from archiver.");
+                    return abandon();
+                }
+                auto resp = cbdc::from_buffer<response>(resp_pkt);
+                if(!resp.has_value()) {
+                    m_logger->error("Invalid response packet");
+                    return abandon();
+                }
+                if(!resp.value().has_value()) {
+                    break;
+                }
+                if(resp.value()->m_height != height) {
+                    m_logger->error("Unexpected block",
+                                    resp.value()->m_height,
+                                    "from archiver.");
+                    return abandon();
+                }
+                height++;
+                handler(std::move(resp.value().value()));
+            }
+
+            if(height <= window_end) {
+                return false;
+            }
+            if(window_end == to) {
+                break;
+            }
+        }
+        return true;
+    }
 }
@@ -10,9 +10,25 @@
 #include "util/common/logging.hpp"
 #include "util/network/tcp_socket.hpp"
 
+#include <functional>
+#include <variant>
+
 namespace cbdc::archiver {
-    /// Height of the block to fetch from the archiver.
-    using request = uint64_t;
+    /// \brief Range of blocks to fetch from the archiver.
+    ///
+    /// The archiver streams back one \ref response per block, in height
+    /// order, followed by std::nullopt after the last block in the range or
+    /// in place of the first block it does not have.
+    struct range_request {
+        /// Height of the first block.
+        uint64_t m_from{};
+        /// Height of the last block, inclusive.
+        uint64_t m_to{};
+    };
+
+    /// Height of the block to fetch from the archiver, or a range of
+    /// blocks.
+    using request = std::variant<uint64_t, range_request>;
 
     /// The requested block, or std::nullopt if not found.
     using response = std::optional<cbdc::atomizer::block>;
@@ -40,7 +56,32 @@ namespace cbdc::archiver {
         auto get_block(uint64_t height)
             -> std::optional<cbdc::atomizer::block>;
 
+        /// Function called with each block retrieved by \ref get_blocks.
+        using block_handler_t = std::function<void(cbdc::atomizer::block&&)>;
+
+        /// Retrieves the blocks in a range of heights from the archiver.
+        /// The archiver streams the blocks, so the range takes one round
+        /// trip per window of blocks rather than one per block.
+        /// \param from height of the first block to retrieve.
+        /// \param to height of the last block to retrieve, inclusive.
+        /// \param handler function to call with each block, in height
+        ///                order, as it arrives.
+        /// \return true if every block in the range was retrieved. Blocks
+        ///         up to the first one the archiver does not have are
+        ///         still passed to the handler. If the stream fails part
+        ///         way through, the connection is closed and the next call
+        ///         reconnects.
+        auto get_blocks(uint64_t from,
+                        uint64_t to,
+                        const block_handler_t& handler) -> bool;
+
       private:
+        auto ensure_connected() -> bool;
+
+        /// Maximum number of blocks requested at once, bounding the
+        /// blocks the archiver queues for the client.
+        static constexpr uint64_t m_range_window = 128;
+
         network::tcp_socket m_sock;
         network::endpoint_t m_endpoint;
         std::shared_ptr<logging::log> m_logger;
@@ -5,10 +5,13 @@
 
 #include "controller.hpp"
 
+#include "format.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
+#include "util/common/variant_overloaded.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
 #include <leveldb/write_batch.h>
 #include <utility>
 
@@ -20,7 +23,18 @@ namespace cbdc::archiver {
         : m_archiver_id(archiver_id),
           m_opts(std::move(opts)),
           m_logger(std::move(log)),
-          m_max_samples(max_samples) {}
+          m_db_opts(m_opts.m_archiver_leveldb),
+          m_max_samples(max_samples) {
+        auto digest_threads = m_opts.m_archiver_digest_threads;
+        if(digest_threads == 0) {
+            digest_threads
+                = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        if(digest_threads > 1) {
+            // The calling thread serializes part of each run itself
+            m_digest_pool = std::make_unique<thread_pool>(digest_threads - 1);
+        }
+    }
 
     controller::~controller() {
         m_atomizer_network.close();
@@ -38,7 +52,11 @@ namespace cbdc::archiver {
     }
 
     auto controller::init() -> bool {
-        if(!init_leveldb()) {
+        if(m_opts.m_archiver_backend == config::archiver_backend::segment) {
+            if(!init_block_archive()) {
+                return false;
+            }
+        } else if(!init_leveldb()) {
             return false;
         }
         if(!init_best_block()) {
@@ -57,10 +75,8 @@ namespace cbdc::archiver {
     }
 
     auto controller::init_leveldb() -> bool {
-        leveldb::Options opt;
-        opt.create_if_missing = true;
+        auto opt = m_db_opts.get();
         opt.paranoid_checks = true;
-        opt.compression = leveldb::kNoCompression;
 
         leveldb::DB* db_ptr{};
         const auto res
@@ -75,7 +91,23 @@ namespace cbdc::archiver {
         return true;
     }
 
+    auto controller::init_block_archive() -> bool {
+        auto archive = std::make_unique<block_archive>(
+            m_opts.m_archiver_segment_bytes,
+            m_opts.m_archiver_compression_level);
+        if(!archive->load(m_opts.m_archiver_db_dirs[m_archiver_id])) {
+            m_logger->error("Failed to load block archive");
+            return false;
+        }
+        m_archive = std::move(archive);
+        return true;
+    }
+
     auto controller::init_best_block() -> bool {
+        if(m_archive) {
+            m_best_height = m_archive->last_height();
+            return true;
+        }
         std::string bestblock_val;
         const auto blk_res
             = m_db->Get(m_read_options, m_bestblock_key, &bestblock_val);
@@ -143,8 +175,37 @@ namespace cbdc::archiver {
             m_logger->error("Invalid request packet");
             return std::nullopt;
         }
-        auto blk = get_block(req.value());
-        return cbdc::make_buffer(blk);
+        return std::visit(
+            overloaded{[&](uint64_t height) {
+                           auto blk = get_block(height);
+                           return cbdc::make_buffer(blk);
+                       },
+                       [&](const range_request& range) {
+                           stream_blocks(range, pkt.m_peer_id);
+                           return cbdc::make_buffer(response());
+                       }},
+            req.value());
+    }
+
+    void controller::stream_blocks(const range_request& range,
+                                   network::peer_id_t peer_id) {
+        m_logger->trace(__func__, "(", range.m_from, ",", range.m_to, ")");
+        // Read ahead a batch of blocks at a time, queueing each batch for
+        // the client before reading the next
+        for(auto height = range.m_from; height <= range.m_to;) {
+            const auto count
+                = std::min(range.m_to - height, m_read_ahead_blocks - 1) + 1;
+            auto blks = get_blocks(height, count);
+            for(auto& blk : blks) {
+                m_archiver_network.send(
+                    make_shared_buffer(response{std::move(blk)}),
+                    peer_id);
+            }
+            if(blks.size() < count || range.m_to - height < count) {
+                return;
+            }
+            height += count;
+        }
     }
 
     auto controller::atomizer_handler(cbdc::network::message_t&& pkt)
@@ -170,89 +231,151 @@ namespace cbdc::archiver {
         if(m_best_height == 0) {
             // This is the first call to digest_block. Check if there is
             // already a best height value in the database and set it if so.
-            std::string bestblock_val;
-            const auto blk_res
-                = m_db->Get(m_read_options, m_bestblock_key, &bestblock_val);
-            if(blk_res.ok()) {
-                m_best_height
-                    = static_cast<uint64_t>(std::stoul(bestblock_val));
+            if(m_archive) {
+                m_best_height = m_archive->last_height();
+            } else {
+                std::string bestblock_val;
+                const auto blk_res = m_db->Get(m_read_options,
+                                               m_bestblock_key,
+                                               &bestblock_val);
+                if(blk_res.ok()) {
+                    m_best_height
+                        = static_cast<uint64_t>(std::stoul(bestblock_val));
+                }
             }
         }
 
-        cbdc::atomizer::block next_blk;
-        bool digest_next{false};
-        {
-            if(blk.m_height <= m_best_height) {
-                m_logger->warn("Not processing duplicate block h:",
-                               blk.m_height);
-                return;
-            }
+        if(blk.m_height <= m_best_height) {
+            m_logger->warn("Not processing duplicate block h:", blk.m_height);
+            return;
+        }
 
-            if(blk.m_height != m_best_height + 1) {
-                // Not contiguous, check prev block isn't deferred already
-                auto it = m_deferred.find(blk.m_height - 1);
-                if(it == m_deferred.end()) {
-                    // Request previous block from atomizer cluster
-                    request_block(blk.m_height - 1);
-                }
-                m_deferred.emplace(blk.m_height, blk);
-                return;
+        if(blk.m_height != m_best_height + 1) {
+            // Not contiguous, check prev block isn't deferred already
+            auto it = m_deferred.find(blk.m_height - 1);
+            if(it == m_deferred.end()) {
+                // Request previous block from atomizer cluster
+                request_block(blk.m_height - 1);
             }
+            m_deferred.emplace(blk.m_height, blk);
+            return;
+        }
 
-            leveldb::WriteBatch batch;
-
-            m_logger->trace("Digesting block ", blk.m_height, "... ");
-
-            auto blk_bytes = make_buffer(blk);
-            leveldb::Slice blk_slice(blk_bytes.c_str(), blk_bytes.size());
-
-            const auto height_str = std::to_string(blk.m_height);
-
-            batch.Put(height_str, blk_slice);
-            batch.Put(m_bestblock_key, height_str);
-            m_best_height++;
+        // Digest the deferred blocks this block makes contiguous along with
+        // it, in one write
+        auto run = std::vector<const cbdc::atomizer::block*>{&blk};
+        for(auto it = m_deferred.find(blk.m_height + 1);
+            it != m_deferred.end() && it->first == run.back()->m_height + 1;
+            it++) {
+            run.push_back(&it->second);
+        }
 
-            const auto res = m_db->Write(m_write_options, &batch);
-            assert(res.ok());
+        m_logger->trace("Digesting blocks",
+                        blk.m_height,
+                        "to",
+                        run.back()->m_height,
+                        "...");
+        if(!write_blocks(run)) {
+            m_logger->error("Failed to write blocks",
+                            blk.m_height,
+                            "to",
+                            run.back()->m_height);
+            return;
+        }
+        m_best_height = run.back()->m_height;
+        m_logger->trace("Digested blocks", blk.m_height, "to", m_best_height);
 
-            m_logger->trace("Digested block ", blk.m_height);
-            if(m_sample_collection_active) {
+        if(m_sample_collection_active) {
+            for(const auto* b : run) {
                 const auto old_block_time = m_last_block_time;
                 m_last_block_time = std::chrono::high_resolution_clock::now();
                 const auto s_since_last_block = std::chrono::duration<double>(
                     m_last_block_time - old_block_time);
                 const auto tx_throughput
-                    = static_cast<double>(blk.m_transactions.size())
+                    = static_cast<double>(b->m_transactions.size())
                     / s_since_last_block.count();
 
                 m_tp_sample_file << tx_throughput << std::endl;
                 m_samples++;
             }
+        }
 
-            // Tell the atomizer cluster to prune all blocks <
-            // m_best_height
+        // Tell the atomizer cluster to prune all blocks < m_best_height,
+        // once they are durable. Archived blocks are synced in groups, and
+        // blocks lost before a sync are fetched from the atomizers again.
+        if(m_archive) {
+            m_unsynced += run.size();
+            if(m_unsynced >= m_opts.m_archiver_sync_blocks) {
+                if(m_archive->flush()) {
+                    m_unsynced = 0;
+                    request_prune(m_best_height);
+                } else {
+                    m_logger->error("Failed to sync block archive");
+                }
+            }
+        } else {
             request_prune(m_best_height);
+        }
 
-            auto it = m_deferred.find(blk.m_height + 1);
-            if(it != m_deferred.end()) {
-                next_blk = it->second;
-                digest_next = true;
-            }
+        m_deferred.erase(m_deferred.begin(),
+                         m_deferred.upper_bound(m_best_height));
+    }
 
-            m_deferred.erase(blk.m_height);
+    auto controller::write_blocks(
+        const std::vector<const cbdc::atomizer::block*>& blks) -> bool {
+        // Serialize, and compress for the archive, in parallel
+        auto bufs = std::vector<cbdc::buffer>(blks.size());
+        auto recs = std::vector<std::optional<block_archive::record>>(
+            m_archive ? blks.size() : 0);
+        for_each_chunk(m_digest_pool.get(),
+                       blks.size(),
+                       1,
+                       [&](size_t begin, size_t end) {
+                           for(auto i = begin; i < end; i++) {
+                               bufs[i] = make_buffer(*blks[i]);
+                               if(m_archive) {
+                                   recs[i] = m_archive->make_record(
+                                       blks[i]->m_height,
+                                       bufs[i]);
+                               }
+                           }
+                       });
+
+        if(m_archive) {
+            auto ready = std::vector<block_archive::record>();
+            ready.reserve(recs.size());
+            for(auto& rec : recs) {
+                if(!rec.has_value()) {
+                    return false;
+                }
+                ready.emplace_back(std::move(rec.value()));
+            }
+            return m_archive->append(ready);
         }
 
-        if(digest_next) {
-            // TODO: this can recurse back to genesis. In a long-running system
-            // we'll want an alternative method of building a new archiver node
-            // and limit the depth of recursion here.
-            digest_block(next_blk);
+        leveldb::WriteBatch batch;
+        for(size_t i{0}; i < blks.size(); i++) {
+            leveldb::Slice blk_slice(bufs[i].c_str(), bufs[i].size());
+            batch.Put(std::to_string(blks[i]->m_height), blk_slice);
         }
+        batch.Put(m_bestblock_key, std::to_string(blks.back()->m_height));
+        return m_db->Write(m_write_options, &batch).ok();
     }
 
     auto controller::get_block(uint64_t height)
         -> std::optional<cbdc::atomizer::block> {
         m_logger->trace(__func__, "(", height, ")");
+        if(m_archive) {
+            auto blk_buf = m_archive->get(height);
+            if(!blk_buf.has_value()) {
+                m_logger->warn("block", height, "not found");
+                return std::nullopt;
+            }
+            auto blk = from_buffer<atomizer::block>(blk_buf.value());
+            assert(blk.has_value());
+            return blk;
+        }
+
         std::string height_str = std::to_string(height);
         std::string blk_str;
         // Assume blocks with 100k 256-byte transactions.
@@ -275,6 +398,29 @@ namespace cbdc::archiver {
         return blk.value();
     }
 
+    auto controller::get_blocks(uint64_t height, uint64_t count)
+        -> std::vector<cbdc::atomizer::block> {
+        auto ret = std::vector<cbdc::atomizer::block>();
+        if(m_archive) {
+            // Consecutive blocks are read from the archive sequentially
+            for(auto& blk_buf : m_archive->get_range(height, count)) {
+                auto blk = from_buffer<atomizer::block>(blk_buf);
+                assert(blk.has_value());
+                ret.emplace_back(std::move(blk.value()));
+            }
+            return ret;
+        }
+
+        for(uint64_t i{0}; i < count; i++) {
+            auto blk = get_block(height + i);
+            if(!blk.has_value()) {
+                break;
+            }
+            ret.emplace_back(std::move(blk.value()));
+        }
+        return ret;
+    }
+
     void controller::request_block(uint64_t height) {
         m_logger->trace("Requesting block", height);
         auto req = atomizer::get_block_request{height};
@@ -6,9 +6,12 @@
 #ifndef OPENCBDC_TX_SRC_ARCHIVER_CONTROLLER_H_
 #define OPENCBDC_TX_SRC_ARCHIVER_CONTROLLER_H_
 
+#include "block_archive.hpp"
 #include "client.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
 #include "util/common/config.hpp"
+#include "util/common/leveldb_options.hpp"
+#include "util/common/thread_pool.hpp"
 #include "util/network/connection_manager.hpp"
 
 #include <leveldb/db.h>
@@ -46,6 +49,11 @@ namespace cbdc::archiver {
         /// \return true if initialization succeeded.
         auto init_leveldb() -> bool;
 
+        /// Initializes the segment file block archive, used in place of
+        /// the LevelDB database by the segment backend.
+        /// \return true if initialization succeeded.
+        auto init_block_archive() -> bool;
+
         /// Initializes the best block value.
         /// \return true if initialization succeeded.
         auto init_best_block() -> bool;
@@ -67,6 +75,8 @@ namespace cbdc::archiver {
         [[nodiscard]] auto best_block_height() const -> uint64_t;
 
         /// Receives a request for an archived block and returns the block.
+        /// For a range of blocks, sends each block to the client first and
+        /// returns std::nullopt to end the range.
         /// \param pkt packet containing the request.
         /// \return block or std::nullopt from \ref get_block.
         /// \see \ref network::packet_handler_t
@@ -88,7 +98,7 @@ namespace cbdc::archiver {
         /// height of the provided block, recursively requests preceding blocks
         /// from the atomizer. Stores each received block in a deferred
         /// processing cache until receiving the next contiguous block, then
-        /// digests each block in order.
+        /// digests the contiguous run of blocks in a single write.
         ///
         /// Instructs connected atomizers to prune digested blocks.
         /// \param blk block to digest.
@@ -102,6 +112,14 @@ namespace cbdc::archiver {
         auto get_block(uint64_t height)
             -> std::optional<cbdc::atomizer::block>;
 
+        /// Queries the archiver database for consecutive blocks.
+        /// \param height the height of the first block to retrieve.
+        /// \param count maximum number of blocks to retrieve.
+        /// \return the blocks from the given height, stopping at the first
+        ///         block the database does not contain.
+        auto get_blocks(uint64_t height, uint64_t count)
+            -> std::vector<cbdc::atomizer::block>;
+
         /// \brief Returns true if this archiver is receiving blocks
         /// from the atomizer.
         ///
@@ -115,7 +133,12 @@ namespace cbdc::archiver {
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
 
+        /// Must outlive m_db.
+        leveldb_options m_db_opts;
         std::unique_ptr<leveldb::DB> m_db;
+        std::unique_ptr<block_archive> m_archive;
+        /// Number of blocks appended to the archive since the last sync.
+        size_t m_unsynced{0};
         uint64_t m_best_height{0};
         /// Blocks pending digestion, waiting for the archiver to digest
         /// preceding blocks from the atomizer, keyed by height.
@@ -140,6 +163,19 @@ namespace cbdc::archiver {
         static constexpr const leveldb::ReadOptions m_read_options{};
         static constexpr const leveldb::WriteOptions m_write_options{true};
 
+        /// Serializes the blocks, and compresses them for the archive, on
+        /// the digest pool.
+        std::unique_ptr<thread_pool> m_digest_pool;
+
+        /// Number of blocks read at once when streaming a range.
+        static constexpr uint64_t m_read_ahead_blocks = 32;
+
+        /// Sends the blocks in a range to a client, one message per block.
+        void stream_blocks(const range_request& range,
+                           network::peer_id_t peer_id);
+        /// Writes a run of consecutive blocks to the database at once.
+        auto write_blocks(const std::vector<const cbdc::atomizer::block*>& blks)
+            -> bool;
         void request_block(uint64_t height);
         void request_prune(uint64_t height);
     };
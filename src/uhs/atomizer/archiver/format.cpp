@@ -0,0 +1,20 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "format.hpp"
+
+#include "util/serialization/format.hpp"
+
+namespace cbdc {
+    auto operator<<(serializer& packet, const archiver::range_request& req)
+        -> serializer& {
+        return packet << req.m_from << req.m_to;
+    }
+
+    auto operator>>(serializer& packet, archiver::range_request& req)
+        -> serializer& {
+        return packet >> req.m_from >> req.m_to;
+    }
+}
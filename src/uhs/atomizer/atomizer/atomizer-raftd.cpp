@@ -4,7 +4,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "controller.hpp"
+#include "util/common/affinity.hpp"
 #include "util/common/config.hpp"
+#include "util/common/huge_pages.hpp"
+#include "util/network/io_loop.hpp"
 #include "util/raft/console_logger.hpp"
 
 #include <csignal>
@@ -27,6 +30,13 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    cbdc::set_huge_pages(opts.m_huge_pages);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     if(opts.m_atomizer_endpoints.size() <= atomizer_id) {
         std::cerr << "Atomizer ID not in config file" << std::endl;
@@ -35,6 +45,9 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_atomizer_loglevels[atomizer_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
 
     auto ctl = cbdc::atomizer::controller{static_cast<uint32_t>(atomizer_id),
                                           opts,
@@ -46,14 +59,18 @@ auto main(int argc, char** argv) -> int {
 
     static std::atomic_bool running{true};
 
-    std::signal(SIGINT, [](int /* signal */) {
+    auto stop = [](int /* signal */) {
         running = false;
-    });
+    };
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
 
     while(running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
     };
 
+    ctl.transfer_leadership();
+
     return 0;
 }
 // LCOV_EXCL_STOP
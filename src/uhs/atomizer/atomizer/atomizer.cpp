@@ -9,32 +9,117 @@
 #include "util/common/config.hpp"
 #include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
+#include "util/serialization/size_serializer.hpp"
+
+#include <algorithm>
+#include <iterator>
 
 namespace cbdc::atomizer {
-    auto atomizer::make_block()
+    namespace {
+        /// Smallest number of transactions worth checking on another thread.
+        constexpr size_t min_check_chunk = 256;
+
+        /// Number of bits set in a bitset.
+        auto popcount(const small_vector<uint64_t, 1>& bits) -> size_t {
+            size_t count{0};
+            for(const auto word : bits) {
+                count += static_cast<size_t>(__builtin_popcountll(word));
+            }
+            return count;
+        }
+    }
+
+    atomizer::pending_tx::pending_tx(transaction::compact_tx tx)
+        : m_tx(std::move(tx)) {
+        m_attested.resize((m_tx.m_inputs.size() + 63) / 64);
+    }
+
+    void atomizer::pending_tx::attest(
+        const std::unordered_set<uint32_t>& attestations) {
+        for(const auto idx : attestations) {
+            if(idx < m_tx.m_inputs.size()) {
+                m_attested[idx / 64] |= uint64_t{1} << (idx % 64);
+            }
+        }
+    }
+
+    auto atomizer::pending_tx::operator==(const pending_tx& rhs) const
+        -> bool {
+        return m_tx == rhs.m_tx && m_attested == rhs.m_attested;
+    }
+
+    auto atomizer::make_block(size_t max_txs)
         -> std::pair<block, std::vector<cbdc::watchtower::tx_error>> {
         block blk;
 
-        blk.m_transactions.swap(m_complete_txs);
+        auto& complete_txs = writable(m_complete_txs);
+        auto carried = std::vector<transaction::compact_tx>();
+        if(max_txs != 0 && complete_txs.size() > max_txs) {
+            const auto first_carried
+                = complete_txs.begin() + static_cast<std::ptrdiff_t>(max_txs);
+            carried.assign(std::make_move_iterator(first_carried),
+                           std::make_move_iterator(complete_txs.end()));
+            complete_txs.erase(first_carried, complete_txs.end());
+        }
+        blk.m_transactions.swap(complete_txs);
+        complete_txs.swap(carried);
 
         m_best_height++;
 
         std::vector<cbdc::watchtower::tx_error> errs;
-        for(auto&& tx : m_txs[m_spent_cache_depth]) {
+        for(auto&& tx : *m_txs[m_spent_cache_depth]) {
             errs.push_back(cbdc::watchtower::tx_error{
-                tx.first.m_id,
+                tx.first,
                 cbdc::watchtower::tx_error_incomplete{}});
         }
 
         for(size_t i = m_spent_cache_depth; i > 0; i--) {
-            m_spent[i] = std::move(m_spent[i - 1]);
             m_txs[i] = std::move(m_txs[i - 1]);
         }
-
-        m_spent[0].clear();
-        m_txs[0].clear();
-        static constexpr auto initial_spent_cache_size = 500000;
-        m_spent[0].reserve(initial_spent_cache_size);
+        m_txs[0] = std::make_shared<tx_map>();
+
+        if(complete_txs.empty()) {
+            if(m_spent_cache_depth > 0) {
+                auto sealed = std::make_shared<sealed_spent>(
+                    m_spent_current->begin(),
+                    m_spent_current->end());
+                std::sort(sealed->begin(), sealed->end());
+                m_spent_sealed.pop_back();
+                m_spent_sealed.insert(m_spent_sealed.begin(),
+                                      std::move(sealed));
+            }
+            if(m_spent_current.use_count() > 1) {
+                // Sized for as many spends as the block just made
+                m_spent_current = std::make_shared<flat_hash_set>(
+                    m_spent_current->size());
+            } else {
+                m_spent_current->clear();
+            }
+        } else {
+            // Transactions carried over to the next block keep their inputs
+            // in the current spent set, so only the inputs of the block just
+            // made are sealed.
+            if(m_spent_cache_depth > 0) {
+                auto sealed = std::make_shared<sealed_spent>();
+                for(const auto& tx : blk.m_transactions) {
+                    sealed->insert(sealed->end(),
+                                   tx.m_inputs.begin(),
+                                   tx.m_inputs.end());
+                }
+                std::sort(sealed->begin(), sealed->end());
+                m_spent_sealed.pop_back();
+                m_spent_sealed.insert(m_spent_sealed.begin(),
+                                      std::move(sealed));
+            }
+            auto spent = std::make_shared<flat_hash_set>(
+                m_spent_current->size());
+            for(const auto& tx : complete_txs) {
+                for(const auto& inp : tx.m_inputs) {
+                    spent->insert(inp);
+                }
+            }
+            m_spent_current = std::move(spent);
+        }
 
         blk.m_height = m_best_height;
 
@@ -55,38 +140,40 @@ namespace cbdc::atomizer {
         // Search the incomplete transactions vector for this notification's
         // block height offset. Note, we might be able to defer this insertion
         // until after we've checked if the transaction is complete.
-        auto it = m_txs[height_offset].find(tx);
-        if(it == m_txs[height_offset].end()) {
+        auto& offset_txs = writable(m_txs[height_offset]);
+        const auto tx_id = tx.m_id;
+        auto it = offset_txs.find(tx_id);
+        if(it == offset_txs.end()) {
             // If we did not already receive a notification of this transaction
-            // for its height offset, insert the transaction and its
-            // attestations into the pending vector.
-            it = m_txs[height_offset]
-                     .insert({std::move(tx), std::move(attestations)})
-                     .first;
-        } else {
-            // Otherwise merge the new set of attestations with the existing
-            // set.
-            it->second.insert(attestations.begin(), attestations.end());
+            // for its height offset, insert the transaction into the pending
+            // vector.
+            it = offset_txs.emplace(tx_id, pending_tx(std::move(tx))).first;
         }
+        // Merge the new set of attestations with the existing set.
+        it->second.attest(attestations);
 
-        std::unordered_set<uint32_t> total_attestations;
+        auto total_attestations = small_vector<uint64_t, 1>();
+        total_attestations.resize(it->second.m_attested.size());
         size_t oldest_attestation{0};
-        std::map<size_t, decltype(m_txs)::value_type::const_iterator> tx_its;
+        std::map<size_t, tx_map::iterator> tx_its;
 
         // Iterate over each height offset in the incomplete transactions
         // vector to accumulate the sets of attestations received for any
         // offset in our cache.
         for(size_t offset = 0; offset <= m_spent_cache_depth; offset++) {
-            const auto& tx_map = m_txs[offset];
-
             // Check if we received a notification of this TX for the given
             // height offset.
-            const auto tx_it = tx_map.find(it->first);
-            if(tx_it != tx_map.end()) {
+            if(m_txs[offset]->count(tx_id) != 0) {
+                // The notification may be erased below, so take a writable
+                // copy of the map before saving an iterator into it.
+                const auto tx_it = writable(m_txs[offset]).find(tx_id);
+
                 // Merge the attestations from this offset with the full set of
                 // attestations so far.
-                total_attestations.insert(tx_it->second.begin(),
-                                          tx_it->second.end());
+                const auto& attested = tx_it->second.m_attested;
+                for(size_t i{0}; i < attested.size(); i++) {
+                    total_attestations[i] |= attested[i];
+                }
 
                 // Keep track of the oldest height offset that we're using
                 // an attestation from.
@@ -99,13 +186,13 @@ namespace cbdc::atomizer {
             }
         }
 
-        const auto& txit = it->first;
+        const auto& txit = it->second.m_tx;
 
         auto cache_check_range = oldest_attestation;
 
         // Check whether this transaction now has attestations for each of its
         // inputs.
-        if(total_attestations.size() == txit.m_inputs.size()) {
+        if(popcount(total_attestations) == txit.m_inputs.size()) {
             auto err_set = check_stxo_cache(txit, cache_check_range);
             if(err_set) {
                 return err_set;
@@ -119,11 +206,12 @@ namespace cbdc::atomizer {
             // vector, or erase the TX notification.
             for(const auto& pending_offset : tx_its) {
                 if(pending_offset.first == oldest_attestation) {
-                    auto tx_ext = m_txs[pending_offset.first].extract(
+                    auto tx_ext = m_txs[pending_offset.first]->extract(
                         pending_offset.second);
-                    m_complete_txs.push_back(std::move(tx_ext.key()));
+                    writable(m_complete_txs)
+                        .push_back(std::move(tx_ext.mapped().m_tx));
                 } else {
-                    m_txs[pending_offset.first].erase(pending_offset.second);
+                    m_txs[pending_offset.first]->erase(pending_offset.second);
                 }
             }
         }
@@ -150,13 +238,75 @@ namespace cbdc::atomizer {
 
         add_tx_to_stxo_cache(tx);
 
-        m_complete_txs.push_back(std::move(tx));
+        writable(m_complete_txs).push_back(std::move(tx));
 
         return std::nullopt;
     }
 
+    auto atomizer::insert_complete_batch(
+        std::vector<aggregate_tx_notification>&& txs,
+        thread_pool* pool) -> std::vector<cbdc::watchtower::tx_error> {
+        // Inputs of each transaction found in the spent cache as of the
+        // start of the batch, or nullopt if the transaction's attestations
+        // are too old to check.
+        auto checks = std::vector<std::optional<spent_set>>(txs.size());
+        auto check = [&](size_t begin, size_t end) {
+            for(size_t i{begin}; i < end; i++) {
+                const auto& msg = txs[i];
+                const auto height_offset
+                    = get_notification_offset(msg.m_oldest_attestation);
+                if(!check_notification_offset(height_offset, msg.m_tx)) {
+                    checks[i] = spent_inputs(msg.m_tx, height_offset);
+                }
+            }
+        };
+        for_each_chunk(pool, txs.size(), min_check_chunk, check);
+
+        // Resolve conflicts between transactions in the batch in order
+        auto errs = std::vector<cbdc::watchtower::tx_error>();
+        auto batch_spent = spent_set();
+        auto& spent = writable(m_spent_current);
+        auto& complete_txs = writable(m_complete_txs);
+        for(size_t i{0}; i < txs.size(); i++) {
+            auto& tx = txs[i].m_tx;
+            if(!checks[i]) {
+                errs.emplace_back(tx.m_id,
+                                  cbdc::watchtower::tx_error_stxo_range{});
+                continue;
+            }
+            auto& err_set = *checks[i];
+            for(const auto& inp : tx.m_inputs) {
+                if(batch_spent.count(inp) != 0) {
+                    err_set.insert(inp);
+                }
+            }
+            if(!err_set.empty()) {
+                errs.emplace_back(
+                    tx.m_id,
+                    cbdc::watchtower::tx_error_inputs_spent{
+                        std::move(err_set)});
+                continue;
+            }
+            batch_spent.insert(tx.m_inputs.begin(), tx.m_inputs.end());
+            for(const auto& inp : tx.m_inputs) {
+                spent.insert(inp);
+            }
+            complete_txs.push_back(std::move(tx));
+        }
+
+        return errs;
+    }
+
     auto atomizer::pending_transactions() const -> size_t {
-        return m_complete_txs.size();
+        return m_complete_txs->size();
+    }
+
+    auto atomizer::spent_memory_usage() const -> size_t {
+        auto ret = m_spent_current->memory_usage();
+        for(const auto& sealed : m_spent_sealed) {
+            ret += sealed->capacity() * sizeof(hash_t);
+        }
+        return ret;
     }
 
     auto atomizer::height() const -> uint64_t {
@@ -165,36 +315,127 @@ namespace cbdc::atomizer {
 
     atomizer::atomizer(const uint64_t best_height,
                        const size_t stxo_cache_depth)
-        : m_best_height(best_height),
+        : m_complete_txs(
+            std::make_shared<std::vector<transaction::compact_tx>>()),
+          m_spent_current(std::make_shared<flat_hash_set>()),
+          m_best_height(best_height),
           m_spent_cache_depth(stxo_cache_depth) {
-        m_txs.resize(stxo_cache_depth + 1);
-        m_spent.resize(stxo_cache_depth + 1);
+        for(size_t i{0}; i <= stxo_cache_depth; i++) {
+            m_txs.push_back(std::make_shared<tx_map>());
+        }
+        auto empty = std::make_shared<const sealed_spent>();
+        m_spent_sealed.resize(stxo_cache_depth, empty);
     }
 
     auto atomizer::serialize() -> cbdc::buffer {
+        // Size the snapshot first so it is written in one allocation
+        auto sizer = cbdc::size_serializer();
+        serialize(sizer);
         auto buf = cbdc::buffer();
+        buf.extend(sizer.size());
         auto ser = cbdc::buffer_serializer(buf);
-
-        ser << static_cast<uint64_t>(m_spent_cache_depth) << m_best_height
-            << m_complete_txs << m_spent << m_txs;
+        serialize(ser);
 
         return buf;
     }
 
-    void atomizer::deserialize(cbdc::serializer& buf) {
-        m_complete_txs.clear();
+    void atomizer::serialize(cbdc::serializer& ser) const {
+        // Same encoding as the vectors of containers the pointers share
+        ser << static_cast<uint64_t>(m_spent_cache_depth) << m_best_height
+            << *m_complete_txs;
+        ser << static_cast<uint64_t>(m_spent_sealed.size() + 1)
+            << *m_spent_current;
+        for(const auto& spent : m_spent_sealed) {
+            ser << *spent;
+        }
+        // Attestations are encoded as sets of input indices
+        ser << static_cast<uint64_t>(m_txs.size());
+        for(const auto& txs : m_txs) {
+            ser << static_cast<uint64_t>(txs->size());
+            for(const auto& [id, ptx] : *txs) {
+                ser << ptx.m_tx
+                    << static_cast<uint64_t>(popcount(ptx.m_attested));
+                for(uint32_t i{0}; i < ptx.m_tx.m_inputs.size(); i++) {
+                    if((ptx.m_attested[i / 64] >> (i % 64)) & 1U) {
+                        ser << i;
+                    }
+                }
+            }
+        }
+    }
 
-        m_spent.clear();
+    auto atomizer::clone() const -> std::shared_ptr<atomizer> {
+        auto ret = std::make_shared<atomizer>(m_best_height,
+                                              m_spent_cache_depth);
+        ret->m_txs = m_txs;
+        ret->m_complete_txs = m_complete_txs;
+        ret->m_spent_current = m_spent_current;
+        ret->m_spent_sealed = m_spent_sealed;
+        return ret;
+    }
 
+    void atomizer::deserialize(cbdc::serializer& buf) {
+        auto complete_txs = std::vector<transaction::compact_tx>();
+        auto n_spent = uint64_t();
+        auto current = std::make_shared<flat_hash_set>();
+        auto n_offsets = uint64_t();
+
+        buf >> m_spent_cache_depth >> m_best_height >> complete_txs >> n_spent
+            >> *current;
+        m_spent_sealed.clear();
+        for(uint64_t i{1}; i < n_spent; i++) {
+            // Snapshots from before heights were sealed are not sorted
+            auto sealed = std::make_shared<sealed_spent>();
+            buf >> *sealed;
+            std::sort(sealed->begin(), sealed->end());
+            m_spent_sealed.push_back(std::move(sealed));
+        }
+        buf >> n_offsets;
         m_txs.clear();
+        for(uint64_t i{0}; i < n_offsets && buf; i++) {
+            auto txs = std::make_shared<tx_map>();
+            auto n_txs = uint64_t();
+            buf >> n_txs;
+            for(uint64_t j{0}; j < n_txs && buf; j++) {
+                auto tx = transaction::compact_tx();
+                auto attestations = std::unordered_set<uint32_t>();
+                buf >> tx >> attestations;
+                const auto tx_id = tx.m_id;
+                auto ptx = pending_tx(std::move(tx));
+                ptx.attest(attestations);
+                txs->emplace(tx_id, std::move(ptx));
+            }
+            m_txs.push_back(std::move(txs));
+        }
 
-        buf >> m_spent_cache_depth >> m_best_height >> m_complete_txs
-            >> m_spent >> m_txs;
+        m_complete_txs = std::make_shared<decltype(complete_txs)>(
+            std::move(complete_txs));
+        m_spent_current = std::move(current);
     }
 
     auto atomizer::operator==(const atomizer& other) const -> bool {
-        return m_txs == other.m_txs && m_complete_txs == other.m_complete_txs
-            && m_spent == other.m_spent && m_best_height == other.m_best_height
+        auto deref_equal = [](const auto& a, const auto& b) {
+            return std::equal(a.begin(),
+                              a.end(),
+                              b.begin(),
+                              b.end(),
+                              [](const auto& x, const auto& y) {
+                                  return *x == *y;
+                              });
+        };
+        auto current_equal = [&]() {
+            return m_spent_current->size() == other.m_spent_current->size()
+                && std::all_of(m_spent_current->begin(),
+                               m_spent_current->end(),
+                               [&](const hash_t& key) {
+                                   return other.m_spent_current->contains(
+                                       key);
+                               });
+        };
+        return deref_equal(m_txs, other.m_txs)
+            && *m_complete_txs == *other.m_complete_txs && current_equal()
+            && deref_equal(m_spent_sealed, other.m_spent_sealed)
+            && m_best_height == other.m_best_height
             && m_spent_cache_depth == other.m_spent_cache_depth;
     }
 
@@ -221,31 +462,48 @@ namespace cbdc::atomizer {
     auto atomizer::check_stxo_cache(const transaction::compact_tx& tx,
                                     uint64_t cache_check_range) const
         -> std::optional<cbdc::watchtower::tx_error> {
+        auto err_set = spent_inputs(tx, cache_check_range);
+        if(!err_set.empty()) {
+            return cbdc::watchtower::tx_error{
+                tx.m_id,
+                cbdc::watchtower::tx_error_inputs_spent{std::move(err_set)}};
+        }
+
+        return std::nullopt;
+    }
+
+    auto atomizer::spent_inputs(const transaction::compact_tx& tx,
+                                uint64_t cache_check_range) const
+        -> spent_set {
         // For each height offset in our STXO cache up to the offset of the
         // oldest attestation we're using, check that the inputs have not
         // already been spent.
-        auto err_set = std::unordered_set<hash_t, hashing::null>{};
-        for(size_t offset = 0; offset <= cache_check_range; offset++) {
+        auto err_set = spent_set{};
+        for(const auto& inp : tx.m_inputs) {
+            if(m_spent_current->contains(inp)) {
+                err_set.insert(inp);
+            }
+        }
+        const auto sealed_range
+            = std::min<uint64_t>(cache_check_range, m_spent_sealed.size());
+        for(size_t offset = 1; offset <= sealed_range; offset++) {
+            const auto& sealed = *m_spent_sealed[offset - 1];
             for(const auto& inp : tx.m_inputs) {
-                if(m_spent[offset].find(inp) != m_spent[offset].end()) {
+                if(std::binary_search(sealed.begin(), sealed.end(), inp)) {
                     err_set.insert(inp);
                 }
             }
         }
-
-        if(!err_set.empty()) {
-            return cbdc::watchtower::tx_error{
-                tx.m_id,
-                cbdc::watchtower::tx_error_inputs_spent{std::move(err_set)}};
-        }
-
-        return std::nullopt;
+        return err_set;
     }
 
     void atomizer::add_tx_to_stxo_cache(const transaction::compact_tx& tx) {
         // None of the inputs have previously been spent during block heights
         // we used attestations from, so spend all the TX inputs in the current
         // block height (offset 0).
-        m_spent[0].insert(tx.m_inputs.begin(), tx.m_inputs.end());
+        auto& spent = writable(m_spent_current);
+        for(const auto& inp : tx.m_inputs) {
+            spent.insert(inp);
+        }
     }
 }
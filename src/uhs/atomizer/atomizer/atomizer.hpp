@@ -7,11 +7,16 @@
 #define OPENCBDC_TX_SRC_ATOMIZER_ATOMIZER_H_
 
 #include "block.hpp"
+#include "messages.hpp"
 #include "uhs/atomizer/watchtower/tx_error_messages.hpp"
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/flat_hash_set.hpp"
 #include "util/common/hashmap.hpp"
+#include "util/common/small_vector.hpp"
+#include "util/common/thread_pool.hpp"
 
 #include <map>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -28,6 +33,14 @@ namespace cbdc::atomizer {
     /// lower than the most recent block will be in the spent cache if they are
     /// unspendable. Otherwise, the atomizer can be certain the inputs not have
     /// been spent.
+    /// Pending transactions are keyed by ID and track the inputs attested
+    /// to so far in a bitset.
+    /// UHS IDs spent in the current block are kept in an open-addressing
+    /// hash set, which is sealed into a sorted array searched by bisection
+    /// when the block is made.
+    /// Internal state is held copy-on-write, so \ref clone can capture it
+    /// for serialization on another thread in time proportional to the cache
+    /// depth rather than to the number of cached entries.
     /// \warning Not thread-safe. Does not persist the atomizer internal state.
     class atomizer {
       public:
@@ -83,15 +96,41 @@ namespace cbdc::atomizer {
                                            transaction::compact_tx&& tx)
             -> std::optional<watchtower::tx_error>;
 
+        /// \brief Attempts to add a batch of complete transactions to the
+        /// next block.
+        ///
+        /// Equivalent to calling \ref insert_complete for each notification
+        /// in order. The notifications are first checked against the spent
+        /// UHS ID cache as of the start of the batch, which is not modified
+        /// until every check is done, so the checks are split across the
+        /// given thread pool. A sequential pass then rejects transactions
+        /// spending inputs spent by earlier transactions in the batch and
+        /// adds the remainder to the next block.
+        /// \param txs compact transactions and the block heights of their
+        ///            oldest attestations.
+        /// \param pool thread pool on which to check the batch, or nullptr to
+        ///             check it on the calling thread.
+        /// \return watchtower errors for the transactions which were not
+        ///         inserted, in batch order.
+        [[nodiscard]] auto
+        insert_complete_batch(std::vector<aggregate_tx_notification>&& txs,
+                              thread_pool* pool = nullptr)
+            -> std::vector<watchtower::tx_error>;
+
         /// Adds the current set of complete transactions to a new block and
         /// returns it for storage and transmission to subscribers. Rotates the
         /// STXO cache, evicting the oldest set of transactions. Generates and
         /// returns a set of errors containing an error for each incomplete
         /// transaction in the set of evicted transactions, or an empty vector
-        /// if there are no such errors.
+        /// if there are no such errors. If more than max_txs transactions are
+        /// complete, the oldest max_txs go into the block and the rest are
+        /// carried over to the next block, their inputs still counted as
+        /// spent.
+        /// \param max_txs maximum number of transactions in the block, or
+        ///                zero for no limit.
         /// \return a pair containing the resultant block and errors to forward
         ///         to the watchtower if necessary.
-        [[nodiscard]] auto make_block()
+        [[nodiscard]] auto make_block(size_t max_txs = 0)
             -> std::pair<cbdc::atomizer::block,
                          std::vector<watchtower::tx_error>>;
 
@@ -100,6 +139,10 @@ namespace cbdc::atomizer {
         /// \return number of transactions.
         [[nodiscard]] auto pending_transactions() const -> size_t;
 
+        /// Returns the memory used by the spent UHS ID cache.
+        /// \return bytes held by the current and sealed spent sets.
+        [[nodiscard]] auto spent_memory_usage() const -> size_t;
+
         /// Returns the height of the most recent block.
         /// \return block height.
         [[nodiscard]] auto height() const -> uint64_t;
@@ -108,6 +151,18 @@ namespace cbdc::atomizer {
         /// \return serialized atomizer state.
         [[nodiscard]] auto serialize() -> buffer;
 
+        /// Serializes the internal state of the atomizer to the given
+        /// serializer, in the format produced by \ref serialize.
+        /// \param ser serializer to write to.
+        void serialize(serializer& ser) const;
+
+        /// Returns a copy of the atomizer which shares storage with this
+        /// instance. Either instance copies a shared container before
+        /// modifying it, so the copy is unaffected by later changes to this
+        /// instance and may be read from another thread.
+        /// \return copy of the atomizer.
+        [[nodiscard]] auto clone() const -> std::shared_ptr<atomizer>;
+
         /// Replaces the state of this atomizer instance with the provided
         /// serialized state data.
         /// \param buf serialized atomizer state produced with \ref serialize.
@@ -116,16 +171,40 @@ namespace cbdc::atomizer {
         auto operator==(const atomizer& other) const -> bool;
 
       private:
-        std::vector<std::unordered_map<transaction::compact_tx,
-                                       std::unordered_set<uint32_t>,
-                                       transaction::compact_tx_hasher>>
-            m_txs;
+        /// A transaction pending attestations received at one height.
+        struct pending_tx {
+            /// Constructor. Sizes the bitset for the transaction's inputs.
+            /// \param tx the pending transaction.
+            explicit pending_tx(transaction::compact_tx tx);
+
+            transaction::compact_tx m_tx;
+            /// Bit i is set once input i has been attested to.
+            small_vector<uint64_t, 1> m_attested;
+
+            /// Marks the given inputs as attested to, ignoring indices past
+            /// the last input.
+            /// \param attestations input indices.
+            void attest(const std::unordered_set<uint32_t>& attestations);
+
+            auto operator==(const pending_tx& rhs) const -> bool;
+        };
 
         // These maps should be keyed/salted for safety. For now they
         // use input values directly as an optimization.
-        std::vector<transaction::compact_tx> m_complete_txs;
+        using tx_map = std::unordered_map<hash_t, pending_tx, hashing::null>;
+        using spent_set = std::unordered_set<hash_t, hashing::null>;
+        /// UHS IDs spent at a sealed block height, sorted.
+        using sealed_spent = std::vector<hash_t>;
+
+        std::vector<std::shared_ptr<tx_map>> m_txs;
 
-        std::vector<std::unordered_set<hash_t, hashing::null>> m_spent;
+        std::shared_ptr<std::vector<transaction::compact_tx>> m_complete_txs;
+
+        /// UHS IDs spent since the most recent block.
+        std::shared_ptr<flat_hash_set> m_spent_current;
+        /// UHS IDs spent in each of the most recent blocks, newest first.
+        /// Sealed heights are never modified, so clones share them freely.
+        std::vector<std::shared_ptr<const sealed_spent>> m_spent_sealed;
 
         uint64_t m_best_height{};
         size_t m_spent_cache_depth;
@@ -142,7 +221,21 @@ namespace cbdc::atomizer {
                                             uint64_t cache_check_range) const
             -> std::optional<watchtower::tx_error>;
 
+        [[nodiscard]] auto spent_inputs(const transaction::compact_tx& tx,
+                                        uint64_t cache_check_range) const
+            -> spent_set;
+
         void add_tx_to_stxo_cache(const transaction::compact_tx& tx);
+
+        /// Returns the given container for modification, first copying it
+        /// if it is shared with a clone.
+        template<typename T>
+        static auto writable(std::shared_ptr<T>& ptr) -> T& {
+            if(ptr.use_count() > 1) {
+                ptr = std::make_shared<T>(*ptr);
+            }
+            return *ptr;
+        }
     };
 }
 
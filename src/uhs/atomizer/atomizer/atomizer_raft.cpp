@@ -25,7 +25,9 @@ namespace cbdc::atomizer {
                false,
                nuraft::cs_new<state_machine>(
                    stxo_cache_depth,
-                   "atomizer_snps_" + std::to_string(atomizer_id)),
+                   "atomizer_snps_" + std::to_string(atomizer_id),
+                   state_machine::default_snapshot_chunk_size,
+                   opts.m_atomizer_check_threads),
                0,
                logger,
                std::move(raft_callback)),
@@ -52,6 +54,10 @@ namespace cbdc::atomizer {
         return get_sm()->tx_notify_count();
     }
 
+    auto atomizer_raft::pending_transactions() -> uint64_t {
+        return get_sm()->pending_transactions();
+    }
+
     void atomizer_raft::tx_notify(tx_notify_request&& notif) {
         if(!transaction::validation::check_attestations(
                notif.m_tx,
@@ -62,10 +68,12 @@ namespace cbdc::atomizer {
             return;
         }
 
-        auto maybe_tx = [&]() -> std::optional<decltype(m_txs)::node_type> {
-            std::unique_lock l(m_txs_mut);
-            auto it = m_txs.find(notif.m_tx);
-            if(it != m_txs.end()) {
+        // The map hashes the leading bytes of the ID, so stripe by the last
+        auto& stripe = m_pending[notif.m_tx.m_id.back() % pending_stripes];
+        auto maybe_tx = [&]() -> std::optional<pending_map::node_type> {
+            std::unique_lock l(stripe.m_mut);
+            auto it = stripe.m_txs.find(notif.m_tx);
+            if(it != stripe.m_txs.end()) {
                 for(auto n : notif.m_attestations) {
                     auto p = std::make_pair(n, notif.m_block_height);
                     auto n_it = it->second.find(p);
@@ -82,7 +90,7 @@ namespace cbdc::atomizer {
                     attestations.insert(
                         std::make_pair(n, notif.m_block_height));
                 }
-                it = m_txs
+                it = stripe.m_txs
                          .insert(std::make_pair(std::move(notif.m_tx),
                                                 std::move(attestations)))
                          .first;
@@ -94,7 +102,7 @@ namespace cbdc::atomizer {
                 return std::nullopt;
             }
 
-            auto tx = m_txs.extract(it);
+            auto tx = stripe.m_txs.extract(it);
             return tx;
         }();
 
@@ -113,25 +121,23 @@ namespace cbdc::atomizer {
         }
         agg.m_oldest_attestation = oldest;
 
-        {
-            std::lock_guard<std::mutex> l(m_complete_mut);
-            m_complete_txs.push_back(std::move(agg));
-        }
+        m_complete_txs.push(std::move(agg));
     }
 
     auto atomizer_raft::send_complete_txs(const raft::callback_type& result_fn)
         -> bool {
         auto atns = aggregate_tx_notify_request();
-        {
-            std::lock_guard<std::mutex> l(m_complete_mut);
-            std::swap(atns.m_agg_txs, m_complete_txs);
-        }
-        if(atns.m_agg_txs.empty()) {
+        if(m_complete_txs.pop_batch(atns.m_agg_txs, complete_queue_capacity)
+           == 0) {
             return false;
         }
         return make_request(atns, result_fn);
     }
 
+    void atomizer_raft::stop_complete_txs() {
+        m_complete_txs.clear();
+    }
+
     auto atomizer_raft::attestation_hash::operator()(
         const atomizer_raft::attestation& pair) const -> size_t {
         return std::hash<decltype(pair.first)>()(pair.first);
@@ -8,10 +8,13 @@
 
 #include "messages.hpp"
 #include "state_machine.hpp"
+#include "util/common/mpmc_queue.hpp"
 #include "util/network/connection_manager.hpp"
 #include "util/raft/node.hpp"
 #include "util/raft/state_manager.hpp"
 
+#include <array>
+
 namespace cbdc::atomizer {
     /// \brief Manager for an atomizer raft node.
     ///
@@ -53,22 +56,36 @@ namespace cbdc::atomizer {
         /// \return number of transaction notifications.
         [[nodiscard]] auto tx_notify_count() -> uint64_t;
 
+        /// Return the number of complete transactions waiting for the next
+        /// block in the state machine.
+        /// \return number of transactions.
+        [[nodiscard]] auto pending_transactions() -> uint64_t;
+
         /// Add the given transaction notification to the set of pending
         /// notifications. If the notification can be combined with previously
         /// received notifications to create an aggregate notification with a
         /// full set of input attestations, create an aggregate notification
-        /// and add it to a list of complete transactions.
+        /// and add it to a list of complete transactions. Safe to call from
+        /// several threads. Pending notifications are striped by transaction
+        /// ID, so only notifications for transactions in the same stripe
+        /// contend.
         /// \param notif transaction notification.
         void tx_notify(tx_notify_request&& notif);
 
         /// Replicate a transaction notification command in the state machine
-        /// containing the current set of complete transactions.
+        /// containing the current set of complete transactions. Blocks until
+        /// at least one complete transaction is available.
         /// \param result_fn function to call with the state machine execution
         ///                  result.
-        /// \return true if the command was accepted for replication.
+        /// \return true if the command was accepted for replication, false
+        ///         on failure or if \ref stop_complete_txs was called.
         [[nodiscard]] auto
         send_complete_txs(const raft::callback_type& result_fn) -> bool;
 
+        /// Discards the current set of complete transactions and unblocks
+        /// callers of \ref send_complete_txs.
+        void stop_complete_txs();
+
       private:
         static constexpr const auto m_node_type = "atomizer";
 
@@ -86,16 +103,24 @@ namespace cbdc::atomizer {
         using attestation_set = std::
             unordered_set<attestation, attestation_hash, attestation_cmp>;
 
-        std::unordered_map<transaction::compact_tx,
-                           attestation_set,
-                           transaction::compact_tx_hasher>
-            m_txs;
-        std::mutex m_complete_mut;
-        std::vector<aggregate_tx_notification> m_complete_txs;
+        using pending_map = std::unordered_map<transaction::compact_tx,
+                                               attestation_set,
+                                               transaction::compact_tx_hasher>;
+
+        /// Pending notifications for the transactions in one stripe.
+        struct pending_stripe {
+            std::mutex m_mut;
+            pending_map m_txs;
+        };
+
+        static constexpr size_t pending_stripes = 16;
+        static constexpr size_t complete_queue_capacity = 1 << 16;
+
+        std::array<pending_stripe, pending_stripes> m_pending;
+        mpmc_queue<aggregate_tx_notification> m_complete_txs{
+            complete_queue_capacity};
         std::shared_ptr<logging::log> m_log;
         config::options m_opts;
-
-        std::mutex m_txs_mut;
     };
 }
 
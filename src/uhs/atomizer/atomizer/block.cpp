@@ -9,4 +9,27 @@ namespace cbdc {
         return (rhs.m_height == m_height)
             && (rhs.m_transactions == m_transactions);
     }
+
+    auto atomizer::filter_block(const block& blk,
+                                const config::shard_range_t& range) -> block {
+        auto ret = block{blk.m_height, {}};
+        for(const auto& tx : blk.m_transactions) {
+            auto ctx = transaction::compact_tx();
+            ctx.m_id = tx.m_id;
+            for(const auto& inp : tx.m_inputs) {
+                if(config::hash_in_shard_range(range, inp)) {
+                    ctx.m_inputs.push_back(inp);
+                }
+            }
+            for(const auto& out : tx.m_uhs_outputs) {
+                if(config::hash_in_shard_range(range, out)) {
+                    ctx.m_uhs_outputs.push_back(out);
+                }
+            }
+            if(!ctx.m_inputs.empty() || !ctx.m_uhs_outputs.empty()) {
+                ret.m_transactions.push_back(std::move(ctx));
+            }
+        }
+        return ret;
+    }
 }
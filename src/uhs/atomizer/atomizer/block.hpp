@@ -8,6 +8,7 @@
 
 #include "uhs/transaction/transaction.hpp"
 #include "util/common/buffer.hpp"
+#include "util/common/config.hpp"
 
 #include <cassert>
 #include <cstddef>
@@ -25,6 +26,17 @@ namespace cbdc::atomizer {
         /// Compact transactions settled by the atomizer in this block.
         std::vector<transaction::compact_tx> m_transactions;
     };
+
+    /// Returns a copy of the block holding only the UHS IDs in the given
+    /// shard range. Transactions with no inputs or outputs in the range are
+    /// dropped and sentinel attestations are not copied. A shard only
+    /// applies the UHS IDs in its own range, so digesting the filtered block
+    /// has the same effect as digesting the full block.
+    /// \param blk block to filter.
+    /// \param range shard hash prefix range.
+    /// \return filtered block at the same height.
+    auto filter_block(const block& blk, const config::shard_range_t& range)
+        -> block;
 }
 
 #endif // OPENCBDC_TX_SRC_ATOMIZER_BLOCK_H_
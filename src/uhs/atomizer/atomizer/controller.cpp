@@ -11,6 +11,9 @@
 #include "util/raft/util.hpp"
 #include "util/serialization/format.hpp"
 
+#include <algorithm>
+#include <map>
+#include <optional>
 #include <utility>
 
 namespace cbdc::atomizer {
@@ -37,6 +40,7 @@ namespace cbdc::atomizer {
 
         m_running = false;
 
+        m_raft_node.stop_complete_txs();
         if(m_tx_notify_thread.joinable()) {
             m_tx_notify_thread.join();
         }
@@ -49,8 +53,8 @@ namespace cbdc::atomizer {
             m_main_thread.join();
         }
 
-        m_notification_queue.clear();
-        for(auto& t : m_notification_threads) {
+        m_request_queue.clear();
+        for(auto& t : m_request_threads) {
             if(t.joinable()) {
                 t.join();
             }
@@ -89,8 +93,8 @@ namespace cbdc::atomizer {
 
         auto n_threads = std::thread::hardware_concurrency();
         for(size_t i = 0; i < n_threads; i++) {
-            m_notification_threads.emplace_back([&]() {
-                notification_consumer();
+            m_request_threads.emplace_back([&]() {
+                request_consumer();
             });
         }
 
@@ -105,10 +109,16 @@ namespace cbdc::atomizer {
             return std::nullopt;
         }
 
+        // Requests are deserialized and handled on the consumer threads
+        m_request_queue.push(std::move(pkt));
+        return std::nullopt;
+    }
+
+    void controller::handle_request(network::message_t&& pkt) {
         auto maybe_req = from_buffer<request>(*pkt.m_pkt);
         if(!maybe_req.has_value()) {
             m_logger->error("Invalid request packet");
-            return std::nullopt;
+            return;
         }
 
         std::visit(
@@ -118,12 +128,41 @@ namespace cbdc::atomizer {
                                     to_string(notif.m_tx.m_id),
                                     "with height",
                                     notif.m_block_height);
-                    m_notification_queue.push(notif);
+                    m_raft_node.tx_notify(std::move(notif));
+                },
+                [&](tx_notify_batch_request& batch) {
+                    m_logger->trace("Received",
+                                    batch.m_txs.size(),
+                                    "transaction notifications with height",
+                                    batch.m_block_height);
+                    for(auto& n : batch.m_txs) {
+                        m_raft_node.tx_notify(
+                            tx_notify_request{std::move(n.m_tx),
+                                              std::move(n.m_attestations),
+                                              batch.m_block_height});
+                    }
                 },
                 [&](const prune_request& p) {
                     m_raft_node.make_request(p, nullptr);
                 },
+                [&](const block_subscribe_request& s) {
+                    m_logger->debug("Peer",
+                                    pkt.m_peer_id,
+                                    "subscribed to blocks in range",
+                                    static_cast<int>(s.m_range.first),
+                                    "-",
+                                    static_cast<int>(s.m_range.second));
+                    std::unique_lock l(m_block_subscribers_mut);
+                    m_block_subscribers[pkt.m_peer_id] = s.m_range;
+                },
                 [&](const get_block_request& g) {
+                    // Recent blocks are immutable and already serialized, so
+                    // they are sent without a round through raft
+                    if(auto blk_pkt = m_raft_node.get_sm()->block_packet(
+                           g.m_block_height)) {
+                        m_atomizer_network.send(blk_pkt, pkt.m_peer_id);
+                        return;
+                    }
                     auto result_fn = [&, peer_id = pkt.m_peer_id](
                                          raft::result_type& r,
                                          nuraft::ptr<std::exception>& err) {
@@ -151,8 +190,6 @@ namespace cbdc::atomizer {
                     m_raft_node.make_request(g, result_fn);
                 }},
             maybe_req.value());
-
-        return std::nullopt;
     }
 
     void controller::tx_notify_handler() {
@@ -169,26 +206,65 @@ namespace cbdc::atomizer {
     }
 
     void controller::main_handler() {
+        // Blocks are made every target interval while transactions are
+        // pending. Reaching the seal threshold makes a block as soon as the
+        // minimum interval allows, and so does the first transaction after
+        // an idle period. Empty blocks, which only rotate the spent cache,
+        // are made at an interval that doubles up to the maximum.
+        const auto target
+            = std::chrono::milliseconds(m_opts.m_target_block_interval);
+        const auto min_interval = std::min(
+            std::chrono::milliseconds(std::max(m_opts.m_min_block_interval,
+                                               size_t{1})),
+            target);
+        const auto max_interval = std::max(
+            std::chrono::milliseconds(m_opts.m_max_block_interval),
+            target);
+        auto idle_interval = target;
         auto last_time = std::chrono::high_resolution_clock::now();
 
         while(m_running) {
-            const auto next_time
-                = last_time
-                + std::chrono::milliseconds(m_opts.m_target_block_interval);
-            std::this_thread::sleep_until(next_time);
-            last_time = std::chrono::high_resolution_clock::now();
-
-            if(m_raft_node.is_leader()) {
-                auto req = make_block_request();
-                auto res
-                    = m_raft_node.make_request(req, [&](auto&& r, auto&& err) {
-                          raft_result_handler(
-                              std::forward<decltype(r)>(r),
-                              std::forward<decltype(err)>(err));
-                      });
-                if(!res && m_running) {
+            std::this_thread::sleep_for(min_interval);
+            const auto now = std::chrono::high_resolution_clock::now();
+            if(!m_raft_node.is_leader()) {
+                last_time = now;
+                idle_interval = target;
+                continue;
+            }
+
+            const auto elapsed = now - last_time;
+            const auto pending = m_raft_node.pending_transactions();
+            auto seal = false;
+            if(pending == 0) {
+                seal = elapsed >= idle_interval;
+            } else if(elapsed >= target) {
+                seal = true;
+            } else if(!m_block_in_flight) {
+                seal = idle_interval > target
+                    || (m_opts.m_block_seal_threshold != 0
+                        && pending >= m_opts.m_block_seal_threshold);
+            }
+            if(!seal) {
+                continue;
+            }
+
+            last_time = now;
+            idle_interval = pending == 0
+                              ? std::min(idle_interval * 2, max_interval)
+                              : target;
+
+            auto req = make_block_request{m_opts.m_max_block_txs};
+            m_block_in_flight = true;
+            auto res
+                = m_raft_node.make_request(req, [&](auto&& r, auto&& err) {
+                      raft_result_handler(std::forward<decltype(r)>(r),
+                                          std::forward<decltype(err)>(err));
+                  });
+            if(!res) {
+                m_block_in_flight = false;
+                if(m_running) {
                     m_logger->error("Failed to make block at time",
-                                    last_time.time_since_epoch().count());
+                                    now.time_since_epoch().count());
                 }
             }
         }
@@ -196,33 +272,48 @@ namespace cbdc::atomizer {
 
     void controller::raft_result_handler(raft::result_type& r,
                                          nuraft::ptr<std::exception>& err) {
+        m_block_in_flight = false;
         if(err) {
             return;
         }
 
         const auto res = r.get();
         assert(res);
-        auto maybe_resp = from_buffer<state_machine::response>(*res);
-        assert(maybe_resp.has_value());
-        assert(
-            std::holds_alternative<make_block_response>(maybe_resp.value()));
-        auto& resp = std::get<make_block_response>(maybe_resp.value());
-
-        auto blk_pkt = make_shared_buffer(resp.m_blk);
+        // The response holds the variant index, the errors and then the
+        // block, which starts with its height and transaction count. Read
+        // only up to those and send the block as the state machine
+        // serialized it when making it.
+        auto deser = nuraft_serializer(*res);
+        uint8_t resp_idx{};
+        auto errs = errors();
+        uint64_t height{};
+        uint64_t n_txs{};
+        deser >> resp_idx >> errs >> height >> n_txs;
+        assert(deser);
+        auto blk_pkt = m_raft_node.get_sm()->block_packet(height);
+        if(!blk_pkt) {
+            // Evicted by later blocks before this result arrived
+            auto maybe_resp = from_buffer<state_machine::response>(*res);
+            assert(maybe_resp.has_value());
+            assert(std::holds_alternative<make_block_response>(
+                maybe_resp.value()));
+            blk_pkt = make_shared_buffer(
+                std::get<make_block_response>(maybe_resp.value()).m_blk);
+        }
 
-        m_atomizer_network.broadcast(blk_pkt);
+        broadcast_block(blk_pkt);
 
         m_logger->info("Block h:",
-                       resp.m_blk.m_height,
+                       height,
                        ", nTXs:",
-                       resp.m_blk.m_transactions.size(),
+                       n_txs,
                        ", log idx:",
                        m_raft_node.last_log_idx(),
                        ", notifications:",
                        m_raft_node.tx_notify_count());
 
-        if(!resp.m_errs.empty()) {
-            auto buf = make_shared_buffer(resp.m_errs);
+        if(!errs.empty()) {
+            auto buf = make_shared_buffer(errs);
             m_watchtower_network.broadcast(buf);
         }
     }
@@ -244,6 +335,14 @@ namespace cbdc::atomizer {
         }
     }
 
+    void controller::transfer_leadership() {
+        if(m_opts.m_leadership_transfer_timeout == 0) {
+            return;
+        }
+        static_cast<void>(m_raft_node.transfer_leadership(
+            std::chrono::milliseconds(m_opts.m_leadership_transfer_timeout)));
+    }
+
     auto controller::raft_callback(nuraft::cb_func::Type type,
                                    nuraft::cb_func::Param* /* param */)
         -> nuraft::cb_func::ReturnCode {
@@ -262,8 +361,13 @@ namespace cbdc::atomizer {
             if(m_atomizer_server.joinable()) {
                 m_atomizer_server.join();
             }
-            // Reset the client network so we can use it again.
+            // Reset the client network so we can use it again. Peer IDs
+            // restart from zero so subscriptions from before are void.
             m_atomizer_network.reset();
+            {
+                std::unique_lock l(m_block_subscribers_mut);
+                m_block_subscribers.clear();
+            }
             // Start listening on our client endpoint and start the handler
             // thread.
             auto as = m_atomizer_network.start_server(
@@ -281,14 +385,50 @@ namespace cbdc::atomizer {
         return nuraft::cb_func::ReturnCode::Ok;
     }
 
-    void controller::notification_consumer() {
+    void controller::request_consumer() {
+        auto pkts = std::vector<network::message_t>();
+        pkts.reserve(request_batch_size);
         while(m_running) {
-            auto notif = tx_notify_request();
-            auto popped = m_notification_queue.pop(notif);
-            if(!popped) {
+            pkts.clear();
+            auto popped = m_request_queue.pop_batch(pkts, request_batch_size);
+            if(popped == 0) {
                 break;
             }
-            m_raft_node.tx_notify(std::move(notif));
+            for(auto& pkt : pkts) {
+                handle_request(std::move(pkt));
+            }
+        }
+    }
+
+    void controller::broadcast_block(const std::shared_ptr<buffer>& blk_pkt) {
+        auto subscribers = [&]() {
+            std::unique_lock l(m_block_subscribers_mut);
+            return m_block_subscribers;
+        }();
+        if(subscribers.empty()) {
+            m_atomizer_network.broadcast(blk_pkt);
+            return;
+        }
+
+        // Decode the block and serialize each filtered block at most once
+        auto blk = std::optional<block>();
+        auto filtered_pkts
+            = std::map<config::shard_range_t, std::shared_ptr<buffer>>();
+        for(const auto peer_id : m_atomizer_network.peer_ids()) {
+            auto it = subscribers.find(peer_id);
+            if(it == subscribers.end()) {
+                m_atomizer_network.send(blk_pkt, peer_id);
+                continue;
+            }
+            auto& pkt = filtered_pkts[it->second];
+            if(!pkt) {
+                if(!blk) {
+                    blk = from_buffer<block>(*blk_pkt);
+                    assert(blk.has_value());
+                }
+                pkt = make_shared_buffer(filter_block(*blk, it->second));
+            }
+            m_atomizer_network.send(pkt, peer_id);
         }
     }
 }
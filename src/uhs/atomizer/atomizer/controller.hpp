@@ -8,10 +8,13 @@
 
 #include "atomizer_raft.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
+#include "util/common/mpmc_queue.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace cbdc::atomizer {
     /// Wrapper for the atomizer raft executable implementation.
@@ -37,6 +40,11 @@ namespace cbdc::atomizer {
         /// \return true if initialization succeeded.
         auto init() -> bool;
 
+        /// Hands raft leadership to an up-to-date follower if this
+        /// atomizer leads, so block production resumes without waiting
+        /// for an election. Call before shutting down.
+        void transfer_leadership();
+
       private:
         uint32_t m_atomizer_id;
         cbdc::config::options m_opts;
@@ -44,6 +52,10 @@ namespace cbdc::atomizer {
 
         atomizer_raft m_raft_node;
         std::atomic_bool m_running{true};
+        /// Set while a make block request replicates, so pending
+        /// transactions do not trigger another early block before it
+        /// commits.
+        std::atomic_bool m_block_in_flight{false};
 
         cbdc::network::connection_manager m_watchtower_network;
         cbdc::network::connection_manager m_atomizer_network;
@@ -52,8 +64,20 @@ namespace cbdc::atomizer {
         std::thread m_tx_notify_thread;
         std::thread m_main_thread;
 
-        blocking_queue<tx_notify_request> m_notification_queue;
-        std::vector<std::thread> m_notification_threads;
+        static constexpr size_t request_queue_capacity = 1 << 14;
+        static constexpr size_t request_batch_size = 64;
+        /// Raw request packets from the network handler thread. Consumer
+        /// threads deserialize them, check attestations and aggregate
+        /// notifications in parallel.
+        mpmc_queue<network::message_t> m_request_queue{
+            request_queue_capacity};
+        std::vector<std::thread> m_request_threads;
+
+        /// Shard range of each peer subscribed to filtered blocks. Other
+        /// peers receive full blocks.
+        std::unordered_map<network::peer_id_t, config::shard_range_t>
+            m_block_subscribers;
+        std::mutex m_block_subscribers_mut;
 
         auto server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
@@ -66,7 +90,9 @@ namespace cbdc::atomizer {
         auto raft_callback(nuraft::cb_func::Type type,
                            nuraft::cb_func::Param* param)
             -> nuraft::cb_func::ReturnCode;
-        void notification_consumer();
+        void request_consumer();
+        void handle_request(network::message_t&& pkt);
+        void broadcast_block(const std::shared_ptr<buffer>& blk_pkt);
     };
 }
 
@@ -11,6 +11,20 @@
 #include "util/serialization/util.hpp"
 
 namespace cbdc {
+    namespace {
+        /// Writes the serialized block if there is one, or else serializes
+        /// the block.
+        auto write_block(serializer& ser,
+                         const atomizer::block& blk,
+                         const std::shared_ptr<buffer>& pkt) -> serializer& {
+            if(pkt) {
+                ser.write(pkt->data(), pkt->size());
+                return ser;
+            }
+            return ser << blk;
+        }
+    }
+
     auto operator<<(serializer& packet, const cbdc::atomizer::block& blk)
         -> serializer& {
         return packet << blk.m_height << blk.m_transactions;
@@ -24,11 +38,10 @@ namespace cbdc {
     auto operator<<(serializer& ser,
                     const atomizer::state_machine::snapshot& snp)
         -> serializer& {
-        auto atomizer_buf = snp.m_atomizer->serialize();
         auto snp_buf = snp.m_snp->serialize();
         ser << static_cast<uint64_t>(snp_buf->size());
         ser.write(snp_buf->data_begin(), snp_buf->size());
-        ser.write(atomizer_buf.data(), atomizer_buf.size());
+        snp.m_atomizer->serialize(ser);
         ser << *snp.m_blocks;
         return ser;
     }
@@ -60,6 +73,29 @@ namespace cbdc {
         return packet;
     }
 
+    auto operator<<(serializer& packet,
+                    const cbdc::atomizer::tx_notification& msg)
+        -> serializer& {
+        return packet << msg.m_tx << msg.m_attestations;
+    }
+
+    auto operator>>(serializer& packet, cbdc::atomizer::tx_notification& msg)
+        -> serializer& {
+        return packet >> msg.m_tx >> msg.m_attestations;
+    }
+
+    auto operator<<(serializer& packet,
+                    const cbdc::atomizer::tx_notify_batch_request& msg)
+        -> serializer& {
+        return packet << msg.m_block_height << msg.m_txs;
+    }
+
+    auto operator>>(serializer& packet,
+                    cbdc::atomizer::tx_notify_batch_request& msg)
+        -> serializer& {
+        return packet >> msg.m_block_height >> msg.m_txs;
+    }
+
     auto operator<<(serializer& packet,
                     const cbdc::atomizer::aggregate_tx_notification& msg)
         -> serializer& {
@@ -95,14 +131,18 @@ namespace cbdc {
         return deser >> r.m_block_height;
     }
 
-    auto operator<<(serializer& ser,
-                    const atomizer::make_block_request& /* r */)
+    auto operator<<(serializer& ser, const atomizer::make_block_request& r)
         -> serializer& {
-        return ser;
+        return ser << r.m_max_txs;
     }
-    auto operator>>(serializer& deser, atomizer::make_block_request& /* r */)
+    auto operator>>(serializer& deser, atomizer::make_block_request& r)
         -> serializer& {
-        return deser;
+        // Requests logged before the block size limit carry no fields
+        r.m_max_txs = 0;
+        if(deser.end_of_buffer()) {
+            return deser;
+        }
+        return deser >> r.m_max_txs;
     }
 
     auto operator<<(serializer& ser, const atomizer::get_block_request& r)
@@ -114,18 +154,30 @@ namespace cbdc {
         return deser >> r.m_block_height;
     }
 
+    auto operator<<(serializer& ser,
+                    const atomizer::block_subscribe_request& r)
+        -> serializer& {
+        return ser << r.m_range;
+    }
+    auto operator>>(serializer& deser, atomizer::block_subscribe_request& r)
+        -> serializer& {
+        return deser >> r.m_range;
+    }
+
     auto operator<<(serializer& ser, const atomizer::make_block_response& r)
         -> serializer& {
-        return ser << r.m_blk << r.m_errs;
+        // Errors first, so readers can stop before the block
+        ser << r.m_errs;
+        return write_block(ser, r.m_blk, r.m_blk_pkt);
     }
     auto operator>>(serializer& deser, atomizer::make_block_response& r)
         -> serializer& {
-        return deser >> r.m_blk >> r.m_errs;
+        return deser >> r.m_errs >> r.m_blk;
     }
 
     auto operator<<(serializer& ser, const atomizer::get_block_response& r)
         -> serializer& {
-        return ser << r.m_blk;
+        return write_block(ser, r.m_blk, r.m_blk_pkt);
     }
     auto operator>>(serializer& deser, atomizer::get_block_response& r)
         -> serializer& {
@@ -33,6 +33,17 @@ namespace cbdc {
     auto operator>>(serializer& packet, atomizer::tx_notify_request& msg)
         -> serializer&;
 
+    auto operator<<(serializer& packet, const atomizer::tx_notification& msg)
+        -> serializer&;
+    auto operator>>(serializer& packet, atomizer::tx_notification& msg)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const atomizer::tx_notify_batch_request& msg)
+        -> serializer&;
+    auto operator>>(serializer& packet, atomizer::tx_notify_batch_request& msg)
+        -> serializer&;
+
     auto operator<<(serializer& packet, const cbdc::atomizer::block& blk)
         -> serializer&;
     auto operator>>(serializer& packet, cbdc::atomizer::block& blk)
@@ -53,6 +64,12 @@ namespace cbdc {
     auto operator>>(serializer& deser, atomizer::get_block_request& r)
         -> serializer&;
 
+    auto operator<<(serializer& ser,
+                    const atomizer::block_subscribe_request& r)
+        -> serializer&;
+    auto operator>>(serializer& deser, atomizer::block_subscribe_request& r)
+        -> serializer&;
+
     auto operator<<(serializer& ser, const atomizer::make_block_response& r)
         -> serializer&;
     auto operator>>(serializer& deser, atomizer::make_block_response& r)
@@ -12,6 +12,16 @@ namespace cbdc::atomizer {
             && (rhs.m_block_height == m_block_height);
     }
 
+    auto tx_notification::operator==(const tx_notification& rhs) const
+        -> bool {
+        return (rhs.m_tx == m_tx) && (rhs.m_attestations == m_attestations);
+    }
+
+    auto tx_notify_batch_request::operator==(
+        const tx_notify_batch_request& rhs) const -> bool {
+        return (rhs.m_block_height == m_block_height) && (rhs.m_txs == m_txs);
+    }
+
     auto aggregate_tx_notification::operator==(
         const aggregate_tx_notification& rhs) const -> bool {
         return (rhs.m_oldest_attestation == m_oldest_attestation)
@@ -22,4 +32,9 @@ namespace cbdc::atomizer {
         const aggregate_tx_notify_request& rhs) const -> bool {
         return rhs.m_agg_txs == m_agg_txs;
     }
+
+    auto block_subscribe_request::operator==(
+        const block_subscribe_request& rhs) const -> bool {
+        return rhs.m_range == m_range;
+    }
 }
@@ -10,6 +10,8 @@
 #include "uhs/atomizer/watchtower/tx_error_messages.hpp"
 #include "uhs/transaction/transaction.hpp"
 
+#include <memory>
+
 namespace cbdc::atomizer {
     /// \brief Transaction notification message.
     ///
@@ -30,6 +32,33 @@ namespace cbdc::atomizer {
         uint64_t m_block_height{};
     };
 
+    /// Transaction and input attestations within a
+    /// \ref tx_notify_batch_request.
+    struct tx_notification {
+        auto operator==(const tx_notification& rhs) const -> bool;
+
+        /// Compact transaction associated with the notification.
+        transaction::compact_tx m_tx;
+        /// Set of input indexes the shard is attesting are unspent at the
+        /// batch's block height.
+        std::unordered_set<uint64_t> m_attestations;
+    };
+
+    /// \brief Batch of transaction notifications.
+    ///
+    /// Sent from shards to the atomizer in place of several
+    /// \ref tx_notify_request with the same block height, so the atomizer
+    /// handles one message for the batch.
+    struct tx_notify_batch_request {
+        auto operator==(const tx_notify_batch_request& rhs) const -> bool;
+
+        /// Block height at which the attestations of every transaction in
+        /// the batch are valid.
+        uint64_t m_block_height{};
+        /// Transaction notifications.
+        std::vector<tx_notification> m_txs;
+    };
+
     /// \brief Transaction notification message with a full set of input
     ///        attestations.
     ///
@@ -61,8 +90,13 @@ namespace cbdc::atomizer {
         std::vector<aggregate_tx_notification> m_agg_txs;
     };
 
-    /// Placeholder struct for a make block state machine request.
-    struct make_block_request {};
+    /// Make block state machine request.
+    struct make_block_request {
+        /// Maximum number of transactions in the block, or zero for no
+        /// limit. Complete transactions past the limit are carried over to
+        /// the next block.
+        uint64_t m_max_txs{};
+    };
 
     /// Prune blocks request for RPC and state machine.
     struct prune_request {
@@ -76,6 +110,18 @@ namespace cbdc::atomizer {
         uint64_t m_block_height{};
     };
 
+    /// \brief Block subscription request.
+    ///
+    /// Sent from shards to the atomizer. Asks the atomizer to send the
+    /// shard only the UHS IDs of each new block within the given range,
+    /// rather than the full block. \see filter_block.
+    struct block_subscribe_request {
+        auto operator==(const block_subscribe_request& rhs) const -> bool;
+
+        /// Hash prefix range of the UHS IDs the shard holds.
+        config::shard_range_t m_range{};
+    };
+
     /// List of watchtower errors returned by the atomizer state machine.
     using errors = std::vector<watchtower::tx_error>;
 
@@ -85,17 +131,26 @@ namespace cbdc::atomizer {
         block m_blk;
         /// Watchtower errors resulting from block creation.
         errors m_errs;
+        /// Block already serialized by the state machine, or nullptr.
+        /// When set, it is written in place of m_blk.
+        std::shared_ptr<buffer> m_blk_pkt{};
     };
 
     /// Atomizer state machine response from get block request.
     struct get_block_response {
         /// Block returned by request.
         block m_blk;
+        /// Block already serialized by the state machine, or nullptr.
+        /// When set, it is written in place of m_blk.
+        std::shared_ptr<buffer> m_blk_pkt{};
     };
 
     /// Atomizer RPC request.
-    using request
-        = std::variant<tx_notify_request, prune_request, get_block_request>;
+    using request = std::variant<tx_notify_request,
+                                 prune_request,
+                                 get_block_request,
+                                 block_subscribe_request,
+                                 tx_notify_batch_request>;
 }
 
 #endif
@@ -7,6 +7,7 @@
 
 #include "atomizer.hpp"
 #include "atomizer_raft.hpp"
+#include "crypto/siphash.h"
 #include "format.hpp"
 #include "util/raft/serialization.hpp"
 #include "util/raft/util.hpp"
@@ -15,15 +16,53 @@
 #include "util/serialization/ostream_serializer.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <libnuraft/nuraft.hxx>
 #include <utility>
 
 namespace cbdc::atomizer {
+    namespace {
+        constexpr uint64_t chunk_checksum_k0 = 0x61746d;
+        constexpr uint64_t chunk_checksum_k1 = 0x736e70;
+
+        auto chunk_checksum(uint64_t snp_idx,
+                            uint64_t obj_id,
+                            const unsigned char* data,
+                            size_t len) -> uint64_t {
+            return CSipHasher(chunk_checksum_k0, chunk_checksum_k1)
+                .Write(snp_idx)
+                .Write(obj_id)
+                .Write(data, len)
+                .Finalize();
+        }
+
+        auto is_snapshot_name(const std::string& name) -> bool {
+            return !name.empty()
+                && std::all_of(name.begin(), name.end(), [](char c) {
+                       return c >= '0' && c <= '9';
+                   });
+        }
+    }
+
     state_machine::state_machine(size_t stxo_cache_depth,
-                                 std::string snapshot_dir)
+                                 std::string snapshot_dir,
+                                 size_t snapshot_chunk_size,
+                                 size_t check_threads)
         : m_snapshot_dir(std::move(snapshot_dir)),
-          m_stxo_cache_depth(stxo_cache_depth) {
+          m_stxo_cache_depth(stxo_cache_depth),
+          m_snapshot_chunk_size(snapshot_chunk_size) {
+        if(check_threads == 0) {
+            check_threads
+                = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        if(check_threads > 1) {
+            // The commit thread checks part of each batch itself
+            m_check_pool
+                = std::make_unique<thread_pool>(check_threads - 1,
+                                                false,
+                                                thread_role::executor);
+        }
         m_atomizer = std::make_shared<atomizer>(0, m_stxo_cache_depth);
         m_blocks = std::make_shared<decltype(m_blocks)::element_type>();
         auto err = std::error_code();
@@ -39,6 +78,12 @@ namespace cbdc::atomizer {
         }
     }
 
+    state_machine::~state_machine() {
+        if(m_snp_thread.joinable()) {
+            m_snp_thread.join();
+        }
+    }
+
     auto state_machine::commit(nuraft::ulong log_idx, nuraft::buffer& data)
         -> nuraft::ptr<nuraft::buffer> {
         assert(log_idx == m_last_committed_idx + 1);
@@ -50,17 +95,12 @@ namespace cbdc::atomizer {
             overloaded{
                 [&](aggregate_tx_notify_request& r)
                     -> std::optional<response> {
-                    auto errs = errors();
-                    for(auto&& msg : r.m_agg_txs) {
-                        auto err = m_atomizer->insert_complete(
-                            msg.m_oldest_attestation,
-                            std::move(msg.m_tx));
-
-                        if(err.has_value()) {
-                            errs.push_back(*err);
-                        }
-                        m_tx_notify_count++;
-                    }
+                    m_tx_notify_count += r.m_agg_txs.size();
+                    auto errs = m_atomizer->insert_complete_batch(
+                        std::move(r.m_agg_txs),
+                        m_check_pool.get());
+
+                    m_pending_txs = m_atomizer->pending_transactions();
 
                     if(!errs.empty()) {
                         return errs;
@@ -68,13 +108,23 @@ namespace cbdc::atomizer {
 
                     return std::nullopt;
                 },
-                [&](const make_block_request& /* r */)
-                    -> std::optional<response> {
-                    auto [blk, errs] = m_atomizer->make_block();
-                    m_blocks->emplace(blk.m_height, blk);
-                    return make_block_response{blk, errs};
+                [&](const make_block_request& r) -> std::optional<response> {
+                    auto [blk, errs] = m_atomizer->make_block(r.m_max_txs);
+                    m_pending_txs = m_atomizer->pending_transactions();
+                    // Serialized once here for the response, broadcasting
+                    // and later get block requests
+                    auto pkt = make_shared_buffer(blk);
+                    const auto height = blk.m_height;
+                    writable_blocks().emplace(height, std::move(blk));
+                    cache_block_packet(height, pkt);
+                    return make_block_response{{},
+                                               std::move(errs),
+                                               std::move(pkt)};
                 },
                 [&](const get_block_request& r) -> std::optional<response> {
+                    if(auto pkt = block_packet(r.m_block_height)) {
+                        return get_block_response{{}, std::move(pkt)};
+                    }
                     auto it = m_blocks->find(r.m_block_height);
                     if(it != m_blocks->end()) {
                         return get_block_response{it->second};
@@ -82,9 +132,16 @@ namespace cbdc::atomizer {
                     return std::nullopt;
                 },
                 [&](const prune_request& r) -> std::optional<response> {
-                    for(auto it = m_blocks->begin(); it != m_blocks->end();) {
+                    {
+                        std::unique_lock l(m_block_pkts_mut);
+                        m_block_pkts.erase(
+                            m_block_pkts.begin(),
+                            m_block_pkts.lower_bound(r.m_block_height));
+                    }
+                    auto& blocks = writable_blocks();
+                    for(auto it = blocks.begin(); it != blocks.end();) {
                         if(it->second.m_height < r.m_block_height) {
-                            it = m_blocks->erase(it);
+                            it = blocks.erase(it);
                         } else {
                             it++;
                         }
@@ -110,39 +167,45 @@ namespace cbdc::atomizer {
     auto
     state_machine::read_logical_snp_obj(nuraft::snapshot& s,
                                         void*& /* user_snp_ctx */,
-                                        nuraft::ulong /* obj_id */,
+                                        nuraft::ulong obj_id,
                                         nuraft::ptr<nuraft::buffer>& data_out,
                                         bool& is_last_obj) -> int {
         auto path = get_snapshot_path(s.get_last_log_idx());
-        {
-            std::shared_lock<std::shared_mutex> l(m_snp_mut);
-            auto ss = std::ifstream(path, std::ios::in | std::ios::binary);
-            if(!ss.good()) {
-                // Requested snapshot doesn't exit anymore, not fatal
-                return -1;
-            }
-            auto err = std::error_code();
-            auto sz = std::filesystem::file_size(path, err);
-            if(err) {
-                // If we got this far, this should work unless our system is
-                // broken
-                std::exit(EXIT_FAILURE);
-            }
-            auto buf = nuraft::buffer::alloc(sz);
-            auto read_vec = std::vector<char>(sz);
-            ss.read(read_vec.data(),
-                    static_cast<std::streamsize>(buf->size()));
-            if(!ss.good()) {
-                // If we got this far, this should work unless our system is
-                // broken
-                std::exit(EXIT_FAILURE);
-            }
-            std::memcpy(buf->data_begin(), read_vec.data(), sz);
-            data_out = std::move(buf);
+        std::shared_lock<std::shared_mutex> l(m_snp_mut);
+        auto ss = std::ifstream(path, std::ios::in | std::ios::binary);
+        if(!ss.good()) {
+            // Requested snapshot doesn't exit anymore, not fatal
+            return -1;
+        }
+        auto err = std::error_code();
+        auto sz = std::filesystem::file_size(path, err);
+        if(err) {
+            // If we got this far, this should work unless our system is
+            // broken
+            std::exit(EXIT_FAILURE);
         }
+        const auto offset = obj_id * m_snapshot_chunk_size;
+        if(offset >= sz) {
+            return -1;
+        }
+        const auto len = std::min(m_snapshot_chunk_size, sz - offset);
+
+        auto buf = nuraft::buffer::alloc(sizeof(uint64_t) + len);
+        auto* chunk = buf->data_begin() + sizeof(uint64_t);
+        ss.seekg(static_cast<std::streamoff>(offset));
+        ss.read(reinterpret_cast<char*>(chunk),
+                static_cast<std::streamsize>(len));
+        if(!ss.good()) {
+            // If we got this far, this should work unless our system is
+            // broken
+            std::exit(EXIT_FAILURE);
+        }
+        const auto sum
+            = chunk_checksum(s.get_last_log_idx(), obj_id, chunk, len);
+        std::memcpy(buf->data_begin(), &sum, sizeof(sum));
 
-        // TODO: send and receive in chunks
-        is_last_obj = true;
+        data_out = std::move(buf);
+        is_last_obj = offset + len >= sz;
 
         return 0;
     }
@@ -150,32 +213,55 @@ namespace cbdc::atomizer {
     void state_machine::save_logical_snp_obj(nuraft::snapshot& s,
                                              nuraft::ulong& obj_id,
                                              nuraft::buffer& data,
-                                             bool /* is_first_obj */,
-                                             bool /* is_last_obj */) {
-        assert(obj_id == 0);
-        auto tmp_path = get_tmp_path();
-        {
-            std::unique_lock<std::shared_mutex> l(m_snp_mut);
-            auto ss = std::ofstream(tmp_path,
-                                    std::ios::out | std::ios::trunc
-                                        | std::ios::binary);
-            if(!ss.good()) {
-                // Since we're the exclusive writer, this should work
-                std::exit(EXIT_FAILURE);
-            }
+                                             bool is_first_obj,
+                                             bool is_last_obj) {
+        const auto snp_idx = s.get_last_log_idx();
+        if(is_first_obj) {
+            m_recv_snp_idx = snp_idx;
+            m_recv_next_obj = 0;
+        }
+        if(snp_idx != m_recv_snp_idx) {
+            // A chunk of a snapshot we did not see the start of, so restart
+            // the transfer
+            obj_id = 0;
+            return;
+        }
+        if(obj_id != m_recv_next_obj) {
+            obj_id = m_recv_next_obj;
+            return;
+        }
 
-            auto write_vec = std::vector<char>(data.size());
-            std::memcpy(write_vec.data(), data.data_begin(), data.size());
-            ss.write(write_vec.data(),
-                     static_cast<std::streamsize>(data.size()));
-            if(!ss.good()) {
-                std::exit(EXIT_FAILURE);
-            }
+        uint64_t sum{};
+        if(data.size() < sizeof(sum)) {
+            return;
+        }
+        std::memcpy(&sum, data.data_begin(), sizeof(sum));
+        const auto* chunk = data.data_begin() + sizeof(sum);
+        const auto len = data.size() - sizeof(sum);
+        if(chunk_checksum(snp_idx, obj_id, chunk, len) != sum) {
+            // Leave the object ID unchanged so the chunk is sent again
+            return;
+        }
 
-            ss.flush();
-            ss.close();
+        auto tmp_path = get_tmp_path(m_tmp_file);
+        auto mode = std::ios::out | std::ios::binary;
+        mode |= is_first_obj ? std::ios::trunc : std::ios::app;
+        auto ss = std::ofstream(tmp_path, mode);
+        if(!ss.good()) {
+            // Since we're the exclusive writer, this should work
+            std::exit(EXIT_FAILURE);
+        }
+        ss.write(reinterpret_cast<const char*>(chunk),
+                 static_cast<std::streamsize>(len));
+        if(!ss.good()) {
+            std::exit(EXIT_FAILURE);
+        }
+        ss.flush();
+        ss.close();
 
-            auto path = get_snapshot_path(s.get_last_log_idx());
+        if(is_last_obj) {
+            std::unique_lock<std::shared_mutex> l(m_snp_mut);
+            auto path = get_snapshot_path(snp_idx);
             auto err = std::error_code();
             std::filesystem::rename(tmp_path, path, err);
             if(err) {
@@ -183,6 +269,7 @@ namespace cbdc::atomizer {
             }
         }
 
+        m_recv_next_obj++;
         obj_id++;
     }
 
@@ -191,6 +278,11 @@ namespace cbdc::atomizer {
         if(snp) {
             m_blocks = snp->m_blocks;
             m_atomizer = snp->m_atomizer;
+            m_pending_txs = m_atomizer->pending_transactions();
+            {
+                std::unique_lock l(m_block_pkts_mut);
+                m_block_pkts.clear();
+            }
             m_last_committed_idx = s.get_last_log_idx();
         }
         return snp.has_value();
@@ -212,67 +304,111 @@ namespace cbdc::atomizer {
         nuraft::snapshot& s,
         nuraft::async_result<bool>::handler_type& when_done) {
         assert(s.get_last_log_idx() == last_commit_index());
-        nuraft::ptr<std::exception> except(nullptr);
-        bool ret = true;
 
+        // Cloning the atomizer and sharing the block cache are cheap, and
+        // later commits copy whatever they modify, so the snapshot thread
+        // sees the state as of this log index
         auto snp_ser = s.serialize();
-        auto snp = snapshot{m_atomizer,
+        auto snp = snapshot{m_atomizer->clone(),
                             nuraft::snapshot::deserialize(*snp_ser),
                             m_blocks};
 
-        auto tmp_path = get_tmp_path();
-        auto path = get_snapshot_path(s.get_last_log_idx());
-        {
-            std::unique_lock<std::shared_mutex> l(m_snp_mut);
-            auto ss = std::ofstream(tmp_path,
-                                    std::ios::out | std::ios::trunc
-                                        | std::ios::binary);
-            if(!ss.good()) {
-                // We're the exclusive writer so these file operations should
-                // work
-                std::exit(EXIT_FAILURE);
-            }
+        // NuRaft creates one snapshot at a time, so any previous snapshot
+        // thread has already called its handler
+        if(m_snp_thread.joinable()) {
+            m_snp_thread.join();
+        }
+        m_snp_thread = std::thread([this, snp = std::move(snp), when_done]() {
+            write_snapshot(snp);
+            bool ret = true;
+            nuraft::ptr<std::exception> except(nullptr);
+            when_done(ret, except);
+        });
+    }
 
-            auto ser = cbdc::ostream_serializer(ss);
-            if(!(ser << snp)) {
-                std::exit(EXIT_FAILURE);
-            }
+    void state_machine::write_snapshot(const snapshot& snp) {
+        const auto idx = snp.m_snp->get_last_log_idx();
+        auto tmp_path = get_tmp_path(m_create_tmp_file);
+        auto path = get_snapshot_path(idx);
 
-            ss.flush();
-            ss.close();
+        auto ss = std::ofstream(tmp_path,
+                                std::ios::out | std::ios::trunc
+                                    | std::ios::binary);
+        if(!ss.good()) {
+            // We're the exclusive writer so these file operations should
+            // work
+            std::exit(EXIT_FAILURE);
+        }
 
-            auto err = std::error_code();
-            std::filesystem::rename(tmp_path, path, err);
-            if(err) {
-                std::exit(EXIT_FAILURE);
-            }
+        auto ser = cbdc::ostream_serializer(ss);
+        if(!(ser << snp)) {
+            std::exit(EXIT_FAILURE);
+        }
 
-            for(const auto& p :
-                std::filesystem::directory_iterator(m_snapshot_dir)) {
-                auto name = p.path().filename().generic_string();
-                if(name == m_tmp_file
-                   || std::stoull(name) < s.get_last_log_idx()) {
-                    std::filesystem::remove(p, err);
-                    if(err) {
-                        std::exit(EXIT_FAILURE);
-                    }
+        ss.flush();
+        ss.close();
+
+        std::unique_lock<std::shared_mutex> l(m_snp_mut);
+        auto err = std::error_code();
+        std::filesystem::rename(tmp_path, path, err);
+        if(err) {
+            std::exit(EXIT_FAILURE);
+        }
+
+        for(const auto& p :
+            std::filesystem::directory_iterator(m_snapshot_dir)) {
+            auto name = p.path().filename().generic_string();
+            if(is_snapshot_name(name) && std::stoull(name) < idx) {
+                std::filesystem::remove(p, err);
+                if(err) {
+                    std::exit(EXIT_FAILURE);
                 }
             }
         }
-
-        when_done(ret, except);
     }
 
     auto state_machine::tx_notify_count() -> uint64_t {
         return m_tx_notify_count;
     }
 
+    auto state_machine::pending_transactions() const -> uint64_t {
+        return m_pending_txs;
+    }
+
+    auto state_machine::block_packet(uint64_t height) const
+        -> std::shared_ptr<buffer> {
+        std::unique_lock l(m_block_pkts_mut);
+        auto it = m_block_pkts.find(height);
+        if(it == m_block_pkts.end()) {
+            return nullptr;
+        }
+        return it->second;
+    }
+
+    void state_machine::cache_block_packet(uint64_t height,
+                                           std::shared_ptr<buffer> pkt) {
+        std::unique_lock l(m_block_pkts_mut);
+        m_block_pkts[height] = std::move(pkt);
+        while(m_block_pkts.size() > block_packet_cache_size) {
+            m_block_pkts.erase(m_block_pkts.begin());
+        }
+    }
+
     auto state_machine::get_snapshot_path(uint64_t idx) const -> std::string {
         return m_snapshot_dir + "/" + std::to_string(idx);
     }
 
-    auto state_machine::get_tmp_path() const -> std::string {
-        return m_snapshot_dir + "/" + m_tmp_file;
+    auto state_machine::get_tmp_path(const std::string& name) const
+        -> std::string {
+        return m_snapshot_dir + "/" + name;
+    }
+
+    auto state_machine::writable_blocks() -> blockstore_t& {
+        // The block cache may be shared with a snapshot being written
+        if(m_blocks.use_count() > 1) {
+            m_blocks = std::make_shared<blockstore_t>(*m_blocks);
+        }
+        return *m_blocks;
     }
 
     auto state_machine::read_snapshot(uint64_t idx)
@@ -288,7 +424,7 @@ namespace cbdc::atomizer {
                     std::exit(EXIT_FAILURE);
                 }
                 auto name = p.path().filename().generic_string();
-                if(name == m_tmp_file) {
+                if(!is_snapshot_name(name)) {
                     continue;
                 }
                 auto f_idx = std::stoull(name);
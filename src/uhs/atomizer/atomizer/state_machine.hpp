@@ -10,21 +10,49 @@
 #include "messages.hpp"
 
 #include <libnuraft/nuraft.hxx>
+#include <map>
+#include <mutex>
 #include <shared_mutex>
+#include <thread>
 
 namespace cbdc::atomizer {
     /// \brief Raft state machine for managing a replicated atomizer.
     ///
     /// Contains a \ref atomizer and a cache of recently created blocks.
     /// Accepts requests to retrieve and prune recent blocks from the cache.
+    /// Snapshots are written in the background from a copy-on-write clone
+    /// of the state, and transferred to other nodes in checksummed chunks
+    /// which the receiver writes to disk as they arrive.
     class state_machine : public nuraft::state_machine {
       public:
+        /// Default size of the snapshot chunks sent to other nodes, in
+        /// bytes.
+        static constexpr size_t default_snapshot_chunk_size
+            = 4UL * 1024 * 1024;
+
         /// Constructor.
         /// \param stxo_cache_depth depth of the spent transaction output
         ///                         cache, passed to the atomizer.
         /// \param snapshot_dir path to directory in which to store snapshots.
         ///                     Will create the directory if it doesn't exist.
-        state_machine(size_t stxo_cache_depth, std::string snapshot_dir);
+        /// \param snapshot_chunk_size maximum size of each snapshot chunk
+        ///                            sent to other nodes.
+        /// \param check_threads number of threads on which to check batches
+        ///                      of transaction notifications against the
+        ///                      spent cache. Zero uses one per hardware
+        ///                      thread.
+        state_machine(size_t stxo_cache_depth,
+                      std::string snapshot_dir,
+                      size_t snapshot_chunk_size = default_snapshot_chunk_size,
+                      size_t check_threads = 1);
+
+        /// Destructor. Waits for any snapshot being written to finish.
+        ~state_machine() override;
+
+        state_machine(const state_machine&) = delete;
+        auto operator=(const state_machine&) -> state_machine& = delete;
+        state_machine(state_machine&&) = delete;
+        auto operator=(state_machine&&) -> state_machine& = delete;
 
         /// Atomizer state machine request.
         using request = std::variant<aggregate_tx_notify_request,
@@ -51,8 +79,9 @@ namespace cbdc::atomizer {
             nuraft::ulong log_idx,
             nuraft::ptr<nuraft::cluster_config>& /*new_conf*/) override;
 
-        /// Read the portion of the state machine snapshot associated with
-        /// the given metadata and object ID into a buffer.
+        /// Read the chunk of the state machine snapshot associated with the
+        /// given metadata and object ID into a buffer, prefixed with a
+        /// checksum of the chunk.
         /// \param s metadata of snapshot to read.
         /// \param user_snp_ctx pointer to a snapshot context; must be provided
         ///                     to all successive calls to this method for the
@@ -69,8 +98,11 @@ namespace cbdc::atomizer {
                              nuraft::ptr<nuraft::buffer>& data_out,
                              bool& is_last_obj) -> int override;
 
-        /// Saves the portion of the state machine snapshot associated with
-        /// the given metadata and object ID into persistent storage.
+        /// Appends the chunk of the state machine snapshot associated with
+        /// the given metadata and object ID to the snapshot being received,
+        /// and completes the snapshot file after the last chunk. Requests
+        /// the chunk again by leaving the object ID unchanged if its
+        /// checksum does not match.
         /// \param s metadata of snapshot to save.
         /// \param obj_id ID of the snapshot object to save.
         /// \param data buffer from which to read the snapshot object data to
@@ -101,7 +133,9 @@ namespace cbdc::atomizer {
         /// \return log index.
         [[nodiscard]] auto last_commit_index() -> nuraft::ulong override;
 
-        /// Creates a snapshot with the given metadata.
+        /// Creates a snapshot with the given metadata. Captures the state
+        /// and writes it to disk on a background thread, so commits are not
+        /// blocked while the snapshot is written.
         /// \param s snapshot metadata.
         /// \param when_done function to call when snapshot creation is
         ///                  complete.
@@ -114,6 +148,20 @@ namespace cbdc::atomizer {
         /// \return transaction notification count.
         [[nodiscard]] auto tx_notify_count() -> uint64_t;
 
+        /// Returns the number of complete transactions waiting for the next
+        /// block as of the most recent commit. Safe to call from any thread.
+        /// \return number of transactions.
+        [[nodiscard]] auto pending_transactions() const -> uint64_t;
+
+        /// Returns a recent block as serialized when it was made, ready to
+        /// send to peers. The buffer is shared and must not be modified.
+        /// Safe to call from any thread.
+        /// \param height height of the block.
+        /// \return serialized block, or nullptr if the block is not among
+        ///         the most recent blocks.
+        [[nodiscard]] auto block_packet(uint64_t height) const
+            -> std::shared_ptr<buffer>;
+
         /// Maps block heights to blocks.
         using blockstore_t
             = std::unordered_map<uint64_t, cbdc::atomizer::block>;
@@ -133,12 +181,22 @@ namespace cbdc::atomizer {
         [[nodiscard]] auto get_snapshot_path(uint64_t idx) const
             -> std::string;
 
-        [[nodiscard]] auto get_tmp_path() const -> std::string;
+        [[nodiscard]] auto get_tmp_path(const std::string& name) const
+            -> std::string;
 
         [[nodiscard]] auto read_snapshot(uint64_t idx)
             -> std::optional<snapshot>;
 
+        void write_snapshot(const snapshot& snp);
+
+        auto writable_blocks() -> blockstore_t&;
+
+        void cache_block_packet(uint64_t height, std::shared_ptr<buffer> pkt);
+
+        /// Temporary file for the snapshot being received from the leader.
         static constexpr auto m_tmp_file = "tmp";
+        /// Temporary file for the snapshot being created locally.
+        static constexpr auto m_create_tmp_file = "tmp_create";
 
         std::atomic<uint64_t> m_last_committed_idx{0};
 
@@ -146,12 +204,29 @@ namespace cbdc::atomizer {
         std::shared_ptr<blockstore_t> m_blocks;
 
         std::atomic<uint64_t> m_tx_notify_count{0};
+        std::atomic<uint64_t> m_pending_txs{0};
+
+        /// Number of most recent blocks kept serialized.
+        static constexpr size_t block_packet_cache_size = 64;
+        /// Most recent blocks serialized when they were made, by height.
+        std::map<uint64_t, std::shared_ptr<buffer>> m_block_pkts;
+        mutable std::mutex m_block_pkts_mut;
 
         std::string m_snapshot_dir;
 
         size_t m_stxo_cache_depth{};
+        size_t m_snapshot_chunk_size;
 
         std::shared_mutex m_snp_mut;
+
+        std::thread m_snp_thread;
+
+        /// Threads helping the commit thread check notification batches, or
+        /// nullptr if batches are checked on the commit thread alone.
+        std::unique_ptr<thread_pool> m_check_pool;
+
+        uint64_t m_recv_snp_idx{};
+        uint64_t m_recv_next_obj{};
     };
 }
 #endif // OPENCBDC_TX_SRC_ATOMIZER_STATE_MACHINE_H_
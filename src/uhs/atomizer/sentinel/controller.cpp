@@ -5,9 +5,14 @@
 
 #include "controller.hpp"
 
+#include "uhs/atomizer/shard/messages.hpp"
 #include "uhs/sentinel/format.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/messages.hpp"
 #include "util/rpc/tcp_server.hpp"
+#include "util/serialization/buffer_serializer.hpp"
 
+#include <algorithm>
 #include <random>
 #include <utility>
 
@@ -19,6 +24,17 @@ namespace cbdc::sentinel {
           m_opts(std::move(opts)),
           m_logger(std::move(logger)) {}
 
+    controller::~controller() {
+        {
+            std::unique_lock l(m_shard_batch_mut);
+            m_running = false;
+        }
+        m_shard_batch_cv.notify_one();
+        if(m_shard_batch_thread.joinable()) {
+            m_shard_batch_thread.join();
+        }
+    }
+
     auto controller::init() -> bool {
         auto skey = m_opts.m_sentinel_private_keys.find(m_sentinel_id);
         if(skey == m_opts.m_sentinel_private_keys.end()) {
@@ -27,9 +43,21 @@ namespace cbdc::sentinel {
         }
         m_privkey = skey->second;
 
-        auto pubkey = pubkey_from_privkey(m_privkey, m_secp.get());
+        auto pubkey = pubkey_from_privkey(m_privkey, secp_context().get());
         m_logger->info("Sentinel public key:", cbdc::to_string(pubkey));
 
+        if(m_sentinel_id < m_opts.m_sentinel_capture_paths.size()) {
+            const auto& path = m_opts.m_sentinel_capture_paths[m_sentinel_id];
+            if(path.has_value()) {
+                m_capture = std::make_unique<trace_writer>(path.value());
+                if(!m_capture->good()) {
+                    m_logger->error("Failed to open capture file", *path);
+                    return false;
+                }
+                m_logger->info("Capturing transactions to", *path);
+            }
+        }
+
         m_shard_data.reserve(m_opts.m_shard_endpoints.size());
         for(size_t i{0}; i < m_opts.m_shard_endpoints.size(); i++) {
             const auto& shard = m_opts.m_shard_endpoints[i];
@@ -51,6 +79,10 @@ namespace cbdc::sentinel {
         }
 
         m_shard_dist = decltype(m_shard_dist)(0, m_shard_data.size() - 1);
+        m_shard_batches.resize(m_shard_data.size());
+        m_shard_batch_thread = std::thread([&]() {
+            shard_batch_loop();
+        });
 
         for(const auto& ep : m_opts.m_sentinel_endpoints) {
             if(ep == m_opts.m_sentinel_endpoints[m_sentinel_id]) {
@@ -85,6 +117,9 @@ namespace cbdc::sentinel {
 
     auto controller::execute_transaction(transaction::full_tx tx)
         -> std::optional<cbdc::sentinel::execute_response> {
+        if(m_capture) {
+            m_capture->append(tx);
+        }
         const auto res = transaction::validation::check_tx(tx);
         tx_status status{tx_status::pending};
         if(res.has_value()) {
@@ -109,7 +144,7 @@ namespace cbdc::sentinel {
 
     void controller::send_transaction(const transaction::full_tx& tx) {
         auto compact_tx = cbdc::transaction::compact_tx(tx);
-        auto attestation = compact_tx.sign(m_secp.get(), m_privkey);
+        auto attestation = compact_tx.sign(secp_context().get(), m_privkey);
         compact_tx.m_attestations.insert(attestation);
 
         gather_attestations(tx, compact_tx, {});
@@ -122,7 +157,7 @@ namespace cbdc::sentinel {
             return std::nullopt;
         }
         auto compact_tx = cbdc::transaction::compact_tx(tx);
-        auto attestation = compact_tx.sign(m_secp.get(), m_privkey);
+        auto attestation = compact_tx.sign(secp_context().get(), m_privkey);
         return attestation;
     }
 
@@ -170,13 +205,12 @@ namespace cbdc::sentinel {
     }
 
     void controller::send_compact_tx(const transaction::compact_tx& ctx) {
-        auto ctx_pkt = std::make_shared<cbdc::buffer>(cbdc::make_buffer(ctx));
-
         auto offset = [&]() {
             std::unique_lock l(m_rand_mut);
             return m_shard_dist(m_rand);
         }();
         auto inputs_sent = std::unordered_set<size_t>();
+        auto targets = std::vector<size_t>();
         for(size_t i = 0; i < m_shard_data.size(); i++) {
             auto idx = (i + offset) % m_shard_data.size();
             const auto& range = m_shard_data[idx].m_range;
@@ -192,15 +226,91 @@ namespace cbdc::sentinel {
                 if(inputs_sent.find(j) != inputs_sent.end()) {
                     continue;
                 }
-                if(!config::hash_in_shard_range(range, ctx.m_inputs[i])) {
+                if(!config::hash_in_shard_range(range, ctx.m_inputs[j])) {
                     continue;
                 }
                 inputs_sent.insert(j);
                 should_send = true;
             }
             if(should_send) {
-                m_shard_network.send(ctx_pkt, pid);
+                targets.push_back(idx);
+            }
+        }
+        if(targets.empty()) {
+            return;
+        }
+
+        {
+            std::unique_lock l(m_shard_batch_mut);
+            for(auto idx : targets) {
+                m_shard_batches[idx].push_back(ctx);
+            }
+            m_shard_batch_pending = true;
+        }
+        m_shard_batch_cv.notify_one();
+    }
+
+    void controller::shard_batch_loop() {
+        const auto max_size
+            = std::max<size_t>(m_opts.m_sentinel_shard_batch_size, 1);
+        const auto linger = std::chrono::microseconds(
+            m_opts.m_sentinel_shard_batch_linger_us);
+        auto full = [&]() {
+            return std::any_of(m_shard_batches.begin(),
+                               m_shard_batches.end(),
+                               [&](const auto& b) {
+                                   return b.size() >= max_size;
+                               });
+        };
+        auto l = std::unique_lock(m_shard_batch_mut);
+        while(true) {
+            m_shard_batch_cv.wait(l, [&]() {
+                return m_shard_batch_pending || !m_running;
+            });
+            if(!m_shard_batch_pending) {
+                break;
+            }
+            // Give concurrent transactions to the same shards a chance to
+            // share the message
+            m_shard_batch_cv.wait_for(l, linger, [&]() {
+                return full() || !m_running;
+            });
+            auto batches = std::vector<std::vector<transaction::compact_tx>>(
+                m_shard_batches.size());
+            batches.swap(m_shard_batches);
+            m_shard_batch_pending = false;
+            l.unlock();
+            for(size_t idx = 0; idx < batches.size(); idx++) {
+                send_shard_batch(idx, std::move(batches[idx]), max_size);
+            }
+            l.lock();
+        }
+    }
+
+    void
+    controller::send_shard_batch(size_t idx,
+                                 std::vector<transaction::compact_tx> txs,
+                                 size_t max_size) {
+        const auto& pid = m_shard_data[idx].m_peer_id;
+        for(size_t first = 0; first < txs.size(); first += max_size) {
+            auto last = std::min(first + max_size, txs.size());
+            if(last - first == 1) {
+                // Shards also accept single transactions without the
+                // batch envelope
+                m_shard_network.send(
+                    std::make_shared<cbdc::buffer>(make_buffer(txs[first])),
+                    pid);
+                continue;
             }
+            auto batch = cbdc::rpc::batch_request<transaction::compact_tx>{
+                {std::make_move_iterator(
+                     txs.begin() + static_cast<std::ptrdiff_t>(first)),
+                 std::make_move_iterator(
+                     txs.begin() + static_cast<std::ptrdiff_t>(last))}};
+            auto pkt = std::make_shared<cbdc::buffer>();
+            auto ser = cbdc::buffer_serializer(*pkt);
+            ser << shard::tx_batch_marker << batch;
+            m_shard_network.send(pkt, pid);
         }
     }
 }
@@ -10,11 +10,15 @@
 #include "uhs/sentinel/async_interface.hpp"
 #include "uhs/sentinel/client.hpp"
 #include "uhs/sentinel/interface.hpp"
+#include "uhs/sentinel/trace.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 
 namespace cbdc::sentinel {
     /// Sentinel implementation.
@@ -34,9 +38,11 @@ namespace cbdc::sentinel {
                    config::options opts,
                    std::shared_ptr<logging::log> logger);
 
-        ~controller() override = default;
+        /// Stops the thread sending transactions to shards.
+        ~controller() override;
 
-        /// Initializes the controller. Establishes connections to the shards
+        /// Initializes the controller. Opens the capture file if configured
+        /// and establishes connections to the shards.
         /// \return true if initialization succeeded.
         auto init() -> bool;
 
@@ -67,11 +73,6 @@ namespace cbdc::sentinel {
 
         std::unique_ptr<rpc::server> m_rpc_server;
 
-        std::unique_ptr<secp256k1_context,
-                        decltype(&secp256k1_context_destroy)>
-            m_secp{secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
-                   &secp256k1_context_destroy};
-
         std::vector<std::unique_ptr<sentinel::rpc::client>>
             m_sentinel_clients{};
 
@@ -83,6 +84,18 @@ namespace cbdc::sentinel {
 
         privkey_t m_privkey{};
 
+        /// Records transactions from clients for replay, if enabled.
+        std::unique_ptr<trace_writer> m_capture;
+
+        /// Compact transactions waiting to be sent to each shard, by index
+        /// in m_shard_data.
+        std::mutex m_shard_batch_mut;
+        std::condition_variable m_shard_batch_cv;
+        std::vector<std::vector<transaction::compact_tx>> m_shard_batches;
+        bool m_shard_batch_pending{false};
+        bool m_running{true};
+        std::thread m_shard_batch_thread;
+
         void send_transaction(const transaction::full_tx& tx);
 
         void validate_result_handler(async_interface::validate_result v_res,
@@ -94,7 +107,15 @@ namespace cbdc::sentinel {
                                  const transaction::compact_tx& ctx,
                                  std::unordered_set<size_t> requested);
 
+        /// Queues the transaction for each shard holding one of its
+        /// inputs.
         void send_compact_tx(const transaction::compact_tx& ctx);
+        void shard_batch_loop();
+        /// Sends the transactions to the shard in messages of at most
+        /// max_size transactions.
+        void send_shard_batch(size_t idx,
+                              std::vector<transaction::compact_tx> txs,
+                              size_t max_size);
     };
 }
 
@@ -5,8 +5,10 @@
 
 #include "controller.hpp"
 #include "crypto/sha256.h"
+#include "util/common/affinity.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
+#include "util/network/io_loop.hpp"
 
 #include <csignal>
 #include <iostream>
@@ -30,6 +32,12 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     if(opts.m_sentinel_endpoints.size() <= sentinel_id) {
         std::cerr << "Sentinel ID not in config file" << std::endl;
@@ -38,6 +46,9 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_sentinel_loglevels[sentinel_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
 
     std::string sha2_impl(SHA256AutoDetect());
     logger->info("using sha2:", sha2_impl);
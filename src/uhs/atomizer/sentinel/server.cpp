@@ -48,6 +48,25 @@ namespace cbdc::sentinel::rpc {
                 },
                 [&](validate_request v_req) -> std::optional<response> {
                     return m_impl->validate_transaction(std::move(v_req));
+                },
+                [&](validate_batch_request b_req) -> std::optional<response> {
+                    auto ret = validate_batch_response();
+                    ret.reserve(b_req.m_txs.size());
+                    for(auto& tx : b_req.m_txs) {
+                        ret.push_back(
+                            m_impl->validate_transaction(std::move(tx)));
+                    }
+                    return ret;
+                },
+                [&](const submit_request& /* s_req */)
+                    -> std::optional<response> {
+                    // Atomizer sentinels keep no record of transaction
+                    // results to poll, so only support execute_request
+                    return std::nullopt;
+                },
+                [&](const status_request& /* s_req */)
+                    -> std::optional<response> {
+                    return std::nullopt;
                 }},
             req.first);
 
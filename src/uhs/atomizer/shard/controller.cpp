@@ -5,19 +5,36 @@
 
 #include "controller.hpp"
 
+#include "format.hpp"
+#include "messages.hpp"
 #include "uhs/atomizer/atomizer/atomizer_raft.hpp"
+#include "uhs/transaction/compact_tx_view.hpp"
 #include "uhs/transaction/messages.hpp"
+#include "util/network/tcp_socket.hpp"
+#include "util/serialization/buffer_serializer.hpp"
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
 #include <utility>
 
 namespace cbdc::shard {
+    namespace {
+        /// Largest part of a UHS export sent in one snapshot response.
+        constexpr size_t snapshot_part_bytes = 1024 * 1024;
+    }
+
     controller::controller(uint32_t shard_id,
                            config::options opts,
                            std::shared_ptr<logging::log> logger)
         : m_shard_id(shard_id),
           m_opts(std::move(opts)),
           m_logger(std::move(logger)),
-          m_shard(m_opts.m_shard_ranges[shard_id]),
+          m_shard(m_opts.m_shard_ranges[shard_id],
+                  m_opts.m_shard_digest_threads,
+                  m_opts.m_shard_uhs_bloom_filter_items,
+                  m_opts.m_shard_uhs_bloom_filter_fp_rate),
           m_archiver_client(m_opts.m_archiver_endpoints[0], m_logger) {}
 
     controller::~controller() {
@@ -37,11 +54,20 @@ namespace cbdc::shard {
                 t.join();
             }
         }
+
+        {
+            std::unique_lock l(m_notify_mut);
+            m_running = false;
+        }
+        m_notify_cv.notify_one();
+        if(m_notify_thread.joinable()) {
+            m_notify_thread.join();
+        }
     }
 
     auto controller::init() -> bool {
-        if(auto err_msg
-           = m_shard.open_db(m_opts.m_shard_db_dirs[m_shard_id])) {
+        if(auto err_msg = m_shard.open_db(m_opts.m_shard_db_dirs[m_shard_id],
+                                          m_opts.m_shard_leveldb)) {
             m_logger->error("Failed to open shard DB for shard",
                             m_shard_id,
                             ". Got error:",
@@ -49,6 +75,8 @@ namespace cbdc::shard {
             return false;
         }
 
+        find_latest_export();
+
         if(!m_archiver_client.init()) {
             m_logger->warn("Failed to connect to archiver");
         }
@@ -93,6 +121,10 @@ namespace cbdc::shard {
 
         m_shard_server = std::move(ss.value());
 
+        m_notify_thread = std::thread([&]() {
+            notify_loop();
+        });
+
         auto n_threads = std::thread::hardware_concurrency();
         for(size_t i = 0; i < n_threads; i++) {
             m_handler_threads.emplace_back([&]() {
@@ -121,6 +153,21 @@ namespace cbdc::shard {
 
         m_logger->info("Digesting block", blk.m_height, "...");
 
+        // Far behind, so start from a peer's export rather than digesting
+        // every missed block
+        const auto catchup_blocks = m_opts.m_shard_snapshot_catchup_blocks;
+        if(catchup_blocks != 0
+           && blk.m_height > m_shard.best_block_height() + catchup_blocks) {
+            m_logger->info("Block",
+                           blk.m_height,
+                           "is far ahead of",
+                           m_shard.best_block_height(),
+                           ", catching up from a peer shard");
+            if(!catch_up_from_peer()) {
+                m_logger->warn("No peer shard snapshot to catch up from");
+            }
+        }
+
         // If the block is not contiguous, catch up by requesting
         // blocks from the archiver.
         while(!m_shard.digest_block(blk)) {
@@ -134,76 +181,365 @@ namespace cbdc::shard {
             }
 
             // Attempt to catch up to the latest block
-            for(uint64_t i = m_shard.best_block_height() + 1; i < blk.m_height;
-                i++) {
-                const auto past_blk = m_archiver_client.get_block(i);
-                if(past_blk) {
-                    m_shard.digest_block(past_blk.value());
-                } else {
-                    m_logger->info("Waiting for archiver sync");
-                    const auto wait_time = std::chrono::milliseconds(10);
-                    std::this_thread::sleep_for(wait_time);
-                    i--;
-                    continue;
-                }
+            const auto caught_up = m_archiver_client.get_blocks(
+                m_shard.best_block_height() + 1,
+                blk.m_height - 1,
+                [&](atomizer::block&& past_blk) {
+                    m_shard.digest_block(past_blk);
+                });
+            if(!caught_up) {
+                m_logger->info("Waiting for archiver sync");
+                const auto wait_time = std::chrono::milliseconds(10);
+                std::this_thread::sleep_for(wait_time);
             }
         }
 
         m_logger->info("Digested block", blk.m_height);
+        maybe_export_uhs();
+
+        // Ask the atomizer which sent the block to send only the UHS IDs in
+        // this shard's range from now on. Full blocks from an atomizer
+        // which lost the subscription are digested all the same.
+        if(m_subscribed_peer != pkt.m_peer_id) {
+            m_subscribed_peer = pkt.m_peer_id;
+            return make_buffer(
+                atomizer::request{atomizer::block_subscribe_request{
+                    m_opts.m_shard_ranges[m_shard_id]}});
+        }
         return std::nullopt;
     }
 
+    void controller::maybe_export_uhs() {
+        const auto interval = m_opts.m_shard_uhs_export_interval;
+        const auto height = m_shard.best_block_height();
+        if(interval == 0 || height % interval != 0) {
+            return;
+        }
+        auto started = m_shard.export_uhs(
+            export_path(height),
+            [this](std::optional<uint64_t> res) {
+                if(res.has_value()) {
+                    m_logger->info("Exported UHS at block", res.value());
+                    m_export_height = res.value();
+                } else {
+                    m_logger->error("Failed to export UHS");
+                }
+            });
+        if(!started) {
+            m_logger->warn("Skipping UHS export at block",
+                           height,
+                           "as the previous export is still running");
+        }
+    }
+
+    auto controller::export_path(uint64_t height) const -> std::string {
+        return m_opts.m_shard_uhs_export_dir + "/shard"
+             + std::to_string(m_shard_id) + "_uhs_" + std::to_string(height);
+    }
+
+    void controller::find_latest_export() {
+        const auto prefix = "shard" + std::to_string(m_shard_id) + "_uhs_";
+        auto err = std::error_code();
+        auto it = std::filesystem::directory_iterator(
+            m_opts.m_shard_uhs_export_dir,
+            err);
+        if(err) {
+            return;
+        }
+        for(const auto& entry : it) {
+            const auto name = entry.path().filename().string();
+            if(name.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            const auto suffix = name.substr(prefix.size());
+            // Skips exports still being written, which carry an extension
+            if(suffix.empty()
+               || suffix.find_first_not_of("0123456789")
+                      != std::string::npos) {
+                continue;
+            }
+            const auto height = std::stoull(suffix);
+            if(height > m_export_height) {
+                m_export_height = height;
+            }
+        }
+    }
+
+    void controller::handle_snapshot_request(const network::message_t& pkt) {
+        auto deser = buffer_serializer(*pkt.m_pkt);
+        deser.advance_cursor(sizeof(snapshot_request_marker));
+        auto req = snapshot_request();
+        if(!(deser >> req)) {
+            m_logger->error("Invalid snapshot request packet");
+            return;
+        }
+
+        auto resp = snapshot_response();
+        const auto height = req.m_height == 0 ? m_export_height.load()
+                                              : req.m_height;
+        const auto path = export_path(height);
+        auto err = std::error_code();
+        const auto size = std::filesystem::file_size(path, err);
+        auto file = std::ifstream(path, std::ios::in | std::ios::binary);
+        if(height != 0 && !err && file.good() && req.m_offset <= size) {
+            const auto len
+                = std::min<uint64_t>(size - req.m_offset, snapshot_part_bytes);
+            resp.m_data.extend(len);
+            file.seekg(static_cast<std::streamoff>(req.m_offset));
+            file.read(static_cast<char*>(resp.m_data.data()),
+                      static_cast<std::streamsize>(len));
+            if(file.good()) {
+                resp.m_height = height;
+                resp.m_size = size;
+            } else {
+                resp.m_data.clear();
+            }
+        }
+        m_shard_network.send(resp, pkt.m_peer_id);
+    }
+
+    auto controller::catch_up_from_peer() -> bool {
+        const auto& own_range = m_opts.m_shard_ranges[m_shard_id];
+        const auto path
+            = m_opts.m_shard_db_dirs[m_shard_id] + "_peer_snapshot";
+        const auto n_peers = std::min(m_opts.m_shard_ranges.size(),
+                                      m_opts.m_shard_endpoints.size());
+        for(size_t i{0}; i < n_peers; i++) {
+            const auto& range = m_opts.m_shard_ranges[i];
+            if(i == m_shard_id || range.first > own_range.first
+               || range.second < own_range.second) {
+                continue;
+            }
+            auto fetched = fetch_snapshot(m_opts.m_shard_endpoints[i], path);
+            auto height = std::optional<uint64_t>();
+            if(fetched) {
+                height = m_shard.import_uhs(path);
+            }
+            auto err = std::error_code();
+            std::filesystem::remove(path, err);
+            if(height.has_value()) {
+                m_logger->info("Imported UHS at block",
+                               height.value(),
+                               "from shard",
+                               i);
+                return true;
+            }
+            if(fetched) {
+                m_logger->warn("Failed to import UHS snapshot from shard", i);
+            }
+        }
+        return false;
+    }
+
+    auto controller::fetch_snapshot(const network::endpoint_t& ep,
+                                    const std::string& path) -> bool {
+        auto sock = network::tcp_socket();
+        if(!sock.connect(ep)) {
+            return false;
+        }
+        auto out
+            = std::ofstream(path, std::ios::out | std::ios::binary
+                                      | std::ios::trunc);
+        auto req = snapshot_request();
+        while(out.good()) {
+            auto pkt = buffer();
+            pkt.append(snapshot_request_marker.data(),
+                       snapshot_request_marker.size());
+            auto body = make_buffer(req);
+            pkt.append(body.data(), body.size());
+            if(!sock.send(pkt)) {
+                return false;
+            }
+
+            auto resp_pkt = buffer();
+            if(!sock.receive(resp_pkt)) {
+                return false;
+            }
+            auto resp = from_buffer<snapshot_response>(resp_pkt);
+            // Only a complete export newer than this shard's state helps,
+            // and every part must come from the same export
+            if(!resp.has_value() || resp->m_height == 0
+               || resp->m_height <= m_shard.best_block_height()
+               || (req.m_height != 0 && resp->m_height != req.m_height)) {
+                return false;
+            }
+            req.m_height = resp->m_height;
+            out.write(static_cast<const char*>(resp->m_data.data()),
+                      static_cast<std::streamsize>(resp->m_data.size()));
+            req.m_offset += resp->m_data.size();
+            if(req.m_offset >= resp->m_size) {
+                out.flush();
+                return out.good();
+            }
+            if(resp->m_data.size() == 0) {
+                return false;
+            }
+        }
+        return false;
+    }
+
     void controller::request_consumer() {
         auto pkt = network::message_t();
         while(m_request_queue.pop(pkt)) {
-            auto maybe_tx = from_buffer<transaction::compact_tx>(*pkt.m_pkt);
-            if(!maybe_tx.has_value()) {
+            const auto& buf = *pkt.m_pkt;
+            if(buf.size() >= sizeof(snapshot_request_marker)
+               && std::memcmp(buf.c_ptr(),
+                              snapshot_request_marker.data(),
+                              sizeof(snapshot_request_marker))
+                      == 0) {
+                handle_snapshot_request(pkt);
+                continue;
+            }
+            if(buf.size() >= sizeof(tx_batch_marker)
+               && std::memcmp(buf.c_ptr(),
+                              tx_batch_marker.data(),
+                              sizeof(tx_batch_marker))
+                      == 0) {
+                handle_batch(buf);
+                continue;
+            }
+            // Check the attestations on the wire bytes so invalid
+            // transactions are never deserialized.
+            auto view = transaction::compact_tx_view::parse(buf);
+            if(!view.has_value()) {
                 m_logger->error("Invalid transaction packet");
                 continue;
             }
+            handle_transaction(view.value());
+        }
+    }
+
+    void controller::handle_batch(const cbdc::buffer& buf) {
+        // The batch envelope is a count followed by the transactions, which
+        // are checked in place like single transaction packets
+        const auto* data = buf.c_ptr();
+        const auto len = buf.size();
+        auto offset = sizeof(tx_batch_marker);
+        uint64_t count{};
+        if(len - offset < sizeof(count)) {
+            m_logger->error("Invalid transaction batch packet");
+            return;
+        }
+        std::memcpy(&count, &data[offset], sizeof(count));
+        offset += sizeof(count);
+        for(uint64_t i{0}; i < count; i++) {
+            auto view = transaction::compact_tx_view::parse(&data[offset],
+                                                            len - offset);
+            if(!view.has_value()) {
+                m_logger->error("Invalid transaction in batch packet");
+                return;
+            }
+            offset += view->size();
+            handle_transaction(view.value());
+        }
+    }
 
-            auto& tx = maybe_tx.value();
+    void controller::handle_transaction(
+        const transaction::compact_tx_view& view) {
+        m_logger->info("Digesting transaction", to_string(view.id()), "...");
+
+        if(!transaction::validation::check_attestations(
+               view,
+               m_opts.m_sentinel_public_keys,
+               m_opts.m_attestation_threshold)) {
+            m_logger->warn("Received invalid compact transaction",
+                           to_string(view.id()));
+            return;
+        }
 
-            m_logger->info("Digesting transaction", to_string(tx.m_id), "...");
+        auto tx = view.to_compact_tx();
 
-            if(!transaction::validation::check_attestations(
-                   tx,
-                   m_opts.m_sentinel_public_keys,
-                   m_opts.m_attestation_threshold)) {
-                m_logger->warn("Received invalid compact transaction",
-                               to_string(tx.m_id));
-                continue;
+        auto res = m_shard.digest_transaction(std::move(tx));
+
+        auto res_handler = overloaded{
+            [&](const atomizer::tx_notify_request& msg) {
+                m_logger->info("Digested transaction",
+                               to_string(msg.m_tx.m_id));
+
+                m_logger->debug("Sending",
+                                msg.m_attestations.size(),
+                                "/",
+                                msg.m_tx.m_inputs.size(),
+                                "attestations...");
+                {
+                    std::unique_lock l(m_notify_mut);
+                    m_notify_batch.push_back(msg);
+                }
+                m_notify_cv.notify_one();
+            },
+            [&](const cbdc::watchtower::tx_error& err) {
+                m_logger->info("error for Tx:",
+                               to_string(err.tx_id()),
+                               err.to_string());
+                // TODO: batch errors into a single RPC
+                auto data = std::vector<cbdc::watchtower::tx_error>{err};
+                auto buf = make_shared_buffer(data);
+                m_watchtower_network.broadcast(buf);
+            }};
+        std::visit(res_handler, res);
+    }
+
+    void controller::notify_loop() {
+        const auto max_size
+            = std::max<size_t>(m_opts.m_shard_notify_batch_size, 1);
+        const auto linger
+            = std::chrono::microseconds(m_opts.m_shard_notify_linger_us);
+        auto l = std::unique_lock(m_notify_mut);
+        while(true) {
+            m_notify_cv.wait(l, [&]() {
+                return !m_notify_batch.empty() || !m_running;
+            });
+            if(m_notify_batch.empty()) {
+                break;
+            }
+            // Give concurrently digested transactions a chance to share
+            // the message
+            m_notify_cv.wait_for(l, linger, [&]() {
+                return m_notify_batch.size() >= max_size || !m_running;
+            });
+            auto batch = std::vector<atomizer::tx_notify_request>();
+            if(m_notify_batch.size() <= max_size) {
+                batch.swap(m_notify_batch);
+            } else {
+                auto last = m_notify_batch.begin()
+                          + static_cast<std::ptrdiff_t>(max_size);
+                batch.assign(std::make_move_iterator(m_notify_batch.begin()),
+                             std::make_move_iterator(last));
+                m_notify_batch.erase(m_notify_batch.begin(), last);
             }
+            l.unlock();
+            send_notifications(std::move(batch));
+            l.lock();
+        }
+    }
 
-            auto res = m_shard.digest_transaction(std::move(tx));
-
-            auto res_handler = overloaded{
-                [&](const atomizer::tx_notify_request& msg) {
-                    m_logger->info("Digested transaction",
-                                   to_string(msg.m_tx.m_id));
-
-                    m_logger->debug("Sending",
-                                    msg.m_attestations.size(),
-                                    "/",
-                                    msg.m_tx.m_inputs.size(),
-                                    "attestations...");
-                    if(!m_atomizer_network.send_to_one(
-                           atomizer::request{msg})) {
-                        m_logger->error(
-                            "Failed to transmit tx to atomizer. ID:",
-                            to_string(msg.m_tx.m_id));
-                    }
-                },
-                [&](const cbdc::watchtower::tx_error& err) {
-                    m_logger->info("error for Tx:",
-                                   to_string(err.tx_id()),
-                                   err.to_string());
-                    // TODO: batch errors into a single RPC
-                    auto data = std::vector<cbdc::watchtower::tx_error>{err};
-                    auto buf = make_shared_buffer(data);
-                    m_watchtower_network.broadcast(buf);
-                }};
-            std::visit(res_handler, res);
+    void controller::send_notifications(
+        std::vector<atomizer::tx_notify_request> batch) {
+        // Transactions digested across a block boundary carry different
+        // heights, so each height gets its own message
+        auto by_height
+            = std::map<uint64_t, std::vector<atomizer::tx_notification>>();
+        for(auto& msg : batch) {
+            by_height[msg.m_block_height].push_back(
+                {std::move(msg.m_tx), std::move(msg.m_attestations)});
+        }
+        for(auto& [height, txs] : by_height) {
+            const auto count = txs.size();
+            auto req = atomizer::request();
+            if(count == 1) {
+                req = atomizer::tx_notify_request{
+                    std::move(txs.front().m_tx),
+                    std::move(txs.front().m_attestations),
+                    height};
+            } else {
+                req = atomizer::tx_notify_batch_request{height,
+                                                        std::move(txs)};
+            }
+            if(!m_atomizer_network.send_to_one(req)) {
+                m_logger->error("Failed to transmit",
+                                count,
+                                "transaction notifications to atomizer");
+            }
         }
     }
 }
@@ -9,10 +9,15 @@
 #include "shard.hpp"
 #include "uhs/atomizer/archiver/client.hpp"
 #include "uhs/atomizer/atomizer/block.hpp"
+#include "uhs/transaction/compact_tx_view.hpp"
+#include "util/common/blocking_queue.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <secp256k1.h>
 
 namespace cbdc::shard {
@@ -57,14 +62,54 @@ namespace cbdc::shard {
 
         cbdc::archiver::client m_archiver_client;
 
+        /// Atomizer peer to which this shard last sent its block
+        /// subscription. Only used by the atomizer handler thread.
+        std::optional<network::peer_id_t> m_subscribed_peer;
+
         blocking_queue<network::message_t> m_request_queue;
         std::vector<std::thread> m_handler_threads;
 
+        /// Transaction notifications waiting to be sent to the atomizer.
+        std::mutex m_notify_mut;
+        std::condition_variable m_notify_cv;
+        std::vector<atomizer::tx_notify_request> m_notify_batch;
+        bool m_running{true};
+        std::thread m_notify_thread;
+
+        /// Block height of the most recent complete UHS export, served to
+        /// peer shards catching up, or zero if there is none.
+        std::atomic<uint64_t> m_export_height{0};
+
         auto server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
         auto atomizer_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
         void request_consumer();
+        void handle_batch(const cbdc::buffer& buf);
+        void handle_transaction(const transaction::compact_tx_view& view);
+        void notify_loop();
+        /// Sends the notifications to the atomizer, sharing a message
+        /// between those with the same block height.
+        void send_notifications(std::vector<atomizer::tx_notify_request> batch);
+        /// Starts an export of the shard's unspent set if the best block
+        /// height is a multiple of the export interval.
+        void maybe_export_uhs();
+        /// Returns the path of this shard's UHS export at a block height.
+        [[nodiscard]] auto export_path(uint64_t height) const -> std::string;
+        /// Finds the most recent UHS export this shard left in the export
+        /// directory, so it can be served to peers after a restart.
+        void find_latest_export();
+        /// Sends the requested part of a UHS export to a peer shard.
+        void handle_snapshot_request(const network::message_t& pkt);
+        /// Imports the most recent UHS export of a peer shard whose range
+        /// covers this shard's.
+        /// \return true if the best block height advanced.
+        auto catch_up_from_peer() -> bool;
+        /// Downloads the most recent UHS export of the shard at the given
+        /// endpoint, if it is ahead of this shard.
+        /// \return true if the whole export was written to path.
+        auto fetch_snapshot(const network::endpoint_t& ep,
+                            const std::string& path) -> bool;
     };
 }
 
@@ -0,0 +1,30 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "format.hpp"
+
+#include "util/serialization/format.hpp"
+
+namespace cbdc {
+    auto operator<<(serializer& packet, const shard::snapshot_request& req)
+        -> serializer& {
+        return packet << req.m_height << req.m_offset;
+    }
+
+    auto operator>>(serializer& packet, shard::snapshot_request& req)
+        -> serializer& {
+        return packet >> req.m_height >> req.m_offset;
+    }
+
+    auto operator<<(serializer& packet, const shard::snapshot_response& resp)
+        -> serializer& {
+        return packet << resp.m_height << resp.m_size << resp.m_data;
+    }
+
+    auto operator>>(serializer& packet, shard::snapshot_response& resp)
+        -> serializer& {
+        return packet >> resp.m_height >> resp.m_size >> resp.m_data;
+    }
+}
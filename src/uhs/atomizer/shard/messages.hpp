@@ -0,0 +1,60 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_SHARD_MESSAGES_H_
+#define OPENCBDC_TX_SRC_SHARD_MESSAGES_H_
+
+#include "util/common/buffer.hpp"
+#include "util/common/hash.hpp"
+
+namespace cbdc::shard {
+    /// \brief Marks a packet sent to a shard as a batch of compact
+    ///        transactions.
+    ///
+    /// Takes the place of the transaction ID at the start of the packet,
+    /// and is followed by an rpc::batch_request of compact transactions.
+    /// Packets without the marker hold a single compact transaction. No
+    /// transaction ID is all zeros.
+    static constexpr hash_t tx_batch_marker{};
+
+    /// \brief Marks a packet sent to a shard as a \ref snapshot_request.
+    ///
+    /// Takes the place of the transaction ID at the start of the packet,
+    /// and is followed by the serialized request. No transaction ID is all
+    /// ones.
+    static constexpr hash_t snapshot_request_marker = []() {
+        auto ret = hash_t();
+        for(auto& b : ret) {
+            b = 0xFF;
+        }
+        return ret;
+    }();
+
+    /// \brief Request for part of the shard's most recent UHS export.
+    ///
+    /// Sent by a shard catching up to a peer shard whose range covers its
+    /// own. The export is read in parts, each requested once the previous
+    /// one has arrived.
+    struct snapshot_request {
+        /// Block height of the export being read, or zero for the most
+        /// recent export.
+        uint64_t m_height{};
+        /// Offset in the export file of the first byte to return.
+        uint64_t m_offset{};
+    };
+
+    /// Part of a UHS export, in response to a \ref snapshot_request.
+    struct snapshot_response {
+        /// Block height of the export, or zero if the shard has no export
+        /// at the requested height.
+        uint64_t m_height{};
+        /// Size of the whole export file in bytes.
+        uint64_t m_size{};
+        /// Export file contents from the requested offset.
+        buffer m_data;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_SHARD_MESSAGES_H_
@@ -5,19 +5,53 @@
 
 #include "shard.hpp"
 
+#include "util/persistence/hash_export.hpp"
+
+#include <algorithm>
+#include <map>
 #include <utility>
 
 namespace cbdc::shard {
-    shard::shard(config::shard_range_t prefix_range)
-        : m_prefix_range(std::move(prefix_range)) {}
+    namespace {
+        /// Smallest number of transactions worth digesting on another
+        /// thread.
+        constexpr size_t min_digest_chunk = 512;
+
+        /// Number of UHS IDs written or deleted per batch while importing.
+        constexpr size_t import_batch_size = 65536;
+    }
 
-    auto shard::open_db(const std::string& db_dir)
+    shard::shard(config::shard_range_t prefix_range,
+                 size_t digest_threads,
+                 size_t uhs_filter_items,
+                 double uhs_filter_fp_rate)
+        : m_prefix_range(std::move(prefix_range)),
+          m_uhs_filter_items(uhs_filter_items),
+          m_uhs_filter_fp_rate(uhs_filter_fp_rate) {
+        if(digest_threads == 0) {
+            digest_threads
+                = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        if(digest_threads > 1) {
+            // The calling thread builds part of each block itself
+            m_digest_pool = std::make_unique<thread_pool>(digest_threads - 1);
+        }
+    }
+
+    shard::~shard() {
+        m_export_stop = true;
+        if(m_export_thread.joinable()) {
+            m_export_thread.join();
+        }
+    }
+
+    auto shard::open_db(const std::string& db_dir,
+                        const config::leveldb_profile& profile)
         -> std::optional<std::string> {
-        leveldb::Options opt;
-        opt.create_if_missing = true;
+        m_db_opts = leveldb_options(profile);
 
         leveldb::DB* db_ptr{};
-        const auto res = leveldb::DB::Open(opt, db_dir, &db_ptr);
+        const auto res = leveldb::DB::Open(m_db_opts.get(), db_dir, &db_ptr);
 
         if(!res.ok()) {
             return res.ToString();
@@ -49,7 +83,18 @@ namespace cbdc::shard {
                         sizeof(this->m_best_block_height));
         }
 
-        update_snapshot();
+        // An import was interrupted, so the unspent set is incomplete
+        std::string importing;
+        if(m_db->Get(m_read_options, m_import_key, &importing).ok()
+           && !reset_db()) {
+            return "Failed to reset shard database after interrupted import";
+        }
+
+        if(m_uhs_filter_items > 0) {
+            update_snapshot(build_uhs_filter());
+        } else {
+            update_snapshot();
+        }
 
         return std::nullopt;
     }
@@ -59,10 +104,67 @@ namespace cbdc::shard {
             return false;
         }
 
+        // Build a batch for each range of transactions, then append them
+        // in block order so an output created and spent within the block
+        // ends up deleted.
+        auto chunk_batches = std::map<size_t, leveldb::WriteBatch>();
+        auto chunk_batches_mut = std::mutex();
+        auto added = std::atomic<size_t>();
+        auto build = [&](size_t begin, size_t end) {
+            leveldb::WriteBatch* chunk_batch{};
+            {
+                std::unique_lock l(chunk_batches_mut);
+                chunk_batch = &chunk_batches[begin];
+            }
+            added += add_block_updates(blk,
+                                       begin,
+                                       end,
+                                       *chunk_batch,
+                                       m_uhs_filter.get());
+        };
+        for_each_chunk(m_digest_pool.get(),
+                       blk.m_transactions.size(),
+                       min_digest_chunk,
+                       build);
+
         leveldb::WriteBatch batch;
+        for(const auto& [begin, chunk_batch] : chunk_batches) {
+            batch.Append(chunk_batch);
+        }
+
+        // Bump the best block height
+        this->m_best_block_height++;
+        std::array<char, sizeof(m_best_block_height)> height_arr{};
+        std::memcpy(height_arr.data(),
+                    &m_best_block_height,
+                    sizeof(m_best_block_height));
+        leveldb::Slice newBestBlockHeight(height_arr.data(),
+                                          sizeof(this->m_best_block_height));
+        batch.Put(m_best_block_height_key, newBestBlockHeight);
+
+        // Commit the changes atomically
+        this->m_db->Write(this->m_write_options, &batch);
+
+        // Spent outputs stay in the filter, so rebuild it from the live
+        // UHS once it holds more outputs than it was sized for
+        m_uhs_filter_count += added;
+        if(m_uhs_filter && m_uhs_filter_count > m_uhs_filter_capacity) {
+            update_snapshot(build_uhs_filter());
+        } else {
+            update_snapshot();
+        }
 
-        // Iterate over all confirmed transactions
-        for(const auto& tx : blk.m_transactions) {
+        return true;
+    }
+
+    auto shard::add_block_updates(const cbdc::atomizer::block& blk,
+                                  size_t begin,
+                                  size_t end,
+                                  leveldb::WriteBatch& batch,
+                                  bloom_filter* uhs_filter) const -> size_t {
+        size_t added{0};
+        for(size_t i{begin}; i < end; i++) {
+            const auto& tx = blk.m_transactions[i];
             // Add new outputs
             for(const auto& out : tx.m_uhs_outputs) {
                 if(is_output_on_shard(out)) {
@@ -70,6 +172,10 @@ namespace cbdc::shard {
                     std::memcpy(out_arr.data(), out.data(), out.size());
                     leveldb::Slice OutPointKey(out_arr.data(), out.size());
                     batch.Put(OutPointKey, leveldb::Slice());
+                    if(uhs_filter != nullptr) {
+                        uhs_filter->add(out);
+                        added++;
+                    }
                 }
             }
 
@@ -83,23 +189,7 @@ namespace cbdc::shard {
                 }
             }
         }
-
-        // Bump the best block height
-        this->m_best_block_height++;
-        std::array<char, sizeof(m_best_block_height)> height_arr{};
-        std::memcpy(height_arr.data(),
-                    &m_best_block_height,
-                    sizeof(m_best_block_height));
-        leveldb::Slice newBestBlockHeight(height_arr.data(),
-                                          sizeof(this->m_best_block_height));
-        batch.Put(m_best_block_height_key, newBestBlockHeight);
-
-        // Commit the changes atomically
-        this->m_db->Write(this->m_write_options, &batch);
-
-        update_snapshot();
-
-        return true;
+        return added;
     }
 
     auto shard::digest_transaction(transaction::compact_tx tx)
@@ -107,10 +197,12 @@ namespace cbdc::shard {
                         cbdc::watchtower::tx_error> {
         std::shared_ptr<const leveldb::Snapshot> snp{};
         uint64_t snp_height{};
+        std::shared_ptr<bloom_filter> uhs_filter{};
         {
             std::shared_lock<std::shared_mutex> l(m_snp_mut);
             snp_height = m_snp_height;
             snp = m_snp;
+            uhs_filter = m_uhs_filter;
         }
 
         // Don't process transactions until we've heard from the atomizer
@@ -139,6 +231,11 @@ namespace cbdc::shard {
                 continue;
             }
 
+            if(uhs_filter && !uhs_filter->possibly_contains(inp)) {
+                dne_inputs.push_back(inp);
+                continue;
+            }
+
             std::array<char, sizeof(inp)> inp_arr{};
             std::memcpy(inp_arr.data(), inp.data(), inp.size());
             leveldb::Slice OutPointKey(inp_arr.data(), inp.size());
@@ -170,11 +267,201 @@ namespace cbdc::shard {
         return m_best_block_height;
     }
 
+    auto shard::export_uhs(const std::string& path, export_callback_type done)
+        -> bool {
+        if(m_exporting.exchange(true)) {
+            return false;
+        }
+        std::shared_ptr<const leveldb::Snapshot> snp{};
+        uint64_t snp_height{};
+        {
+            std::shared_lock<std::shared_mutex> l(m_snp_mut);
+            snp = m_snp;
+            snp_height = m_snp_height;
+        }
+        if(!snp) {
+            m_exporting = false;
+            return false;
+        }
+        // The previous export thread has at most its callback left to run
+        if(m_export_thread.joinable()) {
+            m_export_thread.join();
+        }
+        m_export_thread = std::thread([this,
+                                       path,
+                                       snp = std::move(snp),
+                                       snp_height,
+                                       done = std::move(done)]() {
+            auto ok = write_uhs_export(path, snp.get(), snp_height);
+            m_exporting = false;
+            if(done) {
+                done(ok ? std::optional<uint64_t>(snp_height)
+                        : std::nullopt);
+            }
+        });
+        return true;
+    }
+
+    auto shard::write_uhs_export(const std::string& path,
+                                 const leveldb::Snapshot* snp,
+                                 uint64_t height) -> bool {
+        auto read_options = m_read_options;
+        read_options.snapshot = snp;
+        read_options.fill_cache = false;
+        auto it = std::unique_ptr<leveldb::Iterator>(
+            m_db->NewIterator(read_options));
+        auto writer = persistence::hash_export_writer(path, height);
+        if(!writer.open()) {
+            return false;
+        }
+        // LevelDB orders keys bytewise, which is the order of hash_t
+        for(it->SeekToFirst(); it->Valid() && !m_export_stop; it->Next()) {
+            const auto key = it->key();
+            // Skips the best block height
+            if(key.size() != sizeof(hash_t)) {
+                continue;
+            }
+            auto uhs_id = hash_t();
+            std::memcpy(uhs_id.data(), key.data(), uhs_id.size());
+            if(!writer.add(uhs_id)) {
+                return false;
+            }
+        }
+        return !m_export_stop && it->status().ok() && writer.finish();
+    }
+
+    auto shard::import_uhs(const std::string& path)
+        -> std::optional<uint64_t> {
+        // Check the whole file before touching the database
+        const auto label = persistence::scan_hash_export(
+            path,
+            [](const hash_t* /* vals */, size_t /* n */) {});
+        if(!label.has_value() || label.value() <= m_best_block_height) {
+            return std::nullopt;
+        }
+
+        auto sync_options = m_write_options;
+        sync_options.sync = true;
+        if(!m_db->Put(sync_options, m_import_key, leveldb::Slice()).ok()) {
+            return std::nullopt;
+        }
+
+        auto height = std::optional<uint64_t>();
+        if(clear_uhs()) {
+            height = write_uhs_import(path);
+        }
+        if(height != label) {
+            reset_db();
+            update_snapshot(m_uhs_filter_items > 0 ? build_uhs_filter()
+                                                   : nullptr);
+            return std::nullopt;
+        }
+
+        leveldb::WriteBatch batch;
+        put_best_block_height(batch, label.value());
+        batch.Delete(m_import_key);
+        if(!m_db->Write(sync_options, &batch).ok()) {
+            return std::nullopt;
+        }
+        m_best_block_height = label.value();
+
+        if(m_uhs_filter_items > 0) {
+            update_snapshot(build_uhs_filter());
+        } else {
+            update_snapshot();
+        }
+        return label;
+    }
+
+    auto shard::write_uhs_import(const std::string& path)
+        -> std::optional<uint64_t> {
+        leveldb::WriteBatch batch;
+        size_t pending{0};
+        auto ok = true;
+        auto label = persistence::scan_hash_export(
+            path,
+            [&](const hash_t* vals, size_t n) {
+                for(size_t i{0}; i < n && ok; i++) {
+                    const auto& uhs_id = vals[i];
+                    if(!is_output_on_shard(uhs_id)) {
+                        continue;
+                    }
+                    std::array<char, sizeof(uhs_id)> key_arr{};
+                    std::memcpy(key_arr.data(), uhs_id.data(), uhs_id.size());
+                    batch.Put(leveldb::Slice(key_arr.data(), key_arr.size()),
+                              leveldb::Slice());
+                    if(++pending == import_batch_size) {
+                        ok = m_db->Write(m_write_options, &batch).ok();
+                        batch.Clear();
+                        pending = 0;
+                    }
+                }
+            });
+        if(ok && pending > 0) {
+            ok = m_db->Write(m_write_options, &batch).ok();
+        }
+        if(!ok) {
+            return std::nullopt;
+        }
+        return label;
+    }
+
+    auto shard::clear_uhs() -> bool {
+        auto read_options = m_read_options;
+        read_options.fill_cache = false;
+        auto it = std::unique_ptr<leveldb::Iterator>(
+            m_db->NewIterator(read_options));
+        leveldb::WriteBatch batch;
+        size_t pending{0};
+        for(it->SeekToFirst(); it->Valid(); it->Next()) {
+            // Skips the best block height and import marker
+            if(it->key().size() != sizeof(hash_t)) {
+                continue;
+            }
+            batch.Delete(it->key());
+            if(++pending == import_batch_size) {
+                if(!m_db->Write(m_write_options, &batch).ok()) {
+                    return false;
+                }
+                batch.Clear();
+                pending = 0;
+            }
+        }
+        if(!it->status().ok()) {
+            return false;
+        }
+        return pending == 0 || m_db->Write(m_write_options, &batch).ok();
+    }
+
+    auto shard::reset_db() -> bool {
+        if(!clear_uhs()) {
+            return false;
+        }
+        leveldb::WriteBatch batch;
+        put_best_block_height(batch, 0);
+        batch.Delete(m_import_key);
+        auto sync_options = m_write_options;
+        sync_options.sync = true;
+        if(!m_db->Write(sync_options, &batch).ok()) {
+            return false;
+        }
+        m_best_block_height = 0;
+        return true;
+    }
+
+    void shard::put_best_block_height(leveldb::WriteBatch& batch,
+                                      uint64_t height) const {
+        std::array<char, sizeof(height)> height_arr{};
+        std::memcpy(height_arr.data(), &height, sizeof(height));
+        batch.Put(m_best_block_height_key,
+                  leveldb::Slice(height_arr.data(), height_arr.size()));
+    }
+
     auto shard::is_output_on_shard(const hash_t& uhs_hash) const -> bool {
         return config::hash_in_shard_range(m_prefix_range, uhs_hash);
     }
 
-    void shard::update_snapshot() {
+    void shard::update_snapshot(std::shared_ptr<bloom_filter> uhs_filter) {
         std::unique_lock<std::shared_mutex> l(m_snp_mut);
         m_snp_height = m_best_block_height;
         m_snp = std::shared_ptr<const leveldb::Snapshot>(
@@ -182,5 +469,37 @@ namespace cbdc::shard {
             [&](const leveldb::Snapshot* p) {
                 m_db->ReleaseSnapshot(p);
             });
+        if(uhs_filter) {
+            m_uhs_filter = std::move(uhs_filter);
+        }
+    }
+
+    auto shard::build_uhs_filter() -> std::shared_ptr<bloom_filter> {
+        auto read_options = m_read_options;
+        read_options.fill_cache = false;
+        auto it = std::unique_ptr<leveldb::Iterator>(
+            m_db->NewIterator(read_options));
+        auto outputs = std::vector<hash_t>();
+        for(it->SeekToFirst(); it->Valid(); it->Next()) {
+            const auto key = it->key();
+            // Skips the best block height
+            if(key.size() != sizeof(hash_t)) {
+                continue;
+            }
+            auto& out = outputs.emplace_back();
+            std::memcpy(out.data(), key.data(), out.size());
+        }
+
+        // Leaves room for as many new outputs as there are now before the
+        // next rebuild
+        m_uhs_filter_capacity
+            = std::max(m_uhs_filter_items, 2 * outputs.size());
+        m_uhs_filter_count = outputs.size();
+        auto uhs_filter = std::make_shared<bloom_filter>(m_uhs_filter_capacity,
+                                                         m_uhs_filter_fp_rate);
+        for(const auto& out : outputs) {
+            uhs_filter->add(out);
+        }
+        return uhs_filter;
     }
 }
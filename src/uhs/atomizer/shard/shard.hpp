@@ -15,12 +15,16 @@
 #include "uhs/atomizer/atomizer/format.hpp"
 #include "uhs/atomizer/watchtower/tx_error_messages.hpp"
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/bloom_filter.hpp"
 #include "util/common/config.hpp"
+#include "util/common/leveldb_options.hpp"
 #include "util/common/logging.hpp"
+#include "util/common/thread_pool.hpp"
 #include "util/network/connection_manager.hpp"
 #include "util/serialization/format.hpp"
 
 #include <atomic>
+#include <functional>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 #include <memory>
@@ -37,16 +41,41 @@ namespace cbdc::shard {
       public:
         /// Constructor. Call open_db() before using.
         /// \param prefix_range the inclusive UHS ID prefix range which this shard should track.
-        explicit shard(config::shard_range_t prefix_range);
+        /// \param digest_threads number of threads on which to build the
+        ///                       database updates of each block. Zero uses
+        ///                       one per hardware thread.
+        /// \param uhs_filter_items minimum number of UHS IDs to size the
+        ///                         in-memory Bloom filter of unspent
+        ///                         outputs for. Zero disables the filter.
+        /// \param uhs_filter_fp_rate target false positive rate of the
+        ///                           Bloom filter.
+        explicit shard(config::shard_range_t prefix_range,
+                       size_t digest_threads = 1,
+                       size_t uhs_filter_items = 0,
+                       double uhs_filter_fp_rate
+                       = config::defaults::shard_uhs_bloom_filter_fp_rate);
+
+        /// Stops and waits for any running UHS export.
+        ~shard();
+
+        shard(const shard&) = delete;
+        auto operator=(const shard&) -> shard& = delete;
+        shard(shard&&) = delete;
+        auto operator=(shard&&) -> shard& = delete;
 
         /// Creates or restores this shard's UTXO database.
         /// \param db_dir relative path to the directory to create or read this shard's database files.
+        /// \param profile tuning of the database.
         /// \return nullopt if the shard successfully opened the database. Otherwise, returns the error message.
-        auto open_db(const std::string& db_dir) -> std::optional<std::string>;
+        auto open_db(const std::string& db_dir,
+                     const config::leveldb_profile& profile = {})
+            -> std::optional<std::string>;
 
         /// Checks the validity of a provided transaction's inputs, and returns
         /// a transaction notification to forward to the atomizer or a
-        /// transaction error to forward to the watchtower.
+        /// transaction error to forward to the watchtower. Inputs ruled out
+        /// by the UHS Bloom filter are reported missing without a database
+        /// lookup.
         /// \param tx the transaction to digest.
         /// \return result message to forward.
         auto digest_transaction(transaction::compact_tx tx)
@@ -56,7 +85,10 @@ namespace cbdc::shard {
         /// transaction block from the atomizer. Deletes spent UTXOs and adds
         /// new ones. Increments the best block height. Accepts only blocks
         /// whose block height is one greater than the previous best block
-        /// height; rejects non-contiguous blocks.
+        /// height; rejects non-contiguous blocks. Large blocks are split
+        /// into ranges of transactions whose updates are built in parallel,
+        /// then written to the database in block order with the new best
+        /// block height in a single write.
         /// \param blk the block to digest.
         /// \return true if the shard successfully digested the block. False if the block height is not contiguous.
         auto digest_block(const cbdc::atomizer::block& blk) -> bool;
@@ -65,12 +97,89 @@ namespace cbdc::shard {
         /// \return the best block height.
         [[nodiscard]] auto best_block_height() const -> uint64_t;
 
+        /// Function called with the block height of a finished UHS export,
+        /// or std::nullopt if the export failed.
+        using export_callback_type
+            = std::function<void(std::optional<uint64_t>)>;
+
+        /// Starts exporting the UHS IDs in the database as of the most
+        /// recently digested block, sorted, with \ref
+        /// persistence::hash_export_writer. The export iterates a LevelDB
+        /// snapshot on a background thread, so blocks and transactions are
+        /// digested as usual meanwhile. Only one export runs at a time.
+        /// \param path file to write, labelled with the block height.
+        /// \param done function to call from the export thread when the
+        ///             export finishes. Must not start another export.
+        /// \return false if the database is not open or an export is
+        ///         already running.
+        auto export_uhs(const std::string& path, export_callback_type done)
+            -> bool;
+
+        /// Replaces the unspent set with the UHS IDs in this shard's range
+        /// from an export written by \ref export_uhs, possibly by another
+        /// shard whose range covers this one, and moves the best block
+        /// height to the export's. Digesting then continues from the block
+        /// after the export. The whole file is checked before the database
+        /// is changed. If the import fails part way, the shard is reset to
+        /// an empty unspent set at height zero, and a shard restarted during
+        /// an import is reset the same way when it reopens its database.
+        /// \param path export file to read.
+        /// \return block height of the imported export, or std::nullopt if
+        ///         the file is invalid, no newer than the best block height
+        ///         or could not be written to the database.
+        auto import_uhs(const std::string& path) -> std::optional<uint64_t>;
+
       private:
         [[nodiscard]] auto is_output_on_shard(const hash_t& uhs_hash) const
             -> bool;
 
-        void update_snapshot();
-
+        /// Replaces the snapshot used by digest_transaction with the
+        /// current database state.
+        /// \param uhs_filter if set, the UHS Bloom filter to publish with
+        ///                   the new snapshot.
+        void update_snapshot(std::shared_ptr<bloom_filter> uhs_filter
+                             = nullptr);
+
+        /// Builds a UHS Bloom filter from the outputs in the database.
+        /// \return the new filter.
+        auto build_uhs_filter() -> std::shared_ptr<bloom_filter>;
+
+        /// Adds the updates from a range of the block's transactions to
+        /// the given batch, and their new outputs to the UHS filter.
+        /// \return number of outputs added.
+        auto add_block_updates(const cbdc::atomizer::block& blk,
+                               size_t begin,
+                               size_t end,
+                               leveldb::WriteBatch& batch,
+                               bloom_filter* uhs_filter) const -> size_t;
+
+        /// Writes the UHS IDs in a database snapshot to an export file.
+        /// \return true if the export is complete.
+        auto write_uhs_export(const std::string& path,
+                              const leveldb::Snapshot* snp,
+                              uint64_t height) -> bool;
+
+        /// Writes the UHS IDs in this shard's range from an export file to
+        /// the database, which must hold no UHS IDs.
+        /// \return label of the export file, or std::nullopt on failure.
+        auto write_uhs_import(const std::string& path)
+            -> std::optional<uint64_t>;
+
+        /// Deletes every UHS ID from the database.
+        /// \return true if the deletes were written.
+        auto clear_uhs() -> bool;
+
+        /// Empties the unspent set, sets the best block height to zero and
+        /// removes the import marker.
+        /// \return true if the database was reset.
+        auto reset_db() -> bool;
+
+        /// Adds writing the given best block height to a batch.
+        void put_best_block_height(leveldb::WriteBatch& batch,
+                                   uint64_t height) const;
+
+        /// Must outlive m_db.
+        leveldb_options m_db_opts;
         std::unique_ptr<leveldb::DB> m_db;
         leveldb::ReadOptions m_read_options;
         leveldb::WriteOptions m_write_options;
@@ -79,11 +188,27 @@ namespace cbdc::shard {
 
         std::shared_ptr<const leveldb::Snapshot> m_snp;
         uint64_t m_snp_height{};
+        std::shared_ptr<bloom_filter> m_uhs_filter;
         std::shared_mutex m_snp_mut;
 
         const std::string m_best_block_height_key = "bestBlockHeight";
+        /// Present while an import is replacing the unspent set.
+        const std::string m_import_key = "importingUhs";
 
         std::pair<uint8_t, uint8_t> m_prefix_range;
+
+        size_t m_uhs_filter_items;
+        double m_uhs_filter_fp_rate;
+        /// Outputs the current UHS filter holds, including spent ones. The
+        /// filter is rebuilt once this exceeds the number it was sized for.
+        size_t m_uhs_filter_count{};
+        size_t m_uhs_filter_capacity{};
+
+        std::unique_ptr<thread_pool> m_digest_pool;
+
+        std::atomic_bool m_exporting{false};
+        std::atomic_bool m_export_stop{false};
+        std::thread m_export_thread;
     };
 }
 
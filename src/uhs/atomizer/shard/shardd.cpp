@@ -4,7 +4,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "controller.hpp"
+#include "util/common/affinity.hpp"
 #include "util/common/config.hpp"
+#include "util/network/io_loop.hpp"
 
 #include <cassert>
 #include <csignal>
@@ -30,6 +32,12 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     if(opts.m_shard_endpoints.size() <= shard_id) {
         std::cerr << "Shard ID not in config file" << std::endl;
@@ -38,6 +46,9 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_shard_loglevels[shard_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
 
     auto ctl = cbdc::shard::controller{static_cast<uint32_t>(shard_id),
                                        opts,
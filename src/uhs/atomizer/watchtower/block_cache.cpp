@@ -5,63 +5,166 @@
 
 #include "block_cache.hpp"
 
+#include <algorithm>
+#include <utility>
+
 namespace cbdc::watchtower {
-    block_cache::block_cache(size_t k) : m_k_blks(k) {
-        static constexpr auto puts_per_tx = 2;
-        static constexpr auto txs_per_block = 1000000;
-        m_spent_ids.reserve(k * txs_per_block * puts_per_tx);
-        m_unspent_ids.reserve(k * txs_per_block * puts_per_tx);
+    namespace {
+        constexpr size_t min_index_capacity = 1024;
+
+        /// Number of UHS IDs a block refers to.
+        auto block_ids(const cbdc::atomizer::block& blk) -> size_t {
+            size_t n{0};
+            for(const auto& tx : blk.m_transactions) {
+                n += tx.m_inputs.size() + tx.m_uhs_outputs.size();
+            }
+            return n;
+        }
+    }
+
+    block_cache::block_cache(size_t k)
+        : m_k_blks(k),
+          m_index(min_index_capacity) {
+        m_blks.reserve(k);
     }
 
     void block_cache::push_block(cbdc::atomizer::block&& blk) {
+        m_gen++;
+        m_cached_ids += block_ids(blk);
         if((m_k_blks != 0) && (m_blks.size() == m_k_blks)) {
-            auto& old_blk = m_blks.front();
-            for(auto& tx : old_blk.m_transactions) {
-                for(auto& in : tx.m_inputs) {
-                    m_spent_ids.erase(in);
-                }
-                for(auto& out : tx.m_uhs_outputs) {
-                    m_unspent_ids.erase(out);
-                }
-            }
-            m_blks.pop();
+            // Overwrite the oldest block. Its index entries become stale.
+            auto& slot = m_blks[(m_gen - 1) % m_k_blks];
+            m_cached_ids -= block_ids(slot);
+            slot = std::move(blk);
+            m_evicted_gen = m_gen - m_k_blks;
+        } else {
+            m_blks.push_back(std::move(blk));
         }
+        const auto& new_blk = block_at(m_gen);
 
-        m_blks.push(std::forward<cbdc::atomizer::block>(blk));
+        // Keep the index at most half full, sized so that many blocks can
+        // be pushed before it needs to be rebuilt again
+        if((m_occupied + block_ids(new_blk)) * 2 > m_index.size()) {
+            auto capacity = min_index_capacity;
+            while(capacity < m_cached_ids * 4) {
+                capacity *= 2;
+            }
+            resize_index(capacity);
+        }
 
-        auto blk_height = m_blks.back().m_height;
-        for(auto& tx : m_blks.back().m_transactions) {
-            for(auto& in : tx.m_inputs) {
-                m_unspent_ids.erase(in);
-                m_spent_ids.insert(
-                    {{in, std::make_pair(blk_height, tx.m_id)}});
+        for(uint32_t i{0}; i < new_blk.m_transactions.size(); i++) {
+            const auto& tx = new_blk.m_transactions[i];
+            for(const auto& in : tx.m_inputs) {
+                auto& entry = find_or_insert(in);
+                entry.m_spend_gen = m_gen;
+                entry.m_spend_tx = i;
             }
-            for(auto& out : tx.m_uhs_outputs) {
-                m_unspent_ids.insert(
-                    {{out, std::make_pair(blk_height, tx.m_id)}});
+            for(const auto& out : tx.m_uhs_outputs) {
+                auto& entry = find_or_insert(out);
+                if(!is_cached(entry.m_out_gen)) {
+                    entry.m_out_gen = m_gen;
+                    entry.m_out_tx = i;
+                }
             }
         }
-        m_best_blk_height = std::max(m_best_blk_height, blk_height);
+        m_best_blk_height = std::max(m_best_blk_height, new_blk.m_height);
     }
 
     auto block_cache::check_unspent(const hash_t& uhs_id) const
         -> std::optional<block_cache_result> {
-        auto res = m_unspent_ids.find(uhs_id);
-        if(res == m_unspent_ids.end()) {
+        const auto* entry = find(uhs_id);
+        if(entry == nullptr || !is_cached(entry->m_out_gen)
+           || is_cached(entry->m_spend_gen)) {
             return std::nullopt;
         }
-        return res->second;
+        return result_at(entry->m_out_gen, entry->m_out_tx);
     }
 
     auto block_cache::check_spent(const hash_t& uhs_id) const
         -> std::optional<block_cache_result> {
-        auto res = m_spent_ids.find(uhs_id);
-        if(res == m_spent_ids.end()) {
+        const auto* entry = find(uhs_id);
+        if(entry == nullptr || !is_cached(entry->m_spend_gen)) {
             return std::nullopt;
         }
-        return res->second;
+        return result_at(entry->m_spend_gen, entry->m_spend_tx);
     }
+
     auto block_cache::best_block_height() const -> uint64_t {
         return m_best_blk_height;
     }
+
+    auto block_cache::is_cached(uint64_t gen) const -> bool {
+        return gen > m_evicted_gen;
+    }
+
+    auto block_cache::block_at(uint64_t gen) const
+        -> const cbdc::atomizer::block& {
+        if(m_k_blks == 0) {
+            return m_blks[gen - 1];
+        }
+        return m_blks[(gen - 1) % m_k_blks];
+    }
+
+    auto block_cache::result_at(uint64_t gen, uint32_t tx) const
+        -> block_cache_result {
+        const auto& blk = block_at(gen);
+        return {blk.m_height, blk.m_transactions[tx].m_id};
+    }
+
+    auto block_cache::find(const hash_t& uhs_id) const -> const index_entry* {
+        const auto mask = m_index.size() - 1;
+        for(auto i = m_hash(uhs_id) & mask;; i = (i + 1) & mask) {
+            const auto& entry = m_index[i];
+            if(entry.m_out_gen == 0 && entry.m_spend_gen == 0) {
+                return nullptr;
+            }
+            if(entry.m_id == uhs_id) {
+                return &entry;
+            }
+        }
+    }
+
+    auto block_cache::find_or_insert(const hash_t& uhs_id) -> index_entry& {
+        const auto mask = m_index.size() - 1;
+        index_entry* stale{nullptr};
+        for(auto i = m_hash(uhs_id) & mask;; i = (i + 1) & mask) {
+            auto& entry = m_index[i];
+            if(entry.m_out_gen == 0 && entry.m_spend_gen == 0) {
+                // Not present. Prefer reusing a stale entry on the probe
+                // sequence over extending it.
+                if(stale == nullptr) {
+                    m_occupied++;
+                    stale = &entry;
+                }
+                *stale = index_entry{};
+                stale->m_id = uhs_id;
+                return *stale;
+            }
+            if(entry.m_id == uhs_id) {
+                return entry;
+            }
+            if(stale == nullptr && !is_cached(entry.m_out_gen)
+               && !is_cached(entry.m_spend_gen)) {
+                stale = &entry;
+            }
+        }
+    }
+
+    void block_cache::resize_index(size_t capacity) {
+        auto old_index = std::exchange(m_index,
+                                       std::vector<index_entry>(capacity));
+        m_occupied = 0;
+        const auto mask = capacity - 1;
+        for(const auto& entry : old_index) {
+            if(!is_cached(entry.m_out_gen) && !is_cached(entry.m_spend_gen)) {
+                continue;
+            }
+            auto i = m_hash(entry.m_id) & mask;
+            while(m_index[i].m_out_gen != 0 || m_index[i].m_spend_gen != 0) {
+                i = (i + 1) & mask;
+            }
+            m_index[i] = entry;
+            m_occupied++;
+        }
+    }
 }
@@ -13,13 +13,8 @@
 #include "uhs/atomizer/atomizer/block.hpp"
 #include "util/common/hashmap.hpp"
 
-#include <forward_list>
-#include <memory>
-#include <mutex>
 #include <optional>
-#include <queue>
-#include <shared_mutex>
-#include <unordered_map>
+#include <vector>
 
 namespace cbdc::watchtower {
     /// With respect to a particular UHS ID, block height + ID of containing
@@ -27,6 +22,12 @@ namespace cbdc::watchtower {
     using block_cache_result = std::pair<size_t, hash_t>;
     /// Stores a set of blocks in memory and maintains an index of the UHS IDs
     /// contained therein.
+    ///
+    /// Blocks are kept in a fixed ring. The index is an open-addressing
+    /// table whose entries refer to blocks by generation, the sequence
+    /// number of the push which added them. Evicting a block leaves its
+    /// index entries in place; they are recognized as stale by generation,
+    /// and reused by later insertions or dropped when the index is resized.
     class block_cache {
       public:
         block_cache() = delete;
@@ -59,17 +60,41 @@ namespace cbdc::watchtower {
         auto best_block_height() const -> uint64_t;
 
       private:
+        /// Where a UHS ID was created and spent. A generation of zero means
+        /// no such block.
+        struct index_entry {
+            hash_t m_id{};
+            uint64_t m_out_gen{0};
+            uint64_t m_spend_gen{0};
+            uint32_t m_out_tx{0};
+            uint32_t m_spend_tx{0};
+        };
+
+        [[nodiscard]] auto is_cached(uint64_t gen) const -> bool;
+        [[nodiscard]] auto block_at(uint64_t gen) const
+            -> const cbdc::atomizer::block&;
+        [[nodiscard]] auto result_at(uint64_t gen, uint32_t tx) const
+            -> block_cache_result;
+
+        [[nodiscard]] auto find(const hash_t& uhs_id) const
+            -> const index_entry*;
+        auto find_or_insert(const hash_t& uhs_id) -> index_entry&;
+        void resize_index(size_t capacity);
+
         size_t m_k_blks;
-        std::queue<cbdc::atomizer::block> m_blks;
+        std::vector<cbdc::atomizer::block> m_blks;
+        /// Generation of the most recently pushed block.
+        uint64_t m_gen{0};
+        /// Blocks with this generation or lower have been evicted.
+        uint64_t m_evicted_gen{0};
         uint64_t m_best_blk_height{0};
-        std::unordered_map<hash_t,
-                           block_cache_result,
-                           hashing::const_sip_hash<hash_t>>
-            m_unspent_ids;
-        std::unordered_map<hash_t,
-                           block_cache_result,
-                           hashing::const_sip_hash<hash_t>>
-            m_spent_ids;
+
+        std::vector<index_entry> m_index;
+        /// Index entries in use, including stale ones.
+        size_t m_occupied{0};
+        /// UHS IDs referenced by the cached blocks.
+        size_t m_cached_ids{0};
+        hashing::keyed_mix m_hash{};
     };
 }
 
@@ -8,6 +8,8 @@
 #include "util/serialization/util.hpp"
 #include "watchtower.hpp"
 
+#include <algorithm>
+#include <future>
 #include <utility>
 
 namespace cbdc::watchtower {
@@ -70,6 +72,130 @@ namespace cbdc::watchtower {
             std::get<status_request_check_success>(res->payload()));
     }
 
+    sharded_client::sharded_client(std::vector<network::endpoint_t> eps,
+                                   std::vector<config::shard_range_t> ranges)
+        : m_ranges(std::move(ranges)) {
+        m_clients.reserve(eps.size());
+        for(auto& ep : eps) {
+            m_clients.push_back(
+                std::make_unique<blocking_client>(std::move(ep)));
+        }
+    }
+
+    auto sharded_client::init() -> bool {
+        return !m_clients.empty()
+            && std::all_of(m_clients.begin(),
+                           m_clients.end(),
+                           [](const std::unique_ptr<blocking_client>& c) {
+                               return c->init();
+                           });
+    }
+
+    auto sharded_client::owner(const hash_t& uhs_id) const -> size_t {
+        for(size_t i{0}; i < m_ranges.size() && i < m_clients.size(); i++) {
+            if(config::hash_in_shard_range(m_ranges[i], uhs_id)) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    auto sharded_client::request_best_block_height()
+        -> std::shared_ptr<best_block_height_response> {
+        auto futs = std::vector<
+            std::future<std::shared_ptr<best_block_height_response>>>();
+        futs.reserve(m_clients.size());
+        for(auto& c : m_clients) {
+            futs.push_back(std::async(std::launch::async, [&c]() {
+                return c->request_best_block_height();
+            }));
+        }
+
+        // Only blocks every watchtower has seen are reflected in all ranges
+        std::shared_ptr<best_block_height_response> ret;
+        auto failed = false;
+        for(auto& f : futs) {
+            auto res = f.get();
+            if(!res) {
+                failed = true;
+            } else if(!ret || res->height() < ret->height()) {
+                ret = std::move(res);
+            }
+        }
+        if(failed) {
+            return nullptr;
+        }
+        return ret;
+    }
+
+    auto
+    sharded_client::request_status_update(const status_update_request& req)
+        -> std::shared_ptr<status_request_check_success> {
+        if(m_clients.size() == 1) {
+            return m_clients.front()->request_status_update(req);
+        }
+
+        // Split the request by owner, recording where each UHS ID's state
+        // will be in its owner's response
+        auto parts = std::vector<tx_id_uhs_ids>(m_clients.size());
+        auto positions = std::unordered_map<
+            hash_t,
+            std::vector<std::pair<size_t, size_t>>,
+            hashing::const_sip_hash<hash_t>>();
+        for(const auto& [tx_id, uhs_ids] : req.uhs_ids()) {
+            auto& pos = positions[tx_id];
+            pos.reserve(uhs_ids.size());
+            for(const auto& uhs_id : uhs_ids) {
+                auto i = owner(uhs_id);
+                auto& part = parts[i][tx_id];
+                pos.emplace_back(i, part.size());
+                part.push_back(uhs_id);
+            }
+        }
+
+        auto futs = std::vector<
+            std::future<std::shared_ptr<status_request_check_success>>>(
+            m_clients.size());
+        for(size_t i{0}; i < m_clients.size(); i++) {
+            if(parts[i].empty()) {
+                continue;
+            }
+            futs[i] = std::async(std::launch::async, [&, i]() {
+                return m_clients[i]->request_status_update(
+                    status_update_request{std::move(parts[i])});
+            });
+        }
+        auto results
+            = std::vector<std::shared_ptr<status_request_check_success>>(
+                m_clients.size());
+        auto failed = false;
+        for(size_t i{0}; i < futs.size(); i++) {
+            if(futs[i].valid()) {
+                results[i] = futs[i].get();
+                failed = failed || !results[i];
+            }
+        }
+        if(failed) {
+            return nullptr;
+        }
+
+        auto states = tx_id_states();
+        for(const auto& [tx_id, pos] : positions) {
+            auto& tx_states = states[tx_id];
+            tx_states.reserve(pos.size());
+            for(const auto& [i, idx] : pos) {
+                const auto& part_states = results[i]->states();
+                auto it = part_states.find(tx_id);
+                if(it == part_states.end() || idx >= it->second.size()) {
+                    return nullptr;
+                }
+                tx_states.push_back(it->second[idx]);
+            }
+        }
+        return std::make_shared<status_request_check_success>(
+            std::move(states));
+    }
+
     async_client::async_client(network::endpoint_t ep) : m_ep(std::move(ep)) {}
 
     async_client::~async_client() {
@@ -140,6 +266,13 @@ namespace cbdc::watchtower {
         m_network.broadcast(pkt);
     }
 
+    void async_client::subscribe_status_update(
+        const status_subscribe_request& req) {
+        auto data = request{req};
+        auto pkt = make_shared_buffer(data);
+        m_network.broadcast(pkt);
+    }
+
     void async_client::set_status_update_handler(
         const async_client::status_update_response_handler_t& handler) {
         m_su_handler = handler;
@@ -57,6 +57,49 @@ namespace cbdc::watchtower {
         blocking_queue<std::shared_ptr<response>> m_res_q;
     };
 
+    /// \brief Client to synchronously request information from watchtowers
+    ///        which each index a range of UHS IDs.
+    ///
+    /// Status update requests are split by the range of each UHS ID, sent
+    /// to the watchtowers owning the ranges in parallel, and their responses
+    /// merged in the order of the original request.
+    class sharded_client {
+      public:
+        sharded_client() = delete;
+        /// Constructor.
+        /// \param eps watchtower endpoints.
+        /// \param ranges range of UHS IDs indexed by the watchtower at the
+        ///               same index in eps. UHS IDs outside every range are
+        ///               sent to the first watchtower.
+        sharded_client(std::vector<network::endpoint_t> eps,
+                       std::vector<config::shard_range_t> ranges);
+
+        /// Attempts to connect to every watchtower.
+        /// \return true if all the connections were successful.
+        auto init() -> bool;
+
+        /// Requests the best block height of every watchtower.
+        /// \return the lowest best block height, or nullptr if a watchtower
+        ///         did not respond.
+        auto request_best_block_height()
+            -> std::shared_ptr<best_block_height_response>;
+
+        /// Sends the part of a status update request in each watchtower's
+        /// range to that watchtower and merges the responses.
+        /// \param req request to split.
+        /// \return the merged response, or nullptr if a watchtower did not
+        ///         respond.
+        auto request_status_update(const status_update_request& req)
+            -> std::shared_ptr<status_request_check_success>;
+
+      private:
+        /// Returns the index of the watchtower owning a UHS ID.
+        [[nodiscard]] auto owner(const hash_t& uhs_id) const -> size_t;
+
+        std::vector<config::shard_range_t> m_ranges;
+        std::vector<std::unique_ptr<blocking_client>> m_clients;
+    };
+
     /// Client to asynchronously request information from the watchtower.
     class async_client {
       public:
@@ -82,6 +125,13 @@ namespace cbdc::watchtower {
         /// Sends a StatusUpdateRequest to the Watchtower.
         void request_status_update(const status_update_request& req);
 
+        /// Subscribes to status updates from the Watchtower. Statuses of
+        /// the transactions already resolved are delivered immediately, the
+        /// others once the Watchtower resolves them, all through the status
+        /// update handler.
+        /// \param req transactions to subscribe to.
+        void subscribe_status_update(const status_subscribe_request& req);
+
         using status_update_response_handler_t = std::function<void(
             std::shared_ptr<status_request_check_success>&&)>;
 
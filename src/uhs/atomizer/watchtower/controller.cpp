@@ -19,7 +19,13 @@ cbdc::watchtower::controller::controller(
       m_opts(std::move(opts)),
       m_logger(log),
       m_watchtower(m_opts.m_watchtower_block_cache_size,
-                   m_opts.m_watchtower_error_cache_size),
+                   m_opts.m_watchtower_error_cache_size,
+                   m_opts.m_watchtower_subscription_blocks,
+                   watchtower_id < m_opts.m_watchtower_ranges.size()
+                       ? m_opts.m_watchtower_ranges[watchtower_id]
+                       : config::shard_range_t{
+                           0,
+                           std::numeric_limits<uint8_t>::max()}),
       m_archiver_client(m_opts.m_archiver_endpoints[0], log) {}
 
 cbdc::watchtower::controller::~controller() {
@@ -106,23 +112,25 @@ auto cbdc::watchtower::controller::atomizer_handler(
                     "transactions.");
     if(blk.m_height != (m_last_blk_height + 1)) {
         m_logger->warn("Block not contiguous. Last block:", m_last_blk_height);
-        while(blk.m_height != (m_last_blk_height + 1)) {
-            auto missed_blk
-                = m_archiver_client.get_block(m_last_blk_height + 1);
-            if(!missed_blk) {
+        while(m_last_blk_height + 1 < blk.m_height) {
+            auto caught_up = m_archiver_client.get_blocks(
+                m_last_blk_height + 1,
+                blk.m_height - 1,
+                [&](atomizer::block&& missed_blk) {
+                    m_last_blk_height = missed_blk.m_height;
+                    send_notifications(
+                        m_watchtower.add_block(std::move(missed_blk)));
+                });
+            if(!caught_up) {
                 m_logger->warn("Waiting for archiver sync");
                 static constexpr auto archiver_wait_time
                     = std::chrono::milliseconds(100);
                 std::this_thread::sleep_for(archiver_wait_time);
-                continue;
             }
-
-            m_last_blk_height = (*missed_blk).m_height;
-            m_watchtower.add_block(std::move(*missed_blk));
         }
     }
     m_last_blk_height = blk.m_height;
-    m_watchtower.add_block(std::move(blk));
+    send_notifications(m_watchtower.add_block(std::move(blk)));
     return std::nullopt;
 }
 
@@ -134,10 +142,20 @@ auto cbdc::watchtower::controller::internal_server_handler(
         m_logger->error("Invalid internal request packet");
         return std::nullopt;
     }
-    m_watchtower.add_errors(std::move(maybe_errs.value()));
+    send_notifications(
+        m_watchtower.add_errors(std::move(maybe_errs.value())));
     return std::nullopt;
 }
 
+void cbdc::watchtower::controller::send_notifications(
+    std::vector<notification>&& notifications) {
+    for(auto& n : notifications) {
+        auto res
+            = response{status_request_check_success{std::move(n.m_states)}};
+        m_external_network.send(make_shared_buffer(res), n.m_subscriber);
+    }
+}
+
 auto cbdc::watchtower::controller::external_server_handler(
     cbdc::network::message_t&& pkt) -> std::optional<cbdc::buffer> {
     auto deser = cbdc::buffer_serializer(*pkt.m_pkt);
@@ -157,6 +175,17 @@ auto cbdc::watchtower::controller::external_server_handler(
             m_logger->info("Received request_best_block_height from peer",
                            pkt.m_peer_id);
             return make_buffer(*res);
+        },
+        [&](const cbdc::watchtower::status_subscribe_request& ss_req)
+            -> cbdc::buffer {
+            auto res = m_watchtower.handle_status_subscribe_request(
+                pkt.m_peer_id,
+                ss_req);
+            m_logger->info("Received status_subscribe_request with",
+                           ss_req.uhs_ids().size(),
+                           "UHS IDs from peer",
+                           pkt.m_peer_id);
+            return make_buffer(*res);
         }};
     auto msg = std::visit(res_handler, req.payload());
     return msg;
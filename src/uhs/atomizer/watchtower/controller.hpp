@@ -63,6 +63,7 @@ namespace cbdc::watchtower {
             -> std::optional<cbdc::buffer>;
         auto external_server_handler(cbdc::network::message_t&& pkt)
             -> std::optional<cbdc::buffer>;
+        void send_notifications(std::vector<notification>&& notifications);
     };
 }
 
@@ -52,11 +52,11 @@ namespace cbdc::watchtower {
         std::queue<std::shared_ptr<tx_error>> m_errs;
         std::unordered_map<hash_t,
                            std::shared_ptr<tx_error>,
-                           hashing::const_sip_hash<hash_t>>
+                           hashing::keyed_mix>
             m_uhs_errs;
         std::unordered_map<hash_t,
                            std::shared_ptr<tx_error>,
-                           hashing::const_sip_hash<hash_t>>
+                           hashing::keyed_mix>
             m_tx_id_errs;
     };
 }
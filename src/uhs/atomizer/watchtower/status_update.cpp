@@ -24,6 +24,23 @@ namespace cbdc::watchtower {
         cbdc::watchtower::tx_id_uhs_ids uhs_ids)
         : m_uhs_ids(std::move(uhs_ids)) {}
 
+    status_subscribe_request::status_subscribe_request(
+        cbdc::serializer& pkt) {
+        pkt >> *this;
+    }
+
+    status_subscribe_request::status_subscribe_request(tx_id_uhs_ids uhs_ids)
+        : m_uhs_ids(std::move(uhs_ids)) {}
+
+    auto status_subscribe_request::uhs_ids() const -> const tx_id_uhs_ids& {
+        return m_uhs_ids;
+    }
+
+    auto status_subscribe_request::operator==(
+        const status_subscribe_request& rhs) const -> bool {
+        return rhs.m_uhs_ids == m_uhs_ids;
+    }
+
     cbdc::watchtower::status_update_state::status_update_state(
         cbdc::serializer& pkt) {
         pkt >> *this;
@@ -79,6 +79,41 @@ namespace cbdc::watchtower {
         tx_id_uhs_ids m_uhs_ids;
     };
 
+    /// Network request to be sent the status of a set of UHS IDs once the
+    /// Watchtower has a result for their transactions, instead of polling
+    /// with status update requests. The Watchtower replies at once with the
+    /// transactions it already has a result for, and pushes the others as
+    /// blocks and errors resolve them.
+    class status_subscribe_request {
+      public:
+        friend auto cbdc::operator<<(
+            cbdc::serializer& packet,
+            const cbdc::watchtower::status_subscribe_request& sub_req)
+            -> cbdc::serializer&;
+        friend auto cbdc::operator>>(cbdc::serializer& packet,
+                                     status_subscribe_request& sub_req)
+            -> cbdc::serializer&;
+
+        auto operator==(const status_subscribe_request& rhs) const -> bool;
+
+        status_subscribe_request() = delete;
+
+        /// Constructor.
+        /// \param uhs_ids the UHS IDs to report, keyed by Tx ID.
+        explicit status_subscribe_request(tx_id_uhs_ids uhs_ids);
+
+        /// Construct from a packet.
+        /// \param pkt packet containing a serialized request.
+        explicit status_subscribe_request(cbdc::serializer& pkt);
+
+        /// UHS IDs to report.
+        /// \return the UHS IDs, keyed by Tx ID.
+        [[nodiscard]] auto uhs_ids() const -> const tx_id_uhs_ids&;
+
+      private:
+        tx_id_uhs_ids m_uhs_ids;
+    };
+
     /// Represents the internal state of an ongoing status update request.
     /// Returned in pertinent success responses.
     class status_update_state {
@@ -19,6 +19,18 @@ namespace cbdc {
         return packet >> su_req.m_uhs_ids;
     }
 
+    auto operator<<(cbdc::serializer& packet,
+                    const cbdc::watchtower::status_subscribe_request& sub_req)
+        -> cbdc::serializer& {
+        return packet << sub_req.m_uhs_ids;
+    }
+
+    auto operator>>(cbdc::serializer& packet,
+                    cbdc::watchtower::status_subscribe_request& sub_req)
+        -> cbdc::serializer& {
+        return packet >> sub_req.m_uhs_ids;
+    }
+
     auto operator<<(cbdc::serializer& packet,
                     const cbdc::watchtower::status_update_state& state)
         -> cbdc::serializer& {
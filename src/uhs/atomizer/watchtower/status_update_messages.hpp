@@ -15,6 +15,7 @@
 namespace cbdc {
     namespace watchtower {
         class status_update_request;
+        class status_subscribe_request;
         class status_update_state;
         class status_request_check_success;
     }
@@ -24,6 +25,12 @@ namespace cbdc {
     auto operator>>(cbdc::serializer& packet,
                     cbdc::watchtower::status_update_request& su_req)
         -> cbdc::serializer&;
+    auto operator<<(cbdc::serializer& packet,
+                    const cbdc::watchtower::status_subscribe_request& sub_req)
+        -> cbdc::serializer&;
+    auto operator>>(cbdc::serializer& packet,
+                    cbdc::watchtower::status_subscribe_request& sub_req)
+        -> cbdc::serializer&;
     auto operator<<(cbdc::serializer& packet,
                     const cbdc::watchtower::status_update_state& state)
         -> cbdc::serializer&;
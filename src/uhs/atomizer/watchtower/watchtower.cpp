@@ -12,52 +12,183 @@
 #include <algorithm>
 
 namespace cbdc::watchtower {
-    void watchtower::add_block(cbdc::atomizer::block&& blk) {
-        std::unique_lock lk(m_bc_mut);
-        m_bc.push_block(std::move(blk));
-    }
-
-    void watchtower::add_errors(std::vector<tx_error>&& errs) {
-        std::shared_lock lk0(m_bc_mut, std::defer_lock);
-        std::unique_lock lk1(m_ec_mut, std::defer_lock);
-        std::lock(lk0, lk1);
-        auto repeated_tx_filter = [&](const auto& err) -> bool {
-            auto res = false;
-            auto check_uhs = [&](const hash_t& err_tx_id, auto&& info) {
-                for(const auto& uhs : info.input_uhs_ids()) {
-                    if(auto spent = m_bc.check_spent(uhs)) {
-                        auto [height, tx_id] = spent.value();
-                        if(err_tx_id == tx_id) {
-                            res = true;
-                            return;
+    namespace {
+        auto to_notifications(
+            std::unordered_map<uint64_t, tx_id_states>&& notifications)
+            -> std::vector<notification> {
+            auto ret = std::vector<notification>();
+            ret.reserve(notifications.size());
+            for(auto& [subscriber, states] : notifications) {
+                ret.push_back({subscriber, std::move(states)});
+            }
+            return ret;
+        }
+    }
+
+    auto watchtower::add_block(cbdc::atomizer::block&& blk)
+        -> std::vector<notification> {
+        if(m_range.first != 0
+           || m_range.second != std::numeric_limits<uint8_t>::max()) {
+            blk = atomizer::filter_block(blk, m_range);
+        }
+
+        auto tx_ids = std::vector<hash_t>();
+        tx_ids.reserve(blk.m_transactions.size());
+        for(const auto& tx : blk.m_transactions) {
+            tx_ids.push_back(tx.m_id);
+        }
+
+        // The first copy gets its own block, the second takes the original
+        auto copied = false;
+        m_caches.write([&](caches& c) {
+            if(copied) {
+                c.m_bc.push_block(std::move(blk));
+            } else {
+                c.m_bc.push_block(cbdc::atomizer::block(blk));
+                copied = true;
+            }
+        });
+
+        auto c = m_caches.read();
+        auto notifications = std::unordered_map<uint64_t, tx_id_states>();
+        std::unique_lock l(m_subscriptions_mut);
+        for(const auto& tx_id : tx_ids) {
+            notify_subscribers(*c, tx_id, notifications);
+        }
+
+        // Answer subscriptions that have waited too long with the statuses
+        // as they stand
+        const auto best_height = c->m_bc.best_block_height();
+        while(!m_subscription_expiry.empty()
+              && std::get<0>(m_subscription_expiry.front()) <= best_height) {
+            auto [expiry, tx_id, subscriber]
+                = m_subscription_expiry.front();
+            m_subscription_expiry.pop_front();
+            auto it = m_subscriptions.find(tx_id);
+            if(it == m_subscriptions.end()) {
+                continue;
+            }
+            auto& subs = it->second;
+            auto sub = std::find_if(subs.begin(),
+                                    subs.end(),
+                                    [&](const subscription& s) {
+                                        return s.m_subscriber == subscriber;
+                                    });
+            if(sub == subs.end()) {
+                continue;
+            }
+            notifications[subscriber][tx_id]
+                = check_tx_statuses(*c, tx_id, sub->m_uhs_ids, best_height);
+            subs.erase(sub);
+            if(subs.empty()) {
+                m_subscriptions.erase(it);
+            }
+        }
+
+        return to_notifications(std::move(notifications));
+    }
+
+    auto watchtower::add_errors(std::vector<tx_error>&& errs)
+        -> std::vector<notification> {
+        auto tx_ids = std::vector<hash_t>();
+        tx_ids.reserve(errs.size());
+        for(const auto& err : errs) {
+            tx_ids.push_back(err.tx_id());
+        }
+
+        // Both copies hold the same blocks, so the errors are filtered once
+        auto filtered = false;
+        m_caches.write([&](caches& c) {
+            if(filtered) {
+                c.m_ec.push_errors(std::move(errs));
+                return;
+            }
+            auto repeated_tx_filter = [&](const auto& err) -> bool {
+                auto res = false;
+                auto check_uhs = [&](const hash_t& err_tx_id, auto&& info) {
+                    for(const auto& uhs : info.input_uhs_ids()) {
+                        if(auto spent = c.m_bc.check_spent(uhs)) {
+                            auto [height, tx_id] = spent.value();
+                            if(err_tx_id == tx_id) {
+                                res = true;
+                                return;
+                            }
                         }
-                    }
-                    if(auto unspent = m_bc.check_unspent(uhs)) {
-                        auto [height, tx_id] = unspent.value();
-                        if(err_tx_id == tx_id) {
-                            res = true;
-                            return;
+                        if(auto unspent = c.m_bc.check_unspent(uhs)) {
+                            auto [height, tx_id] = unspent.value();
+                            if(err_tx_id == tx_id) {
+                                res = true;
+                                return;
+                            }
                         }
                     }
-                }
+                };
+                std::visit(
+                    overloaded{[&](tx_error_inputs_spent&& info) {
+                                   check_uhs(err.tx_id(), std::move(info));
+                               },
+                               [&](tx_error_inputs_dne&& info) {
+                                   check_uhs(err.tx_id(), std::move(info));
+                               },
+                               [&](auto&& /* info */) {}},
+                    std::move(err.info()));
+                return res;
             };
-            std::visit(overloaded{[&](tx_error_inputs_spent&& info) {
-                                      check_uhs(err.tx_id(), std::move(info));
-                                  },
-                                  [&](tx_error_inputs_dne&& info) {
-                                      check_uhs(err.tx_id(), std::move(info));
-                                  },
-                                  [&](auto&& /* info */) {}},
-                       std::move(err.info()));
-            return res;
-        };
-        errs.erase(
-            std::remove_if(errs.begin(), errs.end(), repeated_tx_filter),
-            errs.end());
-        m_ec.push_errors(std::move(errs));
-    }
-
-    auto watchtower::check_uhs_id_statuses(const std::vector<hash_t>& uhs_ids,
+            errs.erase(
+                std::remove_if(errs.begin(), errs.end(), repeated_tx_filter),
+                errs.end());
+            filtered = true;
+            c.m_ec.push_errors(std::vector<tx_error>(errs));
+        });
+
+        auto c = m_caches.read();
+        auto notifications = std::unordered_map<uint64_t, tx_id_states>();
+        std::unique_lock l(m_subscriptions_mut);
+        for(const auto& tx_id : tx_ids) {
+            notify_subscribers(*c, tx_id, notifications);
+        }
+        return to_notifications(std::move(notifications));
+    }
+
+    void watchtower::notify_subscribers(
+        const caches& c,
+        const hash_t& tx_id,
+        std::unordered_map<uint64_t, tx_id_states>& notifications) {
+        auto it = m_subscriptions.find(tx_id);
+        if(it == m_subscriptions.end()) {
+            return;
+        }
+        const auto best_height = c.m_bc.best_block_height();
+        for(const auto& sub : it->second) {
+            notifications[sub.m_subscriber][tx_id]
+                = check_tx_statuses(c, tx_id, sub.m_uhs_ids, best_height);
+        }
+        m_subscriptions.erase(it);
+    }
+
+    auto watchtower::check_tx_statuses(const caches& c,
+                                       const hash_t& tx_id,
+                                       const std::vector<hash_t>& uhs_ids,
+                                       uint64_t best_height)
+        -> std::vector<status_update_state> {
+        auto tx_err = c.m_ec.check_tx_id(tx_id);
+        bool internal_err{false};
+        if(tx_err.has_value()
+           && (std::holds_alternative<tx_error_sync>(tx_err.value().info())
+               || std::holds_alternative<tx_error_stxo_range>(
+                   tx_err.value().info()))) {
+            internal_err = true;
+        }
+        return check_uhs_id_statuses(c,
+                                     uhs_ids,
+                                     tx_id,
+                                     internal_err,
+                                     tx_err.has_value(),
+                                     best_height);
+    }
+
+    auto watchtower::check_uhs_id_statuses(const caches& c,
+                                           const std::vector<hash_t>& uhs_ids,
                                            const hash_t& tx_id,
                                            bool internal_err,
                                            bool tx_err,
@@ -74,7 +205,7 @@ namespace cbdc::watchtower {
                                         uhs_id});
                 found_status = true;
             } else if(tx_err) {
-                if(auto uhs_err = m_ec.check_uhs_id(uhs_id)) {
+                if(auto uhs_err = c.m_ec.check_uhs_id(uhs_id)) {
                     states.emplace_back(
                         status_update_state{search_status::invalid_input,
                                             best_height,
@@ -87,7 +218,7 @@ namespace cbdc::watchtower {
                 }
                 found_status = true;
             }
-            if(auto spent = m_bc.check_spent(uhs_id)) {
+            if(auto spent = c.m_bc.check_spent(uhs_id)) {
                 auto [height, s_tx_id] = spent.value();
                 if(s_tx_id == tx_id) {
                     states.emplace_back(
@@ -96,7 +227,7 @@ namespace cbdc::watchtower {
                                             uhs_id});
                     found_status = true;
                 }
-            } else if(auto unspent = m_bc.check_unspent(uhs_id)) {
+            } else if(auto unspent = c.m_bc.check_unspent(uhs_id)) {
                 auto [height, us_tx_id] = unspent.value();
                 if(us_tx_id == tx_id) {
                     states.emplace_back(
@@ -124,25 +255,11 @@ namespace cbdc::watchtower {
                            hashing::const_sip_hash<hash_t>>
             chks;
         {
-            std::shared_lock lk0(m_bc_mut, std::defer_lock);
-            std::shared_lock lk1(m_ec_mut, std::defer_lock);
-            std::lock(lk0, lk1);
-            auto best_height = m_bc.best_block_height();
+            auto c = m_caches.read();
+            auto best_height = c->m_bc.best_block_height();
             for(const auto& [tx_id, uhs_ids] : req.uhs_ids()) {
-                auto tx_err = m_ec.check_tx_id(tx_id);
-                bool internal_err{false};
-                if(tx_err.has_value()
-                   && (std::holds_alternative<tx_error_sync>(
-                           tx_err.value().info())
-                       || std::holds_alternative<tx_error_stxo_range>(
-                           tx_err.value().info()))) {
-                    internal_err = true;
-                }
-                auto states = check_uhs_id_statuses(uhs_ids,
-                                                    tx_id,
-                                                    internal_err,
-                                                    tx_err.has_value(),
-                                                    best_height);
+                auto states
+                    = check_tx_statuses(*c, tx_id, uhs_ids, best_height);
                 chks.emplace(std::make_pair(tx_id, std::move(states)));
             }
         }
@@ -153,12 +270,55 @@ namespace cbdc::watchtower {
     auto watchtower::handle_best_block_height_request(
         const best_block_height_request& /* unused */)
         -> std::unique_ptr<response> {
-        std::shared_lock lk(m_bc_mut);
+        auto c = m_caches.read();
         return std::make_unique<response>(
-            best_block_height_response{m_bc.best_block_height()});
+            best_block_height_response{c->m_bc.best_block_height()});
     }
 
-    watchtower::watchtower(size_t block_cache_size, size_t error_cache_size)
+    auto watchtower::handle_status_subscribe_request(
+        uint64_t subscriber,
+        const status_subscribe_request& req) -> std::unique_ptr<response> {
+        auto chks = tx_id_states();
+        {
+            // Registering under the lock ensures a block or error added
+            // after the caches were read notifies the new subscriptions
+            std::unique_lock l(m_subscriptions_mut);
+            auto c = m_caches.read();
+            auto best_height = c->m_bc.best_block_height();
+            for(const auto& [tx_id, uhs_ids] : req.uhs_ids()) {
+                auto states
+                    = check_tx_statuses(*c, tx_id, uhs_ids, best_height);
+                auto resolved = std::any_of(
+                    states.begin(),
+                    states.end(),
+                    [](const status_update_state& state) {
+                        return state.status() != search_status::no_history;
+                    });
+                if(resolved) {
+                    chks.emplace(tx_id, std::move(states));
+                    continue;
+                }
+                m_subscriptions[tx_id].push_back({subscriber, uhs_ids});
+                m_subscription_expiry.emplace_back(
+                    best_height + m_subscription_blocks,
+                    tx_id,
+                    subscriber);
+            }
+        }
+
+        return std::make_unique<response>(status_request_check_success{chks});
+    }
+
+    watchtower::watchtower(size_t block_cache_size,
+                           size_t error_cache_size,
+                           size_t subscription_blocks,
+                           config::shard_range_t range)
+        : m_caches(block_cache_size, error_cache_size),
+          m_subscription_blocks(subscription_blocks),
+          m_range(range) {}
+
+    watchtower::caches::caches(size_t block_cache_size,
+                               size_t error_cache_size)
         : m_bc{block_cache_size},
           m_ec{error_cache_size} {}
 
@@ -194,8 +354,9 @@ namespace cbdc::watchtower {
     request::request(request_t req) : m_req(std::move(req)) {}
 
     request::request(serializer& pkt)
-        : m_req(get_variant<status_update_request, best_block_height_request>(
-            pkt)) {}
+        : m_req(get_variant<status_update_request,
+                            best_block_height_request,
+                            status_subscribe_request>(pkt)) {}
 
     auto request::payload() const -> const request_t& {
         return m_req;
@@ -14,6 +14,13 @@
 #include "error_cache.hpp"
 #include "messages.hpp"
 #include "status_update.hpp"
+#include "util/common/config.hpp"
+#include "util/common/left_right.hpp"
+
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <tuple>
 
 namespace cbdc::watchtower {
     /// Request the watchtower's known best block height.
@@ -73,8 +80,9 @@ namespace cbdc::watchtower {
 
         request() = delete;
 
-        using request_t
-            = std::variant<status_update_request, best_block_height_request>;
+        using request_t = std::variant<status_update_request,
+                                       best_block_height_request,
+                                       status_subscribe_request>;
 
         /// Constructor.
         /// \param req request payload.
@@ -122,8 +130,18 @@ namespace cbdc::watchtower {
         response_t m_resp;
     };
 
+    /// Statuses to push to a client which subscribed to them.
+    struct notification {
+        /// Subscriber to send the statuses to.
+        uint64_t m_subscriber{};
+        /// Statuses of the resolved transactions.
+        tx_id_states m_states;
+    };
+
     /// Service to answer client requests for processing status updates on
-    /// submitted transactions.
+    /// submitted transactions. Requests are answered from a published copy
+    /// of the caches, so they neither wait for nor delay new blocks and
+    /// errors.
     class watchtower {
       public:
         watchtower() = delete;
@@ -131,19 +149,37 @@ namespace cbdc::watchtower {
         /// Constructor.
         /// \param block_cache_size the number of blocks to store in this Watchtower's block cache.
         /// \param error_cache_size the number of errors to store in this Watchtower's error cache.
+        /// \param subscription_blocks number of blocks after which a
+        ///                            subscription to a transaction that
+        ///                            is still unresolved is answered with
+        ///                            its current statuses and dropped.
+        /// \param range range of UHS IDs to index. Only the part of each
+        ///              block in the range is cached, so the Watchtower can
+        ///              only report statuses of UHS IDs in the range.
         /// \see cbdc::watchtower::BlockCache
-        watchtower(size_t block_cache_size, size_t error_cache_size);
+        watchtower(size_t block_cache_size,
+                   size_t error_cache_size,
+                   size_t subscription_blocks
+                   = config::defaults::watchtower_subscription_blocks,
+                   config::shard_range_t range
+                   = {0, std::numeric_limits<uint8_t>::max()});
 
         /// Adds a new block from the Atomizer to the Watchtower. Currently
-        /// just forwards the block to the in-memory cache to await requests
-        /// from clients.
+        /// just forwards the part of the block in the Watchtower's range to
+        /// the in-memory cache to await requests from clients.
         /// \param blk block to add.
-        void add_block(cbdc::atomizer::block&& blk);
+        /// \return statuses to push to subscribers of the transactions the
+        ///         block resolved, or whose subscriptions expired.
+        auto add_block(cbdc::atomizer::block&& blk)
+            -> std::vector<notification>;
 
         /// Adds an error from an internal component to the Watchtower's error
         /// cache.
         /// \param errs error to add.
-        void add_errors(std::vector<tx_error>&& errs);
+        /// \return statuses to push to subscribers of the transactions the
+        ///         errors resolved.
+        auto add_errors(std::vector<tx_error>&& errs)
+            -> std::vector<notification>;
 
         /// Composes a response to a status update request based on the data
         /// available. Currently only supports check requests against blocks
@@ -170,17 +206,66 @@ namespace cbdc::watchtower {
         handle_best_block_height_request(const best_block_height_request& req)
             -> std::unique_ptr<response>;
 
+        /// Composes a response to a status subscribe request, containing
+        /// the transactions the Watchtower already has a result for, and
+        /// subscribes the client to the others. Statuses are reported as by
+        /// \ref handle_status_update_request.
+        /// \param subscriber ID of the client to push statuses to.
+        /// \param req a status subscribe request from the client.
+        /// \return the response to send to the client.
+        auto handle_status_subscribe_request(
+            uint64_t subscriber,
+            const status_subscribe_request& req) -> std::unique_ptr<response>;
+
       private:
-        block_cache m_bc;
-        std::shared_mutex m_bc_mut;
-        error_cache m_ec;
-        std::shared_mutex m_ec_mut;
-
-        auto check_uhs_id_statuses(const std::vector<hash_t>& uhs_ids,
-                                   const hash_t& tx_id,
-                                   bool internal_err,
-                                   bool tx_err,
-                                   uint64_t best_height)
+        /// Block and error caches, updated together.
+        struct caches {
+            caches(size_t block_cache_size, size_t error_cache_size);
+
+            block_cache m_bc;
+            error_cache m_ec;
+        };
+
+        left_right<caches> m_caches;
+
+        /// A client waiting for a transaction's statuses.
+        struct subscription {
+            uint64_t m_subscriber{};
+            std::vector<hash_t> m_uhs_ids;
+        };
+
+        size_t m_subscription_blocks;
+        config::shard_range_t m_range;
+        /// Subscriptions keyed by Tx ID.
+        std::unordered_map<hash_t,
+                           std::vector<subscription>,
+                           hashing::const_sip_hash<hash_t>>
+            m_subscriptions;
+        /// Block height at which each subscription expires, in order of
+        /// subscription.
+        std::deque<std::tuple<uint64_t, hash_t, uint64_t>>
+            m_subscription_expiry;
+        std::mutex m_subscriptions_mut;
+
+        /// Moves the subscriptions of a resolved transaction to the
+        /// notifications for their subscribers.
+        void notify_subscribers(const caches& c,
+                                const hash_t& tx_id,
+                                std::unordered_map<uint64_t, tx_id_states>&
+                                    notifications);
+
+        static auto check_tx_statuses(const caches& c,
+                                      const hash_t& tx_id,
+                                      const std::vector<hash_t>& uhs_ids,
+                                      uint64_t best_height)
+            -> std::vector<status_update_state>;
+
+        static auto check_uhs_id_statuses(const caches& c,
+                                          const std::vector<hash_t>& uhs_ids,
+                                          const hash_t& tx_id,
+                                          bool internal_err,
+                                          bool tx_err,
+                                          uint64_t best_height)
             -> std::vector<status_update_state>;
     };
 }
@@ -5,8 +5,10 @@
 
 #include "controller.hpp"
 #include "crypto/sha256.h"
+#include "util/common/affinity.hpp"
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
+#include "util/network/io_loop.hpp"
 #include "util/serialization/format.hpp"
 
 #include <csignal>
@@ -29,9 +31,18 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_watchtower_loglevels[watchtower_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
 
     auto ctl
         = cbdc::watchtower::controller{static_cast<uint32_t>(watchtower_id),
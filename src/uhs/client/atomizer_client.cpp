@@ -15,7 +15,8 @@ namespace cbdc {
         const std::string& wallet_file,
         const std::string& client_file)
         : client(opts, logger, wallet_file, client_file),
-          m_wc(opts.m_watchtower_client_endpoints[0]),
+          m_wc(opts.m_watchtower_client_endpoints,
+               opts.m_watchtower_ranges),
           m_logger(logger),
           m_opts(opts) {}
 
@@ -59,8 +60,13 @@ namespace cbdc {
         m_logger->debug("Checking watchtower state...");
 
         auto res = m_wc.request_status_update(req);
+        if(!res) {
+            m_logger->error("Failed to get status update from watchtower");
+            return false;
+        }
 
         bool success{true};
+        auto confirmed = std::vector<hash_t>();
         for(const auto& [tx_id, uhs_states] : res->states()) {
             for(const auto& s : uhs_states) {
                 if((s.status() != cbdc::watchtower::search_status::unspent)
@@ -79,9 +85,13 @@ namespace cbdc {
             if(!success) {
                 continue;
             }
-            success = confirm_transaction(tx_id);
+            confirmed.push_back(tx_id);
         }
 
+        // Update the wallet once for every confirmed transaction
+        success = confirm_transactions(confirmed) == confirmed.size()
+               && success;
+
         return success;
     }
 
@@ -90,8 +100,8 @@ namespace cbdc {
         atomizer::tx_notify_request msg;
         auto ctx = transaction::compact_tx(mint_tx);
         for(size_t i = 0; i < m_opts.m_attestation_threshold; i++) {
-            auto att
-                = ctx.sign(m_secp.get(), m_opts.m_sentinel_private_keys[i]);
+            auto att = ctx.sign(secp_context().get(),
+                                m_opts.m_sentinel_private_keys[i]);
             ctx.m_attestations.insert(att);
         }
         msg.m_tx = std::move(ctx);
@@ -35,7 +35,7 @@ namespace cbdc {
 
         /// \brief Update the client with the latest state from the watchtower.
         ///
-        /// Queries the watchtower's client endpoint to determine whether any
+        /// Queries the watchtowers' client endpoints to determine whether any
         /// pending transactions or inputs have confirmed or been rejected by
         /// the system.
         /// \return false if any pending transactions have failed according
@@ -60,14 +60,9 @@ namespace cbdc {
 
       private:
         cbdc::network::connection_manager m_atomizer_network;
-        cbdc::watchtower::blocking_client m_wc;
+        cbdc::watchtower::sharded_client m_wc;
         std::shared_ptr<logging::log> m_logger;
         cbdc::config::options m_opts;
-
-        std::unique_ptr<secp256k1_context,
-                        decltype(&secp256k1_context_destroy)>
-            m_secp{secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
-                   &secp256k1_context_destroy};
     };
 }
 
@@ -21,17 +21,24 @@ auto mint_command(cbdc::client& client, const std::vector<std::string>& args)
     static constexpr auto min_mint_arg_count = 7;
     if(args.size() < min_mint_arg_count) {
         std::cerr << "Mint requires args <n outputs> <output value>"
-                  << std::endl;
+                  << " [chunk size]" << std::endl;
         return false;
     }
 
     const auto n_outputs = std::stoull(args[5]);
     const auto output_val = std::stoul(args[6]);
+    static constexpr auto chunk_size_arg_idx = 7;
+    const auto chunk_size = args.size() > chunk_size_arg_idx
+                              ? std::stoull(args[chunk_size_arg_idx])
+                              : 0;
 
-    const auto mint_tx
-        = client.mint(n_outputs, static_cast<uint32_t>(output_val));
-    std::cout << cbdc::to_string(cbdc::transaction::tx_id(mint_tx))
-              << std::endl;
+    const auto mint_txs = client.mint(n_outputs,
+                                      static_cast<uint32_t>(output_val),
+                                      chunk_size);
+    for(const auto& mint_tx : mint_txs) {
+        std::cout << cbdc::to_string(cbdc::transaction::tx_id(mint_tx))
+                  << std::endl;
+    }
     return true;
 }
 
@@ -93,7 +100,8 @@ auto fan_command(cbdc::client& client, const std::vector<std::string>& args)
     -> bool {
     static constexpr auto min_fan_arg_count = 8;
     if(args.size() < min_fan_arg_count) {
-        std::cerr << "Fan requires args <count> <value> <pubkey>" << std::endl;
+        std::cerr << "Fan requires args <count> <value> <pubkey>"
+                  << " [chunk size] [window]" << std::endl;
         return false;
     }
 
@@ -107,15 +115,28 @@ auto fan_command(cbdc::client& client, const std::vector<std::string>& args)
         return false;
     }
 
-    const auto [tx, resp] = client.fan(static_cast<uint32_t>(count),
-                                       static_cast<uint32_t>(value),
-                                       pubkey.value());
-    if(!tx.has_value()) {
+    static constexpr auto chunk_size_arg_idx = 8;
+    static constexpr auto window_arg_idx = 9;
+    const auto chunk_size = args.size() > chunk_size_arg_idx
+                              ? std::stoull(args[chunk_size_arg_idx])
+                              : 0;
+    const auto window = args.size() > window_arg_idx
+                          ? std::stoull(args[window_arg_idx])
+                          : 0;
+
+    const auto results = client.fan(static_cast<uint32_t>(count),
+                                    static_cast<uint32_t>(value),
+                                    pubkey.value(),
+                                    chunk_size,
+                                    window);
+    if(results.empty()) {
         std::cout << "Could not generate valid send tx." << std::endl;
         return false;
     }
 
-    print_tx_result(tx, resp, pubkey.value());
+    for(const auto& [tx, resp] : results) {
+        print_tx_result(tx, resp, pubkey.value());
+    }
     return true;
 }
 
@@ -11,6 +11,7 @@
 #include "uhs/sentinel/format.hpp"
 #include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/wallet.hpp"
+#include "util/common/blocking_queue.hpp"
 #include "util/common/config.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/istream_serializer.hpp"
@@ -19,6 +20,8 @@
 
 #include <filesystem>
 #include <iomanip>
+#include <limits>
+#include <thread>
 #include <utility>
 
 namespace cbdc {
@@ -105,6 +108,33 @@ namespace cbdc {
         return mint_tx;
     }
 
+    auto client::mint(size_t n_outputs,
+                      uint32_t output_val,
+                      size_t chunk_size) -> std::vector<transaction::full_tx> {
+        if(chunk_size == 0 || n_outputs <= chunk_size) {
+            return {mint(n_outputs, output_val)};
+        }
+
+        auto txs = std::vector<transaction::full_tx>();
+        txs.reserve((n_outputs + chunk_size - 1) / chunk_size);
+        for(size_t minted{0}; minted < n_outputs; minted += chunk_size) {
+            auto tx = m_wallet.mint_new_coins(
+                std::min(chunk_size, n_outputs - minted),
+                output_val);
+            m_pending_txs.insert({transaction::tx_id(tx), tx});
+            txs.emplace_back(std::move(tx));
+        }
+        save();
+
+        for(const auto& tx : txs) {
+            if(!send_mint_tx(tx)) {
+                m_logger->error("Failed to send mint tx");
+            }
+        }
+
+        return txs;
+    }
+
     void client::sign_transaction(transaction::full_tx& tx) {
         m_wallet.sign(tx);
     }
@@ -172,6 +202,129 @@ namespace cbdc {
         return std::make_pair(tx.value(), res.value());
     }
 
+    auto client::fan(uint32_t count,
+                     uint32_t value,
+                     const pubkey_t& payee,
+                     size_t chunk_size,
+                     size_t window) -> std::vector<fan_result> {
+        if(chunk_size == 0 || count <= chunk_size) {
+            auto [tx, res] = fan(count, value, payee);
+            if(!tx.has_value()) {
+                return {};
+            }
+            return {{tx.value(), res}};
+        }
+
+        const auto chunk_value = static_cast<uint64_t>(chunk_size) * value;
+        if(chunk_value > std::numeric_limits<uint32_t>::max()) {
+            m_logger->error("Fan chunk value exceeds the output limit");
+            return {};
+        }
+
+        // Split the funds into one output per full chunk first, so each
+        // chunk transaction spends an input of its own and the chunks can
+        // be processed independently.
+        const auto n_full = count / chunk_size;
+        const auto split_payee = new_address();
+        auto [split_tx, split_res]
+            = fan(static_cast<uint32_t>(n_full),
+                  static_cast<uint32_t>(chunk_value),
+                  split_payee);
+        if(!split_tx.has_value()) {
+            return {};
+        }
+        auto ret = std::vector<fan_result>{{split_tx.value(), split_res}};
+        if(!await_confirmation(transaction::tx_id(split_tx.value()))) {
+            m_logger->error("Fan split transaction did not confirm");
+            return ret;
+        }
+
+        // Generate every chunk before submitting any, so the wallet locks
+        // distinct inputs for each, and save once for all of them.
+        auto txs = std::vector<transaction::full_tx>();
+        for(uint32_t sent{0}; sent < count;
+            sent += static_cast<uint32_t>(chunk_size)) {
+            const auto n = std::min(static_cast<uint32_t>(chunk_size),
+                                    count - sent);
+            auto tx = m_wallet.fan(n, value, payee, true);
+            if(!tx.has_value()) {
+                m_logger->error("Failed to generate wallet fan tx");
+                break;
+            }
+            for(const auto& in : tx->m_inputs) {
+                m_pending_spend.insert({in.hash(), in});
+            }
+            m_pending_txs.insert({transaction::tx_id(tx.value()), tx.value()});
+            txs.emplace_back(std::move(tx.value()));
+        }
+        save();
+
+        using response_type = std::pair<size_t, sentinel::execute_response>;
+        auto responses = blocking_queue<std::optional<response_type>>();
+        auto results = std::vector<std::optional<sentinel::execute_response>>(
+            txs.size());
+        size_t submitted{0};
+        size_t completed{0};
+        while(completed < txs.size()) {
+            while(submitted < txs.size()
+                  && (window == 0 || submitted - completed < window)) {
+                const auto idx = submitted++;
+                auto sent = m_sentinel_client.execute_transaction(
+                    txs[idx],
+                    [&responses, idx](
+                        const sentinel::rpc::client::execute_result_type& res) {
+                        if(!res.has_value()) {
+                            responses.push(std::nullopt);
+                            return;
+                        }
+                        responses.push(std::make_pair(idx, res.value()));
+                    });
+                if(!sent) {
+                    responses.push(std::nullopt);
+                }
+            }
+
+            auto res = std::optional<response_type>();
+            if(!responses.pop(res)) {
+                break;
+            }
+            completed++;
+            if(!res.has_value()) {
+                m_logger->error("Failed to send transaction to sentinel.");
+                continue;
+            }
+            const auto& [idx, resp] = res.value();
+            results[idx] = resp;
+            if(resp.m_tx_status == sentinel::tx_status::confirmed) {
+                confirm_pending(transaction::tx_id(txs[idx]));
+            }
+        }
+        save();
+
+        for(size_t i{0}; i < txs.size(); i++) {
+            ret.emplace_back(std::move(txs[i]), results[i]);
+        }
+        return ret;
+    }
+
+    auto client::await_confirmation(const hash_t& tx_id) -> bool {
+        static constexpr auto poll_interval = std::chrono::milliseconds(100);
+        static constexpr auto max_polls = 300;
+        for(int i{0}; i < max_polls; i++) {
+            if(m_pending_txs.find(tx_id) == m_pending_txs.end()) {
+                return true;
+            }
+            if(!sync()) {
+                return false;
+            }
+            if(m_pending_txs.find(tx_id) == m_pending_txs.end()) {
+                return true;
+            }
+            std::this_thread::sleep_for(poll_interval);
+        }
+        return false;
+    }
+
     auto client::send_transaction(const transaction::full_tx& tx)
         -> std::optional<cbdc::sentinel::execute_response> {
         import_transaction(tx);
@@ -278,6 +431,24 @@ namespace cbdc {
     }
 
     auto client::confirm_transaction(const hash_t& tx_id) -> bool {
+        auto success = confirm_pending(tx_id);
+        save();
+        return success;
+    }
+
+    auto client::confirm_transactions(const std::vector<hash_t>& tx_ids)
+        -> size_t {
+        size_t confirmed{0};
+        for(const auto& tx_id : tx_ids) {
+            if(confirm_pending(tx_id)) {
+                confirmed++;
+            }
+        }
+        save();
+        return confirmed;
+    }
+
+    auto client::confirm_pending(const hash_t& tx_id) -> bool {
         // TODO: Should abandon and confirm be combined somehow?
         // for instance: finish_transaction(hash_t tx_id, bool succeeded)
         bool success{false};
@@ -301,8 +472,6 @@ namespace cbdc {
             success = true;
         }
 
-        save();
-
         return success;
     }
 
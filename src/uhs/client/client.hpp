@@ -69,6 +69,20 @@ namespace cbdc {
         auto mint(size_t n_outputs, uint32_t output_val)
             -> transaction::full_tx;
 
+        /// \brief Mints outputs in transactions of at most chunk_size outputs
+        ///        each.
+        ///
+        /// Same as \ref mint, but generates every chunk before sending any,
+        /// saving the client state once, so large mints do not produce one
+        /// oversized transaction.
+        /// \param n_outputs total number of new spendable outputs to create.
+        /// \param output_val value of each output.
+        /// \param chunk_size maximum outputs per transaction. Zero mints
+        ///                   all outputs in one transaction.
+        /// \return the completed transactions.
+        auto mint(size_t n_outputs, uint32_t output_val, size_t chunk_size)
+            -> std::vector<transaction::full_tx>;
+
         /// \brief Send a specified amount from this client's wallet to a
         ///        target address.
         ///
@@ -99,6 +113,35 @@ namespace cbdc {
             -> std::pair<std::optional<transaction::full_tx>,
                          std::optional<cbdc::sentinel::execute_response>>;
 
+        /// Transaction sent by a chunked \ref fan and the sentinel's
+        /// response, if any.
+        using fan_result = std::pair<transaction::full_tx,
+                                     std::optional<sentinel::execute_response>>;
+
+        /// \brief Sends fixed-value outputs to a target address in
+        ///        transactions of at most chunk_size outputs, several at once.
+        ///
+        /// First sends a transaction to this wallet splitting the funds into
+        /// one output per chunk and waits for it to confirm, syncing while
+        /// the sentinel reports it pending. Then generates every chunk
+        /// transaction, each spending its own split output, and submits
+        /// them with up to window of them awaiting a sentinel response.
+        /// \param count number of outputs to generate.
+        /// \param value the amount to send per output.
+        /// \param payee the destination address of the transfer.
+        /// \param chunk_size maximum outputs per transaction. If zero or at
+        ///                   least count, same as the unchunked \ref fan.
+        /// \param window maximum transactions awaiting a response. Zero
+        ///               submits every chunk at once.
+        /// \return the transactions sent, split transaction first, with the
+        ///         sentinel's responses. Empty if the split transaction
+        ///         could not be generated or sent.
+        auto fan(uint32_t count,
+                 uint32_t value,
+                 const pubkey_t& payee,
+                 size_t chunk_size,
+                 size_t window) -> std::vector<fan_result>;
+
         /// \brief Extracts the transaction data that recipients need from
         ///        senders to confirm pending transfers.
         ///
@@ -176,6 +219,16 @@ namespace cbdc {
         /// \return true if the transaction was confirmed.
         auto confirm_transaction(const hash_t& tx_id) -> bool;
 
+        /// \brief Confirms the transactions with the given IDs.
+        ///
+        /// Equivalent to calling \ref confirm_transaction for each ID, but
+        /// saves the client and wallet state once rather than once per
+        /// transaction.
+        /// \param tx_ids the IDs of the transactions to confirm.
+        /// \return the number of transactions confirmed.
+        auto confirm_transactions(const std::vector<hash_t>& tx_ids)
+            -> size_t;
+
         /// \brief Create a new transaction.
         ///
         /// Creates a signed transaction that constitutes sending a specified
@@ -307,7 +360,16 @@ namespace cbdc {
 
         void save();
 
+        /// Confirms a pending transaction or input without saving.
+        auto confirm_pending(const hash_t& tx_id) -> bool;
+
         void register_pending_tx(const transaction::full_tx& tx);
+
+        /// Syncs until the given pending transaction confirms or the
+        /// attempts run out.
+        /// \param tx_id ID of the transaction to await.
+        /// \return true if the transaction is no longer pending.
+        auto await_confirmation(const hash_t& tx_id) -> bool;
     };
 }
 
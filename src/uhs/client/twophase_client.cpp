@@ -34,33 +34,38 @@ namespace cbdc {
     }
 
     auto twophase_client::sync() -> bool {
-        auto success = true;
-
-        auto txids = std::set<hash_t>();
+        auto txid_set = std::set<hash_t>();
         for(const auto& [tx_id, tx] : pending_txs()) {
-            txids.insert(tx_id);
+            txid_set.insert(tx_id);
         }
         for(const auto& [tx_id, inp] : pending_inputs()) {
-            txids.insert(tx_id);
+            txid_set.insert(tx_id);
+        }
+        if(txid_set.empty()) {
+            return true;
         }
 
-        for(const auto& tx_id : txids) {
-            m_logger->debug("Requesting status of", to_string(tx_id));
-            auto res = m_shard_status_client.check_tx_id(tx_id);
-            if(!res.has_value()) {
-                m_logger->error("Timeout waiting for shard response");
-                success = false;
+        // One request per shard rather than one per pending TX.
+        const auto txids
+            = std::vector<hash_t>(txid_set.begin(), txid_set.end());
+        m_logger->debug("Requesting status of", txids.size(), "TXs");
+        auto res = m_shard_status_client.check_tx_id_batch(txids);
+        if(!res.has_value()) {
+            m_logger->error("Timeout waiting for shard response");
+            return false;
+        }
+        auto confirmed = std::vector<hash_t>();
+        for(size_t i = 0; i < txids.size(); i++) {
+            if(res.value()[i]) {
+                m_logger->info(to_string(txids[i]), "confirmed");
+                confirmed.push_back(txids[i]);
             } else {
-                if(res.value()) {
-                    m_logger->info(to_string(tx_id), "confirmed");
-                    confirm_transaction(tx_id);
-                } else {
-                    m_logger->info(to_string(tx_id), "not found");
-                }
+                m_logger->info(to_string(txids[i]), "not found");
             }
         }
+        confirm_transactions(confirmed);
 
-        return success;
+        return true;
     }
 
     auto twophase_client::check_tx_id(const hash_t& tx_id)
@@ -77,8 +82,8 @@ namespace cbdc {
         -> bool {
         auto ctx = transaction::compact_tx(mint_tx);
         for(size_t i = 0; i < m_opts.m_attestation_threshold; i++) {
-            auto att
-                = ctx.sign(m_secp.get(), m_opts.m_sentinel_private_keys[i]);
+            auto att = ctx.sign(secp_context().get(),
+                                m_opts.m_sentinel_private_keys[i]);
             ctx.m_attestations.insert(att);
         }
         auto done = std::promise<void>();
@@ -64,6 +64,59 @@ namespace cbdc::sentinel {
                              validate_result_callback_type result_callback)
             -> bool
             = 0;
+
+        /// Callback function for providing batch validation results, or
+        /// std::nullopt if no results were returned.
+        using validate_batch_result_callback_type = std::function<void(
+            std::optional<cbdc::sentinel::validate_batch_response>)>;
+
+        /// Statically validate the given transactions and generate a
+        /// sentinel attestation for each valid transaction.
+        /// \param txs transactions to validate and attest to.
+        /// \param result_callback function to call with the validation
+        ///                        results, in the order of txs.
+        /// \return false if the implementation could not start validating
+        ///         the transactions.
+        virtual auto validate_transactions(
+            std::vector<transaction::full_tx> txs,
+            validate_batch_result_callback_type result_callback) -> bool
+            = 0;
+
+        /// Callback function for providing a transaction submission
+        /// result, or std::nullopt if the submission failed.
+        using submit_result_callback_type = std::function<void(
+            std::optional<cbdc::sentinel::submit_response>)>;
+
+        /// Statically validate the given transaction and, if it is valid,
+        /// forward it to the network without waiting for the execution
+        /// result. Poll for the result with transaction_status.
+        /// \param tx transaction to submit.
+        /// \param result_callback function to call once the transaction has
+        ///                        been validated.
+        /// \return false if the implementation could not start validating
+        ///         the transaction.
+        virtual auto
+        submit_transaction(transaction::full_tx tx,
+                           submit_result_callback_type result_callback)
+            -> bool
+            = 0;
+
+        /// Callback function for providing transaction statuses, or
+        /// std::nullopt if no statuses were returned.
+        using status_result_callback_type = std::function<void(
+            std::optional<cbdc::sentinel::status_response>)>;
+
+        /// Reports the status of previously submitted transactions.
+        /// \param tx_ids IDs of the transactions.
+        /// \param result_callback function to call with the statuses, in
+        ///                        the order of tx_ids.
+        /// \return false if the implementation could not look up the
+        ///         transactions.
+        virtual auto
+        transaction_status(std::vector<hash_t> tx_ids,
+                           status_result_callback_type result_callback)
+            -> bool
+            = 0;
     };
 }
 
@@ -10,10 +10,20 @@
 #include "util/serialization/util.hpp"
 
 namespace cbdc::sentinel::rpc {
+    namespace {
+        auto client_options() -> cbdc::rpc::tcp_client_options {
+            // Follow the fastest sentinel, and move away from one which
+            // stops answering
+            auto opts = cbdc::rpc::tcp_client_options();
+            opts.m_latency_aware = true;
+            return opts;
+        }
+    }
+
     client::client(std::vector<network::endpoint_t> endpoints,
                    std::shared_ptr<logging::log> logger)
         : m_logger(std::move(logger)),
-          m_client(std::move(endpoints)) {}
+          m_client(std::move(endpoints), client_options()) {}
 
     auto client::init(std::optional<bool> error_fatal) -> bool {
         if(!m_client.init(error_fatal)) {
@@ -68,4 +78,50 @@ namespace cbdc::sentinel::rpc {
                 cb(std::get<validate_response>(res.value()));
             });
     }
+
+    auto client::validate_transactions(
+        std::vector<transaction::full_tx> txs,
+        validate_batch_result_callback_type result_callback) -> bool {
+        return m_client.call(
+            validate_batch_request{std::move(txs)},
+            [cb = std::move(result_callback)](std::optional<response> res) {
+                if(!res.has_value()
+                   || !std::holds_alternative<validate_batch_response>(
+                       res.value())) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<validate_batch_response>(std::move(res.value())));
+            });
+    }
+
+    auto client::submit_transaction(
+        transaction::full_tx tx,
+        submit_result_callback_type result_callback) -> bool {
+        return m_client.call(
+            submit_request{std::move(tx)},
+            [cb = std::move(result_callback)](std::optional<response> res) {
+                if(!res.has_value()
+                   || !std::holds_alternative<submit_response>(res.value())) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<submit_response>(res.value()));
+            });
+    }
+
+    auto client::transaction_status(
+        std::vector<hash_t> tx_ids,
+        status_result_callback_type result_callback) -> bool {
+        return m_client.call(
+            status_request{std::move(tx_ids)},
+            [cb = std::move(result_callback)](std::optional<response> res) {
+                if(!res.has_value()
+                   || !std::holds_alternative<status_response>(res.value())) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<status_response>(std::move(res.value())));
+            });
+    }
 }
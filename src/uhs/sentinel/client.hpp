@@ -78,6 +78,39 @@ namespace cbdc::sentinel::rpc {
             std::function<void(validate_result_type)> result_callback)
             -> bool override;
 
+        /// Send several transactions to the sentinel for validation in one
+        /// request and return the responses via a callback function
+        /// asynchronously.
+        /// \param txs transactions to validate and attest to.
+        /// \param result_callback callback function to call with the
+        ///                        results.
+        /// \return true if the request was sent successfully.
+        auto validate_transactions(
+            std::vector<transaction::full_tx> txs,
+            validate_batch_result_callback_type result_callback)
+            -> bool override;
+
+        /// Send a transaction to the sentinel without waiting for its
+        /// execution result, and return the sentinel's acknowledgement via
+        /// a callback function asynchronously.
+        /// \param tx transaction to submit.
+        /// \param result_callback callback function to call with the
+        ///                        acknowledgement.
+        /// \return true if the request was sent successfully.
+        auto submit_transaction(transaction::full_tx tx,
+                                submit_result_callback_type result_callback)
+            -> bool override;
+
+        /// Ask the sentinel for the status of submitted transactions and
+        /// return the response via a callback function asynchronously.
+        /// \param tx_ids IDs of the transactions.
+        /// \param result_callback callback function to call with the
+        ///                        statuses.
+        /// \return true if the request was sent successfully.
+        auto transaction_status(std::vector<hash_t> tx_ids,
+                                status_result_callback_type result_callback)
+            -> bool override;
+
       private:
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
@@ -18,4 +18,34 @@ namespace cbdc {
         -> serializer& {
         return packet >> r.m_tx_status >> r.m_tx_error;
     }
+
+    auto operator<<(serializer& packet,
+                    const sentinel::validate_batch_request& r) -> serializer& {
+        return packet << r.m_txs;
+    }
+
+    auto operator>>(serializer& packet, sentinel::validate_batch_request& r)
+        -> serializer& {
+        return packet >> r.m_txs;
+    }
+
+    auto operator<<(serializer& packet, const sentinel::submit_response& r)
+        -> serializer& {
+        return packet << r.m_tx_id << r.m_result;
+    }
+
+    auto operator>>(serializer& packet, sentinel::submit_response& r)
+        -> serializer& {
+        return packet >> r.m_tx_id >> r.m_result;
+    }
+
+    auto operator<<(serializer& packet, const sentinel::status_request& r)
+        -> serializer& {
+        return packet << r.m_tx_ids;
+    }
+
+    auto operator>>(serializer& packet, sentinel::status_request& r)
+        -> serializer& {
+        return packet >> r.m_tx_ids;
+    }
 }
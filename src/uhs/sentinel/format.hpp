@@ -13,6 +13,21 @@ namespace cbdc {
         -> serializer&;
     auto operator>>(serializer& packet, sentinel::execute_response& r)
         -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const sentinel::validate_batch_request& r) -> serializer&;
+    auto operator>>(serializer& packet, sentinel::validate_batch_request& r)
+        -> serializer&;
+
+    auto operator<<(serializer& packet, const sentinel::submit_response& r)
+        -> serializer&;
+    auto operator>>(serializer& packet, sentinel::submit_response& r)
+        -> serializer&;
+
+    auto operator<<(serializer& packet, const sentinel::status_request& r)
+        -> serializer&;
+    auto operator>>(serializer& packet, sentinel::status_request& r)
+        -> serializer&;
 }
 
 #endif // OPENCBDC_TX_SRC_SENTINEL_FORMAT_H_
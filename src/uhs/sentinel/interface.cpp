@@ -12,6 +12,12 @@ namespace cbdc::sentinel {
             == std::tie(rhs.m_tx_status, rhs.m_tx_error);
     }
 
+    auto submit_response::operator==(const submit_response& rhs) const
+        -> bool {
+        return std::tie(m_tx_id, m_result)
+            == std::tie(rhs.m_tx_id, rhs.m_result);
+    }
+
     auto to_string(tx_status status) -> std::string {
         auto ret = std::string();
         switch(status) {
@@ -65,12 +65,58 @@ namespace cbdc::sentinel {
     /// the given transaction.
     using validate_response = transaction::sentinel_attestation;
 
-    /// Sentinel RPC request type. Either a transaction execution or validation
-    /// request.
-    using request = std::variant<execute_request, validate_request>;
-    /// Sentinel RPC response type. Either a transaction execution or
-    /// validation response.
-    using response = std::variant<execute_response, validate_response>;
+    /// Request type for validating and attesting to several transactions
+    /// in one message.
+    struct validate_batch_request {
+        /// Transactions to validate and attest to.
+        std::vector<transaction::full_tx> m_txs;
+    };
+    /// Response type from batch validation. An attestation for each
+    /// transaction in request order, or std::nullopt for each transaction
+    /// which was invalid.
+    using validate_batch_response
+        = std::vector<std::optional<validate_response>>;
+
+    /// Request type for submitting a transaction without waiting for its
+    /// execution result. The sentinel responds once the transaction has
+    /// been statically validated.
+    struct submit_request : transaction::full_tx {};
+
+    /// Response type from transaction submission.
+    struct submit_response {
+        /// ID of the transaction, with which to poll for its result.
+        hash_t m_tx_id{};
+        /// Status of the transaction when accepted. Pending if the
+        /// sentinel is executing the transaction, otherwise its result.
+        execute_response m_result;
+
+        auto operator==(const submit_response& rhs) const -> bool;
+    };
+
+    /// Request type for polling the results of submitted transactions.
+    struct status_request {
+        /// IDs of the transactions to report on.
+        std::vector<hash_t> m_tx_ids;
+    };
+    /// Response type from polling transaction results. The status of each
+    /// transaction in request order, pending while it executes, or
+    /// std::nullopt if the sentinel has no record of the transaction.
+    using status_response = std::vector<std::optional<execute_response>>;
+
+    /// Sentinel RPC request type. Either a transaction execution,
+    /// validation, batch validation, submission or status request.
+    using request = std::variant<execute_request,
+                                 validate_request,
+                                 validate_batch_request,
+                                 submit_request,
+                                 status_request>;
+    /// Sentinel RPC response type. Either a transaction execution,
+    /// validation, batch validation, submission or status response.
+    using response = std::variant<execute_response,
+                                  validate_response,
+                                  validate_batch_response,
+                                  submit_response,
+                                  status_response>;
 
     /// Interface for a sentinel.
     class interface {
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "trace.hpp"
+
+#include "uhs/transaction/messages.hpp"
+
+namespace cbdc::sentinel {
+    namespace {
+        /// Identifies a trace file and its format version: "cbdctrc" then
+        /// version 1.
+        constexpr uint64_t trace_magic = 0x6362646374726301;
+    }
+
+    trace_writer::trace_writer(const std::string& path)
+        : m_out(path, std::ios::out | std::ios::trunc | std::ios::binary),
+          m_ser(m_out),
+          m_start(std::chrono::steady_clock::now()) {
+        m_ser << trace_magic;
+    }
+
+    trace_writer::~trace_writer() {
+        std::unique_lock<std::mutex> l(m_mut);
+        m_out.flush();
+    }
+
+    auto trace_writer::good() -> bool {
+        std::unique_lock<std::mutex> l(m_mut);
+        return m_out.good() && static_cast<bool>(m_ser);
+    }
+
+    void trace_writer::append(const transaction::full_tx& tx) {
+        const auto offset
+            = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start);
+        std::unique_lock<std::mutex> l(m_mut);
+        m_ser << static_cast<uint64_t>(offset.count()) << tx;
+    }
+
+    trace_reader::trace_reader(const std::string& path)
+        : m_in(path, std::ios::in | std::ios::binary),
+          m_deser(m_in) {
+        uint64_t magic{};
+        m_good = m_in.good() && (m_deser >> magic) && magic == trace_magic;
+    }
+
+    auto trace_reader::good() const -> bool {
+        return m_good;
+    }
+
+    auto trace_reader::next() -> std::optional<trace_record> {
+        if(!m_good || m_in.peek() == std::ifstream::traits_type::eof()) {
+            return std::nullopt;
+        }
+        auto ret = trace_record();
+        if(!(m_deser >> ret.m_offset_ns >> ret.m_tx)) {
+            m_good = false;
+            return std::nullopt;
+        }
+        return ret;
+    }
+}
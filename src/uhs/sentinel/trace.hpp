@@ -0,0 +1,88 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_SENTINEL_TRACE_H_
+#define OPENCBDC_TX_SRC_SENTINEL_TRACE_H_
+
+#include "uhs/transaction/transaction.hpp"
+#include "util/serialization/istream_serializer.hpp"
+#include "util/serialization/ostream_serializer.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace cbdc::sentinel {
+    /// Transaction a sentinel received, with the time it arrived.
+    struct trace_record {
+        /// Nanoseconds between the start of the capture and the arrival of
+        /// the transaction.
+        uint64_t m_offset_ns{};
+        /// Transaction as the client sent it.
+        transaction::full_tx m_tx;
+    };
+
+    /// \brief Records the transactions a sentinel receives to a trace file.
+    ///
+    /// The file starts with a format identifier, followed by one record
+    /// per transaction in arrival order: the offset of its arrival from
+    /// when the writer was opened, then the serialized transaction. Writes
+    /// are buffered, so recording adds no system call per transaction.
+    class trace_writer {
+      public:
+        /// Constructor. Creates or truncates the trace file.
+        /// \param path file to write.
+        explicit trace_writer(const std::string& path);
+
+        /// Flushes buffered records and closes the file.
+        ~trace_writer();
+
+        trace_writer(const trace_writer&) = delete;
+        auto operator=(const trace_writer&) -> trace_writer& = delete;
+        trace_writer(trace_writer&&) = delete;
+        auto operator=(trace_writer&&) -> trace_writer& = delete;
+
+        /// Indicates whether the file is open and every record so far was
+        /// written.
+        /// \return true if the trace is intact.
+        [[nodiscard]] auto good() -> bool;
+
+        /// Records a transaction as arriving now. Thread safe.
+        /// \param tx transaction received.
+        void append(const transaction::full_tx& tx);
+
+      private:
+        std::mutex m_mut;
+        std::ofstream m_out;
+        ostream_serializer m_ser;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /// Reads the records of a trace file written by \ref trace_writer.
+    class trace_reader {
+      public:
+        /// Constructor. Opens the trace file and checks its format.
+        /// \param path file to read.
+        explicit trace_reader(const std::string& path);
+
+        /// Indicates whether the file was opened and is a trace.
+        /// \return true if records can be read.
+        [[nodiscard]] auto good() const -> bool;
+
+        /// Reads the next record.
+        /// \return the record, or std::nullopt at the end of the trace or
+        ///         if the record is truncated.
+        auto next() -> std::optional<trace_record>;
+
+      private:
+        std::ifstream m_in;
+        istream_serializer m_deser;
+        bool m_good{false};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_SENTINEL_TRACE_H_
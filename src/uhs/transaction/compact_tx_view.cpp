@@ -0,0 +1,191 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compact_tx_view.hpp"
+
+#include "crypto/sha256.h"
+
+#include <cstring>
+
+namespace cbdc::transaction {
+    namespace {
+        constexpr size_t count_size = sizeof(uint64_t);
+        constexpr size_t attestation_size
+            = sizeof(pubkey_t) + sizeof(signature_t);
+
+        // Reads the count at offset and checks that count items of the
+        // given size follow it. Advances offset past the items.
+        auto read_count(const unsigned char* data,
+                        size_t len,
+                        size_t& offset,
+                        size_t item_size) -> std::optional<size_t> {
+            if(len - offset < count_size) {
+                return std::nullopt;
+            }
+            uint64_t count{};
+            std::memcpy(&count, &data[offset], count_size);
+            offset += count_size;
+            if(count > (len - offset) / item_size) {
+                return std::nullopt;
+            }
+            offset += static_cast<size_t>(count) * item_size;
+            return static_cast<size_t>(count);
+        }
+    }
+
+    auto compact_tx_view::parse(const unsigned char* data, size_t len)
+        -> std::optional<compact_tx_view> {
+        auto ret = compact_tx_view();
+        ret.m_data = data;
+        if(len < sizeof(hash_t)) {
+            return std::nullopt;
+        }
+        size_t offset = sizeof(hash_t);
+
+        auto n_in = read_count(data, len, offset, sizeof(hash_t));
+        if(!n_in) {
+            return std::nullopt;
+        }
+        ret.m_input_count = *n_in;
+
+        ret.m_outputs_offset = offset;
+        auto n_out = read_count(data, len, offset, sizeof(hash_t));
+        if(!n_out) {
+            return std::nullopt;
+        }
+        ret.m_output_count = *n_out;
+
+        ret.m_attestations_offset = offset;
+        if(len - offset >= count_size) {
+            uint64_t marker{};
+            std::memcpy(&marker, &data[offset], count_size);
+            if(marker == aggregate_attestation_marker) {
+                // Signer bits, then the nonces, then the s value
+                offset += count_size;
+                if(len - offset < sizeof(uint64_t)) {
+                    return std::nullopt;
+                }
+                offset += sizeof(uint64_t);
+                if(!read_count(data, len, offset, sizeof(hash_t))
+                   || len - offset < sizeof(hash_t)) {
+                    return std::nullopt;
+                }
+                ret.m_aggregate = true;
+                ret.m_size = offset + sizeof(hash_t);
+                return ret;
+            }
+        }
+        auto n_att = read_count(data, len, offset, attestation_size);
+        if(!n_att) {
+            return std::nullopt;
+        }
+        ret.m_attestation_count = *n_att;
+        ret.m_size = offset;
+        return ret;
+    }
+
+    auto compact_tx_view::parse(const buffer& buf)
+        -> std::optional<compact_tx_view> {
+        return parse(buf.c_ptr(), buf.size());
+    }
+
+    auto compact_tx_view::id() const -> hash_t {
+        return hash_at(0);
+    }
+
+    auto compact_tx_view::input_count() const -> size_t {
+        return m_input_count;
+    }
+
+    auto compact_tx_view::input(size_t i) const -> hash_t {
+        return hash_at(sizeof(hash_t) + count_size + i * sizeof(hash_t));
+    }
+
+    auto compact_tx_view::output_count() const -> size_t {
+        return m_output_count;
+    }
+
+    auto compact_tx_view::output(size_t i) const -> hash_t {
+        return hash_at(m_outputs_offset + count_size + i * sizeof(hash_t));
+    }
+
+    auto compact_tx_view::attestation_count() const -> size_t {
+        return m_attestation_count;
+    }
+
+    auto compact_tx_view::attestation(size_t i) const -> sentinel_attestation {
+        const auto* att
+            = &m_data[m_attestations_offset + count_size
+                      + i * attestation_size];
+        auto ret = sentinel_attestation();
+        std::memcpy(ret.first.data(), att, ret.first.size());
+        std::memcpy(ret.second.data(),
+                    &att[ret.first.size()],
+                    ret.second.size());
+        return ret;
+    }
+
+    auto compact_tx_view::aggregate() const
+        -> std::optional<aggregate_attestation> {
+        if(!m_aggregate) {
+            return std::nullopt;
+        }
+        auto ret = aggregate_attestation();
+        auto offset = m_attestations_offset + count_size;
+        std::memcpy(&ret.m_signers, &m_data[offset], sizeof(ret.m_signers));
+        offset += sizeof(ret.m_signers);
+        uint64_t n{};
+        std::memcpy(&n, &m_data[offset], count_size);
+        offset += count_size;
+        ret.m_nonces.resize(static_cast<size_t>(n));
+        for(auto& r : ret.m_nonces) {
+            r = hash_at(offset);
+            offset += r.size();
+        }
+        ret.m_s = hash_at(offset);
+        return ret;
+    }
+
+    auto compact_tx_view::hash() const -> hash_t {
+        // The serialized transaction up to the attestations, followed by
+        // an empty attestation count, as in compact_tx::hash.
+        auto sha = CSHA256();
+        sha.Write(m_data, m_attestations_offset);
+        std::array<unsigned char, count_size> no_attestations{};
+        sha.Write(no_attestations.data(), no_attestations.size());
+        auto ret = hash_t();
+        sha.Finalize(ret.data());
+        return ret;
+    }
+
+    auto compact_tx_view::size() const -> size_t {
+        return m_size;
+    }
+
+    auto compact_tx_view::to_compact_tx() const -> compact_tx {
+        auto ret = compact_tx();
+        ret.m_id = id();
+        ret.m_inputs.resize(m_input_count);
+        for(size_t i = 0; i < m_input_count; i++) {
+            ret.m_inputs[i] = input(i);
+        }
+        ret.m_uhs_outputs.resize(m_output_count);
+        for(size_t i = 0; i < m_output_count; i++) {
+            ret.m_uhs_outputs[i] = output(i);
+        }
+        ret.m_attestations.reserve(m_attestation_count);
+        for(size_t i = 0; i < m_attestation_count; i++) {
+            ret.m_attestations.insert(attestation(i));
+        }
+        ret.m_aggregate = aggregate();
+        return ret;
+    }
+
+    auto compact_tx_view::hash_at(size_t offset) const -> hash_t {
+        auto ret = hash_t();
+        std::memcpy(ret.data(), &m_data[offset], ret.size());
+        return ret;
+    }
+}
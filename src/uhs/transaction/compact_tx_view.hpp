@@ -0,0 +1,106 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_TRANSACTION_COMPACT_TX_VIEW_H_
+#define OPENCBDC_TX_SRC_TRANSACTION_COMPACT_TX_VIEW_H_
+
+#include "transaction.hpp"
+#include "util/common/buffer.hpp"
+
+#include <optional>
+
+namespace cbdc::transaction {
+    /// \brief Read-only view of a serialized \ref compact_tx.
+    ///
+    /// Points into the bytes written by
+    /// \ref cbdc::operator<<(serializer&, const transaction::compact_tx&),
+    /// so a received transaction can be checked without deserializing it.
+    /// Offsets are validated once by \ref parse. The view does not own the
+    /// bytes, which must outlive it.
+    class compact_tx_view {
+      public:
+        /// Parses a view of the compact transaction at the start of the
+        /// given bytes.
+        /// \param data serialized compact transaction.
+        /// \param len number of bytes available.
+        /// \return view, or std::nullopt if the bytes are too short for the
+        ///         counts they encode.
+        static auto parse(const unsigned char* data, size_t len)
+            -> std::optional<compact_tx_view>;
+
+        /// Parses a view of the compact transaction in the given buffer.
+        /// \param buf buffer starting with a serialized compact transaction.
+        /// \return see \ref parse.
+        static auto parse(const buffer& buf) -> std::optional<compact_tx_view>;
+
+        /// Returns the transaction ID.
+        /// \return transaction ID.
+        [[nodiscard]] auto id() const -> hash_t;
+
+        /// Returns the number of input hashes.
+        /// \return input count.
+        [[nodiscard]] auto input_count() const -> size_t;
+
+        /// Returns an input hash.
+        /// \param i index of the input.
+        /// \return hash of the input.
+        [[nodiscard]] auto input(size_t i) const -> hash_t;
+
+        /// Returns the number of output UHS IDs.
+        /// \return output count.
+        [[nodiscard]] auto output_count() const -> size_t;
+
+        /// Returns an output UHS ID.
+        /// \param i index of the output.
+        /// \return UHS ID of the output.
+        [[nodiscard]] auto output(size_t i) const -> hash_t;
+
+        /// Returns the number of individual attestations, zero if the
+        /// transaction carries an aggregate attestation.
+        /// \return attestation count.
+        [[nodiscard]] auto attestation_count() const -> size_t;
+
+        /// Returns an attestation.
+        /// \param i index of the attestation.
+        /// \return attestation.
+        [[nodiscard]] auto attestation(size_t i) const
+            -> sentinel_attestation;
+
+        /// Returns the aggregate attestation, if the transaction carries one
+        /// in place of individual attestations.
+        /// \return aggregate attestation, or std::nullopt.
+        [[nodiscard]] auto aggregate() const
+            -> std::optional<aggregate_attestation>;
+
+        /// Returns the hash that sentinels sign, equal to
+        /// \ref compact_tx::hash, computed from the serialized bytes.
+        /// \return compact transaction hash.
+        [[nodiscard]] auto hash() const -> hash_t;
+
+        /// Returns the number of bytes the transaction occupies.
+        /// \return serialized size.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Deserializes the viewed transaction.
+        /// \return compact transaction.
+        [[nodiscard]] auto to_compact_tx() const -> compact_tx;
+
+      private:
+        compact_tx_view() = default;
+
+        [[nodiscard]] auto hash_at(size_t offset) const -> hash_t;
+
+        const unsigned char* m_data{};
+        size_t m_input_count{};
+        size_t m_output_count{};
+        size_t m_attestation_count{};
+        bool m_aggregate{false};
+        size_t m_outputs_offset{};
+        size_t m_attestations_offset{};
+        size_t m_size{};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_TRANSACTION_COMPACT_TX_VIEW_H_
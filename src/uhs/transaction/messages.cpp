@@ -52,14 +52,50 @@ namespace cbdc {
 
     auto operator<<(serializer& packet, const transaction::compact_tx& tx)
         -> serializer& {
-        return packet << tx.m_id << tx.m_inputs << tx.m_uhs_outputs
-                      << tx.m_attestations;
+        packet << tx.m_id << tx.m_inputs << tx.m_uhs_outputs;
+        if(tx.m_aggregate.has_value()) {
+            return packet << transaction::aggregate_attestation_marker
+                          << tx.m_aggregate.value();
+        }
+        return packet << tx.m_attestations;
     }
 
     auto operator>>(serializer& packet, transaction::compact_tx& tx)
         -> serializer& {
-        return packet >> tx.m_id >> tx.m_inputs >> tx.m_uhs_outputs
-            >> tx.m_attestations;
+        packet >> tx.m_id >> tx.m_inputs >> tx.m_uhs_outputs;
+        tx.m_attestations.clear();
+        tx.m_aggregate.reset();
+        auto len = uint64_t();
+        if(!(packet >> len)) {
+            return packet;
+        }
+        if(len == transaction::aggregate_attestation_marker) {
+            auto agg = transaction::aggregate_attestation();
+            if(packet >> agg) {
+                tx.m_aggregate = std::move(agg);
+            }
+            return packet;
+        }
+        // As for the attestation set's own format, repeated keys are ignored
+        for(uint64_t i{0}; i < len; i++) {
+            auto att = transaction::sentinel_attestation();
+            if(!(packet >> att)) {
+                return packet;
+            }
+            tx.m_attestations.insert(att);
+        }
+        return packet;
+    }
+
+    auto operator<<(serializer& packet,
+                    const transaction::aggregate_attestation& agg)
+        -> serializer& {
+        return packet << agg.m_signers << agg.m_nonces << agg.m_s;
+    }
+
+    auto operator>>(serializer& packet,
+                    transaction::aggregate_attestation& agg) -> serializer& {
+        return packet >> agg.m_signers >> agg.m_nonces >> agg.m_s;
     }
 
     auto operator>>(serializer& packet,
@@ -7,9 +7,12 @@
 #define OPENCBDC_TX_SRC_TRANSACTION_MESSAGES_H_
 
 #include "transaction.hpp"
+#include "util/serialization/format.hpp"
 #include "util/serialization/serializer.hpp"
 #include "validation.hpp"
 
+#include <cstddef>
+
 namespace cbdc {
     /// \brief Serializes an out_point.
     ///
@@ -51,6 +54,54 @@ namespace cbdc {
     auto operator>>(serializer& packet, transaction::input& inp)
         -> serializer&;
 
+    /// An out_point serializes to a transaction ID and an index.
+    template<>
+    struct fixed_serialized_size<transaction::out_point>
+        : std::integral_constant<size_t,
+                                 fixed_serialized_size_v<hash_t>
+                                     + fixed_serialized_size_v<uint64_t>> {};
+
+    /// An output serializes to a commitment and a value.
+    template<>
+    struct fixed_serialized_size<transaction::output>
+        : std::integral_constant<size_t,
+                                 fixed_serialized_size_v<hash_t>
+                                     + fixed_serialized_size_v<uint64_t>> {};
+
+    /// An input serializes to an out_point and an output.
+    template<>
+    struct fixed_serialized_size<transaction::input>
+        : std::integral_constant<
+              size_t,
+              fixed_serialized_size_v<transaction::out_point>
+                  + fixed_serialized_size_v<transaction::output>> {};
+
+    /// Out_points are stored as they serialize, so vectors of them are
+    /// written and read in bulk.
+    template<>
+    struct is_bytewise_serializable<transaction::out_point>
+        : std::bool_constant<
+              has_bytewise_layout_v<transaction::out_point>
+              && offsetof(transaction::out_point, m_index)
+                     == sizeof(hash_t)> {};
+
+    /// Outputs are stored as they serialize.
+    template<>
+    struct is_bytewise_serializable<transaction::output>
+        : std::bool_constant<
+              has_bytewise_layout_v<transaction::output>
+              && offsetof(transaction::output, m_value) == sizeof(hash_t)> {};
+
+    /// Inputs are stored as they serialize when their members are.
+    template<>
+    struct is_bytewise_serializable<transaction::input>
+        : std::bool_constant<
+              has_bytewise_layout_v<transaction::input>
+              && is_bytewise_serializable_v<transaction::out_point>
+              && is_bytewise_serializable_v<transaction::output>
+              && offsetof(transaction::input, m_prevout_data)
+                     == sizeof(transaction::out_point)> {};
+
     /// \brief Serializes a full transaction.
     ///
     /// Serializes the inputs, then the outputs, and then the witnesses.
@@ -68,8 +119,10 @@ namespace cbdc {
 
     /// \brief Serializes a compact transaction.
     ///
-    /// Serializes the transaction id, then the input hashes,
-    /// and then the output hashes.
+    /// Serializes the transaction id, then the input hashes, then the
+    /// output hashes, and then either the attestations or
+    /// \ref transaction::aggregate_attestation_marker followed by the
+    /// aggregate attestation.
     /// \see \ref cbdc::operator<<(serializer&, const std::array<T, len>&)
     /// \see \ref cbdc::operator<<(serializer&, const std::vector<T>&)
     auto operator<<(serializer& packet, const transaction::compact_tx& tx)
@@ -80,6 +133,18 @@ namespace cbdc {
     auto operator>>(serializer& packet, transaction::compact_tx& tx)
         -> serializer&;
 
+    /// Serializes an aggregate attestation: the signer bits, then the
+    /// nonces, then the aggregate s value.
+    auto operator<<(serializer& packet,
+                    const transaction::aggregate_attestation& agg)
+        -> serializer&;
+
+    /// Deserializes an aggregate attestation.
+    /// \see \ref cbdc::operator<<(serializer&,
+    ///                        const transaction::aggregate_attestation&)
+    auto operator>>(serializer& packet,
+                    transaction::aggregate_attestation& agg) -> serializer&;
+
     /// Deserializes an input error.
     /// \see \ref cbdc::operator<<(serializer&,
     ///           const transaction::validation::input_error&)
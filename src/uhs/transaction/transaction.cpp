@@ -7,10 +7,63 @@
 
 #include "crypto/sha256.h"
 #include "messages.hpp"
+#include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
+#include <bitset>
+#include <secp256k1.h>
+
 namespace cbdc::transaction {
+    namespace {
+        /// Returns a SHA-256 state primed with a BIP-340 tag.
+        auto tagged_sha(const std::string& tag) -> CSHA256 {
+            auto tag_hash = hash_t();
+            CSHA256()
+                .Write(reinterpret_cast<const unsigned char*>(tag.data()),
+                       tag.size())
+                .Finalize(tag_hash.data());
+            auto ret = CSHA256();
+            ret.Write(tag_hash.data(), tag_hash.size());
+            ret.Write(tag_hash.data(), tag_hash.size());
+            return ret;
+        }
+
+        /// Computes the randomizer of each signer in a half-aggregate. The
+        /// first is one, and each other commits to every signer's nonce and
+        /// key up to its own, so no signer can cancel out another.
+        auto randomizers(const hash_t& payload,
+                         const aggregate_attestation& agg,
+                         const std::vector<const pubkey_t*>& signers)
+            -> std::vector<hash_t> {
+            auto ret = std::vector<hash_t>(signers.size());
+            ret[0].back() = 1;
+            auto sha = tagged_sha("HalfAgg/randomizer");
+            for(size_t i{0}; i < signers.size(); i++) {
+                sha.Write(agg.m_nonces[i].data(), agg.m_nonces[i].size());
+                sha.Write(signers[i]->data(), signers[i]->size());
+                sha.Write(payload.data(), payload.size());
+                if(i > 0) {
+                    auto z = sha;
+                    z.Finalize(ret[i].data());
+                }
+            }
+            return ret;
+        }
+
+        /// Parses an x-only key or nonce as the point with even y.
+        auto lift_x(const secp256k1_context* ctx,
+                    const hash_t& x,
+                    secp256k1_pubkey& out) -> bool {
+            std::array<unsigned char, sizeof(hash_t) + 1> buf{};
+            buf[0] = 2;
+            std::memcpy(&buf[1], x.data(), x.size());
+            return secp256k1_ec_pubkey_parse(ctx, &out, buf.data(), buf.size())
+                == 1;
+        }
+    }
+
     auto out_point::operator==(const out_point& rhs) const -> bool {
         return m_tx_id == rhs.m_tx_id && m_index == rhs.m_index;
     }
@@ -115,19 +168,51 @@ namespace cbdc::transaction {
         return ret;
     }
 
+    auto uhs_ids_from_outputs(const hash_t& entropy,
+                              const std::vector<output>& outputs)
+        -> compact_hashes {
+        auto ret = compact_hashes();
+        if(outputs.empty()) {
+            return ret;
+        }
+        ret.resize(outputs.size());
+
+        // Same preimage as uhs_id_from_output, one per output.
+        constexpr auto msg_len = fixed_serialized_size_v<hash_t>
+                               + fixed_serialized_size_v<uint64_t>
+                               + fixed_serialized_size_v<output>;
+        auto buf = cbdc::buffer();
+        buf.extend(msg_len * outputs.size());
+        auto ser = cbdc::buffer_serializer(buf);
+        for(uint64_t i = 0; i < outputs.size(); i++) {
+            ser << entropy << i << outputs[i];
+        }
+        hash_data_batch(buf.c_ptr(), msg_len, ret.size(), ret.data());
+        return ret;
+    }
+
     auto compact_tx::operator==(const compact_tx& tx) const noexcept -> bool {
         return m_id == tx.m_id;
     }
 
     compact_tx::compact_tx(const full_tx& tx) {
         m_id = tx_id(tx);
-        for(const auto& inp : tx.m_inputs) {
-            m_inputs.push_back(inp.hash());
-        }
-        for(uint64_t i = 0; i < tx.m_outputs.size(); i++) {
-            m_uhs_outputs.push_back(
-                uhs_id_from_output(m_id, i, tx.m_outputs[i]));
+        if(!tx.m_inputs.empty()) {
+            // Inputs serialize to a fixed size, so batch their hashes.
+            constexpr auto inp_len = fixed_serialized_size_v<input>;
+            auto buf = cbdc::buffer();
+            buf.extend(inp_len * tx.m_inputs.size());
+            auto ser = cbdc::buffer_serializer(buf);
+            for(const auto& inp : tx.m_inputs) {
+                ser << inp;
+            }
+            m_inputs.resize(tx.m_inputs.size());
+            hash_data_batch(buf.c_ptr(),
+                            inp_len,
+                            m_inputs.size(),
+                            m_inputs.data());
         }
+        m_uhs_outputs = uhs_ids_from_outputs(m_id, tx.m_outputs);
     }
 
     auto compact_tx::sign(secp256k1_context* ctx, const privkey_t& key) const
@@ -152,12 +237,22 @@ namespace cbdc::transaction {
     }
 
     auto compact_tx::hash() const -> hash_t {
-        // Don't include the attesations in the hash
-        auto ctx = *this;
-        ctx.m_attestations.clear();
-        auto buf = make_buffer(ctx);
+        // Hashes the serialized form with the attestations left out,
+        // without copying the transaction into a buffer.
         auto sha = CSHA256();
-        sha.Write(buf.c_ptr(), buf.size());
+        auto write_len = [&](uint64_t len) {
+            std::array<unsigned char, sizeof(len)> len_arr{};
+            std::memcpy(len_arr.data(), &len, sizeof(len));
+            sha.Write(len_arr.data(), len_arr.size());
+        };
+        sha.Write(m_id.data(), m_id.size());
+        for(const auto* hashes : {&m_inputs, &m_uhs_outputs}) {
+            write_len(hashes->size());
+            for(const auto& h : *hashes) {
+                sha.Write(h.data(), h.size());
+            }
+        }
+        write_len(0);
         auto ret = hash_t();
         sha.Finalize(ret.data());
         return ret;
@@ -181,4 +276,141 @@ namespace cbdc::transaction {
 
         return true;
     }
+
+    auto aggregate_attestation::operator==(
+        const aggregate_attestation& rhs) const -> bool {
+        return m_signers == rhs.m_signers && m_nonces == rhs.m_nonces
+            && m_s == rhs.m_s;
+    }
+
+    auto sorted_sentinel_keys(
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys)
+        -> std::vector<pubkey_t> {
+        auto ret = std::vector<pubkey_t>(pubkeys.begin(), pubkeys.end());
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    auto aggregate_attestations(const secp256k1_context* ctx,
+                                const hash_t& payload,
+                                const attestation_set& atts,
+                                const std::vector<pubkey_t>& keys)
+        -> std::optional<aggregate_attestation> {
+        static constexpr size_t max_signers
+            = std::numeric_limits<uint64_t>::digits;
+        if(atts.empty()) {
+            return std::nullopt;
+        }
+        // Attestations are sorted by key, so their order matches the bits
+        auto ret = aggregate_attestation();
+        auto signers = std::vector<const pubkey_t*>();
+        auto s_values = std::vector<hash_t>();
+        for(const auto& [key, sig] : atts) {
+            auto it = std::lower_bound(keys.begin(), keys.end(), key);
+            const auto idx = static_cast<size_t>(it - keys.begin());
+            if(it == keys.end() || *it != key || idx >= max_signers) {
+                return std::nullopt;
+            }
+            ret.m_signers |= uint64_t{1} << idx;
+            signers.push_back(&*it);
+            auto& r = ret.m_nonces.emplace_back();
+            std::memcpy(r.data(), sig.data(), r.size());
+            auto& s = s_values.emplace_back();
+            std::memcpy(s.data(), &sig[r.size()], s.size());
+        }
+
+        const auto z = randomizers(payload, ret, signers);
+        ret.m_s = s_values[0];
+        if(secp256k1_ec_seckey_verify(ctx, ret.m_s.data()) != 1) {
+            return std::nullopt;
+        }
+        for(size_t i{1}; i < s_values.size(); i++) {
+            if(secp256k1_ec_seckey_tweak_mul(ctx,
+                                             s_values[i].data(),
+                                             z[i].data())
+                   != 1
+               || secp256k1_ec_seckey_tweak_add(ctx,
+                                                ret.m_s.data(),
+                                                s_values[i].data())
+                      != 1) {
+                return std::nullopt;
+            }
+        }
+        return ret;
+    }
+
+    auto verify_aggregate(const secp256k1_context* ctx,
+                          const hash_t& payload,
+                          const aggregate_attestation& agg,
+                          const std::vector<pubkey_t>& keys) -> bool {
+        const auto bits = std::bitset<std::numeric_limits<uint64_t>::digits>(
+            agg.m_signers);
+        if(bits.none() || agg.m_nonces.size() != bits.count()) {
+            return false;
+        }
+        auto signers = std::vector<const pubkey_t*>();
+        for(size_t i{0}; i < bits.size(); i++) {
+            if(!bits[i]) {
+                continue;
+            }
+            if(i >= keys.size()) {
+                return false;
+            }
+            signers.push_back(&keys[i]);
+        }
+
+        // Each signature satisfies s_i*G = R_i + e_i*P_i, so their
+        // weighted sum satisfies s*G = sum(z_i*R_i + z_i*e_i*P_i).
+        const auto z = randomizers(payload, agg, signers);
+        auto points = std::vector<secp256k1_pubkey>(signers.size() * 2);
+        for(size_t i{0}; i < signers.size(); i++) {
+            auto& r = points[i * 2];
+            auto& p = points[i * 2 + 1];
+            auto e = hash_t();
+            tagged_sha("BIP0340/challenge")
+                .Write(agg.m_nonces[i].data(), agg.m_nonces[i].size())
+                .Write(signers[i]->data(), signers[i]->size())
+                .Write(payload.data(), payload.size())
+                .Finalize(e.data());
+            if(!lift_x(ctx, agg.m_nonces[i], r) || !lift_x(ctx, *signers[i], p)
+               || secp256k1_ec_seckey_verify(ctx, e.data()) != 1) {
+                return false;
+            }
+            if(i > 0
+               && (secp256k1_ec_pubkey_tweak_mul(ctx, &r, z[i].data()) != 1
+                   || secp256k1_ec_seckey_tweak_mul(ctx, e.data(), z[i].data())
+                          != 1)) {
+                return false;
+            }
+            if(secp256k1_ec_pubkey_tweak_mul(ctx, &p, e.data()) != 1) {
+                return false;
+            }
+        }
+
+        auto terms = std::vector<const secp256k1_pubkey*>();
+        terms.reserve(points.size());
+        for(const auto& pt : points) {
+            terms.push_back(&pt);
+        }
+        secp256k1_pubkey sum{};
+        secp256k1_pubkey expected{};
+        if(secp256k1_ec_pubkey_combine(ctx, &sum, terms.data(), terms.size())
+               != 1
+           || secp256k1_ec_pubkey_create(ctx, &expected, agg.m_s.data())
+                  != 1) {
+            return false;
+        }
+        using point_bytes = std::array<unsigned char, sizeof(hash_t) + 1>;
+        auto serialize = [&](const secp256k1_pubkey& pt) {
+            auto ret = point_bytes();
+            auto len = ret.size();
+            secp256k1_ec_pubkey_serialize(ctx,
+                                          ret.data(),
+                                          &len,
+                                          &pt,
+                                          SECP256K1_EC_COMPRESSED);
+            return ret;
+        };
+        return serialize(sum) == serialize(expected);
+    }
 }
@@ -8,12 +8,16 @@
 
 #include "crypto/sha256.h"
 #include "util/common/hash.hpp"
+#include "util/common/hashmap.hpp"
 #include "util/common/keys.hpp"
+#include "util/common/small_flat_map.hpp"
+#include "util/common/small_vector.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
 #include <cstdint>
 #include <optional>
+#include <unordered_set>
 
 namespace cbdc::transaction {
     /// \brief The unique identifier of a specific \ref output from
@@ -108,6 +112,50 @@ namespace cbdc::transaction {
     /// a compact transaction hash.
     using sentinel_attestation = std::pair<pubkey_t, signature_t>;
 
+    /// Number of input or output hashes a compact transaction stores
+    /// without a heap allocation.
+    static constexpr size_t compact_tx_inline_hashes = 4;
+
+    /// Number of attestations a compact transaction stores without a heap
+    /// allocation.
+    static constexpr size_t compact_tx_inline_attestations = 2;
+
+    /// Hashes of a compact transaction's inputs or outputs.
+    using compact_hashes = small_vector<hash_t, compact_tx_inline_hashes>;
+
+    /// Sentinel attestations of a compact transaction, sorted by public
+    /// key.
+    using attestation_set = small_flat_map<pubkey_t,
+                                           signature_t,
+                                           compact_tx_inline_attestations>;
+
+    /// \brief Sentinel attestations combined into one signature.
+    ///
+    /// Schnorr half-aggregation of the signers' BIP-340 signatures over
+    /// the same compact transaction hash. Signers are named by position in
+    /// the configured sentinel keys, so a pubkey costs one bit rather than
+    /// 32 bytes, and the signatures' s values are summed into one scalar.
+    /// \see \ref aggregate_attestations
+    struct aggregate_attestation {
+        /// Bit i is set if the sentinel with the i-th lowest configured
+        /// public key signed.
+        uint64_t m_signers{};
+        /// Nonce commitment (r value) of each signer's signature, in the
+        /// order of m_signers.
+        small_vector<hash_t, compact_tx_inline_attestations> m_nonces;
+        /// Sum of the signers' s values, each weighted by its
+        /// randomizer.
+        hash_t m_s{};
+
+        auto operator==(const aggregate_attestation& rhs) const -> bool;
+    };
+
+    /// Attestation count that, in a serialized compact transaction, marks
+    /// an \ref aggregate_attestation in place of the attestation list. No
+    /// real count is this large, so earlier encodings parse unchanged.
+    static constexpr uint64_t aggregate_attestation_marker{uint64_t{1}
+                                                          << 63U};
+
     /// \brief A condensed, hash-only transaction representation
     ///
     /// The minimum amount of data necessary for the transaction processor to
@@ -119,14 +167,17 @@ namespace cbdc::transaction {
         hash_t m_id{};
 
         /// The set of hashes of the transaction's inputs
-        std::vector<hash_t> m_inputs;
+        compact_hashes m_inputs;
 
         /// The set of hashes of the new outputs created in the transaction
-        std::vector<hash_t> m_uhs_outputs;
+        compact_hashes m_uhs_outputs;
 
         /// Signatures from sentinels attesting the compact TX is valid.
-        std::unordered_map<pubkey_t, signature_t, hashing::null>
-            m_attestations;
+        attestation_set m_attestations;
+
+        /// Sentinel signatures combined into one, in place of
+        /// m_attestations.
+        std::optional<aggregate_attestation> m_aggregate;
 
         /// Equality of two compact transactions. Only compares the transaction
         /// IDs.
@@ -163,6 +214,41 @@ namespace cbdc::transaction {
         [[nodiscard]] auto hash() const -> hash_t;
     };
 
+    /// Returns configured sentinel public keys in ascending order, the
+    /// order of bits in \ref aggregate_attestation::m_signers.
+    /// \param pubkeys sentinel public keys.
+    /// \return sorted public keys.
+    auto sorted_sentinel_keys(
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys)
+        -> std::vector<pubkey_t>;
+
+    /// Half-aggregates BIP-340 attestations over the same compact
+    /// transaction hash into one \ref aggregate_attestation.
+    /// \param ctx secp256k1 context.
+    /// \param payload compact transaction hash the attestations sign.
+    /// \param atts attestations to aggregate.
+    /// \param keys sentinel public keys, from \ref sorted_sentinel_keys.
+    /// \return aggregate attestation, or std::nullopt if an attestation's
+    ///         key is not among the first 64 keys or its signature is
+    ///         malformed.
+    auto aggregate_attestations(const secp256k1_context* ctx,
+                                const hash_t& payload,
+                                const attestation_set& atts,
+                                const std::vector<pubkey_t>& keys)
+        -> std::optional<aggregate_attestation>;
+
+    /// Verifies an aggregate attestation with one combined check: s*G must
+    /// equal the sum over signers of z_i*R_i + z_i*e_i*P_i.
+    /// \param ctx secp256k1 context.
+    /// \param payload compact transaction hash the signers signed.
+    /// \param agg aggregate attestation.
+    /// \param keys sentinel public keys, from \ref sorted_sentinel_keys.
+    /// \return true if every signer named in the aggregate signed payload.
+    auto verify_aggregate(const secp256k1_context* ctx,
+                          const hash_t& payload,
+                          const aggregate_attestation& agg,
+                          const std::vector<pubkey_t>& keys) -> bool;
+
     struct compact_tx_hasher {
         auto operator()(compact_tx const& tx) const noexcept -> size_t;
     };
@@ -196,6 +282,15 @@ namespace cbdc::transaction {
     auto uhs_id_from_output(const hash_t& entropy,
                             uint64_t i,
                             const output& output) -> hash_t;
+
+    /// Calculates the UHS IDs of every output of a transaction, hashing
+    /// several outputs at once with \ref hash_data_batch.
+    /// \param entropy transaction ID of the outputs' transaction.
+    /// \param outputs outputs, by index.
+    /// \return UHS ID of each output, equal to \ref uhs_id_from_output.
+    auto uhs_ids_from_outputs(const hash_t& entropy,
+                              const std::vector<output>& outputs)
+        -> compact_hashes;
 }
 
 #endif // OPENCBDC_TX_SRC_TRANSACTION_TRANSACTION_H_
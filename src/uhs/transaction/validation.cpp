@@ -5,20 +5,37 @@
 
 #include "validation.hpp"
 
+#include "crypto/sha256.h"
+#include "messages.hpp"
 #include "transaction.hpp"
+#include "util/serialization/util.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <memory>
 #include <secp256k1.h>
 #include <secp256k1_schnorrsig.h>
 #include <set>
+#include <vector>
 
 namespace cbdc::transaction::validation {
-    static const auto secp_context
-        = std::unique_ptr<secp256k1_context,
-                          decltype(&secp256k1_context_destroy)>(
-            secp256k1_context_create(SECP256K1_CONTEXT_VERIFY),
-            &secp256k1_context_destroy);
+    /// Verifies an attestation's signature over a compact transaction hash.
+    static auto verify_attestation(const hash_t& payload,
+                                   const sentinel_attestation& att) -> bool {
+        secp256k1_xonly_pubkey pubkey{};
+        if(secp256k1_xonly_pubkey_parse(secp_context().get(),
+                                        &pubkey,
+                                        att.first.data())
+           != 1) {
+            return false;
+        }
+        return secp256k1_schnorrsig_verify(secp_context().get(),
+                                           att.second.data(),
+                                           payload.data(),
+                                           &pubkey)
+            == 1;
+    }
 
     auto input_error::operator==(const input_error& rhs) const -> bool {
         return std::tie(m_code, m_data_err, m_idx)
@@ -62,8 +79,50 @@ namespace cbdc::transaction::validation {
             return in_out_set_error;
         }
 
+        const auto witness_err = check_witnesses(tx);
+        if(witness_err) {
+            return witness_err;
+        }
+
+        return std::nullopt;
+    }
+
+    auto check_witnesses(const cbdc::transaction::full_tx& tx)
+        -> std::optional<tx_error> {
+        const auto sighash = cbdc::transaction::tx_id(tx);
+        auto verified = std::set<witness_t>();
+        auto check = [&](size_t idx) -> std::optional<witness_error_code> {
+            const auto& wit = tx.m_witness[idx];
+            if(wit.empty()) {
+                return witness_error_code::missing_witness_program_type;
+            }
+            if(static_cast<witness_program_type>(wit[0])
+               != witness_program_type::p2pk) {
+                return witness_error_code::unknown_witness_program_type;
+            }
+            const auto witness_len_err = check_p2pk_witness_len(tx, idx);
+            if(witness_len_err) {
+                return witness_len_err;
+            }
+            const auto witness_commitment_err
+                = check_p2pk_witness_commitment(tx, idx);
+            if(witness_commitment_err) {
+                return witness_commitment_err;
+            }
+            if(verified.find(wit) != verified.end()) {
+                return std::nullopt;
+            }
+            const auto witness_sig_err
+                = check_p2pk_witness_signature(tx, idx, sighash);
+            if(witness_sig_err) {
+                return witness_sig_err;
+            }
+            verified.insert(wit);
+            return std::nullopt;
+        };
+
         for(size_t idx = 0; idx < tx.m_witness.size(); idx++) {
-            const auto witness_err = check_witness(tx, idx);
+            const auto witness_err = check(idx);
             if(witness_err) {
                 return tx_error{witness_error{witness_err.value(), idx}};
             }
@@ -207,6 +266,15 @@ namespace cbdc::transaction::validation {
     auto check_p2pk_witness_signature(const cbdc::transaction::full_tx& tx,
                                       size_t idx)
         -> std::optional<witness_error_code> {
+        return check_p2pk_witness_signature(tx,
+                                            idx,
+                                            cbdc::transaction::tx_id(tx));
+    }
+
+    auto check_p2pk_witness_signature(const cbdc::transaction::full_tx& tx,
+                                      size_t idx,
+                                      const hash_t& sighash)
+        -> std::optional<witness_error_code> {
         const auto& wit = tx.m_witness[idx];
         secp256k1_xonly_pubkey pubkey{};
 
@@ -216,20 +284,18 @@ namespace cbdc::transaction::validation {
         std::memcpy(pubkey_arr.data(),
                     &wit[sizeof(witness_program_type)],
                     sizeof(pubkey_arr));
-        if(secp256k1_xonly_pubkey_parse(secp_context.get(),
+        if(secp256k1_xonly_pubkey_parse(secp_context().get(),
                                         &pubkey,
                                         pubkey_arr.data())
            != 1) {
             return witness_error_code::invalid_public_key;
         }
 
-        const auto sighash = cbdc::transaction::tx_id(tx);
-
         std::array<unsigned char, sig_len> sig_arr{};
         std::memcpy(sig_arr.data(),
                     &wit[p2pk_witness_prog_len],
                     sizeof(sig_arr));
-        if(secp256k1_schnorrsig_verify(secp_context.get(),
+        if(secp256k1_schnorrsig_verify(secp_context().get(),
                                        sig_arr.data(),
                                        sighash.data(),
                                        &pubkey)
@@ -269,17 +335,54 @@ namespace cbdc::transaction::validation {
 
     auto check_input_set(const cbdc::transaction::full_tx& tx)
         -> std::optional<tx_error> {
-        std::set<cbdc::transaction::out_point> inps;
+        // Compares small input sets pairwise and sorts pointers to larger
+        // ones in a per-thread buffer, so checking a transaction does not
+        // allocate once the buffer has grown to the largest fan-in seen.
+        static constexpr size_t pairwise_threshold = 16;
+        const auto& inputs = tx.m_inputs;
+        const auto duplicate = [](size_t idx) {
+            return tx_error{input_error{input_error_code::duplicate,
+                                        std::nullopt,
+                                        idx}};
+        };
+
+        if(inputs.size() <= pairwise_threshold) {
+            for(size_t idx = 1; idx < inputs.size(); idx++) {
+                for(size_t prev = 0; prev < idx; prev++) {
+                    if(inputs[prev].m_prevout == inputs[idx].m_prevout) {
+                        return duplicate(idx);
+                    }
+                }
+            }
+            return std::nullopt;
+        }
 
-        for(size_t idx = 0; idx < tx.m_inputs.size(); idx++) {
-            const auto& inp = tx.m_inputs[idx];
-            const auto it = inps.find(inp.m_prevout);
-            if(it != inps.end()) {
-                return tx_error{input_error{input_error_code::duplicate,
-                                            std::nullopt,
-                                            idx}};
+        thread_local std::vector<std::pair<const out_point*, size_t>> sorted;
+        sorted.clear();
+        sorted.reserve(inputs.size());
+        for(size_t idx = 0; idx < inputs.size(); idx++) {
+            sorted.emplace_back(&inputs[idx].m_prevout, idx);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) {
+            if(*a.first == *b.first) {
+                return a.second < b.second;
             }
-            inps.insert(inp.m_prevout);
+            return *a.first < *b.first;
+        });
+
+        // The first duplicate in input order is the earliest second
+        // occurrence of any repeated prevout.
+        auto first_dup = std::optional<size_t>();
+        for(size_t i = 1; i < sorted.size(); i++) {
+            if(*sorted[i].first == *sorted[i - 1].first
+               && (i < 2 || !(*sorted[i - 2].first == *sorted[i].first))) {
+                if(!first_dup.has_value() || sorted[i].second < *first_dup) {
+                    first_dup = sorted[i].second;
+                }
+            }
+        }
+        if(first_dup.has_value()) {
+            return duplicate(*first_dup);
         }
 
         return std::nullopt;
@@ -404,19 +507,182 @@ namespace cbdc::transaction::validation {
         return str;
     }
 
+    /// Returns the attestation cache shared by the whole process.
+    static auto process_cache() -> attestation_cache& {
+        // About 100 bytes per entry including the queue and set nodes.
+        static constexpr size_t cache_size = 1 << 17;
+        static auto cache = attestation_cache(cache_size);
+        return cache;
+    }
+
+    /// Checks one attestation of a transaction whose signed hash is
+    /// payload, consulting and filling the cache.
+    static auto check_attestation(
+        const hash_t& payload,
+        const sentinel_attestation& att,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        attestation_cache& cache) -> bool {
+        if(pubkeys.find(att.first) == pubkeys.end()) {
+            return false;
+        }
+        auto key = attestation_cache::key(payload, att);
+        if(cache.contains(key)) {
+            return true;
+        }
+        if(!verify_attestation(payload, att)) {
+            return false;
+        }
+        cache.add(key);
+        return true;
+    }
+
+    /// Checks an aggregate attestation of a transaction whose signed hash
+    /// is payload, consulting and filling the cache.
+    static auto check_aggregate(
+        const hash_t& payload,
+        const aggregate_attestation& agg,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold,
+        attestation_cache& cache) -> bool {
+        if(agg.m_nonces.size() < threshold) {
+            return false;
+        }
+        const auto keys = sorted_sentinel_keys(pubkeys);
+        auto key = attestation_cache::key(payload, agg, keys);
+        if(cache.contains(key)) {
+            return true;
+        }
+        // verify_aggregate checks the nonce count against the signer bits
+        if(!verify_aggregate(secp_context().get(), payload, agg, keys)) {
+            return false;
+        }
+        cache.add(key);
+        return true;
+    }
+
+    attestation_cache::attestation_cache(size_t max_size) {
+        auto stripe_size = std::max<size_t>(max_size / stripe_count, 1);
+        for(auto& s : m_stripes) {
+            s = std::make_unique<stripe>(stripe_size);
+        }
+    }
+
+    auto attestation_cache::key(const hash_t& payload,
+                                const sentinel_attestation& att) -> hash_t {
+        auto sha = CSHA256();
+        sha.Write(payload.data(), payload.size());
+        sha.Write(att.first.data(), att.first.size());
+        sha.Write(att.second.data(), att.second.size());
+        auto ret = hash_t();
+        sha.Finalize(ret.data());
+        return ret;
+    }
+
+    auto attestation_cache::key(const hash_t& payload,
+                                const aggregate_attestation& agg,
+                                const std::vector<pubkey_t>& keys) -> hash_t {
+        auto buf = make_buffer(agg);
+        auto sha = CSHA256();
+        sha.Write(payload.data(), payload.size());
+        sha.Write(buf.c_ptr(), buf.size());
+        const auto max_signers = std::numeric_limits<uint64_t>::digits;
+        for(size_t i{0}; i < keys.size() && i < max_signers; i++) {
+            if((agg.m_signers >> i) & 1U) {
+                sha.Write(keys[i].data(), keys[i].size());
+            }
+        }
+        auto ret = hash_t();
+        sha.Finalize(ret.data());
+        return ret;
+    }
+
+    auto attestation_cache::contains(const hash_t& key) const -> bool {
+        return stripe_for(key).contains(key);
+    }
+
+    void attestation_cache::add(const hash_t& key) {
+        stripe_for(key).add(key);
+    }
+
+    auto attestation_cache::stripe_for(const hash_t& key) const -> stripe& {
+        // The stripe's hasher uses the leading bytes, so pick the stripe
+        // from the last one.
+        return *m_stripes[key.back() % stripe_count];
+    }
+
     auto check_attestations(
         const transaction::compact_tx& tx,
         const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
         size_t threshold) -> bool {
+        return check_attestations(tx, pubkeys, threshold, process_cache());
+    }
+
+    auto check_attestations(
+        const transaction::compact_tx& tx,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold,
+        attestation_cache& cache) -> bool {
+        if(tx.m_aggregate.has_value()) {
+            return tx.m_attestations.empty()
+                && check_aggregate(tx.hash(),
+                                   tx.m_aggregate.value(),
+                                   pubkeys,
+                                   threshold,
+                                   cache);
+        }
         if(tx.m_attestations.size() < threshold) {
             return false;
         }
 
+        const auto payload = tx.hash();
         return std::all_of(tx.m_attestations.begin(),
                            tx.m_attestations.end(),
                            [&](const auto& att) {
-                               return pubkeys.find(att.first) != pubkeys.end()
-                                   && tx.verify(secp_context.get(), att);
+                               return check_attestation(payload,
+                                                        att,
+                                                        pubkeys,
+                                                        cache);
                            });
     }
+
+    auto check_attestations(
+        const transaction::compact_tx_view& tx,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold) -> bool {
+        return check_attestations(tx, pubkeys, threshold, process_cache());
+    }
+
+    auto check_attestations(
+        const transaction::compact_tx_view& tx,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold,
+        attestation_cache& cache) -> bool {
+        if(auto agg = tx.aggregate()) {
+            return check_aggregate(tx.hash(),
+                                   agg.value(),
+                                   pubkeys,
+                                   threshold,
+                                   cache);
+        }
+        const auto n = tx.attestation_count();
+        if(n < threshold) {
+            return false;
+        }
+
+        const auto payload = tx.hash();
+        for(size_t i = 0; i < n; i++) {
+            auto att = tx.attestation(i);
+            // A serialized compact_tx never repeats a key, so bytes that do
+            // are rejected rather than letting one key count twice.
+            for(size_t j = 0; j < i; j++) {
+                if(tx.attestation(j).first == att.first) {
+                    return false;
+                }
+            }
+            if(!check_attestation(payload, att, pubkeys, cache)) {
+                return false;
+            }
+        }
+        return true;
+    }
 }
@@ -6,8 +6,12 @@
 #ifndef OPENCBDC_TX_SRC_TRANSACTION_VALIDATION_H_
 #define OPENCBDC_TX_SRC_TRANSACTION_VALIDATION_H_
 
+#include "compact_tx_view.hpp"
 #include "transaction.hpp"
+#include "util/common/cache_set.hpp"
+#include "util/common/hashmap.hpp"
 
+#include <array>
 #include <cassert>
 #include <memory>
 #include <optional>
@@ -140,6 +144,24 @@ namespace cbdc::transaction::validation {
     auto check_p2pk_witness_signature(const transaction::full_tx& tx,
                                       size_t idx)
         -> std::optional<witness_error_code>;
+    auto check_p2pk_witness_signature(const transaction::full_tx& tx,
+                                      size_t idx,
+                                      const hash_t& sighash)
+        -> std::optional<witness_error_code>;
+
+    /// \brief Checks every witness of a transaction
+    ///
+    /// Equivalent to calling \ref check_witness for each witness, but
+    /// computes the sighash once for the whole transaction, and verifies
+    /// each distinct p2pk witness only once. A p2pk witness holds the
+    /// public key and signature, and every witness signs the same sighash,
+    /// so identical witnesses have identical results. Wallets produce them
+    /// when spending several outputs paid to the same key.
+    ///
+    /// \param tx transaction whose witnesses to check
+    /// \return null if every witness is valid, otherwise the first error
+    auto check_witnesses(const transaction::full_tx& tx)
+        -> std::optional<tx_error>;
     auto check_input_count(const transaction::full_tx& tx)
         -> std::optional<tx_error>;
     auto check_output_count(const transaction::full_tx& tx)
@@ -153,17 +175,117 @@ namespace cbdc::transaction::validation {
     auto get_p2pk_witness_commitment(const pubkey_t& payee) -> hash_t;
     auto to_string(const tx_error& err) -> std::string;
 
+    /// \brief Bounded set of sentinel attestations already verified.
+    ///
+    /// Lets components in one process that check the same compact
+    /// transactions, such as co-located shards or a shard replaying its raft
+    /// log, skip repeating secp256k1 verification. Entries are keyed by the
+    /// signed payload, attesting public key and signature, and split across
+    /// independently locked stripes so concurrent checks rarely contend.
+    class attestation_cache {
+      public:
+        /// Number of independently locked stripes.
+        static constexpr size_t stripe_count = 16;
+
+        /// Constructor.
+        /// \param max_size maximum number of cached attestations.
+        explicit attestation_cache(size_t max_size);
+
+        /// Returns the cache key of an attestation.
+        /// \param payload compact transaction hash the attestation signs.
+        /// \param att attestation.
+        /// \return cache key.
+        static auto key(const hash_t& payload, const sentinel_attestation& att)
+            -> hash_t;
+
+        /// Returns the cache key of an aggregate attestation. Covers the
+        /// keys its signer bits name, since the bits alone depend on the
+        /// configured key set.
+        /// \param payload compact transaction hash the signers signed.
+        /// \param agg aggregate attestation.
+        /// \param keys sentinel public keys in ascending order.
+        /// \return cache key.
+        static auto key(const hash_t& payload,
+                        const aggregate_attestation& agg,
+                        const std::vector<pubkey_t>& keys) -> hash_t;
+
+        /// Checks whether an attestation was verified.
+        /// \param key cache key of the attestation.
+        /// \return true if the attestation is in the cache.
+        [[nodiscard]] auto contains(const hash_t& key) const -> bool;
+
+        /// Records a verified attestation, evicting the oldest entry in its
+        /// stripe if the stripe is full.
+        /// \param key cache key of the attestation.
+        void add(const hash_t& key);
+
+      private:
+        using stripe = cache_set<hash_t, hashing::null>;
+
+        [[nodiscard]] auto stripe_for(const hash_t& key) const -> stripe&;
+
+        std::array<std::unique_ptr<stripe>, stripe_count> m_stripes;
+    };
+
     /// Validates the sentinel attestations attached to a compact transaction.
+    /// A transaction with an aggregate attestation needs the aggregate to
+    /// name at least threshold signers and verify, and must carry no
+    /// individual attestations.
+    /// \param tx compact transaction to validate.
+    /// \param pubkeys set of public keys whose attestations will be accepted.
+    /// \param threshold number of attestations required for a transaction to
+    ///                  be considered valid.
+    /// \return true if the required number of unique attestations are attached
+    ///         to the compact transaction.
+    auto check_attestations(
+        const transaction::compact_tx& tx,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold) -> bool;
+
+    /// Validates the sentinel attestations attached to a compact
+    /// transaction, skipping signature verification for attestations in
+    /// the cache and adding newly verified ones to it. The other overload
+    /// uses a cache shared by the whole process.
     /// \param tx compact transaction to validate.
     /// \param pubkeys set of public keys whose attestations will be accepted.
     /// \param threshold number of attestations required for a transaction to
     ///                  be considered valid.
+    /// \param cache verified attestations.
     /// \return true if the required number of unique attestations are attached
     ///         to the compact transaction.
     auto check_attestations(
         const transaction::compact_tx& tx,
         const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold,
+        attestation_cache& cache) -> bool;
+
+    /// Validates the sentinel attestations of a serialized compact
+    /// transaction without deserializing it, using the process-wide cache.
+    /// Attestations repeating a public key are rejected, since no
+    /// serialized \ref transaction::compact_tx contains them.
+    /// \param tx view of the compact transaction to validate.
+    /// \param pubkeys set of public keys whose attestations will be accepted.
+    /// \param threshold number of attestations required for a transaction to
+    ///                  be considered valid.
+    /// \return true if the required number of unique attestations are attached
+    ///         to the compact transaction.
+    auto check_attestations(
+        const transaction::compact_tx_view& tx,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
         size_t threshold) -> bool;
+
+    /// Validates the attestations of a serialized compact transaction as
+    /// the other view overload, using the given cache.
+    /// \param tx view of the compact transaction to validate.
+    /// \param pubkeys set of public keys whose attestations will be accepted.
+    /// \param threshold number of attestations required.
+    /// \param cache verified attestations.
+    /// \return true if the attestations are valid.
+    auto check_attestations(
+        const transaction::compact_tx_view& tx,
+        const std::unordered_set<pubkey_t, hashing::null>& pubkeys,
+        size_t threshold,
+        attestation_cache& cache) -> bool;
 }
 
 #endif // OPENCBDC_TX_SRC_TRANSACTION_VALIDATION_H_
@@ -7,29 +7,28 @@
 
 #include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/validation.hpp"
+#include "util/common/hash.hpp"
+#include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/istream_serializer.hpp"
 #include "util/serialization/ostream_serializer.hpp"
-#include "util/oracle/oracleDB.h"
+#include "util/serialization/util.hpp"
 
+#include <filesystem>
 #include <secp256k1_schnorrsig.h>
 
-OracleDB db;
-
 namespace cbdc {
+    namespace {
+        /// Appended to a wallet file path to name its journal.
+        constexpr auto journal_suffix = ".journal";
+    }
+
     transaction::wallet::wallet() {
         auto seed = std::chrono::high_resolution_clock::now()
                         .time_since_epoch()
                         .count();
         seed %= std::numeric_limits<uint32_t>::max();
         m_shuffle.seed(static_cast<uint32_t>(seed));
-        if(OracleDB_init(&db) == 0) {
-            if(OracleDB_connect(&db) == 0) {
-                std::cout << "Connected to Oracle Autonomous Database" << std::endl;
-            }else{
-                std::cout << "Failed to connect to Oracle Autonomous Database" << std::endl;
-            }
-        }
     }
 
     auto transaction::wallet::mint_new_coins(const size_t n_outputs,
@@ -86,29 +85,14 @@ namespace cbdc {
             sign(ret);
         }
 
-        auto ctx = transaction::tx_id(ret);
-        std::string payee_str = std::string(payee.begin(), payee.end());
-
-        // adding DTX to Oracle Autonomous Database
-        std::string dtx_string = std::string(ctx.begin(), ctx.end());
-        std::string dtx_hex;
-        dtx_hex.reserve(2*dtx_string.size());
-
-        // convert dtx_string into a hex string
-        for (unsigned char c : dtx_string) {
-            dtx_hex.push_back("0123456789ABCDEF"[c >> 4]);
-            dtx_hex.push_back("0123456789ABCDEF"[c & 15]);
-        }
-        std::string dtx_hex_insert = "INSERT INTO admin.wallet (tx_hash, payee) VALUES ('" + dtx_hex + "', '" + payee_str + "')";
-
-        if(OracleDB_execute(&db, dtx_hex_insert.c_str()) != 0){
-            std::cout << "Wallet did not send" << std::endl;
+        if(m_send_observer) {
+            m_send_observer(transaction::tx_id(ret), payee);
         }
 
         return ret;
     }
 
-    auto transaction::wallet::create_seeded_transaction(size_t seed_idx)
+    auto transaction::wallet::create_seeded_transaction(size_t seed_idx) const
         -> std::optional<transaction::full_tx> {
         if(m_seed_from == m_seed_to) {
             return std::nullopt;
@@ -126,6 +110,44 @@ namespace cbdc {
         return tx;
     }
 
+    auto transaction::wallet::seeded_uhs_ids(size_t begin_seed,
+                                             size_t end_seed) const
+        -> std::vector<hash_t> {
+        auto tx = create_seeded_transaction(0);
+        if(!tx.has_value() || end_seed <= begin_seed) {
+            return {};
+        }
+        const auto count = end_seed - begin_seed;
+
+        // Seeded transactions differ only in their input index, so their
+        // preimages are all the same length
+        const auto tx_len = serialized_size(tx->m_inputs)
+                          + serialized_size(tx->m_outputs);
+        auto tx_buf = cbdc::buffer();
+        tx_buf.extend(tx_len * count);
+        auto tx_ser = cbdc::buffer_serializer(tx_buf);
+        for(auto i = begin_seed; i < end_seed; i++) {
+            tx->m_inputs[0].m_prevout.m_index = i;
+            tx_ser << tx->m_inputs << tx->m_outputs;
+        }
+        auto tx_ids = std::vector<hash_t>(count);
+        hash_data_batch(tx_buf.c_ptr(), tx_len, count, tx_ids.data());
+
+        // Same preimage as uhs_id_from_output for output 0 of each
+        constexpr auto uhs_len = fixed_serialized_size_v<hash_t>
+                               + fixed_serialized_size_v<uint64_t>
+                               + fixed_serialized_size_v<output>;
+        auto uhs_buf = cbdc::buffer();
+        uhs_buf.extend(uhs_len * count);
+        auto uhs_ser = cbdc::buffer_serializer(uhs_buf);
+        for(const auto& tx_id : tx_ids) {
+            uhs_ser << tx_id << uint64_t{0} << tx->m_outputs[0];
+        }
+        auto ret = std::vector<hash_t>(count);
+        hash_data_batch(uhs_buf.c_ptr(), uhs_len, count, ret.data());
+        return ret;
+    }
+
     auto transaction::wallet::create_seeded_input(size_t seed_idx)
         -> std::optional<transaction::input> {
         if(auto tx = create_seeded_transaction(seed_idx)) {
@@ -171,7 +193,7 @@ namespace cbdc {
         for(auto&& b : seckey) {
             b = keygen(*m_random_source);
         }
-        pubkey_t ret = pubkey_from_privkey(seckey, m_secp.get());
+        pubkey_t ret = pubkey_from_privkey(seckey, secp_context().get());
         {
             std::unique_lock<std::shared_mutex> lg(m_keys_mut);
             m_pubkeys.push_back(ret);
@@ -179,6 +201,7 @@ namespace cbdc {
             m_witness_programs.insert(
                 {transaction::validation::get_p2pk_witness_commitment(ret),
                  ret});
+            journal_key(ret, seckey);
         }
 
         return ret;
@@ -219,14 +242,14 @@ namespace cbdc {
 
                 secp256k1_keypair keypair{};
                 [[maybe_unused]] const auto ret
-                    = secp256k1_keypair_create(m_secp.get(),
+                    = secp256k1_keypair_create(secp_context().get(),
                                                &keypair,
                                                seckey.data());
                 assert(ret == 1);
 
                 std::array<unsigned char, sig_len> sig_arr{};
                 [[maybe_unused]] const auto sign_ret
-                    = secp256k1_schnorrsig_sign(m_secp.get(),
+                    = secp256k1_schnorrsig_sign(secp_context().get(),
                                                 sig_arr.data(),
                                                 sighash.data(),
                                                 &keypair,
@@ -246,20 +269,92 @@ namespace cbdc {
         const std::vector<transaction::input>& debits) {
         std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
         for(const auto& inp : credits) {
-            const auto added = m_utxos_set.insert(inp);
-            if(added.second) {
-                m_balance += inp.m_prevout_data.m_value;
-                m_spend_queue.push_back(inp);
-            }
+            add_utxo(inp);
         }
 
         for(const auto& inp : debits) {
-            const auto erased = m_utxos_set.erase(inp) > 0;
-            if(erased) {
-                m_balance -= inp.m_prevout_data.m_value;
+            const auto it = m_utxos.find(inp);
+            if(it != m_utxos.end()) {
+                remove_utxo(it);
             }
         }
-        assert(m_spend_queue.size() == m_utxos_set.size());
+        assert(m_spend_queue.size() == m_utxos.size());
+        assert(m_utxo_values.size() == m_utxos.size());
+    }
+
+    auto transaction::wallet::add_utxo(const transaction::input& inp)
+        -> bool {
+        const auto seq = m_next_seq;
+        const auto added = m_utxos.emplace(inp, seq);
+        if(!added.second) {
+            return false;
+        }
+        m_next_seq++;
+        m_balance += inp.m_prevout_data.m_value;
+        m_spend_queue.emplace(seq, inp);
+        m_utxo_values.emplace(inp.m_prevout_data.m_value, seq);
+        journal_utxo(journal_record::utxo_added, inp);
+        return true;
+    }
+
+    void transaction::wallet::remove_utxo(
+        std::map<transaction::input, uint64_t, cmp_input>::iterator it) {
+        const auto value = it->first.m_prevout_data.m_value;
+        const auto seq = it->second;
+        m_balance -= value;
+        m_utxo_values.erase({value, seq});
+        m_spend_queue.erase(seq);
+        journal_utxo(journal_record::utxo_spent, it->first);
+        m_utxos.erase(it);
+    }
+
+    void transaction::wallet::journal_key(const pubkey_t& pubkey,
+                                          const privkey_t& privkey) {
+        if(!m_journaling) {
+            return;
+        }
+        std::unique_lock<std::mutex> l(m_changes_mut);
+        if(m_key_changes_dropped) {
+            return;
+        }
+        // Past the size of the wallet, the next save rewrites it anyway
+        if(m_key_change_count >= std::max(min_journal_records, m_keys.size())) {
+            m_key_changes.clear();
+            m_key_change_count = 0;
+            m_key_changes_dropped = true;
+            return;
+        }
+        auto ser = buffer_serializer(m_key_changes);
+        ser.advance_cursor(m_key_changes.size());
+        ser << journal_record::key << pubkey << privkey;
+        m_key_change_count++;
+    }
+
+    void transaction::wallet::journal_utxo(journal_record type,
+                                           const transaction::input& inp) {
+        if(!m_journaling) {
+            return;
+        }
+        std::unique_lock<std::mutex> l(m_changes_mut);
+        if(m_utxo_changes_dropped) {
+            return;
+        }
+        if(m_utxo_change_count
+           >= std::max(min_journal_records, m_utxos.size())) {
+            m_utxo_changes.clear();
+            m_utxo_change_count = 0;
+            m_utxo_changes_dropped = true;
+            return;
+        }
+        auto ser = buffer_serializer(m_utxo_changes);
+        ser.advance_cursor(m_utxo_changes.size());
+        ser << type;
+        if(type == journal_record::utxo_spent) {
+            ser << inp.m_prevout;
+        } else {
+            ser << inp;
+        }
+        m_utxo_change_count++;
     }
 
     auto transaction::wallet::seed(const privkey_t& privkey,
@@ -270,7 +365,7 @@ namespace cbdc {
             return false;
         }
 
-        pubkey_t pubkey = pubkey_from_privkey(privkey, m_secp.get());
+        pubkey_t pubkey = pubkey_from_privkey(privkey, secp_context().get());
         auto witness_commitment
             = transaction::validation::get_p2pk_witness_commitment(pubkey);
         {
@@ -281,6 +376,7 @@ namespace cbdc {
             m_pubkeys.push_back(pubkey);
             m_keys.insert({pubkey, privkey});
             m_witness_programs.insert({witness_commitment, pubkey});
+            journal_key(pubkey, privkey);
         }
         seed_readonly(witness_commitment, value, begin_seed, end_seed);
         return true;
@@ -326,7 +422,7 @@ namespace cbdc {
 
     auto transaction::wallet::count() const -> size_t {
         std::shared_lock<std::shared_mutex> lg(m_utxos_mut);
-        auto size = m_utxos_set.size();
+        auto size = m_utxos.size();
         if(m_seed_from != m_seed_to) {
             size += (m_seed_to - m_seed_from);
         }
@@ -334,30 +430,140 @@ namespace cbdc {
     }
 
     void transaction::wallet::save(const std::string& wallet_file) const {
-        std::ofstream wal_file(wallet_file,
-                               std::ios::binary | std::ios::trunc
-                                   | std::ios::out);
-        if(!wal_file.good()) {
-            // TODO: add a logger to wallet or give the save/load function
-            // return
-            ///      values
-            std::exit(EXIT_FAILURE);
+        std::unique_lock<std::mutex> lj(m_journal_mut);
+        if(m_journal_base == wallet_file) {
+            auto wallet_size = size_t{0};
+            {
+                std::shared_lock<std::shared_mutex> lk(m_keys_mut);
+                wallet_size += m_keys.size();
+            }
+            {
+                std::shared_lock<std::shared_mutex> lu(m_utxos_mut);
+                wallet_size += m_utxos.size();
+            }
+            if(save_changes(wallet_size)) {
+                return;
+            }
         }
-        auto ser = ostream_serializer(wal_file);
+        save_full(wallet_file);
+    }
+
+    auto transaction::wallet::save_changes(size_t wallet_size) const
+        -> bool {
+        auto changes = buffer();
+        auto count = size_t{0};
         {
-            std::shared_lock<std::shared_mutex> lk(m_keys_mut);
-            ser << m_keys;
+            std::unique_lock<std::mutex> l(m_changes_mut);
+            count = m_key_change_count + m_utxo_change_count;
+            if(m_key_changes_dropped || m_utxo_changes_dropped
+               || m_journal_records + count
+                      > std::max(min_journal_records, wallet_size)) {
+                return false;
+            }
+            // Key records first, so UTXOs replay after the keys paying them
+            changes.append(m_key_changes.data(), m_key_changes.size());
+            changes.append(m_utxo_changes.data(), m_utxo_changes.size());
+            m_key_changes.clear();
+            m_key_change_count = 0;
+            m_utxo_changes.clear();
+            m_utxo_change_count = 0;
+        }
+        if(count == 0) {
+            return true;
+        }
+
+        std::ofstream journal(m_journal_base + journal_suffix,
+                              std::ios::binary | std::ios::app
+                                  | std::ios::out);
+        journal.write(changes.c_str(),
+                      static_cast<std::streamsize>(changes.size()));
+        journal.flush();
+        if(!journal.good()) {
+            // The full save starts a new journal, so the torn append is
+            // never replayed
+            return false;
         }
+        m_journal_records += count;
+        return true;
+    }
 
+    void transaction::wallet::save_full(const std::string& wallet_file) const {
+        // Changes made from here on are either written below or recorded
+        // for the next save
+        m_journaling = true;
+        m_journal_base.clear();
+
+        auto gen_dist = std::uniform_int_distribution<uint64_t>(1);
+        const auto gen = gen_dist(*m_random_source);
+
+        // Written to a temporary file and renamed over the wallet file, so
+        // a crash leaves either the old or the new wallet
+        const auto tmp_file = wallet_file + ".tmp";
         {
-            std::shared_lock<std::shared_mutex> lu(m_utxos_mut);
-            ser << m_utxos_set;
+            std::ofstream wal_file(tmp_file,
+                                   std::ios::binary | std::ios::trunc
+                                       | std::ios::out);
+            if(!wal_file.good()) {
+                // TODO: add a logger to wallet or give the save/load
+                //       function return values
+                std::exit(EXIT_FAILURE);
+            }
+            auto ser = ostream_serializer(wal_file);
+            {
+                std::shared_lock<std::shared_mutex> lk(m_keys_mut);
+                ser << m_keys;
+                std::unique_lock<std::mutex> l(m_changes_mut);
+                m_key_changes.clear();
+                m_key_change_count = 0;
+                m_key_changes_dropped = false;
+            }
+
+            {
+                // Written in the format of a std::set of the inputs
+                std::shared_lock<std::shared_mutex> lu(m_utxos_mut);
+                ser << static_cast<uint64_t>(m_utxos.size());
+                for(const auto& [utxo, seq] : m_utxos) {
+                    ser << utxo;
+                }
+                std::unique_lock<std::mutex> l(m_changes_mut);
+                m_utxo_changes.clear();
+                m_utxo_change_count = 0;
+                m_utxo_changes_dropped = false;
+            }
+
+            // Trails the wallet so older versions still load it
+            ser << gen;
+            wal_file.flush();
+            if(!wal_file.good()) {
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp_file, wallet_file, ec);
+        if(ec) {
+            std::exit(EXIT_FAILURE);
+        }
+
+        // A journal left by an earlier generation is ignored on load until
+        // it is replaced here
+        std::ofstream journal(wallet_file + journal_suffix,
+                              std::ios::binary | std::ios::trunc
+                                  | std::ios::out);
+        auto jser = ostream_serializer(journal);
+        jser << gen;
+        journal.flush();
+        if(journal.good()) {
+            m_journal_base = wallet_file;
+            m_journal_gen = gen;
+            m_journal_records = 0;
         }
     }
 
     void transaction::wallet::load(const std::string& wallet_file) {
+        std::unique_lock<std::mutex> lj(m_journal_mut);
         std::ifstream wal_file(wallet_file, std::ios::binary | std::ios::in);
         if(wal_file.good()) {
+            m_journaling = false;
             auto deser = istream_serializer(wal_file);
             {
                 std::unique_lock<std::shared_mutex> lk(m_keys_mut);
@@ -379,19 +585,123 @@ namespace cbdc {
             {
                 std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
 
-                m_utxos_set.clear();
+                m_utxos.clear();
                 m_spend_queue.clear();
+                m_utxo_values.clear();
                 m_balance = 0;
 
-                deser >> m_utxos_set;
-                for(const auto& utxo : m_utxos_set) {
-                    m_balance += utxo.m_prevout_data.m_value;
-                    m_spend_queue.push_back(utxo);
+                auto utxos = std::set<transaction::input, cmp_input>();
+                deser >> utxos;
+                for(const auto& utxo : utxos) {
+                    add_utxo(utxo);
                 }
             }
+
+            // Wallet files written before journaling have no generation
+            auto gen = uint64_t{0};
+            if(!(deser >> gen)) {
+                gen = 0;
+            }
+
+            {
+                std::unique_lock<std::mutex> l(m_changes_mut);
+                m_key_changes.clear();
+                m_key_change_count = 0;
+                m_key_changes_dropped = false;
+                m_utxo_changes.clear();
+                m_utxo_change_count = 0;
+                m_utxo_changes_dropped = false;
+            }
+
+            m_journal_base.clear();
+            if(gen != 0) {
+                if(auto n = replay_journal(wallet_file + journal_suffix, gen)) {
+                    m_journal_base = wallet_file;
+                    m_journal_gen = gen;
+                    m_journal_records = n.value();
+                }
+            }
+            m_journaling = true;
         }
     }
 
+    auto transaction::wallet::replay_journal(const std::string& journal_file,
+                                             uint64_t gen)
+        -> std::optional<size_t> {
+        std::ifstream journal(journal_file, std::ios::binary | std::ios::in);
+        if(!journal.good()) {
+            return std::nullopt;
+        }
+        auto deser = istream_serializer(journal);
+        auto journal_gen = uint64_t{0};
+        if(!(deser >> journal_gen) || journal_gen != gen) {
+            return std::nullopt;
+        }
+
+        auto n_records = size_t{0};
+        auto good_pos = journal.tellg();
+        for(;;) {
+            auto type = journal_record{};
+            if(!(deser >> type)) {
+                break;
+            }
+            if(type == journal_record::key) {
+                auto pubkey = pubkey_t();
+                auto privkey = privkey_t();
+                if(!(deser >> pubkey >> privkey)) {
+                    break;
+                }
+                std::unique_lock<std::shared_mutex> lk(m_keys_mut);
+                if(m_keys.emplace(pubkey, privkey).second) {
+                    m_pubkeys.push_back(pubkey);
+                    m_witness_programs.insert(
+                        {transaction::validation::get_p2pk_witness_commitment(
+                             pubkey),
+                         pubkey});
+                }
+            } else if(type == journal_record::utxo_added) {
+                auto inp = transaction::input();
+                if(!(deser >> inp)) {
+                    break;
+                }
+                std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+                add_utxo(inp);
+            } else if(type == journal_record::utxo_spent) {
+                auto inp = transaction::input();
+                if(!(deser >> inp.m_prevout)) {
+                    break;
+                }
+                std::unique_lock<std::shared_mutex> lu(m_utxos_mut);
+                auto it = m_utxos.find(inp);
+                if(it != m_utxos.end()) {
+                    remove_utxo(it);
+                }
+            } else {
+                break;
+            }
+            good_pos = journal.tellg();
+            n_records++;
+        }
+        journal.close();
+
+        // Drop a record torn by a crash while appending, so later records
+        // are appended after the last complete one
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(journal_file, ec);
+        if(ec) {
+            return std::nullopt;
+        }
+        if(size > static_cast<uintmax_t>(good_pos)) {
+            std::filesystem::resize_file(journal_file,
+                                         static_cast<uintmax_t>(good_pos),
+                                         ec);
+            if(ec) {
+                return std::nullopt;
+            }
+        }
+        return n_records;
+    }
+
     auto transaction::wallet::send_to(size_t input_count,
                                       size_t output_count,
                                       const pubkey_t& payee,
@@ -407,7 +717,7 @@ namespace cbdc {
 
         {
             std::unique_lock<std::shared_mutex> ul(m_utxos_mut);
-            if((m_utxos_set.size() + m_seed_to - m_seed_from) < input_count) {
+            if((m_utxos.size() + m_seed_to - m_seed_from) < input_count) {
                 return std::nullopt;
             }
 
@@ -431,8 +741,8 @@ namespace cbdc {
                 (utxo != m_spend_queue.end())
                 && (ret.m_inputs.size() < input_count);
                 utxo++) {
-                ret.m_inputs.push_back(*utxo);
-                total_amount += utxo->m_prevout_data.m_value;
+                ret.m_inputs.push_back(utxo->second);
+                total_amount += utxo->second.m_prevout_data.m_value;
             }
 
             output_val = total_amount / output_count;
@@ -444,10 +754,7 @@ namespace cbdc {
             }
 
             for(size_t i = seeded_inputs; i < ret.m_inputs.size(); i++) {
-                auto& inp = ret.m_inputs[i];
-                m_balance -= inp.m_prevout_data.m_value;
-                m_utxos_set.erase(inp);
-                m_spend_queue.pop_front();
+                remove_utxo(m_utxos.find(ret.m_inputs[i]));
             }
         }
 
@@ -482,6 +789,10 @@ namespace cbdc {
         update_balance(credits, {});
     }
 
+    void transaction::wallet::set_send_observer(send_observer_type observer) {
+        m_send_observer = std::move(observer);
+    }
+
     auto transaction::wallet::fan(size_t output_count,
                                   uint32_t value,
                                   const pubkey_t& payee,
@@ -541,24 +852,35 @@ namespace cbdc {
                 seeded_inputs++;
             }
 
-            auto utxo = m_spend_queue.begin();
-            while((total_amount < amount) && (utxo != m_spend_queue.end())) {
-                ret.m_inputs.push_back(*utxo);
-                ret.m_witness.emplace_back(sig_len, std::byte(0));
-                total_amount += utxo->m_prevout_data.m_value;
-                std::advance(utxo, 1);
+            if(total_amount < amount
+               && m_balance < amount - total_amount) {
+                m_seed_from -= seeded_inputs;
+                return std::nullopt;
             }
 
+            // Spend the oldest UTXO of the smallest value covering the rest
+            // of the amount, which is an exact match when one exists.
+            // Otherwise spend the largest UTXOs, to use as few as possible.
+            auto selected = std::vector<std::pair<uint64_t, uint64_t>>();
             if(total_amount < amount) {
-                m_seed_from -= seeded_inputs;
-                return std::nullopt;
+                const auto covering
+                    = m_utxo_values.lower_bound({amount - total_amount, 0});
+                if(covering != m_utxo_values.end()) {
+                    selected.push_back(*covering);
+                    total_amount += covering->first;
+                }
+            }
+            for(auto it = m_utxo_values.rbegin(); total_amount < amount;
+                it++) {
+                selected.push_back(*it);
+                total_amount += it->first;
             }
 
-            for(size_t i = seeded_inputs; i < ret.m_inputs.size(); i++) {
-                const auto del_utxo = m_spend_queue.begin();
-                m_balance -= del_utxo->m_prevout_data.m_value;
-                m_utxos_set.erase(*del_utxo);
-                m_spend_queue.pop_front();
+            for(const auto& [value, seq] : selected) {
+                const auto& utxo = m_spend_queue.at(seq);
+                ret.m_inputs.push_back(utxo);
+                ret.m_witness.emplace_back(sig_len, std::byte(0));
+                remove_utxo(m_utxos.find(utxo));
             }
         }
         return {{ret, total_amount}};
@@ -7,13 +7,15 @@
 #define OPENCBDC_TX_SRC_TRANSACTION_WALLET_H_
 
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/buffer.hpp"
 #include "util/common/config.hpp"
 #include "util/common/hashmap.hpp"
 #include "util/common/random_source.hpp"
 
 #include <atomic>
 #include <fstream>
-#include <list>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -31,6 +33,11 @@ namespace cbdc::transaction {
     /// pairs for Pay-to-Public-Key transaction attestations.
     class wallet {
       public:
+        /// Callback type invoked with the ID and payee of every transaction
+        /// created by \ref send_to.
+        using send_observer_type
+            = std::function<void(const hash_t& tx_id, const pubkey_t& payee)>;
+
         /// \brief Constructor.
         ///
         /// Initializes the randomization engine for key shuffling.
@@ -185,12 +192,20 @@ namespace cbdc::transaction {
         /// \return number of UTXOs.
         auto count() const -> size_t;
 
-        /// Save the state of the wallet to a binary data file.
+        /// \brief Save the state of the wallet to a binary data file.
+        ///
+        /// Once the wallet has been saved to or loaded from the file, later
+        /// saves append the keys and UTXOs added or spent since the previous
+        /// save to a journal next to the file, so they cost O(change) rather
+        /// than O(wallet). The whole wallet is rewritten, and the journal
+        /// restarted, when the journal grows larger than the wallet.
         /// \param wallet_file path to wallet file location.
         void save(const std::string& wallet_file) const;
 
         /// Overwrites the current state of the wallet with data loaded from a
-        /// file saved via the Wallet::save function.
+        /// file saved via the Wallet::save function, then replays the
+        /// changes in its journal. A partially written final journal record
+        /// is discarded.
         /// \param wallet_file path to wallet file location.
         void load(const std::string& wallet_file);
 
@@ -203,14 +218,38 @@ namespace cbdc::transaction {
         /// \param seed_idx the index in the seed set for which to generate the
         ///                 transaction.
         /// \returns the generated transaction.
-        auto create_seeded_transaction(size_t seed_idx)
+        auto create_seeded_transaction(size_t seed_idx) const
             -> std::optional<full_tx>;
 
+        /// \brief Calculates the UHS IDs of a range of seeded outputs.
+        ///
+        /// Equivalent to the UHS ID of the output of each transaction from
+        /// \ref create_seeded_transaction, but hashes the transactions and
+        /// their outputs several at a time with \ref hash_data_batch.
+        /// Thread safe, so ranges can be calculated in parallel.
+        /// \param begin_seed the index of the first seeded output.
+        /// \param end_seed the index after the last seeded output.
+        /// \return the UHS IDs of the seeded outputs in [begin_seed,
+        ///         end_seed), or an empty vector if the wallet is not seeded.
+        [[nodiscard]] auto seeded_uhs_ids(size_t begin_seed,
+                                          size_t end_seed) const
+            -> std::vector<hash_t>;
+
         /// Given a set of credit inputs, add the UTXOs and update the wallet's
         /// balance.
         /// \param credits the inputs to add to the wallet's set of UTXOs.
         void confirm_inputs(const std::vector<input>& credits);
 
+        /// \brief Attaches an observer for transactions created by
+        ///        \ref send_to.
+        ///
+        /// The observer runs synchronously on the calling thread, so it
+        /// should hand the record off (for example to a write-behind queue)
+        /// rather than block. No observer is attached by default.
+        /// \param observer callback to invoke, or an empty function to
+        ///                 detach the current observer.
+        void set_send_observer(send_observer_type observer);
+
       private:
         struct cmp_input {
             auto operator()(const input& lhs, const input& rhs) const -> bool {
@@ -220,18 +259,38 @@ namespace cbdc::transaction {
             }
         };
 
-        /// Locks access to m_utxos and m_balance (the sum of the UTXOs).
+        /// Type of a wallet journal record.
+        enum class journal_record : uint8_t {
+            /// Key pair added to the wallet.
+            key = 0,
+            /// UTXO added to the wallet.
+            utxo_added = 1,
+            /// UTXO removed from the wallet, recorded by its out point.
+            utxo_spent = 2
+        };
+
+        /// Journal records below this count never trigger a full save.
+        static constexpr size_t min_journal_records = 1024;
+
+        /// Locks access to m_utxos, its indexes and m_balance (the sum of
+        /// the UTXOs).
         /// \warning Do not lock simultaneously with m_keys_mut.
         mutable std::shared_mutex m_utxos_mut;
         uint64_t m_balance{0};
-        /// Stores the current set of spendable inputs.
-        std::set<input, cmp_input> m_utxos_set;
+        /// Stores the current set of spendable inputs, each mapped to the
+        /// sequence number it was added to the wallet with.
+        std::map<input, uint64_t, cmp_input> m_utxos;
         size_t m_seed_from{0};
         size_t m_seed_to{0};
         uint32_t m_seed_value{0};
         hash_t m_seed_witness_commitment{0};
-        /// Queue of spendable inputs, oldest first.
-        std::list<input> m_spend_queue;
+        /// Queue of spendable inputs keyed by sequence number, oldest first.
+        std::map<uint64_t, input> m_spend_queue;
+        /// Index of spendable inputs by value then sequence number, for
+        /// selecting inputs to cover an amount.
+        std::set<std::pair<uint64_t, uint64_t>> m_utxo_values;
+        /// Sequence number of the next input added to the wallet.
+        uint64_t m_next_seq{0};
 
         /// Locks access to m_keys and related members m_pubkeys and
         /// m_witness_programs.
@@ -244,11 +303,41 @@ namespace cbdc::transaction {
         std::vector<pubkey_t> m_pubkeys;
         std::default_random_engine m_shuffle;
 
+        send_observer_type m_send_observer;
+
         // TODO: currently this map grows unbounded, we need to garbage
         //       collect it
         std::unordered_map<hash_t, pubkey_t, hashing::const_sip_hash<hash_t>>
             m_witness_programs;
 
+        /// Serializes saves and guards the journal state below. Lock before
+        /// m_keys_mut or m_utxos_mut.
+        mutable std::mutex m_journal_mut;
+        /// Wallet file the journal extends, or empty if the next save must
+        /// write the whole wallet.
+        mutable std::string m_journal_base;
+        /// Generation shared by the wallet file and its journal.
+        mutable uint64_t m_journal_gen{0};
+        /// Number of records in the journal.
+        mutable size_t m_journal_records{0};
+
+        /// Set once the wallet has been saved or loaded. Changes are only
+        /// recorded for the journal while set.
+        mutable std::atomic_bool m_journaling{false};
+        /// Guards the unsaved changes below. Locked while holding
+        /// m_keys_mut or m_utxos_mut.
+        mutable std::mutex m_changes_mut;
+        /// Journal records of the keys added since the last save.
+        mutable buffer m_key_changes;
+        mutable size_t m_key_change_count{0};
+        /// Set if key changes were discarded for outgrowing the wallet.
+        mutable bool m_key_changes_dropped{false};
+        /// Journal records of the UTXO changes since the last save.
+        mutable buffer m_utxo_changes;
+        mutable size_t m_utxo_change_count{0};
+        /// Set if UTXO changes were discarded for outgrowing the wallet.
+        mutable bool m_utxo_changes_dropped{false};
+
         /// Creates a new input from the seed set based on the parameters
         /// passed in a preceding call to the \ref seed function.
         /// \param seed_idx the index in the seed set to generate the input
@@ -256,12 +345,6 @@ namespace cbdc::transaction {
         /// \returns the generated input to use in a transaction.
         auto create_seeded_input(size_t seed_idx) -> std::optional<input>;
 
-        static const inline auto m_secp
-            = std::unique_ptr<secp256k1_context,
-                              decltype(&secp256k1_context_destroy)>(
-                secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
-                &secp256k1_context_destroy);
-
         static const inline auto m_random_source
             = std::make_unique<random_source>(config::random_source);
 
@@ -272,6 +355,58 @@ namespace cbdc::transaction {
         void update_balance(const std::vector<input>& credits,
                             const std::vector<input>& debits);
 
+        /// Adds a spendable input to the UTXO indexes. Requires a unique
+        /// lock on m_utxos_mut.
+        /// \param inp input to add.
+        /// \return false if the wallet already holds the input.
+        auto add_utxo(const input& inp) -> bool;
+
+        /// Removes a spendable input from the UTXO indexes. Requires a
+        /// unique lock on m_utxos_mut.
+        /// \param it position of the input in m_utxos.
+        void remove_utxo(std::map<input, uint64_t, cmp_input>::iterator it);
+
+        /// Records a key pair added to the wallet for the journal. Requires
+        /// a unique lock on m_keys_mut.
+        /// \param pubkey public key.
+        /// \param privkey private key.
+        void journal_key(const pubkey_t& pubkey, const privkey_t& privkey);
+
+        /// Records a UTXO change for the journal. Requires a unique lock on
+        /// m_utxos_mut.
+        /// \param type utxo_added or utxo_spent.
+        /// \param inp input added or spent.
+        void journal_utxo(journal_record type, const input& inp);
+
+        /// Writes the whole wallet to a file, and starts a new journal for
+        /// it. Requires a lock on m_journal_mut.
+        /// \param wallet_file path to wallet file location.
+        void save_full(const std::string& wallet_file) const;
+
+        /// Appends the unsaved changes to the journal of the wallet file
+        /// the wallet was last saved to or loaded from. Requires a lock on
+        /// m_journal_mut.
+        /// \param wallet_size number of keys and UTXOs in the wallet.
+        /// \return false if the whole wallet needs to be saved instead.
+        auto save_changes(size_t wallet_size) const -> bool;
+
+        /// Replays the records of a wallet journal, truncating a partially
+        /// written final record. Requires a lock on m_journal_mut.
+        /// \param journal_file path to the journal.
+        /// \param gen generation of the wallet file the journal extends.
+        /// \return number of records replayed, or std::nullopt if the
+        ///         journal does not extend the wallet file.
+        auto replay_journal(const std::string& journal_file, uint64_t gen)
+            -> std::optional<size_t>;
+
+        /// Selects inputs with a total value of at least the given amount,
+        /// and removes them from the wallet. Spends seeded outputs first,
+        /// then the oldest UTXO of the smallest value covering the rest of
+        /// the amount, if any, or else the largest UTXOs.
+        /// \param amount total value to cover.
+        /// \return a transaction holding the selected inputs and their total
+        ///         value, or std::nullopt if the wallet cannot cover the
+        ///         amount.
         auto accumulate_inputs(uint64_t amount)
             -> std::optional<std::pair<full_tx, uint64_t>>;
     };
@@ -0,0 +1,73 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "batch_sizer.hpp"
+
+#include <algorithm>
+
+namespace cbdc::coordinator {
+    batch_sizer::batch_sizer(size_t max_size,
+                             std::chrono::microseconds target_latency,
+                             std::chrono::microseconds max_linger)
+        : m_max_size(std::max<size_t>(max_size, 1)),
+          m_target(target_latency),
+          m_max_linger(max_linger),
+          m_size(m_max_size) {
+        m_samples.reserve(window);
+    }
+
+    void batch_sizer::record(bool full, std::chrono::nanoseconds latency) {
+        m_samples.push_back(latency);
+        if(full) {
+            m_full++;
+        }
+        if(m_samples.size() >= window) {
+            adjust();
+        }
+    }
+
+    void batch_sizer::adjust() {
+        // Nearest-rank 99th percentile.
+        static constexpr size_t percentile{99};
+        static constexpr size_t percent{100};
+        auto rank = (m_samples.size() * percentile + percent - 1) / percent;
+        auto p99 = m_samples.begin() + static_cast<std::ptrdiff_t>(rank - 1);
+        std::nth_element(m_samples.begin(), p99, m_samples.end());
+        const auto latency = *p99;
+
+        static constexpr size_t shrink_divisor{8};
+        static constexpr size_t grow_divisor{16};
+        // Only grow with a quarter of the target to spare, so the size
+        // settles instead of oscillating around the target.
+        static constexpr auto headroom_num = 3;
+        static constexpr auto headroom_den = 4;
+        if(latency > m_target) {
+            m_size -= std::max<size_t>(m_size / shrink_divisor, 1);
+            m_size = std::max<size_t>(m_size, 1);
+        } else if(latency * headroom_den < m_target * headroom_num
+                  && m_full * 2 >= m_samples.size()) {
+            m_size += std::max<size_t>(m_size / grow_divisor, 1);
+            m_size = std::min(m_size, m_max_size);
+        }
+
+        if(latency < m_target) {
+            m_linger = std::min(m_max_linger, (m_target - latency) / 2);
+        } else {
+            m_linger = std::chrono::nanoseconds::zero();
+        }
+
+        m_samples.clear();
+        m_full = 0;
+    }
+
+    auto batch_sizer::batch_size() const -> size_t {
+        return m_size;
+    }
+
+    auto batch_sizer::linger() const -> std::chrono::microseconds {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            m_linger);
+    }
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COORDINATOR_BATCH_SIZER_H_
+#define OPENCBDC_TX_SRC_COORDINATOR_BATCH_SIZER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace cbdc::coordinator {
+    /// \brief Adjusts the coordinator's dtx batch size to meet a latency
+    ///        target.
+    ///
+    /// Collects the time each batch takes to reach its result, and after
+    /// every window of samples compares their 99th percentile with the
+    /// target. Over the target, the batch size shrinks by an eighth. Well
+    /// under it, and only if at least half the batches were cut full, the
+    /// batch size grows by a sixteenth. The linger time, for which a
+    /// partial batch waits for more transactions, is half the remaining
+    /// headroom. Not thread-safe.
+    class batch_sizer {
+      public:
+        /// Number of samples per adjustment.
+        static constexpr size_t window{32};
+
+        /// Constructor.
+        /// \param max_size largest batch size, used as the initial size.
+        /// \param target_latency 99th percentile batch latency to aim for.
+        /// \param max_linger longest time a partial batch may wait.
+        batch_sizer(size_t max_size,
+                    std::chrono::microseconds target_latency,
+                    std::chrono::microseconds max_linger);
+
+        /// Records the execution of a batch.
+        /// \param full true if the batch was cut because it reached the
+        ///             batch size.
+        /// \param latency time from the start of the batch until its
+        ///                results were known.
+        void record(bool full, std::chrono::nanoseconds latency);
+
+        /// Returns the current batch size.
+        /// \return number of transactions at which to cut a batch.
+        [[nodiscard]] auto batch_size() const -> size_t;
+
+        /// Returns the current linger time.
+        /// \return time to wait for a partial batch to fill.
+        [[nodiscard]] auto linger() const -> std::chrono::microseconds;
+
+      private:
+        void adjust();
+
+        size_t m_max_size;
+        std::chrono::nanoseconds m_target;
+        std::chrono::nanoseconds m_max_linger;
+        size_t m_size;
+        std::chrono::nanoseconds m_linger{0};
+        std::vector<std::chrono::nanoseconds> m_samples;
+        size_t m_full{0};
+    };
+}
+
+#endif
@@ -8,9 +8,11 @@
 #include "uhs/transaction/messages.hpp"
 
 namespace cbdc::coordinator::rpc {
-    client::client(std::vector<network::endpoint_t> endpoints)
+    client::client(std::vector<network::endpoint_t> endpoints,
+                   cbdc::rpc::tcp_client_options opts)
         : m_client(std::make_unique<decltype(m_client)::element_type>(
-            std::move(endpoints))) {}
+            std::move(endpoints),
+            opts)) {}
 
     auto client::init() -> bool {
         return m_client->init();
@@ -18,6 +20,45 @@ namespace cbdc::coordinator::rpc {
 
     auto client::execute_transaction(transaction::compact_tx tx,
                                      callback_type result_callback) -> bool {
-        return m_client->call(std::move(tx), std::move(result_callback));
+        return m_client->call(
+            request{std::move(tx)},
+            [cb = std::move(result_callback)](std::optional<response> resp) {
+                if(!resp.has_value()
+                   || !std::holds_alternative<bool>(resp.value())) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<bool>(resp.value()));
+            });
+    }
+
+    auto client::execute_transactions(batch_request txs,
+                                      batch_callback_type result_callback)
+        -> bool {
+        return m_client->call(
+            request{std::move(txs)},
+            [cb = std::move(result_callback)](std::optional<response> resp) {
+                if(!resp.has_value()
+                   || !std::holds_alternative<batch_response>(
+                       resp.value())) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(std::get<batch_response>(std::move(resp.value())));
+            });
+    }
+
+    auto client::set_route(uint64_t shard_id,
+                           std::optional<config::shard_range_t> range,
+                           std::chrono::milliseconds timeout) -> bool {
+        auto resp
+            = m_client->call(request{route_request{shard_id, range}}, timeout);
+        return resp.has_value() && std::holds_alternative<bool>(resp.value())
+            && std::get<bool>(resp.value());
+    }
+
+    auto client::await_connection(std::chrono::milliseconds timeout)
+        -> bool {
+        return m_client->await_connection(timeout);
     }
 }
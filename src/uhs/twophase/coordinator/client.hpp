@@ -16,7 +16,9 @@ namespace cbdc::coordinator::rpc {
       public:
         /// Constructor.
         /// \param endpoints RPC server endpoints for the coordinator cluster.
-        explicit client(std::vector<network::endpoint_t> endpoints);
+        /// \param opts flow control settings for the underlying RPC client.
+        explicit client(std::vector<network::endpoint_t> endpoints,
+                        cbdc::rpc::tcp_client_options opts = {});
 
         client() = delete;
         ~client() override = default;
@@ -42,6 +44,40 @@ namespace cbdc::coordinator::rpc {
                                  callback_type result_callback)
             -> bool override;
 
+        /// Callback type for the results of a batch of transactions.
+        using batch_callback_type
+            = std::function<void(std::optional<batch_response>)>;
+
+        /// Requests execution of a batch of transactions in one RPC. Each
+        /// transaction is executed independently.
+        /// \param txs transactions to execute.
+        /// \param result_callback function to call with the result of each
+        ///                        transaction, by index in the batch, or
+        ///                        std::nullopt if the request failed.
+        /// \return true if the RPC request was sent to the cluster
+        ///         successfully.
+        auto execute_transactions(batch_request txs,
+                                  batch_callback_type result_callback)
+            -> bool;
+
+        /// Requests a route change from the coordinator cluster and waits
+        /// until the previous route has drained.
+        /// \see interface::set_route.
+        /// \param shard_id ID of the shard.
+        /// \param range range to route to the shard, or std::nullopt.
+        /// \param timeout maximum time to wait for the change.
+        /// \return true if the coordinator changed the route.
+        auto set_route(uint64_t shard_id,
+                       std::optional<config::shard_range_t> range,
+                       std::chrono::milliseconds timeout) -> bool;
+
+        /// Waits until the client is connected to at least one coordinator
+        /// node, so a failed request can be retried once a node is
+        /// reachable again.
+        /// \param timeout maximum time to wait.
+        /// \return true if the client is connected.
+        auto await_connection(std::chrono::milliseconds timeout) -> bool;
+
       private:
         std::unique_ptr<cbdc::rpc::tcp_client<request, response>> m_client;
     };
@@ -7,18 +7,58 @@
 
 #include "format.hpp"
 #include "uhs/transaction/messages.hpp"
+#include "util/common/affinity.hpp"
+#include "util/common/metrics.hpp"
+#include "util/common/tracing.hpp"
+#include "util/persistence/factory.hpp"
 #include "util/raft/serialization.hpp"
 #include "util/rpc/tcp_server.hpp"
 #include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <utility>
 
-// #include "oracleDB.h"
+namespace cbdc::coordinator {
+    namespace {
+        auto batch_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "coordinator_batch_seconds",
+                    "Time to execute a dtx batch through every phase.");
+            return hist;
+        }
+
+        auto batch_sizes() -> metrics::histogram& {
+            static auto& hist = metrics::registry::global().get_histogram(
+                "coordinator_batch_size",
+                "Transactions in each executed dtx batch.");
+            return hist;
+        }
 
-// OracleDB db;
+        /// Calls a function when the scope holding the guard is left, by
+        /// whichever path.
+        template<typename F>
+        class scope_guard {
+          public:
+            explicit scope_guard(F f) : m_f(std::move(f)) {}
+
+            ~scope_guard() {
+                m_f();
+            }
+
+            scope_guard(const scope_guard&) = delete;
+            auto operator=(const scope_guard&) -> scope_guard& = delete;
+            scope_guard(scope_guard&&) = delete;
+            auto operator=(scope_guard&&) -> scope_guard& = delete;
+
+          private:
+            F m_f;
+        };
+    }
 
-namespace cbdc::coordinator {
     controller::controller(size_t node_id,
                            size_t coordinator_id,
                            config::options opts,
@@ -27,10 +67,17 @@ namespace cbdc::coordinator {
           m_coordinator_id(coordinator_id),
           m_opts(std::move(opts)),
           m_logger(std::move(logger)),
-          m_state_machine(nuraft::cs_new<state_machine>(m_logger)),
+          m_state_machine(nuraft::cs_new<state_machine>(
+              m_logger,
+              m_opts.m_coordinator_snapshot_distance == 0
+                  ? std::string()
+                  : "coordinator_snps_" + std::to_string(m_coordinator_id)
+                        + "_" + std::to_string(m_node_id),
+              m_opts.m_coordinator_snapshot_merge_deltas)),
           m_shard_endpoints(m_opts.m_locking_shard_endpoints),
           m_shard_ranges(m_opts.m_shard_ranges),
           m_batch_size(m_opts.m_batch_size),
+          m_recent_txs(m_opts.m_coordinator_dedupe_cache_size),
           m_exec_threads(m_opts.m_coordinator_max_threads) {
         m_raft_params.election_timeout_lower_bound_
             = static_cast<int>(m_opts.m_election_timeout_lower);
@@ -38,13 +85,74 @@ namespace cbdc::coordinator {
             = static_cast<int>(m_opts.m_election_timeout_upper);
         m_raft_params.heart_beat_interval_
             = static_cast<int>(m_opts.m_heartbeat);
-        m_raft_params.snapshot_distance_ = 0; // TODO: implement snapshots
+        m_raft_params.snapshot_distance_
+            = static_cast<int>(m_opts.m_coordinator_snapshot_distance);
         m_raft_params.max_append_size_
             = static_cast<int>(m_opts.m_raft_max_batch);
+
+        reset_routes({});
+
+        if(m_opts.m_coordinator_target_latency_us != 0) {
+            m_batch_sizer = std::make_unique<batch_sizer>(
+                m_opts.m_batch_size,
+                std::chrono::microseconds(
+                    m_opts.m_coordinator_target_latency_us),
+                std::chrono::microseconds(
+                    m_opts.m_coordinator_max_linger_us));
+        }
+
+        if(m_opts.m_coordinator_journal) {
+            m_journal = std::make_unique<persistence::write_behind_queue>(
+                m_logger,
+                persistence::make_sink(m_opts,
+                                       m_logger,
+                                       "admin.coordinator_journal",
+                                       {"dtx_id", "phase"}),
+                m_opts.m_oracle_queue_high_water_mark,
+                m_opts.m_oracle_batch_size,
+                persistence::make_retry_policy(m_opts));
+            if(!m_journal->start()) {
+                m_logger->warn("Dtx phase transitions will not be journaled");
+            }
+        }
+
+        if(m_opts.m_coordinator_archive) {
+            m_archive = std::make_unique<tx_archive>(
+                m_logger,
+                persistence::make_blob_sink(m_opts,
+                                            m_logger,
+                                            "admin.coordinator_archive",
+                                            "dtx_id",
+                                            "txs"),
+                m_opts.m_oracle_queue_high_water_mark,
+                m_opts.m_oracle_batch_size,
+                m_opts.m_coordinator_archive_compression_level,
+                persistence::make_retry_policy(m_opts));
+            if(!m_archive->start()) {
+                m_logger->warn("Committed dtxs will not be archived");
+            }
+        }
     }
 
     controller::~controller() {
+        m_sampler.reset();
         quit();
+        if(m_journal) {
+            m_journal->stop();
+        }
+        if(m_archive) {
+            m_archive->stop();
+        }
+    }
+
+    controller::batch_txs::batch_txs(size_t batch_size)
+        // Sized so a full batch's nodes, each a value plus its link and
+        // cached hash, and a bucket pointer per node fit the first chunk.
+        : m_arena(std::max<size_t>(batch_size, 1)
+                  * (sizeof(decltype(m_txs)::value_type)
+                     + sizeof(void*) * 3)),
+          m_txs(&m_arena) {
+        m_txs.reserve(batch_size);
     }
 
     auto controller::init() -> bool {
@@ -98,7 +206,16 @@ namespace cbdc::coordinator {
             [&](auto&& res, auto&& err) {
                 return raft_callback(std::forward<decltype(res)>(res),
                                      std::forward<decltype(err)>(err));
-            });
+            },
+            raft::log_store_options{m_opts.m_raft_log_backend,
+                                    m_opts.m_raft_log_cache_bytes,
+                                    m_opts.m_raft_log_segment_bytes,
+                                    m_opts.m_raft_log_leveldb});
+
+        m_replicator = std::make_unique<raft::batching_replicator>(
+            m_raft_serv,
+            make_buffer(sm_command_header{state_machine::command::batch}),
+            m_opts.m_raft_entry_batch);
 
         // Thread to handle starting and stopping the message handler and dtx
         // batch processing threads when triggered by the raft callback
@@ -107,12 +224,48 @@ namespace cbdc::coordinator {
             start_stop_func();
         });
 
+        if(m_opts.m_metrics_sample_interval_ms > 0) {
+            m_sampler = std::make_unique<metrics::sampler>(
+                std::chrono::milliseconds(m_opts.m_metrics_sample_interval_ms),
+                [&]() {
+                    sample_structures();
+                });
+        }
+
         // Initialize NuRaft with the state machine we just created. Register
         // our callback function to notify us when we become a leader or
         // follower.
         return m_raft_serv->init(m_raft_params);
     }
 
+    void controller::sample_structures() {
+        static auto& batch_entries = metrics::registry::global().get_gauge(
+            "coordinator_batch_txs_entries",
+            "Transactions in the batch being gathered.");
+        static auto& batch_bytes = metrics::registry::global().get_gauge(
+            "coordinator_batch_txs_bytes",
+            "Estimated bytes held by the batch being gathered.");
+        static auto& recent_entries = metrics::registry::global().get_gauge(
+            "coordinator_recent_txs_entries",
+            "Transactions executing or with recently kept results.");
+
+        size_t n_txs{0};
+        {
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
+            if(m_current_txs) {
+                n_txs = m_current_txs->m_txs.size();
+            }
+        }
+        batch_entries.set(n_txs);
+        // Each map node holds the entry, its link and cached hash, and
+        // roughly one bucket pointer.
+        batch_bytes.set(
+            n_txs
+            * (sizeof(decltype(batch_txs::m_txs)::value_type)
+               + sizeof(void*) * 3));
+        recent_entries.set(m_recent_txs.size());
+    }
+
     auto controller::raft_callback(nuraft::cb_func::Type type,
                                    nuraft::cb_func::Param* /* param */)
         -> nuraft::cb_func::ReturnCode {
@@ -154,33 +307,70 @@ namespace cbdc::coordinator {
         // Send the prepare status for this dtx ID and the txs contained within
         // to the coordinator RSM and ensure it replicated (or failed) before
         // returning.
-        auto comm = sm_command{{state_machine::command::prepare, dtx_id}, txs};
-        return replicate_sm_command(comm).has_value();
+        auto comm
+            = sm_command{{state_machine::command::prepare, dtx_id, true}, txs};
+        if(!replicate_sm_command(comm).has_value()) {
+            return false;
+        }
+        journal(dtx_id, state_machine::command::prepare);
+        return true;
     }
 
-    auto
-    controller::commit_cb(const hash_t& dtx_id,
-                          const std::vector<bool>& complete_txs,
-                          const std::vector<std::vector<uint64_t>>& tx_idxs)
+    auto controller::commit_cb(
+        const hash_t& dtx_id,
+        const std::vector<bool>& complete_txs,
+        const std::vector<std::vector<uint64_t>>& tx_idxs,
+        std::shared_ptr<const std::vector<transaction::compact_tx>> txs)
         -> bool {
         // Send the commit status for this dtx ID and the result from prepare,
         // along with the mapping of which txs are relevant to each shard in
         // the prepare result to the RSM and check if it replicated.
-        auto comm = sm_command{{state_machine::command::commit, dtx_id},
+        auto comm = sm_command{{state_machine::command::commit, dtx_id, true},
                                std::make_pair(complete_txs, tx_idxs)};
-        return replicate_sm_command(comm).has_value();
+        if(!replicate_sm_command(comm).has_value()) {
+            return false;
+        }
+        journal(dtx_id, state_machine::command::commit);
+        // Dtxs recovered after prepare no longer hold their transactions
+        if(m_archive && !txs->empty()) {
+            m_archive->try_push(dtx_id, std::move(txs), complete_txs);
+        }
+        return true;
     }
 
     auto controller::discard_cb(const hash_t& dtx_id) -> bool {
         // Send the discard status for this dtx ID and check if it replicated.
         auto comm = sm_command{{state_machine::command::discard, dtx_id}};
-        return replicate_sm_command(comm).has_value();
+        if(!replicate_sm_command(comm).has_value()) {
+            return false;
+        }
+        journal(dtx_id, state_machine::command::discard);
+        return true;
     }
 
     auto controller::done_cb(const hash_t& dtx_id) -> bool {
         // Send the done status for this dtx ID and check if it replicated.
         auto comm = sm_command{{state_machine::command::done, dtx_id}};
-        return replicate_sm_command(comm).has_value();
+        if(!replicate_sm_command(comm).has_value()) {
+            return false;
+        }
+        journal(dtx_id, state_machine::command::done);
+        return true;
+    }
+
+    void controller::journal(const hash_t& dtx_id,
+                             state_machine::command phase) {
+        if(!m_journal) {
+            return;
+        }
+        // Records are fixed-width hashes, so the phase is stored as a hash
+        // whose first byte is the state machine command and whose next
+        // eight bytes are this coordinator's ID.
+        auto tag = hash_t{static_cast<uint8_t>(phase)};
+        auto id = static_cast<uint64_t>(m_coordinator_id);
+        std::memcpy(&tag[1], &id, sizeof(id));
+        const auto record = std::array<hash_t, 2>{dtx_id, tag};
+        m_journal->push_records(record.data(), 1);
     }
 
     void controller::stop() {
@@ -188,11 +378,17 @@ namespace cbdc::coordinator {
         // batch trigger condition variable so the threads that check them will
         // end and we can join the threads below.
         {
-            std::lock_guard<std::mutex> l(m_batch_mut);
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
             m_running = false;
         }
         m_rpc_server.reset();
-        m_batch_cv.notify_one();
+        m_batch_cv.notify_all();
+        {
+            // Pairs with the recovery thread's wait so the wake-up is not
+            // lost between its check of m_running and blocking.
+            std::lock_guard<std::mutex> l(m_recovery_mut);
+        }
+        m_recovery_cv.notify_all();
 
         // Stop each of the locking shard clients to cancel any pending RPCs
         // and unblock any of the current dtxs so they can mark themselves as
@@ -209,6 +405,15 @@ namespace cbdc::coordinator {
         if(m_batch_exec_thread.joinable()) {
             m_batch_exec_thread.join();
         }
+        {
+            std::lock_guard<std::mutex> l(m_route_mut);
+            if(m_route_thread.joinable()) {
+                m_route_thread.join();
+            }
+        }
+        if(m_recovery_thread.joinable()) {
+            m_recovery_thread.join();
+        }
 
         // Join any existing dtxs still executing
         join_execs();
@@ -247,7 +452,18 @@ namespace cbdc::coordinator {
         // Deserialize the coordinator state we just retrieved from the RSM
         auto state = coordinator_state();
         auto deser = nuraft_serializer(*res);
-        deser >> state;
+        if(!(deser >> state) || !deser.end_of_buffer()) {
+            m_logger->error("Failed to deserialize coordinator state");
+            return false;
+        }
+
+        // Recovered dtxs are routed as they were when they were prepared
+        reset_routes(state.m_routes);
+        auto map = std::shared_ptr<const shard_prefix_map>();
+        {
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
+            map = m_route_map;
+        }
 
         for(const auto& prep : state.m_prepare_txs) {
             // Create a coordinator for the prepare dtx to recover
@@ -256,6 +472,7 @@ namespace cbdc::coordinator {
                 std::shared_lock<std::shared_mutex> l(m_shards_mut);
                 coord = std::make_shared<distributed_tx>(prep.first,
                                                          m_shards,
+                                                         map,
                                                          m_logger);
             }
             // Tell the coordinator this dtx is in the prepare phase and
@@ -270,6 +487,7 @@ namespace cbdc::coordinator {
                 std::shared_lock<std::shared_mutex> l(m_shards_mut);
                 coord = std::make_shared<distributed_tx>(com.first,
                                                          m_shards,
+                                                         map,
                                                          m_logger);
             }
             // Tell the coordinator this dtx is in the commit phase and provide
@@ -285,6 +503,7 @@ namespace cbdc::coordinator {
                 std::shared_lock<std::shared_mutex> l(m_shards_mut);
                 coord = std::make_shared<distributed_tx>(dis,
                                                          m_shards,
+                                                         map,
                                                          m_logger);
             }
             // Tell the coordinator this dtx is in the discard phase
@@ -292,29 +511,110 @@ namespace cbdc::coordinator {
             coordinators.emplace_back(std::move(coord));
         }
 
+        m_logger->info("Recovering",
+                       coordinators.size(),
+                       "dtxs -",
+                       state.m_prepare_txs.size(),
+                       "prepare,",
+                       state.m_commit_txs.size(),
+                       "commit,",
+                       state.m_discard_txs.size(),
+                       "discard");
+
+        // Hold back new txs on the shards the recovered dtxs touch, so they
+        // see the outcome of the recovered dtxs rather than their locks.
+        {
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
+            m_recovering_shards.assign(m_shard_ranges.size(), 0);
+            for(const auto& coord : coordinators) {
+                for(auto shard : coord->active_shards()) {
+                    if(shard < m_recovering_shards.size()) {
+                        m_recovering_shards[shard]++;
+                    }
+                }
+            }
+        }
+
+        // Execute the recovered dtxs in the background so new txs on other
+        // shards are accepted meanwhile.
+        if(m_recovery_thread.joinable()) {
+            m_recovery_thread.join();
+        }
+        m_recovery_thread
+            = std::thread([this, c{std::move(coordinators)}]() mutable {
+                  recover_dtxs(std::move(c));
+              });
+
+        return true;
+    }
+
+    void controller::recover_dtxs(
+        std::vector<std::shared_ptr<distributed_tx>> dtxs) {
+        const auto recovery_start = std::chrono::steady_clock::now();
+        // Leave at least one executor thread free for new batches.
+        const auto limit = std::max<size_t>(
+            std::min(m_opts.m_coordinator_recovery_concurrency,
+                     m_exec_threads.size() - 1),
+            1);
+
         // Flag in case one of the dtxs fails. This would happen if we stopped
         // being the leader mid-execution.
         auto success = std::atomic_bool{true};
-        for(auto&& coord : coordinators) {
+        // Release the shards of dtxs never handed to an executor, which
+        // are the ones not moved from
+        auto release_unscheduled = scope_guard([&]() {
+            for(const auto& coord : dtxs) {
+                if(coord) {
+                    finish_recovery(coord->active_shards());
+                }
+            }
+        });
+        for(auto&& coord : dtxs) {
+            {
+                std::unique_lock<std::mutex> l(m_recovery_mut);
+                m_recovery_cv.wait(l, [&]() {
+                    return m_recovery_active < limit || !m_running;
+                });
+                if(!m_running) {
+                    success = false;
+                    break;
+                }
+                m_recovery_active++;
+            }
             // Register the callbacks for the RSM so we track dtx state during
             // execution
             batch_set_cbs(*coord);
             auto dtx_id_str = to_string(coord->get_id());
+            auto shards = coord->active_shards();
             m_logger->info("Recovering dtx", dtx_id_str);
             // Create a lambda that handles the execution and cleanup of the
             // dtx
-            auto f = [&, c{std::move(coord)}, s{std::move(dtx_id_str)}](
-                         size_t thread_idx) {
-                // Execute the dtx from its most recent phase
-                auto exec_res = c->execute();
-                if(!exec_res) {
-                    m_logger->error("Failed to recover dtx", s);
-                    // We probably stopped being the leader so set the success
-                    // flag
-                    success = false;
-                } else {
-                    m_logger->info("Recovered dtx", s);
+            auto f = [&,
+                      c{std::move(coord)},
+                      s{std::move(dtx_id_str)},
+                      sh{std::move(shards)}](size_t thread_idx) {
+                {
+                    // Stop holding back the shards however the dtx ends,
+                    // so a failed recovery does not block them for good
+                    auto release = scope_guard([&]() {
+                        finish_recovery(sh);
+                    });
+                    // Execute the dtx from its most recent phase
+                    auto exec_res = c->execute();
+                    if(!exec_res) {
+                        m_logger->error("Failed to recover dtx", s);
+                        // We probably stopped being the leader so set the
+                        // success flag
+                        success = false;
+                    } else {
+                        m_logger->info("Recovered dtx", s);
+                    }
+                }
+                {
+                    std::lock_guard<std::mutex> l(m_recovery_mut);
+                    m_recovery_active--;
                 }
+                m_recovery_cv.notify_all();
                 // Mark the thread we were using as done so it can be re-used
                 {
                     std::shared_lock<std::shared_mutex> l(m_exec_mut);
@@ -326,10 +626,60 @@ namespace cbdc::coordinator {
             schedule_exec(std::move(f));
         }
 
-        // Make sure we recovered fully before returning
-        join_execs();
+        // Wait for the scheduled dtxs, which reference this frame
+        {
+            std::unique_lock<std::mutex> l(m_recovery_mut);
+            m_recovery_cv.wait(l, [&]() {
+                return m_recovery_active == 0;
+            });
+        }
+
+        if(!success) {
+            m_logger->error("Recovery incomplete, likely stopped being "
+                            "leader");
+            return;
+        }
+        const auto recovery_ms
+            = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - recovery_start)
+                  .count();
+        m_logger->info("Recovery of",
+                       dtxs.size(),
+                       "dtxs took",
+                       recovery_ms,
+                       "ms");
+    }
 
-        return success;
+    void controller::finish_recovery(const std::vector<size_t>& shards) {
+        {
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
+            for(auto shard : shards) {
+                if(shard < m_recovering_shards.size()
+                   && m_recovering_shards[shard] > 0) {
+                    m_recovering_shards[shard]--;
+                }
+            }
+        }
+        // Handler threads may be waiting for these shards
+        m_batch_cv.notify_all();
+    }
+
+    auto controller::recovering(const transaction::compact_tx& tx) const
+        -> bool {
+        auto held = [&](const hash_t& h) {
+            for(auto shard : m_route_map->shards(h)) {
+                if(shard < m_recovering_shards.size()
+                   && m_recovering_shards[shard] > 0) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        return held(tx.m_id)
+            || std::any_of(tx.m_inputs.begin(), tx.m_inputs.end(), held)
+            || std::any_of(tx.m_uhs_outputs.begin(),
+                           tx.m_uhs_outputs.end(),
+                           held);
     }
 
     void controller::batch_set_cbs(distributed_tx& c) {
@@ -350,7 +700,8 @@ namespace cbdc::coordinator {
                     return commit_cb(
                         std::forward<decltype(dtx_id)>(dtx_id),
                         std::forward<decltype(complete_txs)>(complete_txs),
-                        std::forward<decltype(tx_idxs)>(tx_idxs));
+                        std::forward<decltype(tx_idxs)>(tx_idxs),
+                        c.get_txs());
                 });
         }
         if(s != distributed_tx::dtx_state::discard) {
@@ -365,15 +716,146 @@ namespace cbdc::coordinator {
         }
     }
 
+    auto controller::make_batch(std::shared_ptr<const shard_prefix_map> map)
+        -> std::shared_ptr<distributed_tx> {
+        std::shared_lock<std::shared_mutex> l(m_shards_mut);
+        return std::make_shared<distributed_tx>(m_rnd.random_hash(),
+                                                m_shards,
+                                                std::move(map),
+                                                m_logger);
+    }
+
+    void controller::reset_routes(const state_machine::shard_routes& routes) {
+        auto ranges = std::vector<std::optional<config::shard_range_t>>();
+        ranges.reserve(m_shard_ranges.size());
+        for(size_t i{0}; i < m_shard_ranges.size(); i++) {
+            // Joining shards receive no UHS IDs until a range is moved to
+            // them
+            const auto joining = i < m_opts.m_shard_joining.size()
+                              && m_opts.m_shard_joining[i];
+            ranges.emplace_back(
+                joining ? std::nullopt
+                        : std::optional<config::shard_range_t>(
+                            m_shard_ranges[i]));
+        }
+        for(const auto& [shard_id, range] : routes) {
+            if(shard_id < ranges.size()) {
+                ranges[shard_id] = range;
+            }
+        }
+        auto map = std::make_shared<const shard_prefix_map>(ranges);
+        std::lock_guard<profiled_mutex> l(m_batch_mut);
+        m_routes = std::move(ranges);
+        m_route_map = std::move(map);
+    }
+
+    auto controller::set_route(uint64_t shard_id,
+                               std::optional<config::shard_range_t> range,
+                               route_callback_type result_callback) -> bool {
+        if(!m_raft_serv->is_leader() || !m_running
+           || shard_id >= m_shard_ranges.size()) {
+            return false;
+        }
+        if(range.has_value()) {
+            const auto& own = m_shard_ranges[shard_id];
+            if(range->first > range->second || range->first < own.first
+               || range->second > own.second) {
+                m_logger->warn("Route outside the range of shard", shard_id);
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> l(m_route_mut);
+        if(m_routing.exchange(true)) {
+            return false;
+        }
+        if(m_route_thread.joinable()) {
+            m_route_thread.join();
+        }
+        m_route_thread = std::thread(
+            [this, shard_id, range, cb = std::move(result_callback)]() {
+                auto comm = sm_command{{state_machine::command::route},
+                                       route_update{shard_id, range}};
+                if(!replicate_sm_command(comm)) {
+                    m_logger->error("Failed to replicate route for shard",
+                                    shard_id);
+                    m_routing = false;
+                    cb(false);
+                    return;
+                }
+                auto old_map = std::weak_ptr<const shard_prefix_map>();
+                {
+                    std::lock_guard<profiled_mutex> ll(m_batch_mut);
+                    m_routes[shard_id] = range;
+                    old_map = m_route_map;
+                    m_route_map
+                        = std::make_shared<const shard_prefix_map>(m_routes);
+                }
+                m_logger->info("Changed route for shard", shard_id);
+                drain_routes(std::move(old_map), cb);
+                m_routing = false;
+            });
+        return true;
+    }
+
+    void controller::drain_routes(
+        std::weak_ptr<const shard_prefix_map> old_map,
+        const route_callback_type& cb) {
+        static constexpr auto poll_interval = std::chrono::milliseconds(10);
+        // An empty batch built with the old map would hold it until the
+        // next transaction arrives, so it is replaced.
+        auto stale = [&]() {
+            return m_current_batch && m_current_txs->m_txs.empty()
+                && m_current_batch->prefix_map() != m_route_map;
+        };
+        while(!old_map.expired()) {
+            if(!m_running) {
+                cb(false);
+                return;
+            }
+            auto map = std::shared_ptr<const shard_prefix_map>();
+            {
+                std::lock_guard<profiled_mutex> l(m_batch_mut);
+                if(stale()) {
+                    map = m_route_map;
+                }
+            }
+            if(map) {
+                auto batch = make_batch(std::move(map));
+                std::lock_guard<profiled_mutex> l(m_batch_mut);
+                if(stale()) {
+                    batch->reserve(m_batch_size);
+                    batch_set_cbs(*batch);
+                    m_current_batch = std::move(batch);
+                }
+            }
+            std::this_thread::sleep_for(poll_interval);
+        }
+        m_logger->info("Previous routes drained");
+        cb(true);
+    }
+
     void controller::batch_executor_func() {
         while(m_running) {
+            size_t batch_size{};
+            auto map = std::shared_ptr<const shard_prefix_map>();
             {
                 // Wait until there are transactions ready to be processed in a
                 // dtx batch
-                std::unique_lock<std::mutex> l(m_batch_mut);
+                std::unique_lock<profiled_mutex> l(m_batch_mut);
                 m_batch_cv.wait(l, [&]() {
-                    return !m_current_txs->empty() || !m_running;
+                    return !m_current_txs->m_txs.empty() || !m_running;
                 });
+                // Give a partial batch time to fill if the latency target
+                // leaves room for it
+                if(m_batch_sizer) {
+                    m_batch_cv.wait_for(l, m_batch_sizer->linger(), [&]() {
+                        return m_current_txs->m_txs.size() >= m_batch_size
+                            || !m_running;
+                    });
+                }
+                batch_size = m_batch_size;
+                map = m_route_map;
             }
             if(!m_running) {
                 break;
@@ -382,31 +864,28 @@ namespace cbdc::coordinator {
             // Placeholders where we're going to move the current batch and map
             // of tx to sentinel so we can send the responses.
             auto batch = std::shared_ptr<distributed_tx>();
-            auto txs
-                = std::shared_ptr<decltype(m_current_txs)::element_type>();
+            auto txs = std::shared_ptr<batch_txs>();
 
             // New batch we're going to swap out with the current batch being
             // built by the handler thread
-            auto new_batch = std::shared_ptr<distributed_tx>();
-            {
-                std::shared_lock<std::shared_mutex> l(m_shards_mut);
-                new_batch
-                    = std::make_shared<distributed_tx>(m_rnd.random_hash(),
-                                                       m_shards,
-                                                       m_logger);
-            }
+            auto new_batch = make_batch(std::move(map));
+            // Size the next batch's storage outside the batch lock so the
+            // handler thread doesn't wait on the allocations
+            new_batch->reserve(batch_size);
+            auto new_txs = std::make_shared<batch_txs>(batch_size);
 
             // Atomically swap the current batch and tx->sentinel map with new
             // ones so we can run this batch while the handler thread builds a
             // new one
+            auto full = false;
             {
-                std::lock_guard<std::mutex> l(m_batch_mut);
+                std::lock_guard<profiled_mutex> l(m_batch_mut);
+                full = m_current_txs->m_txs.size() >= m_batch_size;
                 batch = std::move(m_current_batch);
                 txs = std::move(m_current_txs);
                 m_current_batch = std::move(new_batch);
                 batch_set_cbs(*m_current_batch);
-                m_current_txs = std::make_shared<
-                    decltype(m_current_txs)::element_type>();
+                m_current_txs = std::move(new_txs);
             }
 
             // Notify the handler thread it can re-start adding transactions to
@@ -415,23 +894,44 @@ namespace cbdc::coordinator {
 
             // Lambda to execute the batch and respond to the sentinel with the
             // result
-            auto f = [&, b{std::move(batch)}, t{std::move(txs)}](
+            auto f = [&, b{std::move(batch)}, t{std::move(txs)}, full](
                          size_t thread_idx) {
+                t->m_wait.finish();
+                auto span = tracing::span("coordinator.execute", t->m_trace);
+                auto c = tracing::scoped_context(span.get_context());
                 auto dtxid = to_string(b->get_id());
-                m_logger->info("dtxn start:", dtxid, "size:", t->size());
+                m_logger->info("dtxn start:",
+                               dtxid,
+                               "size:",
+                               t->m_txs.size());
+                batch_sizes().record(t->m_txs.size());
                 auto s = std::chrono::high_resolution_clock::now();
-                // Execute the batch from the start
-                auto res = b->execute();
                 // For each tx result in the batch create a message with
                 // the txid and the result, and send it to the appropriate
                 // sentinel.
-                for(const auto& [tx_id, metadata] : *t) {
-                    const auto& [cb_func, batch_idx] = metadata;
-                    auto tx_res = std::optional<bool>();
-                    if(res.has_value()) {
-                        tx_res = static_cast<bool>((*res)[batch_idx]);
+                auto respond = [&](const std::vector<bool>* res) {
+                    for(const auto& [tx_id, metadata] : t->m_txs) {
+                        const auto& [cb_func, batch_idx] = metadata;
+                        auto tx_res = std::optional<bool>();
+                        if(res != nullptr) {
+                            tx_res = static_cast<bool>((*res)[batch_idx]);
+                        }
+                        cb_func(tx_res);
                     }
-                    cb_func(tx_res);
+                };
+                // Respond as soon as the shards have applied the batch, so
+                // the discard and done phases overlap with later batches
+                // rather than adding to the sentinels' latency.
+                auto responded = false;
+                b->set_result_cb([&](const std::vector<bool>& res) {
+                    record_latency(full, s);
+                    respond(&res);
+                    responded = true;
+                });
+                // Execute the batch from the start
+                auto res = b->execute();
+                if(!responded) {
+                    respond(res.has_value() ? &res.value() : nullptr);
                 }
                 if(!res) {
                     // We probably stopped being the leader and we don't know
@@ -441,6 +941,7 @@ namespace cbdc::coordinator {
                     m_logger->warn("dtxn failed:", dtxid);
                 } else {
                     auto e = std::chrono::high_resolution_clock::now();
+                    batch_latency().record(e - s);
                     auto l = (e - s).count();
                     m_logger->info("dtxn done:",
                                    dtxid,
@@ -461,6 +962,27 @@ namespace cbdc::coordinator {
         }
     }
 
+    void controller::record_latency(
+        bool full,
+        std::chrono::high_resolution_clock::time_point start) {
+        if(!m_batch_sizer) {
+            return;
+        }
+        auto latency = std::chrono::high_resolution_clock::now() - start;
+        auto grew = false;
+        {
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
+            m_batch_sizer->record(full, latency);
+            auto size = m_batch_sizer->batch_size();
+            grew = size > m_batch_size;
+            m_batch_size = size;
+        }
+        if(grew) {
+            // Handler threads may be waiting for space in the batch
+            m_batch_cv.notify_all();
+        }
+    }
+
     auto controller::replicate_sm_command(const sm_command& c)
         -> std::optional<nuraft::ptr<nuraft::buffer>> {
         auto buf = nuraft::buffer::alloc(serialized_size(c));
@@ -468,8 +990,9 @@ namespace cbdc::coordinator {
         ser << c;
         // Sanity check to ensure total_sz was correct
         assert(ser.end_of_buffer());
-        // Use synchronous mode to block until replication or failure
-        return m_raft_serv->replicate_sync(buf);
+        // Block until replication or failure. Commands from concurrent dtxs
+        // share log entries.
+        return m_replicator->replicate_sync(std::move(buf));
     }
 
     void controller::connect_shards() {
@@ -513,7 +1036,12 @@ namespace cbdc::coordinator {
                         // Not use-after-move because the outer loop exits once
                         // f has been moved due to found_thread.
                         thr.first // NOLINTNEXTLINE(bugprone-use-after-move)
-                            = std::make_shared<std::thread>(std::move(f), i);
+                            = std::make_shared<std::thread>(
+                                [fn = std::move(f)](size_t idx) {
+                                    pin_current_thread(thread_role::executor);
+                                    fn(idx);
+                                },
+                                i);
                         found_thread = true;
                         break;
                     }
@@ -568,8 +1096,6 @@ namespace cbdc::coordinator {
             if(stopping) {
                 m_logger->warn("Stopping coordinator");
                 stop();
-                // disconnect oracle autonomous database
-                // OracleDB_disconnect(&db);             
                 m_logger->warn("Stopped coordinator");
                 if(quitting) {
                     m_logger->warn("Quitting");
@@ -592,7 +1118,7 @@ namespace cbdc::coordinator {
         // Set the running flag to true so when we start the threads they won't
         // immediately exit
         {
-            std::lock_guard<std::mutex> l(m_batch_mut);
+            std::lock_guard<profiled_mutex> l(m_batch_mut);
             m_running = true;
         }
         m_logger->warn("Resetting sentinel network handler");
@@ -602,20 +1128,9 @@ namespace cbdc::coordinator {
         // Connect to the shard clusters
         connect_shards();
         m_logger->warn("Became leader, recovering dtxs");
-      
-        // // Connect to the autonomous database
-        // if (OracleDB_init(&db) == 0) {
-        //     m_logger->info("OracleDB initialized successfully.");
-        //     // Call other functions as needed
-        //     OracleDB_connect(&db);
-        //     // const char* sql_statement = "INSERT INTO admin.test_two VALUES (100, 'nate', 'dan', 'bella')";   // this works
-        //     // OracleDB_execute(&db, sql_statement);
-        // } else {
-        //     m_logger->warn("Failed to initialize OracleDB.");
-        // }
-
-        // Attempt recovery of existing dtxs until we stop being the leader or
-        // recovery succeeds
+
+        // Attempt to start recovery of existing dtxs until we stop being the
+        // leader or loading the dtxs to recover succeeds
         bool recovered{false};
         do {
             auto res = recovery_func();
@@ -626,7 +1141,7 @@ namespace cbdc::coordinator {
             }
             recovered = true;
         } while(!recovered && m_raft_serv->is_leader());
-        m_logger->info("Recovery complete");
+        m_logger->info("Recovery started");
 
         // If we stopped being the leader while attempting to recover we
         // shouldn't bother starting and handler threads
@@ -635,26 +1150,25 @@ namespace cbdc::coordinator {
         }
 
         // Create a fresh batch to add transactions to
-        auto batch = std::shared_ptr<distributed_tx>();
+        auto map = std::shared_ptr<const shard_prefix_map>();
         {
-            std::shared_lock<std::shared_mutex> ll(m_shards_mut);
-            batch = std::make_shared<distributed_tx>(m_rnd.random_hash(),
-                                                     m_shards,
-                                                     m_logger);
+            std::lock_guard<profiled_mutex> ll(m_batch_mut);
+            map = m_route_map;
         }
+        auto batch = make_batch(std::move(map));
         // Register the RSM callbacks with the batch
         batch_set_cbs(*batch);
 
         // Atomically set the current batch and a new tx->sentinel map
         {
-            std::lock_guard<std::mutex> ll(m_batch_mut);
+            std::lock_guard<profiled_mutex> ll(m_batch_mut);
             m_current_batch = std::move(batch);
-            m_current_txs
-                = std::make_shared<decltype(m_current_txs)::element_type>();
+            m_current_txs = std::make_shared<batch_txs>(m_batch_size);
         }
 
         // Start the batch executor thread
         m_batch_exec_thread = std::thread([&] {
+            pin_current_thread(thread_role::executor);
             batch_executor_func();
         });
 
@@ -685,18 +1199,27 @@ namespace cbdc::coordinator {
         }
     }
 
+    void controller::transfer_leadership() {
+        if(m_opts.m_leadership_transfer_timeout == 0) {
+            return;
+        }
+        static_cast<void>(m_raft_serv->transfer_leadership(
+            std::chrono::milliseconds(m_opts.m_leadership_transfer_timeout)));
+    }
+
     auto controller::sm_command_header::operator==(
         const sm_command_header& rhs) const -> bool {
-        return std::tie(m_comm, m_dtx_id)
-            == std::tie(rhs.m_comm, rhs.m_dtx_id);
+        return std::tie(m_comm, m_dtx_id, m_compact)
+            == std::tie(rhs.m_comm, rhs.m_dtx_id, rhs.m_compact);
     }
 
     auto controller::coordinator_state::operator==(
         const coordinator_state& rhs) const -> bool {
-        return std::tie(m_prepare_txs, m_commit_txs, m_discard_txs)
+        return std::tie(m_prepare_txs, m_commit_txs, m_discard_txs, m_routes)
             == std::tie(rhs.m_prepare_txs,
                         rhs.m_commit_txs,
-                        rhs.m_discard_txs);
+                        rhs.m_discard_txs,
+                        rhs.m_routes);
     }
 
     auto controller::execute_transaction(transaction::compact_tx tx,
@@ -715,31 +1238,66 @@ namespace cbdc::coordinator {
                            to_string(tx.m_id));
             return false;
         }
+        // Every attestation is valid, so the shards only need as many as
+        // the threshold. Drop the rest before the tx is logged and sent.
+        while(tx.m_attestations.size() > m_opts.m_attestation_threshold) {
+            tx.m_attestations.erase(tx.m_attestations.begin());
+        }
 
+        // A resubmitted transaction shares the result of the earlier
+        // submission rather than executing again
+        if(m_recent_txs.submit(tx.m_id, result_callback)
+           != dedupe_cache<bool>::status::first) {
+            return true;
+        }
+        result_callback = [&, id = tx.m_id, cb = std::move(result_callback)](
+                              std::optional<bool> res) {
+            cb(res);
+            m_recent_txs.finish(id, res);
+        };
+
+        auto full = false;
         auto added = [&]() {
             // Wait until there's space in the current batch
-            std::unique_lock<std::mutex> l(m_batch_mut);
+            std::unique_lock<profiled_mutex> l(m_batch_mut);
             m_batch_cv.wait(l, [&]() {
-                return m_current_txs->size() < m_batch_size || !m_running;
+                return (m_current_txs->m_txs.size() < m_batch_size
+                        && !recovering(tx))
+                    || !m_running;
             });
             if(!m_running) {
                 return false;
             }
 
             // Make sure the TX is not already in the current batch
-            if(m_current_txs->find(tx.m_id) != m_current_txs->end()) {
+            if(m_current_txs->m_txs.find(tx.m_id)
+               != m_current_txs->m_txs.end()) {
                 return false;
             }
             // Add the tx to the current dtx batch and record its index
             auto idx = m_current_batch->add_tx(tx);
             // Map the index of the tx to the transaction ID and sentinel
             // ID
-            m_current_txs->emplace(
+            m_current_txs->m_txs.emplace(
                 tx.m_id,
                 std::make_pair(std::move(result_callback), idx));
+            auto trace = tracing::current();
+            if(trace.has_value() && !m_current_txs->m_trace.has_value()) {
+                m_current_txs->m_trace = trace;
+                m_current_txs->m_wait
+                    = tracing::span("coordinator.batch_wait", trace);
+            }
+            full = m_current_txs->m_txs.size() >= m_batch_size;
             return true;
         }();
-        if(added) {
+        if(!added) {
+            m_recent_txs.finish(tx.m_id, std::nullopt);
+        }
+        if(full) {
+            // Other handler threads share the condition variable, so wake
+            // them all to be sure the executor thread sees the full batch
+            m_batch_cv.notify_all();
+        } else if(added) {
             // If this was a new TX, notify the executor thread there's work to
             // do
             m_batch_cv.notify_one();
@@ -6,24 +6,37 @@
 #ifndef OPENCBDC_TX_SRC_COORDINATOR_CONTROLLER_H_
 #define OPENCBDC_TX_SRC_COORDINATOR_CONTROLLER_H_
 
+#include "batch_sizer.hpp"
 #include "distributed_tx.hpp"
 #include "interface.hpp"
 #include "server.hpp"
 #include "state_machine.hpp"
+#include "tx_archive.hpp"
 #include "uhs/twophase/locking_shard/locking_shard.hpp"
 #include "util/common/buffer.hpp"
+#include "util/common/dedupe_cache.hpp"
+#include "util/common/metrics.hpp"
+#include "util/common/profiled_mutex.hpp"
 #include "util/common/random_source.hpp"
+#include "util/common/shard_prefix_map.hpp"
+#include "util/common/tracing.hpp"
 #include "util/network/connection_manager.hpp"
+#include "util/persistence/write_behind_queue.hpp"
+#include "util/raft/batching_replicator.hpp"
 #include "util/raft/node.hpp"
 
+#include <memory_resource>
 #include <secp256k1.h>
+#include <unordered_map>
 
 namespace cbdc::coordinator {
     /// Replicated coordinator node. Participates in a raft cluster with
     /// other replicated coordinators. When acting as the leader, listens
     /// on a specified endpoint and handles new transaction requests from
     /// sentinels. Recovers failed dtxs as part of its leadership
-    /// transition.
+    /// transition. Optionally journals every replicated dtx phase
+    /// transition to the persistence backend, and archives the full
+    /// transactions of each committed dtx, off the dtx execution path.
     class controller : public interface {
       public:
         using send_fn_t = std::function<void(const std::shared_ptr<buffer>&,
@@ -55,6 +68,11 @@ namespace cbdc::coordinator {
         /// Terminates the replicated coordinator instance.
         void quit();
 
+        /// Hands raft leadership to an up-to-date follower if this node
+        /// leads, so the new leader recovers in-flight dtxs without
+        /// waiting for an election. Call before shutting down.
+        void transfer_leadership();
+
         /// List of compact transactions associated with a distributed
         /// transaction in the prepare phase.
         using prepare_tx = std::vector<transaction::compact_tx>;
@@ -90,16 +108,28 @@ namespace cbdc::coordinator {
             /// if applicable.
             std::optional<hash_t> m_dtx_id{};
 
+            /// True if the command's payload uses the compact encoding.
+            /// Entries logged before the compact encoding existed have this
+            /// unset and are decoded as before.
+            bool m_compact{false};
+
             auto operator==(const sm_command_header& rhs) const -> bool;
         };
 
+        /// Shard ID and the UHS ID range to route to it, or std::nullopt to
+        /// route nothing to the shard.
+        using route_update
+            = std::pair<uint64_t, std::optional<config::shard_range_t>>;
+
         /// A full command for the state machine to process.
         struct sm_command {
             /// The command's metadata.
             sm_command_header m_header{};
 
-            /// Associated transactions to prepare or commit, if applicable.
-            std::optional<std::variant<prepare_tx, commit_tx>> m_data{};
+            /// Associated transactions to prepare or commit, or the route
+            /// to change, if applicable.
+            std::optional<std::variant<prepare_tx, commit_tx, route_update>>
+                m_data{};
         };
 
         /// \brief Current state of distributed transactions managed by a
@@ -117,6 +147,9 @@ namespace cbdc::coordinator {
             /// Transactions in the discard phase.
             discard_txs m_discard_txs{};
 
+            /// Shard routes changed since the coordinator started.
+            state_machine::shard_routes m_routes{};
+
             auto operator==(const coordinator_state& rhs) const -> bool;
         };
 
@@ -127,15 +160,57 @@ namespace cbdc::coordinator {
         /// \param tx transaction to execute.
         /// \param result_callback function to call with the result once
         ///                        execution is complete.
-        /// \return true if the current batch now contains the transaction.
-        ///         false if the current batch already contained the
-        ///         transaction or if the controller shut down before the
-        ///         operation could finish.
+        /// A transaction already executing, or among the recently executed,
+        /// is not added again. Its callback receives the result of the
+        /// earlier submission instead.
+        /// \return true if the transaction's result will be passed to the
+        ///         callback. false if the current batch already contained
+        ///         the transaction or if the controller shut down before
+        ///         the operation could finish.
         auto execute_transaction(transaction::compact_tx tx,
                                  callback_type result_callback)
             -> bool override;
 
+        /// Changes the range of UHS IDs routed to a shard. Replicates the
+        /// change, then waits in the background until every batch routed
+        /// with the previous ranges has finished executing.
+        /// \param shard_id ID of the shard.
+        /// \param range range to route to the shard, which must lie within
+        ///              the shard's configured range, or std::nullopt to
+        ///              route nothing to the shard.
+        /// \param result_callback function to call with true once the
+        ///                        previous routes have drained, or false if
+        ///                        the change failed.
+        /// \return true if the change started.
+        auto set_route(uint64_t shard_id,
+                       std::optional<config::shard_range_t> range,
+                       route_callback_type result_callback) -> bool override;
+
       private:
+        /// \brief Transactions in one batch.
+        ///
+        /// Maps each transaction ID to the sentinel's callback and the
+        /// transaction's index in the batch. Map nodes come from an arena
+        /// owned by the batch, so adding a transaction is a pointer bump
+        /// and the whole map is released at once with the batch.
+        struct batch_txs {
+            /// Constructor.
+            /// \param batch_size expected number of transactions.
+            explicit batch_txs(size_t batch_size);
+
+            std::pmr::monotonic_buffer_resource m_arena;
+            std::pmr::unordered_map<hash_t,
+                                    std::pair<callback_type, size_t>,
+                                    hashing::keyed_mix>
+                m_txs;
+            /// Trace context of the first sampled transaction in the
+            /// batch, under which the batch's execution is traced.
+            std::optional<tracing::context> m_trace;
+            /// Time the traced transaction spent waiting for the batch to
+            /// execute.
+            tracing::span m_wait;
+        };
+
         size_t m_node_id;
         size_t m_coordinator_id;
         cbdc::config::options m_opts;
@@ -143,20 +218,31 @@ namespace cbdc::coordinator {
 
         nuraft::ptr<state_machine> m_state_machine;
         std::shared_ptr<raft::node> m_raft_serv;
+        /// Combines commands from concurrent dtxs into shared log entries.
+        std::unique_ptr<raft::batching_replicator> m_replicator;
         nuraft::raft_params m_raft_params{};
         std::atomic_bool m_running{false};
         std::vector<std::shared_ptr<cbdc::locking_shard::interface>> m_shards;
         std::vector<std::vector<network::endpoint_t>> m_shard_endpoints;
         std::vector<cbdc::config::shard_range_t> m_shard_ranges;
+        /// Range of UHS IDs routed to each shard. Guarded by m_batch_mut.
+        std::vector<std::optional<cbdc::config::shard_range_t>> m_routes;
+        /// Map built from m_routes. Batches hold a reference to the map
+        /// they were routed with until they finish, so a route change can
+        /// wait for them. Guarded by m_batch_mut.
+        std::shared_ptr<const shard_prefix_map> m_route_map;
         random_source m_rnd{config::random_source};
-        std::mutex m_batch_mut;
-        std::condition_variable m_batch_cv;
+        profiled_mutex m_batch_mut{"coordinator_batch"};
+        std::condition_variable_any m_batch_cv;
         std::shared_ptr<distributed_tx> m_current_batch;
-        std::shared_ptr<std::unordered_map<hash_t,
-                                           std::pair<callback_type, size_t>,
-                                           hashing::const_sip_hash<hash_t>>>
-            m_current_txs;
+        std::shared_ptr<batch_txs> m_current_txs;
         size_t m_batch_size;
+        /// Adapts m_batch_size to the latency target, if one is set.
+        /// Guarded by m_batch_mut.
+        std::unique_ptr<batch_sizer> m_batch_sizer;
+        /// Results of transactions executing or recently executed, keyed
+        /// by transaction ID.
+        dedupe_cache<bool> m_recent_txs;
         std::shared_mutex m_shards_mut;
         std::thread m_batch_exec_thread;
         std::unique_ptr<rpc::server> m_rpc_server;
@@ -164,6 +250,26 @@ namespace cbdc::coordinator {
         std::vector<std::pair<std::shared_ptr<std::thread>, std::atomic_bool>>
             m_exec_threads;
         std::shared_mutex m_exec_mut;
+        std::unique_ptr<persistence::write_behind_queue> m_journal;
+        std::unique_ptr<tx_archive> m_archive;
+        /// Waits for batches routed with replaced ranges to drain.
+        std::thread m_route_thread;
+        std::mutex m_route_mut;
+        std::atomic_bool m_routing{false};
+
+        /// Number of recovered dtxs yet to finish on each shard. New txs
+        /// touching a shard wait until its count reaches zero. Guarded by
+        /// m_batch_mut.
+        std::vector<size_t> m_recovering_shards;
+        /// Feeds recovered dtxs to the executor threads in the background.
+        std::thread m_recovery_thread;
+        std::mutex m_recovery_mut;
+        std::condition_variable m_recovery_cv;
+        /// Number of recovered dtxs executing. Guarded by m_recovery_mut.
+        size_t m_recovery_active{0};
+
+        /// Samples the sizes of the controller's structures into gauges.
+        std::unique_ptr<metrics::sampler> m_sampler;
 
         std::thread m_start_thread;
         bool m_start_flag{false};
@@ -174,14 +280,27 @@ namespace cbdc::coordinator {
 
         void start_stop_func();
 
+        void sample_structures();
+
         void start();
 
         void stop();
 
         auto recovery_func() -> bool;
 
+        void recover_dtxs(std::vector<std::shared_ptr<distributed_tx>> dtxs);
+
+        void finish_recovery(const std::vector<size_t>& shards);
+
+        [[nodiscard]] auto recovering(const transaction::compact_tx& tx) const
+            -> bool;
+
         void batch_executor_func();
 
+        void
+        record_latency(bool full,
+                       std::chrono::high_resolution_clock::time_point start);
+
         auto raft_callback(nuraft::cb_func::Type type,
                            nuraft::cb_func::Param* param)
             -> nuraft::cb_func::ReturnCode;
@@ -189,15 +308,27 @@ namespace cbdc::coordinator {
         auto prepare_cb(const hash_t& dtx_id,
                         const std::vector<transaction::compact_tx>& txs)
             -> bool;
-        auto commit_cb(const hash_t& dtx_id,
-                       const std::vector<bool>& complete_txs,
-                       const std::vector<std::vector<uint64_t>>& tx_idxs)
+        auto commit_cb(
+            const hash_t& dtx_id,
+            const std::vector<bool>& complete_txs,
+            const std::vector<std::vector<uint64_t>>& tx_idxs,
+            std::shared_ptr<const std::vector<transaction::compact_tx>> txs)
             -> bool;
         auto discard_cb(const hash_t& dtx_id) -> bool;
         auto done_cb(const hash_t& dtx_id) -> bool;
 
+        void journal(const hash_t& dtx_id, state_machine::command phase);
+
         void batch_set_cbs(distributed_tx& c);
 
+        auto make_batch(std::shared_ptr<const shard_prefix_map> map)
+            -> std::shared_ptr<distributed_tx>;
+
+        void reset_routes(const state_machine::shard_routes& routes);
+
+        void drain_routes(std::weak_ptr<const shard_prefix_map> old_map,
+                          const route_callback_type& cb);
+
         [[nodiscard]] auto replicate_sm_command(const sm_command& c)
             -> std::optional<nuraft::ptr<nuraft::buffer>>;
 
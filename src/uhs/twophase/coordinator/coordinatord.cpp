@@ -4,7 +4,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "controller.hpp"
+#include "util/common/affinity.hpp"
 #include "util/common/config.hpp"
+#include "util/common/profiled_mutex.hpp"
+#include "util/common/tracing.hpp"
+#include "util/network/io_loop.hpp"
+#include "util/rpc/http/metrics_server.hpp"
 
 #include <csignal>
 #include <iostream>
@@ -25,6 +30,13 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    cbdc::set_lock_profiling(opts.m_lock_profiling);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     auto coordinator_id = std::stoull(args[2]);
     auto node_id = std::stoull(args[3]);
@@ -41,6 +53,34 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_coordinator_loglevels[coordinator_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
+
+    auto metrics_server = std::unique_ptr<cbdc::rpc::json_rpc_http_server>();
+    const auto& metrics_ep
+        = opts.m_coordinator_metrics_endpoints[coordinator_id][node_id];
+    if(metrics_ep.has_value()) {
+        metrics_server = cbdc::rpc::start_metrics_server(*metrics_ep);
+        if(!metrics_server) {
+            logger->error("Failed to start metrics server");
+            return -1;
+        }
+    }
+
+    if(opts.m_trace_sample_rate > 0) {
+        const auto trace_name = "coordinator" + std::to_string(coordinator_id)
+                              + "_" + std::to_string(node_id);
+        if(!cbdc::tracing::tracer::global().start(
+               opts.m_trace_sample_rate,
+               opts.m_trace_buffer_size,
+               cbdc::tracing::make_file_exporter(
+                   opts.m_trace_file_prefix + trace_name + ".log",
+                   trace_name))) {
+            logger->error("Failed to start trace exporter");
+            return -1;
+        }
+    }
 
     std::string sha2_impl(SHA256AutoDetect());
     logger->info("using sha2: ", sha2_impl);
@@ -55,9 +95,11 @@ auto main(int argc, char** argv) -> int {
     static std::atomic_bool running{true};
 
     // Wait for CTRL+C etc
-    std::signal(SIGINT, [](int /* sig */) {
+    auto stop = [](int /* sig */) {
         running = false;
-    });
+    };
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
 
     logger->info("Coordinator running...");
 
@@ -69,6 +111,7 @@ auto main(int argc, char** argv) -> int {
 
     logger->info("Shutting down...");
 
+    coord.transfer_leadership();
     coord.quit();
 
     return 0;
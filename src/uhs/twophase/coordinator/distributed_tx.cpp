@@ -5,63 +5,146 @@
 
 #include "distributed_tx.hpp"
 
-#include <future>
+#include "util/common/metrics.hpp"
+#include "util/common/tracing.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
 
 namespace cbdc::coordinator {
+    namespace {
+        auto prepare_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "coordinator_prepare_seconds",
+                    "Time to replicate and lock a dtx on its shards.");
+            return hist;
+        }
+
+        auto commit_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "coordinator_commit_seconds",
+                    "Time to replicate and apply a dtx on its shards.");
+            return hist;
+        }
+
+        auto lock_and_apply_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "coordinator_lock_and_apply_seconds",
+                    "Time to replicate and execute a single-shard dtx.");
+            return hist;
+        }
+
+        /// Collects the results of concurrent shard requests in the order
+        /// they complete, so one thread can wait for all of them.
+        template<typename T>
+        class completion_queue
+            : public std::enable_shared_from_this<completion_queue<T>> {
+          public:
+            /// Returns a callback which queues its result for the given
+            /// shard. The callback keeps the queue alive, so it may be
+            /// called after the waiting thread has given up.
+            auto callback(size_t shard_idx) -> std::function<void(T)> {
+                return [q = this->shared_from_this(), shard_idx](T res) {
+                    {
+                        std::unique_lock<std::mutex> l(q->m_mut);
+                        q->m_results.emplace(shard_idx, std::move(res));
+                    }
+                    q->m_cv.notify_one();
+                };
+            }
+
+            /// Waits for the next result.
+            auto pop() -> std::pair<size_t, T> {
+                std::unique_lock<std::mutex> l(m_mut);
+                m_cv.wait(l, [&]() {
+                    return !m_results.empty();
+                });
+                auto ret = std::move(m_results.front());
+                m_results.pop();
+                return ret;
+            }
+
+          private:
+            std::mutex m_mut;
+            std::condition_variable m_cv;
+            std::queue<std::pair<size_t, T>> m_results;
+        };
+
+        /// Waits for the given number of results from the queue.
+        /// \return false as soon as one of the results is a failure.
+        auto wait_all(completion_queue<bool>& queue, size_t count) -> bool {
+            for(; count > 0; count--) {
+                if(!queue.pop().second) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
     distributed_tx::distributed_tx(
         const hash_t& dtx_id,
         std::vector<std::shared_ptr<locking_shard::interface>> shards,
+        std::shared_ptr<const shard_prefix_map> prefix_map,
         std::shared_ptr<logging::log> logger)
         : m_dtx_id(dtx_id),
           m_shards(std::move(shards)),
+          m_prefix_map(std::move(prefix_map)),
           m_logger(std::move(logger)) {
-        m_txs.resize(m_shards.size());
         m_tx_idxs.resize(m_shards.size());
+        m_active.resize(m_shards.size());
         assert(!m_shards.empty());
+        assert(m_prefix_map->shard_count() == m_shards.size());
     }
 
     auto distributed_tx::prepare() -> std::optional<std::vector<bool>> {
+        auto timer = metrics::scoped_timer(prepare_latency());
+        auto span = tracing::span("coordinator.prepare");
+        auto c = tracing::scoped_context(span.get_context());
         if(m_prepare_cb) {
-            auto res = m_prepare_cb(m_dtx_id, m_full_txs);
+            auto res = m_prepare_cb(m_dtx_id, *m_full_txs);
             if(!res) {
                 m_state = dtx_state::failed;
                 return std::nullopt;
             }
         }
-        auto futures = std::vector<
-            std::pair<std::future<std::optional<std::vector<bool>>>,
-                      size_t>>();
+        auto queue = std::make_shared<
+            completion_queue<std::optional<std::vector<bool>>>>();
+        size_t pending{0};
         for(size_t i{0}; i < m_shards.size(); i++) {
             if(m_tx_idxs[i].empty()) {
                 continue;
             }
-            const auto& shard = m_shards[i];
-            auto f = std::async(std::launch::async,
-                                &locking_shard::interface::lock_outputs,
-                                shard,
-                                std::move(m_txs[i]),
-                                m_dtx_id);
-            futures.emplace_back(std::move(f), i);
+            m_shards[i]->lock_batch_async(
+                locking_shard::tx_batch(m_full_txs, m_tx_idxs[i]),
+                m_dtx_id,
+                queue->callback(i));
+            pending++;
         }
-        auto ret = std::vector<bool>(m_full_txs.size(), true);
-        for(auto& f : futures) {
-            auto res = f.first.get();
+        auto ret = std::vector<bool>(m_full_txs->size(), true);
+        for(; pending > 0; pending--) {
+            auto [shard_idx, res] = queue->pop();
             if(!res) {
                 m_state = dtx_state::failed;
                 return std::nullopt;
             }
-            if(res->size() != m_tx_idxs[f.second].size()) {
+            const auto& idxs = m_tx_idxs[shard_idx];
+            if(res->size() != idxs.size()) {
                 m_logger->fatal(
                     "Shard prepare response has not enough statuses",
                     to_string(m_dtx_id),
                     "expected:",
-                    m_tx_idxs[f.second].size(),
+                    idxs.size(),
                     "got:",
                     res->size());
             }
             for(size_t i{0}; i < res->size(); i++) {
                 if(!(*res)[i]) {
-                    ret[m_tx_idxs[f.second][i]] = false;
+                    ret[idxs[i]] = false;
                 }
             }
         }
@@ -71,6 +154,9 @@ namespace cbdc::coordinator {
 
     auto distributed_tx::commit(const std::vector<bool>& complete_txs)
         -> bool {
+        auto timer = metrics::scoped_timer(commit_latency());
+        auto span = tracing::span("coordinator.commit");
+        auto c = tracing::scoped_context(span.get_context());
         if(m_commit_cb) {
             auto res = m_commit_cb(m_dtx_id, complete_txs, m_tx_idxs);
             if(!res) {
@@ -78,36 +164,99 @@ namespace cbdc::coordinator {
                 return false;
             }
         }
-        auto futures = std::vector<std::future<bool>>();
+        auto queue = std::make_shared<completion_queue<bool>>();
+        size_t pending{0};
         for(size_t i{0}; i < m_shards.size(); i++) {
             if(m_tx_idxs[i].empty()) {
                 continue;
             }
-            const auto& shard = m_shards[i];
             auto shard_complete_txs = std::vector<bool>(m_tx_idxs[i].size());
             for(size_t j{0}; j < shard_complete_txs.size(); j++) {
                 shard_complete_txs[j] = complete_txs[m_tx_idxs[i][j]];
             }
-            auto f = std::async(std::launch::async,
-                                &locking_shard::interface::apply_outputs,
-                                shard,
-                                std::move(shard_complete_txs),
-                                m_dtx_id);
-            futures.emplace_back(std::move(f));
+            m_shards[i]->apply_outputs_async(std::move(shard_complete_txs),
+                                             m_dtx_id,
+                                             queue->callback(i));
+            pending++;
         }
-        for(auto& f : futures) {
-            auto res = f.get();
+        if(!wait_all(*queue, pending)) {
+            m_state = dtx_state::failed;
+            return false;
+        }
+        m_state = dtx_state::discard;
+        return true;
+    }
+
+    auto distributed_tx::single_shard() const -> std::optional<size_t> {
+        auto ret = std::optional<size_t>();
+        for(size_t i{0}; i < m_tx_idxs.size(); i++) {
+            if(m_tx_idxs[i].empty()) {
+                continue;
+            }
+            if(ret.has_value()) {
+                return std::nullopt;
+            }
+            ret = i;
+        }
+        return ret;
+    }
+
+    auto distributed_tx::lock_and_apply(size_t shard_idx)
+        -> std::optional<std::vector<bool>> {
+        auto timer = metrics::scoped_timer(lock_and_apply_latency());
+        auto span = tracing::span("coordinator.lock_and_apply");
+        auto c = tracing::scoped_context(span.get_context());
+        // The prepare record holds the whole batch, which is all recovery
+        // needs to repeat the lock-and-apply. The shard answers a repeat
+        // with its first result, so no commit record is written.
+        if(m_prepare_cb) {
+            auto res = m_prepare_cb(m_dtx_id, *m_full_txs);
             if(!res) {
                 m_state = dtx_state::failed;
-                return false;
+                return std::nullopt;
             }
         }
+        auto res = m_shards[shard_idx]->lock_and_apply_batch(
+            locking_shard::tx_batch(m_full_txs, m_tx_idxs[shard_idx]),
+            m_dtx_id);
+        if(!res) {
+            m_state = dtx_state::failed;
+            return std::nullopt;
+        }
+        const auto& idxs = m_tx_idxs[shard_idx];
+        if(res->size() != idxs.size()) {
+            m_logger->fatal(
+                "Shard lock and apply response has not enough statuses",
+                to_string(m_dtx_id),
+                "expected:",
+                idxs.size(),
+                "got:",
+                res->size());
+        }
+        auto ret = std::vector<bool>(m_full_txs->size(), true);
+        for(size_t i{0}; i < res->size(); i++) {
+            ret[idxs[i]] = (*res)[i];
+        }
         m_state = dtx_state::discard;
-        return true;
+        return ret;
     }
 
     auto distributed_tx::execute() -> std::optional<std::vector<bool>> {
         auto dtxid_str = to_string(m_dtx_id);
+        auto shard_idx = single_shard();
+        if((m_state == dtx_state::prepare || m_state == dtx_state::start)
+           && shard_idx.has_value()) {
+            m_logger->info("Locking and applying", dtxid_str);
+            auto res = lock_and_apply(shard_idx.value());
+            if(!res) {
+                return std::nullopt;
+            }
+            m_complete_txs = std::move(*res);
+            m_logger->info("Locked and applied", dtxid_str);
+            if(m_result_cb) {
+                m_result_cb(m_complete_txs);
+            }
+        }
         if(m_state == dtx_state::prepare || m_state == dtx_state::start) {
             m_logger->info("Preparing", dtxid_str);
             auto res = prepare();
@@ -115,11 +264,11 @@ namespace cbdc::coordinator {
                 return std::nullopt;
             }
             m_complete_txs = std::move(*res);
-            if(m_complete_txs.size() != m_full_txs.size()) {
+            if(m_complete_txs.size() != m_full_txs->size()) {
                 m_logger->fatal("Prepare has incorrect number of statuses",
                                 dtxid_str,
                                 "expected:",
-                                m_full_txs.size(),
+                                m_full_txs->size(),
                                 "got:",
                                 m_complete_txs.size());
             }
@@ -132,6 +281,9 @@ namespace cbdc::coordinator {
                 return std::nullopt;
             }
             m_logger->info("Committed", dtxid_str);
+            if(m_result_cb) {
+                m_result_cb(m_complete_txs);
+            }
         }
         if(m_state == dtx_state::discard) {
             m_logger->info("Discarding", dtxid_str);
@@ -145,39 +297,38 @@ namespace cbdc::coordinator {
     }
 
     auto distributed_tx::add_tx(const transaction::compact_tx& tx) -> size_t {
-        for(size_t i{0}; i < m_shards.size(); i++) {
-            const auto& shard = m_shards[i];
-            auto stx = locking_shard::tx();
-            stx.m_tx = tx;
-            bool active{false};
-            if(shard->hash_in_shard_range(tx.m_id)) {
-                active = true;
-            } else {
-                for(const auto& inp : tx.m_inputs) {
-                    if(shard->hash_in_shard_range(inp)) {
-                        active = true;
-                        break;
-                    }
+        auto mark_active = [&](const hash_t& h) {
+            for(auto shard : m_prefix_map->shards(h)) {
+                if(!m_active[shard]) {
+                    m_active[shard] = true;
+                    m_touched.push_back(shard);
                 }
-                if(!active) {
-                    for(const auto& out : tx.m_uhs_outputs) {
-                        if(shard->hash_in_shard_range(out)) {
-                            active = true;
-                            break;
-                        }
-                    }
-                }
-            }
-            if(active) {
-                m_txs[i].emplace_back(std::move(stx));
-                m_tx_idxs[i].emplace_back(m_full_txs.size());
             }
+        };
+        mark_active(tx.m_id);
+        for(const auto& inp : tx.m_inputs) {
+            mark_active(inp);
+        }
+        for(const auto& out : tx.m_uhs_outputs) {
+            mark_active(out);
+        }
+        const auto idx = m_full_txs->size();
+        for(auto shard : m_touched) {
+            m_tx_idxs[shard].emplace_back(idx);
+            m_active[shard] = false;
         }
-        m_full_txs.emplace_back(tx);
-        return m_full_txs.size() - 1;
+        m_touched.clear();
+        m_full_txs->emplace_back(tx);
+        return idx;
+    }
+
+    void distributed_tx::reserve(size_t n) {
+        m_full_txs->reserve(n);
     }
 
     auto distributed_tx::discard() -> bool {
+        auto span = tracing::span("coordinator.discard");
+        auto c = tracing::scoped_context(span.get_context());
         if(m_discard_cb) {
             auto res = m_discard_cb(m_dtx_id);
             if(!res) {
@@ -185,24 +336,18 @@ namespace cbdc::coordinator {
                 return false;
             }
         }
-        auto futures = std::vector<std::future<bool>>();
+        auto queue = std::make_shared<completion_queue<bool>>();
+        size_t pending{0};
         for(size_t i{0}; i < m_shards.size(); i++) {
             if(m_tx_idxs[i].empty()) {
                 continue;
             }
-            const auto& shard = m_shards[i];
-            auto f = std::async(std::launch::async,
-                                &locking_shard::interface::discard_dtx,
-                                shard,
-                                m_dtx_id);
-            futures.emplace_back(std::move(f));
+            m_shards[i]->discard_dtx_async(m_dtx_id, queue->callback(i));
+            pending++;
         }
-        for(auto& f : futures) {
-            auto res = f.get();
-            if(!res) {
-                m_state = dtx_state::failed;
-                return false;
-            }
+        if(!wait_all(*queue, pending)) {
+            m_state = dtx_state::failed;
+            return false;
         }
         if(m_done_cb) {
             auto res = m_done_cb(m_dtx_id);
@@ -219,6 +364,11 @@ namespace cbdc::coordinator {
         return m_dtx_id;
     }
 
+    auto distributed_tx::get_txs() const
+        -> std::shared_ptr<const std::vector<transaction::compact_tx>> {
+        return m_full_txs;
+    }
+
     void distributed_tx::set_prepare_cb(const prepare_cb_t& cb) {
         m_prepare_cb = cb;
     }
@@ -235,6 +385,10 @@ namespace cbdc::coordinator {
         m_done_cb = cb;
     }
 
+    void distributed_tx::set_result_cb(const result_cb_t& cb) {
+        m_result_cb = cb;
+    }
+
     void distributed_tx::recover_prepare(
         const std::vector<transaction::compact_tx>& txs) {
         m_state = dtx_state::prepare;
@@ -255,8 +409,23 @@ namespace cbdc::coordinator {
         m_state = dtx_state::discard;
     }
 
+    auto distributed_tx::active_shards() const -> std::vector<size_t> {
+        auto ret = std::vector<size_t>();
+        for(size_t i{0}; i < m_tx_idxs.size(); i++) {
+            if(!m_tx_idxs[i].empty()) {
+                ret.push_back(i);
+            }
+        }
+        return ret;
+    }
+
     auto distributed_tx::size() const -> size_t {
-        return std::max(m_full_txs.size(), m_complete_txs.size());
+        return std::max(m_full_txs->size(), m_complete_txs.size());
+    }
+
+    auto distributed_tx::prefix_map() const
+        -> const std::shared_ptr<const shard_prefix_map>& {
+        return m_prefix_map;
     }
 
     auto distributed_tx::get_state() const -> dtx_state {
@@ -10,6 +10,7 @@
 #include "uhs/transaction/transaction.hpp"
 #include "uhs/twophase/locking_shard/locking_shard.hpp"
 #include "util/common/random_source.hpp"
+#include "util/common/shard_prefix_map.hpp"
 #include "util/raft/node.hpp"
 
 #include <memory>
@@ -22,19 +23,26 @@ namespace cbdc::coordinator {
     /// replication).
     class distributed_tx {
       public:
-        /// Constructs a new transaction coordinator instance
-        /// \param dtx_id dtx ID for this transaction batch
-        /// \param shards vector of locking shards that will participate in the
-        ///               dtx. If recovering a previous dtx, the list must
-        ///               refer to the same shards in the same order.
+        /// Constructs a new transaction coordinator instance.
+        /// \param dtx_id dtx ID for this transaction batch.
+        /// \param shards vector of locking shards that will participate in
+        ///               the dtx. If recovering a previous dtx, the list
+        ///               must refer to the same shards in the same order.
+        /// \param prefix_map map from UHS IDs to indices in shards. Built
+        ///                   once by the caller and shared by its dtxs, and
+        ///                   held until the dtx is destroyed.
         /// \param logger logger for messages.
         distributed_tx(
             const hash_t& dtx_id,
             std::vector<std::shared_ptr<locking_shard::interface>> shards,
+            std::shared_ptr<const shard_prefix_map> prefix_map,
             std::shared_ptr<logging::log> logger);
 
         /// Executes the dtx batch to completion or failure, either from start,
         /// or an intermediate state if one of the recover functions were used.
+        /// If only one shard takes part in the batch, the prepare and commit
+        /// phases are replaced by a single lock-and-apply call to that shard,
+        /// and the commit callback is not called.
         /// \return empty optional if the dtx failed, or a vector of flags
         ///         indicating which constituent transactions settled and which
         ///         were rolled back by the transaction's index in the batch.
@@ -50,6 +58,13 @@ namespace cbdc::coordinator {
         /// \return dtx ID for this coordinator
         [[nodiscard]] auto get_id() const -> hash_t;
 
+        /// Returns the transactions in the dtx batch, shared rather than
+        /// copied. Empty if the dtx was recovered in the commit phase or
+        /// later.
+        /// \return transactions in the dtx.
+        [[nodiscard]] auto get_txs() const
+            -> std::shared_ptr<const std::vector<transaction::compact_tx>>;
+
         using discard_cb_t = std::function<bool(const hash_t&)>;
         using done_cb_t = std::function<bool(const hash_t&)>;
         using commit_cb_t
@@ -59,6 +74,7 @@ namespace cbdc::coordinator {
         using prepare_cb_t
             = std::function<bool(const hash_t&,
                                  const std::vector<transaction::compact_tx>&)>;
+        using result_cb_t = std::function<void(const std::vector<bool>&)>;
 
         /// Registers a callback to be called before starting the prepare phase
         /// of the dtx
@@ -95,6 +111,14 @@ namespace cbdc::coordinator {
         ///           sets the dtx state to failed.
         void set_done_cb(const done_cb_t& cb);
 
+        /// Registers a callback to be called once every shard has applied the
+        /// commit phase, before the discard phase starts. The results are
+        /// final at that point, so they can be reported without waiting for
+        /// the discard and done phases to be replicated.
+        /// \param cb callback function taking the vector of flags indicating
+        ///           which transactions settled, by index in the batch.
+        void set_result_cb(const result_cb_t& cb);
+
         /// Sets the state of the dtx to prepare and re-adds all the txs
         /// included in the batch
         /// \param txs list of txs included in the dtx batch
@@ -116,10 +140,26 @@ namespace cbdc::coordinator {
         /// from the discard phase
         void recover_discard();
 
+        /// Returns the shards taking part in the dtx, as far as is known
+        /// in its current phase. A dtx recovered in the discard phase
+        /// reports none.
+        /// \return IDs of the shards with transactions in the batch.
+        [[nodiscard]] auto active_shards() const -> std::vector<size_t>;
+
+        /// Reserves space for the given number of transactions so adding
+        /// them does not reallocate the batch.
+        /// \param n expected number of transactions in the batch.
+        void reserve(size_t n);
+
         /// Returns the number of transactions in the dtx
         /// \return number of transactions in the batch
         [[nodiscard]] auto size() const -> size_t;
 
+        /// Returns the map used to route UHS IDs to shards.
+        /// \return shared prefix map.
+        [[nodiscard]] auto prefix_map() const
+            -> const std::shared_ptr<const shard_prefix_map>&;
+
         enum class dtx_state {
             /// dtx initial state, no action has been performed yet
             start,
@@ -150,17 +190,30 @@ namespace cbdc::coordinator {
         [[nodiscard]] auto commit(const std::vector<bool>& complete_txs)
             -> bool;
 
+        [[nodiscard]] auto single_shard() const -> std::optional<size_t>;
+
+        [[nodiscard]] auto lock_and_apply(size_t shard_idx)
+            -> std::optional<std::vector<bool>>;
+
         auto discard() -> bool;
 
         hash_t m_dtx_id;
         std::vector<std::shared_ptr<locking_shard::interface>> m_shards;
-        std::vector<std::vector<locking_shard::tx>> m_txs;
-        std::vector<transaction::compact_tx> m_full_txs;
+        std::shared_ptr<const shard_prefix_map> m_prefix_map;
+        /// Transactions of the batch, shared by the requests to every
+        /// shard, which refer to them by their indices in m_tx_idxs.
+        std::shared_ptr<std::vector<transaction::compact_tx>> m_full_txs{
+            std::make_shared<std::vector<transaction::compact_tx>>()};
         std::vector<std::vector<uint64_t>> m_tx_idxs;
+        // Per-shard flags and list of flagged shards reused by add_tx to
+        // avoid allocating per tx
+        std::vector<bool> m_active;
+        std::vector<size_t> m_touched;
         prepare_cb_t m_prepare_cb;
         commit_cb_t m_commit_cb;
         discard_cb_t m_discard_cb;
         done_cb_t m_done_cb;
+        result_cb_t m_result_cb;
         dtx_state m_state{dtx_state::start};
         std::vector<bool> m_complete_txs;
         std::shared_ptr<logging::log> m_logger;
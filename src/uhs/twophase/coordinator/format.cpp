@@ -11,17 +11,247 @@
 #include "util/raft/messages.hpp"
 #include "util/serialization/format.hpp"
 
+#include <climits>
+
+namespace cbdc::coordinator {
+    namespace {
+        // Set in the command byte of log entries with compact payloads.
+        constexpr uint8_t compact_flag{0x80};
+        constexpr uint8_t varint_more{0x80};
+        constexpr unsigned varint_bits{7};
+        constexpr unsigned varint_max_bytes{10};
+
+        void write_varint(serializer& ser, uint64_t val) {
+            while(val >= varint_more) {
+                ser << static_cast<uint8_t>(val | varint_more);
+                val >>= varint_bits;
+            }
+            ser << static_cast<uint8_t>(val);
+        }
+
+        auto read_varint(serializer& deser) -> uint64_t {
+            uint64_t ret{0};
+            for(unsigned i{0}; i < varint_max_bytes; i++) {
+                uint8_t byte{0};
+                if(!(deser >> byte)) {
+                    break;
+                }
+                ret |= static_cast<uint64_t>(byte & (varint_more - 1))
+                    << (i * varint_bits);
+                if((byte & varint_more) == 0) {
+                    break;
+                }
+            }
+            return ret;
+        }
+
+        // Bounds the up-front allocation in case a count is corrupt.
+        template<typename V>
+        void reserve(V& vec, uint64_t len) {
+            using T = typename V::value_type;
+            vec.reserve(static_cast<size_t>(
+                std::min<uint64_t>(len,
+                                   config::maximum_reservation / sizeof(T))));
+        }
+
+        void write_hashes(serializer& ser,
+                          const transaction::compact_hashes& hashes) {
+            write_varint(ser, hashes.size());
+            for(const auto& h : hashes) {
+                ser << h;
+            }
+        }
+
+        void read_hashes(serializer& deser,
+                         transaction::compact_hashes& hashes) {
+            auto len = read_varint(deser);
+            hashes.clear();
+            reserve(hashes, len);
+            for(uint64_t i{0}; i < len && deser; i++) {
+                auto h = hash_t();
+                deser >> h;
+                hashes.push_back(h);
+            }
+        }
+
+        auto read_payload(serializer& deser, controller::prepare_tx& txs)
+            -> bool {
+            auto enc = uint8_t();
+            if(!(deser >> enc)) {
+                return false;
+            }
+            switch(static_cast<payload_encoding>(enc)) {
+                case payload_encoding::legacy:
+                    return static_cast<bool>(deser >> txs);
+                case payload_encoding::compact:
+                    return read_compact(deser, txs);
+            }
+            return false;
+        }
+
+        auto read_payload(serializer& deser, controller::commit_tx& c)
+            -> bool {
+            auto enc = uint8_t();
+            if(!(deser >> enc)) {
+                return false;
+            }
+            switch(static_cast<payload_encoding>(enc)) {
+                case payload_encoding::legacy:
+                    return static_cast<bool>(deser >> c);
+                case payload_encoding::compact:
+                    return read_compact(deser, c);
+            }
+            return false;
+        }
+
+        template<typename T>
+        auto read_payloads(
+            serializer& deser,
+            std::unordered_map<hash_t, T, hashing::const_sip_hash<hash_t>>&
+                map) -> bool {
+            auto len = uint64_t();
+            if(!(deser >> len)) {
+                return false;
+            }
+            map.clear();
+            for(uint64_t i{0}; i < len; i++) {
+                auto dtx_id = hash_t();
+                auto payload = T();
+                if(!(deser >> dtx_id) || !read_payload(deser, payload)) {
+                    return false;
+                }
+                map.emplace(dtx_id, std::move(payload));
+            }
+            return true;
+        }
+    }
+
+    void write_compact(serializer& ser, const controller::prepare_tx& txs) {
+        write_varint(ser, txs.size());
+        for(const auto& tx : txs) {
+            ser << tx.m_id;
+            write_hashes(ser, tx.m_inputs);
+            write_hashes(ser, tx.m_uhs_outputs);
+            if(tx.m_aggregate.has_value()) {
+                write_varint(ser, transaction::aggregate_attestation_marker);
+                ser << tx.m_aggregate.value();
+                continue;
+            }
+            write_varint(ser, tx.m_attestations.size());
+            for(const auto& [key, sig] : tx.m_attestations) {
+                ser << key << sig;
+            }
+        }
+    }
+
+    auto read_compact(serializer& deser, controller::prepare_tx& txs) -> bool {
+        auto len = read_varint(deser);
+        txs.clear();
+        reserve(txs, len);
+        for(uint64_t i{0}; i < len && deser; i++) {
+            auto tx = transaction::compact_tx();
+            deser >> tx.m_id;
+            read_hashes(deser, tx.m_inputs);
+            read_hashes(deser, tx.m_uhs_outputs);
+            auto n_att = read_varint(deser);
+            if(n_att == transaction::aggregate_attestation_marker) {
+                tx.m_aggregate.emplace();
+                deser >> tx.m_aggregate.value();
+                n_att = 0;
+            }
+            for(uint64_t j{0}; j < n_att && deser; j++) {
+                auto key = pubkey_t();
+                auto sig = signature_t();
+                deser >> key >> sig;
+                tx.m_attestations.emplace(key, sig);
+            }
+            txs.push_back(std::move(tx));
+        }
+        return static_cast<bool>(deser);
+    }
+
+    void write_compact(serializer& ser, const controller::commit_tx& c) {
+        const auto& [flags, idxs] = c;
+        write_varint(ser, flags.size());
+        for(size_t i{0}; i < flags.size(); i += CHAR_BIT) {
+            uint8_t byte{0};
+            for(size_t j{0}; j < CHAR_BIT && i + j < flags.size(); j++) {
+                if(flags[i + j]) {
+                    byte = static_cast<uint8_t>(byte | (1U << j));
+                }
+            }
+            ser << byte;
+        }
+        // Each shard's indices ascend, so the gaps between them are small.
+        write_varint(ser, idxs.size());
+        for(const auto& shard_idxs : idxs) {
+            write_varint(ser, shard_idxs.size());
+            uint64_t prev{0};
+            for(auto idx : shard_idxs) {
+                write_varint(ser, idx - prev);
+                prev = idx;
+            }
+        }
+    }
+
+    auto read_compact(serializer& deser, controller::commit_tx& c) -> bool {
+        auto& [flags, idxs] = c;
+        auto len = read_varint(deser);
+        flags.clear();
+        flags.reserve(static_cast<size_t>(
+            std::min<uint64_t>(len, config::maximum_reservation * CHAR_BIT)));
+        for(uint64_t i{0}; i < len && deser; i += CHAR_BIT) {
+            uint8_t byte{0};
+            deser >> byte;
+            for(uint64_t j{0}; j < CHAR_BIT && i + j < len; j++) {
+                flags.push_back(((byte >> j) & 1U) != 0);
+            }
+        }
+        auto n_shards = read_varint(deser);
+        idxs.clear();
+        reserve(idxs, n_shards);
+        for(uint64_t i{0}; i < n_shards && deser; i++) {
+            auto& shard_idxs = idxs.emplace_back();
+            auto n_idxs = read_varint(deser);
+            reserve(shard_idxs, n_idxs);
+            uint64_t prev{0};
+            for(uint64_t j{0}; j < n_idxs && deser; j++) {
+                prev += read_varint(deser);
+                shard_idxs.push_back(prev);
+            }
+        }
+        return static_cast<bool>(deser);
+    }
+}
+
 namespace cbdc {
     auto operator<<(serializer& ser,
                     const coordinator::state_machine::coordinator_state& s)
         -> serializer& {
-        return ser << s.m_prepare_txs << s.m_commit_txs << s.m_discard_txs;
+        return ser << coordinator::coordinator_state_version << s.m_prepare_txs
+                   << s.m_commit_txs << s.m_discard_txs << s.m_routes;
     }
 
     auto operator>>(serializer& deser,
                     coordinator::controller::coordinator_state& s)
         -> serializer& {
-        return deser >> s.m_prepare_txs >> s.m_commit_txs >> s.m_discard_txs;
+        // Stops early on an unknown version or payload encoding, leaving
+        // the rest of the buffer unread for the caller to detect.
+        static constexpr uint8_t unrouted_version{1};
+        auto version = uint8_t();
+        if(!(deser >> version)
+           || (version != coordinator::coordinator_state_version
+               && version != unrouted_version)
+           || !coordinator::read_payloads(deser, s.m_prepare_txs)
+           || !coordinator::read_payloads(deser, s.m_commit_txs)
+           || !(deser >> s.m_discard_txs)) {
+            return deser;
+        }
+        s.m_routes.clear();
+        if(version == unrouted_version) {
+            return deser;
+        }
+        return deser >> s.m_routes;
     }
 
     auto operator<<(serializer& ser,
@@ -33,20 +263,35 @@ namespace cbdc {
                 const auto& data
                     = std::get<coordinator::controller::prepare_tx>(
                         c.m_data.value());
-                ser << data;
+                if(c.m_header.m_compact) {
+                    coordinator::write_compact(ser, data);
+                } else {
+                    ser << data;
+                }
                 break;
             }
             case coordinator::state_machine::command::commit: {
                 const auto& data
                     = std::get<coordinator::controller::commit_tx>(
                         c.m_data.value());
-                ser << data;
+                if(c.m_header.m_compact) {
+                    coordinator::write_compact(ser, data);
+                } else {
+                    ser << data;
+                }
                 break;
             }
-            // Discard, done and get don't have a payload
+            case coordinator::state_machine::command::route: {
+                ser << std::get<coordinator::controller::route_update>(
+                    c.m_data.value());
+                break;
+            }
+            // Discard, done and get don't have a payload. Batch entries
+            // are assembled by the raft batching replicator.
             case coordinator::state_machine::command::discard:
             case coordinator::state_machine::command::done:
-            case coordinator::state_machine::command::get: {
+            case coordinator::state_machine::command::get:
+            case coordinator::state_machine::command::batch: {
                 break;
             }
         }
@@ -56,7 +301,11 @@ namespace cbdc {
     auto operator<<(serializer& ser,
                     const coordinator::controller::sm_command_header& c)
         -> serializer& {
-        return ser << static_cast<uint8_t>(c.m_comm) << c.m_dtx_id;
+        auto comm = static_cast<uint8_t>(c.m_comm);
+        if(c.m_compact) {
+            comm = static_cast<uint8_t>(comm | coordinator::compact_flag);
+        }
+        return ser << comm << c.m_dtx_id;
     }
 
     auto operator>>(serializer& deser,
@@ -64,6 +313,8 @@ namespace cbdc {
         -> serializer& {
         uint8_t comm{};
         deser >> comm;
+        c.m_compact = (comm & coordinator::compact_flag) != 0;
+        comm = static_cast<uint8_t>(comm & ~coordinator::compact_flag);
         c.m_comm = static_cast<coordinator::state_machine::command>(comm);
         deser >> c.m_dtx_id;
         return deser;
@@ -9,6 +9,42 @@
 #include "controller.hpp"
 #include "state_machine.hpp"
 
+namespace cbdc::coordinator {
+    /// Encoding of a prepare or commit payload stored by the state machine.
+    enum class payload_encoding : uint8_t {
+        /// Generic serialization, as logged by earlier versions.
+        legacy = 0,
+        /// Variable-length counts, commit flags as a bitmap and
+        /// delta-encoded shard index lists.
+        compact = 1
+    };
+
+    /// Version of the coordinator state returned by the get command. Each
+    /// stored payload is prefixed with its \ref payload_encoding. Version 2
+    /// appends the shard routes.
+    static constexpr uint8_t coordinator_state_version{2};
+
+    /// Serializes a prepare payload in the compact encoding.
+    /// \param ser serializer to write to.
+    /// \param txs transactions in the dtx batch.
+    void write_compact(serializer& ser, const controller::prepare_tx& txs);
+    /// Deserializes a prepare payload in the compact encoding.
+    /// \param deser serializer to read from.
+    /// \param txs set to the transactions in the dtx batch.
+    /// \return false if the payload was invalid.
+    auto read_compact(serializer& deser, controller::prepare_tx& txs) -> bool;
+
+    /// Serializes a commit payload in the compact encoding.
+    /// \param ser serializer to write to.
+    /// \param c prepare results and shard index lists.
+    void write_compact(serializer& ser, const controller::commit_tx& c);
+    /// Deserializes a commit payload in the compact encoding.
+    /// \param deser serializer to read from.
+    /// \param c set to the prepare results and shard index lists.
+    /// \return false if the payload was invalid.
+    auto read_compact(serializer& deser, controller::commit_tx& c) -> bool;
+}
+
 namespace cbdc {
     auto operator<<(serializer& ser,
                     const coordinator::state_machine::coordinator_state& s)
@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_COORDINATOR_INTERFACE_H_
 
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/config.hpp"
 
 #include <functional>
 
@@ -41,6 +42,27 @@ namespace cbdc::coordinator {
         virtual auto execute_transaction(transaction::compact_tx tx,
                                          callback_type result_callback) -> bool
             = 0;
+
+        /// Signature of callback function for the result of a route change.
+        using route_callback_type = std::function<void(bool)>;
+
+        /// Changes the range of UHS IDs the coordinator routes to a locking
+        /// shard, so the range can be moved between shards while the system
+        /// runs. Not supported by default.
+        /// \param shard_id ID of the shard.
+        /// \param range range of UHS ID prefixes to route to the shard, or
+        ///              std::nullopt to route nothing to it.
+        /// \param result_callback function to call with true once no
+        ///                        transactions routed with the previous range
+        ///                        are executing, or false if the change
+        ///                        failed.
+        /// \return true if the implementation started the change.
+        virtual auto set_route(uint64_t /* shard_id */,
+                               std::optional<config::shard_range_t> /* range */,
+                               route_callback_type /* result_callback */)
+            -> bool {
+            return false;
+        }
     };
 }
 
@@ -7,13 +7,34 @@
 #define OPENCBDC_TX_SRC_COORDINATOR_MESSAGES_H_
 
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/config.hpp"
+
+#include <optional>
+#include <variant>
+#include <vector>
 
 namespace cbdc::coordinator::rpc {
-    /// Coordinator RPC request message; a compact transaction.
-    using request = transaction::compact_tx;
-    /// Coordinator RPC response message; a boolean, true if the coordinator
-    /// completed the transaction, false otherwise.
-    using response = bool;
+    /// Compact transactions to execute independently of each other.
+    using batch_request = std::vector<transaction::compact_tx>;
+    /// Execution result of each transaction in a \ref batch_request, by
+    /// index. std::nullopt if the coordinator failed to execute the
+    /// transaction.
+    using batch_response = std::vector<std::optional<bool>>;
+
+    /// Shard ID and the range of UHS ID prefixes to route to it, or
+    /// std::nullopt to route nothing to the shard.
+    using route_request
+        = std::pair<uint64_t, std::optional<config::shard_range_t>>;
+
+    /// Coordinator RPC request message; a compact transaction, a batch of
+    /// them, or a route change.
+    using request = std::
+        variant<transaction::compact_tx, batch_request, route_request>;
+    /// Coordinator RPC response message; for a single transaction, a
+    /// boolean, true if the coordinator completed the transaction, false
+    /// otherwise. For a batch, a \ref batch_response. For a route change,
+    /// true once the previous route has drained.
+    using response = std::variant<bool, batch_response>;
 }
 
 #endif // OPENCBDC_TX_SRC_COORDINATOR_MESSAGES_H_
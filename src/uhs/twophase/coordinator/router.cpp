@@ -0,0 +1,172 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "router.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace cbdc::coordinator::rpc {
+    namespace {
+        /// Rendezvous score of a cluster for a transaction. Transaction IDs
+        /// are already uniform, so mixing in the cluster index with
+        /// SplitMix64 is enough, and every process ranks clusters the same.
+        auto score(const hash_t& tx_id, size_t idx) -> uint64_t {
+            uint64_t x{};
+            std::memcpy(&x, tx_id.data(), sizeof(x));
+            static constexpr uint64_t golden{0x9e3779b97f4a7c15};
+            static constexpr uint64_t mul1{0xbf58476d1ce4e5b9};
+            static constexpr uint64_t mul2{0x94d049bb133111eb};
+            static constexpr unsigned shift1{30};
+            static constexpr unsigned shift2{27};
+            static constexpr unsigned shift3{31};
+            x += golden * (idx + 1);
+            x = (x ^ (x >> shift1)) * mul1;
+            x = (x ^ (x >> shift2)) * mul2;
+            return x ^ (x >> shift3);
+        }
+    }
+
+    router::router(std::vector<std::vector<network::endpoint_t>> clusters,
+                   std::shared_ptr<logging::log> logger,
+                   cbdc::rpc::tcp_client_options opts)
+        : m_logger(std::move(logger)) {
+        for(auto& endpoints : clusters) {
+            auto c = std::make_unique<cluster>();
+            c->m_client = std::make_unique<client>(std::move(endpoints), opts);
+            m_clusters.push_back(std::move(c));
+        }
+    }
+
+    auto router::init() -> bool {
+        auto any = false;
+        for(size_t i{0}; i < m_clusters.size(); i++) {
+            if(m_clusters[i]->m_client->init()) {
+                any = true;
+            } else {
+                m_logger->warn("Failed to connect to coordinator", i);
+                report(i, false);
+            }
+        }
+        return any;
+    }
+
+    auto router::pick(const hash_t& tx_id) const -> size_t {
+        if(m_clusters.size() == 1) {
+            return 0;
+        }
+        auto ranked = std::vector<std::pair<uint64_t, size_t>>();
+        ranked.reserve(m_clusters.size());
+        for(size_t i{0}; i < m_clusters.size(); i++) {
+            ranked.emplace_back(score(tx_id, i), i);
+        }
+        std::sort(ranked.begin(), ranked.end(), std::greater<>());
+
+        auto healthy = std::vector<size_t>();
+        {
+            const auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> l(m_health_mut);
+            for(const auto& r : ranked) {
+                if(m_clusters[r.second]->m_down_until <= now) {
+                    healthy.push_back(r.second);
+                }
+            }
+        }
+        if(healthy.empty()) {
+            // Probe the preferred cluster rather than refusing to send
+            return ranked.front().second;
+        }
+
+        auto least = std::numeric_limits<size_t>::max();
+        for(auto i : healthy) {
+            least = std::min(least, m_clusters[i]->m_in_flight.load());
+        }
+        const auto limit = least * 2 + spill_slack;
+        for(auto i : healthy) {
+            if(m_clusters[i]->m_in_flight <= limit) {
+                return i;
+            }
+        }
+        return healthy.front();
+    }
+
+    auto router::execute_transaction(size_t cluster,
+                                     transaction::compact_tx tx,
+                                     interface::callback_type result_callback)
+        -> bool {
+        auto& c = *m_clusters[cluster];
+        c.m_in_flight++;
+        auto sent = c.m_client->execute_transaction(
+            std::move(tx),
+            [&, cluster, cb = std::move(result_callback)](
+                std::optional<bool> res) {
+                m_clusters[cluster]->m_in_flight--;
+                report(cluster, res.has_value());
+                cb(res);
+            });
+        if(!sent) {
+            c.m_in_flight--;
+            report(cluster, false);
+        }
+        return sent;
+    }
+
+    auto router::execute_transactions(
+        size_t cluster,
+        batch_request txs,
+        client::batch_callback_type result_callback) -> bool {
+        auto& c = *m_clusters[cluster];
+        const auto n = txs.size();
+        c.m_in_flight += n;
+        auto sent = c.m_client->execute_transactions(
+            std::move(txs),
+            [&, cluster, n, cb = std::move(result_callback)](
+                std::optional<batch_response> res) {
+                m_clusters[cluster]->m_in_flight -= n;
+                // A coordinator which failed some transactions is likely
+                // recovering or losing leadership
+                report(cluster,
+                       res.has_value()
+                           && std::all_of(res->begin(),
+                                          res->end(),
+                                          [](const auto& r) {
+                                              return r.has_value();
+                                          }));
+                cb(std::move(res));
+            });
+        if(!sent) {
+            c.m_in_flight -= n;
+            report(cluster, false);
+        }
+        return sent;
+    }
+
+    auto router::await_connection(std::chrono::milliseconds timeout) -> bool {
+        const auto per_cluster
+            = timeout / static_cast<int64_t>(std::max<size_t>(size(), 1));
+        auto any = false;
+        for(auto& c : m_clusters) {
+            any = c->m_client->await_connection(per_cluster) || any;
+        }
+        return any;
+    }
+
+    auto router::size() const -> size_t {
+        return m_clusters.size();
+    }
+
+    void router::report(size_t idx, bool ok) {
+        auto& c = *m_clusters[idx];
+        std::lock_guard<std::mutex> l(m_health_mut);
+        if(ok) {
+            c.m_backoff = std::chrono::milliseconds(0);
+            c.m_down_until = {};
+            return;
+        }
+        c.m_backoff = std::clamp(c.m_backoff * 2, min_backoff, max_backoff);
+        c.m_down_until = std::chrono::steady_clock::now() + c.m_backoff;
+    }
+}
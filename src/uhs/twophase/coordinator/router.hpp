@@ -0,0 +1,101 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COORDINATOR_ROUTER_H_
+#define OPENCBDC_TX_SRC_COORDINATOR_ROUTER_H_
+
+#include "client.hpp"
+#include "util/common/logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace cbdc::coordinator::rpc {
+    /// \brief Spreads transactions across several coordinator clusters.
+    ///
+    /// Each transaction goes to the cluster ranked highest for its ID by
+    /// rendezvous hashing, so every sender picks the same cluster for the
+    /// same transaction and adding a cluster only moves the transactions
+    /// it now ranks highest for. Clusters which fail requests are skipped
+    /// for an increasing back-off period, and a cluster with many more
+    /// transactions in flight than the least loaded one hands its next
+    /// transactions to the next cluster in the ranking.
+    class router {
+      public:
+        /// Constructor.
+        /// \param clusters RPC endpoints of each coordinator cluster.
+        /// \param logger log instance.
+        /// \param opts flow control settings for each cluster's client.
+        router(std::vector<std::vector<network::endpoint_t>> clusters,
+               std::shared_ptr<logging::log> logger,
+               cbdc::rpc::tcp_client_options opts = {});
+
+        /// Connects to the coordinator clusters.
+        /// \return true if at least one cluster is reachable.
+        auto init() -> bool;
+
+        /// Returns the cluster to send a transaction to.
+        /// \param tx_id ID of the transaction.
+        /// \return index of the cluster.
+        [[nodiscard]] auto pick(const hash_t& tx_id) const -> size_t;
+
+        /// Sends a transaction to a cluster. \see client::execute_transaction
+        /// \param cluster index of the cluster.
+        /// \param tx transaction to execute.
+        /// \param result_callback function to call with the result.
+        /// \return true if the request was sent.
+        auto execute_transaction(size_t cluster,
+                                 transaction::compact_tx tx,
+                                 interface::callback_type result_callback)
+            -> bool;
+
+        /// Sends a batch of transactions to a cluster.
+        /// \see client::execute_transactions
+        /// \param cluster index of the cluster.
+        /// \param txs transactions to execute.
+        /// \param result_callback function to call with the results.
+        /// \return true if the request was sent.
+        auto execute_transactions(size_t cluster,
+                                  batch_request txs,
+                                  client::batch_callback_type result_callback)
+            -> bool;
+
+        /// Waits until any cluster is connected.
+        /// \param timeout maximum time to wait.
+        /// \return true if a cluster is connected.
+        auto await_connection(std::chrono::milliseconds timeout) -> bool;
+
+        /// Returns the number of coordinator clusters.
+        /// \return cluster count.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
+        struct cluster {
+            std::unique_ptr<client> m_client;
+            /// Transactions sent and not yet answered.
+            std::atomic<size_t> m_in_flight{0};
+            /// Time before which the cluster is skipped. Guarded by
+            /// m_health_mut.
+            std::chrono::steady_clock::time_point m_down_until{};
+            /// Back-off after the last failure. Guarded by m_health_mut.
+            std::chrono::milliseconds m_backoff{0};
+        };
+
+        static constexpr auto min_backoff = std::chrono::milliseconds(100);
+        static constexpr auto max_backoff = std::chrono::milliseconds(5000);
+        /// In-flight transactions a cluster may have beyond twice those of
+        /// the least loaded cluster before it is passed over.
+        static constexpr size_t spill_slack{1000};
+
+        void report(size_t idx, bool ok);
+
+        std::vector<std::unique_ptr<cluster>> m_clusters;
+        std::shared_ptr<logging::log> m_logger;
+        mutable std::mutex m_health_mut;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COORDINATOR_ROUTER_H_
@@ -5,6 +5,10 @@
 
 #include "server.hpp"
 
+#include "util/common/variant_overloaded.hpp"
+
+#include <mutex>
+
 namespace cbdc::coordinator::rpc {
     server::server(
         interface* impl,
@@ -12,10 +16,82 @@ namespace cbdc::coordinator::rpc {
         : m_impl(impl),
           m_srv(std::move(srv)) {
         m_srv->register_handler_callback(
-            [&](request req,
-                std::function<void(std::optional<bool>)> callback) {
-                return m_impl->execute_transaction(std::move(req),
-                                                   std::move(callback));
+            [&](request req, response_callback_type callback) {
+                return std::visit(
+                    overloaded{[&](transaction::compact_tx& tx) {
+                                   return execute_transaction(
+                                       std::move(tx),
+                                       std::move(callback));
+                               },
+                               [&](batch_request& txs) {
+                                   return execute_batch(std::move(txs),
+                                                        std::move(callback));
+                               },
+                               [&](route_request& route) {
+                                   return m_impl->set_route(
+                                       route.first,
+                                       route.second,
+                                       [cb = std::move(callback)](bool res) {
+                                           cb(response{res});
+                                       });
+                               }},
+                    req);
+            });
+    }
+
+    auto server::execute_transaction(transaction::compact_tx tx,
+                                     response_callback_type callback)
+        -> bool {
+        return m_impl->execute_transaction(
+            std::move(tx),
+            [cb = std::move(callback)](std::optional<bool> res) {
+                if(!res.has_value()) {
+                    cb(std::nullopt);
+                    return;
+                }
+                cb(response{res.value()});
             });
     }
+
+    auto server::execute_batch(batch_request txs,
+                               response_callback_type callback) -> bool {
+        if(txs.empty()) {
+            callback(response{batch_response()});
+            return true;
+        }
+
+        // Responds once every transaction in the batch has a result.
+        struct batch_state {
+            std::mutex m_mut;
+            batch_response m_results;
+            size_t m_pending;
+            response_callback_type m_cb;
+        };
+        auto state = std::make_shared<batch_state>();
+        state->m_results.resize(txs.size());
+        state->m_pending = txs.size();
+        state->m_cb = std::move(callback);
+        auto complete = [state](size_t idx, std::optional<bool> res) {
+            {
+                std::unique_lock<std::mutex> l(state->m_mut);
+                state->m_results[idx] = res;
+                if(--state->m_pending > 0) {
+                    return;
+                }
+            }
+            state->m_cb(response{std::move(state->m_results)});
+        };
+
+        for(size_t i{0}; i < txs.size(); i++) {
+            auto started = m_impl->execute_transaction(
+                std::move(txs[i]),
+                [complete, i](std::optional<bool> res) {
+                    complete(i, res);
+                });
+            if(!started) {
+                complete(i, std::nullopt);
+            }
+        }
+        return true;
+    }
 }
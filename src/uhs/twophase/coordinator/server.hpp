@@ -24,6 +24,15 @@ namespace cbdc::coordinator::rpc {
             std::unique_ptr<cbdc::rpc::async_server<request, response>> srv);
 
       private:
+        using response_callback_type
+            = std::function<void(std::optional<response>)>;
+
+        auto execute_transaction(transaction::compact_tx tx,
+                                 response_callback_type callback) -> bool;
+
+        auto execute_batch(batch_request txs, response_callback_type callback)
+            -> bool;
+
         interface* m_impl;
         std::unique_ptr<cbdc::rpc::async_server<request, response>> m_srv;
     };
@@ -0,0 +1,226 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COORDINATOR_SNAPSHOT_STORE_H_
+#define OPENCBDC_TX_SRC_COORDINATOR_SNAPSHOT_STORE_H_
+
+#include "util/common/buffer.hpp"
+#include "util/common/config.hpp"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <libnuraft/nuraft.hxx>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace cbdc::coordinator {
+    /// \brief Directory of incremental coordinator snapshots.
+    ///
+    /// The snapshot at a raft log index is a chain of files: a base file
+    /// holding every dtx the coordinator tracked at some earlier index,
+    /// followed by one delta file per later snapshot holding only the dtxs
+    /// whose phase changed since the previous one. Each file also holds the
+    /// shard routes at its own index, so a chain's routes come from its
+    /// newest file. Files are serialized and written on a background
+    /// thread from copies of the entries, which share the immutable payload
+    /// buffers with the state machine. Once a chain grows past the merge
+    /// threshold, the same thread folds it into a new base file and deletes
+    /// the files it replaces. Chains are sent to other nodes file by file,
+    /// in chunks; merges and deletions are put off while a chain is being
+    /// sent, as they would renumber its objects.
+    class snapshot_store {
+      public:
+        /// Phase of a dtx recorded in a snapshot file.
+        enum class phase : uint8_t {
+            prepare = 0, ///< In the prepare map, with its payload.
+            commit = 1,  ///< In the commit map, with its payload.
+            discard = 2, ///< In the discard set.
+            done = 3     ///< No longer tracked. Only in delta files.
+        };
+
+        /// Dtx recorded in a snapshot file.
+        struct entry {
+            /// ID of the dtx.
+            hash_t m_dtx_id{};
+            /// Phase of the dtx.
+            phase m_phase{phase::done};
+            /// Stored payload in the prepare and commit phases, prefixed
+            /// with its encoding. nullptr in the other phases.
+            nuraft::ptr<nuraft::buffer> m_payload;
+        };
+
+        /// UHS ID ranges routed to shards, see
+        /// \ref state_machine::shard_routes.
+        using shard_routes
+            = std::unordered_map<uint64_t,
+                                 std::optional<config::shard_range_t>>;
+
+        /// Snapshot loaded from a chain.
+        struct image {
+            /// Raft metadata of the snapshot.
+            nuraft::ptr<nuraft::snapshot> m_snp;
+            /// Every dtx tracked at the snapshot, in no particular order.
+            std::vector<entry> m_dtxs;
+            /// Shard routes at the snapshot.
+            shard_routes m_routes;
+        };
+
+        /// Function called with whether a queued snapshot was written.
+        using done_callback_type = std::function<void(bool)>;
+
+        /// Maximum number of file bytes in one transferred snapshot object.
+        static constexpr size_t chunk_size = 4 * 1024 * 1024;
+
+        /// Time after the last object read from a snapshot at which an
+        /// unfinished transfer no longer pins it.
+        static constexpr auto pin_timeout = std::chrono::seconds(60);
+
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param dir directory in which to store snapshot files.
+        /// \param merge_deltas number of delta files after which a chain is
+        ///                     merged into a new base file. Zero disables
+        ///                     merging.
+        snapshot_store(std::shared_ptr<logging::log> logger,
+                       std::string dir,
+                       size_t merge_deltas);
+
+        /// Writes any queued snapshots, then stops the writer thread.
+        ~snapshot_store();
+
+        snapshot_store(const snapshot_store&) = delete;
+        auto operator=(const snapshot_store&) -> snapshot_store& = delete;
+        snapshot_store(snapshot_store&&) = delete;
+        auto operator=(snapshot_store&&) -> snapshot_store& = delete;
+
+        /// Creates the snapshot directory, removes partially written files,
+        /// finds the newest complete chain and starts the writer thread.
+        /// \return true if the directory was readable.
+        auto init() -> bool;
+
+        /// Checks whether a delta can be written, which requires a chain
+        /// whose newest file matches the state machine's tracked changes.
+        /// Only meaningful while no write is queued.
+        /// \return true if there is a current chain.
+        [[nodiscard]] auto has_chain() const -> bool;
+
+        /// Queues a snapshot file to be written by the writer thread.
+        /// \param snp raft metadata of the snapshot.
+        /// \param is_base true to start a new chain with every tracked dtx,
+        ///                false to extend the current chain with the dtxs
+        ///                changed since its newest file. A delta fails if
+        ///                the chain was abandoned, so the next snapshot
+        ///                must be a base file.
+        /// \param dtxs dtxs to record.
+        /// \param routes shard routes at the snapshot.
+        /// \param done_cb function to call once the file is written or
+        ///                writing failed. Called on the writer thread.
+        void write(nuraft::snapshot& snp,
+                   bool is_base,
+                   std::vector<entry> dtxs,
+                   shard_routes routes,
+                   done_callback_type done_cb);
+
+        /// Returns the raft metadata of the newest complete snapshot.
+        /// \return snapshot metadata, or nullptr if there is none.
+        auto latest() -> nuraft::ptr<nuraft::snapshot>;
+
+        /// Loads the snapshot at the given log index by applying each delta
+        /// in its chain to the base file.
+        /// \param idx log index of the snapshot.
+        /// \return snapshot, or std::nullopt if its chain is incomplete or
+        ///         unreadable.
+        auto load(uint64_t idx) -> std::optional<image>;
+
+        /// Makes the chain ending at the given index the current chain,
+        /// after it was received from another node and applied.
+        /// \param idx log index of the applied snapshot.
+        void set_chain(uint64_t idx);
+
+        /// Reads one transfer object of the snapshot at the given index.
+        /// Objects are numbered across the chain's files in order, one per
+        /// chunk of each file. Pins the snapshot until its last object is
+        /// read, or until no object was read for \ref pin_timeout.
+        /// \param idx log index of the snapshot.
+        /// \param obj_id object number.
+        /// \param is_last set to true if this is the chain's last object.
+        /// \return serialized object, or std::nullopt if the snapshot no
+        ///         longer exists.
+        auto read_object(uint64_t idx, uint64_t obj_id, bool& is_last)
+            -> std::optional<buffer>;
+
+        /// Writes an object received from \ref read_object. A file becomes
+        /// visible to \ref load once its last chunk is written.
+        /// \param obj serialized object.
+        /// \return true if the object was valid and written.
+        auto save_object(buffer obj) -> bool;
+
+      private:
+        struct pending_write {
+            nuraft::ptr<nuraft::snapshot> m_snp;
+            bool m_is_base{};
+            std::vector<entry> m_dtxs;
+            shard_routes m_routes;
+            done_callback_type m_done_cb;
+        };
+
+        [[nodiscard]] auto file_path(uint64_t idx, bool is_base) const
+            -> std::string;
+        [[nodiscard]] auto chain(uint64_t idx) const
+            -> std::optional<std::vector<std::string>>;
+        [[nodiscard]] auto read_chain(const std::vector<std::string>& files)
+            const -> std::optional<image>;
+        auto read_chain_object(uint64_t idx, uint64_t obj_id, bool& is_last)
+            -> std::optional<buffer>;
+        auto write_file(const std::string& path,
+                        uint64_t prev,
+                        nuraft::snapshot& snp,
+                        const shard_routes& routes,
+                        const std::vector<entry>& dtxs,
+                        bool defer_if_pinned) -> bool;
+        auto pinned() -> bool;
+        auto write_pending(pending_write& w) -> bool;
+        void remove_superseded(uint64_t idx);
+        void writer_loop();
+        auto merge(uint64_t idx) -> bool;
+
+        std::shared_ptr<logging::log> m_logger;
+        std::string m_dir;
+        size_t m_merge_deltas;
+
+        /// Guards file creation, renames and deletions against readers.
+        mutable std::shared_mutex m_files_mut;
+
+        /// Snapshots being sent to other nodes, with the time each pin
+        /// expires.
+        std::map<uint64_t, std::chrono::steady_clock::time_point> m_pins;
+        /// Protects m_pins. Never held while acquiring another lock.
+        std::mutex m_pins_mut;
+
+        /// Log index of the newest file in the current chain, or zero.
+        uint64_t m_head{0};
+        /// Log index of the newest complete snapshot, or zero.
+        uint64_t m_latest{0};
+        /// Number of delta files in the current chain.
+        size_t m_chain_deltas{0};
+        mutable std::mutex m_chain_mut;
+        std::condition_variable m_chain_cv;
+        std::vector<pending_write> m_pending;
+
+        bool m_running{true};
+        std::thread m_writer_thread;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COORDINATOR_SNAPSHOT_STORE_H_
@@ -7,14 +7,38 @@
 
 #include "controller.hpp"
 #include "format.hpp"
+#include "util/raft/batching_replicator.hpp"
 #include "util/raft/serialization.hpp"
+#include "util/serialization/format.hpp"
 #include "util/serialization/util.hpp"
 
+#include <cstring>
+
 namespace cbdc::coordinator {
+    namespace {
+        // Copies the payload following the command header, prefixed with
+        // its encoding so recovery can decode entries in either format.
+        auto tag_payload(nuraft::buffer& data, bool compact)
+            -> nuraft::ptr<nuraft::buffer> {
+            const auto len = data.size() - data.pos();
+            auto ret = nuraft::buffer::alloc(len + 1);
+            auto ser = cbdc::nuraft_serializer(*ret);
+            ser << (compact ? payload_encoding::compact
+                            : payload_encoding::legacy);
+            ser.write(data.data(), len);
+            return ret;
+        }
+    }
+
     auto state_machine::commit(uint64_t log_idx, nuraft::buffer& data)
         -> nuraft::ptr<nuraft::buffer> {
         assert(log_idx == m_last_committed_idx + 1);
         m_last_committed_idx = log_idx;
+        return apply(data);
+    }
+
+    auto state_machine::apply(nuraft::buffer& data)
+        -> nuraft::ptr<nuraft::buffer> {
         auto comm = cbdc::coordinator::controller::sm_command_header();
         auto deser = cbdc::nuraft_serializer(data);
         // Deserialize the header from the state machine command
@@ -25,7 +49,7 @@ namespace cbdc::coordinator {
                 // relevant map
                 auto res = m_state.m_prepare_txs.emplace(
                     comm.m_dtx_id.value(),
-                    nuraft::buffer::copy(data));
+                    tag_payload(data, comm.m_compact));
                 if(!res.second) {
                     // dtx IDs are supposed to be unique so if the dtx is
                     // already present in the prepare map, that would indicate
@@ -34,6 +58,7 @@ namespace cbdc::coordinator {
                     m_logger->fatal("Duplicate prepare for dtx",
                                     to_string(comm.m_dtx_id.value()));
                 }
+                track(comm.m_dtx_id.value());
                 break;
             }
             case command::commit: {
@@ -47,22 +72,28 @@ namespace cbdc::coordinator {
                                     to_string(comm.m_dtx_id.value()));
                 }
                 // Put the dtx in the commit map with associated data
-                m_state.m_commit_txs.emplace(comm.m_dtx_id.value(),
-                                             nuraft::buffer::copy(data));
-
+                m_state.m_commit_txs.emplace(
+                    comm.m_dtx_id.value(),
+                    tag_payload(data, comm.m_compact));
+                track(comm.m_dtx_id.value());
                 break;
             }
             case command::discard: {
-                // Remove the dtx from the commit map
+                // Remove the dtx from the commit map, or from the prepare map
+                // if it only touched one shard and skipped the commit phase
                 auto res = m_state.m_commit_txs.erase(comm.m_dtx_id.value());
                 if(res == 0U) {
-                    // If the dtx wasn't in the commit map a bug has occurred
-                    // and we crash
+                    res = m_state.m_prepare_txs.erase(comm.m_dtx_id.value());
+                }
+                if(res == 0U) {
+                    // If the dtx wasn't in either map a bug has occurred and
+                    // we crash
                     m_logger->fatal("Commit not found for discard dtx",
                                     to_string(comm.m_dtx_id.value()));
                 }
                 // Add the dtx to the discard set
                 m_state.m_discard_txs.emplace(comm.m_dtx_id.value());
+                track(comm.m_dtx_id.value());
                 break;
             }
             case command::done: {
@@ -74,6 +105,16 @@ namespace cbdc::coordinator {
                     m_logger->fatal("Discard not found for done dtx",
                                     to_string(comm.m_dtx_id.value()));
                 }
+                track(comm.m_dtx_id.value());
+                break;
+            }
+            case command::route: {
+                auto shard_id = uint64_t();
+                auto range = std::optional<config::shard_range_t>();
+                if(!(deser >> shard_id >> range)) {
+                    m_logger->fatal("Invalid route command");
+                }
+                m_state.m_routes[shard_id] = range;
                 break;
             }
             case command::get: {
@@ -87,6 +128,20 @@ namespace cbdc::coordinator {
                 assert(ser.end_of_buffer());
                 return ret;
             }
+            case command::batch: {
+                // Apply each command of the run in order, combining their
+                // results so the leader can return each to its caller
+                auto entries = raft::read_batch_entry(data, data.pos());
+                if(!entries.has_value()) {
+                    m_logger->fatal("Invalid batch command");
+                }
+                auto results = std::vector<nuraft::ptr<nuraft::buffer>>();
+                results.reserve(entries->size());
+                for(auto& entry : *entries) {
+                    results.emplace_back(apply(*entry));
+                }
+                return raft::make_batch_result(results);
+            }
         }
         return nullptr;
     }
@@ -98,13 +153,113 @@ namespace cbdc::coordinator {
         m_last_committed_idx = log_idx;
     }
 
-    auto state_machine::apply_snapshot(nuraft::snapshot& /* s */) -> bool {
-        // TODO: implement snapshots (cf. #768)
-        return false;
+    void state_machine::track(const hash_t& dtx_id) {
+        if(m_snapshots) {
+            m_changed.insert(dtx_id);
+        }
+    }
+
+    auto state_machine::snapshot_entry(const hash_t& dtx_id) const
+        -> snapshot_store::entry {
+        auto ret = snapshot_store::entry{dtx_id,
+                                         snapshot_store::phase::done,
+                                         nullptr};
+        auto it = m_state.m_prepare_txs.find(dtx_id);
+        if(it != m_state.m_prepare_txs.end()) {
+            ret.m_phase = snapshot_store::phase::prepare;
+            ret.m_payload = it->second;
+            return ret;
+        }
+        it = m_state.m_commit_txs.find(dtx_id);
+        if(it != m_state.m_commit_txs.end()) {
+            ret.m_phase = snapshot_store::phase::commit;
+            ret.m_payload = it->second;
+            return ret;
+        }
+        if(m_state.m_discard_txs.find(dtx_id)
+           != m_state.m_discard_txs.end()) {
+            ret.m_phase = snapshot_store::phase::discard;
+        }
+        return ret;
+    }
+
+    auto
+    state_machine::read_logical_snp_obj(nuraft::snapshot& s,
+                                        void*& /* user_snp_ctx */,
+                                        nuraft::ulong obj_id,
+                                        nuraft::ptr<nuraft::buffer>& data_out,
+                                        bool& is_last_obj) -> int {
+        if(!m_snapshots) {
+            return -1;
+        }
+        auto obj = m_snapshots->read_object(s.get_last_log_idx(),
+                                            obj_id,
+                                            is_last_obj);
+        if(!obj.has_value()) {
+            // Requested snapshot was merged or replaced, not fatal
+            return -1;
+        }
+        data_out = nuraft::buffer::alloc(obj->size());
+        std::memcpy(data_out->data_begin(), obj->data(), obj->size());
+        return 0;
+    }
+
+    void state_machine::save_logical_snp_obj(nuraft::snapshot& /* s */,
+                                             nuraft::ulong& obj_id,
+                                             nuraft::buffer& data,
+                                             bool /* is_first_obj */,
+                                             bool /* is_last_obj */) {
+        if(!m_snapshots) {
+            m_logger->fatal("Received snapshot with snapshots disabled");
+        }
+        auto obj = buffer();
+        obj.append(data.data_begin(), data.size());
+        if(!m_snapshots->save_object(std::move(obj))) {
+            m_logger->fatal("Failed to save snapshot object", obj_id);
+        }
+        obj_id++;
+    }
+
+    auto state_machine::apply_snapshot(nuraft::snapshot& s) -> bool {
+        if(!m_snapshots) {
+            return false;
+        }
+        auto idx = s.get_last_log_idx();
+        auto img = m_snapshots->load(idx);
+        if(!img.has_value()) {
+            return false;
+        }
+        auto state = coordinator_state();
+        for(auto& e : img->m_dtxs) {
+            switch(e.m_phase) {
+                case snapshot_store::phase::prepare:
+                    state.m_prepare_txs.emplace(e.m_dtx_id,
+                                                std::move(e.m_payload));
+                    break;
+                case snapshot_store::phase::commit:
+                    state.m_commit_txs.emplace(e.m_dtx_id,
+                                               std::move(e.m_payload));
+                    break;
+                case snapshot_store::phase::discard:
+                    state.m_discard_txs.emplace(e.m_dtx_id);
+                    break;
+                case snapshot_store::phase::done:
+                    break;
+            }
+        }
+        state.m_routes = std::move(img->m_routes);
+        m_state = std::move(state);
+        m_changed.clear();
+        m_last_committed_idx = idx;
+        m_snapshots->set_chain(idx);
+        return true;
     }
 
     auto state_machine::last_snapshot() -> nuraft::ptr<nuraft::snapshot> {
-        return nullptr;
+        if(!m_snapshots) {
+            return nullptr;
+        }
+        return m_snapshots->latest();
     }
 
     auto state_machine::last_commit_index() -> uint64_t {
@@ -112,13 +267,68 @@ namespace cbdc::coordinator {
     }
 
     void state_machine::create_snapshot(
-        nuraft::snapshot& /* s */,
+        nuraft::snapshot& s,
         nuraft::async_result<bool>::handler_type& when_done) {
-        bool res{false};
-        auto snp = nuraft::ptr<std::exception>();
-        when_done(res, snp);
+        if(!m_snapshots) {
+            auto except = nuraft::ptr<std::exception>();
+            bool ret{false};
+            when_done(ret, except);
+            return;
+        }
+        assert(s.get_last_log_idx() == last_commit_index());
+        // Snapshots are created between commits, so the state does not
+        // change while the entries are copied. Payloads are never modified
+        // once stored, so the copies share them rather than the bytes.
+        auto dtxs = std::vector<snapshot_store::entry>();
+        const auto is_base = !m_snapshots->has_chain();
+        if(is_base) {
+            dtxs.reserve(m_state.m_prepare_txs.size()
+                         + m_state.m_commit_txs.size()
+                         + m_state.m_discard_txs.size());
+            for(const auto& [id, payload] : m_state.m_prepare_txs) {
+                dtxs.push_back({id, snapshot_store::phase::prepare, payload});
+            }
+            for(const auto& [id, payload] : m_state.m_commit_txs) {
+                dtxs.push_back({id, snapshot_store::phase::commit, payload});
+            }
+            for(const auto& id : m_state.m_discard_txs) {
+                dtxs.push_back({id, snapshot_store::phase::discard, nullptr});
+            }
+        } else {
+            dtxs.reserve(m_changed.size());
+            for(const auto& id : m_changed) {
+                dtxs.push_back(snapshot_entry(id));
+            }
+        }
+        m_changed.clear();
+        m_snapshots->write(s,
+                           is_base,
+                           std::move(dtxs),
+                           m_state.m_routes,
+                           [when_done](bool ok) {
+                               auto except = nuraft::ptr<std::exception>();
+                               auto ret = ok;
+                               when_done(ret, except);
+                           });
     }
 
-    state_machine::state_machine(std::shared_ptr<logging::log> logger)
-        : m_logger(std::move(logger)) {}
+    state_machine::state_machine(std::shared_ptr<logging::log> logger,
+                                 std::string snapshot_dir,
+                                 size_t merge_deltas)
+        : m_logger(std::move(logger)) {
+        if(snapshot_dir.empty()) {
+            return;
+        }
+        m_snapshots = std::make_unique<snapshot_store>(m_logger,
+                                                       std::move(snapshot_dir),
+                                                       merge_deltas);
+        if(!m_snapshots->init()) {
+            m_logger->fatal("Failed to initialize snapshot store");
+        }
+        auto snp = m_snapshots->latest();
+        if(snp && !state_machine::apply_snapshot(*snp)) {
+            m_logger->fatal("Failed to apply snapshot at",
+                            snp->get_last_log_idx());
+        }
+    }
 }
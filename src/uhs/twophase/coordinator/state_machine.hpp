@@ -6,6 +6,8 @@
 #ifndef OPENCBDC_TX_SRC_COORDINATOR_STATE_MACHINE_H_
 #define OPENCBDC_TX_SRC_COORDINATOR_STATE_MACHINE_H_
 
+#include "snapshot_store.hpp"
+#include "util/common/config.hpp"
 #include "util/common/hashmap.hpp"
 #include "util/common/logging.hpp"
 
@@ -18,13 +20,22 @@ namespace cbdc::coordinator {
     ///
     /// Contains a \ref coordinator_state and the last-committed index.
     /// Accepts requests to manage and query distributed transactions.
+    /// Snapshots, when enabled, record only the dtxs changed since the
+    /// previous snapshot, see \ref snapshot_store.
     class state_machine final : public nuraft::state_machine {
       public:
         /// Constructor.
         /// Constructs a new coordinator state machine.
         ///
         /// \param logger pointer to logger instance.
-        explicit state_machine(std::shared_ptr<logging::log> logger);
+        /// \param snapshot_dir directory in which to store snapshots. Empty
+        ///                     disables snapshots. Applies the latest
+        ///                     snapshot it holds, if any.
+        /// \param merge_deltas number of incremental snapshots after which
+        ///                     they are merged into a full snapshot.
+        explicit state_machine(std::shared_ptr<logging::log> logger,
+                               std::string snapshot_dir = "",
+                               size_t merge_deltas = 0);
 
         /// Types of command the state machine can process.
         enum class command : uint8_t {
@@ -32,21 +43,30 @@ namespace cbdc::coordinator {
             commit = 1,  ///< Moves a dtx from prepare to commit.
             discard = 2, ///< Moves a dtx from commit to discard.
             done = 3,    ///< Clears the dtx from the coordinator state.
-            get = 4      ///< Retrieves all active dtxs.
+            get = 4,     ///< Retrieves all active dtxs.
+            route = 5,   ///< Changes the UHS ID range routed to a shard.
+            batch = 6    ///< Applies a run of commands in log order.
         };
 
+        /// UHS ID ranges routed to shards, by shard ID, where they differ
+        /// from the configured ranges. std::nullopt if nothing is routed to
+        /// the shard.
+        using shard_routes
+            = std::unordered_map<uint64_t,
+                                 std::optional<config::shard_range_t>>;
+
         /// Used to store dtxs, which phase they are in and relevant data
         /// require for recovery. Each dtx should only be in one of the
         /// constituent variables at a time.
         struct coordinator_state {
             /// Maps dtx IDs in the prepare phase to a byte array containing
-            /// relevant data for recovery.
+            /// relevant data for recovery, prefixed with its encoding.
             std::unordered_map<hash_t,
                                nuraft::ptr<nuraft::buffer>,
                                cbdc::hashing::const_sip_hash<hash_t>>
                 m_prepare_txs{};
             /// Maps dtx IDs in the commit phase to a byte array containing
-            /// relevant data for recovery.
+            /// relevant data for recovery, prefixed with its encoding.
             std::unordered_map<hash_t,
                                nuraft::ptr<nuraft::buffer>,
                                cbdc::hashing::const_sip_hash<hash_t>>
@@ -54,6 +74,8 @@ namespace cbdc::coordinator {
             /// Set of dtx IDs in the discard phase.
             std::unordered_set<hash_t, cbdc::hashing::const_sip_hash<hash_t>>
                 m_discard_txs{};
+            /// Shard routes changed since the coordinator started.
+            shard_routes m_routes{};
         };
 
         /// Commits a state machine command.
@@ -71,26 +93,73 @@ namespace cbdc::coordinator {
             nuraft::ulong log_idx,
             nuraft::ptr<nuraft::cluster_config>& /*new_conf*/) override;
 
-        /// Not implemented for coordinators.
-        /// \return false (unconditionally).
-        auto apply_snapshot(nuraft::snapshot& /* s */) -> bool override;
+        /// Reads one chunk of a snapshot chain to send to another node.
+        /// \param s metadata of snapshot to read.
+        /// \param user_snp_ctx unused.
+        /// \param obj_id ID of the snapshot object to read.
+        /// \param data_out buffer in which to write the snapshot object.
+        /// \param is_last_obj set to true if this is the last snapshot
+        ///                    object.
+        /// \return 0 on success, -1 if the snapshot no longer exists.
+        auto
+        read_logical_snp_obj(nuraft::snapshot& s,
+                             void*& user_snp_ctx,
+                             nuraft::ulong obj_id,
+                             nuraft::ptr<nuraft::buffer>& data_out,
+                             bool& is_last_obj) -> int override;
+
+        /// Saves one chunk of a snapshot chain received from another node.
+        /// \param s metadata of snapshot to save.
+        /// \param obj_id ID of the snapshot object to save. Incremented to
+        ///               request the next object.
+        /// \param data snapshot object data.
+        /// \param is_first_obj true if this is the first snapshot object.
+        /// \param is_last_obj true if this is the last snapshot object.
+        void save_logical_snp_obj(nuraft::snapshot& s,
+                                  nuraft::ulong& obj_id,
+                                  nuraft::buffer& data,
+                                  bool is_first_obj,
+                                  bool is_last_obj) override;
+
+        /// Replaces the coordinator state with the snapshot referenced by
+        /// the given metadata.
+        /// \param s snapshot metadata.
+        /// \return true if the snapshot was loaded and applied.
+        auto apply_snapshot(nuraft::snapshot& s) -> bool override;
 
-        /// Not implemented for coordinators.
-        /// \return nullptr (unconditionally).
+        /// Returns the most recent snapshot metadata.
+        /// \return snapshot metadata, or nullptr if there is no snapshot.
         auto last_snapshot() -> nuraft::ptr<nuraft::snapshot> override;
 
         /// Returns the index of the last-committed command.
         auto last_commit_index() -> uint64_t override;
 
-        /// Not implemented for coordinators.
+        /// Creates a snapshot with the given metadata. Copies the dtxs
+        /// changed since the previous snapshot, or every dtx for the first
+        /// snapshot of a chain, and writes them in the background.
+        /// \param s snapshot metadata.
+        /// \param when_done function to call once the snapshot is written.
         void create_snapshot(
-            nuraft::snapshot& /* s */,
+            nuraft::snapshot& s,
             nuraft::async_result<bool>::handler_type& when_done) override;
 
       private:
         std::atomic<uint64_t> m_last_committed_idx{0};
         coordinator_state m_state{};
         std::shared_ptr<logging::log> m_logger;
+
+        /// Incremental snapshot files, or nullptr if snapshots are
+        /// disabled.
+        std::unique_ptr<snapshot_store> m_snapshots;
+        /// IDs of dtxs whose phase changed since the last snapshot. Only
+        /// tracked with snapshots enabled.
+        std::unordered_set<hash_t, cbdc::hashing::const_sip_hash<hash_t>>
+            m_changed{};
+
+        auto apply(nuraft::buffer& data) -> nuraft::ptr<nuraft::buffer>;
+        void track(const hash_t& dtx_id);
+        [[nodiscard]] auto snapshot_entry(const hash_t& dtx_id) const
+            -> snapshot_store::entry;
     };
 }
 
@@ -1,16 +1,24 @@
 // testOracleDB.cpp
-#include "oracleDB.h"
+#include "util/common/logging.hpp"
+#include "util/oracle/session_pool.hpp"
+
 #include <iostream>
 
 int main() {
-    OracleDB db;
-    if (OracleDB_init(&db) == 0) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::info);
+    auto pool = cbdc::oracle::session_pool(logger, 1, 1, 1, 1);
+    if(!pool.init()) {
+        std::cout << "Failed to initialize OracleDB." << std::endl;
+        return 0;
+    }
+    auto conn = pool.acquire();
+    if(conn.has_value()) {
         std::cout << "OracleDB initialized successfully." << std::endl;
         // Call other functions as needed
         // ...
-        OracleDB_disconnect(&db);
     } else {
-        std::cout << "Failed to initialize OracleDB." << std::endl;
+        std::cout << "Failed to connect to OracleDB." << std::endl;
     }
     return 0;
 }
@@ -0,0 +1,224 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tx_archive.hpp"
+
+#include "uhs/transaction/messages.hpp"
+#include "util/common/affinity.hpp"
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <zstd.h>
+
+namespace cbdc::coordinator {
+    tx_archive::tx_archive(std::shared_ptr<logging::log> logger,
+                           std::unique_ptr<persistence::blob_sink> out,
+                           size_t high_water_mark,
+                           size_t max_batch_size,
+                           int compression_level,
+                           persistence::retry_policy retry)
+        : m_logger(std::move(logger)),
+          m_sink(std::move(out)),
+          m_high_water_mark(std::max<size_t>(high_water_mark, 1)),
+          m_max_batch_size(std::max<size_t>(max_batch_size, 1)),
+          m_compression_level(compression_level),
+          m_retry(retry) {}
+
+    tx_archive::~tx_archive() {
+        stop();
+    }
+
+    auto tx_archive::start() -> bool {
+        if(!m_sink) {
+            return false;
+        }
+
+        {
+            std::unique_lock l(m_mut);
+            m_running = true;
+        }
+        m_thread = std::thread([&]() {
+            pin_current_thread(thread_role::persistence);
+            archive_loop();
+        });
+        return true;
+    }
+
+    auto tx_archive::try_push(
+        const hash_t& dtx_id,
+        std::shared_ptr<const std::vector<transaction::compact_tx>> txs,
+        std::vector<bool> complete_txs) -> bool {
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return false;
+            }
+            if(m_pending.size() >= m_high_water_mark) {
+                m_dropped++;
+                return false;
+            }
+            m_pending.push_back(
+                {dtx_id, std::move(txs), std::move(complete_txs)});
+        }
+        m_pending_cv.notify_one();
+        return true;
+    }
+
+    void tx_archive::stop() {
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_pending_cv.notify_one();
+        if(m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    auto tx_archive::size() const -> size_t {
+        std::unique_lock l(m_mut);
+        return m_pending.size();
+    }
+
+    auto tx_archive::encode(const std::vector<transaction::compact_tx>& txs,
+                            const std::vector<bool>& complete_txs,
+                            int compression_level) -> std::optional<buffer> {
+        auto raw = buffer();
+        raw.extend(serialized_size(complete_txs) + serialized_size(txs));
+        auto ser = buffer_serializer(raw);
+        ser << complete_txs << txs;
+
+        auto compressed = std::vector<unsigned char>(
+            ZSTD_compressBound(raw.size()));
+        const auto len = ZSTD_compress(compressed.data(),
+                                       compressed.size(),
+                                       raw.data(),
+                                       raw.size(),
+                                       compression_level);
+        if(ZSTD_isError(len) != 0) {
+            return std::nullopt;
+        }
+        auto ret = buffer();
+        ret.append(compressed.data(), len);
+        return ret;
+    }
+
+    auto tx_archive::decode(const buffer& blob) -> std::optional<record> {
+        const auto raw_len = ZSTD_getFrameContentSize(blob.data(), blob.size());
+        if(raw_len == ZSTD_CONTENTSIZE_ERROR
+           || raw_len == ZSTD_CONTENTSIZE_UNKNOWN) {
+            return std::nullopt;
+        }
+        auto raw = buffer();
+        raw.extend(raw_len);
+        const auto len
+            = ZSTD_decompress(raw.data(), raw.size(), blob.data(), blob.size());
+        if(ZSTD_isError(len) != 0 || len != raw_len) {
+            return std::nullopt;
+        }
+        auto deser = buffer_serializer(raw);
+        auto ret = record();
+        if(!(deser >> ret.m_complete_txs >> ret.m_txs)
+           || ret.m_complete_txs.size() != ret.m_txs.size()) {
+            return std::nullopt;
+        }
+        return ret;
+    }
+
+    void tx_archive::archive_loop() {
+        // Dtxs queue up while the sink connects
+        if(!m_sink->connect()) {
+            m_logger->warn("Archive sink not ready, will retry writes");
+        }
+        auto batch = std::vector<pending_dtx>();
+        auto keys = std::vector<hash_t>();
+        auto blobs = std::vector<buffer>();
+        while(true) {
+            size_t dropped{0};
+            {
+                std::unique_lock l(m_mut);
+                m_pending_cv.wait(l, [&]() {
+                    return !m_running || !m_pending.empty();
+                });
+                if(m_pending.empty()) {
+                    // Only reachable once stopped and fully drained.
+                    return;
+                }
+                batch.assign(std::make_move_iterator(m_pending.begin()),
+                             std::make_move_iterator(m_pending.end()));
+                m_pending.clear();
+                dropped = std::exchange(m_dropped, 0);
+            }
+            if(dropped != 0) {
+                m_logger->warn("Archive full, dropped", dropped, "dtxs");
+            }
+
+            // Compression runs here rather than on the commit path
+            for(auto& dtx : batch) {
+                auto blob = encode(*dtx.m_txs,
+                                   dtx.m_complete_txs,
+                                   m_compression_level);
+                if(!blob.has_value()) {
+                    m_logger->error("Failed to compress archive of dtx",
+                                    to_string(dtx.m_dtx_id));
+                    continue;
+                }
+                keys.push_back(dtx.m_dtx_id);
+                blobs.push_back(std::move(blob.value()));
+            }
+            batch.clear();
+
+            auto backoff = m_retry.m_initial_backoff;
+            size_t attempts{0};
+            for(size_t i{0}; i < keys.size();) {
+                auto count = std::min(m_max_batch_size, keys.size() - i);
+                if(m_sink->append(&keys[i], &blobs[i], count)) {
+                    i += count;
+                    backoff = m_retry.m_initial_backoff;
+                    attempts = 0;
+                    continue;
+                }
+                attempts++;
+                if(m_retry.m_max_attempts != 0
+                   && attempts >= m_retry.m_max_attempts) {
+                    // Keeps a persistent failure from stalling the archive
+                    m_logger->error("Dropping",
+                                    count,
+                                    "unarchived dtxs after",
+                                    attempts,
+                                    "attempts");
+                    i += count;
+                    backoff = m_retry.m_initial_backoff;
+                    attempts = 0;
+                    continue;
+                }
+                if(!wait_for_retry(backoff)) {
+                    m_logger->error("Dropping",
+                                    keys.size() - i,
+                                    "unarchived dtxs on shutdown");
+                    break;
+                }
+                m_logger->warn("Retrying", count, "unarchived dtxs");
+                backoff = std::min(backoff * 2, m_retry.m_max_backoff);
+            }
+            keys.clear();
+            blobs.clear();
+        }
+    }
+
+    auto tx_archive::wait_for_retry(std::chrono::milliseconds delay)
+        -> bool {
+        std::unique_lock l(m_mut);
+        return !m_pending_cv.wait_for(l, delay, [&]() {
+            return !m_running;
+        });
+    }
+}
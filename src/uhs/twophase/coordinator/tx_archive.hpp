@@ -0,0 +1,144 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COORDINATOR_TX_ARCHIVE_H_
+#define OPENCBDC_TX_SRC_COORDINATOR_TX_ARCHIVE_H_
+
+#include "uhs/transaction/transaction.hpp"
+#include "util/common/buffer.hpp"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+#include "util/persistence/blob_sink.hpp"
+#include "util/persistence/write_behind_queue.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace cbdc::coordinator {
+    /// \brief Archive of the full transactions of each committed dtx.
+    ///
+    /// The coordinator pushes each dtx as it commits, sharing the dtx's
+    /// transaction list rather than copying it. A background thread
+    /// serializes each dtx's transactions and completion flags, compresses
+    /// them with zstd into one blob keyed by the dtx ID, and appends the
+    /// pending blobs to the sink in batches, so the archive costs one row
+    /// per dtx rather than per transaction. Archiving must never hold up
+    /// the commit path, so dtxs pushed at the high-water mark are dropped
+    /// instead of blocking. Failed batches are retried with backoff and
+    /// dropped after the policy's maximum number of attempts, and blobs
+    /// still unwritten after one final attempt at shutdown are dropped.
+    class tx_archive {
+      public:
+        /// Contents of one archived dtx.
+        struct record {
+            /// Flags indicating which transactions settled, by index in
+            /// the batch.
+            std::vector<bool> m_complete_txs;
+            /// Every transaction in the batch.
+            std::vector<transaction::compact_tx> m_txs;
+        };
+
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param out sink receiving the blobs. May be nullptr, in which
+        ///            case \ref start fails.
+        /// \param high_water_mark maximum number of pending dtxs, beyond
+        ///                        which \ref try_push drops dtxs.
+        /// \param max_batch_size maximum number of blobs appended to the
+        ///                       sink at once.
+        /// \param compression_level zstd compression level.
+        /// \param retry backoff between attempts to write a failed batch,
+        ///              and the number of attempts before it is dropped.
+        tx_archive(std::shared_ptr<logging::log> logger,
+                   std::unique_ptr<persistence::blob_sink> out,
+                   size_t high_water_mark,
+                   size_t max_batch_size,
+                   int compression_level,
+                   persistence::retry_policy retry = {});
+
+        /// Destructor. Calls \ref stop.
+        ~tx_archive();
+
+        tx_archive(const tx_archive&) = delete;
+        auto operator=(const tx_archive&) -> tx_archive& = delete;
+        tx_archive(tx_archive&&) = delete;
+        auto operator=(tx_archive&&) -> tx_archive& = delete;
+
+        /// Launches the archive thread.
+        /// \return true if the archive has a sink to write to.
+        auto start() -> bool;
+
+        /// Queues a committed dtx without blocking. The dtx is dropped,
+        /// and counted in the next warning the archive thread logs, if the
+        /// archive is at its high-water mark.
+        /// \param dtx_id ID of the dtx.
+        /// \param txs transactions in the dtx. Must not be modified
+        ///            afterwards.
+        /// \param complete_txs flags indicating which transactions settled.
+        /// \return false if the archive is not running or was full.
+        auto
+        try_push(const hash_t& dtx_id,
+                 std::shared_ptr<const std::vector<transaction::compact_tx>>
+                     txs,
+                 std::vector<bool> complete_txs) -> bool;
+
+        /// Stops accepting new dtxs, writes any pending dtxs to the sink
+        /// and joins the archive thread.
+        void stop();
+
+        /// Returns the number of dtxs waiting to be archived.
+        /// \return queue depth.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Serializes and compresses an archived dtx.
+        /// \param txs transactions in the dtx.
+        /// \param complete_txs flags indicating which transactions settled.
+        /// \param compression_level zstd compression level.
+        /// \return blob, or std::nullopt if compression failed.
+        static auto
+        encode(const std::vector<transaction::compact_tx>& txs,
+               const std::vector<bool>& complete_txs,
+               int compression_level) -> std::optional<buffer>;
+
+        /// Decompresses and deserializes a blob written by the archive.
+        /// \param blob blob from the sink.
+        /// \return archived dtx, or std::nullopt if the blob is corrupt.
+        static auto decode(const buffer& blob) -> std::optional<record>;
+
+      private:
+        struct pending_dtx {
+            hash_t m_dtx_id{};
+            std::shared_ptr<const std::vector<transaction::compact_tx>>
+                m_txs;
+            std::vector<bool> m_complete_txs;
+        };
+
+        void archive_loop();
+        auto wait_for_retry(std::chrono::milliseconds delay) -> bool;
+
+        std::shared_ptr<logging::log> m_logger;
+        std::unique_ptr<persistence::blob_sink> m_sink;
+        size_t m_high_water_mark;
+        size_t m_max_batch_size;
+        int m_compression_level;
+        persistence::retry_policy m_retry;
+
+        mutable std::mutex m_mut;
+        std::condition_variable m_pending_cv;
+        std::deque<pending_dtx> m_pending;
+        /// Dtxs dropped at the high-water mark since the last warning.
+        size_t m_dropped{0};
+        bool m_running{false};
+
+        std::thread m_thread;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COORDINATOR_TX_ARCHIVE_H_
@@ -23,12 +23,18 @@ namespace cbdc::locking_shard::rpc {
     }
 
     auto client::init() -> bool {
-        return m_client->init();
+        if(!m_client->init()) {
+            return false;
+        }
+        m_hedge_thread = std::thread([&]() {
+            hedge_loop();
+        });
+        return true;
     }
 
     auto client::lock_outputs(std::vector<tx>&& txs, const hash_t& dtx_id)
         -> std::optional<std::vector<bool>> {
-        auto req = request{dtx_id, std::move(txs)};
+        auto req = request{dtx_id, lock_params(std::move(txs))};
         auto resp = send_request(req);
         if(!resp.has_value()) {
             return std::nullopt;
@@ -43,16 +49,215 @@ namespace cbdc::locking_shard::rpc {
         return res.has_value();
     }
 
+    auto client::lock_and_apply(std::vector<tx>&& txs, const hash_t& dtx_id)
+        -> std::optional<std::vector<bool>> {
+        return lock_and_apply_batch(tx_batch(std::move(txs)), dtx_id);
+    }
+
+    auto client::lock_and_apply_batch(tx_batch txs, const hash_t& dtx_id)
+        -> std::optional<std::vector<bool>> {
+        auto req = request{dtx_id, lock_apply_params{std::move(txs)}};
+        auto resp = send_request(req);
+        if(!resp.has_value()) {
+            return std::nullopt;
+        }
+        return std::get<lock_response>(resp.value());
+    }
+
     auto client::discard_dtx(const hash_t& dtx_id) -> bool {
         auto req = request{dtx_id, discard_params()};
         auto res = send_request(req);
         return res.has_value();
     }
 
+    auto client::begin_import(const std::pair<uint8_t, uint8_t>& range)
+        -> bool {
+        auto res = send_range_request(
+            request{{}, range_params{range_op::begin_import, range, 0}});
+        return res.has_value() && res->m_success;
+    }
+
+    auto client::import_uhs(std::vector<hash_t> uhs_ids) -> bool {
+        auto res = send_range_request(
+            request{{}, import_params{std::move(uhs_ids)}});
+        return res.has_value() && res->m_success;
+    }
+
+    auto client::end_import() -> bool {
+        auto res = send_range_request(
+            request{{}, range_params{range_op::end_import, {}, 0}});
+        return res.has_value() && res->m_success;
+    }
+
+    auto client::read_range(const std::pair<uint8_t, uint8_t>& range,
+                            uint64_t offset)
+        -> std::optional<std::vector<hash_t>> {
+        auto res = send_range_request(
+            request{{}, range_params{range_op::read, range, offset}});
+        if(!res.has_value() || !res->m_success) {
+            return std::nullopt;
+        }
+        return std::move(res->m_uhs_ids);
+    }
+
+    auto client::drop_range(const std::pair<uint8_t, uint8_t>& range)
+        -> bool {
+        auto res = send_range_request(
+            request{{}, range_params{range_op::drop, range, 0}});
+        return res.has_value() && res->m_success;
+    }
+
+    auto client::send_range_request(request req)
+        -> std::optional<range_response> {
+        auto resp = send_request(req);
+        if(!resp.has_value()) {
+            return std::nullopt;
+        }
+        return std::get<range_response>(std::move(resp.value()));
+    }
+
+    void client::lock_outputs_async(std::vector<tx>&& txs,
+                                    const hash_t& dtx_id,
+                                    lock_callback_type cb) {
+        lock_batch_async(tx_batch(std::move(txs)), dtx_id, std::move(cb));
+    }
+
+    void client::lock_batch_async(tx_batch txs,
+                                  const hash_t& dtx_id,
+                                  lock_callback_type cb) {
+        send_async(request{dtx_id, lock_params(std::move(txs))},
+                   [cb = std::move(cb)](std::optional<response> resp) {
+                       if(!resp.has_value()) {
+                           cb(std::nullopt);
+                           return;
+                       }
+                       cb(std::get<lock_response>(std::move(resp.value())));
+                   });
+    }
+
+    void client::apply_outputs_async(std::vector<bool>&& complete_txs,
+                                     const hash_t& dtx_id,
+                                     done_callback_type cb) {
+        send_async(request{dtx_id, std::move(complete_txs)},
+                   [cb = std::move(cb)](std::optional<response> resp) {
+                       cb(resp.has_value());
+                   });
+    }
+
+    void client::discard_dtx_async(const hash_t& dtx_id,
+                                   done_callback_type cb) {
+        send_async(request{dtx_id, discard_params()},
+                   [cb = std::move(cb)](std::optional<response> resp) {
+                       cb(resp.has_value());
+                   });
+    }
+
+    void client::send_async(request req, response_callback_type cb) {
+        auto id = uint64_t{};
+        {
+            std::unique_lock<std::mutex> l(m_pending_mut);
+            if(!m_running) {
+                l.unlock();
+                cb(std::nullopt);
+                return;
+            }
+            id = m_next_pending_id++;
+            m_pending.emplace(id,
+                              pending_request{std::move(req),
+                                              std::move(cb),
+                                              {},
+                                              initial_result_timeout,
+                                              tracing::current()});
+        }
+        send_pending(id);
+    }
+
+    void client::send_pending(uint64_t id) {
+        auto req = std::optional<request>();
+        auto trace = std::optional<tracing::context>();
+        {
+            std::unique_lock<std::mutex> l(m_pending_mut);
+            auto it = m_pending.find(id);
+            if(it == m_pending.end()) {
+                return;
+            }
+            auto& pending = it->second;
+            pending.m_deadline
+                = std::chrono::steady_clock::now() + pending.m_timeout;
+            pending.m_timeout
+                = std::min(max_result_timeout, pending.m_timeout * 2);
+            req = pending.m_req;
+            trace = pending.m_trace;
+        }
+        m_pending_cv.notify_one();
+        // Earlier copies of the request stay outstanding, so whichever node
+        // answers first completes it.
+        auto c = tracing::scoped_context(trace);
+        auto sent = m_client->call(std::move(req.value()),
+                                   [&, id](std::optional<response> resp) {
+                                       handle_response(id, std::move(resp));
+                                   });
+        if(!sent) {
+            handle_response(id, std::nullopt);
+        }
+    }
+
+    void client::handle_response(uint64_t id, std::optional<response> resp) {
+        auto node = [&]() {
+            std::unique_lock<std::mutex> l(m_pending_mut);
+            if(resp.has_value()) {
+                return m_pending.extract(id);
+            }
+            // Retry a failed request after a delay, unless another copy is
+            // due to be sent sooner anyway.
+            auto it = m_pending.find(id);
+            if(it != m_pending.end()) {
+                m_log.warn("Shard request failed");
+                it->second.m_deadline
+                    = std::min(it->second.m_deadline,
+                               std::chrono::steady_clock::now()
+                                   + retry_delay);
+                m_pending_cv.notify_one();
+            }
+            return decltype(m_pending)::node_type();
+        }();
+        if(!node.empty()) {
+            node.mapped().m_cb(std::move(resp));
+        }
+    }
+
+    void client::hedge_loop() {
+        std::unique_lock<std::mutex> l(m_pending_mut);
+        while(m_running) {
+            auto now = std::chrono::steady_clock::now();
+            auto next = std::optional<std::chrono::steady_clock::time_point>();
+            auto due = std::vector<uint64_t>();
+            for(const auto& [id, pending] : m_pending) {
+                if(pending.m_deadline <= now) {
+                    due.push_back(id);
+                } else if(!next || pending.m_deadline < next.value()) {
+                    next = pending.m_deadline;
+                }
+            }
+            if(!due.empty()) {
+                l.unlock();
+                for(auto id : due) {
+                    m_log.warn("Shard request slow, sending again");
+                    send_pending(id);
+                }
+                l.lock();
+                continue;
+            }
+            if(next.has_value()) {
+                m_pending_cv.wait_until(l, next.value());
+            } else {
+                m_pending_cv.wait(l);
+            }
+        }
+    }
+
     auto client::send_request(const request& req) -> std::optional<response> {
-        auto result_timeout = std::chrono::seconds(3);
-        constexpr auto max_result_timeout = std::chrono::seconds(10);
-        constexpr auto retry_delay = std::chrono::seconds(1);
+        auto result_timeout = initial_result_timeout;
         auto res = std::optional<response>();
         while(m_running && !res.has_value()) {
             res = m_client->call(req, result_timeout);
@@ -69,7 +274,22 @@ namespace cbdc::locking_shard::rpc {
     }
 
     void client::stop() {
-        m_running = false;
+        {
+            std::unique_lock<std::mutex> l(m_pending_mut);
+            m_running = false;
+        }
+        m_pending_cv.notify_all();
+        if(m_hedge_thread.joinable()) {
+            m_hedge_thread.join();
+        }
         m_client.reset();
+        // No more responses can arrive, so fail the remaining requests.
+        auto pending = [&]() {
+            std::unique_lock<std::mutex> l(m_pending_mut);
+            return std::exchange(m_pending, {});
+        }();
+        for(auto& [id, req] : pending) {
+            req.m_cb(std::nullopt);
+        }
     }
 }
@@ -9,8 +9,12 @@
 #include "interface.hpp"
 #include "messages.hpp"
 #include "util/common/logging.hpp"
+#include "util/common/tracing.hpp"
 #include "util/rpc/tcp_client.hpp"
 
+#include <condition_variable>
+#include <unordered_map>
+
 namespace cbdc::locking_shard::rpc {
     /// RPC client for the mutable interface to a locking shard raft cluster.
     class client final : public interface {
@@ -59,22 +63,143 @@ namespace cbdc::locking_shard::rpc {
         auto apply_outputs(std::vector<bool>&& complete_txs,
                            const hash_t& dtx_id) -> bool override;
 
+        /// Issues a lock-and-apply RPC to the remote shard and returns its
+        /// response.
+        /// \param txs vector of txs to lock and apply
+        /// \param dtx_id dtx ID for this batch of transactions
+        /// \return if the operation succeeds, a vector of flags indicating
+        ///         which transactions in the batch were completed
+        auto lock_and_apply(std::vector<tx>&& txs, const hash_t& dtx_id)
+            -> std::optional<std::vector<bool>> override;
+
+        /// Issues a lock-and-apply RPC, as \ref lock_and_apply, serializing
+        /// the transactions directly from the shared batch.
+        /// \param txs transactions to lock and apply.
+        /// \param dtx_id dtx ID for this batch of transactions.
+        /// \return if the operation succeeds, a vector of flags indicating
+        ///         which transactions in the batch were completed.
+        auto lock_and_apply_batch(tx_batch txs, const hash_t& dtx_id)
+            -> std::optional<std::vector<bool>> override;
+
         /// Issues a discard RPC to the remote shard and returns its response.
         /// \param dtx_id dtx ID to discard
         /// \return true if the discard operation succeeded
         auto discard_dtx(const hash_t& dtx_id) -> bool override;
 
+        /// Issues a lock RPC to the remote shard without waiting for its
+        /// response. If no response arrives within the request timeout,
+        /// the request is sent again, possibly to another node in the
+        /// cluster, and the first response to either copy is used.
+        /// \param txs vector of txs to lock.
+        /// \param dtx_id dtx ID for this batch of transactions.
+        /// \param cb function to call from the response handler thread with
+        ///           the lock result, or std::nullopt if the client stops.
+        void lock_outputs_async(std::vector<tx>&& txs,
+                                const hash_t& dtx_id,
+                                lock_callback_type cb) override;
+
+        /// Issues a lock RPC, as \ref lock_outputs_async. Retries share the
+        /// batch rather than copying the transactions.
+        /// \param txs transactions to lock.
+        /// \param dtx_id dtx ID for this batch of transactions.
+        /// \param cb function to call with the lock result.
+        void lock_batch_async(tx_batch txs,
+                              const hash_t& dtx_id,
+                              lock_callback_type cb) override;
+
+        /// Issues an apply RPC to the remote shard without waiting for its
+        /// response, as \ref lock_outputs_async.
+        /// \param complete_txs vector of flags indicating which txs to apply.
+        /// \param dtx_id dtx ID upon which to perform apply.
+        /// \param cb function to call with the result of the apply.
+        void apply_outputs_async(std::vector<bool>&& complete_txs,
+                                 const hash_t& dtx_id,
+                                 done_callback_type cb) override;
+
+        /// Issues a discard RPC to the remote shard without waiting for its
+        /// response, as \ref lock_outputs_async.
+        /// \param dtx_id dtx ID to discard.
+        /// \param cb function to call with the result of the discard.
+        void discard_dtx_async(const hash_t& dtx_id,
+                               done_callback_type cb) override;
+
+        /// Makes the shard cluster start shadowing a range of UHS IDs it
+        /// is taking over from another shard. See
+        /// \ref locking_shard::begin_import.
+        /// \param range inclusive range of UHS ID prefixes to import.
+        /// \return true if the shard is importing the range.
+        auto begin_import(const std::pair<uint8_t, uint8_t>& range) -> bool;
+
+        /// Sends a chunk of unspent UHS IDs in the range being imported.
+        /// \param uhs_ids UHS IDs to import.
+        /// \return true if the shard accepted the UHS IDs.
+        auto import_uhs(std::vector<hash_t> uhs_ids) -> bool;
+
+        /// Ends the import started by \ref begin_import.
+        /// \return true if an import was running.
+        auto end_import() -> bool;
+
+        /// Reads a chunk of the unspent UHS IDs the shard cluster holds in
+        /// a range. See \ref locking_shard::read_range.
+        /// \param range inclusive range of UHS ID prefixes to read.
+        /// \param offset number of UHS IDs already read.
+        /// \return the next chunk of UHS IDs, empty once all have been
+        ///         read, or std::nullopt if the request failed.
+        auto read_range(const std::pair<uint8_t, uint8_t>& range,
+                        uint64_t offset) -> std::optional<std::vector<hash_t>>;
+
+        /// Makes the shard cluster drop a range of UHS IDs another shard
+        /// has taken over.
+        /// \param range inclusive range of UHS ID prefixes to drop.
+        /// \return true if the shard dropped the range.
+        auto drop_range(const std::pair<uint8_t, uint8_t>& range) -> bool;
+
         /// Shuts down the client and unblocks any existing requests waiting
         /// for a response.
         void stop() override;
 
       private:
+        using response_callback_type
+            = std::function<void(std::optional<response>)>;
+
+        /// Asynchronous request awaiting its first successful response.
+        struct pending_request {
+            /// Request to send to the shard.
+            request m_req;
+            /// Function to call with the response.
+            response_callback_type m_cb;
+            /// Time after which the request is sent again.
+            std::chrono::steady_clock::time_point m_deadline;
+            /// Time to wait for a response to the next copy of the request.
+            std::chrono::milliseconds m_timeout;
+            /// Trace context of the caller, restored when the request is
+            /// sent again.
+            std::optional<tracing::context> m_trace;
+        };
+
+        static constexpr auto initial_result_timeout
+            = std::chrono::milliseconds(3000);
+        static constexpr auto max_result_timeout
+            = std::chrono::milliseconds(10000);
+        static constexpr auto retry_delay = std::chrono::milliseconds(1000);
+
         auto send_request(const request& req) -> std::optional<response>;
+        auto send_range_request(request req) -> std::optional<range_response>;
+        void send_async(request req, response_callback_type cb);
+        void send_pending(uint64_t id);
+        void handle_response(uint64_t id, std::optional<response> resp);
+        void hedge_loop();
 
         std::atomic_bool m_running{true};
 
         std::unique_ptr<cbdc::rpc::tcp_client<request, response>> m_client;
 
+        std::mutex m_pending_mut;
+        std::condition_variable m_pending_cv;
+        std::unordered_map<uint64_t, pending_request> m_pending;
+        uint64_t m_next_pending_id{0};
+        std::thread m_hedge_thread;
+
         logging::log& m_log;
     };
 }
@@ -6,6 +6,7 @@
 #include "controller.hpp"
 
 #include "format.hpp"
+#include "replica_status.hpp"
 #include "state_machine.hpp"
 #include "status_client.hpp"
 #include "util/rpc/tcp_server.hpp"
@@ -14,6 +15,36 @@
 #include <utility>
 
 namespace cbdc::locking_shard {
+    namespace {
+        void publish(const std::string& name,
+                     const std::string& desc,
+                     const locking_shard::structure_usage& usage) {
+            auto& reg = metrics::registry::global();
+            reg.get_gauge("shard_" + name + "_entries",
+                          "Entries in the shard's " + desc + ".")
+                .set(usage.m_entries);
+            reg.get_gauge("shard_" + name + "_bytes",
+                          "Estimated bytes held by the shard's " + desc + ".")
+                .set(usage.m_bytes);
+        }
+
+        void publish(const locking_shard::memory_usage& usage) {
+            publish("uhs", "unspent UHS ID set", usage.m_uhs);
+            publish("locked", "locked UHS ID set", usage.m_locked);
+            publish("changes", "tracked UHS changes", usage.m_changes);
+            publish("prepared_dtxs", "prepared dtxs", usage.m_prepared_dtxs);
+            publish("applied_dtxs",
+                    "applied dtxs awaiting discard",
+                    usage.m_applied_dtxs);
+            publish("one_phase_dtxs",
+                    "lock-and-apply results awaiting discard",
+                    usage.m_one_phase_dtxs);
+            publish("completed_txs",
+                    "completed TX ID cache",
+                    usage.m_completed_txs);
+        }
+    }
+
     controller::controller(size_t shard_id,
                            size_t node_id,
                            config::options opts,
@@ -43,7 +74,8 @@ namespace cbdc::locking_shard {
         params.election_timeout_upper_bound_
             = static_cast<int>(m_opts.m_election_timeout_upper);
         params.heart_beat_interval_ = static_cast<int>(m_opts.m_heartbeat);
-        params.snapshot_distance_ = 0; // TODO: implement snapshots
+        params.snapshot_distance_
+            = static_cast<int>(m_opts.m_snapshot_distance);
         params.max_append_size_ = static_cast<int>(m_opts.m_raft_max_batch);
 
         if(m_shard_id > (m_opts.m_shard_ranges.size() - 1)) {
@@ -57,7 +89,12 @@ namespace cbdc::locking_shard {
             m_logger,
             m_opts.m_shard_completed_txs_cache_size,
             m_preseed_dir,
-            m_opts);
+            m_opts,
+            "shard_snps_" + std::to_string(m_shard_id) + "_"
+                + std::to_string(m_node_id),
+            m_opts.m_shard_uhs_export_dir + "/shard"
+                + std::to_string(m_shard_id) + "_"
+                + std::to_string(m_node_id) + "_uhs_");
 
         m_shard = m_state_machine->get_shard_instance();
 
@@ -87,7 +124,21 @@ namespace cbdc::locking_shard {
             [&](auto&& res, auto&& err) {
                 return raft_callback(std::forward<decltype(res)>(res),
                                      std::forward<decltype(err)>(err));
+            },
+            raft::log_store_options{m_opts.m_raft_log_backend,
+                                    m_opts.m_raft_log_cache_bytes,
+                                    m_opts.m_raft_log_segment_bytes,
+                                    m_opts.m_raft_log_leveldb});
+        // The node stops committing before it is destroyed, so the state
+        // machine never calls into it afterwards
+        m_state_machine->set_commit_listener(
+            [raft = m_raft_serv.get()]() {
+                raft->notify_applied();
             });
+        m_replicator = std::make_shared<raft::batching_replicator>(
+            m_raft_serv,
+            state_machine::batch_prefix(),
+            m_opts.m_raft_entry_batch);
 
         if(!m_raft_serv->init(params)) {
             m_logger->error("Failed to initialize raft server");
@@ -97,20 +148,53 @@ namespace cbdc::locking_shard {
         auto status_rpc_server = std::make_unique<
             cbdc::rpc::blocking_tcp_server<rpc::status_request,
                                            rpc::status_response>>(
-            m_opts.m_locking_shard_readonly_endpoints[m_shard_id][m_node_id]);
+            m_opts.m_locking_shard_readonly_endpoints[m_shard_id][m_node_id],
+            network::priority::high);
         if(!status_rpc_server->init()) {
             m_logger->error("Failed to start status RPC server");
             return false;
         }
 
+        auto status = std::shared_ptr<status_interface>(m_shard);
+        if(m_opts.m_shard_read_index) {
+            auto replica = std::make_shared<replica_status>(
+                m_shard,
+                m_raft_serv,
+                m_node_id,
+                m_opts.m_locking_shard_readonly_endpoints[m_shard_id],
+                m_logger);
+            if(!replica->init()) {
+                m_logger->error("Failed to start replica status clients");
+                return false;
+            }
+            status = std::move(replica);
+        }
+
         m_status_server
             = std::make_unique<decltype(m_status_server)::element_type>(
-                m_shard,
-                std::move(status_rpc_server));
+                std::move(status),
+                std::move(status_rpc_server),
+                m_raft_serv);
+
+        if(m_opts.m_metrics_sample_interval_ms > 0) {
+            m_sampler = std::make_unique<metrics::sampler>(
+                std::chrono::milliseconds(m_opts.m_metrics_sample_interval_ms),
+                [shard = m_shard]() {
+                    publish(shard->memory());
+                });
+        }
 
         return true;
     }
 
+    void controller::transfer_leadership() {
+        if(m_opts.m_leadership_transfer_timeout == 0) {
+            return;
+        }
+        static_cast<void>(m_raft_serv->transfer_leadership(
+            std::chrono::milliseconds(m_opts.m_leadership_transfer_timeout)));
+    }
+
     auto controller::raft_callback(nuraft::cb_func::Type type,
                                    nuraft::cb_func::Param* /* param */)
         -> nuraft::cb_func::ReturnCode {
@@ -123,7 +207,7 @@ namespace cbdc::locking_shard {
             m_logger->warn("Became leader, starting listener");
             m_server = std::make_unique<decltype(m_server)::element_type>(
                 m_opts.m_locking_shard_endpoints[m_shard_id][m_node_id]);
-            m_server->register_raft_node(m_raft_serv);
+            m_server->register_raft_node(m_raft_serv, m_replicator);
             if(!m_server->init()) {
                 m_logger->fatal("Couldn't start message handler server");
             }
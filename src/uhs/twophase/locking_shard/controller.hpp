@@ -10,6 +10,7 @@
 #include "locking_shard.hpp"
 #include "state_machine.hpp"
 #include "status_server.hpp"
+#include "util/common/metrics.hpp"
 #include "util/raft/node.hpp"
 #include "util/raft/rpc_server.hpp"
 #include "util/rpc/tcp_server.hpp"
@@ -42,6 +43,10 @@ namespace cbdc::locking_shard {
         /// \return false if initialization fails.
         auto init() -> bool;
 
+        /// Hands raft leadership to an up-to-date follower if this node
+        /// leads the shard cluster. Call before shutting down.
+        void transfer_leadership();
+
       private:
         auto raft_callback(nuraft::cb_func::Type type,
                            nuraft::cb_func::Param* param)
@@ -56,8 +61,12 @@ namespace cbdc::locking_shard {
         std::shared_ptr<state_machine> m_state_machine;
         std::shared_ptr<locking_shard> m_shard;
         std::shared_ptr<raft::node> m_raft_serv;
+        /// Combines concurrent requests into shared log entries.
+        std::shared_ptr<raft::batching_replicator> m_replicator;
         std::unique_ptr<rpc::status_server> m_status_server;
         std::unique_ptr<cbdc::rpc::tcp_server<raft::rpc::server>> m_server;
+        /// Samples the sizes of the shard's structures into gauges.
+        std::unique_ptr<metrics::sampler> m_sampler;
     };
 }
 
@@ -8,6 +8,8 @@
 #include "uhs/transaction/messages.hpp"
 #include "util/serialization/format.hpp"
 
+#include <climits>
+
 namespace cbdc {
     auto operator<<(serializer& packet, const locking_shard::tx& tx)
         -> serializer& {
@@ -18,6 +20,67 @@ namespace cbdc {
         return packet >> tx.m_tx;
     }
 
+    auto operator<<(serializer& packet, const locking_shard::tx_batch& txs)
+        -> serializer& {
+        packet << static_cast<uint64_t>(txs.size());
+        for(size_t i{0}; i < txs.size(); i++) {
+            packet << txs[i];
+        }
+        return packet;
+    }
+
+    auto operator>>(serializer& packet, locking_shard::tx_batch& txs)
+        -> serializer& {
+        auto vec = std::vector<locking_shard::tx>();
+        if(packet >> vec) {
+            txs = locking_shard::tx_batch(std::move(vec));
+        }
+        return packet;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::lock_apply_params& p)
+        -> serializer& {
+        return packet << p.m_txs;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::lock_apply_params& p) -> serializer& {
+        return packet >> p.m_txs;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::range_params& p) -> serializer& {
+        return packet << p.m_op << p.m_range << p.m_offset;
+    }
+
+    auto operator>>(serializer& packet, locking_shard::rpc::range_params& p)
+        -> serializer& {
+        return packet >> p.m_op >> p.m_range >> p.m_offset;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::import_params& p)
+        -> serializer& {
+        return packet << p.m_uhs_ids;
+    }
+
+    auto operator>>(serializer& packet, locking_shard::rpc::import_params& p)
+        -> serializer& {
+        return packet >> p.m_uhs_ids;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::range_response& p)
+        -> serializer& {
+        return packet << p.m_success << p.m_uhs_ids;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::range_response& p) -> serializer& {
+        return packet >> p.m_success >> p.m_uhs_ids;
+    }
+
     auto operator<<(serializer& packet, const locking_shard::rpc::request& p)
         -> serializer& {
         return packet << p.m_dtx_id << p.m_params;
@@ -49,4 +112,93 @@ namespace cbdc {
                     locking_shard::rpc::uhs_status_request& p) -> serializer& {
         return packet >> p.m_uhs_id;
     }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::tx_status_batch_request& p)
+        -> serializer& {
+        return packet << p.m_tx_ids;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::tx_status_batch_request& p)
+        -> serializer& {
+        return packet >> p.m_tx_ids;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::uhs_status_batch_request& p)
+        -> serializer& {
+        return packet << p.m_uhs_ids;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::uhs_status_batch_request& p)
+        -> serializer& {
+        return packet >> p.m_uhs_ids;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::read_index_request& /* p */)
+        -> serializer& {
+        return packet;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::read_index_request& /* p */)
+        -> serializer& {
+        return packet;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::read_index_response& p)
+        -> serializer& {
+        return packet << p.m_commit_idx;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::read_index_response& p)
+        -> serializer& {
+        return packet >> p.m_commit_idx;
+    }
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::status_batch_response& p)
+        -> serializer& {
+        const auto& flags = p.m_statuses;
+        packet << static_cast<uint64_t>(flags.size());
+        for(size_t i{0}; i < flags.size(); i += CHAR_BIT) {
+            uint8_t byte{0};
+            for(size_t j{0}; j < CHAR_BIT && i + j < flags.size(); j++) {
+                if(flags[i + j]) {
+                    byte = static_cast<uint8_t>(byte | (1U << j));
+                }
+            }
+            packet << byte;
+        }
+        return packet;
+    }
+
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::status_batch_response& p)
+        -> serializer& {
+        auto len = uint64_t();
+        if(!(packet >> len)) {
+            return packet;
+        }
+        auto& flags = p.m_statuses;
+        flags.clear();
+        // Bound the up-front allocation in case the length is corrupt.
+        flags.reserve(static_cast<size_t>(
+            std::min<uint64_t>(len, config::maximum_reservation * CHAR_BIT)));
+        for(uint64_t i{0}; i < len; i += CHAR_BIT) {
+            uint8_t byte{0};
+            if(!(packet >> byte)) {
+                return packet;
+            }
+            for(uint64_t j{0}; j < CHAR_BIT && i + j < len; j++) {
+                flags.push_back(((byte >> j) & 1U) != 0);
+            }
+        }
+        return packet;
+    }
 }
@@ -14,6 +14,36 @@ namespace cbdc {
         -> serializer&;
     auto operator>>(serializer& packet, locking_shard::tx& tx) -> serializer&;
 
+    /// Serializes the transactions of a batch as a list of \ref
+    /// locking_shard::tx, without copying them out of a shared batch.
+    auto operator<<(serializer& packet, const locking_shard::tx_batch& txs)
+        -> serializer&;
+    auto operator>>(serializer& packet, locking_shard::tx_batch& txs)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::lock_apply_params& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::lock_apply_params& p) -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::range_params& p) -> serializer&;
+    auto operator>>(serializer& packet, locking_shard::rpc::range_params& p)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::import_params& p)
+        -> serializer&;
+    auto operator>>(serializer& packet, locking_shard::rpc::import_params& p)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::range_response& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::range_response& p) -> serializer&;
+
     auto operator<<(serializer& packet, const locking_shard::rpc::request& p)
         -> serializer&;
     auto operator>>(serializer& packet, locking_shard::rpc::request& p)
@@ -30,6 +60,42 @@ namespace cbdc {
         -> serializer&;
     auto operator>>(serializer& packet,
                     locking_shard::rpc::uhs_status_request& p) -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::tx_status_batch_request& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::tx_status_batch_request& p)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::uhs_status_batch_request& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::uhs_status_batch_request& p)
+        -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::read_index_request& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::read_index_request& p) -> serializer&;
+
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::read_index_response& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::read_index_response& p)
+        -> serializer&;
+
+    /// Serializes the flag count, then the flags packed eight per byte,
+    /// least significant bit first.
+    auto operator<<(serializer& packet,
+                    const locking_shard::rpc::status_batch_response& p)
+        -> serializer&;
+    auto operator>>(serializer& packet,
+                    locking_shard::rpc::status_batch_response& p)
+        -> serializer&;
 }
 
 #endif // OPENCBDC_TX_SRC_LOCKING_SHARD_MESSAGES_H_
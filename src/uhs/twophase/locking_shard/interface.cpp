@@ -17,7 +17,93 @@ namespace cbdc::locking_shard {
         return config::hash_in_shard_range(m_output_range, h);
     }
 
+    auto interface::output_range() const
+        -> const std::pair<uint8_t, uint8_t>& {
+        return m_output_range;
+    }
+
+    void interface::lock_outputs_async(std::vector<tx>&& txs,
+                                       const hash_t& dtx_id,
+                                       lock_callback_type cb) {
+        cb(lock_outputs(std::move(txs), dtx_id));
+    }
+
+    void interface::lock_batch_async(tx_batch txs,
+                                     const hash_t& dtx_id,
+                                     lock_callback_type cb) {
+        lock_outputs_async(std::move(txs).take(), dtx_id, std::move(cb));
+    }
+
+    auto interface::lock_and_apply_batch(tx_batch txs, const hash_t& dtx_id)
+        -> std::optional<std::vector<bool>> {
+        return lock_and_apply(std::move(txs).take(), dtx_id);
+    }
+
+    void interface::apply_outputs_async(std::vector<bool>&& complete_txs,
+                                        const hash_t& dtx_id,
+                                        done_callback_type cb) {
+        cb(apply_outputs(std::move(complete_txs), dtx_id));
+    }
+
+    void interface::discard_dtx_async(const hash_t& dtx_id,
+                                      done_callback_type cb) {
+        cb(discard_dtx(dtx_id));
+    }
+
     auto tx::operator==(const tx& rhs) const -> bool {
         return m_tx == rhs.m_tx;
     }
+
+    tx_batch::tx_batch(std::vector<tx> txs)
+        : m_txs(std::make_shared<std::vector<transaction::compact_tx>>()),
+          m_idxs(txs.size()) {
+        m_txs->reserve(txs.size());
+        for(size_t i{0}; i < txs.size(); i++) {
+            m_txs->emplace_back(std::move(txs[i].m_tx));
+            m_idxs[i] = i;
+        }
+    }
+
+    tx_batch::tx_batch(
+        std::shared_ptr<std::vector<transaction::compact_tx>> txs,
+        std::vector<uint64_t> idxs)
+        : m_txs(std::move(txs)),
+          m_idxs(std::move(idxs)) {}
+
+    auto tx_batch::size() const -> size_t {
+        return m_idxs.size();
+    }
+
+    auto tx_batch::operator[](size_t i) const
+        -> const transaction::compact_tx& {
+        return (*m_txs)[m_idxs[i]];
+    }
+
+    auto tx_batch::take() && -> std::vector<tx> {
+        auto ret = std::vector<tx>();
+        ret.reserve(m_idxs.size());
+        const auto unique = m_txs.use_count() == 1;
+        for(auto idx : m_idxs) {
+            if(unique) {
+                ret.push_back(tx{std::move((*m_txs)[idx])});
+            } else {
+                ret.push_back(tx{(*m_txs)[idx]});
+            }
+        }
+        m_txs.reset();
+        m_idxs.clear();
+        return ret;
+    }
+
+    auto tx_batch::operator==(const tx_batch& rhs) const -> bool {
+        if(size() != rhs.size()) {
+            return false;
+        }
+        for(size_t i{0}; i < size(); i++) {
+            if(!((*this)[i] == rhs[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
 }
@@ -9,6 +9,8 @@
 #include "uhs/transaction/transaction.hpp"
 #include "util/common/hash.hpp"
 
+#include <functional>
+#include <memory>
 #include <optional>
 #include <variant>
 #include <vector>
@@ -22,6 +24,53 @@ namespace cbdc::locking_shard {
         auto operator==(const tx& rhs) const -> bool;
     };
 
+    /// \brief Transactions of a dtx bound for one shard.
+    ///
+    /// Holds indices into a batch of transactions which may be shared with
+    /// other shards' batches and copies of the same request, so the
+    /// coordinator stores each transaction of a dtx once however many
+    /// shards it touches. The shared batch must not be modified while
+    /// referenced. Serializes as a list of \ref tx, read directly from the
+    /// shared batch.
+    class tx_batch {
+      public:
+        /// Constructs an empty batch.
+        tx_batch() = default;
+
+        /// Constructor for transactions owned by this batch alone.
+        /// \param txs transactions.
+        tx_batch(std::vector<tx> txs); // NOLINT(google-explicit-constructor)
+
+        /// Constructor for a view into a shared batch.
+        /// \param txs shared transactions.
+        /// \param idxs distinct indices in txs of the transactions in this
+        ///             batch, in order.
+        tx_batch(std::shared_ptr<std::vector<transaction::compact_tx>> txs,
+                 std::vector<uint64_t> idxs);
+
+        /// Returns the number of transactions in the batch.
+        /// \return batch size.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Returns a transaction in the batch.
+        /// \param i position of the transaction in this batch.
+        /// \return transaction.
+        [[nodiscard]] auto operator[](size_t i) const
+            -> const transaction::compact_tx&;
+
+        /// Returns the transactions of the batch, moving them out of the
+        /// shared batch if nothing else references it, or copying them
+        /// otherwise.
+        /// \return transactions in order.
+        [[nodiscard]] auto take() && -> std::vector<tx>;
+
+        auto operator==(const tx_batch& rhs) const -> bool;
+
+      private:
+        std::shared_ptr<std::vector<transaction::compact_tx>> m_txs;
+        std::vector<uint64_t> m_idxs;
+    };
+
     /// Interface for a locking shard. Intended to allow for other
     /// classes to pick an implementation.
     /// \see locking_shard for an in-memory implementation using hashmaps
@@ -66,12 +115,87 @@ namespace cbdc::locking_shard {
                                    const hash_t& dtx_id) -> bool
             = 0;
 
+        /// Locks and then applies the given transactions in one step, for
+        /// a dtx in which no other shard takes part. Each transaction
+        /// whose relevant inputs were locked is completed, and the rest are
+        /// cancelled, as if \ref lock_outputs were followed by \ref
+        /// apply_outputs with its own result. Repeating the call with the
+        /// same dtx ID before \ref discard_dtx returns the first result.
+        /// \param txs list of txs to lock and apply.
+        /// \param dtx_id distributed tx ID for the operation.
+        /// \return if the operation succeeds, a vector of flags indicating
+        ///         which txs in the input vector were completed. Otherwise
+        ///         std::nullopt.
+        virtual auto lock_and_apply(std::vector<tx>&& txs,
+                                    const hash_t& dtx_id)
+            -> std::optional<std::vector<bool>> = 0;
+
+        /// Callback type for the result of an asynchronous lock.
+        using lock_callback_type
+            = std::function<void(std::optional<std::vector<bool>>)>;
+
+        /// Callback type for the result of an asynchronous apply or discard.
+        using done_callback_type = std::function<void(bool)>;
+
+        /// Asynchronous version of \ref lock_outputs. The callback may be
+        /// called from another thread, or before this function returns. The
+        /// default implementation calls \ref lock_outputs and passes its
+        /// result to the callback.
+        /// \param txs list of txs to attempt to lock.
+        /// \param dtx_id distributed tx ID for lock operation.
+        /// \param cb function to call with the result of the lock.
+        virtual void lock_outputs_async(std::vector<tx>&& txs,
+                                        const hash_t& dtx_id,
+                                        lock_callback_type cb);
+
+        /// Version of \ref lock_outputs_async taking a view of a shared
+        /// batch. The default implementation copies the transactions and
+        /// calls \ref lock_outputs_async.
+        /// \param txs transactions to attempt to lock.
+        /// \param dtx_id distributed tx ID for lock operation.
+        /// \param cb function to call with the result of the lock.
+        virtual void lock_batch_async(tx_batch txs,
+                                      const hash_t& dtx_id,
+                                      lock_callback_type cb);
+
+        /// Version of \ref lock_and_apply taking a view of a shared batch.
+        /// The default implementation copies the transactions and calls
+        /// \ref lock_and_apply.
+        /// \param txs transactions to lock and apply.
+        /// \param dtx_id distributed tx ID for the operation.
+        /// \return flags indicating which txs were completed, or
+        ///         std::nullopt if the operation failed.
+        virtual auto lock_and_apply_batch(tx_batch txs, const hash_t& dtx_id)
+            -> std::optional<std::vector<bool>>;
+
+        /// Asynchronous version of \ref apply_outputs, as \ref
+        /// lock_outputs_async.
+        /// \param complete_txs vector of flags indicating which txs to apply.
+        /// \param dtx_id distributed transaction ID of the previous lock
+        ///               operation.
+        /// \param cb function to call with the result of the apply.
+        virtual void apply_outputs_async(std::vector<bool>&& complete_txs,
+                                         const hash_t& dtx_id,
+                                         done_callback_type cb);
+
+        /// Asynchronous version of \ref discard_dtx, as \ref
+        /// lock_outputs_async.
+        /// \param dtx_id distributed transaction ID to discard.
+        /// \param cb function to call with the result of the discard.
+        virtual void discard_dtx_async(const hash_t& dtx_id,
+                                       done_callback_type cb);
+
         /// Returns whether a given hash is within the shard's range.
         /// \param h hash to check.
         /// \return true if the hash is within the shard's range.
         [[nodiscard]] virtual auto hash_in_shard_range(const hash_t& h) const
             -> bool;
 
+        /// Returns the shard's hash prefix range.
+        /// \return inclusive hash prefix range.
+        [[nodiscard]] auto output_range() const
+            -> const std::pair<uint8_t, uint8_t>&;
+
         /// Discards any cached information about a given distributed
         /// transaction.
         /// \param dtx_id distributed transaction ID of a previous apply
@@ -5,26 +5,54 @@
 
 #include "locking_shard.hpp"
 
+#include "format.hpp"
 #include "messages.hpp"
 #include "uhs/transaction/validation.hpp"
 #include "util/common/config.hpp"
+#include "util/common/mapped_hash_array.hpp"
+#include "util/common/metrics.hpp"
+#include "util/common/tracing.hpp"
+#include "util/oracle/schema.hpp"
+#include "util/persistence/factory.hpp"
+#include "util/persistence/hash_export.hpp"
+#include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
-#include "util/serialization/istream_serializer.hpp"
+#include "util/serialization/size_serializer.hpp"
 
-#include "oracleDB.h"
-
-OracleDB db;
+#include <algorithm>
+#include <climits>
 
 namespace cbdc::locking_shard {
     auto locking_shard::discard_dtx(const hash_t& dtx_id) -> bool {
-        std::unique_lock<std::shared_mutex> l(m_mut);
+        std::unique_lock<std::mutex> l(m_dtx_mut);
         bool running = m_running;
         if(running) {
             m_applied_dtxs.erase(dtx_id);
+            m_one_phase_dtxs.erase(dtx_id);
         }
         return running;
     }
 
+    void locking_shard::age_one_phase_dtx(const hash_t& dtx_id) {
+        auto generation_size
+            = std::max<size_t>(m_opts.m_shard_applied_dtx_generation_size, 1);
+        if(m_one_phase_generations.empty()
+           || m_one_phase_generations.back().size() >= generation_size) {
+            // Keep as many full generations as m_applied_dtxs seals, plus
+            // the one being filled
+            while(!m_one_phase_generations.empty()
+                  && m_one_phase_generations.size()
+                         > m_opts.m_shard_applied_dtx_generations) {
+                for(const auto& id : m_one_phase_generations.front()) {
+                    m_one_phase_dtxs.erase(id);
+                }
+                m_one_phase_generations.pop_front();
+            }
+            m_one_phase_generations.emplace_back();
+        }
+        m_one_phase_generations.back().push_back(dtx_id);
+    }
+
     locking_shard::locking_shard(
         const std::pair<uint8_t, uint8_t>& output_range,
         std::shared_ptr<logging::log> logger,
@@ -33,133 +61,537 @@ namespace cbdc::locking_shard {
         config::options opts)
         : interface(output_range),
           m_logger(std::move(logger)),
+          m_applied_dtxs(opts.m_shard_applied_dtx_generation_size,
+                         opts.m_shard_applied_dtx_generations),
           m_completed_txs(completed_txs_cache_size),
-          m_opts(std::move(opts)) {
-        m_uhs.max_load_factor(std::numeric_limits<float>::max());
-        m_applied_dtxs.max_load_factor(std::numeric_limits<float>::max());
+          m_opts(std::move(opts)),
+          m_stripes(m_opts.m_shard_lock_stripes),
+          m_attestation_threads(std::max<size_t>(
+              m_opts.m_shard_attestation_threads > 0
+                  ? m_opts.m_shard_attestation_threads
+                  : std::thread::hardware_concurrency(),
+              1)),
+          // The calling thread checks one chunk itself, so the pool only
+          // needs the remaining threads
+          m_attestation_pool(
+              m_attestation_threads > 1
+                  ? std::make_unique<thread_pool>(m_attestation_threads - 1,
+                                                  false,
+                                                  thread_role::executor)
+                  : nullptr),
+          m_persistence(m_logger,
+                        persistence::make_sink(m_opts,
+                                               m_logger,
+                                               "admin.shard_data",
+                                               {"raw_data"}),
+                        m_opts.m_oracle_queue_high_water_mark,
+                        m_opts.m_oracle_batch_size,
+                        persistence::make_retry_policy(m_opts)),
+          m_spent_persistence(
+              m_logger,
+              persistence::make_sink(m_opts,
+                                     m_logger,
+                                     "admin.shard_spent",
+                                     {"dtx_id", "tx_id", "uhs_id"},
+                                     oracle::shard_partition_name(
+                                         output_range)),
+              m_opts.m_oracle_queue_high_water_mark,
+              m_opts.m_oracle_batch_size,
+              persistence::make_retry_policy(m_opts)),
+          m_created_persistence(
+              m_logger,
+              persistence::make_sink(m_opts,
+                                     m_logger,
+                                     "admin.shard_created",
+                                     {"dtx_id", "tx_id", "uhs_id"},
+                                     oracle::shard_partition_name(
+                                         output_range)),
+              m_opts.m_oracle_queue_high_water_mark,
+              m_opts.m_oracle_batch_size,
+              persistence::make_retry_policy(m_opts)),
+          m_tx_persistence(
+              m_logger,
+              persistence::make_sink(m_opts,
+                                     m_logger,
+                                     "admin.shard_txs",
+                                     {"tx_id"},
+                                     oracle::shard_partition_name(
+                                         output_range)),
+              m_opts.m_oracle_queue_high_water_mark,
+              m_opts.m_oracle_batch_size,
+              persistence::make_retry_policy(m_opts)) {
         m_prepared_dtxs.max_load_factor(std::numeric_limits<float>::max());
-        m_locked.max_load_factor(std::numeric_limits<float>::max());
 
         static constexpr auto dtx_buckets = 100000;
-        m_applied_dtxs.rehash(dtx_buckets);
         m_prepared_dtxs.rehash(dtx_buckets);
 
-        static constexpr auto locked_buckets = 10000000;
-        m_locked.rehash(locked_buckets);
+        // Flat tables store keys inline, so this reserves about the same
+        // memory as the bucket array previously sized for 10M locks.
+        static constexpr auto locked_keys = 2000000;
+        for(auto& s : m_stripes) {
+            s.m_locked.reserve(locked_keys / m_stripes.size());
+        }
 
         if(!preseed_file.empty()) {
             m_logger->info("Reading preseed file into memory");
             if(!read_preseed_file(preseed_file)) {
                 m_logger->error("Preseeding failed");
             } else {
-                m_logger->info("Preseeding complete -", m_uhs.size(), "utxos");
+                size_t utxos{0};
+                for(const auto& s : m_stripes) {
+                    utxos += s.m_uhs.size();
+                }
+                m_logger->info("Preseeding complete -", utxos, "utxos");
             }
         }
 
-        // Connecting to Oracle Autonomous Database
-        if (OracleDB_init(&db) == 0) {
-            if (OracleDB_connect(&db) == 0) {
-                m_logger->info("Connected to Oracle Autonomous Database");
-            } else {
-                m_logger->error("Failed to connect to Oracle Autonomous Database");
-            }
+        if(!m_persistence.start()) {
+            m_logger->warn("Applied dtx IDs will not be persisted");
+        }
+        if(!m_spent_persistence.start() || !m_created_persistence.start()) {
+            m_logger->warn("Spent and created UHS IDs will not be persisted");
+        }
+        if(!m_tx_persistence.start()) {
+            m_logger->warn("Confirmed TX IDs will not be persisted");
+        }
+
+        if(m_opts.m_persistence_backend == config::persistence_backend::oracle
+           && m_opts.m_oracle_tx_lookup_max_keys > 0) {
+            start_tx_lookup(output_range);
+        }
+    }
+
+    locking_shard::~locking_shard() {
+        m_export_stop = true;
+        wait_for_export();
+        if(m_tx_filter_thread.joinable()) {
+            m_tx_filter_thread.join();
+        }
+    }
+
+    void locking_shard::start_tx_lookup(
+        const std::pair<uint8_t, uint8_t>& output_range) {
+        auto pool = std::make_shared<oracle::session_pool>(
+            m_logger,
+            m_opts.m_oracle_pool_min_sessions,
+            m_opts.m_oracle_pool_max_sessions,
+            m_opts.m_oracle_pool_increment,
+            m_opts.m_oracle_stmt_cache_size);
+        m_tx_lookup = std::make_unique<oracle::hash_lookup>(
+            m_logger,
+            std::move(pool),
+            "admin.shard_txs",
+            "tx_id",
+            oracle::shard_partition_name(output_range),
+            std::chrono::microseconds(m_opts.m_oracle_tx_lookup_window_us),
+            m_opts.m_oracle_tx_lookup_max_keys);
+
+        // The lookup worker connects on its first batch, so starting it
+        // does not wait for the database
+        m_tx_lookup->start();
+
+        if(m_opts.m_shard_tx_bloom_filter_items > 0) {
+            // The filter must hold every TX ID already persisted, or it
+            // would rule out TX IDs confirmed before this shard started.
+            // It is created first so TX IDs confirmed during the scan are
+            // added too, but only used once the scan completes.
+            m_tx_filter = std::make_unique<bloom_filter>(
+                m_opts.m_shard_tx_bloom_filter_items,
+                m_opts.m_shard_tx_bloom_filter_fp_rate);
+            m_tx_filter_thread = std::thread([&]() {
+                m_logger->info("Loading persisted TX IDs into Bloom filter");
+                size_t loaded{0};
+                auto ok = m_tx_lookup->scan([&](const hash_t& tx_id) {
+                    m_tx_filter->add(tx_id);
+                    loaded++;
+                });
+                if(ok) {
+                    m_tx_filter_ready = true;
+                    m_logger->info("Bloom filter loaded -",
+                                   loaded,
+                                   "TX IDs");
+                } else {
+                    m_logger->warn("Failed to load Bloom filter, all cache "
+                                   "misses will query Oracle");
+                }
+            });
         }
     }
 
     auto locking_shard::read_preseed_file(const std::string& preseed_file)
         -> bool {
-        if(std::filesystem::exists(preseed_file)) {
-            auto in = std::ifstream(preseed_file, std::ios::binary);
-            in.seekg(0, std::ios::end);
-            auto sz = in.tellg();
-            if(sz == -1) {
-                return false;
+        auto file = mapped_hash_array(preseed_file);
+        if(!file.open()) {
+            return false;
+        }
+        const auto count = file.size();
+        const auto per_stripe = count / m_stripes.size();
+        for(auto& s : m_stripes) {
+            s.m_uhs.clear();
+            s.m_uhs.reserve(per_stripe + per_stripe / 8);
+        }
+
+        // Each thread inserts a contiguous slice of the file, buffering
+        // keys per stripe so a stripe lock is taken once per flush rather
+        // than once per key.
+        static constexpr size_t flush_size{1024};
+        auto n_threads = std::max<size_t>(
+            std::min<size_t>(std::thread::hardware_concurrency(),
+                             count / flush_size),
+            1);
+        const auto slice = (count + n_threads - 1) / n_threads;
+        auto insert_slice = [&](size_t begin, size_t end) {
+            auto pending = std::vector<std::vector<hash_t>>(m_stripes.size());
+            auto flush = [&](size_t idx) {
+                auto& s = m_stripes[idx];
+                std::unique_lock<profiled_shared_mutex> l(s.m_mut);
+                for(const auto& uhs_id : pending[idx]) {
+                    s.m_uhs.insert(uhs_id);
+                }
+                pending[idx].clear();
+            };
+            for(size_t i{begin}; i < end; i++) {
+                const auto& uhs_id = file.data()[i];
+                auto idx = stripe_index(uhs_id);
+                pending[idx].push_back(uhs_id);
+                if(pending[idx].size() == flush_size) {
+                    flush(idx);
+                }
             }
-            in.seekg(0, std::ios::beg);
-            auto deser = istream_serializer(in);
-            m_uhs.clear();
-            static constexpr auto uhs_size_factor = 2;
-            auto bucket_count = static_cast<unsigned long>(sz / cbdc::hash_size
-                                                           * uhs_size_factor);
-            m_uhs.rehash(bucket_count);
-            deser >> m_uhs;
-            return true;
+            for(size_t idx{0}; idx < pending.size(); idx++) {
+                flush(idx);
+            }
+        };
+
+        auto threads = std::vector<std::thread>();
+        for(size_t t{1}; t < n_threads; t++) {
+            threads.emplace_back(insert_slice,
+                                 std::min(t * slice, count),
+                                 std::min((t + 1) * slice, count));
+        }
+        insert_slice(0, std::min(slice, count));
+        for(auto& t : threads) {
+            t.join();
         }
-        return false;
+        return true;
     }
 
     auto locking_shard::lock_outputs(std::vector<tx>&& txs,
                                      const hash_t& dtx_id)
         -> std::optional<std::vector<bool>> {
-        std::unique_lock<std::shared_mutex> l(m_mut);
         if(!m_running) {
             return std::nullopt;
         }
+        static auto& lock_latency
+            = metrics::registry::global().get_latency_histogram(
+                "shard_lock_seconds",
+                "Time to check and lock the inputs of a dtx batch.");
+        auto timer = metrics::scoped_timer(lock_latency);
+        auto span = tracing::span("shard.lock_outputs");
 
-        auto prepared_dtx_it = m_prepared_dtxs.find(dtx_id);
-        if(prepared_dtx_it != m_prepared_dtxs.end()) {
-            return prepared_dtx_it->second.m_results;
+        {
+            std::unique_lock<std::mutex> l(m_dtx_mut);
+            auto prepared_dtx_it = m_prepared_dtxs.find(dtx_id);
+            if(prepared_dtx_it != m_prepared_dtxs.end()) {
+                return prepared_dtx_it->second.m_results;
+            }
         }
 
-        auto ret = std::vector<bool>();
-        ret.reserve(txs.size());
-        for(auto&& tx : txs) {
-            auto success = check_and_lock_tx(tx);
-            ret.push_back(success);
+        // Verify signatures before taking any stripe locks, so the
+        // expensive part of a lock runs fully in parallel.
+        auto ret = check_attestations(txs);
+
+        {
+            auto locks = lock_stripes(txs, false);
+            for(size_t i{0}; i < txs.size(); i++) {
+                if(ret[i]) {
+                    ret[i] = check_and_lock_tx(txs[i]);
+                }
+            }
         }
+
         auto p = prepared_dtx();
         p.m_results = ret;
         p.m_txs = std::move(txs);
-        m_prepared_dtxs.emplace(dtx_id, std::move(p));
+        auto existing = std::optional<std::vector<bool>>();
+        {
+            std::unique_lock<std::mutex> l(m_dtx_mut);
+            auto [it, inserted] = m_prepared_dtxs.try_emplace(dtx_id,
+                                                              std::move(p));
+            if(!inserted) {
+                existing = it->second.m_results;
+            }
+        }
+        if(existing.has_value()) {
+            // A retry of the same dtx prepared concurrently and won. Hand
+            // back anything this attempt locked and answer as it did.
+            unlock_txs(p.m_txs, p.m_results);
+            return existing;
+        }
+        return ret;
+    }
+
+    auto locking_shard::lock_and_apply(std::vector<tx>&& txs,
+                                       const hash_t& dtx_id)
+        -> std::optional<std::vector<bool>> {
+        if(!m_running) {
+            return std::nullopt;
+        }
+        static auto& lock_and_apply_latency
+            = metrics::registry::global().get_latency_histogram(
+                "shard_lock_and_apply_seconds",
+                "Time to lock and apply a single-shard dtx batch.");
+        auto timer = metrics::scoped_timer(lock_and_apply_latency);
+        auto span = tracing::span("shard.lock_and_apply");
+
+        {
+            std::unique_lock<std::mutex> l(m_dtx_mut);
+            auto it = m_one_phase_dtxs.find(dtx_id);
+            if(it != m_one_phase_dtxs.end()) {
+                return it->second;
+            }
+        }
+
+        auto ret = check_attestations(txs);
+        {
+            auto locks = lock_stripes(txs, false);
+            for(size_t i{0}; i < txs.size(); i++) {
+                if(ret[i]) {
+                    ret[i] = check_and_lock_tx(txs[i]);
+                }
+            }
+        }
+
+        auto existing = std::optional<std::vector<bool>>();
+        {
+            std::unique_lock<std::mutex> l(m_dtx_mut);
+            auto [it, inserted] = m_one_phase_dtxs.try_emplace(dtx_id, ret);
+            if(inserted) {
+                age_one_phase_dtx(dtx_id);
+            } else {
+                existing = it->second;
+            }
+        }
+        if(existing.has_value()) {
+            // A retry of the same dtx got here first and applied the batch.
+            unlock_txs(txs, ret);
+            return existing;
+        }
+
+        // The inputs locked above are released or spent by the apply, so
+        // the batch goes through the same path as a two-phase dtx.
+        apply_prepared_dtx(txs, ret, dtx_id);
+        m_persistence.push(dtx_id);
+        persist_uhs_changes(txs, ret, dtx_id);
+        persist_tx_ids(txs);
+
+        return ret;
+    }
+
+    auto locking_shard::insert_unspent(stripe& s, const hash_t& uhs_id)
+        -> bool {
+        if(!s.m_uhs.insert(uhs_id)) {
+            return false;
+        }
+        if(m_track_deltas && !s.m_removed.erase(uhs_id)) {
+            s.m_added.insert(uhs_id);
+        }
+        return true;
+    }
+
+    void locking_shard::note_export_change(stripe& s,
+                                           const hash_t& uhs_id,
+                                           bool added) {
+        if(!s.m_export_pending) {
+            return;
+        }
+        if(added) {
+            if(!s.m_export_removed.erase(uhs_id)) {
+                s.m_export_added.insert(uhs_id);
+            }
+        } else if(!s.m_export_added.erase(uhs_id)) {
+            s.m_export_removed.insert(uhs_id);
+        }
+    }
+
+    auto locking_shard::erase_unspent(stripe& s, const hash_t& uhs_id)
+        -> bool {
+        if(!s.m_uhs.erase(uhs_id)) {
+            return false;
+        }
+        if(m_track_deltas && !s.m_added.erase(uhs_id)) {
+            s.m_removed.insert(uhs_id);
+        }
+        return true;
+    }
+
+    auto locking_shard::check_attestations(const std::vector<tx>& txs)
+        -> std::vector<bool> {
+        // Below this many txs per thread, handing work to the pool costs
+        // more than the signature checks it would spread.
+        static constexpr size_t min_chunk{32};
+        auto chunks = std::min(m_attestation_threads,
+                               (txs.size() + min_chunk - 1) / min_chunk);
+        chunks = std::max<size_t>(chunks, 1);
+        const auto chunk_size = (txs.size() + chunks - 1) / chunks;
+
+        // One byte per tx, since threads cannot share a vector<bool> word.
+        auto valid = std::vector<uint8_t>(txs.size());
+        auto check_range = [&](size_t begin, size_t end) {
+            for(size_t i{begin}; i < end; i++) {
+                valid[i] = transaction::validation::check_attestations(
+                    txs[i].m_tx,
+                    m_opts.m_sentinel_public_keys,
+                    m_opts.m_attestation_threshold);
+            }
+        };
+
+        auto done = std::vector<std::future<void>>();
+        done.reserve(chunks - 1);
+        for(size_t c{1}; c < chunks; c++) {
+            auto begin = c * chunk_size;
+            auto end = std::min(begin + chunk_size, txs.size());
+            auto p = std::make_shared<std::promise<void>>();
+            done.push_back(p->get_future());
+            m_attestation_pool->push([p, begin, end, &check_range]() {
+                check_range(begin, end);
+                p->set_value();
+            });
+        }
+        check_range(0, std::min(chunk_size, txs.size()));
+        for(auto& f : done) {
+            f.get();
+        }
+
+        auto ret = std::vector<bool>(txs.size());
+        for(size_t i{0}; i < txs.size(); i++) {
+            ret[i] = valid[i] != 0;
+            if(!ret[i]) {
+                m_logger->warn("Received invalid compact transaction",
+                               to_string(txs[i].m_tx.m_id));
+            }
+        }
         return ret;
     }
 
     auto locking_shard::check_and_lock_tx(const tx& t) -> bool {
-        bool success{true};
-        if(!transaction::validation::check_attestations(
-               t.m_tx,
-               m_opts.m_sentinel_public_keys,
-               m_opts.m_attestation_threshold)) {
-            m_logger->warn("Received invalid compact transaction",
-                           to_string(t.m_tx.m_id));
-            success = false;
-        }
-        if(success) {
-            for(const auto& uhs_id : t.m_tx.m_inputs) {
-                if(hash_in_shard_range(uhs_id)
-                   && m_uhs.find(uhs_id) == m_uhs.end()) {
-                    success = false;
-                    break;
+        for(const auto& uhs_id : t.m_tx.m_inputs) {
+            // The old shard of a range being imported checks the inputs
+            // this shard has not received yet
+            if(hash_in_shard_range(uhs_id)
+               && !m_stripes[stripe_index(uhs_id)].m_uhs.contains(uhs_id)
+               && !importing(uhs_id)) {
+                return false;
+            }
+        }
+        for(const auto& uhs_id : t.m_tx.m_inputs) {
+            if(hash_in_shard_range(uhs_id)) {
+                auto& s = m_stripes[stripe_index(uhs_id)];
+                if(erase_unspent(s, uhs_id)) {
+                    s.m_locked.insert(uhs_id);
+                }
+            }
+        }
+        return true;
+    }
+
+    void locking_shard::unlock_txs(const std::vector<tx>& txs,
+                                   const std::vector<bool>& locked) {
+        auto locks = lock_stripes(txs, false);
+        for(size_t i{0}; i < txs.size() && i < locked.size(); i++) {
+            if(!locked[i]) {
+                continue;
+            }
+            for(const auto& uhs_id : txs[i].m_tx.m_inputs) {
+                if(hash_in_shard_range(uhs_id)) {
+                    auto& s = m_stripes[stripe_index(uhs_id)];
+                    if(s.m_locked.erase(uhs_id)) {
+                        insert_unspent(s, uhs_id);
+                    }
                 }
             }
         }
-        if(success) {
+    }
+
+    auto locking_shard::stripe_index(const hash_t& uhs_id) const -> size_t {
+        // The first byte picks the shard, so it is nearly constant here.
+        return ((static_cast<size_t>(uhs_id[1]) << CHAR_BIT) | uhs_id[2])
+             % m_stripes.size();
+    }
+
+    auto locking_shard::lock_stripes(const std::vector<tx>& txs, bool outputs)
+        -> std::vector<std::unique_lock<profiled_shared_mutex>> {
+        auto indices = std::vector<size_t>();
+        for(const auto& t : txs) {
             for(const auto& uhs_id : t.m_tx.m_inputs) {
                 if(hash_in_shard_range(uhs_id)) {
-                    auto n = m_uhs.extract(uhs_id);
-                    assert(!n.empty());
-                    m_locked.emplace(uhs_id);
+                    indices.push_back(stripe_index(uhs_id));
                 }
             }
+            if(outputs) {
+                for(const auto& uhs_id : t.m_tx.m_uhs_outputs) {
+                    if(hash_in_shard_range(uhs_id)) {
+                        indices.push_back(stripe_index(uhs_id));
+                    }
+                }
+            }
+        }
+        // Ascending acquisition order rules out deadlock between dtxs.
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()),
+                      indices.end());
+        auto locks = std::vector<std::unique_lock<profiled_shared_mutex>>();
+        locks.reserve(indices.size());
+        for(auto idx : indices) {
+            locks.emplace_back(m_stripes[idx].m_mut);
         }
-        return success;
+        return locks;
     }
 
     auto locking_shard::apply_outputs(std::vector<bool>&& complete_txs,
                                       const hash_t& dtx_id) -> bool {
-        std::unique_lock<std::shared_mutex> l(m_mut);
         if(!m_running) {
             return false;
         }
-        auto prepared_dtx_it = m_prepared_dtxs.find(dtx_id);
-        if(prepared_dtx_it == m_prepared_dtxs.end()) {
-            if(m_applied_dtxs.find(dtx_id) == m_applied_dtxs.end()) {
-                m_logger->fatal("Unable to find dtx data for apply",
-                                to_string(dtx_id));
+        static auto& apply_latency
+            = metrics::registry::global().get_latency_histogram(
+                "shard_apply_seconds",
+                "Time to apply a prepared dtx batch.");
+        auto timer = metrics::scoped_timer(apply_latency);
+        auto span = tracing::span("shard.apply_outputs");
+        auto dtx = prepared_dtx();
+        {
+            std::unique_lock<std::mutex> l(m_dtx_mut);
+            auto prepared_dtx_it = m_prepared_dtxs.find(dtx_id);
+            if(prepared_dtx_it == m_prepared_dtxs.end()) {
+                // The bounded applied set may have forgotten a dtx whose
+                // apply is retried after a long delay, so this is not a
+                // reason to stop the shard
+                if(!m_applied_dtxs.contains(dtx_id)) {
+                    m_logger->warn("Unable to find dtx data for apply",
+                                   to_string(dtx_id));
+                }
+                return true;
             }
-            return true;
+            dtx = std::move(prepared_dtx_it->second);
+            m_prepared_dtxs.erase(prepared_dtx_it);
+            m_applied_dtxs.insert(dtx_id);
         }
-        auto& dtx = prepared_dtx_it->second.m_txs;
+        apply_prepared_dtx(dtx.m_txs, complete_txs, dtx_id);
+
+        // Persist outside of the critical sections so the database round
+        // trip does not hold up other lock and apply operations.
+        m_persistence.push(dtx_id);
+        persist_uhs_changes(dtx.m_txs, complete_txs, dtx_id);
+        persist_tx_ids(dtx.m_txs);
+
+        return true;
+    }
+
+    void
+    locking_shard::apply_prepared_dtx(const std::vector<tx>& dtx,
+                                      const std::vector<bool>& complete_txs,
+                                      const hash_t& dtx_id) {
         if(complete_txs.size() != dtx.size()) {
             // This would only happen due to a bug in the controller
             m_logger->fatal("Incorrect number of complete tx flags for apply",
@@ -168,73 +600,598 @@ namespace cbdc::locking_shard {
                             "vs",
                             dtx.size());
         }
+        auto locks = lock_stripes(dtx, true);
         for(size_t i{0}; i < dtx.size(); i++) {
             auto&& tx = dtx[i];
             if(hash_in_shard_range(tx.m_tx.m_id)) {
                 m_completed_txs.add(tx.m_tx.m_id);
+                if(m_tx_filter) {
+                    m_tx_filter->add(tx.m_tx.m_id);
+                }
             }
 
             for(auto&& uhs_id : tx.m_tx.m_uhs_outputs) {
                 if(hash_in_shard_range(uhs_id) && complete_txs[i]) {
-                    m_uhs.emplace(uhs_id);
+                    auto& s = m_stripes[stripe_index(uhs_id)];
+                    if(insert_unspent(s, uhs_id)) {
+                        note_export_change(s, uhs_id, true);
+                    }
                 }
             }
             for(auto&& uhs_id : tx.m_tx.m_inputs) {
                 if(hash_in_shard_range(uhs_id)) {
-                    auto was_locked = m_locked.erase(uhs_id);
-                    if(!complete_txs[i] && (was_locked != 0U)) {
-                        m_uhs.emplace(uhs_id);
+                    auto& s = m_stripes[stripe_index(uhs_id)];
+                    if(complete_txs[i] && importing(uhs_id)) {
+                        // Keeps a late import from re-adding the input, and
+                        // removes it if it was imported after the lock
+                        s.m_import_spent.insert(uhs_id);
+                        if(erase_unspent(s, uhs_id)) {
+                            note_export_change(s, uhs_id, false);
+                        }
+                    }
+                    auto was_locked = s.m_locked.erase(uhs_id);
+                    if(!was_locked) {
+                        continue;
+                    }
+                    // Locked UHS IDs count as unspent in exports, so only
+                    // spending one changes the exported set
+                    if(complete_txs[i]) {
+                        note_export_change(s, uhs_id, false);
+                    } else {
+                        insert_unspent(s, uhs_id);
                     }
                 }
             }
         }
+    }
 
-        m_prepared_dtxs.erase(dtx_id);
-        m_applied_dtxs.insert(dtx_id);
-
-        // adding DTX to Oracle Autonomous Database
-        std::string dtx_string = std::string(dtx_id.begin(), dtx_id.end());
-        m_logger->info("DTX: " + std::string(dtx_id.begin(), dtx_id.end()));
-        std::string dtx_hex;
-        dtx_hex.reserve(2*dtx_string.size());
-
-        // convert dtx_string into a hex string
-        for (unsigned char c : dtx_string) {
-            dtx_hex.push_back("0123456789ABCDEF"[c >> 4]);
-            dtx_hex.push_back("0123456789ABCDEF"[c & 15]);
+    void
+    locking_shard::persist_uhs_changes(const std::vector<tx>& dtx,
+                                       const std::vector<bool>& complete_txs,
+                                       const hash_t& dtx_id) {
+        // Flatten the dtx into one (dtx_id, tx_id, uhs_id) record per UHS
+        // ID so each table receives the whole dtx as a single batch.
+        auto spent = std::vector<hash_t>();
+        auto created = std::vector<hash_t>();
+        for(size_t i{0}; i < dtx.size() && i < complete_txs.size(); i++) {
+            if(!complete_txs[i]) {
+                continue;
+            }
+            const auto& ctx = dtx[i].m_tx;
+            for(const auto& uhs_id : ctx.m_inputs) {
+                if(hash_in_shard_range(uhs_id)) {
+                    spent.insert(spent.end(), {dtx_id, ctx.m_id, uhs_id});
+                }
+            }
+            for(const auto& uhs_id : ctx.m_uhs_outputs) {
+                if(hash_in_shard_range(uhs_id)) {
+                    created.insert(created.end(), {dtx_id, ctx.m_id, uhs_id});
+                }
+            }
         }
-        m_logger->info("DTX HEX: " + dtx_hex);
-        std::string dtx_hex_insert = "INSERT INTO admin.shard_data (raw_data) VALUES ('" + dtx_hex + "')";
-        if(OracleDB_execute(&db, dtx_hex_insert.c_str()) == 0) {
-            m_logger->info("Inserted DTX Hex into shard_data");
-        } else {
-            m_logger->error("Failed to insert DTX Hex into shard_data");
+        static constexpr size_t record_width{3};
+        if(!spent.empty()) {
+            m_spent_persistence.push_records(spent.data(),
+                                             spent.size() / record_width);
         }
+        if(!created.empty()) {
+            m_created_persistence.push_records(created.data(),
+                                               created.size() / record_width);
+        }
+    }
 
-        //For loop through ctx's inputs and outputs and insert into DB
-
-
-        return true;
+    void locking_shard::persist_tx_ids(const std::vector<tx>& dtx) {
+        // Mirrors the TX IDs added to the completed TX cache, so the cold
+        // tier answers exactly as the cache would have.
+        auto tx_ids = std::vector<hash_t>();
+        tx_ids.reserve(dtx.size());
+        for(const auto& t : dtx) {
+            if(hash_in_shard_range(t.m_tx.m_id)) {
+                tx_ids.push_back(t.m_tx.m_id);
+            }
+        }
+        if(!tx_ids.empty()) {
+            m_tx_persistence.push_records(tx_ids.data(), tx_ids.size());
+        }
     }
 
     void locking_shard::stop() {
-        if(OracleDB_disconnect(&db) == 0) {
-            m_logger->info("Disconnected from Oracle Autonomous Database");
-        } else {
-            m_logger->error("Failed to disconnect from Oracle Autonomous Database");
-        }
         m_running = false;
+        m_persistence.stop();
+        m_spent_persistence.stop();
+        m_created_persistence.stop();
+        m_tx_persistence.stop();
+        if(m_tx_lookup) {
+            m_tx_lookup->stop();
+        }
     }
 
     auto locking_shard::check_unspent(const hash_t& uhs_id)
         -> std::optional<bool> {
-        std::shared_lock<std::shared_mutex> l(m_mut);
-        return m_uhs.find(uhs_id) != m_uhs.end()
-            || m_locked.find(uhs_id) != m_locked.end();
+        const auto& s = m_stripes[stripe_index(uhs_id)];
+        std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+        return s.m_uhs.contains(uhs_id) || s.m_locked.contains(uhs_id);
     }
 
     auto locking_shard::check_tx_id(const hash_t& tx_id)
         -> std::optional<bool> {
-        return m_completed_txs.contains(tx_id);
+        if(m_completed_txs.contains(tx_id)) {
+            return true;
+        }
+        if(!m_tx_lookup) {
+            return false;
+        }
+        if(m_tx_filter_ready && !m_tx_filter->possibly_contains(tx_id)) {
+            return false;
+        }
+        return m_tx_lookup->lookup(tx_id).get();
+    }
+
+    auto locking_shard::check_unspent_batch(const std::vector<hash_t>& uhs_ids)
+        -> std::optional<std::vector<bool>> {
+        auto order = std::vector<std::pair<size_t, size_t>>();
+        order.reserve(uhs_ids.size());
+        for(size_t i{0}; i < uhs_ids.size(); i++) {
+            order.emplace_back(stripe_index(uhs_ids[i]), i);
+        }
+        std::sort(order.begin(), order.end());
+
+        auto ret = std::vector<bool>(uhs_ids.size());
+        auto it = order.begin();
+        while(it != order.end()) {
+            const auto& s = m_stripes[it->first];
+            std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+            const auto idx = it->first;
+            for(; it != order.end() && it->first == idx; it++) {
+                const auto& uhs_id = uhs_ids[it->second];
+                ret[it->second]
+                    = s.m_uhs.contains(uhs_id) || s.m_locked.contains(uhs_id);
+            }
+        }
+        return ret;
+    }
+
+    auto locking_shard::check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+        -> std::optional<std::vector<bool>> {
+        auto ret = std::vector<bool>(tx_ids.size());
+        using pending_lookup
+            = std::pair<size_t, std::future<std::optional<bool>>>;
+        auto pending = std::vector<pending_lookup>();
+        for(size_t i{0}; i < tx_ids.size(); i++) {
+            const auto& tx_id = tx_ids[i];
+            if(m_completed_txs.contains(tx_id)) {
+                ret[i] = true;
+            } else if(m_tx_lookup
+                      && (!m_tx_filter_ready
+                          || m_tx_filter->possibly_contains(tx_id))) {
+                pending.emplace_back(i, m_tx_lookup->lookup(tx_id));
+            }
+        }
+        auto failed = false;
+        for(auto& [i, f] : pending) {
+            auto res = f.get();
+            if(!res.has_value()) {
+                failed = true;
+            } else {
+                ret[i] = res.value();
+            }
+        }
+        if(failed) {
+            return std::nullopt;
+        }
+        return ret;
+    }
+
+    auto locking_shard::take_uhs_delta() -> uhs_delta {
+        auto ret = uhs_delta();
+        for(auto& s : m_stripes) {
+            std::unique_lock<profiled_shared_mutex> l(s.m_mut);
+            ret.m_added.insert(ret.m_added.end(),
+                               s.m_added.begin(),
+                               s.m_added.end());
+            ret.m_removed.insert(ret.m_removed.end(),
+                                 s.m_removed.begin(),
+                                 s.m_removed.end());
+            s.m_added.clear();
+            s.m_removed.clear();
+        }
+        m_track_deltas = true;
+        std::sort(ret.m_added.begin(), ret.m_added.end());
+        std::sort(ret.m_removed.begin(), ret.m_removed.end());
+        return ret;
+    }
+
+    auto locking_shard::uhs_image() const -> std::vector<hash_t> {
+        auto ret = std::vector<hash_t>();
+        for(const auto& s : m_stripes) {
+            std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+            ret.insert(ret.end(), s.m_uhs.begin(), s.m_uhs.end());
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    auto locking_shard::memory() const -> memory_usage {
+        auto ret = memory_usage();
+        auto add_set = [](structure_usage& u, const flat_hash_set& set) {
+            u.m_entries += set.size();
+            u.m_bytes += set.memory_usage();
+        };
+        for(const auto& s : m_stripes) {
+            std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+            add_set(ret.m_uhs, s.m_uhs);
+            add_set(ret.m_locked, s.m_locked);
+            add_set(ret.m_changes, s.m_added);
+            add_set(ret.m_changes, s.m_removed);
+            add_set(ret.m_changes, s.m_export_added);
+            add_set(ret.m_changes, s.m_export_removed);
+            add_set(ret.m_changes, s.m_import_spent);
+        }
+
+        // Hash map nodes hold a next pointer and a cached hash besides the
+        // entry.
+        static constexpr auto node_overhead = 2 * sizeof(void*);
+        {
+            std::lock_guard<std::mutex> l(m_dtx_mut);
+            ret.m_prepared_dtxs.m_entries = m_prepared_dtxs.size();
+            ret.m_prepared_dtxs.m_bytes
+                = m_prepared_dtxs.bucket_count() * sizeof(void*);
+            for(const auto& [dtx_id, dtx] : m_prepared_dtxs) {
+                ret.m_prepared_dtxs.m_bytes
+                    += sizeof(dtx_id) + sizeof(dtx) + node_overhead
+                     + dtx.m_results.size() / CHAR_BIT;
+                for(const auto& t : dtx.m_txs) {
+                    ret.m_prepared_dtxs.m_bytes
+                        += sizeof(t)
+                         + (t.m_tx.m_inputs.size()
+                            + t.m_tx.m_uhs_outputs.size())
+                               * sizeof(hash_t)
+                         + t.m_tx.m_attestations.size()
+                               * (sizeof(pubkey_t) + sizeof(signature_t));
+                }
+            }
+            ret.m_applied_dtxs.m_entries = m_applied_dtxs.size();
+            ret.m_applied_dtxs.m_bytes = m_applied_dtxs.memory_usage();
+            ret.m_one_phase_dtxs.m_entries = m_one_phase_dtxs.size();
+            for(const auto& [dtx_id, results] : m_one_phase_dtxs) {
+                ret.m_one_phase_dtxs.m_bytes += sizeof(dtx_id)
+                                              + sizeof(results)
+                                              + node_overhead
+                                              + results.size() / CHAR_BIT;
+            }
+            for(const auto& gen : m_one_phase_generations) {
+                ret.m_one_phase_dtxs.m_bytes
+                    += gen.capacity() * sizeof(hash_t);
+            }
+        }
+        ret.m_completed_txs.m_entries = m_completed_txs.size();
+        ret.m_completed_txs.m_bytes = m_completed_txs.memory_usage();
+        return ret;
+    }
+
+    auto locking_shard::dtx_state() const -> buffer {
+        auto locked = std::vector<hash_t>();
+        for(const auto& s : m_stripes) {
+            std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+            locked.insert(locked.end(), s.m_locked.begin(), s.m_locked.end());
+        }
+        std::sort(locked.begin(), locked.end());
+        auto import_spent = std::vector<hash_t>();
+        for(const auto& s : m_stripes) {
+            std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+            import_spent.insert(import_spent.end(),
+                                s.m_import_spent.begin(),
+                                s.m_import_spent.end());
+        }
+        std::sort(import_spent.begin(), import_spent.end());
+
+        auto write = [&](serializer& ser) {
+            ser << locked << static_cast<uint64_t>(m_prepared_dtxs.size());
+            for(const auto& [dtx_id, p] : m_prepared_dtxs) {
+                ser << dtx_id << p.m_txs << p.m_results;
+            }
+            ser << m_applied_dtxs << m_one_phase_dtxs;
+            ser << m_import_range << m_dropped_ranges << import_spent;
+        };
+
+        std::unique_lock<std::mutex> l(m_dtx_mut);
+        // Size the state first so it is written in one allocation
+        auto sizer = size_serializer();
+        write(sizer);
+        auto ret = buffer();
+        ret.extend(sizer.size());
+        auto ser = buffer_serializer(ret);
+        write(ser);
+        return ret;
+    }
+
+    auto locking_shard::restore(const std::vector<hash_t>& uhs,
+                                buffer dtx_state) -> bool {
+        wait_for_export();
+        auto deser = buffer_serializer(dtx_state);
+        auto locked = std::vector<hash_t>();
+        auto n_prepared = uint64_t();
+        if(!(deser >> locked >> n_prepared)) {
+            return false;
+        }
+        auto prepared
+            = std::unordered_map<hash_t, prepared_dtx, hashing::null>();
+        for(uint64_t i{0}; i < n_prepared; i++) {
+            auto dtx_id = hash_t();
+            auto p = prepared_dtx();
+            if(!(deser >> dtx_id >> p.m_txs >> p.m_results)) {
+                return false;
+            }
+            prepared.emplace(dtx_id, std::move(p));
+        }
+        auto applied = generational_hash_set(
+            m_opts.m_shard_applied_dtx_generation_size,
+            m_opts.m_shard_applied_dtx_generations);
+        auto one_phase = decltype(m_one_phase_dtxs)();
+        if(!(deser >> applied >> one_phase)) {
+            return false;
+        }
+        // Snapshots from before range moves end here
+        auto import_range = std::optional<range_t>();
+        auto dropped = std::vector<range_t>();
+        auto import_spent = std::vector<hash_t>();
+        if(!deser.end_of_buffer()
+           && !(deser >> import_range >> dropped >> import_spent)) {
+            return false;
+        }
+
+        {
+            // Readers and status queries may run concurrently with a
+            // snapshot install, so every stripe is held, in the same
+            // ascending order as lock_stripes, while the state is replaced
+            auto locks = std::vector<std::unique_lock<profiled_shared_mutex>>();
+            locks.reserve(m_stripes.size());
+            for(auto& s : m_stripes) {
+                locks.emplace_back(s.m_mut);
+            }
+            for(auto& s : m_stripes) {
+                s.m_uhs.clear();
+                s.m_locked.clear();
+                s.m_added.clear();
+                s.m_removed.clear();
+                s.m_import_spent.clear();
+            }
+            for(const auto& uhs_id : uhs) {
+                m_stripes[stripe_index(uhs_id)].m_uhs.insert(uhs_id);
+            }
+            for(const auto& uhs_id : locked) {
+                m_stripes[stripe_index(uhs_id)].m_locked.insert(uhs_id);
+            }
+            for(const auto& uhs_id : import_spent) {
+                m_stripes[stripe_index(uhs_id)].m_import_spent.insert(
+                    uhs_id);
+            }
+            m_import_range = import_range;
+            m_dropped_ranges = std::move(dropped);
+            m_read_range.reset();
+            m_read_uhs.clear();
+        }
+        {
+            std::unique_lock<std::mutex> l(m_dtx_mut);
+            m_prepared_dtxs = std::move(prepared);
+            m_applied_dtxs = std::move(applied);
+            m_one_phase_dtxs = std::move(one_phase);
+            // Snapshots do not record the generations, so restored results
+            // start aging out from here
+            m_one_phase_generations.clear();
+            for(const auto& entry : m_one_phase_dtxs) {
+                age_one_phase_dtx(entry.first);
+            }
+        }
+        m_track_deltas = true;
+        return true;
+    }
+
+    auto locking_shard::export_uhs(const std::string& path,
+                                   uint64_t label,
+                                   export_callback_type done) -> bool {
+        if(m_exporting.exchange(true)) {
+            return false;
+        }
+        // The previous export thread has at most its callback left to run
+        if(m_export_thread.joinable()) {
+            m_export_thread.join();
+        }
+        {
+            // Holding every stripe at once makes the cut consistent
+            auto locks = std::vector<std::unique_lock<profiled_shared_mutex>>();
+            locks.reserve(m_stripes.size());
+            for(auto& s : m_stripes) {
+                locks.emplace_back(s.m_mut);
+                s.m_export_pending = true;
+            }
+        }
+        m_export_thread = std::thread([this, path, label, done]() {
+            auto uhs = std::vector<hash_t>();
+            for(auto& s : m_stripes) {
+                copy_export_stripe(s, uhs);
+            }
+            auto ok = !m_export_stop;
+            if(ok) {
+                std::sort(uhs.begin(), uhs.end());
+                auto writer = persistence::hash_export_writer(path, label);
+                ok = writer.open();
+                for(auto it = uhs.begin(); ok && it != uhs.end(); it++) {
+                    ok = !m_export_stop && writer.add(*it);
+                }
+                ok = ok && writer.finish();
+            }
+            m_exporting = false;
+            if(done) {
+                done(ok);
+            }
+        });
+        return true;
+    }
+
+    void locking_shard::copy_export_stripe(stripe& s,
+                                           std::vector<hash_t>& out) {
+        std::unique_lock<profiled_shared_mutex> l(s.m_mut);
+        if(!m_export_stop) {
+            for(const auto* set : {&s.m_uhs, &s.m_locked}) {
+                for(const auto& uhs_id : *set) {
+                    if(!s.m_export_added.contains(uhs_id)) {
+                        out.push_back(uhs_id);
+                    }
+                }
+            }
+            out.insert(out.end(),
+                       s.m_export_removed.begin(),
+                       s.m_export_removed.end());
+        }
+        s.m_export_pending = false;
+        s.m_export_added.clear();
+        s.m_export_removed.clear();
+    }
+
+    void locking_shard::wait_for_export() {
+        if(m_export_thread.joinable()) {
+            m_export_thread.join();
+        }
+    }
+
+    auto locking_shard::within_range(const range_t& range) const -> bool {
+        const auto& own = output_range();
+        return range.first <= range.second && range.first >= own.first
+            && range.second <= own.second;
+    }
+
+    auto locking_shard::importing(const hash_t& uhs_id) const -> bool {
+        return m_import_range.has_value()
+            && config::hash_in_shard_range(m_import_range.value(), uhs_id);
+    }
+
+    auto locking_shard::hash_in_shard_range(const hash_t& h) const -> bool {
+        if(!interface::hash_in_shard_range(h)) {
+            return false;
+        }
+        return std::none_of(m_dropped_ranges.begin(),
+                            m_dropped_ranges.end(),
+                            [&](const range_t& r) {
+                                return config::hash_in_shard_range(r, h);
+                            });
+    }
+
+    auto locking_shard::begin_import(const range_t& range) -> bool {
+        if(m_import_range.has_value()) {
+            return m_import_range.value() == range;
+        }
+        if(!within_range(range)) {
+            return false;
+        }
+        m_logger->info("Importing range",
+                       static_cast<int>(range.first),
+                       "to",
+                       static_cast<int>(range.second));
+        m_import_range = range;
+        return true;
+    }
+
+    auto locking_shard::import_uhs(const std::vector<hash_t>& uhs_ids)
+        -> bool {
+        if(!std::all_of(uhs_ids.begin(), uhs_ids.end(), [&](const auto& h) {
+               return importing(h);
+           })) {
+            return false;
+        }
+        for(const auto& uhs_id : uhs_ids) {
+            auto& s = m_stripes[stripe_index(uhs_id)];
+            std::unique_lock<profiled_shared_mutex> l(s.m_mut);
+            if(s.m_import_spent.contains(uhs_id)
+               || s.m_locked.contains(uhs_id)) {
+                continue;
+            }
+            if(insert_unspent(s, uhs_id)) {
+                note_export_change(s, uhs_id, true);
+            }
+        }
+        return true;
+    }
+
+    auto locking_shard::end_import() -> bool {
+        if(!m_import_range.has_value()) {
+            return false;
+        }
+        for(auto& s : m_stripes) {
+            std::unique_lock<profiled_shared_mutex> l(s.m_mut);
+            s.m_import_spent.clear();
+        }
+        m_import_range.reset();
+        m_logger->info("Finished importing range");
+        return true;
+    }
+
+    auto locking_shard::read_range(const range_t& range, uint64_t offset)
+        -> std::optional<std::vector<hash_t>> {
+        if(!within_range(range)) {
+            return std::nullopt;
+        }
+        if(offset == 0 || m_read_range != range) {
+            m_read_uhs.clear();
+            for(const auto& s : m_stripes) {
+                std::shared_lock<profiled_shared_mutex> l(s.m_mut);
+                // Locked UHS IDs are unspent until their dtx applies
+                for(const auto* set : {&s.m_uhs, &s.m_locked}) {
+                    for(const auto& uhs_id : *set) {
+                        if(config::hash_in_shard_range(range, uhs_id)) {
+                            m_read_uhs.push_back(uhs_id);
+                        }
+                    }
+                }
+            }
+            std::sort(m_read_uhs.begin(), m_read_uhs.end());
+            m_read_range = range;
+        }
+        const auto begin = std::min<uint64_t>(offset, m_read_uhs.size());
+        const auto end
+            = std::min<uint64_t>(begin + range_chunk_size, m_read_uhs.size());
+        return std::vector<hash_t>(
+            m_read_uhs.begin() + static_cast<std::ptrdiff_t>(begin),
+            m_read_uhs.begin() + static_cast<std::ptrdiff_t>(end));
+    }
+
+    auto locking_shard::drop_range(const range_t& range) -> bool {
+        if(!within_range(range)) {
+            return false;
+        }
+        size_t dropped{0};
+        for(auto& s : m_stripes) {
+            std::unique_lock<profiled_shared_mutex> l(s.m_mut);
+            auto in_range = std::vector<hash_t>();
+            for(const auto* set : {&s.m_uhs, &s.m_locked}) {
+                for(const auto& uhs_id : *set) {
+                    if(config::hash_in_shard_range(range, uhs_id)) {
+                        in_range.push_back(uhs_id);
+                    }
+                }
+            }
+            for(const auto& uhs_id : in_range) {
+                if(!erase_unspent(s, uhs_id)) {
+                    s.m_locked.erase(uhs_id);
+                }
+                s.m_import_spent.erase(uhs_id);
+                note_export_change(s, uhs_id, false);
+            }
+            dropped += in_range.size();
+        }
+        m_read_range.reset();
+        m_read_uhs = std::vector<hash_t>();
+        if(std::find(m_dropped_ranges.begin(), m_dropped_ranges.end(), range)
+           == m_dropped_ranges.end()) {
+            m_dropped_ranges.push_back(range);
+        }
+        m_logger->info("Dropped range",
+                       static_cast<int>(range.first),
+                       "to",
+                       static_cast<int>(range.second),
+                       "-",
+                       dropped,
+                       "UHS IDs");
+        return true;
     }
 }
@@ -10,26 +10,46 @@
 #include "interface.hpp"
 #include "status_interface.hpp"
 #include "uhs/transaction/transaction.hpp"
+#include "util/common/bloom_filter.hpp"
+#include "util/common/buffer.hpp"
 #include "util/common/cache_set.hpp"
+#include "util/common/flat_hash_set.hpp"
+#include "util/common/generational_hash_set.hpp"
 #include "util/common/hash.hpp"
 #include "util/common/hashmap.hpp"
 #include "util/common/logging.hpp"
+#include "util/common/profiled_mutex.hpp"
+#include "util/common/thread_pool.hpp"
+#include "util/oracle/hash_lookup.hpp"
+#include "util/persistence/write_behind_queue.hpp"
 
+#include <atomic>
+#include <deque>
 #include <filesystem>
+#include <functional>
 #include <future>
 #include <leveldb/db.h>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
 #include <variant>
 #include <vector>
 
 namespace cbdc::locking_shard {
+    /// Changes to a locking shard's unspent set between two snapshots.
+    struct uhs_delta {
+        /// UHS IDs which became unspent, sorted.
+        std::vector<hash_t> m_added;
+        /// UHS IDs which stopped being unspent, sorted.
+        std::vector<hash_t> m_removed;
+    };
+
     /// \brief In-memory implementation of \ref interface and
     /// \ref status_interface.
     ///
-    /// \warning Not thread safe.
     /// Implements a UHS through conservative two-phase locking. Callers
     /// atomically check a batch of prospective transactions for spendable
     /// input UHS IDs in this shard's range, and lock those UHS IDs. Based on
@@ -41,6 +61,14 @@ namespace cbdc::locking_shard {
     /// recently applied in the system. This is useful for recipients in a
     /// transaction to verify that the transaction has completed, or if the
     /// sender disconnects from the sentinel before receiving a response.
+    /// With the Oracle persistence backend, TX IDs missing from the cache
+    /// fall through to a cold tier of every TX ID the shard has persisted,
+    /// optionally screened by a Bloom filter first.
+    ///
+    /// The UHS is split into independently locked stripes keyed by hash
+    /// bits below the shard range prefix. Each lock and apply operation
+    /// holds only the stripes its UHS IDs fall in, acquired in ascending
+    /// order, so dtxs touching disjoint stripes proceed in parallel.
     class locking_shard final : public interface, public status_interface {
       public:
         /// Constructor.
@@ -59,6 +87,14 @@ namespace cbdc::locking_shard {
                       config::options opts);
         locking_shard() = delete;
 
+        /// Stops and waits for any running UHS export.
+        ~locking_shard() override;
+
+        locking_shard(const locking_shard&) = delete;
+        auto operator=(const locking_shard&) -> locking_shard& = delete;
+        locking_shard(locking_shard&&) = delete;
+        auto operator=(locking_shard&&) -> locking_shard& = delete;
+
         /// \brief Attempts to lock the input hashes for the given batch of
         /// transactions.
         ///
@@ -95,6 +131,21 @@ namespace cbdc::locking_shard {
         auto apply_outputs(std::vector<bool>&& complete_txs,
                            const hash_t& dtx_id) -> bool final;
 
+        /// \brief Locks and applies a batch of transactions in one step.
+        ///
+        /// Used in place of \ref lock_outputs and \ref apply_outputs when
+        /// this shard is the only one taking part in the dtx, so there is
+        /// nothing to wait for between the two. The results are kept until
+        /// \ref discard_dtx so a retry from the coordinator returns them
+        /// instead of applying the batch again.
+        /// \param txs list of txs to lock and apply.
+        /// \param dtx_id distributed tx ID for the operation.
+        /// \return if the operation succeeds, a vector of flags corresponding
+        ///         to the txs in the input which were completed. Otherwise
+        ///         std::nullopt.
+        auto lock_and_apply(std::vector<tx>&& txs, const hash_t& dtx_id)
+            -> std::optional<std::vector<bool>> final;
+
         /// Discards any cached information about a given distributed
         /// transaction. Called as the final step of a distributed transaction
         /// once all other participating shards have finished processing \ref
@@ -116,33 +167,286 @@ namespace cbdc::locking_shard {
         [[nodiscard]] auto check_unspent(const hash_t& uhs_id)
             -> std::optional<bool> final;
 
-        /// Queries whether the given TX ID is confirmed in the cache of
-        /// recently confirmed TX IDs.
+        /// Queries whether the given TX ID is confirmed, first in the cache
+        /// of recently confirmed TX IDs and then, if enabled, in the TX IDs
+        /// persisted to Oracle. The Oracle lookup blocks until a batched
+        /// query containing the TX ID completes, and is skipped when the
+        /// Bloom filter rules the TX ID out once it has finished loading.
         /// \param tx_id TX ID to query.
-        /// \return true if cache contains TX ID, or false if not. std::nullopt
-        ///         if the query failed.
+        /// \return true if the TX ID is confirmed, or false if not.
+        ///         std::nullopt if the query failed.
         [[nodiscard]] auto check_tx_id(const hash_t& tx_id)
             -> std::optional<bool> final;
 
+        /// Queries whether the shard's UHS contains each of the given UHS
+        /// IDs, taking each stripe's lock once for all the IDs in it. The
+        /// stripes are read one after another, so the result is not a
+        /// snapshot across stripes.
+        /// \param uhs_ids UHS IDs to query.
+        /// \return one flag per UHS ID in the same order, true if unspent.
+        [[nodiscard]] auto
+        check_unspent_batch(const std::vector<hash_t>& uhs_ids)
+            -> std::optional<std::vector<bool>> final;
+
+        /// Queries whether each of the given TX IDs is confirmed, as \ref
+        /// check_tx_id would. Cold tier lookups for every cache miss are
+        /// issued before waiting on any, so they share batched queries.
+        /// \param tx_ids TX IDs to query.
+        /// \return one flag per TX ID in the same order, true if confirmed,
+        ///         or std::nullopt if any cold tier lookup failed.
+        [[nodiscard]] auto check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+            -> std::optional<std::vector<bool>> final;
+
+        /// Returns the UHS IDs added to and removed from the unspent set
+        /// since the previous call, and starts tracking changes if this is
+        /// the first call. Must not run concurrently with lock, apply or
+        /// discard operations.
+        /// \return sorted changes to the unspent set.
+        auto take_uhs_delta() -> uhs_delta;
+
+        /// Returns every unspent UHS ID, sorted. Must not run concurrently
+        /// with lock, apply or discard operations.
+        /// \return sorted unspent UHS IDs.
+        [[nodiscard]] auto uhs_image() const -> std::vector<hash_t>;
+
+        /// Serializes the shard's state other than its unspent set: locked
+        /// UHS IDs, prepared dtxs, applied dtx IDs and lock-and-apply
+        /// results. Must not run
+        /// concurrently with lock, apply or discard operations.
+        /// \return serialized dtx state.
+        [[nodiscard]] auto dtx_state() const -> buffer;
+
+        /// Size of one of the shard's in-memory structures.
+        struct structure_usage {
+            /// Number of entries.
+            size_t m_entries{};
+            /// Estimated bytes held, including allocator overhead for
+            /// node-based containers.
+            size_t m_bytes{};
+        };
+
+        /// Sizes of the shard's in-memory structures.
+        struct memory_usage {
+            /// Unspent UHS IDs.
+            structure_usage m_uhs;
+            /// Locked UHS IDs.
+            structure_usage m_locked;
+            /// Changes tracked for deltas, exports and imports.
+            structure_usage m_changes;
+            /// Prepared dtxs.
+            structure_usage m_prepared_dtxs;
+            /// Applied dtxs awaiting discard.
+            structure_usage m_applied_dtxs;
+            /// Results of lock-and-apply dtxs awaiting discard.
+            structure_usage m_one_phase_dtxs;
+            /// Recently completed TX IDs.
+            structure_usage m_completed_txs;
+        };
+
+        /// Returns the sizes of the shard's in-memory structures. Takes
+        /// each lock briefly in turn, so the sizes need not be mutually
+        /// consistent.
+        /// \return entries and bytes held by each structure.
+        [[nodiscard]] auto memory() const -> memory_usage;
+
+        /// Replaces the shard's state with a snapshot and starts tracking
+        /// UHS changes from it. Must not run concurrently with any other
+        /// operation. The completed TX cache is left as it is.
+        /// \param uhs every unspent UHS ID.
+        /// \param dtx_state state previously returned by \ref dtx_state.
+        /// \return true if the dtx state was deserialized.
+        auto restore(const std::vector<hash_t>& uhs, buffer dtx_state)
+            -> bool;
+
+        /// Function called with true when a UHS export finishes and false
+        /// if it failed.
+        using export_callback_type = std::function<void(bool)>;
+
+        /// \brief Starts exporting every unspent UHS ID, including those
+        /// locked by dtxs in progress, sorted, with \ref
+        /// persistence::hash_export_writer.
+        ///
+        /// The set is cut at the time of the call by briefly taking every
+        /// stripe lock. From then until the export thread copies a stripe,
+        /// the stripe records the changes made to it, and the copy undoes
+        /// them. Lock and apply operations therefore only ever wait for the
+        /// copy of a single stripe. Only one export runs at a time.
+        /// \param path file to write.
+        /// \param label value to store in the file header, such as the raft
+        ///              log index of the cut.
+        /// \param done function to call from the export thread when the
+        ///             export finishes. Must not start another export.
+        /// \return false if an export is already running.
+        auto export_uhs(const std::string& path,
+                        uint64_t label,
+                        export_callback_type done) -> bool;
+
+        /// Inclusive range of hash prefixes.
+        using range_t = std::pair<uint8_t, uint8_t>;
+
+        /// Maximum number of UHS IDs returned by one \ref read_range.
+        static constexpr size_t range_chunk_size{65536};
+
+        /// \brief Starts importing part of this shard's range from the
+        /// shard cluster which currently holds it.
+        ///
+        /// Coordinators send this shard the dtxs touching the range from
+        /// now on, alongside the old shard, which alone decides whether
+        /// their inputs are unspent. Until \ref end_import, this shard
+        /// neither refuses inputs in the range which it does not hold
+        /// yet, nor re-adds UHS IDs spent since the import began when
+        /// \ref import_uhs delivers them late. The old shard's copy of the
+        /// range can therefore be read at any point after every dtx
+        /// routed without this shard has finished.
+        /// \param range range to import, within this shard's range.
+        /// \return false if the range is outside this shard's range or
+        ///         another import is in progress. Repeating the call for
+        ///         the range being imported succeeds.
+        auto begin_import(const range_t& range) -> bool;
+
+        /// Adds UHS IDs read from the old shard of the range being
+        /// imported, except those spent or locked since the import began.
+        /// \param uhs_ids UHS IDs to import.
+        /// \return false if no import is in progress or a UHS ID is outside
+        ///         the range being imported.
+        auto import_uhs(const std::vector<hash_t>& uhs_ids) -> bool;
+
+        /// Finishes an import. This shard holds the whole range from now
+        /// on and refuses inputs in it which it does not hold.
+        /// \return false if no import was in progress.
+        auto end_import() -> bool;
+
+        /// Returns a chunk of the unspent and locked UHS IDs in a range,
+        /// sorted. The range is copied when the first chunk is read, so
+        /// later chunks continue from the same copy, which is kept until
+        /// the range is dropped.
+        /// \param range range to read, within this shard's range.
+        /// \param offset number of UHS IDs in the range to skip.
+        /// \return up to \ref range_chunk_size UHS IDs, or std::nullopt if
+        ///         the range is outside this shard's range.
+        auto read_range(const range_t& range, uint64_t offset)
+            -> std::optional<std::vector<hash_t>>;
+
+        /// Stops serving a range moved to another shard cluster. Removes
+        /// the range's UHS IDs, and from then on ignores UHS IDs and TX
+        /// IDs in the range as if it were outside this shard's range.
+        /// \param range range to drop, within this shard's range.
+        /// \return false if the range is outside this shard's range.
+        auto drop_range(const range_t& range) -> bool;
+
+        /// Returns whether a given hash is within the shard's range and not
+        /// in a range dropped by \ref drop_range.
+        /// \param h hash to check.
+        /// \return true if the shard is responsible for the hash.
+        [[nodiscard]] auto hash_in_shard_range(const hash_t& h) const
+            -> bool final;
+
       private:
         auto read_preseed_file(const std::string& preseed_file) -> bool;
+        struct stripe;
+        auto insert_unspent(stripe& s, const hash_t& uhs_id) -> bool;
+        static void note_export_change(stripe& s,
+                                       const hash_t& uhs_id,
+                                       bool added);
+        void copy_export_stripe(stripe& s, std::vector<hash_t>& out);
+        void wait_for_export();
+        auto erase_unspent(stripe& s, const hash_t& uhs_id) -> bool;
+        auto check_attestations(const std::vector<tx>& txs)
+            -> std::vector<bool>;
         auto check_and_lock_tx(const tx& t) -> bool;
+        void unlock_txs(const std::vector<tx>& txs,
+                        const std::vector<bool>& locked);
+        void age_one_phase_dtx(const hash_t& dtx_id);
+        [[nodiscard]] auto stripe_index(const hash_t& uhs_id) const
+            -> size_t;
+        auto lock_stripes(const std::vector<tx>& txs, bool outputs)
+            -> std::vector<std::unique_lock<profiled_shared_mutex>>;
+        void apply_prepared_dtx(const std::vector<tx>& dtx,
+                                const std::vector<bool>& complete_txs,
+                                const hash_t& dtx_id);
+        void persist_uhs_changes(const std::vector<tx>& dtx,
+                                 const std::vector<bool>& complete_txs,
+                                 const hash_t& dtx_id);
+        void persist_tx_ids(const std::vector<tx>& dtx);
+        [[nodiscard]] auto within_range(const range_t& range) const -> bool;
+        [[nodiscard]] auto importing(const hash_t& uhs_id) const -> bool;
+        void start_tx_lookup(const std::pair<uint8_t, uint8_t>& output_range);
 
         struct prepared_dtx {
             std::vector<tx> m_txs;
             std::vector<bool> m_results;
         };
+        /// Unspent and locked UHS IDs whose stripe index is this
+        /// stripe's position in m_stripes.
+        struct stripe {
+            mutable profiled_shared_mutex m_mut{"locking_shard_stripe"};
+            flat_hash_set m_uhs;
+            flat_hash_set m_locked;
+            /// Changes to m_uhs since the last \ref take_uhs_delta.
+            flat_hash_set m_added;
+            flat_hash_set m_removed;
+            /// Set from the cut of a UHS export until the export has
+            /// copied this stripe.
+            bool m_export_pending{false};
+            /// Changes to m_uhs and m_locked combined since the cut.
+            flat_hash_set m_export_added;
+            flat_hash_set m_export_removed;
+            /// UHS IDs in the range being imported which were spent since
+            /// the import began.
+            flat_hash_set m_import_spent;
+        };
+        /// Set once changes to the unspent set are being tracked.
+        std::atomic_bool m_track_deltas{false};
         std::atomic_bool m_running{true};
 
         std::shared_ptr<logging::log> m_logger;
-        mutable std::shared_mutex m_mut;
-        std::unordered_set<hash_t, hashing::null> m_uhs;
-        std::unordered_set<hash_t, hashing::null> m_locked;
+        /// Protects m_prepared_dtxs, m_applied_dtxs and m_one_phase_dtxs.
+        /// Never held while acquiring a stripe lock.
+        mutable std::mutex m_dtx_mut;
         std::unordered_map<hash_t, prepared_dtx, hashing::null>
             m_prepared_dtxs;
-        std::unordered_set<hash_t, hashing::null> m_applied_dtxs;
+        /// Applied dtxs awaiting discard. Bounded, so dtxs whose discard
+        /// never arrives are eventually forgotten.
+        generational_hash_set m_applied_dtxs;
+        /// Results of lock-and-apply dtxs awaiting discard. Aged out in
+        /// the same generations as m_applied_dtxs.
+        std::unordered_map<hash_t, std::vector<bool>, hashing::null>
+            m_one_phase_dtxs;
+        /// IDs added to m_one_phase_dtxs, oldest generation first.
+        std::deque<std::vector<hash_t>> m_one_phase_generations;
         cbdc::cache_set<hash_t, hashing::null> m_completed_txs;
         config::options m_opts;
+        std::vector<stripe> m_stripes;
+        size_t m_attestation_threads;
+        /// Workers sharing attestation checks with the calling thread, or
+        /// nullptr if it checks them alone.
+        std::unique_ptr<thread_pool> m_attestation_pool;
+        persistence::write_behind_queue m_persistence;
+        persistence::write_behind_queue m_spent_persistence;
+        persistence::write_behind_queue m_created_persistence;
+        persistence::write_behind_queue m_tx_persistence;
+        std::unique_ptr<oracle::hash_lookup> m_tx_lookup;
+        std::unique_ptr<bloom_filter> m_tx_filter;
+        /// Set once m_tx_filter holds every persisted TX ID. Until then
+        /// the filter only collects newly confirmed TX IDs, and every
+        /// cache miss queries Oracle.
+        std::atomic_bool m_tx_filter_ready{false};
+        /// Loads the persisted TX IDs into m_tx_filter, so the shard
+        /// starts serving without waiting for the database.
+        std::thread m_tx_filter_thread;
+
+        /// Range being imported, if any, and ranges moved to other
+        /// shards. Only changed by range move requests, which like lock,
+        /// apply and discard operations are processed one at a time.
+        std::optional<range_t> m_import_range;
+        std::vector<range_t> m_dropped_ranges;
+        /// Sorted copy of the range most recently read by \ref read_range.
+        std::optional<range_t> m_read_range;
+        std::vector<hash_t> m_read_uhs;
+
+        std::atomic_bool m_exporting{false};
+        std::atomic_bool m_export_stop{false};
+        std::thread m_export_thread;
     };
 }
 
@@ -5,7 +5,13 @@
 
 #include "controller.hpp"
 #include "crypto/sha256.h"
+#include "util/common/affinity.hpp"
 #include "util/common/config.hpp"
+#include "util/common/huge_pages.hpp"
+#include "util/common/profiled_mutex.hpp"
+#include "util/common/tracing.hpp"
+#include "util/network/io_loop.hpp"
+#include "util/rpc/http/metrics_server.hpp"
 
 #include <csignal>
 #include <iostream>
@@ -26,6 +32,14 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto cfg = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(cfg.m_network_backend);
+    cbdc::network::set_local_transport(cfg.m_local_transport);
+    cbdc::set_thread_cpus(cfg.m_thread_cpus);
+    cbdc::set_lock_profiling(cfg.m_lock_profiling);
+    cbdc::set_huge_pages(cfg.m_huge_pages);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
     auto shard_id = std::stoull(args[2]);
     auto node_id = std::stoull(args[3]);
 
@@ -41,6 +55,34 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         cfg.m_shard_loglevels[shard_id]);
+    if(cfg.m_log_async_capacity > 0) {
+        logger->enable_async(cfg.m_log_async_capacity, cfg.m_log_overflow);
+    }
+
+    auto metrics_server = std::unique_ptr<cbdc::rpc::json_rpc_http_server>();
+    const auto& metrics_ep
+        = cfg.m_locking_shard_metrics_endpoints[shard_id][node_id];
+    if(metrics_ep.has_value()) {
+        metrics_server = cbdc::rpc::start_metrics_server(*metrics_ep);
+        if(!metrics_server) {
+            logger->error("Failed to start metrics server");
+            return -1;
+        }
+    }
+
+    if(cfg.m_trace_sample_rate > 0) {
+        const auto trace_name = "shard" + std::to_string(shard_id) + "_"
+                              + std::to_string(node_id);
+        if(!cbdc::tracing::tracer::global().start(
+               cfg.m_trace_sample_rate,
+               cfg.m_trace_buffer_size,
+               cbdc::tracing::make_file_exporter(
+                   cfg.m_trace_file_prefix + trace_name + ".log",
+                   trace_name))) {
+            logger->error("Failed to start trace exporter");
+            return -1;
+        }
+    }
 
     std::string sha2_impl(SHA256AutoDetect());
     logger->info("using sha2: ", sha2_impl);
@@ -54,9 +96,11 @@ auto main(int argc, char** argv) -> int {
     static std::atomic_bool running{true};
 
     // Wait for CTRL+C etc
-    std::signal(SIGINT, [](int /* sig */) {
+    auto stop = [](int /* sig */) {
         running = false;
-    });
+    };
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
 
     logger->info("Shard running...");
 
@@ -68,6 +112,8 @@ auto main(int argc, char** argv) -> int {
 
     logger->info("Shutting down...");
 
+    ctl.transfer_leadership();
+
     return 0;
 }
 // LCOV_EXCL_STOP
@@ -8,9 +8,11 @@
 
 #include "interface.hpp"
 
+#include <tuple>
+
 namespace cbdc::locking_shard::rpc {
     /// Transactions whose outputs the locking shard should lock
-    using lock_params = std::vector<tx>;
+    using lock_params = tx_batch;
     /// Vector of bools. True if the locking shard should complete the
     /// transaction at the same index in the previous batch. False if the
     /// locking shard should unlock the transaction.
@@ -23,13 +25,70 @@ namespace cbdc::locking_shard::rpc {
         };
     };
 
+    /// Transactions the locking shard should lock and then immediately
+    /// apply, for a dtx in which no other shard takes part.
+    struct lock_apply_params {
+        /// Transactions to lock and apply.
+        tx_batch m_txs;
+
+        auto operator==(const lock_apply_params& rhs) const -> bool {
+            return m_txs == rhs.m_txs;
+        }
+    };
+
+    /// Steps of moving part of a shard's range to another shard cluster.
+    /// \see locking_shard::begin_import
+    enum class range_op : uint8_t {
+        /// Start importing the range into the new shard.
+        begin_import = 0,
+        /// Finish importing the range into the new shard.
+        end_import = 1,
+        /// Read a chunk of the range's UHS IDs from the old shard.
+        read = 2,
+        /// Stop serving the range on the old shard.
+        drop = 3
+    };
+
+    /// Parameters for one step of a range move.
+    struct range_params {
+        /// Step to perform.
+        range_op m_op{};
+        /// Inclusive hash prefix range being moved.
+        std::pair<uint8_t, uint8_t> m_range{};
+        /// For reads, the number of UHS IDs in the range to skip.
+        uint64_t m_offset{};
+
+        auto operator==(const range_params& rhs) const -> bool {
+            return std::tie(m_op, m_range, m_offset)
+                == std::tie(rhs.m_op, rhs.m_range, rhs.m_offset);
+        }
+    };
+
+    /// UHS IDs the new shard of a range move should add to its unspent
+    /// set.
+    struct import_params {
+        /// UHS IDs to import.
+        std::vector<hash_t> m_uhs_ids;
+
+        auto operator==(const import_params& rhs) const -> bool {
+            return m_uhs_ids == rhs.m_uhs_ids;
+        }
+    };
+
     /// Request to a shard
     struct request {
-        /// The distributed transaction ID corresponding to the request
+        /// The distributed transaction ID corresponding to the request.
+        /// Unused by range move requests.
         hash_t m_dtx_id{};
-        /// If the command is lock or apply, the parameters for these
-        /// commands
-        std::variant<lock_params, apply_params, discard_params> m_params{};
+        /// If the command is lock, apply or lock-and-apply, the parameters
+        /// for these commands, or the parameters of a range move step
+        std::variant<lock_params,
+                     apply_params,
+                     discard_params,
+                     lock_apply_params,
+                     range_params,
+                     import_params>
+            m_params{};
 
         auto operator==(const request& rhs) const -> bool;
     };
@@ -53,9 +112,28 @@ namespace cbdc::locking_shard::rpc {
         };
     };
 
-    /// Response to a locking shard request
-    using response
-        = std::variant<lock_response, apply_response, discard_response>;
+    /// Response to a range move request.
+    struct range_response {
+        /// False if the shard refused the step.
+        bool m_success{};
+        /// For reads, the next chunk of UHS IDs in the range, sorted. A
+        /// chunk shorter than \ref locking_shard::range_chunk_size is the
+        /// last.
+        std::vector<hash_t> m_uhs_ids;
+
+        auto operator==(const range_response& rhs) const -> bool {
+            return std::tie(m_success, m_uhs_ids)
+                == std::tie(rhs.m_success, rhs.m_uhs_ids);
+        }
+    };
+
+    /// Response to a locking shard request. Lock-and-apply requests are
+    /// answered with a \ref lock_response, and range move and import
+    /// requests with a \ref range_response.
+    using response = std::variant<lock_response,
+                                  apply_response,
+                                  discard_response,
+                                  range_response>;
 }
 
 #endif
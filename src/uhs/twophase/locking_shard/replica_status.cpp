@@ -0,0 +1,135 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "replica_status.hpp"
+
+#include "format.hpp"
+
+namespace cbdc::locking_shard {
+    replica_status::replica_status(
+        std::shared_ptr<status_interface> shard,
+        std::shared_ptr<raft::node> raft,
+        size_t node_id,
+        const std::vector<network::endpoint_t>& readonly_endpoints,
+        std::shared_ptr<logging::log> logger)
+        : m_shard(std::move(shard)),
+          m_raft(std::move(raft)),
+          m_node_id(node_id),
+          m_logger(std::move(logger)) {
+        for(size_t i{0}; i < readonly_endpoints.size(); i++) {
+            if(i == m_node_id) {
+                m_replicas.emplace_back();
+                continue;
+            }
+            // Read index requests gate consistent reads, so keep them
+            // ahead of bulk traffic
+            auto opts = cbdc::rpc::tcp_client_options();
+            opts.m_priority = network::priority::high;
+            m_replicas.emplace_back(std::make_unique<client_type>(
+                std::vector<network::endpoint_t>{readonly_endpoints[i]},
+                opts));
+        }
+    }
+
+    auto replica_status::init() -> bool {
+        for(auto& client : m_replicas) {
+            // Replicas may start in any order, so keep retrying
+            if(client && !client->init(false)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto replica_status::check_unspent(const hash_t& uhs_id)
+        -> std::optional<bool> {
+        if(!sync()) {
+            return std::nullopt;
+        }
+        return m_shard->check_unspent(uhs_id);
+    }
+
+    auto replica_status::check_tx_id(const hash_t& tx_id)
+        -> std::optional<bool> {
+        if(!sync()) {
+            return std::nullopt;
+        }
+        return m_shard->check_tx_id(tx_id);
+    }
+
+    auto replica_status::check_unspent_batch(
+        const std::vector<hash_t>& uhs_ids)
+        -> std::optional<std::vector<bool>> {
+        if(!sync()) {
+            return std::nullopt;
+        }
+        return m_shard->check_unspent_batch(uhs_ids);
+    }
+
+    auto replica_status::check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+        -> std::optional<std::vector<bool>> {
+        if(!sync()) {
+            return std::nullopt;
+        }
+        return m_shard->check_tx_id_batch(tx_ids);
+    }
+
+    auto replica_status::sync() -> bool {
+        auto idx = std::optional<uint64_t>();
+        {
+            std::unique_lock<std::mutex> l(m_mut);
+            // A fetch already in flight may have read the index before
+            // this query arrived, so wait for one which starts after it
+            const auto target = m_rounds + (m_fetching ? 2 : 1);
+            while(m_rounds < target) {
+                if(m_fetching) {
+                    m_cv.wait(l);
+                    continue;
+                }
+                m_fetching = true;
+                l.unlock();
+                auto fetched = fetch_read_index();
+                l.lock();
+                m_fetching = false;
+                m_read_index = fetched;
+                m_rounds++;
+                m_cv.notify_all();
+            }
+            idx = m_read_index;
+        }
+        if(!idx.has_value()) {
+            return false;
+        }
+        if(!m_raft->await_applied(idx.value(), read_timeout)) {
+            m_logger->warn("Replica did not apply read index",
+                           idx.value(),
+                           "in time");
+            return false;
+        }
+        return true;
+    }
+
+    auto replica_status::fetch_read_index() -> std::optional<uint64_t> {
+        auto leader = m_raft->leader_id();
+        if(!leader.has_value() || leader.value() >= m_replicas.size()) {
+            return std::nullopt;
+        }
+        if(leader.value() == m_node_id) {
+            return m_raft->read_index();
+        }
+        // The leader may wait a heartbeat or two for a quorum to respond
+        auto res = m_replicas[leader.value()]->call(
+            rpc::read_index_request{},
+            read_timeout + m_raft->read_index_timeout());
+        if(!res.has_value()) {
+            return std::nullopt;
+        }
+        const auto* idx = std::get_if<rpc::read_index_response>(&res.value());
+        if(idx == nullptr) {
+            return std::nullopt;
+        }
+        return idx->m_commit_idx;
+    }
+}
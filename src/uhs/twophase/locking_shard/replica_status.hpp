@@ -0,0 +1,103 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_LOCKING_SHARD_REPLICA_STATUS_H_
+#define OPENCBDC_TX_SRC_LOCKING_SHARD_REPLICA_STATUS_H_
+
+#include "status_interface.hpp"
+#include "status_messages.hpp"
+#include "util/common/logging.hpp"
+#include "util/raft/node.hpp"
+#include "util/rpc/tcp_client.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace cbdc::locking_shard {
+    /// \brief Serves status queries from any replica of a shard cluster.
+    ///
+    /// Before reading its local copy of the shard, a replica asks the
+    /// cluster leader for its commit index and waits until its own state
+    /// machine has applied that index, so each query reflects every lock
+    /// and apply committed before the query arrived (raft read-index).
+    /// Queries arriving while a leader round trip is in flight share the
+    /// next one, so followers make at most one request to the leader at a
+    /// time however many queries they serve.
+    class replica_status : public status_interface {
+      public:
+        /// Constructor.
+        /// \param shard local replica of the shard.
+        /// \param raft raft node of the local replica.
+        /// \param node_id ID of the local replica in the cluster.
+        /// \param readonly_endpoints status endpoints of the replicas in
+        ///                           the cluster, ordered by node ID.
+        /// \param logger log instance.
+        replica_status(std::shared_ptr<status_interface> shard,
+                       std::shared_ptr<raft::node> raft,
+                       size_t node_id,
+                       const std::vector<network::endpoint_t>&
+                           readonly_endpoints,
+                       std::shared_ptr<logging::log> logger);
+
+        /// Starts connecting to the other replicas in the background.
+        /// \return true if the RPC clients started.
+        auto init() -> bool;
+
+        /// \see status_interface::check_unspent
+        [[nodiscard]] auto check_unspent(const hash_t& uhs_id)
+            -> std::optional<bool> override;
+
+        /// \see status_interface::check_tx_id
+        [[nodiscard]] auto check_tx_id(const hash_t& tx_id)
+            -> std::optional<bool> override;
+
+        /// \see status_interface::check_unspent_batch
+        [[nodiscard]] auto
+        check_unspent_batch(const std::vector<hash_t>& uhs_ids)
+            -> std::optional<std::vector<bool>> override;
+
+        /// \see status_interface::check_tx_id_batch
+        [[nodiscard]] auto
+        check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+            -> std::optional<std::vector<bool>> override;
+
+      private:
+        /// Longest a query waits for the leader's commit index and then
+        /// for the local state machine to catch up to it.
+        static constexpr auto read_timeout = std::chrono::seconds(1);
+
+        using client_type
+            = cbdc::rpc::tcp_client<rpc::status_request, rpc::status_response>;
+
+        std::shared_ptr<status_interface> m_shard;
+        std::shared_ptr<raft::node> m_raft;
+        size_t m_node_id;
+        std::shared_ptr<logging::log> m_logger;
+        /// Clients for the status endpoint of each replica, null for the
+        /// local replica.
+        std::vector<std::unique_ptr<client_type>> m_replicas;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        /// Whether a query is fetching the read index.
+        bool m_fetching{false};
+        /// Number of read index fetches finished.
+        uint64_t m_rounds{0};
+        /// Result of the last read index fetch.
+        std::optional<uint64_t> m_read_index;
+
+        /// Waits until the local replica reflects every entry committed
+        /// before the call.
+        /// \return true if the local replica is up to date.
+        auto sync() -> bool;
+
+        /// Fetches the commit index from the cluster leader.
+        /// \return commit index, or std::nullopt if the leader could not
+        ///         be reached.
+        auto fetch_read_index() -> std::optional<uint64_t>;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_LOCKING_SHARD_REPLICA_STATUS_H_
@@ -0,0 +1,637 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "snapshot_store.hpp"
+
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/istream_serializer.hpp"
+#include "util/serialization/ostream_serializer.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace cbdc::locking_shard {
+    namespace {
+        constexpr auto base_ext = ".base";
+        constexpr auto delta_ext = ".delta";
+        constexpr auto tmp_ext = ".tmp";
+        constexpr auto recv_ext = ".recv";
+        constexpr size_t max_idx_digits = 19;
+
+        /// Log index and whether the file is a base file, from a snapshot
+        /// file name.
+        auto parse_name(const std::string& name)
+            -> std::optional<std::pair<uint64_t, bool>> {
+            auto dot = name.find('.');
+            if(dot == 0 || dot == std::string::npos || dot > max_idx_digits) {
+                return std::nullopt;
+            }
+            auto ext = name.substr(dot);
+            if(ext != base_ext && ext != delta_ext) {
+                return std::nullopt;
+            }
+            auto stem = name.substr(0, dot);
+            if(!std::all_of(stem.begin(), stem.end(), [](char c) {
+                   return c >= '0' && c <= '9';
+               })) {
+                return std::nullopt;
+            }
+            return std::make_pair(std::stoull(stem), ext == base_ext);
+        }
+
+        /// Flushes a file or directory to disk.
+        auto sync_path(const std::string& path) -> bool {
+            auto fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) {
+                return false;
+            }
+            const auto ret = ::fsync(fd) == 0;
+            ::close(fd);
+            return ret;
+        }
+
+        struct file_header {
+            /// Log index of the previous file in the chain, zero for a base
+            /// file.
+            uint64_t m_prev{};
+            nuraft::ptr<nuraft::snapshot> m_snp;
+            buffer m_dtx_state;
+        };
+
+        auto read_header(serializer& deser) -> std::optional<file_header> {
+            auto ret = file_header();
+            uint64_t meta_sz{};
+            if(!(deser >> ret.m_prev >> meta_sz) || meta_sz == 0) {
+                return std::nullopt;
+            }
+            auto meta = nuraft::buffer::alloc(meta_sz);
+            if(!deser.read(meta->data_begin(), meta->size())) {
+                return std::nullopt;
+            }
+            ret.m_snp = nuraft::snapshot::deserialize(*meta);
+            if(!ret.m_snp || !(deser >> ret.m_dtx_state)) {
+                return std::nullopt;
+            }
+            return ret;
+        }
+
+        auto read_prev(const std::string& path) -> std::optional<uint64_t> {
+            auto in = std::ifstream(path, std::ios::in | std::ios::binary);
+            if(!in.good()) {
+                return std::nullopt;
+            }
+            auto deser = istream_serializer(in);
+            uint64_t prev{};
+            if(!(deser >> prev)) {
+                return std::nullopt;
+            }
+            return prev;
+        }
+
+        // Hash lists are written as one block rather than element by
+        // element, since a base file holds the whole unspent set.
+        auto write_hashes(serializer& ser, const std::vector<hash_t>& hashes)
+            -> bool {
+            if(!(ser << static_cast<uint64_t>(hashes.size()))) {
+                return false;
+            }
+            return hashes.empty()
+                || ser.write(hashes.data(), hashes.size() * sizeof(hash_t));
+        }
+
+        auto read_hashes(serializer& deser)
+            -> std::optional<std::vector<hash_t>> {
+            uint64_t count{};
+            if(!(deser >> count)) {
+                return std::nullopt;
+            }
+            auto ret = std::vector<hash_t>(count);
+            if(count != 0
+               && !deser.read(ret.data(), ret.size() * sizeof(hash_t))) {
+                return std::nullopt;
+            }
+            return ret;
+        }
+    }
+
+    snapshot_store::snapshot_store(std::shared_ptr<logging::log> logger,
+                                   std::string dir,
+                                   size_t merge_deltas)
+        : m_logger(std::move(logger)),
+          m_dir(std::move(dir)),
+          m_merge_deltas(merge_deltas) {}
+
+    snapshot_store::~snapshot_store() {
+        {
+            std::unique_lock<std::mutex> l(m_chain_mut);
+            m_running = false;
+        }
+        m_chain_cv.notify_one();
+        if(m_merge_thread.joinable()) {
+            m_merge_thread.join();
+        }
+    }
+
+    auto snapshot_store::init() -> bool {
+        auto err = std::error_code();
+        std::filesystem::create_directories(m_dir, err);
+        if(err) {
+            m_logger->error("Failed to create snapshot directory", m_dir);
+            return false;
+        }
+
+        auto indices = std::vector<uint64_t>();
+        for(const auto& p : std::filesystem::directory_iterator(m_dir, err)) {
+            const auto& path = p.path();
+            auto ext = path.extension().generic_string();
+            if(ext == tmp_ext || ext == recv_ext) {
+                auto rm_err = std::error_code();
+                std::filesystem::remove(path, rm_err);
+                continue;
+            }
+            auto parsed = parse_name(path.filename().generic_string());
+            if(parsed.has_value()) {
+                indices.push_back(parsed->first);
+            }
+        }
+        if(err) {
+            m_logger->error("Failed to read snapshot directory", m_dir);
+            return false;
+        }
+
+        std::sort(indices.begin(), indices.end(), std::greater<>());
+        for(auto idx : indices) {
+            if(chain(idx).has_value()) {
+                m_latest = idx;
+                break;
+            }
+        }
+
+        m_merge_thread = std::thread([&]() {
+            merge_loop();
+        });
+        return true;
+    }
+
+    auto snapshot_store::has_chain() const -> bool {
+        std::unique_lock<std::mutex> l(m_chain_mut);
+        return m_head != 0;
+    }
+
+    auto snapshot_store::write_base(nuraft::snapshot& snp,
+                                    const std::vector<hash_t>& uhs,
+                                    const buffer& dtx_state) -> bool {
+        auto idx = snp.get_last_log_idx();
+        if(!write_file(file_path(idx, true),
+                       0,
+                       snp,
+                       dtx_state,
+                       uhs,
+                       std::vector<hash_t>(),
+                       false)) {
+            std::unique_lock<std::mutex> l(m_chain_mut);
+            m_head = 0;
+            return false;
+        }
+        {
+            std::unique_lock<std::mutex> l(m_chain_mut);
+            m_head = idx;
+            m_latest = idx;
+            m_chain_deltas = 0;
+        }
+        remove_superseded(idx);
+        return true;
+    }
+
+    auto snapshot_store::write_delta(nuraft::snapshot& snp,
+                                     const uhs_delta& delta,
+                                     const buffer& dtx_state) -> bool {
+        auto idx = snp.get_last_log_idx();
+        std::unique_lock<std::mutex> l(m_chain_mut);
+        auto prev = m_head;
+        if(prev == 0 || prev >= idx) {
+            m_head = 0;
+            return false;
+        }
+        l.unlock();
+
+        auto ok = write_file(file_path(idx, false),
+                             prev,
+                             snp,
+                             dtx_state,
+                             delta.m_added,
+                             delta.m_removed,
+                             false);
+
+        l.lock();
+        if(!ok) {
+            m_head = 0;
+            return false;
+        }
+        m_head = idx;
+        m_latest = idx;
+        m_chain_deltas++;
+        if(m_merge_deltas != 0 && m_chain_deltas >= m_merge_deltas) {
+            m_chain_cv.notify_one();
+        }
+        return true;
+    }
+
+    auto snapshot_store::latest() -> nuraft::ptr<nuraft::snapshot> {
+        uint64_t idx{};
+        {
+            std::unique_lock<std::mutex> l(m_chain_mut);
+            idx = m_latest;
+        }
+        if(idx == 0) {
+            return nullptr;
+        }
+
+        std::shared_lock<std::shared_mutex> l(m_files_mut);
+        auto files = chain(idx);
+        if(!files.has_value()) {
+            return nullptr;
+        }
+        auto in
+            = std::ifstream(files->back(), std::ios::in | std::ios::binary);
+        auto deser = istream_serializer(in);
+        auto header = read_header(deser);
+        if(!header.has_value()) {
+            return nullptr;
+        }
+        return header->m_snp;
+    }
+
+    auto snapshot_store::load(uint64_t idx) -> std::optional<image> {
+        std::shared_lock<std::shared_mutex> l(m_files_mut);
+        auto files = chain(idx);
+        if(!files.has_value()) {
+            return std::nullopt;
+        }
+        return read_chain(files.value());
+    }
+
+    void snapshot_store::set_chain(uint64_t idx) {
+        auto files = std::optional<std::vector<std::string>>();
+        {
+            std::shared_lock<std::shared_mutex> l(m_files_mut);
+            files = chain(idx);
+        }
+        if(!files.has_value()) {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> l(m_chain_mut);
+            m_head = idx;
+            m_latest = idx;
+            m_chain_deltas = files->size() - 1;
+        }
+        auto base = parse_name(
+            std::filesystem::path(files->front()).filename().generic_string());
+        remove_superseded(base->first);
+        m_chain_cv.notify_one();
+    }
+
+    auto snapshot_store::read_object(uint64_t idx,
+                                     uint64_t obj_id,
+                                     bool& is_last) -> std::optional<buffer> {
+        {
+            std::unique_lock<std::mutex> l(m_pins_mut);
+            m_pins[idx] = std::chrono::steady_clock::now() + pin_timeout;
+        }
+        auto ret = read_chain_object(idx, obj_id, is_last);
+        if(!ret.has_value() || is_last) {
+            {
+                std::unique_lock<std::mutex> l(m_pins_mut);
+                m_pins.erase(idx);
+            }
+            m_chain_cv.notify_one();
+        }
+        return ret;
+    }
+
+    auto snapshot_store::read_chain_object(uint64_t idx,
+                                           uint64_t obj_id,
+                                           bool& is_last)
+        -> std::optional<buffer> {
+        std::shared_lock<std::shared_mutex> l(m_files_mut);
+        auto files = chain(idx);
+        if(!files.has_value()) {
+            return std::nullopt;
+        }
+
+        for(size_t i{0}; i < files->size(); i++) {
+            const auto& path = (*files)[i];
+            auto err = std::error_code();
+            auto sz = std::filesystem::file_size(path, err);
+            if(err) {
+                return std::nullopt;
+            }
+            auto chunks
+                = std::max<uint64_t>(1, (sz + chunk_size - 1) / chunk_size);
+            if(obj_id >= chunks) {
+                obj_id -= chunks;
+                continue;
+            }
+
+            auto offset = obj_id * chunk_size;
+            auto len = std::min<uint64_t>(chunk_size, sz - offset);
+            auto last_chunk = obj_id + 1 == chunks;
+            auto name = parse_name(
+                std::filesystem::path(path).filename().generic_string());
+
+            auto ret = buffer();
+            auto ser = buffer_serializer(ret);
+            ser << name->first << static_cast<uint8_t>(name->second)
+                << offset << static_cast<uint8_t>(last_chunk) << len;
+            auto data_offset = ret.size();
+            ret.extend(len);
+
+            auto in = std::ifstream(path, std::ios::in | std::ios::binary);
+            in.seekg(static_cast<std::streamoff>(offset));
+            in.read(static_cast<char*>(ret.data_at(data_offset)),
+                    static_cast<std::streamsize>(len));
+            if(!in.good()) {
+                return std::nullopt;
+            }
+
+            is_last = last_chunk && i + 1 == files->size();
+            return ret;
+        }
+        return std::nullopt;
+    }
+
+    auto snapshot_store::save_object(buffer obj) -> bool {
+        auto deser = buffer_serializer(obj);
+        uint64_t idx{};
+        uint8_t is_base{};
+        uint64_t offset{};
+        uint8_t last_chunk{};
+        auto data = buffer();
+        if(!(deser >> idx >> is_base >> offset >> last_chunk >> data)
+           || idx == 0) {
+            m_logger->error("Received malformed snapshot object");
+            return false;
+        }
+
+        auto path = file_path(idx, is_base != 0);
+        auto recv_path = path + recv_ext;
+        {
+            auto mode = std::ios::out | std::ios::binary;
+            mode |= offset == 0 ? std::ios::trunc : std::ios::in;
+            auto out = std::fstream(recv_path, mode);
+            if(!out.good()) {
+                m_logger->error("Failed to open", recv_path);
+                return false;
+            }
+            out.seekp(static_cast<std::streamoff>(offset));
+            out.write(static_cast<const char*>(data.data()),
+                      static_cast<std::streamsize>(data.size()));
+            out.flush();
+            if(!out.good()) {
+                m_logger->error("Failed to write", recv_path);
+                return false;
+            }
+        }
+
+        if(last_chunk != 0) {
+            if(!sync_path(recv_path)) {
+                m_logger->error("Failed to sync", recv_path);
+                return false;
+            }
+            std::unique_lock<std::shared_mutex> l(m_files_mut);
+            auto err = std::error_code();
+            std::filesystem::rename(recv_path, path, err);
+            if(err) {
+                m_logger->error("Failed to rename", recv_path);
+                return false;
+            }
+            if(!sync_path(m_dir)) {
+                m_logger->error("Failed to sync", m_dir);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto snapshot_store::file_path(uint64_t idx, bool is_base) const
+        -> std::string {
+        return m_dir + "/" + std::to_string(idx)
+             + (is_base ? base_ext : delta_ext);
+    }
+
+    auto snapshot_store::chain(uint64_t idx) const
+        -> std::optional<std::vector<std::string>> {
+        auto ret = std::vector<std::string>();
+        while(idx != 0) {
+            auto base = file_path(idx, true);
+            auto err = std::error_code();
+            if(std::filesystem::exists(base, err)) {
+                ret.push_back(base);
+                std::reverse(ret.begin(), ret.end());
+                return ret;
+            }
+            auto delta = file_path(idx, false);
+            auto prev = read_prev(delta);
+            if(!prev.has_value() || prev.value() >= idx) {
+                return std::nullopt;
+            }
+            ret.push_back(delta);
+            idx = prev.value();
+        }
+        return std::nullopt;
+    }
+
+    auto snapshot_store::read_chain(const std::vector<std::string>& files)
+        const -> std::optional<image> {
+        auto ret = image();
+        for(size_t i{0}; i < files.size(); i++) {
+            auto in = std::ifstream(files[i], std::ios::in | std::ios::binary);
+            auto deser = istream_serializer(in);
+            auto header = read_header(deser);
+            if(!header.has_value()) {
+                m_logger->error("Failed to read snapshot header", files[i]);
+                return std::nullopt;
+            }
+            auto added = read_hashes(deser);
+            auto removed = std::optional<std::vector<hash_t>>();
+            if(added.has_value()) {
+                removed = read_hashes(deser);
+            }
+            if(!removed.has_value()) {
+                m_logger->error("Failed to read snapshot UHS IDs", files[i]);
+                return std::nullopt;
+            }
+
+            if(i == 0) {
+                ret.m_uhs = std::move(added.value());
+            } else {
+                auto kept = std::vector<hash_t>();
+                kept.reserve(ret.m_uhs.size());
+                std::set_difference(ret.m_uhs.begin(),
+                                    ret.m_uhs.end(),
+                                    removed->begin(),
+                                    removed->end(),
+                                    std::back_inserter(kept));
+                ret.m_uhs = std::vector<hash_t>();
+                ret.m_uhs.reserve(kept.size() + added->size());
+                std::set_union(kept.begin(),
+                               kept.end(),
+                               added->begin(),
+                               added->end(),
+                               std::back_inserter(ret.m_uhs));
+            }
+
+            if(i + 1 == files.size()) {
+                ret.m_snp = std::move(header->m_snp);
+                ret.m_dtx_state = std::move(header->m_dtx_state);
+            }
+        }
+        return ret;
+    }
+
+    auto snapshot_store::write_file(const std::string& path,
+                                    uint64_t prev,
+                                    nuraft::snapshot& snp,
+                                    const buffer& dtx_state,
+                                    const std::vector<hash_t>& added,
+                                    const std::vector<hash_t>& removed,
+                                    bool defer_if_pinned) -> bool {
+        auto tmp_path = path + tmp_ext;
+        {
+            auto out = std::ofstream(tmp_path,
+                                     std::ios::out | std::ios::trunc
+                                         | std::ios::binary);
+            if(!out.good()) {
+                m_logger->error("Failed to open", tmp_path);
+                return false;
+            }
+            auto ser = ostream_serializer(out);
+            auto meta = snp.serialize();
+            auto ok = (ser << prev << static_cast<uint64_t>(meta->size()))
+                   && ser.write(meta->data_begin(), meta->size())
+                   && (ser << dtx_state) && write_hashes(ser, added)
+                   && write_hashes(ser, removed);
+            out.flush();
+            if(!ok || !out.good()) {
+                m_logger->error("Failed to write", tmp_path);
+                return false;
+            }
+        }
+        // The rename must not reach disk before the file's contents
+        if(!sync_path(tmp_path)) {
+            m_logger->error("Failed to sync", tmp_path);
+            return false;
+        }
+
+        std::unique_lock<std::shared_mutex> l(m_files_mut);
+        auto err = std::error_code();
+        if(defer_if_pinned && pinned()) {
+            // A new base file would renumber a chain being transferred
+            std::filesystem::remove(tmp_path, err);
+            return false;
+        }
+        std::filesystem::rename(tmp_path, path, err);
+        if(err) {
+            m_logger->error("Failed to rename", tmp_path);
+            return false;
+        }
+        if(!sync_path(m_dir)) {
+            m_logger->error("Failed to sync", m_dir);
+            return false;
+        }
+        return true;
+    }
+
+    auto snapshot_store::pinned() -> bool {
+        std::unique_lock<std::mutex> l(m_pins_mut);
+        auto now = std::chrono::steady_clock::now();
+        for(auto it = m_pins.begin(); it != m_pins.end();) {
+            if(it->second <= now) {
+                it = m_pins.erase(it);
+            } else {
+                it++;
+            }
+        }
+        return !m_pins.empty();
+    }
+
+    void snapshot_store::remove_superseded(uint64_t idx) {
+        std::unique_lock<std::shared_mutex> l(m_files_mut);
+        if(pinned()) {
+            // Left for the next base file, as a transfer may need them
+            return;
+        }
+        auto err = std::error_code();
+        for(const auto& p : std::filesystem::directory_iterator(m_dir, err)) {
+            auto name = parse_name(p.path().filename().generic_string());
+            if(!name.has_value()) {
+                continue;
+            }
+            auto [f_idx, is_base] = name.value();
+            if(f_idx < idx || (f_idx == idx && !is_base)) {
+                auto rm_err = std::error_code();
+                std::filesystem::remove(p.path(), rm_err);
+            }
+        }
+    }
+
+    void snapshot_store::merge_loop() {
+        std::unique_lock<std::mutex> l(m_chain_mut);
+        while(true) {
+            m_chain_cv.wait(l, [&]() {
+                return !m_running
+                    || (m_merge_deltas != 0 && m_head != 0
+                        && m_head != m_merged
+                        && m_chain_deltas >= m_merge_deltas);
+            });
+            if(!m_running) {
+                return;
+            }
+            auto idx = m_head;
+            l.unlock();
+            auto ok = merge(idx);
+            l.lock();
+            if(!ok && pinned()) {
+                // Retries once the transfer finishes or its pin expires
+                m_chain_cv.wait_for(l, pin_timeout, [&]() {
+                    return !m_running || !pinned();
+                });
+                continue;
+            }
+            m_merged = idx;
+            if(ok && m_head != 0) {
+                // Deltas written during the merge extend the new base file.
+                std::shared_lock<std::shared_mutex> fl(m_files_mut);
+                auto files = chain(m_head);
+                m_chain_deltas = files.has_value() ? files->size() - 1 : 0;
+            }
+        }
+    }
+
+    auto snapshot_store::merge(uint64_t idx) -> bool {
+        auto img = load(idx);
+        if(!img.has_value()) {
+            m_logger->warn("Failed to load snapshot chain at", idx);
+            return false;
+        }
+        if(!write_file(file_path(idx, true),
+                       0,
+                       *img->m_snp,
+                       img->m_dtx_state,
+                       img->m_uhs,
+                       std::vector<hash_t>(),
+                       true)) {
+            return false;
+        }
+        remove_superseded(idx);
+        m_logger->info("Merged snapshot chain at", idx);
+        return true;
+    }
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_LOCKING_SHARD_SNAPSHOT_STORE_H_
+#define OPENCBDC_TX_SRC_LOCKING_SHARD_SNAPSHOT_STORE_H_
+
+#include "locking_shard.hpp"
+#include "util/common/buffer.hpp"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <libnuraft/nuraft.hxx>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cbdc::locking_shard {
+    /// \brief Directory of incremental locking shard snapshots.
+    ///
+    /// The snapshot at a raft log index is a chain of files: a base file
+    /// holding every unspent UHS ID at some earlier index, followed by one
+    /// delta file per later snapshot holding the sorted UHS IDs added and
+    /// removed since the previous one. Each file also holds the shard's dtx
+    /// state at its own index, so a chain's dtx state comes from its newest
+    /// file. Once a chain grows past the merge threshold, a background
+    /// thread folds it into a new base file and deletes the files it
+    /// replaces. Chains are sent to other nodes file by file, in chunks;
+    /// while a chain is being sent, merges and deletions wait so its
+    /// object numbering stays stable.
+    class snapshot_store {
+      public:
+        /// Snapshot loaded from a chain.
+        struct image {
+            /// Raft metadata of the snapshot.
+            nuraft::ptr<nuraft::snapshot> m_snp;
+            /// Every unspent UHS ID, sorted.
+            std::vector<hash_t> m_uhs;
+            /// Serialized dtx state, see \ref locking_shard::dtx_state.
+            buffer m_dtx_state;
+        };
+
+        /// Maximum number of file bytes in one transferred snapshot object.
+        static constexpr size_t chunk_size = 4 * 1024 * 1024;
+
+        /// Time after the last object read from a snapshot at which an
+        /// unfinished transfer no longer pins it.
+        static constexpr auto pin_timeout = std::chrono::seconds(60);
+
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param dir directory in which to store snapshot files.
+        /// \param merge_deltas number of delta files after which a chain is
+        ///                     merged into a new base file. Zero disables
+        ///                     merging.
+        snapshot_store(std::shared_ptr<logging::log> logger,
+                       std::string dir,
+                       size_t merge_deltas);
+
+        /// Stops the merge thread.
+        ~snapshot_store();
+
+        snapshot_store(const snapshot_store&) = delete;
+        auto operator=(const snapshot_store&) -> snapshot_store& = delete;
+        snapshot_store(snapshot_store&&) = delete;
+        auto operator=(snapshot_store&&) -> snapshot_store& = delete;
+
+        /// Creates the snapshot directory, removes partially written files,
+        /// finds the newest complete chain and starts the merge thread.
+        /// \return true if the directory was readable.
+        auto init() -> bool;
+
+        /// Checks whether a delta can be written, which requires a chain
+        /// whose newest file matches the shard's tracked changes.
+        /// \return true if there is a current chain.
+        [[nodiscard]] auto has_chain() const -> bool;
+
+        /// Writes a base file, starting a new chain.
+        /// \param snp raft metadata of the snapshot.
+        /// \param uhs every unspent UHS ID, sorted.
+        /// \param dtx_state serialized dtx state.
+        /// \return true if the file was written.
+        auto write_base(nuraft::snapshot& snp,
+                        const std::vector<hash_t>& uhs,
+                        const buffer& dtx_state) -> bool;
+
+        /// Writes a delta file extending the current chain. If writing
+        /// fails, the chain is abandoned so the next snapshot must be a
+        /// base file.
+        /// \param snp raft metadata of the snapshot.
+        /// \param delta changes since the newest file in the chain.
+        /// \param dtx_state serialized dtx state.
+        /// \return true if the file was written.
+        auto write_delta(nuraft::snapshot& snp,
+                         const uhs_delta& delta,
+                         const buffer& dtx_state) -> bool;
+
+        /// Returns the raft metadata of the newest complete snapshot.
+        /// \return snapshot metadata, or nullptr if there is none.
+        auto latest() -> nuraft::ptr<nuraft::snapshot>;
+
+        /// Loads the snapshot at the given log index by applying each delta
+        /// in its chain to the base file.
+        /// \param idx log index of the snapshot.
+        /// \return snapshot, or std::nullopt if its chain is incomplete or
+        ///         unreadable.
+        auto load(uint64_t idx) -> std::optional<image>;
+
+        /// Makes the chain ending at the given index the current chain,
+        /// after it was received from another node and applied.
+        /// \param idx log index of the applied snapshot.
+        void set_chain(uint64_t idx);
+
+        /// Reads one transfer object of the snapshot at the given index.
+        /// Objects are numbered across the chain's files in order, one per
+        /// chunk of each file. Pins the snapshot until its last object is
+        /// read, or until no object was read for \ref pin_timeout.
+        /// \param idx log index of the snapshot.
+        /// \param obj_id object number.
+        /// \param is_last set to true if this is the chain's last object.
+        /// \return serialized object, or std::nullopt if the snapshot no
+        ///         longer exists.
+        auto read_object(uint64_t idx, uint64_t obj_id, bool& is_last)
+            -> std::optional<buffer>;
+
+        /// Writes an object received from \ref read_object. A file becomes
+        /// visible to \ref load once its last chunk is written.
+        /// \param obj serialized object.
+        /// \return true if the object was valid and written.
+        auto save_object(buffer obj) -> bool;
+
+      private:
+        [[nodiscard]] auto file_path(uint64_t idx, bool is_base) const
+            -> std::string;
+        [[nodiscard]] auto chain(uint64_t idx) const
+            -> std::optional<std::vector<std::string>>;
+        [[nodiscard]] auto read_chain(const std::vector<std::string>& files)
+            const -> std::optional<image>;
+        auto read_chain_object(uint64_t idx, uint64_t obj_id, bool& is_last)
+            -> std::optional<buffer>;
+        auto write_file(const std::string& path,
+                        uint64_t prev,
+                        nuraft::snapshot& snp,
+                        const buffer& dtx_state,
+                        const std::vector<hash_t>& added,
+                        const std::vector<hash_t>& removed,
+                        bool defer_if_pinned) -> bool;
+        auto pinned() -> bool;
+        void remove_superseded(uint64_t idx);
+        void merge_loop();
+        auto merge(uint64_t idx) -> bool;
+
+        std::shared_ptr<logging::log> m_logger;
+        std::string m_dir;
+        size_t m_merge_deltas;
+
+        /// Guards file creation, renames and deletions against readers.
+        mutable std::shared_mutex m_files_mut;
+
+        /// Snapshots being sent to other nodes, with the time each pin
+        /// expires.
+        std::map<uint64_t, std::chrono::steady_clock::time_point> m_pins;
+        /// Protects m_pins. Never held while acquiring another lock.
+        std::mutex m_pins_mut;
+
+        /// Log index of the newest file in the current chain, or zero.
+        uint64_t m_head{0};
+        /// Log index of the newest complete snapshot, or zero.
+        uint64_t m_latest{0};
+        /// Number of delta files in the current chain.
+        size_t m_chain_deltas{0};
+        /// Log index of the last chain the merge thread tried to merge.
+        uint64_t m_merged{0};
+        mutable std::mutex m_chain_mut;
+        std::condition_variable m_chain_cv;
+
+        std::atomic_bool m_running{true};
+        std::thread m_merge_thread;
+    };
+}
+
+#endif
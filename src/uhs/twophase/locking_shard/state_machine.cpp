@@ -6,36 +6,85 @@
 #include "state_machine.hpp"
 
 #include "format.hpp"
+#include "util/raft/batching_replicator.hpp"
 #include "util/raft/serialization.hpp"
 #include "util/serialization/format.hpp"
 
+#include <cstring>
 #include <unistd.h>
 
 namespace cbdc::locking_shard {
+    namespace {
+        /// Variant index following the dtx ID of a batch entry.
+        constexpr uint8_t batch_marker{0xFF};
+    }
+
     state_machine::state_machine(
         const std::pair<uint8_t, uint8_t>& output_range,
         std::shared_ptr<logging::log> logger,
         size_t completed_txs_cache_size,
         const std::string& preseed_file,
-        config::options opts)
+        config::options opts,
+        std::string snapshot_dir,
+        std::string uhs_export_prefix)
         : m_output_range(output_range),
+          m_snapshot_dir(std::move(snapshot_dir)),
+          m_uhs_export_prefix(std::move(uhs_export_prefix)),
+          m_uhs_export_interval(opts.m_shard_uhs_export_interval),
           m_logger(std::move(logger)) {
         register_handler_callback([&](rpc::request req) {
             return process_request(std::move(req));
         });
+        auto snapshot_distance = opts.m_snapshot_distance;
+        auto merge_deltas = opts.m_shard_snapshot_merge_deltas;
         m_shard = std::make_unique<locking_shard>(output_range,
                                                   m_logger,
                                                   completed_txs_cache_size,
                                                   preseed_file,
                                                   std::move(opts));
+        if(snapshot_distance == 0) {
+            return;
+        }
+
+        m_snapshots = std::make_unique<snapshot_store>(m_logger,
+                                                       m_snapshot_dir,
+                                                       merge_deltas);
+        if(!m_snapshots->init()) {
+            m_logger->fatal("Failed to initialize snapshot store");
+        }
+        auto snp = m_snapshots->latest();
+        if(snp && !state_machine::apply_snapshot(*snp)) {
+            m_logger->fatal("Failed to apply snapshot at",
+                            snp->get_last_log_idx());
+        }
     }
 
     auto state_machine::commit(uint64_t log_idx, nuraft::buffer& data)
         -> nuraft::ptr<nuraft::buffer> {
         assert(log_idx == m_last_committed_idx + 1);
-        m_last_committed_idx = log_idx;
+
+        const auto prefix_size = sizeof(hash_t) + sizeof(batch_marker);
+        if(data.size() >= prefix_size
+           && data.data_begin()[sizeof(hash_t)] == batch_marker) {
+            auto entries = raft::read_batch_entry(data, prefix_size);
+            if(!entries.has_value()) {
+                m_logger->fatal("Invalid batch entry at log index", log_idx);
+            }
+            // Each request takes the locks it needs, as it would in an entry
+            // of its own
+            auto results = std::vector<nuraft::ptr<nuraft::buffer>>();
+            results.reserve(entries->size());
+            for(auto& entry : *entries) {
+                results.emplace_back(blocking_call(*entry).value_or(nullptr));
+            }
+            maybe_export_uhs(log_idx);
+            set_applied(log_idx);
+            return raft::make_batch_result(results);
+        }
 
         auto resp = blocking_call(data);
+        maybe_export_uhs(log_idx);
+        set_applied(log_idx);
         if(!resp.has_value()) {
             // TODO: This would only happen if there was a deserialization
             // error with the request. Maybe we should abort here as such an
@@ -46,19 +95,117 @@ namespace cbdc::locking_shard {
         return resp.value();
     }
 
+    auto state_machine::batch_prefix() -> buffer {
+        auto ret = buffer();
+        ret.extend(sizeof(hash_t));
+        ret.append(&batch_marker, sizeof(batch_marker));
+        return ret;
+    }
+
+    void state_machine::maybe_export_uhs(uint64_t log_idx) {
+        if(m_uhs_export_interval == 0 || log_idx % m_uhs_export_interval != 0
+           || m_uhs_export_prefix.empty()) {
+            return;
+        }
+        // Requests are processed as they commit, so the export reflects
+        // exactly the log entries up to this one
+        auto started = m_shard->export_uhs(
+            m_uhs_export_prefix + std::to_string(log_idx),
+            log_idx,
+            [logger = m_logger, log_idx](bool ok) {
+                if(ok) {
+                    logger->info("Exported UHS at log index", log_idx);
+                } else {
+                    logger->error("Failed to export UHS at log index",
+                                  log_idx);
+                }
+            });
+        if(!started) {
+            m_logger->warn("Skipping UHS export at log index",
+                           log_idx,
+                           "as the previous export is still running");
+        }
+    }
+
     void state_machine::commit_config(
         const nuraft::ulong log_idx,
         nuraft::ptr<nuraft::cluster_config>& /*new_conf*/) {
         assert(log_idx == m_last_committed_idx + 1);
+        set_applied(log_idx);
+    }
+
+    void state_machine::set_commit_listener(std::function<void()> listener) {
+        m_commit_listener = std::move(listener);
+    }
+
+    void state_machine::set_applied(uint64_t log_idx) {
         m_last_committed_idx = log_idx;
+        if(m_commit_listener) {
+            m_commit_listener();
+        }
     }
 
-    auto state_machine::apply_snapshot(nuraft::snapshot& /* s */) -> bool {
-        return false;
+    auto
+    state_machine::read_logical_snp_obj(nuraft::snapshot& s,
+                                        void*& /* user_snp_ctx */,
+                                        nuraft::ulong obj_id,
+                                        nuraft::ptr<nuraft::buffer>& data_out,
+                                        bool& is_last_obj) -> int {
+        if(!m_snapshots) {
+            return -1;
+        }
+        auto obj = m_snapshots->read_object(s.get_last_log_idx(),
+                                            obj_id,
+                                            is_last_obj);
+        if(!obj.has_value()) {
+            // Requested snapshot was merged or replaced, not fatal
+            return -1;
+        }
+        data_out = nuraft::buffer::alloc(obj->size());
+        std::memcpy(data_out->data_begin(), obj->data(), obj->size());
+        return 0;
+    }
+
+    void state_machine::save_logical_snp_obj(nuraft::snapshot& /* s */,
+                                             nuraft::ulong& obj_id,
+                                             nuraft::buffer& data,
+                                             bool /* is_first_obj */,
+                                             bool /* is_last_obj */) {
+        if(!m_snapshots) {
+            m_logger->fatal("Received snapshot with snapshots disabled");
+        }
+        auto obj = buffer();
+        obj.append(data.data_begin(), data.size());
+        if(!m_snapshots->save_object(std::move(obj))) {
+            m_logger->fatal("Failed to save snapshot object", obj_id);
+        }
+        obj_id++;
+    }
+
+    auto state_machine::apply_snapshot(nuraft::snapshot& s) -> bool {
+        if(!m_snapshots) {
+            return false;
+        }
+        auto idx = s.get_last_log_idx();
+        auto img = m_snapshots->load(idx);
+        if(!img.has_value()) {
+            return false;
+        }
+        if(!m_shard->restore(img->m_uhs, std::move(img->m_dtx_state))) {
+            m_logger->error("Failed to restore shard state from snapshot",
+                            idx);
+            return false;
+        }
+        m_snapshots->set_chain(idx);
+        set_applied(idx);
+        return true;
     }
 
     auto state_machine::last_snapshot() -> nuraft::ptr<nuraft::snapshot> {
-        return nullptr;
+        if(!m_snapshots) {
+            return nullptr;
+        }
+        return m_snapshots->latest();
     }
 
     auto state_machine::last_commit_index() -> uint64_t {
@@ -66,10 +213,28 @@ namespace cbdc::locking_shard {
     }
 
     void state_machine::create_snapshot(
-        nuraft::snapshot& /* s */,
+        nuraft::snapshot& s,
         nuraft::async_result<bool>::handler_type& when_done) {
         nuraft::ptr<std::exception> except(nullptr);
         bool ret = false;
+        if(m_snapshots) {
+            assert(s.get_last_log_idx() == last_commit_index());
+            // Snapshots are created between commits, so the shard's state
+            // does not change while it is being read.
+            auto dtx_state = m_shard->dtx_state();
+            if(m_snapshots->has_chain()) {
+                ret = m_snapshots->write_delta(s,
+                                               m_shard->take_uhs_delta(),
+                                               dtx_state);
+            } else {
+                // Discard changes tracked before the base image so the next
+                // delta is relative to it.
+                m_shard->take_uhs_delta();
+                ret = m_snapshots->write_base(s,
+                                              m_shard->uhs_image(),
+                                              dtx_state);
+            }
+        }
         when_done(ret, except);
     }
 
@@ -89,8 +254,9 @@ namespace cbdc::locking_shard {
                                           "with",
                                           params.size(),
                                           "txs");
-                           auto res = m_shard->lock_outputs(std::move(params),
-                                                            req.m_dtx_id);
+                           auto res = m_shard->lock_outputs(
+                               std::move(params).take(),
+                               req.m_dtx_id);
                            assert(res.has_value());
                            m_logger->info("Done lock", dtxid_str);
                            return res.value();
@@ -113,6 +279,54 @@ namespace cbdc::locking_shard {
                            assert(res);
                            m_logger->info("Done discard", dtxid_str);
                            return rpc::discard_response();
+                       },
+                       [&](rpc::lock_apply_params&& params)
+                           -> cbdc::locking_shard::rpc::response {
+                           m_logger->info("Processing lock and apply",
+                                          dtxid_str,
+                                          "with",
+                                          params.m_txs.size(),
+                                          "txs");
+                           auto res = m_shard->lock_and_apply(
+                               std::move(params.m_txs).take(),
+                               req.m_dtx_id);
+                           assert(res.has_value());
+                           m_logger->info("Done lock and apply", dtxid_str);
+                           return res.value();
+                       },
+                       [&](rpc::range_params&& params)
+                           -> cbdc::locking_shard::rpc::response {
+                           auto res = rpc::range_response{false, {}};
+                           switch(params.m_op) {
+                               case rpc::range_op::begin_import:
+                                   res.m_success = m_shard->begin_import(
+                                       params.m_range);
+                                   break;
+                               case rpc::range_op::end_import:
+                                   res.m_success = m_shard->end_import();
+                                   break;
+                               case rpc::range_op::read: {
+                                   auto ids = m_shard->read_range(
+                                       params.m_range,
+                                       params.m_offset);
+                                   if(ids.has_value()) {
+                                       res.m_success = true;
+                                       res.m_uhs_ids = std::move(ids.value());
+                                   }
+                                   break;
+                               }
+                               case rpc::range_op::drop:
+                                   res.m_success
+                                       = m_shard->drop_range(params.m_range);
+                                   break;
+                           }
+                           return res;
+                       },
+                       [&](rpc::import_params&& params)
+                           -> cbdc::locking_shard::rpc::response {
+                           return rpc::range_response{
+                               m_shard->import_uhs(params.m_uhs_ids),
+                               {}};
                        }},
             std::move(req.m_params));
     }
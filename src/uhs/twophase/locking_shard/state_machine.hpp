@@ -7,9 +7,11 @@
 #define OPENCBDC_TX_SRC_LOCKING_SHARD_STATE_MACHINE_H_
 
 #include "locking_shard.hpp"
+#include "snapshot_store.hpp"
 #include "util/common/logging.hpp"
 #include "util/rpc/blocking_server.hpp"
 
+#include <functional>
 #include <libnuraft/nuraft.hxx>
 #include <mutex>
 
@@ -31,14 +33,23 @@ namespace cbdc::locking_shard {
         /// \param preseed_file path to file containing shard pre-seeding data
         ///                     or empty string to disable pre-seeding.
         /// \param opts configuration options.
+        /// \param snapshot_dir directory in which to store snapshots. Only
+        ///                     used if the snapshot distance is non-zero.
+        ///                     Applies the latest snapshot it holds, if any.
+        /// \param uhs_export_prefix path prefix of the UHS exports started
+        ///                          every m_shard_uhs_export_interval log
+        ///                          entries, completed by the log index.
         state_machine(const std::pair<uint8_t, uint8_t>& output_range,
                       std::shared_ptr<logging::log> logger,
                       size_t completed_txs_cache_size,
                       const std::string& preseed_file,
-                      config::options opts);
+                      config::options opts,
+                      std::string snapshot_dir,
+                      std::string uhs_export_prefix = "");
 
         /// Commit the given raft log entry at the given log index, and return
-        /// the result.
+        /// the result. Entries starting with \ref batch_prefix hold a run of
+        /// requests, which are processed in order.
         /// \param log_idx raft log index of the log entry.
         /// \param data serialized RPC request.
         /// \return serialized RPC response or nullptr if there was an error
@@ -46,29 +57,78 @@ namespace cbdc::locking_shard {
         auto commit(uint64_t log_idx, nuraft::buffer& data)
             -> nuraft::ptr<nuraft::buffer> override;
 
+        /// Returns the bytes marking a raft log entry as a batch of requests,
+        /// see \ref raft::make_batch_entry. An all-zero dtx ID followed by a
+        /// variant index no request type uses.
+        /// \return batch entry prefix.
+        static auto batch_prefix() -> buffer;
+
         /// Handler for the raft cluster configuration changes
         /// \param log_idx Raft log number of the configuration change.
         void commit_config(
             nuraft::ulong log_idx,
             nuraft::ptr<nuraft::cluster_config>& /*new_conf*/) override;
 
-        /// Not implemented for locking shard.
-        /// \return false.
-        auto apply_snapshot(nuraft::snapshot& /* s */) -> bool override;
-
-        /// Not implemented for locking shard.
-        /// \return nullptr.
+        /// Reads one chunk of a snapshot file to send to another node.
+        /// \param s metadata of snapshot to read.
+        /// \param user_snp_ctx unused.
+        /// \param obj_id ID of the snapshot object to read.
+        /// \param data_out buffer in which to write the snapshot object.
+        /// \param is_last_obj set to true if this object ID is the last
+        ///                    snapshot object.
+        /// \return 0 if the object was read successfully.
+        [[nodiscard]] auto
+        read_logical_snp_obj(nuraft::snapshot& s,
+                             void*& user_snp_ctx,
+                             nuraft::ulong obj_id,
+                             nuraft::ptr<nuraft::buffer>& data_out,
+                             bool& is_last_obj) -> int override;
+
+        /// Saves one chunk of a snapshot file received from another node.
+        /// \param s metadata of snapshot to save.
+        /// \param obj_id ID of the snapshot object to save. Incremented to
+        ///               request the next object.
+        /// \param data snapshot object data.
+        /// \param is_first_obj true if this object ID is the first snapshot
+        ///                     object.
+        /// \param is_last_obj true if this object ID is the last snapshot
+        ///                    object.
+        void save_logical_snp_obj(nuraft::snapshot& s,
+                                  nuraft::ulong& obj_id,
+                                  nuraft::buffer& data,
+                                  bool is_first_obj,
+                                  bool is_last_obj) override;
+
+        /// Replaces the locking shard's state with the snapshot referenced
+        /// by the given metadata. The completed TX cache is kept, as
+        /// confirmed TX IDs are also held by the cold tier.
+        /// \param s snapshot metadata.
+        /// \return true if the snapshot was loaded and applied.
+        auto apply_snapshot(nuraft::snapshot& s) -> bool override;
+
+        /// Returns the most recent snapshot metadata.
+        /// \return snapshot metadata, or nullptr if there is no snapshot.
         auto last_snapshot() -> nuraft::ptr<nuraft::snapshot> override;
 
         /// Returns the most recently committed log entry index.
         /// \return log entry index.
         auto last_commit_index() -> uint64_t override;
 
-        /// Not implemented for locking shard.
+        /// Creates a snapshot with the given metadata. The first snapshot
+        /// holds the whole unspent set and later ones hold only the changes
+        /// since the previous snapshot.
+        /// \param s snapshot metadata.
+        /// \param when_done function to call when snapshot creation is
+        ///                  complete.
         void create_snapshot(
-            nuraft::snapshot& /* s */,
-            nuraft::async_result<bool>::handler_type& /* when_done */)
-            override;
+            nuraft::snapshot& s,
+            nuraft::async_result<bool>::handler_type& when_done) override;
+
+        /// Sets the function to call each time the last commit index
+        /// advances, once the entry at the new index has been applied. Must
+        /// be set before the raft node starts committing entries.
+        /// \param listener function to call after each commit.
+        void set_commit_listener(std::function<void()> listener);
 
         /// Returns a pointer to the locking shard instance managed by this
         /// state machine.
@@ -79,20 +139,24 @@ namespace cbdc::locking_shard {
       private:
         auto process_request(cbdc::locking_shard::rpc::request req)
             -> cbdc::locking_shard::rpc::response;
+        void maybe_export_uhs(uint64_t log_idx);
+        void set_applied(uint64_t log_idx);
 
         std::atomic<uint64_t> m_last_committed_idx{0};
-        nuraft::ptr<nuraft::snapshot> m_snapshot{};
-        std::shared_mutex m_snapshots_mut{};
-
-        nuraft::ptr<nuraft::snapshot> m_tmp_snapshot{};
-        std::mutex m_tmp_mut{};
+        std::function<void()> m_commit_listener;
 
         std::shared_ptr<cbdc::locking_shard::locking_shard> m_shard{};
         std::pair<uint8_t, uint8_t> m_output_range{};
         std::string m_snapshot_dir{};
         std::string m_db_dir{};
+        std::string m_uhs_export_prefix{};
+        uint64_t m_uhs_export_interval{};
 
         std::shared_ptr<logging::log> m_logger;
+
+        /// Incremental snapshot files, or nullptr if snapshots are
+        /// disabled.
+        std::unique_ptr<snapshot_store> m_snapshots;
     };
 }
 
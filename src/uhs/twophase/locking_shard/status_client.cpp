@@ -13,10 +13,10 @@ namespace cbdc::locking_shard::rpc {
             shard_read_only_endpoints,
         std::vector<config::shard_range_t> shard_ranges,
         std::chrono::milliseconds timeout)
-        : m_shard_ranges(std::move(shard_ranges)),
+        : m_prefix_map(shard_ranges),
           m_request_timeout(timeout) {
-        assert(m_shard_ranges.size() == shard_read_only_endpoints.size());
-        m_shard_clients.reserve(m_shard_ranges.size());
+        assert(shard_ranges.size() == shard_read_only_endpoints.size());
+        m_shard_clients.reserve(shard_ranges.size());
         for(auto& cluster : shard_read_only_endpoints) {
             m_shard_clients.emplace_back(
                 std::make_unique<
@@ -43,4 +43,15 @@ namespace cbdc::locking_shard::rpc {
         -> std::optional<bool> {
         return make_request<uhs_status_request>(uhs_id);
     }
+
+    auto status_client::check_unspent_batch(
+        const std::vector<hash_t>& uhs_ids)
+        -> std::optional<std::vector<bool>> {
+        return make_batch_request<uhs_status_batch_request>(uhs_ids);
+    }
+
+    auto status_client::check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+        -> std::optional<std::vector<bool>> {
+        return make_batch_request<tx_status_batch_request>(tx_ids);
+    }
 }
@@ -9,8 +9,11 @@
 #include "status_interface.hpp"
 #include "status_messages.hpp"
 #include "util/common/config.hpp"
+#include "util/common/shard_prefix_map.hpp"
 #include "util/rpc/tcp_client.hpp"
 
+#include <future>
+
 namespace cbdc::locking_shard::rpc {
     /// Client for interacting with the read-only port on 2PC shards. Allows
     /// for checking whether a TX ID has been confirmed or whether a UHS ID
@@ -62,22 +65,116 @@ namespace cbdc::locking_shard::rpc {
         [[nodiscard]] auto check_tx_id(const hash_t& tx_id)
             -> std::optional<bool> override;
 
+        /// Queries whether each of the given UHS IDs is unspent, with one
+        /// concurrent request per shard cluster responsible for any of them.
+        /// \param uhs_ids UHS IDs to query.
+        /// \return one flag per UHS ID in the same order, or std::nullopt
+        ///         if any request failed.
+        [[nodiscard]] auto
+        check_unspent_batch(const std::vector<hash_t>& uhs_ids)
+            -> std::optional<std::vector<bool>> override;
+
+        /// Queries whether each of the given TX IDs is confirmed, with one
+        /// concurrent request per shard cluster responsible for any of them.
+        /// \param tx_ids TX IDs to query.
+        /// \return one flag per TX ID in the same order, or std::nullopt if
+        ///         any request failed.
+        [[nodiscard]] auto check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+            -> std::optional<std::vector<bool>> override;
+
       private:
         std::vector<std::unique_ptr<
             cbdc::rpc::tcp_client<status_request, status_response>>>
             m_shard_clients;
-        std::vector<config::shard_range_t> m_shard_ranges;
+        shard_prefix_map m_prefix_map;
         std::chrono::milliseconds m_request_timeout;
 
         template<typename T>
         auto make_request(const hash_t& val) -> std::optional<bool> {
-            // TODO: optimize the algorithm for shard selection.
-            for(size_t i = 0; i < m_shard_ranges.size(); i++) {
-                if(config::hash_in_shard_range(m_shard_ranges[i], val)) {
-                    return m_shard_clients[i]->call(T{val}, m_request_timeout);
+            const auto& shards = m_prefix_map.shards(val);
+            if(shards.empty()) {
+                return std::nullopt;
+            }
+            auto& client = m_shard_clients[shards.front()];
+            auto res = client->call(T{val}, m_request_timeout);
+            if(!res.has_value()
+               || !std::holds_alternative<bool>(res.value())) {
+                return std::nullopt;
+            }
+            return std::get<bool>(res.value());
+        }
+
+        template<typename T>
+        auto make_batch_request(const std::vector<hash_t>& vals)
+            -> std::optional<std::vector<bool>> {
+            auto ret = std::vector<bool>(vals.size());
+            const auto shard_count = m_prefix_map.shard_count();
+            auto per_shard = std::vector<T>(shard_count);
+            auto positions = std::vector<std::vector<size_t>>(shard_count);
+            for(size_t j = 0; j < vals.size(); j++) {
+                const auto& shards = m_prefix_map.shards(vals[j]);
+                if(shards.empty()) {
+                    return std::nullopt;
+                }
+                auto i = shards.front();
+                batch_ids(per_shard[i]).push_back(vals[j]);
+                positions[i].push_back(j);
+            }
+            // Query the shards concurrently, then gather the responses
+            using response_promise
+                = std::promise<std::optional<status_response>>;
+            auto pending = std::vector<std::shared_ptr<response_promise>>(
+                shard_count);
+            for(size_t i = 0; i < shard_count; i++) {
+                if(positions[i].empty()) {
+                    continue;
+                }
+                auto p = std::make_shared<response_promise>();
+                pending[i] = p;
+                auto sent = m_shard_clients[i]->call(
+                    std::move(per_shard[i]),
+                    [p](std::optional<status_response> res) {
+                        p->set_value(std::move(res));
+                    });
+                if(!sent) {
+                    return std::nullopt;
                 }
             }
-            return std::nullopt;
+            for(size_t i = 0; i < shard_count; i++) {
+                if(!pending[i]) {
+                    continue;
+                }
+                auto fut = pending[i]->get_future();
+                if(m_request_timeout != std::chrono::milliseconds::zero()
+                   && fut.wait_for(m_request_timeout)
+                          == std::future_status::timeout) {
+                    return std::nullopt;
+                }
+                auto res = fut.get();
+                if(!res.has_value()) {
+                    return std::nullopt;
+                }
+                auto* statuses
+                    = std::get_if<status_batch_response>(&res.value());
+                if(statuses == nullptr
+                   || statuses->m_statuses.size() != positions[i].size()) {
+                    return std::nullopt;
+                }
+                for(size_t k = 0; k < positions[i].size(); k++) {
+                    ret[positions[i][k]] = statuses->m_statuses[k];
+                }
+            }
+            return ret;
+        }
+
+        static auto batch_ids(uhs_status_batch_request& req)
+            -> std::vector<hash_t>& {
+            return req.m_uhs_ids;
+        }
+
+        static auto batch_ids(tx_status_batch_request& req)
+            -> std::vector<hash_t>& {
+            return req.m_tx_ids;
         }
     };
 }
@@ -10,6 +10,7 @@
 
 #include <optional>
 #include <variant>
+#include <vector>
 
 namespace cbdc::locking_shard {
     /// Interface for querying the read-only state of a locking shard. Returns
@@ -38,6 +39,23 @@ namespace cbdc::locking_shard {
         ///         if the query failed.
         [[nodiscard]] virtual auto check_tx_id(const hash_t& tx_id)
             -> std::optional<bool> = 0;
+
+        /// Queries whether the shard's UHS contains each of the given UHS
+        /// IDs.
+        /// \param uhs_ids UHS IDs to query.
+        /// \return one flag per UHS ID in the same order, true if the UHS
+        ///         ID is unspent, or std::nullopt if the query failed.
+        [[nodiscard]] virtual auto
+        check_unspent_batch(const std::vector<hash_t>& uhs_ids)
+            -> std::optional<std::vector<bool>> = 0;
+
+        /// Queries whether each of the given TX IDs is confirmed.
+        /// \param tx_ids TX IDs to query.
+        /// \return one flag per TX ID in the same order, true if the TX ID
+        ///         is confirmed, or std::nullopt if the query failed.
+        [[nodiscard]] virtual auto
+        check_tx_id_batch(const std::vector<hash_t>& tx_ids)
+            -> std::optional<std::vector<bool>> = 0;
     };
 }
 
@@ -9,27 +9,92 @@
 #include "util/common/hash.hpp"
 
 #include <variant>
+#include <vector>
 
 namespace cbdc::locking_shard::rpc {
     /// RPC message for clients to use to request the status of a UHS ID.
     struct uhs_status_request {
         /// UHS ID to check.
         hash_t m_uhs_id{};
+
+        auto operator==(const uhs_status_request& rhs) const -> bool {
+            return m_uhs_id == rhs.m_uhs_id;
+        }
     };
 
     /// RPC message for clients to use to request the status of a TX ID.
     struct tx_status_request {
         /// TX ID to check.
         hash_t m_tx_id{};
+
+        auto operator==(const tx_status_request& rhs) const -> bool {
+            return m_tx_id == rhs.m_tx_id;
+        }
+    };
+
+    /// RPC message for clients to use to request the status of many UHS
+    /// IDs in one round trip.
+    struct uhs_status_batch_request {
+        /// UHS IDs to check. All must be in the receiving shard's range.
+        std::vector<hash_t> m_uhs_ids;
+
+        auto operator==(const uhs_status_batch_request& rhs) const -> bool {
+            return m_uhs_ids == rhs.m_uhs_ids;
+        }
+    };
+
+    /// RPC message for clients to use to request the status of many TX IDs
+    /// in one round trip.
+    struct tx_status_batch_request {
+        /// TX IDs to check. All must be in the receiving shard's range.
+        std::vector<hash_t> m_tx_ids;
+
+        auto operator==(const tx_status_batch_request& rhs) const -> bool {
+            return m_tx_ids == rhs.m_tx_ids;
+        }
     };
 
-    /// Status request RPC message wrapper, holding either a UHS ID or TX ID
-    /// query request.
-    using status_request = std::variant<uhs_status_request, tx_status_request>;
+    /// RPC message for shard replicas to use to request the leader's
+    /// commit index before serving a status query.
+    struct read_index_request {
+        auto operator==(const read_index_request& /* rhs */) const -> bool {
+            return true;
+        }
+    };
+
+    /// Status request RPC message wrapper, holding a single or batched UHS
+    /// ID or TX ID query request, or a replica's read index request.
+    using status_request = std::variant<uhs_status_request,
+                                        tx_status_request,
+                                        uhs_status_batch_request,
+                                        tx_status_batch_request,
+                                        read_index_request>;
+
+    /// Response to a batched status request, serialized as a bitmap.
+    struct status_batch_response {
+        /// One flag per requested ID, in request order.
+        std::vector<bool> m_statuses;
+
+        auto operator==(const status_batch_response& rhs) const -> bool {
+            return m_statuses == rhs.m_statuses;
+        }
+    };
+
+    /// Response to a read index request from the shard cluster leader.
+    struct read_index_response {
+        /// Index up to which the leader has committed log entries.
+        uint64_t m_commit_idx{};
+
+        auto operator==(const read_index_response& rhs) const -> bool {
+            return m_commit_idx == rhs.m_commit_idx;
+        }
+    };
 
     /// Status response RPC messages indicating whether the shard contains
-    /// given UHS or TX ID.
-    using status_response = bool;
+    /// the given UHS or TX ID, or each of a batch of IDs, or the leader's
+    /// read index.
+    using status_response
+        = std::variant<bool, status_batch_response, read_index_response>;
 }
 
 #endif
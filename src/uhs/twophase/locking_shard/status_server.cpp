@@ -11,8 +11,10 @@ namespace cbdc::locking_shard::rpc {
     status_server::status_server(
         std::shared_ptr<status_interface> impl,
         std::unique_ptr<
-            cbdc::rpc::blocking_server<status_request, status_response>> srv)
+            cbdc::rpc::blocking_server<status_request, status_response>> srv,
+        std::shared_ptr<raft::node> raft)
         : m_impl(std::move(impl)),
+          m_raft(std::move(raft)),
           m_srv(std::move(srv)) {
         m_srv->register_handler_callback([&](status_request req) {
             return request_handler(req);
@@ -21,13 +23,45 @@ namespace cbdc::locking_shard::rpc {
 
     auto status_server::request_handler(status_request req)
         -> std::optional<status_response> {
-        return std::visit(overloaded{[&](const uhs_status_request& r) {
-                                         return m_impl->check_unspent(
-                                             r.m_uhs_id);
-                                     },
-                                     [&](const tx_status_request& r) {
-                                         return m_impl->check_tx_id(r.m_tx_id);
-                                     }},
-                          req);
+        auto single = [](std::optional<bool> res)
+            -> std::optional<status_response> {
+            if(!res.has_value()) {
+                return std::nullopt;
+            }
+            return res.value();
+        };
+        auto batch = [](std::optional<std::vector<bool>> res)
+            -> std::optional<status_response> {
+            if(!res.has_value()) {
+                return std::nullopt;
+            }
+            return status_batch_response{std::move(res.value())};
+        };
+        return std::visit(
+            overloaded{[&](const uhs_status_request& r) {
+                           return single(m_impl->check_unspent(r.m_uhs_id));
+                       },
+                       [&](const tx_status_request& r) {
+                           return single(m_impl->check_tx_id(r.m_tx_id));
+                       },
+                       [&](const uhs_status_batch_request& r) {
+                           return batch(
+                               m_impl->check_unspent_batch(r.m_uhs_ids));
+                       },
+                       [&](const tx_status_batch_request& r) {
+                           return batch(m_impl->check_tx_id_batch(r.m_tx_ids));
+                       },
+                       [&](const read_index_request& /* r */)
+                           -> std::optional<status_response> {
+                           if(!m_raft) {
+                               return std::nullopt;
+                           }
+                           auto idx = m_raft->read_index();
+                           if(!idx.has_value()) {
+                               return std::nullopt;
+                           }
+                           return read_index_response{idx.value()};
+                       }},
+            req);
     }
 }
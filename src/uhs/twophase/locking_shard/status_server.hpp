@@ -8,6 +8,7 @@
 
 #include "status_interface.hpp"
 #include "status_messages.hpp"
+#include "util/raft/node.hpp"
 #include "util/rpc/blocking_server.hpp"
 
 #include <memory>
@@ -20,13 +21,18 @@ namespace cbdc::locking_shard::rpc {
         /// \param impl pointer to an implementation of the locking shard status
         ///             interface.
         /// \param srv pointer to an initialized RPC server which is ready to accept requests.
+        /// \param raft raft node of the shard replica, which answers read
+        ///             index requests from the other replicas while it
+        ///             leads the cluster. Null to refuse them.
         status_server(
             std::shared_ptr<status_interface> impl,
             std::unique_ptr<cbdc::rpc::blocking_server<status_request,
-                                                       status_response>> srv);
+                                                       status_response>> srv,
+            std::shared_ptr<raft::node> raft = nullptr);
 
       private:
         std::shared_ptr<status_interface> m_impl;
+        std::shared_ptr<raft::node> m_raft;
         std::unique_ptr<
             cbdc::rpc::blocking_server<status_request, status_response>>
             m_srv;
@@ -6,37 +6,108 @@
 #include "controller.hpp"
 
 #include "uhs/twophase/coordinator/format.hpp"
+#include "util/common/affinity.hpp"
+#include "util/common/metrics.hpp"
+#include "util/common/tracing.hpp"
+#include "util/persistence/factory.hpp"
 #include "util/rpc/tcp_server.hpp"
 #include "util/serialization/util.hpp"
 
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
 #include <utility>
-#include "oracleDB.h"
 
+namespace cbdc::sentinel_2pc {
+    namespace {
+        auto validate_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "sentinel_validate_seconds",
+                    "Time to validate and attest a transaction locally.");
+            return hist;
+        }
 
-OracleDB db;
+        auto rejected_txs() -> metrics::counter& {
+            static auto& ctr = metrics::registry::global().get_counter(
+                "sentinel_rejected_total",
+                "Transactions which failed static validation.");
+            return ctr;
+        }
+
+        /// Coordinator clusters the sentinel sends transactions to: all of
+        /// them when routing by transaction, otherwise just the one picked
+        /// by sentinel ID.
+        auto coordinator_clusters(uint32_t sentinel_id,
+                                  const config::options& opts)
+            -> std::vector<std::vector<network::endpoint_t>> {
+            if(opts.m_sentinel_coordinator_routing) {
+                return opts.m_coordinator_endpoints;
+            }
+            return {opts.m_coordinator_endpoints
+                        [sentinel_id
+                         % static_cast<uint32_t>(
+                             opts.m_coordinator_endpoints.size())]};
+        }
+
+        auto coordinator_client_options(const config::options& opts)
+            -> cbdc::rpc::tcp_client_options {
+            auto ret = cbdc::rpc::tcp_client_options();
+            ret.m_max_in_flight = opts.m_sentinel_coordinator_max_in_flight;
+            ret.m_request_timeout = std::chrono::milliseconds(
+                opts.m_sentinel_coordinator_timeout_ms);
+            return ret;
+        }
+    }
 
-namespace cbdc::sentinel_2pc {
     controller::controller(uint32_t sentinel_id,
                            const config::options& opts,
                            std::shared_ptr<logging::log> logger)
         : m_sentinel_id(sentinel_id),
           m_opts(opts),
           m_logger(std::move(logger)),
-          m_coordinator_client(
-              opts.m_coordinator_endpoints[sentinel_id
-                                           % static_cast<uint32_t>(
-                                               opts.m_coordinator_endpoints
-                                                   .size())]) 
+          m_coordinators(coordinator_clusters(sentinel_id, opts),
+                         m_logger,
+                         coordinator_client_options(opts)),
+          m_persistence(m_logger,
+                        persistence::make_sink(opts,
+                                               m_logger,
+                                               "admin.sentinel",
+                                               {"tx_hash"}),
+                        opts.m_oracle_queue_high_water_mark,
+                        opts.m_oracle_batch_size,
+                        persistence::make_retry_policy(opts)),
+          m_recent_txs(opts.m_sentinel_dedupe_cache_size) {
+        if(!m_persistence.start()) {
+            m_logger->warn("Sentinel audit records will not be persisted");
+        }
+    }
+
+    controller::~controller() {
+        m_validation_queue.clear();
+        for(auto& t : m_validation_threads) {
+            if(t.joinable()) {
+                t.join();
+            }
+        }
         {
-            // Connecting to Oracle Autonomous Database
-            if (OracleDB_init(&db) == 0) {
-                if (OracleDB_connect(&db) == 0) {
-                    m_logger->info("Connected to Oracle Autonomous Database");
-                } else {
-                    m_logger->error("Failed to connect to Oracle Autonomous Database");
-                }
-            }   
+            std::unique_lock<std::mutex> l(m_batch_mut);
+            m_running = false;
+        }
+        {
+            // Wakes the attestation thread only after m_running is seen
+            std::unique_lock<std::mutex> l(m_attestation_mut);
+        }
+        m_attestation_cv.notify_all();
+        if(m_attestation_thread.joinable()) {
+            m_attestation_thread.join();
         }
+        m_batch_cv.notify_all();
+        if(m_batch_thread.joinable()) {
+            m_batch_thread.join();
+        }
+    }
 
     auto controller::init() -> bool {
         if(m_opts.m_sentinel_endpoints.empty()) {
@@ -59,13 +130,28 @@ namespace cbdc::sentinel_2pc {
         } else {
             m_privkey = skey->second;
 
-            auto pubkey = pubkey_from_privkey(m_privkey, m_secp.get());
+            auto pubkey = pubkey_from_privkey(m_privkey, secp_context().get());
             m_logger->info("Sentinel public key:", cbdc::to_string(pubkey));
         }
+        m_sentinel_keys
+            = transaction::sorted_sentinel_keys(m_opts.m_sentinel_public_keys);
+
+        if(m_sentinel_id < m_opts.m_sentinel_capture_paths.size()) {
+            const auto& path = m_opts.m_sentinel_capture_paths[m_sentinel_id];
+            if(path.has_value()) {
+                m_capture = std::make_unique<cbdc::sentinel::trace_writer>(
+                    path.value());
+                if(!m_capture->good()) {
+                    m_logger->error("Failed to open capture file", *path);
+                    return false;
+                }
+                m_logger->info("Capturing transactions to", *path);
+            }
+        }
 
         auto retry_delay = std::chrono::seconds(1);
         auto retry_threshold = 4;
-        while(!m_coordinator_client.init() && retry_threshold-- > 0) {
+        while(!m_coordinators.init() && retry_threshold-- > 0) {
             m_logger->warn("Failed to start coordinator client.");
 
             std::this_thread::sleep_for(retry_delay);
@@ -75,6 +161,21 @@ namespace cbdc::sentinel_2pc {
             }
         }
 
+        m_batch_thread = std::thread([&]() {
+            batch_loop();
+        });
+
+        const auto n_validation_threads
+            = m_opts.m_sentinel_validation_threads > 0
+                ? m_opts.m_sentinel_validation_threads
+                : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        for(size_t i{0}; i < n_validation_threads; i++) {
+            m_validation_threads.emplace_back([&]() {
+                pin_current_thread(thread_role::executor);
+                validation_loop();
+            });
+        }
+
         for(const auto& ep : m_opts.m_sentinel_endpoints) {
             if(ep == m_opts.m_sentinel_endpoints[m_sentinel_id]) {
                 continue;
@@ -87,11 +188,10 @@ namespace cbdc::sentinel_2pc {
             }
             m_sentinel_clients.emplace_back(std::move(client));
         }
-
-        constexpr size_t dist_lower_bound = 0;
-        const size_t dist_upper_bound
-            = m_sentinel_clients.empty() ? 0 : m_sentinel_clients.size() - 1;
-        m_dist = decltype(m_dist)(dist_lower_bound, dist_upper_bound);
+        m_attestation_queues.resize(m_sentinel_clients.size());
+        m_attestation_thread = std::thread([&]() {
+            attestation_loop();
+        });
 
         auto rpc_server = std::make_unique<cbdc::rpc::tcp_server<
             cbdc::rpc::async_server<cbdc::sentinel::request,
@@ -109,33 +209,165 @@ namespace cbdc::sentinel_2pc {
         return true;
     }
 
+    void controller::validation_loop() {
+        // Signing only reads the context, so the threads share one
+        auto* secp = secp_context().get();
+        auto task = validation_task();
+        while(m_validation_queue.pop(task)) {
+            task(secp);
+        }
+    }
+
     auto controller::execute_transaction(
         transaction::full_tx tx,
         execute_result_callback_type result_callback) -> bool {
+        if(m_capture) {
+            m_capture->append(tx);
+        }
+        // A client retrying a transaction shares the result of the earlier
+        // submission rather than starting another round of 2PC
+        auto id = transaction::tx_id(tx);
+        if(m_recent_txs.submit(id, result_callback)
+           != dedupe_cache<sentinel::execute_response>::status::first) {
+            return true;
+        }
+        queue_transaction(std::move(tx),
+                          id,
+                          std::move(result_callback),
+                          nullptr);
+        return true;
+    }
+
+    auto
+    controller::submit_transaction(transaction::full_tx tx,
+                                   submit_result_callback_type result_callback)
+        -> bool {
+        if(m_capture) {
+            m_capture->append(tx);
+        }
+        auto id = transaction::tx_id(tx);
+        auto known = m_recent_txs.claim(id);
+        if(known.has_value()) {
+            result_callback(cbdc::sentinel::submit_response{
+                id,
+                known->value_or(pending_response())});
+            return true;
+        }
+        queue_transaction(
+            std::move(tx),
+            id,
+            [](const std::optional<cbdc::sentinel::execute_response>&) {},
+            [id, cb = std::move(result_callback)](
+                cbdc::sentinel::execute_response res) {
+                cb(cbdc::sentinel::submit_response{id, std::move(res)});
+            });
+        return true;
+    }
+
+    auto
+    controller::transaction_status(std::vector<hash_t> tx_ids,
+                                   status_result_callback_type result_callback)
+        -> bool {
+        auto ret = cbdc::sentinel::status_response();
+        ret.reserve(tx_ids.size());
+        for(const auto& id : tx_ids) {
+            auto known = m_recent_txs.find(id);
+            if(!known.has_value()) {
+                ret.emplace_back(std::nullopt);
+                continue;
+            }
+            ret.emplace_back(known->value_or(pending_response()));
+        }
+        result_callback(std::move(ret));
+        return true;
+    }
+
+    auto controller::pending_response() -> cbdc::sentinel::execute_response {
+        return {cbdc::sentinel::tx_status::pending, std::nullopt};
+    }
+
+    void
+    controller::queue_transaction(transaction::full_tx tx,
+                                  const hash_t& id,
+                                  execute_result_callback_type result_callback,
+                                  accept_callback_type accept_callback) {
+        result_callback
+            = [&, id, cb = std::move(result_callback)](
+                  std::optional<cbdc::sentinel::execute_response> res) {
+                  m_recent_txs.finish(id, res);
+                  cb(std::move(res));
+              };
+
+        // Continue the client's trace, or sample a new one
+        auto parent = tracing::current();
+        if(!parent.has_value()) {
+            parent = tracing::maybe_start_trace();
+        }
+        auto trace = tracing::make_shared_span("sentinel.execute", parent);
+        if(trace) {
+            result_callback
+                = [trace, cb = std::move(result_callback)](
+                      std::optional<cbdc::sentinel::execute_response> res) {
+                      trace->finish();
+                      cb(std::move(res));
+                  };
+        }
+        // Each task runs once, so it hands its transaction and callback on
+        // rather than copying them
+        m_validation_queue.push([&,
+                                 t = std::move(tx),
+                                 cb = std::move(result_callback),
+                                 accept = std::move(accept_callback),
+                                 trace](secp256k1_context* secp) mutable {
+            auto c = tracing::scoped_context(tracing::context_of(trace));
+            execute_validated(std::move(t), std::move(cb), accept, secp);
+        });
+    }
+
+    void controller::execute_validated(
+        transaction::full_tx tx,
+        execute_result_callback_type result_callback,
+        const accept_callback_type& accept_callback,
+        secp256k1_context* secp) {
+        auto span = tracing::span("sentinel.validate");
+        const auto start = std::chrono::steady_clock::now();
         const auto validation_err = transaction::validation::check_tx(tx);
         if(validation_err.has_value()) {
+            validate_latency().record(std::chrono::steady_clock::now()
+                                      - start);
+            rejected_txs().add();
+            span.finish();
             auto tx_id = transaction::tx_id(tx);
             m_logger->debug(
                 "Rejected (",
                 transaction::validation::to_string(validation_err.value()),
                 ")",
                 to_string(tx_id));
-            result_callback(cbdc::sentinel::execute_response{
+            auto res = cbdc::sentinel::execute_response{
                 cbdc::sentinel::tx_status::static_invalid,
-                validation_err});
-            return true;
+                validation_err};
+            if(accept_callback) {
+                accept_callback(res);
+            }
+            result_callback(std::move(res));
+            return;
+        }
+        if(accept_callback) {
+            accept_callback(pending_response());
         }
 
         auto compact_tx = cbdc::transaction::compact_tx(tx);
 
         if(m_opts.m_attestation_threshold > 0) {
-            auto attestation = compact_tx.sign(m_secp.get(), m_privkey);
+            auto attestation = compact_tx.sign(secp, m_privkey);
             compact_tx.m_attestations.insert(attestation);
         }
+        validate_latency().record(std::chrono::steady_clock::now() - start);
+        span.finish();
 
-        gather_attestations(tx, std::move(result_callback), compact_tx, {});
-
-        return true;
+        gather_attestations(tx,
+                            std::move(result_callback),
+                            std::move(compact_tx));
     }
 
     void
@@ -157,105 +389,443 @@ namespace cbdc::sentinel_2pc {
     auto controller::validate_transaction(
         transaction::full_tx tx,
         validate_result_callback_type result_callback) -> bool {
+        m_validation_queue.push(
+            [&,
+             t = std::move(tx),
+             cb = std::move(result_callback),
+             trace = tracing::current()](secp256k1_context* secp) mutable {
+                auto c = tracing::scoped_context(trace);
+                validate_and_sign(t, std::move(cb), secp);
+            });
+        return true;
+    }
+
+    void controller::validate_and_sign(
+        const transaction::full_tx& tx,
+        validate_result_callback_type result_callback,
+        secp256k1_context* secp) {
+        auto span = tracing::span("sentinel.validate");
+        const auto start = std::chrono::steady_clock::now();
         const auto validation_err = transaction::validation::check_tx(tx);
         if(validation_err.has_value()) {
+            validate_latency().record(std::chrono::steady_clock::now()
+                                      - start);
+            rejected_txs().add();
+            span.finish();
             result_callback(std::nullopt);
-            return true;
+            return;
         }
         auto compact_tx = cbdc::transaction::compact_tx(tx);
-        auto attestation = compact_tx.sign(m_secp.get(), m_privkey);
+        auto attestation = compact_tx.sign(secp, m_privkey);
+        validate_latency().record(std::chrono::steady_clock::now() - start);
+        span.finish();
         result_callback(std::move(attestation));
+    }
+
+    auto controller::validate_transactions(
+        std::vector<transaction::full_tx> txs,
+        validate_batch_result_callback_type result_callback) -> bool {
+        m_validation_queue.push(
+            [&,
+             t = std::move(txs),
+             cb = std::move(result_callback),
+             trace = tracing::current()](secp256k1_context* secp) {
+                auto c = tracing::scoped_context(trace);
+                auto res = cbdc::sentinel::validate_batch_response();
+                res.reserve(t.size());
+                for(const auto& tx : t) {
+                    validate_and_sign(
+                        tx,
+                        [&](validate_result v_res) {
+                            res.push_back(std::move(v_res));
+                        },
+                        secp);
+                }
+                cb(std::move(res));
+            });
         return true;
     }
 
-    void controller::validate_result_handler(
-        validate_result v_res,
+    void controller::gather_attestations(
         const transaction::full_tx& tx,
         execute_result_callback_type result_callback,
-        transaction::compact_tx ctx,
-        std::unordered_set<size_t> requested) {
-        if(!v_res.has_value()) {
-            m_logger->error(to_string(ctx.m_id),
-                            "invalid according to remote sentinel");
+        transaction::compact_tx ctx) {
+        if(ctx.m_attestations.size() >= m_opts.m_attestation_threshold) {
+            m_logger->debug("Accepted", to_string(ctx.m_id));
+            aggregate(ctx);
+            send_compact_tx(ctx, std::move(result_callback));
+            return;
+        }
+
+        const auto needed
+            = m_opts.m_attestation_threshold - ctx.m_attestations.size();
+        if(needed > m_sentinel_clients.size()) {
+            m_logger->error("Not enough peer sentinels to attest to",
+                            to_string(ctx.m_id));
             result_callback(std::nullopt);
             return;
         }
-        ctx.m_attestations.insert(std::move(v_res.value()));
-        gather_attestations(tx,
-                            std::move(result_callback),
-                            ctx,
-                            std::move(requested));
+
+        // Ask enough peers at once to reach the threshold, plus one more so
+        // a slow or failed peer does not hold up the transaction. Peers
+        // which fail are replaced from the remaining candidates.
+        static constexpr size_t hedged_requests{1};
+        thread_local auto rand = std::default_random_engine(
+            std::random_device()());
+        auto round = std::make_shared<attestation_round>();
+        round->m_tx = tx;
+        round->m_ctx = std::move(ctx);
+        round->m_cb = std::move(result_callback);
+        round->m_trace = tracing::current();
+        round->m_candidates.resize(m_sentinel_clients.size());
+        std::iota(round->m_candidates.begin(), round->m_candidates.end(), 0);
+        std::shuffle(round->m_candidates.begin(),
+                     round->m_candidates.end(),
+                     rand);
+        const auto n_requests
+            = std::min(needed + hedged_requests, round->m_candidates.size());
+        auto peers = std::vector<size_t>(
+            round->m_candidates.end()
+                - static_cast<std::ptrdiff_t>(n_requests),
+            round->m_candidates.end());
+        round->m_candidates.resize(round->m_candidates.size() - n_requests);
+        round->m_outstanding = n_requests;
+        for(auto peer : peers) {
+            request_attestation(round, peer);
+        }
     }
 
-    void controller::gather_attestations(
-        const transaction::full_tx& tx,
-        execute_result_callback_type result_callback,
-        const transaction::compact_tx& ctx,
-        std::unordered_set<size_t> requested) {
-        if(ctx.m_attestations.size() < m_opts.m_attestation_threshold) {
-            auto success = false;
-            while(!success) {
-                auto sentinel_id = m_dist(m_rand);
-                if(requested.find(sentinel_id) != requested.end()) {
-                    continue;
+    void controller::request_attestation(
+        const std::shared_ptr<attestation_round>& r,
+        size_t peer) {
+        auto cb = std::function<void(peer_result)>([&, r](peer_result res) {
+            attestation_handler(r, std::move(res));
+        });
+        {
+            std::unique_lock<std::mutex> l(m_attestation_mut);
+            if(m_running) {
+                m_attestation_queues[peer].push_back({r->m_tx, std::move(cb)});
+                cb = nullptr;
+            }
+        }
+        if(cb) {
+            // Shutting down, so treat the peer as unreachable
+            cb(std::nullopt);
+            return;
+        }
+        m_attestation_cv.notify_one();
+    }
+
+    void
+    controller::attestation_handler(const std::shared_ptr<attestation_round>& r,
+                                    peer_result res) {
+        auto retry = std::optional<size_t>();
+        {
+            std::unique_lock<std::mutex> l(r->m_mut);
+            if(r->m_done) {
+                return;
+            }
+            r->m_outstanding--;
+            if(res.has_value() && res->has_value()) {
+                r->m_ctx.m_attestations.insert(std::move(res->value()));
+                if(r->m_ctx.m_attestations.size()
+                   < m_opts.m_attestation_threshold) {
+                    return;
                 }
-                success
-                    = m_sentinel_clients[sentinel_id]->validate_transaction(
-                        tx,
-                        [=](validate_result v_res) {
-                            auto r = requested;
-                            r.insert(sentinel_id);
-                            validate_result_handler(v_res,
-                                                    tx,
-                                                    result_callback,
-                                                    ctx,
-                                                    r);
-                        });
+                r->m_done = true;
+            } else if(res.has_value()) {
+                r->m_done = true;
+                l.unlock();
+                m_logger->error(to_string(r->m_ctx.m_id),
+                                "invalid according to remote sentinel");
+                r->m_cb(std::nullopt);
+                return;
+            } else if(!r->m_candidates.empty()) {
+                retry = r->m_candidates.back();
+                r->m_candidates.pop_back();
+                r->m_outstanding++;
+            } else if(r->m_outstanding == 0) {
+                r->m_done = true;
+                l.unlock();
+                m_logger->error("No peer sentinels attested to",
+                                to_string(r->m_ctx.m_id));
+                r->m_cb(std::nullopt);
+                return;
+            } else {
+                return;
             }
+        }
+        if(retry.has_value()) {
+            request_attestation(r, retry.value());
             return;
         }
 
-        m_logger->debug("Accepted", to_string(ctx.m_id));
+        // Responses arrive on the client's thread
+        auto c = tracing::scoped_context(r->m_trace);
+        m_logger->debug("Accepted", to_string(r->m_ctx.m_id));
+        aggregate(r->m_ctx);
+        send_compact_tx(r->m_ctx, std::move(r->m_cb));
+    }
 
-        send_compact_tx(ctx, std::move(result_callback));
+    void controller::attestation_loop() {
+        const auto max_size
+            = std::max<size_t>(m_opts.m_sentinel_batch_size, 1);
+        const auto linger = std::chrono::microseconds(
+            m_opts.m_sentinel_attestation_linger_us);
+        auto pending = [&]() {
+            return std::any_of(m_attestation_queues.begin(),
+                               m_attestation_queues.end(),
+                               [](const auto& q) {
+                                   return !q.empty();
+                               });
+        };
+        auto full = [&]() {
+            return std::any_of(m_attestation_queues.begin(),
+                               m_attestation_queues.end(),
+                               [&](const auto& q) {
+                                   return q.size() >= max_size;
+                               });
+        };
+        auto l = std::unique_lock<std::mutex>(m_attestation_mut);
+        while(true) {
+            m_attestation_cv.wait(l, [&]() {
+                return pending() || !m_running;
+            });
+            if(!pending()) {
+                break;
+            }
+            // Give concurrent transactions a chance to share each request
+            m_attestation_cv.wait_for(l, linger, [&]() {
+                return full() || !m_running;
+            });
+            auto queues = decltype(m_attestation_queues)(
+                m_attestation_queues.size());
+            queues.swap(m_attestation_queues);
+            l.unlock();
+            for(size_t peer{0}; peer < queues.size(); peer++) {
+                auto& q = queues[peer];
+                for(size_t i{0}; i < q.size(); i += max_size) {
+                    const auto first
+                        = q.begin() + static_cast<std::ptrdiff_t>(i);
+                    const auto last
+                        = q.begin()
+                        + static_cast<std::ptrdiff_t>(
+                              std::min(i + max_size, q.size()));
+                    send_attestation_batch(
+                        peer,
+                        std::vector<attestation_request>(
+                            std::make_move_iterator(first),
+                            std::make_move_iterator(last)));
+                }
+            }
+            l.lock();
+        }
+    }
+
+    void controller::send_attestation_batch(
+        size_t peer,
+        std::vector<attestation_request> batch) {
+        auto txs = std::vector<transaction::full_tx>();
+        auto cbs = std::vector<std::function<void(peer_result)>>();
+        txs.reserve(batch.size());
+        cbs.reserve(batch.size());
+        for(auto& req : batch) {
+            txs.push_back(std::move(req.m_tx));
+            cbs.push_back(std::move(req.m_cb));
+        }
+        auto shared_cbs = std::make_shared<decltype(cbs)>(std::move(cbs));
+        auto sent = m_sentinel_clients[peer]->validate_transactions(
+            std::move(txs),
+            [&, shared_cbs](
+                std::optional<cbdc::sentinel::validate_batch_response> res) {
+                if(res.has_value() && res->size() != shared_cbs->size()) {
+                    m_logger->error("Sentinel batch response has",
+                                    res->size(),
+                                    "results, expected",
+                                    shared_cbs->size());
+                    res.reset();
+                }
+                for(size_t i{0}; i < shared_cbs->size(); i++) {
+                    (*shared_cbs)[i](res.has_value()
+                                         ? peer_result((*res)[i])
+                                         : std::nullopt);
+                }
+            });
+        if(!sent) {
+            for(auto& cb : *shared_cbs) {
+                cb(std::nullopt);
+            }
+        }
+    }
+
+    void controller::aggregate(transaction::compact_tx& ctx) const {
+        if(!m_opts.m_sentinel_aggregate_attestations) {
+            return;
+        }
+        // Hedged requests can gather more attestations than needed, and
+        // an aggregate cannot be trimmed later
+        while(ctx.m_attestations.size() > m_opts.m_attestation_threshold) {
+            ctx.m_attestations.erase(ctx.m_attestations.begin());
+        }
+        auto agg = transaction::aggregate_attestations(secp_context().get(),
+                                                       ctx.hash(),
+                                                       ctx.m_attestations,
+                                                       m_sentinel_keys);
+        if(!agg.has_value()) {
+            m_logger->warn("Sending individual attestations for",
+                           to_string(ctx.m_id));
+            return;
+        }
+        ctx.m_attestations.clear();
+        ctx.m_aggregate = std::move(agg);
     }
 
     void
     controller::send_compact_tx(const transaction::compact_tx& ctx,
                                 execute_result_callback_type result_callback) {
-        auto cb =
-            [&, res_cb = std::move(result_callback)](std::optional<bool> res) {
-                result_handler(res, res_cb);
-            };
-
-        // TODO: add a "retry" error response to offload sentinels from this
-        //       infinite retry responsibility.
-        while(!m_coordinator_client.execute_transaction(ctx, cb)) {
-            // TODO: the network currently doesn't provide a callback for
-            //       reconnection events so we have to sleep here to
-            //       prevent a needless spin. Instead, add such a callback
-            //       or queue to the network to remove this sleep.
-            static constexpr auto retry_delay = std::chrono::milliseconds(100);
-            std::this_thread::sleep_for(retry_delay);
-        };
+        {
+            std::unique_lock<std::mutex> l(m_batch_mut);
+            // Callers include network threads, so a full queue fails the
+            // transaction rather than blocking them
+            if(m_batch.size()
+               >= std::max<size_t>(m_opts.m_sentinel_batch_max_queued, 1)) {
+                l.unlock();
+                m_logger->warn("Coordinator queue full, rejecting",
+                               to_string(ctx.m_id));
+                result_callback(std::nullopt);
+                return;
+            }
+            m_batch.push_back(queued_tx{ctx,
+                                        std::move(result_callback),
+                                        tracing::current(),
+                                        tracing::span("sentinel.batch_wait")});
+        }
+        m_batch_cv.notify_one();
+    }
 
-        // adding DTX to Oracle Autonomous Database
-        std::string dtx_string = std::string(ctx.m_id.begin(), ctx.m_id.end());
-        m_logger->info("DTX: " + std::string(ctx.m_id.begin(), ctx.m_id.end()));
-        std::string dtx_hex;
-        dtx_hex.reserve(2*dtx_string.size());
-
-        // convert dtx_string into a hex string
-        for (unsigned char c : dtx_string) {
-            dtx_hex.push_back("0123456789ABCDEF"[c >> 4]);
-            dtx_hex.push_back("0123456789ABCDEF"[c & 15]);
-        }
-        m_logger->info("DTX HEX: " + dtx_hex);
-        std::string dtx_hex_insert = "INSERT INTO admin.sentinel (tx_hash) VALUES ('" + dtx_hex + "')";
-        if(OracleDB_execute(&db, dtx_hex_insert.c_str()) == 0) {
-            m_logger->info("Inserted DTX Hex into shard_data");
-        } else {
-            m_logger->error("Failed to insert DTX Hex into shard_data");
+    void controller::batch_loop() {
+        const auto max_size
+            = std::max<size_t>(m_opts.m_sentinel_batch_size, 1);
+        const auto linger
+            = std::chrono::microseconds(m_opts.m_sentinel_batch_linger_us);
+        auto l = std::unique_lock<std::mutex>(m_batch_mut);
+        while(true) {
+            m_batch_cv.wait(l, [&]() {
+                return !m_batch.empty() || !m_running;
+            });
+            if(m_batch.empty()) {
+                break;
+            }
+            // Give concurrent requests a chance to share the RPC
+            m_batch_cv.wait_for(l, linger, [&]() {
+                return m_batch.size() >= max_size || !m_running;
+            });
+            auto batch = std::vector<queued_tx>();
+            if(m_batch.size() <= max_size) {
+                batch.swap(m_batch);
+            } else {
+                auto last = m_batch.begin()
+                          + static_cast<std::ptrdiff_t>(max_size);
+                batch.assign(std::make_move_iterator(m_batch.begin()),
+                             std::make_move_iterator(last));
+                m_batch.erase(m_batch.begin(), last);
+            }
+            l.unlock();
+            send_batch(std::move(batch));
+            l.lock();
         }
     }
+
+    void controller::send_batch(std::vector<queued_tx> batch) {
+        // The coordinator RPC is traced under the first sampled transaction
+        // in the batch
+        auto trace = std::optional<tracing::context>();
+        for(auto& q : batch) {
+            q.m_wait.finish();
+            if(!trace.has_value()) {
+                trace = q.m_trace;
+            }
+        }
+        auto c = tracing::scoped_context(trace);
+
+        // Transactions are grouped by coordinator cluster. Groups which
+        // fail to send are grouped again, letting the router steer them
+        // away from clusters which have become unavailable.
+        static constexpr auto reconnect_timeout = std::chrono::seconds(1);
+        auto pending = std::move(batch);
+        while(true) {
+            auto groups = std::map<size_t, std::vector<queued_tx>>();
+            for(auto& q : pending) {
+                groups[m_coordinators.pick(q.m_tx.m_id)].push_back(
+                    std::move(q));
+            }
+            pending.clear();
+            for(auto& [cluster, group] : groups) {
+                if(!send_group(cluster, group)) {
+                    pending.insert(pending.end(),
+                                   std::make_move_iterator(group.begin()),
+                                   std::make_move_iterator(group.end()));
+                    continue;
+                }
+                // Audit records are persisted off the RPC thread.
+                for(const auto& q : group) {
+                    m_persistence.push(q.m_tx.m_id);
+                }
+            }
+            if(pending.empty()) {
+                return;
+            }
+
+            // TODO: add a "retry" error response to offload sentinels from
+            //       this infinite retry responsibility.
+            if(!m_running) {
+                for(const auto& q : pending) {
+                    q.m_cb(std::nullopt);
+                }
+                return;
+            }
+            // Sending only fails when no coordinator node is connected, so
+            // wait for one to reconnect rather than spinning.
+            if(!m_coordinators.await_connection(reconnect_timeout)) {
+                m_logger->warn("Waiting for coordinator connection");
+            }
+        }
+    }
+
+    auto controller::send_group(size_t cluster,
+                                const std::vector<queued_tx>& group) -> bool {
+        if(group.size() == 1) {
+            return m_coordinators.execute_transaction(
+                cluster,
+                group.front().m_tx,
+                [&, res_cb = group.front().m_cb](std::optional<bool> res) {
+                    result_handler(res, res_cb);
+                });
+        }
+        auto txs = coordinator::rpc::batch_request();
+        auto cbs = std::vector<execute_result_callback_type>();
+        txs.reserve(group.size());
+        cbs.reserve(group.size());
+        for(const auto& q : group) {
+            txs.push_back(q.m_tx);
+            cbs.push_back(q.m_cb);
+        }
+        return m_coordinators.execute_transactions(
+            cluster,
+            std::move(txs),
+            [&, res_cbs = std::move(cbs)](
+                std::optional<coordinator::rpc::batch_response> res) {
+                if(res.has_value() && res->size() != res_cbs.size()) {
+                    m_logger->error("Coordinator batch response has",
+                                    res->size(),
+                                    "results, expected",
+                                    res_cbs.size());
+                    res.reset();
+                }
+                for(size_t i{0}; i < res_cbs.size(); i++) {
+                    result_handler(res.has_value() ? (*res)[i] : std::nullopt,
+                                   res_cbs[i]);
+                }
+            });
+    }
 }
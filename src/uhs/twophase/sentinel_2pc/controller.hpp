@@ -11,13 +11,20 @@
 #include "uhs/sentinel/async_interface.hpp"
 #include "uhs/sentinel/client.hpp"
 #include "uhs/sentinel/format.hpp"
+#include "uhs/sentinel/trace.hpp"
 #include "uhs/transaction/messages.hpp"
-#include "uhs/twophase/coordinator/client.hpp"
+#include "uhs/twophase/coordinator/router.hpp"
+#include "util/common/blocking_queue.hpp"
 #include "util/common/config.hpp"
+#include "util/common/dedupe_cache.hpp"
 #include "util/common/hashmap.hpp"
+#include "util/common/tracing.hpp"
 #include "util/network/connection_manager.hpp"
+#include "util/persistence/write_behind_queue.hpp"
 
-#include <random>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace cbdc::sentinel_2pc {
     /// Manages a sentinel server for the two-phase commit architecture.
@@ -37,26 +44,33 @@ namespace cbdc::sentinel_2pc {
                    const config::options& opts,
                    std::shared_ptr<logging::log> logger);
 
-        ~controller() override = default;
+        /// Destructor. Stops the validation threads, then the attestation
+        /// and coordinator batch threads, sending any requests they have
+        /// queued first.
+        ~controller() override;
 
-        /// Initializes the controller. Connects to the shard coordinator
-        /// network and launches a server thread for external clients.
+        /// Initializes the controller. Opens the capture file if
+        /// configured, starts the validation threads, connects to the shard
+        /// coordinator network and launches a server thread for external
+        /// clients.
         /// \return true if initialization succeeded.
         auto init() -> bool;
 
-        /// Statically validates a transaction, submits it the shard
-        /// coordinator network, and returns the result via a callback
-        /// function.
+        /// Queues a transaction to be statically validated on one of the
+        /// validation threads, then submitted to the shard coordinator
+        /// network. Returns the result via a callback function. A
+        /// transaction already processing, or among the recently processed,
+        /// shares the result of the earlier submission instead.
         /// \param tx transaction to submit.
         /// \param result_callback function to call with the execution result.
-        /// \return false if the sentinel was unable to forward the transaction
-        ///         to a coordinator.
+        /// \return true.
         auto execute_transaction(transaction::full_tx tx,
                                  execute_result_callback_type result_callback)
             -> bool override;
 
-        /// Statically validates a transaction and generates a sentinel
-        /// attestation if the transaction is valid.
+        /// Queues a transaction to be statically validated on one of the
+        /// validation threads, which generates a sentinel attestation if
+        /// the transaction is valid.
         /// \param tx transaction to validate.
         /// \param result_callback function to call with the attestation or
         ///                        std::nullopt if the transaction was invalid.
@@ -66,46 +80,167 @@ namespace cbdc::sentinel_2pc {
                              validate_result_callback_type result_callback)
             -> bool override;
 
+        /// Queues a batch of transactions to be statically validated and
+        /// attested to on one of the validation threads.
+        /// \param txs transactions to validate.
+        /// \param result_callback function to call with an attestation for
+        ///                        each valid transaction.
+        /// \return true.
+        auto validate_transactions(
+            std::vector<transaction::full_tx> txs,
+            validate_batch_result_callback_type result_callback)
+            -> bool override;
+
+        /// Queues a transaction to be statically validated on one of the
+        /// validation threads, then submitted to the shard coordinator
+        /// network without waiting for the execution result.
+        /// \param tx transaction to submit.
+        /// \param result_callback function to call with a pending status
+        ///                        once the transaction is valid, or with
+        ///                        its result if it is invalid or already
+        ///                        executed.
+        /// \return true.
+        auto submit_transaction(transaction::full_tx tx,
+                                submit_result_callback_type result_callback)
+            -> bool override;
+
+        /// Reports the status of transactions processing or among the
+        /// recently processed. Transactions whose execution result was
+        /// unknown, or which are no longer among the results kept, have no
+        /// status and should be resubmitted.
+        /// \param tx_ids IDs of the transactions.
+        /// \param result_callback function to call with the statuses.
+        /// \return true.
+        auto transaction_status(std::vector<hash_t> tx_ids,
+                                status_result_callback_type result_callback)
+            -> bool override;
+
       private:
+        /// Task run on a validation thread with the secp256k1 context.
+        using validation_task = std::function<void(secp256k1_context*)>;
+        /// Callback function for the status of a transaction once
+        /// statically validated.
+        using accept_callback_type
+            = std::function<void(cbdc::sentinel::execute_response)>;
+
+        void validation_loop();
+
+        static auto pending_response() -> cbdc::sentinel::execute_response;
+
+        void queue_transaction(transaction::full_tx tx,
+                               const hash_t& id,
+                               execute_result_callback_type result_callback,
+                               accept_callback_type accept_callback);
+
+        void execute_validated(transaction::full_tx tx,
+                               execute_result_callback_type result_callback,
+                               const accept_callback_type& accept_callback,
+                               secp256k1_context* secp);
+
+        void validate_and_sign(const transaction::full_tx& tx,
+                               validate_result_callback_type result_callback,
+                               secp256k1_context* secp);
+
         static void result_handler(std::optional<bool> res,
                                    const execute_result_callback_type& res_cb);
 
-        void
-        validate_result_handler(validate_result v_res,
-                                const transaction::full_tx& tx,
-                                execute_result_callback_type result_callback,
-                                transaction::compact_tx ctx,
-                                std::unordered_set<size_t> requested);
+        /// Attestations being gathered from peer sentinels for one
+        /// transaction.
+        struct attestation_round {
+            std::mutex m_mut;
+            transaction::full_tx m_tx;
+            transaction::compact_tx m_ctx;
+            execute_result_callback_type m_cb;
+            std::optional<tracing::context> m_trace;
+            /// Peers not yet asked, in the order to ask them.
+            std::vector<size_t> m_candidates;
+            /// Requests sent and not yet answered.
+            size_t m_outstanding{0};
+            /// Whether the round has finished, successfully or not.
+            bool m_done{false};
+        };
+
+        /// Result of asking a peer sentinel for an attestation:
+        /// std::nullopt if the peer did not reply.
+        using peer_result = std::optional<validate_result>;
+
+        /// Transaction waiting to be sent to a peer sentinel for attestation.
+        struct attestation_request {
+            transaction::full_tx m_tx;
+            std::function<void(peer_result)> m_cb;
+        };
 
         void gather_attestations(const transaction::full_tx& tx,
                                  execute_result_callback_type result_callback,
-                                 const transaction::compact_tx& ctx,
-                                 std::unordered_set<size_t> requested);
+                                 transaction::compact_tx ctx);
+        void request_attestation(const std::shared_ptr<attestation_round>& r,
+                                 size_t peer);
+        void attestation_handler(const std::shared_ptr<attestation_round>& r,
+                                 peer_result res);
+        void attestation_loop();
+        void send_attestation_batch(size_t peer,
+                                    std::vector<attestation_request> batch);
+
+        void aggregate(transaction::compact_tx& ctx) const;
 
         void send_compact_tx(const transaction::compact_tx& ctx,
                              execute_result_callback_type result_callback);
 
+        /// Compact transaction waiting to be sent to the coordinator.
+        struct queued_tx {
+            transaction::compact_tx m_tx;
+            execute_result_callback_type m_cb;
+            /// Trace context of the transaction, if sampled.
+            std::optional<tracing::context> m_trace;
+            /// Time spent waiting to be sent.
+            tracing::span m_wait;
+        };
+
+        void batch_loop();
+        void send_batch(std::vector<queued_tx> batch);
+        auto send_group(size_t cluster, const std::vector<queued_tx>& group)
+            -> bool;
+
         uint32_t m_sentinel_id;
         cbdc::config::options m_opts;
         std::shared_ptr<logging::log> m_logger;
 
         std::unique_ptr<cbdc::sentinel::rpc::async_server> m_rpc_server;
 
-        std::unique_ptr<secp256k1_context,
-                        decltype(&secp256k1_context_destroy)>
-            m_secp{secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
-                   &secp256k1_context_destroy};
-
-        coordinator::rpc::client m_coordinator_client;
+        coordinator::rpc::router m_coordinators;
 
         std::vector<std::unique_ptr<sentinel::rpc::client>>
             m_sentinel_clients{};
 
-        std::random_device m_r{};
-        std::default_random_engine m_rand{m_r()};
-        std::uniform_int_distribution<size_t> m_dist{};
-
         privkey_t m_privkey{};
+        /// Sentinel public keys in the order of aggregate signer bits.
+        std::vector<pubkey_t> m_sentinel_keys;
+
+        persistence::write_behind_queue m_persistence;
+
+        /// Records transactions from clients for replay, if enabled.
+        std::unique_ptr<cbdc::sentinel::trace_writer> m_capture;
+
+        /// Results of transactions processing or recently processed, keyed
+        /// by transaction ID.
+        dedupe_cache<sentinel::execute_response> m_recent_txs;
+
+        blocking_queue<validation_task> m_validation_queue;
+        std::vector<std::thread> m_validation_threads;
+
+        std::mutex m_batch_mut;
+        std::condition_variable m_batch_cv;
+        /// Transactions waiting to be sent to the coordinator. Holds at
+        /// most m_sentinel_batch_max_queued of them.
+        std::vector<queued_tx> m_batch;
+        std::atomic_bool m_running{true};
+        std::thread m_batch_thread;
+
+        std::mutex m_attestation_mut;
+        std::condition_variable m_attestation_cv;
+        /// Attestation requests waiting to be sent to each peer sentinel.
+        std::vector<std::vector<attestation_request>> m_attestation_queues;
+        std::thread m_attestation_thread;
     };
 }
 
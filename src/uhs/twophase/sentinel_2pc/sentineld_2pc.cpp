@@ -4,6 +4,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "controller.hpp"
+#include "util/common/affinity.hpp"
+#include "util/common/tracing.hpp"
+#include "util/network/io_loop.hpp"
+#include "util/rpc/http/metrics_server.hpp"
 
 #include <csignal>
 #include <unordered_map>
@@ -26,6 +30,12 @@ auto main(int argc, char** argv) -> int {
         return -1;
     }
     auto opts = std::get<cbdc::config::options>(cfg_or_err);
+    cbdc::network::io_loop::set_global_backend(opts.m_network_backend);
+    cbdc::network::set_local_transport(opts.m_local_transport);
+    cbdc::set_thread_cpus(opts.m_thread_cpus);
+    if(!cbdc::pin_current_thread(cbdc::thread_role::main)) {
+        std::cerr << "Failed to pin main thread to its CPUs" << std::endl;
+    }
 
     if(opts.m_sentinel_endpoints.size() <= sentinel_id) {
         std::cerr << "Sentinel ID not in config file" << std::endl;
@@ -34,6 +44,32 @@ auto main(int argc, char** argv) -> int {
 
     auto logger = std::make_shared<cbdc::logging::log>(
         opts.m_sentinel_loglevels[sentinel_id]);
+    if(opts.m_log_async_capacity > 0) {
+        logger->enable_async(opts.m_log_async_capacity, opts.m_log_overflow);
+    }
+
+    auto metrics_server = std::unique_ptr<cbdc::rpc::json_rpc_http_server>();
+    const auto& metrics_ep = opts.m_sentinel_metrics_endpoints[sentinel_id];
+    if(metrics_ep.has_value()) {
+        metrics_server = cbdc::rpc::start_metrics_server(*metrics_ep);
+        if(!metrics_server) {
+            logger->error("Failed to start metrics server");
+            return -1;
+        }
+    }
+
+    if(opts.m_trace_sample_rate > 0) {
+        const auto trace_name = "sentinel" + std::to_string(sentinel_id);
+        if(!cbdc::tracing::tracer::global().start(
+               opts.m_trace_sample_rate,
+               opts.m_trace_buffer_size,
+               cbdc::tracing::make_file_exporter(
+                   opts.m_trace_file_prefix + trace_name + ".log",
+                   trace_name))) {
+            logger->error("Failed to start trace exporter");
+            return -1;
+        }
+    }
 
     std::string sha2_impl(SHA256AutoDetect());
     logger->info("using sha2:", sha2_impl);
@@ -24,6 +24,21 @@ namespace cbdc::sentinel::rpc {
                                    return m_impl->validate_transaction(
                                        std::move(v_req),
                                        callback);
+                               },
+                               [&](validate_batch_request b_req) {
+                                   return m_impl->validate_transactions(
+                                       std::move(b_req.m_txs),
+                                       callback);
+                               },
+                               [&](submit_request s_req) {
+                                   return m_impl->submit_transaction(
+                                       std::move(s_req),
+                                       callback);
+                               },
+                               [&](status_request s_req) {
+                                   return m_impl->transaction_status(
+                                       std::move(s_req.m_tx_ids),
+                                       callback);
                                }},
                     req);
                 return res;
@@ -0,0 +1,119 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "affinity.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cbdc {
+    namespace {
+        std::mutex g_cpus_mut;
+        thread_cpus g_cpus;
+
+        constexpr auto node_prefix = "node";
+
+        auto parse_number(const std::string& str) -> std::optional<size_t> {
+            if(str.empty()
+               || !std::all_of(str.begin(), str.end(), [](char c) {
+                      return c >= '0' && c <= '9';
+                  })) {
+                return std::nullopt;
+            }
+            return std::stoull(str);
+        }
+
+        /// Reads the CPUs of a NUMA node from sysfs.
+        auto node_cpus(size_t node) -> std::optional<std::string> {
+            auto in = std::ifstream("/sys/devices/system/node/node"
+                                    + std::to_string(node) + "/cpulist");
+            auto ret = std::string();
+            if(!std::getline(in, ret) || ret.empty()) {
+                return std::nullopt;
+            }
+            return ret;
+        }
+    }
+
+    auto parse_cpu_list(const std::string& list)
+        -> std::optional<std::vector<size_t>> {
+        auto ret = std::vector<size_t>();
+        auto ss = std::stringstream(list);
+        auto entry = std::string();
+        while(std::getline(ss, entry, ',')) {
+            if(entry.rfind(node_prefix, 0) == 0) {
+                const auto node = parse_number(
+                    entry.substr(std::string(node_prefix).size()));
+                if(!node.has_value()) {
+                    return std::nullopt;
+                }
+                const auto node_list = node_cpus(node.value());
+                if(!node_list.has_value()
+                   || node_list->find(node_prefix) != std::string::npos) {
+                    return std::nullopt;
+                }
+                auto cpus = parse_cpu_list(node_list.value());
+                if(!cpus.has_value()) {
+                    return std::nullopt;
+                }
+                ret.insert(ret.end(), cpus->begin(), cpus->end());
+                continue;
+            }
+
+            const auto dash = entry.find('-');
+            const auto first = parse_number(entry.substr(0, dash));
+            const auto last = dash == std::string::npos
+                                ? first
+                                : parse_number(entry.substr(dash + 1));
+            if(!first.has_value() || !last.has_value()
+               || last.value() < first.value()) {
+                return std::nullopt;
+            }
+            for(auto cpu = first.value(); cpu <= last.value(); cpu++) {
+                ret.push_back(cpu);
+            }
+        }
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+
+    void set_thread_cpus(thread_cpus cpus) {
+        std::unique_lock l(g_cpus_mut);
+        g_cpus = std::move(cpus);
+    }
+
+    auto pin_current_thread(thread_role role) -> bool {
+        auto cpus = std::vector<size_t>();
+        {
+            std::unique_lock l(g_cpus_mut);
+            auto it = g_cpus.find(role);
+            if(it == g_cpus.end() || it->second.empty()) {
+                return true;
+            }
+            cpus = it->second;
+        }
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(auto cpu : cpus) {
+            if(cpu >= CPU_SETSIZE) {
+                return false;
+            }
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        return true;
+#endif
+    }
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_AFFINITY_H_
+#define OPENCBDC_TX_SRC_COMMON_AFFINITY_H_
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc {
+    /// Kinds of threads which can be confined to their own CPUs.
+    enum class thread_role {
+        /// A daemon's main thread, and any threads it starts which have no
+        /// role of their own.
+        main,
+        /// Network I/O threads.
+        network,
+        /// Raft message processing threads.
+        raft,
+        /// Transaction processing worker pools.
+        executor,
+        /// Threads writing audit records to storage.
+        persistence
+    };
+
+    /// CPUs assigned to each thread role. Roles without an entry, or with
+    /// an empty list, are not pinned.
+    using thread_cpus = std::map<thread_role, std::vector<size_t>>;
+
+    /// Parses a list of CPUs such as "0-3,8,10-11". An entry of the form
+    /// "node<N>" stands for every CPU of NUMA node N, as listed by the
+    /// kernel.
+    /// \param list comma-separated CPU numbers, inclusive ranges and NUMA
+    ///             nodes.
+    /// \return sorted, de-duplicated CPU numbers, or std::nullopt if the
+    ///         list is malformed or names an unknown NUMA node.
+    auto parse_cpu_list(const std::string& list)
+        -> std::optional<std::vector<size_t>>;
+
+    /// Sets the CPUs used by \ref pin_current_thread for the whole
+    /// process. Call once at startup, before starting any threads.
+    /// \param cpus CPUs for each role.
+    void set_thread_cpus(thread_cpus cpus);
+
+    /// Restricts the calling thread to the CPUs configured for its role.
+    ///
+    /// Threads inherit the CPUs of the thread that starts them, and Linux
+    /// places memory on the NUMA node of the CPU that first writes to it.
+    /// So pinning the main thread to the CPUs of one node, before building
+    /// large in-memory structures, keeps them and every unpinned helper
+    /// thread on that node.
+    /// \param role role of the calling thread.
+    /// \return false if the role has CPUs but the thread could not be
+    ///         pinned to them. Always true on platforms without thread
+    ///         affinity.
+    auto pin_current_thread(thread_role role) -> bool;
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_AFFINITY_H_
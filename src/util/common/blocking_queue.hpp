@@ -77,6 +77,22 @@ namespace cbdc {
             }
         }
 
+        /// Pops an element from the queue if there is one, without
+        /// blocking.
+        /// \param item object into which to move the popped element.
+        /// \return true if an element was popped, false if the queue was
+        ///         empty.
+        [[nodiscard]] auto try_pop(T& item) -> bool {
+            std::unique_lock<std::mutex> lck(m_mut);
+            if(m_buffer.empty()) {
+                return false;
+            }
+            item = std::move(first_item<T, Q>());
+            m_buffer.pop();
+            m_wake = !m_buffer.empty();
+            return true;
+        }
+
         /// Clears the queue and unblocks waiting consumers.
         void clear() {
             {
@@ -0,0 +1,76 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bloom_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace cbdc {
+    namespace {
+        constexpr size_t word_bits = 64;
+        constexpr size_t max_probes = 16;
+    }
+
+    bloom_filter::bloom_filter(size_t expected_items,
+                               double false_positive_rate) {
+        // Optimal sizing: m = -n ln(p) / ln(2)^2 bits and k = m / n ln(2)
+        // probes.
+        const auto n
+            = static_cast<double>(std::max<size_t>(expected_items, 1));
+        const auto p = std::clamp(false_positive_rate, 1e-9, 0.5);
+        const auto ln2 = std::log(2.0);
+        const auto m = std::ceil(-n * std::log(p) / (ln2 * ln2));
+        const auto words
+            = std::max<size_t>((static_cast<size_t>(m) + word_bits - 1)
+                                   / word_bits,
+                               1);
+        m_bits = words * word_bits;
+        const auto k = std::round(static_cast<double>(m_bits) / n * ln2);
+        m_probes = std::clamp<size_t>(static_cast<size_t>(k), 1, max_probes);
+        m_words = std::make_unique<std::atomic<uint64_t>[]>(words);
+        for(size_t i{0}; i < words; i++) {
+            m_words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    auto bloom_filter::probe(const hash_t& val, size_t i) const -> size_t {
+        // Double hashing over two independent 64-bit words of the hash.
+        uint64_t h1{};
+        uint64_t h2{};
+        std::memcpy(&h1, val.data(), sizeof(h1));
+        std::memcpy(&h2, val.data() + sizeof(h1), sizeof(h2));
+        return static_cast<size_t>((h1 + i * (h2 | 1)) % m_bits);
+    }
+
+    void bloom_filter::add(const hash_t& val) {
+        for(size_t i{0}; i < m_probes; i++) {
+            const auto bit = probe(val, i);
+            m_words[bit / word_bits].fetch_or(uint64_t{1} << (bit % word_bits),
+                                              std::memory_order_relaxed);
+        }
+    }
+
+    auto bloom_filter::possibly_contains(const hash_t& val) const -> bool {
+        for(size_t i{0}; i < m_probes; i++) {
+            const auto bit = probe(val, i);
+            const auto word
+                = m_words[bit / word_bits].load(std::memory_order_relaxed);
+            if((word & (uint64_t{1} << (bit % word_bits))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto bloom_filter::bits() const -> size_t {
+        return m_bits;
+    }
+
+    auto bloom_filter::probes() const -> size_t {
+        return m_probes;
+    }
+}
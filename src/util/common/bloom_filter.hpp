@@ -0,0 +1,71 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_BLOOM_FILTER_H_
+#define OPENCBDC_TX_SRC_COMMON_BLOOM_FILTER_H_
+
+#include "hash.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace cbdc {
+    /// \brief Thread-safe, fixed-size Bloom filter of hashes.
+    ///
+    /// Answers whether a hash may have been added, with no false negatives
+    /// and a false positive rate set at construction for the expected
+    /// number of hashes. Values added are assumed to be uniformly
+    /// distributed cryptographic hashes, so probe positions are derived
+    /// directly from the hash bytes rather than by rehashing. Adding and
+    /// querying never lock and may run concurrently.
+    class bloom_filter {
+      public:
+        /// Constructor. Sizes the filter for the given number of hashes and
+        /// false positive rate.
+        /// \param expected_items number of hashes the filter is sized for.
+        ///                       Adding more increases the false positive
+        ///                       rate.
+        /// \param false_positive_rate target probability that a hash which
+        ///                            was never added is reported as
+        ///                            present, between 0 and 1 exclusive.
+        bloom_filter(size_t expected_items, double false_positive_rate);
+
+        bloom_filter() = delete;
+        ~bloom_filter() = default;
+        bloom_filter(const bloom_filter&) = delete;
+        auto operator=(const bloom_filter&) -> bloom_filter& = delete;
+        bloom_filter(bloom_filter&&) = delete;
+        auto operator=(bloom_filter&&) -> bloom_filter& = delete;
+
+        /// Adds a hash to the filter.
+        /// \param val hash to add.
+        void add(const hash_t& val);
+
+        /// Checks whether a hash may have been added to the filter.
+        /// \param val hash to check.
+        /// \return false if the hash was definitely never added, true if it
+        ///         probably was.
+        [[nodiscard]] auto possibly_contains(const hash_t& val) const
+            -> bool;
+
+        /// Returns the size of the filter.
+        /// \return number of bits in the filter.
+        [[nodiscard]] auto bits() const -> size_t;
+
+        /// Returns the number of bits checked per hash.
+        /// \return probe count.
+        [[nodiscard]] auto probes() const -> size_t;
+
+      private:
+        [[nodiscard]] auto probe(const hash_t& val, size_t i) const
+            -> size_t;
+
+        size_t m_bits;
+        size_t m_probes;
+        std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_BLOOM_FILTER_H_
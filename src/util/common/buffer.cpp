@@ -5,10 +5,10 @@
 
 #include "buffer.hpp"
 
-#include <array>
+#include "hex.hpp"
+
+#include <cstddef>
 #include <cstring>
-#include <iomanip>
-#include <sstream>
 
 namespace cbdc {
     void buffer::clear() {
@@ -21,10 +21,6 @@ namespace cbdc {
         std::memcpy(&m_data[orig_size], data, len);
     }
 
-    auto buffer::size() const -> size_t {
-        return m_data.size();
-    }
-
     auto buffer::data() -> void* {
         return m_data.data();
     }
@@ -33,14 +29,6 @@ namespace cbdc {
         return m_data.data();
     }
 
-    auto buffer::data_at(size_t offset) -> void* {
-        return &m_data[offset];
-    }
-
-    auto buffer::data_at(size_t offset) const -> const void* {
-        return &m_data[offset];
-    }
-
     auto buffer::operator==(const buffer& other) const -> bool {
         return m_data == other.m_data;
     }
@@ -49,6 +37,14 @@ namespace cbdc {
         m_data.resize(m_data.size() + len);
     }
 
+    void buffer::reserve(size_t len) {
+        m_data.reserve(len);
+    }
+
+    auto buffer::capacity() const -> size_t {
+        return m_data.capacity();
+    }
+
     auto buffer::c_ptr() const -> const unsigned char* {
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
         return reinterpret_cast<const unsigned char*>(m_data.data());
@@ -60,25 +56,20 @@ namespace cbdc {
     }
 
     auto buffer::to_hex() const -> std::string {
-        // TODO: refactor these into general hex conversion functions with
-        //       functions in hash.cpp.
-        std::stringstream ret;
-        ret << std::hex << std::setfill('0');
-
-        for(const auto& byte : m_data) {
-            // TODO: This function is likely very slow. At some point this
-            //       could be converted to lookup table that we make ourselves.
-            ret << std::setw(2) << static_cast<int>(byte);
-        }
+        auto ret = std::string(m_data.size() * 2, '\0');
+        to_hex_into(ret.data());
+        return ret;
+    }
 
-        return ret.str();
+    void buffer::to_hex_into(char* out) const {
+        hex_encode(c_ptr(), m_data.size(), out);
     }
 
     auto buffer::to_hex_prefixed(const std::string& prefix) const
         -> std::string {
-        auto res = std::string();
-        res.append(prefix);
-        res.append(to_hex());
+        auto res = prefix;
+        res.resize(prefix.size() + m_data.size() * 2);
+        to_hex_into(res.data() + prefix.size());
         return res;
     }
 
@@ -89,17 +80,11 @@ namespace cbdc {
         }
 
         auto ret = cbdc::buffer();
-
-        for(size_t i = 0; i < hex.size(); i += 2) {
-            unsigned int v{};
-            std::stringstream s;
-            // TODO: This function is likely very slow. At some point this
-            //       could be converted to lookup table that we make ourselves.
-            s << std::hex << hex.substr(i, 2);
-            if(!(s >> v)) {
-                return std::nullopt;
-            }
-            ret.m_data.push_back(static_cast<std::byte>(v));
+        ret.m_data.resize(hex.size() / 2);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* out = reinterpret_cast<unsigned char*>(ret.m_data.data());
+        if(!hex_decode(hex.data(), ret.m_data.size(), out)) {
+            return std::nullopt;
         }
 
         return ret;
@@ -53,6 +53,16 @@ namespace cbdc {
         /// \param len the number of bytes to add.
         void extend(size_t len);
 
+        /// Allocates storage for at least the given number of bytes without
+        /// changing the size of the buffer.
+        /// \param len the number of bytes to reserve.
+        void reserve(size_t len);
+
+        /// Returns the number of bytes the buffer can hold without
+        /// reallocating.
+        /// \return capacity in bytes.
+        [[nodiscard]] auto capacity() const -> size_t;
+
         /// Returns a pointer to the data, cast to an unsigned char*.
         /// \return unsigned char pointer.
         [[nodiscard]] auto c_ptr() const -> const unsigned char*;
@@ -71,6 +81,12 @@ namespace cbdc {
         /// \return a hex encoded string.
         [[nodiscard]] auto to_hex() const -> std::string;
 
+        /// Writes the hex representation of the contents of the buffer
+        /// without allocating.
+        /// \param out destination for 2 * size() characters. No null
+        ///            terminator is written.
+        void to_hex_into(char* out) const;
+
         /// Creates a new buffer from the provided hex string optionally
         /// prefixed with a prefix sequence
         /// \param hex string-encoded hex representation of this buffer.
@@ -89,6 +105,19 @@ namespace cbdc {
       private:
         std::vector<std::byte> m_data{};
     };
+
+    // Defined inline as serializers call them for every value
+    inline auto buffer::size() const -> size_t {
+        return m_data.size();
+    }
+
+    inline auto buffer::data_at(size_t offset) -> void* {
+        return m_data.data() + offset;
+    }
+
+    inline auto buffer::data_at(size_t offset) const -> const void* {
+        return m_data.data() + offset;
+    }
 }
 
 #endif // OPENCBDC_TX_SRC_COMMON_BUFFER_H_
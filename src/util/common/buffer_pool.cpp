@@ -0,0 +1,181 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "buffer_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace cbdc {
+    /// A pooled buffer, along with storage for the control block of the
+    /// shared_ptr that owns it while it is in use.
+    struct buffer_pool::entry {
+        static constexpr size_t control_size = 64;
+
+        explicit entry(buffer_pool* pool) : m_pool(pool) {}
+
+        buffer m_buf;
+        buffer_pool* m_pool;
+        alignas(std::max_align_t) std::array<std::byte, control_size>
+            m_control{};
+    };
+
+    /// Places the shared_ptr control block inside the entry. The control
+    /// block is deallocated after the last weak reference is gone, which
+    /// is when the entry can return to the pool.
+    template<typename T>
+    class buffer_pool::control_allocator {
+      public:
+        using value_type = T;
+
+        explicit control_allocator(entry* e) : m_entry(e) {}
+
+        template<typename U>
+        explicit control_allocator(const control_allocator<U>& other)
+            : m_entry(other.m_entry) {}
+
+        auto allocate(size_t n) -> T* {
+            static_assert(sizeof(T) <= entry::control_size,
+                          "shared_ptr control block too large");
+            static_assert(alignof(T) <= alignof(std::max_align_t),
+                          "shared_ptr control block over-aligned");
+            assert(n == 1);
+            (void)n;
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            return reinterpret_cast<T*>(m_entry->m_control.data());
+        }
+
+        void deallocate(T* /* p */, size_t /* n */) {
+            m_entry->m_pool->release(m_entry);
+        }
+
+        template<typename U>
+        auto operator==(const control_allocator<U>& rhs) const -> bool {
+            return m_entry == rhs.m_entry;
+        }
+
+        template<typename U>
+        auto operator!=(const control_allocator<U>& rhs) const -> bool {
+            return m_entry != rhs.m_entry;
+        }
+
+      private:
+        template<typename U>
+        friend class control_allocator;
+
+        entry* m_entry;
+    };
+
+    buffer_pool::buffer_pool(size_t max_free) : m_max_free(max_free) {
+        for(auto& c : m_classes) {
+            c.m_free.reserve(m_max_free);
+        }
+    }
+
+    buffer_pool::~buffer_pool() {
+        for(auto& c : m_classes) {
+            for(auto* e : c.m_free) {
+                delete e; // NOLINT(cppcoreguidelines-owning-memory)
+            }
+        }
+    }
+
+    auto buffer_pool::acquire(size_t capacity) -> std::shared_ptr<buffer> {
+        auto idx = class_for_size(capacity);
+        auto* e = take(idx);
+        if(e == nullptr) {
+            // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+            e = new entry(this);
+            if(idx < size_class_count) {
+                e->m_buf.reserve(class_size(idx));
+            }
+        }
+        e->m_buf.reserve(capacity);
+        return share(e);
+    }
+
+    auto buffer_pool::wrap(buffer&& buf) -> std::shared_ptr<buffer> {
+        auto* e = take(0);
+        if(e == nullptr) {
+            // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+            e = new entry(this);
+        }
+        e->m_buf = std::move(buf);
+        return share(e);
+    }
+
+    auto buffer_pool::free_count() const -> size_t {
+        size_t ret{0};
+        for(const auto& c : m_classes) {
+            std::unique_lock<std::mutex> l(c.m_mut);
+            ret += c.m_free.size();
+        }
+        return ret;
+    }
+
+    auto buffer_pool::global() -> buffer_pool& {
+        // Never destroyed, so buffers released during static destruction
+        // still have a pool to return to.
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+        static auto* pool = new buffer_pool();
+        return *pool;
+    }
+
+    auto buffer_pool::take(size_t first_class) -> entry* {
+        for(auto i = first_class; i < size_class_count; i++) {
+            auto& c = m_classes[i];
+            std::unique_lock<std::mutex> l(c.m_mut);
+            if(!c.m_free.empty()) {
+                auto* e = c.m_free.back();
+                c.m_free.pop_back();
+                return e;
+            }
+        }
+        return nullptr;
+    }
+
+    auto buffer_pool::share(entry* e) -> std::shared_ptr<buffer> {
+        return std::shared_ptr<buffer>(
+            &e->m_buf,
+            [](buffer* b) {
+                b->clear();
+            },
+            control_allocator<buffer>(e));
+    }
+
+    void buffer_pool::release(entry* e) {
+        auto cap = e->m_buf.capacity();
+        if(cap <= max_buffer_size) {
+            auto& c = m_classes[class_of_capacity(cap)];
+            std::unique_lock<std::mutex> l(c.m_mut);
+            if(c.m_free.size() < m_max_free) {
+                c.m_free.push_back(e);
+                return;
+            }
+        }
+        delete e; // NOLINT(cppcoreguidelines-owning-memory)
+    }
+
+    auto buffer_pool::class_size(size_t idx) -> size_t {
+        return min_class_size << (2 * idx);
+    }
+
+    auto buffer_pool::class_of_capacity(size_t capacity) -> size_t {
+        size_t idx{0};
+        while(idx + 1 < size_class_count && capacity >= class_size(idx + 1)) {
+            idx++;
+        }
+        return idx;
+    }
+
+    auto buffer_pool::class_for_size(size_t size) -> size_t {
+        size_t idx{0};
+        while(idx < size_class_count && class_size(idx) < size) {
+            idx++;
+        }
+        return idx;
+    }
+}
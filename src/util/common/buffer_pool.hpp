@@ -0,0 +1,98 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_BUFFER_POOL_H_
+#define OPENCBDC_TX_SRC_COMMON_BUFFER_POOL_H_
+
+#include "buffer.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Pool of reusable shared buffers.
+    ///
+    /// Hands out shared buffers whose storage, along with the shared_ptr
+    /// control block, returns to the pool when the last reference is
+    /// released. A steady flow of messages therefore reuses the same
+    /// allocations rather than making new ones. Free buffers are kept in
+    /// size classes by capacity. Buffers may be acquired on one thread and
+    /// released on another. The pool must outlive the buffers it hands
+    /// out; \ref global is never destroyed.
+    class buffer_pool {
+      public:
+        /// Number of buffer size classes.
+        static constexpr size_t size_class_count = 8;
+        /// Capacity in bytes of the smallest size class. Each class is
+        /// four times the capacity of the one before it.
+        static constexpr size_t min_class_size = 256;
+        /// Buffers which grew beyond this capacity are freed on release
+        /// rather than kept.
+        static constexpr size_t max_buffer_size
+            = min_class_size << (2 * (size_class_count - 1));
+        /// Default number of free buffers kept per size class.
+        static constexpr size_t default_max_free = 1024;
+
+        /// Constructor.
+        /// \param max_free number of free buffers to keep in each size
+        ///                 class. Released buffers beyond this are freed.
+        explicit buffer_pool(size_t max_free = default_max_free);
+
+        /// Frees the buffers held by the pool.
+        ~buffer_pool();
+
+        buffer_pool(const buffer_pool&) = delete;
+        auto operator=(const buffer_pool&) -> buffer_pool& = delete;
+        buffer_pool(buffer_pool&&) = delete;
+        auto operator=(buffer_pool&&) -> buffer_pool& = delete;
+
+        /// Returns an empty buffer with at least the given capacity. Reuses
+        /// a free buffer from the smallest size class that fits, if any.
+        /// \param capacity number of bytes the buffer should hold without
+        ///                 reallocating.
+        /// \return buffer which returns to the pool once released.
+        [[nodiscard]] auto acquire(size_t capacity = 0)
+            -> std::shared_ptr<buffer>;
+
+        /// Moves the given buffer into pooled storage, so it can be shared
+        /// without a separate allocation for the shared_ptr.
+        /// \param buf buffer to move.
+        /// \return shared buffer holding the contents of buf.
+        [[nodiscard]] auto wrap(buffer&& buf) -> std::shared_ptr<buffer>;
+
+        /// Returns the number of free buffers held by the pool.
+        /// \return free buffer count across all size classes.
+        [[nodiscard]] auto free_count() const -> size_t;
+
+        /// Returns the process-wide pool used by the network layer.
+        /// \return global buffer pool.
+        static auto global() -> buffer_pool&;
+
+      private:
+        struct entry;
+        template<typename T>
+        class control_allocator;
+
+        struct size_class {
+            mutable std::mutex m_mut;
+            std::vector<entry*> m_free;
+        };
+
+        size_t m_max_free;
+        std::array<size_class, size_class_count> m_classes;
+
+        [[nodiscard]] auto take(size_t first_class) -> entry*;
+        [[nodiscard]] auto share(entry* e) -> std::shared_ptr<buffer>;
+        void release(entry* e);
+
+        static auto class_size(size_t idx) -> size_t;
+        static auto class_of_capacity(size_t capacity) -> size_t;
+        static auto class_for_size(size_t size) -> size_t;
+    };
+}
+
+#endif
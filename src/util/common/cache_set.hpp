@@ -7,15 +7,23 @@
 #define CACHE_SET_H_INC
 
 #include <cassert>
-#include <queue>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
-#include <unordered_set>
+#include <vector>
 
 namespace cbdc {
     /// \brief Thread-safe set with a maximum size.
     ///
-    /// If full, inserting a new value will evict the oldest value.
-    /// \tparam K type of the values in the set.
+    /// If full, inserting a new value will evict the oldest value. Values are
+    /// spread across independently locked stripes, each a fixed-size
+    /// open-addressing table with a ring buffer recording insertion order,
+    /// so eviction order is oldest-first within a stripe. All memory is
+    /// allocated on construction.
+    /// \tparam K type of the values in the set. Must be default
+    ///           constructible and copyable.
     /// \tparam H hasher compatible with std::unordered_set.
     template<typename K, typename H = std::hash<K>>
     class cache_set {
@@ -24,10 +32,19 @@ namespace cbdc {
 
         /// Constructor.
         /// \param max_size maximum number of elements in the set.
-        explicit cache_set(size_t max_size) : m_max_size(max_size) {
-            m_vals.max_load_factor(std::numeric_limits<float>::max());
-            static constexpr auto buckets_factor = 2;
-            m_vals.rehash(buckets_factor * max_size);
+        explicit cache_set(size_t max_size) {
+            assert(max_size > 0);
+            static constexpr size_t min_stripe_size = 64;
+            while(m_stripe_count < max_stripes
+                  && m_stripe_count * 2 * min_stripe_size <= max_size) {
+                m_stripe_count *= 2;
+            }
+            auto stripe_size
+                = (max_size + m_stripe_count - 1) / m_stripe_count;
+            m_stripes = std::make_unique<stripe[]>(m_stripe_count);
+            for(size_t i = 0; i < m_stripe_count; i++) {
+                m_stripes[i].init(stripe_size);
+            }
         };
 
         /// Adds a value to the set, evicting the oldest value if the set is
@@ -36,33 +53,143 @@ namespace cbdc {
         /// \return true if the value was not already in the set.
         template<typename T>
         auto add(T&& val) -> bool {
-            std::unique_lock<std::shared_mutex> l(m_mut);
-            auto added = m_vals.emplace(std::forward<T>(val));
-            if(added.second) {
-                m_eviction_queue.push(std::ref(*added.first));
-                if(m_eviction_queue.size() >= m_max_size) {
-                    auto& v = m_eviction_queue.front();
-                    m_vals.erase(v);
-                    m_eviction_queue.pop();
-                }
-            }
-            assert(m_eviction_queue.size() <= m_max_size);
-            return added.second;
+            auto h = H()(val);
+            auto& s = stripe_for(h);
+            std::unique_lock<std::shared_mutex> l(s.m_mut);
+            return s.add(std::forward<T>(val), h);
         }
 
         /// Determines whether a given value is present in the cache set.
         /// \param val value to check.
         /// \return true if the value is present in the set.
         [[nodiscard]] auto contains(const K& val) const -> bool {
-            std::shared_lock<std::shared_mutex> l(m_mut);
-            return m_vals.find(val) != m_vals.end();
+            auto h = H()(val);
+            const auto& s = stripe_for(h);
+            std::shared_lock<std::shared_mutex> l(s.m_mut);
+            return s.find(val, h) != stripe::npos;
+        }
+
+        /// Returns the number of values in the set.
+        /// \return value count.
+        [[nodiscard]] auto size() const -> size_t {
+            size_t ret{0};
+            for(size_t i = 0; i < m_stripe_count; i++) {
+                std::shared_lock<std::shared_mutex> l(m_stripes[i].m_mut);
+                ret += m_stripes[i].m_count;
+            }
+            return ret;
+        }
+
+        /// Returns the number of bytes allocated for the set's tables,
+        /// which is fixed on construction.
+        /// \return table size in bytes.
+        [[nodiscard]] auto memory_usage() const -> size_t {
+            size_t ret{0};
+            for(size_t i = 0; i < m_stripe_count; i++) {
+                const auto& s = m_stripes[i];
+                ret += (s.m_slots.size() + s.m_ring.size()) * sizeof(K)
+                     + s.m_used.size();
+            }
+            return ret;
         }
 
       private:
-        std::unordered_set<K, H> m_vals;
-        std::queue<std::reference_wrapper<const K>> m_eviction_queue;
-        size_t m_max_size;
-        mutable std::shared_mutex m_mut;
+        static constexpr size_t max_stripes = 16;
+
+        struct stripe {
+            static constexpr size_t npos = SIZE_MAX;
+
+            mutable std::shared_mutex m_mut;
+            std::vector<K> m_slots;
+            std::vector<uint8_t> m_used;
+            size_t m_mask{};
+            // Values in insertion order, oldest at m_head
+            std::vector<K> m_ring;
+            size_t m_head{};
+            size_t m_count{};
+
+            void init(size_t capacity) {
+                // Keep the load factor at or below one half
+                size_t n_slots = 2;
+                while(n_slots < capacity * 2) {
+                    n_slots *= 2;
+                }
+                m_slots.resize(n_slots);
+                m_used.resize(n_slots);
+                m_mask = n_slots - 1;
+                m_ring.resize(capacity);
+            }
+
+            [[nodiscard]] auto find(const K& val, size_t h) const -> size_t {
+                for(auto i = h & m_mask; m_used[i] != 0;
+                    i = (i + 1) & m_mask) {
+                    if(m_slots[i] == val) {
+                        return i;
+                    }
+                }
+                return npos;
+            }
+
+            template<typename T>
+            auto add(T&& val, size_t h) -> bool {
+                auto i = h & m_mask;
+                for(; m_used[i] != 0; i = (i + 1) & m_mask) {
+                    if(m_slots[i] == val) {
+                        return false;
+                    }
+                }
+
+                auto cap = m_ring.size();
+                if(m_count == cap) {
+                    erase(m_ring[m_head]);
+                    m_ring[m_head] = val;
+                    m_head = (m_head + 1) % cap;
+                    // Erasing may have shifted an entry into the free slot
+                    i = h & m_mask;
+                    while(m_used[i] != 0) {
+                        i = (i + 1) & m_mask;
+                    }
+                } else {
+                    m_ring[(m_head + m_count) % cap] = val;
+                    m_count++;
+                }
+                m_slots[i] = std::forward<T>(val);
+                m_used[i] = 1;
+                return true;
+            }
+
+            // Removes a value using backward-shift deletion, so probe
+            // sequences stay unbroken without tombstones.
+            void erase(const K& val) {
+                auto i = find(val, H()(val));
+                assert(i != npos);
+                m_used[i] = 0;
+                for(auto j = (i + 1) & m_mask; m_used[j] != 0;
+                    j = (j + 1) & m_mask) {
+                    auto home = H()(m_slots[j]) & m_mask;
+                    // Distance from each entry's home slot
+                    auto dist_j = (j - home) & m_mask;
+                    auto dist_i = (i - home) & m_mask;
+                    if(dist_i < dist_j) {
+                        m_slots[i] = std::move(m_slots[j]);
+                        m_used[i] = 1;
+                        m_used[j] = 0;
+                        i = j;
+                    }
+                }
+            }
+        };
+
+        size_t m_stripe_count{1};
+        std::unique_ptr<stripe[]> m_stripes;
+
+        [[nodiscard]] auto stripe_for(size_t h) const -> stripe& {
+            // Use the high bits of a remixed hash, as the table index uses
+            // the low bits
+            static constexpr uint64_t mix = 0x9E3779B97F4A7C15ULL;
+            auto idx = (static_cast<uint64_t>(h) * mix) >> 32;
+            return m_stripes[idx & (m_stripe_count - 1)];
+        }
     };
 }
 
@@ -89,6 +89,13 @@ namespace cbdc::config {
         return ss.str();
     }
 
+    auto get_shard_joining_key(size_t shard_id) -> std::string {
+        std::stringstream ss;
+        get_shard_key_prefix(ss, shard_id);
+        ss << joining_postfix;
+        return ss.str();
+    }
+
     void get_archiver_key_prefix(std::stringstream& ss, size_t archiver_id) {
         ss << archiver_prefix << archiver_id << config_separator;
     }
@@ -125,6 +132,14 @@ namespace cbdc::config {
         ss << sentinel_prefix << sentinel_id << config_separator;
     }
 
+    auto get_sentinel_metrics_endpoint_key(size_t sentinel_id)
+        -> std::string {
+        std::stringstream ss;
+        get_sentinel_key_prefix(ss, sentinel_id);
+        ss << metrics_endpoint_postfix;
+        return ss.str();
+    }
+
     auto get_sentinel_loglevel_key(size_t sentinel_id) -> std::string {
         std::stringstream ss;
         get_sentinel_key_prefix(ss, sentinel_id);
@@ -153,6 +168,20 @@ namespace cbdc::config {
         return ss.str();
     }
 
+    auto get_watchtower_start_key(size_t watchtower_id) -> std::string {
+        std::stringstream ss;
+        get_watchtower_key_prefix(ss, watchtower_id);
+        ss << start_postfix;
+        return ss.str();
+    }
+
+    auto get_watchtower_end_key(size_t watchtower_id) -> std::string {
+        std::stringstream ss;
+        get_watchtower_key_prefix(ss, watchtower_id);
+        ss << end_postfix;
+        return ss.str();
+    }
+
     auto get_watchtower_loglevel_key(size_t watchtower_id) -> std::string {
         std::stringstream ss;
         get_watchtower_key_prefix(ss, watchtower_id);
@@ -192,6 +221,14 @@ namespace cbdc::config {
         return ss.str();
     }
 
+    auto get_shard_metrics_endpoint_key(size_t shard_id, size_t node_id)
+        -> std::string {
+        std::stringstream ss;
+        get_shard_key_prefix(ss, shard_id);
+        ss << node_id << config_separator << metrics_endpoint_postfix;
+        return ss.str();
+    }
+
     void get_coordinator_key_prefix(std::stringstream& ss,
                                     size_t coordinator_id) {
         ss << coordinator_prefix << coordinator_id << config_separator;
@@ -205,6 +242,14 @@ namespace cbdc::config {
         return ss.str();
     }
 
+    auto get_coordinator_metrics_endpoint_key(size_t coordinator_id,
+                                              size_t node_id) -> std::string {
+        std::stringstream ss;
+        get_coordinator_key_prefix(ss, coordinator_id);
+        ss << node_id << config_separator << metrics_endpoint_postfix;
+        return ss.str();
+    }
+
     auto get_coordinator_raft_endpoint_key(size_t coordinator_id,
                                            size_t node_id) -> std::string {
         std::stringstream ss;
@@ -241,6 +286,34 @@ namespace cbdc::config {
         return ss.str();
     }
 
+    auto get_sentinel_capture_key(size_t sentinel_id) -> std::string {
+        auto ss = std::stringstream();
+        get_sentinel_key_prefix(ss, sentinel_id);
+        ss << capture_postfix;
+        return ss.str();
+    }
+
+    void read_leveldb_profile(leveldb_profile& profile,
+                              const parser& cfg,
+                              const std::string& prefix) {
+        const auto key = [&](const char* postfix) {
+            return prefix + "_" + postfix;
+        };
+        profile.m_block_cache_bytes
+            = cfg.get_ulong(key(leveldb_block_cache_bytes_postfix))
+                  .value_or(profile.m_block_cache_bytes);
+        profile.m_write_buffer_bytes
+            = cfg.get_ulong(key(leveldb_write_buffer_bytes_postfix))
+                  .value_or(profile.m_write_buffer_bytes);
+        profile.m_bloom_bits_per_key
+            = cfg.get_ulong(key(leveldb_bloom_bits_postfix))
+                  .value_or(profile.m_bloom_bits_per_key);
+        profile.m_compression
+            = cfg.get_ulong(key(leveldb_compression_postfix))
+                  .value_or(profile.m_compression ? 1 : 0)
+           != 0;
+    }
+
     auto read_shard_endpoints(options& opts, const parser& cfg)
         -> std::optional<std::string> {
         const auto shard_count = cfg.get_ulong(shard_count_key).value_or(0);
@@ -248,6 +321,7 @@ namespace cbdc::config {
             opts.m_locking_shard_endpoints.resize(shard_count);
             opts.m_locking_shard_raft_endpoints.resize(shard_count);
             opts.m_locking_shard_readonly_endpoints.resize(shard_count);
+            opts.m_locking_shard_metrics_endpoints.resize(shard_count);
             for(size_t i{0}; i < shard_count; i++) {
                 const auto node_count_key = get_shard_node_count_key(i);
                 const auto node_count = cfg.get_ulong(node_count_key);
@@ -285,6 +359,11 @@ namespace cbdc::config {
                     }
                     opts.m_locking_shard_readonly_endpoints[i].emplace_back(
                         *ro_ep);
+
+                    const auto metrics_ep_key
+                        = get_shard_metrics_endpoint_key(i, j);
+                    opts.m_locking_shard_metrics_endpoints[i].emplace_back(
+                        cfg.get_endpoint(metrics_ep_key));
                 }
             }
         }
@@ -335,11 +414,66 @@ namespace cbdc::config {
                 = std::make_pair(static_cast<uint8_t>(*range_start),
                                  static_cast<uint8_t>(*range_end));
             opts.m_shard_ranges.push_back(shard_range);
+
+            const auto joining_key = get_shard_joining_key(i);
+            opts.m_shard_joining.push_back(
+                cfg.get_ulong(joining_key).value_or(0) != 0);
         }
 
         opts.m_shard_completed_txs_cache_size
             = cfg.get_ulong(shard_completed_txs_cache_size)
                   .value_or(opts.m_shard_completed_txs_cache_size);
+        opts.m_shard_tx_bloom_filter_items
+            = cfg.get_ulong(shard_tx_bloom_filter_items_key)
+                  .value_or(opts.m_shard_tx_bloom_filter_items);
+        opts.m_shard_tx_bloom_filter_fp_rate
+            = cfg.get_decimal(shard_tx_bloom_filter_fp_rate_key)
+                  .value_or(opts.m_shard_tx_bloom_filter_fp_rate);
+        opts.m_shard_lock_stripes
+            = std::max<size_t>(cfg.get_ulong(shard_lock_stripes_key)
+                                   .value_or(opts.m_shard_lock_stripes),
+                               1);
+        opts.m_shard_read_index
+            = cfg.get_ulong(shard_read_index_key)
+                  .value_or(opts.m_shard_read_index ? 1 : 0)
+           != 0;
+        opts.m_shard_attestation_threads
+            = cfg.get_ulong(shard_attestation_threads_key)
+                  .value_or(opts.m_shard_attestation_threads);
+        opts.m_shard_applied_dtx_generation_size
+            = cfg.get_ulong(shard_applied_dtx_generation_size_key)
+                  .value_or(opts.m_shard_applied_dtx_generation_size);
+        opts.m_shard_applied_dtx_generations
+            = cfg.get_ulong(shard_applied_dtx_generations_key)
+                  .value_or(opts.m_shard_applied_dtx_generations);
+        opts.m_shard_snapshot_merge_deltas
+            = cfg.get_ulong(shard_snapshot_merge_deltas_key)
+                  .value_or(opts.m_shard_snapshot_merge_deltas);
+        opts.m_shard_digest_threads
+            = cfg.get_ulong(shard_digest_threads_key)
+                  .value_or(opts.m_shard_digest_threads);
+        opts.m_shard_notify_batch_size
+            = cfg.get_ulong(shard_notify_batch_size_key)
+                  .value_or(opts.m_shard_notify_batch_size);
+        opts.m_shard_notify_linger_us
+            = cfg.get_ulong(shard_notify_linger_us_key)
+                  .value_or(opts.m_shard_notify_linger_us);
+        opts.m_shard_uhs_bloom_filter_items
+            = cfg.get_ulong(shard_uhs_bloom_filter_items_key)
+                  .value_or(opts.m_shard_uhs_bloom_filter_items);
+        opts.m_shard_uhs_bloom_filter_fp_rate
+            = cfg.get_decimal(shard_uhs_bloom_filter_fp_rate_key)
+                  .value_or(opts.m_shard_uhs_bloom_filter_fp_rate);
+        read_leveldb_profile(opts.m_shard_leveldb, cfg, shard_prefix);
+        opts.m_shard_uhs_export_dir
+            = cfg.get_string(shard_uhs_export_dir_key)
+                  .value_or(opts.m_shard_uhs_export_dir);
+        opts.m_shard_uhs_export_interval
+            = cfg.get_ulong(shard_uhs_export_interval_key)
+                  .value_or(opts.m_shard_uhs_export_interval);
+        opts.m_shard_snapshot_catchup_blocks
+            = cfg.get_ulong(shard_snapshot_catchup_blocks_key)
+                  .value_or(opts.m_shard_snapshot_catchup_blocks);
 
         opts.m_seed_from = cfg.get_ulong(seed_from).value_or(opts.m_seed_from);
         opts.m_seed_to = cfg.get_ulong(seed_to).value_or(opts.m_seed_to);
@@ -355,6 +489,9 @@ namespace cbdc::config {
             opts.m_seed_value
                 = cfg.get_ulong(seed_value).value_or(opts.m_seed_value);
         }
+        opts.m_seed_oracle_table = cfg.get_string(seed_oracle_table_key);
+        opts.m_seed_oracle_partitioned
+            = cfg.get_ulong(seed_oracle_partitioned_key).value_or(0) != 0;
 
         return std::nullopt;
     }
@@ -365,6 +502,7 @@ namespace cbdc::config {
             = cfg.get_ulong(coordinator_count_key).value_or(0);
         opts.m_coordinator_endpoints.resize(coordinator_count);
         opts.m_coordinator_raft_endpoints.resize(coordinator_count);
+        opts.m_coordinator_metrics_endpoints.resize(coordinator_count);
         for(size_t i{0}; i < coordinator_count; i++) {
             const auto loglevel_key = get_coordinator_loglevel_key(i);
             const auto coordinator_loglevel
@@ -396,12 +534,42 @@ namespace cbdc::config {
                          + " (" + ep_key + ")";
                 }
                 opts.m_coordinator_endpoints[i].emplace_back(*ep);
+
+                opts.m_coordinator_metrics_endpoints[i].emplace_back(
+                    cfg.get_endpoint(
+                        get_coordinator_metrics_endpoint_key(i, j)));
             }
         }
 
         opts.m_coordinator_max_threads
             = cfg.get_ulong(coordinator_max_threads)
                   .value_or(opts.m_coordinator_max_threads);
+        opts.m_coordinator_journal
+            = cfg.get_ulong(coordinator_journal_key).value_or(0) != 0;
+        opts.m_coordinator_archive
+            = cfg.get_ulong(coordinator_archive_key).value_or(0) != 0;
+        opts.m_coordinator_archive_compression_level = static_cast<int>(
+            cfg.get_ulong(coordinator_archive_compression_level_key)
+                .value_or(static_cast<size_t>(
+                    opts.m_coordinator_archive_compression_level)));
+        opts.m_coordinator_target_latency_us
+            = cfg.get_ulong(coordinator_target_latency_key)
+                  .value_or(opts.m_coordinator_target_latency_us);
+        opts.m_coordinator_max_linger_us
+            = cfg.get_ulong(coordinator_max_linger_key)
+                  .value_or(opts.m_coordinator_max_linger_us);
+        opts.m_coordinator_recovery_concurrency
+            = cfg.get_ulong(coordinator_recovery_concurrency_key)
+                  .value_or(opts.m_coordinator_recovery_concurrency);
+        opts.m_coordinator_dedupe_cache_size
+            = cfg.get_ulong(coordinator_dedupe_cache_size_key)
+                  .value_or(opts.m_coordinator_dedupe_cache_size);
+        opts.m_coordinator_snapshot_distance = static_cast<int32_t>(
+            cfg.get_ulong(coordinator_snapshot_distance_key)
+                .value_or(opts.m_coordinator_snapshot_distance));
+        opts.m_coordinator_snapshot_merge_deltas
+            = cfg.get_ulong(coordinator_snapshot_merge_deltas_key)
+                  .value_or(opts.m_coordinator_snapshot_merge_deltas);
 
         return std::nullopt;
     }
@@ -411,6 +579,42 @@ namespace cbdc::config {
         opts.m_attestation_threshold
             = cfg.get_ulong(attestation_threshold_key)
                   .value_or(opts.m_attestation_threshold);
+        opts.m_sentinel_batch_size = cfg.get_ulong(sentinel_batch_size_key)
+                                         .value_or(opts.m_sentinel_batch_size);
+        opts.m_sentinel_batch_linger_us
+            = cfg.get_ulong(sentinel_batch_linger_key)
+                  .value_or(opts.m_sentinel_batch_linger_us);
+        opts.m_sentinel_batch_max_queued
+            = cfg.get_ulong(sentinel_batch_max_queued_key)
+                  .value_or(opts.m_sentinel_batch_max_queued);
+        opts.m_sentinel_shard_batch_size
+            = cfg.get_ulong(sentinel_shard_batch_size_key)
+                  .value_or(opts.m_sentinel_shard_batch_size);
+        opts.m_sentinel_shard_batch_linger_us
+            = cfg.get_ulong(sentinel_shard_batch_linger_key)
+                  .value_or(opts.m_sentinel_shard_batch_linger_us);
+        opts.m_sentinel_validation_threads
+            = cfg.get_ulong(sentinel_validation_threads_key)
+                  .value_or(opts.m_sentinel_validation_threads);
+        opts.m_sentinel_coordinator_routing
+            = cfg.get_ulong(sentinel_coordinator_routing_key)
+                  .value_or(opts.m_sentinel_coordinator_routing ? 1 : 0)
+           != 0;
+        opts.m_sentinel_coordinator_max_in_flight
+            = cfg.get_ulong(sentinel_coordinator_max_in_flight_key)
+                  .value_or(opts.m_sentinel_coordinator_max_in_flight);
+        opts.m_sentinel_coordinator_timeout_ms
+            = cfg.get_ulong(sentinel_coordinator_timeout_key)
+                  .value_or(opts.m_sentinel_coordinator_timeout_ms);
+        opts.m_sentinel_attestation_linger_us
+            = cfg.get_ulong(sentinel_attestation_linger_key)
+                  .value_or(opts.m_sentinel_attestation_linger_us);
+        opts.m_sentinel_aggregate_attestations
+            = cfg.get_ulong(sentinel_aggregate_attestations_key).value_or(0)
+           != 0;
+        opts.m_sentinel_dedupe_cache_size
+            = cfg.get_ulong(sentinel_dedupe_cache_size_key)
+                  .value_or(opts.m_sentinel_dedupe_cache_size);
 
         const auto sentinel_count
             = cfg.get_ulong(sentinel_count_key).value_or(0);
@@ -422,12 +626,16 @@ namespace cbdc::config {
                      + std::to_string(i) + " (" + sentinel_ep_key + ")";
             }
             opts.m_sentinel_endpoints.push_back(*sentinel_ep);
+            opts.m_sentinel_metrics_endpoints.push_back(
+                cfg.get_endpoint(get_sentinel_metrics_endpoint_key(i)));
 
             const auto sentinel_loglevel_key = get_sentinel_loglevel_key(i);
             const auto sentinel_loglevel
                 = cfg.get_loglevel(sentinel_loglevel_key)
                       .value_or(defaults::log_level);
             opts.m_sentinel_loglevels.push_back(sentinel_loglevel);
+            opts.m_sentinel_capture_paths.push_back(
+                cfg.get_string(get_sentinel_capture_key(i)));
 
             const auto sentinel_private_key_key
                 = get_sentinel_private_key_key(i);
@@ -488,10 +696,23 @@ namespace cbdc::config {
         opts.m_target_block_interval
             = cfg.get_ulong(target_block_interval_key)
                   .value_or(opts.m_target_block_interval);
+        opts.m_min_block_interval = cfg.get_ulong(min_block_interval_key)
+                                        .value_or(opts.m_min_block_interval);
+        opts.m_max_block_interval = cfg.get_ulong(max_block_interval_key)
+                                        .value_or(opts.m_max_block_interval);
+        opts.m_block_seal_threshold
+            = cfg.get_ulong(block_seal_threshold_key)
+                  .value_or(opts.m_block_seal_threshold);
+        opts.m_max_block_txs
+            = cfg.get_ulong(max_block_txs_key).value_or(opts.m_max_block_txs);
 
         opts.m_stxo_cache_depth
             = cfg.get_ulong(stxo_cache_key).value_or(opts.m_stxo_cache_depth);
 
+        opts.m_atomizer_check_threads
+            = cfg.get_ulong(atomizer_check_threads_key)
+                  .value_or(opts.m_atomizer_check_threads);
+
         return std::nullopt;
     }
 
@@ -523,6 +744,37 @@ namespace cbdc::config {
             opts.m_archiver_db_dirs.push_back(*archiver_db);
         }
 
+        opts.m_archiver_segment_bytes
+            = cfg.get_ulong(archiver_segment_bytes_key)
+                  .value_or(opts.m_archiver_segment_bytes);
+        opts.m_archiver_compression_level = static_cast<int>(
+            cfg.get_ulong(archiver_compression_level_key)
+                .value_or(static_cast<size_t>(
+                    opts.m_archiver_compression_level)));
+        opts.m_archiver_sync_blocks
+            = cfg.get_ulong(archiver_sync_blocks_key)
+                  .value_or(opts.m_archiver_sync_blocks);
+        if(opts.m_archiver_sync_blocks == 0) {
+            return "archiver_sync_blocks must be positive";
+        }
+        opts.m_archiver_digest_threads
+            = cfg.get_ulong(archiver_digest_threads_key)
+                  .value_or(opts.m_archiver_digest_threads);
+        read_leveldb_profile(opts.m_archiver_leveldb, cfg, archiver_prefix);
+
+        const auto backend = cfg.get_string(archiver_backend_key);
+        if(!backend.has_value()) {
+            return std::nullopt;
+        }
+        static const auto backends
+            = std::unordered_map<std::string, archiver_backend>{
+                {"leveldb", archiver_backend::leveldb},
+                {"segment", archiver_backend::segment}};
+        const auto it = backends.find(backend.value());
+        if(it == backends.end()) {
+            return "Unknown archiver backend: " + backend.value();
+        }
+        opts.m_archiver_backend = it->second;
         return std::nullopt;
     }
 
@@ -561,6 +813,20 @@ namespace cbdc::config {
                 = cfg.get_loglevel(watchtower_loglevel_key)
                       .value_or(defaults::log_level);
             opts.m_watchtower_loglevels.push_back(watchtower_loglevel);
+
+            const auto range_start
+                = cfg.get_ulong(get_watchtower_start_key(i)).value_or(0);
+            const auto range_end
+                = cfg.get_ulong(get_watchtower_end_key(i))
+                      .value_or(std::numeric_limits<uint8_t>::max());
+            if(range_start > range_end
+               || range_end > std::numeric_limits<uint8_t>::max()) {
+                return "Invalid UHS ID range for watchtower "
+                     + std::to_string(i);
+            }
+            opts.m_watchtower_ranges.emplace_back(
+                static_cast<uint8_t>(range_start),
+                static_cast<uint8_t>(range_end));
         }
 
         opts.m_watchtower_block_cache_size
@@ -569,6 +835,9 @@ namespace cbdc::config {
         opts.m_watchtower_error_cache_size
             = cfg.get_ulong(watchtower_error_cache_size_key)
                   .value_or(opts.m_watchtower_error_cache_size);
+        opts.m_watchtower_subscription_blocks
+            = cfg.get_ulong(watchtower_subscription_blocks_key)
+                  .value_or(opts.m_watchtower_subscription_blocks);
 
         return std::nullopt;
     }
@@ -582,12 +851,20 @@ namespace cbdc::config {
                 .value_or(opts.m_election_timeout_lower));
         opts.m_heartbeat = static_cast<int32_t>(
             cfg.get_ulong(heartbeat_key).value_or(opts.m_heartbeat));
+        opts.m_leadership_transfer_timeout
+            = cfg.get_ulong(leadership_transfer_timeout_key)
+                  .value_or(opts.m_leadership_transfer_timeout);
         opts.m_snapshot_distance
             = static_cast<int32_t>(cfg.get_ulong(snapshot_distance_key)
                                        .value_or(opts.m_snapshot_distance));
         opts.m_raft_max_batch
             = static_cast<int32_t>(cfg.get_ulong(raft_batch_size_key)
                                        .value_or(opts.m_raft_max_batch));
+        opts.m_raft_entry_batch = cfg.get_ulong(raft_entry_batch_key)
+                                      .value_or(opts.m_raft_entry_batch);
+        opts.m_raft_log_cache_bytes
+            = cfg.get_ulong(raft_log_cache_bytes_key)
+                  .value_or(opts.m_raft_log_cache_bytes);
 
         opts.m_batch_size
             = cfg.get_ulong(batch_size_key).value_or(opts.m_batch_size);
@@ -604,6 +881,12 @@ namespace cbdc::config {
                                    .value_or(opts.m_fixed_tx_rate);
         opts.m_fixed_tx_mode
             = opts.m_input_count != 0 && opts.m_output_count != 0;
+        opts.m_loadgen_target_rate
+            = cfg.get_ulong(loadgen_target_rate_key)
+                  .value_or(opts.m_loadgen_target_rate);
+        opts.m_loadgen_threads = std::max<size_t>(
+            cfg.get_ulong(loadgen_threads_key).value_or(opts.m_loadgen_threads),
+            1);
         opts.m_window_size
             = cfg.get_ulong(window_size_key).value_or(opts.m_window_size);
 
@@ -616,6 +899,188 @@ namespace cbdc::config {
             = cfg.get_ulong(loadgen_count_key).value_or(opts.m_loadgen_count);
     }
 
+    void read_oracle_options(options& opts, const parser& cfg) {
+        opts.m_oracle_queue_high_water_mark
+            = cfg.get_ulong(oracle_queue_high_water_mark_key)
+                  .value_or(opts.m_oracle_queue_high_water_mark);
+        opts.m_oracle_batch_size = cfg.get_ulong(oracle_batch_size_key)
+                                       .value_or(opts.m_oracle_batch_size);
+        opts.m_oracle_pool_min_sessions
+            = cfg.get_ulong(oracle_pool_min_sessions_key)
+                  .value_or(opts.m_oracle_pool_min_sessions);
+        opts.m_oracle_pool_max_sessions
+            = cfg.get_ulong(oracle_pool_max_sessions_key)
+                  .value_or(opts.m_oracle_pool_max_sessions);
+        opts.m_oracle_pool_increment
+            = cfg.get_ulong(oracle_pool_increment_key)
+                  .value_or(opts.m_oracle_pool_increment);
+        opts.m_oracle_stmt_cache_size
+            = cfg.get_ulong(oracle_stmt_cache_size_key)
+                  .value_or(opts.m_oracle_stmt_cache_size);
+        opts.m_oracle_group_commit_window_us
+            = cfg.get_ulong(oracle_group_commit_window_key)
+                  .value_or(opts.m_oracle_group_commit_window_us);
+        opts.m_oracle_group_commit_max_rows
+            = cfg.get_ulong(oracle_group_commit_max_rows_key)
+                  .value_or(opts.m_oracle_group_commit_max_rows);
+        opts.m_oracle_group_commit_threads
+            = cfg.get_ulong(oracle_group_commit_threads_key)
+                  .value_or(opts.m_oracle_group_commit_threads);
+        opts.m_oracle_stats_interval
+            = cfg.get_ulong(oracle_stats_interval_key)
+                  .value_or(opts.m_oracle_stats_interval);
+        opts.m_oracle_tx_lookup_window_us
+            = cfg.get_ulong(oracle_tx_lookup_window_key)
+                  .value_or(opts.m_oracle_tx_lookup_window_us);
+        opts.m_oracle_tx_lookup_max_keys
+            = cfg.get_ulong(oracle_tx_lookup_max_keys_key)
+                  .value_or(opts.m_oracle_tx_lookup_max_keys);
+    }
+
+    auto read_persistence_options(options& opts, const parser& cfg)
+        -> std::optional<std::string> {
+        opts.m_wallet_audit
+            = cfg.get_ulong(wallet_audit_key).value_or(0) != 0;
+        opts.m_persistence_dir = cfg.get_string(persistence_dir_key)
+                                     .value_or(opts.m_persistence_dir);
+        opts.m_persistence_retry_backoff_ms
+            = cfg.get_ulong(persistence_retry_backoff_key)
+                  .value_or(opts.m_persistence_retry_backoff_ms);
+        opts.m_persistence_retry_max_backoff_ms
+            = cfg.get_ulong(persistence_retry_max_backoff_key)
+                  .value_or(opts.m_persistence_retry_max_backoff_ms);
+        opts.m_persistence_retry_max_attempts
+            = cfg.get_ulong(persistence_retry_max_attempts_key)
+                  .value_or(opts.m_persistence_retry_max_attempts);
+
+        const auto backend = cfg.get_string(persistence_backend_key);
+        if(!backend.has_value()) {
+            return std::nullopt;
+        }
+        static const auto backends
+            = std::unordered_map<std::string, persistence_backend>{
+                {"null", persistence_backend::null},
+                {"file", persistence_backend::file},
+                {"leveldb", persistence_backend::leveldb},
+                {"oracle", persistence_backend::oracle}};
+        const auto it = backends.find(backend.value());
+        if(it == backends.end()) {
+            return "Unknown persistence backend: " + backend.value();
+        }
+        opts.m_persistence_backend = it->second;
+        return std::nullopt;
+    }
+
+    auto read_raft_log_options(options& opts, const parser& cfg)
+        -> std::optional<std::string> {
+        opts.m_raft_log_segment_bytes
+            = cfg.get_ulong(raft_log_segment_bytes_key)
+                  .value_or(opts.m_raft_log_segment_bytes);
+        if(opts.m_raft_log_segment_bytes == 0) {
+            return "raft_log_segment_bytes must be positive";
+        }
+        read_leveldb_profile(opts.m_raft_log_leveldb, cfg, raft_log_prefix);
+
+        const auto backend = cfg.get_string(raft_log_backend_key);
+        if(!backend.has_value()) {
+            return std::nullopt;
+        }
+        static const auto backends
+            = std::unordered_map<std::string, raft_log_backend>{
+                {"leveldb", raft_log_backend::leveldb},
+                {"segment", raft_log_backend::segment}};
+        const auto it = backends.find(backend.value());
+        if(it == backends.end()) {
+            return "Unknown raft log backend: " + backend.value();
+        }
+        opts.m_raft_log_backend = it->second;
+        return std::nullopt;
+    }
+
+    auto read_network_options(options& opts, const parser& cfg)
+        -> std::optional<std::string> {
+        opts.m_local_transport
+            = cfg.get_ulong(local_transport_key).value_or(0) != 0;
+        const auto backend = cfg.get_string(network_backend_key);
+        if(!backend.has_value()) {
+            return std::nullopt;
+        }
+        static const auto backends
+            = std::unordered_map<std::string, network_backend>{
+                {"epoll", network_backend::epoll},
+                {"io_uring", network_backend::io_uring}};
+        const auto it = backends.find(backend.value());
+        if(it == backends.end()) {
+            return "Unknown network backend: " + backend.value();
+        }
+        opts.m_network_backend = it->second;
+        return std::nullopt;
+    }
+
+    auto read_log_options(options& opts, const parser& cfg)
+        -> std::optional<std::string> {
+        opts.m_log_async_capacity
+            = cfg.get_ulong(log_async_capacity_key).value_or(0);
+        const auto policy = cfg.get_string(log_overflow_policy_key);
+        if(!policy.has_value()) {
+            return std::nullopt;
+        }
+        static const auto policies
+            = std::unordered_map<std::string, logging::overflow_policy>{
+                {"block", logging::overflow_policy::block},
+                {"drop", logging::overflow_policy::drop}};
+        const auto it = policies.find(policy.value());
+        if(it == policies.end()) {
+            return "Unknown log overflow policy: " + policy.value();
+        }
+        opts.m_log_overflow = it->second;
+        return std::nullopt;
+    }
+
+    auto read_trace_options(options& opts, const parser& cfg)
+        -> std::optional<std::string> {
+        opts.m_trace_sample_rate
+            = cfg.get_decimal(trace_sample_rate_key).value_or(0);
+        if(opts.m_trace_sample_rate < 0 || opts.m_trace_sample_rate > 1) {
+            return "Trace sample rate must be between 0 and 1";
+        }
+        opts.m_trace_buffer_size = cfg.get_ulong(trace_buffer_size_key)
+                                       .value_or(opts.m_trace_buffer_size);
+        opts.m_trace_file_prefix = cfg.get_string(trace_file_prefix_key)
+                                       .value_or(opts.m_trace_file_prefix);
+        opts.m_metrics_sample_interval_ms
+            = cfg.get_ulong(metrics_sample_interval_key)
+                  .value_or(opts.m_metrics_sample_interval_ms);
+        opts.m_lock_profiling
+            = cfg.get_ulong(lock_profiling_key).value_or(0) != 0;
+        return std::nullopt;
+    }
+
+    auto read_thread_cpus_options(options& opts, const parser& cfg)
+        -> std::optional<std::string> {
+        opts.m_huge_pages
+            = cfg.get_ulong(huge_pages_key).value_or(0) != 0;
+        static const auto roles
+            = std::vector<std::pair<std::string, thread_role>>{
+                {cpus_main_key, thread_role::main},
+                {cpus_network_key, thread_role::network},
+                {cpus_raft_key, thread_role::raft},
+                {cpus_executor_key, thread_role::executor},
+                {cpus_persistence_key, thread_role::persistence}};
+        for(const auto& [key, role] : roles) {
+            const auto list = cfg.get_string(key);
+            if(!list.has_value()) {
+                continue;
+            }
+            auto cpus = parse_cpu_list(list.value());
+            if(!cpus.has_value()) {
+                return "Invalid CPU list for " + key + ": " + list.value();
+            }
+            opts.m_thread_cpus[role] = std::move(cpus.value());
+        }
+        return std::nullopt;
+    }
+
     auto read_options(const std::string& config_file)
         -> std::variant<options, std::string> {
         auto opts = options{};
@@ -662,6 +1127,38 @@ namespace cbdc::config {
 
         read_loadgen_options(opts, cfg);
 
+        read_oracle_options(opts, cfg);
+
+        err = read_persistence_options(opts, cfg);
+        if(err.has_value()) {
+            return err.value();
+        }
+
+        err = read_raft_log_options(opts, cfg);
+        if(err.has_value()) {
+            return err.value();
+        }
+
+        err = read_network_options(opts, cfg);
+        if(err.has_value()) {
+            return err.value();
+        }
+
+        err = read_log_options(opts, cfg);
+        if(err.has_value()) {
+            return err.value();
+        }
+
+        err = read_trace_options(opts, cfg);
+        if(err.has_value()) {
+            return err.value();
+        }
+
+        err = read_thread_cpus_options(opts, cfg);
+        if(err.has_value()) {
+            return err.value();
+        }
+
         return opts;
     }
 
@@ -697,6 +1194,20 @@ namespace cbdc::config {
                 return "Two-phase mode required at least one configured "
                        "coordinator";
             }
+            // Each distinct range becomes a table partition, so ranges
+            // must be equal or disjoint
+            auto ranges = opts.m_shard_ranges;
+            std::sort(ranges.begin(), ranges.end());
+            ranges.erase(std::unique(ranges.begin(), ranges.end()),
+                         ranges.end());
+            for(size_t i{0}; i < ranges.size(); i++) {
+                if(ranges[i].first > ranges[i].second) {
+                    return "Shard range start is after its end";
+                }
+                if(i > 0 && ranges[i].first <= ranges[i - 1].second) {
+                    return "Shard ranges overlap without being equal";
+                }
+            }
         } else {
             if(opts.m_watchtower_client_endpoints.empty()) {
                 return "Atomizer mode requires at least one configured "
@@ -12,6 +12,7 @@
 #ifndef OPENCBDC_TX_SRC_COMMON_CONFIG_H_
 #define OPENCBDC_TX_SRC_COMMON_CONFIG_H_
 
+#include "affinity.hpp"
 #include "hash.hpp"
 #include "hashmap.hpp"
 #include "keys.hpp"
@@ -48,21 +49,87 @@ namespace cbdc::config {
         static constexpr size_t stxo_cache_depth{1};
         static constexpr size_t window_size{10000};
         static constexpr size_t shard_completed_txs_cache_size{10000000};
+        static constexpr double shard_tx_bloom_filter_fp_rate{0.01};
+        static constexpr size_t shard_uhs_bloom_filter_items{1000000};
+        static constexpr double shard_uhs_bloom_filter_fp_rate{0.01};
+        static constexpr size_t leveldb_block_cache_bytes{8UL * 1024 * 1024};
+        static constexpr size_t leveldb_write_buffer_bytes{
+            4UL * 1024 * 1024};
+        static constexpr size_t leveldb_bloom_bits_per_key{10};
+        static constexpr size_t shard_leveldb_block_cache_bytes{
+            64UL * 1024 * 1024};
+        static constexpr size_t shard_leveldb_write_buffer_bytes{
+            16UL * 1024 * 1024};
+        static constexpr size_t shard_lock_stripes{64};
+        static constexpr size_t shard_applied_dtx_generation_size{100000};
+        static constexpr size_t shard_applied_dtx_generations{4};
+        static constexpr size_t shard_snapshot_merge_deltas{8};
+        static constexpr uint64_t shard_snapshot_catchup_blocks{1000};
+        static constexpr size_t shard_attestation_threads{0};
+        static constexpr size_t shard_group_commit_batch{1024};
+        static constexpr size_t shard_group_commit_delay_us{200};
         static constexpr size_t batch_size{2000};
         static constexpr size_t target_block_interval{250};
+        static constexpr size_t min_block_interval{10};
+        static constexpr size_t max_block_interval{2000};
+        static constexpr size_t block_seal_threshold{10000};
+        static constexpr size_t max_block_txs{100000};
         static constexpr int32_t election_timeout_upper_bound{4000};
         static constexpr int32_t election_timeout_lower_bound{2000};
         static constexpr int32_t heartbeat{1000};
+        static constexpr size_t leadership_transfer_timeout{4000};
         static constexpr int32_t raft_max_batch{100000};
+        static constexpr size_t raft_entry_batch{64};
+        static constexpr size_t raft_log_cache_bytes{64UL * 1024 * 1024};
+        static constexpr size_t raft_log_segment_bytes{64UL * 1024 * 1024};
+        static constexpr size_t archiver_segment_bytes{256UL * 1024 * 1024};
+        static constexpr int archiver_compression_level{3};
+        static constexpr size_t archiver_sync_blocks{16};
         static constexpr size_t coordinator_max_threads{75};
+        static constexpr size_t coordinator_max_linger_us{5000};
+        static constexpr size_t coordinator_recovery_concurrency{16};
+        static constexpr size_t coordinator_dedupe_cache_size{100000};
+        static constexpr int coordinator_archive_compression_level{3};
+        static constexpr size_t coordinator_snapshot_merge_deltas{8};
+        static constexpr size_t sentinel_batch_size{100};
+        static constexpr size_t shard_notify_batch_size{100};
+        static constexpr size_t shard_notify_linger_us{200};
+        static constexpr size_t sentinel_batch_linger_us{500};
+        static constexpr size_t sentinel_batch_max_queued{10000};
+        static constexpr size_t sentinel_shard_batch_size{100};
+        static constexpr size_t sentinel_shard_batch_linger_us{200};
+        static constexpr size_t sentinel_validation_threads{0};
+        static constexpr size_t sentinel_attestation_linger_us{200};
+        static constexpr size_t sentinel_coordinator_max_in_flight{0};
+        static constexpr size_t sentinel_coordinator_timeout_ms{0};
+        static constexpr size_t sentinel_dedupe_cache_size{100000};
         static constexpr size_t initial_mint_count{20000};
         static constexpr size_t initial_mint_value{100};
         static constexpr size_t watchtower_block_cache_size{100};
         static constexpr size_t watchtower_error_cache_size{1000000};
+        static constexpr size_t watchtower_subscription_blocks{100};
         static constexpr size_t input_count{2};
         static constexpr size_t output_count{2};
         static constexpr double fixed_tx_rate{1.0};
         static constexpr size_t attestation_threshold{1};
+        static constexpr size_t oracle_queue_high_water_mark{100000};
+        static constexpr size_t oracle_batch_size{10000};
+        static constexpr size_t oracle_pool_min_sessions{1};
+        static constexpr size_t oracle_pool_max_sessions{16};
+        static constexpr size_t oracle_pool_increment{1};
+        static constexpr size_t oracle_stmt_cache_size{20};
+        static constexpr size_t oracle_group_commit_window_us{1000};
+        static constexpr size_t oracle_group_commit_max_rows{512};
+        static constexpr size_t oracle_group_commit_threads{1};
+        static constexpr size_t oracle_stats_interval{10};
+        static constexpr size_t oracle_tx_lookup_window_us{500};
+        static constexpr size_t oracle_tx_lookup_max_keys{64};
+        static constexpr size_t persistence_retry_backoff_ms{100};
+        static constexpr size_t persistence_retry_max_backoff_ms{10000};
+        static constexpr size_t persistence_retry_max_attempts{10};
+        static constexpr size_t trace_buffer_size{65536};
+        static constexpr auto trace_file_prefix = "trace_";
+        static constexpr size_t metrics_sample_interval_ms{10000};
 
         static constexpr auto log_level = logging::log_level::warn;
     }
@@ -71,36 +138,86 @@ namespace cbdc::config {
     static constexpr auto loglevel_postfix = "loglevel";
     static constexpr auto raft_endpoint_postfix = "raft_endpoint";
     static constexpr auto stxo_cache_key = "stxo_cache_depth";
+    static constexpr auto atomizer_check_threads_key
+        = "atomizer_check_threads";
     static constexpr auto shard_count_key = "shard_count";
     static constexpr auto shard_prefix = "shard";
     static constexpr auto seed_privkey = "seed_privkey";
     static constexpr auto seed_value = "seed_value";
     static constexpr auto seed_from = "seed_from";
     static constexpr auto seed_to = "seed_to";
+    static constexpr auto seed_oracle_table_key = "seed_oracle_table";
+    static constexpr auto seed_oracle_partitioned_key
+        = "seed_oracle_partitioned";
     static constexpr auto atomizer_prefix = "atomizer";
     static constexpr auto sentinel_count_key = "sentinel_count";
     static constexpr auto sentinel_prefix = "sentinel";
+    static constexpr auto sentinel_batch_size_key = "sentinel_batch_size";
+    static constexpr auto sentinel_batch_linger_key
+        = "sentinel_batch_linger_us";
+    static constexpr auto sentinel_batch_max_queued_key
+        = "sentinel_batch_max_queued";
+    static constexpr auto sentinel_shard_batch_size_key
+        = "sentinel_shard_batch_size";
+    static constexpr auto sentinel_shard_batch_linger_key
+        = "sentinel_shard_batch_linger_us";
+    static constexpr auto sentinel_validation_threads_key
+        = "sentinel_validation_threads";
+    static constexpr auto sentinel_coordinator_routing_key
+        = "sentinel_coordinator_routing";
+    static constexpr auto sentinel_coordinator_max_in_flight_key
+        = "sentinel_coordinator_max_in_flight";
+    static constexpr auto sentinel_coordinator_timeout_key
+        = "sentinel_coordinator_timeout_ms";
+    static constexpr auto sentinel_attestation_linger_key
+        = "sentinel_attestation_linger_us";
+    static constexpr auto sentinel_aggregate_attestations_key
+        = "sentinel_aggregate_attestations";
+    static constexpr auto sentinel_dedupe_cache_size_key
+        = "sentinel_dedupe_cache_size";
     static constexpr auto config_separator = "_";
     static constexpr auto db_postfix = "db";
     static constexpr auto start_postfix = "start";
     static constexpr auto end_postfix = "end";
+    static constexpr auto joining_postfix = "joining";
     static constexpr auto atomizer_count_key = "atomizer_count";
     static constexpr auto archiver_prefix = "archiver";
     static constexpr auto batch_size_key = "batch_size";
     static constexpr auto window_size_key = "window_size";
     static constexpr auto target_block_interval_key = "target_block_interval";
+    static constexpr auto min_block_interval_key = "min_block_interval";
+    static constexpr auto max_block_interval_key = "max_block_interval";
+    static constexpr auto block_seal_threshold_key = "block_seal_threshold";
+    static constexpr auto max_block_txs_key = "max_block_txs";
     static constexpr auto election_timeout_upper_key
         = "election_timeout_upper";
     static constexpr auto election_timeout_lower_key
         = "election_timeout_lower";
     static constexpr auto heartbeat_key = "heartbeat";
+    static constexpr auto leadership_transfer_timeout_key
+        = "leadership_transfer_timeout";
     static constexpr auto snapshot_distance_key = "snapshot_distance";
     static constexpr auto raft_batch_size_key = "raft_max_batch";
+    static constexpr auto raft_entry_batch_key = "raft_entry_batch";
+    static constexpr auto raft_log_cache_bytes_key = "raft_log_cache_bytes";
+    static constexpr auto raft_log_backend_key = "raft_log_backend";
+    static constexpr auto raft_log_segment_bytes_key
+        = "raft_log_segment_bytes";
     static constexpr auto input_count_key = "loadgen_sendtx_input_count";
     static constexpr auto output_count_key = "loadgen_sendtx_output_count";
     static constexpr auto invalid_rate_key = "loadgen_invalid_tx_rate";
     static constexpr auto fixed_tx_rate_key = "loadgen_fixed_tx_rate";
+    static constexpr auto loadgen_target_rate_key = "loadgen_target_rate";
+    static constexpr auto loadgen_threads_key = "loadgen_threads";
     static constexpr auto archiver_count_key = "archiver_count";
+    static constexpr auto archiver_backend_key = "archiver_backend";
+    static constexpr auto archiver_segment_bytes_key
+        = "archiver_segment_bytes";
+    static constexpr auto archiver_compression_level_key
+        = "archiver_compression_level";
+    static constexpr auto archiver_sync_blocks_key = "archiver_sync_blocks";
+    static constexpr auto archiver_digest_threads_key
+        = "archiver_digest_threads";
     static constexpr auto watchtower_count_key = "watchtower_count";
     static constexpr auto watchtower_prefix = "watchtower";
     static constexpr auto watchtower_client_ep_postfix = "client_endpoint";
@@ -109,21 +226,178 @@ namespace cbdc::config {
         = "watchtower_block_cache_size";
     static constexpr auto watchtower_error_cache_size_key
         = "watchtower_error_cache_size";
+    static constexpr auto watchtower_subscription_blocks_key
+        = "watchtower_subscription_blocks";
     static constexpr auto two_phase_mode = "2pc";
     static constexpr auto count_postfix = "count";
     static constexpr auto readonly = "readonly";
+    static constexpr auto metrics_endpoint_postfix = "metrics_endpoint";
     static constexpr auto coordinator_prefix = "coordinator";
     static constexpr auto coordinator_count_key = "coordinator_count";
     static constexpr auto coordinator_max_threads = "coordinator_max_threads";
+    static constexpr auto coordinator_journal_key = "coordinator_journal";
+    static constexpr auto coordinator_archive_key = "coordinator_archive";
+    static constexpr auto coordinator_archive_compression_level_key
+        = "coordinator_archive_compression_level";
+    static constexpr auto coordinator_target_latency_key
+        = "coordinator_target_latency_us";
+    static constexpr auto coordinator_max_linger_key
+        = "coordinator_max_linger_us";
+    static constexpr auto coordinator_recovery_concurrency_key
+        = "coordinator_recovery_concurrency";
+    static constexpr auto coordinator_dedupe_cache_size_key
+        = "coordinator_dedupe_cache_size";
+    static constexpr auto coordinator_snapshot_distance_key
+        = "coordinator_snapshot_distance";
+    static constexpr auto coordinator_snapshot_merge_deltas_key
+        = "coordinator_snapshot_merge_deltas";
     static constexpr auto initial_mint_count_key = "initial_mint_count";
     static constexpr auto initial_mint_value_key = "initial_mint_value";
     static constexpr auto loadgen_count_key = "loadgen_count";
     static constexpr auto shard_completed_txs_cache_size
         = "shard_completed_txs_cache_size";
+    static constexpr auto shard_tx_bloom_filter_items_key
+        = "shard_tx_bloom_filter_items";
+    static constexpr auto shard_tx_bloom_filter_fp_rate_key
+        = "shard_tx_bloom_filter_fp_rate";
+    static constexpr auto shard_lock_stripes_key = "shard_lock_stripes";
+    static constexpr auto shard_read_index_key = "shard_read_index";
+    static constexpr auto shard_attestation_threads_key
+        = "shard_attestation_threads";
+    static constexpr auto shard_applied_dtx_generation_size_key
+        = "shard_applied_dtx_generation_size";
+    static constexpr auto shard_applied_dtx_generations_key
+        = "shard_applied_dtx_generations";
+    static constexpr auto shard_snapshot_merge_deltas_key
+        = "shard_snapshot_merge_deltas";
+    static constexpr auto shard_digest_threads_key = "shard_digest_threads";
+    static constexpr auto shard_notify_batch_size_key
+        = "shard_notify_batch_size";
+    static constexpr auto shard_notify_linger_us_key
+        = "shard_notify_linger_us";
+    static constexpr auto shard_uhs_bloom_filter_items_key
+        = "shard_uhs_bloom_filter_items";
+    static constexpr auto shard_uhs_bloom_filter_fp_rate_key
+        = "shard_uhs_bloom_filter_fp_rate";
+    static constexpr auto leveldb_block_cache_bytes_postfix
+        = "leveldb_block_cache_bytes";
+    static constexpr auto leveldb_write_buffer_bytes_postfix
+        = "leveldb_write_buffer_bytes";
+    static constexpr auto leveldb_bloom_bits_postfix = "leveldb_bloom_bits";
+    static constexpr auto leveldb_compression_postfix
+        = "leveldb_compression";
+    static constexpr auto raft_log_prefix = "raft_log";
+    static constexpr auto shard_uhs_export_dir_key = "shard_uhs_export_dir";
+    static constexpr auto shard_uhs_export_interval_key
+        = "shard_uhs_export_interval";
+    static constexpr auto shard_snapshot_catchup_blocks_key
+        = "shard_snapshot_catchup_blocks";
     static constexpr auto wait_for_followers_key = "wait_for_followers";
     static constexpr auto private_key_postfix = "private_key";
     static constexpr auto public_key_postfix = "public_key";
+    static constexpr auto capture_postfix = "capture";
     static constexpr auto attestation_threshold_key = "attestation_threshold";
+    static constexpr auto oracle_queue_high_water_mark_key
+        = "oracle_queue_high_water_mark";
+    static constexpr auto oracle_batch_size_key = "oracle_batch_size";
+    static constexpr auto oracle_pool_min_sessions_key
+        = "oracle_pool_min_sessions";
+    static constexpr auto oracle_pool_max_sessions_key
+        = "oracle_pool_max_sessions";
+    static constexpr auto oracle_pool_increment_key = "oracle_pool_increment";
+    static constexpr auto oracle_stmt_cache_size_key
+        = "oracle_stmt_cache_size";
+    static constexpr auto oracle_group_commit_window_key
+        = "oracle_group_commit_window_us";
+    static constexpr auto oracle_group_commit_max_rows_key
+        = "oracle_group_commit_max_rows";
+    static constexpr auto oracle_group_commit_threads_key
+        = "oracle_group_commit_threads";
+    static constexpr auto oracle_stats_interval_key = "oracle_stats_interval";
+    static constexpr auto oracle_tx_lookup_window_key
+        = "oracle_tx_lookup_window_us";
+    static constexpr auto oracle_tx_lookup_max_keys_key
+        = "oracle_tx_lookup_max_keys";
+    static constexpr auto wallet_audit_key = "wallet_audit";
+    static constexpr auto persistence_backend_key = "persistence_backend";
+    static constexpr auto persistence_dir_key = "persistence_dir";
+    static constexpr auto persistence_retry_backoff_key
+        = "persistence_retry_backoff_ms";
+    static constexpr auto persistence_retry_max_backoff_key
+        = "persistence_retry_max_backoff_ms";
+    static constexpr auto persistence_retry_max_attempts_key
+        = "persistence_retry_max_attempts";
+    static constexpr auto network_backend_key = "network_backend";
+    static constexpr auto local_transport_key = "local_transport";
+    static constexpr auto huge_pages_key = "huge_pages";
+    static constexpr auto log_async_capacity_key = "log_async_capacity";
+    static constexpr auto log_overflow_policy_key = "log_overflow_policy";
+    static constexpr auto trace_sample_rate_key = "trace_sample_rate";
+    static constexpr auto trace_buffer_size_key = "trace_buffer_size";
+    static constexpr auto trace_file_prefix_key = "trace_file_prefix";
+    static constexpr auto metrics_sample_interval_key
+        = "metrics_sample_interval_ms";
+    static constexpr auto lock_profiling_key = "lock_profiling";
+    static constexpr auto cpus_main_key = "cpus_main";
+    static constexpr auto cpus_network_key = "cpus_network";
+    static constexpr auto cpus_raft_key = "cpus_raft";
+    static constexpr auto cpus_executor_key = "cpus_executor";
+    static constexpr auto cpus_persistence_key = "cpus_persistence";
+
+    /// Storage backend for audit records persisted off the hot path.
+    enum class persistence_backend {
+        /// Discard all records.
+        null,
+        /// Append-only local file per table.
+        file,
+        /// Local LevelDB database per table.
+        leveldb,
+        /// Oracle Autonomous Database.
+        oracle
+    };
+
+    /// Storage for raft logs.
+    enum class raft_log_backend {
+        /// LevelDB database.
+        leveldb,
+        /// Preallocated, memory-mapped segment files.
+        segment
+    };
+
+    /// Storage for archived blocks.
+    enum class archiver_backend {
+        /// LevelDB database.
+        leveldb,
+        /// Append-only, compressed segment files.
+        segment
+    };
+
+    /// I/O mechanism used by the network layer's I/O threads.
+    enum class network_backend {
+        /// Readiness polling with epoll, or kqueue on macOS.
+        epoll,
+        /// Completion-based I/O with io_uring on Linux. Falls back to epoll
+        /// where io_uring is unavailable.
+        io_uring
+    };
+
+    /// Tuning of a LevelDB database, read for each role from the keys
+    /// <role>_leveldb_block_cache_bytes, <role>_leveldb_write_buffer_bytes,
+    /// <role>_leveldb_bloom_bits and <role>_leveldb_compression.
+    struct leveldb_profile {
+        /// Size in bytes of the LRU cache of uncompressed table blocks.
+        /// Zero leaves LevelDB to allocate its own small cache.
+        size_t m_block_cache_bytes{defaults::leveldb_block_cache_bytes};
+        /// Size in bytes of the in-memory table which buffers writes
+        /// before they are sorted into a table file.
+        size_t m_write_buffer_bytes{defaults::leveldb_write_buffer_bytes};
+        /// Bits per key of the Bloom filter kept for each table, which
+        /// lets point lookups skip tables that cannot hold the key. Zero
+        /// disables the filters.
+        size_t m_bloom_bits_per_key{defaults::leveldb_bloom_bits_per_key};
+        /// Flag set to compress table blocks with Snappy.
+        bool m_compression{true};
+    };
 
     /// [start, end] inclusive.
     using shard_range_t = std::pair<uint8_t, uint8_t>;
@@ -132,6 +406,10 @@ namespace cbdc::config {
     struct options {
         /// Depth of the spent transaction cache in the atomizer, in blocks.
         size_t m_stxo_cache_depth{defaults::stxo_cache_depth};
+        /// Number of threads each atomizer checks batches of transaction
+        /// notifications against its spent cache on. Zero uses one per
+        /// hardware thread.
+        size_t m_atomizer_check_threads{0};
         /// Maximum number of unconfirmed transactions in atomizer-cli.
         size_t m_window_size{defaults::window_size};
         /// Number of inputs in fixed-size transactions from atomizer-cli.
@@ -142,11 +420,91 @@ namespace cbdc::config {
         double m_invalid_rate{0.0};
         /// Proportion of fixed transactions sent from atomizer-cli.
         double m_fixed_tx_rate{defaults::fixed_tx_rate};
+        /// Transactions per second each twophase-gen sends in open-loop
+        /// mode, regardless of how many are awaiting confirmation. Zero
+        /// runs the generator in a closed loop.
+        size_t m_loadgen_target_rate{0};
+        /// Number of threads, each with its own wallet, sharing the target
+        /// rate of an open-loop twophase-gen.
+        size_t m_loadgen_threads{1};
         /// The number of completed transactions that each locking shard (2PC)
         /// keeps in memory for responding to queries through the read-only
         /// endpoint.
         size_t m_shard_completed_txs_cache_size{
             defaults::shard_completed_txs_cache_size};
+        /// Number of TX IDs each locking shard (2PC) sizes its Bloom filter
+        /// of persisted TX IDs for. Lookups the filter rules out skip the
+        /// Oracle cold tier. Zero disables the filter.
+        size_t m_shard_tx_bloom_filter_items{0};
+        /// Target false positive rate of the locking shard TX ID Bloom
+        /// filter.
+        double m_shard_tx_bloom_filter_fp_rate{
+            defaults::shard_tx_bloom_filter_fp_rate};
+        /// Number of independently locked partitions each locking shard
+        /// (2PC) splits its UHS into. Dtxs touching disjoint partitions
+        /// lock and apply in parallel.
+        size_t m_shard_lock_stripes{defaults::shard_lock_stripes};
+        /// Whether locking shard (2PC) replicas confirm the cluster
+        /// leader's commit index and catch up to it before answering each
+        /// status query, so any replica's answer reflects every committed
+        /// change. Otherwise followers answer from their own, possibly
+        /// lagging, state.
+        bool m_shard_read_index{true};
+        /// Number of threads each locking shard (2PC) spreads the
+        /// attestation checks of one dtx across. Zero uses one per
+        /// hardware thread, and one checks on the calling thread.
+        size_t m_shard_attestation_threads{
+            defaults::shard_attestation_threads};
+        /// Number of dtxs each locking shard (2PC) applies before sealing
+        /// its current generation of applied dtx IDs.
+        size_t m_shard_applied_dtx_generation_size{
+            defaults::shard_applied_dtx_generation_size};
+        /// Number of sealed generations of applied dtx IDs each locking
+        /// shard (2PC) keeps to answer repeated applies for dtxs whose
+        /// discard never arrived. Older generations are dropped.
+        size_t m_shard_applied_dtx_generations{
+            defaults::shard_applied_dtx_generations};
+        /// Number of incremental snapshots of a locking shard (2PC) after
+        /// which they are merged into a new full snapshot in the
+        /// background. Zero disables merging.
+        size_t m_shard_snapshot_merge_deltas{
+            defaults::shard_snapshot_merge_deltas};
+        /// Number of threads each atomizer shard builds the database
+        /// updates of a block on. Zero uses one per hardware thread, and
+        /// one builds them on the calling thread.
+        size_t m_shard_digest_threads{0};
+        /// Maximum number of transaction notifications each atomizer shard
+        /// sends to the atomizer in one message.
+        size_t m_shard_notify_batch_size{defaults::shard_notify_batch_size};
+        /// Longest time, in microseconds, an atomizer shard waits for more
+        /// transaction notifications before sending a partial batch.
+        size_t m_shard_notify_linger_us{defaults::shard_notify_linger_us};
+        /// Minimum number of UHS IDs each atomizer shard sizes its Bloom
+        /// filter of unspent outputs for. Inputs the filter rules out are
+        /// rejected without a database lookup. Zero disables the filter.
+        size_t m_shard_uhs_bloom_filter_items{
+            defaults::shard_uhs_bloom_filter_items};
+        /// Target false positive rate of the atomizer shard UHS Bloom
+        /// filter.
+        double m_shard_uhs_bloom_filter_fp_rate{
+            defaults::shard_uhs_bloom_filter_fp_rate};
+        /// Tuning of the atomizer shards' UHS databases.
+        leveldb_profile m_shard_leveldb{
+            defaults::shard_leveldb_block_cache_bytes,
+            defaults::shard_leveldb_write_buffer_bytes};
+        /// Directory in which shards write exports of their unspent set
+        /// for auditing.
+        std::string m_shard_uhs_export_dir{"."};
+        /// Number of blocks, for atomizer shards, or raft log entries, for
+        /// locking shards, between exports of the unspent set. Zero
+        /// disables exports.
+        uint64_t m_shard_uhs_export_interval{0};
+        /// Number of blocks an atomizer shard must be behind before it
+        /// catches up by importing the most recent UHS export of a peer
+        /// shard covering its range, rather than digesting every missed
+        /// block. Zero disables catching up from peers.
+        uint64_t m_shard_snapshot_catchup_blocks{
+            defaults::shard_snapshot_catchup_blocks};
 
         /// List of atomizer endpoints, ordered by atomizer ID.
         std::vector<network::endpoint_t> m_atomizer_endpoints;
@@ -154,10 +512,17 @@ namespace cbdc::config {
         std::vector<network::endpoint_t> m_archiver_endpoints;
         /// List of sentinel endpoints, ordered by sentinel ID.
         std::vector<network::endpoint_t> m_sentinel_endpoints;
+        /// Optional Prometheus metrics endpoints, ordered by sentinel ID.
+        std::vector<std::optional<network::endpoint_t>>
+            m_sentinel_metrics_endpoints;
         /// List of watchtower client endpoints, ordered by watchtower ID.
         std::vector<network::endpoint_t> m_watchtower_client_endpoints;
         /// List of watchtower internal endpoints, ordered by watchtower ID
         std::vector<network::endpoint_t> m_watchtower_internal_endpoints;
+        /// Range of UHS IDs indexed by each watchtower, ordered by
+        /// watchtower ID. Watchtowers without a configured range index
+        /// every UHS ID.
+        std::vector<shard_range_t> m_watchtower_ranges;
         /// List of shard endpoints, ordered by shard ID.
         std::vector<network::endpoint_t> m_shard_endpoints;
         /// List of atomizer raft endpoints, ordered by atomizer ID.
@@ -167,6 +532,21 @@ namespace cbdc::config {
         size_t m_batch_size{defaults::batch_size};
         /// Target block creation interval in the atomizer in milliseconds.
         size_t m_target_block_interval{defaults::target_block_interval};
+        /// Shortest interval between blocks in the atomizer in
+        /// milliseconds, when pending transactions reach
+        /// m_block_seal_threshold.
+        size_t m_min_block_interval{defaults::min_block_interval};
+        /// Longest interval between blocks in the atomizer in milliseconds.
+        /// While no transactions are pending the interval doubles from
+        /// m_target_block_interval up to this value.
+        size_t m_max_block_interval{defaults::max_block_interval};
+        /// Number of complete transactions pending in the atomizer at
+        /// which a block is made without waiting for the target interval.
+        /// Zero disables early blocks.
+        size_t m_block_seal_threshold{defaults::block_seal_threshold};
+        /// Maximum number of transactions in an atomizer block, or zero for
+        /// no limit. Transactions past the limit go into the next block.
+        size_t m_max_block_txs{defaults::max_block_txs};
         /// List of atomizer log levels by atomizer ID.
         std::vector<logging::log_level> m_atomizer_loglevels;
         /// Raft election timeout upper bound in milliseconds.
@@ -177,10 +557,31 @@ namespace cbdc::config {
             defaults::election_timeout_lower_bound};
         /// Raft heartbeat timeout in milliseconds.
         int32_t m_heartbeat{defaults::heartbeat};
+        /// Longest a raft leader waits, when shutting down, to hand
+        /// leadership to an up-to-date follower, in milliseconds. Zero
+        /// shuts down without a handoff, leaving the followers to elect a
+        /// new leader once the election timeout passes.
+        size_t m_leadership_transfer_timeout{
+            defaults::leadership_transfer_timeout};
         /// Raft snapshot distance, in number of log entries.
         int32_t m_snapshot_distance{0};
         /// Maximum number of raft log entries to batch into one RPC message.
         int32_t m_raft_max_batch{defaults::raft_max_batch};
+        /// Maximum number of coordinator or locking shard commands the
+        /// leader combines into one raft log entry, so followers apply
+        /// them as a run. One logs each command separately.
+        size_t m_raft_entry_batch{defaults::raft_entry_batch};
+        /// Size limit in bytes of the in-memory cache of recent raft log
+        /// entries. Zero disables the cache.
+        size_t m_raft_log_cache_bytes{defaults::raft_log_cache_bytes};
+        /// Storage backend for raft logs.
+        raft_log_backend m_raft_log_backend{raft_log_backend::leveldb};
+        /// Size in bytes of each preallocated raft log segment file, when
+        /// using the segment backend.
+        size_t m_raft_log_segment_bytes{defaults::raft_log_segment_bytes};
+        /// Tuning of the raft log database, when using the LevelDB
+        /// backend.
+        leveldb_profile m_raft_log_leveldb{};
         /// List of shard log levels by shard ID.
         std::vector<logging::log_level> m_shard_loglevels;
         /// List of shard DB paths by shard ID.
@@ -188,6 +589,11 @@ namespace cbdc::config {
         /// List of shard UHS ID ranges by shard ID. Each shard range is
         /// inclusive of the start and end of the range.
         std::vector<shard_range_t> m_shard_ranges;
+        /// Flags by shard ID, true for locking shard clusters which are
+        /// started empty to take over part of another shard's range.
+        /// Coordinators route nothing to them until told to by a range
+        /// move.
+        std::vector<bool> m_shard_joining;
 
         /// private key used for initial seed.
         std::optional<privkey_t> m_seed_privkey;
@@ -197,6 +603,13 @@ namespace cbdc::config {
         size_t m_seed_from{0};
         /// ending index for faked input used for initial seed.
         size_t m_seed_to{0};
+        /// Oracle table into which the shard-seeder direct path loads the
+        /// seeded UHS IDs, if any.
+        std::optional<std::string> m_seed_oracle_table;
+        /// Flag set if the seeded Oracle table has one partition per shard
+        /// range, named by oracle::shard_partition_name, so each shard is
+        /// loaded into its own partition.
+        bool m_seed_oracle_partitioned{false};
 
         /// List of sentinel log levels by sentinel ID.
         std::vector<logging::log_level> m_sentinel_loglevels;
@@ -206,6 +619,31 @@ namespace cbdc::config {
         std::vector<logging::log_level> m_watchtower_loglevels;
         /// List of archiver DB paths by archiver ID.
         std::vector<std::string> m_archiver_db_dirs;
+        /// Storage backend for archived blocks.
+        archiver_backend m_archiver_backend{archiver_backend::leveldb};
+        /// Size in bytes at which the archiver starts a new segment file,
+        /// when using the segment backend.
+        size_t m_archiver_segment_bytes{defaults::archiver_segment_bytes};
+        /// zstd compression level of archived blocks, when using the
+        /// segment backend.
+        int m_archiver_compression_level{
+            defaults::archiver_compression_level};
+        /// Number of blocks the archiver appends between syncs to disk,
+        /// when using the segment backend. Blocks are pruned from the
+        /// atomizers only once synced.
+        size_t m_archiver_sync_blocks{defaults::archiver_sync_blocks};
+        /// Number of threads the archiver uses to serialize and compress a
+        /// run of contiguous blocks. Zero uses one thread per hardware
+        /// thread.
+        size_t m_archiver_digest_threads{0};
+        /// Tuning of the archiver database, when using the LevelDB
+        /// backend. Blocks are stored uncompressed by default as they
+        /// are mostly random hashes.
+        leveldb_profile m_archiver_leveldb{
+            defaults::leveldb_block_cache_bytes,
+            defaults::leveldb_write_buffer_bytes,
+            defaults::leveldb_bloom_bits_per_key,
+            false};
         /// Flag set if m_input_count or m_output_count are greater than zero.
         /// Causes the atomizer-cli to send fixed-size transactions.
         bool m_fixed_tx_mode{false};
@@ -222,14 +660,58 @@ namespace cbdc::config {
         /// node ID.
         std::vector<std::vector<network::endpoint_t>>
             m_locking_shard_readonly_endpoints;
+        /// Optional Prometheus metrics endpoints for locking shards, ordered
+        /// by shard ID then node ID.
+        std::vector<std::vector<std::optional<network::endpoint_t>>>
+            m_locking_shard_metrics_endpoints;
         /// List of coordinator endpoints, ordered by shard ID then node ID.
         std::vector<std::vector<network::endpoint_t>> m_coordinator_endpoints;
         /// List of coordinator raft endpoints, ordered by shard ID then node
         /// ID.
         std::vector<std::vector<network::endpoint_t>>
             m_coordinator_raft_endpoints;
+        /// Optional Prometheus metrics endpoints for coordinators, ordered by
+        /// coordinator ID then node ID.
+        std::vector<std::vector<std::optional<network::endpoint_t>>>
+            m_coordinator_metrics_endpoints;
         /// Coordinator thread count limit.
         size_t m_coordinator_max_threads{defaults::coordinator_max_threads};
+        /// Flag set if coordinators should journal each replicated dtx
+        /// phase transition to the persistence backend.
+        bool m_coordinator_journal{false};
+        /// Flag set if coordinators should archive the full transactions
+        /// of each committed dtx, compressed into one blob per dtx, to the
+        /// persistence backend.
+        bool m_coordinator_archive{false};
+        /// zstd compression level of archived dtxs.
+        int m_coordinator_archive_compression_level{
+            defaults::coordinator_archive_compression_level};
+        /// 99th percentile dtx batch latency, in microseconds, that
+        /// coordinators adapt their batch size to meet. Zero keeps the
+        /// batch size fixed at m_batch_size, which is otherwise the upper
+        /// limit.
+        size_t m_coordinator_target_latency_us{0};
+        /// Longest time, in microseconds, an adaptive coordinator waits for
+        /// a partial batch to fill before executing it.
+        size_t m_coordinator_max_linger_us{
+            defaults::coordinator_max_linger_us};
+        /// Maximum number of recovered dtxs a new coordinator leader
+        /// executes at once. Always leaves at least one executor thread
+        /// free for new batches.
+        size_t m_coordinator_recovery_concurrency{
+            defaults::coordinator_recovery_concurrency};
+        /// Number of recent transaction results a coordinator leader keeps
+        /// to answer resubmitted transactions without executing them again.
+        size_t m_coordinator_dedupe_cache_size{
+            defaults::coordinator_dedupe_cache_size};
+        /// Raft snapshot distance of the coordinators, in number of log
+        /// entries. Zero disables coordinator snapshots.
+        int32_t m_coordinator_snapshot_distance{0};
+        /// Number of incremental coordinator snapshots after which they are
+        /// merged into a new full snapshot in the background. Zero disables
+        /// merging.
+        size_t m_coordinator_snapshot_merge_deltas{
+            defaults::coordinator_snapshot_merge_deltas};
         /// List of coordinator log levels, ordered by coordinator ID.
         std::vector<logging::log_level> m_coordinator_loglevels;
 
@@ -246,6 +728,11 @@ namespace cbdc::config {
         /// (0=unlimited).
         size_t m_watchtower_error_cache_size{
             defaults::watchtower_error_cache_size};
+        /// Number of blocks after which a watchtower answers a status
+        /// subscription that is still unresolved with the current statuses
+        /// and drops it.
+        size_t m_watchtower_subscription_blocks{
+            defaults::watchtower_subscription_blocks};
 
         /// Number of load generators over which to split pre-seeded UTXOs.
         size_t m_loadgen_count{0};
@@ -258,6 +745,159 @@ namespace cbdc::config {
 
         /// Number of sentinel attestations needed for a compact transaction.
         size_t m_attestation_threshold{defaults::attestation_threshold};
+
+        /// Maximum number of compact transactions a sentinel sends to its
+        /// coordinator in one request.
+        size_t m_sentinel_batch_size{defaults::sentinel_batch_size};
+        /// Longest time, in microseconds, a sentinel waits for more
+        /// transactions before sending a partial batch to its coordinator.
+        size_t m_sentinel_batch_linger_us{defaults::sentinel_batch_linger_us};
+        /// Maximum number of compact transactions a sentinel holds waiting
+        /// to be sent to its coordinator. Transactions arriving while the
+        /// queue is full fail, so clients retry them later.
+        size_t m_sentinel_batch_max_queued{
+            defaults::sentinel_batch_max_queued};
+        /// Maximum number of compact transactions an atomizer sentinel
+        /// sends to each shard in one message.
+        size_t m_sentinel_shard_batch_size{
+            defaults::sentinel_shard_batch_size};
+        /// Longest time, in microseconds, an atomizer sentinel waits for
+        /// more transactions before sending a partial batch to a shard.
+        size_t m_sentinel_shard_batch_linger_us{
+            defaults::sentinel_shard_batch_linger_us};
+        /// Number of threads each sentinel (2PC) validates and attests to
+        /// transactions on. Zero uses one per hardware thread.
+        size_t m_sentinel_validation_threads{
+            defaults::sentinel_validation_threads};
+        /// Whether sentinels (2PC) spread transactions across all
+        /// coordinator clusters by transaction ID. Otherwise each sentinel
+        /// sends to one cluster picked by its ID.
+        bool m_sentinel_coordinator_routing{true};
+        /// Maximum number of requests a sentinel (2PC) leaves awaiting a
+        /// response from each coordinator cluster before further requests
+        /// wait. Zero for no limit.
+        size_t m_sentinel_coordinator_max_in_flight{
+            defaults::sentinel_coordinator_max_in_flight};
+        /// Milliseconds after which a sentinel (2PC) fails a coordinator
+        /// request without a response. Zero for no timeout.
+        size_t m_sentinel_coordinator_timeout_ms{
+            defaults::sentinel_coordinator_timeout_ms};
+        /// Longest time, in microseconds, a sentinel (2PC) waits for more
+        /// transactions before asking a peer sentinel to attest to a
+        /// partial batch.
+        size_t m_sentinel_attestation_linger_us{
+            defaults::sentinel_attestation_linger_us};
+        /// Whether sentinels (2PC) combine the attestations of each
+        /// transaction into one half-aggregated signature before sending it
+        /// to a coordinator. Aggregates name signers by their position
+        /// among the first 64 sentinel keys in ascending order.
+        bool m_sentinel_aggregate_attestations{false};
+        /// Number of recent transaction results a sentinel (2PC) keeps to
+        /// answer resubmitted transactions without processing them again.
+        size_t m_sentinel_dedupe_cache_size{
+            defaults::sentinel_dedupe_cache_size};
+        /// Files to which each sentinel records the transactions clients
+        /// send it, with their arrival times, ordered by sentinel ID.
+        /// std::nullopt disables capture for that sentinel.
+        std::vector<std::optional<std::string>> m_sentinel_capture_paths;
+
+        /// Maximum number of records waiting in an Oracle write-behind queue
+        /// before producers block.
+        size_t m_oracle_queue_high_water_mark{
+            defaults::oracle_queue_high_water_mark};
+        /// Maximum number of rows sent to Oracle in one array insert.
+        size_t m_oracle_batch_size{defaults::oracle_batch_size};
+        /// Number of sessions each Oracle session pool opens up front.
+        size_t m_oracle_pool_min_sessions{defaults::oracle_pool_min_sessions};
+        /// Maximum number of open sessions in each Oracle session pool.
+        size_t m_oracle_pool_max_sessions{defaults::oracle_pool_max_sessions};
+        /// Number of sessions an Oracle session pool opens when it grows.
+        size_t m_oracle_pool_increment{defaults::oracle_pool_increment};
+        /// Number of prepared statements cached by each Oracle session.
+        size_t m_oracle_stmt_cache_size{defaults::oracle_stmt_cache_size};
+        /// Maximum time in microseconds an Oracle group commit waits for
+        /// concurrent rows before committing.
+        size_t m_oracle_group_commit_window_us{
+            defaults::oracle_group_commit_window_us};
+        /// Number of rows which closes an Oracle group commit early.
+        size_t m_oracle_group_commit_max_rows{
+            defaults::oracle_group_commit_max_rows};
+        /// Number of Oracle group commits in flight at once, each sent by
+        /// its own thread over its own pooled session.
+        size_t m_oracle_group_commit_threads{
+            defaults::oracle_group_commit_threads};
+        /// Seconds between client-side Oracle statistics reports. Zero
+        /// disables reporting.
+        size_t m_oracle_stats_interval{defaults::oracle_stats_interval};
+        /// Maximum time in microseconds a batched Oracle TX ID lookup waits
+        /// for concurrent lookups before querying.
+        size_t m_oracle_tx_lookup_window_us{
+            defaults::oracle_tx_lookup_window_us};
+        /// Number of TX IDs which closes a batched Oracle lookup early, and
+        /// the size of its IN list. Zero disables the Oracle cold tier of
+        /// locking shard TX ID lookups.
+        size_t m_oracle_tx_lookup_max_keys{
+            defaults::oracle_tx_lookup_max_keys};
+        /// Flag set if load generators should record the transactions
+        /// their wallets create.
+        bool m_wallet_audit{false};
+        /// Backend receiving persisted audit records.
+        persistence_backend m_persistence_backend{
+            persistence_backend::oracle};
+        /// Directory in which the file and LevelDB persistence backends
+        /// store their data.
+        std::string m_persistence_dir{"persistence"};
+        /// Milliseconds a write-behind queue waits before retrying a batch
+        /// its sink rejected.
+        size_t m_persistence_retry_backoff_ms{
+            defaults::persistence_retry_backoff_ms};
+        /// Upper bound in milliseconds on the doubling retry delay of a
+        /// write-behind queue.
+        size_t m_persistence_retry_max_backoff_ms{
+            defaults::persistence_retry_max_backoff_ms};
+        /// Number of failed attempts after which a write-behind queue or
+        /// the coordinator's archive drops a batch. Zero retries transient
+        /// failures until shutdown.
+        size_t m_persistence_retry_max_attempts{
+            defaults::persistence_retry_max_attempts};
+        /// I/O mechanism for TCP connections between components.
+        network_backend m_network_backend{network_backend::epoll};
+        /// Whether same-host components connect over abstract Unix domain
+        /// sockets instead of loopback TCP. Only peers running as the same
+        /// user are accepted on those sockets.
+        bool m_local_transport{false};
+        /// Whether large in-memory tables, such as the UHS and lock sets of
+        /// locking shards and the atomizer's spent set, are backed by
+        /// transparent huge pages to reduce TLB misses.
+        bool m_huge_pages{false};
+        /// Number of log statements buffered for a background thread to
+        /// write. Zero writes statements on the logging thread.
+        size_t m_log_async_capacity{0};
+        /// Behavior of an asynchronous log when its buffer is full.
+        logging::overflow_policy m_log_overflow{
+            logging::overflow_policy::block};
+        /// Fraction of transactions for which sentinels start a trace.
+        /// Zero disables tracing in every component.
+        double m_trace_sample_rate{0};
+        /// Number of completed trace spans buffered for export before
+        /// further spans are dropped.
+        size_t m_trace_buffer_size{defaults::trace_buffer_size};
+        /// Prefix of the file to which each component exports its spans,
+        /// followed by the component name and ".log".
+        std::string m_trace_file_prefix{defaults::trace_file_prefix};
+        /// Milliseconds between samples of the sizes of components'
+        /// in-memory structures into metrics gauges. Zero disables
+        /// sampling.
+        size_t m_metrics_sample_interval_ms{
+            defaults::metrics_sample_interval_ms};
+        /// Whether profiled locks record wait and hold time histograms
+        /// into metrics.
+        bool m_lock_profiling{false};
+        /// CPUs to which each kind of thread is pinned, from lists such as
+        /// "0-7,16-23" or "node0". Daemons sharing a host and a config
+        /// file can be given their own lists through environment
+        /// variables, such as CPUS_NETWORK='"node1"'.
+        thread_cpus m_thread_cpus;
     };
 
     /// Read options from the given config file without checking invariants.
@@ -0,0 +1,159 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_DEDUPE_CACHE_H_
+#define OPENCBDC_TX_SRC_COMMON_DEDUPE_CACHE_H_
+
+#include "hash.hpp"
+#include "hashmap.hpp"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Collapses repeated submissions of the same request ID.
+    ///
+    /// The first submission of an ID is processed as usual. Submissions
+    /// of the ID while it is processing wait for its result instead, and
+    /// later submissions receive the result directly while it remains
+    /// among the most recent results kept. Only results with a value are
+    /// kept, so an ID whose outcome was unknown is processed again when
+    /// resubmitted.
+    /// \tparam T type of the result.
+    template<typename T>
+    class dedupe_cache {
+      public:
+        using result_type = std::optional<T>;
+        using callback_type = std::function<void(result_type)>;
+
+        /// Outcome of a submission.
+        enum class status {
+            /// The ID is new. The caller processes it and calls finish.
+            first,
+            /// The ID is processing. The callback waits for its result.
+            attached,
+            /// The ID has a recent result, already passed to the callback.
+            cached
+        };
+
+        dedupe_cache() = delete;
+
+        /// Constructor.
+        /// \param max_results number of most recent results to keep.
+        explicit dedupe_cache(size_t max_results)
+            : m_max_results(max_results) {}
+
+        /// Registers a submission of an ID.
+        /// \param id ID of the request.
+        /// \param cb callback for the result. Moved from unless the
+        ///           submission is the first for the ID.
+        /// \return outcome of the submission.
+        auto submit(const hash_t& id, callback_type& cb) -> status {
+            auto res = result_type();
+            {
+                std::lock_guard<std::mutex> l(m_mut);
+                auto [it, inserted] = m_entries.try_emplace(id);
+                if(inserted) {
+                    return status::first;
+                }
+                if(!it->second.m_result.has_value()) {
+                    it->second.m_waiters.push_back(std::move(cb));
+                    return status::attached;
+                }
+                res = it->second.m_result;
+            }
+            auto done = std::move(cb);
+            done(std::move(res));
+            return status::cached;
+        }
+
+        /// Registers a submission of an ID which does not wait for the
+        /// result.
+        /// \param id ID of the request.
+        /// \return std::nullopt if the submission is the first for the ID,
+        ///         and the caller processes it and calls finish. Otherwise
+        ///         the ID's result, which is empty while it is processing.
+        auto claim(const hash_t& id) -> std::optional<result_type> {
+            std::lock_guard<std::mutex> l(m_mut);
+            auto [it, inserted] = m_entries.try_emplace(id);
+            if(inserted) {
+                return std::nullopt;
+            }
+            return it->second.m_result;
+        }
+
+        /// Looks up the result of an ID.
+        /// \param id ID of the request.
+        /// \return std::nullopt if the ID is neither processing nor among
+        ///         the kept results. Otherwise the ID's result, which is
+        ///         empty while it is processing.
+        auto find(const hash_t& id) -> std::optional<result_type> {
+            std::lock_guard<std::mutex> l(m_mut);
+            auto it = m_entries.find(id);
+            if(it == m_entries.end()) {
+                return std::nullopt;
+            }
+            return it->second.m_result;
+        }
+
+        /// Records the result of processing an ID and passes it to the
+        /// submissions waiting for it.
+        /// \param id ID whose first submission returned status::first, or
+        ///           which the caller claimed.
+        /// \param res result of processing the ID.
+        void finish(const hash_t& id, const result_type& res) {
+            auto waiters = std::vector<callback_type>();
+            {
+                std::lock_guard<std::mutex> l(m_mut);
+                auto it = m_entries.find(id);
+                if(it == m_entries.end()) {
+                    return;
+                }
+                waiters = std::move(it->second.m_waiters);
+                if(!res.has_value() || m_max_results == 0) {
+                    m_entries.erase(it);
+                } else {
+                    it->second.m_result = res;
+                    m_done.push_back(id);
+                    if(m_done.size() > m_max_results) {
+                        m_entries.erase(m_done.front());
+                        m_done.pop_front();
+                    }
+                }
+            }
+            for(auto& cb : waiters) {
+                cb(res);
+            }
+        }
+
+        /// Returns the number of IDs processing or with kept results.
+        /// \return ID count.
+        auto size() -> size_t {
+            std::lock_guard<std::mutex> l(m_mut);
+            return m_entries.size();
+        }
+
+      private:
+        struct entry {
+            /// Result of the ID once processed and kept.
+            result_type m_result;
+            /// Callbacks of submissions waiting for the result.
+            std::vector<callback_type> m_waiters;
+        };
+
+        size_t m_max_results;
+        std::mutex m_mut;
+        std::unordered_map<hash_t, entry, hashing::const_sip_hash<hash_t>>
+            m_entries;
+        /// IDs with kept results, oldest first.
+        std::deque<hash_t> m_done;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_DEDUPE_CACHE_H_
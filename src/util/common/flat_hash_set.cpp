@@ -0,0 +1,274 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat_hash_set.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cbdc {
+    namespace {
+        constexpr size_t group_size = 16;
+        constexpr uint8_t ctrl_empty = 0x80;
+        constexpr uint8_t ctrl_deleted = 0xfe;
+        constexpr uint8_t h2_mask = 0x7f;
+        constexpr size_t h2_bits = 7;
+        constexpr size_t max_load_num = 7;
+        constexpr size_t max_load_den = 8;
+
+        auto hash_key(const hash_t& key) -> uint64_t {
+            // Every key in a shard's set shares its routing prefix, and the
+            // keys in one lock stripe share the bytes which select it, so
+            // fold in every word of the key rather than only the first.
+            uint64_t word{};
+            for(size_t off{0}; off < key.size(); off += sizeof(word)) {
+                uint64_t part{};
+                std::memcpy(&part, &key[off], sizeof(part));
+                word ^= part;
+            }
+            // Keys are already uniform, but mixing spreads structured keys,
+            // such as those used in tests, across groups and control bytes.
+            static constexpr uint64_t golden = 0x9e3779b97f4a7c15;
+            static constexpr auto half_word = 32;
+            word *= golden;
+            return word ^ (word >> half_word);
+        }
+
+        auto h2(uint64_t h) -> uint8_t {
+            return static_cast<uint8_t>(h & h2_mask);
+        }
+
+        /// Bit i is set if control byte i of the group equals ctrl.
+        auto match(const uint8_t* group, uint8_t ctrl) -> uint32_t {
+#if defined(__SSE2__)
+            const auto bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(group));
+            const auto needle = _mm_set1_epi8(static_cast<char>(ctrl));
+            const auto eq = _mm_cmpeq_epi8(bytes, needle);
+            return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+#else
+            uint32_t ret{0};
+            for(size_t i{0}; i < group_size; i++) {
+                if(group[i] == ctrl) {
+                    ret |= 1U << i;
+                }
+            }
+            return ret;
+#endif
+        }
+
+        /// Bit i is set if slot i of the group is empty or deleted, both of
+        /// which have the high bit set.
+        auto match_free(const uint8_t* group) -> uint32_t {
+#if defined(__SSE2__)
+            const auto bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(group));
+            return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+#else
+            uint32_t ret{0};
+            for(size_t i{0}; i < group_size; i++) {
+                if((group[i] & ctrl_empty) != 0) {
+                    ret |= 1U << i;
+                }
+            }
+            return ret;
+#endif
+        }
+
+        auto lowest_bit(uint32_t mask) -> size_t {
+            return static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+
+    flat_hash_set::flat_hash_set(size_t expected) {
+        reserve(expected);
+    }
+
+    auto flat_hash_set::find_slot(const hash_t& key, uint64_t h) const
+        -> size_t {
+        if(m_slots.empty()) {
+            return npos;
+        }
+        const auto tag = h2(h);
+        auto group = static_cast<size_t>(h >> h2_bits) & m_group_mask;
+        // Triangular probing visits every group once the table is a power
+        // of two groups, and the load limit guarantees an empty slot.
+        for(size_t step{1};; step++) {
+            const auto* ctrl = &m_ctrl[group * group_size];
+            for(auto m = match(ctrl, tag); m != 0; m &= m - 1) {
+                const auto idx = group * group_size + lowest_bit(m);
+                if(m_slots[idx] == key) {
+                    return idx;
+                }
+            }
+            if(match(ctrl, ctrl_empty) != 0) {
+                return npos;
+            }
+            group = (group + step) & m_group_mask;
+        }
+    }
+
+    auto flat_hash_set::find_free_slot(uint64_t h) const -> size_t {
+        auto group = static_cast<size_t>(h >> h2_bits) & m_group_mask;
+        for(size_t step{1};; step++) {
+            const auto m = match_free(&m_ctrl[group * group_size]);
+            if(m != 0) {
+                return group * group_size + lowest_bit(m);
+            }
+            group = (group + step) & m_group_mask;
+        }
+    }
+
+    auto flat_hash_set::insert(const hash_t& key) -> bool {
+        const auto h = hash_key(key);
+        if(find_slot(key, h) != npos) {
+            return false;
+        }
+        const auto cap = capacity();
+        if((m_size + m_deleted + 1) * max_load_den > cap * max_load_num) {
+            // Purge tombstones in place if they are what fills the table,
+            // otherwise double.
+            const auto grow = (m_size + 1) * max_load_den * 2
+                            > cap * max_load_num;
+            rehash(cap == 0 ? group_size : (grow ? cap * 2 : cap));
+        }
+        const auto idx = find_free_slot(h);
+        if(m_ctrl[idx] == ctrl_deleted) {
+            m_deleted--;
+        }
+        m_ctrl[idx] = h2(h);
+        m_slots[idx] = key;
+        m_size++;
+        return true;
+    }
+
+    auto flat_hash_set::contains(const hash_t& key) const -> bool {
+        return find_slot(key, hash_key(key)) != npos;
+    }
+
+    auto flat_hash_set::erase(const hash_t& key) -> bool {
+        const auto idx = find_slot(key, hash_key(key));
+        if(idx == npos) {
+            return false;
+        }
+        // A probe stops at the first group with an empty slot, so if this
+        // group already has one no probe can pass through it and the slot
+        // can be freed outright.
+        const auto group = idx - idx % group_size;
+        if(match(&m_ctrl[group], ctrl_empty) != 0) {
+            m_ctrl[idx] = ctrl_empty;
+        } else {
+            m_ctrl[idx] = ctrl_deleted;
+            m_deleted++;
+        }
+        m_size--;
+        return true;
+    }
+
+    void flat_hash_set::clear() {
+        std::fill(m_ctrl.begin(), m_ctrl.end(), ctrl_empty);
+        m_size = 0;
+        m_deleted = 0;
+    }
+
+    void flat_hash_set::reserve(size_t count) {
+        auto cap = group_size;
+        while(cap * max_load_num < count * max_load_den) {
+            cap *= 2;
+        }
+        if(cap > capacity()) {
+            rehash(cap);
+        }
+    }
+
+    void flat_hash_set::rehash(size_t new_capacity) {
+        auto old_ctrl = std::move(m_ctrl);
+        auto old_slots = std::move(m_slots);
+        m_ctrl.assign(new_capacity, ctrl_empty);
+        m_slots.resize(new_capacity);
+        m_group_mask = new_capacity / group_size - 1;
+        m_deleted = 0;
+        for(size_t i{0}; i < old_slots.size(); i++) {
+            if((old_ctrl[i] & ctrl_empty) == 0) {
+                const auto h = hash_key(old_slots[i]);
+                const auto idx = find_free_slot(h);
+                m_ctrl[idx] = h2(h);
+                m_slots[idx] = old_slots[i];
+            }
+        }
+    }
+
+    auto flat_hash_set::size() const -> size_t {
+        return m_size;
+    }
+
+    auto flat_hash_set::empty() const -> bool {
+        return m_size == 0;
+    }
+
+    auto flat_hash_set::capacity() const -> size_t {
+        return m_slots.size();
+    }
+
+    auto flat_hash_set::memory_usage() const -> size_t {
+        return m_ctrl.capacity() + m_slots.capacity() * sizeof(hash_t);
+    }
+
+    auto flat_hash_set::begin() const -> const_iterator {
+        return {this, 0};
+    }
+
+    auto flat_hash_set::end() const -> const_iterator {
+        return {this, capacity()};
+    }
+
+    flat_hash_set::const_iterator::const_iterator(const flat_hash_set* set,
+                                                  size_t idx)
+        : m_set(set),
+          m_idx(idx) {
+        skip_unused();
+    }
+
+    void flat_hash_set::const_iterator::skip_unused() {
+        while(m_idx < m_set->capacity()
+              && (m_set->m_ctrl[m_idx] & ctrl_empty) != 0) {
+            m_idx++;
+        }
+    }
+
+    auto flat_hash_set::const_iterator::operator*() const -> reference {
+        return m_set->m_slots[m_idx];
+    }
+
+    auto flat_hash_set::const_iterator::operator->() const -> pointer {
+        return &m_set->m_slots[m_idx];
+    }
+
+    auto flat_hash_set::const_iterator::operator++() -> const_iterator& {
+        m_idx++;
+        skip_unused();
+        return *this;
+    }
+
+    auto flat_hash_set::const_iterator::operator++(int) -> const_iterator {
+        auto ret = *this;
+        ++(*this);
+        return ret;
+    }
+
+    auto flat_hash_set::const_iterator::operator==(
+        const const_iterator& rhs) const -> bool {
+        return m_set == rhs.m_set && m_idx == rhs.m_idx;
+    }
+
+    auto flat_hash_set::const_iterator::operator!=(
+        const const_iterator& rhs) const -> bool {
+        return !(*this == rhs);
+    }
+}
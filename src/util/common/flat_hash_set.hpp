@@ -0,0 +1,139 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_FLAT_HASH_SET_H_
+#define OPENCBDC_TX_SRC_COMMON_FLAT_HASH_SET_H_
+
+#include "hash.hpp"
+#include "huge_pages.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Open-addressing hash set of hashes.
+    ///
+    /// Stores keys inline in one flat array alongside one control byte per
+    /// slot, so a lookup touches a 16-byte group of control bytes and then
+    /// only the slots whose control byte matches 7 bits of the key's hash,
+    /// rather than following a chain of heap nodes. Control bytes are
+    /// compared a group at a time with SSE2 where available. Slots are
+    /// probed a group at a time in a triangular sequence, and erased slots
+    /// leave tombstones only when their group is full. The table keeps at
+    /// most 7/8 of its slots in use and doubles when it would exceed that.
+    ///
+    /// Keys are assumed to be cryptographic hashes, so placing them only
+    /// folds their 8-byte words together and mixes the result once. Bytes
+    /// which every key in a set shares, such as a shard's routing prefix,
+    /// do not narrow where keys land.
+    ///
+    /// The table is allocated with \ref huge_page_allocator, so large sets
+    /// are backed by huge pages when enabled.
+    ///
+    /// \warning Not thread safe.
+    class flat_hash_set {
+      public:
+        /// Forward iterator over the keys in the set, in slot order.
+        class const_iterator {
+          public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = hash_t;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const hash_t*;
+            using reference = const hash_t&;
+
+            auto operator*() const -> reference;
+            auto operator->() const -> pointer;
+            auto operator++() -> const_iterator&;
+            auto operator++(int) -> const_iterator;
+            auto operator==(const const_iterator& rhs) const -> bool;
+            auto operator!=(const const_iterator& rhs) const -> bool;
+
+          private:
+            friend class flat_hash_set;
+            const_iterator(const flat_hash_set* set, size_t idx);
+            void skip_unused();
+
+            const flat_hash_set* m_set{};
+            size_t m_idx{};
+        };
+
+        /// Constructs an empty set which allocates on its first insert.
+        flat_hash_set() = default;
+
+        /// Constructs an empty set with room for the given number of keys.
+        /// \param expected number of keys the set can hold before growing.
+        explicit flat_hash_set(size_t expected);
+
+        /// Adds a key to the set.
+        /// \param key key to add.
+        /// \return true if the key was not already in the set.
+        auto insert(const hash_t& key) -> bool;
+
+        /// Checks whether the set contains a key.
+        /// \param key key to find.
+        /// \return true if the key is in the set.
+        [[nodiscard]] auto contains(const hash_t& key) const -> bool;
+
+        /// Removes a key from the set.
+        /// \param key key to remove.
+        /// \return true if the key was in the set.
+        auto erase(const hash_t& key) -> bool;
+
+        /// Removes every key, keeping the allocated capacity.
+        void clear();
+
+        /// Grows the set so it can hold the given number of keys without
+        /// rehashing. Never shrinks the set.
+        /// \param count number of keys.
+        void reserve(size_t count);
+
+        /// Returns the number of keys in the set.
+        /// \return key count.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Checks whether the set is empty.
+        /// \return true if the set contains no keys.
+        [[nodiscard]] auto empty() const -> bool;
+
+        /// Returns the number of slots in the table.
+        /// \return slot count.
+        [[nodiscard]] auto capacity() const -> size_t;
+
+        /// Returns the number of bytes allocated for the table.
+        /// \return table size in bytes.
+        [[nodiscard]] auto memory_usage() const -> size_t;
+
+        /// Returns an iterator to the first key.
+        /// \return begin iterator.
+        [[nodiscard]] auto begin() const -> const_iterator;
+
+        /// Returns the past-the-end iterator.
+        /// \return end iterator.
+        [[nodiscard]] auto end() const -> const_iterator;
+
+      private:
+        /// Index of the slot holding key, or npos.
+        [[nodiscard]] auto find_slot(const hash_t& key, uint64_t h) const
+            -> size_t;
+        /// Index of a free slot for a key not already in the set.
+        [[nodiscard]] auto find_free_slot(uint64_t h) const -> size_t;
+        void rehash(size_t new_capacity);
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        /// One control byte per slot: empty, deleted, or the low 7 bits of
+        /// the key's hash.
+        std::vector<uint8_t, huge_page_allocator<uint8_t>> m_ctrl;
+        std::vector<hash_t, huge_page_allocator<hash_t>> m_slots;
+        size_t m_size{0};
+        size_t m_deleted{0};
+        /// Number of 16-slot groups minus one. Groups are a power of two.
+        size_t m_group_mask{0};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_FLAT_HASH_SET_H_
@@ -0,0 +1,101 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "generational_hash_set.hpp"
+
+#include <algorithm>
+
+namespace cbdc {
+    generational_hash_set::generational_hash_set(size_t generation_size,
+                                                 size_t generations)
+        : m_generation_size(std::max<size_t>(generation_size, 1)),
+          m_generations(generations),
+          m_current(m_generation_size) {}
+
+    void generational_hash_set::insert(const hash_t& key) {
+        if(m_current_inserts >= m_generation_size) {
+            seal();
+        }
+        m_current.insert(key);
+        m_current_inserts++;
+    }
+
+    auto generational_hash_set::contains(const hash_t& key) const -> bool {
+        if(m_current.contains(key)) {
+            return true;
+        }
+        return std::any_of(m_sealed.begin(),
+                           m_sealed.end(),
+                           [&](const std::vector<hash_t>& gen) {
+                               return std::binary_search(gen.begin(),
+                                                         gen.end(),
+                                                         key);
+                           });
+    }
+
+    auto generational_hash_set::erase(const hash_t& key) -> bool {
+        return m_current.erase(key);
+    }
+
+    auto generational_hash_set::size() const -> size_t {
+        return m_current.size() + m_sealed_size;
+    }
+
+    auto generational_hash_set::memory_usage() const -> size_t {
+        auto ret = m_current.memory_usage();
+        for(const auto& gen : m_sealed) {
+            ret += gen.capacity() * sizeof(hash_t);
+        }
+        return ret;
+    }
+
+    auto generational_hash_set::sealed_generations() const -> size_t {
+        return m_sealed.size();
+    }
+
+    auto generational_hash_set::current() const -> const flat_hash_set& {
+        return m_current;
+    }
+
+    auto generational_hash_set::current_inserts() const -> size_t {
+        return m_current_inserts;
+    }
+
+    auto generational_hash_set::sealed() const
+        -> const std::deque<std::vector<hash_t>>& {
+        return m_sealed;
+    }
+
+    void
+    generational_hash_set::restore(flat_hash_set current,
+                                   size_t current_inserts,
+                                   std::deque<std::vector<hash_t>> sealed) {
+        m_current = std::move(current);
+        m_current_inserts = current_inserts;
+        m_sealed = std::move(sealed);
+        while(m_sealed.size() > m_generations) {
+            m_sealed.pop_back();
+        }
+        m_sealed_size = 0;
+        for(const auto& gen : m_sealed) {
+            m_sealed_size += gen.size();
+        }
+    }
+
+    void generational_hash_set::seal() {
+        if(m_generations > 0 && !m_current.empty()) {
+            auto gen = std::vector<hash_t>(m_current.begin(), m_current.end());
+            std::sort(gen.begin(), gen.end());
+            m_sealed_size += gen.size();
+            m_sealed.push_front(std::move(gen));
+        }
+        while(m_sealed.size() > m_generations) {
+            m_sealed_size -= m_sealed.back().size();
+            m_sealed.pop_back();
+        }
+        m_current.clear();
+        m_current_inserts = 0;
+    }
+}
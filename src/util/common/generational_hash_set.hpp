@@ -0,0 +1,106 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_GENERATIONAL_HASH_SET_H_
+#define OPENCBDC_TX_SRC_COMMON_GENERATIONAL_HASH_SET_H_
+
+#include "flat_hash_set.hpp"
+#include "hash.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Hash set that forgets keys a bounded number of inserts after
+    ///        adding them.
+    ///
+    /// Keys are inserted into a mutable current generation. Once a
+    /// generation has taken a fixed number of inserts it is sealed into a
+    /// sorted array, which costs a third of the memory of the hash table
+    /// and is searched by bisection, and the current generation is cleared
+    /// for reuse without releasing its capacity. Only a fixed number of
+    /// sealed generations is kept, so the oldest are dropped and memory
+    /// stays bounded however many keys are inserted over time. Keys can
+    /// only be erased while still in the current generation; older keys
+    /// are expected to be dropped by sealing.
+    ///
+    /// \warning Not thread safe.
+    class generational_hash_set {
+      public:
+        /// Constructor.
+        /// \param generation_size number of inserts after which the
+        ///                        current generation is sealed.
+        /// \param generations number of sealed generations to keep. Zero
+        ///                    drops keys as soon as their generation is
+        ///                    sealed.
+        generational_hash_set(size_t generation_size, size_t generations);
+
+        /// Adds a key to the current generation, sealing the generation
+        /// first if it has taken its share of inserts.
+        /// \param key key to add.
+        void insert(const hash_t& key);
+
+        /// Checks whether any retained generation contains a key.
+        /// \param key key to find.
+        /// \return true if the key was inserted and not yet erased or
+        ///         dropped.
+        [[nodiscard]] auto contains(const hash_t& key) const -> bool;
+
+        /// Removes a key from the current generation.
+        /// \param key key to remove.
+        /// \return true if the key was in the current generation.
+        auto erase(const hash_t& key) -> bool;
+
+        /// Returns the number of keys in every retained generation.
+        /// \return key count.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Returns the number of bytes allocated for every retained
+        /// generation.
+        /// \return size in bytes.
+        [[nodiscard]] auto memory_usage() const -> size_t;
+
+        /// Returns the number of sealed generations currently retained.
+        /// \return sealed generation count.
+        [[nodiscard]] auto sealed_generations() const -> size_t;
+
+        /// Returns the current generation.
+        /// \return current generation's keys.
+        [[nodiscard]] auto current() const -> const flat_hash_set&;
+
+        /// Returns the number of inserts into the current generation,
+        /// counting keys since erased.
+        /// \return insert count.
+        [[nodiscard]] auto current_inserts() const -> size_t;
+
+        /// Returns the sealed generations.
+        /// \return sealed generations, newest first, each sorted.
+        [[nodiscard]] auto sealed() const
+            -> const std::deque<std::vector<hash_t>>&;
+
+        /// Replaces the set's contents with state previously read from
+        /// \ref current, \ref current_inserts and \ref sealed, keeping the
+        /// generation size and count given at construction.
+        /// \param current keys of the current generation.
+        /// \param current_inserts inserts into the current generation.
+        /// \param sealed sealed generations, newest first, each sorted.
+        void restore(flat_hash_set current,
+                     size_t current_inserts,
+                     std::deque<std::vector<hash_t>> sealed);
+
+      private:
+        void seal();
+
+        size_t m_generation_size;
+        size_t m_generations;
+        flat_hash_set m_current;
+        size_t m_current_inserts{0};
+        /// Sealed generations, newest first, each sorted.
+        std::deque<std::vector<hash_t>> m_sealed;
+        size_t m_sealed_size{0};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_GENERATIONAL_HASH_SET_H_
@@ -6,34 +6,174 @@
 #include "hash.hpp"
 
 #include "crypto/sha256.h"
+#include "hex.hpp"
 
+#include <algorithm>
 #include <cstring>
-#include <iomanip>
 #include <vector>
 
 namespace cbdc {
-    auto to_string(const hash_t& val) -> std::string {
-        std::stringstream ret;
-        ret << std::hex << std::setfill('0');
+    namespace {
+        constexpr size_t sha256_lanes = 8;
+        constexpr size_t sha256_block_size = 64;
+        constexpr size_t sha256_block_words = 16;
+        constexpr size_t sha256_rounds = 64;
+        constexpr size_t sha256_state_words = 8;
+
+        // Each word holds the same SHA256 word of every lane.
+        using lane_word = std::array<uint32_t, sha256_lanes>;
+
+        constexpr std::array<uint32_t, sha256_rounds> sha256_k = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
+            0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
+            0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+            0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+            0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
+            0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+            0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+            0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+            0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
+            0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+            0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+            0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        constexpr std::array<uint32_t, sha256_state_words> sha256_init
+            = {0x6a09e667,
+               0xbb67ae85,
+               0x3c6ef372,
+               0xa54ff53a,
+               0x510e527f,
+               0x9b05688c,
+               0x1f83d9ab,
+               0x5be0cd19};
 
-        for(const auto& byte : val) {
-            ret << std::setw(2) << static_cast<int>(byte);
+        inline auto rotr(uint32_t x, int n) -> uint32_t {
+            return (x >> n) | (x << (32 - n));
         }
 
-        return ret.str();
-    }
+        inline auto read_be32(const unsigned char* ptr) -> uint32_t {
+            return static_cast<uint32_t>(ptr[0]) << 24U
+                 | static_cast<uint32_t>(ptr[1]) << 16U
+                 | static_cast<uint32_t>(ptr[2]) << 8U
+                 | static_cast<uint32_t>(ptr[3]);
+        }
 
-    auto hash_from_hex(const std::string& val) -> hash_t {
-        hash_t ret;
+        inline void write_be32(unsigned char* ptr, uint32_t x) {
+            ptr[0] = static_cast<unsigned char>(x >> 24U);
+            ptr[1] = static_cast<unsigned char>(x >> 16U);
+            ptr[2] = static_cast<unsigned char>(x >> 8U);
+            ptr[3] = static_cast<unsigned char>(x);
+        }
+
+        // Compresses one message block of every lane into its state.
+        void transform_lanes(std::array<lane_word, sha256_state_words>& st,
+                             const unsigned char* blocks,
+                             size_t stride) {
+            std::array<lane_word, sha256_rounds> w{};
+            for(size_t t = 0; t < sha256_block_words; t++) {
+                for(size_t l = 0; l < sha256_lanes; l++) {
+                    w[t][l] = read_be32(&blocks[l * stride + t * 4]);
+                }
+            }
+            for(size_t t = sha256_block_words; t < sha256_rounds; t++) {
+                for(size_t l = 0; l < sha256_lanes; l++) {
+                    auto w15 = w[t - 15][l];
+                    auto w2 = w[t - 2][l];
+                    auto s0 = rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3U);
+                    auto s1 = rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10U);
+                    w[t][l] = w[t - 16][l] + s0 + w[t - 7][l] + s1;
+                }
+            }
+
+            auto v = st;
+            for(size_t t = 0; t < sha256_rounds; t++) {
+                for(size_t l = 0; l < sha256_lanes; l++) {
+                    auto a = v[0][l];
+                    auto e = v[4][l];
+                    auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+                    auto ch = (e & v[5][l]) ^ (~e & v[6][l]);
+                    auto t1 = v[7][l] + s1 + ch + sha256_k[t] + w[t][l];
+                    auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+                    auto maj = (a & v[1][l]) ^ (a & v[2][l])
+                             ^ (v[1][l] & v[2][l]);
+                    v[7][l] = v[6][l];
+                    v[6][l] = v[5][l];
+                    v[5][l] = e;
+                    v[4][l] = v[3][l] + t1;
+                    v[3][l] = v[2][l];
+                    v[2][l] = v[1][l];
+                    v[1][l] = a;
+                    v[0][l] = t1 + s0 + maj;
+                }
+            }
+
+            for(size_t i = 0; i < sha256_state_words; i++) {
+                for(size_t l = 0; l < sha256_lanes; l++) {
+                    st[i][l] += v[i][l];
+                }
+            }
+        }
+
+        // Hashes up to one message per lane. Unused lanes hash zeroes.
+        void hash_lanes(const unsigned char* data,
+                        size_t len,
+                        size_t count,
+                        hash_t* out) {
+            // Room for the 0x80 terminator and 64-bit length.
+            static constexpr size_t trailer_size = 9;
+            const auto n_blocks
+                = (len + trailer_size + sha256_block_size - 1)
+                / sha256_block_size;
+            const auto stride = n_blocks * sha256_block_size;
+
+            auto padded = std::vector<unsigned char>(stride * sha256_lanes);
+            const auto bit_len = static_cast<uint64_t>(len) * 8;
+            for(size_t l = 0; l < count; l++) {
+                auto* msg = &padded[l * stride];
+                std::memcpy(msg, &data[l * len], len);
+                msg[len] = 0x80;
+                write_be32(&msg[stride - 8],
+                           static_cast<uint32_t>(bit_len >> 32U));
+                write_be32(&msg[stride - 4], static_cast<uint32_t>(bit_len));
+            }
 
-        for(size_t i = 0; i < val.size(); i += 2) {
-            unsigned int v{};
-            std::stringstream s;
-            s << std::hex << val.substr(i, 2);
-            s >> v;
-            ret[i / 2] = static_cast<uint8_t>(v);
+            auto st = std::array<lane_word, sha256_state_words>();
+            for(size_t i = 0; i < sha256_state_words; i++) {
+                st[i].fill(sha256_init[i]);
+            }
+            for(size_t b = 0; b < n_blocks; b++) {
+                transform_lanes(st, &padded[b * sha256_block_size], stride);
+            }
+
+            for(size_t l = 0; l < count; l++) {
+                for(size_t i = 0; i < sha256_state_words; i++) {
+                    write_be32(&out[l][i * 4], st[i][l]);
+                }
+            }
+        }
+
+        auto have_shani() -> bool {
+            // Selects the fastest single-message kernel as a side effect,
+            // which every daemon also does at start-up.
+            static const auto ret
+                = SHA256AutoDetect().find("shani") != std::string::npos;
+            return ret;
         }
+    }
 
+    auto to_string(const hash_t& val) -> std::string {
+        auto ret = std::string(val.size() * 2, '\0');
+        hex_encode(val.data(), val.size(), ret.data());
+        return ret;
+    }
+
+    auto hash_from_hex(const std::string& val) -> hash_t {
+        auto ret = hash_t();
+        auto len = std::min(val.size() / 2, ret.size());
+        if(!hex_decode(val.data(), len, ret.data())) {
+            return {};
+        }
         return ret;
     }
 
@@ -48,4 +188,29 @@ namespace cbdc {
 
         return ret;
     }
+
+    void hash_data_batch(const unsigned char* data,
+                         size_t len,
+                         size_t count,
+                         hash_t* out,
+                         hash_batch_kernel kernel) {
+        if(kernel == hash_batch_kernel::automatic) {
+            kernel = have_shani() ? hash_batch_kernel::single
+                                  : hash_batch_kernel::lanes;
+        }
+        size_t i = 0;
+        if(kernel == hash_batch_kernel::lanes) {
+            // A lone message is cheaper to hash than a group of lanes.
+            while(count - i > 1) {
+                auto n = std::min(sha256_lanes, count - i);
+                hash_lanes(&data[i * len], len, n, &out[i]);
+                i += n;
+            }
+        }
+        for(; i < count; i++) {
+            CSHA256()
+                .Write(&data[i * len], len)
+                .Finalize(out[i].data());
+        }
+    }
 }
@@ -25,7 +25,8 @@ namespace cbdc {
 
     /// Parses a hexadecimal representation of a hash.
     /// \param val string with a hex representation of a hash.
-    /// \return hash value of the string.
+    /// \return hash value of the string, or all zeros if the string is not
+    ///         valid hex.
     auto hash_from_hex(const std::string& val) -> hash_t;
 
     /// Calculates the SHA256 hash of the specified data.
@@ -33,6 +34,37 @@ namespace cbdc {
     /// \param len the number of bytes of the data to hash.
     /// \return the hash of the data.
     auto hash_data(const std::byte* data, size_t len) -> hash_t;
+
+    /// Ways \ref hash_data_batch can hash its messages.
+    enum class hash_batch_kernel {
+        /// Single where SHA-NI is available, lanes otherwise.
+        automatic,
+        /// Up to 8 messages at a time in portable parallel lanes.
+        lanes,
+        /// One message at a time with the kernel selected by
+        /// SHA256AutoDetect.
+        single
+    };
+
+    /// \brief Calculates the SHA256 hashes of several messages of equal
+    ///        length.
+    ///
+    /// Hashes up to 8 messages at a time in parallel lanes, so the
+    /// compiler can vectorize the compression function across messages.
+    /// Falls back to hashing one message at a time where SHA-NI is
+    /// available, since its single-message kernel is faster.
+    /// \param data messages to hash, stored back to back.
+    /// \param len length of each message in bytes.
+    /// \param count number of messages.
+    /// \param out array of count hashes in which to store the results.
+    /// \param kernel way to hash the messages. Only tests and benchmarks
+    ///               need to override the automatic choice.
+    void hash_data_batch(const unsigned char* data,
+                         size_t len,
+                         size_t count,
+                         hash_t* out,
+                         hash_batch_kernel kernel
+                         = hash_batch_kernel::automatic);
 }
 
 #endif // OPENCBDC_TX_SRC_COMMON_HASH_H_
@@ -5,10 +5,44 @@
 
 #include "hashmap.hpp"
 
+#include <random>
+
 namespace cbdc::hashing {
     auto null::operator()(const hash_t& hash) const noexcept -> size_t {
         size_t ret{};
         std::memcpy(&ret, hash.data(), sizeof(ret));
         return ret;
     }
+
+    namespace {
+        auto process_key() -> const std::array<uint64_t, 4>& {
+            static const auto key = []() {
+                auto rd = std::random_device();
+                auto dist = std::uniform_int_distribution<uint64_t>();
+                auto k = std::array<uint64_t, 4>();
+                for(auto& w : k) {
+                    w = dist(rd);
+                }
+                return k;
+            }();
+            return key;
+        }
+
+        __extension__ using uint128_t = unsigned __int128;
+
+        // Folds the 128-bit product of two words into 64 bits
+        auto mul_fold(uint64_t a, uint64_t b) -> uint64_t {
+            auto p = static_cast<uint128_t>(a) * b;
+            return static_cast<uint64_t>(p) ^ static_cast<uint64_t>(p >> 64);
+        }
+    }
+
+    auto keyed_mix::operator()(const hash_t& hash) const noexcept -> size_t {
+        const auto& key = process_key();
+        auto w = std::array<uint64_t, 4>();
+        static_assert(sizeof(w) == sizeof(hash));
+        std::memcpy(w.data(), hash.data(), sizeof(w));
+        return mul_fold(w[0] ^ key[0], w[1] ^ key[1])
+             ^ mul_fold(w[2] ^ key[2], w[3] ^ key[3]);
+    }
 }
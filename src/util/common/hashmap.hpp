@@ -45,9 +45,7 @@ namespace cbdc::hashing {
             static constexpr std::array<uint64_t, 2> siphash_key{0x1337,
                                                                  0x1337};
             CSipHasher hasher(siphash_key[0], siphash_key[1]);
-            std::vector<unsigned char> arr(buf.size());
-            std::memcpy(arr.data(), buf.data(), buf.size());
-            hasher.Write(arr.data(), arr.size());
+            hasher.Write(buf.c_ptr(), buf.size());
             return hasher.Finalize();
         }
     };
@@ -61,6 +59,17 @@ namespace cbdc::hashing {
     struct null {
         auto operator()(const hash_t& hash) const noexcept -> size_t;
     };
+
+    /// \brief Cheap keyed hash of a hash_t for STL data structures.
+    ///
+    /// Mixes all of the hash's bytes with a key chosen at random once per
+    /// process, so colliding keys cannot be pre-calculated, at a fraction of
+    /// the cost of SipHash. Values differ between processes, so only use
+    /// for containers whose iteration order is never persisted or sent to
+    /// other processes.
+    struct keyed_mix {
+        auto operator()(const hash_t& hash) const noexcept -> size_t;
+    };
 }
 
 #endif // OPENCBDC_TX_SRC_COMMON_HASHMAP_H_
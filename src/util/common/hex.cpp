@@ -0,0 +1,257 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hex.hpp"
+
+#include <climits>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cbdc {
+    namespace {
+        constexpr auto nibble_bits = 4U;
+        constexpr auto nibble_mask = 0x0fU;
+        constexpr auto ten = 10U;
+        /// Distance from '0' + 10 to 'a' and to 'A'.
+        constexpr char lower_gap = 'a' - '0' - ten;
+        constexpr char upper_gap = 'A' - '0' - ten;
+
+        /// Returns the value of a hexadecimal digit of either case, or a
+        /// value above nibble_mask if c is not a hexadecimal digit.
+        auto hex_nibble(char c) -> unsigned {
+            if(c >= '0' && c <= '9') {
+                return static_cast<unsigned>(c - '0');
+            }
+            if(c >= 'a' && c <= 'f') {
+                return static_cast<unsigned>(c - 'a') + ten;
+            }
+            if(c >= 'A' && c <= 'F') {
+                return static_cast<unsigned>(c - 'A') + ten;
+            }
+            return nibble_mask + 1;
+        }
+
+        void encode_scalar(const unsigned char* data,
+                           size_t len,
+                           char* out,
+                           bool upper) {
+            const auto* digits
+                = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+            for(size_t i{0}; i < len; i++) {
+                out[i * 2] = digits[data[i] >> nibble_bits];
+                out[i * 2 + 1] = digits[data[i] & nibble_mask];
+            }
+        }
+
+        auto decode_scalar(const char* hex, size_t len, unsigned char* out)
+            -> bool {
+            for(size_t i{0}; i < len; i++) {
+                auto hi = hex_nibble(hex[i * 2]);
+                auto lo = hex_nibble(hex[i * 2 + 1]);
+                if(hi > nibble_mask || lo > nibble_mask) {
+                    return false;
+                }
+                out[i] = static_cast<unsigned char>((hi << nibble_bits) | lo);
+            }
+            return true;
+        }
+
+#if defined(__SSE2__)
+        // Characters are compared as signed bytes, so anything above 0x7f
+        // fails the range checks below along with the other non-digits.
+
+        /// Converts nibbles to their hexadecimal digits.
+        auto nibbles_to_digits(__m128i n, __m128i gap) -> __m128i {
+            const auto nine = _mm_set1_epi8(static_cast<char>(ten - 1));
+            const auto letters = _mm_and_si128(_mm_cmpgt_epi8(n, nine), gap);
+            return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+                                letters);
+        }
+
+        /// Converts hexadecimal digits to nibbles, setting valid to all ones
+        /// in the lanes that held a digit.
+        auto digits_to_nibbles(__m128i c, __m128i& valid) -> __m128i {
+            const auto is_digit
+                = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+            const auto lower = _mm_or_si128(c, _mm_set1_epi8(' '));
+            const auto is_alpha = _mm_and_si128(
+                _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+            valid = _mm_or_si128(is_digit, is_alpha);
+            const auto digit_val
+                = _mm_and_si128(is_digit, _mm_sub_epi8(c, _mm_set1_epi8('0')));
+            const auto alpha_val = _mm_and_si128(
+                is_alpha,
+                _mm_sub_epi8(lower, _mm_set1_epi8('a' - ten)));
+            return _mm_or_si128(digit_val, alpha_val);
+        }
+
+        /// Combines the nibble pairs in each 16-bit lane of n into one
+        /// byte held in the low half of the lane.
+        auto join_nibbles(__m128i n) -> __m128i {
+            const auto hi = _mm_slli_epi16(
+                _mm_and_si128(n, _mm_set1_epi16(UINT8_MAX)),
+                nibble_bits);
+            return _mm_or_si128(hi, _mm_srli_epi16(n, CHAR_BIT));
+        }
+#endif
+
+#if defined(__AVX2__)
+        auto nibbles_to_digits(__m256i n, __m256i gap) -> __m256i {
+            const auto nine = _mm256_set1_epi8(static_cast<char>(ten - 1));
+            const auto letters
+                = _mm256_and_si256(_mm256_cmpgt_epi8(n, nine), gap);
+            return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')),
+                                   letters);
+        }
+
+        auto digits_to_nibbles(__m256i c, __m256i& valid) -> __m256i {
+            const auto is_digit = _mm256_and_si256(
+                _mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+            const auto lower = _mm256_or_si256(c, _mm256_set1_epi8(' '));
+            const auto is_alpha = _mm256_and_si256(
+                _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+            valid = _mm256_or_si256(is_digit, is_alpha);
+            const auto digit_val = _mm256_and_si256(
+                is_digit,
+                _mm256_sub_epi8(c, _mm256_set1_epi8('0')));
+            const auto alpha_val = _mm256_and_si256(
+                is_alpha,
+                _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - ten)));
+            return _mm256_or_si256(digit_val, alpha_val);
+        }
+
+        auto join_nibbles(__m256i n) -> __m256i {
+            const auto hi = _mm256_slli_epi16(
+                _mm256_and_si256(n, _mm256_set1_epi16(UINT8_MAX)),
+                nibble_bits);
+            return _mm256_or_si256(hi, _mm256_srli_epi16(n, CHAR_BIT));
+        }
+#endif
+    }
+
+    void hex_encode(const unsigned char* data,
+                    size_t len,
+                    char* out,
+                    bool upper) {
+        size_t i{0};
+        const auto gap = upper ? upper_gap : lower_gap;
+#if defined(__AVX2__)
+        {
+            constexpr size_t block = sizeof(__m256i);
+            const auto gap_v = _mm256_set1_epi8(gap);
+            const auto mask = _mm256_set1_epi8(static_cast<char>(nibble_mask));
+            for(; i + block <= len; i += block) {
+                const auto v = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(data + i));
+                const auto hi = nibbles_to_digits(
+                    _mm256_and_si256(_mm256_srli_epi16(v, nibble_bits),
+                                     mask),
+                    gap_v);
+                const auto lo
+                    = nibbles_to_digits(_mm256_and_si256(v, mask), gap_v);
+                // Unpacking interleaves within each 128-bit lane, so the
+                // halves are put back in order before storing.
+                const auto a = _mm256_unpacklo_epi8(hi, lo);
+                const auto b = _mm256_unpackhi_epi8(hi, lo);
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out + i * 2),
+                    _mm256_permute2x128_si256(a, b, 0x20));
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out + i * 2 + block),
+                    _mm256_permute2x128_si256(a, b, 0x31));
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        {
+            constexpr size_t block = sizeof(__m128i);
+            const auto gap_v = _mm_set1_epi8(gap);
+            const auto mask = _mm_set1_epi8(static_cast<char>(nibble_mask));
+            for(; i + block <= len; i += block) {
+                const auto v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(data + i));
+                const auto hi = nibbles_to_digits(
+                    _mm_and_si128(_mm_srli_epi16(v, nibble_bits), mask),
+                    gap_v);
+                const auto lo
+                    = nibbles_to_digits(_mm_and_si128(v, mask), gap_v);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2),
+                                 _mm_unpacklo_epi8(hi, lo));
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(out + i * 2 + block),
+                    _mm_unpackhi_epi8(hi, lo));
+            }
+        }
+#endif
+        encode_scalar(data + i, len - i, out + i * 2, upper);
+    }
+
+    auto hex_decode(const char* hex, size_t len, unsigned char* out) -> bool {
+        size_t i{0};
+#if defined(__AVX2__)
+        {
+            constexpr size_t block = sizeof(__m256i);
+            for(; i + block <= len; i += block) {
+                auto valid0 = __m256i();
+                auto valid1 = __m256i();
+                const auto n0 = digits_to_nibbles(
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(hex + i * 2)),
+                    valid0);
+                const auto n1 = digits_to_nibbles(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                        hex + i * 2 + block)),
+                    valid1);
+                if(_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1))
+                   != -1) {
+                    return false;
+                }
+                // Packing works within each 128-bit lane, leaving the
+                // 64-bit quarters in 0, 2, 1, 3 order.
+                const auto packed = _mm256_packus_epi16(join_nibbles(n0),
+                                                        join_nibbles(n1));
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out + i),
+                    _mm256_permute4x64_epi64(packed, 0xd8));
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        {
+            constexpr size_t block = sizeof(__m128i);
+            constexpr auto all_valid = 0xffff;
+            for(; i + block <= len; i += block) {
+                auto valid0 = __m128i();
+                auto valid1 = __m128i();
+                const auto n0 = digits_to_nibbles(
+                    _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(hex + i * 2)),
+                    valid0);
+                const auto n1 = digits_to_nibbles(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                        hex + i * 2 + block)),
+                    valid1);
+                if(_mm_movemask_epi8(_mm_and_si128(valid0, valid1))
+                   != all_valid) {
+                    return false;
+                }
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(out + i),
+                    _mm_packus_epi16(join_nibbles(n0), join_nibbles(n1)));
+            }
+        }
+#endif
+        return decode_scalar(hex + i * 2, len - i, out + i);
+    }
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_HEX_H_
+#define OPENCBDC_TX_SRC_COMMON_HEX_H_
+
+#include <cstddef>
+
+namespace cbdc {
+    /// Writes the hexadecimal representation of a byte array, two digits
+    /// per byte, most significant nibble first. Uses SIMD instructions
+    /// when the build targets them.
+    /// \param data bytes to encode.
+    /// \param len number of bytes to encode.
+    /// \param out destination for 2 * len characters. No null terminator
+    ///            is written.
+    /// \param upper true to use upper-case digits rather than lower-case.
+    void hex_encode(const unsigned char* data,
+                    size_t len,
+                    char* out,
+                    bool upper = false);
+
+    /// Parses pairs of hexadecimal digits of either case into bytes.
+    /// \param hex 2 * len characters to parse.
+    /// \param len number of bytes to write.
+    /// \param out destination for len bytes.
+    /// \return false if any character is not a hexadecimal digit, in which
+    ///         case the contents of out are unspecified.
+    auto hex_decode(const char* hex, size_t len, unsigned char* out) -> bool;
+}
+
+#endif
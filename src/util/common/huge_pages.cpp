@@ -0,0 +1,65 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "huge_pages.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace cbdc {
+    namespace {
+        std::atomic_bool huge_pages{false};
+    }
+
+    void set_huge_pages(bool enabled) {
+        huge_pages = enabled;
+    }
+
+    auto huge_pages_enabled() -> bool {
+        return huge_pages;
+    }
+
+    auto allocate_array(size_t bytes) -> void* {
+        if(bytes < huge_page_size) {
+            return ::operator new(bytes);
+        }
+        // Aligning every large array, not only those allocated while huge
+        // pages are enabled, lets deallocation tell the two kinds apart by
+        // size alone. The padding is address space the kernel never backs.
+        void* ptr{};
+        if(::posix_memalign(&ptr, huge_page_size, bytes) != 0) {
+            // Without the alignment the array stays on regular pages, and
+            // std::free in deallocate_array still releases it
+            ptr = std::malloc(bytes); // NOLINT(cppcoreguidelines-no-malloc)
+            if(ptr == nullptr) {
+                // As the global operator new does when built without
+                // exceptions
+                std::terminate();
+            }
+            return ptr;
+        }
+#if defined(MADV_HUGEPAGE)
+        if(huge_pages) {
+            // Advisory only: without transparent huge page support the
+            // array is backed by regular pages.
+            static_cast<void>(::madvise(ptr, bytes, MADV_HUGEPAGE));
+        }
+#endif
+        return ptr;
+    }
+
+    void deallocate_array(void* ptr, size_t bytes) noexcept {
+        if(bytes < huge_page_size) {
+            ::operator delete(ptr);
+            return;
+        }
+        std::free(ptr); // NOLINT(cppcoreguidelines-no-malloc)
+    }
+}
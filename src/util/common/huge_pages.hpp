@@ -0,0 +1,87 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_HUGE_PAGES_H_
+#define OPENCBDC_TX_SRC_COMMON_HUGE_PAGES_H_
+
+#include <cstddef>
+#include <new>
+
+namespace cbdc {
+    /// Size of a transparent huge page on x86-64 and arm64 Linux.
+    static constexpr size_t huge_page_size = size_t{2} << 20;
+
+    /// Sets whether arrays allocated through \ref huge_page_allocator
+    /// are backed by transparent huge pages. Call once at startup, before
+    /// building large in-memory structures. Arrays already allocated are
+    /// unaffected.
+    /// \param enabled true to request huge pages.
+    void set_huge_pages(bool enabled);
+
+    /// Returns whether arrays are being backed by huge pages.
+    /// \return true if enabled by \ref set_huge_pages.
+    auto huge_pages_enabled() -> bool;
+
+    /// Allocates memory for an array. Arrays of at least one huge page
+    /// are aligned to a huge page boundary and, if enabled, advised to
+    /// use huge pages, so a table of hundreds of millions of keys needs a
+    /// few thousand TLB entries rather than millions. Smaller arrays use
+    /// the global allocator. Like the global allocator in a build
+    /// without exceptions, terminates the process if the memory could not
+    /// be allocated.
+    /// \param bytes size of the array.
+    /// \return pointer to the memory.
+    auto allocate_array(size_t bytes) -> void*;
+
+    /// Frees memory allocated by \ref allocate_array.
+    /// \param ptr pointer to the memory.
+    /// \param bytes size given when allocating the memory.
+    void deallocate_array(void* ptr, size_t bytes) noexcept;
+
+    /// \brief Allocator for large flat arrays which places them on huge
+    ///        pages when enabled.
+    /// \see allocate_array
+    /// \tparam T type of element.
+    template<typename T>
+    class huge_page_allocator {
+      public:
+        using value_type = T;
+
+        huge_page_allocator() = default;
+
+        /// Converting constructor required of allocators.
+        template<typename U>
+        explicit huge_page_allocator(
+            const huge_page_allocator<U>& /* other */) noexcept {}
+
+        /// Allocates an array.
+        /// \param n number of elements.
+        /// \return pointer to the array.
+        auto allocate(size_t n) -> T* {
+            return static_cast<T*>(allocate_array(n * sizeof(T)));
+        }
+
+        /// Frees an array.
+        /// \param ptr pointer to the array.
+        /// \param n number of elements given when allocating the array.
+        void deallocate(T* ptr, size_t n) noexcept {
+            deallocate_array(ptr, n * sizeof(T));
+        }
+
+        template<typename U>
+        auto operator==(const huge_page_allocator<U>& /* rhs */) const
+            -> bool {
+            return true;
+        }
+
+        template<typename U>
+        auto operator!=(const huge_page_allocator<U>& /* rhs */) const
+            -> bool {
+            return false;
+        }
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_HUGE_PAGES_H_
@@ -5,7 +5,11 @@
 
 #include "keys.hpp"
 
+#include "config.hpp"
+#include "random_source.hpp"
+
 #include <cassert>
+#include <secp256k1.h>
 #include <secp256k1_schnorrsig.h>
 
 namespace cbdc {
@@ -27,4 +31,20 @@ namespace cbdc {
         assert(ser_ret == 1);
         return pubkey;
     }
+
+    auto secp_context() -> const std::shared_ptr<secp256k1_context>& {
+        static const auto ctx = [] {
+            auto ret = std::shared_ptr<secp256k1_context>(
+                ::secp256k1_context_create(SECP256K1_CONTEXT_SIGN
+                                           | SECP256K1_CONTEXT_VERIFY),
+                &::secp256k1_context_destroy);
+            auto rnd = random_source(config::random_source);
+            const auto seed = rnd.random_hash();
+            [[maybe_unused]] const auto rand_ret
+                = ::secp256k1_context_randomize(ret.get(), seed.data());
+            assert(rand_ret == 1);
+            return ret;
+        }();
+        return ctx;
+    }
 }
@@ -8,6 +8,7 @@
 
 #include <array>
 #include <cstring>
+#include <memory>
 #include <vector>
 
 struct secp256k1_context_struct;
@@ -35,6 +36,17 @@ namespace cbdc {
     auto pubkey_from_privkey(const privkey_t& privkey, secp256k1_context* ctx)
         -> pubkey_t;
 
+    /// \brief Returns the secp256k1 context shared by the whole process.
+    ///
+    /// Creating a context builds its precomputed tables, which takes
+    /// milliseconds, so objects and threads share this one instead of
+    /// creating their own. The context can sign and verify, and is
+    /// randomized against side-channel attacks when first created. It is
+    /// never modified afterwards, so any number of threads may use it
+    /// concurrently.
+    /// \return the shared context.
+    auto secp_context() -> const std::shared_ptr<secp256k1_context>&;
+
     /// Converts an std::array into an std::vector of the same size via copy.
     /// \param arr the array to convert.
     /// \return a vector containing the same data as the array.
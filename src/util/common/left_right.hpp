@@ -0,0 +1,96 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_LEFT_RIGHT_H_
+#define OPENCBDC_TX_SRC_COMMON_LEFT_RIGHT_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace cbdc {
+    /// \brief Two copies of an object, letting readers proceed while a
+    ///        writer updates it.
+    ///
+    /// Readers pin the published copy with \ref read and never wait for
+    /// writers. A writer applies its update to the unpublished copy,
+    /// publishes it, waits for the readers still pinning the previous copy
+    /// to release it, then applies the same update to that copy. Writers
+    /// are serialized with each other. Readers should release their pin
+    /// promptly, as the next write waits for it.
+    /// \tparam T type of the object to replicate.
+    template<typename T>
+    class left_right {
+      public:
+        /// Constructor. Constructs both copies from the same arguments.
+        /// \param args arguments to pass to the constructor of T.
+        template<typename... Args>
+        explicit left_right(const Args&... args)
+            : m_left(std::make_unique<T>(args...)),
+              m_right(std::make_unique<T>(args...)) {
+            publish(*m_left);
+        }
+
+        left_right(const left_right&) = delete;
+        auto operator=(const left_right&) -> left_right& = delete;
+        left_right(left_right&&) = delete;
+        auto operator=(left_right&&) -> left_right& = delete;
+
+        ~left_right() = default;
+
+        /// Pins the published copy of the object.
+        /// \return the published copy, which is not modified until the
+        ///         returned pointer and all copies of it are released.
+        [[nodiscard]] auto read() const -> std::shared_ptr<const T> {
+            return std::atomic_load(&m_active);
+        }
+
+        /// Applies an update to both copies of the object, publishing the
+        /// updated copy before the second application.
+        /// \param fn function to apply to each copy in turn. Must leave both
+        ///           copies in the same state.
+        template<typename F>
+        void write(F&& fn) {
+            std::unique_lock l(m_write_mut);
+            auto& standby = m_left_active ? *m_right : *m_left;
+            auto& previous = m_left_active ? *m_left : *m_right;
+            fn(standby);
+            auto previous_released = publish(standby);
+            m_left_active = !m_left_active;
+
+            // Readers can no longer pin the previous copy, so wait for the
+            // ones which already have
+            while(!previous_released->load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            fn(previous);
+        }
+
+      private:
+        /// Publishes a copy to readers.
+        /// \param copy the copy to publish.
+        /// \return flag set once the previously published copy has been
+        ///         released by all readers.
+        auto publish(const T& copy) -> std::shared_ptr<std::atomic<bool>> {
+            auto released = std::make_shared<std::atomic<bool>>(false);
+            auto pin = std::shared_ptr<const T>(&copy, [released](const T*) {
+                released->store(true, std::memory_order_release);
+            });
+            std::atomic_store(&m_active, std::move(pin));
+            return std::exchange(m_active_released, std::move(released));
+        }
+
+        std::unique_ptr<T> m_left;
+        std::unique_ptr<T> m_right;
+        std::shared_ptr<const T> m_active;
+        std::shared_ptr<std::atomic<bool>> m_active_released;
+        bool m_left_active{true};
+        std::mutex m_write_mut;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_LEFT_RIGHT_H_
@@ -0,0 +1,30 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "leveldb_options.hpp"
+
+namespace cbdc {
+    leveldb_options::leveldb_options(const config::leveldb_profile& profile) {
+        m_opt.create_if_missing = true;
+        m_opt.write_buffer_size = profile.m_write_buffer_bytes;
+        m_opt.compression = profile.m_compression
+                              ? leveldb::kSnappyCompression
+                              : leveldb::kNoCompression;
+        if(profile.m_block_cache_bytes > 0) {
+            m_block_cache.reset(
+                leveldb::NewLRUCache(profile.m_block_cache_bytes));
+            m_opt.block_cache = m_block_cache.get();
+        }
+        if(profile.m_bloom_bits_per_key > 0) {
+            m_filter_policy.reset(leveldb::NewBloomFilterPolicy(
+                static_cast<int>(profile.m_bloom_bits_per_key)));
+            m_opt.filter_policy = m_filter_policy.get();
+        }
+    }
+
+    auto leveldb_options::get() const -> leveldb::Options {
+        return m_opt;
+    }
+}
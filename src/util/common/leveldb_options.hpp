@@ -0,0 +1,44 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_LEVELDB_OPTIONS_H_
+#define OPENCBDC_TX_SRC_COMMON_LEVELDB_OPTIONS_H_
+
+#include "config.hpp"
+
+#include <leveldb/cache.h>
+#include <leveldb/filter_policy.h>
+#include <leveldb/options.h>
+#include <memory>
+
+namespace cbdc {
+    /// \brief LevelDB options built from a \ref config::leveldb_profile.
+    ///
+    /// Owns the Bloom filter policy and block cache the options point to,
+    /// so must outlive every database opened with them. Databases opened
+    /// with the same instance share one block cache. Tables must be
+    /// written with a filter policy for lookups to use their filters, so
+    /// tools creating a database should open it with the same profile as
+    /// the component which later reads it.
+    class leveldb_options {
+      public:
+        /// Constructor.
+        /// \param profile tuning to apply.
+        explicit leveldb_options(const config::leveldb_profile& profile = {});
+
+        /// Returns options for opening a database with this tuning,
+        /// creating the database if missing. Callers may set further
+        /// options, such as a comparator, on the returned copy.
+        /// \return database options.
+        [[nodiscard]] auto get() const -> leveldb::Options;
+
+      private:
+        std::unique_ptr<const leveldb::FilterPolicy> m_filter_policy;
+        std::unique_ptr<leveldb::Cache> m_block_cache;
+        leveldb::Options m_opt;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_LEVELDB_OPTIONS_H_
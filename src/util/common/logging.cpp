@@ -15,6 +15,85 @@ namespace cbdc::logging {
           m_loglevel(level),
           m_logfile(std::move(logfile)) {}
 
+    log::~log() {
+        if(m_async) {
+            m_async->push(record{});
+            m_flusher.join();
+        }
+    }
+
+    void log::enable_async(size_t capacity, overflow_policy policy) {
+        if(m_async) {
+            return;
+        }
+        size_t n = 2;
+        while(n < capacity) {
+            n *= 2;
+        }
+        m_overflow = policy;
+        m_async = std::make_unique<mpmc_queue<record>>(n);
+        m_flusher = std::thread([&]() {
+            flush_loop();
+        });
+    }
+
+    void log::write(const std::string& formatted_statement) {
+        const std::lock_guard<std::mutex> lock(m_stream_mut);
+        if(m_stdout) {
+            std::cout << formatted_statement;
+        }
+        *m_logfile << formatted_statement;
+    }
+
+    void log::flush_loop() {
+        static constexpr size_t max_batch = 256;
+        auto recs = std::vector<record>();
+        recs.reserve(max_batch);
+        auto ss = std::stringstream();
+        auto barriers = std::vector<std::promise<void>*>();
+        for(;;) {
+            recs.clear();
+            if(m_async->pop_batch(recs, max_batch) == 0) {
+                return;
+            }
+            ss.str({});
+            auto stop = false;
+            for(auto& rec : recs) {
+                if(rec.m_format) {
+                    write_log_prefix(ss, rec.m_level, rec.m_time);
+                    rec.m_format(ss);
+                    ss << "\n";
+                } else if(rec.m_barrier != nullptr) {
+                    barriers.push_back(rec.m_barrier);
+                } else {
+                    stop = true;
+                }
+            }
+            auto dropped = m_dropped.exchange(0);
+            if(dropped > 0) {
+                write_log_prefix(ss, log_level::warn, clock_type::now());
+                ss << " Dropped " << dropped
+                   << " log statements, buffer full\n";
+            }
+            write(ss.str());
+            for(auto* b : barriers) {
+                b->set_value();
+            }
+            barriers.clear();
+            if(stop) {
+                return;
+            }
+        }
+    }
+
+    void log::await_flushed() {
+        auto barrier = std::promise<void>();
+        auto fut = barrier.get_future();
+        if(m_async->push(record{{}, log_level::trace, nullptr, &barrier})) {
+            fut.wait();
+        }
+    }
+
     void log::set_stdout_enabled(bool stdout_enabled) {
         m_stdout = stdout_enabled;
     }
@@ -50,8 +129,9 @@ namespace cbdc::logging {
         }
     }
 
-    void log::write_log_prefix(std::stringstream& ss, log_level level) {
-        auto now = std::chrono::system_clock::now();
+    void log::write_log_prefix(std::ostream& ss,
+                               log_level level,
+                               clock_type::time_point now) {
         auto now_t = std::chrono::system_clock::to_time_t(now);
         auto now_ms
             = std::chrono::time_point_cast<std::chrono::milliseconds>(now);
@@ -5,15 +5,23 @@
 #ifndef OPENCBDC_TX_SRC_COMMON_LOGGING_H_
 #define OPENCBDC_TX_SRC_COMMON_LOGGING_H_
 
+#include "mpmc_queue.hpp"
+
 #include <chrono>
 #include <cstdint>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 
 namespace cbdc::logging {
     /// No-op stream destination for log output.
@@ -46,6 +54,16 @@ namespace cbdc::logging {
         fatal
     };
 
+    /// What an asynchronous \ref log does with a statement when its buffer
+    /// is full.
+    enum class overflow_policy {
+        /// Wait for the background thread to free space.
+        block,
+        /// Discard the statement. The number of discarded statements is
+        /// logged once space frees up.
+        drop
+    };
+
     /// Generalized logging class. Supports logging to stdout or an output file
     /// at a specified log level.
     class log {
@@ -61,6 +79,29 @@ namespace cbdc::logging {
                      std::unique_ptr<std::ostream> logfile
                      = std::make_unique<null_stream>());
 
+        /// Destructor. Writes any buffered statements and stops the
+        /// background thread if asynchronous mode is enabled.
+        ~log();
+
+        log(const log&) = delete;
+        auto operator=(const log&) -> log& = delete;
+        log(log&&) = delete;
+        auto operator=(log&&) -> log& = delete;
+
+        /// \brief Switches the log to asynchronous mode.
+        ///
+        /// Statements are timestamped and their arguments copied into a
+        /// bounded lock-free buffer, then formatted and written by a
+        /// background thread. Arguments which cannot be copied are formatted
+        /// on the calling thread. Fatal statements are written after all
+        /// buffered statements, before the program exits. Must not be called
+        /// concurrently with logging.
+        /// \param capacity number of statements the buffer holds, rounded up
+        ///                 to a power of two.
+        /// \param policy behavior when the buffer is full.
+        void enable_async(size_t capacity,
+                          overflow_policy policy = overflow_policy::block);
+
         /// Enables or disables printing the log output to stdout.
         /// \param stdout_enabled true if the log should print to stdout.
         void set_stdout_enabled(bool stdout_enabled);
@@ -129,22 +170,97 @@ namespace cbdc::logging {
         std::mutex m_stream_mut{};
         std::unique_ptr<std::ostream> m_logfile;
 
+        using clock_type = std::chrono::system_clock;
+
+        /// Statement awaiting formatting by the background thread. A record
+        /// without a formatter is a barrier if m_barrier is set, otherwise a
+        /// request to stop.
+        struct record {
+            clock_type::time_point m_time{};
+            log_level m_level{};
+            std::function<void(std::ostream&)> m_format;
+            std::promise<void>* m_barrier{};
+        };
+
+        std::unique_ptr<mpmc_queue<record>> m_async;
+        overflow_policy m_overflow{overflow_policy::block};
+        std::atomic<uint64_t> m_dropped{0};
+        std::thread m_flusher;
+
         auto static to_string(log_level level) -> std::string;
-        static void write_log_prefix(std::stringstream& ss, log_level level);
+        static void write_log_prefix(std::ostream& ss,
+                                     log_level level,
+                                     clock_type::time_point now);
+        void write(const std::string& formatted_statement);
+        void flush_loop();
+        void await_flushed();
+
+        template<typename T>
+        static auto capture(T&& arg) {
+            using type = std::decay_t<T>;
+            // Copy strings the caller may free before the statement is
+            // formatted
+            if constexpr(std::is_same_v<type, const char*>
+                         || std::is_same_v<type, char*>
+                         || std::is_same_v<type, std::string_view>) {
+                return std::string(arg);
+            } else {
+                return type(std::forward<T>(arg));
+            }
+        }
+
         template<typename... Targs>
-        void write_log_statement(log_level level, Targs&&... args) {
-            if(m_loglevel <= level) {
+        static auto make_formatter(Targs&&... args)
+            -> std::function<void(std::ostream&)> {
+            if constexpr((std::is_copy_constructible_v<std::decay_t<Targs>>
+                          && ...)) {
+                return [vals = std::make_tuple(capture(
+                            std::forward<Targs>(args))...)](std::ostream& os) {
+                    std::apply(
+                        [&](const auto&... v) {
+                            ((os << " " << v), ...);
+                        },
+                        vals);
+                };
+            } else {
                 std::stringstream ss;
-                write_log_prefix(ss, level);
                 ((ss << " " << args), ...);
-                ss << "\n";
-                auto formatted_statement = ss.str();
-                const std::lock_guard<std::mutex> lock(m_stream_mut);
-                if(m_stdout) {
-                    std::cout << formatted_statement;
+                return [str = ss.str()](std::ostream& os) {
+                    os << str;
+                };
+            }
+        }
+
+        template<typename... Targs>
+        void write_log_statement(log_level level, Targs&&... args) {
+            if(m_loglevel > level) {
+                return;
+            }
+            auto now = clock_type::now();
+            if(m_async) {
+                if(level == log_level::fatal) {
+                    await_flushed();
+                } else {
+                    auto rec = record{
+                        now,
+                        level,
+                        make_formatter(std::forward<Targs>(args)...),
+                        nullptr};
+                    if(m_overflow == overflow_policy::drop) {
+                        if(!m_async->try_push(std::move(rec))) {
+                            m_dropped++;
+                        }
+                    } else {
+                        m_async->push(std::move(rec));
+                    }
+                    return;
                 }
-                *m_logfile << formatted_statement;
             }
+            std::stringstream ss;
+            write_log_prefix(ss, level, now);
+            ((ss << " " << args), ...);
+            ss << "\n";
+            write(ss.str());
         }
     };
 
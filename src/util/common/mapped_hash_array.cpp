@@ -0,0 +1,135 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mapped_hash_array.hpp"
+
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cbdc {
+    namespace {
+        static_assert(sizeof(hash_t) == hash_size);
+
+        auto read_count(const unsigned char* p) -> uint64_t {
+            uint64_t ret{0};
+            for(size_t i{0}; i < sizeof(ret); i++) {
+                ret |= static_cast<uint64_t>(p[i]) << (i * CHAR_BIT);
+            }
+            return ret;
+        }
+    }
+
+    mapped_hash_array::mapped_hash_array(std::string path)
+        : m_path(std::move(path)) {}
+
+    mapped_hash_array::~mapped_hash_array() {
+        unmap();
+    }
+
+    mapped_hash_array::mapped_hash_array(mapped_hash_array&& other) noexcept
+        : m_path(std::move(other.m_path)),
+          m_map(other.m_map),
+          m_map_size(other.m_map_size),
+          m_data(other.m_data),
+          m_size(other.m_size) {
+        other.m_map = nullptr;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    auto mapped_hash_array::operator=(mapped_hash_array&& other) noexcept
+        -> mapped_hash_array& {
+        if(this != &other) {
+            unmap();
+            m_path = std::move(other.m_path);
+            m_map = other.m_map;
+            m_map_size = other.m_map_size;
+            m_data = other.m_data;
+            m_size = other.m_size;
+            other.m_map = nullptr;
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+    auto mapped_hash_array::open() -> bool {
+        unmap();
+        auto fd = ::open(m_path.c_str(), O_RDONLY);
+        if(fd < 0) {
+            return false;
+        }
+        struct stat st {};
+        if(::fstat(fd, &st) != 0 || st.st_size < 0) {
+            ::close(fd);
+            return false;
+        }
+        const auto file_size = static_cast<size_t>(st.st_size);
+        if(file_size < sizeof(uint64_t)) {
+            ::close(fd);
+            return false;
+        }
+        auto* map = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file.
+        ::close(fd);
+        if(map == MAP_FAILED) {
+            return false;
+        }
+        m_map = map;
+        m_map_size = file_size;
+
+        const auto* bytes = static_cast<const unsigned char*>(map);
+        size_t offset{0};
+        if(file_size >= magic.size() + sizeof(uint64_t)
+           && std::memcmp(bytes, magic.data(), magic.size()) == 0) {
+            offset = magic.size();
+        }
+        const auto count = read_count(bytes + offset);
+        offset += sizeof(uint64_t);
+        if((file_size - offset) / hash_size < count
+           || (file_size - offset) % hash_size != 0) {
+            unmap();
+            return false;
+        }
+        m_size = static_cast<size_t>(count);
+        m_data = reinterpret_cast<const hash_t*>(bytes + offset);
+        // Callers read the whole array once, front to back.
+        ::madvise(map, file_size, MADV_SEQUENTIAL);
+        ::madvise(map, file_size, MADV_WILLNEED);
+        return true;
+    }
+
+    auto mapped_hash_array::data() const -> const hash_t* {
+        return m_data;
+    }
+
+    auto mapped_hash_array::size() const -> size_t {
+        return m_size;
+    }
+
+    auto mapped_hash_array::write_header(std::ostream& out, uint64_t count)
+        -> bool {
+        out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+        auto buf = std::array<char, sizeof(count)>();
+        for(size_t i{0}; i < buf.size(); i++) {
+            buf[i] = static_cast<char>((count >> (i * CHAR_BIT)) & UINT8_MAX);
+        }
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        return out.good();
+    }
+
+    void mapped_hash_array::unmap() {
+        if(m_map != nullptr) {
+            ::munmap(m_map, m_map_size);
+            m_map = nullptr;
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
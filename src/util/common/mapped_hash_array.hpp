@@ -0,0 +1,73 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_MAPPED_HASH_ARRAY_H_
+#define OPENCBDC_TX_SRC_COMMON_MAPPED_HASH_ARRAY_H_
+
+#include "hash.hpp"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace cbdc {
+    /// \brief Read-only, memory-mapped file of fixed-width hashes.
+    ///
+    /// The file holds an 8-byte magic, a little-endian uint64 count and
+    /// then count 32-byte hashes back to back, so the hashes are used in
+    /// place with no parsing. Files without the magic are read as a bare
+    /// count followed by the hashes, which is the layout of a serialized
+    /// hash set. Move-only; the mapping is removed on destruction.
+    class mapped_hash_array {
+      public:
+        /// Magic marking a file written by \ref write_header.
+        static constexpr std::array<char, 8> magic
+            = {'C', 'B', 'D', 'C', 'H', 'S', 'H', '1'};
+
+        /// Constructor. Does not open the file.
+        /// \param path path of the file to map.
+        explicit mapped_hash_array(std::string path);
+
+        ~mapped_hash_array();
+        mapped_hash_array(const mapped_hash_array&) = delete;
+        auto operator=(const mapped_hash_array&)
+            -> mapped_hash_array& = delete;
+        mapped_hash_array(mapped_hash_array&& other) noexcept;
+        auto operator=(mapped_hash_array&& other) noexcept
+            -> mapped_hash_array&;
+
+        /// Maps the file and checks its length matches its header.
+        /// \return true if the file was mapped.
+        auto open() -> bool;
+
+        /// Returns the mapped hashes.
+        /// \return first hash, or nullptr if the file is not mapped.
+        [[nodiscard]] auto data() const -> const hash_t*;
+
+        /// Returns the number of mapped hashes.
+        /// \return hash count.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Writes the header for a file of hashes. Writing it again with
+        /// the final count, from the start of the stream, lets writers
+        /// stream hashes without knowing the count in advance.
+        /// \param out stream positioned at the start of the file.
+        /// \param count number of hashes that follow.
+        /// \return true if the header was written.
+        static auto write_header(std::ostream& out, uint64_t count) -> bool;
+
+      private:
+        void unmap();
+
+        std::string m_path;
+        void* m_map{nullptr};
+        size_t m_map_size{0};
+        const hash_t* m_data{nullptr};
+        size_t m_size{0};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_MAPPED_HASH_ARRAY_H_
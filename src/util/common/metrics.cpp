@@ -0,0 +1,198 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.hpp"
+
+#include <cassert>
+#include <sstream>
+
+namespace cbdc::metrics {
+    auto this_thread_shard() -> size_t {
+        static std::atomic<size_t> next_shard{0};
+        thread_local const size_t shard
+            = next_shard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+        return shard;
+    }
+
+    auto counter::value() const -> uint64_t {
+        uint64_t ret{0};
+        for(const auto& s : m_shards) {
+            ret += s.m_val.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    auto histogram_snapshot::quantile(double q) const -> uint64_t {
+        if(m_count == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(q * static_cast<double>(m_count));
+        if(rank >= m_count) {
+            rank = m_count - 1;
+        }
+        uint64_t seen{0};
+        for(size_t i{0}; i < m_counts.size(); i++) {
+            seen += m_counts[i];
+            if(seen > rank) {
+                return histogram::bucket_upper_bound(i);
+            }
+        }
+        return histogram::max_value;
+    }
+
+    histogram::histogram(double scale)
+        : m_scale(scale),
+          m_shards(std::make_unique<shard[]>(shard_count)) {}
+
+    auto histogram::snapshot() const -> histogram_snapshot {
+        auto ret = histogram_snapshot();
+        ret.m_counts.resize(bucket_count);
+        for(size_t s{0}; s < shard_count; s++) {
+            const auto& sh = m_shards[s];
+            for(size_t i{0}; i < bucket_count; i++) {
+                auto n = sh.m_counts[i].load(std::memory_order_relaxed);
+                ret.m_counts[i] += n;
+                ret.m_count += n;
+            }
+            ret.m_sum += sh.m_sum.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    auto histogram::scale() const -> double {
+        return m_scale;
+    }
+
+    auto histogram::bucket_upper_bound(size_t idx) -> uint64_t {
+        if(idx < sub_buckets) {
+            return idx;
+        }
+        if(idx >= bucket_count - 1) {
+            return max_value;
+        }
+        auto exp = idx / sub_buckets + sub_bucket_bits - 1;
+        auto sub = idx % sub_buckets;
+        auto width = uint64_t{1} << (exp - sub_bucket_bits);
+        return ((sub_buckets + sub) << (exp - sub_bucket_bits)) + width - 1;
+    }
+
+    sampler::sampler(std::chrono::milliseconds interval,
+                     std::function<void()> fn) {
+        m_thread = std::thread([this, interval, f = std::move(fn)]() {
+            std::unique_lock<std::mutex> l(m_mut);
+            while(!m_stop) {
+                l.unlock();
+                f();
+                l.lock();
+                m_cv.wait_for(l, interval, [&]() {
+                    return m_stop;
+                });
+            }
+        });
+    }
+
+    sampler::~sampler() {
+        {
+            std::lock_guard<std::mutex> l(m_mut);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    auto registry::global() -> registry& {
+        static auto reg = registry();
+        return reg;
+    }
+
+    auto registry::get_counter(const std::string& name,
+                               const std::string& help) -> counter& {
+        std::lock_guard<std::mutex> l(m_mut);
+        auto& e = m_metrics[name];
+        if(!e.m_counter) {
+            assert(!e.m_histogram && !e.m_gauge);
+            e.m_help = help;
+            e.m_counter = std::make_unique<counter>();
+        }
+        return *e.m_counter;
+    }
+
+    auto registry::get_gauge(const std::string& name,
+                             const std::string& help) -> gauge& {
+        std::lock_guard<std::mutex> l(m_mut);
+        auto& e = m_metrics[name];
+        if(!e.m_gauge) {
+            assert(!e.m_counter && !e.m_histogram);
+            e.m_help = help;
+            e.m_gauge = std::make_unique<gauge>();
+        }
+        return *e.m_gauge;
+    }
+
+    auto registry::get_histogram(const std::string& name,
+                                 const std::string& help,
+                                 double scale) -> histogram& {
+        std::lock_guard<std::mutex> l(m_mut);
+        auto& e = m_metrics[name];
+        if(!e.m_histogram) {
+            assert(!e.m_counter && !e.m_gauge);
+            e.m_help = help;
+            e.m_histogram = std::make_unique<histogram>(scale);
+        }
+        return *e.m_histogram;
+    }
+
+    auto registry::get_latency_histogram(const std::string& name,
+                                         const std::string& help)
+        -> histogram& {
+        static constexpr double ns_to_s = 1e-9;
+        return get_histogram(name, help, ns_to_s);
+    }
+
+    void registry::write_prometheus(std::ostream& os) const {
+        std::lock_guard<std::mutex> l(m_mut);
+        for(const auto& [name, e] : m_metrics) {
+            os << "# HELP " << name << " " << e.m_help << "\n";
+            if(e.m_counter) {
+                os << "# TYPE " << name << " counter\n"
+                   << name << " " << e.m_counter->value() << "\n";
+                continue;
+            }
+            if(e.m_gauge) {
+                os << "# TYPE " << name << " gauge\n"
+                   << name << " " << e.m_gauge->value() << "\n";
+                continue;
+            }
+            const auto& h = *e.m_histogram;
+            auto snap = h.snapshot();
+            os << "# TYPE " << name << " histogram\n";
+            // Cumulative counts at each power of two, the last bucket
+            // boundary within each major bucket
+            uint64_t cumulative{0};
+            size_t idx{0};
+            for(size_t exp{0}; exp <= histogram::max_exponent; exp++) {
+                auto bound = (uint64_t{2} << exp) - 1;
+                for(; idx < histogram::bucket_count
+                      && histogram::bucket_upper_bound(idx) <= bound;
+                    idx++) {
+                    cumulative += snap.m_counts[idx];
+                }
+                os << name << "_bucket{le=\""
+                   << static_cast<double>(bound + 1) * h.scale() << "\"} "
+                   << cumulative << "\n";
+            }
+            os << name << "_bucket{le=\"+Inf\"} " << snap.m_count << "\n"
+               << name << "_sum "
+               << static_cast<double>(snap.m_sum) * h.scale() << "\n"
+               << name << "_count " << snap.m_count << "\n";
+        }
+    }
+
+    auto registry::to_prometheus() const -> std::string {
+        auto ss = std::stringstream();
+        write_prometheus(ss);
+        return ss.str();
+    }
+}
@@ -0,0 +1,299 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_METRICS_H_
+#define OPENCBDC_TX_SRC_COMMON_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Low-overhead process-wide counters and histograms, exported in the
+/// Prometheus text format.
+namespace cbdc::metrics {
+    /// Number of independently updated copies of each metric. Threads are
+    /// spread across shards so concurrent updates rarely share a cache
+    /// line.
+    static constexpr size_t shard_count = 16;
+
+    /// Content type of \ref registry::to_prometheus output.
+    static constexpr auto prometheus_content_type
+        = "text/plain; version=0.0.4";
+
+    /// Returns the shard index of the calling thread.
+    auto this_thread_shard() -> size_t;
+
+    /// Monotonically increasing count. Updates are a single relaxed atomic
+    /// add on a shard local to the calling thread.
+    class counter {
+      public:
+        /// Adds to the counter.
+        /// \param n amount to add.
+        void add(uint64_t n = 1) {
+            m_shards[this_thread_shard()].m_val.fetch_add(
+                n,
+                std::memory_order_relaxed);
+        }
+
+        /// Returns the sum of all shards.
+        [[nodiscard]] auto value() const -> uint64_t;
+
+      private:
+        struct alignas(64) shard {
+            std::atomic<uint64_t> m_val{};
+        };
+
+        std::array<shard, shard_count> m_shards{};
+    };
+
+    /// Current value of a quantity which rises and falls, such as the size
+    /// of a container. Updates are a single relaxed atomic store, so a
+    /// gauge is usually set by a \ref sampler rather than on every change.
+    class gauge {
+      public:
+        /// Sets the gauge.
+        /// \param val new value.
+        void set(uint64_t val) {
+            m_val.store(val, std::memory_order_relaxed);
+        }
+
+        /// Returns the most recently set value.
+        [[nodiscard]] auto value() const -> uint64_t {
+            return m_val.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic<uint64_t> m_val{};
+    };
+
+    /// Point-in-time copy of a \ref histogram.
+    struct histogram_snapshot {
+        /// Number of values in each bucket.
+        std::vector<uint64_t> m_counts;
+        /// Number of recorded values.
+        uint64_t m_count{};
+        /// Sum of recorded values.
+        uint64_t m_sum{};
+
+        /// Returns an upper bound for the given quantile of the recorded
+        /// values, accurate to within the bucket resolution.
+        /// \param q quantile in [0, 1].
+        /// \return upper bound of the bucket containing the quantile, or
+        ///         zero if no values were recorded.
+        [[nodiscard]] auto quantile(double q) const -> uint64_t;
+    };
+
+    /// \brief Log-linear histogram of unsigned integer values.
+    ///
+    /// Each power of two is split into \ref sub_buckets linear buckets, so
+    /// any value is placed in a bucket no wider than 1/8th of its
+    /// magnitude, as in an HDR histogram. Values above \ref max_value are
+    /// counted in the last bucket. Recording is two relaxed atomic adds on
+    /// a shard local to the calling thread.
+    class histogram {
+      public:
+        /// Linear buckets per power of two.
+        static constexpr size_t sub_bucket_bits = 3;
+        static constexpr size_t sub_buckets = size_t{1} << sub_bucket_bits;
+        /// Largest power of two tracked. With nanosecond values, just over
+        /// 18 minutes.
+        static constexpr size_t max_exponent = 40;
+        static constexpr uint64_t max_value
+            = (uint64_t{1} << (max_exponent + 1)) - 1;
+        static constexpr size_t bucket_count
+            = (max_exponent - sub_bucket_bits + 2) * sub_buckets;
+
+        /// Constructor.
+        /// \param scale multiplier converting recorded values into the
+        ///              exported unit, e.g. 1e-9 for nanoseconds recorded
+        ///              into a histogram exported in seconds.
+        explicit histogram(double scale = 1.0);
+
+        /// Records a value.
+        /// \param val value to record.
+        void record(uint64_t val) {
+            auto& s = m_shards[this_thread_shard()];
+            s.m_counts[bucket_index(val)].fetch_add(
+                1,
+                std::memory_order_relaxed);
+            s.m_sum.fetch_add(val, std::memory_order_relaxed);
+        }
+
+        /// Records a duration in nanoseconds.
+        /// \param d duration to record.
+        template<typename Rep, typename Period>
+        void record(std::chrono::duration<Rep, Period> d) {
+            auto ns
+                = std::chrono::duration_cast<std::chrono::nanoseconds>(d)
+                      .count();
+            record(static_cast<uint64_t>(ns < 0 ? 0 : ns));
+        }
+
+        /// Merges the shards into a snapshot. Concurrent updates may or may
+        /// not be included.
+        [[nodiscard]] auto snapshot() const -> histogram_snapshot;
+
+        /// Returns the multiplier to the exported unit.
+        [[nodiscard]] auto scale() const -> double;
+
+        /// Returns the index of the bucket containing the given value.
+        static auto bucket_index(uint64_t val) -> size_t {
+            if(val < sub_buckets) {
+                return static_cast<size_t>(val);
+            }
+            if(val > max_value) {
+                return bucket_count - 1;
+            }
+            auto exp = static_cast<size_t>(63 - __builtin_clzll(val));
+            auto shift = exp - sub_bucket_bits;
+            return (exp - sub_bucket_bits + 1) * sub_buckets
+                 + static_cast<size_t>((val >> shift) & (sub_buckets - 1));
+        }
+
+        /// Returns the largest value placed in the given bucket.
+        static auto bucket_upper_bound(size_t idx) -> uint64_t;
+
+      private:
+        struct alignas(64) shard {
+            std::array<std::atomic<uint64_t>, bucket_count> m_counts{};
+            std::atomic<uint64_t> m_sum{};
+        };
+
+        double m_scale;
+        std::unique_ptr<shard[]> m_shards;
+    };
+
+    /// Records the time between construction and destruction into a
+    /// histogram.
+    class scoped_timer {
+      public:
+        /// Constructor. Starts the timer.
+        /// \param hist histogram in which to record the elapsed time.
+        explicit scoped_timer(histogram& hist)
+            : m_hist(hist),
+              m_start(std::chrono::steady_clock::now()) {}
+
+        /// Destructor. Records the elapsed time.
+        ~scoped_timer() {
+            m_hist.record(std::chrono::steady_clock::now() - m_start);
+        }
+
+        scoped_timer(const scoped_timer&) = delete;
+        auto operator=(const scoped_timer&) -> scoped_timer& = delete;
+        scoped_timer(scoped_timer&&) = delete;
+        auto operator=(scoped_timer&&) -> scoped_timer& = delete;
+
+      private:
+        histogram& m_hist;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /// \brief Runs a function at a fixed interval on a background thread.
+    ///
+    /// Used to update gauges from structures too costly to measure on
+    /// every change. The function first runs when the sampler starts.
+    class sampler {
+      public:
+        /// Constructor. Starts the background thread.
+        /// \param interval time between runs.
+        /// \param fn function to run. Should not block for long, as it
+        ///           delays destruction of the sampler.
+        sampler(std::chrono::milliseconds interval, std::function<void()> fn);
+
+        /// Destructor. Stops the background thread, waiting for a running
+        /// call to return.
+        ~sampler();
+
+        sampler(const sampler&) = delete;
+        auto operator=(const sampler&) -> sampler& = delete;
+        sampler(sampler&&) = delete;
+        auto operator=(sampler&&) -> sampler& = delete;
+
+      private:
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        bool m_stop{false};
+        std::thread m_thread;
+    };
+
+    /// \brief Named collection of metrics.
+    ///
+    /// Metrics are created on first lookup and live as long as the
+    /// registry, so callers should look a metric up once and keep the
+    /// reference, typically in a function-local static.
+    class registry {
+      public:
+        registry() = default;
+
+        /// Returns the registry shared by the whole process.
+        static auto global() -> registry&;
+
+        /// Returns the counter with the given name, creating it if needed.
+        /// \param name metric name. By convention ends in _total.
+        /// \param help description of the metric.
+        /// \return counter which lives as long as the registry.
+        auto get_counter(const std::string& name, const std::string& help)
+            -> counter&;
+
+        /// Returns the gauge with the given name, creating it if needed.
+        /// \param name metric name. By convention ends in a unit, such as
+        ///             _bytes.
+        /// \param help description of the metric.
+        /// \return gauge which lives as long as the registry.
+        auto get_gauge(const std::string& name, const std::string& help)
+            -> gauge&;
+
+        /// Returns the histogram with the given name, creating it if
+        /// needed.
+        /// \param name metric name.
+        /// \param help description of the metric.
+        /// \param scale multiplier converting recorded values into the
+        ///              exported unit. Ignored if the histogram exists.
+        /// \return histogram which lives as long as the registry.
+        auto get_histogram(const std::string& name,
+                           const std::string& help,
+                           double scale = 1.0) -> histogram&;
+
+        /// Returns a histogram of durations recorded in nanoseconds and
+        /// exported in seconds.
+        /// \param name metric name. By convention ends in _seconds.
+        /// \param help description of the metric.
+        /// \return histogram which lives as long as the registry.
+        auto get_latency_histogram(const std::string& name,
+                                   const std::string& help) -> histogram&;
+
+        /// Writes every metric in the Prometheus text exposition format.
+        /// Histograms are exported with a bucket per power of two.
+        /// \param os stream to which to write.
+        void write_prometheus(std::ostream& os) const;
+
+        /// Returns every metric in the Prometheus text exposition format.
+        [[nodiscard]] auto to_prometheus() const -> std::string;
+
+      private:
+        struct entry {
+            std::string m_help;
+            std::unique_ptr<counter> m_counter;
+            std::unique_ptr<gauge> m_gauge;
+            std::unique_ptr<histogram> m_histogram;
+        };
+
+        mutable std::mutex m_mut;
+        std::map<std::string, entry> m_metrics;
+    };
+}
+
+#endif
@@ -0,0 +1,275 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_MPMC_QUEUE_H_
+#define OPENCBDC_TX_SRC_COMMON_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Bounded lock-free multi-producer multi-consumer queue.
+    ///
+    /// Ring buffer where each slot carries a sequence number, so producers
+    /// and consumers claim slots with a single compare-and-swap. Blocking
+    /// operations spin briefly before parking on a condition variable,
+    /// which is only touched when a thread is parked. Drop-in alternative
+    /// to \ref blocking_queue for hot paths, where \ref pop_batch lets a
+    /// consumer drain many elements per wake-up.
+    /// \tparam T type of object stored in the queue. Must be default
+    ///           constructible and move assignable.
+    template<typename T>
+    class mpmc_queue {
+      public:
+        /// Constructor.
+        /// \param capacity maximum number of elements. Must be a power of
+        ///                 two.
+        explicit mpmc_queue(size_t capacity)
+            : m_mask(capacity - 1),
+              m_cells(std::make_unique<cell[]>(capacity)) {
+            assert(capacity > 1 && (capacity & (capacity - 1)) == 0);
+            for(size_t i = 0; i < capacity; i++) {
+                m_cells[i].m_seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        mpmc_queue(const mpmc_queue&) = delete;
+        auto operator=(const mpmc_queue&) -> mpmc_queue& = delete;
+        mpmc_queue(mpmc_queue&&) = delete;
+        auto operator=(mpmc_queue&&) -> mpmc_queue& = delete;
+
+        /// \brief Destructor.
+        ///
+        /// Clears the queue and unblocks any waiting producers and
+        /// consumers.
+        ~mpmc_queue() {
+            clear();
+        }
+
+        /// Pushes an element onto the queue if there is space, without
+        /// blocking.
+        /// \param item object to push onto the queue.
+        /// \return true if the element was pushed, false if the queue was
+        ///         full.
+        [[nodiscard]] auto try_push(T&& item) -> bool {
+            auto pos = m_tail.load(std::memory_order_relaxed);
+            for(;;) {
+                auto& c = m_cells[pos & m_mask];
+                auto seq = c.m_seq.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(seq)
+                          - static_cast<std::ptrdiff_t>(pos);
+                if(diff == 0) {
+                    if(m_tail.compare_exchange_weak(
+                           pos,
+                           pos + 1,
+                           std::memory_order_relaxed)) {
+                        c.m_data = std::move(item);
+                        c.m_seq.store(pos + 1, std::memory_order_release);
+                        wake(m_consumers_waiting);
+                        return true;
+                    }
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// Pushes an element onto the queue, waiting for space if the queue
+        /// is full.
+        /// \param item object to push onto the queue.
+        /// \return true on success, false if the queue has been cleared
+        ///         since the last \ref reset().
+        auto push(T item) -> bool {
+            return wait(
+                m_producers_waiting,
+                [&]() {
+                    return !m_cleared.load(std::memory_order_relaxed)
+                        && try_push(std::move(item));
+                },
+                [&]() {
+                    return can_push();
+                });
+        }
+
+        /// Pops an element from the queue if there is one, without
+        /// blocking.
+        /// \param item object into which to move the popped element.
+        /// \return true if an element was popped, false if the queue was
+        ///         empty.
+        [[nodiscard]] auto try_pop(T& item) -> bool {
+            auto pos = m_head.load(std::memory_order_relaxed);
+            for(;;) {
+                auto& c = m_cells[pos & m_mask];
+                auto seq = c.m_seq.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(seq)
+                          - static_cast<std::ptrdiff_t>(pos + 1);
+                if(diff == 0) {
+                    if(m_head.compare_exchange_weak(
+                           pos,
+                           pos + 1,
+                           std::memory_order_relaxed)) {
+                        item = std::move(c.m_data);
+                        c.m_seq.store(pos + m_mask + 1,
+                                      std::memory_order_release);
+                        wake(m_producers_waiting);
+                        return true;
+                    }
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = m_head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// \brief Pops an element from the queue.
+        ///
+        /// Blocks if the queue is empty. Unblocks on destruction or \ref
+        /// clear without returning an element.
+        /// \param item object into which to move the popped element.
+        /// \return true on success, false if interrupted by \ref clear() or
+        ///         destruction.
+        [[nodiscard]] auto pop(T& item) -> bool {
+            return wait(
+                m_consumers_waiting,
+                [&]() {
+                    return try_pop(item);
+                },
+                [&]() {
+                    return can_pop();
+                });
+        }
+
+        /// \brief Pops up to max elements from the queue.
+        ///
+        /// Blocks until at least one element is available, then appends
+        /// every available element, up to max, to out.
+        /// \param out vector to which to append popped elements.
+        /// \param max maximum number of elements to pop.
+        /// \return number of elements popped, or zero if interrupted by \ref
+        ///         clear() or destruction.
+        [[nodiscard]] auto pop_batch(std::vector<T>& out, size_t max)
+            -> size_t {
+            auto item = T();
+            if(max == 0 || !pop(item)) {
+                return 0;
+            }
+            out.emplace_back(std::move(item));
+            size_t n = 1;
+            while(n < max && try_pop(item)) {
+                out.emplace_back(std::move(item));
+                n++;
+            }
+            return n;
+        }
+
+        /// Clears the queue and unblocks waiting producers and consumers.
+        void clear() {
+            {
+                std::unique_lock<std::mutex> l(m_mut);
+                m_cleared.store(true, std::memory_order_seq_cst);
+            }
+            m_cv.notify_all();
+            auto item = T();
+            while(try_pop(item)) {}
+        }
+
+        /// Removes the wakeup flag for waiting threads. Must be called
+        /// after \ref clear() before re-using the queue. All producers and
+        /// consumers must have returned before calling this method.
+        void reset() {
+            std::unique_lock<std::mutex> l(m_mut);
+            m_cleared = false;
+        }
+
+      private:
+        struct cell {
+            std::atomic<size_t> m_seq{};
+            T m_data{};
+        };
+
+        static constexpr size_t spin_count = 64;
+
+        size_t m_mask;
+        std::unique_ptr<cell[]> m_cells;
+        std::atomic<size_t> m_head{0};
+        std::atomic<size_t> m_tail{0};
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::atomic<size_t> m_consumers_waiting{0};
+        std::atomic<size_t> m_producers_waiting{0};
+        std::atomic<bool> m_cleared{false};
+
+        auto can_push() const -> bool {
+            auto pos = m_tail.load(std::memory_order_relaxed);
+            return m_cells[pos & m_mask].m_seq.load(std::memory_order_acquire)
+                == pos;
+        }
+
+        auto can_pop() const -> bool {
+            auto pos = m_head.load(std::memory_order_relaxed);
+            return m_cells[pos & m_mask].m_seq.load(std::memory_order_acquire)
+                == pos + 1;
+        }
+
+        // Retries op until it succeeds, spinning and then parking until
+        // ready() suggests op may succeed. Returns false if the queue is
+        // cleared meanwhile. op() may wake other threads so must not be
+        // called with m_mut held.
+        template<typename Op, typename Ready>
+        auto wait(std::atomic<size_t>& waiting, Op&& op, Ready&& ready)
+            -> bool {
+            for(size_t i = 0; i < spin_count; i++) {
+                if(op()) {
+                    return true;
+                }
+                if(m_cleared.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            for(;;) {
+                if(op()) {
+                    return true;
+                }
+                std::unique_lock<std::mutex> l(m_mut);
+                if(m_cleared.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                waiting.fetch_add(1, std::memory_order_seq_cst);
+                // Pairs with the fence in wake() so either the waker sees
+                // this thread waiting, or ready() sees the change
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(!ready()) {
+                    m_cv.wait(l);
+                }
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        void wake(std::atomic<size_t>& waiting) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(waiting.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> l(m_mut);
+            }
+            // Producers and consumers share the condition variable
+            m_cv.notify_all();
+        }
+    };
+}
+
+#endif
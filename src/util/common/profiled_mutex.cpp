@@ -0,0 +1,25 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "profiled_mutex.hpp"
+
+namespace cbdc {
+    namespace detail {
+        auto get_lock_histograms(const std::string& name) -> lock_histograms {
+            auto& reg = metrics::registry::global();
+            return {&reg.get_latency_histogram(
+                        "lock_" + name + "_wait_seconds",
+                        "Time spent waiting to acquire the " + name
+                            + " lock."),
+                    &reg.get_latency_histogram(
+                        "lock_" + name + "_hold_seconds",
+                        "Time the " + name + " lock was held exclusively.")};
+        }
+    }
+
+    void set_lock_profiling(bool enabled) {
+        detail::lock_profiling = enabled;
+    }
+}
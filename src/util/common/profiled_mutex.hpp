@@ -0,0 +1,161 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_PROFILED_MUTEX_H_
+#define OPENCBDC_TX_SRC_COMMON_PROFILED_MUTEX_H_
+
+#include "metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+namespace cbdc {
+    namespace detail {
+        /// Set while profiled mutexes record wait and hold times.
+        inline std::atomic_bool lock_profiling{false};
+
+        /// Histograms of one named lock.
+        struct lock_histograms {
+            /// Time spent waiting to acquire the lock.
+            metrics::histogram* m_wait;
+            /// Time the lock was held exclusively.
+            metrics::histogram* m_hold;
+        };
+
+        /// Returns the histograms of the named lock from the global metrics
+        /// registry, creating them if needed.
+        /// \param name lock name.
+        /// \return the lock's histograms.
+        auto get_lock_histograms(const std::string& name) -> lock_histograms;
+    }
+
+    /// Sets whether profiled mutexes record wait and hold times. Call at
+    /// startup, typically from the lock_profiling option.
+    /// \param enabled true to record times.
+    void set_lock_profiling(bool enabled);
+
+    /// \brief Mutex which records, when profiling is enabled, how long
+    ///        threads wait to acquire it and how long they hold it.
+    ///
+    /// Times are recorded into the histograms lock_<name>_wait_seconds and
+    /// lock_<name>_hold_seconds, shared by every mutex with the same name.
+    /// While profiling is disabled each operation costs one relaxed atomic
+    /// load on top of the underlying mutex. Meets the Lockable
+    /// requirements, so works with std::lock_guard, std::unique_lock and
+    /// std::condition_variable_any.
+    /// \tparam Mutex underlying mutex type.
+    template<typename Mutex>
+    class basic_profiled_mutex {
+      public:
+        /// Constructor.
+        /// \param name name under which times are recorded.
+        explicit basic_profiled_mutex(const std::string& name)
+            : m_hists(detail::get_lock_histograms(name)) {}
+
+        basic_profiled_mutex(const basic_profiled_mutex&) = delete;
+        auto operator=(const basic_profiled_mutex&)
+            -> basic_profiled_mutex& = delete;
+        basic_profiled_mutex(basic_profiled_mutex&&) = delete;
+        auto operator=(basic_profiled_mutex&&)
+            -> basic_profiled_mutex& = delete;
+
+        ~basic_profiled_mutex() = default;
+
+        /// Acquires the mutex exclusively.
+        void lock() {
+            if(!detail::lock_profiling.load(std::memory_order_relaxed)) {
+                m_mut.lock();
+                return;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            if(m_mut.try_lock()) {
+                m_hists.m_wait->record(uint64_t{0});
+                m_acquired = start;
+                return;
+            }
+            m_mut.lock();
+            m_acquired = std::chrono::steady_clock::now();
+            m_hists.m_wait->record(m_acquired - start);
+        }
+
+        /// Acquires the mutex exclusively if it is free.
+        /// \return true if the mutex was acquired.
+        auto try_lock() -> bool {
+            if(!m_mut.try_lock()) {
+                return false;
+            }
+            if(detail::lock_profiling.load(std::memory_order_relaxed)) {
+                m_acquired = std::chrono::steady_clock::now();
+            }
+            return true;
+        }
+
+        /// Releases the mutex from exclusive ownership.
+        void unlock() {
+            // The holder recorded the acquisition time if profiling was
+            // enabled then, whatever the setting is now.
+            if(m_acquired == std::chrono::steady_clock::time_point()) {
+                m_mut.unlock();
+                return;
+            }
+            const auto held = std::chrono::steady_clock::now() - m_acquired;
+            m_acquired = {};
+            m_mut.unlock();
+            m_hists.m_hold->record(held);
+        }
+
+      protected:
+        Mutex m_mut;
+        detail::lock_histograms m_hists;
+
+      private:
+        /// Time the current exclusive holder acquired the mutex, or zero.
+        std::chrono::steady_clock::time_point m_acquired{};
+    };
+
+    /// Profiled std::mutex. \see basic_profiled_mutex
+    using profiled_mutex = basic_profiled_mutex<std::mutex>;
+
+    /// \brief Profiled std::shared_mutex. \see basic_profiled_mutex
+    ///
+    /// Shared acquisitions record their wait time. Their hold time is not
+    /// recorded, as holders cannot be told apart.
+    class profiled_shared_mutex
+        : public basic_profiled_mutex<std::shared_mutex> {
+      public:
+        using basic_profiled_mutex::basic_profiled_mutex;
+
+        /// Acquires the mutex shared.
+        void lock_shared() {
+            if(!detail::lock_profiling.load(std::memory_order_relaxed)) {
+                m_mut.lock_shared();
+                return;
+            }
+            if(m_mut.try_lock_shared()) {
+                m_hists.m_wait->record(uint64_t{0});
+                return;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            m_mut.lock_shared();
+            m_hists.m_wait->record(std::chrono::steady_clock::now() - start);
+        }
+
+        /// Acquires the mutex shared if no thread holds it exclusively.
+        /// \return true if the mutex was acquired.
+        auto try_lock_shared() -> bool {
+            return m_mut.try_lock_shared();
+        }
+
+        /// Releases the mutex from shared ownership.
+        void unlock_shared() {
+            m_mut.unlock_shared();
+        }
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_COMMON_PROFILED_MUTEX_H_
@@ -0,0 +1,41 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "shard_prefix_map.hpp"
+
+namespace cbdc {
+    shard_prefix_map::shard_prefix_map(const std::vector<range_t>& ranges)
+        : m_shard_count(ranges.size()) {
+        for(size_t i{0}; i < ranges.size(); i++) {
+            for(size_t prefix = ranges[i].first; prefix <= ranges[i].second;
+                prefix++) {
+                m_shards[prefix].push_back(i);
+            }
+        }
+    }
+
+    shard_prefix_map::shard_prefix_map(
+        const std::vector<std::optional<range_t>>& ranges)
+        : m_shard_count(ranges.size()) {
+        for(size_t i{0}; i < ranges.size(); i++) {
+            if(!ranges[i].has_value()) {
+                continue;
+            }
+            for(size_t prefix = ranges[i]->first; prefix <= ranges[i]->second;
+                prefix++) {
+                m_shards[prefix].push_back(i);
+            }
+        }
+    }
+
+    auto shard_prefix_map::shards(const hash_t& h) const
+        -> const std::vector<size_t>& {
+        return m_shards[h[0]];
+    }
+
+    auto shard_prefix_map::shard_count() const -> size_t {
+        return m_shard_count;
+    }
+}
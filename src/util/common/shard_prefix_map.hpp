@@ -0,0 +1,60 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_SHARD_PREFIX_MAP_H_
+#define OPENCBDC_TX_SRC_COMMON_SHARD_PREFIX_MAP_H_
+
+#include "hash.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Lookup table from hash prefixes to the shards covering them.
+    ///
+    /// Built once from the shards' inclusive first-byte ranges, so finding
+    /// the shards for a hash is one table load rather than one range
+    /// comparison per shard. Ranges may overlap, in which case a hash maps
+    /// to every shard whose range contains it.
+    class shard_prefix_map {
+      public:
+        /// Inclusive range of hash prefixes handled by a shard.
+        using range_t = std::pair<uint8_t, uint8_t>;
+
+        /// Constructor.
+        /// \param ranges hash prefix range of each shard, by shard ID.
+        explicit shard_prefix_map(const std::vector<range_t>& ranges);
+
+        /// Constructor for a map in which some shards hold no range.
+        /// \param ranges hash prefix range of each shard, by shard ID, or
+        ///               std::nullopt for a shard no hash maps to.
+        explicit shard_prefix_map(
+            const std::vector<std::optional<range_t>>& ranges);
+
+        /// Returns the shards whose ranges contain the given hash.
+        /// \param h hash to look up.
+        /// \return shard IDs in ascending order, or an empty list if no
+        ///         shard's range contains the hash.
+        [[nodiscard]] auto shards(const hash_t& h) const
+            -> const std::vector<size_t>&;
+
+        /// Returns the number of shards in the map.
+        /// \return shard count.
+        [[nodiscard]] auto shard_count() const -> size_t;
+
+      private:
+        static constexpr size_t prefix_count
+            = size_t{std::numeric_limits<uint8_t>::max()} + 1;
+
+        size_t m_shard_count;
+        std::array<std::vector<size_t>, prefix_count> m_shards{};
+    };
+}
+
+#endif
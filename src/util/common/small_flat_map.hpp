@@ -0,0 +1,170 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_SMALL_FLAT_MAP_H_
+#define OPENCBDC_TX_SRC_COMMON_SMALL_FLAT_MAP_H_
+
+#include "small_vector.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace cbdc {
+    /// \brief Map stored as an array of key-value pairs sorted by key.
+    ///
+    /// Backed by a \ref small_vector, so maps of up to N entries live
+    /// inline without heap allocations. Lookups are binary searches and
+    /// inserts shift later entries, which suits maps of a few entries.
+    /// \tparam K key type. Must be less-than comparable.
+    /// \tparam V value type.
+    /// \tparam N number of entries stored inline.
+    template<typename K, typename V, size_t N>
+    class small_flat_map {
+      public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using iterator = value_type*;
+        using const_iterator = const value_type*;
+
+        small_flat_map() = default;
+
+        /// Constructs a map holding the given entries. Later entries with
+        /// a duplicate key are ignored.
+        /// \param init entries.
+        small_flat_map(std::initializer_list<value_type> init) {
+            for(const auto& v : init) {
+                insert(v);
+            }
+        }
+
+        /// Returns the entry with the given key.
+        /// \param key key to find.
+        /// \return iterator to the entry, or end() if there is none.
+        auto find(const K& key) -> iterator {
+            auto it = lower_bound(key);
+            return it != end() && it->first == key ? it : end();
+        }
+
+        /// \copydoc find
+        [[nodiscard]] auto find(const K& key) const -> const_iterator {
+            auto it = lower_bound(key);
+            return it != end() && it->first == key ? it : end();
+        }
+
+        /// Returns the number of entries with the given key.
+        /// \param key key to find.
+        /// \return 1 if the key is in the map, otherwise 0.
+        [[nodiscard]] auto count(const K& key) const -> size_t {
+            return find(key) != end() ? 1 : 0;
+        }
+
+        /// Adds an entry unless one with the same key exists.
+        /// \param val entry to add.
+        /// \return iterator to the entry with the key, and true if the
+        ///         entry was added.
+        auto insert(const value_type& val) -> std::pair<iterator, bool> {
+            auto it = lower_bound(val.first);
+            if(it != end() && it->first == val.first) {
+                return {it, false};
+            }
+            return {m_entries.insert(it, val), true};
+        }
+
+        /// Adds an entry unless one with the same key exists.
+        /// \param key key of the entry.
+        /// \param val value of the entry.
+        /// \return see \ref insert.
+        auto emplace(const K& key, const V& val) -> std::pair<iterator, bool> {
+            return insert({key, val});
+        }
+
+        /// Returns the value with the given key, adding a default value if
+        /// there is none.
+        /// \param key key to find.
+        /// \return value with the key.
+        auto operator[](const K& key) -> V& {
+            return insert({key, V()}).first->second;
+        }
+
+        /// Removes the entry at the given position.
+        /// \param pos entry to remove.
+        /// \return iterator to the following entry.
+        auto erase(const_iterator pos) -> iterator {
+            return m_entries.erase(pos);
+        }
+
+        /// Removes the entry with the given key.
+        /// \param key key to remove.
+        /// \return number of entries removed.
+        auto erase(const K& key) -> size_t {
+            auto it = find(key);
+            if(it == end()) {
+                return 0;
+            }
+            m_entries.erase(it);
+            return 1;
+        }
+
+        /// Ensures the map can hold n entries without reallocating.
+        /// \param n number of entries.
+        void reserve(size_t n) {
+            m_entries.reserve(n);
+        }
+
+        void clear() {
+            m_entries.clear();
+        }
+
+        [[nodiscard]] auto size() const -> size_t {
+            return m_entries.size();
+        }
+
+        [[nodiscard]] auto empty() const -> bool {
+            return m_entries.empty();
+        }
+
+        auto begin() -> iterator {
+            return m_entries.begin();
+        }
+
+        auto end() -> iterator {
+            return m_entries.end();
+        }
+
+        [[nodiscard]] auto begin() const -> const_iterator {
+            return m_entries.begin();
+        }
+
+        [[nodiscard]] auto end() const -> const_iterator {
+            return m_entries.end();
+        }
+
+        auto operator==(const small_flat_map& rhs) const -> bool {
+            return m_entries == rhs.m_entries;
+        }
+
+        auto operator!=(const small_flat_map& rhs) const -> bool {
+            return !(*this == rhs);
+        }
+
+      private:
+        auto lower_bound(const K& key) -> iterator {
+            return std::lower_bound(begin(), end(), key, key_less);
+        }
+
+        [[nodiscard]] auto lower_bound(const K& key) const -> const_iterator {
+            return std::lower_bound(begin(), end(), key, key_less);
+        }
+
+        static auto key_less(const value_type& entry, const K& key) -> bool {
+            return entry.first < key;
+        }
+
+        small_vector<value_type, N> m_entries;
+    };
+}
+
+#endif
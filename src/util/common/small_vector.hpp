@@ -0,0 +1,283 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_SMALL_VECTOR_H_
+#define OPENCBDC_TX_SRC_COMMON_SMALL_VECTOR_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace cbdc {
+    /// \brief Vector that stores up to N elements inline.
+    ///
+    /// Only allocates once it grows past N elements, so small instances
+    /// cost no heap allocation to create, copy or move. Elements must be
+    /// trivially destructible, which lets the storage past the end hold
+    /// stale values rather than tracking element lifetimes.
+    /// \tparam T element type.
+    /// \tparam N number of elements stored inline.
+    template<typename T, size_t N>
+    class small_vector {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "small_vector elements must be trivially destructible");
+        static_assert(std::is_default_constructible_v<T>,
+                      "small_vector elements must be default constructible");
+        static_assert(N > 0, "small_vector needs inline capacity");
+
+      public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        small_vector() = default;
+        ~small_vector() = default;
+
+        /// Constructs a vector holding the given elements.
+        /// \param init elements.
+        small_vector(std::initializer_list<T> init) {
+            assign(init.begin(), init.end());
+        }
+
+        /// Constructs a vector holding a copy of a range of elements.
+        /// \param first start of the range.
+        /// \param last end of the range.
+        template<typename It>
+        small_vector(It first, It last) {
+            assign(first, last);
+        }
+
+        small_vector(const small_vector& other) {
+            assign(other.begin(), other.end());
+        }
+
+        /// Takes the heap storage of the other vector if it has any,
+        /// otherwise copies its inline elements. Leaves it empty.
+        small_vector(small_vector&& other) noexcept {
+            take(std::move(other));
+        }
+
+        auto operator=(const small_vector& other) -> small_vector& {
+            if(this != &other) {
+                assign(other.begin(), other.end());
+            }
+            return *this;
+        }
+
+        auto operator=(small_vector&& other) noexcept -> small_vector& {
+            if(this != &other) {
+                take(std::move(other));
+            }
+            return *this;
+        }
+
+        auto operator=(std::initializer_list<T> init) -> small_vector& {
+            assign(init.begin(), init.end());
+            return *this;
+        }
+
+        /// Replaces the contents with a copy of a range of elements.
+        /// \param first start of the range.
+        /// \param last end of the range.
+        template<typename It>
+        void assign(It first, It last) {
+            m_size = 0;
+            reserve(static_cast<size_t>(std::distance(first, last)));
+            std::copy(first, last, data());
+            m_size = static_cast<size_t>(std::distance(first, last));
+        }
+
+        /// Ensures the vector can hold n elements without reallocating.
+        /// \param n number of elements.
+        void reserve(size_t n) {
+            if(n <= m_capacity) {
+                return;
+            }
+            auto cap = std::max(n, m_capacity * 2);
+            auto heap = std::make_unique<T[]>(cap);
+            std::copy(begin(), end(), heap.get());
+            m_heap = std::move(heap);
+            m_capacity = cap;
+        }
+
+        /// Resizes the vector, value-initializing new elements.
+        /// \param n new number of elements.
+        void resize(size_t n) {
+            reserve(n);
+            std::fill(data() + m_size, data() + std::max(n, m_size), T());
+            m_size = n;
+        }
+
+        /// Appends an element.
+        /// \param val element to append.
+        void push_back(const T& val) {
+            emplace_back(val);
+        }
+
+        /// Appends an element constructed from the given arguments.
+        /// \param args constructor arguments.
+        /// \return the new element.
+        template<typename... Args>
+        auto emplace_back(Args&&... args) -> T& {
+            // Construct first, since args may refer to an element.
+            auto val = T(std::forward<Args>(args)...);
+            reserve(m_size + 1);
+            auto& ret = data()[m_size];
+            ret = std::move(val);
+            m_size++;
+            return ret;
+        }
+
+        /// Removes the last element.
+        void pop_back() {
+            m_size--;
+        }
+
+        /// Inserts an element before the given position.
+        /// \param pos position before which to insert.
+        /// \param val element to insert.
+        /// \return iterator to the inserted element.
+        auto insert(const_iterator pos, const T& val) -> iterator {
+            auto idx = static_cast<size_t>(pos - begin());
+            auto copy = val;
+            reserve(m_size + 1);
+            std::move_backward(begin() + idx, end(), end() + 1);
+            data()[idx] = std::move(copy);
+            m_size++;
+            return begin() + idx;
+        }
+
+        /// Removes the element at the given position.
+        /// \param pos position of the element to remove.
+        /// \return iterator to the element after the removed one.
+        auto erase(const_iterator pos) -> iterator {
+            return erase(pos, pos + 1);
+        }
+
+        /// Removes a range of elements.
+        /// \param first start of the range.
+        /// \param last end of the range.
+        /// \return iterator to the element after the removed ones.
+        auto erase(const_iterator first, const_iterator last) -> iterator {
+            auto idx = static_cast<size_t>(first - begin());
+            auto count = static_cast<size_t>(last - first);
+            std::move(begin() + idx + count, end(), begin() + idx);
+            m_size -= count;
+            return begin() + idx;
+        }
+
+        /// Removes every element, keeping any heap storage.
+        void clear() {
+            m_size = 0;
+        }
+
+        [[nodiscard]] auto size() const -> size_t {
+            return m_size;
+        }
+
+        [[nodiscard]] auto empty() const -> bool {
+            return m_size == 0;
+        }
+
+        [[nodiscard]] auto capacity() const -> size_t {
+            return m_capacity;
+        }
+
+        [[nodiscard]] auto data() -> T* {
+            return m_heap ? m_heap.get() : m_inline.data();
+        }
+
+        [[nodiscard]] auto data() const -> const T* {
+            return m_heap ? m_heap.get() : m_inline.data();
+        }
+
+        auto operator[](size_t i) -> T& {
+            return data()[i];
+        }
+
+        auto operator[](size_t i) const -> const T& {
+            return data()[i];
+        }
+
+        auto front() -> T& {
+            return data()[0];
+        }
+
+        auto front() const -> const T& {
+            return data()[0];
+        }
+
+        auto back() -> T& {
+            return data()[m_size - 1];
+        }
+
+        auto back() const -> const T& {
+            return data()[m_size - 1];
+        }
+
+        auto begin() -> iterator {
+            return data();
+        }
+
+        auto end() -> iterator {
+            return data() + m_size;
+        }
+
+        [[nodiscard]] auto begin() const -> const_iterator {
+            return data();
+        }
+
+        [[nodiscard]] auto end() const -> const_iterator {
+            return data() + m_size;
+        }
+
+        [[nodiscard]] auto cbegin() const -> const_iterator {
+            return begin();
+        }
+
+        [[nodiscard]] auto cend() const -> const_iterator {
+            return end();
+        }
+
+        auto operator==(const small_vector& rhs) const -> bool {
+            return std::equal(begin(), end(), rhs.begin(), rhs.end());
+        }
+
+        auto operator!=(const small_vector& rhs) const -> bool {
+            return !(*this == rhs);
+        }
+
+      private:
+        void take(small_vector&& other) {
+            if(other.m_heap) {
+                m_heap = std::move(other.m_heap);
+                m_capacity = other.m_capacity;
+                m_size = other.m_size;
+            } else {
+                assign(other.begin(), other.end());
+            }
+            other.m_capacity = N;
+            other.m_size = 0;
+        }
+
+        // Left uninitialized, only the first m_size elements are read.
+        std::array<T, N> m_inline;
+        std::unique_ptr<T[]> m_heap;
+        size_t m_size{0};
+        size_t m_capacity{N};
+    };
+}
+
+#endif
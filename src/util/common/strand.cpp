@@ -0,0 +1,45 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "strand.hpp"
+
+namespace cbdc {
+    strand::strand(std::shared_ptr<thread_pool> pool)
+        : m_pool(std::move(pool)) {}
+
+    void strand::post(std::function<void()> fn) {
+        {
+            std::unique_lock l(m_mut);
+            m_queue.emplace_back(std::move(fn));
+            if(m_running) {
+                return;
+            }
+            m_running = true;
+        }
+        if(m_pool) {
+            m_pool->push([this]() {
+                drain();
+            });
+        } else {
+            drain();
+        }
+    }
+
+    void strand::drain() {
+        auto fn = std::function<void()>();
+        for(;;) {
+            {
+                std::unique_lock l(m_mut);
+                if(m_queue.empty()) {
+                    m_running = false;
+                    return;
+                }
+                fn = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            fn();
+        }
+    }
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_STRAND_H_
+#define OPENCBDC_TX_SRC_COMMON_STRAND_H_
+
+#include "thread_pool.hpp"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace cbdc {
+    /// \brief Lightweight serial executor.
+    ///
+    /// Runs posted tasks one at a time, in the order they were posted,
+    /// without a dedicated thread. State touched only from tasks on the same
+    /// strand needs no lock, so continuations of asynchronous calls can
+    /// update it without holding a mutex across further calls. The strand
+    /// must outlive every task posted to it.
+    class strand {
+      public:
+        /// Constructor.
+        /// \param pool thread pool on which to run tasks. If nullptr, tasks
+        ///             run on the thread which posts to an idle strand,
+        ///             which also runs any tasks posted meanwhile.
+        explicit strand(std::shared_ptr<thread_pool> pool = nullptr);
+
+        /// Queues a task to run after all previously posted tasks.
+        /// \param fn task to run.
+        void post(std::function<void()> fn);
+
+      private:
+        std::shared_ptr<thread_pool> m_pool;
+        std::mutex m_mut;
+        std::deque<std::function<void()>> m_queue;
+        bool m_running{false};
+
+        void drain();
+    };
+}
+
+#endif
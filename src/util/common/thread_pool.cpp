@@ -5,48 +5,186 @@
 
 #include "thread_pool.hpp"
 
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace cbdc {
+    namespace {
+        // Pool and worker index of the current thread, if it is a worker
+        thread_local const void* current_pool{nullptr};
+        thread_local size_t current_worker{0};
+    }
+
+    thread_pool::thread_pool(size_t n_threads,
+                             bool pin_threads,
+                             std::optional<thread_role> role) {
+        if(n_threads == 0) {
+            n_threads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        m_workers.reserve(n_threads);
+        for(size_t i = 0; i < n_threads; i++) {
+            m_workers.emplace_back(std::make_unique<worker_type>());
+        }
+        for(size_t i = 0; i < n_threads; i++) {
+            m_workers[i]->m_thread
+                = std::thread([this, i, pin_threads, role]() {
+                      worker_loop(i, pin_threads, role);
+                  });
+        }
+    }
+
     thread_pool::~thread_pool() {
-        std::unique_lock l(m_mut);
-        for(auto& t : m_threads) {
-            t->m_queue.clear();
-            if(t->m_thread.joinable()) {
-                t->m_thread.join();
+        {
+            std::unique_lock l(m_sleep_mut);
+            m_stop = true;
+        }
+        m_sleep_cv.notify_all();
+        for(auto& w : m_workers) {
+            if(w->m_thread.joinable()) {
+                w->m_thread.join();
+            }
+        }
+        for(auto& w : m_workers) {
+            while(auto* task = w->m_deque.pop()) {
+                delete task;
             }
         }
+        for(auto* task : m_inject) {
+            delete task;
+        }
     }
 
     void thread_pool::push(const std::function<void()>& fn) {
-        std::unique_lock l(m_mut);
-        auto launched = false;
-        for(auto& thr : m_threads) {
-            if(thr->m_running) {
-                continue;
+        auto* task = new task_type(fn);
+        if(current_pool != this
+           || !m_workers[current_worker]->m_deque.push(task)) {
+            std::unique_lock l(m_inject_mut);
+            m_inject.push_back(task);
+            m_inject_size++;
+        }
+        // Pairs with the fence in worker_loop so either this thread sees a
+        // sleeping worker, or the worker sees the new task
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_sleeping.load(std::memory_order_relaxed) > 0) {
+            {
+                std::unique_lock l(m_sleep_mut);
             }
+            m_sleep_cv.notify_one();
+        }
+    }
 
-            thr->m_running = true;
-            thr->m_queue.push(fn);
-            launched = true;
-            break;
+    auto thread_pool::size() const -> size_t {
+        return m_workers.size();
+    }
+
+    auto thread_pool::next_task(size_t idx) -> task_type* {
+        if(auto* task = m_workers[idx]->m_deque.pop()) {
+            return task;
         }
-        if(launched) {
-            return;
+        if(m_inject_size.load(std::memory_order_relaxed) > 0) {
+            std::unique_lock l(m_inject_mut);
+            if(!m_inject.empty()) {
+                auto* task = m_inject.front();
+                m_inject.pop_front();
+                m_inject_size--;
+                return task;
+            }
         }
+        auto n = m_workers.size();
+        for(size_t i = 1; i < n; i++) {
+            if(auto* task = m_workers[(idx + i) % n]->m_deque.steal()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
 
-        auto thr = std::make_shared<thread_type>();
-        m_threads.emplace_back(thr);
-        thr->m_running = true;
-        thr->m_thread = std::thread([thr]() {
-            thread_loop(thr);
-        });
-        thr->m_queue.push(fn);
+    auto thread_pool::has_work() -> bool {
+        if(m_inject_size.load() > 0) {
+            return true;
+        }
+        for(auto& w : m_workers) {
+            if(!w->m_deque.empty()) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    void thread_pool::thread_loop(const std::shared_ptr<thread_type>& thr) {
-        auto f = std::function<void()>();
-        while(thr->m_queue.pop(f)) {
-            f();
-            thr->m_running = false;
+    void thread_pool::worker_loop(size_t idx,
+                                  bool pin,
+                                  std::optional<thread_role> role) {
+        current_pool = this;
+        current_worker = idx;
+        if(!pin && role.has_value()) {
+            pin_current_thread(role.value());
         }
+#ifdef __linux__
+        if(pin) {
+            auto n_cpus = std::max(std::thread::hardware_concurrency(), 1U);
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(idx % n_cpus, &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        }
+#else
+        static_cast<void>(pin);
+#endif
+
+        while(!m_stop) {
+            if(auto* task = next_task(idx)) {
+                (*task)();
+                delete task;
+                continue;
+            }
+
+            std::unique_lock l(m_sleep_mut);
+            m_sleeping++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // A failed steal may have hidden work, so check again before
+            // sleeping
+            if(!m_stop && !has_work()) {
+                m_sleep_cv.wait(l);
+            }
+            m_sleeping--;
+        }
+    }
+
+    void for_each_chunk(thread_pool* pool,
+                        size_t n,
+                        size_t min_chunk,
+                        const std::function<void(size_t, size_t)>& fn) {
+        min_chunk = std::max<size_t>(min_chunk, 1);
+        if(pool == nullptr || n < 2 * min_chunk) {
+            fn(0, n);
+            return;
+        }
+        const auto n_chunks = std::min(pool->size() + 1, n / min_chunk);
+        const auto chunk_size = (n + n_chunks - 1) / n_chunks;
+
+        auto mut = std::mutex();
+        auto cv = std::condition_variable();
+        size_t remaining{n_chunks - 1};
+        for(size_t i{1}; i < n_chunks; i++) {
+            const auto begin = i * chunk_size;
+            const auto end = std::min(n, begin + chunk_size);
+            pool->push([&, begin, end]() {
+                fn(begin, end);
+                std::unique_lock l(mut);
+                if(--remaining == 0) {
+                    cv.notify_one();
+                }
+            });
+        }
+        fn(0, std::min(n, chunk_size));
+
+        std::unique_lock l(mut);
+        cv.wait(l, [&]() {
+            return remaining == 0;
+        });
     }
 }
@@ -6,16 +6,42 @@
 #ifndef OPENCBDC_TX_SRC_COMMON_THREAD_POOL_H_
 #define OPENCBDC_TX_SRC_COMMON_THREAD_POOL_H_
 
-#include "blocking_queue.hpp"
+#include "affinity.hpp"
+#include "work_stealing_deque.hpp"
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <vector>
 
 namespace cbdc {
+    /// \brief Fixed-size work-stealing thread pool.
+    ///
+    /// Tasks pushed from a worker go onto that worker's bounded lock-free
+    /// deque; other tasks, or tasks which do not fit, go onto a shared
+    /// injection queue. Idle workers take from their own deque, then the
+    /// injection queue, then steal from other workers. Tasks still queued
+    /// when the pool is destroyed are discarded.
     class thread_pool {
       public:
-        thread_pool() = default;
+        /// Constructor. Starts the worker threads.
+        /// \param n_threads number of worker threads. Zero for one per
+        ///                  hardware thread.
+        /// \param pin_threads true to pin each worker to a CPU, round-robin.
+        ///                    Only supported on Linux.
+        /// \param role if set and pin_threads is false, restricts the
+        ///             workers to the CPUs configured for the role. See
+        ///             \ref pin_current_thread.
+        explicit thread_pool(size_t n_threads = 0,
+                             bool pin_threads = false,
+                             std::optional<thread_role> role = std::nullopt);
+
+        /// Destructor. Stops and joins the worker threads.
         ~thread_pool();
 
         thread_pool(const thread_pool&) = delete;
@@ -23,20 +49,55 @@ namespace cbdc {
         thread_pool(thread_pool&&) = delete;
         auto operator=(thread_pool&&) -> thread_pool& = delete;
 
+        /// Queues a task to run on a worker thread. Thread safe.
+        /// \param fn task to run.
         void push(const std::function<void()>& fn);
 
+        /// Returns the number of worker threads.
+        /// \return worker count.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Capacity of each worker's deque.
+        static constexpr size_t deque_capacity = 1024;
+
       private:
-        struct thread_type {
+        using task_type = std::function<void()>;
+
+        struct worker_type {
+            worker_type() : m_deque(deque_capacity) {}
+
+            work_stealing_deque<task_type> m_deque;
             std::thread m_thread;
-            std::atomic_bool m_running{false};
-            blocking_queue<std::function<void()>> m_queue;
         };
 
-        std::mutex m_mut;
-        std::vector<std::shared_ptr<thread_type>> m_threads;
+        std::vector<std::unique_ptr<worker_type>> m_workers;
+
+        std::mutex m_inject_mut;
+        std::deque<task_type*> m_inject;
+        std::atomic<size_t> m_inject_size{0};
 
-        static void thread_loop(const std::shared_ptr<thread_type>& thr);
+        std::mutex m_sleep_mut;
+        std::condition_variable m_sleep_cv;
+        std::atomic<size_t> m_sleeping{0};
+        std::atomic_bool m_stop{false};
+
+        void
+        worker_loop(size_t idx, bool pin, std::optional<thread_role> role);
+        auto next_task(size_t idx) -> task_type*;
+        auto has_work() -> bool;
     };
+
+    /// Calls fn on consecutive ranges of [0, n), running the ranges on the
+    /// given thread pool and the calling thread. Returns once every range
+    /// is done.
+    /// \param pool thread pool, or nullptr to run on the calling thread.
+    /// \param n number of elements.
+    /// \param min_chunk smallest range worth running on another thread.
+    /// \param fn function taking the start and end of each range.
+    void for_each_chunk(thread_pool* pool,
+                        size_t n,
+                        size_t min_chunk,
+                        const std::function<void(size_t, size_t)>& fn);
 }
 
 #endif
@@ -0,0 +1,234 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tracing.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+namespace cbdc::tracing {
+    namespace {
+        thread_local std::optional<context> this_thread_context{};
+
+        auto rng() -> std::mt19937_64& {
+            thread_local auto gen = std::mt19937_64(std::random_device()());
+            return gen;
+        }
+
+        auto new_id() -> uint64_t {
+            uint64_t id{};
+            while(id == 0) {
+                id = rng()();
+            }
+            return id;
+        }
+    }
+
+    auto context::operator==(const context& rhs) const -> bool {
+        return m_trace_id == rhs.m_trace_id && m_span_id == rhs.m_span_id;
+    }
+
+    auto current() -> std::optional<context> {
+        return this_thread_context;
+    }
+
+    scoped_context::scoped_context(std::optional<context> ctx)
+        : m_prev(this_thread_context) {
+        this_thread_context = ctx;
+    }
+
+    scoped_context::~scoped_context() {
+        this_thread_context = m_prev;
+    }
+
+    span::span(const char* name, std::optional<context> parent) {
+        if(!parent) {
+            return;
+        }
+        m_active = true;
+        m_rec.m_trace_id = parent->m_trace_id;
+        m_rec.m_parent_id = parent->m_span_id;
+        m_rec.m_span_id = new_id();
+        m_rec.m_name = name;
+        m_rec.m_start = std::chrono::system_clock::now();
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    span::~span() {
+        finish();
+    }
+
+    span::span(span&& other) noexcept
+        : m_rec(other.m_rec),
+          m_start(other.m_start),
+          m_active(other.m_active) {
+        other.m_active = false;
+    }
+
+    auto span::operator=(span&& other) noexcept -> span& {
+        if(this != &other) {
+            finish();
+            m_rec = other.m_rec;
+            m_start = other.m_start;
+            m_active = other.m_active;
+            other.m_active = false;
+        }
+        return *this;
+    }
+
+    void span::finish() {
+        if(!m_active) {
+            return;
+        }
+        m_active = false;
+        m_rec.m_duration = std::chrono::steady_clock::now() - m_start;
+        tracer::global().record(m_rec);
+    }
+
+    auto span::get_context() const -> std::optional<context> {
+        if(m_rec.m_trace_id == 0) {
+            return std::nullopt;
+        }
+        return context{m_rec.m_trace_id, m_rec.m_span_id};
+    }
+
+    auto make_shared_span(const char* name, std::optional<context> parent)
+        -> std::shared_ptr<span> {
+        if(!parent) {
+            return nullptr;
+        }
+        return std::make_shared<span>(name, parent);
+    }
+
+    auto context_of(const std::shared_ptr<span>& s) -> std::optional<context> {
+        if(!s) {
+            return std::nullopt;
+        }
+        return s->get_context();
+    }
+
+    tracer::~tracer() {
+        stop();
+    }
+
+    auto tracer::global() -> tracer& {
+        static auto t = tracer();
+        return t;
+    }
+
+    auto tracer::start(double sample_rate,
+                       size_t capacity,
+                       exporter_type exporter) -> bool {
+        if(m_running || !exporter) {
+            return false;
+        }
+        size_t cap = 2;
+        while(cap < capacity) {
+            cap <<= 1;
+        }
+        m_spans = std::make_unique<mpmc_queue<span_record>>(cap);
+        m_exporter = std::move(exporter);
+
+        uint64_t threshold{};
+        if(sample_rate >= 1.0) {
+            threshold = UINT64_MAX;
+        } else if(sample_rate > 0.0) {
+            static constexpr double two_pow_64 = 18446744073709551616.0;
+            threshold = static_cast<uint64_t>(sample_rate * two_pow_64);
+        }
+        m_threshold = threshold;
+        m_running = true;
+        m_export_thread = std::thread([&]() {
+            export_loop();
+        });
+        return true;
+    }
+
+    void tracer::stop() {
+        if(!m_running.exchange(false)) {
+            return;
+        }
+        m_threshold = 0;
+        // A record without a name tells the export thread to stop once
+        // everything before it has been exported
+        [[maybe_unused]] auto pushed = m_spans->push(span_record{});
+        if(m_export_thread.joinable()) {
+            m_export_thread.join();
+        }
+    }
+
+    auto tracer::maybe_start_trace() -> std::optional<context> {
+        auto threshold = m_threshold.load(std::memory_order_relaxed);
+        if(threshold == 0 || rng()() > threshold) {
+            return std::nullopt;
+        }
+        return context{new_id(), 0};
+    }
+
+    void tracer::record(span_record rec) {
+        if(!m_running.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if(!m_spans->try_push(std::move(rec))) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    auto tracer::dropped() const -> uint64_t {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    void tracer::export_loop() {
+        static constexpr size_t max_batch = 256;
+        auto batch = std::vector<span_record>();
+        batch.reserve(max_batch);
+        auto done = false;
+        while(!done) {
+            batch.clear();
+            if(m_spans->pop_batch(batch, max_batch) == 0) {
+                return;
+            }
+            for(size_t i = 0; i < batch.size(); i++) {
+                if(batch[i].m_name == nullptr) {
+                    batch.resize(i);
+                    done = true;
+                    break;
+                }
+            }
+            if(!batch.empty()) {
+                m_exporter(batch);
+            }
+        }
+    }
+
+    auto maybe_start_trace() -> std::optional<context> {
+        return tracer::global().maybe_start_trace();
+    }
+
+    auto make_file_exporter(const std::string& path, std::string process_name)
+        -> exporter_type {
+        auto file = std::make_shared<std::ofstream>(path, std::ios::app);
+        if(!file->good()) {
+            return {};
+        }
+        return [file, name = std::move(process_name)](
+                   const std::vector<span_record>& spans) {
+            auto& os = *file;
+            for(const auto& s : spans) {
+                auto start_us
+                    = std::chrono::duration_cast<std::chrono::microseconds>(
+                          s.m_start.time_since_epoch())
+                          .count();
+                os << name << std::hex << std::setfill('0') << " "
+                   << std::setw(16) << s.m_trace_id << " " << std::setw(16)
+                   << s.m_span_id << " " << std::setw(16) << s.m_parent_id
+                   << std::dec << " " << s.m_name << " " << start_us << " "
+                   << s.m_duration.count() << "\n";
+            }
+            os.flush();
+        };
+    }
+}
@@ -0,0 +1,194 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_TRACING_H_
+#define OPENCBDC_TX_SRC_COMMON_TRACING_H_
+
+#include "mpmc_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Sampled distributed tracing. A trace follows one sampled request across
+/// threads and processes. Its context travels in RPC headers, and each
+/// process records the timed spans it executes into a bounded buffer which
+/// is exported in batches.
+namespace cbdc::tracing {
+    /// Identifies a trace, and the span within it that new spans are
+    /// children of.
+    struct context {
+        /// Identifier shared by every span in the trace. Never zero.
+        uint64_t m_trace_id{};
+        /// Identifier of the parent span, or zero at the root of a trace.
+        uint64_t m_span_id{};
+
+        auto operator==(const context& rhs) const -> bool;
+    };
+
+    /// Completed span.
+    struct span_record {
+        uint64_t m_trace_id{};
+        uint64_t m_span_id{};
+        uint64_t m_parent_id{};
+        /// Name of the operation. Points to a string literal.
+        const char* m_name{};
+        std::chrono::system_clock::time_point m_start{};
+        std::chrono::nanoseconds m_duration{};
+    };
+
+    /// Function which exports a batch of completed spans.
+    using exporter_type = std::function<void(const std::vector<span_record>&)>;
+
+    /// Returns the trace context of the calling thread, if any.
+    auto current() -> std::optional<context>;
+
+    /// Sets the trace context of the calling thread for the lifetime of the
+    /// object, then restores the previous context. Work handed to another
+    /// thread must capture \ref current and re-install it there.
+    class scoped_context {
+      public:
+        /// Constructor.
+        /// \param ctx context to install, or std::nullopt to clear it.
+        explicit scoped_context(std::optional<context> ctx);
+        ~scoped_context();
+
+        scoped_context(const scoped_context&) = delete;
+        auto operator=(const scoped_context&) -> scoped_context& = delete;
+        scoped_context(scoped_context&&) = delete;
+        auto operator=(scoped_context&&) -> scoped_context& = delete;
+
+      private:
+        std::optional<context> m_prev;
+    };
+
+    /// \brief Timed operation within a trace.
+    ///
+    /// Does nothing unless given a parent context, so untraced requests pay
+    /// only for an empty std::optional. Recorded when finished or
+    /// destroyed, whichever comes first.
+    class span {
+      public:
+        /// Constructs a no-op span.
+        span() = default;
+
+        /// Starts a span.
+        /// \param name name of the operation. Must be a string literal.
+        /// \param parent context of the parent span, or std::nullopt to
+        ///               make the span a no-op.
+        explicit span(const char* name,
+                      std::optional<context> parent = current());
+        ~span();
+
+        span(span&& other) noexcept;
+        auto operator=(span&& other) noexcept -> span&;
+        span(const span&) = delete;
+        auto operator=(const span&) -> span& = delete;
+
+        /// Records the span if it is active and not yet finished.
+        void finish();
+
+        /// Returns the context for children of this span, or std::nullopt
+        /// if the span is a no-op.
+        [[nodiscard]] auto get_context() const -> std::optional<context>;
+
+      private:
+        span_record m_rec{};
+        std::chrono::steady_clock::time_point m_start{};
+        bool m_active{false};
+    };
+
+    /// Starts a span which can be shared between callbacks.
+    /// \param name name of the operation. Must be a string literal.
+    /// \param parent context of the parent span.
+    /// \return started span, or nullptr if parent is std::nullopt.
+    auto make_shared_span(const char* name,
+                          std::optional<context> parent = current())
+        -> std::shared_ptr<span>;
+
+    /// Returns the context for children of a shared span.
+    /// \param s span from \ref make_shared_span.
+    /// \return the span's context, or std::nullopt if s is nullptr.
+    auto context_of(const std::shared_ptr<span>& s) -> std::optional<context>;
+
+    /// \brief Process-wide sampler and span buffer.
+    ///
+    /// Spans are pushed to a bounded lock-free buffer, or dropped if it is
+    /// full, and a background thread passes them to an exporter in batches.
+    /// Spans recorded while the tracer is stopped are discarded.
+    class tracer {
+      public:
+        tracer() = default;
+        ~tracer();
+
+        tracer(const tracer&) = delete;
+        auto operator=(const tracer&) -> tracer& = delete;
+        tracer(tracer&&) = delete;
+        auto operator=(tracer&&) -> tracer& = delete;
+
+        /// Returns the tracer shared by the whole process.
+        static auto global() -> tracer&;
+
+        /// Starts recording and exporting spans. Must not be called
+        /// concurrently with other methods.
+        /// \param sample_rate fraction of new requests to trace, in [0, 1].
+        ///                    Only affects \ref maybe_start_trace; spans
+        ///                    of traces started elsewhere are recorded
+        ///                    regardless.
+        /// \param capacity number of spans buffered awaiting export,
+        ///                 rounded up to a power of two.
+        /// \param exporter function to call with each batch of spans. Called
+        ///                 on the export thread.
+        /// \return false if already started or exporter is empty.
+        auto start(double sample_rate, size_t capacity, exporter_type exporter)
+            -> bool;
+
+        /// Exports all buffered spans and stops the export thread.
+        void stop();
+
+        /// Starts a new trace with the configured probability.
+        /// \return root context of the new trace, or std::nullopt if the
+        ///         request should not be traced.
+        auto maybe_start_trace() -> std::optional<context>;
+
+        /// Buffers a completed span for export.
+        /// \param rec span to export.
+        void record(span_record rec);
+
+        /// Returns the number of spans dropped because the buffer was full.
+        [[nodiscard]] auto dropped() const -> uint64_t;
+
+      private:
+        std::atomic<bool> m_running{false};
+        std::atomic<uint64_t> m_threshold{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::unique_ptr<mpmc_queue<span_record>> m_spans;
+        exporter_type m_exporter;
+        std::thread m_export_thread;
+
+        void export_loop();
+    };
+
+    /// Starts a new trace with the global tracer's sampling probability.
+    /// \see tracer::maybe_start_trace
+    auto maybe_start_trace() -> std::optional<context>;
+
+    /// Returns an exporter which appends spans to a file, one per line:
+    /// process name, trace ID, span ID, parent span ID, span name, start
+    /// time in microseconds since the epoch, and duration in nanoseconds.
+    /// \param path file to which to append.
+    /// \param process_name name identifying this process in the file.
+    /// \return exporter, or an empty function if the file cannot be opened.
+    auto make_file_exporter(const std::string& path, std::string process_name)
+        -> exporter_type;
+}
+
+#endif
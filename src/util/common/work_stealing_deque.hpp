@@ -0,0 +1,113 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_COMMON_WORK_STEALING_DEQUE_H_
+#define OPENCBDC_TX_SRC_COMMON_WORK_STEALING_DEQUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cbdc {
+    /// \brief Bounded lock-free work-stealing deque of pointers.
+    ///
+    /// Chase-Lev deque with a fixed capacity. A single owner thread pushes
+    /// and pops at the bottom, and any thread may steal from the top.
+    /// \tparam T type of object pointed to by elements.
+    template<typename T>
+    class work_stealing_deque {
+      public:
+        /// Constructor.
+        /// \param capacity maximum number of elements. Must be a power of
+        ///                 two.
+        explicit work_stealing_deque(size_t capacity)
+            : m_mask(static_cast<int64_t>(capacity) - 1),
+              m_buf(capacity) {
+            assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+        }
+
+        /// Pushes an element onto the bottom. Owner thread only.
+        /// \param item element to push.
+        /// \return false if the deque is full.
+        auto push(T* item) -> bool {
+            auto b = m_bottom.load(std::memory_order_relaxed);
+            auto t = m_top.load(std::memory_order_acquire);
+            if(b - t > m_mask) {
+                return false;
+            }
+            m_buf[static_cast<size_t>(b & m_mask)].store(
+                item,
+                std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /// Pops the most recently pushed element. Owner thread only.
+        /// \return element, or nullptr if the deque is empty.
+        auto pop() -> T* {
+            auto b = m_bottom.load(std::memory_order_relaxed) - 1;
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = m_top.load(std::memory_order_relaxed);
+            if(t > b) {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            auto* item = m_buf[static_cast<size_t>(b & m_mask)].load(
+                std::memory_order_relaxed);
+            if(t == b) {
+                // Last element, race any thieves for it
+                if(!m_top.compare_exchange_strong(t,
+                                                  t + 1,
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        /// Steals the least recently pushed element. Thread safe.
+        /// \return element, or nullptr if the deque is empty or another
+        ///         thread won the race for the element.
+        auto steal() -> T* {
+            auto t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b = m_bottom.load(std::memory_order_acquire);
+            if(t >= b) {
+                return nullptr;
+            }
+            auto* item = m_buf[static_cast<size_t>(t & m_mask)].load(
+                std::memory_order_relaxed);
+            if(!m_top.compare_exchange_strong(t,
+                                              t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return item;
+        }
+
+        /// Returns whether the deque appeared empty at the time of the call.
+        /// \return true if there were no elements.
+        [[nodiscard]] auto empty() const -> bool {
+            auto b = m_bottom.load(std::memory_order_seq_cst);
+            auto t = m_top.load(std::memory_order_seq_cst);
+            return b <= t;
+        }
+
+      private:
+        int64_t m_mask;
+        std::vector<std::atomic<T*>> m_buf;
+        std::atomic<int64_t> m_top{0};
+        std::atomic<int64_t> m_bottom{0};
+    };
+}
+
+#endif
@@ -5,6 +5,8 @@
 
 #include "connection_manager.hpp"
 
+#include "util/common/buffer_pool.hpp"
+
 namespace cbdc::network {
     connection_manager::~connection_manager() {
         close();
@@ -37,11 +39,12 @@ namespace cbdc::network {
         return true;
     }
 
-    void connection_manager::broadcast(const std::shared_ptr<buffer>& data) {
+    void connection_manager::broadcast(const std::shared_ptr<buffer>& data,
+                                       priority prio) {
         {
             std::shared_lock<std::shared_mutex> l(m_peer_mutex);
             for(const auto& peer : m_peers) {
-                peer.m_peer->send(data);
+                peer.m_peer->send(data, prio);
             }
         }
     }
@@ -97,11 +100,16 @@ namespace cbdc::network {
             m_async_recv_cv.notify_one();
         };
 
+        auto reconnect_cb = [&]() {
+            notify_connect();
+        };
+
         {
             std::unique_lock<std::shared_mutex> l(m_peer_mutex);
             auto p = std::make_unique<peer>(std::move(sock),
                                             recv_cb,
-                                            attempt_reconnect);
+                                            attempt_reconnect,
+                                            reconnect_cb);
             if(m_running) {
                 m_peers.emplace_back(std::move(p), peer_id);
             }
@@ -173,7 +181,8 @@ namespace cbdc::network {
                     auto res = handler(std::move(pkt));
 
                     if(res.has_value()) {
-                        send(std::make_shared<buffer>(std::move(res.value())),
+                        send(buffer_pool::global().wrap(
+                                 std::move(res.value())),
                              pid);
                     }
                 }
@@ -196,10 +205,12 @@ namespace cbdc::network {
             m_peers.clear();
         }
         m_async_recv_cv.notify_all();
+        notify_connect();
     }
 
     void connection_manager::send(const std::shared_ptr<buffer>& data,
-                                  peer_id_t peer_id) {
+                                  peer_id_t peer_id,
+                                  priority prio) {
         std::shared_ptr<peer> peer;
         {
             std::shared_lock<std::shared_mutex> l(m_peer_mutex);
@@ -212,7 +223,7 @@ namespace cbdc::network {
         }
 
         if(peer) {
-            peer->send(data);
+            peer->send(data, prio);
         }
     }
 
@@ -221,6 +232,16 @@ namespace cbdc::network {
         return m_peers.size();
     }
 
+    auto connection_manager::peer_ids() -> std::vector<peer_id_t> {
+        std::shared_lock<std::shared_mutex> l(m_peer_mutex);
+        auto ids = std::vector<peer_id_t>();
+        ids.reserve(m_peers.size());
+        for(const auto& p : m_peers) {
+            ids.push_back(p.m_peer_id);
+        }
+        return ids;
+    }
+
     void connection_manager::reset() {
         close();
         assert(!m_running);
@@ -233,8 +254,8 @@ namespace cbdc::network {
         }
     }
 
-    auto connection_manager::send_to_one(const std::shared_ptr<buffer>& data)
-        -> bool {
+    auto connection_manager::send_to_one(const std::shared_ptr<buffer>& data,
+                                         priority prio) -> bool {
         bool sent{false};
         {
             std::shared_lock<std::shared_mutex> l(m_peer_mutex);
@@ -247,7 +268,7 @@ namespace cbdc::network {
                 auto idx = (i + offset) % m_peers.size();
                 const auto& p = m_peers[idx];
                 if(p.m_peer->connected()) {
-                    p.m_peer->send(data);
+                    p.m_peer->send(data, prio);
                     sent = true;
                     break;
                 }
@@ -273,6 +294,37 @@ namespace cbdc::network {
         return false;
     }
 
+    auto connection_manager::await_connection(
+        std::chrono::milliseconds timeout) -> bool {
+        auto epoch = [&]() {
+            std::unique_lock<std::mutex> l(m_connect_mut);
+            return m_connect_epoch;
+        }();
+        // Peers are checked outside m_connect_mut so reconnect callbacks
+        // never wait on it while a peer lock is held.
+        if(connected_to_one()) {
+            return true;
+        }
+        if(!m_running) {
+            return false;
+        }
+        {
+            std::unique_lock<std::mutex> l(m_connect_mut);
+            m_connect_cv.wait_for(l, timeout, [&]() {
+                return m_connect_epoch != epoch;
+            });
+        }
+        return connected_to_one();
+    }
+
+    void connection_manager::notify_connect() {
+        {
+            std::unique_lock<std::mutex> l(m_connect_mut);
+            m_connect_epoch++;
+        }
+        m_connect_cv.notify_all();
+    }
+
     auto connection_manager::connected_to_one() -> bool {
         {
             std::shared_lock<std::shared_mutex> l(m_peer_mutex);
@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -77,16 +78,19 @@ namespace cbdc::network {
 
         /// Sends the provided data to all added peers.
         /// \param data packet to to send.
+        /// \param prio priority class of the packet.
         /// \see connection_manager::add
-        void broadcast(const std::shared_ptr<buffer>& data);
+        void broadcast(const std::shared_ptr<buffer>& data,
+                       priority prio = priority::normal);
 
         /// Serialize the data and broadcast it to all peers. Wraps
         /// connection_manager::broadcast.
         /// \param data data to serialize and send.
+        /// \param prio priority class of the packet.
         template<typename Ta>
-        void broadcast(const Ta& data) {
+        void broadcast(const Ta& data, priority prio = priority::normal) {
             auto pkt = make_shared_buffer(data);
-            return broadcast(pkt);
+            return broadcast(pkt, prio);
         }
 
         /// Collects and return unhandled packets received from connected
@@ -152,22 +156,32 @@ namespace cbdc::network {
         /// Sends the provided data to the specified peer. Conducts an O(n)
         /// search for the target peer. \param data data packet to send.
         /// \param peer_id ID of the peer to whom to send data.
-        void send(const std::shared_ptr<buffer>& data, peer_id_t peer_id);
+        /// \param prio priority class of the packet.
+        void send(const std::shared_ptr<buffer>& data,
+                  peer_id_t peer_id,
+                  priority prio = priority::normal);
 
         /// Serialize the data and transmit it in a packet to the remote host
         /// at the specified peer ID.
         /// \param data data to serialize and send.
         /// \param peer_id ID of the peer to whom to send data.
+        /// \param prio priority class of the packet.
         template<typename Ta>
-        void send(const Ta& data, peer_id_t peer_id) {
+        void send(const Ta& data,
+                  peer_id_t peer_id,
+                  priority prio = priority::normal) {
             auto pkt = make_shared_buffer(data);
-            return send(pkt, peer_id);
+            return send(pkt, peer_id, prio);
         }
 
         /// Returns the number of peers connected to this network.
         /// \return number of peers connected to this network.
         [[nodiscard]] auto peer_count() -> size_t;
 
+        /// Returns the IDs of the peers managed by this network.
+        /// \return peer IDs, in the order the peers were added.
+        [[nodiscard]] auto peer_ids() -> std::vector<peer_id_t>;
+
         /// Resets the network instance to a fresh state. Callers must close()
         /// the network and join() any handler threads before re-using the
         /// instance with this function.
@@ -175,18 +189,23 @@ namespace cbdc::network {
 
         /// Send the provided data to an online peer managed by this network.
         /// \param data packet to send.
+        /// \param prio priority class of the packet.
         /// \return flag to indicate whether the packet was sent to a peer.
-        [[nodiscard]] auto send_to_one(const std::shared_ptr<buffer>& data)
+        [[nodiscard]] auto send_to_one(const std::shared_ptr<buffer>& data,
+                                       priority prio = priority::normal)
             -> bool;
 
         /// Serialize and send the provided data to an online peer managed by
         /// this network. Wraps connection_manager::send_to_one.
         /// \param data serializable object to send.
+        /// \param prio priority class of the packet.
         /// \return flag to indicate whether the packet was sent to a peer.
         template<typename T>
-        [[nodiscard]] auto send_to_one(const T& data) -> bool {
+        [[nodiscard]] auto send_to_one(const T& data,
+                                       priority prio = priority::normal)
+            -> bool {
             auto pkt = make_shared_buffer(data);
-            return send_to_one(pkt);
+            return send_to_one(pkt, prio);
         }
 
         /// Determines whether the given peer ID is connected
@@ -198,6 +217,13 @@ namespace cbdc::network {
         /// \return true if at least one peer is connected.
         [[nodiscard]] auto connected_to_one() -> bool;
 
+        /// Waits until the network is connected to at least one peer. Wakes
+        /// when a peer reconnects, rather than polling.
+        /// \param timeout maximum time to wait.
+        /// \return true if at least one peer is connected.
+        [[nodiscard]] auto await_connection(std::chrono::milliseconds timeout)
+            -> bool;
+
       private:
         tcp_listener m_listener;
 
@@ -217,6 +243,8 @@ namespace cbdc::network {
             peer_id_t m_peer_id;
         };
 
+        void notify_connect();
+
         std::vector<m_peer_t> m_peers;
         std::atomic<peer_id_t> m_next_peer_id{0};
 
@@ -224,6 +252,11 @@ namespace cbdc::network {
 
         std::atomic_bool m_running{true};
 
+        /// Incremented each time a peer reconnects or the network closes.
+        uint64_t m_connect_epoch{0};
+        std::mutex m_connect_mut;
+        std::condition_variable m_connect_cv;
+
         std::mutex m_async_recv_mut;
         std::condition_variable m_async_recv_cv;
         std::vector<std::queue<message_t>> m_async_recv_queues;
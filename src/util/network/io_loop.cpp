@@ -0,0 +1,769 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "io_loop.hpp"
+
+#include "util/common/affinity.hpp"
+#include "util/common/buffer_pool.hpp"
+
+#ifdef __APPLE__
+#include "util/rpc/http/kqueue_event_handler.hpp"
+#endif
+
+#ifdef __linux__
+#include "uring.hpp"
+#include "util/rpc/http/epoll_event_handler.hpp"
+
+#include <poll.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace cbdc::network {
+    namespace {
+        /// Size of each I/O thread's read buffer.
+        constexpr size_t read_buffer_size = 64 * 1024;
+
+        auto would_block() -> bool {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+
+        std::atomic<config::network_backend> global_backend{
+            config::network_backend::epoll};
+
+#ifdef __linux__
+        /// io_uring user data for completions to ignore.
+        constexpr uint64_t ignore_tag = 0;
+        /// io_uring user data for the wake pipe poll.
+        constexpr uint64_t wake_tag = 1;
+        /// Low bits of a connection's io_uring user data, identifying the
+        /// operation. Connections are aligned to more than this.
+        constexpr uint64_t op_mask = 1;
+        constexpr uint64_t op_recv = 0;
+        constexpr uint64_t op_send = 1;
+#endif
+    }
+
+    /// An I/O thread and the connections it handles.
+    struct io_loop::worker {
+        explicit worker(config::network_backend backend);
+        ~worker();
+
+        worker(const worker&) = delete;
+        auto operator=(const worker&) -> worker& = delete;
+        worker(worker&&) = delete;
+        auto operator=(worker&&) -> worker& = delete;
+
+        void run();
+        void wake();
+        void post_flush(std::shared_ptr<connection> conn);
+        void process_posted();
+
+        void read_ready(connection& conn);
+        void consume(connection& conn, const std::byte* data, size_t len);
+        void deliver(connection& conn);
+        [[nodiscard]] auto flush(connection& conn) -> bool;
+        void take_queued(connection& conn);
+        [[nodiscard]] auto gather(connection& conn)
+            -> std::pair<iovec*, size_t>;
+        void advance(connection& conn, size_t written);
+        void set_want_write(connection& conn, bool want);
+        void detach(connection& conn);
+        void fail(connection& conn);
+
+#ifdef __linux__
+        void run_uring();
+        void uring_complete(const io_uring_cqe& cqe);
+        void uring_arm_wake();
+        void uring_arm_recv(connection& conn);
+        void uring_received(connection& conn, const io_uring_cqe& cqe);
+        void uring_flush(connection& conn);
+        void uring_sent(connection& conn, int res);
+        void uring_cancel(connection& conn, uint64_t op);
+        void uring_release(connection& conn);
+#endif
+
+        std::unique_ptr<rpc::event_handler> m_events;
+        std::array<int, 2> m_wake_fds{-1, -1};
+        std::atomic_bool m_running{true};
+        std::thread m_thread;
+
+        std::mutex m_mut;
+        bool m_woken{false};
+        std::vector<std::shared_ptr<connection>> m_added;
+        std::vector<std::shared_ptr<connection>> m_flush;
+        std::vector<
+            std::pair<std::shared_ptr<connection>, std::promise<void>*>>
+            m_removed;
+
+        // Only touched by the I/O thread
+        std::unordered_map<int, std::shared_ptr<connection>> m_conns;
+        std::vector<std::byte> m_read_buf;
+
+#ifdef __linux__
+        // Connections stay alive until their io_uring operations complete
+        std::unordered_map<connection*, std::shared_ptr<connection>> m_live;
+        std::vector<io_uring_cqe> m_cqes;
+        // Destroyed first, cancelling any operations still in flight
+        std::unique_ptr<uring> m_ring;
+#endif
+    };
+
+    io_loop::io_loop(size_t n_threads, config::network_backend backend) {
+        n_threads = std::max<size_t>(n_threads, 1);
+        for(size_t i = 0; i < n_threads; i++) {
+            m_workers.emplace_back(std::make_unique<worker>(backend));
+        }
+    }
+
+    io_loop::~io_loop() = default;
+
+    auto io_loop::global() -> const std::shared_ptr<io_loop>& {
+        // Never destroyed, so peers destroyed during static destruction can
+        // still deregister.
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+        static auto* loop
+            = new std::shared_ptr<io_loop>(std::make_shared<io_loop>(
+                default_thread_count(),
+                global_backend.load()));
+        return *loop;
+    }
+
+    void io_loop::set_global_backend(config::network_backend backend) {
+        global_backend = backend;
+    }
+
+    auto io_loop::backend() const -> config::network_backend {
+        if(m_workers.front()->m_events) {
+            return config::network_backend::epoll;
+        }
+        return config::network_backend::io_uring;
+    }
+
+    auto io_loop::default_thread_count() -> size_t {
+        static constexpr size_t threads_per_io_thread = 4;
+        return std::max<size_t>(std::thread::hardware_concurrency()
+                                    / threads_per_io_thread,
+                                1);
+    }
+
+    auto io_loop::add(tcp_socket& sock,
+                      recv_callback_type recv_cb,
+                      close_callback_type close_cb)
+        -> std::shared_ptr<connection> {
+        const auto fd = sock.m_sock_fd;
+        if(fd == -1) {
+            return nullptr;
+        }
+        auto idx = m_next_worker++ % m_workers.size();
+        auto* w = m_workers[idx].get();
+        if(w->m_events) {
+            const auto flags = fcntl(fd, F_GETFL, 0);
+            if(flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+                return nullptr;
+            }
+        }
+        auto conn = std::make_shared<connection>(fd,
+                                                 w,
+                                                 std::move(recv_cb),
+                                                 std::move(close_cb));
+        {
+            std::unique_lock<std::mutex> l(w->m_mut);
+            w->m_added.push_back(conn);
+        }
+        w->wake();
+        return conn;
+    }
+
+    void io_loop::remove(const std::shared_ptr<connection>& conn) {
+        if(!conn) {
+            return;
+        }
+        auto* w = conn->m_worker;
+        if(std::this_thread::get_id() == w->m_thread.get_id()) {
+            // Called from a callback on the I/O thread, so no other
+            // callback for the connection can be running.
+            w->detach(*conn);
+            return;
+        }
+        auto done = std::promise<void>();
+        auto fut = done.get_future();
+        {
+            std::unique_lock<std::mutex> l(w->m_mut);
+            w->m_removed.emplace_back(conn, &done);
+        }
+        w->wake();
+        fut.wait();
+    }
+
+    io_loop::connection::connection(int fd,
+                                    worker* w,
+                                    recv_callback_type recv_cb,
+                                    close_callback_type close_cb)
+        : m_fd(fd),
+          m_worker(w),
+          m_recv_cb(std::move(recv_cb)),
+          m_close_cb(std::move(close_cb)) {}
+
+    void io_loop::connection::send(const std::shared_ptr<buffer>& data,
+                                   priority prio) {
+        if(!data || !m_open) {
+            return;
+        }
+        auto schedule = false;
+        {
+            std::unique_lock<std::mutex> l(m_send_mut);
+            if(prio == priority::high) {
+                m_queued_high.push_back(data);
+            } else {
+                m_queued.push_back(data);
+            }
+            if(!m_flush_scheduled) {
+                m_flush_scheduled = true;
+                schedule = true;
+            }
+        }
+        if(schedule) {
+            m_worker->post_flush(shared_from_this());
+        }
+    }
+
+    auto io_loop::connection::open() const -> bool {
+        return m_open;
+    }
+
+    io_loop::worker::worker([[maybe_unused]] config::network_backend backend)
+        : m_read_buf(read_buffer_size) {
+        [[maybe_unused]] auto res = pipe(m_wake_fds.data());
+        assert(res == 0);
+        fcntl(m_wake_fds[0], F_SETFL, O_NONBLOCK);
+#ifdef __APPLE__
+        m_events = std::make_unique<rpc::kqueue_event_handler>();
+#endif
+#ifdef __linux__
+        if(backend == config::network_backend::io_uring) {
+            auto ring = std::make_unique<uring>();
+            if(ring->init()) {
+                m_ring = std::move(ring);
+                uring_arm_wake();
+            }
+        }
+        if(!m_ring) {
+            m_events = std::make_unique<rpc::epoll_event_handler>();
+        }
+#endif
+        if(m_events) {
+            [[maybe_unused]] auto init = m_events->init();
+            assert(init);
+            // Poll without reporting timeouts, waking at least once a
+            // second
+            m_events->set_timeout(-1);
+            m_events->register_fd(m_wake_fds[0],
+                                  rpc::event_handler::event_type::in);
+        }
+        m_thread = std::thread([&]() {
+            pin_current_thread(thread_role::network);
+            run();
+        });
+    }
+
+    io_loop::worker::~worker() {
+        m_running = false;
+        wake();
+        if(m_thread.joinable()) {
+            m_thread.join();
+        }
+        close(m_wake_fds[0]);
+        close(m_wake_fds[1]);
+    }
+
+    void io_loop::worker::run() {
+#ifdef __linux__
+        if(m_ring) {
+            run_uring();
+            return;
+        }
+#endif
+        while(m_running) {
+            auto evs = m_events->poll();
+            if(evs.has_value()) {
+                for(const auto& [fd, timeout] : *evs) {
+                    if(timeout) {
+                        continue;
+                    }
+                    if(fd == m_wake_fds[0]) {
+                        auto drain = std::array<char, 64>();
+                        while(read(fd, drain.data(), drain.size()) > 0) {}
+                        continue;
+                    }
+                    auto it = m_conns.find(fd);
+                    if(it == m_conns.end()) {
+                        continue;
+                    }
+                    // Keep the connection alive through its callbacks
+                    auto conn = it->second;
+                    read_ready(*conn);
+                    if(conn->m_open && conn->m_want_write && !flush(*conn)) {
+                        fail(*conn);
+                    }
+                }
+            }
+            process_posted();
+        }
+    }
+
+    void io_loop::worker::wake() {
+        {
+            std::unique_lock<std::mutex> l(m_mut);
+            if(m_woken) {
+                return;
+            }
+            m_woken = true;
+        }
+        static constexpr auto dummy_byte = char();
+        [[maybe_unused]] auto res
+            = write(m_wake_fds[1], &dummy_byte, sizeof(dummy_byte));
+    }
+
+    void io_loop::worker::post_flush(std::shared_ptr<connection> conn) {
+        {
+            std::unique_lock<std::mutex> l(m_mut);
+            m_flush.emplace_back(std::move(conn));
+        }
+        wake();
+    }
+
+    void io_loop::worker::process_posted() {
+        decltype(m_added) added;
+        decltype(m_flush) to_flush;
+        decltype(m_removed) removed;
+        {
+            std::unique_lock<std::mutex> l(m_mut);
+            m_woken = false;
+            std::swap(added, m_added);
+            std::swap(to_flush, m_flush);
+            std::swap(removed, m_removed);
+        }
+
+        for(auto& conn : added) {
+#ifdef __linux__
+            if(m_ring) {
+                m_live[conn.get()] = conn;
+                uring_arm_recv(*conn);
+                continue;
+            }
+#endif
+            m_conns[conn->m_fd] = conn;
+            m_events->register_fd(conn->m_fd,
+                                  rpc::event_handler::event_type::in);
+        }
+
+        for(auto& conn : to_flush) {
+            if(!conn->m_open) {
+                continue;
+            }
+#ifdef __linux__
+            if(m_ring) {
+                uring_flush(*conn);
+                continue;
+            }
+#endif
+            if(!flush(*conn)) {
+                fail(*conn);
+            }
+        }
+
+        for(auto& [conn, done] : removed) {
+            detach(*conn);
+            done->set_value();
+        }
+    }
+
+    void io_loop::worker::read_ready(connection& conn) {
+        // Read until the socket would block, as epoll is edge-triggered
+        while(conn.m_open) {
+            // Read the rest of a large packet straight into its buffer
+            if(conn.m_pkt
+               && conn.m_pkt->size() - conn.m_pkt_read >= m_read_buf.size()) {
+                auto n = read(conn.m_fd,
+                              conn.m_pkt->data_at(conn.m_pkt_read),
+                              conn.m_pkt->size() - conn.m_pkt_read);
+                if(n < 0 && would_block()) {
+                    return;
+                }
+                if(n <= 0) {
+                    fail(conn);
+                    return;
+                }
+                conn.m_pkt_read += static_cast<size_t>(n);
+                if(conn.m_pkt_read == conn.m_pkt->size()) {
+                    deliver(conn);
+                }
+                continue;
+            }
+
+            auto n = read(conn.m_fd, m_read_buf.data(), m_read_buf.size());
+            if(n < 0 && would_block()) {
+                return;
+            }
+            if(n <= 0) {
+                fail(conn);
+                return;
+            }
+            consume(conn, m_read_buf.data(), static_cast<size_t>(n));
+        }
+    }
+
+    void io_loop::worker::consume(connection& conn,
+                                  const std::byte* data,
+                                  size_t len) {
+        while(len > 0 && conn.m_open) {
+            if(!conn.m_pkt) {
+                auto n
+                    = std::min(len, conn.m_header.size() - conn.m_header_read);
+                std::memcpy(&conn.m_header[conn.m_header_read], data, n);
+                conn.m_header_read += n;
+                data += n;
+                len -= n;
+                if(conn.m_header_read < conn.m_header.size()) {
+                    return;
+                }
+                uint64_t pkt_sz{};
+                std::memcpy(&pkt_sz, conn.m_header.data(), sizeof(pkt_sz));
+                conn.m_header_read = 0;
+                conn.m_pkt = buffer_pool::global().acquire(pkt_sz);
+                conn.m_pkt->extend(pkt_sz);
+                conn.m_pkt_read = 0;
+                if(pkt_sz == 0) {
+                    deliver(conn);
+                }
+                continue;
+            }
+            auto n = std::min(len, conn.m_pkt->size() - conn.m_pkt_read);
+            std::memcpy(conn.m_pkt->data_at(conn.m_pkt_read), data, n);
+            conn.m_pkt_read += n;
+            data += n;
+            len -= n;
+            if(conn.m_pkt_read == conn.m_pkt->size()) {
+                deliver(conn);
+            }
+        }
+    }
+
+    void io_loop::worker::deliver(connection& conn) {
+        auto pkt = std::move(conn.m_pkt);
+        conn.m_pkt.reset();
+        conn.m_pkt_read = 0;
+        conn.m_recv_cb(std::move(pkt));
+    }
+
+    auto io_loop::worker::flush(connection& conn) -> bool {
+        take_queued(conn);
+        while(conn.m_send_idx < conn.m_sending.size()) {
+            auto [iov, n_iov] = gather(conn);
+            auto n = writev(conn.m_fd, iov, static_cast<int>(n_iov));
+            if(n < 0 && would_block()) {
+                set_want_write(conn, true);
+                return true;
+            }
+            if(n <= 0) {
+                return false;
+            }
+            advance(conn, static_cast<size_t>(n));
+        }
+        set_want_write(conn, false);
+        return true;
+    }
+
+    void io_loop::worker::take_queued(connection& conn) {
+        std::unique_lock<std::mutex> l(conn.m_send_mut);
+        conn.m_flush_scheduled = false;
+        if(!conn.m_queued_high.empty()) {
+            // Place high priority packets after those already placed and
+            // any partly written packet, ahead of the unsent normal ones.
+            auto pos = std::max(conn.m_high_end,
+                                conn.m_send_idx
+                                    + (conn.m_send_offset > 0 ? 1 : 0));
+            pos = std::min(pos, conn.m_sending.size());
+            conn.m_sending.insert(
+                conn.m_sending.begin() + static_cast<std::ptrdiff_t>(pos),
+                conn.m_queued_high.begin(),
+                conn.m_queued_high.end());
+            conn.m_high_end = pos + conn.m_queued_high.size();
+            conn.m_queued_high.clear();
+        }
+        conn.m_sending.insert(conn.m_sending.end(),
+                              conn.m_queued.begin(),
+                              conn.m_queued.end());
+        conn.m_queued.clear();
+    }
+
+    auto io_loop::worker::gather(connection& conn)
+        -> std::pair<iovec*, size_t> {
+        size_t n_iov{0};
+        for(size_t i = 0; i < max_gather_packets
+                          && conn.m_send_idx + i < conn.m_sending.size();
+            i++) {
+            const auto& pkt = conn.m_sending[conn.m_send_idx + i];
+            conn.m_sizes[i] = static_cast<uint64_t>(pkt->size());
+            conn.m_iov[n_iov].iov_base = &conn.m_sizes[i];
+            conn.m_iov[n_iov].iov_len = sizeof(conn.m_sizes[i]);
+            n_iov++;
+            conn.m_iov[n_iov].iov_base
+                = const_cast<void*>(pkt->data()); // NOLINT
+            conn.m_iov[n_iov].iov_len = pkt->size();
+            n_iov++;
+        }
+
+        // Skip what was already written of the first packet
+        auto skip = conn.m_send_offset;
+        auto* first = conn.m_iov.data();
+        while(skip > 0 && skip >= first->iov_len) {
+            skip -= first->iov_len;
+            first++;
+            n_iov--;
+        }
+        first->iov_base = static_cast<std::byte*>(first->iov_base) + skip;
+        first->iov_len -= skip;
+        return {first, n_iov};
+    }
+
+    void io_loop::worker::advance(connection& conn, size_t written) {
+        while(written > 0) {
+            const auto& pkt = conn.m_sending[conn.m_send_idx];
+            auto remaining
+                = sizeof(uint64_t) + pkt->size() - conn.m_send_offset;
+            if(written < remaining) {
+                conn.m_send_offset += written;
+                return;
+            }
+            written -= remaining;
+            conn.m_send_idx++;
+            conn.m_send_offset = 0;
+        }
+        if(conn.m_send_idx == conn.m_sending.size()) {
+            conn.m_sending.clear();
+            conn.m_send_idx = 0;
+            conn.m_high_end = 0;
+        }
+    }
+
+    void io_loop::worker::set_want_write(connection& conn, bool want) {
+        if(conn.m_want_write == want) {
+            return;
+        }
+        conn.m_want_write = want;
+        if(want) {
+            m_events->register_fd(conn.m_fd,
+                                  rpc::event_handler::event_type::inout);
+        } else {
+            // Re-register rather than modify so that level-triggered
+            // handlers drop the write filter.
+            m_events->register_fd(conn.m_fd,
+                                  rpc::event_handler::event_type::remove);
+            m_events->register_fd(conn.m_fd,
+                                  rpc::event_handler::event_type::in);
+        }
+    }
+
+    void io_loop::worker::detach(connection& conn) {
+        conn.m_open = false;
+#ifdef __linux__
+        if(m_ring) {
+            uring_cancel(conn, op_recv);
+            if(conn.m_send_inflight) {
+                uring_cancel(conn, op_send);
+            }
+            uring_release(conn);
+            return;
+        }
+#endif
+        auto it = m_conns.find(conn.m_fd);
+        if(it == m_conns.end() || it->second.get() != &conn) {
+            return;
+        }
+        m_events->register_fd(conn.m_fd,
+                              rpc::event_handler::event_type::remove);
+        m_conns.erase(it);
+    }
+
+    void io_loop::worker::fail(connection& conn) {
+        if(!conn.m_open) {
+            return;
+        }
+        detach(conn);
+        {
+            std::unique_lock<std::mutex> l(conn.m_send_mut);
+            conn.m_queued.clear();
+            conn.m_queued_high.clear();
+        }
+        if(!conn.m_send_inflight) {
+            conn.m_sending.clear();
+        }
+        if(conn.m_close_cb) {
+            conn.m_close_cb();
+        }
+    }
+
+#ifdef __linux__
+    void io_loop::worker::run_uring() {
+        while(m_running) {
+            m_cqes.clear();
+            if(m_ring->submit_and_wait(m_cqes)) {
+                for(const auto& cqe : m_cqes) {
+                    uring_complete(cqe);
+                }
+            }
+            process_posted();
+        }
+    }
+
+    void io_loop::worker::uring_complete(const io_uring_cqe& cqe) {
+        if(cqe.user_data == ignore_tag) {
+            return;
+        }
+        if(cqe.user_data == wake_tag) {
+            auto drain = std::array<char, 64>();
+            while(read(m_wake_fds[0], drain.data(), drain.size()) > 0) {}
+            if((cqe.flags & IORING_CQE_F_MORE) == 0) {
+                uring_arm_wake();
+            }
+            return;
+        }
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* ptr = reinterpret_cast<connection*>(cqe.user_data & ~op_mask);
+        auto it = m_live.find(ptr);
+        assert(it != m_live.end());
+        // Keep the connection alive through its callbacks
+        auto conn = it->second;
+        if((cqe.user_data & op_mask) == op_send) {
+            uring_sent(*conn, cqe.res);
+        } else {
+            uring_received(*conn, cqe);
+        }
+    }
+
+    void io_loop::worker::uring_arm_wake() {
+        auto* sqe = m_ring->get_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = m_wake_fds[0];
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = wake_tag;
+    }
+
+    void io_loop::worker::uring_arm_recv(connection& conn) {
+        auto* sqe = m_ring->get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = conn.m_fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = uring::buffer_group;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        sqe->user_data = reinterpret_cast<uint64_t>(&conn) | op_recv;
+        conn.m_ops++;
+    }
+
+    void io_loop::worker::uring_received(connection& conn,
+                                         const io_uring_cqe& cqe) {
+        const auto more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+        if(!more) {
+            conn.m_ops--;
+        }
+        if((cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+            const auto bid
+                = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if(cqe.res > 0) {
+                consume(conn,
+                        m_ring->recv_buffer(bid),
+                        static_cast<size_t>(cqe.res));
+            }
+            m_ring->recycle(bid);
+        }
+        if(!conn.m_open) {
+            uring_release(conn);
+            return;
+        }
+        // Running out of provided buffers ends the multishot receive
+        // without closing the connection.
+        if(cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS)) {
+            fail(conn);
+            return;
+        }
+        if(!more) {
+            uring_arm_recv(conn);
+        }
+    }
+
+    void io_loop::worker::uring_flush(connection& conn) {
+        // Leave packets queued while a send is in flight, as placing high
+        // priority ones would move the packets it covers. The completion
+        // flushes again.
+        if(conn.m_send_inflight) {
+            return;
+        }
+        take_queued(conn);
+        if(conn.m_sending.empty()) {
+            return;
+        }
+        auto [iov, n_iov] = gather(conn);
+        conn.m_msg = msghdr{};
+        conn.m_msg.msg_iov = iov;
+        conn.m_msg.msg_iovlen = n_iov;
+
+        auto* sqe = m_ring->get_sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = conn.m_fd;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        sqe->addr = reinterpret_cast<uint64_t>(&conn.m_msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        sqe->user_data = reinterpret_cast<uint64_t>(&conn) | op_send;
+        conn.m_send_inflight = true;
+        conn.m_ops++;
+    }
+
+    void io_loop::worker::uring_sent(connection& conn, int res) {
+        conn.m_ops--;
+        conn.m_send_inflight = false;
+        if(!conn.m_open) {
+            conn.m_sending.clear();
+            uring_release(conn);
+            return;
+        }
+        if(res <= 0) {
+            fail(conn);
+            return;
+        }
+        advance(conn, static_cast<size_t>(res));
+        uring_flush(conn);
+    }
+
+    void io_loop::worker::uring_cancel(connection& conn, uint64_t op) {
+        if(conn.m_ops == 0) {
+            return;
+        }
+        auto* sqe = m_ring->get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        sqe->addr = reinterpret_cast<uint64_t>(&conn) | op;
+        sqe->user_data = ignore_tag;
+    }
+
+    void io_loop::worker::uring_release(connection& conn) {
+        if(!conn.m_open && conn.m_ops == 0) {
+            m_live.erase(&conn);
+        }
+    }
+#endif
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_NETWORK_IO_LOOP_H_
+#define OPENCBDC_TX_SRC_NETWORK_IO_LOOP_H_
+
+#include "tcp_socket.hpp"
+#include "util/common/buffer.hpp"
+#include "util/common/config.hpp"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace cbdc::rpc {
+    class event_handler;
+}
+
+namespace cbdc::network {
+    /// Send priority class of a packet.
+    enum class priority {
+        /// Small control traffic, such as consensus-adjacent requests and
+        /// status responses. Sent ahead of any queued normal packets.
+        high,
+        /// Everything else, including bulk data.
+        normal
+    };
+
+    /// \brief Event-driven I/O for TCP sockets.
+    ///
+    /// Multiplexes any number of sockets over a fixed set of I/O threads.
+    /// With the epoll backend, each thread polls its non-blocking sockets
+    /// with an \ref rpc::event_handler. With the io_uring backend, each
+    /// thread keeps a multishot receive and at most one send in flight
+    /// per socket, and waits for their completions. Uses the same
+    /// size-prefixed packet framing as \ref tcp_socket. Received packets
+    /// are passed to a callback on the I/O thread. Sent packets are queued
+    /// and written by the I/O thread, with packets queued together
+    /// gathered into single writes. High priority packets overtake queued
+    /// normal packets not yet started, so packets are only delivered in
+    /// order within each \ref priority class.
+    class io_loop {
+      public:
+        /// Callback for each packet received on a connection.
+        using recv_callback_type
+            = std::function<void(std::shared_ptr<buffer>)>;
+
+        /// Callback for when a connection is closed by the remote host or
+        /// fails.
+        using close_callback_type = std::function<void()>;
+
+        class connection;
+
+        /// Constructor. Starts the I/O threads.
+        /// \param n_threads number of I/O threads. At least one is started.
+        /// \param backend I/O mechanism to use. io_uring falls back to
+        ///                epoll if the kernel does not support it.
+        explicit io_loop(
+            size_t n_threads,
+            config::network_backend backend = config::network_backend::epoll);
+
+        /// Stops the I/O threads. Every connection must have been removed.
+        ~io_loop();
+
+        io_loop(const io_loop&) = delete;
+        auto operator=(const io_loop&) -> io_loop& = delete;
+        io_loop(io_loop&&) = delete;
+        auto operator=(io_loop&&) -> io_loop& = delete;
+
+        /// Returns the process-wide loop used by \ref peer s by default.
+        /// Never destroyed.
+        /// \return global I/O loop.
+        static auto global() -> const std::shared_ptr<io_loop>&;
+
+        /// Returns the number of I/O threads the global loop starts: a
+        /// quarter of the hardware threads, and at least one.
+        /// \return default I/O thread count.
+        static auto default_thread_count() -> size_t;
+
+        /// Sets the backend of the global loop. Has no effect once
+        /// \ref global has been called.
+        /// \param backend I/O mechanism for the global loop.
+        static void set_global_backend(config::network_backend backend);
+
+        /// Returns the I/O mechanism in use, after any fallback.
+        /// \return backend handling the loop's sockets.
+        [[nodiscard]] auto backend() const -> config::network_backend;
+
+        /// Starts handling I/O on a connected socket. The epoll backend
+        /// switches the socket to non-blocking mode. The socket must stay
+        /// open until the connection is removed.
+        /// \param sock connected socket.
+        /// \param recv_cb function to call with each received packet.
+        /// \param close_cb function to call if the connection closes before
+        ///                 it is removed.
+        /// \return handle for sending on and removing the connection, or
+        ///         nullptr if the socket is not open.
+        [[nodiscard]] auto add(tcp_socket& sock,
+                               recv_callback_type recv_cb,
+                               close_callback_type close_cb)
+            -> std::shared_ptr<connection>;
+
+        /// Stops handling I/O on a connection. No callbacks for the
+        /// connection run after this returns. May be called from the
+        /// connection's own callbacks.
+        /// \param conn connection to remove.
+        void remove(const std::shared_ptr<connection>& conn);
+
+      private:
+        struct worker;
+
+        /// Number of packets gathered into a single write.
+        static constexpr size_t max_gather_packets = 32;
+
+        std::vector<std::unique_ptr<worker>> m_workers;
+        std::atomic<size_t> m_next_worker{0};
+    };
+
+    /// Handle for a socket registered with an \ref io_loop.
+    class io_loop::connection
+        : public std::enable_shared_from_this<connection> {
+      public:
+        /// Queues a packet to send. Packets queued after the connection
+        /// closes are dropped.
+        /// \param data packet to send.
+        /// \param prio priority class of the packet.
+        void send(const std::shared_ptr<buffer>& data,
+                  priority prio = priority::normal);
+
+        /// Indicates whether the connection is still being handled.
+        /// \return false once the connection has closed or been removed.
+        [[nodiscard]] auto open() const -> bool;
+
+        /// Constructor. Use \ref io_loop::add.
+        connection(int fd,
+                   worker* w,
+                   recv_callback_type recv_cb,
+                   close_callback_type close_cb);
+
+      private:
+        friend class io_loop;
+        friend struct worker;
+
+        int m_fd;
+        worker* m_worker;
+        recv_callback_type m_recv_cb;
+        close_callback_type m_close_cb;
+        std::atomic_bool m_open{true};
+
+        // Read state, only touched by the I/O thread
+        std::array<std::byte, sizeof(uint64_t)> m_header{};
+        size_t m_header_read{0};
+        std::shared_ptr<buffer> m_pkt;
+        size_t m_pkt_read{0};
+
+        // Packets queued by senders
+        std::mutex m_send_mut;
+        std::vector<std::shared_ptr<buffer>> m_queued;
+        std::vector<std::shared_ptr<buffer>> m_queued_high;
+        bool m_flush_scheduled{false};
+
+        // Write state, only touched by the I/O thread
+        std::vector<std::shared_ptr<buffer>> m_sending;
+        size_t m_send_idx{0};
+        size_t m_send_offset{0};
+        /// End of the high priority packets placed ahead of the unsent
+        /// normal packets in m_sending.
+        size_t m_high_end{0};
+        std::array<uint64_t, max_gather_packets> m_sizes{};
+        std::array<iovec, max_gather_packets * 2> m_iov{};
+        bool m_want_write{false};
+
+        // io_uring state, only touched by the I/O thread
+        size_t m_ops{0};
+        bool m_send_inflight{false};
+        msghdr m_msg{};
+    };
+}
+
+#endif
@@ -5,28 +5,46 @@
 
 #include "peer.hpp"
 
-#include <cassert>
 #include <utility>
 
 namespace cbdc::network {
     peer::peer(std::unique_ptr<tcp_socket> sock,
                peer::callback_type cb,
-               bool attempt_reconnect)
+               bool attempt_reconnect,
+               reconnect_callback_type reconnect_cb,
+               std::shared_ptr<io_loop> loop)
         : m_sock(std::move(sock)),
+          m_loop(loop ? std::move(loop) : io_loop::global()),
           m_attempt_reconnect(attempt_reconnect),
-          m_recv_cb(std::move(cb)) {
-        do_send();
-        do_recv();
-        do_reconnect();
+          m_recv_cb(std::move(cb)),
+          m_reconnect_cb(std::move(reconnect_cb)) {
+        if(m_attempt_reconnect) {
+            do_reconnect();
+        }
+        if(!attach()) {
+            if(m_attempt_reconnect) {
+                signal_reconnect();
+            } else {
+                m_running = false;
+                m_shut_down = true;
+            }
+        }
     }
 
     peer::~peer() {
         shutdown();
     }
 
-    void peer::send(const std::shared_ptr<cbdc::buffer>& data) {
-        if(!m_shut_down) {
-            m_send_queue.push(data);
+    void peer::send(const std::shared_ptr<cbdc::buffer>& data,
+                    priority prio) {
+        if(m_shut_down) {
+            return;
+        }
+        std::unique_lock<std::mutex> l(m_conn_mut);
+        if(m_conn && m_conn->open()) {
+            m_conn->send(data, prio);
+        } else if(m_attempt_reconnect) {
+            m_pending.emplace_back(data, prio);
         }
     }
 
@@ -43,38 +61,39 @@ namespace cbdc::network {
         return !m_shut_down && m_running && m_sock->connected();
     }
 
-    void peer::do_send() {
-        m_send_thread = std::thread([&]() {
-            while(m_running) {
-                std::shared_ptr<cbdc::buffer> pkt;
-                if(!m_send_queue.pop(pkt)) {
-                    assert(!m_running);
-                    break;
-                }
-
-                if(pkt) {
-                    const auto result = m_sock->send(*pkt);
-                    if(!result) {
-                        signal_reconnect();
-                        return;
-                    }
-                }
-            }
-        });
+    auto peer::attach() -> bool {
+        m_running = true;
+        auto conn = m_loop->add(
+            *m_sock,
+            [&](std::shared_ptr<cbdc::buffer> pkt) {
+                m_recv_cb(std::move(pkt));
+            },
+            [&]() {
+                handle_close();
+            });
+        if(!conn) {
+            m_running = false;
+            return false;
+        }
+        std::unique_lock<std::mutex> l(m_conn_mut);
+        m_conn = std::move(conn);
+        for(const auto& [pkt, prio] : m_pending) {
+            m_conn->send(pkt, prio);
+        }
+        m_pending.clear();
+        return true;
     }
 
-    void peer::do_recv() {
-        m_recv_thread = std::thread([&]() {
-            while(m_running) {
-                auto pkt = std::make_shared<cbdc::buffer>();
-                if(!m_sock->receive(*pkt)) {
-                    signal_reconnect();
-                    return;
-                }
-
-                m_recv_cb(std::move(pkt));
-            }
-        });
+    void peer::handle_close() {
+        m_running = false;
+        if(m_attempt_reconnect) {
+            signal_reconnect();
+            return;
+        }
+        m_shut_down = true;
+        std::unique_lock<std::mutex> l(m_conn_mut);
+        m_sock->disconnect();
+        m_pending.clear();
     }
 
     void peer::do_reconnect() {
@@ -90,26 +109,24 @@ namespace cbdc::network {
                 if(m_shut_down) {
                     break;
                 }
-                if(m_attempt_reconnect) {
-                    close();
-                    while(!m_shut_down && !m_sock->reconnect()) {
-                        static constexpr auto retry_delay
-                            = std::chrono::seconds(3);
-                        std::unique_lock<std::mutex> l(m_reconnect_mut);
-                        m_reconnect_cv.wait_for(l, retry_delay, [&]() -> bool {
-                            return m_shut_down;
-                        });
-                    }
-                    if(!m_shut_down) {
-                        m_running = true;
-                        do_send();
-                        do_recv();
-                    }
-                } else {
-                    m_shut_down = true;
-                    close();
-                    m_send_queue.clear();
-                    return;
+                close();
+                while(!m_shut_down && !m_sock->reconnect()) {
+                    static constexpr auto retry_delay
+                        = std::chrono::seconds(3);
+                    std::unique_lock<std::mutex> l(m_reconnect_mut);
+                    m_reconnect_cv.wait_for(l, retry_delay, [&]() -> bool {
+                        return m_shut_down;
+                    });
+                }
+                if(m_shut_down) {
+                    break;
+                }
+                if(!attach()) {
+                    signal_reconnect();
+                    continue;
+                }
+                if(m_reconnect_cb) {
+                    m_reconnect_cb();
                 }
             }
         });
@@ -117,15 +134,16 @@ namespace cbdc::network {
 
     void peer::close() {
         m_running = false;
-        m_sock->disconnect();
-        m_send_queue.clear();
-        if(m_send_thread.joinable()) {
-            m_send_thread.join();
-        }
-        if(m_recv_thread.joinable()) {
-            m_recv_thread.join();
+        auto conn = std::shared_ptr<io_loop::connection>();
+        {
+            std::unique_lock<std::mutex> l(m_conn_mut);
+            std::swap(conn, m_conn);
         }
-        m_send_queue.reset();
+        // Waits for any callback running on the I/O thread to finish
+        m_loop->remove(conn);
+        std::unique_lock<std::mutex> l(m_conn_mut);
+        m_sock->disconnect();
+        m_pending.clear();
     }
 
     void peer::signal_reconnect() {
@@ -6,18 +6,23 @@
 #ifndef OPENCBDC_TX_SRC_NETWORK_PEER_H_
 #define OPENCBDC_TX_SRC_NETWORK_PEER_H_
 
+#include "io_loop.hpp"
 #include "tcp_socket.hpp"
-#include "util/common/blocking_queue.hpp"
 
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace cbdc::network {
     /// \brief Maintains a TCP socket.
     ///
     /// Handles reconnecting to a TCP socket, queuing discrete packets to send,
     /// sending queued packets, and passing received packets to a callback
-    /// function.
+    /// function. Sending and receiving is handled by the threads of an
+    /// \ref io_loop, so the receipt callback is called on an I/O thread and
+    /// should not block.
     class peer {
       public:
         /// Type for the packet receipt callback function. Accepts a pointer to
@@ -25,19 +30,29 @@ namespace cbdc::network {
         using callback_type
             = std::function<void(std::shared_ptr<cbdc::buffer>)>;
 
-        /// \brief Constructor. Starts socket management threads.
+        /// Type for the function called each time the TCP socket
+        /// reconnects.
+        using reconnect_callback_type = std::function<void()>;
+
+        /// \brief Constructor. Starts handling the socket.
         ///
-        /// Starts a thread to send queued packets via the
-        /// associated TCP socket. Starts a thread to receive packets and call
-        /// a callback function. Starts a thread to monitor the connection
-        /// status of the TCP socket and reconnect if the socket disconnects.
+        /// Registers the TCP socket with the I/O loop, which sends queued
+        /// packets and calls a callback function with received packets. If
+        /// reconnecting, starts a thread to reconnect the TCP socket when it
+        /// disconnects.
         /// \param sock TCP socket to manage.
         /// \param cb callback function to call with packets received by the socket.
         /// \param attempt_reconnect true if the instance should reconnect the TCP
         ///                          socket if it loses the connection.
+        /// \param reconnect_cb optional function to call after each
+        ///                     successful reconnection.
+        /// \param loop I/O loop to handle the socket with, or nullptr to
+        ///             use \ref io_loop::global.
         peer(std::unique_ptr<tcp_socket> sock,
              callback_type cb,
-             bool attempt_reconnect);
+             bool attempt_reconnect,
+             reconnect_callback_type reconnect_cb = nullptr,
+             std::shared_ptr<io_loop> loop = nullptr);
 
         /// Destructor. Calls \ref shutdown().
         ~peer();
@@ -51,12 +66,15 @@ namespace cbdc::network {
         /// \brief Sends buffered data.
         ///
         /// Queues a packet to send via the TCP socket. The recipient peer
-        /// receives it as a discrete unit.
+        /// receives it as a discrete unit. High priority packets overtake
+        /// queued normal ones.
         /// \param data buffer to send.
-        void send(const std::shared_ptr<cbdc::buffer>& data);
+        /// \param prio priority class of the packet.
+        void send(const std::shared_ptr<cbdc::buffer>& data,
+                  priority prio = priority::normal);
 
-        /// Clears any packets in the pending send queue. Stops the send,
-        /// receive, and reconnect threads. Disconnects the TCP socket.
+        /// Clears any packets in the pending send queue. Stops handling the
+        /// socket and the reconnect thread. Disconnects the TCP socket.
         void shutdown();
 
         /// Indicates whether the TCP socket is currently connected.
@@ -65,11 +83,13 @@ namespace cbdc::network {
 
       private:
         std::unique_ptr<tcp_socket> m_sock;
+        std::shared_ptr<io_loop> m_loop;
 
-        blocking_queue<std::shared_ptr<cbdc::buffer>> m_send_queue;
-
-        std::thread m_recv_thread;
-        std::thread m_send_thread;
+        std::mutex m_conn_mut;
+        std::shared_ptr<io_loop::connection> m_conn;
+        /// Packets sent while disconnected, to send once reconnected.
+        std::vector<std::pair<std::shared_ptr<cbdc::buffer>, priority>>
+            m_pending;
 
         std::thread m_reconnect_thread;
         std::mutex m_reconnect_mut;
@@ -81,10 +101,11 @@ namespace cbdc::network {
         std::atomic_bool m_shut_down{false};
 
         callback_type m_recv_cb;
+        reconnect_callback_type m_reconnect_cb;
 
-        void do_send();
+        [[nodiscard]] auto attach() -> bool;
 
-        void do_recv();
+        void handle_close();
 
         void do_reconnect();
 
@@ -5,10 +5,29 @@
 
 #include "socket.hpp"
 
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
 #include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <ifaddrs.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 namespace cbdc::network {
+    namespace {
+        std::atomic_bool local_transport{false};
+    }
+
+    void set_local_transport(bool enabled) {
+        local_transport = enabled;
+    }
+
+    auto socket::local_transport_enabled() -> bool {
+        return local_transport;
+    }
+
     socket::socket() {
         // Ignore SIGPIPE if the socket disconnects and we try to write to it
         static std::atomic_flag sigpipe_ignored = ATOMIC_FLAG_INIT;
@@ -57,4 +76,92 @@ namespace cbdc::network {
         }
         return true;
     }
+
+    auto socket::get_local_addr(const ip_address& address,
+                                port_number_t port)
+        -> std::pair<sockaddr_un, socklen_t> {
+        // The leading NUL places the name in the abstract namespace, so no
+        // file is left behind and the name is released when the listener
+        // closes. Names longer than sun_path are truncated.
+        auto name = "opencbdc/" + address + ":" + std::to_string(port);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        const auto len = std::min(name.size(), sizeof(addr.sun_path) - 1);
+        std::memcpy(&addr.sun_path[1], name.data(), len);
+        return {addr,
+                static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1
+                                       + len)};
+    }
+
+    auto socket::is_same_user_peer(int fd) -> bool {
+        // Abstract socket names carry no filesystem permissions, so any
+        // local process could take a listener's name. Only peers running
+        // as this process's user are trusted.
+        ucred cred{};
+        socklen_t len = sizeof(cred);
+        if(getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+            return false;
+        }
+        return cred.uid == getuid();
+    }
+
+    auto socket::is_local_address(const ip_address& address) -> bool {
+        auto res0 = get_addrinfo(address, 0);
+        if(!res0) {
+            return false;
+        }
+        ifaddrs* ifs0{};
+        if(getifaddrs(&ifs0) != 0) {
+            return false;
+        }
+        auto ifs = std::unique_ptr<ifaddrs, decltype(&freeifaddrs)>(
+            ifs0,
+            &freeifaddrs);
+
+        auto same_ip = [](const sockaddr* a, const sockaddr* b) {
+            if(a->sa_family != b->sa_family) {
+                return false;
+            }
+            if(a->sa_family == AF_INET) {
+                const auto* a4 = reinterpret_cast<const sockaddr_in*>(a);
+                const auto* b4 = reinterpret_cast<const sockaddr_in*>(b);
+                return a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+            }
+            const auto* a6 = reinterpret_cast<const sockaddr_in6*>(a);
+            const auto* b6 = reinterpret_cast<const sockaddr_in6*>(b);
+            return std::memcmp(&a6->sin6_addr,
+                               &b6->sin6_addr,
+                               sizeof(a6->sin6_addr))
+                == 0;
+        };
+
+        for(auto* res = res0.get(); res != nullptr; res = res->ai_next) {
+            if(res->ai_family == AF_INET) {
+                const auto* in
+                    = reinterpret_cast<const sockaddr_in*>(res->ai_addr);
+                static constexpr auto loopback_net = 0x7f000000U;
+                static constexpr auto net_mask = 0xff000000U;
+                if((ntohl(in->sin_addr.s_addr) & net_mask) == loopback_net) {
+                    return true;
+                }
+            } else if(res->ai_family == AF_INET6) {
+                const auto* in6
+                    = reinterpret_cast<const sockaddr_in6*>(res->ai_addr);
+                if(IN6_IS_ADDR_LOOPBACK(&in6->sin6_addr)) {
+                    return true;
+                }
+            } else {
+                continue;
+            }
+            for(auto* i = ifs.get(); i != nullptr; i = i->ifa_next) {
+                if(i->ifa_addr != nullptr
+                   && (i->ifa_addr->sa_family == AF_INET
+                       || i->ifa_addr->sa_family == AF_INET6)
+                   && same_ip(i->ifa_addr, res->ai_addr)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
 }
@@ -9,6 +9,7 @@
 #include <memory>
 #include <netdb.h>
 #include <string>
+#include <sys/un.h>
 
 namespace cbdc::network {
     /// An IP addresses.
@@ -21,6 +22,13 @@ namespace cbdc::network {
     /// IP address for localhost.
     static const auto localhost = ip_address("127.0.0.1");
 
+    /// Sets whether connections between endpoints on the same host use a
+    /// Unix domain socket instead of loopback TCP. Affects listeners and
+    /// connections created afterwards. Disabled by default, see
+    /// config::options::m_local_transport.
+    /// \param enabled true to use Unix domain sockets where possible.
+    void set_local_transport(bool enabled);
+
     /// \brief Generic superclass for network sockets.
     ///
     /// Provides a socket file descriptor and utility methods for configuring
@@ -45,10 +53,27 @@ namespace cbdc::network {
         friend class tcp_socket;
         friend class tcp_listener;
         friend class socket_selector;
+        friend class io_loop;
 
         static auto get_addrinfo(const ip_address& address, port_number_t port)
             -> std::shared_ptr<addrinfo>;
 
+        /// Returns the abstract Unix domain socket address on which a
+        /// listener for the given endpoint accepts same-host connections.
+        static auto get_local_addr(const ip_address& address,
+                                   port_number_t port)
+            -> std::pair<sockaddr_un, socklen_t>;
+
+        /// Checks whether the address resolves to the loopback interface
+        /// or to an address of one of this host's interfaces.
+        static auto is_local_address(const ip_address& address) -> bool;
+
+        static auto local_transport_enabled() -> bool;
+
+        /// Checks whether the peer of a connected Unix domain socket runs
+        /// as the same user as this process.
+        static auto is_same_user_peer(int fd) -> bool;
+
         virtual auto create_socket(int domain, int type, int protocol) -> bool;
         virtual auto set_sockopts() -> bool;
     };
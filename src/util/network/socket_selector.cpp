@@ -13,6 +13,12 @@ namespace cbdc::network {
         return add(sock.m_sock_fd);
     }
 
+    auto socket_selector::add(const tcp_listener& listener) -> bool {
+        return add(listener.m_sock_fd)
+            && (listener.m_local_fd.load() == -1
+                || add(listener.m_local_fd.load()));
+    }
+
     auto socket_selector::wait() -> bool {
         m_ready_fds = m_fds;
         const auto nfds
@@ -6,7 +6,7 @@
 #ifndef OPENCBDC_TX_SRC_NETWORK_SOCKET_SELECTOR_H_
 #define OPENCBDC_TX_SRC_NETWORK_SOCKET_SELECTOR_H_
 
-#include "socket.hpp"
+#include "tcp_listener.hpp"
 
 #include <array>
 
@@ -39,6 +39,13 @@ namespace cbdc::network {
         /// \return true if there was space in the selector to add the socket
         auto add(const socket& sock) -> bool;
 
+        /// Adds a listener to the selector, including its Unix domain
+        /// socket if it has one.
+        /// \param listener the listener to add to the selector
+        /// \return true if there was space in the selector to add the
+        ///         listener
+        auto add(const tcp_listener& listener) -> bool;
+
         /// Blocks until at least one socket in the selector is ready
         /// to perform a read operation.
         /// \return true if there is a ready socket
@@ -5,6 +5,9 @@
 
 #include "tcp_listener.hpp"
 
+#include <array>
+#include <iostream>
+#include <poll.h>
 #include <unistd.h>
 
 namespace cbdc::network {
@@ -42,17 +45,92 @@ namespace cbdc::network {
             break;
         }
 
-        return m_sock_fd != -1;
+        if(m_sock_fd == -1) {
+            return false;
+        }
+
+        // Another process holding the name would receive this endpoint's
+        // same-host connections, so the listener fails rather than falling
+        // back to TCP alone
+        if(local_transport_enabled()
+           && !listen_local(local_address, local_port)) {
+            std::cerr << "[ERROR] Failed to listen on the Unix domain socket "
+                      << "for " << local_address << ":" << local_port
+                      << std::endl;
+            ::close(m_sock_fd);
+            m_sock_fd = -1;
+            return false;
+        }
+
+        return true;
+    }
+
+    auto tcp_listener::listen_local(const ip_address& local_address,
+                                    port_number_t local_port) -> bool {
+        auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd == -1) {
+            return false;
+        }
+        const auto [addr, addr_len]
+            = get_local_addr(local_address, local_port);
+        static constexpr auto max_listen_queue = 5;
+        if(bind(fd, reinterpret_cast<const sockaddr*>(&addr), addr_len) != 0
+           || ::listen(fd, max_listen_queue) != 0) {
+            ::close(fd);
+            return false;
+        }
+        m_local_fd = fd;
+        return true;
     }
 
     auto tcp_listener::accept(tcp_socket& sock) -> bool {
-        sockaddr cli_addr{};
-        unsigned int cli_len = sizeof(cli_addr);
-        sock.m_sock_fd = ::accept(m_sock_fd, &cli_addr, &cli_len);
-        return sock.m_sock_fd != -1;
+        while(true) {
+            auto fd = m_sock_fd;
+            const auto local_fd = m_local_fd.load();
+            if(local_fd != -1) {
+                // Waits for either listener, preferring same-host
+                // connections
+                std::array<pollfd, 2> fds{};
+                fds[0].fd = local_fd;
+                fds[0].events = POLLIN;
+                fds[1].fd = fd;
+                fds[1].events = POLLIN;
+                if(poll(fds.data(), fds.size(), -1) <= 0) {
+                    return false;
+                }
+                if((fds[0].revents & POLLIN) == 0) {
+                    if((fds[1].revents & POLLIN) == 0) {
+                        return false;
+                    }
+                } else {
+                    fd = local_fd;
+                }
+            }
+            sockaddr_storage cli_addr{};
+            socklen_t cli_len = sizeof(cli_addr);
+            sock.m_sock_fd = ::accept(fd,
+                                      reinterpret_cast<sockaddr*>(&cli_addr),
+                                      &cli_len);
+            if(sock.m_sock_fd == -1) {
+                return false;
+            }
+            sock.m_local = fd == local_fd;
+            if(!sock.m_local || is_same_user_peer(sock.m_sock_fd)) {
+                return true;
+            }
+            std::cerr << "[WARN] Rejected a Unix domain socket connection "
+                      << "from another user" << std::endl;
+            ::close(sock.m_sock_fd);
+            sock.m_sock_fd = -1;
+        }
     }
 
     void tcp_listener::close() {
+        const auto local_fd = m_local_fd.exchange(-1);
+        if(local_fd != -1) {
+            shutdown(local_fd, SHUT_RDWR);
+            ::close(local_fd);
+        }
         if(m_sock_fd != -1) {
             shutdown(m_sock_fd, SHUT_RDWR);
             ::close(m_sock_fd);
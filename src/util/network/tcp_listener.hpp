@@ -8,8 +8,15 @@
 
 #include "tcp_socket.hpp"
 
+#include <atomic>
+
 namespace cbdc::network {
-    /// Listens for incoming TCP connections on a given endpoint.
+    /// \brief Listens for incoming TCP connections on a given endpoint.
+    ///
+    /// When enabled with \ref set_local_transport, also listens on a Unix
+    /// domain socket named after the endpoint, which \ref tcp_socket uses
+    /// instead of TCP when connecting from the same host. Connections on
+    /// that socket from processes of other users are rejected.
     class tcp_listener : public socket {
       public:
         /// Constructs a new tcp_listener.
@@ -22,15 +29,18 @@ namespace cbdc::network {
         tcp_listener(tcp_listener&&) = delete;
         auto operator=(tcp_listener&&) -> tcp_listener& = delete;
 
-        /// Starts the listener on the given local port and address.
+        /// Starts the listener on the given local port and address. Failing
+        /// to listen on the Unix domain socket, for example because another
+        /// process on the host already uses its name, is an error, as that
+        /// process would receive this endpoint's same-host connections.
         /// \param local_address the address of the interface to listen on
         /// \param local_port the port number to listen on
         /// \return true if the listener started listening successfully.
         auto listen(const ip_address& local_address, port_number_t local_port)
             -> bool;
 
-        /// Blocks until an incoming connection is ready and
-        /// populates the given socket.
+        /// Blocks until an incoming connection is ready on either socket
+        /// and populates the given socket.
         /// \param sock the socket to attach to the incoming connection
         /// \return true if the listener successfully accepted a connection.
         auto accept(tcp_socket& sock) -> bool;
@@ -38,6 +48,16 @@ namespace cbdc::network {
         /// Stops the listener and unblocks any blocking calls associated
         /// with this listener.
         void close();
+
+      private:
+        /// Listening Unix domain socket, or -1. Atomic as \ref close may
+        /// run while \ref accept polls it.
+        std::atomic<int> m_local_fd{-1};
+
+        auto listen_local(const ip_address& local_address,
+                          port_number_t local_port) -> bool;
+
+        friend class socket_selector;
     };
 }
 
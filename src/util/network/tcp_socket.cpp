@@ -5,6 +5,7 @@
 
 #include "tcp_socket.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <unistd.h>
@@ -18,6 +19,13 @@ namespace cbdc::network {
                              port_number_t remote_port) -> bool {
         m_addr = remote_address;
         m_port = remote_port;
+        m_local = local_transport_enabled()
+               && connect_local(remote_address, remote_port);
+        if(m_local) {
+            m_connected = true;
+            return true;
+        }
+
         auto res0 = get_addrinfo(remote_address, remote_port);
         if(!res0) {
             return false;
@@ -44,6 +52,40 @@ namespace cbdc::network {
         return m_connected;
     }
 
+    auto tcp_socket::connect_local(const ip_address& remote_address,
+                                   port_number_t remote_port) -> bool {
+        // A listener bound to a wildcard address is named after it rather
+        // than the address clients connect to, so those names are tried
+        // too, but only if the address belongs to this host.
+        static const auto wildcards
+            = std::array<ip_address, 2>{"0.0.0.0", "::"};
+        auto try_connect = [&](const ip_address& name) {
+            const auto [addr, addr_len] = get_local_addr(name, remote_port);
+            m_sock_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if(m_sock_fd == -1) {
+                return false;
+            }
+            // A listener run by another user may have taken the name
+            if(::connect(m_sock_fd,
+                         reinterpret_cast<const sockaddr*>(&addr),
+                         addr_len)
+                   != 0
+               || !is_same_user_peer(m_sock_fd)) {
+                ::close(m_sock_fd);
+                m_sock_fd = -1;
+                return false;
+            }
+            return true;
+        };
+        if(try_connect(remote_address)) {
+            return true;
+        }
+        if(!is_local_address(remote_address)) {
+            return false;
+        }
+        return std::any_of(wildcards.begin(), wildcards.end(), try_connect);
+    }
+
     void tcp_socket::disconnect() {
         if(m_sock_fd != -1) {
             m_connected = false;
@@ -58,32 +100,62 @@ namespace cbdc::network {
     }
 
     auto tcp_socket::send(const buffer& pkt) const -> bool {
-        const auto sz_val = static_cast<uint64_t>(pkt.size());
-        std::array<std::byte, sizeof(sz_val)> sz_arr{};
-        std::memcpy(sz_arr.data(), &sz_val, sizeof(sz_val));
-        size_t total_written = 0;
-        while(total_written != sizeof(sz_val)) {
-            auto n = write(m_sock_fd,
-                           &sz_arr.at(total_written),
-                           sizeof(sz_val) - total_written);
-            if(n <= 0) {
-                return false;
+        auto sz_val = static_cast<uint64_t>(pkt.size());
+        std::array<iovec, 2> iov{};
+        iov[0].iov_base = &sz_val;
+        iov[0].iov_len = sizeof(sz_val);
+        iov[1].iov_base = const_cast<void*>(pkt.data()); // NOLINT
+        iov[1].iov_len = pkt.size();
+        return write_all(iov.data(), iov.size());
+    }
+
+    auto tcp_socket::send(const std::vector<std::shared_ptr<buffer>>& pkts)
+        const -> bool {
+        std::array<uint64_t, max_gather_packets> sizes{};
+        std::array<iovec, max_gather_packets * 2> iov{};
+        size_t n_pkts{0};
+        for(const auto& pkt : pkts) {
+            if(!pkt) {
+                continue;
+            }
+            sizes[n_pkts] = static_cast<uint64_t>(pkt->size());
+            auto& hdr = iov[n_pkts * 2];
+            hdr.iov_base = &sizes[n_pkts];
+            hdr.iov_len = sizeof(sizes[n_pkts]);
+            auto& body = iov[n_pkts * 2 + 1];
+            body.iov_base = const_cast<void*>(pkt->data()); // NOLINT
+            body.iov_len = pkt->size();
+            n_pkts++;
+            if(n_pkts == max_gather_packets) {
+                if(!write_all(iov.data(), n_pkts * 2)) {
+                    return false;
+                }
+                n_pkts = 0;
             }
-            total_written += static_cast<size_t>(n);
         }
+        return n_pkts == 0 || write_all(iov.data(), n_pkts * 2);
+    }
 
-        total_written = 0;
-        while(total_written
-              != static_cast<decltype(total_written)>(pkt.size())) {
-            auto n = write(m_sock_fd,
-                           pkt.data_at(total_written),
-                           pkt.size() - total_written);
+    auto tcp_socket::write_all(iovec* iov, size_t count) const -> bool {
+        while(count > 0) {
+            auto n = writev(m_sock_fd, iov, static_cast<int>(count));
             if(n <= 0) {
                 return false;
             }
-            total_written += static_cast<size_t>(n);
+            // Skip the fully written entries and advance into a partially
+            // written one
+            auto written = static_cast<size_t>(n);
+            while(count > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                iov++;
+                count--;
+            }
+            if(count > 0) {
+                auto* base = static_cast<std::byte*>(iov->iov_base);
+                iov->iov_base = base + written;
+                iov->iov_len -= written;
+            }
         }
-
         return true;
     }
 
@@ -102,19 +174,20 @@ namespace cbdc::network {
         }
         std::memcpy(&pkt_sz, sz_buf.data(), sizeof(pkt_sz));
 
+        // Read straight into the packet so a recycled buffer's storage is
+        // reused
         pkt.clear();
+        pkt.extend(pkt_sz);
 
         total_read = 0;
-        auto buf = std::vector<std::byte>(pkt_sz);
         while(total_read < pkt_sz) {
             const auto buf_sz = pkt_sz - total_read;
-            auto n = read(m_sock_fd, buf.data(), buf_sz);
+            auto n = read(m_sock_fd, pkt.data_at(total_read), buf_sz);
             if(n <= 0) {
                 return false;
             }
 
             total_read += static_cast<uint64_t>(n);
-            pkt.append(buf.data(), static_cast<size_t>(n));
         }
 
         return true;
@@ -131,4 +204,8 @@ namespace cbdc::network {
     auto tcp_socket::connected() const -> bool {
         return m_connected;
     }
+
+    auto tcp_socket::is_local() const -> bool {
+        return m_local;
+    }
 }
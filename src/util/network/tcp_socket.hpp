@@ -12,6 +12,9 @@
 #include "util/serialization/util.hpp"
 
 #include <atomic>
+#include <memory>
+#include <sys/uio.h>
+#include <vector>
 
 namespace cbdc::network {
     /// \brief Wrapper for a TCP socket.
@@ -39,7 +42,9 @@ namespace cbdc::network {
         auto connect(const endpoint_t& ep) -> bool;
 
         /// Attempts to connect to the given remote address/port
-        /// combination.
+        /// combination. Connects through the listener's Unix domain socket
+        /// if the endpoint is on the same host, avoiding the loopback TCP
+        /// stack, and over TCP otherwise.
         /// \param remote_address the IP address of the remote endpoint
         /// \param remote_port the port number of the remote endpoint
         /// \return true if the socket connected to the endpoint successfully.
@@ -51,6 +56,14 @@ namespace cbdc::network {
         /// \return true if the packet was sent successfully.
         [[nodiscard]] auto send(const buffer& pkt) const -> bool;
 
+        /// Sends the given packets to the remote host in order, each as a
+        /// discrete packet. Gathers the size prefixes and packet data into
+        /// as few writes as possible.
+        /// \param pkts packets to send. Null pointers are skipped.
+        /// \return true if every packet was sent successfully.
+        [[nodiscard]] auto
+        send(const std::vector<std::shared_ptr<buffer>>& pkts) const -> bool;
+
         /// Serialize the data and transmit it in a packet to the remote host.
         /// \param data data to serialize and send.
         /// \return true if the packet was sent successfully.
@@ -84,10 +97,27 @@ namespace cbdc::network {
         ///         disconnect() call.
         [[nodiscard]] auto connected() const -> bool;
 
+        /// Returns whether the connection uses a same-host Unix domain
+        /// socket rather than TCP.
+        /// \return true if the connection is local.
+        [[nodiscard]] auto is_local() const -> bool;
+
       private:
+        /// Number of packets gathered into a single write.
+        static constexpr size_t max_gather_packets = 32;
+
+        [[nodiscard]] auto write_all(iovec* iov, size_t count) const
+            -> bool;
+
+        auto connect_local(const ip_address& remote_address,
+                           port_number_t remote_port) -> bool;
+
         std::optional<ip_address> m_addr{};
         port_number_t m_port{};
         std::atomic_bool m_connected{false};
+        bool m_local{false};
+
+        friend class tcp_listener;
     };
 }
 
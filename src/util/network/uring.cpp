@@ -0,0 +1,240 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uring.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cbdc::network {
+    namespace {
+        /// Number of submission queue entries.
+        constexpr unsigned sq_entries = 256;
+        /// Number of completion queue entries. Multishot receives can
+        /// complete many times per submission.
+        constexpr unsigned cq_entries = 4096;
+
+        auto sys_setup(unsigned entries, io_uring_params* p) -> int {
+            return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+        }
+
+        auto sys_enter(int fd,
+                       unsigned to_submit,
+                       unsigned min_complete,
+                       unsigned flags) -> int {
+            return static_cast<int>(syscall(__NR_io_uring_enter,
+                                            fd,
+                                            to_submit,
+                                            min_complete,
+                                            flags,
+                                            nullptr,
+                                            0));
+        }
+
+        auto sys_register(int fd, unsigned op, void* arg, unsigned n)
+            -> int {
+            return static_cast<int>(
+                syscall(__NR_io_uring_register, fd, op, arg, n));
+        }
+
+        template<typename T>
+        auto at(void* base, size_t offset) -> T* {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            return reinterpret_cast<T*>(static_cast<std::byte*>(base)
+                                        + offset);
+        }
+    }
+
+    uring::~uring() {
+        if(m_fd != -1) {
+            close(m_fd);
+        }
+        if(m_bufs != nullptr) {
+            munmap(m_bufs, m_bufs_size);
+        }
+        if(m_sqes != nullptr) {
+            munmap(m_sqes, m_sqes_size);
+        }
+        if(m_ring != nullptr) {
+            munmap(m_ring, m_ring_size);
+        }
+    }
+
+    auto uring::init() -> bool {
+        auto params = io_uring_params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+        params.cq_entries = cq_entries;
+        m_fd = sys_setup(sq_entries, &params);
+        if(m_fd == -1 && errno == EINVAL) {
+            // Cooperative task running needs a newer kernel than the
+            // features below, so retry without it.
+            params = io_uring_params{};
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = cq_entries;
+            m_fd = sys_setup(sq_entries, &params);
+        }
+        if(m_fd == -1 || (params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+            return false;
+        }
+
+        m_ring_size = std::max<size_t>(
+            params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        auto* ring = mmap(nullptr,
+                          m_ring_size,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE,
+                          m_fd,
+                          IORING_OFF_SQ_RING);
+        if(ring == MAP_FAILED) {
+            return false;
+        }
+        m_ring = ring;
+
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        auto* sqes = mmap(nullptr,
+                          m_sqes_size,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE,
+                          m_fd,
+                          IORING_OFF_SQES);
+        if(sqes == MAP_FAILED) {
+            return false;
+        }
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        m_sq_head = at<uint32_t>(m_ring, params.sq_off.head);
+        m_sq_tail = at<uint32_t>(m_ring, params.sq_off.tail);
+        m_sq_array = at<uint32_t>(m_ring, params.sq_off.array);
+        m_sq_mask = *at<uint32_t>(m_ring, params.sq_off.ring_mask);
+        m_sq_entries = params.sq_entries;
+        m_sq_local_tail = *m_sq_tail;
+
+        m_cq_head = at<uint32_t>(m_ring, params.cq_off.head);
+        m_cq_tail = at<uint32_t>(m_ring, params.cq_off.tail);
+        m_cqes = at<io_uring_cqe>(m_ring, params.cq_off.cqes);
+        m_cq_mask = *at<uint32_t>(m_ring, params.cq_off.ring_mask);
+
+        return supports_multishot_recv() && register_buffers();
+    }
+
+    auto uring::get_sqe() -> io_uring_sqe* {
+        // The kernel consumes every submitted entry before
+        // io_uring_enter returns, so submitting makes room.
+        while(m_sq_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE)
+              >= m_sq_entries) {
+            if(submit(0) < 0 && errno != EINTR && errno != EAGAIN
+               && errno != EBUSY) {
+                break;
+            }
+        }
+        const auto idx = m_sq_local_tail & m_sq_mask;
+        auto* sqe = &m_sqes[idx];
+        *sqe = io_uring_sqe{};
+        m_sq_array[idx] = idx;
+        m_sq_local_tail++;
+        m_to_submit++;
+        return sqe;
+    }
+
+    auto uring::submit_and_wait(std::vector<io_uring_cqe>& out) -> bool {
+        if(submit(1) < 0 && errno != EINTR && errno != EAGAIN
+           && errno != EBUSY) {
+            return false;
+        }
+        reap(out);
+        return true;
+    }
+
+    auto uring::recv_buffer(uint16_t bid) -> const std::byte* {
+        return &m_buf_storage[bid * recv_buffer_size];
+    }
+
+    void uring::recycle(uint16_t bid) {
+        add_buffer(bid);
+        // The ring tail overlays the reserved field of the first entry
+        __atomic_store_n(&m_bufs[0].resv, m_bufs_tail, __ATOMIC_RELEASE);
+    }
+
+    auto uring::supports_multishot_recv() const -> bool {
+        // Multishot receive arrived in the same kernel release as
+        // zero-copy send, which, unlike the receive flag, can be probed.
+        static constexpr size_t probe_ops = 256;
+        auto storage = std::vector<std::byte>(
+            sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+        auto* probe = at<io_uring_probe>(storage.data(), 0);
+        auto* ops = at<io_uring_probe_op>(storage.data(),
+                                          sizeof(io_uring_probe));
+        if(sys_register(m_fd, IORING_REGISTER_PROBE, probe, probe_ops) != 0) {
+            return false;
+        }
+        return probe->last_op >= IORING_OP_SEND_ZC
+            && (ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    auto uring::register_buffers() -> bool {
+        static_assert((recv_buffer_count & (recv_buffer_count - 1)) == 0,
+                      "buffer ring size must be a power of two");
+        m_bufs_size = recv_buffer_count * sizeof(io_uring_buf);
+        auto* bufs = mmap(nullptr,
+                          m_bufs_size,
+                          PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1,
+                          0);
+        if(bufs == MAP_FAILED) {
+            return false;
+        }
+        m_bufs = static_cast<io_uring_buf*>(bufs);
+        m_buf_storage.resize(recv_buffer_count * recv_buffer_size);
+
+        auto reg = io_uring_buf_reg{};
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        reg.ring_addr = reinterpret_cast<uint64_t>(m_bufs);
+        reg.ring_entries = recv_buffer_count;
+        reg.bgid = buffer_group;
+        if(sys_register(m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            return false;
+        }
+
+        for(uint16_t bid = 0; bid < recv_buffer_count; bid++) {
+            add_buffer(bid);
+        }
+        __atomic_store_n(&m_bufs[0].resv, m_bufs_tail, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    auto uring::submit(unsigned min_complete) -> int {
+        __atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+        const auto flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0U;
+        auto ret = sys_enter(m_fd, m_to_submit, min_complete, flags);
+        if(ret > 0) {
+            m_to_submit -= static_cast<uint32_t>(ret);
+        }
+        return ret;
+    }
+
+    void uring::reap(std::vector<io_uring_cqe>& out) {
+        auto head = __atomic_load_n(m_cq_head, __ATOMIC_RELAXED);
+        const auto tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; head++) {
+            out.push_back(m_cqes[head & m_cq_mask]);
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    void uring::add_buffer(uint16_t bid) {
+        auto& buf = m_bufs[m_bufs_tail & (recv_buffer_count - 1)];
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        buf.addr = reinterpret_cast<uint64_t>(
+            &m_buf_storage[bid * recv_buffer_size]);
+        buf.len = static_cast<uint32_t>(recv_buffer_size);
+        buf.bid = bid;
+        m_bufs_tail++;
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_NETWORK_URING_H_
+#define OPENCBDC_TX_SRC_NETWORK_URING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <vector>
+
+namespace cbdc::network {
+    /// \brief Minimal io_uring instance.
+    ///
+    /// Wraps the submission and completion queues of an io_uring created
+    /// with the raw system calls, along with a ring of kernel-provided
+    /// receive buffers. Multishot receives pick buffers from the ring
+    /// themselves, so a single wait returns data from any number of
+    /// sockets. Not thread-safe; used by one I/O thread.
+    class uring {
+      public:
+        /// Buffer group ID of the provided receive buffers.
+        static constexpr uint16_t buffer_group = 0;
+        /// Number of provided receive buffers.
+        static constexpr uint16_t recv_buffer_count = 128;
+        /// Size in bytes of each provided receive buffer.
+        static constexpr size_t recv_buffer_size = 32 * 1024;
+
+        uring() = default;
+
+        /// Unmaps the queues and closes the io_uring. Pending operations
+        /// are cancelled by the kernel.
+        ~uring();
+
+        uring(const uring&) = delete;
+        auto operator=(const uring&) -> uring& = delete;
+        uring(uring&&) = delete;
+        auto operator=(uring&&) -> uring& = delete;
+
+        /// Creates the io_uring and registers the receive buffers.
+        /// \return false if the kernel lacks io_uring, or the multishot
+        ///         receive and provided buffer ring support it needs.
+        [[nodiscard]] auto init() -> bool;
+
+        /// Returns a zeroed submission queue entry to fill in. Entries are
+        /// submitted by the next call to \ref submit_and_wait.
+        /// \return submission queue entry.
+        [[nodiscard]] auto get_sqe() -> io_uring_sqe*;
+
+        /// Submits pending entries and waits for at least one completion.
+        /// \param out vector to which to append the available completions.
+        /// \return false if waiting failed for a reason other than a
+        ///         signal.
+        [[nodiscard]] auto submit_and_wait(std::vector<io_uring_cqe>& out)
+            -> bool;
+
+        /// Returns the contents of a provided receive buffer.
+        /// \param bid buffer ID from a receive completion.
+        /// \return pointer to the start of the buffer.
+        [[nodiscard]] auto recv_buffer(uint16_t bid) -> const std::byte*;
+
+        /// Returns a provided receive buffer to the kernel.
+        /// \param bid buffer ID from a receive completion.
+        void recycle(uint16_t bid);
+
+      private:
+        int m_fd{-1};
+
+        void* m_ring{nullptr};
+        size_t m_ring_size{0};
+        io_uring_sqe* m_sqes{nullptr};
+        size_t m_sqes_size{0};
+
+        uint32_t* m_sq_head{nullptr};
+        uint32_t* m_sq_tail{nullptr};
+        uint32_t* m_sq_array{nullptr};
+        uint32_t m_sq_mask{0};
+        uint32_t m_sq_entries{0};
+        uint32_t m_sq_local_tail{0};
+        uint32_t m_to_submit{0};
+
+        uint32_t* m_cq_head{nullptr};
+        uint32_t* m_cq_tail{nullptr};
+        io_uring_cqe* m_cqes{nullptr};
+        uint32_t m_cq_mask{0};
+
+        io_uring_buf* m_bufs{nullptr};
+        size_t m_bufs_size{0};
+        uint16_t m_bufs_tail{0};
+        std::vector<std::byte> m_buf_storage;
+
+        [[nodiscard]] auto supports_multishot_recv() const -> bool;
+        [[nodiscard]] auto register_buffers() -> bool;
+        [[nodiscard]] auto submit(unsigned min_complete) -> int;
+        void reap(std::vector<io_uring_cqe>& out);
+        void add_buffer(uint16_t bid);
+    };
+}
+
+#endif
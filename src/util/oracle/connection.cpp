@@ -0,0 +1,254 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "connection.hpp"
+
+#include <algorithm>
+
+namespace cbdc::oracle {
+    statement::statement(OracleDB* db, OCIStmt* stmt, std::string sql)
+        : m_db(db),
+          m_stmt(stmt),
+          m_sql(std::move(sql)) {}
+
+    statement::~statement() {
+        release();
+    }
+
+    statement::statement(statement&& other) noexcept
+        : m_db(other.m_db),
+          m_stmt(other.m_stmt),
+          m_sql(std::move(other.m_sql)),
+          m_failed(other.m_failed) {
+        other.m_stmt = nullptr;
+    }
+
+    auto statement::operator=(statement&& other) noexcept -> statement& {
+        if(this != &other) {
+            release();
+            m_db = other.m_db;
+            m_stmt = other.m_stmt;
+            m_sql = std::move(other.m_sql);
+            m_failed = other.m_failed;
+            other.m_stmt = nullptr;
+        }
+        return *this;
+    }
+
+    auto statement::bind_raw(size_t pos, hash_t* values) -> bool {
+        static_assert(sizeof(hash_t) == hash_size);
+        if(OracleDB_stmt_bind_array(m_db,
+                                    m_stmt,
+                                    static_cast<int>(pos),
+                                    values,
+                                    static_cast<int>(hash_size),
+                                    SQLT_BIN)
+           != 0) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    auto statement::bind_blob(size_t pos,
+                              unsigned char* values,
+                              size_t width,
+                              uint32_t* lens) -> bool {
+        static_assert(sizeof(uint32_t) == sizeof(ub4));
+        if(OracleDB_stmt_bind_lob_array(m_db,
+                                        m_stmt,
+                                        static_cast<int>(pos),
+                                        values,
+                                        width,
+                                        lens)
+           != 0) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    auto statement::execute(size_t rows) -> bool {
+        if(OracleDB_stmt_execute(m_db, m_stmt, static_cast<int>(rows)) != 0) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    auto statement::define_raw(size_t pos, hash_t* values) -> bool {
+        if(OracleDB_stmt_define_array(m_db,
+                                      m_stmt,
+                                      static_cast<int>(pos),
+                                      values,
+                                      static_cast<int>(hash_size),
+                                      SQLT_BIN)
+           != 0) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    auto statement::query() -> bool {
+        if(OracleDB_stmt_query(m_db, m_stmt) != 0) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    auto statement::fetch(size_t max_rows) -> std::optional<size_t> {
+        int fetched{0};
+        if(OracleDB_stmt_fetch(m_db,
+                               m_stmt,
+                               static_cast<int>(max_rows),
+                               &fetched)
+           != 0) {
+            m_failed = true;
+            return std::nullopt;
+        }
+        return static_cast<size_t>(fetched);
+    }
+
+    void statement::release() {
+        if(m_stmt != nullptr) {
+            OracleDB_stmt_release(m_db,
+                                  m_stmt,
+                                  m_sql.c_str(),
+                                  m_failed ? 1 : 0);
+            m_stmt = nullptr;
+        }
+    }
+
+    batch::batch(statement stmt, size_t width, size_t capacity)
+        : m_stmt(std::move(stmt)),
+          m_width(width),
+          m_capacity(capacity),
+          m_columns(width * capacity) {}
+
+    auto batch::bind() -> bool {
+        for(size_t col{0}; col < m_width; col++) {
+            if(!m_stmt.bind_raw(col + 1, &m_columns[col * m_capacity])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto batch::add(const hash_t* record) -> bool {
+        if(m_size == m_capacity) {
+            return false;
+        }
+        for(size_t col{0}; col < m_width; col++) {
+            m_columns[col * m_capacity + m_size] = record[col];
+        }
+        m_size++;
+        return true;
+    }
+
+    auto batch::execute() -> bool {
+        if(m_size == 0) {
+            return true;
+        }
+        const auto rows = m_size;
+        m_size = 0;
+        if(!m_stmt.execute(rows)) {
+            OracleDB_rollback(m_stmt.m_db);
+            return false;
+        }
+        return OracleDB_commit(m_stmt.m_db) == 0;
+    }
+
+    void batch::clear() {
+        m_size = 0;
+    }
+
+    auto batch::size() const -> size_t {
+        return m_size;
+    }
+
+    auto batch::capacity() const -> size_t {
+        return m_capacity;
+    }
+
+    connection::connection(std::unique_ptr<OracleDB> session)
+        : m_session(std::move(session)) {}
+
+    connection::~connection() {
+        release();
+    }
+
+    connection::connection(connection&& other) noexcept = default;
+
+    auto connection::operator=(connection&& other) noexcept -> connection& {
+        if(this != &other) {
+            release();
+            m_session = std::move(other.m_session);
+        }
+        return *this;
+    }
+
+    auto connection::prepare(const std::string& sql)
+        -> std::optional<statement> {
+        OCIStmt* stmt{};
+        if(OracleDB_stmt_prepare(m_session.get(), sql.c_str(), &stmt) != 0) {
+            return std::nullopt;
+        }
+        return statement(m_session.get(), stmt, sql);
+    }
+
+    auto connection::prepare_batch(const std::string& sql,
+                                   size_t width,
+                                   size_t capacity) -> std::optional<batch> {
+        auto stmt = prepare(sql);
+        if(!stmt.has_value()) {
+            return std::nullopt;
+        }
+        auto ret = batch(std::move(stmt.value()),
+                         width,
+                         std::max<size_t>(capacity, 1));
+        // Moving the batch keeps its buffers in place, so the binding
+        // survives the return.
+        if(!ret.bind()) {
+            return std::nullopt;
+        }
+        return ret;
+    }
+
+    auto connection::commit() -> bool {
+        return OracleDB_commit(m_session.get()) == 0;
+    }
+
+    void connection::rollback() {
+        OracleDB_rollback(m_session.get());
+    }
+
+    auto connection::lost() const -> bool {
+        return !m_session || OracleDB_connection_lost(m_session.get()) != 0;
+    }
+
+    void connection::discard() {
+        if(m_session) {
+            OracleDB_pool_drop(m_session.get());
+            m_session.reset();
+        }
+    }
+
+    auto connection::stats() const -> const OracleDBStats& {
+        return m_session->stats;
+    }
+
+    void connection::reset_stats() {
+        OracleDB_stats_reset(m_session.get());
+    }
+
+    void connection::release() {
+        if(m_session) {
+            OracleDB_pool_release(m_session.get());
+            m_session.reset();
+        }
+    }
+}
@@ -0,0 +1,213 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_CONNECTION_H_
+#define OPENCBDC_TX_SRC_ORACLE_CONNECTION_H_
+
+#include "oracleDB.h"
+#include "util/common/hash.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::oracle {
+    class batch;
+    class direct_path_loader;
+    class session_pool;
+
+    /// \brief Prepared statement borrowed from a session's statement cache.
+    ///
+    /// Returns the statement to the cache on destruction, evicting it if
+    /// any call on it failed. Move-only. Must not outlive the
+    /// \ref connection that prepared it.
+    class statement {
+      public:
+        ~statement();
+
+        statement(const statement&) = delete;
+        auto operator=(const statement&) -> statement& = delete;
+        statement(statement&& other) noexcept;
+        auto operator=(statement&& other) noexcept -> statement&;
+
+        /// Binds an array of hashes as RAW values to a positional bind
+        /// variable. The binding refers to the array itself, so each
+        /// \ref execute sends the values it holds at that time.
+        /// \param pos 1-based position of the bind variable.
+        /// \param values array of at least as many hashes as the number of
+        ///               rows later executed. Must outlive the statement.
+        /// \return true if the array was bound.
+        auto bind_raw(size_t pos, hash_t* values) -> bool;
+
+        /// Binds an array of variable-length binary values to a positional
+        /// BLOB bind variable. Row i is the first lens[i] bytes of the
+        /// width bytes starting at values + i * width. Like \ref bind_raw,
+        /// the binding refers to the arrays themselves.
+        /// \param pos 1-based position of the bind variable.
+        /// \param values array of width bytes per row. Must outlive the
+        ///               statement or the next binding of pos.
+        /// \param width bytes reserved for each row.
+        /// \param lens length of each row's value. Must outlive the
+        ///             statement or the next binding of pos.
+        /// \return true if the array was bound.
+        auto bind_blob(size_t pos,
+                       unsigned char* values,
+                       size_t width,
+                       uint32_t* lens) -> bool;
+
+        /// Executes the statement once for each of the first rows bound
+        /// values, in one round trip, without committing.
+        /// \param rows number of bound rows to send.
+        /// \return true if every row was executed.
+        auto execute(size_t rows) -> bool;
+
+        /// Defines an array of hashes as the output buffers for a RAW
+        /// select-list column of a query.
+        /// \param pos 1-based position of the column in the select list.
+        /// \param values array of as many hashes as the most rows passed to
+        ///               \ref fetch. Must outlive the statement.
+        /// \return true if the array was defined.
+        auto define_raw(size_t pos, hash_t* values) -> bool;
+
+        /// Executes the statement as a query, leaving its result set open
+        /// for \ref fetch.
+        /// \return true if the query was executed.
+        auto query() -> bool;
+
+        /// Fetches the next rows of the result set into the defined
+        /// buffers, starting at the first element of each.
+        /// \param max_rows maximum number of rows to fetch.
+        /// \return number of rows fetched, 0 once the result set is
+        ///         exhausted, or std::nullopt on failure.
+        auto fetch(size_t max_rows) -> std::optional<size_t>;
+
+      private:
+        friend class batch;
+        friend class connection;
+        statement(OracleDB* db, OCIStmt* stmt, std::string sql);
+        void release();
+
+        OracleDB* m_db{};
+        OCIStmt* m_stmt{};
+        std::string m_sql;
+        bool m_failed{false};
+    };
+
+    /// \brief Reusable array insert of fixed-width hash records.
+    ///
+    /// Owns one column-wise bind buffer per column, bound to the statement
+    /// once when the batch is created. Adding a record copies its hashes
+    /// into the buffers, and \ref execute sends every added record in one
+    /// round trip and commits them together. No memory is allocated after
+    /// construction. Move-only. Must not outlive the \ref connection that
+    /// created it.
+    class batch {
+      public:
+        batch(const batch&) = delete;
+        auto operator=(const batch&) -> batch& = delete;
+        batch(batch&&) noexcept = default;
+        auto operator=(batch&&) noexcept -> batch& = default;
+        ~batch() = default;
+
+        /// Adds a record to the batch.
+        /// \param record one hash per column, in bind order.
+        /// \return false if the batch is already full.
+        auto add(const hash_t* record) -> bool;
+
+        /// Inserts and commits the added records, then empties the batch.
+        /// Rolls back if the insert fails.
+        /// \return true if every record was inserted and committed.
+        auto execute() -> bool;
+
+        /// Discards the added records.
+        void clear();
+
+        /// Returns the number of records added since the last execute.
+        /// \return record count.
+        [[nodiscard]] auto size() const -> size_t;
+
+        /// Returns the maximum number of records per execute.
+        /// \return batch capacity.
+        [[nodiscard]] auto capacity() const -> size_t;
+
+      private:
+        friend class connection;
+        batch(statement stmt, size_t width, size_t capacity);
+        auto bind() -> bool;
+
+        statement m_stmt;
+        size_t m_width;
+        size_t m_capacity;
+        size_t m_size{0};
+        /// Column-major bind buffers, m_capacity hashes per column.
+        std::vector<hash_t> m_columns;
+    };
+
+    /// \brief Exclusive handle to one pooled Oracle session.
+    ///
+    /// Returns the session to its pool on destruction. Move-only; the
+    /// underlying session keeps its address across moves, so statements
+    /// and batches created from a connection stay valid when it moves.
+    class connection {
+      public:
+        ~connection();
+
+        connection(const connection&) = delete;
+        auto operator=(const connection&) -> connection& = delete;
+        connection(connection&& other) noexcept;
+        auto operator=(connection&& other) noexcept -> connection&;
+
+        /// Prepares a statement through the session's statement cache.
+        /// \param sql query to prepare.
+        /// \return prepared statement, or std::nullopt on failure.
+        auto prepare(const std::string& sql) -> std::optional<statement>;
+
+        /// Prepares an array insert with RAW(32) bind variables :1 to
+        /// :width, and binds reusable buffers of capacity rows to it.
+        /// \param sql insert statement with width positional binds.
+        /// \param width number of hashes per record.
+        /// \param capacity maximum number of records per execute.
+        /// \return batch, or std::nullopt on failure.
+        auto prepare_batch(const std::string& sql,
+                           size_t width,
+                           size_t capacity) -> std::optional<batch>;
+
+        /// Commits the session's transaction.
+        /// \return true if the commit succeeded.
+        auto commit() -> bool;
+
+        /// Rolls back the session's transaction.
+        void rollback();
+
+        /// Checks whether the last failed call lost the connection, so the
+        /// session must be replaced.
+        /// \return true if the session is no longer usable.
+        [[nodiscard]] auto lost() const -> bool;
+
+        /// Returns the session to the pool marked as dead, so the pool
+        /// closes it rather than handing it out again. The connection is no
+        /// longer usable afterwards.
+        void discard();
+
+        /// Returns the client-side statistics gathered since the last
+        /// \ref reset_stats.
+        /// \return session statistics.
+        [[nodiscard]] auto stats() const -> const OracleDBStats&;
+
+        /// Resets the client-side statistics.
+        void reset_stats();
+
+      private:
+        friend class direct_path_loader;
+        friend class session_pool;
+        explicit connection(std::unique_ptr<OracleDB> session);
+        void release();
+
+        std::unique_ptr<OracleDB> m_session;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_CONNECTION_H_
@@ -0,0 +1,130 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "direct_path_loader.hpp"
+
+#include <algorithm>
+
+namespace cbdc::oracle {
+    direct_path_loader::direct_path_loader(
+        std::shared_ptr<logging::log> logger,
+        connection& conn,
+        const std::string& table,
+        std::optional<std::string> partition,
+        std::vector<std::string> columns)
+        : m_logger(std::move(logger)),
+          m_conn(conn),
+          m_table(table),
+          m_partition(std::move(partition)),
+          m_columns(std::move(columns)) {
+        // The direct path API takes the schema and table name separately.
+        const auto dot = table.find('.');
+        if(dot != std::string::npos) {
+            m_schema = table.substr(0, dot);
+            m_table = table.substr(dot + 1);
+        }
+    }
+
+    direct_path_loader::~direct_path_loader() {
+        if(m_open) {
+            m_logger->warn("Aborting unfinished direct path load of",
+                           m_table);
+            OracleDB_dirpath_abort(&m_load);
+        }
+    }
+
+    auto direct_path_loader::open() -> bool {
+        auto names = std::vector<const char*>();
+        names.reserve(m_columns.size());
+        for(const auto& col : m_columns) {
+            names.push_back(col.c_str());
+        }
+        auto widths = std::vector<unsigned int>(m_columns.size(),
+                                                static_cast<unsigned int>(
+                                                    hash_size));
+        if(OracleDB_dirpath_begin(
+               m_conn.m_session.get(),
+               &m_load,
+               m_schema.has_value() ? m_schema->c_str() : nullptr,
+               m_table.c_str(),
+               m_partition.has_value() ? m_partition->c_str() : nullptr,
+               names.data(),
+               widths.data(),
+               static_cast<int>(m_columns.size()))
+           != 0) {
+            m_logger->error("Failed to start direct path load of", m_table);
+            return false;
+        }
+        m_open = true;
+        m_buffer.resize(m_load.max_rows * m_columns.size());
+        m_buffer_rows = 0;
+        return true;
+    }
+
+    auto direct_path_loader::append(const hash_t* records, size_t count)
+        -> bool {
+        if(!m_open) {
+            return false;
+        }
+        const auto width = m_columns.size();
+        const auto capacity = m_buffer.size() / width;
+        while(count > 0) {
+            const auto n = std::min(count, capacity - m_buffer_rows);
+            std::copy_n(records,
+                        n * width,
+                        m_buffer.begin()
+                            + static_cast<std::ptrdiff_t>(m_buffer_rows
+                                                          * width));
+            m_buffer_rows += n;
+            records += n * width;
+            count -= n;
+            if(m_buffer_rows == capacity && !load_buffer()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto direct_path_loader::finish() -> bool {
+        if(!m_open) {
+            return false;
+        }
+        if(!load_buffer()) {
+            return false;
+        }
+        // Finishing frees the load's handles whether or not it succeeds.
+        m_open = false;
+        if(OracleDB_dirpath_finish(&m_load) != 0) {
+            m_logger->error("Failed to finish direct path load of", m_table);
+            return false;
+        }
+        return true;
+    }
+
+    auto direct_path_loader::rows() const -> size_t {
+        return m_rows;
+    }
+
+    auto direct_path_loader::load_buffer() -> bool {
+        if(m_buffer_rows == 0) {
+            return true;
+        }
+        // hash_t is a plain byte array, so the buffer is already laid out
+        // as the contiguous row-major input OracleDB_dirpath_load expects.
+        static_assert(sizeof(hash_t) == hash_size);
+        const auto* rows
+            = reinterpret_cast<const unsigned char*>(m_buffer.data());
+        if(OracleDB_dirpath_load(&m_load,
+                                 rows,
+                                 static_cast<int>(m_buffer_rows))
+           != 0) {
+            m_logger->error("Direct path load of", m_table, "failed");
+            return false;
+        }
+        m_rows += m_buffer_rows;
+        m_buffer_rows = 0;
+        return true;
+    }
+}
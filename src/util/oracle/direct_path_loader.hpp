@@ -0,0 +1,96 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_DIRECT_PATH_LOADER_H_
+#define OPENCBDC_TX_SRC_ORACLE_DIRECT_PATH_LOADER_H_
+
+#include "connection.hpp"
+#include "oracleDB.h"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::oracle {
+    /// \brief Bulk loads hash records through the OCI direct path API.
+    ///
+    /// Direct path loading formats data blocks on the client and writes
+    /// them above the table's high water mark, bypassing SQL processing,
+    /// so it is suited to loading large snapshots into empty tables or
+    /// partitions. Records are buffered and sent a column array at a
+    /// time, and become visible only once \ref finish succeeds. A loader
+    /// that is destroyed without finishing aborts the load.
+    ///
+    /// The connection passed to the loader must not be used for anything
+    /// else until the load is finished, and must outlive the loader.
+    class direct_path_loader {
+      public:
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param conn session to load with.
+        /// \param table target table, optionally qualified with its schema
+        ///              as "schema.table".
+        /// \param partition partition to load into, or std::nullopt to load
+        ///                  the whole table.
+        /// \param columns names of the columns receiving each record's
+        ///                hashes, as RAW(32).
+        direct_path_loader(std::shared_ptr<logging::log> logger,
+                           connection& conn,
+                           const std::string& table,
+                           std::optional<std::string> partition,
+                           std::vector<std::string> columns);
+
+        /// Destructor. Aborts the load if it was not finished.
+        ~direct_path_loader();
+
+        direct_path_loader() = delete;
+        direct_path_loader(const direct_path_loader&) = delete;
+        auto operator=(const direct_path_loader&)
+            -> direct_path_loader& = delete;
+        direct_path_loader(direct_path_loader&&) = delete;
+        auto operator=(direct_path_loader&&) -> direct_path_loader& = delete;
+
+        /// Prepares the direct path load.
+        /// \return true if the load was prepared successfully.
+        auto open() -> bool;
+
+        /// Adds records to the load. Loads the buffered records whenever a
+        /// full column array has accumulated.
+        /// \param records row-major array of count records, each holding
+        ///                one hash per column.
+        /// \param count number of records.
+        /// \return true if all records sent so far were loaded.
+        auto append(const hash_t* records, size_t count) -> bool;
+
+        /// Loads any buffered records and saves the load.
+        /// \return true if every record was loaded and saved.
+        auto finish() -> bool;
+
+        /// Returns the number of records loaded so far.
+        /// \return record count.
+        [[nodiscard]] auto rows() const -> size_t;
+
+      private:
+        auto load_buffer() -> bool;
+
+        std::shared_ptr<logging::log> m_logger;
+        connection& m_conn;
+        std::optional<std::string> m_schema;
+        std::string m_table;
+        std::optional<std::string> m_partition;
+        std::vector<std::string> m_columns;
+
+        OracleDBDirPath m_load{};
+        bool m_open{false};
+        std::vector<hash_t> m_buffer;
+        size_t m_buffer_rows{0};
+        size_t m_rows{0};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_DIRECT_PATH_LOADER_H_
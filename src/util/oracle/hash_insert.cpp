@@ -0,0 +1,65 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hash_insert.hpp"
+
+#include <vector>
+
+namespace cbdc::oracle {
+    auto make_insert_query(const std::string& table,
+                           const std::string& column) -> std::string {
+        return make_insert_query(table, std::vector<std::string>{column});
+    }
+
+    auto make_insert_query(const std::string& table,
+                           const std::vector<std::string>& columns)
+        -> std::string {
+        auto names = std::string();
+        auto binds = std::string();
+        for(size_t i{0}; i < columns.size(); i++) {
+            if(i != 0) {
+                names += ", ";
+                binds += ", ";
+            }
+            names += columns[i];
+            binds += ":" + std::to_string(i + 1);
+        }
+        return "INSERT INTO " + table + " (" + names + ") VALUES (" + binds
+             + ")";
+    }
+
+    auto make_partition_insert_query(const std::string& table,
+                                     const std::string& partition,
+                                     const std::vector<std::string>& columns)
+        -> std::string {
+        return make_insert_query(table + " PARTITION (" + partition + ")",
+                                 columns);
+    }
+
+    auto make_scan_query(const std::string& table,
+                         const std::optional<std::string>& partition,
+                         const std::string& column) -> std::string {
+        auto ret = "SELECT " + column + " FROM " + table;
+        if(partition.has_value()) {
+            ret += " PARTITION (" + partition.value() + ")";
+        }
+        return ret;
+    }
+
+    auto make_lookup_query(const std::string& table,
+                           const std::optional<std::string>& partition,
+                           const std::string& column,
+                           size_t keys) -> std::string {
+        auto binds = std::string();
+        for(size_t i{0}; i < keys; i++) {
+            if(i != 0) {
+                binds += ", ";
+            }
+            binds += ":" + std::to_string(i + 1);
+        }
+        return make_scan_query(table, partition, column) + " WHERE "
+             + column + " IN (" + binds + ")";
+    }
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_HASH_INSERT_H_
+#define OPENCBDC_TX_SRC_ORACLE_HASH_INSERT_H_
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::oracle {
+    /// Builds a single-column positional insert statement.
+    /// \param table fully qualified name of the table to insert into.
+    /// \param column name of the column receiving the value.
+    /// \return query of the form "INSERT INTO table (column) VALUES (:1)".
+    auto make_insert_query(const std::string& table,
+                           const std::string& column) -> std::string;
+
+    /// Builds a multi-column positional insert statement.
+    /// \param table fully qualified name of the table to insert into.
+    /// \param columns names of the columns receiving the values, in bind
+    ///                order.
+    /// \return query of the form
+    ///         "INSERT INTO table (a, b) VALUES (:1, :2)".
+    auto make_insert_query(const std::string& table,
+                           const std::vector<std::string>& columns)
+        -> std::string;
+
+    /// Builds a multi-column positional insert statement restricted to one
+    /// partition. Oracle rejects rows that do not belong to the partition,
+    /// and the insert only locks that partition.
+    /// \param table fully qualified name of the table to insert into.
+    /// \param partition name of the partition receiving the rows.
+    /// \param columns names of the columns receiving the values, in bind
+    ///                order.
+    /// \return query of the form
+    ///         "INSERT INTO table PARTITION (p) (a, b) VALUES (:1, :2)".
+    auto make_partition_insert_query(const std::string& table,
+                                     const std::string& partition,
+                                     const std::vector<std::string>& columns)
+        -> std::string;
+
+    /// Builds a query returning which of a fixed number of hashes are
+    /// present in a column.
+    /// \param table fully qualified name of the table to search.
+    /// \param partition name of the partition to search, or std::nullopt
+    ///                  to search the whole table.
+    /// \param column name of the column holding the hashes.
+    /// \param keys number of positional bind variables in the IN list.
+    /// \return query of the form
+    ///         "SELECT c FROM table PARTITION (p) WHERE c IN (:1, :2)".
+    auto make_lookup_query(const std::string& table,
+                           const std::optional<std::string>& partition,
+                           const std::string& column,
+                           size_t keys) -> std::string;
+
+    /// Builds a query returning every hash in a column.
+    /// \param table fully qualified name of the table to read.
+    /// \param partition name of the partition to read, or std::nullopt to
+    ///                  read the whole table.
+    /// \param column name of the column holding the hashes.
+    /// \return query of the form "SELECT c FROM table PARTITION (p)".
+    auto make_scan_query(const std::string& table,
+                         const std::optional<std::string>& partition,
+                         const std::string& column) -> std::string;
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_HASH_INSERT_H_
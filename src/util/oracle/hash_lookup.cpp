@@ -0,0 +1,231 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hash_lookup.hpp"
+
+#include "hash_insert.hpp"
+#include "util/common/hashmap.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace cbdc::oracle {
+    hash_lookup::hash_lookup(std::shared_ptr<logging::log> logger,
+                             std::shared_ptr<session_pool> pool,
+                             std::string table,
+                             const std::string& column,
+                             const std::optional<std::string>& partition,
+                             std::chrono::microseconds window,
+                             size_t max_keys)
+        : m_logger(std::move(logger)),
+          m_pool(std::move(pool)),
+          m_table(std::move(table)),
+          m_window(window),
+          m_max_keys(std::max<size_t>(max_keys, 1)),
+          m_query(make_lookup_query(m_table, partition, column, m_max_keys)),
+          m_scan_query(make_scan_query(m_table, partition, column)),
+          m_keys(m_max_keys),
+          m_rows(m_max_keys) {}
+
+    hash_lookup::~hash_lookup() {
+        stop();
+    }
+
+    void hash_lookup::start() {
+        {
+            std::unique_lock l(m_mut);
+            if(m_running) {
+                return;
+            }
+            m_running = true;
+        }
+        m_thread = std::thread([&]() {
+            worker_loop();
+        });
+    }
+
+    auto hash_lookup::lookup(const hash_t& id)
+        -> std::future<std::optional<bool>> {
+        auto req = request{id, std::promise<std::optional<bool>>()};
+        auto fut = req.m_found.get_future();
+        auto wake = false;
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                req.m_found.set_value(std::nullopt);
+                return fut;
+            }
+            m_pending.emplace_back(std::move(req));
+            // The worker only needs waking to open a batch or to close a
+            // full one early.
+            wake = m_pending.size() == 1 || m_pending.size() >= m_max_keys;
+        }
+        if(wake) {
+            m_cv.notify_one();
+        }
+        return fut;
+    }
+
+    auto hash_lookup::scan(const std::function<void(const hash_t&)>& fn)
+        -> bool {
+        if(!m_pool->init()) {
+            return false;
+        }
+        auto conn = m_pool->acquire();
+        if(!conn.has_value()) {
+            m_logger->error("Failed to connect to Oracle Autonomous Database");
+            return false;
+        }
+        auto stmt = conn->prepare(m_scan_query);
+        static constexpr size_t scan_rows = 4096;
+        auto rows = std::vector<hash_t>(scan_rows);
+        if(!stmt.has_value() || !stmt->define_raw(1, rows.data())
+           || !stmt->query()) {
+            m_logger->error("Failed to query", m_table);
+            return false;
+        }
+        while(true) {
+            auto fetched = stmt->fetch(scan_rows);
+            if(!fetched.has_value()) {
+                m_logger->error("Failed to read", m_table);
+                return false;
+            }
+            for(size_t i{0}; i < fetched.value(); i++) {
+                fn(rows[i]);
+            }
+            if(fetched.value() < scan_rows) {
+                return true;
+            }
+        }
+    }
+
+    void hash_lookup::stop() {
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if(m_thread.joinable()) {
+            m_thread.join();
+        }
+        for(auto& req : m_pending) {
+            req.m_found.set_value(std::nullopt);
+        }
+        m_pending.clear();
+        disconnect();
+    }
+
+    auto hash_lookup::connect() -> bool {
+        if(m_stmt.has_value()) {
+            return true;
+        }
+        if(!m_pool->init()) {
+            return false;
+        }
+        m_conn = m_pool->acquire();
+        if(!m_conn.has_value()) {
+            m_logger->error("Failed to connect to Oracle Autonomous Database");
+            return false;
+        }
+        auto stmt = m_conn->prepare(m_query);
+        if(!stmt.has_value()) {
+            m_logger->error("Failed to prepare lookup in", m_table);
+            disconnect();
+            return false;
+        }
+        // The bind and define buffers stay in place for the life of the
+        // statement, so each batch only rewrites their contents.
+        for(size_t i{0}; i < m_max_keys; i++) {
+            if(!stmt->bind_raw(i + 1, &m_keys[i])) {
+                disconnect();
+                return false;
+            }
+        }
+        if(!stmt->define_raw(1, m_rows.data())) {
+            disconnect();
+            return false;
+        }
+        m_stmt = std::move(stmt);
+        return true;
+    }
+
+    void hash_lookup::disconnect() {
+        m_stmt.reset();
+        m_conn.reset();
+    }
+
+    auto hash_lookup::query(std::vector<request>& batch) -> bool {
+        // Batches never exceed m_max_keys, the number of bind variables.
+        for(size_t i{0}; i < m_max_keys; i++) {
+            m_keys[i] = batch[std::min(i, batch.size() - 1)].m_id;
+        }
+        if(!m_stmt->query()) {
+            return false;
+        }
+        auto found = std::unordered_set<hash_t, hashing::null>();
+        while(true) {
+            auto fetched = m_stmt->fetch(m_max_keys);
+            if(!fetched.has_value()) {
+                return false;
+            }
+            found.insert(m_rows.begin(),
+                         m_rows.begin()
+                             + static_cast<std::ptrdiff_t>(fetched.value()));
+            if(fetched.value() < m_max_keys) {
+                break;
+            }
+        }
+        for(auto& req : batch) {
+            req.m_found.set_value(found.find(req.m_id) != found.end());
+        }
+        return true;
+    }
+
+    void hash_lookup::worker_loop() {
+        auto batch = std::vector<request>();
+        while(true) {
+            {
+                std::unique_lock l(m_mut);
+                m_cv.wait(l, [&]() {
+                    return !m_running || !m_pending.empty();
+                });
+                if(!m_running) {
+                    // stop() fails whatever is still pending.
+                    return;
+                }
+                // Hold the batch open so concurrent callers can join it.
+                m_cv.wait_for(l, m_window, [&]() {
+                    return !m_running || m_pending.size() >= m_max_keys;
+                });
+                auto count = std::min(m_max_keys, m_pending.size());
+                auto end = m_pending.begin()
+                         + static_cast<std::ptrdiff_t>(count);
+                batch.assign(std::make_move_iterator(m_pending.begin()),
+                             std::make_move_iterator(end));
+                m_pending.erase(m_pending.begin(), end);
+            }
+
+            if(!connect() || !query(batch)) {
+                m_logger->error("Failed to look up",
+                                batch.size(),
+                                "keys in",
+                                m_table);
+                if(m_conn.has_value() && m_conn->lost()) {
+                    m_logger->warn("Lost Oracle session for", m_table);
+                    m_stmt.reset();
+                    m_conn->discard();
+                    m_conn.reset();
+                }
+                for(auto& req : batch) {
+                    req.m_found.set_value(std::nullopt);
+                }
+            }
+            batch.clear();
+        }
+    }
+}
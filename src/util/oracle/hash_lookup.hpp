@@ -0,0 +1,120 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_HASH_LOOKUP_H_
+#define OPENCBDC_TX_SRC_ORACLE_HASH_LOOKUP_H_
+
+#include "session_pool.hpp"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cbdc::oracle {
+    /// \brief Batches concurrent membership queries against a hash column.
+    ///
+    /// Callers submit hashes and receive a future reporting whether the
+    /// hash is stored in the column. A worker thread waits for the first
+    /// pending hash, keeps the batch open for up to the lookup window or
+    /// until it holds the maximum number of keys, and then resolves the
+    /// whole batch with one "SELECT ... WHERE column IN (...)" round trip.
+    /// The IN list always has the maximum number of bind variables, padded
+    /// with repeated keys, so every batch reuses one cached statement. The
+    /// worker connects on its first batch and reconnects after losing its
+    /// session.
+    class hash_lookup {
+      public:
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param pool session pool from which to take the worker's
+        ///             session.
+        /// \param table fully qualified name of the table to search.
+        /// \param column name of the column holding the hashes.
+        /// \param partition name of the partition to search, or
+        ///                  std::nullopt to search the whole table.
+        /// \param window maximum time the first key in a batch waits for
+        ///               others to join it.
+        /// \param max_keys number of keys which closes a batch early.
+        hash_lookup(std::shared_ptr<logging::log> logger,
+                    std::shared_ptr<session_pool> pool,
+                    std::string table,
+                    const std::string& column,
+                    const std::optional<std::string>& partition,
+                    std::chrono::microseconds window,
+                    size_t max_keys);
+
+        /// Destructor. Calls \ref stop.
+        ~hash_lookup();
+
+        hash_lookup() = delete;
+        hash_lookup(const hash_lookup&) = delete;
+        auto operator=(const hash_lookup&) -> hash_lookup& = delete;
+        hash_lookup(hash_lookup&&) = delete;
+        auto operator=(hash_lookup&&) -> hash_lookup& = delete;
+
+        /// Launches the worker thread.
+        void start();
+
+        /// Adds a hash to the next lookup batch.
+        /// \param id hash to look up.
+        /// \return future set to whether the column contains the hash, or
+        ///         std::nullopt if the query failed or the lookup is not
+        ///         running.
+        auto lookup(const hash_t& id) -> std::future<std::optional<bool>>;
+
+        /// Reads every hash in the column with its own session, blocking
+        /// until the scan completes. Independent of the worker thread.
+        /// \param fn function called with each hash read.
+        /// \return true if the whole column was read.
+        auto scan(const std::function<void(const hash_t&)>& fn) -> bool;
+
+        /// Fails any pending lookups, joins the worker thread and returns
+        /// its session to the pool.
+        void stop();
+
+      private:
+        struct request {
+            hash_t m_id;
+            std::promise<std::optional<bool>> m_found;
+        };
+
+        void worker_loop();
+        auto connect() -> bool;
+        auto query(std::vector<request>& batch) -> bool;
+        void disconnect();
+
+        std::shared_ptr<logging::log> m_logger;
+        std::shared_ptr<session_pool> m_pool;
+        std::string m_table;
+        std::chrono::microseconds m_window;
+        size_t m_max_keys;
+        std::string m_query;
+        std::string m_scan_query;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<request> m_pending;
+        bool m_running{false};
+
+        std::optional<connection> m_conn;
+        std::optional<statement> m_stmt;
+        /// Bind buffer for the IN list, m_max_keys hashes.
+        std::vector<hash_t> m_keys;
+        /// Define buffer for the returned rows, m_max_keys hashes.
+        std::vector<hash_t> m_rows;
+        std::thread m_thread;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_HASH_LOOKUP_H_
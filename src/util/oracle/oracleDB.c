@@ -2,6 +2,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+// Current monotonic time in microseconds
+static unsigned long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)ts.tv_nsec / 1000ULL;
+}
+
+// Record an operation that started at start_us in the given histogram
+static void record_timing(OracleDBTiming *timing, unsigned long long start_us) {
+    unsigned long long elapsed = now_us() - start_us;
+    int bucket = 0;
+    while (bucket < ORACLEDB_HISTOGRAM_BUCKETS - 1 && (elapsed >> bucket) != 0) {
+        bucket++;
+    }
+    timing->count++;
+    timing->total_us += elapsed;
+    if (elapsed > timing->max_us) {
+        timing->max_us = elapsed;
+    }
+    timing->buckets[bucket]++;
+}
 
 // Initialize OracleDB struct
 // @params db: OracleDB struct
@@ -86,6 +109,15 @@ int OracleDB_connect(OracleDB *db) {
         return 1;
     }
 
+    // Enable the statement cache used by OracleDB_execute_batch
+    ub4 stmt_cache_size = ORACLEDB_DEFAULT_STMT_CACHE_SIZE;
+    db->status = OCIAttrSet(db->svchp, OCI_HTYPE_SVCCTX, &stmt_cache_size, 0, OCI_ATTR_STMTCACHESIZE, db->errhp);
+    if(db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error setting statement cache size attribute.\n");
+        print_oci_error(db->errhp);
+        return 1;
+    }
+
     printf("[Oracle DB] Connected to Oracle Database.\n");
     return 0;
 }
@@ -95,6 +127,7 @@ int OracleDB_connect(OracleDB *db) {
 // @return 0 if success, 1 if error
 int OracleDB_execute(OracleDB *db, const char *sql_query) {
     OCIStmt *stmthp;
+    unsigned long long start;
 
     // PREPARE STATEMENT SECTION
     // Allocate a statement handle
@@ -102,38 +135,49 @@ int OracleDB_execute(OracleDB *db, const char *sql_query) {
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error allocating statement handle\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
         return 1;
     }
 
     // Prepare the SQL statement
+    start = now_us();
     db->status = OCIStmtPrepare(stmthp, db->errhp, (text *)sql_query, (ub4)strlen(sql_query), OCI_NTV_SYNTAX, OCI_DEFAULT);
+    record_timing(&db->stats.prepare, start);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error preparing SQL statement\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
+        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
         return 1;
     }
 
     // execute
+    start = now_us();
     db->status = OCIStmtExecute(db->svchp, stmthp, db->errhp, 1, 0, NULL, NULL, OCI_DEFAULT);
+    record_timing(&db->stats.execute, start);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error executing SQL statement\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
+        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
         return 1;
     }
-    printf("[Oracle DB] SQL statement executed successfully.\n");
+    db->stats.statements++;
+    db->stats.rows++;
 
     // Commit the transaction
+    start = now_us();
     db->status = OCITransCommit(db->svchp, db->errhp, OCI_DEFAULT);
+    record_timing(&db->stats.commit, start);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error committing transaction\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
+        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
         return 1;
     }
-    printf("[Oracle DB] Transaction committed successfully.\n");
 
-    if (stmthp != NULL) {
-        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
-    }
+    OCIHandleFree(stmthp, OCI_HTYPE_STMT);
     return 0;
 }
 
@@ -142,20 +186,26 @@ int OracleDB_execute(OracleDB *db, const char *sql_query) {
 // @return 0 if success, 1 if error
 int OracleDB_execute_bind(OracleDB *db, const char *sql_query, const char **bind_vars, int num_bind_vars) {
     OCIStmt *stmthp;
+    unsigned long long start;
 
     // Allocate a statement handle
     db->status = OCIHandleAlloc(db->envhp, (void **)&stmthp, OCI_HTYPE_STMT, 0, NULL);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error allocating statement handle\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
         return 1;
     }
 
     // Prepare the SQL statement with bind variables
+    start = now_us();
     db->status = OCIStmtPrepare(stmthp, db->errhp, (text *)sql_query, (ub4)strlen(sql_query), OCI_NTV_SYNTAX, OCI_DEFAULT);
+    record_timing(&db->stats.prepare, start);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error preparing SQL statement\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
+        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
         return 1;
     }
 
@@ -166,52 +216,278 @@ int OracleDB_execute_bind(OracleDB *db, const char *sql_query, const char **bind
         if (db->status != OCI_SUCCESS) {
             printf("[Oracle DB] Error binding variable %d\n", i + 1);
             print_oci_error(db->errhp);
+            db->stats.errors++;
+            OCIHandleFree(stmthp, OCI_HTYPE_STMT);
             return 1;
         }
     }
 
     // execute
+    start = now_us();
     db->status = OCIStmtExecute(db->svchp, stmthp, db->errhp, 1, 0, NULL, NULL, OCI_DEFAULT);
+    record_timing(&db->stats.execute, start);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error executing bind SQL statement\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
+        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
         return 1;
     }
-
-    printf("[Oracle DB] Bind SQL statement executed successfully.\n");
+    db->stats.statements++;
+    db->stats.rows++;
 
     // Commit the transaction
+    start = now_us();
     db->status = OCITransCommit(db->svchp, db->errhp, OCI_DEFAULT);
+    record_timing(&db->stats.commit, start);
     if (db->status != OCI_SUCCESS) {
         printf("[Oracle DB] Error committing transaction\n");
         print_oci_error(db->errhp);
+        db->stats.errors++;
+        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
         return 1;
     }
 
-    printf("[Oracle DB] Transaction committed successfully.\n");
-
     // Free the statement handle
-    if (stmthp != NULL) {
-        OCIHandleFree(stmthp, OCI_HTYPE_STMT);
-    }
+    OCIHandleFree(stmthp, OCI_HTYPE_STMT);
 
     return 0;
 }
 
-    // How to use bind variables
-    // Bind variables is faster for adding lists of data to a table.
+// Execute SQL once for every row of column-wise bind arrays, then commit once
+// Each column is a contiguous array of num_rows values, each occupying
+// col_widths[i] bytes. col_types[i] gives the external type of column i: for
+// SQLT_STR every value is a null-terminated string and the width includes the
+// terminator, for SQLT_BIN every value is exactly col_widths[i] raw bytes. Pass
+// NULL for col_types to bind every column as SQLT_STR. Positional bind
+// variables (:1, :2, ...) in the query map to columns in order.
+// The statement is prepared through the session's statement cache using the
+// query text as the key, so repeated calls with the same query reuse the
+// parsed cursor instead of hard-parsing it again.
+// @params db: OracleDB struct, sql_query: SQL query, columns: array of column buffers,
+//         col_widths: width of one value in each column, col_types: SQLT type of each column or NULL,
+//         num_cols: number of columns, num_rows: number of rows in each column
+// @return 0 if success, 1 if error
+int OracleDB_execute_batch(OracleDB *db, const char *sql_query, const void **columns, const int *col_widths, const ub2 *col_types, int num_cols, int num_rows) {
+    OCIStmt *stmthp = NULL;
+
+    if (num_rows <= 0) {
+        return 0;
+    }
+
+    if (OracleDB_stmt_prepare(db, sql_query, &stmthp) != 0) {
+        return 1;
+    }
+
+    // Bind each column as an array. OCI steps through the array by the value
+    // size, so row i of column j is read from columns[j] + i * col_widths[j].
+    for (int i = 0; i < num_cols; i++) {
+        const ub2 col_type = col_types ? col_types[i] : (ub2)SQLT_STR;
+        if (OracleDB_stmt_bind_array(db, stmthp, i + 1, (void *)columns[i], col_widths[i], col_type) != 0) {
+            OracleDB_stmt_release(db, stmthp, sql_query, 1);
+            return 1;
+        }
+    }
+
+    // execute all rows in a single round trip
+    if (OracleDB_stmt_execute(db, stmthp, num_rows) != 0) {
+        OracleDB_rollback(db);
+        OracleDB_stmt_release(db, stmthp, sql_query, 1);
+        return 1;
+    }
+
+    // Return the statement to the cache before committing the whole batch
+    OracleDB_stmt_release(db, stmthp, sql_query, 0);
+    return OracleDB_commit(db);
+}
+
+    // How to use batch binds
+    // Binding column arrays sends every row in one round trip with one COMMIT.
     //
     // const char *sql_query = "INSERT INTO table (id, name) VALUES (:1, :2)";
-    // const char *id_values[] = {"101", "102", "103", "104", "105"};
-    // const char *name_values[] = {"John", "Alice", "Bob", "Eve", "Charlie"};
+    // const char id_values[5][4] = {"101", "102", "103", "104", "105"};
+    // const char name_values[5][8] = {"John", "Alice", "Bob", "Eve", "Charlie"};
+    // const char *columns[] = {&id_values[0][0], &name_values[0][0]};
+    // const int col_widths[] = {4, 8};
+    //
+    // OracleDB_execute_batch(&db, sql_query, (const void **)columns, col_widths, NULL, 2, 5);
+    //
+    // Fixed-width binary values such as 32-byte hashes bind directly as RAW:
+    //
+    // const char *sql_query = "INSERT INTO table (hash) VALUES (:1)";
+    // const unsigned char hashes[5][32] = {...};
+    // const void *columns[] = {&hashes[0][0]};
+    // const int col_widths[] = {32};
+    // const ub2 col_types[] = {SQLT_BIN};
+    //
+    // OracleDB_execute_batch(&db, sql_query, columns, col_widths, col_types, 1, 5);
+
+
+// Prepare a statement through the session's statement cache
+// The query text is the cache key, so repeated prepares of the same query
+// reuse the parsed cursor instead of hard-parsing it again. Return the
+// statement with OracleDB_stmt_release.
+// @params db: OracleDB struct, sql_query: SQL query, stmthp: prepared statement
+// @return 0 if success, 1 if error
+int OracleDB_stmt_prepare(OracleDB *db, const char *sql_query, OCIStmt **stmthp) {
+    const ub4 query_len = (ub4)strlen(sql_query);
+    unsigned long long start = now_us();
+    *stmthp = NULL;
+    db->status = OCIStmtPrepare2(db->svchp, stmthp, db->errhp, (const OraText *)sql_query, query_len,
+                                 (const OraText *)sql_query, query_len, OCI_NTV_SYNTAX, OCI_DEFAULT);
+    record_timing(&db->stats.prepare, start);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error preparing SQL statement\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    return 0;
+}
+
+// Bind an array of fixed-width values to a positional bind variable
+// The binding refers to values directly, so later executions send whatever
+// the array holds at that time, up to the number of rows executed.
+// @params db: OracleDB struct, stmthp: prepared statement, pos: 1-based bind position,
+//         values: array of values, width: bytes per value, type: SQLT type of the values
+// @return 0 if success, 1 if error
+int OracleDB_stmt_bind_array(OracleDB *db, OCIStmt *stmthp, int pos, void *values, int width, ub2 type) {
+    OCIBind *bindp = NULL;
+    db->status = OCIBindByPos(stmthp, &bindp, db->errhp, (ub4)pos, values, (sb4)width, type, NULL, NULL, NULL, 0, NULL, OCI_DEFAULT);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error binding column %d\n", pos);
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    return 0;
+}
+
+// Bind an array of variable-length binary values to a BLOB bind variable
+// Each value occupies width bytes of the array, of which only lens[i] are
+// sent, so one round trip inserts rows of different sizes. Uses the LOB data
+// interface, so values may exceed the 32 KiB limit of RAW binds.
+// @params db: OracleDB struct, stmthp: prepared statement, pos: 1-based bind position,
+//         values: array of values, width: bytes reserved per value, lens: length of each value
+// @return 0 if success, 1 if error
+int OracleDB_stmt_bind_lob_array(OracleDB *db, OCIStmt *stmthp, int pos, void *values, unsigned long long width, ub4 *lens) {
+    OCIBind *bindp = NULL;
+    db->status = OCIBindByPos2(stmthp, &bindp, db->errhp, (ub4)pos, values, (sb8)width, SQLT_LBI, NULL, lens, NULL, 0, NULL, OCI_DEFAULT);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error binding LOB column %d\n", pos);
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    return 0;
+}
 
-    // // Number of sets of bind variables
-    // int num_sets = 5;
-    // for (int i = 0; i < num_sets; i++) {
-    //     const char *bind_vars[] = {id_values[i], name_values[i]};
-    //     OracleDB_execute_bind(&db, sql_query, bind_vars, 2);
-    // }
+// Execute a prepared statement once per bound row, without committing
+// @params db: OracleDB struct, stmthp: prepared statement, num_rows: number of bound rows to send
+// @return 0 if success, 1 if error
+int OracleDB_stmt_execute(OracleDB *db, OCIStmt *stmthp, int num_rows) {
+    unsigned long long start = now_us();
+    db->status = OCIStmtExecute(db->svchp, stmthp, db->errhp, (ub4)num_rows, 0, NULL, NULL, OCI_DEFAULT);
+    record_timing(&db->stats.execute, start);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error executing batch SQL statement\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    db->stats.statements++;
+    db->stats.rows += (unsigned long long)num_rows;
+    return 0;
+}
 
+// Define an array of fixed-width output buffers for a query's select-list column
+// Each fetch fills the buffers from the start, one value per fetched row.
+// @params db: OracleDB struct, stmthp: prepared query, pos: 1-based select-list position,
+//         values: array of output buffers, width: bytes per buffer, type: SQLT type to fetch as
+// @return 0 if success, 1 if error
+int OracleDB_stmt_define_array(OracleDB *db, OCIStmt *stmthp, int pos, void *values, int width, ub2 type) {
+    OCIDefine *defnp = NULL;
+    db->status = OCIDefineByPos(stmthp, &defnp, db->errhp, (ub4)pos, values, (sb4)width, type, NULL, NULL, NULL, OCI_DEFAULT);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error defining column %d\n", pos);
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    return 0;
+}
+
+// Execute a prepared query without fetching any rows
+// @params db: OracleDB struct, stmthp: prepared query with its binds set
+// @return 0 if success, 1 if error
+int OracleDB_stmt_query(OracleDB *db, OCIStmt *stmthp) {
+    unsigned long long start = now_us();
+    db->status = OCIStmtExecute(db->svchp, stmthp, db->errhp, 0, 0, NULL, NULL, OCI_DEFAULT);
+    record_timing(&db->stats.execute, start);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error executing query\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    db->stats.statements++;
+    return 0;
+}
+
+// Fetch the next rows of an executed query into its defined buffers
+// @params db: OracleDB struct, stmthp: executed query, max_rows: rows the defined buffers hold,
+//         num_fetched: set to the number of rows fetched, 0 once the result set is exhausted
+// @return 0 if success, 1 if error
+int OracleDB_stmt_fetch(OracleDB *db, OCIStmt *stmthp, int max_rows, int *num_fetched) {
+    ub4 fetched = 0;
+    unsigned long long start = now_us();
+    *num_fetched = 0;
+    db->status = OCIStmtFetch2(stmthp, db->errhp, (ub4)max_rows, OCI_FETCH_NEXT, 0, OCI_DEFAULT);
+    record_timing(&db->stats.execute, start);
+    // OCI_NO_DATA still fills the buffers with the final, partial set of rows
+    if (db->status != OCI_SUCCESS && db->status != OCI_NO_DATA) {
+        printf("[Oracle DB] Error fetching rows\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    OCIAttrGet(stmthp, OCI_HTYPE_STMT, &fetched, NULL, OCI_ATTR_ROWS_FETCHED, db->errhp);
+    *num_fetched = (int)fetched;
+    db->stats.rows += (unsigned long long)fetched;
+    return 0;
+}
+
+// Return a prepared statement to the session's statement cache
+// @params db: OracleDB struct, stmthp: prepared statement, sql_query: SQL query it was prepared with,
+//         drop: nonzero to evict the statement from the cache, e.g. after an error
+void OracleDB_stmt_release(OracleDB *db, OCIStmt *stmthp, const char *sql_query, int drop) {
+    OCIStmtRelease(stmthp, db->errhp, (const OraText *)sql_query, (ub4)strlen(sql_query),
+                   drop ? OCI_STRLS_CACHE_DELETE : OCI_DEFAULT);
+}
+
+// Commit the session's transaction
+// @params db: OracleDB struct
+// @return 0 if success, 1 if error
+int OracleDB_commit(OracleDB *db) {
+    unsigned long long start = now_us();
+    db->status = OCITransCommit(db->svchp, db->errhp, OCI_DEFAULT);
+    record_timing(&db->stats.commit, start);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error committing transaction\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+    return 0;
+}
+
+// Roll back the session's transaction
+// @params db: OracleDB struct
+// @return 0 if success, 1 if error
+int OracleDB_rollback(OracleDB *db) {
+    db->status = OCITransRollback(db->svchp, db->errhp, OCI_DEFAULT);
+    return db->status == OCI_SUCCESS ? 0 : 1;
+}
 
 // Clean up OCI handles
 // @params db: OracleDB struct
@@ -236,6 +512,446 @@ int OracleDB_disconnect(OracleDB *db) {
     return 0;
 }
 
+// Create a session pool in a threaded environment
+// Every pooled session keeps its own cache of up to stmt_cache_size prepared statements.
+// @params pool: OracleDBPool struct, min_sessions: sessions opened up front,
+//         max_sessions: upper bound on open sessions, increment: sessions opened at a time when the pool grows,
+//         stmt_cache_size: statements cached per session
+// @return 0 if success, 1 if error
+int OracleDB_pool_init(OracleDBPool *pool, unsigned int min_sessions, unsigned int max_sessions, unsigned int increment, unsigned int stmt_cache_size) {
+    memset(pool, 0, sizeof(*pool));
+
+    // set environment variables
+    if(set_environment() != 0) {
+        printf("[Oracle DB] Error setting environment.\n");
+        return 1;
+    }
+
+    // Create a threaded environment so sessions can be used from any thread
+    pool->status = OCIEnvCreate(&pool->envhp, OCI_THREADED, NULL, NULL, NULL, NULL, 0, NULL);
+    if (pool->status != OCI_SUCCESS) {
+        printf("[Oracle DB] OCIEnvCreate failed.\n");
+        return 1;
+    }
+
+    // Read keys from key file
+    if (read_key_file(pool->username, pool->password, pool->wallet_pw) != 0) {
+        printf("[Oracle DB] Error reading key file.\n");
+        OracleDB_pool_destroy(pool);
+        return 1;
+    }
+
+    OCIHandleAlloc(pool->envhp, (void **)&pool->errhp, OCI_HTYPE_ERROR, 0, NULL);
+    OCIHandleAlloc(pool->envhp, (void **)&pool->poolhp, OCI_HTYPE_SPOOL, 0, NULL);
+
+    // Create the pool. Homogeneous pools share the credentials given here.
+    pool->status = OCISessionPoolCreate(pool->envhp, pool->errhp, pool->poolhp, &pool->pool_name, &pool->pool_name_len,
+                                        (const OraText *)"cbdcauto_low", (ub4)strlen("cbdcauto_low"),
+                                        (ub4)min_sessions, (ub4)max_sessions, (ub4)increment,
+                                        (const OraText *)pool->username, (ub4)strlen(pool->username),
+                                        (const OraText *)pool->password, (ub4)strlen(pool->password),
+                                        OCI_SPC_HOMOGENEOUS);
+    if (pool->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error creating session pool.\n");
+        print_oci_error(pool->errhp);
+        OracleDB_pool_destroy(pool);
+        return 1;
+    }
+
+    // Size the per-session statement cache
+    ub4 cache_size = (ub4)stmt_cache_size;
+    pool->status = OCIAttrSet(pool->poolhp, OCI_HTYPE_SPOOL, &cache_size, 0, OCI_ATTR_SPOOL_STMTCACHESIZE, pool->errhp);
+    if (pool->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error setting statement cache size attribute.\n");
+        print_oci_error(pool->errhp);
+        OracleDB_pool_destroy(pool);
+        return 1;
+    }
+
+    printf("[Oracle DB] Created session pool with %u-%u sessions.\n", min_sessions, max_sessions);
+    return 0;
+}
+
+// Take a session from the pool
+// The session shares the pool's environment and may be used with OracleDB_execute*
+// from one thread at a time. Return it with OracleDB_pool_release, not OracleDB_disconnect.
+// @params pool: OracleDBPool struct, db: OracleDB struct to fill in
+// @return 0 if success, 1 if error
+int OracleDB_pool_acquire(OracleDBPool *pool, OracleDB *db) {
+    memset(db, 0, sizeof(*db));
+    db->envhp = pool->envhp;
+
+    // Each session gets its own error handle so threads do not share one
+    db->status = OCIHandleAlloc(db->envhp, (void **)&db->errhp, OCI_HTYPE_ERROR, 0, NULL);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error allocating error handle\n");
+        return 1;
+    }
+
+    db->status = OCISessionGet(db->envhp, db->errhp, &db->svchp, NULL, pool->pool_name, pool->pool_name_len,
+                               NULL, 0, NULL, NULL, NULL, OCI_SESSGET_SPOOL | OCI_SESSGET_STMTCACHE);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error getting session from pool\n");
+        print_oci_error(db->errhp);
+        OCIHandleFree(db->errhp, OCI_HTYPE_ERROR);
+        db->errhp = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Release a pooled session with the given OCISessionRelease mode
+static int pool_release(OracleDB *db, ub4 mode) {
+    int ret = 0;
+    if (db->svchp && db->errhp) {
+        db->status = OCISessionRelease(db->svchp, db->errhp, NULL, 0, mode);
+        if (db->status != OCI_SUCCESS) {
+            printf("[Oracle DB] Error releasing session to pool\n");
+            print_oci_error(db->errhp);
+            ret = 1;
+        }
+    }
+    if (db->errhp) OCIHandleFree(db->errhp, OCI_HTYPE_ERROR);
+    db->svchp = NULL;
+    db->errhp = NULL;
+    db->envhp = NULL;
+    return ret;
+}
+
+// Return a session to its pool
+// @params db: OracleDB struct filled in by OracleDB_pool_acquire
+// @return 0 if success, 1 if error
+int OracleDB_pool_release(OracleDB *db) {
+    return pool_release(db, OCI_DEFAULT);
+}
+
+// Return a dead session to its pool, which closes it instead of handing it
+// out again. The pool opens a fresh session on a later acquire.
+// @params db: OracleDB struct filled in by OracleDB_pool_acquire
+// @return 0 if success, 1 if error
+int OracleDB_pool_drop(OracleDB *db) {
+    return pool_release(db, OCI_SESSRLS_DROPSESS);
+}
+
+// Check whether the last failed call lost the connection to the database
+// Only errors which make the session unusable count, so constraint
+// violations and the like leave the session in place.
+// @params db: OracleDB struct
+// @return 1 if the session must be replaced, 0 otherwise
+int OracleDB_connection_lost(OracleDB *db) {
+    // ORA-00028 session killed, ORA-01012 not logged on, ORA-01033/01034/
+    // 01089 instance unavailable, ORA-02396 idle timeout, ORA-03113/03114/
+    // 03135 connection lost, ORA-12xxx network errors, ORA-25408 failed over
+    static const sb4 lost_codes[] = {28, 1012, 1033, 1034, 1089, 2396, 3113, 3114, 3135,
+                                     12153, 12170, 12514, 12528, 12537, 12541, 12543,
+                                     12547, 12570, 25408};
+    sb4 errcode = 0;
+    text errbuf[512];
+    if (!db->svchp || !db->errhp) {
+        return 1;
+    }
+    if (OCIErrorGet(db->errhp, 1, NULL, &errcode, errbuf, (ub4)sizeof(errbuf), OCI_HTYPE_ERROR) != OCI_SUCCESS) {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(lost_codes) / sizeof(lost_codes[0]); i++) {
+        if (errcode == lost_codes[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Destroy a session pool and its environment
+// All sessions must have been released first.
+// @params pool: OracleDBPool struct
+// @return 0 if success, 1 if error
+int OracleDB_pool_destroy(OracleDBPool *pool) {
+    if (pool->poolhp && pool->errhp && pool->pool_name) OCISessionPoolDestroy(pool->poolhp, pool->errhp, OCI_DEFAULT);
+    if (pool->poolhp) OCIHandleFree(pool->poolhp, OCI_HTYPE_SPOOL);
+    if (pool->errhp) OCIHandleFree(pool->errhp, OCI_HTYPE_ERROR);
+    if (pool->envhp) OCIHandleFree(pool->envhp, OCI_HTYPE_ENV);
+    pool->poolhp = NULL;
+    pool->errhp = NULL;
+    pool->envhp = NULL;
+    pool->pool_name = NULL;
+    pool->pool_name_len = 0;
+    return 0;
+}
+
+// Free the handles of a direct path load
+static void dirpath_free(OracleDBDirPath *dp) {
+    if (dp->dpstr) OCIHandleFree(dp->dpstr, OCI_HTYPE_DIRPATH_STREAM);
+    if (dp->dpca) OCIHandleFree(dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY);
+    if (dp->dpctx) OCIHandleFree(dp->dpctx, OCI_HTYPE_DIRPATH_CTX);
+    dp->dpstr = NULL;
+    dp->dpca = NULL;
+    dp->dpctx = NULL;
+}
+
+// Start a direct path load
+// Direct path loading formats blocks on the client and writes them above the
+// table's high water mark, bypassing SQL processing and the buffer cache.
+// The loaded rows become visible when OracleDB_dirpath_finish returns. While
+// the load is open the session must not be used for anything else.
+// @params db: OracleDB struct, dp: load to initialize, schema: owning schema
+// or NULL for the session user, table: table name, partition: partition
+// name or NULL to load the whole table, columns: column names, col_widths:
+// bytes per value of each column (RAW data), num_cols: number of columns
+// @return 0 if success, 1 if error
+int OracleDB_dirpath_begin(OracleDB *db, OracleDBDirPath *dp, const char *schema, const char *table, const char *partition, const char **columns, const unsigned int *col_widths, int num_cols) {
+    OCIParam *collist = NULL;
+    unsigned long long start;
+    ub2 ncols;
+
+    memset(dp, 0, sizeof(*dp));
+    dp->db = db;
+    if (num_cols <= 0 || num_cols > ORACLEDB_DIRPATH_MAX_COLS) {
+        printf("[Oracle DB] Invalid direct path column count %d\n", num_cols);
+        return 1;
+    }
+    ncols = (ub2)num_cols;
+    dp->num_cols = ncols;
+
+    db->status = OCIHandleAlloc(db->envhp, (void **)&dp->dpctx, OCI_HTYPE_DIRPATH_CTX, 0, NULL);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error allocating direct path context\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        return 1;
+    }
+
+    // Target table, partition and column count
+    db->status = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, (void *)table, (ub4)strlen(table), OCI_ATTR_NAME, db->errhp);
+    if (db->status == OCI_SUCCESS && schema) {
+        db->status = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, (void *)schema, (ub4)strlen(schema), OCI_ATTR_SCHEMA_NAME, db->errhp);
+    }
+    if (db->status == OCI_SUCCESS && partition) {
+        db->status = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, (void *)partition, (ub4)strlen(partition), OCI_ATTR_SUB_NAME, db->errhp);
+    }
+    if (db->status == OCI_SUCCESS && !partition) {
+        // Whole-table loads from several sessions need a parallel load,
+        // otherwise each session waits on the table lock of the others.
+        ub1 parallel = 1;
+        db->status = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &parallel, 0, OCI_ATTR_DIRPATH_PARALLEL, db->errhp);
+    }
+    if (db->status == OCI_SUCCESS) {
+        db->status = OCIAttrSet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &ncols, 0, OCI_ATTR_NUM_COLS, db->errhp);
+    }
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error setting direct path target %s\n", table);
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        dirpath_free(dp);
+        return 1;
+    }
+
+    // Describe each column as fixed-width binary input
+    db->status = OCIAttrGet(dp->dpctx, OCI_HTYPE_DIRPATH_CTX, &collist, NULL, OCI_ATTR_LIST_COLUMNS, db->errhp);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error getting direct path column list\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        dirpath_free(dp);
+        return 1;
+    }
+    for (int i = 0; i < num_cols; i++) {
+        OCIParam *col = NULL;
+        ub2 col_type = SQLT_BIN;
+        ub4 col_width = col_widths[i];
+        db->status = OCIParamGet(collist, OCI_DTYPE_PARAM, db->errhp, (void **)&col, (ub4)(i + 1));
+        if (db->status == OCI_SUCCESS) {
+            db->status = OCIAttrSet(col, OCI_DTYPE_PARAM, (void *)columns[i], (ub4)strlen(columns[i]), OCI_ATTR_NAME, db->errhp);
+        }
+        if (db->status == OCI_SUCCESS) {
+            db->status = OCIAttrSet(col, OCI_DTYPE_PARAM, &col_type, 0, OCI_ATTR_DATA_TYPE, db->errhp);
+        }
+        if (db->status == OCI_SUCCESS) {
+            db->status = OCIAttrSet(col, OCI_DTYPE_PARAM, &col_width, 0, OCI_ATTR_DATA_SIZE, db->errhp);
+        }
+        if (col) OCIDescriptorFree(col, OCI_DTYPE_PARAM);
+        if (db->status != OCI_SUCCESS) {
+            printf("[Oracle DB] Error describing direct path column %s\n", columns[i]);
+            print_oci_error(db->errhp);
+            db->stats.errors++;
+            dirpath_free(dp);
+            return 1;
+        }
+        dp->col_widths[i] = col_width;
+        dp->row_width += col_width;
+    }
+
+    start = now_us();
+    db->status = OCIDirPathPrepare(dp->dpctx, db->svchp, db->errhp);
+    record_timing(&db->stats.prepare, start);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error preparing direct path load of %s\n", table);
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        dirpath_free(dp);
+        return 1;
+    }
+
+    // The column array and stream are children of the prepared context
+    db->status = OCIHandleAlloc(dp->dpctx, (void **)&dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY, 0, NULL);
+    if (db->status == OCI_SUCCESS) {
+        db->status = OCIHandleAlloc(dp->dpctx, (void **)&dp->dpstr, OCI_HTYPE_DIRPATH_STREAM, 0, NULL);
+    }
+    if (db->status == OCI_SUCCESS) {
+        db->status = OCIAttrGet(dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY, &dp->max_rows, NULL, OCI_ATTR_NUM_ROWS, db->errhp);
+    }
+    if (db->status != OCI_SUCCESS || dp->max_rows == 0) {
+        printf("[Oracle DB] Error allocating direct path buffers\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        OracleDB_dirpath_abort(dp);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Convert the filled column array into stream buffers and load them
+// @params dp: direct path load, num_rows: rows set in the column array
+// @return 0 if success, 1 if error
+static int dirpath_load_array(OracleDBDirPath *dp, ub4 num_rows) {
+    OracleDB *db = dp->db;
+    ub4 row_off = 0;
+    unsigned long long start;
+
+    // A full stream buffer returns OCI_CONTINUE after converting only some
+    // rows; load it and resume from the first unconverted row.
+    for (;;) {
+        sword conv = OCIDirPathColArrayToStream(dp->dpca, dp->dpctx, dp->dpstr, db->errhp, num_rows, row_off);
+        if (conv != OCI_SUCCESS && conv != OCI_CONTINUE) {
+            db->status = conv;
+            printf("[Oracle DB] Error converting direct path column array\n");
+            print_oci_error(db->errhp);
+            db->stats.errors++;
+            return 1;
+        }
+
+        start = now_us();
+        db->status = OCIDirPathLoadStream(dp->dpctx, dp->dpstr, db->errhp);
+        record_timing(&db->stats.execute, start);
+        if (db->status != OCI_SUCCESS) {
+            printf("[Oracle DB] Error loading direct path stream\n");
+            print_oci_error(db->errhp);
+            db->stats.errors++;
+            return 1;
+        }
+        db->stats.statements++;
+        OCIDirPathStreamReset(dp->dpstr, db->errhp);
+
+        if (conv == OCI_SUCCESS) {
+            break;
+        }
+        ub4 converted = 0;
+        OCIAttrGet(dp->dpca, OCI_HTYPE_DIRPATH_COLUMN_ARRAY, &converted, NULL, OCI_ATTR_ROW_COUNT, db->errhp);
+        row_off += converted;
+        if (row_off >= num_rows) {
+            break;
+        }
+    }
+
+    db->stats.rows += num_rows;
+    OCIDirPathColArrayReset(dp->dpca, db->errhp);
+    return 0;
+}
+
+// Load rows through an open direct path load
+// Rows are row-major: each row is the concatenation of its column values,
+// using the column widths given to OracleDB_dirpath_begin. The rows are only
+// referenced until this call returns.
+// @params dp: direct path load, rows: row data, num_rows: number of rows
+// @return 0 if success, 1 if error
+int OracleDB_dirpath_load(OracleDBDirPath *dp, const unsigned char *rows, int num_rows) {
+    OracleDB *db = dp->db;
+    ub4 total = num_rows > 0 ? (ub4)num_rows : 0;
+    ub4 done = 0;
+
+    while (done < total) {
+        ub4 chunk = total - done;
+        if (chunk > dp->max_rows) {
+            chunk = dp->max_rows;
+        }
+        for (ub4 r = 0; r < chunk; r++) {
+            const unsigned char *row = rows + (size_t)(done + r) * dp->row_width;
+            size_t col_off = 0;
+            for (ub2 c = 0; c < dp->num_cols; c++) {
+                db->status = OCIDirPathColArrayEntrySet(dp->dpca, db->errhp, r, c, (ub1 *)(row + col_off), dp->col_widths[c], OCI_DIRPATH_COL_COMPLETE);
+                if (db->status != OCI_SUCCESS) {
+                    printf("[Oracle DB] Error setting direct path entry\n");
+                    print_oci_error(db->errhp);
+                    db->stats.errors++;
+                    return 1;
+                }
+                col_off += dp->col_widths[c];
+            }
+        }
+        if (dirpath_load_array(dp, chunk) != 0) {
+            return 1;
+        }
+        done += chunk;
+    }
+
+    return 0;
+}
+
+// Finish a direct path load, saving the loaded rows, and free its handles
+// @params dp: direct path load
+// @return 0 if success, 1 if error
+int OracleDB_dirpath_finish(OracleDBDirPath *dp) {
+    OracleDB *db = dp->db;
+    unsigned long long start = now_us();
+    db->status = OCIDirPathFinish(dp->dpctx, db->errhp);
+    record_timing(&db->stats.commit, start);
+    if (db->status != OCI_SUCCESS) {
+        printf("[Oracle DB] Error finishing direct path load\n");
+        print_oci_error(db->errhp);
+        db->stats.errors++;
+        OracleDB_dirpath_abort(dp);
+        return 1;
+    }
+    dirpath_free(dp);
+    return 0;
+}
+
+// Abort a direct path load, discarding the loaded rows, and free its handles
+// @params dp: direct path load
+void OracleDB_dirpath_abort(OracleDBDirPath *dp) {
+    if (dp->dpctx) {
+        OCIDirPathAbort(dp->dpctx, dp->db->errhp);
+    }
+    dirpath_free(dp);
+}
+
+// Reset the client-side statistics of a session
+// @params db: OracleDB struct
+void OracleDB_stats_reset(OracleDB *db) {
+    memset(&db->stats, 0, sizeof(db->stats));
+}
+
+// Approximate a latency percentile from a histogram
+// Returns the upper bound of the bucket containing the percentile, so the
+// result overestimates by at most a factor of two.
+// @params timing: histogram, percentile: fraction between 0 and 1
+// @return latency in microseconds, or 0 if the histogram is empty
+unsigned long long OracleDB_timing_percentile(const OracleDBTiming *timing, double percentile) {
+    unsigned long long seen = 0;
+    double target;
+    if (timing->count == 0) {
+        return 0;
+    }
+    target = percentile * (double)timing->count;
+    for (int i = 0; i < ORACLEDB_HISTOGRAM_BUCKETS; i++) {
+        seen += timing->buckets[i];
+        if ((double)seen >= target) {
+            return i == ORACLEDB_HISTOGRAM_BUCKETS - 1 ? timing->max_us : (1ULL << i);
+        }
+    }
+    return timing->max_us;
+}
 
 // Print OCI error
 void print_oci_error(OCIError *errhp) {
@@ -7,6 +7,31 @@ extern "C" {
 
 #include <oci.h>
 
+// Statements cached per session when none is given explicitly
+#define ORACLEDB_DEFAULT_STMT_CACHE_SIZE 20
+
+// Number of latency histogram buckets. Bucket i counts operations that took
+// less than 2^i microseconds, with the last bucket catching everything slower.
+#define ORACLEDB_HISTOGRAM_BUCKETS 24
+
+// Latency histogram for one kind of operation
+typedef struct {
+    unsigned long long count;
+    unsigned long long total_us;
+    unsigned long long max_us;
+    unsigned long long buckets[ORACLEDB_HISTOGRAM_BUCKETS];
+} OracleDBTiming;
+
+// Per-session client-side statistics
+typedef struct {
+    OracleDBTiming prepare;
+    OracleDBTiming execute;
+    OracleDBTiming commit;
+    unsigned long long statements;  // executed statements (one per batch)
+    unsigned long long rows;        // rows sent or fetched across all statements
+    unsigned long long errors;      // failed prepare, bind, execute or commit calls
+} OracleDBStats;
+
 // OracleDB struct
 typedef struct {
     OCIEnv *envhp;      // environment handler
@@ -16,19 +41,74 @@ typedef struct {
     OCIError *errhp;    // error handler
 
     sword status;
+    OracleDBStats stats;
 
     char username[128];
     char password[128];
     char wallet_pw[128];
 } OracleDB;
 
+// Maximum number of columns in a direct path load
+#define ORACLEDB_DIRPATH_MAX_COLS 16
+
+// Direct path load into one table or partition
+typedef struct {
+    OracleDB *db;                       // session performing the load
+    OCIDirPathCtx *dpctx;               // direct path context
+    OCIDirPathColArray *dpca;           // column array
+    OCIDirPathStream *dpstr;            // stream buffer
+    ub4 max_rows;                       // rows the column array holds
+    ub2 num_cols;
+    ub4 col_widths[ORACLEDB_DIRPATH_MAX_COLS];
+    unsigned int row_width;             // bytes per input row
+} OracleDBDirPath;
+
+// OracleDBPool struct
+typedef struct {
+    OCIEnv *envhp;      // environment handler (threaded)
+    OCIError *errhp;    // error handler
+    OCISPool *poolhp;   // session pool handler
+
+    OraText *pool_name;
+    ub4 pool_name_len;
+
+    sword status;
+
+    char username[128];
+    char password[128];
+    char wallet_pw[128];
+} OracleDBPool;
+
 // Functions
 int OracleDB_init(OracleDB *db);
 int OracleDB_connect(OracleDB *db);
 int OracleDB_execute(OracleDB *db, const char *sql_query);
 int OracleDB_execute_bind(OracleDB *db, const char *sql_query, const char **bind_vars, int num_bind_vars);
+int OracleDB_execute_batch(OracleDB *db, const char *sql_query, const void **columns, const int *col_widths, const ub2 *col_types, int num_cols, int num_rows);
+int OracleDB_stmt_prepare(OracleDB *db, const char *sql_query, OCIStmt **stmthp);
+int OracleDB_stmt_bind_array(OracleDB *db, OCIStmt *stmthp, int pos, void *values, int width, ub2 type);
+int OracleDB_stmt_bind_lob_array(OracleDB *db, OCIStmt *stmthp, int pos, void *values, unsigned long long width, ub4 *lens);
+int OracleDB_stmt_execute(OracleDB *db, OCIStmt *stmthp, int num_rows);
+int OracleDB_stmt_define_array(OracleDB *db, OCIStmt *stmthp, int pos, void *values, int width, ub2 type);
+int OracleDB_stmt_query(OracleDB *db, OCIStmt *stmthp);
+int OracleDB_stmt_fetch(OracleDB *db, OCIStmt *stmthp, int max_rows, int *num_fetched);
+void OracleDB_stmt_release(OracleDB *db, OCIStmt *stmthp, const char *sql_query, int drop);
+int OracleDB_commit(OracleDB *db);
+int OracleDB_rollback(OracleDB *db);
 int OracleDB_clean_up(OracleDB *db);
 int OracleDB_disconnect(OracleDB *db);
+int OracleDB_pool_init(OracleDBPool *pool, unsigned int min_sessions, unsigned int max_sessions, unsigned int increment, unsigned int stmt_cache_size);
+int OracleDB_pool_acquire(OracleDBPool *pool, OracleDB *db);
+int OracleDB_pool_release(OracleDB *db);
+int OracleDB_pool_drop(OracleDB *db);
+int OracleDB_connection_lost(OracleDB *db);
+int OracleDB_pool_destroy(OracleDBPool *pool);
+int OracleDB_dirpath_begin(OracleDB *db, OracleDBDirPath *dp, const char *schema, const char *table, const char *partition, const char **columns, const unsigned int *col_widths, int num_cols);
+int OracleDB_dirpath_load(OracleDBDirPath *dp, const unsigned char *rows, int num_rows);
+int OracleDB_dirpath_finish(OracleDBDirPath *dp);
+void OracleDB_dirpath_abort(OracleDBDirPath *dp);
+void OracleDB_stats_reset(OracleDB *db);
+unsigned long long OracleDB_timing_percentile(const OracleDBTiming *timing, double percentile);
 void print_oci_error(OCIError *errhp);
 int read_key_file(char *username, char *password, char *wallet_pw);
 int set_environment();
@@ -0,0 +1,73 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "schema.hpp"
+
+#include "util/common/hex.hpp"
+
+#include <algorithm>
+
+namespace cbdc::oracle {
+    namespace {
+        auto to_hex_byte(unsigned int val) -> std::string {
+            auto byte = static_cast<unsigned char>(val);
+            auto ret = std::string(2, '0');
+            hex_encode(&byte, sizeof(byte), ret.data(), true);
+            return ret;
+        }
+    }
+
+    auto shard_partition_name(const config::shard_range_t& range)
+        -> std::string {
+        return "SHARD_" + to_hex_byte(range.first) + "_"
+             + to_hex_byte(range.second);
+    }
+
+    auto make_partitioned_table_ddl(
+        const std::string& table,
+        const std::vector<std::string>& columns,
+        const std::string& key_column,
+        std::vector<config::shard_range_t> ranges)
+        -> std::vector<std::string> {
+        std::sort(ranges.begin(), ranges.end());
+        ranges.erase(std::unique(ranges.begin(), ranges.end()),
+                     ranges.end());
+
+        auto create = "CREATE TABLE " + table + " (";
+        for(size_t i{0}; i < columns.size(); i++) {
+            if(i != 0) {
+                create += ", ";
+            }
+            create += columns[i] + " RAW(32) NOT NULL";
+        }
+        create += ") PARTITION BY RANGE (" + key_column + ") (";
+
+        // RAW values compare bytewise, so a 32-byte key is below the
+        // one-byte bound HEXTORAW('XX') exactly when its first byte is less
+        // than XX.
+        static constexpr auto max_byte = 0xffU;
+        for(size_t i{0}; i < ranges.size(); i++) {
+            const auto& range = ranges[i];
+            if(i != 0) {
+                create += ", ";
+            }
+            create += "PARTITION " + shard_partition_name(range)
+                    + " VALUES LESS THAN (";
+            if(i + 1 == ranges.size() || range.second == max_byte) {
+                create += "MAXVALUE)";
+                break;
+            }
+            create += "HEXTORAW('" + to_hex_byte(range.second + 1U) + "'))";
+        }
+        create += ")";
+
+        // Qualifying the index name with the table's schema keeps the index
+        // next to its table.
+        auto index = "CREATE INDEX " + table + "_" + key_column + "_idx ON "
+                   + table + " (" + key_column + ") LOCAL";
+
+        return {create, index};
+    }
+}
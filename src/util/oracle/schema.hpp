@@ -0,0 +1,46 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_SCHEMA_H_
+#define OPENCBDC_TX_SRC_ORACLE_SCHEMA_H_
+
+#include "util/common/config.hpp"
+
+#include <string>
+#include <vector>
+
+namespace cbdc::oracle {
+    /// Returns the name of the table partition holding the records of a
+    /// shard range.
+    /// \param range inclusive range of first UHS ID bytes.
+    /// \return partition name of the form "SHARD_<start>_<end>", with the
+    ///         bounds as two hex digits each.
+    auto shard_partition_name(const config::shard_range_t& range)
+        -> std::string;
+
+    /// Builds the DDL for a table of RAW(32) hash columns, range
+    /// partitioned on the first byte of one of them.
+    ///
+    /// There is one partition per distinct shard range, so each shard
+    /// writes into its own partition and its own local index segment. The
+    /// partition bounds sit on byte boundaries, matching
+    /// config::hash_in_shard_range. Values beyond the highest range fall
+    /// into the last partition, so the partitions always cover the whole
+    /// key space.
+    /// \param table fully qualified name of the table to create.
+    /// \param columns names of the table's columns.
+    /// \param key_column column whose first byte selects the partition.
+    /// \param ranges shard ranges, in any order and possibly repeated.
+    /// \return statements creating the table and a local index on
+    ///         key_column, without trailing semicolons.
+    auto make_partitioned_table_ddl(
+        const std::string& table,
+        const std::vector<std::string>& columns,
+        const std::string& key_column,
+        std::vector<config::shard_range_t> ranges)
+        -> std::vector<std::string>;
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_SCHEMA_H_
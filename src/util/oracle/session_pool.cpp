@@ -0,0 +1,61 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "session_pool.hpp"
+
+namespace cbdc::oracle {
+    session_pool::session_pool(std::shared_ptr<logging::log> logger,
+                               size_t min_sessions,
+                               size_t max_sessions,
+                               size_t increment,
+                               size_t stmt_cache_size)
+        : m_logger(std::move(logger)),
+          m_min_sessions(min_sessions),
+          m_max_sessions(max_sessions),
+          m_increment(increment),
+          m_stmt_cache_size(stmt_cache_size) {}
+
+    session_pool::~session_pool() {
+        if(m_initialized) {
+            OracleDB_pool_destroy(&m_pool);
+        }
+    }
+
+    auto session_pool::init() -> bool {
+        if(m_initialized) {
+            return true;
+        }
+        std::unique_lock l(m_init_mut);
+        if(m_initialized) {
+            return true;
+        }
+        if(OracleDB_pool_init(&m_pool,
+                              static_cast<unsigned int>(m_min_sessions),
+                              static_cast<unsigned int>(m_max_sessions),
+                              static_cast<unsigned int>(m_increment),
+                              static_cast<unsigned int>(m_stmt_cache_size))
+           != 0) {
+            m_logger->error("Failed to create Oracle session pool");
+            return false;
+        }
+        m_initialized = true;
+        m_logger->info("Created Oracle session pool with up to",
+                       m_max_sessions,
+                       "sessions");
+        return true;
+    }
+
+    auto session_pool::acquire() -> std::optional<connection> {
+        if(!m_initialized) {
+            return std::nullopt;
+        }
+        auto session = std::make_unique<OracleDB>();
+        if(OracleDB_pool_acquire(&m_pool, session.get()) != 0) {
+            m_logger->error("Failed to acquire Oracle session");
+            return std::nullopt;
+        }
+        return connection(std::move(session));
+    }
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_SESSION_POOL_H_
+#define OPENCBDC_TX_SRC_ORACLE_SESSION_POOL_H_
+
+#include "connection.hpp"
+#include "oracleDB.h"
+#include "util/common/logging.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace cbdc::oracle {
+    /// \brief Thread-safe pool of Oracle sessions.
+    ///
+    /// Wraps an OCI session pool created in a threaded environment. Each
+    /// worker thread acquires its own \ref connection and uses it
+    /// exclusively, so concurrent threads never share a service context.
+    /// The pool opens sessions on demand up to its configured maximum, and
+    /// each session caches its prepared statements so repeated queries skip
+    /// the parse.
+    class session_pool {
+      public:
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param min_sessions number of sessions opened when the pool is
+        ///                     created.
+        /// \param max_sessions maximum number of concurrently open sessions.
+        /// \param increment number of sessions opened at once when the pool
+        ///                  needs to grow.
+        /// \param stmt_cache_size number of prepared statements each session
+        ///                        keeps in its statement cache.
+        session_pool(std::shared_ptr<logging::log> logger,
+                     size_t min_sessions,
+                     size_t max_sessions,
+                     size_t increment,
+                     size_t stmt_cache_size);
+
+        /// Destructor. Destroys the OCI pool. All connections must have been
+        /// released.
+        ~session_pool();
+
+        session_pool() = delete;
+        session_pool(const session_pool&) = delete;
+        auto operator=(const session_pool&) -> session_pool& = delete;
+        session_pool(session_pool&&) = delete;
+        auto operator=(session_pool&&) -> session_pool& = delete;
+
+        /// Creates the OCI environment and session pool, unless another
+        /// call already did. Safe to call from several threads at once.
+        /// \return true if the pool was created successfully.
+        auto init() -> bool;
+
+        /// Takes a session from the pool, blocking if all sessions are in
+        /// use and the pool is at its maximum size.
+        /// \return connection, or std::nullopt if the pool is not
+        ///         initialized or a session could not be obtained.
+        auto acquire() -> std::optional<connection>;
+
+      private:
+        std::shared_ptr<logging::log> m_logger;
+        size_t m_min_sessions;
+        size_t m_max_sessions;
+        size_t m_increment;
+        size_t m_stmt_cache_size;
+
+        OracleDBPool m_pool{};
+        std::mutex m_init_mut;
+        std::atomic_bool m_initialized{false};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_SESSION_POOL_H_
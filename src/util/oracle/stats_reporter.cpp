@@ -0,0 +1,66 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stats_reporter.hpp"
+
+namespace cbdc::oracle {
+    namespace {
+        constexpr auto p50 = 0.5;
+        constexpr auto p99 = 0.99;
+
+        auto summarize(const OracleDBTiming& timing) -> std::string {
+            return std::to_string(OracleDB_timing_percentile(&timing, p50))
+                 + "/"
+                 + std::to_string(OracleDB_timing_percentile(&timing, p99))
+                 + "/" + std::to_string(timing.max_us) + "us";
+        }
+    }
+
+    stats_reporter::stats_reporter(std::shared_ptr<logging::log> logger,
+                                   std::string name,
+                                   std::chrono::seconds interval)
+        : m_logger(std::move(logger)),
+          m_name(std::move(name)),
+          m_interval(interval),
+          m_last_report(std::chrono::steady_clock::now()) {}
+
+    void stats_reporter::maybe_report(connection& conn) {
+        if(m_interval.count() == 0) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if(now - m_last_report < m_interval) {
+            return;
+        }
+        report(conn);
+    }
+
+    void stats_reporter::report(connection& conn) {
+        m_last_report = std::chrono::steady_clock::now();
+        const auto& stats = conn.stats();
+        if(stats.statements == 0 && stats.errors == 0) {
+            return;
+        }
+        const auto rows_per_statement
+            = stats.statements == 0 ? 0 : stats.rows / stats.statements;
+        m_logger->info("[Oracle stats]",
+                       m_name,
+                       "statements:",
+                       stats.statements,
+                       "rows:",
+                       stats.rows,
+                       "rows/statement:",
+                       rows_per_statement,
+                       "errors:",
+                       stats.errors,
+                       "prepare p50/p99/max:",
+                       summarize(stats.prepare),
+                       "execute p50/p99/max:",
+                       summarize(stats.execute),
+                       "commit p50/p99/max:",
+                       summarize(stats.commit));
+        conn.reset_stats();
+    }
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_ORACLE_STATS_REPORTER_H_
+#define OPENCBDC_TX_SRC_ORACLE_STATS_REPORTER_H_
+
+#include "connection.hpp"
+#include "util/common/logging.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace cbdc::oracle {
+    /// \brief Periodically logs the client-side statistics of a session.
+    ///
+    /// Each report covers the interval since the previous one: statement,
+    /// row and error counts, mean rows per statement, and approximate
+    /// p50/p99/max latencies for prepare, execute and commit. The session's
+    /// statistics are reset after every report.
+    class stats_reporter {
+      public:
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param name label identifying the session in the log.
+        /// \param interval minimum time between reports. Zero disables
+        ///                 reporting.
+        stats_reporter(std::shared_ptr<logging::log> logger,
+                       std::string name,
+                       std::chrono::seconds interval);
+
+        /// Logs and resets the session's statistics if the reporting
+        /// interval has elapsed. Cheap enough to call after every
+        /// operation.
+        /// \param conn session whose statistics to report.
+        void maybe_report(connection& conn);
+
+        /// Logs and resets the session's statistics unconditionally.
+        /// \param conn session whose statistics to report.
+        void report(connection& conn);
+
+      private:
+        std::shared_ptr<logging::log> m_logger;
+        std::string m_name;
+        std::chrono::seconds m_interval;
+        std::chrono::steady_clock::time_point m_last_report;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_ORACLE_STATS_REPORTER_H_
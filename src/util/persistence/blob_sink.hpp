@@ -0,0 +1,47 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_BLOB_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_BLOB_SINK_H_
+
+#include "util/common/buffer.hpp"
+#include "util/common/hash.hpp"
+
+#include <cstddef>
+
+namespace cbdc::persistence {
+    /// \brief Destination for batches of keyed, variable-length records.
+    ///
+    /// Unlike \ref sink, whose records are fixed-width rows of hashes,
+    /// each record here is one hash key and an opaque blob of any size,
+    /// such as a compressed archive of a dtx's transactions.
+    /// \see file_blob_sink and oracle_blob_sink for the available
+    ///      backends.
+    class blob_sink {
+      public:
+        blob_sink() = default;
+        virtual ~blob_sink() = default;
+        blob_sink(const blob_sink&) = delete;
+        auto operator=(const blob_sink&) -> blob_sink& = delete;
+        blob_sink(blob_sink&&) = delete;
+        auto operator=(blob_sink&&) -> blob_sink& = delete;
+
+        /// Appends a batch of records and makes them durable.
+        /// \param keys array of count record keys.
+        /// \param blobs array of count record contents, in key order.
+        /// \param count number of records in the batch.
+        /// \return true if the sink stored every record.
+        virtual auto
+        append(const hash_t* keys, const buffer* blobs, size_t count)
+            -> bool
+            = 0;
+
+        /// Opens any connection the sink needs, see sink::connect.
+        /// \return true if the sink is ready to accept records.
+        virtual auto connect() -> bool;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_BLOB_SINK_H_
@@ -0,0 +1,219 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "factory.hpp"
+
+#include "file_blob_sink.hpp"
+#include "file_sink.hpp"
+#include "leveldb_sink.hpp"
+#include "null_sink.hpp"
+#include "oracle_blob_sink.hpp"
+#include "oracle_sink.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace cbdc::persistence {
+    namespace {
+        // Every sink with the same pool settings shares one session pool,
+        // so the process holds at most the configured number of sessions
+        // however many sinks it creates.
+        auto make_oracle_pool(const config::options& opts,
+                              const std::shared_ptr<logging::log>& logger)
+            -> std::shared_ptr<oracle::session_pool> {
+            using pool_key = std::tuple<size_t, size_t, size_t, size_t>;
+            static std::mutex pools_mut;
+            static std::map<pool_key, std::weak_ptr<oracle::session_pool>>
+                pools;
+
+            const auto key = pool_key{opts.m_oracle_pool_min_sessions,
+                                      opts.m_oracle_pool_max_sessions,
+                                      opts.m_oracle_pool_increment,
+                                      opts.m_oracle_stmt_cache_size};
+            std::unique_lock<std::mutex> l(pools_mut);
+            auto& existing = pools[key];
+            if(auto pool = existing.lock()) {
+                return pool;
+            }
+            auto pool = std::make_shared<oracle::session_pool>(
+                logger,
+                opts.m_oracle_pool_min_sessions,
+                opts.m_oracle_pool_max_sessions,
+                opts.m_oracle_pool_increment,
+                opts.m_oracle_stmt_cache_size);
+            existing = pool;
+            return pool;
+        }
+
+        auto make_oracle_sink(const config::options& opts,
+                              const std::shared_ptr<logging::log>& logger,
+                              std::shared_ptr<oracle::session_pool> pool,
+                              const std::string& table,
+                              std::vector<std::string> columns,
+                              const std::optional<std::string>& partition)
+            -> std::unique_ptr<sink> {
+            // The thread draining the sink connects it, so creating a
+            // sink never waits for the database
+            return std::make_unique<oracle_sink>(
+                logger,
+                std::move(pool),
+                table,
+                std::move(columns),
+                partition,
+                opts.m_oracle_batch_size,
+                std::chrono::seconds(opts.m_oracle_stats_interval));
+        }
+
+        auto make_local_path(const config::options& opts,
+                             const std::shared_ptr<logging::log>& logger,
+                             const std::string& name)
+            -> std::optional<std::string> {
+            auto ec = std::error_code();
+            std::filesystem::create_directories(opts.m_persistence_dir, ec);
+            if(ec) {
+                logger->error("Failed to create persistence directory",
+                              opts.m_persistence_dir,
+                              ec.message());
+                return std::nullopt;
+            }
+            return (std::filesystem::path(opts.m_persistence_dir) / name)
+                .string();
+        }
+    }
+
+    auto make_sink(const config::options& opts,
+                   const std::shared_ptr<logging::log>& logger,
+                   const std::string& table,
+                   std::vector<std::string> columns,
+                   const std::optional<std::string>& partition)
+        -> std::unique_ptr<sink> {
+        const auto width = columns.size();
+        if(opts.m_persistence_backend == config::persistence_backend::null) {
+            return std::make_unique<null_sink>(width);
+        }
+
+        if(opts.m_persistence_backend
+           == config::persistence_backend::oracle) {
+            return make_oracle_sink(opts,
+                                    logger,
+                                    make_oracle_pool(opts, logger),
+                                    table,
+                                    std::move(columns),
+                                    partition);
+        }
+
+        const auto path = make_local_path(
+            opts,
+            logger,
+            partition.has_value() ? table + "." + partition.value() : table);
+        if(!path.has_value()) {
+            return nullptr;
+        }
+
+        if(opts.m_persistence_backend == config::persistence_backend::file) {
+            auto ret = std::make_unique<file_sink>(width, path.value());
+            if(!ret->open()) {
+                logger->error("Failed to open persistence file",
+                              path.value());
+                return nullptr;
+            }
+            return ret;
+        }
+
+        auto ret = std::make_unique<leveldb_sink>(width, path.value());
+        if(auto err = ret->open()) {
+            logger->error("Failed to open persistence database",
+                          path.value(),
+                          err.value());
+            return nullptr;
+        }
+        return ret;
+    }
+
+    auto make_blob_sink(const config::options& opts,
+                        const std::shared_ptr<logging::log>& logger,
+                        const std::string& table,
+                        const std::string& key_column,
+                        const std::string& blob_column)
+        -> std::unique_ptr<blob_sink> {
+        if(opts.m_persistence_backend == config::persistence_backend::null) {
+            return nullptr;
+        }
+
+        if(opts.m_persistence_backend
+           == config::persistence_backend::oracle) {
+            return std::make_unique<oracle_blob_sink>(
+                logger,
+                make_oracle_pool(opts, logger),
+                table,
+                key_column,
+                blob_column,
+                opts.m_oracle_batch_size,
+                std::chrono::seconds(opts.m_oracle_stats_interval));
+        }
+
+        // LevelDB suits small fixed-width records, so blobs always go to a
+        // flat file
+        const auto path = make_local_path(opts, logger, table + ".blobs");
+        if(!path.has_value()) {
+            return nullptr;
+        }
+        auto ret = std::make_unique<file_blob_sink>(path.value());
+        if(!ret->open()) {
+            logger->error("Failed to open persistence file", path.value());
+            return nullptr;
+        }
+        return ret;
+    }
+
+    auto make_group_commit(const config::options& opts,
+                           const std::shared_ptr<logging::log>& logger,
+                           const std::string& table,
+                           std::vector<std::string> columns,
+                           const std::optional<std::string>& partition)
+        -> std::unique_ptr<group_commit> {
+        auto sinks = std::vector<std::unique_ptr<sink>>();
+        if(opts.m_persistence_backend
+           == config::persistence_backend::oracle) {
+            auto pool = make_oracle_pool(opts, logger);
+            const auto threads
+                = std::max<size_t>(opts.m_oracle_group_commit_threads, 1);
+            for(size_t i = 0; i < threads; i++) {
+                sinks.emplace_back(make_oracle_sink(opts,
+                                                    logger,
+                                                    pool,
+                                                    table,
+                                                    columns,
+                                                    partition));
+            }
+        } else {
+            auto out = make_sink(opts,
+                                 logger,
+                                 table,
+                                 std::move(columns),
+                                 partition);
+            if(!out) {
+                return nullptr;
+            }
+            sinks.emplace_back(std::move(out));
+        }
+        return std::make_unique<group_commit>(
+            logger,
+            std::move(sinks),
+            std::chrono::microseconds(opts.m_oracle_group_commit_window_us),
+            opts.m_oracle_group_commit_max_rows);
+    }
+
+    auto make_retry_policy(const config::options& opts) -> retry_policy {
+        return {
+            std::chrono::milliseconds(opts.m_persistence_retry_backoff_ms),
+            std::chrono::milliseconds(
+                opts.m_persistence_retry_max_backoff_ms),
+            opts.m_persistence_retry_max_attempts};
+    }
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_FACTORY_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_FACTORY_H_
+
+#include "blob_sink.hpp"
+#include "group_commit.hpp"
+#include "sink.hpp"
+#include "write_behind_queue.hpp"
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// Creates and opens the sink selected by
+    /// config::options::m_persistence_backend.
+    /// \param opts configuration options.
+    /// \param logger log instance.
+    /// \param table name of the table, file or database receiving the
+    ///              records.
+    /// \param columns names of the hashes in each record.
+    /// \param partition partition of the table owned by the caller, if
+    ///                  any. The Oracle backend inserts only into this
+    ///                  partition; the file and LevelDB backends keep a
+    ///                  separate file or database per partition.
+    /// \return opened sink, or nullptr if the sink could not be opened. The
+    ///         Oracle sink is returned unconnected, see sink::connect.
+    auto make_sink(const config::options& opts,
+                   const std::shared_ptr<logging::log>& logger,
+                   const std::string& table,
+                   std::vector<std::string> columns,
+                   const std::optional<std::string>& partition
+                   = std::nullopt) -> std::unique_ptr<sink>;
+
+    /// Creates and opens the blob sink selected by
+    /// config::options::m_persistence_backend. The Oracle backend inserts
+    /// into a table with a RAW(32) key column and a BLOB column. The file
+    /// and LevelDB backends both append to <table>.blobs in the
+    /// persistence directory.
+    /// \param opts configuration options.
+    /// \param logger log instance.
+    /// \param table name of the table or file receiving the records.
+    /// \param key_column name of the Oracle column receiving keys.
+    /// \param blob_column name of the Oracle column receiving blobs.
+    /// \return opened sink, or nullptr if the null backend is selected or
+    ///         the sink could not be opened. The Oracle sink is returned
+    ///         unconnected, see blob_sink::connect.
+    auto make_blob_sink(const config::options& opts,
+                        const std::shared_ptr<logging::log>& logger,
+                        const std::string& table,
+                        const std::string& key_column,
+                        const std::string& blob_column)
+        -> std::unique_ptr<blob_sink>;
+
+    /// Creates a group commit over the sink selected by
+    /// config::options::m_persistence_backend. The Oracle backend gets
+    /// config::options::m_oracle_group_commit_threads sinks sharing one
+    /// session pool, so that many groups are in flight at once. Other
+    /// backends get a single sink.
+    /// \param opts configuration options.
+    /// \param logger log instance.
+    /// \param table name of the table, file or database receiving the
+    ///              records.
+    /// \param columns names of the hashes in each record.
+    /// \param partition partition of the table owned by the caller, if
+    ///                  any.
+    /// \return group commit, not yet started, or nullptr if a sink could
+    ///         not be opened.
+    auto make_group_commit(const config::options& opts,
+                           const std::shared_ptr<logging::log>& logger,
+                           const std::string& table,
+                           std::vector<std::string> columns,
+                           const std::optional<std::string>& partition
+                           = std::nullopt) -> std::unique_ptr<group_commit>;
+
+    /// Returns the write-behind queue retry policy configured in
+    /// config::options.
+    /// \param opts configuration options.
+    /// \return retry policy.
+    auto make_retry_policy(const config::options& opts) -> retry_policy;
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_FACTORY_H_
@@ -0,0 +1,100 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "file_blob_sink.hpp"
+
+#include <unistd.h>
+
+namespace cbdc::persistence {
+    file_blob_sink::file_blob_sink(std::string path)
+        : m_path(std::move(path)) {}
+
+    auto file_blob_sink::open() -> bool {
+        m_file.reset(std::fopen(m_path.c_str(), "ab"));
+        return m_file != nullptr;
+    }
+
+    auto file_blob_sink::append(const hash_t* keys,
+                                const buffer* blobs,
+                                size_t count) -> bool {
+        if(!m_file) {
+            return false;
+        }
+        auto* f = m_file.get();
+        if(std::fseek(f, 0, SEEK_END) != 0) {
+            return false;
+        }
+        const auto start = std::ftell(f);
+        if(start < 0) {
+            return false;
+        }
+        auto ok = true;
+        for(size_t i{0}; ok && i < count; i++) {
+            const auto len = static_cast<uint64_t>(blobs[i].size());
+            ok = std::fwrite(keys[i].data(), 1, keys[i].size(), f)
+                    == keys[i].size()
+              && std::fwrite(&len, sizeof(len), 1, f) == 1
+              && std::fwrite(blobs[i].data(), 1, blobs[i].size(), f)
+                     == blobs[i].size();
+        }
+        ok = ok && std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+        if(!ok) {
+            // A retried append must not follow a partial record
+            rollback(start);
+        }
+        return ok;
+    }
+
+    auto file_blob_sink::rollback(long offset) -> bool {
+        // Closing flushes whatever the stream still buffers, so the file
+        // is truncated afterwards and reopened for the next append
+        m_file.reset();
+        return ::truncate(m_path.c_str(), static_cast<off_t>(offset)) == 0
+            && open();
+    }
+
+    auto scan_blob_file(
+        const std::string& path,
+        const std::function<void(const hash_t&, buffer&&)>& fn) -> bool {
+        auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>(
+            std::fopen(path.c_str(), "rb"),
+            &std::fclose);
+        if(!file) {
+            return false;
+        }
+        auto* f = file.get();
+        if(std::fseek(f, 0, SEEK_END) != 0) {
+            return false;
+        }
+        const auto size = std::ftell(f);
+        if(size < 0 || std::fseek(f, 0, SEEK_SET) != 0) {
+            return false;
+        }
+        auto key = hash_t();
+        for(;;) {
+            const auto n = std::fread(key.data(), 1, key.size(), f);
+            if(n == 0) {
+                return std::ferror(f) == 0;
+            }
+            // Anything after the last whole record is a torn write
+            uint64_t len{};
+            if(n != key.size()
+               || std::fread(&len, sizeof(len), 1, f) != 1) {
+                return false;
+            }
+            // A corrupt length must not allocate past the end of the file
+            const auto pos = std::ftell(f);
+            if(pos < 0 || len > static_cast<uint64_t>(size - pos)) {
+                return false;
+            }
+            auto blob = buffer();
+            blob.extend(len);
+            if(std::fread(blob.data(), 1, len, f) != len) {
+                return false;
+            }
+            fn(key, std::move(blob));
+        }
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_FILE_BLOB_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_FILE_BLOB_SINK_H_
+
+#include "blob_sink.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace cbdc::persistence {
+    /// \brief Blob sink which appends records to a local file.
+    ///
+    /// Each record is written as its key, the blob length as a 64-bit
+    /// integer in host byte order, then the blob itself. Every append is
+    /// synced to disk before it returns. A failed append is truncated
+    /// away, so a retry never follows a partial record.
+    class file_blob_sink final : public blob_sink {
+      public:
+        /// Constructor.
+        /// \param path file to append to. Created if it does not exist.
+        explicit file_blob_sink(std::string path);
+
+        /// Opens the file for appending.
+        /// \return true if the file was opened.
+        auto open() -> bool;
+
+        /// Appends the records to the file and syncs it to disk.
+        /// \param keys array of count record keys.
+        /// \param blobs array of count record contents.
+        /// \param count number of records.
+        /// \return true if every record was written and synced.
+        auto append(const hash_t* keys, const buffer* blobs, size_t count)
+            -> bool override;
+
+      private:
+        /// Closes the file, truncates it to the given size and reopens it.
+        auto rollback(long offset) -> bool;
+
+        std::string m_path;
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> m_file{
+            nullptr,
+            &std::fclose};
+    };
+
+    /// Reads every record from a file written by \ref file_blob_sink.
+    /// \param path file to read.
+    /// \param fn function called with each record's key and blob, in the
+    ///           order they were appended.
+    /// \return false if the file could not be opened, ends with a
+    ///         truncated record or holds a length past its end.
+    auto scan_blob_file(
+        const std::string& path,
+        const std::function<void(const hash_t&, buffer&&)>& fn) -> bool;
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_FILE_BLOB_SINK_H_
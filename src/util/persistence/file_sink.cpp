@@ -0,0 +1,35 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "file_sink.hpp"
+
+#include <unistd.h>
+
+namespace cbdc::persistence {
+    file_sink::file_sink(size_t width, std::string path)
+        : sink(width),
+          m_path(std::move(path)) {}
+
+    auto file_sink::open() -> bool {
+        m_file.reset(std::fopen(m_path.c_str(), "ab"));
+        return m_file != nullptr;
+    }
+
+    auto file_sink::append(const hash_t* records, size_t count) -> bool {
+        if(!m_file) {
+            return false;
+        }
+        const auto n = count * width();
+        return std::fwrite(records, sizeof(hash_t), n, m_file.get()) == n;
+    }
+
+    auto file_sink::flush() -> bool {
+        if(!m_file) {
+            return false;
+        }
+        return std::fflush(m_file.get()) == 0
+            && fsync(fileno(m_file.get())) == 0;
+    }
+}
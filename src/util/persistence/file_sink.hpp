@@ -0,0 +1,50 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_FILE_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_FILE_SINK_H_
+
+#include "sink.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace cbdc::persistence {
+    /// \brief Sink which appends records to a local file.
+    ///
+    /// Records are written in their raw binary form, width() * hash_size
+    /// bytes each, with no framing. \ref flush syncs the file to disk so
+    /// appended records survive a crash.
+    class file_sink final : public sink {
+      public:
+        /// Constructor.
+        /// \param width number of hashes in each record.
+        /// \param path file to append to. Created if it does not exist.
+        file_sink(size_t width, std::string path);
+
+        /// Opens the file for appending.
+        /// \return true if the file was opened.
+        auto open() -> bool;
+
+        /// Appends the records to the file buffer.
+        /// \param records contiguous array of count * width() hashes.
+        /// \param count number of records.
+        /// \return true if every record was written.
+        auto append(const hash_t* records, size_t count) -> bool override;
+
+        /// Flushes the file buffer and syncs the file to disk.
+        /// \return true if the file was synced.
+        auto flush() -> bool override;
+
+      private:
+        std::string m_path;
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> m_file{
+            nullptr,
+            &std::fclose};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_FILE_SINK_H_
@@ -0,0 +1,192 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "group_commit.hpp"
+
+#include "util/common/affinity.hpp"
+
+#include <algorithm>
+
+namespace cbdc::persistence {
+    namespace {
+        auto single(std::unique_ptr<sink> out)
+            -> std::vector<std::unique_ptr<sink>> {
+            auto ret = std::vector<std::unique_ptr<sink>>();
+            ret.emplace_back(std::move(out));
+            return ret;
+        }
+    }
+
+    group_commit::group_commit(std::shared_ptr<logging::log> logger,
+                               std::unique_ptr<sink> out,
+                               std::chrono::microseconds window,
+                               size_t max_rows)
+        : group_commit(std::move(logger),
+                       single(std::move(out)),
+                       window,
+                       max_rows) {}
+
+    group_commit::group_commit(std::shared_ptr<logging::log> logger,
+                               std::vector<std::unique_ptr<sink>> sinks,
+                               std::chrono::microseconds window,
+                               size_t max_rows)
+        : m_logger(std::move(logger)),
+          m_sinks(std::move(sinks)),
+          m_width(!m_sinks.empty() && m_sinks.front()
+                      ? m_sinks.front()->width()
+                      : 1),
+          m_window(window),
+          m_max_rows(std::max<size_t>(max_rows, 1)) {}
+
+    void group_commit::waiter::complete(bool ok) {
+        if(m_done.has_value()) {
+            m_done->set_value(ok);
+        } else if(m_cb) {
+            m_cb(ok);
+        }
+    }
+
+    group_commit::~group_commit() {
+        stop();
+    }
+
+    auto group_commit::start() -> bool {
+        if(m_sinks.empty()
+           || std::any_of(m_sinks.begin(), m_sinks.end(), [&](auto& s) {
+                  return !s || s->width() != m_width;
+              })) {
+            return false;
+        }
+        {
+            std::unique_lock l(m_mut);
+            if(m_running) {
+                return true;
+            }
+            m_running = true;
+        }
+        for(auto& out : m_sinks) {
+            m_threads.emplace_back([&, sink_ptr = out.get()]() {
+                pin_current_thread(thread_role::persistence);
+                leader_loop(*sink_ptr);
+            });
+        }
+        return true;
+    }
+
+    auto group_commit::enqueue(const hash_t* record, waiter& w) -> bool {
+        auto wake = false;
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return false;
+            }
+            m_pending.insert(m_pending.end(), record, record + m_width);
+            m_waiters.emplace_back(std::move(w));
+            // A leader only needs waking to open a group or to close a
+            // full one early.
+            wake = m_waiters.size() == 1 || m_waiters.size() >= m_max_rows;
+        }
+        if(wake) {
+            m_cv.notify_one();
+        }
+        return true;
+    }
+
+    auto group_commit::submit(const hash_t* record) -> std::future<bool> {
+        auto done = std::promise<bool>();
+        auto fut = done.get_future();
+        auto w = waiter{std::move(done), nullptr};
+        if(!enqueue(record, w)) {
+            w.complete(false);
+        }
+        return fut;
+    }
+
+    void group_commit::submit(const hash_t* record, callback_type cb) {
+        auto w = waiter{std::nullopt, std::move(cb)};
+        if(!enqueue(record, w)) {
+            w.complete(false);
+        }
+    }
+
+    auto group_commit::submit(const hash_t& id) -> std::future<bool> {
+        if(m_width != 1) {
+            auto done = std::promise<bool>();
+            done.set_value(false);
+            return done.get_future();
+        }
+        return submit(&id);
+    }
+
+    void group_commit::stop() {
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_cv.notify_all();
+        for(auto& t : m_threads) {
+            if(t.joinable()) {
+                t.join();
+            }
+        }
+        m_threads.clear();
+    }
+
+    void group_commit::leader_loop(sink& out) {
+        // Records queue up while the sink connects
+        if(!out.connect()) {
+            m_logger->warn("Persistence sink not ready, will retry writes");
+        }
+        auto records = std::vector<hash_t>();
+        auto waiters = std::vector<waiter>();
+        while(true) {
+            {
+                std::unique_lock l(m_mut);
+                m_cv.wait(l, [&]() {
+                    return !m_running || !m_waiters.empty();
+                });
+                if(m_waiters.empty()) {
+                    // Only reachable once stopped and fully drained.
+                    return;
+                }
+                // Hold the group open so concurrent callers can join it.
+                m_cv.wait_for(l, m_window, [&]() {
+                    return !m_running || m_waiters.size() >= m_max_rows;
+                });
+                // Another leader may have taken the group meanwhile
+                if(m_waiters.empty()) {
+                    continue;
+                }
+                auto count = std::min(m_max_rows, m_waiters.size());
+                auto waiters_end = m_waiters.begin()
+                                 + static_cast<std::ptrdiff_t>(count);
+                waiters.assign(std::make_move_iterator(m_waiters.begin()),
+                               std::make_move_iterator(waiters_end));
+                m_waiters.erase(m_waiters.begin(), waiters_end);
+                auto records_end = m_pending.begin()
+                                 + static_cast<std::ptrdiff_t>(count
+                                                               * m_width);
+                records.assign(m_pending.begin(), records_end);
+                m_pending.erase(m_pending.begin(), records_end);
+            }
+
+            auto ok = out.append(records.data(), waiters.size())
+                   && out.flush();
+            if(!ok) {
+                m_logger->error("Failed to commit",
+                                waiters.size(),
+                                "grouped records");
+            }
+            for(auto& w : waiters) {
+                w.complete(ok);
+            }
+            records.clear();
+            waiters.clear();
+        }
+    }
+}
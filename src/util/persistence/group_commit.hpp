@@ -0,0 +1,140 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_GROUP_COMMIT_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_GROUP_COMMIT_H_
+
+#include "sink.hpp"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// \brief Shares one sink append and flush between concurrent writers.
+    ///
+    /// Callers submit records and receive a future that completes once the
+    /// record is durable. A leader thread waits for the first pending
+    /// record, keeps the group open for up to the commit window or until it
+    /// holds the maximum number of records, and then appends and flushes
+    /// the whole group at once. Each caller pays at most one window of
+    /// extra latency while the backend sees one commit per group rather
+    /// than one per record. With \ref oracle_sink, each group is one array
+    /// insert and one redo flush.
+    ///
+    /// Given several sinks, each gets its own leader thread, so while one
+    /// group waits for its round trip the next can be formed and sent
+    /// through another sink. A few threads then keep many records in
+    /// flight. Groups may commit out of order. Callers on an event loop
+    /// can pass a callback instead of waiting on a future.
+    class group_commit {
+      public:
+        /// Function called with whether a record was committed. Called on
+        /// a leader thread.
+        using callback_type = std::function<void(bool)>;
+
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param out sink receiving the records. May be nullptr, in which
+        ///            case \ref start fails.
+        /// \param window maximum time the first record in a group waits for
+        ///               others to join it.
+        /// \param max_rows number of records which closes a group early.
+        group_commit(std::shared_ptr<logging::log> logger,
+                     std::unique_ptr<sink> out,
+                     std::chrono::microseconds window,
+                     size_t max_rows);
+
+        /// Constructor for a group of leader threads.
+        /// \param logger log instance.
+        /// \param sinks sinks receiving the records, one per leader thread.
+        ///              All must have the same width. If empty, or if any
+        ///              is nullptr, \ref start fails.
+        /// \param window maximum time the first record in a group waits for
+        ///               others to join it.
+        /// \param max_rows number of records which closes a group early.
+        group_commit(std::shared_ptr<logging::log> logger,
+                     std::vector<std::unique_ptr<sink>> sinks,
+                     std::chrono::microseconds window,
+                     size_t max_rows);
+
+        /// Destructor. Calls \ref stop.
+        ~group_commit();
+
+        group_commit() = delete;
+        group_commit(const group_commit&) = delete;
+        auto operator=(const group_commit&) -> group_commit& = delete;
+        group_commit(group_commit&&) = delete;
+        auto operator=(group_commit&&) -> group_commit& = delete;
+
+        /// Launches the leader threads.
+        /// \return true if there are sinks to commit into.
+        auto start() -> bool;
+
+        /// Adds a record to the next group commit.
+        /// \param record sink::width() hashes, in column order.
+        /// \return future set to true once the record is committed, or
+        ///         false if the commit failed or the group commit is not
+        ///         running.
+        auto submit(const hash_t* record) -> std::future<bool>;
+
+        /// Adds a single-hash record to the next group commit.
+        /// \param id hash to persist. The sink must be one hash wide.
+        /// \return future set as for \ref submit.
+        auto submit(const hash_t& id) -> std::future<bool>;
+
+        /// Adds a record to the next group commit without blocking a
+        /// thread on its result.
+        /// \param record sink::width() hashes, in column order.
+        /// \param cb function called once the record is committed or the
+        ///           commit failed. Called before returning if the group
+        ///           commit is not running.
+        void submit(const hash_t* record, callback_type cb);
+
+        /// Stops accepting new records, commits any pending records and
+        /// joins the leader threads.
+        void stop();
+
+      private:
+        /// Caller waiting for a pending record, through either a promise
+        /// or a callback.
+        struct waiter {
+            std::optional<std::promise<bool>> m_done;
+            callback_type m_cb;
+
+            void complete(bool ok);
+        };
+
+        /// Queues a record, moving from the waiter only if it was queued.
+        auto enqueue(const hash_t* record, waiter& w) -> bool;
+        void leader_loop(sink& out);
+
+        std::shared_ptr<logging::log> m_logger;
+        std::vector<std::unique_ptr<sink>> m_sinks;
+        size_t m_width;
+        std::chrono::microseconds m_window;
+        size_t m_max_rows;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        /// Pending records stored back to back, m_width hashes each.
+        std::vector<hash_t> m_pending;
+        /// One waiter per pending record.
+        std::vector<waiter> m_waiters;
+        bool m_running{false};
+
+        std::vector<std::thread> m_threads;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_GROUP_COMMIT_H_
@@ -0,0 +1,201 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hash_export.hpp"
+
+#include "crypto/siphash.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <zstd.h>
+
+namespace cbdc::persistence {
+    namespace {
+        constexpr auto tmp_ext = ".tmp";
+        /// Identifies export files, "UHSEXP01" in little-endian byte order.
+        constexpr uint64_t file_magic = 0x3130505845534855;
+        constexpr uint64_t checksum_k0 = 0x686578;
+        constexpr uint64_t checksum_k1 = 0x707274;
+        /// Limits the allocation made for a chunk read from a corrupt
+        /// file.
+        constexpr uint64_t max_chunk_hashes = 1 << 24;
+
+        auto chunk_checksum(const hash_t* hashes, size_t count) -> uint64_t {
+            return CSipHasher(checksum_k0, checksum_k1)
+                .Write(hashes->data(), count * sizeof(hash_t))
+                .Finalize();
+        }
+
+        auto read_u64(std::ifstream& in, uint64_t& val) -> bool {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            in.read(reinterpret_cast<char*>(&val), sizeof(val));
+            return in.good();
+        }
+    }
+
+    hash_export_writer::hash_export_writer(std::string path,
+                                           uint64_t label,
+                                           int compression_level,
+                                           size_t chunk_hashes)
+        : m_path(std::move(path)),
+          m_tmp_path(m_path + tmp_ext),
+          m_label(label),
+          m_compression_level(compression_level),
+          m_chunk_hashes(std::max<size_t>(chunk_hashes, 1)) {
+        m_chunk.reserve(m_chunk_hashes);
+    }
+
+    auto hash_export_writer::open() -> bool {
+        m_out.open(m_tmp_path,
+                   std::ios::out | std::ios::trunc | std::ios::binary);
+        m_ok = m_out.good() && write_u64(file_magic) && write_u64(m_label);
+        return m_ok;
+    }
+
+    auto hash_export_writer::add(const hash_t& val) -> bool {
+        if(!m_ok || (m_last.has_value() && !(m_last.value() < val))) {
+            m_ok = false;
+            return false;
+        }
+        m_last = val;
+        m_chunk.push_back(val);
+        m_count++;
+        if(m_chunk.size() == m_chunk_hashes) {
+            m_ok = write_chunk();
+        }
+        return m_ok;
+    }
+
+    auto hash_export_writer::finish() -> bool {
+        if(!m_ok) {
+            return false;
+        }
+        if(!m_chunk.empty() && !write_chunk()) {
+            m_ok = false;
+            return false;
+        }
+        // A zero-length chunk marks the trailer
+        m_ok = write_u64(0) && write_u64(m_count);
+        m_out.flush();
+        m_out.close();
+        if(!m_ok || m_out.fail()) {
+            m_ok = false;
+            return false;
+        }
+        auto err = std::error_code();
+        std::filesystem::rename(m_tmp_path, m_path, err);
+        m_ok = !err;
+        return m_ok;
+    }
+
+    auto hash_export_writer::count() const -> uint64_t {
+        return m_count;
+    }
+
+    auto hash_export_writer::write_chunk() -> bool {
+        const auto raw_len = m_chunk.size() * sizeof(hash_t);
+        m_compressed.resize(ZSTD_compressBound(raw_len));
+        const auto len = ZSTD_compress(m_compressed.data(),
+                                       m_compressed.size(),
+                                       m_chunk.data(),
+                                       raw_len,
+                                       m_compression_level);
+        if(ZSTD_isError(len) != 0) {
+            return false;
+        }
+        auto ok = write_u64(m_chunk.size()) && write_u64(len)
+               && write_u64(chunk_checksum(m_chunk.data(), m_chunk.size()));
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        m_out.write(reinterpret_cast<const char*>(m_compressed.data()),
+                    static_cast<std::streamsize>(len));
+        m_chunk.clear();
+        return ok && m_out.good();
+    }
+
+    auto hash_export_writer::write_u64(uint64_t val) -> bool {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        m_out.write(reinterpret_cast<const char*>(&val), sizeof(val));
+        return m_out.good();
+    }
+
+    auto scan_hash_export(
+        const std::string& path,
+        const std::function<void(const hash_t*, size_t)>& fn)
+        -> std::optional<uint64_t> {
+        auto in = std::ifstream(path, std::ios::in | std::ios::binary);
+        auto magic = uint64_t();
+        auto label = uint64_t();
+        if(!read_u64(in, magic) || magic != file_magic
+           || !read_u64(in, label)) {
+            return std::nullopt;
+        }
+
+        auto compressed = std::vector<char>();
+        auto chunk = std::vector<hash_t>();
+        auto last = std::optional<hash_t>();
+        uint64_t total{0};
+        while(true) {
+            auto count = uint64_t();
+            if(!read_u64(in, count)) {
+                return std::nullopt;
+            }
+            if(count == 0) {
+                auto expected = uint64_t();
+                if(!read_u64(in, expected) || expected != total) {
+                    return std::nullopt;
+                }
+                return label;
+            }
+            auto len = uint64_t();
+            auto checksum = uint64_t();
+            if(count > max_chunk_hashes || !read_u64(in, len)
+               || len > ZSTD_compressBound(count * sizeof(hash_t))
+               || !read_u64(in, checksum)) {
+                return std::nullopt;
+            }
+            compressed.resize(len);
+            in.read(compressed.data(), static_cast<std::streamsize>(len));
+            if(!in.good()) {
+                return std::nullopt;
+            }
+
+            chunk.resize(count);
+            const auto raw_len = ZSTD_decompress(chunk.data(),
+                                                 count * sizeof(hash_t),
+                                                 compressed.data(),
+                                                 compressed.size());
+            if(ZSTD_isError(raw_len) != 0
+               || raw_len != count * sizeof(hash_t)
+               || chunk_checksum(chunk.data(), count) != checksum) {
+                return std::nullopt;
+            }
+            for(const auto& h : chunk) {
+                if(last.has_value() && !(last.value() < h)) {
+                    return std::nullopt;
+                }
+                last = h;
+            }
+            total += count;
+            fn(chunk.data(), chunk.size());
+        }
+    }
+
+    auto read_hash_export(const std::string& path)
+        -> std::optional<hash_export> {
+        auto ret = hash_export();
+        auto label = scan_hash_export(
+            path,
+            [&](const hash_t* hashes, size_t count) {
+                ret.m_hashes.insert(ret.m_hashes.end(),
+                                    hashes,
+                                    hashes + count);
+            });
+        if(!label.has_value()) {
+            return std::nullopt;
+        }
+        ret.m_label = label.value();
+        return ret;
+    }
+}
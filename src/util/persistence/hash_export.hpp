@@ -0,0 +1,110 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_HASH_EXPORT_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_HASH_EXPORT_H_
+
+#include "util/common/hash.hpp"
+
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// \brief Writes a sorted set of hashes to a file of compressed chunks.
+    ///
+    /// The file starts with a header holding a caller-chosen label, such as
+    /// the block height the set was exported at. Hashes follow in ascending
+    /// order, in zstd-compressed chunks of up to chunk_hashes hashes, each
+    /// with a checksum of its contents. A trailer holding the total number
+    /// of hashes ends the file. The file is written under a temporary name
+    /// and only appears at its path once complete, so readers never see a
+    /// partial export.
+    class hash_export_writer {
+      public:
+        /// Default number of hashes in each chunk.
+        static constexpr size_t default_chunk_hashes = 16384;
+
+        /// Constructor.
+        /// \param path file to write.
+        /// \param label value to store in the file header.
+        /// \param compression_level zstd compression level.
+        /// \param chunk_hashes maximum number of hashes in each chunk.
+        hash_export_writer(std::string path,
+                           uint64_t label,
+                           int compression_level = 1,
+                           size_t chunk_hashes = default_chunk_hashes);
+
+        /// Creates the temporary file and writes the header.
+        /// \return true if the file was created.
+        auto open() -> bool;
+
+        /// Adds a hash to the export, writing out the current chunk once
+        /// it is full.
+        /// \param val hash to add. Must be greater than the previous hash.
+        /// \return false if the hash is out of order or writing failed.
+        auto add(const hash_t& val) -> bool;
+
+        /// Writes the last chunk and the trailer, then moves the file to
+        /// its final path.
+        /// \return true if the export is complete.
+        auto finish() -> bool;
+
+        /// Returns the number of hashes added so far.
+        /// \return number of hashes.
+        [[nodiscard]] auto count() const -> uint64_t;
+
+      private:
+        auto write_chunk() -> bool;
+        auto write_u64(uint64_t val) -> bool;
+
+        std::string m_path;
+        std::string m_tmp_path;
+        uint64_t m_label;
+        int m_compression_level;
+        size_t m_chunk_hashes;
+
+        std::ofstream m_out;
+        std::vector<hash_t> m_chunk;
+        std::vector<unsigned char> m_compressed;
+        std::optional<hash_t> m_last;
+        uint64_t m_count{0};
+        bool m_ok{false};
+    };
+
+    /// Contents of a file written by \ref hash_export_writer.
+    struct hash_export {
+        /// Label from the file header.
+        uint64_t m_label{};
+        /// Every hash in the file, sorted.
+        std::vector<hash_t> m_hashes;
+    };
+
+    /// Reads a file written by \ref hash_export_writer one chunk at a
+    /// time, so files larger than memory can be processed. Checks the
+    /// checksum and ordering of each chunk before passing it on.
+    /// \param path file to read.
+    /// \param fn function called with each chunk of hashes, in ascending
+    ///           order. Chunks already passed to fn must be discarded if
+    ///           the scan fails.
+    /// \return label from the file header, or std::nullopt if the file is
+    ///         missing, truncated or corrupt.
+    auto scan_hash_export(
+        const std::string& path,
+        const std::function<void(const hash_t*, size_t)>& fn)
+        -> std::optional<uint64_t>;
+
+    /// Reads a whole file written by \ref hash_export_writer, checking the
+    /// checksum of each chunk and that the file is complete.
+    /// \param path file to read.
+    /// \return file contents, or std::nullopt if the file is missing,
+    ///         truncated or corrupt.
+    auto read_hash_export(const std::string& path)
+        -> std::optional<hash_export>;
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_HASH_EXPORT_H_
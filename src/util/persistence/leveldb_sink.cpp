@@ -0,0 +1,56 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "leveldb_sink.hpp"
+
+#include <leveldb/write_batch.h>
+
+namespace cbdc::persistence {
+    leveldb_sink::leveldb_sink(size_t width,
+                               std::string db_dir,
+                               const config::leveldb_profile& profile)
+        : sink(width),
+          m_db_dir(std::move(db_dir)),
+          m_db_opts(profile) {}
+
+    auto leveldb_sink::open() -> std::optional<std::string> {
+        leveldb::DB* db_ptr{};
+        const auto res
+            = leveldb::DB::Open(m_db_opts.get(), m_db_dir, &db_ptr);
+        if(!res.ok()) {
+            return res.ToString();
+        }
+        m_db.reset(db_ptr);
+        return std::nullopt;
+    }
+
+    auto leveldb_sink::append(const hash_t* records, size_t count) -> bool {
+        if(!m_db) {
+            return false;
+        }
+        const auto w = width();
+        leveldb::WriteBatch batch;
+        for(size_t i{0}; i < count; i++) {
+            const auto* rec
+                = reinterpret_cast<const char*>(records[i * w].data());
+            auto key = leveldb::Slice(rec, hash_size);
+            auto val = leveldb::Slice(rec + hash_size, (w - 1) * hash_size);
+            batch.Put(key, val);
+        }
+        return m_db->Write(m_write_options, &batch).ok();
+    }
+
+    auto leveldb_sink::flush() -> bool {
+        if(!m_db) {
+            return false;
+        }
+        // An empty synchronous write syncs the log, and with it every
+        // earlier unsynced write.
+        auto sync_options = leveldb::WriteOptions();
+        sync_options.sync = true;
+        leveldb::WriteBatch batch;
+        return m_db->Write(sync_options, &batch).ok();
+    }
+}
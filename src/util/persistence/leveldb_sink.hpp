@@ -0,0 +1,59 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_LEVELDB_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_LEVELDB_SINK_H_
+
+#include "sink.hpp"
+#include "util/common/leveldb_options.hpp"
+
+#include <leveldb/db.h>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace cbdc::persistence {
+    /// \brief Sink which stores records in a local LevelDB database.
+    ///
+    /// The first hash of each record is the key and the remaining hashes,
+    /// if any, are the value. Each appended batch is written atomically
+    /// without syncing. \ref flush forces a synchronous write so that all
+    /// previous batches are durable.
+    class leveldb_sink final : public sink {
+      public:
+        /// Constructor.
+        /// \param width number of hashes in each record. Must be at least
+        ///              one.
+        /// \param db_dir directory of the database. Created if it does not
+        ///               exist.
+        /// \param profile tuning of the database.
+        leveldb_sink(size_t width,
+                     std::string db_dir,
+                     const config::leveldb_profile& profile = {});
+
+        /// Opens the database.
+        /// \return std::nullopt on success, or an error message.
+        auto open() -> std::optional<std::string>;
+
+        /// Writes the records in a single batch.
+        /// \param records contiguous array of count * width() hashes.
+        /// \param count number of records.
+        /// \return true if the batch was written.
+        auto append(const hash_t* records, size_t count) -> bool override;
+
+        /// Syncs the database log to disk.
+        /// \return true if the sync succeeded.
+        auto flush() -> bool override;
+
+      private:
+        std::string m_db_dir;
+        /// Must outlive m_db.
+        leveldb_options m_db_opts;
+        std::unique_ptr<leveldb::DB> m_db{};
+        leveldb::WriteOptions m_write_options{};
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_LEVELDB_SINK_H_
@@ -0,0 +1,19 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "null_sink.hpp"
+
+namespace cbdc::persistence {
+    null_sink::null_sink(size_t width) : sink(width) {}
+
+    auto null_sink::append(const hash_t* /* records */, size_t /* count */)
+        -> bool {
+        return true;
+    }
+
+    auto null_sink::flush() -> bool {
+        return true;
+    }
+}
@@ -0,0 +1,30 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_NULL_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_NULL_SINK_H_
+
+#include "sink.hpp"
+
+namespace cbdc::persistence {
+    /// Sink which discards every record. Used to take persistence off the
+    /// hot path entirely, for example when benchmarking.
+    class null_sink final : public sink {
+      public:
+        /// Constructor.
+        /// \param width number of hashes in each record.
+        explicit null_sink(size_t width);
+
+        /// Discards the records.
+        /// \return true.
+        auto append(const hash_t* records, size_t count) -> bool override;
+
+        /// No-op.
+        /// \return true.
+        auto flush() -> bool override;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_NULL_SINK_H_
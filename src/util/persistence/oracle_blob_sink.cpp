@@ -0,0 +1,128 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "oracle_blob_sink.hpp"
+
+#include "util/common/metrics.hpp"
+#include "util/oracle/hash_insert.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cbdc::persistence {
+    oracle_blob_sink::oracle_blob_sink(
+        std::shared_ptr<logging::log> logger,
+        std::shared_ptr<oracle::session_pool> pool,
+        std::string table,
+        const std::string& key_column,
+        const std::string& blob_column,
+        size_t batch_size,
+        std::chrono::seconds stats_interval)
+        : m_logger(std::move(logger)),
+          m_pool(std::move(pool)),
+          m_table(std::move(table)),
+          m_query(oracle::make_insert_query(m_table,
+                                            std::vector<std::string>{
+                                                key_column,
+                                                blob_column})),
+          m_batch_size(std::max<size_t>(batch_size, 1)),
+          m_stats(m_logger, m_table, stats_interval) {}
+
+    oracle_blob_sink::~oracle_blob_sink() {
+        if(m_conn.has_value()) {
+            m_stats.report(m_conn.value());
+        }
+    }
+
+    auto oracle_blob_sink::connect() -> bool {
+        if(m_conn.has_value()) {
+            return true;
+        }
+        if(!m_pool->init()) {
+            return false;
+        }
+        m_conn = m_pool->acquire();
+        if(!m_conn.has_value()) {
+            m_logger->error("Failed to connect to Oracle Autonomous Database");
+            return false;
+        }
+        return true;
+    }
+
+    auto oracle_blob_sink::append(const hash_t* keys,
+                                  const buffer* blobs,
+                                  size_t count) -> bool {
+        static auto& persist_latency
+            = metrics::registry::global().get_latency_histogram(
+                "oracle_blob_persist_seconds",
+                "Time to insert a batch of blob records into Oracle.");
+        auto timer = metrics::scoped_timer(persist_latency);
+        if(!connect()) {
+            return false;
+        }
+        auto ret = true;
+        for(size_t i{0}; ret && i < count;) {
+            auto n = batch_rows(&blobs[i], count - i);
+            ret = insert(&keys[i], &blobs[i], n);
+            i += n;
+        }
+        if(m_blobs.capacity() > max_batch_bytes) {
+            m_blobs = std::vector<unsigned char>();
+        }
+        ret = ret && m_conn->commit();
+        if(!ret) {
+            m_conn->rollback();
+        }
+        m_stats.maybe_report(m_conn.value());
+        if(!ret && m_conn->lost()) {
+            m_logger->warn("Lost Oracle session for", m_table);
+            m_conn->discard();
+            m_conn.reset();
+        }
+        return ret;
+    }
+
+    auto oracle_blob_sink::batch_rows(const buffer* blobs, size_t count) const
+        -> size_t {
+        size_t width{1};
+        size_t n{0};
+        while(n < count && n < m_batch_size) {
+            auto row_width = std::max(width, blobs[n].size());
+            if(n != 0 && row_width * (n + 1) > max_batch_bytes) {
+                break;
+            }
+            width = row_width;
+            n++;
+        }
+        return n;
+    }
+
+    auto oracle_blob_sink::insert(const hash_t* keys,
+                                  const buffer* blobs,
+                                  size_t count) -> bool {
+        // Each row gets as much room as the largest blob in the batch
+        size_t width{1};
+        for(size_t i{0}; i < count; i++) {
+            width = std::max(width, blobs[i].size());
+        }
+        m_keys.assign(keys, keys + count);
+        m_blobs.resize(count * width);
+        m_lens.resize(count);
+        for(size_t i{0}; i < count; i++) {
+            std::memcpy(&m_blobs[i * width], blobs[i].data(), blobs[i].size());
+            m_lens[i] = static_cast<uint32_t>(blobs[i].size());
+        }
+        // The statement comes from the session's cache, and is rebound each
+        // time as the buffers may have moved
+        auto stmt = m_conn->prepare(m_query);
+        if(!stmt.has_value()) {
+            m_logger->error("Failed to prepare insert into", m_table);
+            return false;
+        }
+        return stmt->bind_raw(1, m_keys.data())
+            && stmt->bind_blob(2, m_blobs.data(), width, m_lens.data())
+            && stmt->execute(count);
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_ORACLE_BLOB_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_ORACLE_BLOB_SINK_H_
+
+#include "blob_sink.hpp"
+#include "util/common/logging.hpp"
+#include "util/oracle/session_pool.hpp"
+#include "util/oracle/stats_reporter.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// \brief Blob sink which inserts records into an Oracle table.
+    ///
+    /// Each record becomes one row holding its key in a RAW(32) column and
+    /// its blob in a BLOB column. Up to batch_size rows are sent per array
+    /// insert, with each row's blob bound through the LOB data interface,
+    /// and a whole \ref append commits once. Array binds give every row
+    /// the width of the batch's largest blob, so a batch also ends before
+    /// that padded size exceeds \ref max_batch_bytes. Like oracle_sink,
+    /// the sink connects on its draining thread, drops a lost session and
+    /// reconnects on the next append. It must only be used from one
+    /// thread at a time.
+    class oracle_blob_sink final : public blob_sink {
+      public:
+        /// Maximum size of the padded blob bind buffer for one array
+        /// insert. A single larger blob is inserted on its own.
+        static constexpr size_t max_batch_bytes = 16 * 1024 * 1024;
+
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param pool session pool from which to take the sink's session.
+        /// \param table fully qualified name of the table to insert into.
+        /// \param key_column name of the RAW(32) column receiving keys.
+        /// \param blob_column name of the BLOB column receiving blobs.
+        /// \param batch_size maximum number of rows per array insert.
+        /// \param stats_interval time between client-side statistics
+        ///                       reports. Zero disables reporting.
+        oracle_blob_sink(std::shared_ptr<logging::log> logger,
+                         std::shared_ptr<oracle::session_pool> pool,
+                         std::string table,
+                         const std::string& key_column,
+                         const std::string& blob_column,
+                         size_t batch_size,
+                         std::chrono::seconds stats_interval);
+
+        /// Destructor. Logs the statistics gathered since the last report.
+        ~oracle_blob_sink() override;
+
+        oracle_blob_sink(const oracle_blob_sink&) = delete;
+        auto operator=(const oracle_blob_sink&) -> oracle_blob_sink&
+            = delete;
+        oracle_blob_sink(oracle_blob_sink&&) = delete;
+        auto operator=(oracle_blob_sink&&) -> oracle_blob_sink& = delete;
+
+        /// Inserts the records and commits them together, connecting
+        /// first if the sink has no session.
+        /// \param keys array of count record keys.
+        /// \param blobs array of count record contents.
+        /// \param count number of records.
+        /// \return true if every row was inserted and committed.
+        auto append(const hash_t* keys, const buffer* blobs, size_t count)
+            -> bool override;
+
+        /// Creates the pool if needed and takes a session from it, unless
+        /// the sink already has one.
+        /// \return true if the sink is ready to insert.
+        auto connect() -> bool override;
+
+      private:
+        /// Number of leading records that fit in one array insert.
+        [[nodiscard]] auto batch_rows(const buffer* blobs,
+                                      size_t count) const -> size_t;
+        auto insert(const hash_t* keys, const buffer* blobs, size_t count)
+            -> bool;
+
+        std::shared_ptr<logging::log> m_logger;
+        std::shared_ptr<oracle::session_pool> m_pool;
+        std::string m_table;
+        std::string m_query;
+        size_t m_batch_size;
+
+        std::optional<oracle::connection> m_conn;
+        oracle::stats_reporter m_stats;
+
+        /// Bind buffers, reused across appends unless a single oversized
+        /// blob grew them past \ref max_batch_bytes.
+        std::vector<hash_t> m_keys;
+        std::vector<unsigned char> m_blobs;
+        std::vector<uint32_t> m_lens;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_ORACLE_BLOB_SINK_H_
@@ -0,0 +1,117 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "oracle_sink.hpp"
+
+#include "util/common/metrics.hpp"
+#include "util/oracle/hash_insert.hpp"
+
+namespace cbdc::persistence {
+    oracle_sink::oracle_sink(std::shared_ptr<logging::log> logger,
+                             std::shared_ptr<oracle::session_pool> pool,
+                             std::string table,
+                             std::vector<std::string> columns,
+                             const std::optional<std::string>& partition,
+                             size_t batch_size,
+                             std::chrono::seconds stats_interval)
+        : sink(columns.size()),
+          m_logger(std::move(logger)),
+          m_pool(std::move(pool)),
+          m_table(std::move(table)),
+          m_query(partition.has_value()
+                      ? oracle::make_partition_insert_query(m_table,
+                                                            partition.value(),
+                                                            columns)
+                      : oracle::make_insert_query(m_table, columns)),
+          m_batch_size(batch_size),
+          m_stats(m_logger,
+                  partition.has_value() ? m_table + ":" + partition.value()
+                                        : m_table,
+                  stats_interval) {}
+
+    oracle_sink::~oracle_sink() {
+        if(m_conn.has_value()) {
+            m_stats.report(m_conn.value());
+        }
+        disconnect();
+    }
+
+    auto oracle_sink::init() -> bool {
+        if(!m_pool->init()) {
+            return false;
+        }
+        m_conn = m_pool->acquire();
+        if(!m_conn.has_value()) {
+            m_logger->error("Failed to connect to Oracle Autonomous Database");
+            return false;
+        }
+        m_batch = m_conn->prepare_batch(m_query, width(), m_batch_size);
+        if(!m_batch.has_value()) {
+            m_logger->error("Failed to prepare insert into", m_table);
+            disconnect();
+            return false;
+        }
+        return true;
+    }
+
+    auto oracle_sink::connect() -> bool {
+        return m_conn.has_value() || init();
+    }
+
+    auto oracle_sink::append(const hash_t* records, size_t count) -> bool {
+        static auto& persist_latency
+            = metrics::registry::global().get_latency_histogram(
+                "oracle_persist_seconds",
+                "Time to insert a batch of records into Oracle.");
+        static auto& persisted = metrics::registry::global().get_counter(
+            "oracle_persisted_records_total",
+            "Records inserted into Oracle.");
+        auto timer = metrics::scoped_timer(persist_latency);
+        m_retryable = true;
+        if(!m_conn.has_value() && !init()) {
+            return false;
+        }
+        auto ret = insert(records, count);
+        if(ret) {
+            persisted.add(count);
+        }
+        m_stats.maybe_report(m_conn.value());
+        m_retryable = !ret && m_conn->lost();
+        if(m_retryable) {
+            m_logger->warn("Lost Oracle session for", m_table);
+            m_batch.reset();
+            m_conn->discard();
+            m_conn.reset();
+        }
+        return ret;
+    }
+
+    auto oracle_sink::insert(const hash_t* records, size_t count) -> bool {
+        const auto w = width();
+        for(size_t i{0}; i < count; i++) {
+            if(!m_batch->add(&records[i * w])) {
+                if(!m_batch->execute()) {
+                    return false;
+                }
+                m_batch->add(&records[i * w]);
+            }
+        }
+        return m_batch->execute();
+    }
+
+    auto oracle_sink::retryable() const -> bool {
+        return m_retryable;
+    }
+
+    auto oracle_sink::flush() -> bool {
+        return true;
+    }
+
+    void oracle_sink::disconnect() {
+        // The batch's statement belongs to the session, so release it first.
+        m_batch.reset();
+        m_conn.reset();
+    }
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_ORACLE_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_ORACLE_SINK_H_
+
+#include "sink.hpp"
+#include "util/common/logging.hpp"
+#include "util/oracle/session_pool.hpp"
+#include "util/oracle/stats_reporter.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// \brief Sink which inserts records into an Oracle table.
+    ///
+    /// Each record becomes one row with one RAW column per hash. Records
+    /// are copied into a preallocated oracle::batch, and each full batch is
+    /// sent as a single array insert and committed, so \ref flush has
+    /// nothing left to do. The sink holds one pooled
+    /// session and must only be used from one thread at a time.
+    ///
+    /// The sink does not connect when constructed. The thread draining it
+    /// connects through \ref connect, so services start without waiting
+    /// for the database. The sink also reconnects on its own. If the
+    /// database is unreachable, or an insert fails because the session
+    /// died, the session is dropped and \ref append fails. The next
+    /// \ref append then creates the pool or takes a fresh session first.
+    /// The write-behind queue retries failed batches with backoff, so
+    /// reconnection happens on its thread.
+    class oracle_sink final : public sink {
+      public:
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param pool session pool from which to take the sink's session.
+        /// \param table fully qualified name of the table to insert into.
+        /// \param columns names of the columns receiving each record's
+        ///                hashes, ideally of type RAW(32).
+        /// \param partition partition of the table to insert into, or
+        ///                  std::nullopt to insert into the whole table.
+        /// \param batch_size maximum number of rows per array insert.
+        ///                   Appends of up to this many records commit
+        ///                   atomically.
+        /// \param stats_interval time between client-side statistics
+        ///                       reports. Zero disables reporting.
+        oracle_sink(std::shared_ptr<logging::log> logger,
+                    std::shared_ptr<oracle::session_pool> pool,
+                    std::string table,
+                    std::vector<std::string> columns,
+                    const std::optional<std::string>& partition,
+                    size_t batch_size,
+                    std::chrono::seconds stats_interval);
+
+        /// Destructor. Logs the statistics gathered since the last report.
+        ~oracle_sink() override;
+
+        oracle_sink(const oracle_sink&) = delete;
+        auto operator=(const oracle_sink&) -> oracle_sink& = delete;
+        oracle_sink(oracle_sink&&) = delete;
+        auto operator=(oracle_sink&&) -> oracle_sink& = delete;
+
+        /// Creates the pool if needed, takes a session from it and
+        /// prepares the insert.
+        /// \return true if the sink is ready to insert.
+        auto init() -> bool;
+
+        /// Inserts and commits the records, connecting first if the sink
+        /// has no session.
+        /// \param records contiguous array of count * width() hashes.
+        /// \param count number of records.
+        /// \return true if every row was inserted and committed, false if
+        ///         the sink could not connect or the insert failed.
+        auto append(const hash_t* records, size_t count) -> bool override;
+
+        /// No-op, as every batch is committed by \ref append.
+        /// \return true.
+        auto flush() -> bool override;
+
+        /// Calls \ref init unless the sink already has a session.
+        /// \return true if the sink is ready to insert.
+        auto connect() -> bool override;
+
+        /// Checks whether the last failed \ref append failed to connect or
+        /// lost its session. Other errors, such as constraint violations,
+        /// would fail again on retry.
+        /// \return true if the failure was a connection failure.
+        [[nodiscard]] auto retryable() const -> bool override;
+
+      private:
+        auto insert(const hash_t* records, size_t count) -> bool;
+        void disconnect();
+
+        std::shared_ptr<logging::log> m_logger;
+        std::shared_ptr<oracle::session_pool> m_pool;
+        std::string m_table;
+        std::string m_query;
+        size_t m_batch_size;
+
+        std::optional<oracle::connection> m_conn;
+        std::optional<oracle::batch> m_batch;
+        bool m_retryable{true};
+        oracle::stats_reporter m_stats;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_ORACLE_SINK_H_
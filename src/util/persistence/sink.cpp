@@ -0,0 +1,22 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sink.hpp"
+
+namespace cbdc::persistence {
+    sink::sink(size_t width) : m_width(width) {}
+
+    auto sink::connect() -> bool {
+        return true;
+    }
+
+    auto sink::retryable() const -> bool {
+        return true;
+    }
+
+    auto sink::width() const -> size_t {
+        return m_width;
+    }
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_SINK_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_SINK_H_
+
+#include "util/common/hash.hpp"
+
+#include <cstddef>
+
+namespace cbdc::persistence {
+    /// \brief Destination for batches of audit records.
+    ///
+    /// A record is a fixed-width row of \ref width hashes. Batches are
+    /// passed as contiguous arrays of records stored back to back, so
+    /// record i occupies records[i * width()] to
+    /// records[i * width() + width() - 1].
+    /// \see null_sink, file_sink, leveldb_sink and oracle_sink for the
+    ///      available backends.
+    class sink {
+      public:
+        /// Constructor.
+        /// \param width number of hashes in each record.
+        explicit sink(size_t width);
+        virtual ~sink() = default;
+        sink() = delete;
+        sink(const sink&) = delete;
+        auto operator=(const sink&) -> sink& = delete;
+        sink(sink&&) = delete;
+        auto operator=(sink&&) -> sink& = delete;
+
+        /// Appends a batch of records.
+        /// \param records contiguous array of count * width() hashes.
+        /// \param count number of records in the batch.
+        /// \return true if the sink accepted every record.
+        virtual auto append(const hash_t* records, size_t count) -> bool
+            = 0;
+
+        /// Makes all previously appended records durable.
+        /// \return true if the records were flushed.
+        virtual auto flush() -> bool = 0;
+
+        /// Opens any connection the sink needs. Called on the thread which
+        /// drains the sink before its first append, so slow connection
+        /// setup does not delay whoever created the sink. Sinks which fail
+        /// to connect must retry on \ref append.
+        /// \return true if the sink is ready to accept records.
+        virtual auto connect() -> bool;
+
+        /// Checks whether the last failed \ref append may succeed if
+        /// retried, for example after a lost connection. Batches failing
+        /// for other reasons are dropped rather than retried.
+        /// \return true unless the sink knows the failure is permanent.
+        [[nodiscard]] virtual auto retryable() const -> bool;
+
+        /// Returns the number of hashes in each record.
+        /// \return record width.
+        [[nodiscard]] auto width() const -> size_t;
+
+      private:
+        size_t m_width;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_SINK_H_
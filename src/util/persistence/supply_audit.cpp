@@ -0,0 +1,176 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "supply_audit.hpp"
+
+#include "hash_export.hpp"
+#include "util/common/mapped_hash_array.hpp"
+#include "util/oracle/hash_lookup.hpp"
+#include "util/oracle/schema.hpp"
+
+#include <filesystem>
+
+namespace cbdc::persistence {
+    namespace {
+        /// Records of created and spent UHS IDs hold a dtx ID, a TX ID and
+        /// a UHS ID.
+        constexpr size_t uhs_record_width = 3;
+
+        void audit_export(const shard_audit_source& src, shard_supply& out) {
+            uint64_t exported{0};
+            uint64_t out_of_range{0};
+            auto label = scan_hash_export(
+                src.m_export_path,
+                [&](const hash_t* hashes, size_t count) {
+                    exported += count;
+                    for(size_t i{0}; i < count; i++) {
+                        if(!config::hash_in_shard_range(src.m_range,
+                                                        hashes[i])) {
+                            out_of_range++;
+                        }
+                    }
+                });
+            if(!label.has_value()) {
+                out.m_error = "Failed to read " + src.m_export_path;
+                return;
+            }
+            out.m_label = label.value();
+            out.m_exported = exported;
+            out.m_out_of_range = out_of_range;
+        }
+
+        void audit_preseed(const shard_audit_source& src, shard_supply& out) {
+            if(src.m_preseed_path.empty()) {
+                return;
+            }
+            auto file = mapped_hash_array(src.m_preseed_path);
+            if(!file.open()) {
+                out.m_error = "Failed to read " + src.m_preseed_path;
+                return;
+            }
+            out.m_seeded = file.size();
+        }
+    }
+
+    auto shard_supply::balanced() const -> bool {
+        if(m_error.has_value() || m_out_of_range != 0) {
+            return false;
+        }
+        if(!m_created.has_value() || !m_spent.has_value()) {
+            return true;
+        }
+        return m_seeded + m_created.value()
+            == m_exported + m_spent.value();
+    }
+
+    auto audit_supply(const std::vector<shard_audit_source>& sources,
+                      const record_counter& counter,
+                      thread_pool* pool) -> std::vector<shard_supply> {
+        auto ret = std::vector<shard_supply>(sources.size());
+        // Tasks write disjoint fields, except for errors, which are kept
+        // apart and merged once every task has finished.
+        auto preseed_errors
+            = std::vector<std::optional<std::string>>(sources.size());
+        // Tasks of the same kind are adjacent, so each chunk of the pool
+        // covers a mix of shards rather than every task of a few shards.
+        auto tasks = std::vector<std::function<void()>>();
+        for(size_t i{0}; i < sources.size(); i++) {
+            ret[i].m_range = sources[i].m_range;
+            tasks.emplace_back([&, i]() {
+                audit_export(sources[i], ret[i]);
+            });
+        }
+        for(size_t i{0}; i < sources.size(); i++) {
+            tasks.emplace_back([&, i]() {
+                auto res = shard_supply();
+                audit_preseed(sources[i], res);
+                ret[i].m_seeded = res.m_seeded;
+                preseed_errors[i] = std::move(res.m_error);
+            });
+        }
+        for(size_t i{0}; counter && i < sources.size(); i++) {
+            tasks.emplace_back([&, i]() {
+                ret[i].m_created
+                    = counter(shard_created_table, sources[i].m_range);
+            });
+            tasks.emplace_back([&, i]() {
+                ret[i].m_spent
+                    = counter(shard_spent_table, sources[i].m_range);
+            });
+        }
+
+        for_each_chunk(pool, tasks.size(), 1, [&](size_t begin, size_t end) {
+            for(auto t = begin; t < end; t++) {
+                tasks[t]();
+            }
+        });
+        for(size_t i{0}; i < ret.size(); i++) {
+            if(!ret[i].m_error.has_value()) {
+                ret[i].m_error = std::move(preseed_errors[i]);
+            }
+        }
+        return ret;
+    }
+
+    auto make_record_counter(const config::options& opts,
+                             const std::shared_ptr<logging::log>& logger)
+        -> record_counter {
+        if(opts.m_persistence_backend == config::persistence_backend::file) {
+            return [dir = opts.m_persistence_dir](
+                       const std::string& table,
+                       const config::shard_range_t& range)
+                       -> std::optional<uint64_t> {
+                // Matches the path chosen by make_sink
+                const auto path
+                    = std::filesystem::path(dir)
+                    / (table + "." + oracle::shard_partition_name(range));
+                auto ec = std::error_code();
+                const auto size = std::filesystem::file_size(path, ec);
+                constexpr auto record_size = uhs_record_width * hash_size;
+                if(ec || size % record_size != 0) {
+                    return std::nullopt;
+                }
+                return size / record_size;
+            };
+        }
+
+        if(opts.m_persistence_backend
+           == config::persistence_backend::oracle) {
+            auto pool = std::make_shared<oracle::session_pool>(
+                logger,
+                opts.m_oracle_pool_min_sessions,
+                opts.m_oracle_pool_max_sessions,
+                opts.m_oracle_pool_increment,
+                opts.m_oracle_stmt_cache_size);
+            // Initialized here as the pool is shared by concurrent scans
+            if(!pool->init()) {
+                return {};
+            }
+            return [logger, pool](const std::string& table,
+                                  const config::shard_range_t& range)
+                       -> std::optional<uint64_t> {
+                // Only the scan is used, which needs no worker thread or
+                // lookup batches.
+                auto lookup
+                    = oracle::hash_lookup(logger,
+                                          pool,
+                                          table,
+                                          "uhs_id",
+                                          oracle::shard_partition_name(range),
+                                          std::chrono::microseconds(0),
+                                          1);
+                uint64_t count{0};
+                if(!lookup.scan([&](const hash_t& /* id */) {
+                       count++;
+                   })) {
+                    return std::nullopt;
+                }
+                return count;
+            };
+        }
+
+        return {};
+    }
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_SUPPLY_AUDIT_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_SUPPLY_AUDIT_H_
+
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+#include "util/common/thread_pool.hpp"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// Inputs for auditing the UHS of one shard.
+    struct shard_audit_source {
+        /// Range of UHS IDs owned by the shard.
+        config::shard_range_t m_range{};
+        /// UHS export written by the shard, see \ref hash_export_writer.
+        std::string m_export_path;
+        /// File of UHS IDs the shard was seeded with, see
+        /// \ref mapped_hash_array, or empty if the shard was not seeded.
+        std::string m_preseed_path;
+    };
+
+    /// Supply figures for one shard, as computed by \ref audit_supply.
+    struct shard_supply {
+        /// Range of UHS IDs owned by the shard.
+        config::shard_range_t m_range{};
+        /// Label of the export, such as the height it was taken at.
+        uint64_t m_label{};
+        /// Number of UHS IDs in the export.
+        uint64_t m_exported{};
+        /// Number of exported UHS IDs outside the shard's range.
+        uint64_t m_out_of_range{};
+        /// Number of UHS IDs the shard was seeded with.
+        uint64_t m_seeded{};
+        /// Number of persisted records of UHS IDs created by
+        /// transactions, or std::nullopt if no records are available.
+        std::optional<uint64_t> m_created;
+        /// Number of persisted records of UHS IDs spent by transactions,
+        /// or std::nullopt if no records are available.
+        std::optional<uint64_t> m_spent;
+        /// Description of the first input which could not be read, if any.
+        std::optional<std::string> m_error;
+
+        /// Checks the export against the seeded UHS IDs and the persisted
+        /// records: every exported ID must be in range and the export must
+        /// hold exactly the seeded plus created IDs not since spent. The
+        /// records are only compared when both counts are available.
+        /// \return true if every input was read and the figures agree.
+        [[nodiscard]] auto balanced() const -> bool;
+    };
+
+    /// Counts the persisted records for a shard.
+    /// \param table name of the table holding the records.
+    /// \param range range of UHS IDs owned by the shard.
+    /// \return number of records, or std::nullopt if unavailable.
+    using record_counter = std::function<std::optional<uint64_t>(
+        const std::string& table,
+        const config::shard_range_t& range)>;
+
+    /// Table of the UHS IDs created by locking shards.
+    static constexpr auto shard_created_table = "admin.shard_created";
+    /// Table of the UHS IDs spent by locking shards.
+    static constexpr auto shard_spent_table = "admin.shard_spent";
+
+    /// Audits the UHS of every shard concurrently. Reading each export,
+    /// preseed file and record count is a separate task run on the pool,
+    /// so large exports and slow record scans of different shards
+    /// overlap. Exports are streamed rather
+    /// than loaded, so memory use does not grow with the UHS.
+    /// \param sources shards to audit.
+    /// \param counter function counting persisted records, or an empty
+    ///                function to skip the record checks.
+    /// \param pool thread pool, or nullptr to audit on the calling thread.
+    /// \return figures for each shard, in the order of sources.
+    auto audit_supply(const std::vector<shard_audit_source>& sources,
+                      const record_counter& counter,
+                      thread_pool* pool) -> std::vector<shard_supply>;
+
+    /// Returns a record counter for the configured persistence backend.
+    ///
+    /// The file backend's records are fixed-width, so they are counted
+    /// from the file size. The Oracle backend scans the UHS ID column of
+    /// the shard's partition. The LevelDB backend keys records by dtx ID,
+    /// which collapses the records of a dtx, and the null backend keeps
+    /// no records, so neither can be counted.
+    /// \param opts configuration options.
+    /// \param logger log instance.
+    /// \return record counter, or an empty function if the backend's
+    ///         records cannot be counted or Oracle is unreachable.
+    auto make_record_counter(const config::options& opts,
+                             const std::shared_ptr<logging::log>& logger)
+        -> record_counter;
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_SUPPLY_AUDIT_H_
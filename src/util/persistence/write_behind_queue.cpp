@@ -0,0 +1,166 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "write_behind_queue.hpp"
+
+#include "util/common/affinity.hpp"
+
+#include <algorithm>
+
+namespace cbdc::persistence {
+    write_behind_queue::write_behind_queue(
+        std::shared_ptr<logging::log> logger,
+        std::unique_ptr<sink> out,
+        size_t high_water_mark,
+        size_t max_batch_size,
+        retry_policy retry)
+        : m_logger(std::move(logger)),
+          m_sink(std::move(out)),
+          m_width(m_sink ? std::max<size_t>(m_sink->width(), 1) : 1),
+          m_high_water_mark(high_water_mark),
+          m_max_batch_size(std::max<size_t>(max_batch_size, 1)),
+          m_retry(retry) {}
+
+    write_behind_queue::~write_behind_queue() {
+        stop();
+    }
+
+    auto write_behind_queue::start() -> bool {
+        if(!m_sink) {
+            return false;
+        }
+
+        {
+            std::unique_lock l(m_mut);
+            m_running = true;
+        }
+        m_thread = std::thread([&]() {
+            pin_current_thread(thread_role::persistence);
+            persistence_loop();
+        });
+        return true;
+    }
+
+    auto write_behind_queue::push(const hash_t& id) -> bool {
+        return push_row({id});
+    }
+
+    auto write_behind_queue::push_row(std::initializer_list<hash_t> record)
+        -> bool {
+        if(record.size() != m_width) {
+            return false;
+        }
+        return push_records(record.begin(), 1);
+    }
+
+    auto write_behind_queue::push_records(const hash_t* records, size_t count)
+        -> bool {
+        {
+            std::unique_lock l(m_mut);
+            m_space_cv.wait(l, [&]() {
+                return !m_running
+                    || m_pending.size() < m_high_water_mark * m_width;
+            });
+            if(!m_running) {
+                return false;
+            }
+            m_pending.insert(m_pending.end(),
+                             records,
+                             records + count * m_width);
+        }
+        m_pending_cv.notify_one();
+        return true;
+    }
+
+    void write_behind_queue::stop() {
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_pending_cv.notify_one();
+        m_space_cv.notify_all();
+        if(m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    auto write_behind_queue::size() const -> size_t {
+        std::unique_lock l(m_mut);
+        return m_pending.size() / m_width;
+    }
+
+    void write_behind_queue::persistence_loop() {
+        // Records queue up while the sink connects
+        if(!m_sink->connect()) {
+            m_logger->warn("Persistence sink not ready, will retry writes");
+        }
+        auto batch = std::vector<hash_t>();
+        while(true) {
+            {
+                std::unique_lock l(m_mut);
+                m_pending_cv.wait(l, [&]() {
+                    return !m_running || !m_pending.empty();
+                });
+                if(m_pending.empty()) {
+                    // Only reachable once stopped and fully drained.
+                    return;
+                }
+                batch.assign(m_pending.begin(), m_pending.end());
+                m_pending.clear();
+            }
+            m_space_cv.notify_all();
+
+            const auto records = batch.size() / m_width;
+            auto backoff = m_retry.m_initial_backoff;
+            size_t attempts{0};
+            for(size_t i{0}; i < records;) {
+                auto count = std::min(m_max_batch_size, records - i);
+                if(m_sink->append(&batch[i * m_width], count)) {
+                    i += count;
+                    backoff = m_retry.m_initial_backoff;
+                    attempts = 0;
+                    continue;
+                }
+                attempts++;
+                if(!m_sink->retryable()
+                   || (m_retry.m_max_attempts != 0
+                       && attempts >= m_retry.m_max_attempts)) {
+                    m_logger->error("Dropping",
+                                    count,
+                                    "records the sink rejected after",
+                                    attempts,
+                                    "attempts");
+                    i += count;
+                    backoff = m_retry.m_initial_backoff;
+                    attempts = 0;
+                    continue;
+                }
+                if(!wait_for_retry(backoff)) {
+                    m_logger->error("Dropping",
+                                    records - i,
+                                    "unpersisted records on shutdown");
+                    break;
+                }
+                m_logger->warn("Retrying", count, "unpersisted records");
+                backoff = std::min(backoff * 2, m_retry.m_max_backoff);
+            }
+            if(!m_sink->flush()) {
+                m_logger->error("Failed to flush persisted records");
+            }
+            batch.clear();
+        }
+    }
+
+    auto write_behind_queue::wait_for_retry(std::chrono::milliseconds delay)
+        -> bool {
+        std::unique_lock l(m_mut);
+        return !m_pending_cv.wait_for(l, delay, [&]() {
+            return !m_running;
+        });
+    }
+}
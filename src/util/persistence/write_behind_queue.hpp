@@ -0,0 +1,141 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_PERSISTENCE_WRITE_BEHIND_QUEUE_H_
+#define OPENCBDC_TX_SRC_PERSISTENCE_WRITE_BEHIND_QUEUE_H_
+
+#include "sink.hpp"
+#include "util/common/config.hpp"
+#include "util/common/hash.hpp"
+#include "util/common/logging.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cbdc::persistence {
+    /// Delays between attempts to persist a batch the sink rejected.
+    struct retry_policy {
+        /// Delay before the first retry of a batch.
+        std::chrono::milliseconds m_initial_backoff{
+            config::defaults::persistence_retry_backoff_ms};
+        /// Upper bound on the delay, which doubles after each failed
+        /// attempt.
+        std::chrono::milliseconds m_max_backoff{
+            config::defaults::persistence_retry_max_backoff_ms};
+        /// Number of failed attempts after which a batch is dropped. Zero
+        /// retries until the queue stops.
+        size_t m_max_attempts{0};
+    };
+
+    /// \brief Bounded write-behind queue in front of a persistence sink.
+    ///
+    /// Each record consists of sink::width() hashes. Callers push records
+    /// from their hot path and return immediately. A dedicated persistence
+    /// thread drains the queue and appends the pending records to the sink
+    /// in batches, flushing the sink after each drain. When the queue
+    /// reaches its high-water mark, \ref push blocks until the persistence
+    /// thread has made room, providing backpressure to the caller rather
+    /// than growing without bound.
+    ///
+    /// If the sink rejects a batch because of a transient failure, for
+    /// example because the database is unreachable, the persistence thread
+    /// retries it with exponential backoff. Meanwhile new records keep
+    /// accumulating in the queue, so a short outage never blocks callers.
+    /// Batches the sink rejects for any other reason, or which still fail
+    /// after the policy's maximum number of attempts, are dropped with an
+    /// error rather than blocking the records behind them. Records still
+    /// unpersisted when the queue is stopped are dropped after one final
+    /// attempt.
+    class write_behind_queue {
+      public:
+        /// Constructor.
+        /// \param logger log instance.
+        /// \param out sink receiving the records. May be nullptr, in which
+        ///            case \ref start fails.
+        /// \param high_water_mark maximum number of pending records before
+        ///                        \ref push blocks.
+        /// \param max_batch_size maximum number of records appended to the
+        ///                       sink at once.
+        /// \param retry backoff between attempts to persist a failed batch.
+        write_behind_queue(std::shared_ptr<logging::log> logger,
+                           std::unique_ptr<sink> out,
+                           size_t high_water_mark,
+                           size_t max_batch_size,
+                           retry_policy retry = {});
+
+        /// Destructor. Calls \ref stop.
+        ~write_behind_queue();
+
+        write_behind_queue() = delete;
+        write_behind_queue(const write_behind_queue&) = delete;
+        auto operator=(const write_behind_queue&)
+            -> write_behind_queue& = delete;
+        write_behind_queue(write_behind_queue&&) = delete;
+        auto operator=(write_behind_queue&&) -> write_behind_queue& = delete;
+
+        /// Launches the persistence thread.
+        /// \return true if the queue has a sink to drain into.
+        auto start() -> bool;
+
+        /// Queues a single-hash record. Blocks while the queue is at its
+        /// high-water mark.
+        /// \param id hash to persist.
+        /// \return false if the queue is not running or its records are not
+        ///         exactly one hash wide.
+        auto push(const hash_t& id) -> bool;
+
+        /// Queues a record. Blocks while the queue is at its high-water
+        /// mark.
+        /// \param record one hash per record column, in column order.
+        /// \return false if the queue is not running or the record width
+        ///         does not match the sink.
+        auto push_row(std::initializer_list<hash_t> record) -> bool;
+
+        /// Queues a batch of records under a single lock acquisition.
+        /// Blocks while the queue is at its high-water mark, but admits the
+        /// whole batch once there is room, so the queue may briefly exceed
+        /// the mark by one batch.
+        /// \param records contiguous array of count * sink::width() hashes.
+        /// \param count number of records.
+        /// \return false if the queue is not running.
+        auto push_records(const hash_t* records, size_t count) -> bool;
+
+        /// Stops accepting new records, flushes any pending records to the
+        /// sink and joins the persistence thread.
+        void stop();
+
+        /// Returns the number of records waiting to be persisted.
+        /// \return queue depth.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
+        void persistence_loop();
+        auto wait_for_retry(std::chrono::milliseconds delay) -> bool;
+
+        std::shared_ptr<logging::log> m_logger;
+        std::unique_ptr<sink> m_sink;
+        size_t m_width;
+        size_t m_high_water_mark;
+        size_t m_max_batch_size;
+        retry_policy m_retry;
+
+        mutable std::mutex m_mut;
+        std::condition_variable m_pending_cv;
+        std::condition_variable m_space_cv;
+        /// Pending records stored back to back, m_width hashes each.
+        std::deque<hash_t> m_pending;
+        bool m_running{false};
+
+        std::thread m_thread;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_PERSISTENCE_WRITE_BEHIND_QUEUE_H_
@@ -0,0 +1,291 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "batching_replicator.hpp"
+
+#include "serialization.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+namespace cbdc::raft {
+    namespace {
+        /// Reads a size-prefixed byte string from the buffer into a new
+        /// buffer, checking it lies within the buffer first.
+        auto read_sized(nuraft::buffer& buf)
+            -> std::optional<nuraft::ptr<nuraft::buffer>> {
+            if(buf.pos() + sizeof(uint64_t) > buf.size()) {
+                return std::nullopt;
+            }
+            auto len = uint64_t();
+            std::memcpy(&len, buf.get_raw(sizeof(len)), sizeof(len));
+            if(len > buf.size() - buf.pos()) {
+                return std::nullopt;
+            }
+            auto ret = nuraft::buffer::alloc(len);
+            std::memcpy(ret->data_begin(), buf.get_raw(len), len);
+            return ret;
+        }
+
+        void put_sized(nuraft::buffer& buf, const nuraft::buffer& data) {
+            auto len = static_cast<uint64_t>(data.size());
+            buf.put_raw(reinterpret_cast<const nuraft::byte*>(&len),
+                        sizeof(len));
+            buf.put_raw(data.data_begin(), data.size());
+        }
+
+        auto read_count(nuraft::buffer& buf) -> std::optional<uint64_t> {
+            if(buf.pos() + sizeof(uint64_t) > buf.size()) {
+                return std::nullopt;
+            }
+            auto count = uint64_t();
+            std::memcpy(&count, buf.get_raw(sizeof(count)), sizeof(count));
+            // Each item takes at least its size prefix
+            if(count > (buf.size() - buf.pos()) / sizeof(uint64_t)) {
+                return std::nullopt;
+            }
+            return count;
+        }
+    }
+
+    auto
+    make_batch_entry(const buffer& prefix,
+                     const std::vector<nuraft::ptr<nuraft::buffer>>& entries)
+        -> nuraft::ptr<nuraft::buffer> {
+        auto sz = prefix.size() + sizeof(uint64_t);
+        for(const auto& e : entries) {
+            sz += sizeof(uint64_t) + e->size();
+        }
+        auto ret = nuraft::buffer::alloc(sz);
+        ret->put_raw(static_cast<const nuraft::byte*>(prefix.data()),
+                     prefix.size());
+        auto count = static_cast<uint64_t>(entries.size());
+        ret->put_raw(reinterpret_cast<const nuraft::byte*>(&count),
+                     sizeof(count));
+        for(const auto& e : entries) {
+            put_sized(*ret, *e);
+        }
+        ret->pos(0);
+        return ret;
+    }
+
+    auto read_batch_entry(nuraft::buffer& buf, size_t prefix_size)
+        -> std::optional<std::vector<nuraft::ptr<nuraft::buffer>>> {
+        if(prefix_size > buf.size()) {
+            return std::nullopt;
+        }
+        buf.pos(prefix_size);
+        auto count = read_count(buf);
+        if(!count.has_value()) {
+            return std::nullopt;
+        }
+        auto ret = std::vector<nuraft::ptr<nuraft::buffer>>();
+        ret.reserve(*count);
+        for(uint64_t i{0}; i < *count; i++) {
+            auto entry = read_sized(buf);
+            if(!entry.has_value()) {
+                return std::nullopt;
+            }
+            ret.emplace_back(std::move(*entry));
+        }
+        return ret;
+    }
+
+    auto make_batch_result(
+        const std::vector<nuraft::ptr<nuraft::buffer>>& results)
+        -> nuraft::ptr<nuraft::buffer> {
+        auto sz = sizeof(uint64_t);
+        for(const auto& r : results) {
+            sz += sizeof(uint8_t);
+            if(r) {
+                sz += sizeof(uint64_t) + r->size();
+            }
+        }
+        auto ret = nuraft::buffer::alloc(sz);
+        auto count = static_cast<uint64_t>(results.size());
+        ret->put_raw(reinterpret_cast<const nuraft::byte*>(&count),
+                     sizeof(count));
+        for(const auto& r : results) {
+            ret->put(static_cast<nuraft::byte>(r ? 1 : 0));
+            if(r) {
+                put_sized(*ret, *r);
+            }
+        }
+        ret->pos(0);
+        return ret;
+    }
+
+    auto read_batch_result(nuraft::buffer& buf)
+        -> std::optional<std::vector<nuraft::ptr<nuraft::buffer>>> {
+        buf.pos(0);
+        if(buf.size() < sizeof(uint64_t)) {
+            return std::nullopt;
+        }
+        auto count = uint64_t();
+        std::memcpy(&count, buf.get_raw(sizeof(count)), sizeof(count));
+        // Each result takes at least its presence flag
+        if(count > buf.size() - buf.pos()) {
+            return std::nullopt;
+        }
+        auto ret = std::vector<nuraft::ptr<nuraft::buffer>>();
+        ret.reserve(count);
+        for(uint64_t i{0}; i < count; i++) {
+            if(buf.pos() >= buf.size()) {
+                return std::nullopt;
+            }
+            if(buf.get_byte() == 0) {
+                ret.emplace_back(nullptr);
+                continue;
+            }
+            auto res = read_sized(buf);
+            if(!res.has_value()) {
+                return std::nullopt;
+            }
+            ret.emplace_back(std::move(*res));
+        }
+        return ret;
+    }
+
+    batching_replicator::batching_replicator(std::shared_ptr<node> raft,
+                                             buffer batch_prefix,
+                                             size_t max_batch)
+        : m_raft(std::move(raft)),
+          m_batch_prefix(std::move(batch_prefix)),
+          m_max_batch(std::max(max_batch, size_t{1})),
+          m_append_thread([&]() {
+              append_loop();
+          }) {}
+
+    batching_replicator::~batching_replicator() {
+        {
+            std::unique_lock l(m_mut);
+            m_running = false;
+        }
+        m_cv.notify_one();
+        m_append_thread.join();
+        for(auto& p : m_pending) {
+            p.m_result_fn(std::nullopt);
+        }
+    }
+
+    auto batching_replicator::replicate(nuraft::ptr<nuraft::buffer> entry,
+                                        result_callback_type result_fn)
+        -> bool {
+        if(!m_raft->is_leader()) {
+            return false;
+        }
+        {
+            std::unique_lock l(m_mut);
+            if(!m_running) {
+                return false;
+            }
+            m_pending.push_back({std::move(entry), std::move(result_fn)});
+        }
+        m_cv.notify_one();
+        return true;
+    }
+
+    auto
+    batching_replicator::replicate_sync(nuraft::ptr<nuraft::buffer> entry)
+        -> std::optional<nuraft::ptr<nuraft::buffer>> {
+        auto res = std::make_shared<
+            std::promise<std::optional<nuraft::ptr<nuraft::buffer>>>>();
+        auto fut = res->get_future();
+        auto accepted = replicate(
+            std::move(entry),
+            [res](std::optional<nuraft::ptr<nuraft::buffer>> r) {
+                res->set_value(std::move(r));
+            });
+        if(!accepted) {
+            return std::nullopt;
+        }
+        return fut.get();
+    }
+
+    void batching_replicator::append_loop() {
+        while(true) {
+            auto batch = std::vector<pending>();
+            {
+                std::unique_lock l(m_mut);
+                m_cv.wait(l, [&]() {
+                    return !m_running || !m_pending.empty();
+                });
+                if(!m_running) {
+                    return;
+                }
+                if(m_pending.size() <= m_max_batch) {
+                    std::swap(batch, m_pending);
+                } else {
+                    auto end = m_pending.begin()
+                             + static_cast<std::ptrdiff_t>(m_max_batch);
+                    batch.assign(std::make_move_iterator(m_pending.begin()),
+                                 std::make_move_iterator(end));
+                    m_pending.erase(m_pending.begin(), end);
+                }
+            }
+            append(std::move(batch));
+        }
+    }
+
+    void batching_replicator::append(std::vector<pending> batch) {
+        auto fail = [](std::vector<pending>& b) {
+            for(auto& p : b) {
+                p.m_result_fn(std::nullopt);
+            }
+        };
+
+        if(batch.size() == 1) {
+            auto result_fn = std::move(batch.front().m_result_fn);
+            auto accepted = m_raft->replicate(
+                std::move(batch.front().m_entry),
+                [result_fn](result_type& r, nuraft::ptr<std::exception>& err) {
+                    if(err
+                       || r.get_result_code()
+                              != nuraft::cmd_result_code::OK) {
+                        result_fn(std::nullopt);
+                        return;
+                    }
+                    result_fn(r.get());
+                });
+            if(!accepted) {
+                result_fn(std::nullopt);
+            }
+            return;
+        }
+
+        auto entries = std::vector<nuraft::ptr<nuraft::buffer>>();
+        entries.reserve(batch.size());
+        for(auto& p : batch) {
+            entries.emplace_back(std::move(p.m_entry));
+        }
+        auto entry = make_batch_entry(m_batch_prefix, entries);
+        auto shared_batch
+            = std::make_shared<std::vector<pending>>(std::move(batch));
+        auto accepted = m_raft->replicate(
+            std::move(entry),
+            [shared_batch, fail](result_type& r,
+                                 nuraft::ptr<std::exception>& err) {
+                auto& b = *shared_batch;
+                if(err
+                   || r.get_result_code() != nuraft::cmd_result_code::OK
+                   || !r.get()) {
+                    fail(b);
+                    return;
+                }
+                auto results = read_batch_result(*r.get());
+                if(!results.has_value() || results->size() != b.size()) {
+                    fail(b);
+                    return;
+                }
+                for(size_t i{0}; i < b.size(); i++) {
+                    b[i].m_result_fn((*results)[i]);
+                }
+            });
+        if(!accepted) {
+            fail(*shared_batch);
+        }
+    }
+}
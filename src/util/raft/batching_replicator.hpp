@@ -0,0 +1,132 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RAFT_BATCHING_REPLICATOR_H_
+#define OPENCBDC_TX_SRC_RAFT_BATCHING_REPLICATOR_H_
+
+#include "node.hpp"
+#include "util/common/buffer.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace cbdc::raft {
+    /// \brief Builds a raft log entry holding several state machine
+    ///        commands.
+    ///
+    /// The entry is the prefix followed by the number of commands as a
+    /// 64-bit uint, then each command prefixed with its size. State
+    /// machines recognize batches by the prefix, which must not start any
+    /// single command, and read the commands with \ref read_batch_entry.
+    /// \param prefix bytes marking the entry as a batch.
+    /// \param entries commands to combine.
+    /// \return combined log entry.
+    auto
+    make_batch_entry(const buffer& prefix,
+                     const std::vector<nuraft::ptr<nuraft::buffer>>& entries)
+        -> nuraft::ptr<nuraft::buffer>;
+
+    /// Reads the commands of a batch entry.
+    /// \param buf batch entry from \ref make_batch_entry.
+    /// \param prefix_size size of the batch prefix to skip.
+    /// \return commands in log order, or std::nullopt if the entry is
+    ///         malformed.
+    auto read_batch_entry(nuraft::buffer& buf, size_t prefix_size)
+        -> std::optional<std::vector<nuraft::ptr<nuraft::buffer>>>;
+
+    /// Combines the state machine results of each command in a batch
+    /// entry into the result of the entry.
+    /// \param results result of each command, nullptr where a command had
+    ///                none.
+    /// \return combined result.
+    auto make_batch_result(
+        const std::vector<nuraft::ptr<nuraft::buffer>>& results)
+        -> nuraft::ptr<nuraft::buffer>;
+
+    /// Splits the result of a batch entry into the result of each command.
+    /// \param buf combined result from \ref make_batch_result.
+    /// \return result of each command, or std::nullopt if the result is
+    ///         malformed.
+    auto read_batch_result(nuraft::buffer& buf)
+        -> std::optional<std::vector<nuraft::ptr<nuraft::buffer>>>;
+
+    /// \brief Combines state machine commands replicated concurrently into
+    ///        shared raft log entries.
+    ///
+    /// Commands queue while the previous entry is being appended, and are
+    /// then replicated together as a batch entry, so followers replaying
+    /// or catching up apply a run of commands per entry rather than one.
+    /// A command replicated alone is logged unchanged, so state machines
+    /// still apply entries written before batching or with it disabled.
+    class batching_replicator {
+      public:
+        /// Function called with the state machine result of a command, or
+        /// std::nullopt if it failed to replicate. The result may hold
+        /// nullptr if the state machine returned none.
+        using result_callback_type = std::function<void(
+            std::optional<nuraft::ptr<nuraft::buffer>>)>;
+
+        /// Constructor. Starts the thread which appends batches.
+        /// \param raft node whose state machine applies the commands.
+        /// \param batch_prefix bytes marking a batch entry, see
+        ///                     \ref make_batch_entry.
+        /// \param max_batch maximum number of commands per entry. One
+        ///                  disables batching.
+        batching_replicator(std::shared_ptr<node> raft,
+                            buffer batch_prefix,
+                            size_t max_batch);
+
+        /// Stops the append thread. Commands still queued fail.
+        ~batching_replicator();
+
+        batching_replicator(const batching_replicator&) = delete;
+        auto operator=(const batching_replicator&)
+            -> batching_replicator& = delete;
+        batching_replicator(batching_replicator&&) = delete;
+        auto operator=(batching_replicator&&)
+            -> batching_replicator& = delete;
+
+        /// Queues a command for replication. Thread safe.
+        /// \param entry serialized state machine command.
+        /// \param result_fn function to call with the command's result.
+        /// \return false if this node is not the leader or the replicator
+        ///         is stopping, in which case result_fn is not called.
+        [[nodiscard]] auto replicate(nuraft::ptr<nuraft::buffer> entry,
+                                     result_callback_type result_fn) -> bool;
+
+        /// Replicates a command and waits for its result.
+        /// \param entry serialized state machine command.
+        /// \return state machine result, or std::nullopt if the command
+        ///         failed to replicate.
+        [[nodiscard]] auto
+        replicate_sync(nuraft::ptr<nuraft::buffer> entry)
+            -> std::optional<nuraft::ptr<nuraft::buffer>>;
+
+      private:
+        struct pending {
+            nuraft::ptr<nuraft::buffer> m_entry;
+            result_callback_type m_result_fn;
+        };
+
+        void append_loop();
+        void append(std::vector<pending> batch);
+
+        std::shared_ptr<node> m_raft;
+        buffer m_batch_prefix;
+        size_t m_max_batch;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<pending> m_pending;
+        bool m_running{true};
+        std::thread m_append_thread;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_RAFT_BATCHING_REPLICATOR_H_
@@ -5,6 +5,8 @@
 
 #include "log_store.hpp"
 
+#include "util/common/metrics.hpp"
+
 #include <array>
 #include <cstring>
 #include <leveldb/write_batch.h>
@@ -37,11 +39,22 @@ namespace cbdc::raft {
         return ret;
     }
 
+    log_store::log_store(size_t cache_bytes,
+                         const config::leveldb_profile& db_profile)
+        : m_db_opts(db_profile),
+          m_cache_capacity(cache_bytes) {}
+
+    log_store::~log_store() {
+        if(m_db) {
+            std::lock_guard<profiled_mutex> l(m_db_mut);
+            flush_locked();
+        }
+    }
+
     auto log_store::load(const std::string& db_dir) -> bool {
         m_write_opt.sync = false;
 
-        leveldb::Options opt;
-        opt.create_if_missing = true;
+        auto opt = m_db_opts.get();
         opt.comparator = &m_cmp;
 
         leveldb::DB* db_ptr{};
@@ -51,25 +64,29 @@ namespace cbdc::raft {
         }
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::lock_guard<profiled_mutex> l(m_db_mut);
             m_db.reset(db_ptr);
 
             m_next_idx
                 = get_first_or_last_index<false>(m_db.get(), m_read_opt) + 1;
             m_start_idx
                 = get_first_or_last_index<true>(m_db.get(), m_read_opt);
+            m_pending.clear();
+            m_pending_start = m_next_idx;
+            m_durable_next = m_next_idx;
+            cache_reset_locked();
         }
 
         return true;
     }
 
     auto log_store::next_slot() const -> uint64_t {
-        std::lock_guard<std::mutex> l(m_db_mut);
+        std::lock_guard<profiled_mutex> l(m_db_mut);
         return m_next_idx;
     }
 
     auto log_store::start_index() const -> uint64_t {
-        std::lock_guard<std::mutex> l(m_db_mut);
+        std::lock_guard<profiled_mutex> l(m_db_mut);
         return m_start_idx;
     }
 
@@ -82,10 +99,17 @@ namespace cbdc::raft {
         return entry;
     }
 
+    auto buffer_slice(const nuraft::buffer& buf) -> leveldb::Slice {
+        return {reinterpret_cast<const char*>(buf.data_begin()), buf.size()};
+    }
+
     auto log_store::last_entry() const -> nuraft::ptr<nuraft::log_entry> {
         nuraft::ptr<nuraft::log_entry> last_entry;
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::lock_guard<profiled_mutex> l(m_db_mut);
+            if(!m_cache.empty() || !m_pending.empty()) {
+                return buffered_entry_locked(m_next_idx - 1);
+            }
             auto it = std::unique_ptr<leveldb::Iterator>(
                 m_db->NewIterator(m_read_opt));
 
@@ -122,42 +146,32 @@ namespace cbdc::raft {
     }
 
     auto log_store::append(nuraft::ptr<nuraft::log_entry>& entry) -> uint64_t {
-        const auto value = get_value_slice(entry);
-
-        {
-            std::lock_guard<std::mutex> l(m_db_mut);
-            const auto key = get_key_slice(m_next_idx);
-            const auto status = m_db->Put(m_write_opt, key.first, value.first);
-            assert(status.ok());
-
-            m_next_idx++;
-            return m_next_idx - 1;
-        }
+        auto buf = entry->serialize();
+        const auto size = buf->size();
+        std::lock_guard<profiled_mutex> l(m_db_mut);
+        m_pending.push_back(std::move(buf));
+        cache_push_locked(entry, size);
+        m_next_idx++;
+        return m_next_idx - 1;
     }
 
     void log_store::write_at(uint64_t index,
                              nuraft::ptr<nuraft::log_entry>& entry) {
-        const auto key = get_key_slice(index);
-        const auto value = get_value_slice(entry);
-        leveldb::WriteBatch batch;
-        batch.Put(key.first, value.first);
-
-        {
-            std::lock_guard<std::mutex> l(m_db_mut);
-
-            std::vector<data_slice::second_type> data_slices(m_next_idx
-                                                             - index);
-            for(uint64_t i = index + 1; i < m_next_idx; i++) {
-                auto del_key = get_key_slice(i);
-                batch.Delete(del_key.first);
-                data_slices[i - index] = std::move(del_key.second);
-            }
-
-            const auto status = m_db->Write(m_write_opt, &batch);
-            assert(status.ok());
-
-            m_next_idx = index + 1;
+        auto buf = entry->serialize();
+        const auto size = buf->size();
+        std::lock_guard<profiled_mutex> l(m_db_mut);
+        cache_truncate_locked(index);
+        cache_push_locked(entry, size);
+        // Entries after the index which are already in the database are
+        // deleted by the next flush
+        if(index < m_pending_start) {
+            m_pending.clear();
+            m_pending_start = index;
+        } else {
+            m_pending.resize(index - m_pending_start);
         }
+        m_pending.push_back(std::move(buf));
+        m_next_idx = index + 1;
     }
 
     auto log_store::log_entries(uint64_t start, uint64_t end)
@@ -166,13 +180,21 @@ namespace cbdc::raft {
         auto ret = nuraft::cs_new<log_entries_t::element_type>(end - start);
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::lock_guard<profiled_mutex> l(m_db_mut);
+            assert(end <= m_next_idx);
+            const auto buffered_start
+                = std::min(m_pending_start, m_cache_start);
+            const auto n_durable
+                = start < buffered_start
+                    ? static_cast<size_t>(std::min(end, buffered_start)
+                                          - start)
+                    : size_t{0};
             auto it = std::unique_ptr<leveldb::Iterator>(
                 m_db->NewIterator(m_read_opt));
 
             it->Seek(first_key.first);
 
-            for(size_t i{0}; i < ret->size(); [&]() {
+            for(size_t i{0}; i < n_durable; [&]() {
                     it->Next();
                     i++;
                 }()) {
@@ -182,6 +204,10 @@ namespace cbdc::raft {
                 assert(entry);
                 (*ret)[i] = std::move(entry);
             }
+
+            for(size_t i{n_durable}; i < ret->size(); i++) {
+                (*ret)[i] = buffered_entry_locked(start + i);
+            }
         }
 
         return ret;
@@ -193,7 +219,13 @@ namespace cbdc::raft {
         std::string val;
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::lock_guard<profiled_mutex> l(m_db_mut);
+            if(index >= m_next_idx) {
+                return nuraft::cs_new<nuraft::log_entry>(0, nullptr);
+            }
+            if(index >= m_pending_start || index >= m_cache_start) {
+                return buffered_entry_locked(index);
+            }
             const auto status = m_db->Get(m_read_opt, key.first, &val);
             if(!status.ok()) {
                 assert(status.IsNotFound());
@@ -276,14 +308,20 @@ namespace cbdc::raft {
         }
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::lock_guard<profiled_mutex> l(m_db_mut);
+            [[maybe_unused]] const auto flushed = flush_locked();
+            assert(flushed);
             const auto status = m_db->Write(m_write_opt, &batch);
             assert(status.ok());
+            m_dirty = true;
 
             m_start_idx
                 = get_first_or_last_index<true>(m_db.get(), m_read_opt);
             m_next_idx
                 = get_first_or_last_index<false>(m_db.get(), m_read_opt) + 1;
+            m_pending_start = m_next_idx;
+            m_durable_next = m_next_idx;
+            cache_reset_locked();
         }
     }
 
@@ -291,7 +329,10 @@ namespace cbdc::raft {
         leveldb::WriteBatch batch;
 
         {
-            std::lock_guard<std::mutex> l(m_db_mut);
+            std::lock_guard<profiled_mutex> l(m_db_mut);
+            if(!flush_locked()) {
+                return false;
+            }
 
             const auto n_elems = last_log_index - m_start_idx + 1;
             std::vector<data_slice::second_type> data_slices(n_elems);
@@ -303,36 +344,122 @@ namespace cbdc::raft {
 
             const auto status = m_db->Write(m_write_opt, &batch);
             assert(status.ok());
+            m_dirty = true;
 
             m_start_idx = last_log_index + 1;
             m_next_idx = std::max(m_next_idx, m_start_idx);
+            m_pending_start = m_next_idx;
+            m_durable_next = std::max(m_durable_next, m_next_idx);
+            while(!m_cache.empty() && m_cache_start < m_start_idx) {
+                m_cache_bytes -= m_cache.front().m_size;
+                m_cache.pop_front();
+                m_cache_start++;
+            }
+            if(m_cache.empty()) {
+                m_cache_start = m_next_idx;
+            }
         }
 
         return true;
     }
 
     auto log_store::flush() -> bool {
-        // LevelDB does not provide a way to issue a single "flush" call. As a
-        // workaround make a dummy write with no lasting effects where sync =
-        // true.
+        std::lock_guard<profiled_mutex> l(m_db_mut);
+        return flush_locked();
+    }
+
+    auto log_store::flush_locked() -> bool {
+        const auto no_changes
+            = m_pending.empty() && m_durable_next <= m_next_idx;
+        if(no_changes && !m_dirty) {
+            return true;
+        }
+
+        static auto& flush_latency
+            = metrics::registry::global().get_latency_histogram(
+                "raft_log_flush_seconds",
+                "Time to write and sync buffered raft log entries.");
+        static auto& flush_size = metrics::registry::global().get_histogram(
+            "raft_log_flush_entries",
+            "Number of raft log entries written per flush.");
+        auto timer = metrics::scoped_timer(flush_latency);
+        flush_size.record(m_pending.size());
 
         leveldb::WriteOptions sync_opts;
         sync_opts.sync = true;
 
+        // WriteBatch copies keys and values, so the key slices' backing
+        // data need not outlive each call
         leveldb::WriteBatch batch;
+        for(auto i = m_next_idx; i < m_durable_next; i++) {
+            const auto key = get_key_slice(i);
+            batch.Delete(key.first);
+        }
+        for(size_t i{0}; i < m_pending.size(); i++) {
+            const auto key = get_key_slice(m_pending_start + i);
+            batch.Put(key.first, buffer_slice(*m_pending[i]));
+        }
 
-        // Log entry 0 is always empty so we're not overwriting anything
-        // important
-        std::array<char, sizeof(uint64_t)> dummy_key_data{};
-        leveldb::Slice dummy_key_slice(dummy_key_data.data(),
-                                       dummy_key_data.size());
-        batch.Put(dummy_key_slice, dummy_key_slice);
-        batch.Delete(dummy_key_slice);
+        if(no_changes) {
+            // Only earlier unsynced writes need syncing. LevelDB does not
+            // provide a way to issue a single "flush" call, so make a dummy
+            // write with no lasting effects. Log entry 0 is always empty so
+            // we're not overwriting anything important.
+            std::array<char, sizeof(uint64_t)> dummy_key_data{};
+            leveldb::Slice dummy_key_slice(dummy_key_data.data(),
+                                           dummy_key_data.size());
+            batch.Put(dummy_key_slice, dummy_key_slice);
+            batch.Delete(dummy_key_slice);
+        }
 
-        {
-            std::lock_guard<std::mutex> l(m_db_mut);
-            const auto status = m_db->Write(sync_opts, &batch);
-            return status.ok();
+        const auto status = m_db->Write(sync_opts, &batch);
+        if(!status.ok()) {
+            return false;
+        }
+
+        m_pending.clear();
+        m_pending_start = m_next_idx;
+        m_durable_next = m_next_idx;
+        m_dirty = false;
+        return true;
+    }
+
+    void log_store::cache_push_locked(nuraft::ptr<nuraft::log_entry> entry,
+                                      size_t size) {
+        m_cache.push_back({std::move(entry), size});
+        m_cache_bytes += size;
+        while(!m_cache.empty() && m_cache_bytes > m_cache_capacity) {
+            m_cache_bytes -= m_cache.front().m_size;
+            m_cache.pop_front();
+            m_cache_start++;
+        }
+    }
+
+    void log_store::cache_truncate_locked(uint64_t index) {
+        if(index <= m_cache_start) {
+            m_cache.clear();
+            m_cache_bytes = 0;
+            m_cache_start = index;
+            return;
+        }
+        while(m_cache_start + m_cache.size() > index) {
+            m_cache_bytes -= m_cache.back().m_size;
+            m_cache.pop_back();
+        }
+    }
+
+    void log_store::cache_reset_locked() {
+        m_cache.clear();
+        m_cache_bytes = 0;
+        m_cache_start = m_next_idx;
+    }
+
+    auto log_store::buffered_entry_locked(uint64_t index) const
+        -> nuraft::ptr<nuraft::log_entry> {
+        if(index >= m_cache_start) {
+            return m_cache[index - m_cache_start].m_entry;
         }
+        const auto& buf = m_pending[index - m_pending_start];
+        return log_entry_from_slice(buffer_slice(*buf));
     }
 }
@@ -7,17 +7,40 @@
 #define OPENCBDC_TX_SRC_RAFT_LOG_STORE_H_
 
 #include "index_comparator.hpp"
+#include "util/common/leveldb_options.hpp"
+#include "util/common/profiled_mutex.hpp"
 
+#include <deque>
 #include <leveldb/db.h>
 #include <libnuraft/log_store.hxx>
 #include <mutex>
+#include <vector>
 
 namespace cbdc::raft {
-    /// NuRaft log_store implementation using LevelDB.
+    /// \brief NuRaft log_store implementation using LevelDB.
+    ///
+    /// Appended entries are buffered in memory, where reads can see them,
+    /// and written to the database in a single synced batch by \ref flush,
+    /// so the append rate is bound by disk bandwidth rather than by fsyncs
+    /// per entry. The most recent entries are also kept in a bounded
+    /// in-memory cache so that replicating them to followers does not read
+    /// or deserialize anything from storage.
     class log_store : public nuraft::log_store {
       public:
-        log_store() = default;
-        ~log_store() override = default;
+        /// Default size limit of the recent entry cache, in bytes of
+        /// serialized log entries.
+        static constexpr size_t default_cache_bytes = 64UL * 1024 * 1024;
+
+        /// Constructor.
+        /// \param cache_bytes maximum total serialized size of the recent
+        ///                    log entries to keep in memory. Zero disables
+        ///                    the cache.
+        /// \param db_profile tuning of the LevelDB database.
+        explicit log_store(size_t cache_bytes = default_cache_bytes,
+                           const config::leveldb_profile& db_profile = {});
+
+        /// Destructor. Flushes buffered log entries.
+        ~log_store() override;
 
         log_store(const log_store& other) = delete;
         auto operator=(const log_store& other) -> log_store& = delete;
@@ -44,13 +67,16 @@ namespace cbdc::raft {
         [[nodiscard]] auto last_entry() const
             -> nuraft::ptr<nuraft::log_entry> override;
 
-        /// Append the given log entry to the end of the log.
+        /// Append the given log entry to the end of the log. The entry is
+        /// not durable until the next call to \ref flush.
         /// \param entry log entry to append.
         /// \return index of the appended log entry.
         auto append(nuraft::ptr<nuraft::log_entry>& entry)
             -> uint64_t override;
 
-        /// Write a log entry at the given index.
+        /// Write a log entry at the given index, removing any later
+        /// entries. The change is not durable until the next call to
+        /// \ref flush.
         /// \param index log index at which to write the entry.
         /// \param entry log entry to write.
         void write_at(uint64_t index,
@@ -99,20 +125,54 @@ namespace cbdc::raft {
         /// \return true.
         auto compact(uint64_t last_log_index) -> bool override;
 
-        /// Flush any buffered writes to disk.
+        /// Write buffered log entries to the database in one batch, and
+        /// sync it and any earlier writes to disk.
         /// \return true if the flush was successful.
         auto flush() -> bool override;
 
       private:
+        /// Must outlive m_db.
+        leveldb_options m_db_opts;
         std::unique_ptr<leveldb::DB> m_db{};
-        mutable std::mutex m_db_mut{};
+        mutable profiled_mutex m_db_mut{"raft_log_store"};
         uint64_t m_next_idx{};
         uint64_t m_start_idx{};
 
+        /// Serialized entries not yet written to the database, at indices
+        /// from m_pending_start up to m_next_idx.
+        std::vector<nuraft::ptr<nuraft::buffer>> m_pending{};
+        uint64_t m_pending_start{};
+        /// Index after the last entry in the database. Exceeds m_next_idx
+        /// when write_at has truncated the log since the last flush.
+        uint64_t m_durable_next{};
+        /// True if the database has unsynced writes.
+        bool m_dirty{false};
+
+        struct cached_entry {
+            nuraft::ptr<nuraft::log_entry> m_entry;
+            size_t m_size;
+        };
+
+        /// Most recent log entries, at indices from m_cache_start up to
+        /// m_next_idx.
+        std::deque<cached_entry> m_cache{};
+        uint64_t m_cache_start{};
+        size_t m_cache_bytes{};
+        size_t m_cache_capacity;
+
         leveldb::ReadOptions m_read_opt;
         leveldb::WriteOptions m_write_opt;
 
         index_comparator m_cmp;
+
+        auto flush_locked() -> bool;
+
+        void cache_push_locked(nuraft::ptr<nuraft::log_entry> entry,
+                               size_t size);
+        void cache_truncate_locked(uint64_t index);
+        void cache_reset_locked();
+        [[nodiscard]] auto buffered_entry_locked(uint64_t index) const
+            -> nuraft::ptr<nuraft::log_entry>;
     };
 }
 
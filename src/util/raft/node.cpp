@@ -5,7 +5,20 @@
 
 #include "node.hpp"
 
+#include "util/common/affinity.hpp"
+#include "util/common/metrics.hpp"
+
 namespace cbdc::raft {
+    namespace {
+        auto commit_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "raft_commit_seconds",
+                    "Time from appending a raft entry to its commit.");
+            return hist;
+        }
+    }
+
     node::node(int node_id,
                std::vector<network::endpoint_t> raft_endpoints,
                const std::string& node_type,
@@ -13,7 +26,8 @@ namespace cbdc::raft {
                nuraft::ptr<nuraft::state_machine> sm,
                size_t asio_thread_pool_size,
                std::shared_ptr<logging::log> logger,
-               nuraft::cb_func::func_type raft_cb)
+               nuraft::cb_func::func_type raft_cb,
+               log_store_options log_opts)
         : m_node_id(static_cast<uint32_t>(node_id)),
           m_blocking(blocking),
           m_port(raft_endpoints[m_node_id].second),
@@ -23,10 +37,14 @@ namespace cbdc::raft {
               node_type + "_raft_log_" + std::to_string(m_node_id),
               node_type + "_raft_config_" + std::to_string(m_node_id) + ".dat",
               node_type + "_raft_state_" + std::to_string(m_node_id) + ".dat",
-              std::move(raft_endpoints))),
+              std::move(raft_endpoints),
+              log_opts)),
           m_sm(std::move(sm)),
           m_log(std::move(logger)) {
         m_asio_opt.thread_pool_size_ = asio_thread_pool_size;
+        m_asio_opt.worker_start_ = [](uint32_t /* id */) {
+            pin_current_thread(thread_role::raft);
+        };
         m_init_opts.raft_callback_ = std::move(raft_cb);
         if(m_node_id != 0) {
             m_init_opts.skip_initial_election_timeout_ = true;
@@ -42,6 +60,7 @@ namespace cbdc::raft {
             params.return_method_ = nuraft::raft_params::async_handler;
         }
         params.auto_forwarding_ = false;
+        m_heartbeat_ms = params.heart_beat_interval_;
 
         m_raft_instance = m_launcher.init(m_sm,
                                           m_smgr,
@@ -72,13 +91,20 @@ namespace cbdc::raft {
 
     auto node::replicate(nuraft::ptr<nuraft::buffer> new_log,
                          const callback_type& result_fn) const -> bool {
+        auto start = std::chrono::steady_clock::now();
         auto ret = m_raft_instance->append_entries({std::move(new_log)});
         if(!ret->get_accepted()) {
             return false;
         }
 
         if(result_fn) {
-            ret->when_ready(result_fn);
+            ret->when_ready(
+                [start, result_fn](result_type& r,
+                                   nuraft::ptr<std::exception>& err) {
+                    commit_latency().record(std::chrono::steady_clock::now()
+                                            - start);
+                    result_fn(r, err);
+                });
         }
 
         return true;
@@ -86,6 +112,7 @@ namespace cbdc::raft {
 
     auto node::replicate_sync(const nuraft::ptr<nuraft::buffer>& new_log) const
         -> std::optional<nuraft::ptr<nuraft::buffer>> {
+        auto timer = metrics::scoped_timer(commit_latency());
         auto ret = m_raft_instance->append_entries({new_log});
         if(!ret->get_accepted()
            || ret->get_result_code() != nuraft::cmd_result_code::OK) {
@@ -103,6 +130,113 @@ namespace cbdc::raft {
         return m_sm->last_commit_index();
     }
 
+    auto node::leader_id() const -> std::optional<size_t> {
+        // NuRaft server IDs are node IDs plus one, see state_manager
+        auto leader = m_raft_instance->get_leader();
+        if(leader <= 0) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(leader - 1);
+    }
+
+    auto node::read_index() const -> std::optional<uint64_t> {
+        const auto start = std::chrono::steady_clock::now();
+        if(!m_raft_instance->is_leader()) {
+            return std::nullopt;
+        }
+        {
+            // Every entry committed by an earlier leader sits below the end
+            // of the log as this node first saw it in its term
+            std::unique_lock<std::mutex> l(m_read_mut);
+            const auto term = m_raft_instance->get_term();
+            if(term != m_read_term) {
+                m_read_term = term;
+                m_term_start_idx = m_raft_instance->get_last_log_idx();
+            }
+            if(m_raft_instance->get_committed_log_idx() < m_term_start_idx) {
+                return std::nullopt;
+            }
+        }
+        const auto idx = m_raft_instance->get_committed_log_idx();
+
+        // NuRaft has no on-demand quorum round, so wait for a majority of
+        // the cluster to respond to the heartbeats and appends it sends
+        // anyway, counting only responses received after the call started
+        const auto servers = m_raft_instance->get_config()->get_servers();
+        const auto quorum = servers.size() / 2 + 1;
+        const auto deadline = start + read_index_timeout();
+        static constexpr auto poll_interval = std::chrono::milliseconds(1);
+        while(m_raft_instance->is_leader()) {
+            const auto elapsed
+                = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+            size_t acks{1};
+            for(const auto& peer : m_raft_instance->get_peer_info_all()) {
+                if(peer.last_succ_resp_us_
+                   < static_cast<uint64_t>(elapsed)) {
+                    acks++;
+                }
+            }
+            if(acks >= quorum) {
+                return idx;
+            }
+            if(std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            std::this_thread::sleep_for(poll_interval);
+        }
+        return std::nullopt;
+    }
+
+    auto node::read_index_timeout() const -> std::chrono::milliseconds {
+        return std::chrono::milliseconds(2 * m_heartbeat_ms);
+    }
+
+    auto node::await_applied(uint64_t idx,
+                             std::chrono::milliseconds timeout) const
+        -> bool {
+        std::unique_lock<std::mutex> l(m_applied_mut);
+        return m_applied_cv.wait_for(l, timeout, [&] {
+            return m_sm->last_commit_index() >= idx;
+        });
+    }
+
+    void node::notify_applied() const {
+        // Holding the lock stops a waiter missing the wakeup between its
+        // check of the commit index and its wait
+        std::unique_lock<std::mutex> l(m_applied_mut);
+        m_applied_cv.notify_all();
+    }
+
+    auto node::transfer_leadership(std::chrono::milliseconds timeout) const
+        -> bool {
+        if(!m_raft_instance->is_leader()) {
+            return true;
+        }
+        if(m_raft_instance->get_config()->get_servers().size() < 2) {
+            return false;
+        }
+        m_log->info("Transferring raft leadership");
+        // Without an immediate yield NuRaft pauses writes, waits for the
+        // chosen follower to match its log, then asks it to take over
+        m_raft_instance->yield_leadership(false);
+        static constexpr auto poll_interval = std::chrono::milliseconds(10);
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while(std::chrono::steady_clock::now() < deadline) {
+            auto leader = leader_id();
+            if(!m_raft_instance->is_leader() && leader.has_value()
+               && leader.value() != m_node_id) {
+                m_log->info("Raft leadership transferred to node",
+                            leader.value());
+                return true;
+            }
+            std::this_thread::sleep_for(poll_interval);
+        }
+        m_log->warn("Raft leadership transfer timed out");
+        return false;
+    }
+
     auto node::get_sm() const -> nuraft::state_machine* {
         return m_sm.get();
     }
@@ -11,7 +11,9 @@
 #include "util/common/config.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <condition_variable>
 #include <libnuraft/nuraft.hxx>
+#include <mutex>
 
 namespace cbdc::raft {
     /// A NuRaft state machine execution result.
@@ -51,6 +53,7 @@ namespace cbdc::raft {
         ///                              of cores on the system.
         /// \param logger log instance NuRaft should use.
         /// \param raft_cb NuRaft callback to report raft events.
+        /// \param log_opts storage settings for the raft log.
         node(int node_id,
              std::vector<network::endpoint_t> raft_endpoints,
              const std::string& node_type,
@@ -58,7 +61,8 @@ namespace cbdc::raft {
              nuraft::ptr<nuraft::state_machine> sm,
              size_t asio_thread_pool_size,
              std::shared_ptr<logging::log> logger,
-             nuraft::cb_func::func_type raft_cb);
+             nuraft::cb_func::func_type raft_cb,
+             log_store_options log_opts = {});
 
         ~node();
 
@@ -96,6 +100,58 @@ namespace cbdc::raft {
         /// \return log index.
         [[nodiscard]] auto last_log_idx() const -> uint64_t;
 
+        /// Returns the ID of the node the cluster currently follows.
+        /// \return node ID of the leader, or std::nullopt if unknown.
+        [[nodiscard]] auto leader_id() const -> std::optional<size_t>;
+
+        /// Returns the commit index to serve a consistent read from, for
+        /// this node or a follower asking on behalf of a client. A read
+        /// served once the state machine has applied the index reflects
+        /// every entry committed before this call. The leader only answers
+        /// once it has committed an entry from its own term, so its commit
+        /// index covers every earlier leader's commits, and once a quorum
+        /// has acknowledged it after the call started, so no newer leader
+        /// can have committed entries it does not know about. The wait for
+        /// the quorum is bounded by \ref read_index_timeout.
+        /// \return commit index, or std::nullopt if this node is not the
+        ///         leader, has not committed an entry in its term yet or
+        ///         did not hear from a quorum in time.
+        [[nodiscard]] auto read_index() const -> std::optional<uint64_t>;
+
+        /// Returns the longest time \ref read_index waits for a quorum of
+        /// the cluster to acknowledge the leader. Two heartbeat intervals,
+        /// as an idle leader only contacts followers once per heartbeat.
+        /// \return maximum quorum wait.
+        [[nodiscard]] auto read_index_timeout() const
+            -> std::chrono::milliseconds;
+
+        /// Waits until the state machine has applied the log entry at the
+        /// given index. The state machine must call \ref notify_applied
+        /// each time its last commit index advances.
+        /// \param idx log index to wait for.
+        /// \param timeout maximum time to wait.
+        /// \return true if the state machine reached the index in time.
+        [[nodiscard]] auto await_applied(uint64_t idx,
+                                         std::chrono::milliseconds timeout)
+            const -> bool;
+
+        /// Wakes callers of \ref await_applied to re-check the state
+        /// machine's last commit index. Called by the state machine after
+        /// applying each log entry.
+        void notify_applied() const;
+
+        /// Hands leadership to an up-to-date follower, so the cluster keeps
+        /// serving without waiting out an election timeout when this node
+        /// stops. The leader stops accepting new log entries until the
+        /// follower has caught up and taken over. Does nothing if this
+        /// node is not the leader.
+        /// \param timeout maximum time to wait for another node to lead.
+        /// \return true if another node leads, or this node was not the
+        ///         leader. False if the cluster has no other node or no
+        ///         follower took over in time.
+        [[nodiscard]] auto
+        transfer_leadership(std::chrono::milliseconds timeout) const -> bool;
+
         /// Returns a pointer to the state machine replicated by this raft
         /// node.
         /// \return pointer to the state machine.
@@ -119,6 +175,15 @@ namespace cbdc::raft {
         nuraft::raft_server::init_options m_init_opts;
 
         std::shared_ptr<logging::log> m_log;
+
+        int32_t m_heartbeat_ms{};
+
+        mutable std::mutex m_read_mut;
+        mutable uint64_t m_read_term{};
+        mutable uint64_t m_term_start_idx{};
+
+        mutable std::mutex m_applied_mut;
+        mutable std::condition_variable m_applied_cv;
     };
 }
 
@@ -6,6 +6,7 @@
 #ifndef OPENCBDC_TX_SRC_RAFT_RPC_SERVER_H_
 #define OPENCBDC_TX_SRC_RAFT_RPC_SERVER_H_
 
+#include "batching_replicator.hpp"
 #include "node.hpp"
 #include "util/rpc/async_server.hpp"
 
@@ -21,8 +22,13 @@ namespace cbdc::raft::rpc {
         /// for this server.
         /// \param impl pointer to the raft node.
         /// \see cbdc::rpc::server
-        void register_raft_node(std::shared_ptr<node> impl) {
+        /// \param replicator if set, replicates requests so concurrent ones
+        ///                   share log entries.
+        void register_raft_node(
+            std::shared_ptr<node> impl,
+            std::shared_ptr<batching_replicator> replicator = nullptr) {
             m_impl = std::move(impl);
+            m_replicator = std::move(replicator);
             cbdc::rpc::raw_async_server::register_handler_callback(
                 [&](buffer req, response_callback_type resp_cb) {
                     return request_handler(std::move(req), std::move(resp_cb));
@@ -33,6 +39,7 @@ namespace cbdc::raft::rpc {
 
       private:
         std::shared_ptr<node> m_impl;
+        std::shared_ptr<batching_replicator> m_replicator;
 
         using response_callback_type =
             typename cbdc::rpc::raw_async_server::response_callback_type;
@@ -51,6 +58,21 @@ namespace cbdc::raft::rpc {
             nuraft::buffer_serializer bs(new_log);
             bs.put_raw(request_buf.data(), request_buf.size());
 
+            if(m_replicator) {
+                return m_replicator->replicate(
+                    std::move(new_log),
+                    [resp_cb = std::move(response_callback)](
+                        std::optional<nuraft::ptr<nuraft::buffer>> res) {
+                        if(!res.has_value() || !*res) {
+                            resp_cb(std::nullopt);
+                            return;
+                        }
+                        auto resp_pkt = cbdc::buffer();
+                        resp_pkt.append((*res)->data_begin(), (*res)->size());
+                        resp_cb(std::move(resp_pkt));
+                    });
+            }
+
             auto success = m_impl->replicate(
                 new_log,
                 [&, resp_cb = std::move(response_callback), req_buf = new_log](
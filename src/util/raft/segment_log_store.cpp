@@ -0,0 +1,576 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "segment_log_store.hpp"
+
+#include "crypto/siphash.h"
+#include "util/common/metrics.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <libnuraft/buffer_serializer.hxx>
+#include <limits>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cbdc::raft {
+    namespace {
+        constexpr auto segment_prefix = "segment_";
+        constexpr size_t segment_name_digits = 20;
+
+        /// Each record starts with its log index, payload length and
+        /// checksum, followed by the serialized log entry.
+        constexpr size_t header_size = 3 * sizeof(uint64_t);
+        constexpr uint64_t checksum_k0 = 0x736567;
+        constexpr uint64_t checksum_k1 = 0x6c6f67;
+
+        auto read_u64(const unsigned char* p) -> uint64_t {
+            uint64_t ret{};
+            std::memcpy(&ret, p, sizeof(ret));
+            return ret;
+        }
+
+        void write_u64(unsigned char* p, uint64_t val) {
+            std::memcpy(p, &val, sizeof(val));
+        }
+
+        auto record_checksum(uint64_t index,
+                             const unsigned char* data,
+                             size_t len) -> uint64_t {
+            return CSipHasher(checksum_k0, checksum_k1)
+                .Write(index)
+                .Write(static_cast<uint64_t>(len))
+                .Write(data, len)
+                .Finalize();
+        }
+
+        auto segment_name(uint64_t first_idx) -> std::string {
+            const auto digits = std::to_string(first_idx);
+            return segment_prefix
+                 + std::string(segment_name_digits - digits.size(), '0')
+                 + digits;
+        }
+
+        auto parse_segment_name(const std::string& name)
+            -> std::optional<uint64_t> {
+            const auto prefix_len = std::strlen(segment_prefix);
+            if(name.size() != prefix_len + segment_name_digits
+               || name.compare(0, prefix_len, segment_prefix) != 0) {
+                return std::nullopt;
+            }
+            const auto digits = name.substr(prefix_len);
+            if(!std::all_of(digits.begin(), digits.end(), [](char c) {
+                   return c >= '0' && c <= '9';
+               })) {
+                return std::nullopt;
+            }
+            return std::stoull(digits);
+        }
+
+        auto sync_dir(const std::string& dir) -> bool {
+            auto fd = ::open(dir.c_str(), O_RDONLY);
+            if(fd < 0) {
+                return false;
+            }
+            const auto ret = ::fsync(fd) == 0;
+            ::close(fd);
+            return ret;
+        }
+
+        auto flush_latency() -> metrics::histogram& {
+            static auto& hist
+                = metrics::registry::global().get_latency_histogram(
+                    "raft_log_flush_seconds",
+                    "Time to write and sync buffered raft log entries.");
+            return hist;
+        }
+
+        auto flush_size() -> metrics::histogram& {
+            static auto& hist = metrics::registry::global().get_histogram(
+                "raft_log_flush_entries",
+                "Number of raft log entries written per flush.");
+            return hist;
+        }
+    }
+
+    /// A segment file mapped into memory.
+    struct segment_log_store::segment {
+        segment(uint64_t first_idx, std::string path)
+            : m_first_idx(first_idx),
+              m_path(std::move(path)) {}
+
+        ~segment() {
+            if(m_data != nullptr) {
+                ::munmap(m_data, m_size);
+            }
+        }
+
+        segment(const segment&) = delete;
+        auto operator=(const segment&) -> segment& = delete;
+        segment(segment&&) = delete;
+        auto operator=(segment&&) -> segment& = delete;
+
+        /// Map the segment file, first creating and preallocating it if
+        /// create_size is non-zero.
+        auto open(size_t create_size) -> bool {
+            auto flags = O_RDWR;
+            if(create_size != 0) {
+                flags |= O_CREAT | O_TRUNC;
+            }
+            auto fd = ::open(m_path.c_str(), flags, S_IRUSR | S_IWUSR);
+            if(fd < 0) {
+                return false;
+            }
+            if(create_size != 0) {
+                const auto len = static_cast<off_t>(create_size);
+#ifdef __APPLE__
+                const auto allocated = ::ftruncate(fd, len) == 0;
+#else
+                const auto allocated = ::posix_fallocate(fd, 0, len) == 0;
+#endif
+                if(!allocated || ::fsync(fd) != 0) {
+                    ::close(fd);
+                    return false;
+                }
+                m_size = create_size;
+            } else {
+                struct stat st {};
+                if(::fstat(fd, &st) != 0 || st.st_size < 0) {
+                    ::close(fd);
+                    return false;
+                }
+                m_size = static_cast<size_t>(st.st_size);
+            }
+            if(m_size < header_size) {
+                ::close(fd);
+                return false;
+            }
+            auto* map = ::mmap(nullptr,
+                               m_size,
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED,
+                               fd,
+                               0);
+            // The mapping keeps its own reference to the file.
+            ::close(fd);
+            if(map == MAP_FAILED) {
+                return false;
+            }
+            m_data = static_cast<unsigned char*>(map);
+            return true;
+        }
+
+        /// Index the valid records at the start of the segment. Zeroes
+        /// anything after them, such as a torn record, so that later
+        /// appends cannot be followed by leftover data.
+        void scan() {
+            size_t off{0};
+            while(off + header_size <= m_size) {
+                const auto* hdr = m_data + off;
+                const auto idx = read_u64(hdr);
+                const auto len = read_u64(hdr + sizeof(uint64_t));
+                const auto sum = read_u64(hdr + 2 * sizeof(uint64_t));
+                if(len == 0 || idx != next_idx()
+                   || len > m_size - off - header_size
+                   || record_checksum(idx, hdr + header_size, len) != sum) {
+                    break;
+                }
+                m_offsets.push_back(off);
+                off += header_size + len;
+            }
+            m_end = off;
+
+            const auto tail = std::min(m_size - m_end, header_size);
+            const auto* tail_begin = m_data + m_end;
+            if(std::any_of(tail_begin, tail_begin + tail, [](auto b) {
+                   return b != 0;
+               })) {
+                std::memset(m_data + m_end, 0, m_size - m_end);
+                mark_dirty(m_end, m_size);
+            }
+        }
+
+        void mark_dirty(size_t begin, size_t end) {
+            m_dirty_begin = std::min(m_dirty_begin, begin);
+            m_dirty_end = std::max(m_dirty_end, end);
+        }
+
+        /// Return true if the segment was written since the last sync.
+        [[nodiscard]] auto dirty() const -> bool {
+            return m_dirty_begin < m_dirty_end;
+        }
+
+        /// Sync the range written since the last call.
+        auto sync() -> bool {
+            if(!dirty()) {
+                return true;
+            }
+            static const auto page_size
+                = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            const auto begin = m_dirty_begin - m_dirty_begin % page_size;
+            if(::msync(m_data + begin, m_dirty_end - begin, MS_SYNC) != 0) {
+                return false;
+            }
+            m_dirty_begin = std::numeric_limits<size_t>::max();
+            m_dirty_end = 0;
+            return true;
+        }
+
+        /// Return the index after the last entry in the segment.
+        [[nodiscard]] auto next_idx() const -> uint64_t {
+            return m_first_idx + m_offsets.size();
+        }
+
+        uint64_t m_first_idx;
+        std::string m_path;
+        unsigned char* m_data{};
+        size_t m_size{};
+        /// Offset of each record in the segment.
+        std::vector<size_t> m_offsets{};
+        /// Offset after the last record.
+        size_t m_end{};
+        size_t m_dirty_begin{std::numeric_limits<size_t>::max()};
+        size_t m_dirty_end{};
+    };
+
+    segment_log_store::segment_log_store(size_t segment_bytes)
+        : m_segment_bytes(segment_bytes) {}
+
+    segment_log_store::~segment_log_store() {
+        std::lock_guard<std::mutex> l(m_mut);
+        flush_locked();
+    }
+
+    auto segment_log_store::load(const std::string& dir) -> bool {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if(!std::filesystem::is_directory(dir, ec)) {
+            return false;
+        }
+
+        auto files = std::vector<std::pair<uint64_t, std::string>>();
+        for(const auto& file : std::filesystem::directory_iterator(dir, ec)) {
+            const auto first_idx
+                = parse_segment_name(file.path().filename().string());
+            if(first_idx.has_value()) {
+                files.emplace_back(first_idx.value(), file.path().string());
+            }
+        }
+        if(ec) {
+            return false;
+        }
+        std::sort(files.begin(), files.end());
+
+        std::lock_guard<std::mutex> l(m_mut);
+        m_dir = dir;
+        m_segments.clear();
+        for(auto& [first_idx, path] : files) {
+            auto seg = std::make_unique<segment>(first_idx, std::move(path));
+            // Segments after a gap hold entries written after ones which
+            // were lost, so they are not part of the log
+            if(!m_segments.empty()
+               && first_idx != m_segments.back()->next_idx()) {
+                if(!remove_segment(*seg)) {
+                    return false;
+                }
+                continue;
+            }
+            if(!seg->open(0)) {
+                return false;
+            }
+            seg->scan();
+            m_segments.push_back(std::move(seg));
+        }
+
+        if(m_segments.empty()) {
+            m_start_idx = 1;
+            m_next_idx = 1;
+        } else {
+            m_start_idx = m_segments.front()->m_first_idx;
+            m_next_idx = m_segments.back()->next_idx();
+        }
+
+        return flush_locked();
+    }
+
+    auto segment_log_store::next_slot() const -> uint64_t {
+        std::lock_guard<std::mutex> l(m_mut);
+        return m_next_idx;
+    }
+
+    auto segment_log_store::start_index() const -> uint64_t {
+        std::lock_guard<std::mutex> l(m_mut);
+        return m_start_idx;
+    }
+
+    auto segment_log_store::last_entry() const
+        -> nuraft::ptr<nuraft::log_entry> {
+        std::lock_guard<std::mutex> l(m_mut);
+        return entry_locked(m_next_idx - 1);
+    }
+
+    auto segment_log_store::append(nuraft::ptr<nuraft::log_entry>& entry)
+        -> uint64_t {
+        const auto buf = entry->serialize();
+        std::lock_guard<std::mutex> l(m_mut);
+        [[maybe_unused]] const auto appended
+            = append_locked(buf->data_begin(), buf->size());
+        assert(appended);
+        return m_next_idx - 1;
+    }
+
+    void segment_log_store::write_at(uint64_t index,
+                                     nuraft::ptr<nuraft::log_entry>& entry) {
+        const auto buf = entry->serialize();
+        std::lock_guard<std::mutex> l(m_mut);
+        [[maybe_unused]] const auto truncated = truncate_locked(index);
+        assert(truncated);
+        [[maybe_unused]] const auto appended
+            = append_locked(buf->data_begin(), buf->size());
+        assert(appended);
+    }
+
+    auto segment_log_store::log_entries(uint64_t start, uint64_t end)
+        -> log_entries_t {
+        auto ret = nuraft::cs_new<log_entries_t::element_type>(end - start);
+        std::lock_guard<std::mutex> l(m_mut);
+        assert(end <= m_next_idx);
+        for(size_t i{0}; i < ret->size(); i++) {
+            (*ret)[i] = entry_locked(start + i);
+        }
+        return ret;
+    }
+
+    auto segment_log_store::entry_at(uint64_t index)
+        -> nuraft::ptr<nuraft::log_entry> {
+        std::lock_guard<std::mutex> l(m_mut);
+        return entry_locked(index);
+    }
+
+    auto segment_log_store::term_at(uint64_t index) -> uint64_t {
+        const auto entry = entry_at(index);
+        return entry->get_term();
+    }
+
+    auto segment_log_store::pack(uint64_t index, int32_t cnt)
+        -> nuraft::ptr<nuraft::buffer> {
+        assert(cnt >= 0);
+        std::lock_guard<std::mutex> l(m_mut);
+        assert(index >= m_start_idx);
+        assert(index + static_cast<uint64_t>(cnt) <= m_next_idx);
+
+        auto records = std::vector<std::pair<const unsigned char*, size_t>>(
+            static_cast<size_t>(cnt));
+        size_t total_len{0};
+        for(size_t i{0}; i < records.size(); i++) {
+            records[i] = record_locked(index + i);
+            total_len += records[i].second;
+        }
+
+        auto ret = nuraft::buffer::alloc(
+            sizeof(uint64_t) + records.size() * sizeof(uint64_t)
+            + total_len);
+        nuraft::buffer_serializer bs(ret);
+
+        bs.put_u64(records.size());
+
+        for(const auto& [data, len] : records) {
+            bs.put_u64(len);
+            bs.put_raw(data, len);
+        }
+
+        return ret;
+    }
+
+    void segment_log_store::apply_pack(uint64_t index, nuraft::buffer& pack) {
+        nuraft::buffer_serializer bs(pack);
+
+        const auto cnt = bs.get_u64();
+
+        std::lock_guard<std::mutex> l(m_mut);
+        if(index < m_start_idx || index > m_next_idx) {
+            // The pack does not continue the log, so replace it entirely
+            while(!m_segments.empty()) {
+                [[maybe_unused]] const auto removed
+                    = remove_segment(*m_segments.back());
+                assert(removed);
+                m_segments.pop_back();
+            }
+            m_start_idx = index;
+            m_next_idx = index;
+        } else {
+            [[maybe_unused]] const auto truncated = truncate_locked(index);
+            assert(truncated);
+        }
+
+        for(size_t i{0}; i < cnt; i++) {
+            const auto len = bs.get_u64();
+            const auto* data = static_cast<const unsigned char*>(
+                bs.get_raw(static_cast<size_t>(len)));
+            [[maybe_unused]] const auto appended
+                = append_locked(data, static_cast<size_t>(len));
+            assert(appended);
+        }
+    }
+
+    auto segment_log_store::compact(uint64_t last_log_index) -> bool {
+        std::lock_guard<std::mutex> l(m_mut);
+        while(!m_segments.empty()
+              && m_segments.front()->next_idx() <= last_log_index + 1) {
+            if(!remove_segment(*m_segments.front())) {
+                return false;
+            }
+            m_segments.pop_front();
+        }
+
+        m_start_idx = last_log_index + 1;
+        m_next_idx = std::max(m_next_idx, m_start_idx);
+
+        return true;
+    }
+
+    auto segment_log_store::flush() -> bool {
+        std::lock_guard<std::mutex> l(m_mut);
+        return flush_locked();
+    }
+
+    auto segment_log_store::append_locked(const unsigned char* data,
+                                          size_t len) -> bool {
+        const auto rec_size = header_size + len;
+        if(m_segments.empty()
+           || m_segments.back()->m_end + rec_size
+                  > m_segments.back()->m_size) {
+            if(!m_segments.empty() && m_segments.back()->m_offsets.empty()) {
+                // The current segment is empty but too small for this
+                // record, so replace it with one which fits
+                if(!remove_segment(*m_segments.back())) {
+                    return false;
+                }
+                m_segments.pop_back();
+            }
+            auto seg = std::make_unique<segment>(
+                m_next_idx,
+                m_dir + "/" + segment_name(m_next_idx));
+            if(!seg->open(std::max(m_segment_bytes, rec_size))) {
+                return false;
+            }
+            m_segments.push_back(std::move(seg));
+            m_dir_dirty = true;
+        }
+
+        auto& seg = *m_segments.back();
+        auto* rec = seg.m_data + seg.m_end;
+        write_u64(rec, m_next_idx);
+        write_u64(rec + sizeof(uint64_t), len);
+        write_u64(rec + 2 * sizeof(uint64_t),
+                  record_checksum(m_next_idx, data, len));
+        std::memcpy(rec + header_size, data, len);
+
+        seg.m_offsets.push_back(seg.m_end);
+        seg.mark_dirty(seg.m_end, seg.m_end + rec_size);
+        seg.m_end += rec_size;
+        m_next_idx++;
+        m_unflushed++;
+        return true;
+    }
+
+    auto segment_log_store::truncate_locked(uint64_t index) -> bool {
+        if(index >= m_next_idx) {
+            return true;
+        }
+
+        while(!m_segments.empty() && m_segments.back()->m_first_idx >= index) {
+            if(!remove_segment(*m_segments.back())) {
+                return false;
+            }
+            m_segments.pop_back();
+        }
+
+        if(!m_segments.empty()) {
+            auto& seg = *m_segments.back();
+            const auto count = index - seg.m_first_idx;
+            const auto pos = seg.m_offsets[count];
+            // Zero the removed records so that loading cannot mistake them
+            // for entries following the ones which replace them
+            std::memset(seg.m_data + pos, 0, seg.m_end - pos);
+            seg.mark_dirty(pos, seg.m_end);
+            seg.m_offsets.resize(count);
+            seg.m_end = pos;
+        }
+
+        m_next_idx = index;
+        return true;
+    }
+
+    auto segment_log_store::flush_locked() -> bool {
+        const auto dirty = std::any_of(m_segments.begin(),
+                                       m_segments.end(),
+                                       [](const auto& seg) {
+                                           return seg->dirty();
+                                       });
+        if(!dirty && !m_dir_dirty) {
+            return true;
+        }
+
+        auto timer = metrics::scoped_timer(flush_latency());
+        flush_size().record(m_unflushed);
+
+        for(auto& seg : m_segments) {
+            if(!seg->sync()) {
+                return false;
+            }
+        }
+        if(m_dir_dirty) {
+            if(!sync_dir(m_dir)) {
+                return false;
+            }
+            m_dir_dirty = false;
+        }
+
+        m_unflushed = 0;
+        return true;
+    }
+
+    auto segment_log_store::record_locked(uint64_t index) const
+        -> std::pair<const unsigned char*, size_t> {
+        auto it = std::upper_bound(m_segments.begin(),
+                                   m_segments.end(),
+                                   index,
+                                   [](uint64_t idx, const auto& seg) {
+                                       return idx < seg->m_first_idx;
+                                   });
+        assert(it != m_segments.begin());
+        const auto& seg = **std::prev(it);
+        const auto off = seg.m_offsets[index - seg.m_first_idx];
+        const auto* rec = seg.m_data + off;
+        return {rec + header_size,
+                static_cast<size_t>(read_u64(rec + sizeof(uint64_t)))};
+    }
+
+    auto segment_log_store::entry_locked(uint64_t index) const
+        -> nuraft::ptr<nuraft::log_entry> {
+        if(index < m_start_idx || index >= m_next_idx) {
+            return nuraft::cs_new<nuraft::log_entry>(0, nullptr);
+        }
+        const auto [data, len] = record_locked(index);
+        auto buf = nuraft::buffer::alloc(len);
+        std::memcpy(buf->data_begin(), data, len);
+        auto entry = nuraft::log_entry::deserialize(*buf);
+        assert(entry);
+        return entry;
+    }
+
+    auto segment_log_store::remove_segment(const segment& seg) -> bool {
+        std::error_code ec;
+        std::filesystem::remove(seg.m_path, ec);
+        m_dir_dirty = true;
+        return !ec;
+    }
+}
@@ -0,0 +1,162 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RAFT_SEGMENT_LOG_STORE_H_
+#define OPENCBDC_TX_SRC_RAFT_SEGMENT_LOG_STORE_H_
+
+#include <deque>
+#include <libnuraft/log_store.hxx>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cbdc::raft {
+    /// \brief NuRaft log_store implementation using memory-mapped segment
+    ///        files.
+    ///
+    /// The log is split into preallocated segment files, each holding a
+    /// contiguous run of serialized entries named by the index of its first
+    /// entry. Each record carries its log index, length and a checksum, so
+    /// loading stops at the first torn or stale record. An in-memory offset
+    /// index locates entries, \ref pack copies records straight out of the
+    /// mapping, \ref compact deletes whole segments, and \ref flush syncs
+    /// only the ranges written since the previous flush. Unlike an LSM tree,
+    /// nothing is rewritten in the background.
+    class segment_log_store : public nuraft::log_store {
+      public:
+        /// Default size of each preallocated segment file, in bytes.
+        static constexpr size_t default_segment_bytes = 64UL * 1024 * 1024;
+
+        /// Constructor.
+        /// \param segment_bytes size of each segment file. Segments are
+        ///                      enlarged to fit entries bigger than this.
+        explicit segment_log_store(
+            size_t segment_bytes = default_segment_bytes);
+
+        /// Destructor. Flushes written log entries.
+        ~segment_log_store() override;
+
+        segment_log_store(const segment_log_store& other) = delete;
+        auto operator=(const segment_log_store& other)
+            -> segment_log_store& = delete;
+
+        segment_log_store(segment_log_store&& other) = delete;
+        auto operator=(segment_log_store&& other)
+            -> segment_log_store& = delete;
+
+        /// Load the log store from segment files in the given directory,
+        /// creating it if needed. Discards records after the first invalid
+        /// record.
+        /// \param dir segment directory.
+        /// \return true if loading the log succeeded.
+        [[nodiscard]] auto load(const std::string& dir) -> bool;
+
+        /// Return the log index of the next empty log entry.
+        /// \return log index.
+        [[nodiscard]] auto next_slot() const -> uint64_t override;
+
+        /// Return the first log index stored by the log store.
+        /// \return log index.
+        [[nodiscard]] auto start_index() const -> uint64_t override;
+
+        /// Return the last log entry in the log store. Returns an empty log
+        /// entry at index zero if the log store is empty.
+        /// \return log entry.
+        [[nodiscard]] auto last_entry() const
+            -> nuraft::ptr<nuraft::log_entry> override;
+
+        /// Append the given log entry to the end of the log. The entry is
+        /// not durable until the next call to \ref flush.
+        /// \param entry log entry to append.
+        /// \return index of the appended log entry.
+        auto append(nuraft::ptr<nuraft::log_entry>& entry)
+            -> uint64_t override;
+
+        /// Write a log entry at the given index, removing any later
+        /// entries. The change is not durable until the next call to
+        /// \ref flush.
+        /// \param index log index at which to write the entry.
+        /// \param entry log entry to write.
+        void write_at(uint64_t index,
+                      nuraft::ptr<nuraft::log_entry>& entry) override;
+
+        /// List of log entries.
+        using log_entries_t
+            = nuraft::ptr<std::vector<nuraft::ptr<nuraft::log_entry>>>;
+
+        /// Return the log entries in the given range of indices.
+        /// \param start first log entry to retrieve.
+        /// \param end last log entry to retrieve (exclusive).
+        /// \return list of log entries.
+        [[nodiscard]] auto log_entries(uint64_t start, uint64_t end)
+            -> log_entries_t override;
+
+        /// Return the log entry at the given index. Returns a null log entry
+        /// if there is no log entry at the given index.
+        /// \param index log index.
+        /// \return log entry.
+        [[nodiscard]] auto entry_at(uint64_t index)
+            -> nuraft::ptr<nuraft::log_entry> override;
+
+        /// Return the log term associated with the log entry at the given
+        /// index.
+        /// \param index log index.
+        /// \return log term.
+        [[nodiscard]] auto term_at(uint64_t index) -> uint64_t override;
+
+        /// Serialize the given number of log entries from the given index,
+        /// copying the stored records without deserializing them.
+        /// \param index starting log index.
+        /// \param cnt number of log entries to serialize. Must be positive.
+        /// \return buffer containing serialized log entries.
+        [[nodiscard]] auto pack(uint64_t index, int32_t cnt)
+            -> nuraft::ptr<nuraft::buffer> override;
+
+        /// Write the given serialized log entries starting at the given log
+        /// index, removing any later entries.
+        /// \param index log index at which to write the first log entry.
+        /// \param pack serialized log entries.
+        void apply_pack(uint64_t index, nuraft::buffer& pack) override;
+
+        /// Delete log entries from the start of the log up to the given log
+        /// index. Segment files are removed once all of their entries are
+        /// compacted, so entries sharing a segment with later entries remain
+        /// on disk and may be visible again after reloading.
+        /// \param last_log_index last log index to delete (inclusive).
+        /// \return true if removing compacted segments succeeded.
+        auto compact(uint64_t last_log_index) -> bool override;
+
+        /// Sync entries written since the last flush to disk.
+        /// \return true if the flush was successful.
+        auto flush() -> bool override;
+
+      private:
+        struct segment;
+
+        std::string m_dir;
+        size_t m_segment_bytes;
+        mutable std::mutex m_mut{};
+        std::deque<std::unique_ptr<segment>> m_segments{};
+        uint64_t m_start_idx{1};
+        uint64_t m_next_idx{1};
+        /// True if segment files were created or removed since the last
+        /// flush.
+        bool m_dir_dirty{false};
+        /// Number of entries appended since the last flush.
+        size_t m_unflushed{};
+
+        auto append_locked(const unsigned char* data, size_t len) -> bool;
+        auto truncate_locked(uint64_t index) -> bool;
+        auto flush_locked() -> bool;
+        [[nodiscard]] auto record_locked(uint64_t index) const
+            -> std::pair<const unsigned char*, size_t>;
+        [[nodiscard]] auto entry_locked(uint64_t index) const
+            -> nuraft::ptr<nuraft::log_entry>;
+        auto remove_segment(const segment& seg) -> bool;
+    };
+}
+
+#endif // OPENCBDC_TX_SRC_RAFT_SEGMENT_LOG_STORE_H_
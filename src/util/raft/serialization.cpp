@@ -7,7 +7,6 @@
 
 #include <cstring>
 #include <libnuraft/buffer.hxx>
-#include <vector>
 
 namespace cbdc {
     nuraft_serializer::nuraft_serializer(nuraft::buffer& buf) : m_buf(buf) {
@@ -31,18 +30,16 @@ namespace cbdc {
         return m_buf.pos() >= m_buf.size();
     }
 
-    auto nuraft_serializer::write(const void* data, size_t len) -> bool {
+    auto nuraft_serializer::do_write(const void* data, size_t len) -> bool {
         if(m_buf.pos() + len > m_buf.size()) {
             m_valid = false;
             return false;
         }
-        auto data_vec = std::vector<nuraft::byte>(len);
-        std::memcpy(data_vec.data(), data, len);
-        m_buf.put_raw(data_vec.data(), len);
+        m_buf.put_raw(static_cast<const nuraft::byte*>(data), len);
         return true;
     }
 
-    auto nuraft_serializer::read(void* data, size_t len) -> bool {
+    auto nuraft_serializer::do_read(void* data, size_t len) -> bool {
         if(m_buf.pos() + len > m_buf.size()) {
             m_valid = false;
             return false;
@@ -38,12 +38,13 @@ namespace cbdc {
         ///         to write to the buffer.
         [[nodiscard]] auto end_of_buffer() const -> bool final;
 
+      private:
         /// Writes the given raw bytes to the buffer from the current position
         /// of the cursor. Does not resize the buffer.
         /// \param data pointer to the start of the data to write.
         /// \param len number of bytes to write.
         /// \return true if the operation wrote the entirety of the data to the buffer.
-        auto write(const void* data, size_t len) -> bool final;
+        auto do_write(const void* data, size_t len) -> bool final;
 
         /// Reads the given number of bytes from the current cursor in the
         /// buffer into the given destination.
@@ -51,9 +52,8 @@ namespace cbdc {
         /// \param len number of bytes to read from the buffer.
         /// \return true if operation successfully copied the requested number of bytes
         ///        from the buffer to the given destination.
-        auto read(void* data, size_t len) -> bool final;
+        auto do_read(void* data, size_t len) -> bool final;
 
-      private:
         nuraft::buffer& m_buf;
         bool m_valid{true};
     };
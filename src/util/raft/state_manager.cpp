@@ -18,12 +18,14 @@ namespace cbdc::raft {
         std::string log_dir,
         std::string config_file,
         std::string state_file,
-        std::vector<network::endpoint_t> raft_endpoints)
+        std::vector<network::endpoint_t> raft_endpoints,
+        log_store_options log_opts)
         : m_id(srv_id),
           m_config_file(std::move(config_file)),
           m_state_file(std::move(state_file)),
           m_log_dir(std::move(log_dir)),
-          m_raft_endpoints(std::move(raft_endpoints)) {}
+          m_raft_endpoints(std::move(raft_endpoints)),
+          m_log_opts(log_opts) {}
 
     template<typename T>
     void save_object(const T& obj, const std::string& filename) {
@@ -99,7 +101,17 @@ namespace cbdc::raft {
     }
 
     auto state_manager::load_log_store() -> nuraft::ptr<nuraft::log_store> {
-        auto log = nuraft::cs_new<log_store>();
+        if(m_log_opts.m_backend == config::raft_log_backend::segment) {
+            auto log = nuraft::cs_new<segment_log_store>(
+                m_log_opts.m_segment_bytes);
+            if(!log->load(m_log_dir)) {
+                return nullptr;
+            }
+            return log;
+        }
+
+        auto log = nuraft::cs_new<log_store>(m_log_opts.m_cache_bytes,
+                                             m_log_opts.m_leveldb);
         if(!log->load(m_log_dir)) {
             return nullptr;
         }
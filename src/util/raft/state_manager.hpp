@@ -7,11 +7,25 @@
 #define OPENCBDC_TX_SRC_RAFT_STATE_MANAGER_H_
 
 #include "log_store.hpp"
+#include "segment_log_store.hpp"
+#include "util/common/config.hpp"
 #include "util/network/socket.hpp"
 
 #include <libnuraft/nuraft.hxx>
 
 namespace cbdc::raft {
+    /// Storage settings for the raft log.
+    struct log_store_options {
+        /// Log store implementation to use.
+        config::raft_log_backend m_backend{config::raft_log_backend::leveldb};
+        /// Size limit of the LevelDB log store's cache of recent entries.
+        size_t m_cache_bytes{log_store::default_cache_bytes};
+        /// Size of each segment file of the segment log store.
+        size_t m_segment_bytes{segment_log_store::default_segment_bytes};
+        /// Tuning of the LevelDB log store's database.
+        config::leveldb_profile m_leveldb{};
+    };
+
     /// Implementation of nuraft::state_mgr using a file.
     class state_manager : public nuraft::state_mgr {
       public:
@@ -21,11 +35,13 @@ namespace cbdc::raft {
         /// \param config_file file for the cluster configuration.
         /// \param state_file file for the server state.
         /// \param raft_endpoints list of initial node endpoints in the cluster.
+        /// \param log_opts storage settings for the raft log.
         state_manager(int32_t srv_id,
                       std::string log_dir,
                       std::string config_file,
                       std::string state_file,
-                      std::vector<network::endpoint_t> raft_endpoints);
+                      std::vector<network::endpoint_t> raft_endpoints,
+                      log_store_options log_opts = {});
         ~state_manager() override = default;
 
         state_manager(const state_manager& other) = delete;
@@ -68,6 +84,7 @@ namespace cbdc::raft {
         std::string m_state_file;
         std::string m_log_dir;
         std::vector<network::endpoint_t> m_raft_endpoints;
+        log_store_options m_log_opts;
     };
 }
 
@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_RPC_ASYNC_SERVER_H_
 
 #include "server.hpp"
+#include "util/common/tracing.hpp"
 
 namespace cbdc::rpc {
     /// \brief Generic asynchronous RPC server.
@@ -65,7 +66,9 @@ namespace cbdc::rpc {
         /// handler function. Provides the request handler function with a
         /// callback which serializes the response. That callback passes the
         /// serialized data buffer to the callback provided here for
-        /// transmission.
+        /// transmission. The request's trace context, if any, is installed
+        /// for the duration of the handler call, which is recorded as a span
+        /// ending when the response is ready.
         /// \param request_buf buffer holding an RPC request.
         /// \param response_callback callback which transmits the serialized
         ///                          response buffer.
@@ -81,12 +84,19 @@ namespace cbdc::rpc {
                 if(!req.has_value()) {
                     return std::nullopt;
                 }
+                auto span = tracing::make_shared_span(
+                    "rpc.server",
+                    req.value().m_header.m_trace);
+                auto ctx = tracing::scoped_context(tracing::context_of(span));
                 auto success = m_callback(
                     std::move(req.value().m_payload),
                     [&,
                      resp_cb = std::move(response_callback),
-                     hdr
-                     = req.value().m_header](std::optional<Response> resp) {
+                     hdr = req.value().m_header,
+                     span](std::optional<Response> resp) {
+                        if(span) {
+                            span->finish();
+                        }
                         auto resp_buf
                             = server_type::serialize_response(std::move(hdr),
                                                               std::move(resp));
@@ -0,0 +1,272 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RPC_AWAITABLE_H_
+#define OPENCBDC_TX_SRC_RPC_AWAITABLE_H_
+
+// Coroutine support requires building with C++20. The project builds with
+// C++17, so these adapters are only available to targets which opt in to a
+// newer standard.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include "client.hpp"
+#include "util/common/strand.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace cbdc::rpc {
+    namespace detail {
+        template<typename T>
+        struct task_result {
+            std::optional<T> m_value;
+
+            void return_value(T value) {
+                m_value = std::move(value);
+            }
+
+            auto result() -> T {
+                return std::move(m_value.value());
+            }
+        };
+
+        template<>
+        struct task_result<void> {
+            void return_void() noexcept {}
+
+            void result() noexcept {}
+        };
+
+        /// Coroutine which starts immediately and frees itself on
+        /// completion.
+        struct detached_task {
+            struct promise_type {
+                auto get_return_object() noexcept -> detached_task {
+                    return {};
+                }
+
+                auto initial_suspend() noexcept -> std::suspend_never {
+                    return {};
+                }
+
+                auto final_suspend() noexcept -> std::suspend_never {
+                    return {};
+                }
+
+                void return_void() noexcept {}
+
+                void unhandled_exception() noexcept {
+                    std::terminate();
+                }
+            };
+        };
+    }
+
+    /// \brief Lazily-started coroutine returning a T.
+    ///
+    /// Starts when first awaited, and resumes its awaiter when it returns.
+    /// Use \ref spawn to start a task from callback-based code.
+    /// \tparam T type returned by the coroutine.
+    template<typename T = void>
+    class [[nodiscard]] task {
+      public:
+        struct promise_type : detail::task_result<T> {
+            std::coroutine_handle<> m_continuation{std::noop_coroutine()};
+
+            auto get_return_object() noexcept -> task {
+                return task(handle_type::from_promise(*this));
+            }
+
+            auto initial_suspend() noexcept -> std::suspend_always {
+                return {};
+            }
+
+            struct final_awaiter {
+                auto await_ready() noexcept -> bool {
+                    return false;
+                }
+
+                auto await_suspend(
+                    std::coroutine_handle<promise_type> h) noexcept
+                    -> std::coroutine_handle<> {
+                    return h.promise().m_continuation;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            auto final_suspend() noexcept -> final_awaiter {
+                return {};
+            }
+
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        task(task&& other) noexcept
+            : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+        auto operator=(task&& other) noexcept -> task& {
+            if(this != &other) {
+                destroy();
+                m_handle = std::exchange(other.m_handle, nullptr);
+            }
+            return *this;
+        }
+
+        task(const task&) = delete;
+        auto operator=(const task&) -> task& = delete;
+
+        ~task() {
+            destroy();
+        }
+
+        auto operator co_await() && noexcept {
+            struct awaiter {
+                handle_type m_handle;
+
+                auto await_ready() noexcept -> bool {
+                    return m_handle.done();
+                }
+
+                auto await_suspend(std::coroutine_handle<> continuation)
+                    -> std::coroutine_handle<> {
+                    m_handle.promise().m_continuation = continuation;
+                    return m_handle;
+                }
+
+                auto await_resume() -> T {
+                    return m_handle.promise().result();
+                }
+            };
+            return awaiter{m_handle};
+        }
+
+      private:
+        handle_type m_handle;
+
+        explicit task(handle_type handle) : m_handle(handle) {}
+
+        void destroy() {
+            if(m_handle) {
+                m_handle.destroy();
+            }
+        }
+    };
+
+    /// Starts a task without awaiting it, then calls the given function with
+    /// its result.
+    /// \param t task to run.
+    /// \param done function to call with the result of the task.
+    template<typename T, typename F>
+    auto spawn(task<T> t, F done) -> detail::detached_task {
+        if constexpr(std::is_void_v<T>) {
+            co_await std::move(t);
+            done();
+        } else {
+            done(co_await std::move(t));
+        }
+    }
+
+    /// \brief Awaitable asynchronous RPC.
+    ///
+    /// Suspends the awaiting coroutine until the response arrives and
+    /// resumes it with the response, or with std::nullopt if the request
+    /// failed or timed out. If sending the request fails, or the response
+    /// arrives before the coroutine suspends, it continues without
+    /// suspending.
+    /// \see cbdc::rpc::async_call
+    template<typename Request, typename Response>
+    class call_awaitable {
+      public:
+        /// Constructor.
+        /// \param c client with which to issue the request.
+        /// \param request_payload payload for the RPC.
+        /// \param s strand on which to resume the coroutine, or nullptr to
+        ///          resume it on the thread which received the response.
+        call_awaitable(client<Request, Response>& c,
+                       Request request_payload,
+                       strand* s)
+            : m_client(c),
+              m_request(std::move(request_payload)),
+              m_strand(s) {}
+
+        auto await_ready() noexcept -> bool {
+            return false;
+        }
+
+        auto await_suspend(std::coroutine_handle<> h) -> bool {
+            m_handle = h;
+            auto sent = m_client.call(
+                std::move(m_request),
+                [this](std::optional<Response> resp) {
+                    m_result = std::move(resp);
+                    if(m_state.exchange(state::done, std::memory_order_acq_rel)
+                       == state::suspended) {
+                        resume();
+                    }
+                });
+            if(!sent) {
+                return false;
+            }
+            auto expected = state::pending;
+            return m_state.compare_exchange_strong(expected,
+                                                   state::suspended,
+                                                   std::memory_order_acq_rel);
+        }
+
+        auto await_resume() -> std::optional<Response> {
+            return std::move(m_result);
+        }
+
+      private:
+        enum class state {
+            pending,
+            suspended,
+            done
+        };
+
+        client<Request, Response>& m_client;
+        Request m_request;
+        strand* m_strand;
+        std::coroutine_handle<> m_handle;
+        std::optional<Response> m_result;
+        std::atomic<state> m_state{state::pending};
+
+        void resume() {
+            if(m_strand != nullptr) {
+                m_strand->post([h = m_handle]() {
+                    h.resume();
+                });
+            } else {
+                m_handle.resume();
+            }
+        }
+    };
+
+    /// Issues an asynchronous RPC which a coroutine can co_await.
+    /// \param c client with which to issue the request.
+    /// \param request_payload payload for the RPC.
+    /// \param s strand on which to resume the awaiting coroutine, or nullptr
+    ///          to resume it on the thread which received the response.
+    /// \return awaitable for the response.
+    template<typename Request, typename Response>
+    auto async_call(client<Request, Response>& c,
+                    std::type_identity_t<Request> request_payload,
+                    strand* s = nullptr) -> call_awaitable<Request, Response> {
+        return {c, std::move(request_payload), s};
+    }
+}
+
+#endif
+
+#endif
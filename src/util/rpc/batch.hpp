@@ -0,0 +1,100 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RPC_BATCH_H_
+#define OPENCBDC_TX_SRC_RPC_BATCH_H_
+
+#include "async_server.hpp"
+#include "blocking_server.hpp"
+#include "messages.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace cbdc::rpc {
+    /// Adapts a blocking request handler to handle a \ref batch_request,
+    /// for registering with a blocking server of batch envelopes. Requests
+    /// are handled in order on the calling thread.
+    /// \tparam Request type for requests.
+    /// \tparam Response type for responses.
+    /// \param handler handler for individual requests.
+    /// \return handler for batches of requests.
+    template<typename Request, typename Response>
+    auto make_batch_handler(
+        typename blocking_server<Request, Response>::callback_type handler) ->
+        typename blocking_server<batch_request<Request>,
+                                 batch_response<Response>>::callback_type {
+        return [h = std::move(handler)](batch_request<Request> batch)
+                   -> std::optional<batch_response<Response>> {
+            auto resp = batch_response<Response>();
+            resp.m_responses.reserve(batch.m_requests.size());
+            for(auto& req : batch.m_requests) {
+                resp.m_responses.emplace_back(h(std::move(req)));
+            }
+            return resp;
+        };
+    }
+
+    /// Adapts an asynchronous request handler to handle a \ref
+    /// batch_request, for registering with an asynchronous server of batch
+    /// envelopes. Every request in the batch is started immediately and the
+    /// batch response is returned once the last request completes. A request
+    /// the handler fails to start gets a std::nullopt response.
+    /// \tparam Request type for requests.
+    /// \tparam Response type for responses.
+    /// \param handler handler for individual requests.
+    /// \return handler for batches of requests.
+    template<typename Request, typename Response>
+    auto make_async_batch_handler(
+        typename async_server<Request, Response>::callback_type handler) ->
+        typename async_server<batch_request<Request>,
+                              batch_response<Response>>::callback_type {
+        using batch_callback_type =
+            typename async_server<batch_request<Request>,
+                                  batch_response<Response>>::
+                response_callback_type;
+        return [h = std::move(handler)](batch_request<Request> batch,
+                                        batch_callback_type cb) -> bool {
+            struct batch_state {
+                batch_response<Response> m_response;
+                std::atomic<size_t> m_remaining;
+                batch_callback_type m_callback;
+            };
+
+            auto n = batch.m_requests.size();
+            if(n == 0) {
+                cb(batch_response<Response>());
+                return true;
+            }
+
+            auto state = std::make_shared<batch_state>();
+            state->m_response.m_responses.resize(n);
+            state->m_remaining = n;
+            state->m_callback = std::move(cb);
+            auto complete = [state](size_t idx,
+                                    std::optional<Response> resp) {
+                state->m_response.m_responses[idx] = std::move(resp);
+                if(state->m_remaining.fetch_sub(1, std::memory_order_acq_rel)
+                   == 1) {
+                    state->m_callback(std::move(state->m_response));
+                }
+            };
+
+            for(size_t i = 0; i < n; i++) {
+                auto started
+                    = h(std::move(batch.m_requests[i]),
+                        [complete, i](std::optional<Response> resp) {
+                            complete(i, std::move(resp));
+                        });
+                if(!started) {
+                    complete(i, std::nullopt);
+                }
+            }
+            return true;
+        };
+    }
+}
+
+#endif
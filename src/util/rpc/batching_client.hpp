@@ -0,0 +1,175 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RPC_BATCHING_CLIENT_H_
+#define OPENCBDC_TX_SRC_RPC_BATCHING_CLIENT_H_
+
+#include "tcp_client.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cbdc::rpc {
+    /// Coalescing settings for a \ref batching_client.
+    struct batching_client_options {
+        /// Number of queued calls which triggers sending a batch.
+        size_t m_max_batch_size{64};
+        /// Longest time a queued call waits for the batch to fill before
+        /// it is sent.
+        std::chrono::microseconds m_max_delay{std::chrono::microseconds(100)};
+        /// Settings for the underlying \ref tcp_client.
+        tcp_client_options m_client_opts{};
+    };
+
+    /// RPC client which coalesces individual calls into \ref batch_request
+    /// frames, for servers whose handler is wrapped with \ref
+    /// make_batch_handler or \ref make_async_batch_handler.
+    /// \tparam Request type for requests.
+    /// \tparam Response type for responses.
+    template<typename Request, typename Response>
+    class batching_client {
+      public:
+        /// Constructor.
+        /// \param server_endpoints RPC server endpoints to which to connect.
+        /// \param opts coalescing settings.
+        explicit batching_client(
+            std::vector<network::endpoint_t> server_endpoints,
+            batching_client_options opts = {})
+            : m_client(std::move(server_endpoints), opts.m_client_opts),
+              m_opts(opts) {}
+
+        batching_client(batching_client&&) = delete;
+        auto operator=(batching_client&&) -> batching_client& = delete;
+        batching_client(const batching_client&) = delete;
+        auto operator=(const batching_client&) -> batching_client& = delete;
+
+        /// Destructor. Sends any queued calls and stops the flush thread.
+        ~batching_client() {
+            {
+                std::unique_lock<std::mutex> l(m_mut);
+                m_running = false;
+            }
+            m_cv.notify_one();
+            if(m_flush_thread.joinable()) {
+                m_flush_thread.join();
+            }
+        }
+
+        /// User-provided response callback function type.
+        using response_callback_type
+            = std::function<void(std::optional<Response>)>;
+
+        /// Initializes the underlying client and starts the flush thread.
+        /// \return false if the underlying client failed to initialize.
+        [[nodiscard]] auto init() -> bool {
+            if(!m_client.init()) {
+                return false;
+            }
+            m_flush_thread = std::thread([&]() {
+                flush_loop();
+            });
+            return true;
+        }
+
+        /// Waits until the client is connected to at least one of the server
+        /// endpoints.
+        /// \param timeout maximum time to wait.
+        /// \return true if connected, false if timed out.
+        auto await_connection(std::chrono::milliseconds timeout) -> bool {
+            return m_client.await_connection(timeout);
+        }
+
+        /// Queues a request to be sent with the next batch. Thread safe.
+        /// \param request_payload payload for the RPC.
+        /// \param response_callback function to call with the response, or
+        ///                          with std::nullopt if the request failed.
+        /// \return false if the client is shutting down.
+        auto call(Request request_payload,
+                  response_callback_type response_callback) -> bool {
+            auto full = [&]() {
+                std::unique_lock<std::mutex> l(m_mut);
+                if(!m_running) {
+                    return false;
+                }
+                m_requests.emplace_back(std::move(request_payload));
+                m_callbacks.emplace_back(std::move(response_callback));
+                return m_requests.size() >= m_opts.m_max_batch_size;
+            }();
+            if(full) {
+                m_cv.notify_one();
+            }
+            return true;
+        }
+
+      private:
+        tcp_client<batch_request<Request>, batch_response<Response>>
+            m_client;
+        batching_client_options m_opts;
+
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        std::vector<Request> m_requests;
+        std::vector<response_callback_type> m_callbacks;
+        bool m_running{true};
+        std::thread m_flush_thread;
+
+        void flush_loop() {
+            std::unique_lock<std::mutex> l(m_mut);
+            for(;;) {
+                if(m_requests.empty()) {
+                    if(!m_running) {
+                        return;
+                    }
+                    m_cv.wait(l);
+                    continue;
+                }
+                if(m_running && m_requests.size() < m_opts.m_max_batch_size) {
+                    // Give the batch a chance to fill
+                    m_cv.wait_for(l, m_opts.m_max_delay, [&]() {
+                        return !m_running
+                            || m_requests.size() >= m_opts.m_max_batch_size;
+                    });
+                }
+                auto batch = batch_request<Request>{std::move(m_requests)};
+                auto callbacks = std::move(m_callbacks);
+                m_requests.clear();
+                m_callbacks.clear();
+                l.unlock();
+                send_batch(std::move(batch), std::move(callbacks));
+                l.lock();
+            }
+        }
+
+        void send_batch(batch_request<Request> batch,
+                        std::vector<response_callback_type> callbacks) {
+            auto cbs = std::make_shared<std::vector<response_callback_type>>(
+                std::move(callbacks));
+            auto fail_all = [](std::vector<response_callback_type>& c) {
+                for(auto& cb : c) {
+                    cb(std::nullopt);
+                }
+            };
+            auto sent = m_client.call(
+                std::move(batch),
+                [cbs, fail_all](std::optional<batch_response<Response>> resp) {
+                    if(!resp.has_value()
+                       || resp->m_responses.size() != cbs->size()) {
+                        fail_all(*cbs);
+                        return;
+                    }
+                    for(size_t i = 0; i < cbs->size(); i++) {
+                        (*cbs)[i](std::move(resp->m_responses[i]));
+                    }
+                });
+            if(!sent) {
+                fail_all(*cbs);
+            }
+        }
+    };
+}
+
+#endif
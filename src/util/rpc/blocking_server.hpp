@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_RPC_BLOCKING_SERVER_H_
 
 #include "server.hpp"
+#include "util/common/tracing.hpp"
 
 namespace cbdc::rpc {
     /// Generic synchronous RPC server. Handles serialization of requests and
@@ -51,7 +52,9 @@ namespace cbdc::rpc {
 
       protected:
         /// Synchronously deserializes an RPC request, calls the request
-        /// handler function, then serializes and returns the response.
+        /// handler function, then serializes and returns the response. The
+        /// request's trace context, if any, is installed for the duration of
+        /// the handler call, which is recorded as a span.
         /// \param request_buf buffer holding an RPC request.
         /// \return serialized response, or std::nullopt if deserializing or
         ///         handling the request failed.
@@ -62,6 +65,9 @@ namespace cbdc::rpc {
             }
             auto resp = std::optional<Response>();
             if(m_callback) {
+                auto span
+                    = tracing::span("rpc.server", req.value().m_header.m_trace);
+                auto ctx = tracing::scoped_context(span.get_context());
                 resp = m_callback(std::move(req.value().m_payload));
             }
             return server_type::serialize_response(
@@ -8,6 +8,7 @@
 
 #include "format.hpp"
 #include "messages.hpp"
+#include "util/common/tracing.hpp"
 #include "util/serialization/util.hpp"
 
 #include <atomic>
@@ -44,7 +45,8 @@ namespace cbdc::rpc {
         /// Issues the given request with an optional timeout, then waits for
         /// and returns the response. Serializes the request data, calls
         /// call_raw() to transmit the data and get a response, and returns the
-        /// deserialized response. Thread safe.
+        /// deserialized response. If the calling thread is traced, records
+        /// the call as a span and propagates the trace. Thread safe.
         /// \param request_payload payload for the RPC.
         /// \param timeout optional timeout in milliseconds. Zero indicates the
         ///                call should not timeout.
@@ -54,9 +56,11 @@ namespace cbdc::rpc {
                                 std::chrono::milliseconds timeout
                                 = std::chrono::milliseconds::zero())
             -> std::optional<Response> {
+            auto span = tracing::span("rpc.client");
             auto [request_buf, request_id]
-                = make_request(std::move(request_payload));
+                = make_request(std::move(request_payload), span.get_context());
             auto resp = call_raw(std::move(request_buf), request_id, timeout);
+            span.finish();
             if(!resp.has_value()) {
                 return std::nullopt;
             }
@@ -66,20 +70,28 @@ namespace cbdc::rpc {
 
         /// Issues an asynchronous request and registers the given callback to
         /// handle the response. Serializes the request data, then transmits it
-        /// with call_raw(). Thread safe.
+        /// with call_raw(). If the calling thread is traced, records the call
+        /// as a span and propagates the trace. Thread safe.
         /// \param request_payload payload for the RPC.
         /// \param response_callback function for the request handler to call
-        ///                          when the response is available.
+        ///                          when the response is available, or with
+        ///                          std::nullopt if the request timed out.
         /// \return true if the request was sent successfully.
         auto call(Request request_payload,
                   response_callback_type response_callback) -> bool {
+            auto span = tracing::make_shared_span("rpc.client");
             auto [request_buf, request_id]
-                = make_request(std::move(request_payload));
+                = make_request(std::move(request_payload),
+                               tracing::context_of(span));
             auto ret = call_raw(std::move(request_buf),
                                 request_id,
-                                [resp_cb = std::move(response_callback)](
-                                    std::optional<response_type> resp) {
+                                [resp_cb = std::move(response_callback),
+                                 span](std::optional<response_type> resp) {
+                                    if(span) {
+                                        span->finish();
+                                    }
                                     if(!resp.has_value()) {
+                                        resp_cb(std::nullopt);
                                         return;
                                     }
                                     resp_cb(std::move(resp.value().m_payload));
@@ -122,10 +134,12 @@ namespace cbdc::rpc {
                               raw_callback_type response_callback) -> bool
             = 0;
 
-        auto make_request(Request request_payload)
+        auto make_request(Request request_payload,
+                          std::optional<tracing::context> trace)
             -> std::pair<cbdc::buffer, request_id_type> {
             auto request_id = m_current_request_id++;
-            auto req = request_type{{request_id}, std::move(request_payload)};
+            auto req = request_type{{request_id, trace},
+                                    std::move(request_payload)};
             return {make_buffer(req), request_id};
         }
     };
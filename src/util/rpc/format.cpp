@@ -8,12 +8,32 @@
 #include "util/serialization/format.hpp"
 
 namespace cbdc {
+    // The trace context is written like a std::optional, but inline since
+    // the generic std::optional serializer cannot find operators for types
+    // outside namespace cbdc.
     auto operator<<(serializer& ser, const rpc::header& header)
         -> serializer& {
-        return ser << header.m_request_id;
+        ser << header.m_request_id << header.m_trace.has_value();
+        if(header.m_trace.has_value()) {
+            ser << header.m_trace->m_trace_id << header.m_trace->m_span_id;
+        }
+        return ser;
     }
 
     auto operator>>(serializer& deser, rpc::header& header) -> serializer& {
-        return deser >> header.m_request_id;
+        bool has_trace{};
+        if(!(deser >> header.m_request_id >> has_trace)) {
+            return deser;
+        }
+        if(has_trace) {
+            auto ctx = tracing::context();
+            if(!(deser >> ctx.m_trace_id >> ctx.m_span_id)) {
+                return deser;
+            }
+            header.m_trace = ctx;
+        } else {
+            header.m_trace = std::nullopt;
+        }
+        return deser;
     }
 }
@@ -7,6 +7,7 @@
 #define OPENCBDC_TX_SRC_RPC_FORMAT_H_
 
 #include "messages.hpp"
+#include "util/serialization/format.hpp"
 #include "util/serialization/serializer.hpp"
 
 namespace cbdc {
@@ -34,6 +35,30 @@ namespace cbdc {
     auto operator>>(serializer& deser, rpc::response<T>& resp) -> serializer& {
         return deser >> resp.m_header >> resp.m_payload;
     }
+
+    template<typename T>
+    auto operator<<(serializer& ser, const rpc::batch_request<T>& req)
+        -> serializer& {
+        return ser << req.m_requests;
+    }
+
+    template<typename T>
+    auto operator>>(serializer& deser, rpc::batch_request<T>& req)
+        -> serializer& {
+        return deser >> req.m_requests;
+    }
+
+    template<typename T>
+    auto operator<<(serializer& ser, const rpc::batch_response<T>& resp)
+        -> serializer& {
+        return ser << resp.m_responses;
+    }
+
+    template<typename T>
+    auto operator>>(serializer& deser, rpc::batch_response<T>& resp)
+        -> serializer& {
+        return deser >> resp.m_responses;
+    }
 }
 
 #endif
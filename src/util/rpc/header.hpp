@@ -6,7 +6,10 @@
 #ifndef OPENCBDC_TX_SRC_RPC_HEADER_H_
 #define OPENCBDC_TX_SRC_RPC_HEADER_H_
 
+#include "util/common/tracing.hpp"
+
 #include <cstdint>
+#include <optional>
 
 namespace cbdc::rpc {
     using request_id_type = uint64_t;
@@ -15,6 +18,9 @@ namespace cbdc::rpc {
     struct header {
         /// Identifier for matching requests with responses.
         request_id_type m_request_id;
+        /// Trace context of the span which issued a sampled request, or
+        /// std::nullopt if the request is not traced.
+        std::optional<tracing::context> m_trace{};
     };
 }
 
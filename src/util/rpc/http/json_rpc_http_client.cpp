@@ -28,8 +28,19 @@ namespace cbdc::rpc {
         std::vector<std::string> endpoints,
         long timeout,
         std::shared_ptr<logging::log> log)
+        : json_rpc_http_client(std::move(endpoints),
+                               timeout,
+                               std::move(log),
+                               options{}) {}
+
+    json_rpc_http_client::json_rpc_http_client(
+        std::vector<std::string> endpoints,
+        long timeout,
+        std::shared_ptr<logging::log> log,
+        options opts)
         : m_endpoints(std::move(endpoints)),
           m_timeout(timeout),
+          m_opts(opts),
           m_log(std::move(log)) {
 // TODO: find a way to do this without the preprocessor
 #ifdef __APPLE__
@@ -50,6 +61,21 @@ namespace cbdc::rpc {
                           CURLMOPT_SOCKETFUNCTION,
                           socket_callback);
         curl_multi_setopt(m_multi_handle, CURLMOPT_SOCKETDATA, this);
+        if(m_opts.m_max_host_connections > 0) {
+            curl_multi_setopt(m_multi_handle,
+                              CURLMOPT_MAX_HOST_CONNECTIONS,
+                              m_opts.m_max_host_connections);
+        }
+        if(m_opts.m_max_idle_connections > 0) {
+            curl_multi_setopt(m_multi_handle,
+                              CURLMOPT_MAXCONNECTS,
+                              m_opts.m_max_idle_connections);
+        }
+        if(m_opts.m_http2) {
+            curl_multi_setopt(m_multi_handle,
+                              CURLMOPT_PIPELINING,
+                              CURLPIPE_MULTIPLEX);
+        }
         m_headers
             = curl_slist_append(m_headers, "Content-Type: application/json");
         m_headers = curl_slist_append(m_headers, "charsets: utf-8");
@@ -91,6 +117,17 @@ namespace cbdc::rpc {
             curl_easy_setopt(handle, CURLOPT_HTTPHEADER, m_headers);
             curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, m_timeout);
             curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 3);
+            if(m_opts.m_tcp_keep_alive) {
+                curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+            }
+            if(m_opts.m_http2) {
+                curl_easy_setopt(handle,
+                                 CURLOPT_HTTP_VERSION,
+                                 CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+                // Wait for a connection to multiplex onto rather than
+                // opening another one
+                curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+            }
             // curl_easy_setopt(handle, CURLOPT_TIMEOUT, 5);
         } else {
             handle = m_handles.front();
@@ -35,6 +35,25 @@ namespace cbdc::rpc {
     /// randomized load balancing across multiple RPC endpoints.
     class json_rpc_http_client {
       public:
+        /// Connection pool settings. Connections are kept open and reused
+        /// by later calls to the same endpoint.
+        struct options {
+            /// Maximum number of connections open at once to each
+            /// endpoint. Calls beyond the limit wait for a connection to
+            /// become free. Zero for no limit.
+            long m_max_host_connections{0};
+            /// Maximum number of idle connections kept open for reuse.
+            /// Zero for libcurl's default of four per concurrent call.
+            long m_max_idle_connections{0};
+            /// Whether to send TCP keep-alive probes on idle connections,
+            /// so they are not dropped by the network between calls.
+            bool m_tcp_keep_alive{true};
+            /// Whether to multiplex concurrent calls over shared HTTP/2
+            /// connections. The endpoints must accept HTTP/2 without an
+            /// upgrade from HTTP/1.1.
+            bool m_http2{false};
+        };
+
         /// Construct a new client.
         /// \param endpoints list of RPC endpoints to load balance between.
         /// \param timeout response timeout in milliseconds. 0 for no timeout.
@@ -42,6 +61,16 @@ namespace cbdc::rpc {
         json_rpc_http_client(std::vector<std::string> endpoints,
                              long timeout,
                              std::shared_ptr<logging::log> log);
+
+        /// Construct a new client.
+        /// \param endpoints list of RPC endpoints to load balance between.
+        /// \param timeout response timeout in milliseconds. 0 for no timeout.
+        /// \param log log instance.
+        /// \param opts connection pool settings.
+        json_rpc_http_client(std::vector<std::string> endpoints,
+                             long timeout,
+                             std::shared_ptr<logging::log> log,
+                             options opts);
         /// Cancels any existing requests and stops the client.
         ~json_rpc_http_client();
 
@@ -72,6 +101,7 @@ namespace cbdc::rpc {
       private:
         std::vector<std::string> m_endpoints;
         long m_timeout;
+        options m_opts;
         std::unique_ptr<event_handler> m_ev_handler;
 
         Json::StreamWriterBuilder m_builder;
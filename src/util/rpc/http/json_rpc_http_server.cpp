@@ -5,6 +5,7 @@
 
 #include "json_rpc_http_server.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <iostream>
 #include <thread>
@@ -12,39 +13,53 @@
 namespace cbdc::rpc {
     json_rpc_http_server::json_rpc_http_server(network::endpoint_t endpoint,
                                                bool enable_cors)
+        : json_rpc_http_server(std::move(endpoint), enable_cors, options{}) {}
+
+    json_rpc_http_server::json_rpc_http_server(network::endpoint_t endpoint,
+                                               bool enable_cors,
+                                               options opts)
         : m_host(endpoint.first),
           m_port(endpoint.second),
-          m_enable_cors(enable_cors) {}
+          m_opts(opts),
+          m_enable_cors(enable_cors) {
+        // Responses are read by programs, so skip the pretty-printing
+        m_builder["indentation"] = "";
+    }
 
     json_rpc_http_server::~json_rpc_http_server() {
         // Set running flag
         m_running = false;
 
         // Stop accepting incoming connections
-        auto sock = MHD_quiesce_daemon(m_daemon);
+        auto socks = std::vector<MHD_socket>();
+        for(auto* daemon : m_daemons) {
+            socks.push_back(MHD_quiesce_daemon(daemon));
+        }
 
         // Wait for existing connections to drain
-        for(;;) {
-            const auto* inf
-                = MHD_get_daemon_info(m_daemon,
-                                      MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
-            if(inf->num_connections == 0) {
-                break;
+        for(auto* daemon : m_daemons) {
+            for(;;) {
+                const auto* inf = MHD_get_daemon_info(
+                    daemon,
+                    MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+                if(inf->num_connections == 0) {
+                    break;
+                }
+                constexpr auto wait_time = std::chrono::milliseconds(100);
+                std::this_thread::sleep_for(wait_time);
             }
-            // std::cout << "Waiting for " << inf->num_connections << "
-            // connections to close" << std::endl;
-            constexpr auto wait_time = std::chrono::milliseconds(100);
-            std::this_thread::sleep_for(wait_time);
         }
 
-        // std::cout << "All connections closed" << std::endl;
-
-        // Stop HTTP daemon
-        MHD_stop_daemon(m_daemon);
+        // Stop HTTP daemons
+        for(auto* daemon : m_daemons) {
+            MHD_stop_daemon(daemon);
+        }
 
-        // Close listening socket
-        if(sock != -1) {
-            close(sock);
+        // Close listening sockets
+        for(auto sock : socks) {
+            if(sock != -1) {
+                close(sock);
+            }
         }
     }
 
@@ -53,37 +68,77 @@ namespace cbdc::rpc {
             = (MHD_is_feature_supported(MHD_FEATURE_EPOLL) == MHD_YES);
         auto use_flag
             = has_epoll ? MHD_USE_EPOLL_INTERNALLY : MHD_USE_POLL_INTERNALLY;
-        auto connection_limit = has_epoll ? 65536 : FD_SETSIZE - 4;
+        auto max_connections
+            = has_epoll ? size_t{65536} : size_t{FD_SETSIZE - 4};
         auto addr = sockaddr_in{};
         addr.sin_family = AF_INET;
         addr.sin_port = htons(m_port);
         inet_aton(m_host.c_str(),
                   reinterpret_cast<in_addr*>(&addr.sin_addr.s_addr));
-        m_daemon = MHD_start_daemon(use_flag | MHD_ALLOW_SUSPEND_RESUME
-                                        | MHD_USE_DEBUG,
-                                    m_port,
-                                    nullptr,
-                                    nullptr,
-                                    callback,
-                                    this,
-                                    MHD_OPTION_NOTIFY_COMPLETED,
-                                    request_complete,
-                                    this,
-                                    MHD_OPTION_THREAD_POOL_SIZE,
-                                    std::thread::hardware_concurrency(),
-                                    MHD_OPTION_CONNECTION_TIMEOUT,
-                                    3,
-                                    MHD_OPTION_CONNECTION_LIMIT,
-                                    connection_limit,
-                                    MHD_OPTION_SOCK_ADDR,
-                                    &addr,
-                                    MHD_OPTION_END);
-        return m_daemon != nullptr;
+
+        auto listeners = m_opts.m_listeners;
+        if(listeners == 0) {
+            listeners = std::max(size_t{1},
+                                 size_t{std::thread::hardware_concurrency()});
+        }
+        auto connection_limit = m_opts.m_connection_limit;
+        if(connection_limit == 0) {
+            connection_limit = max_connections * listeners;
+        }
+        // Each listener accepts its own share of the connections
+        connection_limit = std::min(
+            max_connections,
+            std::max(size_t{1}, connection_limit / listeners));
+
+        auto flags = static_cast<unsigned int>(use_flag)
+                   | MHD_ALLOW_SUSPEND_RESUME | MHD_USE_DEBUG;
+        auto reuse_port = listeners > 1;
+        for(size_t i{0}; i < listeners; i++) {
+            auto* daemon
+                = start_daemon(flags, addr, connection_limit, reuse_port);
+            if(daemon == nullptr) {
+                return false;
+            }
+            m_daemons.push_back(daemon);
+        }
+        return true;
+    }
+
+    auto json_rpc_http_server::start_daemon(unsigned int flags,
+                                            const sockaddr_in& addr,
+                                            size_t connection_limit,
+                                            bool reuse_port) -> MHD_Daemon* {
+        // A single listener serves its socket from a pool of threads.
+        // Several listeners each run one thread on their own socket, so
+        // a connection is parsed and handled on the thread that accepted
+        // it.
+        auto pool_size
+            = reuse_port ? 1U : std::thread::hardware_concurrency();
+        return MHD_start_daemon(flags,
+                                m_port,
+                                nullptr,
+                                nullptr,
+                                callback,
+                                this,
+                                MHD_OPTION_NOTIFY_COMPLETED,
+                                request_complete,
+                                this,
+                                MHD_OPTION_THREAD_POOL_SIZE,
+                                pool_size,
+                                MHD_OPTION_CONNECTION_TIMEOUT,
+                                m_opts.m_connection_timeout,
+                                MHD_OPTION_CONNECTION_LIMIT,
+                                static_cast<unsigned int>(connection_limit),
+                                MHD_OPTION_LISTENING_ADDRESS_REUSE,
+                                reuse_port ? 1U : 0U,
+                                MHD_OPTION_SOCK_ADDR,
+                                &addr,
+                                MHD_OPTION_END);
     }
 
     auto json_rpc_http_server::callback(void* cls,
                                         struct MHD_Connection* connection,
-                                        const char* /* url */,
+                                        const char* url,
                                         const char* method,
                                         const char* /* version */,
                                         const char* upload_data,
@@ -114,6 +169,20 @@ namespace cbdc::rpc {
             return MHD_YES;
         }
 
+        if(method == std::string("GET")) {
+            const auto& handlers = req->m_server->m_text_handlers;
+            auto it = handlers.find(url);
+            if(it == handlers.end()) {
+                req->m_code = MHD_HTTP_NOT_FOUND;
+                send_response("Not found", req);
+                return MHD_YES;
+            }
+            req->m_code = MHD_HTTP_OK;
+            req->m_content_type = it->second.m_content_type.c_str();
+            send_response(it->second.m_handler(), req);
+            return MHD_YES;
+        }
+
         if(method != std::string("POST")) {
             req->m_code = MHD_HTTP_METHOD_NOT_ALLOWED;
             send_response("HTTP method not allowed", req);
@@ -201,7 +270,14 @@ namespace cbdc::rpc {
             MHD_add_response_header(result, "Vary", "Origin");
         }
 
-        MHD_add_response_header(result, "Content-Type", "application/json");
+        MHD_add_response_header(result,
+                                "Content-Type",
+                                request_info->m_content_type);
+        if(!request_info->m_server->m_opts.m_keep_alive) {
+            MHD_add_response_header(result,
+                                    MHD_HTTP_HEADER_CONNECTION,
+                                    "close");
+        }
         auto ret = MHD_queue_response(request_info->m_connection,
                                       request_info->m_code,
                                       result);
@@ -215,7 +291,28 @@ namespace cbdc::rpc {
         return ret == MHD_YES;
     }
 
+    auto json_rpc_http_server::parse_call(const Json::Value& req)
+        -> std::optional<call> {
+        if(!req.isObject() || !req.isMember("method")) {
+            return std::nullopt;
+        }
+
+        if(!req["method"].isString()) {
+            return std::nullopt;
+        }
+
+        auto ret = call{req["method"].asString(), Json::Value(), req["id"]};
+        if(req.isMember("params")) {
+            ret.m_params = req["params"];
+        }
+        return ret;
+    }
+
     auto json_rpc_http_server::handle_request(request* request_info) -> bool {
+        if(!m_cb) {
+            return false;
+        }
+
         auto req = Json::Value();
         auto r = Json::Reader();
         auto success = r.parse(request_info->m_request.str(), req, false);
@@ -223,39 +320,143 @@ namespace cbdc::rpc {
             return false;
         }
 
-        if(!req.isMember("method")) {
+        if(req.isArray()) {
+            return handle_batch_request(request_info, req);
+        }
+
+        auto maybe_call = parse_call(req);
+        if(!maybe_call.has_value()) {
             return false;
         }
 
-        if(!req["method"].isString()) {
+        uint64_t id = 0;
+        if(maybe_call->m_id.isUInt64()) {
+            id = maybe_call->m_id.asUInt64();
+        }
+
+        MHD_suspend_connection(request_info->m_connection);
+
+        auto maybe_sent = m_cb(
+            maybe_call->m_method,
+            maybe_call->m_params,
+            [this, request_info, id](std::optional<Json::Value> resp) {
+                handle_response(Json::Value(Json::UInt64(id)),
+                                request_info,
+                                std::move(resp));
+            });
+        return maybe_sent;
+    }
+
+    auto
+    json_rpc_http_server::handle_batch_request(request* request_info,
+                                               const Json::Value& reqs)
+        -> bool {
+        if(reqs.empty()) {
             return false;
         }
 
-        auto method = req["method"].asString();
-        auto params = Json::Value();
+        auto state = std::make_shared<batch>();
+        const auto n = static_cast<size_t>(reqs.size());
+        state->m_responses.resize(reqs.size());
+        state->m_done.resize(n);
+        // Hold back the reply until every call has been dispatched, as
+        // handlers may respond before returning
+        state->m_pending = n + 1;
 
-        if(req.isMember("params")) {
-            params = req["params"];
+        MHD_suspend_connection(request_info->m_connection);
+
+        // Dispatch every call before waiting on any of them, so
+        // asynchronous handlers work on the whole batch concurrently
+        for(Json::ArrayIndex i = 0; i < reqs.size(); i++) {
+            auto maybe_call = parse_call(reqs[i]);
+            if(!maybe_call.has_value()) {
+                auto err = Json::Value();
+                err["error"]["code"] = error_invalid_request;
+                err["error"]["message"] = "Invalid Request";
+                handle_batch_response(state,
+                                      i,
+                                      Json::Value(),
+                                      request_info,
+                                      std::move(err));
+                continue;
+            }
+
+            const auto& id = maybe_call->m_id;
+            auto maybe_sent = m_cb(
+                maybe_call->m_method,
+                maybe_call->m_params,
+                [this, state, i, id, request_info](
+                    std::optional<Json::Value> resp) {
+                    handle_batch_response(state,
+                                          i,
+                                          id,
+                                          request_info,
+                                          std::move(resp));
+                });
+            if(!maybe_sent) {
+                // Handlers rejecting a call may not respond to it. A later
+                // response for the call is ignored.
+                auto err = Json::Value();
+                err["error"]["code"] = error_invalid_request;
+                err["error"]["message"] = "Invalid Request";
+                handle_batch_response(state,
+                                      i,
+                                      id,
+                                      request_info,
+                                      std::move(err));
+            }
         }
 
-        uint64_t id = 0;
-        if(req["id"].isUInt64()) {
-            id = req["id"].asUInt64();
+        // Release the hold taken above
+        handle_batch_response(state, n, Json::Value(), request_info, {});
+        return true;
+    }
+
+    auto json_rpc_http_server::make_response(const Json::Value& id,
+                                             std::optional<Json::Value> resp)
+        -> Json::Value {
+        auto ret = Json::Value();
+        if(resp.has_value()) {
+            ret = std::move(resp.value());
+        } else {
+            ret["error"]["code"] = error_internal;
+            ret["error"]["message"] = "Internal error";
         }
+        ret["jsonrpc"] = "2.0";
+        ret["id"] = id;
+        return ret;
+    }
 
-        MHD_suspend_connection(request_info->m_connection);
+    void json_rpc_http_server::handle_batch_response(
+        const std::shared_ptr<batch>& state,
+        size_t index,
+        const Json::Value& id,
+        request* request_info,
+        std::optional<Json::Value> resp) {
+        {
+            std::unique_lock l(state->m_mut);
+            if(index < state->m_done.size()) {
+                if(state->m_done[index]) {
+                    return;
+                }
+                state->m_done[index] = true;
+                state->m_responses[static_cast<Json::ArrayIndex>(index)]
+                    = make_response(id, std::move(resp));
+            }
+            if(--state->m_pending != 0) {
+                return;
+            }
+        }
 
-        auto maybe_sent
-            = m_cb(method,
-                   params,
-                   [this, request_info, id](std::optional<Json::Value> resp) {
-                       handle_response(id, request_info, std::move(resp));
-                   });
-        return maybe_sent;
+        // Every call has been answered so nothing else touches the
+        // responses
+        request_info->m_code = MHD_HTTP_OK;
+        auto resp_str = Json::writeString(m_builder, state->m_responses);
+        request_info->m_server->send_response(resp_str, request_info);
     }
 
     void
-    json_rpc_http_server::handle_response(uint64_t id,
+    json_rpc_http_server::handle_response(const Json::Value& id,
                                           request* request_info,
                                           std::optional<Json::Value> resp) {
         if(!resp.has_value()) {
@@ -280,6 +481,14 @@ namespace cbdc::rpc {
         m_cb = std::move(handler_callback);
     }
 
+    void json_rpc_http_server::register_text_handler(
+        const std::string& path,
+        std::string content_type,
+        text_handler_callback_type handler) {
+        m_text_handlers[path]
+            = text_handler{std::move(content_type), std::move(handler)};
+    }
+
     void json_rpc_http_server::request_complete(
         void* cls,
         struct MHD_Connection* /* connection */,
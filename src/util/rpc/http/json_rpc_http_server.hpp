@@ -11,14 +11,19 @@
 #include <atomic>
 #include <functional>
 #include <json/json.h>
+#include <map>
+#include <memory>
 #include <microhttpd.h>
 #include <mutex>
+#include <netinet/in.h>
 #include <optional>
 #include <sstream>
+#include <vector>
 
 namespace cbdc::rpc {
     /// Asynchrounous HTTP JSON-RPC server implemented using libmicrohttpd and
-    /// libjsoncpp.
+    /// libjsoncpp. Batch requests are dispatched to the handler all at
+    /// once and answered with a single array of responses in request order.
     class json_rpc_http_server {
       public:
         /// Type alias for the callback function for returning response values
@@ -29,6 +34,29 @@ namespace cbdc::rpc {
         /// requests.
         using handler_callback_type = std::function<
             bool(std::string, Json::Value, result_callback_type)>;
+        /// Callback function type returning the body of a plain HTTP GET
+        /// response.
+        using text_handler_callback_type = std::function<std::string()>;
+
+        /// Listener and connection settings.
+        struct options {
+            /// Number of listener threads. One listens with a single
+            /// socket served by a pool of one thread per hardware thread.
+            /// More than one starts that many single-threaded listeners,
+            /// each with its own socket bound to the endpoint with
+            /// SO_REUSEPORT so the kernel spreads connections across them,
+            /// and each running the handler for its own connections. Zero
+            /// for one listener per hardware thread.
+            size_t m_listeners{1};
+            /// Seconds an idle connection is kept open.
+            unsigned int m_connection_timeout{3};
+            /// Maximum number of open connections across all listeners.
+            /// Zero for the most the event loop supports.
+            size_t m_connection_limit{0};
+            /// Whether connections are kept open between requests. If
+            /// false, every response closes its connection.
+            bool m_keep_alive{true};
+        };
 
         /// Construct a new server.
         /// \param endpoint network endpoint to listen on.
@@ -36,6 +64,14 @@ namespace cbdc::rpc {
         explicit json_rpc_http_server(network::endpoint_t endpoint,
                                       bool enable_cors = false);
 
+        /// Construct a new server.
+        /// \param endpoint network endpoint to listen on.
+        /// \param enable_cors true if CORS should be enabled.
+        /// \param opts listener and connection settings.
+        json_rpc_http_server(network::endpoint_t endpoint,
+                             bool enable_cors,
+                             options opts);
+
         /// Stop the server.
         ~json_rpc_http_server();
 
@@ -49,23 +85,77 @@ namespace cbdc::rpc {
         /// Register the application request handler function with the server.
         void register_handler_callback(handler_callback_type handler_callback);
 
+        /// Serves HTTP GET requests for the given path with the body returned
+        /// by a handler, alongside JSON-RPC. Used to expose plain-text
+        /// endpoints such as metrics. Must be called before \ref init.
+        /// \param path URL path to serve, e.g. "/metrics".
+        /// \param content_type value of the Content-Type response header.
+        /// \param handler function returning the response body. Called on
+        ///                the server's threads.
+        void register_text_handler(const std::string& path,
+                                   std::string content_type,
+                                   text_handler_callback_type handler);
+
         /// Start listening for incoming connections and processing requests.
         /// \return true if listening was successful.
         auto init() -> bool;
 
       private:
+        /// Starts one listener daemon.
+        /// \param flags MHD daemon flags.
+        /// \param addr address to listen on.
+        /// \param connection_limit maximum connections for this daemon.
+        /// \param reuse_port whether to bind with SO_REUSEPORT.
+        /// \return the daemon, or nullptr on failure.
+        auto start_daemon(unsigned int flags,
+                          const sockaddr_in& addr,
+                          size_t connection_limit,
+                          bool reuse_port) -> MHD_Daemon*;
+
+        /// JSON-RPC error code for a malformed request object.
+        static constexpr int error_invalid_request = -32600;
+        /// JSON-RPC error code for a call the handler failed to process.
+        static constexpr int error_internal = -32603;
+
         struct request {
             MHD_Connection* m_connection{};
             std::stringstream m_request;
             json_rpc_http_server* m_server{};
             const char* m_origin{};
             unsigned int m_code{};
+            const char* m_content_type{"application/json"};
+        };
+
+        struct text_handler {
+            std::string m_content_type;
+            text_handler_callback_type m_handler;
+        };
+
+        /// JSON-RPC call parsed from a request object.
+        struct call {
+            std::string m_method;
+            Json::Value m_params;
+            Json::Value m_id;
+        };
+
+        /// Responses to a batch request collected as they complete.
+        struct batch {
+            std::mutex m_mut;
+            /// Responses in the order of the requests.
+            Json::Value m_responses{Json::arrayValue};
+            /// Whether each request has been answered.
+            std::vector<bool> m_done;
+            /// Requests not yet answered, plus one while dispatching.
+            size_t m_pending{};
         };
 
         network::ip_address m_host{};
         uint16_t m_port{};
-        MHD_Daemon* m_daemon{};
+        options m_opts;
+        /// One daemon per listener.
+        std::vector<MHD_Daemon*> m_daemons;
         handler_callback_type m_cb;
+        std::map<std::string, text_handler> m_text_handlers;
         Json::StreamWriterBuilder m_builder;
 
         std::mutex m_requests_mut;
@@ -90,10 +180,25 @@ namespace cbdc::rpc {
 
         auto handle_request(request* request_info) -> bool;
 
-        void handle_response(uint64_t id,
+        auto handle_batch_request(request* request_info,
+                                  const Json::Value& reqs) -> bool;
+
+        void handle_response(const Json::Value& id,
                              request* request_info,
                              std::optional<Json::Value> resp);
 
+        void handle_batch_response(const std::shared_ptr<batch>& state,
+                                   size_t index,
+                                   const Json::Value& id,
+                                   request* request_info,
+                                   std::optional<Json::Value> resp);
+
+        static auto parse_call(const Json::Value& req) -> std::optional<call>;
+
+        static auto make_response(const Json::Value& id,
+                                  std::optional<Json::Value> resp)
+            -> Json::Value;
+
         static void request_complete(void* cls,
                                      struct MHD_Connection* connection,
                                      void** con_cls,
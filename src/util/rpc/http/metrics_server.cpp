@@ -0,0 +1,25 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics_server.hpp"
+
+#include "util/common/metrics.hpp"
+
+namespace cbdc::rpc {
+    auto start_metrics_server(const network::endpoint_t& endpoint)
+        -> std::unique_ptr<json_rpc_http_server> {
+        auto srv = std::make_unique<json_rpc_http_server>(endpoint);
+        srv->register_text_handler(metrics_path,
+                                   metrics::prometheus_content_type,
+                                   []() {
+                                       return metrics::registry::global()
+                                           .to_prometheus();
+                                   });
+        if(!srv->init()) {
+            return nullptr;
+        }
+        return srv;
+    }
+}
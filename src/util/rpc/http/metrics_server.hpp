@@ -0,0 +1,25 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OPENCBDC_TX_SRC_RPC_METRICS_SERVER_H_
+#define OPENCBDC_TX_SRC_RPC_METRICS_SERVER_H_
+
+#include "json_rpc_http_server.hpp"
+
+#include <memory>
+
+namespace cbdc::rpc {
+    /// URL path at which \ref start_metrics_server serves metrics.
+    static constexpr auto metrics_path = "/metrics";
+
+    /// Starts an HTTP server which serves the process-wide metrics registry
+    /// in the Prometheus text format at \ref metrics_path.
+    /// \param endpoint network endpoint to listen on.
+    /// \return running server, or nullptr if listening failed.
+    auto start_metrics_server(const network::endpoint_t& endpoint)
+        -> std::unique_ptr<json_rpc_http_server>;
+}
+
+#endif
@@ -9,6 +9,7 @@
 #include "header.hpp"
 
 #include <optional>
+#include <vector>
 
 namespace cbdc::rpc {
     /// RPC request message.
@@ -30,6 +31,24 @@ namespace cbdc::rpc {
         /// Response payload or std::nullopt if processing the request failed.
         std::optional<T> m_payload;
     };
+
+    /// Envelope carrying several request payloads in a single RPC frame.
+    /// \see cbdc::rpc::make_batch_handler
+    /// \tparam T request payload type.
+    template<typename T>
+    struct batch_request {
+        /// Request payloads, in the order they should be handled.
+        std::vector<T> m_requests;
+    };
+
+    /// Envelope carrying the responses to a \ref batch_request.
+    /// \tparam T response payload type.
+    template<typename T>
+    struct batch_response {
+        /// Response for each request at the same index in the batch, or
+        /// std::nullopt if processing that request failed.
+        std::vector<std::optional<T>> m_responses;
+    };
 }
 
 #endif
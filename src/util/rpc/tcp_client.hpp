@@ -7,15 +7,44 @@
 #define OPENCBDC_TX_SRC_RPC_TCP_CLIENT_H_
 
 #include "client.hpp"
+#include "util/common/blocking_queue.hpp"
+#include "util/common/buffer_pool.hpp"
 #include "util/common/variant_overloaded.hpp"
 #include "util/network/connection_manager.hpp"
 
+#include <algorithm>
+#include <deque>
 #include <future>
+#include <limits>
 #include <unordered_map>
 
 namespace cbdc::rpc {
+    /// Flow control and response dispatch settings for a \ref tcp_client.
+    struct tcp_client_options {
+        /// Maximum number of requests awaiting a response. Further calls
+        /// wait for a response to free a slot, for up to the request
+        /// timeout. Zero for no limit.
+        size_t m_max_in_flight{0};
+        /// Time after which a request without a response fails, and the
+        /// longest a call waits for a slot. Zero for no timeout.
+        std::chrono::milliseconds m_request_timeout{0};
+        /// Number of threads on which to run response callbacks. Zero runs
+        /// them on the thread which received the response.
+        size_t m_callback_threads{0};
+        /// Priority class of requests, relative to other traffic sent on
+        /// the same connections.
+        network::priority m_priority{network::priority::normal};
+        /// Send each request to the connected server with the lowest
+        /// response latency, weighted by its requests awaiting a response,
+        /// rather than to a random connected server.
+        bool m_latency_aware{false};
+    };
+
     /// Implements an RPC client over TCP sockets. Accepts multiple server
-    /// endpoints for failover purposes.
+    /// endpoints for failover purposes. Any number of requests may be in
+    /// flight, matched to responses by request ID, up to an optional
+    /// window which applies backpressure to callers. Optionally tracks the
+    /// latency of each server to send requests to the fastest one.
     /// \see cbdc::rpc::tcp_server
     /// \tparam Request type for requests.
     /// \tparam Response type for responses.
@@ -24,8 +53,11 @@ namespace cbdc::rpc {
       public:
         /// Constructor.
         /// \param server_endpoints RPC server endpoints to which to connect.
-        explicit tcp_client(std::vector<network::endpoint_t> server_endpoints)
-            : m_server_endpoints(std::move(server_endpoints)) {}
+        /// \param opts flow control settings.
+        explicit tcp_client(std::vector<network::endpoint_t> server_endpoints,
+                            tcp_client_options opts = {})
+            : m_server_endpoints(std::move(server_endpoints)),
+              m_opts(opts) {}
 
         tcp_client(tcp_client&&) = delete;
         auto operator=(tcp_client&&) -> tcp_client& = delete;
@@ -36,18 +68,42 @@ namespace cbdc::rpc {
             typename client<Request, Response>::response_type;
 
         /// Destructor. Disconnects from the RPC servers and stops the response
-        /// handler thread.
+        /// handler thread. Pending synchronous calls return std::nullopt,
+        /// and callbacks for outstanding asynchronous calls are called with
+        /// std::nullopt.
         ~tcp_client() override {
             m_net.close();
             if(m_handler_thread.joinable()) {
                 m_handler_thread.join();
             }
+            {
+                std::unique_lock<std::mutex> l(m_timeouts_mut);
+                m_running = false;
+            }
+            m_timeouts_cv.notify_one();
+            if(m_timeout_thread.joinable()) {
+                m_timeout_thread.join();
+            }
+            {
+                std::unique_lock<std::mutex> l(m_credits_mut);
+                m_credits_cv.notify_all();
+            }
+            auto pending = decltype(m_responses)();
             {
                 std::unique_lock<std::mutex> l(m_responses_mut);
-                for(auto& [request_id, action] : m_responses) {
-                    set_response_value(action, std::nullopt);
-                }
-                m_responses.clear();
+                std::swap(pending, m_responses);
+            }
+            // Queued behind any responses already handed to the callback
+            // threads, which are stopped below
+            for(auto& [request_id, action] : pending) {
+                set_response_value(action, std::nullopt);
+            }
+            pending.clear();
+            for(size_t i = 0; i < m_callback_threads.size(); i++) {
+                m_callbacks.push(nullptr);
+            }
+            for(auto& t : m_callback_threads) {
+                t.join();
             }
         }
 
@@ -83,12 +139,63 @@ namespace cbdc::rpc {
                     return response_handler(std::move(msg));
                 });
 
+            if(m_opts.m_request_timeout.count() > 0) {
+                m_timeout_thread = std::thread([&]() {
+                    expire_requests();
+                });
+            }
+
+            for(size_t i = 0; i < m_opts.m_callback_threads; i++) {
+                m_callback_threads.emplace_back([&]() {
+                    auto cb = std::function<void()>();
+                    while(m_callbacks.pop(cb) && cb) {
+                        cb();
+                    }
+                });
+            }
+
             return true;
         }
 
+        /// Returns the number of requests awaiting a response.
+        /// \return in-flight request count.
+        [[nodiscard]] auto in_flight() -> size_t {
+            std::unique_lock<std::mutex> l(m_responses_mut);
+            return m_responses.size();
+        }
+
+        /// Returns the response latency estimate of each server, for
+        /// servers which have answered a request since the client started.
+        /// Only tracked with tcp_client_options::m_latency_aware.
+        /// \return exponentially weighted moving average response time,
+        ///         keyed by peer ID. Peer IDs follow the order of the
+        ///         server endpoints.
+        [[nodiscard]] auto server_latencies()
+            -> std::unordered_map<network::peer_id_t,
+                                  std::chrono::nanoseconds> {
+            auto ret = std::unordered_map<network::peer_id_t,
+                                          std::chrono::nanoseconds>();
+            std::unique_lock<std::mutex> l(m_servers_mut);
+            for(const auto& [peer_id, stats] : m_servers) {
+                if(stats.m_latency.count() > 0) {
+                    ret.emplace(peer_id, stats.m_latency);
+                }
+            }
+            return ret;
+        }
+
+        /// Waits until the client is connected to at least one of the server
+        /// endpoints.
+        /// \param timeout maximum time to wait.
+        /// \return true if the client is connected.
+        auto await_connection(std::chrono::milliseconds timeout) -> bool {
+            return m_net.await_connection(timeout);
+        }
+
       private:
         network::connection_manager m_net;
         std::vector<network::endpoint_t> m_server_endpoints;
+        tcp_client_options m_opts;
         std::thread m_handler_thread;
 
         using raw_callback_type =
@@ -101,16 +208,189 @@ namespace cbdc::rpc {
         std::mutex m_responses_mut;
         std::unordered_map<request_id_type, response_action_type> m_responses;
 
+        std::mutex m_credits_mut;
+        std::condition_variable m_credits_cv;
+        size_t m_credits_used{0};
+
+        // Requests in the order they expire, as they share one timeout
+        using clock_type = std::chrono::steady_clock;
+        std::mutex m_timeouts_mut;
+        std::condition_variable m_timeouts_cv;
+        std::deque<std::pair<clock_type::time_point, request_id_type>>
+            m_timeouts;
+        bool m_running{true};
+        std::thread m_timeout_thread;
+
+        blocking_queue<std::function<void()>> m_callbacks;
+        std::vector<std::thread> m_callback_threads;
+
+        /// Response latency and load of one server.
+        struct server_stats {
+            /// Moving average of response times, zero until the first
+            /// response.
+            std::chrono::nanoseconds m_latency{0};
+            /// Requests sent to the server awaiting a response.
+            size_t m_outstanding{0};
+        };
+
+        /// Server and send time of a request awaiting a response.
+        struct sent_request {
+            network::peer_id_t m_server{};
+            clock_type::time_point m_sent;
+        };
+
+        /// Weight of each new sample in the moving average, as a divisor.
+        static constexpr int64_t latency_smoothing = 8;
+
+        std::mutex m_servers_mut;
+        std::unordered_map<network::peer_id_t, server_stats> m_servers;
+        std::unordered_map<request_id_type, sent_request> m_sent;
+
+        /// Returns the connected server with the lowest latency weighted
+        /// by its outstanding requests. Servers without a latency sample
+        /// are preferred, so every server is measured.
+        auto select_server() -> std::optional<network::peer_id_t> {
+            auto connected = m_net.peer_ids();
+            connected.erase(std::remove_if(connected.begin(),
+                                           connected.end(),
+                                           [&](network::peer_id_t id) {
+                                               return !m_net.connected(id);
+                                           }),
+                            connected.end());
+
+            std::unique_lock<std::mutex> l(m_servers_mut);
+            auto best = std::optional<network::peer_id_t>();
+            auto best_score = std::numeric_limits<double>::max();
+            for(const auto id : connected) {
+                const auto& stats = m_servers[id];
+                const auto score
+                    = static_cast<double>(stats.m_latency.count() + 1)
+                    * static_cast<double>(stats.m_outstanding + 1);
+                if(score < best_score) {
+                    best = id;
+                    best_score = score;
+                }
+            }
+            return best;
+        }
+
+        /// Records a request sent to a server.
+        void add_sent(request_id_type request_id, network::peer_id_t server) {
+            std::unique_lock<std::mutex> l(m_servers_mut);
+            m_sent[request_id] = {server, clock_type::now()};
+            m_servers[server].m_outstanding++;
+        }
+
+        /// Updates the latency estimate of the server a request was sent
+        /// to. A request which failed doubles the estimate, so traffic
+        /// moves away from servers which stop answering.
+        void complete_sent(request_id_type request_id, bool answered) {
+            std::unique_lock<std::mutex> l(m_servers_mut);
+            auto it = m_sent.find(request_id);
+            if(it == m_sent.end()) {
+                return;
+            }
+            auto& stats = m_servers[it->second.m_server];
+            stats.m_outstanding--;
+            auto sample = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock_type::now() - it->second.m_sent);
+            m_sent.erase(it);
+            if(!answered) {
+                sample = std::max(sample, stats.m_latency * 2);
+            }
+            if(stats.m_latency.count() == 0) {
+                stats.m_latency = sample;
+            } else {
+                stats.m_latency += (sample - stats.m_latency)
+                                 / latency_smoothing;
+            }
+        }
+
+        /// Takes a slot in the in-flight window, waiting for up to the
+        /// request timeout for one to free up.
+        auto acquire_credit() -> bool {
+            if(m_opts.m_max_in_flight == 0) {
+                return true;
+            }
+            std::unique_lock<std::mutex> l(m_credits_mut);
+            auto available = [&]() {
+                return m_credits_used < m_opts.m_max_in_flight;
+            };
+            if(m_opts.m_request_timeout.count() > 0) {
+                if(!m_credits_cv.wait_for(l,
+                                          m_opts.m_request_timeout,
+                                          available)) {
+                    return false;
+                }
+            } else {
+                m_credits_cv.wait(l, available);
+            }
+            m_credits_used++;
+            return true;
+        }
+
+        void release_credit() {
+            if(m_opts.m_max_in_flight == 0) {
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> l(m_credits_mut);
+                m_credits_used--;
+            }
+            m_credits_cv.notify_one();
+        }
+
         auto send_request(cbdc::buffer request_buf,
                           request_id_type request_id,
                           response_action_type response_action) -> bool {
+            if(!acquire_credit()) {
+                return false;
+            }
             {
                 std::unique_lock<std::mutex> l(m_responses_mut);
                 assert(m_responses.find(request_id) == m_responses.end());
                 m_responses[request_id] = std::move(response_action);
             }
-            auto pkt = std::make_shared<buffer>(std::move(request_buf));
-            return m_net.send_to_one(pkt);
+            if(m_opts.m_request_timeout.count() > 0) {
+                {
+                    std::unique_lock<std::mutex> l(m_timeouts_mut);
+                    m_timeouts.emplace_back(clock_type::now()
+                                                + m_opts.m_request_timeout,
+                                            request_id);
+                }
+                m_timeouts_cv.notify_one();
+            }
+            auto pkt = buffer_pool::global().wrap(std::move(request_buf));
+            if(!m_opts.m_latency_aware) {
+                return m_net.send_to_one(pkt, m_opts.m_priority);
+            }
+            auto server = select_server();
+            if(!server.has_value()) {
+                return false;
+            }
+            add_sent(request_id, server.value());
+            m_net.send(pkt, server.value(), m_opts.m_priority);
+            return true;
+        }
+
+        void expire_requests() {
+            std::unique_lock<std::mutex> l(m_timeouts_mut);
+            while(m_running) {
+                if(m_timeouts.empty()) {
+                    m_timeouts_cv.wait(l);
+                    continue;
+                }
+                auto [deadline, request_id] = m_timeouts.front();
+                if(clock_type::now() < deadline) {
+                    m_timeouts_cv.wait_until(l, deadline);
+                    continue;
+                }
+                m_timeouts.pop_front();
+                l.unlock();
+                // No-op if the response already arrived
+                set_response(request_id, std::nullopt);
+                l.lock();
+            }
         }
 
         void set_response_value(response_action_type& response_action,
@@ -119,7 +399,15 @@ namespace cbdc::rpc {
                                       p.set_value(std::move(value));
                                   },
                                   [&](raw_callback_type& cb) {
-                                      cb(std::move(value));
+                                      if(m_callback_threads.empty()) {
+                                          cb(std::move(value));
+                                          return;
+                                      }
+                                      m_callbacks.push(
+                                          [c = std::move(cb),
+                                           v = std::move(value)]() {
+                                              c(v);
+                                          });
                                   }},
                        response_action);
         }
@@ -168,6 +456,10 @@ namespace cbdc::rpc {
             }();
 
             if(!response_node.empty()) {
+                if(m_opts.m_latency_aware) {
+                    complete_sent(request_id, value.has_value());
+                }
+                release_credit();
                 set_response_value(response_node.mapped(), std::move(value));
             }
         }
@@ -178,9 +470,15 @@ namespace cbdc::rpc {
             if(!send_request(std::move(request_buf),
                              request_id,
                              std::move(response_callback))) {
-                {
+                auto erased = [&]() {
                     std::unique_lock<std::mutex> l(m_responses_mut);
-                    m_responses.erase(request_id);
+                    return m_responses.erase(request_id);
+                }();
+                if(erased != 0) {
+                    if(m_opts.m_latency_aware) {
+                        complete_sent(request_id, false);
+                    }
+                    release_credit();
                 }
                 return false;
             }
@@ -9,6 +9,7 @@
 #include "async_server.hpp"
 #include "blocking_server.hpp"
 #include "server.hpp"
+#include "util/common/buffer_pool.hpp"
 #include "util/network/connection_manager.hpp"
 
 namespace cbdc::rpc {
@@ -21,9 +22,13 @@ namespace cbdc::rpc {
       public:
         /// Constructor.
         /// \param listen_endpoint endpoint on which to listen for incoming connections.
-        explicit tcp_server(network::endpoint_t listen_endpoint)
+        /// \param prio priority class of responses, relative to other
+        ///             traffic sent on the same connections.
+        explicit tcp_server(network::endpoint_t listen_endpoint,
+                            network::priority prio = network::priority::normal)
             : m_net(std::make_shared<network::connection_manager>()),
-              m_listen_endpoint(std::move(listen_endpoint)) {}
+              m_listen_endpoint(std::move(listen_endpoint)),
+              m_priority(prio) {}
 
         tcp_server(tcp_server&&) = delete;
         auto operator=(tcp_server&&) -> tcp_server& = delete;
@@ -51,14 +56,26 @@ namespace cbdc::rpc {
                     if constexpr(Server::handler == handler_type::async) {
                         ret = Server::async_call(
                             std::move(*msg.m_pkt),
-                            [&, peer_id = msg.m_peer_id, net = m_net](
-                                cbdc::buffer resp) {
-                                auto resp_ptr = std::make_shared<cbdc::buffer>(
+                            [&,
+                             peer_id = msg.m_peer_id,
+                             net = m_net,
+                             prio = m_priority](cbdc::buffer resp) {
+                                auto resp_ptr = buffer_pool::global().wrap(
                                     std::move(resp));
-                                net->send(resp_ptr, peer_id);
+                                net->send(resp_ptr, peer_id, prio);
                             });
                     } else {
                         ret = Server::blocking_call(std::move(*msg.m_pkt));
+                        if(ret.has_value()
+                           && m_priority != network::priority::normal) {
+                            // The handler thread sends returned responses
+                            // at normal priority
+                            m_net->send(buffer_pool::global().wrap(
+                                            std::move(ret.value())),
+                                        msg.m_peer_id,
+                                        m_priority);
+                            ret.reset();
+                        }
                     }
 
                     return ret;
@@ -76,6 +93,7 @@ namespace cbdc::rpc {
       private:
         std::shared_ptr<network::connection_manager> m_net;
         network::endpoint_t m_listen_endpoint;
+        network::priority m_priority;
         std::thread m_handler_thread;
     };
 
@@ -8,7 +8,8 @@
 #include <cstring>
 
 namespace cbdc {
-    buffer_serializer::buffer_serializer(cbdc::buffer& pkt) : m_pkt(pkt) {}
+    buffer_serializer::buffer_serializer(cbdc::buffer& pkt)
+        : serializer(pkt) {}
 
     buffer_serializer::operator bool() const {
         return m_valid;
@@ -24,25 +25,21 @@ namespace cbdc {
     }
 
     [[nodiscard]] auto buffer_serializer::end_of_buffer() const -> bool {
-        return m_cursor >= m_pkt.size();
+        return m_cursor >= m_pkt->size();
     }
 
-    auto buffer_serializer::write(const void* data, size_t len) -> bool {
-        if(m_cursor + len > m_pkt.size()) {
-            m_pkt.extend(m_cursor + len - m_pkt.size());
+    auto buffer_serializer::do_write(const void* data, size_t len) -> bool {
+        if(m_cursor + len > m_pkt->size()) {
+            m_pkt->extend(m_cursor + len - m_pkt->size());
         }
-        std::memcpy(m_pkt.data_at(m_cursor), data, len);
+        std::memcpy(m_pkt->data_at(m_cursor), data, len);
         m_cursor += len;
         return true;
     }
 
-    auto buffer_serializer::read(void* data, size_t len) -> bool {
-        if(m_cursor + len > m_pkt.size()) {
-            m_valid = false;
-            return false;
-        }
-        std::memcpy(data, m_pkt.data_at(m_cursor), len);
-        m_cursor += len;
-        return true;
+    auto buffer_serializer::do_read(void* /* data */, size_t /* len */)
+        -> bool {
+        m_valid = false;
+        return false;
     }
 }
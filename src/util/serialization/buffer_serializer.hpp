@@ -11,6 +11,9 @@
 
 namespace cbdc {
     /// \brief Serializer implementation for \ref buffer.
+    ///
+    /// Reads and writes within the buffer are copied inline by \ref
+    /// serializer without a virtual call.
     class buffer_serializer final : public cbdc::serializer {
       public:
         /// Constructor.
@@ -32,26 +35,20 @@ namespace cbdc {
         /// \return true if the cursor is at or beyond the end of the buffer.
         [[nodiscard]] auto end_of_buffer() const -> bool final;
 
+      private:
         /// Write the given bytes into the buffer from the current cursor
-        /// position. If the data extends beyond the end of the buffer, expands
-        /// the buffer size to fit the new data.
+        /// position. Called for writes extending beyond the end of the
+        /// buffer, so expands the buffer size to fit the new data.
         /// \param data pointer to the start of the bytes to write.
         /// \param len number of bytes to write.
         /// \return true if the serializer wrote the entirety of the data to
         ///         the buffer.
-        auto write(const void* data, size_t len) -> bool final;
+        auto do_write(const void* data, size_t len) -> bool final;
 
-        /// Read the given number of bytes from the buffer from the current
-        /// cursor position into the given memory location.
-        /// \param data pointer to the destination of the read data.
-        /// \param len number of bytes to read from the buffer.
-        /// \return true if the serializer read the requested number of bytes
-        ///         from the buffer.
-        auto read(void* data, size_t len) -> bool final;
+        /// Called for reads beyond the end of the buffer, so always fails.
+        /// \return false.
+        auto do_read(void* data, size_t len) -> bool final;
 
-      private:
-        cbdc::buffer& m_pkt;
-        size_t m_cursor{};
         bool m_valid{true};
     };
 }
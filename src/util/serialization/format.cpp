@@ -34,4 +34,65 @@ namespace cbdc {
         deser.read(b.data(), sz);
         return deser;
     }
+
+    auto operator<<(serializer& ser, const flat_hash_set& set)
+        -> serializer& {
+        ser << static_cast<uint64_t>(set.size());
+        for(const auto& key : set) {
+            ser << key;
+        }
+        return ser;
+    }
+
+    auto operator>>(serializer& deser, flat_hash_set& set) -> serializer& {
+        auto len = uint64_t();
+        if(!(deser >> len)) {
+            return deser;
+        }
+        // Bound the up-front allocation in case the length is corrupt.
+        set.reserve(set.size()
+                    + static_cast<size_t>(std::min(
+                        len,
+                        config::maximum_reservation / sizeof(hash_t))));
+        for(uint64_t i{0}; i < len; i++) {
+            auto key = hash_t();
+            if(!(deser >> key)) {
+                return deser;
+            }
+            set.insert(key);
+        }
+        return deser;
+    }
+
+    auto operator<<(serializer& ser, const generational_hash_set& set)
+        -> serializer& {
+        ser << set.current() << static_cast<uint64_t>(set.current_inserts())
+            << static_cast<uint64_t>(set.sealed().size());
+        for(const auto& gen : set.sealed()) {
+            ser << gen;
+        }
+        return ser;
+    }
+
+    auto operator>>(serializer& deser, generational_hash_set& set)
+        -> serializer& {
+        auto current = flat_hash_set();
+        auto inserts = uint64_t();
+        auto count = uint64_t();
+        if(!(deser >> current >> inserts >> count)) {
+            return deser;
+        }
+        auto sealed = std::deque<std::vector<hash_t>>();
+        for(uint64_t i{0}; i < count; i++) {
+            auto gen = std::vector<hash_t>();
+            if(!(deser >> gen)) {
+                return deser;
+            }
+            sealed.push_back(std::move(gen));
+        }
+        set.restore(std::move(current),
+                    static_cast<size_t>(inserts),
+                    std::move(sealed));
+        return deser;
+    }
 }
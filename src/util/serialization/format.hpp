@@ -9,21 +9,110 @@
 #include "serializer.hpp"
 #include "util/common/buffer.hpp"
 #include "util/common/config.hpp"
+#include "util/common/flat_hash_set.hpp"
+#include "util/common/generational_hash_set.hpp"
+#include "util/common/small_flat_map.hpp"
+#include "util/common/small_vector.hpp"
 #include "util/common/variant_overloaded.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <optional>
 #include <set>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace cbdc {
+    /// \brief Serialized size of types whose encoding has a fixed length.
+    ///
+    /// Holds the number of bytes every value of T serializes to, or zero
+    /// if the serialized size depends on the value. Specialize alongside
+    /// the serializer of a fixed-size structure so its size is known at
+    /// compile time. \see \ref serialized_size.
+    /// \tparam T type to serialize.
+    template<typename T, typename = void>
+    struct fixed_serialized_size : std::integral_constant<size_t, 0> {};
+
+    /// \copydoc fixed_serialized_size
+    template<typename T>
+    inline constexpr size_t fixed_serialized_size_v
+        = fixed_serialized_size<T>::value;
+
+    /// Integral values serialize to their size in memory.
+    template<typename T>
+    struct fixed_serialized_size<
+        T,
+        std::enable_if_t<std::is_integral_v<T> && !std::is_enum_v<T>>>
+        : std::integral_constant<size_t, sizeof(T)> {};
+
+    /// std::byte serializes to a single byte.
+    template<>
+    struct fixed_serialized_size<std::byte>
+        : std::integral_constant<size_t, 1> {};
+
+    /// Arrays of integral values serialize to their size in memory.
+    template<typename T, size_t len>
+    struct fixed_serialized_size<std::array<T, len>,
+                                 std::enable_if_t<std::is_integral_v<T>>>
+        : std::integral_constant<size_t, sizeof(T) * len> {};
+
+    /// Pairs of fixed-size values serialize to the sum of their sizes.
+    template<typename A, typename B>
+    struct fixed_serialized_size<
+        std::pair<A, B>,
+        std::enable_if_t<(fixed_serialized_size_v<A> > 0
+                          && fixed_serialized_size_v<B> > 0)>>
+        : std::integral_constant<size_t,
+                                 fixed_serialized_size_v<A>
+                                     + fixed_serialized_size_v<B>> {};
+
+    /// \brief Whether a contiguous run of T serializes as its raw bytes.
+    ///
+    /// True for types whose in-memory representation is their serialized
+    /// form, so vectors of them are written with a single copy rather
+    /// than one call per element. Excludes bool, which is not bytewise
+    /// for the std::vector<bool> specialization.
+    /// \tparam T element type.
+    template<typename T>
+    struct is_bytewise_serializable
+        : std::bool_constant<std::is_integral_v<T>
+                             && !std::is_same_v<T, bool>> {};
+
+    /// \copydoc is_bytewise_serializable
+    template<typename T>
+    inline constexpr bool is_bytewise_serializable_v
+        = is_bytewise_serializable<T>::value;
+
+    template<>
+    struct is_bytewise_serializable<std::byte> : std::true_type {};
+
+    /// \brief Whether the memory layout of T can be its serialized form.
+    ///
+    /// True if T is trivially copyable, has no padding and is as large as
+    /// its fixed serialized size. A structure meeting these conditions
+    /// whose members are declared in the order it serializes them may
+    /// specialize \ref is_bytewise_serializable with this value. The
+    /// member order cannot be checked here.
+    /// \tparam T structure type.
+    template<typename T>
+    inline constexpr bool has_bytewise_layout_v
+        = std::is_trivially_copyable_v<T>
+       && std::has_unique_object_representations_v<T>
+       && fixed_serialized_size_v<T> == sizeof(T);
+
+    template<typename T, size_t len>
+    struct is_bytewise_serializable<std::array<T, len>>
+        : std::bool_constant<is_bytewise_serializable_v<T>
+                             && sizeof(std::array<T, len>)
+                                    == sizeof(T) * len> {};
 
     /// Serializes the std::byte as a std::uint8_t.
     auto operator<<(serializer& packet, std::byte b) -> serializer&;
@@ -46,6 +135,28 @@ namespace cbdc {
     /// \brief Deserializes a raw byte buffer.
     auto operator>>(serializer& deser, buffer& b) -> serializer&;
 
+    /// \brief Serializes a flat hash set.
+    ///
+    /// Uses the same format as an unordered set of hashes: the number of
+    /// keys as a 64-bit uint, followed by each key.
+    ///
+    /// \see \ref cbdc::operator>>(serializer&, flat_hash_set&)
+    auto operator<<(serializer& ser, const flat_hash_set& set) -> serializer&;
+
+    /// \brief Deserializes a flat hash set, adding to any keys it holds.
+    auto operator>>(serializer& deser, flat_hash_set& set) -> serializer&;
+
+    /// \brief Serializes a generational hash set.
+    ///
+    /// Writes the current generation, its insert count, and then the
+    /// number of sealed generations followed by each, newest first.
+    auto operator<<(serializer& ser, const generational_hash_set& set)
+        -> serializer&;
+
+    /// \brief Deserializes a generational hash set, replacing its keys.
+    auto operator>>(serializer& deser, generational_hash_set& set)
+        -> serializer&;
+
     /// Serializes nothing if `T` is an empty type.
     /// \tparam T an empty type
     /// \param s the serializer (to which nothing will be written)
@@ -187,8 +298,14 @@ namespace cbdc {
         -> serializer& {
         const auto len = static_cast<uint64_t>(vec.size());
         packet << len;
-        for(uint64_t i = 0; i < len; i++) {
-            packet << static_cast<T>(vec[i]);
+        if constexpr(is_bytewise_serializable_v<T>) {
+            if(!vec.empty()) {
+                packet.write(vec.data(), sizeof(T) * vec.size());
+            }
+        } else {
+            for(uint64_t i = 0; i < len; i++) {
+                packet << static_cast<T>(vec[i]);
+            }
         }
         return packet;
     }
@@ -212,7 +329,15 @@ namespace cbdc {
                 allocated + config::maximum_reservation / sizeof(T));
             vec.reserve(allocated);
             while(vec.size() < allocated) {
-                if constexpr(std::is_default_constructible_v<T>) {
+                if constexpr(is_bytewise_serializable_v<T>) {
+                    // One read per element rather than one per member, so
+                    // a truncated vector still keeps its complete elements
+                    T val{};
+                    if(!packet.read(&val, sizeof(T))) {
+                        return packet;
+                    }
+                    vec.push_back(val);
+                } else if constexpr(std::is_default_constructible_v<T>) {
                     T val{};
                     if(!(packet >> val)) {
                         return packet;
@@ -232,6 +357,99 @@ namespace cbdc {
         return packet;
     }
 
+    /// Serializes a small vector in the same format as a std::vector.
+    /// \see \ref cbdc::operator<<(serializer&, const std::vector<T>&)
+    template<typename T, size_t N>
+    auto operator<<(serializer& packet, const small_vector<T, N>& vec)
+        -> serializer& {
+        packet << static_cast<uint64_t>(vec.size());
+        if constexpr(is_bytewise_serializable_v<T>) {
+            if(!vec.empty()) {
+                packet.write(vec.data(), sizeof(T) * vec.size());
+            }
+        } else {
+            for(const auto& val : vec) {
+                packet << val;
+            }
+        }
+        return packet;
+    }
+
+    /// Deserializes a small vector of elements.
+    /// \see \ref cbdc::operator<<(serializer&, const small_vector<T, N>&)
+    template<typename T, size_t N>
+    auto operator>>(serializer& packet, small_vector<T, N>& vec)
+        -> serializer& {
+        static_assert(sizeof(T) <= config::maximum_reservation,
+                      "Vector element size too large");
+
+        uint64_t len{};
+        if(!(packet >> len)) {
+            return packet;
+        }
+
+        vec.clear();
+        uint64_t allocated = 0;
+        while(allocated < len) {
+            allocated = std::min(
+                len,
+                allocated + config::maximum_reservation / sizeof(T));
+            vec.reserve(allocated);
+            while(vec.size() < allocated) {
+                T val{};
+                if constexpr(is_bytewise_serializable_v<T>) {
+                    if(!packet.read(&val, sizeof(T))) {
+                        return packet;
+                    }
+                } else if(!(packet >> val)) {
+                    return packet;
+                }
+                vec.push_back(std::move(val));
+            }
+        }
+        return packet;
+    }
+
+    /// Serializes a small flat map in the same format as a
+    /// std::unordered_map.
+    template<typename K, typename V, size_t N>
+    auto operator<<(serializer& ser, const small_flat_map<K, V, N>& map)
+        -> serializer& {
+        ser << static_cast<uint64_t>(map.size());
+        for(const auto& [key, val] : map) {
+            ser << key << val;
+        }
+        return ser;
+    }
+
+    /// Deserializes a small flat map. Entries with a duplicate key are
+    /// ignored, as for std::unordered_map.
+    /// \see \ref cbdc::operator<<(serializer&, const small_flat_map<K, V, N>&)
+    template<typename K, typename V, size_t N>
+    auto operator>>(serializer& deser, small_flat_map<K, V, N>& map)
+        -> serializer& {
+        static_assert(sizeof(K) + sizeof(V) <= config::maximum_reservation,
+                      "Map element size too large");
+        auto len = uint64_t();
+        if(!(deser >> len)) {
+            return deser;
+        }
+
+        map.clear();
+        map.reserve(std::min(
+            len,
+            uint64_t{config::maximum_reservation / (sizeof(K) + sizeof(V))}));
+        for(uint64_t i = 0; i < len; i++) {
+            auto key = K();
+            auto val = V();
+            if(!(deser >> key >> val)) {
+                return deser;
+            }
+            map.emplace(key, val);
+        }
+        return deser;
+    }
+
     /// Serializes the count of key-value pairs, and then each key and value,
     /// statically-casted.
     /// \see \ref cbdc::operator<<(serializer&, T)
@@ -32,13 +32,13 @@ namespace cbdc {
         m_str.seekg(0);
     }
 
-    auto istream_serializer::write(const void* /* data */, size_t /* len */)
+    auto istream_serializer::do_write(const void* /* data */, size_t /* len */)
         -> bool {
         m_str.setstate(std::ios::failbit);
         return false;
     }
 
-    auto istream_serializer::read(void* data, size_t len) -> bool {
+    auto istream_serializer::do_read(void* data, size_t len) -> bool {
         auto read_vec = std::vector<char>(len);
         if(!m_str.read(read_vec.data(), static_cast<off_type>(len))) {
             return false;
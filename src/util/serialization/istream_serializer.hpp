@@ -30,9 +30,10 @@ namespace cbdc {
         /// Seeks the stream position to the beginning.
         void reset() final;
 
+      private:
         /// Not implemented for istream.
         /// \return false.
-        auto write(const void* data, size_t len) -> bool final;
+        auto do_write(const void* data, size_t len) -> bool final;
 
         /// Attempts to read the given number of bytes from the current
         /// position in the stream.
@@ -40,9 +41,8 @@ namespace cbdc {
         /// \param len number of bytes to read from the stream.
         /// \return true if the operation read the requested number of bytes
         ///         from the stream into the destination.
-        auto read(void* data, size_t len) -> bool final;
+        auto do_read(void* data, size_t len) -> bool final;
 
-      private:
         std::istream& m_str;
 
         using off_type = std::remove_reference_t<decltype(m_str)>::off_type;
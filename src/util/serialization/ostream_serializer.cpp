@@ -32,14 +32,15 @@ namespace cbdc {
         m_str.seekp(0);
     }
 
-    auto ostream_serializer::write(const void* data, size_t len) -> bool {
+    auto ostream_serializer::do_write(const void* data, size_t len) -> bool {
         auto write_vec = std::vector<char>(len);
         std::memcpy(write_vec.data(), data, len);
         return static_cast<bool>(
             m_str.write(write_vec.data(), static_cast<off_type>(len)));
     }
 
-    auto ostream_serializer::read(void* /* data */, size_t /* len */) -> bool {
+    auto ostream_serializer::do_read(void* /* data */, size_t /* len */)
+        -> bool {
         m_str.setstate(std::ios::failbit);
         return false;
     }
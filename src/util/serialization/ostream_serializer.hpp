@@ -29,6 +29,7 @@ namespace cbdc {
         /// Seeks the stream position to the beginning.
         void reset() final;
 
+      private:
         /// Attempts to write the given number of bytes from the given memory
         /// location to the stream's current position.
         /// \param data memory location from which to write data into the
@@ -36,13 +37,12 @@ namespace cbdc {
         /// \param len number of bytes to write into the stream.
         /// \return true if the operation wrote the requested number of bytes
         ///         from the data source into the stream.
-        auto write(const void* data, size_t len) -> bool final;
+        auto do_write(const void* data, size_t len) -> bool final;
 
         /// Not implemented for ostream.
         /// \return false.
-        auto read(void* data, size_t len) -> bool final;
+        auto do_read(void* data, size_t len) -> bool final;
 
-      private:
         std::ostream& m_str;
 
         using off_type = std::remove_reference_t<decltype(m_str)>::off_type;
@@ -6,7 +6,10 @@
 #ifndef OPENCBDC_TX_SRC_SERIALIZATION_SERIALIZER_H_
 #define OPENCBDC_TX_SRC_SERIALIZATION_SERIALIZER_H_
 
+#include "util/common/buffer.hpp"
+
 #include <cstddef>
+#include <cstring>
 
 namespace cbdc {
     /// Interface for serializing objects into and out of raw bytes
@@ -42,7 +45,14 @@ namespace cbdc {
         /// \param len number of bytes of the data to write.
         /// \return true if the serializer wrote the requested number of bytes
         ///         to the buffer.
-        virtual auto write(const void* data, size_t len) -> bool = 0;
+        auto write(const void* data, size_t len) -> bool {
+            if(m_pkt != nullptr && m_cursor + len <= m_pkt->size()) {
+                std::memcpy(m_pkt->data_at(m_cursor), data, len);
+                m_cursor += len;
+                return true;
+            }
+            return do_write(data, len);
+        }
 
         /// Attempts to read the requested number of bytes from the current
         /// cursor position into the given memory location.
@@ -51,10 +61,36 @@ namespace cbdc {
         /// \param len number of bytes to read from the buffer.
         /// \return true if the serializer read the requested number of bytes
         ///         from the buffer into the destination.
-        virtual auto read(void* data, size_t len) -> bool = 0;
+        auto read(void* data, size_t len) -> bool {
+            if(m_pkt != nullptr && m_cursor + len <= m_pkt->size()) {
+                std::memcpy(data, m_pkt->data_at(m_cursor), len);
+                m_cursor += len;
+                return true;
+            }
+            return do_read(data, len);
+        }
 
       protected:
         serializer() = default;
+
+        /// Constructor for serializers of a \ref buffer. Reads and writes
+        /// within the buffer's current size are copied inline at m_cursor,
+        /// without a virtual call.
+        /// \param pkt buffer to serialize into or out of.
+        explicit serializer(buffer& pkt) : m_pkt(&pkt) {}
+
+        /// Writes data that \ref write did not copy inline.
+        /// \see \ref write
+        virtual auto do_write(const void* data, size_t len) -> bool = 0;
+
+        /// Reads data that \ref read did not copy inline.
+        /// \see \ref read
+        virtual auto do_read(void* data, size_t len) -> bool = 0;
+
+        /// Buffer read and written inline, or nullptr if there is none.
+        buffer* m_pkt{};
+        /// Offset in m_pkt of the next read or write.
+        size_t m_cursor{};
     };
 }
 
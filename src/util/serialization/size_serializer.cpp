@@ -22,12 +22,12 @@ namespace cbdc {
         return false;
     }
 
-    auto size_serializer::write(const void* /* data */, size_t len) -> bool {
+    auto size_serializer::do_write(const void* /* data */, size_t len) -> bool {
         m_cursor += len;
         return true;
     }
 
-    auto size_serializer::read(void* /* data */, size_t /* len */) -> bool {
+    auto size_serializer::do_read(void* /* data */, size_t /* len */) -> bool {
         return false;
     }
 
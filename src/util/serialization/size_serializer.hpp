@@ -34,23 +34,21 @@ namespace cbdc {
         /// \return false.
         [[nodiscard]] auto end_of_buffer() const -> bool final;
 
+        /// Returns the number of bytes accumulated in the size counter during
+        /// mock serialization.
+        /// \return number of bytes a buffer would need for serialization.
+        [[nodiscard]] auto size() const -> size_t;
+
+      private:
         /// Increases size counter by the given number of bytes.
         /// \param data pointer is not read from.
         /// \param len number of bytes by which to increase the size counter.
         /// \return true.
-        auto write(const void* data, size_t len) -> bool final;
+        auto do_write(const void* data, size_t len) -> bool final;
 
         /// Read is not implemented for size serializer.
         /// \return false.
-        auto read(void* data, size_t len) -> bool final;
-
-        /// Returns the number of bytes accumulated in the size counter during
-        /// mock serialization.
-        /// \return number of bytes a buffer would need for serialization.
-        [[nodiscard]] auto size() const -> size_t;
-
-      private:
-        size_t m_cursor{};
+        auto do_read(void* data, size_t len) -> bool final;
     };
 }
 
@@ -7,21 +7,29 @@
 #define OPENCBDC_TX_SRC_SERIALIZATION_UTIL_H_
 
 #include "buffer_serializer.hpp"
+#include "format.hpp"
 #include "size_serializer.hpp"
+#include "util/common/buffer_pool.hpp"
 
 #include <memory>
 
 namespace cbdc {
     /// Calculates the serialized size in bytes of the given object when
     /// serialized using \ref serializer. \see \ref size_serializer.
+    /// Types with a \ref fixed_serialized_size return it without
+    /// walking the object.
     /// \tparam T type of object.
     /// \param obj object to serialize.
     /// \return serialized size in bytes.
     template<typename T>
     auto serialized_size(const T& obj) -> size_t {
-        auto ser = size_serializer();
-        ser << obj;
-        return ser.size();
+        if constexpr(fixed_serialized_size_v<T> > 0) {
+            return fixed_serialized_size_v<T>;
+        } else {
+            auto ser = size_serializer();
+            ser << obj;
+            return ser.size();
+        }
     }
 
     /// Serialize object into cbdc::buffer using a cbdc::buffer_serializer.
@@ -41,13 +49,14 @@ namespace cbdc {
     }
 
     /// Serialize object into std::shared_ptr<cbdc::buffer> using a
-    /// cbdc::buffer_serializer.
+    /// cbdc::buffer_serializer. The buffer is taken from
+    /// \ref buffer_pool::global and returns to it once released.
     /// \tparam T type of object to serialize.
     /// \return a shared_ptr to a serialized buffer of the object.
     template<typename T>
     auto make_shared_buffer(const T& obj) -> std::shared_ptr<cbdc::buffer> {
         auto sz = serialized_size(obj);
-        auto buf = std::make_shared<cbdc::buffer>();
+        auto buf = buffer_pool::global().acquire(sz);
         buf->extend(sz);
         auto ser = cbdc::buffer_serializer(*buf);
         ser << obj;
@@ -84,8 +84,12 @@ class atomizer_end_to_end_test : public ::testing::Test {
         std::filesystem::remove_all("atomizer_snps_0");
         std::filesystem::remove_all("shard0_db");
         std::filesystem::remove(m_sender_wallet_store_file);
+        std::filesystem::remove(std::string(m_sender_wallet_store_file)
+                                + ".journal");
         std::filesystem::remove(m_sender_client_store_file);
         std::filesystem::remove(m_receiver_wallet_store_file);
+        std::filesystem::remove(std::string(m_receiver_wallet_store_file)
+                                + ".journal");
         std::filesystem::remove(m_receiver_client_store_file);
         std::filesystem::remove("tp_samples.txt");
     }
@@ -63,8 +63,12 @@ class two_phase_end_to_end_test : public ::testing::Test {
         m_receiver.reset();
 
         std::filesystem::remove(m_sender_wallet_store_file);
+        std::filesystem::remove(std::string(m_sender_wallet_store_file)
+                                + ".journal");
         std::filesystem::remove(m_sender_client_store_file);
         std::filesystem::remove(m_receiver_wallet_store_file);
+        std::filesystem::remove(std::string(m_receiver_wallet_store_file)
+                                + ".journal");
         std::filesystem::remove(m_receiver_client_store_file);
         std::filesystem::remove_all("coordinator0_raft_log_0");
         std::filesystem::remove("coordinator0_raft_config_0.dat");
@@ -0,0 +1,159 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/atomizer/archiver/block_archive.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+class block_archive_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(m_dir);
+        for(uint64_t i{0}; i < 20; i++) {
+            auto blk = cbdc::buffer();
+            // Repetitive contents, like the structure of serialized blocks
+            for(size_t j{0}; j < 64; j++) {
+                blk.append(&i, sizeof(i));
+            }
+            m_blocks.push_back(std::move(blk));
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    [[nodiscard]] auto segments() const -> std::vector<std::string> {
+        auto ret = std::vector<std::string>();
+        for(const auto& f : std::filesystem::directory_iterator(m_dir)) {
+            ret.push_back(f.path().string());
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    static constexpr auto m_dir = "block_archive_test_dir";
+    /// Small enough that each segment holds only a few blocks.
+    static constexpr size_t m_segment_bytes = 256;
+    static constexpr uint64_t m_first_height = 1;
+    std::vector<cbdc::buffer> m_blocks;
+};
+
+TEST_F(block_archive_test, append_read) {
+    auto archive = cbdc::archiver::block_archive(m_segment_bytes);
+    ASSERT_TRUE(archive.load(m_dir));
+    ASSERT_EQ(archive.last_height(), 0UL);
+    ASSERT_FALSE(archive.get(m_first_height).has_value());
+
+    for(size_t i{0}; i < m_blocks.size(); i++) {
+        ASSERT_TRUE(archive.append(m_first_height + i, m_blocks[i]));
+    }
+    ASSERT_TRUE(archive.flush());
+    ASSERT_GT(segments().size(), 1UL);
+    ASSERT_EQ(archive.last_height(), m_blocks.size());
+
+    // Only the next height can be appended
+    ASSERT_FALSE(archive.append(m_first_height, m_blocks[0]));
+    ASSERT_FALSE(archive.append(m_blocks.size() + 2, m_blocks[0]));
+
+    for(size_t i{0}; i < m_blocks.size(); i++) {
+        auto blk = archive.get(m_first_height + i);
+        ASSERT_TRUE(blk.has_value());
+        ASSERT_EQ(blk.value(), m_blocks[i]);
+    }
+    ASSERT_FALSE(archive.get(0).has_value());
+    ASSERT_FALSE(archive.get(m_blocks.size() + 1).has_value());
+
+    // Ranges span segments and stop at the end of the archive
+    auto range = archive.get_range(3, 100);
+    ASSERT_EQ(range.size(), m_blocks.size() - 2);
+    for(size_t i{0}; i < range.size(); i++) {
+        ASSERT_EQ(range[i], m_blocks[i + 2]);
+    }
+
+    // Blocks are stored compressed
+    uintmax_t archived_bytes{0};
+    size_t raw_bytes{0};
+    for(const auto& seg : segments()) {
+        archived_bytes += std::filesystem::file_size(seg);
+    }
+    for(const auto& blk : m_blocks) {
+        raw_bytes += blk.size();
+    }
+    ASSERT_LT(archived_bytes, raw_bytes / 2);
+}
+
+TEST_F(block_archive_test, reload) {
+    {
+        auto archive = cbdc::archiver::block_archive(m_segment_bytes);
+        ASSERT_TRUE(archive.load(m_dir));
+        for(size_t i{0}; i < m_blocks.size(); i++) {
+            ASSERT_TRUE(archive.append(m_first_height + i, m_blocks[i]));
+        }
+    }
+
+    auto archive = cbdc::archiver::block_archive(m_segment_bytes);
+    ASSERT_TRUE(archive.load(m_dir));
+    ASSERT_EQ(archive.last_height(), m_blocks.size());
+    auto range = archive.get_range(m_first_height, m_blocks.size());
+    ASSERT_EQ(range, m_blocks);
+}
+
+TEST_F(block_archive_test, torn_record) {
+    {
+        auto archive = cbdc::archiver::block_archive(m_segment_bytes);
+        ASSERT_TRUE(archive.load(m_dir));
+        for(size_t i{0}; i < m_blocks.size(); i++) {
+            ASSERT_TRUE(archive.append(m_first_height + i, m_blocks[i]));
+        }
+    }
+
+    // Partially overwrite the last record
+    const auto last = segments().back();
+    const auto size = std::filesystem::file_size(last);
+    {
+        auto f = std::fstream(last,
+                              std::ios::binary | std::ios::in
+                                  | std::ios::out);
+        f.seekp(static_cast<std::streamoff>(size - 4));
+        f.write("torn", 4);
+    }
+
+    auto archive = cbdc::archiver::block_archive(m_segment_bytes);
+    ASSERT_TRUE(archive.load(m_dir));
+    ASSERT_EQ(archive.last_height(), m_blocks.size() - 1);
+    ASSERT_LT(std::filesystem::file_size(last), size);
+    ASSERT_FALSE(archive.get(m_blocks.size()).has_value());
+
+    // The lost block can be appended again
+    ASSERT_TRUE(archive.append(m_blocks.size(), m_blocks.back()));
+    auto blk = archive.get(m_blocks.size());
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_EQ(blk.value(), m_blocks.back());
+}
+
+TEST_F(block_archive_test, append_records) {
+    auto archive = cbdc::archiver::block_archive(m_segment_bytes);
+    ASSERT_TRUE(archive.load(m_dir));
+
+    auto recs = std::vector<cbdc::archiver::block_archive::record>();
+    for(size_t i{0}; i < m_blocks.size(); i++) {
+        auto rec = archive.make_record(m_first_height + i, m_blocks[i]);
+        ASSERT_TRUE(rec.has_value());
+        recs.push_back(std::move(rec.value()));
+    }
+
+    // Records must be consecutive
+    ASSERT_FALSE(archive.append({recs[0], recs[2]}));
+    ASSERT_EQ(archive.last_height(), 0UL);
+
+    ASSERT_TRUE(archive.append(recs));
+    ASSERT_GT(segments().size(), 1UL);
+    ASSERT_EQ(archive.last_height(), m_blocks.size());
+    ASSERT_EQ(archive.get_range(m_first_height, m_blocks.size()), m_blocks);
+}
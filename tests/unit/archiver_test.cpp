@@ -4,12 +4,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "uhs/atomizer/archiver/controller.hpp"
+#include "uhs/atomizer/archiver/format.hpp"
 #include "uhs/atomizer/atomizer/format.hpp"
 #include "util/common/logging.hpp"
+#include "util/network/tcp_listener.hpp"
 #include "util/serialization/format.hpp"
 
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <thread>
 
 class ArchiverTest : public ::testing::Test {
   protected:
@@ -210,6 +213,31 @@ TEST_F(ArchiverTest, digest_block_deferral) {
     ASSERT_EQ(m_archiver->best_block_height(), 3UL);
 }
 
+// Test if the archiver digests a run of deferred blocks once the block
+// preceding them arrives
+TEST_F(ArchiverTest, digest_block_deferred_run) {
+    m_config_opts.m_archiver_digest_threads = 4;
+    m_archiver
+        = std::make_unique<cbdc::archiver::controller>(0,
+                                                       m_config_opts,
+                                                       m_log,
+                                                       0);
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    m_archiver->digest_block(m_dummy_blocks[0]);
+    for(size_t i{2}; i < m_dummy_blocks.size(); i++) {
+        m_archiver->digest_block(m_dummy_blocks[i]);
+    }
+    ASSERT_EQ(m_archiver->best_block_height(), 1UL);
+    m_archiver->digest_block(m_dummy_blocks[1]);
+    ASSERT_EQ(m_archiver->best_block_height(), m_dummy_blocks.size());
+    for(const auto& b : m_dummy_blocks) {
+        auto blk = m_archiver->get_block(b.m_height);
+        ASSERT_TRUE(blk.has_value());
+        ASSERT_EQ(blk.value(), b);
+    }
+}
+
 // Test the get_block function
 TEST_F(ArchiverTest, get_block) {
     m_archiver->init_leveldb();
@@ -234,7 +262,7 @@ TEST_F(ArchiverTest, server_handler) {
     m_archiver->digest_block(m_dummy_blocks[2]);
     auto pkt = std::make_shared<cbdc::buffer>();
     auto ser = cbdc::buffer_serializer(*pkt);
-    ser << static_cast<uint64_t>(1);
+    ser << cbdc::archiver::request{static_cast<uint64_t>(1)};
     auto msg = cbdc::network::message_t{pkt, 0};
     auto buf = m_archiver->server_handler(std::move(msg));
     ASSERT_TRUE(buf.has_value());
@@ -269,6 +297,82 @@ TEST_F(ArchiverTest, client) {
               m_dummy_blocks[0].m_transactions[2].m_id);
 }
 
+// Test streaming a range of blocks to the client
+TEST_F(ArchiverTest, client_get_blocks) {
+    m_archiver->init_leveldb();
+    m_archiver->init_best_block();
+    ASSERT_TRUE(m_archiver->init_archiver_server());
+    for(const auto& b : m_dummy_blocks) {
+        m_archiver->digest_block(b);
+    }
+
+    auto client
+        = cbdc::archiver::client(m_config_opts.m_archiver_endpoints[0], m_log);
+    ASSERT_TRUE(client.init());
+    auto blks = std::vector<cbdc::atomizer::block>();
+    auto handler = [&](cbdc::atomizer::block&& b) {
+        blks.push_back(std::move(b));
+    };
+    ASSERT_TRUE(client.get_blocks(2, 9, handler));
+    ASSERT_EQ(blks.size(), 8UL);
+    for(size_t i{0}; i < blks.size(); i++) {
+        ASSERT_EQ(blks[i], m_dummy_blocks[i + 1]);
+    }
+
+    // The stream ends at the first missing block
+    blks.clear();
+    ASSERT_FALSE(client.get_blocks(9, 15, handler));
+    ASSERT_EQ(blks.size(), 2UL);
+    ASSERT_EQ(blks.back().m_height, 10UL);
+
+    // The connection remains usable for single blocks
+    auto blk = client.get_block(3);
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_EQ(blk.value(), m_dummy_blocks[2]);
+}
+
+// Test that the rest of a failed stream is not read as later responses
+TEST_F(ArchiverTest, client_get_blocks_failed_stream) {
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 5002};
+    auto listener = cbdc::network::tcp_listener();
+    ASSERT_TRUE(listener.listen(ep.first, ep.second));
+    std::thread server([&]() {
+        // Streams the range out of order. The client may close the
+        // connection before the stream is sent, so sends can fail.
+        auto first = cbdc::network::tcp_socket();
+        ASSERT_TRUE(listener.accept(first));
+        auto pkt = cbdc::buffer();
+        ASSERT_TRUE(first.receive(pkt));
+        for(const auto& resp :
+            {cbdc::archiver::response{m_dummy_blocks[2]},
+             cbdc::archiver::response{m_dummy_blocks[1]},
+             cbdc::archiver::response{std::nullopt}}) {
+            [[maybe_unused]] auto sent = first.send(resp);
+        }
+
+        // Answers the request the client makes after reconnecting
+        auto second = cbdc::network::tcp_socket();
+        ASSERT_TRUE(listener.accept(second));
+        ASSERT_TRUE(second.receive(pkt));
+        ASSERT_TRUE(second.send(cbdc::archiver::response{m_dummy_blocks[0]}));
+    });
+
+    auto client = cbdc::archiver::client(ep, m_log);
+    ASSERT_TRUE(client.init());
+    auto blks = std::vector<cbdc::atomizer::block>();
+    ASSERT_FALSE(client.get_blocks(2, 3, [&](cbdc::atomizer::block&& b) {
+        blks.push_back(std::move(b));
+    }));
+    ASSERT_TRUE(blks.empty());
+
+    auto blk = client.get_block(1);
+    // Fails the server's accept if the client never reconnected
+    listener.close();
+    server.join();
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_EQ(blk.value(), m_dummy_blocks[0]);
+}
+
 // Test if the archiver returns null for a non existent block
 TEST_F(ArchiverTest, get_block_non_existent) {
     m_archiver->init_leveldb();
@@ -293,3 +397,39 @@ TEST_F(ArchiverTest, init) {
     ASSERT_TRUE(blk.has_value());
     ASSERT_EQ(m_archiver->best_block_height(), 1UL);
 }
+
+// Test digesting and reloading blocks with the segment file backend
+TEST_F(ArchiverTest, segment_backend) {
+    m_config_opts.m_archiver_backend = cbdc::config::archiver_backend::segment;
+    m_config_opts.m_archiver_sync_blocks = 2;
+    {
+        auto archiver0
+            = std::make_unique<cbdc::archiver::controller>(0,
+                                                           m_config_opts,
+                                                           m_log,
+                                                           0);
+        ASSERT_TRUE(archiver0->init_block_archive());
+        ASSERT_TRUE(archiver0->init_best_block());
+        ASSERT_EQ(archiver0->best_block_height(), 0UL);
+        archiver0->digest_block(m_dummy_blocks[0]);
+        archiver0->digest_block(m_dummy_blocks[2]);
+        archiver0->digest_block(m_dummy_blocks[1]);
+        ASSERT_EQ(archiver0->best_block_height(), 3UL);
+    }
+
+    auto archiver1
+        = std::make_unique<cbdc::archiver::controller>(0,
+                                                       m_config_opts,
+                                                       m_log,
+                                                       0);
+    ASSERT_TRUE(archiver1->init_block_archive());
+    ASSERT_TRUE(archiver1->init_best_block());
+    ASSERT_EQ(archiver1->best_block_height(), 3UL);
+    auto blk = archiver1->get_block(2);
+    ASSERT_TRUE(blk.has_value());
+    ASSERT_EQ(blk.value().m_height, 2UL);
+    ASSERT_EQ(blk.value().m_transactions.size(), 20UL);
+    ASSERT_EQ(blk.value().m_transactions[2].m_id,
+              m_dummy_blocks[1].m_transactions[2].m_id);
+    ASSERT_FALSE(archiver1->get_block(4).has_value());
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/atomizer/atomizer/format.hpp"
+#include "util.hpp"
+#include "util/raft/util.hpp"
+
+#include <filesystem>
+#include <future>
+#include <gtest/gtest.h>
+
+class atomizer_state_machine_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(m_leader_dir);
+        std::filesystem::remove_all(m_follower_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_leader_dir);
+        std::filesystem::remove_all(m_follower_dir);
+    }
+
+    static void commit(cbdc::atomizer::state_machine& sm,
+                       uint64_t log_idx,
+                       const cbdc::atomizer::state_machine::request& req) {
+        auto buf = cbdc::make_buffer<cbdc::atomizer::state_machine::request,
+                                     nuraft::ptr<nuraft::buffer>>(req);
+        [[maybe_unused]] auto res = sm.commit(log_idx, *buf);
+    }
+
+    static auto notify_request(const cbdc::transaction::compact_tx& tx)
+        -> cbdc::atomizer::state_machine::request {
+        auto req = cbdc::atomizer::aggregate_tx_notify_request{};
+        req.m_agg_txs.push_back({tx, 0});
+        return req;
+    }
+
+    cbdc::transaction::compact_tx m_tx0{
+        cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}})};
+    cbdc::transaction::compact_tx m_tx1{
+        cbdc::test::simple_tx({'d'}, {{'e'}}, {{'f'}})};
+
+    static constexpr auto m_leader_dir = "atomizer_sm_test_leader";
+    static constexpr auto m_follower_dir = "atomizer_sm_test_follower";
+    static constexpr size_t m_stxo_cache_depth = 2;
+    /// Small enough that a snapshot spans several chunks.
+    static constexpr size_t m_chunk_size = 16;
+};
+
+TEST_F(atomizer_state_machine_test, snapshot_transfer) {
+    auto leader = cbdc::atomizer::state_machine(m_stxo_cache_depth,
+                                                m_leader_dir,
+                                                m_chunk_size);
+    commit(leader, 1, notify_request(m_tx0));
+    commit(leader, 2, cbdc::atomizer::make_block_request{});
+    commit(leader, 3, notify_request(m_tx1));
+
+    auto snp_meta
+        = nuraft::snapshot(3, 1, nuraft::cs_new<nuraft::cluster_config>());
+    auto done = std::promise<bool>();
+    nuraft::async_result<bool>::handler_type when_done
+        = [&](bool& ret, nuraft::ptr<std::exception>& /* err */) {
+              done.set_value(ret);
+          };
+    leader.create_snapshot(snp_meta, when_done);
+    // Commits proceed while the snapshot is written in the background
+    commit(leader, 4, cbdc::atomizer::make_block_request{});
+    ASSERT_TRUE(done.get_future().get());
+
+    auto snp = leader.last_snapshot();
+    ASSERT_TRUE(snp);
+    ASSERT_EQ(snp->get_last_log_idx(), 3UL);
+
+    auto follower = cbdc::atomizer::state_machine(m_stxo_cache_depth,
+                                                  m_follower_dir,
+                                                  m_chunk_size);
+    void* ctx{nullptr};
+    nuraft::ulong obj_id{0};
+    auto is_last = false;
+    auto corrupted = false;
+    size_t chunks{0};
+    while(!is_last) {
+        auto data = nuraft::ptr<nuraft::buffer>();
+        ASSERT_EQ(
+            leader.read_logical_snp_obj(*snp, ctx, obj_id, data, is_last),
+            0);
+        const auto sent_id = obj_id;
+        if(!corrupted && obj_id == 1) {
+            // A corrupted chunk is requested again
+            data->data_begin()[data->size() - 1] ^= 1;
+            corrupted = true;
+            follower
+                .save_logical_snp_obj(*snp, obj_id, *data, false, is_last);
+            ASSERT_EQ(obj_id, sent_id);
+            is_last = false;
+            continue;
+        }
+        follower
+            .save_logical_snp_obj(*snp, obj_id, *data, obj_id == 0, is_last);
+        ASSERT_EQ(obj_id, sent_id + 1);
+        chunks++;
+    }
+    ASSERT_GT(chunks, 2UL);
+
+    ASSERT_TRUE(follower.apply_snapshot(*snp));
+    ASSERT_EQ(follower.last_commit_index(), 3UL);
+    ASSERT_EQ(std::filesystem::file_size(std::filesystem::path(m_leader_dir)
+                                         / "3"),
+              std::filesystem::file_size(std::filesystem::path(m_follower_dir)
+                                         / "3"));
+
+    // The follower continues from the snapshot state
+    auto req = cbdc::make_buffer<cbdc::atomizer::state_machine::request,
+                                 nuraft::ptr<nuraft::buffer>>(
+        cbdc::atomizer::make_block_request{});
+    auto res_buf = follower.commit(4, *req);
+    ASSERT_TRUE(res_buf);
+    auto res = cbdc::from_buffer<cbdc::atomizer::state_machine::response>(
+        *res_buf);
+    ASSERT_TRUE(res.has_value());
+    auto& blk_res = std::get<cbdc::atomizer::make_block_response>(*res);
+    ASSERT_EQ(blk_res.m_blk.m_height, 2UL);
+    ASSERT_EQ(blk_res.m_blk.m_transactions.size(), 1UL);
+    ASSERT_EQ(blk_res.m_blk.m_transactions[0], m_tx1);
+}
+
+TEST_F(atomizer_state_machine_test, block_packets) {
+    auto sm = cbdc::atomizer::state_machine(m_stxo_cache_depth,
+                                            m_leader_dir,
+                                            m_chunk_size);
+    commit(sm, 1, notify_request(m_tx0));
+    auto req = cbdc::make_buffer<cbdc::atomizer::state_machine::request,
+                                 nuraft::ptr<nuraft::buffer>>(
+        cbdc::atomizer::make_block_request{});
+    auto res_buf = sm.commit(2, *req);
+    ASSERT_TRUE(res_buf);
+    auto res = cbdc::from_buffer<cbdc::atomizer::state_machine::response>(
+        *res_buf);
+    ASSERT_TRUE(res.has_value());
+    auto& blk = std::get<cbdc::atomizer::make_block_response>(*res).m_blk;
+    ASSERT_EQ(blk.m_height, 1UL);
+    ASSERT_EQ(blk.m_transactions.size(), 1UL);
+
+    // The block is kept as serialized for the response
+    auto pkt = sm.block_packet(1);
+    ASSERT_TRUE(pkt);
+    ASSERT_EQ(*pkt, cbdc::make_buffer(blk));
+
+    req = cbdc::make_buffer<cbdc::atomizer::state_machine::request,
+                            nuraft::ptr<nuraft::buffer>>(
+        cbdc::atomizer::get_block_request{1});
+    res_buf = sm.commit(3, *req);
+    ASSERT_TRUE(res_buf);
+    res = cbdc::from_buffer<cbdc::atomizer::state_machine::response>(
+        *res_buf);
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(std::get<cbdc::atomizer::get_block_response>(*res).m_blk, blk);
+
+    commit(sm, 4, cbdc::atomizer::prune_request{2});
+    ASSERT_FALSE(sm.block_packet(1));
+}
@@ -4,8 +4,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "uhs/atomizer/atomizer/atomizer.hpp"
+#include "uhs/transaction/messages.hpp"
 #include "util.hpp"
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
 
+#include <cstring>
 #include <gtest/gtest.h>
 
 class atomizer_test : public ::testing::Test {
@@ -150,3 +154,174 @@ TEST_F(atomizer_test, err_incomplete) {
 
     verify_serialization();
 }
+
+TEST_F(atomizer_test, attestations_across_heights) {
+    static constexpr uint32_t n_inputs = 70;
+    auto inputs = std::vector<cbdc::hash_t>();
+    for(uint32_t i{0}; i < n_inputs; i++) {
+        inputs.push_back({static_cast<unsigned char>(i + 1)});
+    }
+    auto tx = cbdc::test::simple_tx({'a'}, inputs, {{'b'}});
+
+    auto first = std::unordered_set<uint32_t>();
+    for(uint32_t i{0}; i < 64; i++) {
+        first.insert(i);
+    }
+    auto err = m_atomizer->insert(0, tx, first);
+    ASSERT_FALSE(err.has_value());
+    auto [blk, errs] = m_atomizer->make_block();
+    ASSERT_TRUE(errs.empty());
+
+    // Indices past the last input do not count towards completion
+    err = m_atomizer->insert(1, tx, {64, 65, 66, 67, 68, n_inputs});
+    ASSERT_FALSE(err.has_value());
+    ASSERT_EQ(m_atomizer->pending_transactions(), 0UL);
+    verify_serialization();
+
+    err = m_atomizer->insert(1, tx, {n_inputs - 1});
+    ASSERT_FALSE(err.has_value());
+    ASSERT_EQ(m_atomizer->pending_transactions(), 1UL);
+    verify_serialization();
+}
+
+TEST_F(atomizer_test, max_block_txs) {
+    auto tx0 = cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}});
+    auto tx1 = cbdc::test::simple_tx({'d'}, {{'e'}}, {{'f'}});
+    auto tx2 = cbdc::test::simple_tx({'g'}, {{'h'}}, {{'i'}});
+    for(const auto& tx : {tx0, tx1, tx2}) {
+        ASSERT_FALSE(m_atomizer->insert(0, tx, {0}).has_value());
+    }
+
+    auto [blk, errs] = m_atomizer->make_block(2);
+    ASSERT_TRUE(errs.empty());
+    ASSERT_EQ(blk.m_transactions.size(), 2UL);
+    ASSERT_EQ(blk.m_transactions[0], tx0);
+    ASSERT_EQ(blk.m_transactions[1], tx1);
+    ASSERT_EQ(m_atomizer->pending_transactions(), 1UL);
+    verify_serialization();
+
+    // Inputs of both the sealed block and the carried transaction remain
+    // spent
+    auto double_spend = cbdc::test::simple_tx({'J'}, {{'b'}, {'h'}}, {{'k'}});
+    auto err = m_atomizer->insert(0, double_spend, {0, 1});
+    auto want = cbdc::watchtower::tx_error{
+        {'J'},
+        cbdc::watchtower::tx_error_inputs_spent{{{'b'}, {'h'}}}};
+    ASSERT_TRUE(err.has_value());
+    ASSERT_EQ(err.value(), want);
+
+    auto [next_blk, next_errs] = m_atomizer->make_block(2);
+    ASSERT_TRUE(next_errs.empty());
+    ASSERT_EQ(next_blk.m_transactions.size(), 1UL);
+    ASSERT_EQ(next_blk.m_transactions[0], tx2);
+    ASSERT_EQ(m_atomizer->pending_transactions(), 0UL);
+
+    err = m_atomizer->insert(0, double_spend, {0, 1});
+    ASSERT_TRUE(err.has_value());
+    ASSERT_EQ(err.value(), want);
+    verify_serialization();
+}
+
+TEST_F(atomizer_test, clone_copy_on_write) {
+    auto tx0 = cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}});
+    auto err = m_atomizer->insert(0, tx0, {0});
+    ASSERT_FALSE(err.has_value());
+
+    auto clone = m_atomizer->clone();
+    ASSERT_EQ(*clone, *m_atomizer);
+    auto clone_ser = clone->serialize();
+
+    // Changes after cloning must not be visible in the clone
+    auto tx1 = cbdc::test::simple_tx({'d'}, {{'e'}}, {{'f'}});
+    err = m_atomizer->insert(0, tx1, {0});
+    ASSERT_FALSE(err.has_value());
+    auto [blk, errs] = m_atomizer->make_block();
+    ASSERT_TRUE(errs.empty());
+    ASSERT_EQ(blk.m_transactions.size(), 2UL);
+
+    ASSERT_FALSE(*clone == *m_atomizer);
+    ASSERT_EQ(clone->serialize(), clone_ser);
+
+    auto [clone_blk, clone_errs] = clone->make_block();
+    ASSERT_TRUE(clone_errs.empty());
+    ASSERT_EQ(clone_blk.m_transactions.size(), 1UL);
+    ASSERT_EQ(clone_blk.m_transactions[0], tx0);
+}
+
+TEST_F(atomizer_test, insert_complete_batch) {
+    auto errs = m_atomizer->make_block().second;
+    ASSERT_TRUE(errs.empty());
+    auto spent = cbdc::test::simple_tx({'a'}, {{'b'}}, {{'c'}});
+    ASSERT_FALSE(m_atomizer->insert_complete(1, std::move(spent)));
+    for(int i{0}; i < 2; i++) {
+        errs = m_atomizer->make_block().second;
+        ASSERT_TRUE(errs.empty());
+    }
+
+    // Large enough to be checked in several chunks, with conflicts against
+    // the spent cache, the stxo range and earlier transactions in the batch
+    auto batch = std::vector<cbdc::atomizer::aggregate_tx_notification>();
+    static constexpr uint16_t n_txs = 2000;
+    for(uint16_t i{0}; i < n_txs; i++) {
+        auto id = cbdc::hash_t{'t'};
+        auto inp = cbdc::hash_t{'i'};
+        std::memcpy(id.data() + 1, &i, sizeof(i));
+        auto inp_idx = static_cast<uint16_t>(i % 3 == 0 ? i - i % 7 : i);
+        std::memcpy(inp.data() + 1, &inp_idx, sizeof(inp_idx));
+        auto ins = std::vector<cbdc::hash_t>{inp};
+        if(i % 101 == 0) {
+            ins.push_back({'b'});
+        }
+        auto height = i % 97 == 0 ? uint64_t{0} : uint64_t{1};
+        batch.push_back({cbdc::test::simple_tx(id, ins, {{'o'}}), height});
+    }
+
+    auto seq_atomizer = m_atomizer->clone();
+    auto want = std::vector<cbdc::watchtower::tx_error>();
+    for(auto msg : batch) {
+        auto err = seq_atomizer->insert_complete(msg.m_oldest_attestation,
+                                                 std::move(msg.m_tx));
+        if(err) {
+            want.push_back(*err);
+        }
+    }
+    ASSERT_FALSE(want.empty());
+
+    auto pool = cbdc::thread_pool(3);
+    auto got = m_atomizer->insert_complete_batch(std::move(batch), &pool);
+    ASSERT_EQ(got, want);
+    ASSERT_EQ(*m_atomizer, *seq_atomizer);
+
+    verify_serialization();
+}
+
+TEST_F(atomizer_test, deserialize_unsorted_spent) {
+    // Spent caches used to be serialized as unordered sets at every height
+    using spent_set = std::unordered_set<cbdc::hash_t, cbdc::hashing::null>;
+    using tx_map = std::unordered_map<cbdc::transaction::compact_tx,
+                                      std::unordered_set<uint32_t>,
+                                      cbdc::transaction::compact_tx_hasher>;
+    auto spent = std::vector<spent_set>(3);
+    for(unsigned char i{0}; i < 100; i++) {
+        spent[1].insert({static_cast<unsigned char>(255 - i)});
+    }
+    spent[2].insert({'x'});
+    auto buf = cbdc::buffer();
+    auto ser = cbdc::buffer_serializer(buf);
+    ser << uint64_t{2} << uint64_t{5}
+        << std::vector<cbdc::transaction::compact_tx>() << spent
+        << std::vector<tx_map>(3);
+
+    auto deser = cbdc::buffer_serializer(buf);
+    m_atomizer->deserialize(deser);
+    ASSERT_EQ(m_atomizer->height(), 5UL);
+
+    auto tx0 = cbdc::test::simple_tx({'a'}, {{200}}, {{'c'}});
+    ASSERT_TRUE(m_atomizer->insert_complete(4, std::move(tx0)).has_value());
+    auto tx1 = cbdc::test::simple_tx({'d'}, {{'x'}}, {{'f'}});
+    ASSERT_TRUE(m_atomizer->insert_complete(3, std::move(tx1)).has_value());
+    auto tx2 = cbdc::test::simple_tx({'g'}, {{'x'}}, {{'h'}});
+    ASSERT_FALSE(m_atomizer->insert_complete(4, std::move(tx2)).has_value());
+
+    verify_serialization();
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/affinity.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+TEST(affinity_test, parse_cpu_list) {
+    using list = std::vector<size_t>;
+    ASSERT_EQ(cbdc::parse_cpu_list(""), list{});
+    ASSERT_EQ(cbdc::parse_cpu_list("3"), list{3});
+    ASSERT_EQ(cbdc::parse_cpu_list("0-3,8,10-11"),
+              (list{0, 1, 2, 3, 8, 10, 11}));
+    // Sorted and de-duplicated
+    ASSERT_EQ(cbdc::parse_cpu_list("5,1-2,2"), (list{1, 2, 5}));
+
+    ASSERT_FALSE(cbdc::parse_cpu_list("3-1").has_value());
+    ASSERT_FALSE(cbdc::parse_cpu_list("1,,2").has_value());
+    ASSERT_FALSE(cbdc::parse_cpu_list("a").has_value());
+    ASSERT_FALSE(cbdc::parse_cpu_list("1-").has_value());
+    ASSERT_FALSE(cbdc::parse_cpu_list("node").has_value());
+    ASSERT_FALSE(cbdc::parse_cpu_list("node100000").has_value());
+}
+
+#ifdef __linux__
+TEST(affinity_test, pin_current_thread) {
+    auto cpus = std::vector<size_t>();
+    {
+        cpu_set_t set;
+        ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(set), &set),
+                  0);
+        for(size_t i{0}; i < CPU_SETSIZE && cpus.empty(); i++) {
+            if(CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+    ASSERT_FALSE(cpus.empty());
+    cbdc::set_thread_cpus({{cbdc::thread_role::network, cpus}});
+
+    auto pinned = std::vector<size_t>();
+    auto t = std::thread([&]() {
+        // Roles without CPUs are left alone
+        ASSERT_TRUE(cbdc::pin_current_thread(cbdc::thread_role::raft));
+        ASSERT_TRUE(cbdc::pin_current_thread(cbdc::thread_role::network));
+        cpu_set_t set;
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+        for(size_t i{0}; i < CPU_SETSIZE; i++) {
+            if(CPU_ISSET(i, &set)) {
+                pinned.push_back(i);
+            }
+        }
+    });
+    t.join();
+    cbdc::set_thread_cpus({});
+    ASSERT_EQ(pinned, cpus);
+}
+#endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/bloom_filter.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace {
+    // Deterministic stand-in for a cryptographic hash of n.
+    auto make_hash(uint64_t n) -> cbdc::hash_t {
+        auto gen = std::mt19937_64(n);
+        auto ret = cbdc::hash_t();
+        for(size_t i{0}; i < ret.size(); i += sizeof(uint64_t)) {
+            const auto word = gen();
+            std::memcpy(&ret[i], &word, sizeof(word));
+        }
+        return ret;
+    }
+}
+
+TEST(bloom_filter_test, sizing) {
+    auto filter = cbdc::bloom_filter(1000, 0.01);
+    // About 9.6 bits per item and 7 probes for a 1% false positive rate.
+    ASSERT_GE(filter.bits(), 9585UL);
+    ASSERT_EQ(filter.bits() % 64, 0UL);
+    ASSERT_EQ(filter.probes(), 7UL);
+}
+
+TEST(bloom_filter_test, no_false_negatives) {
+    static constexpr uint64_t items = 10000;
+    auto filter = cbdc::bloom_filter(items, 0.01);
+    for(uint64_t i{0}; i < items; i++) {
+        filter.add(make_hash(i));
+    }
+    for(uint64_t i{0}; i < items; i++) {
+        ASSERT_TRUE(filter.possibly_contains(make_hash(i)));
+    }
+}
+
+TEST(bloom_filter_test, false_positive_rate) {
+    static constexpr uint64_t items = 10000;
+    auto filter = cbdc::bloom_filter(items, 0.01);
+    for(uint64_t i{0}; i < items; i++) {
+        filter.add(make_hash(i));
+    }
+    size_t positives{0};
+    for(uint64_t i{items}; i < 2 * items; i++) {
+        if(filter.possibly_contains(make_hash(i))) {
+            positives++;
+        }
+    }
+    // Well above the expected 100 so the test is not flaky.
+    ASSERT_LT(positives, 250UL);
+}
+
+TEST(bloom_filter_test, empty) {
+    auto filter = cbdc::bloom_filter(0, 0.01);
+    ASSERT_FALSE(filter.possibly_contains(make_hash(0)));
+    filter.add(make_hash(0));
+    ASSERT_TRUE(filter.possibly_contains(make_hash(0)));
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/buffer_pool.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(buffer_pool_test, reuses_released_buffers) {
+    auto pool = cbdc::buffer_pool(4);
+    ASSERT_EQ(pool.free_count(), 0UL);
+
+    auto buf = pool.acquire(100);
+    ASSERT_GE(buf->capacity(), 100UL);
+    ASSERT_EQ(buf->size(), 0UL);
+    buf->extend(100);
+    const auto* data = buf->data();
+    buf.reset();
+    ASSERT_EQ(pool.free_count(), 1UL);
+
+    // The same storage comes back, emptied
+    buf = pool.acquire();
+    ASSERT_EQ(pool.free_count(), 0UL);
+    ASSERT_EQ(buf->size(), 0UL);
+    buf->extend(10);
+    ASSERT_EQ(buf->data(), data);
+
+    // A larger request skips smaller free buffers
+    auto small = std::move(buf);
+    small.reset();
+    auto large = pool.acquire(cbdc::buffer_pool::min_class_size * 4);
+    ASSERT_GE(large->capacity(), cbdc::buffer_pool::min_class_size * 4);
+    ASSERT_EQ(pool.free_count(), 1UL);
+}
+
+TEST(buffer_pool_test, weak_references_hold_entry) {
+    auto pool = cbdc::buffer_pool(4);
+    auto buf = pool.acquire();
+    auto weak = std::weak_ptr<cbdc::buffer>(buf);
+    buf.reset();
+    ASSERT_TRUE(weak.expired());
+    ASSERT_EQ(pool.free_count(), 0UL);
+    weak.reset();
+    ASSERT_EQ(pool.free_count(), 1UL);
+}
+
+TEST(buffer_pool_test, wrap_and_limits) {
+    auto pool = cbdc::buffer_pool(1);
+    auto src = cbdc::buffer();
+    src.append("abc", 3);
+    auto expected = src;
+    auto wrapped = pool.wrap(std::move(src));
+    ASSERT_EQ(*wrapped, expected);
+
+    // Only one free buffer is kept per size class
+    auto other = pool.acquire();
+    wrapped.reset();
+    other.reset();
+    ASSERT_EQ(pool.free_count(), 1UL);
+
+    // Oversized buffers are freed rather than kept
+    auto huge = pool.acquire(cbdc::buffer_pool::max_buffer_size + 1);
+    huge.reset();
+    ASSERT_EQ(pool.free_count(), 1UL);
+}
+
+TEST(buffer_pool_test, release_on_other_thread) {
+    auto pool = cbdc::buffer_pool();
+    constexpr size_t n = 64;
+    auto bufs = std::vector<std::shared_ptr<cbdc::buffer>>();
+    for(size_t i = 0; i < n; i++) {
+        bufs.push_back(pool.acquire(i));
+    }
+    auto t = std::thread([&]() {
+        bufs.clear();
+    });
+    t.join();
+    ASSERT_EQ(pool.free_count(), n);
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/cache_set.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Sends every value to the same slot, to exercise probing
+    struct collide_hash {
+        auto operator()(uint64_t /* v */) const -> size_t {
+            return 0;
+        }
+    };
+}
+
+TEST(cache_set_test, evicts_oldest) {
+    auto set = cbdc::cache_set<uint64_t>(4);
+    for(uint64_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(set.add(i));
+    }
+    ASSERT_FALSE(set.add(uint64_t{2}));
+    ASSERT_EQ(set.size(), 4UL);
+    ASSERT_GE(set.memory_usage(), 4 * 3 * sizeof(uint64_t));
+    for(uint64_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(set.contains(i));
+    }
+
+    ASSERT_TRUE(set.add(uint64_t{4}));
+    ASSERT_FALSE(set.contains(0));
+    for(uint64_t i = 1; i < 5; i++) {
+        ASSERT_TRUE(set.contains(i));
+    }
+}
+
+TEST(cache_set_test, eviction_keeps_probe_chains) {
+    auto set = cbdc::cache_set<uint64_t, collide_hash>(8);
+    for(uint64_t i = 0; i < 100; i++) {
+        ASSERT_TRUE(set.add(i));
+        for(uint64_t j = 0; j <= i; j++) {
+            ASSERT_EQ(set.contains(j), j + 8 > i);
+        }
+    }
+}
+
+TEST(cache_set_test, striped_concurrent_adds) {
+    static constexpr uint64_t n_threads = 4;
+    static constexpr uint64_t n_vals = 10000;
+    auto set = cbdc::cache_set<uint64_t>(n_threads * n_vals);
+    auto threads = std::vector<std::thread>();
+    for(uint64_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for(uint64_t i = 0; i < n_vals; i++) {
+                ASSERT_TRUE(set.add(t * n_vals + i));
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+
+    // Each stripe holds its share of the values, so a full set of
+    // uniformly hashed values is mostly retained
+    size_t found = 0;
+    for(uint64_t i = 0; i < n_threads * n_vals; i++) {
+        if(set.contains(i)) {
+            found++;
+        }
+    }
+    ASSERT_GT(found, n_threads * n_vals * 9 / 10);
+}
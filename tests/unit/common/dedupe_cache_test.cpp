@@ -0,0 +1,84 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/dedupe_cache.hpp"
+
+#include <gtest/gtest.h>
+
+using status = cbdc::dedupe_cache<int>::status;
+
+TEST(dedupe_cache_test, duplicates_share_result) {
+    auto cache = cbdc::dedupe_cache<int>(2);
+    auto id = cbdc::hash_t{1};
+    auto results = std::vector<std::optional<int>>();
+    auto cb = cbdc::dedupe_cache<int>::callback_type(
+        [&](std::optional<int> res) {
+            results.push_back(res);
+        });
+
+    auto first = cb;
+    ASSERT_EQ(cache.submit(id, first), status::first);
+    auto dup = cb;
+    ASSERT_EQ(cache.submit(id, dup), status::attached);
+    ASSERT_TRUE(results.empty());
+
+    cache.finish(id, 5);
+    ASSERT_EQ(results, (std::vector<std::optional<int>>{5}));
+
+    auto late = cb;
+    ASSERT_EQ(cache.submit(id, late), status::cached);
+    ASSERT_EQ(results, (std::vector<std::optional<int>>{5, 5}));
+}
+
+TEST(dedupe_cache_test, unknown_result_not_kept) {
+    auto cache = cbdc::dedupe_cache<int>(2);
+    auto id = cbdc::hash_t{1};
+    auto results = std::vector<std::optional<int>>();
+    auto cb = cbdc::dedupe_cache<int>::callback_type(
+        [&](std::optional<int> res) {
+            results.push_back(res);
+        });
+
+    auto first = cb;
+    ASSERT_EQ(cache.submit(id, first), status::first);
+    auto dup = cb;
+    ASSERT_EQ(cache.submit(id, dup), status::attached);
+    cache.finish(id, std::nullopt);
+    ASSERT_EQ(results, (std::vector<std::optional<int>>{std::nullopt}));
+
+    // The retry is processed again
+    auto retry = cb;
+    ASSERT_EQ(cache.submit(id, retry), status::first);
+}
+
+TEST(dedupe_cache_test, evicts_oldest_result) {
+    auto cache = cbdc::dedupe_cache<int>(2);
+    for(uint8_t i{0}; i < 3; i++) {
+        auto cb = cbdc::dedupe_cache<int>::callback_type();
+        ASSERT_EQ(cache.submit(cbdc::hash_t{i}, cb), status::first);
+        cache.finish(cbdc::hash_t{i}, i);
+    }
+    auto cb = cbdc::dedupe_cache<int>::callback_type([](auto) {});
+    ASSERT_EQ(cache.submit(cbdc::hash_t{0}, cb), status::first);
+    cb = [](auto) {};
+    ASSERT_EQ(cache.submit(cbdc::hash_t{2}, cb), status::cached);
+}
+
+TEST(dedupe_cache_test, claim_and_find) {
+    auto cache = cbdc::dedupe_cache<int>(2);
+    auto id = cbdc::hash_t{1};
+    ASSERT_FALSE(cache.find(id).has_value());
+    ASSERT_FALSE(cache.claim(id).has_value());
+
+    // Processing, so known without a result
+    auto claimed = cache.claim(id);
+    ASSERT_TRUE(claimed.has_value());
+    ASSERT_FALSE(claimed->has_value());
+    ASSERT_EQ(cache.find(id), claimed);
+
+    cache.finish(id, 3);
+    ASSERT_EQ(cache.find(id), std::optional<std::optional<int>>(3));
+    ASSERT_EQ(cache.claim(id), std::optional<std::optional<int>>(3));
+}
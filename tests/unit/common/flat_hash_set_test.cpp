@@ -0,0 +1,115 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/flat_hash_set.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <unordered_set>
+
+namespace {
+    auto make_hash(uint64_t n) -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        std::memcpy(ret.data(), &n, sizeof(n));
+        return ret;
+    }
+}
+
+TEST(flat_hash_set_test, insert_find_erase) {
+    auto set = cbdc::flat_hash_set();
+    ASSERT_TRUE(set.empty());
+    ASSERT_FALSE(set.contains(make_hash(1)));
+    ASSERT_FALSE(set.erase(make_hash(1)));
+
+    ASSERT_TRUE(set.insert(make_hash(1)));
+    ASSERT_FALSE(set.insert(make_hash(1)));
+    ASSERT_TRUE(set.insert(make_hash(2)));
+    ASSERT_EQ(set.size(), 2UL);
+    ASSERT_TRUE(set.contains(make_hash(1)));
+    ASSERT_TRUE(set.contains(make_hash(2)));
+
+    ASSERT_TRUE(set.erase(make_hash(1)));
+    ASSERT_FALSE(set.erase(make_hash(1)));
+    ASSERT_FALSE(set.contains(make_hash(1)));
+    ASSERT_TRUE(set.contains(make_hash(2)));
+    ASSERT_EQ(set.size(), 1UL);
+}
+
+TEST(flat_hash_set_test, grows) {
+    static constexpr uint64_t count = 100000;
+    auto set = cbdc::flat_hash_set();
+    for(uint64_t i{0}; i < count; i++) {
+        ASSERT_TRUE(set.insert(make_hash(i)));
+    }
+    ASSERT_EQ(set.size(), count);
+    ASSERT_GE(set.capacity() * 7, count * 8);
+    for(uint64_t i{0}; i < count; i++) {
+        ASSERT_TRUE(set.contains(make_hash(i)));
+    }
+    ASSERT_FALSE(set.contains(make_hash(count)));
+}
+
+TEST(flat_hash_set_test, churn_matches_unordered_set) {
+    // Repeated inserts and erases exercise tombstone reuse and in-place
+    // rehashing without growing the table.
+    auto set = cbdc::flat_hash_set(1000);
+    auto ref = std::unordered_set<uint64_t>();
+    const auto cap = set.capacity();
+    for(uint64_t i{0}; i < 200000; i++) {
+        const auto key = (i * 7919) % 5000;
+        if(i % 3 == 0) {
+            ASSERT_EQ(set.erase(make_hash(key)), ref.erase(key) == 1);
+        } else if(ref.size() < 1000) {
+            ASSERT_EQ(set.insert(make_hash(key)), ref.insert(key).second);
+        }
+    }
+    ASSERT_EQ(set.size(), ref.size());
+    ASSERT_EQ(set.capacity(), cap);
+    for(uint64_t key{0}; key < 5000; key++) {
+        ASSERT_EQ(set.contains(make_hash(key)), ref.count(key) == 1);
+    }
+}
+
+TEST(flat_hash_set_test, iterates_and_clears) {
+    auto set = cbdc::flat_hash_set();
+    for(uint64_t i{0}; i < 100; i++) {
+        set.insert(make_hash(i));
+    }
+    set.erase(make_hash(50));
+    auto seen = std::unordered_set<uint64_t>();
+    for(const auto& key : set) {
+        uint64_t n{};
+        std::memcpy(&n, key.data(), sizeof(n));
+        seen.insert(n);
+    }
+    ASSERT_EQ(seen.size(), 99UL);
+    ASSERT_EQ(seen.count(50), 0UL);
+
+    const auto cap = set.capacity();
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(set.begin(), set.end());
+    ASSERT_EQ(set.capacity(), cap);
+    ASSERT_FALSE(set.contains(make_hash(1)));
+}
+
+TEST(flat_hash_set_test, shared_prefix) {
+    // Keys of one shard share their routing prefix and differ only later
+    auto set = cbdc::flat_hash_set();
+    auto make_key = [](uint64_t n) {
+        auto ret = cbdc::hash_t();
+        ret.fill(0xab);
+        std::memcpy(&ret[ret.size() - sizeof(n)], &n, sizeof(n));
+        return ret;
+    };
+    for(uint64_t i{0}; i < 10000; i++) {
+        ASSERT_TRUE(set.insert(make_key(i)));
+    }
+    ASSERT_EQ(set.size(), 10000UL);
+    for(uint64_t i{0}; i < 10000; i++) {
+        ASSERT_TRUE(set.contains(make_key(i)));
+    }
+    ASSERT_FALSE(set.contains(make_key(10000)));
+}
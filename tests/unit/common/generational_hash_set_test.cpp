@@ -0,0 +1,70 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/generational_hash_set.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+namespace {
+    auto make_hash(uint64_t n) -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        std::memcpy(&ret[ret.size() - sizeof(n)], &n, sizeof(n));
+        ret[0] = static_cast<unsigned char>(n * 37);
+        return ret;
+    }
+}
+
+TEST(generational_hash_set_test, retains_recent_generations) {
+    auto set = cbdc::generational_hash_set(10, 2);
+    for(uint64_t i{0}; i < 35; i++) {
+        set.insert(make_hash(i));
+    }
+    // Generations [10, 20) and [20, 30) are sealed, [30, 35) is current
+    // and [0, 10) has been dropped.
+    ASSERT_EQ(set.sealed_generations(), 2UL);
+    ASSERT_EQ(set.size(), 25UL);
+    for(uint64_t i{0}; i < 10; i++) {
+        ASSERT_FALSE(set.contains(make_hash(i)));
+    }
+    for(uint64_t i{10}; i < 35; i++) {
+        ASSERT_TRUE(set.contains(make_hash(i)));
+    }
+}
+
+TEST(generational_hash_set_test, erase_current_only) {
+    auto set = cbdc::generational_hash_set(4, 1);
+    for(uint64_t i{0}; i < 6; i++) {
+        set.insert(make_hash(i));
+    }
+    ASSERT_TRUE(set.erase(make_hash(5)));
+    ASSERT_FALSE(set.contains(make_hash(5)));
+    ASSERT_FALSE(set.erase(make_hash(5)));
+    // Sealed keys stay until their generation is dropped.
+    ASSERT_FALSE(set.erase(make_hash(1)));
+    ASSERT_TRUE(set.contains(make_hash(1)));
+    ASSERT_EQ(set.size(), 5UL);
+}
+
+TEST(generational_hash_set_test, erased_keys_do_not_seal) {
+    auto set = cbdc::generational_hash_set(3, 4);
+    for(uint64_t i{0}; i < 3; i++) {
+        set.insert(make_hash(i));
+        ASSERT_TRUE(set.erase(make_hash(i)));
+    }
+    set.insert(make_hash(3));
+    ASSERT_EQ(set.sealed_generations(), 0UL);
+    ASSERT_EQ(set.size(), 1UL);
+}
+
+TEST(generational_hash_set_test, no_sealed_generations) {
+    auto set = cbdc::generational_hash_set(2, 0);
+    set.insert(make_hash(0));
+    set.insert(make_hash(1));
+    set.insert(make_hash(2));
+    ASSERT_FALSE(set.contains(make_hash(0)));
+    ASSERT_TRUE(set.contains(make_hash(2)));
+    ASSERT_EQ(set.size(), 1UL);
+}
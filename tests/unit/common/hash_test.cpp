@@ -3,7 +3,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/sha256.h"
 #include "util/common/hash.hpp"
+#include "util/common/hashmap.hpp"
 
 #include <gtest/gtest.h>
 
@@ -23,3 +25,74 @@ TEST_F(hash_test, hash_from_hex) {
     auto act_val = cbdc::hash_from_hex(m_str);
     EXPECT_EQ(m_hash, act_val);
 }
+
+TEST_F(hash_test, hash_data_batch) {
+    // Message lengths around the one- and two-block padding boundaries.
+    for(size_t len : {0, 1, 55, 56, 64, 80, 120}) {
+        for(size_t count = 0; count <= 17; count++) {
+            auto data = std::vector<unsigned char>(len * count);
+            for(size_t i{0}; i < data.size(); i++) {
+                data[i] = static_cast<unsigned char>(i * 31 + len);
+            }
+            auto out = std::vector<cbdc::hash_t>(count);
+            cbdc::hash_data_batch(data.data(), len, count, out.data());
+            for(size_t i{0}; i < count; i++) {
+                auto expected = cbdc::hash_data(
+                    reinterpret_cast<const std::byte*>(&data[i * len]),
+                    len);
+                ASSERT_EQ(out[i], expected);
+            }
+        }
+    }
+}
+
+TEST_F(hash_test, hash_data_batch_shani) {
+    if(SHA256AutoDetect().find("shani") == std::string::npos) {
+        GTEST_SKIP() << "SHA-NI is not available";
+    }
+    // The single-message path now runs the SHA-NI kernel, and the lanes
+    // path the portable scalar compression function.
+    for(size_t len : {0, 1, 55, 56, 63, 64, 65, 80, 119, 120, 128}) {
+        for(size_t count = 0; count <= 17; count++) {
+            auto data = std::vector<unsigned char>(len * count);
+            for(size_t i{0}; i < data.size(); i++) {
+                data[i] = static_cast<unsigned char>(i * 131 + len);
+            }
+            auto shani = std::vector<cbdc::hash_t>(count);
+            cbdc::hash_data_batch(data.data(),
+                                  len,
+                                  count,
+                                  shani.data(),
+                                  cbdc::hash_batch_kernel::single);
+            auto scalar = std::vector<cbdc::hash_t>(count);
+            cbdc::hash_data_batch(data.data(),
+                                  len,
+                                  count,
+                                  scalar.data(),
+                                  cbdc::hash_batch_kernel::lanes);
+            ASSERT_EQ(shani, scalar);
+        }
+    }
+}
+
+TEST_F(hash_test, sip_hash_buffer) {
+    // Hashing a buffer matches hashing the same bytes as a fixed-size type
+    auto buf = cbdc::buffer();
+    buf.append(m_hash.data(), m_hash.size());
+    auto buf_hash = cbdc::hashing::const_sip_hash<cbdc::buffer>()(buf);
+    auto arr_hash = cbdc::hashing::const_sip_hash<cbdc::hash_t>()(m_hash);
+    ASSERT_EQ(buf_hash, arr_hash);
+}
+
+TEST_F(hash_test, keyed_mix) {
+    auto hasher = cbdc::hashing::keyed_mix();
+    ASSERT_EQ(hasher(m_hash), hasher(m_hash));
+
+    // Flipping any byte changes the result
+    auto base = hasher(m_hash);
+    for(size_t i{0}; i < m_hash.size(); i++) {
+        auto h = m_hash;
+        h[i] ^= 1;
+        ASSERT_NE(hasher(h), base);
+    }
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/buffer.hpp"
+#include "util/common/hex.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    auto reference_hex(const std::vector<unsigned char>& data, bool upper)
+        -> std::string {
+        const auto* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        auto ret = std::string();
+        for(auto byte : data) {
+            ret.push_back(digits[byte >> 4]);
+            ret.push_back(digits[byte & 0xf]);
+        }
+        return ret;
+    }
+}
+
+TEST(hex_test, round_trip) {
+    // Lengths around the 16- and 32-byte vector blocks
+    for(size_t len{0}; len <= 100; len++) {
+        auto data = std::vector<unsigned char>(len);
+        for(size_t i{0}; i < len; i++) {
+            data[i] = static_cast<unsigned char>(i * 37 + len);
+        }
+        for(auto upper : {false, true}) {
+            auto hex = std::string(len * 2, '\0');
+            cbdc::hex_encode(data.data(), len, hex.data(), upper);
+            ASSERT_EQ(hex, reference_hex(data, upper));
+
+            auto decoded = std::vector<unsigned char>(len);
+            ASSERT_TRUE(cbdc::hex_decode(hex.data(), len, decoded.data()));
+            ASSERT_EQ(decoded, data);
+        }
+    }
+}
+
+TEST(hex_test, all_byte_values) {
+    auto data = std::vector<unsigned char>(256);
+    for(size_t i{0}; i < data.size(); i++) {
+        data[i] = static_cast<unsigned char>(i);
+    }
+    auto hex = std::string(data.size() * 2, '\0');
+    cbdc::hex_encode(data.data(), data.size(), hex.data());
+    ASSERT_EQ(hex, reference_hex(data, false));
+}
+
+TEST(hex_test, rejects_non_digits) {
+    constexpr size_t len = 40;
+    auto hex = std::string(len * 2, 'a');
+    auto out = std::vector<unsigned char>(len);
+    for(auto bad : {'g', 'G', '/', ':', '@', '`', ' ', '\0', '\xc1'}) {
+        for(size_t pos{0}; pos < hex.size(); pos++) {
+            auto str = hex;
+            str[pos] = bad;
+            ASSERT_FALSE(cbdc::hex_decode(str.data(), len, out.data()));
+        }
+    }
+}
+
+TEST(hex_test, buffer_to_hex_into) {
+    auto buf = cbdc::buffer::from_hex("00FFaB10").value();
+    auto out = std::string(buf.size() * 2 + 1, '*');
+    buf.to_hex_into(out.data());
+    ASSERT_EQ(out, "00ffab10*");
+    ASSERT_EQ(buf.to_hex_prefixed(), "0x00ffab10");
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/flat_hash_set.hpp"
+#include "util/common/huge_pages.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+class huge_pages_test : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        cbdc::set_huge_pages(false);
+    }
+};
+
+TEST_F(huge_pages_test, aligns_large_arrays) {
+    cbdc::set_huge_pages(true);
+    ASSERT_TRUE(cbdc::huge_pages_enabled());
+    auto big = std::vector<uint64_t, cbdc::huge_page_allocator<uint64_t>>(
+        cbdc::huge_page_size);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(big.data()) % cbdc::huge_page_size,
+              0UL);
+    big.back() = 1;
+    ASSERT_EQ(big.front(), 0UL);
+
+    auto small = std::vector<uint64_t, cbdc::huge_page_allocator<uint64_t>>(
+        16,
+        2);
+    ASSERT_EQ(small.back(), 2UL);
+}
+
+TEST_F(huge_pages_test, set_memory_usage) {
+    cbdc::set_huge_pages(true);
+    auto set = cbdc::flat_hash_set();
+    ASSERT_EQ(set.memory_usage(), 0UL);
+    for(uint64_t i{0}; i < 100000; i++) {
+        auto key = cbdc::hash_t();
+        std::memcpy(key.data(), &i, sizeof(i));
+        set.insert(key);
+    }
+    ASSERT_EQ(set.size(), 100000UL);
+    ASSERT_GE(set.memory_usage(),
+              set.capacity() * (sizeof(cbdc::hash_t) + 1));
+}
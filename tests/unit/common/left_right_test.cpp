@@ -0,0 +1,67 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/left_right.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(left_right_test, write_updates_both_copies) {
+    auto lr = cbdc::left_right<std::vector<int>>(size_t{2}, 7);
+    auto before = lr.read();
+    ASSERT_EQ(before->size(), 2UL);
+
+    auto released = std::thread([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // The pinned copy is unchanged until it is released
+        ASSERT_EQ(before->size(), 2UL);
+        before.reset();
+    });
+    size_t applied{0};
+    lr.write([&](std::vector<int>& v) {
+        v.push_back(8);
+        applied++;
+    });
+    released.join();
+    ASSERT_EQ(applied, 2UL);
+
+    lr.write([](std::vector<int>& v) {
+        v.push_back(9);
+    });
+    auto expected = std::vector<int>{7, 7, 8, 9};
+    ASSERT_EQ(*lr.read(), expected);
+    lr.write([](std::vector<int>& v) {
+        v.pop_back();
+    });
+    expected.pop_back();
+    ASSERT_EQ(*lr.read(), expected);
+}
+
+TEST(left_right_test, concurrent_readers) {
+    auto lr = cbdc::left_right<std::vector<int>>();
+    auto done = std::atomic<bool>(false);
+    auto readers = std::vector<std::thread>();
+    for(size_t i{0}; i < 4; i++) {
+        readers.emplace_back([&]() {
+            while(!done) {
+                auto v = lr.read();
+                for(size_t j{0}; j < v->size(); j++) {
+                    ASSERT_EQ((*v)[j], static_cast<int>(j));
+                }
+            }
+        });
+    }
+    for(int i{0}; i < 1000; i++) {
+        lr.write([&](std::vector<int>& v) {
+            v.push_back(i);
+        });
+    }
+    done = true;
+    for(auto& t : readers) {
+        t.join();
+    }
+    ASSERT_EQ(lr.read()->size(), 1000UL);
+}
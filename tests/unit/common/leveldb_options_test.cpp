@@ -0,0 +1,73 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/leveldb_options.hpp"
+
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <leveldb/db.h>
+
+namespace {
+    constexpr auto db_dir = "leveldb_options_test_db";
+}
+
+class leveldb_options_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(db_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(db_dir);
+    }
+};
+
+TEST_F(leveldb_options_test, applies_profile) {
+    auto profile = cbdc::config::leveldb_profile{1024 * 1024,
+                                                 2 * 1024 * 1024,
+                                                 10,
+                                                 false};
+    auto opts = cbdc::leveldb_options(profile);
+    auto opt = opts.get();
+    ASSERT_TRUE(opt.create_if_missing);
+    ASSERT_EQ(opt.write_buffer_size, profile.m_write_buffer_bytes);
+    ASSERT_EQ(opt.compression, leveldb::kNoCompression);
+    ASSERT_NE(opt.block_cache, nullptr);
+    ASSERT_NE(opt.filter_policy, nullptr);
+    ASSERT_EQ(opts.get().block_cache, opt.block_cache);
+}
+
+TEST_F(leveldb_options_test, zero_disables_filter_and_cache) {
+    auto profile = cbdc::config::leveldb_profile{0, 4096, 0, true};
+    auto opt = cbdc::leveldb_options(profile).get();
+    ASSERT_EQ(opt.block_cache, nullptr);
+    ASSERT_EQ(opt.filter_policy, nullptr);
+    ASSERT_EQ(opt.compression, leveldb::kSnappyCompression);
+}
+
+TEST_F(leveldb_options_test, lookups_after_compaction) {
+    auto opts = cbdc::leveldb_options();
+    leveldb::DB* db_ptr{};
+    ASSERT_TRUE(leveldb::DB::Open(opts.get(), db_dir, &db_ptr).ok());
+    auto db = std::unique_ptr<leveldb::DB>(db_ptr);
+    for(int i = 0; i < 1000; i += 2) {
+        ASSERT_TRUE(db->Put(leveldb::WriteOptions(),
+                            std::to_string(i),
+                            std::to_string(i))
+                        .ok());
+    }
+    db->CompactRange(nullptr, nullptr);
+
+    auto val = std::string();
+    for(int i = 0; i < 1000; i++) {
+        auto res = db->Get(leveldb::ReadOptions(), std::to_string(i), &val);
+        if(i % 2 == 0) {
+            ASSERT_TRUE(res.ok());
+            ASSERT_EQ(val, std::to_string(i));
+        } else {
+            ASSERT_TRUE(res.IsNotFound());
+        }
+    }
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/logging.hpp"
+
+#include <algorithm>
+#include <future>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+namespace {
+    // Blocks the formatting thread until released
+    struct gate {
+        std::shared_future<void> m_open;
+    };
+
+    auto operator<<(std::ostream& os, const gate& g) -> std::ostream& {
+        g.m_open.wait();
+        return os << "gate";
+    }
+
+    struct move_only {
+        move_only() = default;
+        move_only(const move_only&) = delete;
+        move_only(move_only&&) = default;
+        auto operator=(const move_only&) -> move_only& = delete;
+        auto operator=(move_only&&) -> move_only& = default;
+        ~move_only() = default;
+    };
+
+    auto operator<<(std::ostream& os, const move_only& /* m */)
+        -> std::ostream& {
+        return os << "move_only";
+    }
+
+    auto count_lines(const std::string& str) -> size_t {
+        return static_cast<size_t>(
+            std::count(str.begin(), str.end(), '\n'));
+    }
+}
+
+class logging_test : public ::testing::Test {
+  protected:
+    std::stringbuf m_buf;
+
+    auto make_log() -> std::unique_ptr<cbdc::logging::log> {
+        return std::make_unique<cbdc::logging::log>(
+            cbdc::logging::log_level::trace,
+            false,
+            std::make_unique<std::ostream>(&m_buf));
+    }
+};
+
+TEST_F(logging_test, async_preserves_order_and_copies_strings) {
+    auto log = make_log();
+    log->enable_async(8);
+    static constexpr auto n_statements = 100;
+    for(int i = 0; i < n_statements; i++) {
+        char msg[] = "message";
+        log->info(msg, std::to_string(i));
+        // The statement must not observe later changes to the buffer
+        msg[0] = 'X';
+    }
+    log.reset();
+
+    auto out = m_buf.str();
+    ASSERT_EQ(count_lines(out), n_statements);
+    ASSERT_EQ(out.find("Xessage"), std::string::npos);
+    auto pos = size_t();
+    for(int i = 0; i < n_statements; i++) {
+        auto expected = "[INFO ] message " + std::to_string(i) + "\n";
+        auto found = out.find(expected, pos);
+        ASSERT_NE(found, std::string::npos);
+        pos = found + expected.size();
+    }
+}
+
+TEST_F(logging_test, async_formats_non_copyable_eagerly) {
+    auto log = make_log();
+    log->enable_async(4);
+    log->warn("value:", move_only());
+    log.reset();
+    ASSERT_NE(m_buf.str().find("[WARN ] value: move_only\n"),
+              std::string::npos);
+}
+
+TEST_F(logging_test, async_drop_policy_reports_dropped) {
+    auto log = make_log();
+    log->enable_async(2, cbdc::logging::overflow_policy::drop);
+    auto open = std::promise<void>();
+    log->info(gate{open.get_future().share()});
+    static constexpr auto n_statements = 16;
+    for(int i = 0; i < n_statements; i++) {
+        log->info(i);
+    }
+    open.set_value();
+    log.reset();
+
+    auto out = m_buf.str();
+    ASSERT_NE(out.find("[INFO ] gate\n"), std::string::npos);
+    ASSERT_NE(out.find("[WARN ] Dropped "), std::string::npos);
+    // The gate, at most a full buffer and the drop report
+    ASSERT_LE(count_lines(out), 2U + 3U);
+}
+
+TEST_F(logging_test, async_respects_level) {
+    auto log = std::make_unique<cbdc::logging::log>(
+        cbdc::logging::log_level::warn,
+        false,
+        std::make_unique<std::ostream>(&m_buf));
+    log->enable_async(4);
+    log->info("hidden");
+    log->error("shown");
+    log.reset();
+    ASSERT_EQ(m_buf.str().find("hidden"), std::string::npos);
+    ASSERT_NE(m_buf.str().find("[ERROR] shown\n"), std::string::npos);
+}
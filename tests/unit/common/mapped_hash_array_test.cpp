@@ -0,0 +1,78 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/mapped_hash_array.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+class mapped_hash_array_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        for(size_t i{0}; i < m_hashes.size(); i++) {
+            std::memcpy(m_hashes[i].data(), &i, sizeof(i));
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(m_path);
+    }
+
+    void write_hashes(std::ofstream& out, size_t count) {
+        out.write(reinterpret_cast<const char*>(m_hashes.data()),
+                  static_cast<std::streamsize>(count * cbdc::hash_size));
+    }
+
+    static constexpr auto m_path = "mapped_hash_array_test.dat";
+    std::array<cbdc::hash_t, 100> m_hashes{};
+};
+
+TEST_F(mapped_hash_array_test, read_with_header) {
+    {
+        auto out = std::ofstream(m_path, std::ios::binary);
+        ASSERT_TRUE(
+            cbdc::mapped_hash_array::write_header(out, m_hashes.size()));
+        write_hashes(out, m_hashes.size());
+    }
+    auto file = cbdc::mapped_hash_array(m_path);
+    ASSERT_TRUE(file.open());
+    ASSERT_EQ(file.size(), m_hashes.size());
+    for(size_t i{0}; i < m_hashes.size(); i++) {
+        ASSERT_EQ(file.data()[i], m_hashes[i]);
+    }
+}
+
+TEST_F(mapped_hash_array_test, read_legacy_layout) {
+    {
+        auto out = std::ofstream(m_path, std::ios::binary);
+        const uint64_t count = m_hashes.size();
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        write_hashes(out, m_hashes.size());
+    }
+    auto file = cbdc::mapped_hash_array(m_path);
+    ASSERT_TRUE(file.open());
+    ASSERT_EQ(file.size(), m_hashes.size());
+    ASSERT_EQ(file.data()[m_hashes.size() - 1], m_hashes.back());
+}
+
+TEST_F(mapped_hash_array_test, reject_truncated) {
+    {
+        auto out = std::ofstream(m_path, std::ios::binary);
+        ASSERT_TRUE(
+            cbdc::mapped_hash_array::write_header(out, m_hashes.size()));
+        write_hashes(out, m_hashes.size() - 1);
+    }
+    auto file = cbdc::mapped_hash_array(m_path);
+    ASSERT_FALSE(file.open());
+    ASSERT_EQ(file.size(), 0UL);
+    ASSERT_EQ(file.data(), nullptr);
+}
+
+TEST_F(mapped_hash_array_test, missing_file) {
+    auto file = cbdc::mapped_hash_array("does_not_exist.dat");
+    ASSERT_FALSE(file.open());
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/metrics.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(metrics_test, counter_sums_threads) {
+    auto c = cbdc::metrics::counter();
+    static constexpr size_t n_threads = 8;
+    static constexpr size_t n_adds = 10000;
+    auto threads = std::vector<std::thread>();
+    for(size_t i{0}; i < n_threads; i++) {
+        threads.emplace_back([&]() {
+            for(size_t j{0}; j < n_adds; j++) {
+                c.add();
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(c.value(), n_threads * n_adds);
+}
+
+TEST(metrics_test, bucket_bounds) {
+    using cbdc::metrics::histogram;
+    // Every value lies within its bucket, and buckets are contiguous
+    uint64_t prev_upper{0};
+    for(size_t i{0}; i < histogram::bucket_count; i++) {
+        auto upper = histogram::bucket_upper_bound(i);
+        if(i > 0) {
+            ASSERT_GT(upper, prev_upper);
+            ASSERT_EQ(histogram::bucket_index(prev_upper + 1), i);
+        }
+        ASSERT_EQ(histogram::bucket_index(upper), i);
+        prev_upper = upper;
+    }
+    ASSERT_EQ(prev_upper, histogram::max_value);
+    ASSERT_EQ(histogram::bucket_index(UINT64_MAX),
+              histogram::bucket_count - 1);
+
+    // Buckets are no wider than an eighth of their values
+    for(uint64_t v : {9ULL, 100ULL, 12345ULL, 1000000007ULL}) {
+        auto upper = histogram::bucket_upper_bound(histogram::bucket_index(v));
+        ASSERT_GE(upper, v);
+        ASSERT_LE(upper - v, v / histogram::sub_buckets);
+    }
+}
+
+TEST(metrics_test, histogram_quantiles) {
+    auto h = cbdc::metrics::histogram();
+    for(uint64_t i{1}; i <= 1000; i++) {
+        h.record(i);
+    }
+    auto snap = h.snapshot();
+    ASSERT_EQ(snap.m_count, 1000U);
+    ASSERT_EQ(snap.m_sum, 500500U);
+    auto p50 = snap.quantile(0.5);
+    ASSERT_GE(p50, 500U);
+    ASSERT_LE(p50, 500U + 500U / 8);
+    auto p99 = snap.quantile(0.99);
+    ASSERT_GE(p99, 990U);
+    ASSERT_LE(p99, 990U + 990U / 8);
+    ASSERT_EQ(cbdc::metrics::histogram_snapshot().quantile(0.5), 0U);
+}
+
+TEST(metrics_test, prometheus_output) {
+    auto reg = cbdc::metrics::registry();
+    auto& c = reg.get_counter("test_events_total", "Events.");
+    c.add(3);
+    ASSERT_EQ(&reg.get_counter("test_events_total", "Events."), &c);
+    auto& h = reg.get_latency_histogram("test_stage_seconds", "Stage.");
+    h.record(std::chrono::microseconds(3));
+    h.record(std::chrono::milliseconds(2));
+
+    auto out = reg.to_prometheus();
+    ASSERT_NE(out.find("# TYPE test_events_total counter\n"
+                       "test_events_total 3\n"),
+              std::string::npos);
+    ASSERT_NE(out.find("# TYPE test_stage_seconds histogram\n"),
+              std::string::npos);
+    ASSERT_NE(out.find("test_stage_seconds_bucket{le=\"4.096e-06\"} 1\n"),
+              std::string::npos);
+    ASSERT_NE(out.find("test_stage_seconds_bucket{le=\"+Inf\"} 2\n"),
+              std::string::npos);
+    ASSERT_NE(out.find("test_stage_seconds_count 2\n"), std::string::npos);
+    ASSERT_NE(out.find("test_stage_seconds_sum 0.002003\n"),
+              std::string::npos);
+}
+
+TEST(metrics_test, gauge_and_sampler) {
+    auto reg = cbdc::metrics::registry();
+    auto& g = reg.get_gauge("test_queue_bytes", "Queue size.");
+    g.set(7);
+    ASSERT_EQ(&reg.get_gauge("test_queue_bytes", "Queue size."), &g);
+    ASSERT_NE(reg.to_prometheus().find("# TYPE test_queue_bytes gauge\n"
+                                       "test_queue_bytes 7\n"),
+              std::string::npos);
+
+    // The sampler runs its function on start and then every interval
+    std::atomic<uint64_t> runs{0};
+    {
+        auto s = cbdc::metrics::sampler(std::chrono::milliseconds(1), [&]() {
+            g.set(++runs);
+        });
+        while(runs < 3) {
+            std::this_thread::yield();
+        }
+    }
+    const auto stopped = runs.load();
+    ASSERT_EQ(g.value(), stopped);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(runs, stopped);
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/mpmc_queue.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(mpmc_queue_test, fifo_and_capacity) {
+    auto q = cbdc::mpmc_queue<int>(4);
+    for(int i = 0; i < 4; i++) {
+        ASSERT_TRUE(q.try_push(int{i}));
+    }
+    ASSERT_FALSE(q.try_push(4));
+
+    auto item = 0;
+    ASSERT_TRUE(q.try_pop(item));
+    ASSERT_EQ(item, 0);
+    ASSERT_TRUE(q.try_push(4));
+
+    auto out = std::vector<int>();
+    ASSERT_EQ(q.pop_batch(out, 3), 3UL);
+    auto expected = std::vector<int>{1, 2, 3};
+    ASSERT_EQ(out, expected);
+    ASSERT_EQ(q.pop_batch(out, 3), 1UL);
+    ASSERT_EQ(out.back(), 4);
+    ASSERT_FALSE(q.try_pop(item));
+}
+
+TEST(mpmc_queue_test, clear_unblocks) {
+    auto q = cbdc::mpmc_queue<int>(2);
+    auto consumer = std::thread([&]() {
+        auto item = 0;
+        ASSERT_FALSE(q.pop(item));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.clear();
+    consumer.join();
+
+    q.reset();
+    ASSERT_TRUE(q.push(1));
+    ASSERT_TRUE(q.push(2));
+    auto producer = std::thread([&]() {
+        ASSERT_FALSE(q.push(3));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.clear();
+    producer.join();
+}
+
+TEST(mpmc_queue_test, concurrent_producers_and_consumers) {
+    static constexpr int n_threads = 4;
+    static constexpr int n_items = 20000;
+    auto q = cbdc::mpmc_queue<int>(64);
+    auto seen = std::vector<std::atomic<int>>(n_threads * n_items);
+
+    auto consumers = std::vector<std::thread>();
+    for(int i = 0; i < n_threads; i++) {
+        consumers.emplace_back([&]() {
+            auto out = std::vector<int>();
+            for(;;) {
+                out.clear();
+                if(q.pop_batch(out, 16) == 0) {
+                    return;
+                }
+                for(auto v : out) {
+                    seen[static_cast<size_t>(v)]++;
+                }
+            }
+        });
+    }
+
+    auto producers = std::vector<std::thread>();
+    for(int i = 0; i < n_threads; i++) {
+        producers.emplace_back([&, i]() {
+            for(int j = 0; j < n_items; j++) {
+                ASSERT_TRUE(q.push(i * n_items + j));
+            }
+        });
+    }
+    for(auto& t : producers) {
+        t.join();
+    }
+
+    // Wait for the consumers to drain the queue before stopping them
+    auto item = 0;
+    while(q.try_pop(item)) {
+        seen[static_cast<size_t>(item)]++;
+    }
+    for(;;) {
+        auto total = 0;
+        for(auto& s : seen) {
+            total += s;
+        }
+        if(total == n_threads * n_items) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    q.clear();
+    for(auto& t : consumers) {
+        t.join();
+    }
+    for(auto& s : seen) {
+        ASSERT_EQ(s, 1);
+    }
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/profiled_mutex.hpp"
+
+#include <condition_variable>
+#include <gtest/gtest.h>
+#include <thread>
+
+class profiled_mutex_test : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        cbdc::set_lock_profiling(false);
+    }
+
+    static auto wait_hist(const std::string& name)
+        -> cbdc::metrics::histogram& {
+        return cbdc::metrics::registry::global().get_latency_histogram(
+            "lock_" + name + "_wait_seconds",
+            "");
+    }
+
+    static auto hold_hist(const std::string& name)
+        -> cbdc::metrics::histogram& {
+        return cbdc::metrics::registry::global().get_latency_histogram(
+            "lock_" + name + "_hold_seconds",
+            "");
+    }
+};
+
+TEST_F(profiled_mutex_test, disabled_records_nothing) {
+    auto mut = cbdc::profiled_mutex("test_disabled");
+    {
+        std::lock_guard<cbdc::profiled_mutex> l(mut);
+    }
+    ASSERT_TRUE(mut.try_lock());
+    mut.unlock();
+    ASSERT_EQ(wait_hist("test_disabled").snapshot().m_count, 0UL);
+    ASSERT_EQ(hold_hist("test_disabled").snapshot().m_count, 0UL);
+}
+
+TEST_F(profiled_mutex_test, records_wait_and_hold) {
+    cbdc::set_lock_profiling(true);
+    auto mut = cbdc::profiled_mutex("test_contended");
+    static constexpr auto hold = std::chrono::milliseconds(20);
+    std::unique_lock<cbdc::profiled_mutex> l(mut);
+    auto t = std::thread([&]() {
+        std::lock_guard<cbdc::profiled_mutex> ll(mut);
+    });
+    std::this_thread::sleep_for(hold);
+    l.unlock();
+    t.join();
+
+    auto wait = wait_hist("test_contended").snapshot();
+    ASSERT_EQ(wait.m_count, 2UL);
+    ASSERT_GE(wait.quantile(1.0),
+              static_cast<uint64_t>(
+                  std::chrono::nanoseconds(hold).count() / 2));
+    auto held = hold_hist("test_contended").snapshot();
+    ASSERT_EQ(held.m_count, 2UL);
+    ASSERT_GE(held.quantile(1.0),
+              static_cast<uint64_t>(std::chrono::nanoseconds(hold).count()));
+}
+
+TEST_F(profiled_mutex_test, shared_and_condition_variable) {
+    cbdc::set_lock_profiling(true);
+    auto mut = cbdc::profiled_shared_mutex("test_shared");
+    {
+        std::shared_lock<cbdc::profiled_shared_mutex> a(mut);
+        std::shared_lock<cbdc::profiled_shared_mutex> b(mut);
+        ASSERT_FALSE(mut.try_lock());
+    }
+    ASSERT_EQ(wait_hist("test_shared").snapshot().m_count, 2UL);
+    ASSERT_EQ(hold_hist("test_shared").snapshot().m_count, 0UL);
+
+    auto cv = std::condition_variable_any();
+    auto ready = false;
+    auto t = std::thread([&]() {
+        std::lock_guard<cbdc::profiled_shared_mutex> l(mut);
+        ready = true;
+        cv.notify_one();
+    });
+    {
+        std::unique_lock<cbdc::profiled_shared_mutex> l(mut);
+        cv.wait(l, [&]() {
+            return ready;
+        });
+    }
+    t.join();
+    ASSERT_GE(hold_hist("test_shared").snapshot().m_count, 2UL);
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/shard_prefix_map.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    auto with_prefix(uint8_t prefix) -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        ret[0] = prefix;
+        return ret;
+    }
+}
+
+TEST(shard_prefix_map_test, shards) {
+    auto map = cbdc::shard_prefix_map({{0, 127}, {128, 255}});
+    ASSERT_EQ(map.shard_count(), 2UL);
+    ASSERT_EQ(map.shards(with_prefix(0)), std::vector<size_t>{0});
+    ASSERT_EQ(map.shards(with_prefix(127)), std::vector<size_t>{0});
+    ASSERT_EQ(map.shards(with_prefix(128)), std::vector<size_t>{1});
+    ASSERT_EQ(map.shards(with_prefix(255)), std::vector<size_t>{1});
+}
+
+TEST(shard_prefix_map_test, overlapping_and_uncovered) {
+    auto map = cbdc::shard_prefix_map({{10, 20}, {15, 30}});
+    ASSERT_TRUE(map.shards(with_prefix(9)).empty());
+    ASSERT_EQ(map.shards(with_prefix(10)), std::vector<size_t>{0});
+    ASSERT_EQ(map.shards(with_prefix(15)), (std::vector<size_t>{0, 1}));
+    ASSERT_EQ(map.shards(with_prefix(30)), std::vector<size_t>{1});
+    ASSERT_TRUE(map.shards(with_prefix(31)).empty());
+}
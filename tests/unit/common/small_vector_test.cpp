@@ -0,0 +1,103 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/small_flat_map.hpp"
+#include "util/common/small_vector.hpp"
+#include "util/serialization/buffer_serializer.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
+
+#include <gtest/gtest.h>
+#include <unordered_map>
+#include <vector>
+
+TEST(small_vector_test, grows_past_inline) {
+    auto vec = cbdc::small_vector<uint64_t, 2>();
+    ASSERT_TRUE(vec.empty());
+    ASSERT_EQ(vec.capacity(), 2UL);
+    vec.push_back(1);
+    vec.push_back(2);
+    const auto* inline_data = vec.data();
+    ASSERT_EQ(vec.capacity(), 2UL);
+
+    vec.push_back(3);
+    ASSERT_NE(vec.data(), inline_data);
+    ASSERT_GE(vec.capacity(), 3UL);
+    ASSERT_EQ(vec, (cbdc::small_vector<uint64_t, 2>{1, 2, 3}));
+
+    vec.erase(vec.begin());
+    vec.insert(vec.begin() + 1, 4);
+    vec.pop_back();
+    ASSERT_EQ(vec, (cbdc::small_vector<uint64_t, 2>{2, 4}));
+    vec.resize(4);
+    ASSERT_EQ(vec, (cbdc::small_vector<uint64_t, 2>{2, 4, 0, 0}));
+}
+
+TEST(small_vector_test, copy_move) {
+    auto small = cbdc::small_vector<uint64_t, 2>{1};
+    auto large = cbdc::small_vector<uint64_t, 2>{1, 2, 3};
+
+    auto small_copy = small;
+    auto large_copy = large;
+    ASSERT_EQ(small_copy, small);
+    ASSERT_EQ(large_copy, large);
+    ASSERT_NE(large_copy.data(), large.data());
+
+    const auto* large_data = large.data();
+    auto moved = std::move(large);
+    ASSERT_EQ(moved.data(), large_data);
+    ASSERT_EQ(moved, large_copy);
+    ASSERT_TRUE(large.empty()); // NOLINT(bugprone-use-after-move)
+
+    moved = std::move(small);
+    ASSERT_EQ(moved, small_copy);
+    ASSERT_TRUE(small.empty()); // NOLINT(bugprone-use-after-move)
+}
+
+TEST(small_vector_test, serialization_matches_vector) {
+    auto vec = std::vector<uint64_t>{1, 2, 3, 4, 5};
+    auto small = cbdc::small_vector<uint64_t, 2>(vec.begin(), vec.end());
+    auto buf = cbdc::make_buffer(small);
+    ASSERT_EQ(buf, cbdc::make_buffer(vec));
+
+    auto deser = cbdc::buffer_serializer(buf);
+    auto out = cbdc::small_vector<uint64_t, 2>{9};
+    ASSERT_TRUE(deser >> out);
+    ASSERT_EQ(out, small);
+}
+
+TEST(small_flat_map_test, sorted_unique_keys) {
+    auto map = cbdc::small_flat_map<uint64_t, uint64_t, 2>();
+    ASSERT_TRUE(map.insert({3, 30}).second);
+    ASSERT_TRUE(map.emplace(1, 10).second);
+    ASSERT_FALSE(map.insert({3, 31}).second);
+    map[2] = 20;
+    ASSERT_EQ(map.size(), 3UL);
+    ASSERT_EQ(map.find(3)->second, 30UL);
+    ASSERT_EQ(map.find(4), map.end());
+
+    auto keys = std::vector<uint64_t>();
+    for(const auto& [key, val] : map) {
+        keys.push_back(key);
+    }
+    ASSERT_EQ(keys, (std::vector<uint64_t>{1, 2, 3}));
+
+    ASSERT_EQ(map.erase(2), 1UL);
+    ASSERT_EQ(map.erase(2), 0UL);
+    map.erase(map.begin());
+    ASSERT_EQ(map, (cbdc::small_flat_map<uint64_t, uint64_t, 2>{{3, 30}}));
+}
+
+TEST(small_flat_map_test, serialization_matches_unordered_map) {
+    auto map = cbdc::small_flat_map<uint64_t, uint64_t, 2>{{1, 10}};
+    auto umap = std::unordered_map<uint64_t, uint64_t>{{1, 10}};
+    auto buf = cbdc::make_buffer(map);
+    ASSERT_EQ(buf, cbdc::make_buffer(umap));
+
+    auto deser = cbdc::buffer_serializer(buf);
+    auto out = cbdc::small_flat_map<uint64_t, uint64_t, 2>();
+    ASSERT_TRUE(deser >> out);
+    ASSERT_EQ(out, map);
+}
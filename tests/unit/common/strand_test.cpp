@@ -0,0 +1,55 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/strand.hpp"
+
+#include <future>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(strand_test, inline_runs_in_order) {
+    auto s = cbdc::strand();
+    auto order = std::vector<int>();
+    s.post([&]() {
+        order.push_back(1);
+        // Posted from a running task, so runs after it returns
+        s.post([&]() {
+            order.push_back(3);
+        });
+        order.push_back(2);
+    });
+    auto expected = std::vector<int>{1, 2, 3};
+    ASSERT_EQ(order, expected);
+}
+
+TEST(strand_test, pool_serializes_tasks) {
+    auto pool = std::make_shared<cbdc::thread_pool>();
+    auto s = cbdc::strand(pool);
+
+    static constexpr int n_threads = 4;
+    static constexpr int n_tasks = 1000;
+    // Not atomic, as the strand never runs two tasks at once
+    int count = 0;
+    auto done = std::promise<void>();
+    auto threads = std::vector<std::thread>();
+    for(int i = 0; i < n_threads; i++) {
+        threads.emplace_back([&]() {
+            for(int j = 0; j < n_tasks; j++) {
+                s.post([&]() {
+                    if(++count == n_threads * n_tasks) {
+                        done.set_value();
+                    }
+                });
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    auto status = done.get_future().wait_for(std::chrono::seconds(5));
+    ASSERT_EQ(status, std::future_status::ready);
+    ASSERT_EQ(count, n_threads * n_tasks);
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/thread_pool.hpp"
+#include "util/common/work_stealing_deque.hpp"
+
+#include <future>
+#include <gtest/gtest.h>
+#include <set>
+
+TEST(work_stealing_deque_test, owner_and_thief_ends) {
+    auto deque = cbdc::work_stealing_deque<int>(4);
+    auto vals = std::vector<int>{0, 1, 2, 3, 4};
+    ASSERT_TRUE(deque.empty());
+    for(size_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(deque.push(&vals[i]));
+    }
+    ASSERT_FALSE(deque.push(&vals[4]));
+
+    // The owner pops the newest element, thieves steal the oldest
+    ASSERT_EQ(deque.pop(), &vals[3]);
+    ASSERT_EQ(deque.steal(), &vals[0]);
+    ASSERT_TRUE(deque.push(&vals[4]));
+    ASSERT_EQ(deque.pop(), &vals[4]);
+    ASSERT_EQ(deque.steal(), &vals[1]);
+    ASSERT_EQ(deque.pop(), &vals[2]);
+    ASSERT_EQ(deque.pop(), nullptr);
+    ASSERT_EQ(deque.steal(), nullptr);
+    ASSERT_TRUE(deque.empty());
+}
+
+TEST(work_stealing_deque_test, concurrent_steal_takes_each_once) {
+    static constexpr int n_items = 100000;
+    static constexpr int n_thieves = 3;
+    auto deque = cbdc::work_stealing_deque<int>(1024);
+    auto vals = std::vector<int>(n_items);
+    auto taken = std::vector<std::atomic<int>>(n_items);
+    auto remaining = std::atomic<int>{n_items};
+
+    auto thieves = std::vector<std::thread>();
+    for(int i = 0; i < n_thieves; i++) {
+        thieves.emplace_back([&]() {
+            while(remaining > 0) {
+                if(auto* v = deque.steal()) {
+                    taken[static_cast<size_t>(v - vals.data())]++;
+                    remaining--;
+                }
+            }
+        });
+    }
+
+    for(int i = 0; i < n_items;) {
+        if(deque.push(&vals[static_cast<size_t>(i)])) {
+            i++;
+        } else if(auto* v = deque.pop()) {
+            taken[static_cast<size_t>(v - vals.data())]++;
+            remaining--;
+        }
+    }
+    while(auto* v = deque.pop()) {
+        taken[static_cast<size_t>(v - vals.data())]++;
+        remaining--;
+    }
+    for(auto& t : thieves) {
+        t.join();
+    }
+    for(auto& t : taken) {
+        ASSERT_EQ(t, 1);
+    }
+}
+
+TEST(thread_pool_test, runs_all_tasks) {
+    auto pool = cbdc::thread_pool(4);
+    ASSERT_EQ(pool.size(), 4UL);
+
+    static constexpr int n_tasks = 10000;
+    auto remaining = std::atomic<int>{n_tasks};
+    auto done = std::promise<void>();
+    for(int i = 0; i < n_tasks; i++) {
+        pool.push([&]() {
+            if(--remaining == 0) {
+                done.set_value();
+            }
+        });
+    }
+    auto status = done.get_future().wait_for(std::chrono::seconds(5));
+    ASSERT_EQ(status, std::future_status::ready);
+}
+
+TEST(thread_pool_test, nested_tasks_are_stolen) {
+    auto pool = cbdc::thread_pool(4);
+
+    // One task fans out onto its worker's deque, and the other workers
+    // steal from it
+    static constexpr int n_tasks = 2000;
+    auto remaining = std::atomic<int>{n_tasks};
+    auto done = std::promise<void>();
+    auto mut = std::mutex();
+    auto ids = std::set<std::thread::id>();
+    pool.push([&]() {
+        for(int i = 0; i < n_tasks; i++) {
+            pool.push([&]() {
+                {
+                    std::unique_lock l(mut);
+                    ids.insert(std::this_thread::get_id());
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+                if(--remaining == 0) {
+                    done.set_value();
+                }
+            });
+        }
+    });
+    auto status = done.get_future().wait_for(std::chrono::seconds(5));
+    ASSERT_EQ(status, std::future_status::ready);
+    ASSERT_GT(ids.size(), 1UL);
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/tracing.hpp"
+
+#include <future>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class tracing_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        ASSERT_TRUE(cbdc::tracing::tracer::global().start(
+            1.0,
+            m_capacity,
+            [&](const std::vector<cbdc::tracing::span_record>& spans) {
+                std::lock_guard<std::mutex> l(m_mut);
+                m_spans.insert(m_spans.end(), spans.begin(), spans.end());
+            }));
+    }
+
+    void TearDown() override {
+        cbdc::tracing::tracer::global().stop();
+    }
+
+    static constexpr size_t m_capacity = 64;
+    std::mutex m_mut;
+    std::vector<cbdc::tracing::span_record> m_spans;
+};
+
+TEST_F(tracing_test, untraced_span_is_noop) {
+    ASSERT_FALSE(cbdc::tracing::current().has_value());
+    {
+        auto s = cbdc::tracing::span("untraced");
+        ASSERT_FALSE(s.get_context().has_value());
+        ASSERT_EQ(cbdc::tracing::make_shared_span("untraced"), nullptr);
+    }
+    cbdc::tracing::tracer::global().stop();
+    ASSERT_TRUE(m_spans.empty());
+}
+
+TEST_F(tracing_test, child_spans) {
+    auto root = cbdc::tracing::maybe_start_trace();
+    ASSERT_TRUE(root.has_value());
+    auto parent_id = uint64_t{};
+    {
+        auto parent = cbdc::tracing::span("parent", root);
+        parent_id = parent.get_context()->m_span_id;
+        auto c = cbdc::tracing::scoped_context(parent.get_context());
+        ASSERT_EQ(cbdc::tracing::current(), parent.get_context());
+        // Context is per-thread, so must be handed over explicitly
+        std::thread([trace = cbdc::tracing::current()]() {
+            ASSERT_FALSE(cbdc::tracing::current().has_value());
+            auto tc = cbdc::tracing::scoped_context(trace);
+            auto child = cbdc::tracing::span("child");
+        }).join();
+    }
+    ASSERT_FALSE(cbdc::tracing::current().has_value());
+    cbdc::tracing::tracer::global().stop();
+
+    ASSERT_EQ(m_spans.size(), 2);
+    const auto& child = m_spans[0];
+    const auto& parent = m_spans[1];
+    ASSERT_STREQ(child.m_name, "child");
+    ASSERT_STREQ(parent.m_name, "parent");
+    ASSERT_EQ(parent.m_trace_id, root->m_trace_id);
+    ASSERT_EQ(child.m_trace_id, root->m_trace_id);
+    ASSERT_EQ(parent.m_parent_id, 0);
+    ASSERT_EQ(parent.m_span_id, parent_id);
+    ASSERT_EQ(child.m_parent_id, parent_id);
+    ASSERT_NE(child.m_span_id, parent_id);
+    ASSERT_LE(child.m_duration, parent.m_duration);
+}
+
+TEST_F(tracing_test, finish_records_once) {
+    auto s = cbdc::tracing::span("once", cbdc::tracing::maybe_start_trace());
+    s.finish();
+    s.finish();
+    auto moved = std::move(s);
+    moved.finish();
+    cbdc::tracing::tracer::global().stop();
+    ASSERT_EQ(m_spans.size(), 1);
+}
+
+TEST_F(tracing_test, drops_when_full) {
+    // Block the export thread so the buffer fills
+    cbdc::tracing::tracer::global().stop();
+    auto blocked = std::promise<void>();
+    auto release = blocked.get_future().share();
+    ASSERT_TRUE(cbdc::tracing::tracer::global().start(
+        1.0,
+        m_capacity,
+        [&, release](const std::vector<cbdc::tracing::span_record>& spans) {
+            release.wait();
+            std::lock_guard<std::mutex> l(m_mut);
+            m_spans.insert(m_spans.end(), spans.begin(), spans.end());
+        }));
+    auto dropped = cbdc::tracing::tracer::global().dropped();
+    static constexpr size_t n_spans = m_capacity * 4;
+    auto root = cbdc::tracing::maybe_start_trace();
+    for(size_t i{0}; i < n_spans; i++) {
+        auto s = cbdc::tracing::span("span", root);
+    }
+    blocked.set_value();
+    cbdc::tracing::tracer::global().stop();
+    auto n_dropped = cbdc::tracing::tracer::global().dropped() - dropped;
+    ASSERT_GT(n_dropped, 0);
+    ASSERT_EQ(m_spans.size() + n_dropped, n_spans);
+}
+
+TEST(tracing_sample_test, sample_rate) {
+    auto& t = cbdc::tracing::tracer::global();
+    auto noop = [](const std::vector<cbdc::tracing::span_record>&) {};
+    ASSERT_TRUE(t.start(0.0, 2, noop));
+    ASSERT_FALSE(t.start(1.0, 2, noop));
+    ASSERT_FALSE(t.maybe_start_trace().has_value());
+    t.stop();
+
+    ASSERT_TRUE(t.start(0.5, 2, noop));
+    static constexpr size_t n_samples = 10000;
+    size_t sampled{0};
+    for(size_t i{0}; i < n_samples; i++) {
+        if(t.maybe_start_trace().has_value()) {
+            sampled++;
+        }
+    }
+    t.stop();
+    ASSERT_GT(sampled, n_samples / 3);
+    ASSERT_LT(sampled, n_samples * 2 / 3);
+    ASSERT_FALSE(t.maybe_start_trace().has_value());
+}
@@ -91,6 +91,24 @@ TEST_F(config_validation_test, twophase_coordinator_invariant) {
     ASSERT_TRUE(err.has_value());
 }
 
+TEST_F(config_validation_test, twophase_shard_ranges) {
+    m_twophase_opts.m_shard_ranges = {{0, 127}, {128, 255}, {0, 127}};
+    auto err = cbdc::config::check_options(m_twophase_opts);
+    ASSERT_FALSE(err.has_value());
+
+    m_twophase_opts.m_shard_ranges = {{0, 127}, {127, 255}};
+    err = cbdc::config::check_options(m_twophase_opts);
+    ASSERT_TRUE(err.has_value());
+
+    m_twophase_opts.m_shard_ranges = {{0, 255}, {16, 31}};
+    err = cbdc::config::check_options(m_twophase_opts);
+    ASSERT_TRUE(err.has_value());
+
+    m_twophase_opts.m_shard_ranges = {{128, 0}};
+    err = cbdc::config::check_options(m_twophase_opts);
+    ASSERT_TRUE(err.has_value());
+}
+
 TEST_F(config_validation_test, parsing_validation) {
     std::istringstream cfg(m_example_config);
     cbdc::config::parser ex(cfg);
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/coordinator/batch_sizer.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+class batch_sizer_test : public ::testing::Test {
+  protected:
+    void record_window(bool full, std::chrono::nanoseconds latency) {
+        for(size_t i{0}; i < cbdc::coordinator::batch_sizer::window; i++) {
+            m_sizer.record(full, latency);
+        }
+    }
+
+    cbdc::coordinator::batch_sizer m_sizer{1000, 10ms, 2ms};
+};
+
+TEST_F(batch_sizer_test, starts_at_max) {
+    ASSERT_EQ(m_sizer.batch_size(), 1000UL);
+    ASSERT_EQ(m_sizer.linger(), 0us);
+}
+
+TEST_F(batch_sizer_test, shrinks_over_target) {
+    record_window(true, 20ms);
+    ASSERT_EQ(m_sizer.batch_size(), 875UL);
+    ASSERT_EQ(m_sizer.linger(), 0us);
+
+    // One slow batch in a window is enough to miss the 99th percentile.
+    for(size_t i{1}; i < cbdc::coordinator::batch_sizer::window; i++) {
+        m_sizer.record(true, 1ms);
+    }
+    ASSERT_EQ(m_sizer.batch_size(), 875UL);
+    m_sizer.record(true, 20ms);
+    ASSERT_LT(m_sizer.batch_size(), 875UL);
+}
+
+TEST_F(batch_sizer_test, grows_when_full) {
+    record_window(true, 20ms);
+    ASSERT_EQ(m_sizer.batch_size(), 875UL);
+    record_window(true, 4ms);
+    ASSERT_EQ(m_sizer.batch_size(), 929UL);
+    ASSERT_EQ(m_sizer.linger(), 2ms);
+    for(size_t i{0}; i < 10; i++) {
+        record_window(true, 4ms);
+    }
+    ASSERT_EQ(m_sizer.batch_size(), 1000UL);
+}
+
+TEST_F(batch_sizer_test, holds_when_partial) {
+    record_window(true, 20ms);
+    record_window(false, 1ms);
+    ASSERT_EQ(m_sizer.batch_size(), 875UL);
+    // Near the target, the size holds and the linger shrinks.
+    record_window(true, 9ms);
+    ASSERT_EQ(m_sizer.batch_size(), 875UL);
+    ASSERT_EQ(m_sizer.linger(), 500us);
+}
+
+TEST_F(batch_sizer_test, minimum_size) {
+    auto sizer = cbdc::coordinator::batch_sizer(4, 10ms, 2ms);
+    for(size_t i{0}; i < 10 * cbdc::coordinator::batch_sizer::window; i++) {
+        sizer.record(true, 20ms);
+    }
+    ASSERT_EQ(sizer.batch_size(), 1UL);
+}
@@ -98,14 +98,18 @@ TEST_F(coordinator_messages_test, coordinator_state) {
         = cbdc::coordinator::controller::coordinator_state{prep, comm, disc};
 
     auto sm_state = cbdc::coordinator::state_machine::coordinator_state();
-    auto prep_buf = nuraft::buffer::alloc(cbdc::serialized_size(prep_param));
+    auto prep_buf
+        = nuraft::buffer::alloc(cbdc::serialized_size(prep_param) + 1);
     auto prep_ser = cbdc::nuraft_serializer(*prep_buf);
-    ASSERT_TRUE(prep_ser << prep_param);
+    ASSERT_TRUE(prep_ser << cbdc::coordinator::payload_encoding::legacy
+                         << prep_param);
     sm_state.m_prepare_txs.emplace(cbdc::hash_t{'b'}, prep_buf);
 
-    auto comm_buf = nuraft::buffer::alloc(cbdc::serialized_size(comm_param));
+    auto comm_buf
+        = nuraft::buffer::alloc(cbdc::serialized_size(comm_param) + 1);
     auto comm_ser = cbdc::nuraft_serializer(*comm_buf);
-    ASSERT_TRUE(comm_ser << comm_param);
+    ASSERT_TRUE(comm_ser << cbdc::coordinator::payload_encoding::legacy
+                         << comm_param);
     sm_state.m_commit_txs.emplace(cbdc::hash_t{'c'}, comm_buf);
     sm_state.m_discard_txs.emplace(cbdc::hash_t{'d'});
 
@@ -115,3 +119,158 @@ TEST_F(coordinator_messages_test, coordinator_state) {
     ASSERT_TRUE(m_deser >> deser_state);
     ASSERT_EQ(state, deser_state);
 }
+
+TEST_F(coordinator_messages_test, compact_command_header) {
+    auto comm = cbdc::coordinator::controller::sm_command_header{
+        cbdc::coordinator::state_machine::command::prepare,
+        cbdc::hash_t{'a'},
+        true};
+
+    ASSERT_TRUE(m_ser << comm);
+
+    auto deser_comm = cbdc::coordinator::controller::sm_command_header();
+    ASSERT_TRUE(m_deser >> deser_comm);
+    ASSERT_EQ(comm, deser_comm);
+}
+
+TEST_F(coordinator_messages_test, compact_prepare_command) {
+    auto header = cbdc::coordinator::controller::sm_command_header{
+        cbdc::coordinator::state_machine::command::prepare,
+        cbdc::hash_t{'a'},
+        true};
+    auto attested = m_tx;
+    attested.m_attestations.emplace(cbdc::pubkey_t{'k'},
+                                    cbdc::signature_t{'s'});
+    auto param = cbdc::coordinator::controller::prepare_tx{m_tx, attested};
+    auto comm = cbdc::coordinator::controller::sm_command{header, param};
+    ASSERT_TRUE(m_ser << comm);
+    auto compact_size = m_target_packet.size();
+
+    auto deser_header = cbdc::coordinator::controller::sm_command_header();
+    ASSERT_TRUE(m_deser >> deser_header);
+    ASSERT_EQ(header, deser_header);
+
+    auto deser_comm = cbdc::coordinator::controller::prepare_tx();
+    ASSERT_TRUE(cbdc::coordinator::read_compact(m_deser, deser_comm));
+    ASSERT_EQ(param, deser_comm);
+    ASSERT_EQ(deser_comm[0].m_inputs, m_tx.m_inputs);
+    ASSERT_EQ(deser_comm[0].m_uhs_outputs, m_tx.m_uhs_outputs);
+    ASSERT_EQ(deser_comm[1].m_attestations, attested.m_attestations);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+
+    ASSERT_LT(compact_size,
+              cbdc::serialized_size(
+                  cbdc::coordinator::controller::sm_command{
+                      {header.m_comm, header.m_dtx_id},
+                      param}));
+}
+
+TEST_F(coordinator_messages_test, compact_commit_command) {
+    auto header = cbdc::coordinator::controller::sm_command_header{
+        cbdc::coordinator::state_machine::command::commit,
+        cbdc::hash_t{'a'},
+        true};
+    auto flags = std::vector<bool>(20);
+    for(size_t i{0}; i < flags.size(); i += 3) {
+        flags[i] = true;
+    }
+    auto param = cbdc::coordinator::controller::commit_tx{
+        flags,
+        {{0, 1, 2, 300, 301}, {}, {5, 100000}}};
+    auto comm = cbdc::coordinator::controller::sm_command{header, param};
+    ASSERT_TRUE(m_ser << comm);
+
+    auto deser_header = cbdc::coordinator::controller::sm_command_header();
+    ASSERT_TRUE(m_deser >> deser_header);
+    ASSERT_EQ(header, deser_header);
+
+    auto deser_comm = cbdc::coordinator::controller::commit_tx();
+    ASSERT_TRUE(cbdc::coordinator::read_compact(m_deser, deser_comm));
+    ASSERT_EQ(param, deser_comm);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+}
+
+TEST_F(coordinator_messages_test, mixed_coordinator_state) {
+    auto prep_param = cbdc::coordinator::controller::prepare_tx{m_tx};
+    auto comm_param
+        = cbdc::coordinator::controller::commit_tx{{true, false}, {{0}, {1}}};
+
+    // A legacy prepare entry next to a compact commit entry, as after an
+    // upgrade with dtxs in flight.
+    auto sm_state = cbdc::coordinator::state_machine::coordinator_state();
+    auto prep_buf
+        = nuraft::buffer::alloc(cbdc::serialized_size(prep_param) + 1);
+    auto prep_ser = cbdc::nuraft_serializer(*prep_buf);
+    ASSERT_TRUE(prep_ser << cbdc::coordinator::payload_encoding::legacy
+                         << prep_param);
+    sm_state.m_prepare_txs.emplace(cbdc::hash_t{'b'}, prep_buf);
+
+    auto comm_packet = cbdc::buffer();
+    auto comm_ser = cbdc::buffer_serializer(comm_packet);
+    ASSERT_TRUE(comm_ser << cbdc::coordinator::payload_encoding::compact);
+    cbdc::coordinator::write_compact(comm_ser, comm_param);
+    auto comm_buf = nuraft::buffer::alloc(comm_packet.size());
+    auto comm_buf_ser = cbdc::nuraft_serializer(*comm_buf);
+    ASSERT_TRUE(comm_buf_ser.write(comm_packet.data(), comm_packet.size()));
+    sm_state.m_commit_txs.emplace(cbdc::hash_t{'c'}, comm_buf);
+
+    ASSERT_TRUE(m_ser << sm_state);
+
+    auto deser_state = cbdc::coordinator::controller::coordinator_state();
+    ASSERT_TRUE(m_deser >> deser_state);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+    auto expected = cbdc::coordinator::controller::coordinator_state{
+        {{cbdc::hash_t{'b'}, prep_param}},
+        {{cbdc::hash_t{'c'}, comm_param}},
+        {}};
+    ASSERT_EQ(expected, deser_state);
+}
+
+TEST_F(coordinator_messages_test, routed_coordinator_state) {
+    auto sm_state = cbdc::coordinator::state_machine::coordinator_state();
+    sm_state.m_routes.emplace(1, cbdc::config::shard_range_t{0, 63});
+    sm_state.m_routes.emplace(2, std::nullopt);
+    ASSERT_TRUE(m_ser << sm_state);
+
+    auto deser_state = cbdc::coordinator::controller::coordinator_state();
+    ASSERT_TRUE(m_deser >> deser_state);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+    ASSERT_EQ(deser_state.m_routes, sm_state.m_routes);
+}
+
+TEST_F(coordinator_messages_test, unrouted_state_version) {
+    // Version 1 states end after the discarded dtxs
+    ASSERT_TRUE(m_ser << uint8_t{1} << uint64_t{0} << uint64_t{0}
+                      << uint64_t{0});
+    auto deser_state = cbdc::coordinator::controller::coordinator_state();
+    deser_state.m_routes.emplace(1, std::nullopt);
+    ASSERT_TRUE(m_deser >> deser_state);
+    ASSERT_TRUE(m_deser.end_of_buffer());
+    ASSERT_EQ(deser_state, cbdc::coordinator::controller::coordinator_state());
+}
+
+TEST_F(coordinator_messages_test, route_command) {
+    auto comm = cbdc::coordinator::controller::sm_command{
+        {cbdc::coordinator::state_machine::command::route},
+        cbdc::coordinator::controller::route_update{
+            3,
+            cbdc::config::shard_range_t{128, 191}}};
+    ASSERT_TRUE(m_ser << comm);
+
+    auto deser_header = cbdc::coordinator::controller::sm_command_header();
+    auto deser_route = cbdc::coordinator::controller::route_update();
+    ASSERT_TRUE(m_deser >> deser_header >> deser_route);
+    ASSERT_EQ(deser_header, comm.m_header);
+    ASSERT_EQ(deser_route,
+              std::get<cbdc::coordinator::controller::route_update>(
+                  comm.m_data.value()));
+    ASSERT_TRUE(m_deser.end_of_buffer());
+}
+
+TEST_F(coordinator_messages_test, unknown_state_version) {
+    ASSERT_TRUE(m_ser << uint8_t{3} << uint64_t{0} << uint64_t{0}
+                      << uint64_t{0});
+    auto deser_state = cbdc::coordinator::controller::coordinator_state();
+    m_deser >> deser_state;
+    ASSERT_FALSE(m_deser.end_of_buffer());
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/coordinator/router.hpp"
+#include "util/common/hash.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+class router_test : public ::testing::Test {
+  protected:
+    static auto make_router(size_t n) -> cbdc::coordinator::rpc::router {
+        auto clusters = std::vector<std::vector<cbdc::network::endpoint_t>>();
+        for(size_t i{0}; i < n; i++) {
+            clusters.push_back(
+                {{"localhost", static_cast<unsigned short>(40000 + i)}});
+        }
+        return {std::move(clusters), m_logger};
+    }
+
+    static auto tx_id(size_t i) -> cbdc::hash_t {
+        auto ret = cbdc::hash_t();
+        auto x = (i + 1) * 0x9e3779b97f4a7c15;
+        std::memcpy(ret.data(), &x, sizeof(x));
+        return ret;
+    }
+
+    static constexpr size_t n_txs{4000};
+    static inline auto m_logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::fatal);
+};
+
+TEST_F(router_test, picks_deterministically) {
+    auto a = make_router(4);
+    auto b = make_router(4);
+    auto counts = std::vector<size_t>(4);
+    for(size_t i{0}; i < n_txs; i++) {
+        const auto c = a.pick(tx_id(i));
+        ASSERT_EQ(c, b.pick(tx_id(i)));
+        counts[c]++;
+    }
+    for(auto count : counts) {
+        ASSERT_GT(count, n_txs / 8);
+    }
+}
+
+TEST_F(router_test, added_cluster_takes_only_its_share) {
+    auto before = make_router(3);
+    auto after = make_router(4);
+    for(size_t i{0}; i < n_txs; i++) {
+        const auto c = after.pick(tx_id(i));
+        if(c != 3) {
+            ASSERT_EQ(c, before.pick(tx_id(i)));
+        }
+    }
+}
+
+TEST_F(router_test, skips_failed_cluster) {
+    auto r = make_router(2);
+    auto id = tx_id(0);
+    const auto preferred = r.pick(id);
+    // No cluster is connected, so sending fails
+    ASSERT_FALSE(r.execute_transaction(preferred, {}, [](auto) {}));
+    ASSERT_NE(r.pick(id), preferred);
+
+    // With every cluster failing, the preferred one is still probed
+    ASSERT_FALSE(r.execute_transaction(1 - preferred, {}, [](auto) {}));
+    ASSERT_EQ(r.pick(id), preferred);
+}
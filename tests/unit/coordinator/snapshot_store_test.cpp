@@ -0,0 +1,253 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/coordinator/snapshot_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <gtest/gtest.h>
+#include <thread>
+
+class coordinator_snapshot_store_test : public ::testing::Test {
+  protected:
+    using store_type = cbdc::coordinator::snapshot_store;
+    using phase = store_type::phase;
+
+    void SetUp() override {
+        for(size_t i{0}; i < m_ids.size(); i++) {
+            m_ids[i][0] = static_cast<unsigned char>(i);
+        }
+        m_routes[1] = cbdc::config::shard_range_t{0, 127};
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::remove_all(m_dir_b);
+    }
+
+    static auto metadata(uint64_t idx) -> nuraft::ptr<nuraft::snapshot> {
+        return nuraft::cs_new<nuraft::snapshot>(
+            idx,
+            1,
+            nuraft::cs_new<nuraft::cluster_config>());
+    }
+
+    static auto payload(unsigned char b) -> nuraft::ptr<nuraft::buffer> {
+        auto ret = nuraft::buffer::alloc(3);
+        std::fill_n(ret->data_begin(), ret->size(), b);
+        return ret;
+    }
+
+    // Queues a write and waits for it to finish.
+    static auto write_sync(store_type& store,
+                           uint64_t idx,
+                           bool is_base,
+                           std::vector<store_type::entry> dtxs,
+                           store_type::shard_routes routes) -> bool {
+        auto done = std::promise<bool>();
+        store.write(*metadata(idx),
+                    is_base,
+                    std::move(dtxs),
+                    std::move(routes),
+                    [&](bool ok) {
+                        done.set_value(ok);
+                    });
+        return done.get_future().get();
+    }
+
+    // Prepares 0 and 1 at 10, then commits 0, discards 1 and prepares 2 at
+    // 20, then finishes 1 at 30.
+    void write_chain(store_type& store) {
+        ASSERT_TRUE(write_sync(store,
+                               10,
+                               true,
+                               {{m_ids[0], phase::prepare, payload(0)},
+                                {m_ids[1], phase::prepare, payload(1)}},
+                               {}));
+        ASSERT_TRUE(write_sync(store,
+                               20,
+                               false,
+                               {{m_ids[0], phase::commit, payload(2)},
+                                {m_ids[1], phase::discard, nullptr},
+                                {m_ids[2], phase::prepare, payload(3)}},
+                               {}));
+        ASSERT_TRUE(write_sync(store,
+                               30,
+                               false,
+                               {{m_ids[1], phase::done, nullptr}},
+                               m_routes));
+    }
+
+    // Checks a loaded image holds the state written by write_chain.
+    void check_image(const store_type::image& img) {
+        ASSERT_EQ(img.m_snp->get_last_log_idx(), 30UL);
+        ASSERT_EQ(img.m_routes, m_routes);
+        auto dtxs = img.m_dtxs;
+        std::sort(dtxs.begin(), dtxs.end(), [](auto& a, auto& b) {
+            return a.m_dtx_id < b.m_dtx_id;
+        });
+        ASSERT_EQ(dtxs.size(), 2UL);
+        ASSERT_EQ(dtxs[0].m_dtx_id, m_ids[0]);
+        ASSERT_EQ(dtxs[0].m_phase, phase::commit);
+        ASSERT_EQ(dtxs[0].m_payload->data_begin()[0], 2);
+        ASSERT_EQ(dtxs[1].m_dtx_id, m_ids[2]);
+        ASSERT_EQ(dtxs[1].m_phase, phase::prepare);
+        ASSERT_EQ(dtxs[1].m_payload->data_begin()[0], 3);
+    }
+
+    static constexpr auto m_dir = "coordinator_snapshot_store_test_snps";
+    static constexpr auto m_dir_b = "coordinator_snapshot_store_test_snps_b";
+    std::shared_ptr<cbdc::logging::log> m_log{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn)};
+    std::array<cbdc::hash_t, 3> m_ids{};
+    store_type::shard_routes m_routes;
+};
+
+TEST_F(coordinator_snapshot_store_test, load_chain) {
+    auto store = store_type(m_log, m_dir, 0);
+    ASSERT_TRUE(store.init());
+    ASSERT_FALSE(store.has_chain());
+    ASSERT_EQ(store.latest(), nullptr);
+    write_chain(store);
+    ASSERT_TRUE(store.has_chain());
+    ASSERT_EQ(store.latest()->get_last_log_idx(), 30UL);
+
+    auto img = store.load(30);
+    ASSERT_TRUE(img.has_value());
+    check_image(img.value());
+
+    img = store.load(10);
+    ASSERT_TRUE(img.has_value());
+    ASSERT_EQ(img->m_dtxs.size(), 2UL);
+    ASSERT_TRUE(img->m_routes.empty());
+
+    ASSERT_FALSE(store.load(15).has_value());
+}
+
+TEST_F(coordinator_snapshot_store_test, delta_requires_chain) {
+    auto store = store_type(m_log, m_dir, 0);
+    ASSERT_TRUE(store.init());
+    ASSERT_FALSE(write_sync(store,
+                            20,
+                            false,
+                            {{m_ids[0], phase::discard, nullptr}},
+                            {}));
+    ASSERT_EQ(store.latest(), nullptr);
+}
+
+TEST_F(coordinator_snapshot_store_test, reopen) {
+    {
+        auto store = store_type(m_log, m_dir, 0);
+        ASSERT_TRUE(store.init());
+        write_chain(store);
+    }
+    auto store = store_type(m_log, m_dir, 0);
+    ASSERT_TRUE(store.init());
+    ASSERT_EQ(store.latest()->get_last_log_idx(), 30UL);
+    // The chain only continues once the coordinator has restored from it.
+    ASSERT_FALSE(store.has_chain());
+    store.set_chain(30);
+    ASSERT_TRUE(store.has_chain());
+}
+
+TEST_F(coordinator_snapshot_store_test, transfer) {
+    auto src = store_type(m_log, m_dir, 0);
+    ASSERT_TRUE(src.init());
+    write_chain(src);
+    auto dst = store_type(m_log, m_dir_b, 0);
+    ASSERT_TRUE(dst.init());
+
+    auto is_last = false;
+    uint64_t obj_id{0};
+    while(!is_last) {
+        auto obj = src.read_object(30, obj_id, is_last);
+        ASSERT_TRUE(obj.has_value());
+        ASSERT_TRUE(dst.save_object(std::move(obj.value())));
+        obj_id++;
+    }
+    ASSERT_EQ(obj_id, 3UL);
+
+    auto img = dst.load(30);
+    ASSERT_TRUE(img.has_value());
+    check_image(img.value());
+    dst.set_chain(30);
+    ASSERT_EQ(dst.latest()->get_last_log_idx(), 30UL);
+}
+
+TEST_F(coordinator_snapshot_store_test, merge) {
+    auto store = store_type(m_log, m_dir, 2);
+    ASSERT_TRUE(store.init());
+    write_chain(store);
+
+    // The merge runs on the writer thread before the next write.
+    ASSERT_TRUE(write_sync(store,
+                           40,
+                           false,
+                           {{m_ids[2], phase::commit, payload(4)}},
+                           m_routes));
+    ASSERT_TRUE(std::filesystem::exists(std::string(m_dir) + "/30.base"));
+    ASSERT_FALSE(std::filesystem::exists(std::string(m_dir) + "/10.base"));
+    ASSERT_FALSE(std::filesystem::exists(std::string(m_dir) + "/20.delta"));
+
+    auto img = store.load(30);
+    ASSERT_TRUE(img.has_value());
+    check_image(img.value());
+
+    img = store.load(40);
+    ASSERT_TRUE(img.has_value());
+    ASSERT_EQ(img->m_dtxs.size(), 2UL);
+}
+
+TEST_F(coordinator_snapshot_store_test, merge_waits_for_transfer) {
+    auto store = store_type(m_log, m_dir, 2);
+    ASSERT_TRUE(store.init());
+    ASSERT_TRUE(write_sync(store,
+                           10,
+                           true,
+                           {{m_ids[0], phase::prepare, payload(0)}},
+                           {}));
+    ASSERT_TRUE(write_sync(store,
+                           20,
+                           false,
+                           {{m_ids[0], phase::commit, payload(1)}},
+                           {}));
+    auto is_last = false;
+    ASSERT_TRUE(store.read_object(20, 0, is_last).has_value());
+    ASSERT_FALSE(is_last);
+
+    // Merges attempted mid-transfer are put off so the chain's objects
+    // keep their numbers.
+    ASSERT_TRUE(write_sync(store,
+                           30,
+                           false,
+                           {{m_ids[1], phase::prepare, payload(2)}},
+                           {}));
+    ASSERT_TRUE(write_sync(store,
+                           40,
+                           false,
+                           {{m_ids[1], phase::commit, payload(3)}},
+                           {}));
+    ASSERT_TRUE(std::filesystem::exists(std::string(m_dir) + "/10.base"));
+    ASSERT_FALSE(std::filesystem::exists(std::string(m_dir) + "/30.base"));
+    ASSERT_TRUE(store.read_object(20, 1, is_last).has_value());
+    ASSERT_TRUE(is_last);
+
+    // Once the transfer ends, the chain is merged after a following write.
+    ASSERT_TRUE(write_sync(store,
+                           50,
+                           false,
+                           {{m_ids[2], phase::prepare, payload(4)}},
+                           {}));
+    auto base = std::string(m_dir) + "/10.base";
+    for(size_t i{0}; i < 100 && std::filesystem::exists(base); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_FALSE(std::filesystem::exists(base));
+    auto img = store.load(50);
+    ASSERT_TRUE(img.has_value());
+    ASSERT_EQ(img->m_dtxs.size(), 3UL);
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/coordinator/tx_archive.hpp"
+#include "util.hpp"
+
+#include <atomic>
+#include <functional>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace {
+    /// Blob sink which keeps every appended record in memory.
+    class memory_blob_sink final : public cbdc::persistence::blob_sink {
+      public:
+        auto append(const cbdc::hash_t* keys,
+                    const cbdc::buffer* blobs,
+                    size_t count) -> bool override {
+            while(m_blocked) {
+                std::this_thread::yield();
+            }
+            if(m_failures > 0) {
+                m_failures--;
+                return false;
+            }
+            m_keys.insert(m_keys.end(), keys, keys + count);
+            m_blobs.insert(m_blobs.end(), blobs, blobs + count);
+            m_appended += count;
+            return true;
+        }
+
+        std::atomic<size_t> m_appended{0};
+        std::vector<cbdc::hash_t> m_keys;
+        std::vector<cbdc::buffer> m_blobs;
+        /// Number of upcoming appends to reject.
+        std::atomic<size_t> m_failures{0};
+        /// Holds appends until cleared.
+        std::atomic_bool m_blocked{false};
+    };
+}
+
+class coordinator_tx_archive_test : public ::testing::Test {
+  protected:
+    std::shared_ptr<cbdc::logging::log> m_logger{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::fatal)};
+
+    static void wait_for(const std::function<bool()>& done) {
+        static constexpr auto max_wait = std::chrono::seconds(5);
+        const auto deadline = std::chrono::steady_clock::now() + max_wait;
+        while(!done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::shared_ptr<const std::vector<cbdc::transaction::compact_tx>> m_txs{
+        std::make_shared<const std::vector<cbdc::transaction::compact_tx>>(
+            std::vector<cbdc::transaction::compact_tx>{
+                cbdc::test::simple_tx({'a'}, {{'b'}, {'c'}}, {{'d'}}),
+                cbdc::test::simple_tx({'e'}, {{'f'}}, {{'g'}, {'h'}})})};
+    std::vector<bool> m_complete{true, false};
+};
+
+TEST_F(coordinator_tx_archive_test, encode_decode) {
+    auto blob = cbdc::coordinator::tx_archive::encode(*m_txs, m_complete, 3);
+    ASSERT_TRUE(blob.has_value());
+    auto rec = cbdc::coordinator::tx_archive::decode(blob.value());
+    ASSERT_TRUE(rec.has_value());
+    ASSERT_EQ(rec->m_complete_txs, m_complete);
+    ASSERT_EQ(rec->m_txs.size(), 2UL);
+    ASSERT_EQ(cbdc::test::compact_transaction(rec->m_txs[0]), (*m_txs)[0]);
+    ASSERT_EQ(cbdc::test::compact_transaction(rec->m_txs[1]), (*m_txs)[1]);
+
+    auto corrupt = cbdc::buffer();
+    corrupt.append(blob->data(), blob->size() / 2);
+    ASSERT_FALSE(cbdc::coordinator::tx_archive::decode(corrupt).has_value());
+}
+
+TEST_F(coordinator_tx_archive_test, archives_dtxs) {
+    auto sink = std::make_unique<memory_blob_sink>();
+    auto* sink_ptr = sink.get();
+    sink_ptr->m_failures = 1;
+    auto archive = cbdc::coordinator::tx_archive(
+        m_logger,
+        std::move(sink),
+        10,
+        1,
+        3,
+        {std::chrono::milliseconds(1), std::chrono::milliseconds(1)});
+    ASSERT_FALSE(archive.try_push({'x'}, m_txs, m_complete));
+    ASSERT_TRUE(archive.start());
+    ASSERT_TRUE(archive.try_push({'x'}, m_txs, m_complete));
+    ASSERT_TRUE(archive.try_push({'y'}, m_txs, {false, true}));
+
+    // The first append fails, so waits for the retry
+    wait_for([&]() {
+        return sink_ptr->m_appended == 2;
+    });
+    archive.stop();
+    ASSERT_EQ(archive.size(), 0UL);
+    ASSERT_FALSE(archive.try_push({'z'}, m_txs, m_complete));
+
+    ASSERT_EQ(sink_ptr->m_keys,
+              (std::vector<cbdc::hash_t>{{'x'}, {'y'}}));
+    auto rec = cbdc::coordinator::tx_archive::decode(sink_ptr->m_blobs[1]);
+    ASSERT_TRUE(rec.has_value());
+    ASSERT_EQ(rec->m_complete_txs, (std::vector<bool>{false, true}));
+    ASSERT_EQ(rec->m_txs.size(), 2UL);
+}
+
+TEST_F(coordinator_tx_archive_test, drops_when_full) {
+    auto sink = std::make_unique<memory_blob_sink>();
+    auto* sink_ptr = sink.get();
+    sink_ptr->m_blocked = true;
+    auto archive
+        = cbdc::coordinator::tx_archive(m_logger, std::move(sink), 1, 1, 3);
+    ASSERT_TRUE(archive.start());
+    ASSERT_TRUE(archive.try_push({'x'}, m_txs, m_complete));
+    wait_for([&]() {
+        return archive.size() == 0;
+    });
+
+    // With the sink stalled, pushes beyond the high-water mark return at
+    // once rather than holding up the caller
+    ASSERT_TRUE(archive.try_push({'y'}, m_txs, m_complete));
+    ASSERT_FALSE(archive.try_push({'z'}, m_txs, m_complete));
+    sink_ptr->m_blocked = false;
+    wait_for([&]() {
+        return sink_ptr->m_appended == 2;
+    });
+    archive.stop();
+    ASSERT_EQ(sink_ptr->m_keys,
+              (std::vector<cbdc::hash_t>{{'x'}, {'y'}}));
+}
+
+TEST_F(coordinator_tx_archive_test, drops_after_max_attempts) {
+    auto sink = std::make_unique<memory_blob_sink>();
+    auto* sink_ptr = sink.get();
+    sink_ptr->m_failures = 2;
+    auto archive = cbdc::coordinator::tx_archive(
+        m_logger,
+        std::move(sink),
+        10,
+        1,
+        3,
+        {std::chrono::milliseconds(1), std::chrono::milliseconds(1), 2});
+    ASSERT_TRUE(archive.start());
+    ASSERT_TRUE(archive.try_push({'x'}, m_txs, m_complete));
+    wait_for([&]() {
+        return sink_ptr->m_failures == 0;
+    });
+    ASSERT_TRUE(archive.try_push({'y'}, m_txs, m_complete));
+    wait_for([&]() {
+        return sink_ptr->m_appended == 1;
+    });
+    archive.stop();
+    ASSERT_EQ(sink_ptr->m_keys, (std::vector<cbdc::hash_t>{{'y'}}));
+}
+
+TEST_F(coordinator_tx_archive_test, no_sink) {
+    auto archive
+        = cbdc::coordinator::tx_archive(m_logger, nullptr, 10, 1, 3);
+    ASSERT_FALSE(archive.start());
+    ASSERT_FALSE(archive.try_push({'x'}, m_txs, m_complete));
+}
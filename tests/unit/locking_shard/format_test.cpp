@@ -39,6 +39,35 @@ TEST_F(locking_shard_format_test, lock_request) {
     ASSERT_EQ(req, deser_req);
 }
 
+TEST_F(locking_shard_format_test, shared_batch) {
+    auto other = cbdc::locking_shard::tx{
+        cbdc::test::simple_tx({'j', 'k', 'l'}, {{{'m'}}}, {{{'n'}}})};
+    auto shared = std::make_shared<std::vector<cbdc::transaction::compact_tx>>(
+        std::vector<cbdc::transaction::compact_tx>{m_tx.m_tx,
+                                                   other.m_tx,
+                                                   m_tx.m_tx});
+    auto view = cbdc::locking_shard::tx_batch(shared, {1, 2});
+    ASSERT_EQ(view.size(), 2UL);
+    ASSERT_EQ(view[0], other.m_tx);
+    ASSERT_TRUE(m_ser << view);
+
+    // A view serializes as the list of transactions it refers to
+    auto owned = std::vector<cbdc::locking_shard::tx>{other, m_tx};
+    auto owned_packet = cbdc::buffer();
+    auto owned_ser = cbdc::buffer_serializer(owned_packet);
+    ASSERT_TRUE(owned_ser << owned);
+    ASSERT_EQ(m_target_packet, owned_packet);
+
+    auto deser = cbdc::locking_shard::tx_batch();
+    ASSERT_TRUE(m_deser >> deser);
+    ASSERT_EQ(deser, view);
+
+    // Taking from a shared batch leaves it intact
+    auto taken = std::move(view).take();
+    ASSERT_EQ(taken, owned);
+    ASSERT_EQ((*shared)[1].m_inputs, other.m_tx.m_inputs);
+}
+
 TEST_F(locking_shard_format_test, apply_request) {
     auto req = cbdc::locking_shard::rpc::request();
     req.m_dtx_id = {'b'};
@@ -61,6 +90,42 @@ TEST_F(locking_shard_format_test, discard_request) {
     ASSERT_EQ(req, deser_req);
 }
 
+TEST_F(locking_shard_format_test, lock_apply_request) {
+    auto req = cbdc::locking_shard::rpc::request();
+    req.m_dtx_id = {'b'};
+    req.m_params = cbdc::locking_shard::rpc::lock_apply_params{
+        std::vector<cbdc::locking_shard::tx>{m_tx, m_tx}};
+    ASSERT_TRUE(m_ser << req);
+
+    auto deser_req = cbdc::locking_shard::rpc::request();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_EQ(req, deser_req);
+}
+
+TEST_F(locking_shard_format_test, range_request) {
+    auto req = cbdc::locking_shard::rpc::request();
+    req.m_params = cbdc::locking_shard::rpc::range_params{
+        cbdc::locking_shard::rpc::range_op::read,
+        {128, 191},
+        65536};
+    ASSERT_TRUE(m_ser << req);
+
+    auto deser_req = cbdc::locking_shard::rpc::request();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_EQ(req, deser_req);
+}
+
+TEST_F(locking_shard_format_test, import_request) {
+    auto req = cbdc::locking_shard::rpc::request();
+    req.m_params = cbdc::locking_shard::rpc::import_params{
+        {cbdc::hash_t{'a'}, cbdc::hash_t{'b'}}};
+    ASSERT_TRUE(m_ser << req);
+
+    auto deser_req = cbdc::locking_shard::rpc::request();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_EQ(req, deser_req);
+}
+
 TEST_F(locking_shard_format_test, lock_response) {
     auto req = cbdc::locking_shard::rpc::response();
     req = cbdc::locking_shard::rpc::lock_response({true, false});
@@ -90,3 +155,56 @@ TEST_F(locking_shard_format_test, discard_response) {
     ASSERT_TRUE(m_deser >> deser_req);
     ASSERT_EQ(req, deser_req);
 }
+
+TEST_F(locking_shard_format_test, range_response) {
+    auto req = cbdc::locking_shard::rpc::response();
+    req = cbdc::locking_shard::rpc::range_response{true, {cbdc::hash_t{'c'}}};
+    ASSERT_TRUE(m_ser << req);
+
+    auto deser_req = cbdc::locking_shard::rpc::response();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_EQ(req, deser_req);
+}
+
+TEST_F(locking_shard_format_test, status_batch_request) {
+    auto req = cbdc::locking_shard::rpc::status_request();
+    req = cbdc::locking_shard::rpc::uhs_status_batch_request{
+        {{'a'}, {'b'}, {'c'}}};
+    ASSERT_TRUE(m_ser << req);
+
+    auto deser_req = cbdc::locking_shard::rpc::status_request();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_EQ(req, deser_req);
+}
+
+TEST_F(locking_shard_format_test, status_batch_response) {
+    auto resp = cbdc::locking_shard::rpc::status_response();
+    auto flags = std::vector<bool>();
+    for(size_t i{0}; i < 13; i++) {
+        flags.push_back(i % 3 == 0);
+    }
+    resp = cbdc::locking_shard::rpc::status_batch_response{flags};
+    ASSERT_TRUE(m_ser << resp);
+    // Count, then 13 flags packed into two bytes.
+    ASSERT_EQ(m_target_packet.size(), sizeof(uint8_t) + sizeof(uint64_t) + 2);
+
+    auto deser_resp = cbdc::locking_shard::rpc::status_response();
+    ASSERT_TRUE(m_deser >> deser_resp);
+    ASSERT_EQ(resp, deser_resp);
+}
+
+TEST_F(locking_shard_format_test, read_index) {
+    auto req = cbdc::locking_shard::rpc::status_request();
+    req = cbdc::locking_shard::rpc::read_index_request{};
+    ASSERT_TRUE(m_ser << req);
+    auto resp = cbdc::locking_shard::rpc::status_response();
+    resp = cbdc::locking_shard::rpc::read_index_response{42};
+    ASSERT_TRUE(m_ser << resp);
+
+    auto deser_req = cbdc::locking_shard::rpc::status_request();
+    ASSERT_TRUE(m_deser >> deser_req);
+    ASSERT_EQ(req, deser_req);
+    auto deser_resp = cbdc::locking_shard::rpc::status_response();
+    ASSERT_TRUE(m_deser >> deser_resp);
+    ASSERT_EQ(resp, deser_resp);
+}
@@ -0,0 +1,177 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/locking_shard/snapshot_store.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <thread>
+
+class snapshot_store_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        for(size_t i{0}; i < m_ids.size(); i++) {
+            m_ids[i][0] = static_cast<unsigned char>(i);
+        }
+        m_state.append("state", 5);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::remove_all(m_dir_b);
+    }
+
+    static auto metadata(uint64_t idx) -> nuraft::ptr<nuraft::snapshot> {
+        return nuraft::cs_new<nuraft::snapshot>(
+            idx,
+            1,
+            nuraft::cs_new<nuraft::cluster_config>());
+    }
+
+    // Writes {0, 1, 2} at 10, then adds 3 and removes 0 at 20.
+    void write_chain(cbdc::locking_shard::snapshot_store& store) {
+        ASSERT_TRUE(store.write_base(*metadata(10),
+                                     {m_ids[0], m_ids[1], m_ids[2]},
+                                     m_state));
+        auto delta = cbdc::locking_shard::uhs_delta{{m_ids[3]}, {m_ids[0]}};
+        m_state.append("2", 1);
+        ASSERT_TRUE(store.write_delta(*metadata(20), delta, m_state));
+    }
+
+    static constexpr auto m_dir = "snapshot_store_test_snps";
+    static constexpr auto m_dir_b = "snapshot_store_test_snps_b";
+    std::shared_ptr<cbdc::logging::log> m_log{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn)};
+    std::array<cbdc::hash_t, 4> m_ids{};
+    cbdc::buffer m_state;
+};
+
+TEST_F(snapshot_store_test, load_chain) {
+    auto store = cbdc::locking_shard::snapshot_store(m_log, m_dir, 0);
+    ASSERT_TRUE(store.init());
+    ASSERT_FALSE(store.has_chain());
+    ASSERT_EQ(store.latest(), nullptr);
+    write_chain(store);
+    ASSERT_TRUE(store.has_chain());
+    ASSERT_EQ(store.latest()->get_last_log_idx(), 20UL);
+
+    auto img = store.load(20);
+    ASSERT_TRUE(img.has_value());
+    auto expected = std::vector<cbdc::hash_t>{m_ids[1], m_ids[2], m_ids[3]};
+    ASSERT_EQ(img->m_uhs, expected);
+    ASSERT_EQ(img->m_dtx_state, m_state);
+    ASSERT_EQ(img->m_snp->get_last_log_idx(), 20UL);
+
+    img = store.load(10);
+    ASSERT_TRUE(img.has_value());
+    expected = {m_ids[0], m_ids[1], m_ids[2]};
+    ASSERT_EQ(img->m_uhs, expected);
+
+    ASSERT_FALSE(store.load(15).has_value());
+}
+
+TEST_F(snapshot_store_test, delta_requires_chain) {
+    auto store = cbdc::locking_shard::snapshot_store(m_log, m_dir, 0);
+    ASSERT_TRUE(store.init());
+    ASSERT_FALSE(
+        store.write_delta(*metadata(20), {{m_ids[0]}, {}}, m_state));
+    ASSERT_EQ(store.latest(), nullptr);
+}
+
+TEST_F(snapshot_store_test, reopen) {
+    {
+        auto store = cbdc::locking_shard::snapshot_store(m_log, m_dir, 0);
+        ASSERT_TRUE(store.init());
+        write_chain(store);
+    }
+    auto store = cbdc::locking_shard::snapshot_store(m_log, m_dir, 0);
+    ASSERT_TRUE(store.init());
+    ASSERT_EQ(store.latest()->get_last_log_idx(), 20UL);
+    // The chain only continues once the shard has restored from it.
+    ASSERT_FALSE(store.has_chain());
+    store.set_chain(20);
+    ASSERT_TRUE(store.has_chain());
+}
+
+TEST_F(snapshot_store_test, transfer) {
+    auto src = cbdc::locking_shard::snapshot_store(m_log, m_dir, 0);
+    ASSERT_TRUE(src.init());
+    write_chain(src);
+    auto dst = cbdc::locking_shard::snapshot_store(m_log, m_dir_b, 0);
+    ASSERT_TRUE(dst.init());
+
+    auto is_last = false;
+    uint64_t obj_id{0};
+    while(!is_last) {
+        auto obj = src.read_object(20, obj_id, is_last);
+        ASSERT_TRUE(obj.has_value());
+        ASSERT_TRUE(dst.save_object(std::move(obj.value())));
+        obj_id++;
+    }
+    ASSERT_EQ(obj_id, 2UL);
+    ASSERT_FALSE(src.read_object(20, obj_id, is_last).has_value());
+
+    auto img = dst.load(20);
+    ASSERT_TRUE(img.has_value());
+    ASSERT_EQ(img->m_uhs, src.load(20)->m_uhs);
+    ASSERT_EQ(img->m_dtx_state, m_state);
+    dst.set_chain(20);
+    ASSERT_EQ(dst.latest()->get_last_log_idx(), 20UL);
+}
+
+TEST_F(snapshot_store_test, merge) {
+    auto store = cbdc::locking_shard::snapshot_store(m_log, m_dir, 1);
+    ASSERT_TRUE(store.init());
+    write_chain(store);
+
+    // The merged delta file is deleted last.
+    auto delta = std::string(m_dir) + "/20.delta";
+    for(size_t i{0}; i < 100 && std::filesystem::exists(delta); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_FALSE(std::filesystem::exists(delta));
+    ASSERT_TRUE(std::filesystem::exists(std::string(m_dir) + "/20.base"));
+    ASSERT_FALSE(std::filesystem::exists(std::string(m_dir) + "/10.base"));
+
+    auto img = store.load(20);
+    ASSERT_TRUE(img.has_value());
+    auto expected = std::vector<cbdc::hash_t>{m_ids[1], m_ids[2], m_ids[3]};
+    ASSERT_EQ(img->m_uhs, expected);
+    ASSERT_EQ(img->m_dtx_state, m_state);
+
+    // New deltas extend the merged base file.
+    ASSERT_TRUE(store.write_delta(*metadata(30), {{}, {m_ids[1]}}, m_state));
+    img = store.load(30);
+    ASSERT_TRUE(img.has_value());
+    expected = {m_ids[2], m_ids[3]};
+    ASSERT_EQ(img->m_uhs, expected);
+}
+
+TEST_F(snapshot_store_test, merge_waits_for_transfer) {
+    auto store = cbdc::locking_shard::snapshot_store(m_log, m_dir, 2);
+    ASSERT_TRUE(store.init());
+    write_chain(store);
+
+    auto is_last = false;
+    ASSERT_TRUE(store.read_object(20, 0, is_last).has_value());
+    ASSERT_FALSE(is_last);
+
+    // Reaching the merge threshold mid-transfer must not renumber the
+    // chain's objects.
+    ASSERT_TRUE(store.write_delta(*metadata(30), {{}, {m_ids[1]}}, m_state));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto delta = std::string(m_dir) + "/30.delta";
+    ASSERT_TRUE(std::filesystem::exists(delta));
+    ASSERT_TRUE(std::filesystem::exists(std::string(m_dir) + "/10.base"));
+    ASSERT_TRUE(store.read_object(20, 1, is_last).has_value());
+    ASSERT_TRUE(is_last);
+
+    for(size_t i{0}; i < 100 && std::filesystem::exists(delta); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_FALSE(std::filesystem::exists(delta));
+    ASSERT_TRUE(std::filesystem::exists(std::string(m_dir) + "/30.base"));
+}
@@ -109,6 +109,29 @@ TEST_F(PacketIOTest, ctx_notify_request) {
     ASSERT_EQ(tx_notify, result_tx_notify);
 }
 
+TEST_F(PacketIOTest, tx_notify_batch_request) {
+    auto req = cbdc::atomizer::tx_notify_batch_request();
+    req.m_block_height = 33;
+    for(unsigned char i = 0; i < 3; i++) {
+        auto n = cbdc::atomizer::tx_notification();
+        n.m_tx.m_id = {i, 'l', 'k', 'e'};
+        n.m_tx.m_inputs.push_back({'a', i, 'o', 'p'});
+        n.m_tx.m_uhs_outputs.push_back({'t', 'a', i, 'm'});
+        n.m_attestations.insert(i);
+        req.m_txs.push_back(std::move(n));
+    }
+
+    m_ser << cbdc::atomizer::request{req};
+
+    auto result_req = cbdc::atomizer::request();
+    m_deser >> result_req;
+
+    ASSERT_TRUE(std::holds_alternative<cbdc::atomizer::tx_notify_batch_request>(
+        result_req));
+    ASSERT_EQ(req,
+              std::get<cbdc::atomizer::tx_notify_batch_request>(result_req));
+}
+
 TEST_F(PacketIOTest, block) {
     cbdc::transaction::compact_tx tx0;
     tx0.m_inputs.push_back({'a', 'x', 'o', 'p'});
@@ -134,6 +157,20 @@ TEST_F(PacketIOTest, block) {
     ASSERT_EQ(block, result_block);
 }
 
+TEST_F(PacketIOTest, block_subscribe_request) {
+    auto req = cbdc::atomizer::block_subscribe_request{{3, 8}};
+
+    m_ser << cbdc::atomizer::request{req};
+
+    auto result_req = cbdc::atomizer::request();
+    m_deser >> result_req;
+
+    ASSERT_TRUE(std::holds_alternative<cbdc::atomizer::block_subscribe_request>(
+        result_req));
+    ASSERT_EQ(req,
+              std::get<cbdc::atomizer::block_subscribe_request>(result_req));
+}
+
 TEST_F(PacketIOTest, compact_transaction) {
     cbdc::transaction::compact_tx tx;
     tx.m_inputs.push_back({'h', 'o', 'o', 'e'});
@@ -400,6 +437,66 @@ TEST_F(PacketIOTest, SentinelResponsePendingTest) {
     ASSERT_EQ(resp, resp_deser);
 }
 
+TEST_F(PacketIOTest, sentinel_validate_batch) {
+    auto out = cbdc::transaction::output();
+    out.m_value = 67;
+    out.m_witness_program_commitment = {'t', 'a', 'f', 'm'};
+    auto tx = cbdc::transaction::full_tx();
+    tx.m_outputs.push_back(out);
+    auto req = cbdc::sentinel::request{
+        cbdc::sentinel::validate_batch_request{{tx, tx}}};
+    m_ser << req;
+    auto req_deser = cbdc::sentinel::request();
+    m_deser >> req_deser;
+    ASSERT_TRUE(
+        std::holds_alternative<cbdc::sentinel::validate_batch_request>(
+            req_deser));
+    ASSERT_EQ(
+        std::get<cbdc::sentinel::validate_batch_request>(req_deser).m_txs,
+        std::get<cbdc::sentinel::validate_batch_request>(req).m_txs);
+
+    auto resp = cbdc::sentinel::response{
+        cbdc::sentinel::validate_batch_response{
+            cbdc::sentinel::validate_response{{'k'}, {'s'}},
+            std::nullopt}};
+    m_ser << resp;
+    auto resp_deser = cbdc::sentinel::response();
+    m_deser >> resp_deser;
+    ASSERT_EQ(resp, resp_deser);
+}
+
+TEST_F(PacketIOTest, sentinel_submit_and_status) {
+    auto req = cbdc::sentinel::request{
+        cbdc::sentinel::status_request{{{'a'}, {'b'}}}};
+    m_ser << req;
+    auto req_deser = cbdc::sentinel::request();
+    m_deser >> req_deser;
+    ASSERT_TRUE(
+        std::holds_alternative<cbdc::sentinel::status_request>(req_deser));
+    ASSERT_EQ(std::get<cbdc::sentinel::status_request>(req_deser).m_tx_ids,
+              std::get<cbdc::sentinel::status_request>(req).m_tx_ids);
+
+    auto pending
+        = cbdc::sentinel::execute_response{cbdc::sentinel::tx_status::pending,
+                                           std::nullopt};
+    auto submitted = cbdc::sentinel::response{
+        cbdc::sentinel::submit_response{{'a'}, pending}};
+    m_ser << submitted;
+    auto status = cbdc::sentinel::response{cbdc::sentinel::status_response{
+        pending,
+        std::nullopt,
+        cbdc::sentinel::execute_response{
+            cbdc::sentinel::tx_status::confirmed,
+            std::nullopt}}};
+    m_ser << status;
+
+    auto resp_deser = cbdc::sentinel::response();
+    m_deser >> resp_deser;
+    ASSERT_EQ(submitted, resp_deser);
+    m_deser >> resp_deser;
+    ASSERT_EQ(status, resp_deser);
+}
+
 TEST_F(PacketIOTest, empty_optional_test) {
     auto opt = std::optional<cbdc::atomizer::block>();
     m_ser << opt;
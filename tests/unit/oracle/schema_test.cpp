@@ -0,0 +1,64 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/oracle/hash_insert.hpp"
+#include "util/oracle/schema.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(oracle_schema_test, partition_name) {
+    ASSERT_EQ(cbdc::oracle::shard_partition_name({0x00, 0x3f}),
+              "SHARD_00_3F");
+    ASSERT_EQ(cbdc::oracle::shard_partition_name({0xc0, 0xff}),
+              "SHARD_C0_FF");
+}
+
+TEST(oracle_schema_test, partitioned_table_ddl) {
+    auto ddl = cbdc::oracle::make_partitioned_table_ddl(
+        "admin.shard_spent",
+        {"dtx_id", "tx_id", "uhs_id"},
+        "uhs_id",
+        {{0x80, 0xff}, {0x00, 0x7f}, {0x80, 0xff}});
+    ASSERT_EQ(ddl.size(), 2UL);
+    ASSERT_EQ(ddl[0],
+              "CREATE TABLE admin.shard_spent (dtx_id RAW(32) NOT NULL, "
+              "tx_id RAW(32) NOT NULL, uhs_id RAW(32) NOT NULL) PARTITION "
+              "BY RANGE (uhs_id) (PARTITION SHARD_00_7F VALUES LESS THAN "
+              "(HEXTORAW('80')), PARTITION SHARD_80_FF VALUES LESS THAN "
+              "(MAXVALUE))");
+    ASSERT_EQ(ddl[1],
+              "CREATE INDEX admin.shard_spent_uhs_id_idx ON "
+              "admin.shard_spent (uhs_id) LOCAL");
+}
+
+TEST(oracle_schema_test, partitioned_table_ddl_partial_coverage) {
+    auto ddl = cbdc::oracle::make_partitioned_table_ddl("t",
+                                                        {"uhs_id"},
+                                                        "uhs_id",
+                                                        {{0x00, 0x0f}});
+    ASSERT_EQ(ddl[0],
+              "CREATE TABLE t (uhs_id RAW(32) NOT NULL) PARTITION BY RANGE "
+              "(uhs_id) (PARTITION SHARD_00_0F VALUES LESS THAN "
+              "(MAXVALUE))");
+}
+
+TEST(oracle_schema_test, partition_insert_query) {
+    ASSERT_EQ(cbdc::oracle::make_partition_insert_query("admin.shard_spent",
+                                                        "SHARD_00_7F",
+                                                        {"dtx_id", "uhs_id"}),
+              "INSERT INTO admin.shard_spent PARTITION (SHARD_00_7F) "
+              "(dtx_id, uhs_id) VALUES (:1, :2)");
+}
+
+TEST(oracle_schema_test, lookup_query) {
+    ASSERT_EQ(cbdc::oracle::make_lookup_query("admin.shard_txs",
+                                              "SHARD_00_7F",
+                                              "tx_id",
+                                              3),
+              "SELECT tx_id FROM admin.shard_txs PARTITION (SHARD_00_7F) "
+              "WHERE tx_id IN (:1, :2, :3)");
+    ASSERT_EQ(cbdc::oracle::make_lookup_query("t", std::nullopt, "c", 1),
+              "SELECT c FROM t WHERE c IN (:1)");
+}
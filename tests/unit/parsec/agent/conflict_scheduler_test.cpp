@@ -0,0 +1,85 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/agent/conflict_scheduler.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    auto make_key(unsigned char n) -> cbdc::buffer {
+        auto ret = cbdc::buffer();
+        ret.append(&n, sizeof(n));
+        return ret;
+    }
+}
+
+TEST(conflict_scheduler_test, independent_run_immediately) {
+    auto sched = cbdc::parsec::agent::conflict_scheduler();
+    auto started = std::vector<size_t>();
+    sched.submit(0, {make_key(1), make_key(2)}, [&]() {
+        started.push_back(0);
+    });
+    sched.submit(1, {make_key(3)}, [&]() {
+        started.push_back(1);
+    });
+    sched.submit(2, {}, [&]() {
+        started.push_back(2);
+    });
+    ASSERT_EQ(started, (std::vector<size_t>{0, 1, 2}));
+    ASSERT_EQ(sched.size(), 3UL);
+    sched.release(0);
+    sched.release(1);
+    sched.release(2);
+    ASSERT_EQ(sched.size(), 0UL);
+}
+
+TEST(conflict_scheduler_test, conflicts_run_in_order) {
+    auto sched = cbdc::parsec::agent::conflict_scheduler();
+    auto started = std::vector<size_t>();
+    auto submit = [&](size_t id, std::vector<cbdc::buffer> keys) {
+        sched.submit(id, std::move(keys), [&started, id]() {
+            started.push_back(id);
+        });
+    };
+    submit(0, {make_key(1)});
+    // Duplicate keys do not make a transaction wait for itself
+    submit(1, {make_key(2), make_key(2)});
+    submit(2, {make_key(1), make_key(2)});
+    submit(3, {make_key(2)});
+    submit(4, {make_key(3)});
+    ASSERT_EQ(started, (std::vector<size_t>{0, 1, 4}));
+
+    sched.release(0);
+    ASSERT_EQ(started, (std::vector<size_t>{0, 1, 4}));
+
+    // 3 arrived after 2, so waits for it even though it only needs key 2
+    sched.release(1);
+    ASSERT_EQ(started, (std::vector<size_t>{0, 1, 4, 2}));
+
+    sched.release(2);
+    ASSERT_EQ(started, (std::vector<size_t>{0, 1, 4, 2, 3}));
+
+    sched.release(3);
+    sched.release(4);
+    ASSERT_EQ(sched.size(), 0UL);
+}
+
+TEST(conflict_scheduler_test, start_can_release) {
+    auto sched = cbdc::parsec::agent::conflict_scheduler();
+    auto started = std::vector<size_t>();
+    for(size_t id{0}; id < 3; id++) {
+        // Transactions which finish synchronously release from start
+        sched.submit(id, {make_key(1)}, [&sched, &started, id]() {
+            started.push_back(id);
+            if(id > 0) {
+                sched.release(id);
+            }
+        });
+    }
+    ASSERT_EQ(started, (std::vector<size_t>{0}));
+    sched.release(0);
+    ASSERT_EQ(started, (std::vector<size_t>{0, 1, 2}));
+    ASSERT_EQ(sched.size(), 0UL);
+}
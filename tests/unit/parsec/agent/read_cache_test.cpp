@@ -0,0 +1,56 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/agent/read_cache.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace {
+    auto make_key(unsigned char n) -> cbdc::buffer {
+        auto ret = cbdc::buffer();
+        ret.append(&n, sizeof(n));
+        return ret;
+    }
+}
+
+TEST(read_cache_test, put_get) {
+    auto cache = cbdc::parsec::agent::read_cache(std::chrono::minutes(1));
+    ASSERT_FALSE(cache.get(make_key(1)).has_value());
+
+    cache.put(make_key(1), make_key(10), 5);
+    ASSERT_EQ(cache.get(make_key(1)), make_key(10));
+
+    // Values read or written by earlier tickets do not replace later ones
+    cache.put(make_key(1), make_key(11), 4);
+    ASSERT_EQ(cache.get(make_key(1)), make_key(10));
+
+    auto updates = cbdc::parsec::broker::state_update_type();
+    updates.emplace(make_key(1), make_key(12));
+    updates.emplace(make_key(2), make_key(20));
+    cache.update(updates, 6);
+    ASSERT_EQ(cache.get(make_key(1)), make_key(12));
+    ASSERT_EQ(cache.get(make_key(2)), make_key(20));
+}
+
+TEST(read_cache_test, expires) {
+    auto cache
+        = cbdc::parsec::agent::read_cache(std::chrono::milliseconds(10));
+    cache.put(make_key(1), make_key(10), 1);
+    ASSERT_TRUE(cache.get(make_key(1)).has_value());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(cache.get(make_key(1)).has_value());
+}
+
+TEST(read_cache_test, evicts_least_recently_used) {
+    auto cache = cbdc::parsec::agent::read_cache(std::chrono::minutes(1), 2);
+    cache.put(make_key(1), make_key(10), 1);
+    cache.put(make_key(2), make_key(20), 1);
+    ASSERT_TRUE(cache.get(make_key(1)).has_value());
+    cache.put(make_key(3), make_key(30), 1);
+    ASSERT_TRUE(cache.get(make_key(1)).has_value());
+    ASSERT_FALSE(cache.get(make_key(2)).has_value());
+    ASSERT_TRUE(cache.get(make_key(3)).has_value());
+}
@@ -230,6 +230,57 @@ TEST_F(evm_test, host_storage) {
     EXPECT_EQ(host.set_storage(addr3, val2, val1), EVMC_STORAGE_DELETED);
 }
 
+TEST_F(evm_test, host_prefetch) {
+    const auto from = evmc::address{0xff0000};
+    const auto to = evmc::address{0xff0001};
+    const auto other = evmc::address{0xff0002};
+    const auto key = evmc::bytes32{1};
+    const auto val = evmc::bytes32{2};
+
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_to = to;
+    tx.m_access_list = {{other, {key, key}}, {to, {}}, {from, {}}};
+
+    size_t n_requests{0};
+    auto host = cbdc::parsec::agent::runner::evm_host(
+        m_log,
+        [&](const cbdc::parsec::runtime_locking_shard::key_type& /* k */,
+            cbdc::parsec::broker::lock_type /* locktype */,
+            const cbdc::parsec::broker::interface::try_lock_callback_type&
+                cb) {
+            n_requests++;
+            cb(cbdc::buffer());
+            return true;
+        },
+        evmc_tx_context(),
+        tx,
+        false,
+        0);
+
+    // The recipient's and other's accounts and code, then other's storage
+    // key once. The sender is locked by the caller.
+    auto locks = host.prefetch_locks(from);
+    ASSERT_EQ(locks.size(), 5UL);
+    ASSERT_EQ(locks.back().first,
+              cbdc::make_buffer(
+                  cbdc::parsec::agent::runner::storage_key{other, key}));
+
+    auto values = std::vector<cbdc::parsec::broker::value_type>(
+        locks.size() - 1);
+    values.push_back(cbdc::make_buffer(val));
+    ASSERT_FALSE(host.insert_prefetched({}));
+    ASSERT_TRUE(host.insert_prefetched(values));
+
+    const auto& chost = host;
+    EXPECT_EQ(chost.get_storage(other, key), val);
+    EXPECT_FALSE(chost.account_exists(to));
+    EXPECT_EQ(chost.get_code_size(other), 0UL);
+    EXPECT_EQ(n_requests, 0UL);
+
+    EXPECT_EQ(chost.get_storage(to, key), evmc::bytes32{});
+    EXPECT_EQ(n_requests, 1UL);
+}
+
 TEST_F(evm_test, simple_send) {
     auto tx = cbdc::parsec::agent::runner::evm_tx();
     tx.m_to = m_addr2_addr;
@@ -306,6 +357,99 @@ TEST_F(evm_test, simple_send) {
     ASSERT_EQ(res, std::future_status::ready);
 }
 
+TEST_F(evm_test, block_summary) {
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_to = m_addr2_addr;
+    tx.m_nonce = evmc::uint256be(1);
+    tx.m_value = evmc::uint256be(1000);
+    tx.m_gas_price = evmc::uint256be(1);
+    tx.m_gas_limit = evmc::uint256be(200000);
+    auto sighash = cbdc::parsec::agent::runner::sig_hash(tx);
+    tx.m_sig = cbdc::parsec::agent::runner::eth_sign(m_priv1,
+                                                     sighash,
+                                                     tx.m_type,
+                                                     m_secp_context);
+
+    auto run = [&](cbdc::parsec::agent::runner::evm_runner_function f,
+                   const cbdc::buffer& params,
+                   bool is_readonly_run) {
+        auto prom = std::promise<cbdc::parsec::agent::return_type>();
+        auto fut = prom.get_future();
+        auto agent = std::make_shared<cbdc::parsec::agent::impl>(
+            m_log,
+            m_cfg,
+            &cbdc::parsec::agent::runner::factory<
+                cbdc::parsec::agent::runner::evm_runner>::create,
+            m_broker,
+            cbdc::make_buffer(f),
+            params,
+            [&](const cbdc::parsec::agent::interface::exec_return_type& res) {
+                ASSERT_TRUE(
+                    std::holds_alternative<cbdc::parsec::agent::return_type>(
+                        res));
+                prom.set_value(
+                    std::get<cbdc::parsec::agent::return_type>(res));
+            },
+            cbdc::parsec::agent::runner::evm_runner::initial_lock_type,
+            is_readonly_run,
+            m_secp_context,
+            nullptr);
+        EXPECT_TRUE(agent->exec());
+        EXPECT_EQ(fut.wait_for(std::chrono::seconds(2)),
+                  std::future_status::ready);
+        return fut.get();
+    };
+
+    run(cbdc::parsec::agent::runner::evm_runner_function::execute_transaction,
+        cbdc::make_buffer(tx),
+        false);
+    auto tn = m_broker->highest_ticket();
+
+    // The summary stored at commit matches the one computed from the block
+    auto block_param = cbdc::make_buffer(evmc::uint256be(tn));
+    auto summary_res
+        = run(cbdc::parsec::agent::runner::evm_runner_function::
+                  get_block_summary,
+              block_param,
+              true);
+    auto maybe_summary = cbdc::from_buffer<
+        cbdc::parsec::agent::runner::evm_block_summary>(
+        summary_res[block_param]);
+    ASSERT_TRUE(maybe_summary.has_value());
+    auto& summary = maybe_summary.value();
+    ASSERT_EQ(summary.m_ticket_number, tn);
+    ASSERT_EQ(summary.m_txids.size(), 1UL);
+    ASSERT_EQ(summary.m_txids[0], cbdc::parsec::agent::runner::tx_id(tx));
+    ASSERT_EQ(summary.m_receipt_hashes.size(), 1UL);
+    ASSERT_EQ(summary.m_logs_bloom.size(),
+              cbdc::parsec::agent::runner::evm_bloom_size);
+
+    auto block_res
+        = run(cbdc::parsec::agent::runner::evm_runner_function::get_block,
+              block_param,
+              true);
+    auto maybe_blk
+        = cbdc::from_buffer<cbdc::parsec::agent::runner::evm_pretend_block>(
+            block_res[block_param]);
+    ASSERT_TRUE(maybe_blk.has_value());
+    auto computed
+        = cbdc::parsec::agent::runner::make_block_summary(maybe_blk.value());
+    ASSERT_EQ(cbdc::make_buffer(computed), cbdc::make_buffer(summary));
+
+    // A ticket without a transaction has an empty summary
+    auto empty_param = cbdc::make_buffer(evmc::uint256be(tn + 1000));
+    auto empty_res
+        = run(cbdc::parsec::agent::runner::evm_runner_function::
+                  get_block_summary,
+              empty_param,
+              true);
+    auto maybe_empty = cbdc::from_buffer<
+        cbdc::parsec::agent::runner::evm_block_summary>(
+        empty_res[empty_param]);
+    ASSERT_TRUE(maybe_empty.has_value());
+    ASSERT_TRUE(maybe_empty.value().m_txids.empty());
+}
+
 TEST_F(evm_test, contract_deploy) {
     // See tools/bench/parsec/evm/contracts for the source Solidity contract
     // and other details on the generation of the following bytecode
@@ -735,6 +879,37 @@ TEST_F(evm_test, signature_check) {
     ASSERT_FALSE(maybe_from.has_value());
 }
 
+TEST_F(evm_test, signature_check_cached) {
+    auto tx = cbdc::parsec::agent::runner::evm_tx();
+    tx.m_nonce = evmc::uint256be(1);
+    tx.m_gas_price = evmc::uint256be(50000000000);
+    tx.m_gas_limit = evmc::uint256be(21000);
+    tx.m_to = m_addr1_addr;
+    tx.m_value = evmc::uint256be(1050000000000000);
+
+    auto sighash = cbdc::parsec::agent::runner::sig_hash(tx);
+    tx.m_sig = cbdc::parsec::agent::runner::eth_sign(m_priv0,
+                                                     sighash,
+                                                     tx.m_type,
+                                                     m_secp_context);
+
+    // Checking again returns the cached signer
+    for(size_t i = 0; i < 2; i++) {
+        auto maybe_from
+            = cbdc::parsec::agent::runner::check_signature(tx,
+                                                           m_secp_context);
+        ASSERT_TRUE(maybe_from.has_value());
+        ASSERT_EQ(maybe_from.value(), m_addr0_addr);
+    }
+
+    // The same signature over a different transaction is not a hit
+    tx.m_value = evmc::uint256be(1);
+    auto maybe_from
+        = cbdc::parsec::agent::runner::check_signature(tx, m_secp_context);
+    ASSERT_FALSE(maybe_from.has_value()
+                 && maybe_from.value() == m_addr0_addr);
+}
+
 // from: https://github.com/ethereum/EIPs/blob/master/EIPS/eip-155.md#example
 TEST_F(evm_test, signature_check_2) {
     cbdc::privkey_t priv;
@@ -1269,6 +1444,29 @@ TEST_F(evm_test, decode_rlp_test) {
     deser >> rlp_value;
     ASSERT_EQ(rlp_value.type(), cbdc::rlp_value_type::array);
     ASSERT_EQ(rlp_value.size(), 12UL);
+
+    auto view = cbdc::rlp_view::decode(buf.c_ptr(), buf.size());
+    ASSERT_TRUE(view.has_value());
+    ASSERT_EQ(view->type(), cbdc::rlp_value_type::array);
+    auto items = view->items();
+    ASSERT_TRUE(items.has_value());
+    ASSERT_EQ(items->size(), 12UL);
+    for(size_t i = 0; i < items->size(); i++) {
+        auto val = rlp_value.value_at(i);
+        ASSERT_EQ(items.value()[i].type(), val.type());
+        if(val.type() == cbdc::rlp_value_type::buffer) {
+            ASSERT_EQ(items.value()[i].size(), val.size());
+            ASSERT_EQ(std::memcmp(items.value()[i].data(),
+                                  val.data(),
+                                  val.size()),
+                      0);
+        }
+    }
+
+    // Truncated input is rejected rather than read past the end
+    ASSERT_FALSE(
+        cbdc::rlp_view::decode(buf.c_ptr(), buf.size() - 1).has_value());
+    ASSERT_FALSE(cbdc::rlp_view::decode(buf.c_ptr(), 2).has_value());
 }
 
 // Using TX 0xb4b7a6679ab790549dc3324a7239a6bf7a87ffd4c4c092df523a5b0697763db7
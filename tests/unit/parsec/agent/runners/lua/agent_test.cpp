@@ -100,6 +100,65 @@ TEST_F(agent_test, deploy_test) {
     ASSERT_TRUE(agent->exec());
 }
 
+TEST_F(agent_test, reuse_test) {
+    auto make_params = [&](const std::string& name) {
+        auto params = cbdc::buffer();
+        uint64_t key_len = name.size();
+        params.append(&key_len, sizeof(key_len));
+        params.append(name.data(), name.size());
+        uint64_t fun_len = m_deploy_contract.size();
+        params.append(&fun_len, sizeof(fun_len));
+        params.append(m_deploy_contract.data(), m_deploy_contract.size());
+        return params;
+    };
+    auto make_callback = [&](const std::string& name, bool& called) {
+        auto contract_name = cbdc::buffer();
+        contract_name.append(name.data(), name.size());
+        return [&, contract_name](
+                   cbdc::parsec::agent::interface::exec_return_type res) {
+            ASSERT_TRUE(
+                std::holds_alternative<cbdc::parsec::agent::return_type>(res));
+            auto ret = cbdc::parsec::agent::return_type(
+                {{contract_name, m_deploy_contract}});
+            ASSERT_EQ(ret, std::get<cbdc::parsec::agent::return_type>(res));
+            called = true;
+        };
+    };
+
+    auto first_called = false;
+    auto agent = std::make_shared<cbdc::parsec::agent::impl>(
+        m_log,
+        m_cfg,
+        &cbdc::parsec::agent::runner::factory<
+            cbdc::parsec::agent::runner::lua_runner>::create,
+        m_broker,
+        m_deploy_contract_key,
+        make_params("contract"),
+        make_callback("contract", first_called),
+        cbdc::parsec::agent::runner::lua_runner::initial_lock_type,
+        false,
+        nullptr,
+        nullptr);
+    ASSERT_FALSE(agent->recycle());
+    ASSERT_TRUE(agent->exec());
+    ASSERT_TRUE(first_called);
+
+    ASSERT_TRUE(agent->recycle());
+    ASSERT_EQ(agent->get_state(), cbdc::parsec::agent::impl::state::init);
+    ASSERT_FALSE(agent->get_ticket_number().has_value());
+
+    auto second_called = false;
+    agent->reuse(m_deploy_contract_key,
+                 make_params("contract2"),
+                 make_callback("contract2", second_called),
+                 cbdc::parsec::agent::runner::lua_runner::initial_lock_type,
+                 false);
+    ASSERT_TRUE(agent->exec());
+    ASSERT_TRUE(second_called);
+    ASSERT_EQ(agent->get_state(),
+              cbdc::parsec::agent::impl::state::finish_complete);
+}
+
 TEST_F(agent_test, rollback_test) {
     auto params = cbdc::buffer();
 
@@ -3,10 +3,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/sha256.h"
 #include "parsec/agent/runners/lua/impl.hpp"
 #include "parsec/util.hpp"
+#include "util/common/keys.hpp"
 
 #include <gtest/gtest.h>
+#include <secp256k1_schnorrsig.h>
 
 TEST(agent_runner_test, rollback_test) {
     auto log = std::make_shared<cbdc::logging::log>(
@@ -63,6 +66,91 @@ TEST(agent_runner_test, rollback_test) {
                                                   std::move(try_lock_cb),
                                                   nullptr,
                                                   nullptr,
+                                                  nullptr,
                                                   0);
     ASSERT_TRUE(runner.run());
 }
+
+TEST(agent_runner_test, check_sig_test) {
+    auto log
+        = std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn);
+    auto cfg = cbdc::parsec::config();
+
+    // Checks the signature in its parameter, laid out as the pubkey, the
+    // signature and then the signed message
+    static constexpr auto source
+        = "local p = ...\n"
+          "check_sig(string.sub(p, 1, 32), string.sub(p, 33, 96),\n"
+          "          string.sub(p, 97))\n"
+          "return {}\n";
+    auto* L = luaL_newstate();
+    ASSERT_EQ(luaL_loadstring(L, source), LUA_OK);
+    auto contract = cbdc::buffer();
+    lua_dump(
+        L,
+        [](lua_State* /* L */, const void* p, size_t sz, void* ud) {
+            static_cast<cbdc::buffer*>(ud)->append(p, sz);
+            return 0;
+        },
+        &contract,
+        0);
+    lua_close(L);
+
+    auto secp = std::unique_ptr<secp256k1_context,
+                                decltype(&secp256k1_context_destroy)>(
+        secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
+        &secp256k1_context_destroy);
+    auto skey = cbdc::privkey_t{3};
+    auto pkey = cbdc::pubkey_from_privkey(skey, secp.get());
+    static constexpr auto msg = "pay 5";
+    auto sighash = cbdc::hash_t();
+    CSHA256()
+        .Write(reinterpret_cast<const unsigned char*>(msg), 5)
+        .Finalize(sighash.data());
+    secp256k1_keypair keypair{};
+    ASSERT_EQ(secp256k1_keypair_create(secp.get(), &keypair, skey.data()),
+              1);
+    cbdc::signature_t sig{};
+    ASSERT_EQ(secp256k1_schnorrsig_sign(secp.get(),
+                                        sig.data(),
+                                        sighash.data(),
+                                        &keypair,
+                                        nullptr,
+                                        nullptr),
+              1);
+
+    auto run = [&](const cbdc::signature_t& s) {
+        auto param = cbdc::buffer();
+        param.append(pkey.data(), pkey.size());
+        param.append(s.data(), s.size());
+        param.append(msg, 5);
+        auto ok = std::optional<bool>();
+        auto runner = cbdc::parsec::agent::runner::lua_runner(
+            log,
+            cfg,
+            contract,
+            std::move(param),
+            false,
+            [&](cbdc::parsec::agent::runner::interface::run_return_type ret) {
+                ok = std::holds_alternative<
+                    cbdc::parsec::runtime_locking_shard::state_update_type>(
+                    ret);
+            },
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr,
+            0);
+        EXPECT_TRUE(runner.run());
+        EXPECT_TRUE(ok.has_value());
+        return ok.value_or(false);
+    };
+
+    // The second run is answered from the cache of verified signatures,
+    // which must not accept a different signature for the same message
+    ASSERT_TRUE(run(sig));
+    ASSERT_TRUE(run(sig));
+    auto bad_sig = sig;
+    bad_sig[0] ^= 1;
+    ASSERT_FALSE(run(bad_sig));
+}
@@ -8,8 +8,12 @@
 #include "parsec/directory/impl.hpp"
 #include "parsec/runtime_locking_shard/impl.hpp"
 #include "parsec/ticket_machine/impl.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
 
+#include <atomic>
 #include <gtest/gtest.h>
+#include <thread>
 
 TEST(broker_test, deploy_test) {
     auto log = std::make_shared<cbdc::logging::log>(
@@ -44,3 +48,517 @@ TEST(broker_test, deploy_test) {
 
     cbdc::test::add_to_shard(broker, deploy_contract_key, deploy_contract);
 }
+
+TEST(broker_test, try_lock_batch_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    constexpr size_t n_shards = 3;
+    for(size_t i{0}; i < n_shards; i++) {
+        shards.push_back(
+            std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log));
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    auto locks = std::vector<cbdc::parsec::broker::lock_request_type>();
+    auto values = std::vector<cbdc::buffer>();
+    constexpr size_t n_keys = 8;
+    for(size_t i{0}; i < n_keys; i++) {
+        auto key = cbdc::make_buffer(i);
+        auto value = cbdc::make_buffer(i * 2);
+        cbdc::test::add_to_shard(broker, key, value);
+        locks.emplace_back(key, cbdc::parsec::broker::lock_type::read);
+        values.push_back(value);
+    }
+    // A key requested twice is locked once, with the stronger lock type.
+    locks.emplace_back(locks.front().first,
+                       cbdc::parsec::broker::lock_type::write);
+    values.push_back(values.front());
+
+    auto locked = false;
+    auto begin_res = broker->begin([&](auto begin_ret) {
+        ASSERT_TRUE(std::holds_alternative<
+                    cbdc::parsec::ticket_machine::ticket_number_type>(
+            begin_ret));
+        auto ticket_number
+            = std::get<cbdc::parsec::ticket_machine::ticket_number_type>(
+                begin_ret);
+        auto lock_res = broker->try_lock_batch(
+            ticket_number,
+            locks,
+            [&](cbdc::parsec::broker::interface::try_lock_batch_return_type
+                    res) {
+                ASSERT_TRUE(
+                    std::holds_alternative<std::vector<cbdc::buffer>>(res));
+                ASSERT_EQ(std::get<std::vector<cbdc::buffer>>(res), values);
+                locked = true;
+            });
+        ASSERT_TRUE(lock_res);
+
+        // Keys already locked are answered by the broker.
+        lock_res = broker->try_lock(
+            ticket_number,
+            locks.front().first,
+            cbdc::parsec::broker::lock_type::write,
+            [&](cbdc::parsec::broker::interface::try_lock_return_type res) {
+                ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(res));
+                ASSERT_EQ(std::get<cbdc::buffer>(res), values.front());
+            });
+        ASSERT_TRUE(lock_res);
+
+        auto commit_res = broker->commit(
+            ticket_number,
+            {{locks.front().first, values.back()}},
+            [&](auto commit_ret) {
+                ASSERT_FALSE(commit_ret.has_value());
+            });
+        ASSERT_TRUE(commit_res);
+    });
+    ASSERT_TRUE(begin_res);
+    ASSERT_TRUE(locked);
+}
+
+TEST(broker_test, read_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    constexpr size_t n_shards = 3;
+    for(size_t i{0}; i < n_shards; i++) {
+        shards.push_back(
+            std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log));
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    auto keys = std::vector<cbdc::buffer>();
+    auto values = std::vector<cbdc::buffer>();
+    constexpr size_t n_keys = 8;
+    for(size_t i{0}; i < n_keys; i++) {
+        auto key = cbdc::make_buffer(i);
+        auto value = cbdc::make_buffer(i * 2);
+        cbdc::test::add_to_shard(broker, key, value);
+        keys.push_back(key);
+        values.push_back(value);
+    }
+    keys.push_back(keys.front());
+    values.push_back(values.front());
+
+    // Hold a write lock on one of the keys, which reads must not wait for
+    auto begin_res = broker->begin([&](auto begin_ret) {
+        auto ticket_number
+            = std::get<cbdc::parsec::ticket_machine::ticket_number_type>(
+                begin_ret);
+        auto lock_res = broker->try_lock(
+            ticket_number,
+            keys.front(),
+            cbdc::parsec::broker::lock_type::write,
+            [](const cbdc::parsec::broker::interface::try_lock_return_type&
+                   res) {
+                ASSERT_TRUE(std::holds_alternative<cbdc::buffer>(res));
+            });
+        ASSERT_TRUE(lock_res);
+    });
+    ASSERT_TRUE(begin_res);
+
+    auto read = false;
+    auto read_res = broker->read(
+        keys,
+        [&](cbdc::parsec::broker::interface::read_return_type res) {
+            using values_type
+                = std::vector<cbdc::parsec::runtime_locking_shard::
+                                  committed_value>;
+            ASSERT_TRUE(std::holds_alternative<values_type>(res));
+            const auto& vals = std::get<values_type>(res);
+            ASSERT_EQ(vals.size(), values.size());
+            for(size_t i{0}; i < vals.size(); i++) {
+                ASSERT_EQ(vals[i].m_value, values[i]);
+                // Each key was committed by its own ticket, in order
+                ASSERT_EQ(vals[i].m_version, i % n_keys);
+            }
+            read = true;
+        });
+    ASSERT_TRUE(read_res);
+    ASSERT_TRUE(read);
+}
+
+TEST(broker_test, load_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    constexpr size_t n_shards = 3;
+    for(size_t i{0}; i < n_shards; i++) {
+        shards.push_back(
+            std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log));
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    auto rows = cbdc::parsec::broker::state_update_type();
+    auto keys = std::vector<cbdc::buffer>();
+    constexpr size_t n_keys = 64;
+    for(size_t i{0}; i < n_keys; i++) {
+        auto key = cbdc::make_buffer(i);
+        rows.emplace(key, cbdc::make_buffer(i * 2));
+        keys.push_back(key);
+    }
+
+    auto loaded = false;
+    auto load_res = broker->load(
+        rows,
+        [&](cbdc::parsec::broker::interface::load_return_type res) {
+            ASSERT_FALSE(res.has_value());
+            loaded = true;
+        });
+    ASSERT_TRUE(load_res);
+    ASSERT_TRUE(loaded);
+
+    auto read = false;
+    auto read_res = broker->read(
+        keys,
+        [&](cbdc::parsec::broker::interface::read_return_type res) {
+            using values_type
+                = std::vector<cbdc::parsec::runtime_locking_shard::
+                                  committed_value>;
+            ASSERT_TRUE(std::holds_alternative<values_type>(res));
+            const auto& vals = std::get<values_type>(res);
+            ASSERT_EQ(vals.size(), n_keys);
+            for(size_t i{0}; i < n_keys; i++) {
+                ASSERT_EQ(vals[i].m_value, rows[keys[i]]);
+            }
+            read = true;
+        });
+    ASSERT_TRUE(read_res);
+    ASSERT_TRUE(read);
+}
+
+TEST(broker_test, recover_paged_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard0
+        = std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log);
+    auto shard1
+        = std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>(
+        {shard0, shard1});
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory = std::make_shared<cbdc::parsec::directory::impl>(2);
+
+    // Leave more begun tickets on each shard than fit in a recovery page,
+    // as a crashed broker would
+    constexpr cbdc::parsec::ticket_machine::ticket_number_type n_tickets
+        = 2500;
+    for(cbdc::parsec::ticket_machine::ticket_number_type tn{1};
+        tn <= n_tickets;
+        tn++) {
+        auto& shard = tn % 2 == 0 ? shard0 : shard1;
+        ASSERT_TRUE(shard->try_lock(
+            tn,
+            0,
+            cbdc::make_buffer(tn),
+            cbdc::parsec::runtime_locking_shard::lock_type::write,
+            true,
+            [](const cbdc::parsec::runtime_locking_shard::interface::
+                   try_lock_return_type&) {}));
+    }
+
+    // A ticket committed on one shard but only prepared on the other,
+    // which is only returned in the last page of each shard
+    constexpr cbdc::parsec::ticket_machine::ticket_number_type partial
+        = n_tickets + 1;
+    auto key0 = cbdc::buffer::from_hex("aa").value();
+    auto key1 = cbdc::buffer::from_hex("bb").value();
+    auto val = cbdc::buffer::from_hex("cc").value();
+    for(auto& [shard, key] :
+        {std::make_pair(shard0, key0), std::make_pair(shard1, key1)}) {
+        ASSERT_TRUE(shard->try_lock(
+            partial,
+            0,
+            key,
+            cbdc::parsec::runtime_locking_shard::lock_type::write,
+            true,
+            [](const cbdc::parsec::runtime_locking_shard::interface::
+                   try_lock_return_type&) {}));
+        ASSERT_TRUE(
+            shard->prepare(partial,
+                           0,
+                           {{key, val}},
+                           [](const cbdc::parsec::runtime_locking_shard::
+                                  interface::prepare_return_type& res) {
+                               ASSERT_FALSE(res.has_value());
+                           }));
+    }
+    ASSERT_TRUE(shard0->commit(
+        partial,
+        [](const cbdc::parsec::runtime_locking_shard::interface::
+               commit_return_type& res) {
+            ASSERT_FALSE(res.has_value());
+        }));
+
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+    auto calls = 0;
+    ASSERT_TRUE(broker->recover(
+        [&](cbdc::parsec::broker::interface::recover_return_type res) {
+            ASSERT_FALSE(res.has_value());
+            calls++;
+        }));
+    ASSERT_EQ(calls, 1);
+
+    for(auto& shard : shards) {
+        auto maybe_success = shard->get_tickets(
+            0,
+            0,
+            1,
+            [](const cbdc::parsec::runtime_locking_shard::interface::
+                   get_tickets_return_type& res) {
+                ASSERT_TRUE(std::holds_alternative<
+                            cbdc::parsec::runtime_locking_shard::
+                                tickets_page>(res));
+                ASSERT_TRUE(std::get<cbdc::parsec::runtime_locking_shard::
+                                         tickets_page>(res)
+                                .m_tickets.empty());
+            });
+        ASSERT_TRUE(maybe_success);
+    }
+
+    auto read = false;
+    ASSERT_TRUE(shard1->read(
+        {key1},
+        [&](const cbdc::parsec::runtime_locking_shard::interface::
+                read_return_type& res) {
+            ASSERT_EQ(res.size(), 1UL);
+            ASSERT_EQ(res[0].m_value, val);
+            read = true;
+        }));
+    ASSERT_TRUE(read);
+}
+
+TEST(broker_test, commit_without_shards) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard
+        = std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log);
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 1);
+    auto directory = std::make_shared<cbdc::parsec::directory::impl>(1);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(
+        0,
+        std::vector<
+            std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>(
+            {shard}),
+        ticketer,
+        directory,
+        log);
+
+    // A ticket which locked nothing commits and finishes immediately
+    auto finished = false;
+    auto begin_res = broker->begin([&](auto begin_ret) {
+        auto ticket_number
+            = std::get<cbdc::parsec::ticket_machine::ticket_number_type>(
+                begin_ret);
+        auto commit_res
+            = broker->commit(ticket_number, {}, [&](auto commit_ret) {
+                  ASSERT_FALSE(commit_ret.has_value());
+                  auto finish_res
+                      = broker->finish(ticket_number, [&](auto finish_ret) {
+                            ASSERT_FALSE(finish_ret.has_value());
+                            finished = true;
+                        });
+                  ASSERT_TRUE(finish_res);
+              });
+        ASSERT_TRUE(commit_res);
+    });
+    ASSERT_TRUE(begin_res);
+    ASSERT_TRUE(finished);
+}
+
+namespace {
+    /// Ticket machine which counts the ranges it hands out.
+    class counting_ticket_machine
+        : public cbdc::parsec::ticket_machine::interface {
+      public:
+        counting_ticket_machine(std::shared_ptr<cbdc::logging::log> log,
+                                cbdc::parsec::ticket_machine::ticket_number_type
+                                    range)
+            : m_impl(std::move(log), range) {}
+
+        auto
+        get_ticket_number(get_ticket_number_callback_type result_callback)
+            -> bool override {
+            m_calls++;
+            return m_impl.get_ticket_number(std::move(result_callback));
+        }
+
+        size_t m_calls{0};
+
+      private:
+        cbdc::parsec::ticket_machine::impl m_impl;
+    };
+}
+
+TEST(broker_test, begin_leases_ticket_ranges) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard
+        = std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log);
+    constexpr cbdc::parsec::ticket_machine::ticket_number_type range = 10;
+    auto ticketer = std::make_shared<counting_ticket_machine>(log, range);
+    auto directory = std::make_shared<cbdc::parsec::directory::impl>(1);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(
+        0,
+        std::vector<
+            std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>(
+            {shard}),
+        ticketer,
+        directory,
+        log);
+
+    constexpr cbdc::parsec::ticket_machine::ticket_number_type n_tickets
+        = 25;
+    for(cbdc::parsec::ticket_machine::ticket_number_type i{0}; i < n_tickets;
+        i++) {
+        auto got = false;
+        ASSERT_TRUE(broker->begin(
+            [&](cbdc::parsec::broker::interface::ticketnum_or_errcode_type
+                    res) {
+                ASSERT_TRUE(std::holds_alternative<
+                            cbdc::parsec::ticket_machine::ticket_number_type>(
+                    res));
+                ASSERT_EQ(std::get<
+                              cbdc::parsec::ticket_machine::ticket_number_type>(
+                              res),
+                          i);
+                got = true;
+            }));
+        ASSERT_TRUE(got);
+    }
+    ASSERT_EQ(broker->highest_ticket(), n_tickets - 1);
+
+    // One range for the first ticket, then one prefetch each time half a
+    // range remains
+    ASSERT_LE(ticketer->m_calls, n_tickets / range + 2);
+}
+
+TEST(broker_test, concurrent_tickets) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shards = std::vector<
+        std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>();
+    constexpr size_t n_shards = 2;
+    for(size_t i{0}; i < n_shards; i++) {
+        shards.push_back(
+            std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(log));
+    }
+    auto ticketer
+        = std::make_shared<cbdc::parsec::ticket_machine::impl>(log, 16);
+    auto directory
+        = std::make_shared<cbdc::parsec::directory::impl>(n_shards);
+    auto broker = std::make_shared<cbdc::parsec::broker::impl>(0,
+                                                               shards,
+                                                               ticketer,
+                                                               directory,
+                                                               log);
+
+    // Each thread runs tickets writing its own key, so none conflict.
+    // Tickets whose begin call waited for a range may run on another
+    // thread.
+    constexpr size_t n_threads = 8;
+    constexpr size_t n_rounds = 50;
+    auto finished = std::atomic<size_t>();
+    auto threads = std::vector<std::thread>();
+    for(size_t t{0}; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            auto key = cbdc::make_buffer(t);
+            for(size_t r{0}; r < n_rounds; r++) {
+                auto res = broker->begin([&, key](auto begin_ret) {
+                    auto ticket_number = std::get<
+                        cbdc::parsec::ticket_machine::ticket_number_type>(
+                        begin_ret);
+                    auto lock_res = broker->try_lock(
+                        ticket_number,
+                        key,
+                        cbdc::parsec::broker::lock_type::write,
+                        [&, key, ticket_number](auto lock_ret) {
+                            if(!std::holds_alternative<cbdc::buffer>(
+                                   lock_ret)) {
+                                return;
+                            }
+                            auto updates
+                                = cbdc::parsec::broker::state_update_type();
+                            updates[key] = key;
+                            auto commit_res = broker->commit(
+                                ticket_number,
+                                updates,
+                                [&, ticket_number](auto commit_ret) {
+                                    if(commit_ret.has_value()) {
+                                        return;
+                                    }
+                                    auto finish_res = broker->finish(
+                                        ticket_number,
+                                        [&](auto finish_ret) {
+                                            if(!finish_ret.has_value()) {
+                                                finished++;
+                                            }
+                                        });
+                                    ASSERT_TRUE(finish_res);
+                                });
+                            ASSERT_TRUE(commit_res);
+                        });
+                    ASSERT_TRUE(lock_res);
+                });
+                ASSERT_TRUE(res);
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(finished, n_threads * n_rounds);
+
+    auto keys = std::vector<cbdc::buffer>();
+    for(size_t t{0}; t < n_threads; t++) {
+        keys.push_back(cbdc::make_buffer(t));
+    }
+    auto got = false;
+    ASSERT_TRUE(broker->read(keys, [&](auto read_ret) {
+        auto& vals = std::get<
+            std::vector<cbdc::parsec::runtime_locking_shard::committed_value>>(
+            read_ret);
+        ASSERT_EQ(vals.size(), n_threads);
+        for(size_t t{0}; t < n_threads; t++) {
+            ASSERT_EQ(vals[t].m_value, keys[t]);
+        }
+        got = true;
+    }));
+    ASSERT_TRUE(got);
+}
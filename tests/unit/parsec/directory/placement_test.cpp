@@ -0,0 +1,120 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/directory/impl.hpp"
+#include "util/common/hashmap.hpp"
+
+#include <gtest/gtest.h>
+#include <set>
+
+namespace {
+    auto make_key(uint64_t n, size_t len) -> cbdc::buffer {
+        auto ret = cbdc::buffer();
+        for(size_t i{0}; i < len; i++) {
+            auto byte = static_cast<unsigned char>(n >> (i % 8 * 8));
+            ret.append(&byte, 1);
+        }
+        return ret;
+    }
+
+    /// Returns a key made of the given prefix followed by a suffix.
+    auto with_suffix(const cbdc::buffer& prefix, uint64_t suffix)
+        -> cbdc::buffer {
+        auto ret = prefix;
+        ret.append(&suffix, sizeof(suffix));
+        return ret;
+    }
+}
+
+TEST(directory_test, default_placement_unchanged) {
+    constexpr size_t n_shards = 7;
+    auto directory = cbdc::parsec::directory::impl(n_shards);
+    auto hasher = cbdc::hashing::const_sip_hash<cbdc::buffer>();
+    for(uint64_t i{0}; i < 1000; i++) {
+        auto key = make_key(i, 1 + i % 40);
+        auto got = false;
+        ASSERT_TRUE(directory.key_location(key, [&](uint64_t shard) {
+            ASSERT_EQ(shard, hasher(key) % n_shards);
+            got = true;
+        }));
+        ASSERT_TRUE(got);
+    }
+}
+
+TEST(directory_test, hash_prefix_colocates) {
+    constexpr size_t n_shards = 8;
+    constexpr size_t prefix_len = 20;
+    auto placement
+        = cbdc::parsec::directory::hash_placement(n_shards, prefix_len);
+    auto shards = std::set<uint64_t>();
+    for(uint64_t i{0}; i < 100; i++) {
+        auto account = make_key(i, prefix_len);
+        auto shard = placement.shard_for(account);
+        ASSERT_LT(shard, n_shards);
+        shards.insert(shard);
+        for(uint64_t j{0}; j < 10; j++) {
+            ASSERT_EQ(placement.shard_for(with_suffix(account, j)), shard);
+        }
+    }
+    // Different accounts still spread across the shards
+    ASSERT_GT(shards.size(), 1UL);
+}
+
+TEST(directory_test, range_placement) {
+    auto even = cbdc::parsec::directory::range_placement(4);
+    ASSERT_EQ(even.shard_for(cbdc::buffer()), 0UL);
+    ASSERT_EQ(even.shard_for(cbdc::buffer::from_hex("00ff").value()), 0UL);
+    ASSERT_EQ(even.shard_for(cbdc::buffer::from_hex("3fff").value()), 0UL);
+    ASSERT_EQ(even.shard_for(cbdc::buffer::from_hex("40").value()), 1UL);
+    ASSERT_EQ(even.shard_for(cbdc::buffer::from_hex("80").value()), 2UL);
+    ASSERT_EQ(even.shard_for(cbdc::buffer::from_hex("ffff").value()), 3UL);
+
+    auto split = cbdc::parsec::directory::range_placement(
+        std::vector<cbdc::buffer>{cbdc::buffer::from_hex("1000").value(),
+                                  cbdc::buffer::from_hex("20").value()});
+    ASSERT_EQ(split.shard_for(cbdc::buffer::from_hex("10").value()), 0UL);
+    ASSERT_EQ(split.shard_for(cbdc::buffer::from_hex("1000").value()), 1UL);
+    ASSERT_EQ(split.shard_for(cbdc::buffer::from_hex("1fff").value()), 1UL);
+    ASSERT_EQ(split.shard_for(cbdc::buffer::from_hex("20").value()), 2UL);
+}
+
+TEST(directory_test, consistent_hash_placement) {
+    constexpr size_t n_shards = 8;
+    constexpr size_t n_keys = 10000;
+    auto placement
+        = cbdc::parsec::directory::consistent_hash_placement(n_shards);
+    auto grown
+        = cbdc::parsec::directory::consistent_hash_placement(n_shards + 1);
+    auto counts = std::vector<size_t>(n_shards);
+    size_t moved{0};
+    for(uint64_t i{0}; i < n_keys; i++) {
+        auto key = make_key(i, 32);
+        auto shard = placement.shard_for(key);
+        ASSERT_LT(shard, n_shards);
+        counts[shard]++;
+        auto new_shard = grown.shard_for(key);
+        // Keys only move to the new shard
+        if(new_shard != shard) {
+            ASSERT_EQ(new_shard, n_shards);
+            moved++;
+        }
+    }
+    for(auto count : counts) {
+        ASSERT_GT(count, n_keys / n_shards / 2);
+    }
+    ASSERT_LT(moved, n_keys / 4);
+}
+
+TEST(directory_test, parse_placement_type) {
+    ASSERT_EQ(cbdc::parsec::directory::parse_placement_type("hash"),
+              cbdc::parsec::directory::placement_type::hash);
+    ASSERT_EQ(cbdc::parsec::directory::parse_placement_type("range"),
+              cbdc::parsec::directory::placement_type::range);
+    ASSERT_EQ(
+        cbdc::parsec::directory::parse_placement_type("consistent_hash"),
+        cbdc::parsec::directory::placement_type::consistent_hash);
+    ASSERT_FALSE(
+        cbdc::parsec::directory::parse_placement_type("random").has_value());
+}
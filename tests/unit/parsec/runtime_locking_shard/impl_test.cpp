@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "parsec/runtime_locking_shard/impl.hpp"
+#include "util/serialization/format.hpp"
+#include "util/serialization/util.hpp"
 
 #include <future>
 #include <gtest/gtest.h>
@@ -723,3 +725,357 @@ TEST(runtime_locking_shard_test, upgrade_lock_test) {
         });
     ASSERT_TRUE(maybe_success);
 }
+
+TEST(runtime_locking_shard_test, try_lock_batch_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    auto key0 = cbdc::buffer::from_hex("aa").value();
+    auto key1 = cbdc::buffer::from_hex("bb").value();
+
+    auto maybe_success = shard.try_lock(
+        0,
+        0,
+        key0,
+        cbdc::parsec::runtime_locking_shard::lock_type::write,
+        true,
+        [&](cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_return_type ret) {
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::value_type>(ret));
+        });
+    ASSERT_TRUE(maybe_success);
+
+    // The batch waits for the older ticket to release its lock on key0
+    auto calls = 0;
+    maybe_success = shard.try_lock_batch(
+        1,
+        0,
+        {{key1, cbdc::parsec::runtime_locking_shard::lock_type::write},
+         {key0, cbdc::parsec::runtime_locking_shard::lock_type::read}},
+        true,
+        [&](cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_batch_return_type ret) {
+            calls++;
+            ASSERT_TRUE(std::holds_alternative<
+                        std::vector<cbdc::parsec::runtime_locking_shard::
+                                        value_type>>(ret));
+            auto& vals = std::get<
+                std::vector<cbdc::parsec::runtime_locking_shard::value_type>>(
+                ret);
+            ASSERT_EQ(vals.size(), 2UL);
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 0);
+
+    maybe_success = shard.rollback(
+        0,
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 1);
+
+    // Locks requested by the batch are held by the ticket
+    maybe_success = shard.try_lock(
+        1,
+        0,
+        key1,
+        cbdc::parsec::runtime_locking_shard::lock_type::write,
+        false,
+        [&](cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_return_type ret) {
+            ASSERT_TRUE(
+                std::holds_alternative<
+                    cbdc::parsec::runtime_locking_shard::shard_error>(ret));
+            ASSERT_EQ(
+                std::get<cbdc::parsec::runtime_locking_shard::shard_error>(ret)
+                    .m_error_code,
+                cbdc::parsec::runtime_locking_shard::error_code::lock_held);
+        });
+    ASSERT_TRUE(maybe_success);
+}
+
+TEST(runtime_locking_shard_test, read_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    auto key0 = cbdc::buffer::from_hex("aa").value();
+    auto key1 = cbdc::buffer::from_hex("bb").value();
+    auto val0 = cbdc::buffer::from_hex("cc").value();
+
+    auto maybe_success = shard.try_lock(
+        3,
+        0,
+        key0,
+        cbdc::parsec::runtime_locking_shard::lock_type::write,
+        true,
+        [](const cbdc::parsec::runtime_locking_shard::interface::
+               try_lock_return_type&) {});
+    ASSERT_TRUE(maybe_success);
+    maybe_success = shard.prepare(
+        3,
+        0,
+        {{key0, val0}},
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+
+    // Reads complete immediately while the key is locked, without seeing
+    // the prepared update
+    auto calls = 0;
+    maybe_success = shard.read(
+        {key0, key1},
+        [&](cbdc::parsec::runtime_locking_shard::interface::read_return_type
+                ret) {
+            calls++;
+            ASSERT_EQ(ret.size(), 2UL);
+            ASSERT_EQ(ret[0].m_value, cbdc::buffer());
+            ASSERT_EQ(ret[0].m_version, 0UL);
+            ASSERT_EQ(ret[1].m_value, cbdc::buffer());
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 1);
+
+    maybe_success = shard.commit(
+        3,
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.read(
+        {key0},
+        [&](cbdc::parsec::runtime_locking_shard::interface::read_return_type
+                ret) {
+            calls++;
+            ASSERT_EQ(ret.size(), 1UL);
+            ASSERT_EQ(ret[0].m_value, val0);
+            ASSERT_EQ(ret[0].m_version, 3UL);
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 2);
+
+    // Reads hold no locks, so the key can be locked again immediately
+    maybe_success = shard.try_lock(
+        4,
+        0,
+        key0,
+        cbdc::parsec::runtime_locking_shard::lock_type::write,
+        true,
+        [&](cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_return_type ret) {
+            calls++;
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::value_type>(ret));
+            ASSERT_EQ(
+                std::get<cbdc::parsec::runtime_locking_shard::value_type>(ret),
+                val0);
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 3);
+}
+
+TEST(runtime_locking_shard_test, one_phase_commit_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    auto key = cbdc::buffer::from_hex("aa").value();
+    auto val = cbdc::buffer::from_hex("bb").value();
+
+    // Updates to keys the ticket has not locked fail during the prepare
+    auto maybe_success = shard.try_lock(
+        0,
+        0,
+        key,
+        cbdc::parsec::runtime_locking_shard::lock_type::read,
+        true,
+        [](const cbdc::parsec::runtime_locking_shard::interface::
+               try_lock_return_type&) {});
+    ASSERT_TRUE(maybe_success);
+    maybe_success = shard.one_phase_commit(
+        0,
+        0,
+        {{key, val}},
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_TRUE(ret.has_value());
+            ASSERT_EQ(ret.value().m_error_code,
+                      cbdc::parsec::runtime_locking_shard::error_code::
+                          state_update_with_read_lock);
+        });
+    ASSERT_TRUE(maybe_success);
+    maybe_success = shard.rollback(
+        0,
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.try_lock(
+        1,
+        0,
+        key,
+        cbdc::parsec::runtime_locking_shard::lock_type::write,
+        true,
+        [](const cbdc::parsec::runtime_locking_shard::interface::
+               try_lock_return_type&) {});
+    ASSERT_TRUE(maybe_success);
+    maybe_success = shard.one_phase_commit(
+        1,
+        0,
+        {{key, val}},
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.read(
+        {key},
+        [&](cbdc::parsec::runtime_locking_shard::interface::read_return_type
+                ret) {
+            ASSERT_EQ(ret.size(), 1UL);
+            ASSERT_EQ(ret[0].m_value, val);
+            ASSERT_EQ(ret[0].m_version, 1UL);
+        });
+    ASSERT_TRUE(maybe_success);
+
+    maybe_success = shard.finish(
+        1,
+        [](const std::optional<
+            cbdc::parsec::runtime_locking_shard::shard_error>& ret) {
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+}
+
+TEST(runtime_locking_shard_test, load_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    auto key0 = cbdc::buffer::from_hex("aa").value();
+    auto key1 = cbdc::buffer::from_hex("bb").value();
+    auto val0 = cbdc::buffer::from_hex("cc").value();
+    auto val1 = cbdc::buffer::from_hex("dd").value();
+
+    auto calls = 0;
+    auto maybe_success = shard.load(
+        {{key0, val0}, {key1, val1}},
+        [&](cbdc::parsec::runtime_locking_shard::interface::load_return_type
+                ret) {
+            calls++;
+            ASSERT_FALSE(ret.has_value());
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 1);
+
+    maybe_success = shard.read(
+        {key0, key1},
+        [&](cbdc::parsec::runtime_locking_shard::interface::read_return_type
+                ret) {
+            calls++;
+            ASSERT_EQ(ret.size(), 2UL);
+            ASSERT_EQ(ret[0].m_value, val0);
+            ASSERT_EQ(ret[0].m_version, 0UL);
+            ASSERT_EQ(ret[1].m_value, val1);
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 2);
+
+    // Loaded values are visible to tickets locking the keys
+    maybe_success = shard.try_lock(
+        3,
+        0,
+        key1,
+        cbdc::parsec::runtime_locking_shard::lock_type::read,
+        true,
+        [&](cbdc::parsec::runtime_locking_shard::interface::
+                try_lock_return_type ret) {
+            calls++;
+            ASSERT_TRUE(std::holds_alternative<
+                        cbdc::parsec::runtime_locking_shard::value_type>(ret));
+            ASSERT_EQ(
+                std::get<cbdc::parsec::runtime_locking_shard::value_type>(ret),
+                val1);
+        });
+    ASSERT_TRUE(maybe_success);
+    ASSERT_EQ(calls, 3);
+}
+
+TEST(runtime_locking_shard_test, get_tickets_paged_test) {
+    auto log = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::trace);
+    auto shard = cbdc::parsec::runtime_locking_shard::impl(log);
+
+    // Tickets 1 to 7, alternately managed by brokers 0 and 1
+    constexpr cbdc::parsec::runtime_locking_shard::ticket_number_type
+        n_tickets = 7;
+    for(cbdc::parsec::runtime_locking_shard::ticket_number_type tn{1};
+        tn <= n_tickets;
+        tn++) {
+        auto maybe_success = shard.try_lock(
+            tn,
+            tn % 2,
+            cbdc::make_buffer(tn),
+            cbdc::parsec::runtime_locking_shard::lock_type::write,
+            true,
+            [](const cbdc::parsec::runtime_locking_shard::interface::
+                   try_lock_return_type&) {});
+        ASSERT_TRUE(maybe_success);
+    }
+
+    auto get_page = [&](cbdc::parsec::runtime_locking_shard::broker_id_type
+                            broker_id,
+                        cbdc::parsec::runtime_locking_shard::
+                            ticket_number_type start,
+                        size_t max_tickets) {
+        auto page = cbdc::parsec::runtime_locking_shard::tickets_page();
+        auto maybe_success = shard.get_tickets(
+            broker_id,
+            start,
+            max_tickets,
+            [&](cbdc::parsec::runtime_locking_shard::interface::
+                    get_tickets_return_type res) {
+                ASSERT_TRUE(std::holds_alternative<
+                            cbdc::parsec::runtime_locking_shard::
+                                tickets_page>(res));
+                page = std::get<
+                    cbdc::parsec::runtime_locking_shard::tickets_page>(res);
+            });
+        EXPECT_TRUE(maybe_success);
+        return page;
+    };
+
+    auto page = get_page(1, 0, 2);
+    ASSERT_EQ(page.m_tickets.size(), 2UL);
+    ASSERT_EQ(page.m_tickets[0].first, 1UL);
+    ASSERT_EQ(page.m_tickets[0].second,
+              cbdc::parsec::runtime_locking_shard::ticket_state::begun);
+    ASSERT_EQ(page.m_tickets[1].first, 3UL);
+    ASSERT_TRUE(page.m_more);
+
+    page = get_page(1, page.m_tickets.back().first + 1, 2);
+    ASSERT_EQ(page.m_tickets.size(), 2UL);
+    ASSERT_EQ(page.m_tickets[0].first, 5UL);
+    ASSERT_EQ(page.m_tickets[1].first, 7UL);
+    ASSERT_FALSE(page.m_more);
+
+    page = get_page(0, 0, n_tickets);
+    ASSERT_EQ(page.m_tickets.size(), 3UL);
+    ASSERT_EQ(page.m_tickets[2].first, 6UL);
+    ASSERT_FALSE(page.m_more);
+
+    page = get_page(0, n_tickets, n_tickets);
+    ASSERT_TRUE(page.m_tickets.empty());
+    ASSERT_FALSE(page.m_more);
+}
@@ -0,0 +1,180 @@
+// Copyright (c) 2022 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/runtime_locking_shard/format.hpp"
+#include "parsec/runtime_locking_shard/replicated_shard_client.hpp"
+#include "parsec/runtime_locking_shard/state_machine.hpp"
+#include "util/raft/util.hpp"
+#include "util/serialization/format.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <future>
+#include <gtest/gtest.h>
+
+using namespace cbdc::parsec::runtime_locking_shard;
+
+namespace {
+    /// Counts the raft log entries applied to the shard state machine.
+    class counting_state_machine : public state_machine {
+      public:
+        auto commit(uint64_t log_idx, nuraft::buffer& data)
+            -> nuraft::ptr<nuraft::buffer> override {
+            m_commits++;
+            return state_machine::commit(log_idx, data);
+        }
+
+        std::atomic<size_t> m_commits{0};
+    };
+}
+
+class replicated_shard_client_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        cleanup();
+        m_raft_params.election_timeout_lower_bound_ = 1500;
+        m_raft_params.election_timeout_upper_bound_ = 3000;
+        m_raft_params.heart_beat_interval_ = 1000;
+        m_raft_params.snapshot_distance_ = 0;
+        m_raft_params.max_append_size_ = 100000;
+    }
+
+    void TearDown() override {
+        cleanup();
+    }
+
+    static void cleanup() {
+        std::filesystem::remove_all(m_node_type + "_raft_log_0");
+        std::filesystem::remove_all(m_node_type + "_raft_config_0.dat");
+        std::filesystem::remove_all(m_node_type + "_raft_state_0.dat");
+    }
+
+    auto start_node() -> std::shared_ptr<cbdc::raft::node> {
+        auto node = std::make_shared<cbdc::raft::node>(
+            0,
+            std::vector<cbdc::network::endpoint_t>{{"127.0.0.1", 5010}},
+            m_node_type,
+            false,
+            m_sm,
+            1,
+            m_log,
+            nullptr);
+        if(!node->init(m_raft_params) || !node->is_leader()) {
+            return nullptr;
+        }
+        return node;
+    }
+
+    static auto make_state(const std::string& key, const std::string& val)
+        -> replicated_shard_interface::state_type {
+        auto ret = replicated_shard_interface::state_type();
+        ret.emplace(cbdc::buffer::from_hex(key).value(),
+                    cbdc::buffer::from_hex(val).value());
+        return ret;
+    }
+
+    static inline const std::string m_node_type{"rls_client_test"};
+    nuraft::raft_params m_raft_params;
+    std::shared_ptr<cbdc::logging::log> m_log{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::warn)};
+    std::shared_ptr<counting_state_machine> m_sm{
+        std::make_shared<counting_state_machine>()};
+};
+
+TEST_F(replicated_shard_client_test, batch_apply) {
+    auto batch = rpc::replicated_batch_request{
+        {rpc::replicated_prepare_request{1, 0, make_state("aa", "bb")},
+         rpc::commit_request{1},
+         rpc::commit_request{2},
+         rpc::finish_request{1}}};
+    auto buf = cbdc::make_buffer<rpc::replicated_request,
+                                 nuraft::ptr<nuraft::buffer>>(batch);
+
+    auto res_buf = m_sm->commit(1, *buf);
+    ASSERT_TRUE(res_buf);
+    auto res = cbdc::from_buffer<rpc::replicated_response>(*res_buf);
+    ASSERT_TRUE(res.has_value());
+    ASSERT_TRUE(std::holds_alternative<rpc::replicated_batch_response>(
+        res.value()));
+    auto& results = std::get<rpc::replicated_batch_response>(res.value());
+
+    // Each request gets its own result, in order, and a failed request
+    // does not stop the rest of the batch
+    ASSERT_EQ(results.size(), 4UL);
+    EXPECT_FALSE(results[0].has_value());
+    EXPECT_FALSE(results[1].has_value());
+    ASSERT_TRUE(results[2].has_value());
+    EXPECT_EQ(results[2].value(), error_code::unknown_ticket);
+    EXPECT_FALSE(results[3].has_value());
+
+    EXPECT_EQ(m_sm->last_commit_index(), 1UL);
+    EXPECT_EQ(m_sm->get_shard()->get_state(), make_state("aa", "bb"));
+    auto tickets = replicated_shard_interface::get_tickets_return_type();
+    ASSERT_TRUE(m_sm->get_shard()->get_tickets(
+        [&](replicated_shard_interface::get_tickets_return_type ret) {
+            tickets = std::move(ret);
+        }));
+    ASSERT_TRUE(
+        std::holds_alternative<replicated_shard_interface::tickets_type>(
+            tickets));
+    EXPECT_TRUE(
+        std::get<replicated_shard_interface::tickets_type>(tickets).empty());
+}
+
+TEST_F(replicated_shard_client_test, full_batch_is_one_entry) {
+    auto node = start_node();
+    ASSERT_TRUE(node);
+    // A delay far longer than the test, so only a full batch replicates
+    auto client = std::make_unique<replicated_shard_client>(
+        node,
+        replicated_shard_client_options{3, std::chrono::seconds(60)});
+
+    auto results
+        = std::vector<std::promise<replicated_shard_interface::return_type>>(
+            3);
+    auto callback = [&](size_t i) {
+        return [&, i](replicated_shard_interface::return_type ret) {
+            results[i].set_value(ret);
+        };
+    };
+    ASSERT_TRUE(client->prepare(1, 0, make_state("aa", "bb"), callback(0)));
+    ASSERT_TRUE(client->prepare(2, 0, make_state("cc", "dd"), callback(1)));
+    ASSERT_TRUE(client->commit(1, callback(2)));
+
+    for(auto& res : results) {
+        auto fut = res.get_future();
+        ASSERT_EQ(fut.wait_for(std::chrono::seconds(5)),
+                  std::future_status::ready);
+        EXPECT_FALSE(fut.get().has_value());
+    }
+    EXPECT_EQ(m_sm->m_commits.load(), 1UL);
+    EXPECT_EQ(m_sm->get_shard()->get_state(), make_state("aa", "bb"));
+
+    client.reset();
+    node->stop();
+}
+
+TEST_F(replicated_shard_client_test, partial_batch_after_delay) {
+    auto node = start_node();
+    ASSERT_TRUE(node);
+    auto client = std::make_unique<replicated_shard_client>(
+        node,
+        replicated_shard_client_options{1024,
+                                        std::chrono::milliseconds(10)});
+
+    auto result = std::promise<replicated_shard_interface::return_type>();
+    ASSERT_TRUE(
+        client->finish(7, [&](replicated_shard_interface::return_type ret) {
+            result.set_value(ret);
+        }));
+    auto fut = result.get_future();
+    ASSERT_EQ(fut.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    EXPECT_FALSE(fut.get().has_value());
+    EXPECT_EQ(m_sm->m_commits.load(), 1UL);
+
+    client.reset();
+    node->stop();
+}
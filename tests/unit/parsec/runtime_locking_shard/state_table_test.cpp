@@ -0,0 +1,148 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "parsec/runtime_locking_shard/state_table.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+    using cbdc::parsec::runtime_locking_shard::lock_type;
+    using cbdc::parsec::runtime_locking_shard::state_table;
+
+    auto make_buf(uint64_t n, size_t len) -> cbdc::buffer {
+        auto ret = cbdc::buffer();
+        for(size_t i{0}; i < len; i++) {
+            auto byte = static_cast<unsigned char>(n >> (i % 8 * 8));
+            ret.append(&byte, 1);
+        }
+        return ret;
+    }
+}
+
+TEST(state_table_test, insert_find) {
+    auto table = state_table();
+    ASSERT_TRUE(table.empty());
+
+    auto key = cbdc::buffer::from_hex("aa").value();
+    auto h = state_table::hash(key);
+    ASSERT_EQ(table.find(key, h), nullptr);
+
+    auto& elem = table.get_or_insert(key, h);
+    ASSERT_EQ(table.size(), 1UL);
+    ASSERT_EQ(table.find(key, h), &elem);
+    ASSERT_EQ(&table.get_or_insert(key, h), &elem);
+    ASSERT_EQ(table.value(elem), cbdc::buffer());
+    ASSERT_FALSE(elem.m_lock.m_writer.has_value());
+
+    auto other = cbdc::buffer::from_hex("aaaa").value();
+    ASSERT_EQ(table.find(other, state_table::hash(other)), nullptr);
+
+    auto empty_key = cbdc::buffer();
+    auto& empty_elem
+        = table.get_or_insert(empty_key, state_table::hash(empty_key));
+    ASSERT_NE(&empty_elem, &elem);
+    ASSERT_EQ(table.size(), 2UL);
+}
+
+TEST(state_table_test, grows_with_stable_elements) {
+    static constexpr uint64_t count = 50000;
+    auto table = state_table();
+    auto elems = std::vector<state_table::element_type*>();
+    for(uint64_t i{0}; i < count; i++) {
+        auto key = make_buf(i, 8 + i % 32);
+        auto& elem = table.get_or_insert(key, state_table::hash(key));
+        table.set_value(elem, make_buf(i, i % 16));
+        elem.m_lock.m_writer = i;
+        elems.push_back(&elem);
+    }
+    ASSERT_EQ(table.size(), count);
+    for(uint64_t i{0}; i < count; i++) {
+        auto key = make_buf(i, 8 + i % 32);
+        auto* elem = table.find(key, state_table::hash(key));
+        ASSERT_EQ(elem, elems[i]);
+        ASSERT_EQ(elem->m_lock.m_writer, i);
+        ASSERT_EQ(table.value(*elem), make_buf(i, i % 16));
+    }
+}
+
+TEST(state_table_test, value_updates) {
+    static constexpr uint64_t count = 100;
+    auto table = state_table();
+    for(uint64_t i{0}; i < count; i++) {
+        auto key = make_buf(i, 8);
+        table.get_or_insert(key, state_table::hash(key));
+    }
+
+    // Growing values are moved to the end of the arena, which is compacted
+    // as older copies accumulate. The other values must survive that.
+    for(size_t round{1}; round < 64; round++) {
+        for(uint64_t i{0}; i < count; i++) {
+            auto key = make_buf(i, 8);
+            auto& elem = *table.find(key, state_table::hash(key));
+            auto len = (i % 2 == 0) ? round * 4 : 64 - round;
+            table.set_value(elem, make_buf(i + round, len));
+        }
+        for(uint64_t i{0}; i < count; i++) {
+            auto key = make_buf(i, 8);
+            auto& elem = *table.find(key, state_table::hash(key));
+            auto len = (i % 2 == 0) ? round * 4 : 64 - round;
+            ASSERT_EQ(table.value(elem), make_buf(i + round, len));
+        }
+    }
+}
+
+TEST(state_table_test, lock_queue_order) {
+    auto lock = state_table::lock_state_type();
+    ASSERT_EQ(lock.find_queued(1), nullptr);
+
+    auto calls = std::vector<uint64_t>();
+    for(uint64_t tn : {5, 1, 3}) {
+        lock.enqueue({tn, lock_type::read, [&calls, tn](auto) {
+                          calls.push_back(tn);
+                      }});
+    }
+    ASSERT_EQ(lock.queue_size(), 3UL);
+    ASSERT_EQ(lock.front()->m_ticket_number, 1UL);
+    ASSERT_NE(lock.find_queued(3), nullptr);
+    ASSERT_EQ(lock.find_queued(4), nullptr);
+
+    auto req = lock.dequeue(3);
+    ASSERT_EQ(req.m_ticket_number, 3UL);
+    req.m_callback(cbdc::buffer());
+    ASSERT_EQ(calls, std::vector<uint64_t>{3});
+    ASSERT_EQ(lock.find_queued(3), nullptr);
+    ASSERT_EQ(lock.queue_size(), 2UL);
+
+    ASSERT_EQ(lock.pop_front().m_ticket_number, 1UL);
+    ASSERT_EQ(lock.front()->m_ticket_number, 5UL);
+    lock.enqueue({2, lock_type::write, [](auto) {}});
+    lock.enqueue({6, lock_type::write, [](auto) {}});
+    ASSERT_EQ(lock.front()->m_ticket_number, 2UL);
+    ASSERT_EQ(lock.dequeue(2).m_ticket_number, 2UL);
+    ASSERT_EQ(lock.pop_front().m_ticket_number, 5UL);
+    ASSERT_EQ(lock.pop_front().m_ticket_number, 6UL);
+    ASSERT_EQ(lock.front(), nullptr);
+    ASSERT_EQ(lock.queue_size(), 0UL);
+
+    lock.add_reader(1);
+    lock.add_reader(1);
+    lock.add_reader(2);
+    lock.add_reader(4);
+    ASSERT_EQ(lock.m_readers.size(), 3UL);
+    lock.remove_reader(2);
+    lock.remove_reader(7);
+    ASSERT_EQ(lock.m_readers.size(), 2UL);
+    ASSERT_EQ(lock.m_readers[0], 1UL);
+    ASSERT_EQ(lock.m_readers[1], 4UL);
+
+    lock.add_reader(3);
+    ASSERT_EQ(lock.younger_holders(2, lock_type::read).size(), 0UL);
+    ASSERT_EQ(lock.younger_holders(2, lock_type::write),
+              (std::vector<uint64_t>{3, 4}));
+    lock.m_writer = 5;
+    ASSERT_EQ(lock.younger_holders(4, lock_type::read),
+              std::vector<uint64_t>{5});
+    ASSERT_EQ(lock.younger_holders(6, lock_type::write).size(), 0UL);
+}
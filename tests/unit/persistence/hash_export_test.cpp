@@ -0,0 +1,90 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/persistence/hash_export.hpp"
+
+#include <filesystem>
+#include <gtest/gtest.h>
+
+namespace {
+    constexpr auto g_export_file = "hash_export_test.uhs";
+
+    auto make_hashes(size_t count) -> std::vector<cbdc::hash_t> {
+        auto ret = std::vector<cbdc::hash_t>(count);
+        for(size_t i{0}; i < count; i++) {
+            // Big-endian so the hashes are in ascending order
+            for(size_t j{0}; j < sizeof(i); j++) {
+                ret[i][sizeof(i) - 1 - j]
+                    = static_cast<unsigned char>(i >> (j * 8));
+            }
+            ret[i][sizeof(i)] = static_cast<unsigned char>(i * 7);
+        }
+        return ret;
+    }
+}
+
+class hash_export_test : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        std::filesystem::remove(g_export_file);
+        std::filesystem::remove(std::string(g_export_file) + ".tmp");
+    }
+};
+
+TEST_F(hash_export_test, round_trip) {
+    for(size_t count : {0, 1, 9, 10, 11, 1000}) {
+        std::filesystem::remove(g_export_file);
+        auto hashes = make_hashes(count);
+        auto writer = cbdc::persistence::hash_export_writer(g_export_file,
+                                                            count + 5,
+                                                            1,
+                                                            10);
+        ASSERT_TRUE(writer.open());
+        for(const auto& h : hashes) {
+            ASSERT_TRUE(writer.add(h));
+        }
+        // Nothing is visible until the export is finished
+        ASSERT_FALSE(std::filesystem::exists(g_export_file));
+        ASSERT_TRUE(writer.finish());
+        ASSERT_EQ(writer.count(), count);
+
+        auto got = cbdc::persistence::read_hash_export(g_export_file);
+        ASSERT_TRUE(got.has_value());
+        ASSERT_EQ(got->m_label, count + 5);
+        ASSERT_EQ(got->m_hashes, hashes);
+    }
+}
+
+TEST_F(hash_export_test, rejects_unsorted) {
+    auto hashes = make_hashes(3);
+    auto writer
+        = cbdc::persistence::hash_export_writer(g_export_file, 0, 1, 10);
+    ASSERT_TRUE(writer.open());
+    ASSERT_TRUE(writer.add(hashes[1]));
+    ASSERT_FALSE(writer.add(hashes[0]));
+    ASSERT_FALSE(writer.add(hashes[2]));
+    ASSERT_FALSE(writer.finish());
+    ASSERT_FALSE(std::filesystem::exists(g_export_file));
+}
+
+TEST_F(hash_export_test, rejects_truncated) {
+    auto writer
+        = cbdc::persistence::hash_export_writer(g_export_file, 0, 1, 10);
+    ASSERT_TRUE(writer.open());
+    for(const auto& h : make_hashes(25)) {
+        ASSERT_TRUE(writer.add(h));
+    }
+    ASSERT_TRUE(writer.finish());
+    ASSERT_TRUE(cbdc::persistence::read_hash_export(g_export_file));
+
+    auto size = std::filesystem::file_size(g_export_file);
+    for(auto len : {size - 1, size - sizeof(uint64_t), size / 2, 8UL}) {
+        std::filesystem::resize_file(g_export_file, len);
+        ASSERT_FALSE(
+            cbdc::persistence::read_hash_export(g_export_file).has_value());
+    }
+    ASSERT_FALSE(
+        cbdc::persistence::read_hash_export("missing_file").has_value());
+}
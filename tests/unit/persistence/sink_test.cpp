@@ -0,0 +1,519 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/persistence/factory.hpp"
+#include "util/persistence/file_blob_sink.hpp"
+#include "util/persistence/file_sink.hpp"
+#include "util/persistence/group_commit.hpp"
+#include "util/persistence/leveldb_sink.hpp"
+#include "util/persistence/null_sink.hpp"
+#include "util/persistence/write_behind_queue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+namespace {
+    /// Sink which keeps every appended record in memory.
+    class memory_sink final : public cbdc::persistence::sink {
+      public:
+        explicit memory_sink(size_t width, std::vector<cbdc::hash_t>& out)
+            : sink(width),
+              m_out(out) {}
+
+        auto append(const cbdc::hash_t* records, size_t count)
+            -> bool override {
+            if(m_failures > 0) {
+                m_failures--;
+                return false;
+            }
+            m_out.insert(m_out.end(), records, records + count * width());
+            m_appends++;
+            return true;
+        }
+
+        auto flush() -> bool override {
+            m_flushes++;
+            return true;
+        }
+
+        [[nodiscard]] auto retryable() const -> bool override {
+            return !m_permanent;
+        }
+
+        std::atomic<size_t> m_appends{0};
+        size_t m_flushes{0};
+        /// Number of upcoming appends to reject.
+        std::atomic<size_t> m_failures{0};
+        /// Whether rejected appends report a permanent failure.
+        std::atomic_bool m_permanent{false};
+
+      private:
+        std::vector<cbdc::hash_t>& m_out;
+    };
+}
+
+class persistence_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(m_dir);
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    std::shared_ptr<cbdc::logging::log> m_logger{
+        std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::fatal)};
+    static constexpr auto m_dir = "persistence_test_dir";
+    cbdc::hash_t m_a{'a'};
+    cbdc::hash_t m_b{'b'};
+    cbdc::hash_t m_c{'c'};
+    cbdc::hash_t m_d{'d'};
+};
+
+TEST_F(persistence_test, null_sink) {
+    auto sink = cbdc::persistence::null_sink(1);
+    ASSERT_EQ(sink.width(), 1UL);
+    ASSERT_TRUE(sink.append(&m_a, 1));
+    ASSERT_TRUE(sink.flush());
+}
+
+TEST_F(persistence_test, file_sink_append) {
+    const auto path = std::string(m_dir) + "/records";
+    auto sink = cbdc::persistence::file_sink(2, path);
+    ASSERT_FALSE(sink.append(&m_a, 1));
+    ASSERT_TRUE(sink.open());
+
+    auto records = std::vector<cbdc::hash_t>{m_a, m_b, m_c, m_d};
+    ASSERT_TRUE(sink.append(records.data(), 2));
+    ASSERT_TRUE(sink.flush());
+
+    auto in = std::ifstream(path, std::ios::binary);
+    auto contents = std::vector<unsigned char>(
+        std::istreambuf_iterator<char>(in),
+        std::istreambuf_iterator<char>());
+    ASSERT_EQ(contents.size(), records.size() * cbdc::hash_size);
+    for(size_t i{0}; i < records.size(); i++) {
+        ASSERT_TRUE(std::equal(records[i].begin(),
+                               records[i].end(),
+                               &contents[i * cbdc::hash_size]));
+    }
+}
+
+TEST_F(persistence_test, leveldb_sink_append) {
+    const auto path = std::string(m_dir) + "/db";
+    {
+        auto sink = cbdc::persistence::leveldb_sink(2, path);
+        ASSERT_FALSE(sink.open().has_value());
+        auto records = std::vector<cbdc::hash_t>{m_a, m_b, m_c, m_d};
+        ASSERT_TRUE(sink.append(records.data(), 2));
+        ASSERT_TRUE(sink.flush());
+    }
+
+    leveldb::DB* db_ptr{};
+    auto opt = leveldb::Options();
+    ASSERT_TRUE(leveldb::DB::Open(opt, path, &db_ptr).ok());
+    auto db = std::unique_ptr<leveldb::DB>(db_ptr);
+    auto val = std::string();
+    auto key = leveldb::Slice(reinterpret_cast<const char*>(m_c.data()),
+                              m_c.size());
+    ASSERT_TRUE(db->Get(leveldb::ReadOptions(), key, &val).ok());
+    ASSERT_EQ(val,
+              std::string(reinterpret_cast<const char*>(m_d.data()),
+                          m_d.size()));
+}
+
+TEST_F(persistence_test, make_sink_null) {
+    auto opts = cbdc::config::options();
+    opts.m_persistence_backend = cbdc::config::persistence_backend::null;
+    auto sink = cbdc::persistence::make_sink(opts, m_logger, "t", {"a"});
+    ASSERT_NE(sink, nullptr);
+    ASSERT_EQ(sink->width(), 1UL);
+}
+
+TEST_F(persistence_test, make_sink_file) {
+    auto opts = cbdc::config::options();
+    opts.m_persistence_backend = cbdc::config::persistence_backend::file;
+    opts.m_persistence_dir = std::string(m_dir) + "/nested";
+    auto sink
+        = cbdc::persistence::make_sink(opts, m_logger, "t", {"a", "b"});
+    ASSERT_NE(sink, nullptr);
+    ASSERT_EQ(sink->width(), 2UL);
+    ASSERT_TRUE(std::filesystem::exists(opts.m_persistence_dir + "/t"));
+}
+
+TEST_F(persistence_test, file_blob_sink_append) {
+    auto opts = cbdc::config::options();
+    opts.m_persistence_backend = cbdc::config::persistence_backend::file;
+    opts.m_persistence_dir = m_dir;
+    auto sink = cbdc::persistence::make_blob_sink(opts,
+                                                  m_logger,
+                                                  "t",
+                                                  "key",
+                                                  "blob");
+    ASSERT_NE(sink, nullptr);
+    auto keys = std::vector<cbdc::hash_t>{m_a, m_b};
+    auto blobs = std::vector<cbdc::buffer>(2);
+    blobs[0].append("abc", 3);
+    blobs[1].append("de", 2);
+    ASSERT_TRUE(sink->append(keys.data(), blobs.data(), 2));
+    ASSERT_TRUE(sink->append(&m_c, blobs.data(), 1));
+    sink.reset();
+
+    const auto path = std::string(m_dir) + "/t.blobs";
+    auto got_keys = std::vector<cbdc::hash_t>();
+    auto got_blobs = std::vector<cbdc::buffer>();
+    ASSERT_TRUE(cbdc::persistence::scan_blob_file(
+        path,
+        [&](const cbdc::hash_t& key, cbdc::buffer&& blob) {
+            got_keys.push_back(key);
+            got_blobs.push_back(std::move(blob));
+        }));
+    ASSERT_EQ(got_keys, (std::vector<cbdc::hash_t>{m_a, m_b, m_c}));
+    ASSERT_EQ(got_blobs.size(), 3UL);
+    ASSERT_EQ(got_blobs[0], blobs[0]);
+    ASSERT_EQ(got_blobs[1], blobs[1]);
+    ASSERT_EQ(got_blobs[2], blobs[0]);
+
+    // A torn final record fails the scan
+    std::filesystem::resize_file(path,
+                                 std::filesystem::file_size(path) - 1);
+    ASSERT_FALSE(cbdc::persistence::scan_blob_file(
+        path,
+        [](const cbdc::hash_t& /* key */, cbdc::buffer&& /* blob */) {}));
+
+    // So does a corrupt length, without allocating it
+    {
+        auto out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(m_a.data()),
+                  static_cast<std::streamsize>(m_a.size()));
+        const auto len = std::numeric_limits<uint64_t>::max();
+        out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    }
+    ASSERT_FALSE(cbdc::persistence::scan_blob_file(
+        path,
+        [](const cbdc::hash_t& /* key */, cbdc::buffer&& /* blob */) {}));
+
+    opts.m_persistence_backend = cbdc::config::persistence_backend::null;
+    ASSERT_EQ(cbdc::persistence::make_blob_sink(opts,
+                                                m_logger,
+                                                "t",
+                                                "key",
+                                                "blob"),
+              nullptr);
+}
+
+TEST_F(persistence_test, write_behind_queue_drains) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<memory_sink>(2, out);
+    auto* sink_ptr = sink.get();
+    auto queue = cbdc::persistence::write_behind_queue(m_logger,
+                                                       std::move(sink),
+                                                       10,
+                                                       1);
+    ASSERT_FALSE(queue.push_row({m_a, m_b}));
+    ASSERT_TRUE(queue.start());
+
+    ASSERT_FALSE(queue.push(m_a));
+    ASSERT_TRUE(queue.push_row({m_a, m_b}));
+    ASSERT_TRUE(queue.push_row({m_c, m_d}));
+    queue.stop();
+
+    ASSERT_EQ(queue.size(), 0UL);
+    ASSERT_EQ(out, (std::vector<cbdc::hash_t>{m_a, m_b, m_c, m_d}));
+    ASSERT_GE(sink_ptr->m_appends.load(), 2UL);
+    ASSERT_GE(sink_ptr->m_flushes, 1UL);
+    ASSERT_FALSE(queue.push_row({m_a, m_b}));
+}
+
+TEST_F(persistence_test, write_behind_queue_no_sink) {
+    auto queue
+        = cbdc::persistence::write_behind_queue(m_logger, nullptr, 10, 10);
+    ASSERT_FALSE(queue.start());
+    ASSERT_FALSE(queue.push(m_a));
+}
+
+TEST_F(persistence_test, write_behind_queue_push_records) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto queue = cbdc::persistence::write_behind_queue(
+        m_logger,
+        std::make_unique<memory_sink>(2, out),
+        10,
+        10);
+    ASSERT_TRUE(queue.start());
+
+    auto records = std::vector<cbdc::hash_t>{m_a, m_b, m_c, m_d};
+    ASSERT_TRUE(queue.push_records(records.data(), 2));
+    queue.stop();
+
+    ASSERT_EQ(out, records);
+    ASSERT_FALSE(queue.push_records(records.data(), 2));
+}
+
+TEST_F(persistence_test, write_behind_queue_retries) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<memory_sink>(1, out);
+    auto* sink_ptr = sink.get();
+    sink_ptr->m_failures = 3;
+    auto queue = cbdc::persistence::write_behind_queue(
+        m_logger,
+        std::move(sink),
+        10,
+        10,
+        {std::chrono::milliseconds(1), std::chrono::milliseconds(4)});
+    ASSERT_TRUE(queue.start());
+    ASSERT_TRUE(queue.push(m_a));
+
+    static constexpr auto max_wait = std::chrono::seconds(5);
+    const auto deadline = std::chrono::steady_clock::now() + max_wait;
+    while(sink_ptr->m_appends == 0
+          && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    queue.stop();
+
+    ASSERT_EQ(sink_ptr->m_failures.load(), 0UL);
+    ASSERT_EQ(out, (std::vector<cbdc::hash_t>{m_a}));
+}
+
+TEST_F(persistence_test, write_behind_queue_drops_rejected_batches) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<memory_sink>(1, out);
+    auto* sink_ptr = sink.get();
+    sink_ptr->m_failures = 1;
+    sink_ptr->m_permanent = true;
+    auto queue = cbdc::persistence::write_behind_queue(
+        m_logger,
+        std::move(sink),
+        10,
+        10,
+        {std::chrono::milliseconds(1), std::chrono::milliseconds(1), 2});
+    ASSERT_TRUE(queue.start());
+    // A permanent failure drops the batch without retrying it
+    ASSERT_TRUE(queue.push(m_a));
+
+    static constexpr auto max_wait = std::chrono::seconds(5);
+    auto deadline = std::chrono::steady_clock::now() + max_wait;
+    while(sink_ptr->m_failures != 0
+          && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // So does a transient one, once it reaches the attempt limit
+    sink_ptr->m_permanent = false;
+    sink_ptr->m_failures = 2;
+    ASSERT_TRUE(queue.push(m_b));
+    deadline = std::chrono::steady_clock::now() + max_wait;
+    while(sink_ptr->m_failures != 0
+          && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(queue.push(m_c));
+    deadline = std::chrono::steady_clock::now() + max_wait;
+    while(sink_ptr->m_appends == 0
+          && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    queue.stop();
+
+    ASSERT_EQ(out, (std::vector<cbdc::hash_t>{m_c}));
+}
+
+TEST_F(persistence_test, write_behind_queue_drops_on_stop) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<memory_sink>(1, out);
+    sink->m_failures = std::numeric_limits<size_t>::max();
+    auto queue = cbdc::persistence::write_behind_queue(
+        m_logger,
+        std::move(sink),
+        10,
+        10,
+        {std::chrono::milliseconds(1), std::chrono::milliseconds(1)});
+    ASSERT_TRUE(queue.start());
+    ASSERT_TRUE(queue.push(m_a));
+    queue.stop();
+
+    ASSERT_TRUE(out.empty());
+    ASSERT_EQ(queue.size(), 0UL);
+}
+
+TEST_F(persistence_test, queue_buffers_while_connecting) {
+    // Connecting blocks until released, as with a slow database
+    class slow_sink final : public cbdc::persistence::sink {
+      public:
+        explicit slow_sink(std::vector<cbdc::hash_t>& out)
+            : sink(1),
+              m_out(out) {}
+
+        auto connect() -> bool override {
+            std::unique_lock l(m_mut);
+            m_cv.wait(l, [&]() {
+                return m_released;
+            });
+            m_connected = true;
+            return true;
+        }
+
+        auto append(const cbdc::hash_t* records, size_t count)
+            -> bool override {
+            if(!m_connected) {
+                return false;
+            }
+            m_out.insert(m_out.end(), records, records + count);
+            return true;
+        }
+
+        auto flush() -> bool override {
+            return true;
+        }
+
+        void release() {
+            {
+                std::unique_lock l(m_mut);
+                m_released = true;
+            }
+            m_cv.notify_one();
+        }
+
+      private:
+        std::vector<cbdc::hash_t>& m_out;
+        std::mutex m_mut;
+        std::condition_variable m_cv;
+        bool m_released{false};
+        std::atomic<bool> m_connected{false};
+    };
+
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<slow_sink>(out);
+    auto* sink_ptr = sink.get();
+    auto queue = cbdc::persistence::write_behind_queue(
+        m_logger,
+        std::move(sink),
+        10,
+        10,
+        {std::chrono::milliseconds(1), std::chrono::milliseconds(1)});
+    ASSERT_TRUE(queue.start());
+    ASSERT_TRUE(queue.push(m_a));
+    ASSERT_TRUE(queue.push(m_b));
+    ASSERT_EQ(queue.size(), 2UL);
+
+    sink_ptr->release();
+    queue.stop();
+    ASSERT_EQ(out, (std::vector<cbdc::hash_t>{m_a, m_b}));
+}
+
+TEST_F(persistence_test, group_commit_shares_commit) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<memory_sink>(2, out);
+    auto* sink_ptr = sink.get();
+    // The window outlasts the test, so only a full group triggers it.
+    auto group = cbdc::persistence::group_commit(m_logger,
+                                                 std::move(sink),
+                                                 std::chrono::seconds(30),
+                                                 2);
+    auto records = std::vector<cbdc::hash_t>{m_a, m_b, m_c, m_d};
+    ASSERT_FALSE(group.submit(records.data()).get());
+    ASSERT_TRUE(group.start());
+    ASSERT_FALSE(group.submit(m_a).get());
+
+    auto first = group.submit(&records[0]);
+    auto second = group.submit(&records[2]);
+    ASSERT_TRUE(first.get());
+    ASSERT_TRUE(second.get());
+    group.stop();
+
+    ASSERT_EQ(out, records);
+    ASSERT_EQ(sink_ptr->m_appends.load(), 1UL);
+    ASSERT_EQ(sink_ptr->m_flushes, 1UL);
+}
+
+TEST_F(persistence_test, group_commit_fails_group) {
+    auto out = std::vector<cbdc::hash_t>();
+    auto sink = std::make_unique<memory_sink>(1, out);
+    sink->m_failures = 1;
+    auto group = cbdc::persistence::group_commit(m_logger,
+                                                 std::move(sink),
+                                                 std::chrono::microseconds(0),
+                                                 10);
+    ASSERT_TRUE(group.start());
+    ASSERT_FALSE(group.submit(m_a).get());
+    ASSERT_TRUE(group.submit(m_b).get());
+    group.stop();
+
+    ASSERT_EQ(out, (std::vector<cbdc::hash_t>{m_b}));
+}
+
+TEST_F(persistence_test, group_commit_overlaps_groups) {
+    // Each append waits until both sinks are appending, which only
+    // happens if two groups are in flight at once.
+    class rendezvous_sink final : public cbdc::persistence::sink {
+      public:
+        explicit rendezvous_sink(std::atomic<size_t>& entered)
+            : sink(1),
+              m_entered(entered) {}
+
+        auto append(const cbdc::hash_t* /* records */, size_t /* count */)
+            -> bool override {
+            m_entered++;
+            auto deadline
+                = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while(m_entered < 2) {
+                if(std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        auto flush() -> bool override {
+            return true;
+        }
+
+      private:
+        std::atomic<size_t>& m_entered;
+    };
+
+    auto entered = std::atomic<size_t>();
+    auto sinks = std::vector<std::unique_ptr<cbdc::persistence::sink>>();
+    sinks.emplace_back(std::make_unique<rendezvous_sink>(entered));
+    sinks.emplace_back(std::make_unique<rendezvous_sink>(entered));
+    auto group = cbdc::persistence::group_commit(m_logger,
+                                                 std::move(sinks),
+                                                 std::chrono::microseconds(0),
+                                                 1);
+    ASSERT_TRUE(group.start());
+
+    auto committed = std::atomic<size_t>();
+    auto cb = [&](bool ok) {
+        if(ok) {
+            committed++;
+        }
+    };
+    group.submit(&m_a, cb);
+    group.submit(&m_b, cb);
+    group.stop();
+    ASSERT_EQ(committed, 2UL);
+}
+
+TEST_F(persistence_test, group_commit_no_sink) {
+    auto group = cbdc::persistence::group_commit(m_logger,
+                                                 nullptr,
+                                                 std::chrono::microseconds(0),
+                                                 10);
+    ASSERT_FALSE(group.start());
+    ASSERT_FALSE(group.submit(m_a).get());
+    auto called = std::optional<bool>();
+    group.submit(&m_a, [&](bool ok) {
+        called = ok;
+    });
+    ASSERT_EQ(called, false);
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/mapped_hash_array.hpp"
+#include "util/persistence/hash_export.hpp"
+#include "util/persistence/supply_audit.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+class supply_audit_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Shard 0 owns first bytes 0-127 and shard 1 owns 128-255
+        m_sources.resize(2);
+        m_sources[0].m_range = {0, 127};
+        m_sources[1].m_range = {128, 255};
+        for(size_t i{0}; i < m_sources.size(); i++) {
+            m_sources[i].m_export_path
+                = "supply_audit_test_export_" + std::to_string(i);
+            m_sources[i].m_preseed_path
+                = "supply_audit_test_preseed_" + std::to_string(i);
+        }
+    }
+
+    void TearDown() override {
+        for(const auto& src : m_sources) {
+            std::filesystem::remove(src.m_export_path);
+            std::filesystem::remove(src.m_preseed_path);
+        }
+    }
+
+    /// Returns count hashes in ascending order, starting with first_byte.
+    static auto make_hashes(uint8_t first_byte, size_t count)
+        -> std::vector<cbdc::hash_t> {
+        auto ret = std::vector<cbdc::hash_t>(count);
+        for(size_t i{0}; i < count; i++) {
+            ret[i][0] = first_byte;
+            ret[i][1] = static_cast<unsigned char>(i);
+        }
+        return ret;
+    }
+
+    static void write_export(const std::string& path,
+                             uint64_t label,
+                             const std::vector<cbdc::hash_t>& hashes) {
+        auto writer = cbdc::persistence::hash_export_writer(path, label);
+        ASSERT_TRUE(writer.open());
+        for(const auto& h : hashes) {
+            ASSERT_TRUE(writer.add(h));
+        }
+        ASSERT_TRUE(writer.finish());
+    }
+
+    static void write_preseed(const std::string& path, size_t count) {
+        auto out = std::ofstream(path, std::ios::binary);
+        ASSERT_TRUE(cbdc::mapped_hash_array::write_header(out, count));
+        auto hashes = make_hashes(0, count);
+        out.write(reinterpret_cast<const char*>(hashes.data()),
+                  static_cast<std::streamsize>(count * sizeof(cbdc::hash_t)));
+    }
+
+    std::vector<cbdc::persistence::shard_audit_source> m_sources;
+    cbdc::thread_pool m_pool{2};
+    // Shard 0 created 6 and spent 4, shard 1 created 3 and spent 1
+    cbdc::persistence::record_counter m_counter
+        = [](const std::string& table, const cbdc::config::shard_range_t& r)
+        -> std::optional<uint64_t> {
+        const auto created = table == cbdc::persistence::shard_created_table;
+        if(r.first == 0) {
+            return created ? 6 : 4;
+        }
+        return created ? 3 : 1;
+    };
+};
+
+TEST_F(supply_audit_test, balanced) {
+    write_export(m_sources[0].m_export_path, 7, make_hashes(1, 12));
+    write_export(m_sources[1].m_export_path, 9, make_hashes(200, 2));
+    write_preseed(m_sources[0].m_preseed_path, 10);
+    m_sources[1].m_preseed_path.clear();
+
+    auto res
+        = cbdc::persistence::audit_supply(m_sources, m_counter, &m_pool);
+    ASSERT_EQ(res.size(), 2UL);
+    ASSERT_FALSE(res[0].m_error.has_value());
+    ASSERT_EQ(res[0].m_label, 7UL);
+    ASSERT_EQ(res[0].m_exported, 12UL);
+    ASSERT_EQ(res[0].m_seeded, 10UL);
+    ASSERT_EQ(res[0].m_created, 6UL);
+    ASSERT_EQ(res[0].m_spent, 4UL);
+    ASSERT_TRUE(res[0].balanced());
+    ASSERT_EQ(res[1].m_label, 9UL);
+    ASSERT_EQ(res[1].m_exported, 2UL);
+    ASSERT_EQ(res[1].m_seeded, 0UL);
+    ASSERT_TRUE(res[1].balanced());
+}
+
+TEST_F(supply_audit_test, detects_mismatches) {
+    // Shard 0 is missing an output, shard 1 holds one outside its range
+    write_export(m_sources[0].m_export_path, 7, make_hashes(1, 11));
+    auto hashes = make_hashes(100, 1);
+    auto in_range = make_hashes(200, 1);
+    hashes.insert(hashes.end(), in_range.begin(), in_range.end());
+    write_export(m_sources[1].m_export_path, 9, hashes);
+    write_preseed(m_sources[0].m_preseed_path, 10);
+    m_sources[1].m_preseed_path.clear();
+
+    auto res
+        = cbdc::persistence::audit_supply(m_sources, m_counter, &m_pool);
+    ASSERT_FALSE(res[0].balanced());
+    ASSERT_EQ(res[1].m_out_of_range, 1UL);
+    ASSERT_FALSE(res[1].balanced());
+
+    // Without records, only the ranges are checked
+    res = cbdc::persistence::audit_supply(m_sources, {}, nullptr);
+    ASSERT_FALSE(res[0].m_created.has_value());
+    ASSERT_TRUE(res[0].balanced());
+    ASSERT_FALSE(res[1].balanced());
+}
+
+TEST_F(supply_audit_test, missing_inputs) {
+    write_export(m_sources[0].m_export_path, 7, make_hashes(1, 12));
+
+    auto res
+        = cbdc::persistence::audit_supply(m_sources, m_counter, &m_pool);
+    // Shard 0's preseed file and shard 1's export are missing
+    ASSERT_TRUE(res[0].m_error.has_value());
+    ASSERT_FALSE(res[0].balanced());
+    ASSERT_TRUE(res[1].m_error.has_value());
+    ASSERT_FALSE(res[1].balanced());
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/raft/batching_replicator.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+namespace {
+    auto make_entry(const std::string& s) -> nuraft::ptr<nuraft::buffer> {
+        auto buf = nuraft::buffer::alloc(s.size());
+        std::memcpy(buf->data_begin(), s.data(), s.size());
+        return buf;
+    }
+
+    auto to_string(const nuraft::buffer& buf) -> std::string {
+        return {reinterpret_cast<const char*>(buf.data_begin()), buf.size()};
+    }
+}
+
+TEST(batching_replicator_test, entry_round_trip) {
+    auto prefix = cbdc::buffer();
+    auto marker = uint8_t{0xFF};
+    prefix.append(&marker, sizeof(marker));
+    auto entries = std::vector<nuraft::ptr<nuraft::buffer>>{make_entry("a"),
+                                                            make_entry(""),
+                                                            make_entry("xyz")};
+    auto batch = cbdc::raft::make_batch_entry(prefix, entries);
+    ASSERT_EQ(batch->data_begin()[0], marker);
+
+    auto read = cbdc::raft::read_batch_entry(*batch, prefix.size());
+    ASSERT_TRUE(read.has_value());
+    ASSERT_EQ(read->size(), entries.size());
+    for(size_t i{0}; i < entries.size(); i++) {
+        ASSERT_EQ(to_string(*(*read)[i]), to_string(*entries[i]));
+    }
+}
+
+TEST(batching_replicator_test, truncated_entry) {
+    auto entries = std::vector<nuraft::ptr<nuraft::buffer>>{make_entry("abc"),
+                                                            make_entry("de")};
+    auto batch = cbdc::raft::make_batch_entry(cbdc::buffer(), entries);
+    auto truncated = nuraft::buffer::alloc(batch->size() - 1);
+    std::memcpy(truncated->data_begin(),
+                batch->data_begin(),
+                truncated->size());
+    ASSERT_FALSE(cbdc::raft::read_batch_entry(*truncated, 0).has_value());
+    ASSERT_FALSE(cbdc::raft::read_batch_entry(*batch, batch->size() + 1)
+                     .has_value());
+}
+
+TEST(batching_replicator_test, result_round_trip) {
+    auto results
+        = std::vector<nuraft::ptr<nuraft::buffer>>{make_entry("ok"),
+                                                   nullptr,
+                                                   make_entry("")};
+    auto combined = cbdc::raft::make_batch_result(results);
+    auto read = cbdc::raft::read_batch_result(*combined);
+    ASSERT_TRUE(read.has_value());
+    ASSERT_EQ(read->size(), results.size());
+    ASSERT_EQ(to_string(*(*read)[0]), "ok");
+    ASSERT_EQ((*read)[1], nullptr);
+    ASSERT_EQ(to_string(*(*read)[2]), "");
+
+    auto truncated = nuraft::buffer::alloc(combined->size() - 1);
+    std::memcpy(truncated->data_begin(),
+                combined->data_begin(),
+                truncated->size());
+    ASSERT_FALSE(cbdc::raft::read_batch_result(*truncated).has_value());
+}
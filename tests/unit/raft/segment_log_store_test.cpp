@@ -0,0 +1,199 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/raft/segment_log_store.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+class segment_log_store_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(m_dir);
+        for(uint64_t i{0}; i < 20; i++) {
+            auto buf = nuraft::buffer::alloc(sizeof(i));
+            std::memcpy(buf->data_begin(), &i, sizeof(i));
+            m_entries.push_back(
+                nuraft::cs_new<nuraft::log_entry>(100 + i, buf));
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    [[nodiscard]] auto segment_count() const -> size_t {
+        return static_cast<size_t>(
+            std::distance(std::filesystem::directory_iterator(m_dir),
+                          std::filesystem::directory_iterator()));
+    }
+
+    static constexpr auto m_dir = "segment_log_store_test_dir";
+    /// Small enough that each segment holds only a few entries.
+    static constexpr size_t m_segment_bytes = 256;
+    std::vector<nuraft::ptr<nuraft::log_entry>> m_entries;
+};
+
+TEST_F(segment_log_store_test, append_read) {
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store.load(m_dir));
+    ASSERT_EQ(store.next_slot(), 1UL);
+    ASSERT_EQ(store.start_index(), 1UL);
+    ASSERT_EQ(store.last_entry()->get_term(), 0UL);
+
+    for(size_t i{0}; i < m_entries.size(); i++) {
+        ASSERT_EQ(store.append(m_entries[i]), i + 1);
+    }
+    ASSERT_GT(segment_count(), 1UL);
+    ASSERT_EQ(store.next_slot(), m_entries.size() + 1);
+    ASSERT_EQ(store.last_entry()->get_term(), m_entries.back()->get_term());
+    ASSERT_TRUE(store.entry_at(m_entries.size() + 1)->is_buf_null());
+
+    auto range = store.log_entries(3, 15);
+    ASSERT_EQ(range->size(), 12UL);
+    for(size_t i{0}; i < range->size(); i++) {
+        ASSERT_EQ((*range)[i]->get_term(), m_entries[i + 2]->get_term());
+    }
+}
+
+TEST_F(segment_log_store_test, reload) {
+    {
+        auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+        ASSERT_TRUE(store.load(m_dir));
+        for(auto& entry : m_entries) {
+            store.append(entry);
+        }
+        ASSERT_TRUE(store.flush());
+    }
+
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store.load(m_dir));
+    ASSERT_EQ(store.start_index(), 1UL);
+    ASSERT_EQ(store.next_slot(), m_entries.size() + 1);
+    for(size_t i{0}; i < m_entries.size(); i++) {
+        ASSERT_EQ(store.term_at(i + 1), m_entries[i]->get_term());
+    }
+}
+
+TEST_F(segment_log_store_test, write_at) {
+    {
+        auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+        ASSERT_TRUE(store.load(m_dir));
+        for(auto& entry : m_entries) {
+            store.append(entry);
+        }
+        ASSERT_TRUE(store.flush());
+
+        store.write_at(5, m_entries[0]);
+        ASSERT_EQ(store.next_slot(), 6UL);
+        ASSERT_EQ(store.term_at(5), m_entries[0]->get_term());
+        ASSERT_TRUE(store.entry_at(6)->is_buf_null());
+        ASSERT_EQ(store.append(m_entries[1]), 6UL);
+        ASSERT_TRUE(store.flush());
+    }
+
+    // Truncated entries must not reappear after the new ones
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store.load(m_dir));
+    ASSERT_EQ(store.next_slot(), 7UL);
+    ASSERT_EQ(store.term_at(5), m_entries[0]->get_term());
+    ASSERT_EQ(store.term_at(6), m_entries[1]->get_term());
+}
+
+TEST_F(segment_log_store_test, compact) {
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store.load(m_dir));
+    for(auto& entry : m_entries) {
+        store.append(entry);
+    }
+    const auto segments = segment_count();
+
+    ASSERT_TRUE(store.compact(10));
+    ASSERT_EQ(store.start_index(), 11UL);
+    ASSERT_EQ(store.next_slot(), m_entries.size() + 1);
+    ASSERT_LT(segment_count(), segments);
+    ASSERT_TRUE(store.entry_at(10)->is_buf_null());
+    ASSERT_EQ(store.term_at(11), m_entries[10]->get_term());
+
+    // Compacting past the end of the log empties it
+    ASSERT_TRUE(store.compact(30));
+    ASSERT_EQ(segment_count(), 0UL);
+    ASSERT_EQ(store.start_index(), 31UL);
+    ASSERT_EQ(store.next_slot(), 31UL);
+    ASSERT_EQ(store.append(m_entries[0]), 31UL);
+    ASSERT_TRUE(store.flush());
+
+    auto store2 = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store2.load(m_dir));
+    ASSERT_EQ(store2.start_index(), 31UL);
+    ASSERT_EQ(store2.next_slot(), 32UL);
+}
+
+TEST_F(segment_log_store_test, pack_apply) {
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store.load(m_dir));
+    for(auto& entry : m_entries) {
+        store.append(entry);
+    }
+
+    auto pack = store.pack(4, 10);
+    store.write_at(3, m_entries[0]);
+    ASSERT_EQ(store.next_slot(), 4UL);
+
+    store.apply_pack(4, *pack);
+    ASSERT_EQ(store.next_slot(), 14UL);
+    ASSERT_EQ(store.term_at(3), m_entries[0]->get_term());
+    for(uint64_t i{4}; i < 14; i++) {
+        ASSERT_EQ(store.term_at(i), m_entries[i - 1]->get_term());
+    }
+
+    // A pack which does not continue the log replaces it
+    store.apply_pack(40, *pack);
+    ASSERT_EQ(store.start_index(), 40UL);
+    ASSERT_EQ(store.next_slot(), 50UL);
+    ASSERT_EQ(store.term_at(40), m_entries[3]->get_term());
+}
+
+TEST_F(segment_log_store_test, torn_record) {
+    {
+        auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+        ASSERT_TRUE(store.load(m_dir));
+        for(size_t i{0}; i < 3; i++) {
+            store.append(m_entries[i]);
+        }
+        ASSERT_TRUE(store.flush());
+    }
+    ASSERT_EQ(segment_count(), 1UL);
+
+    // Corrupt the last byte of the third record's payload
+    const auto path
+        = std::filesystem::directory_iterator(m_dir)->path().string();
+    const auto record_size = 3 * sizeof(uint64_t)
+                           + m_entries[0]->serialize()->size();
+    {
+        auto file = std::fstream(path,
+                                 std::ios::in | std::ios::out
+                                     | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(3 * record_size - 1));
+        file.put('\xff');
+    }
+
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_TRUE(store.load(m_dir));
+    ASSERT_EQ(store.next_slot(), 3UL);
+    ASSERT_EQ(store.append(m_entries[5]), 3UL);
+    ASSERT_EQ(store.term_at(3), m_entries[5]->get_term());
+}
+
+TEST_F(segment_log_store_test, load_file) {
+    {
+        auto file = std::ofstream(m_dir);
+        file << "not a directory";
+    }
+    auto store = cbdc::raft::segment_log_store(m_segment_bytes);
+    ASSERT_FALSE(store.load(m_dir));
+}
@@ -199,6 +199,17 @@ class raft_test : public ::testing::Test {
         for(size_t i{0}; i < nodes.size(); i++) {
             ASSERT_EQ(nodes[i]->get_sm(), sms[i].get());
         }
+
+        // Only the leader has leadership to hand over
+        static constexpr auto transfer_timeout = std::chrono::seconds(10);
+        ASSERT_TRUE(nodes[1]->transfer_leadership(transfer_timeout));
+        ASSERT_TRUE(nodes[0]->is_leader());
+        ASSERT_TRUE(nodes[0]->transfer_leadership(transfer_timeout));
+        ASSERT_FALSE(nodes[0]->is_leader());
+        auto leader = nodes[0]->leader_id();
+        ASSERT_TRUE(leader.has_value());
+        ASSERT_NE(leader.value(), 0UL);
+        ASSERT_TRUE(nodes[leader.value()]->is_leader());
     }
 
     void basic_raft_cluster_fail_test() {
@@ -557,6 +568,73 @@ TEST_F(raft_test, log_store_write_at) {
     ASSERT_TRUE(entry->is_buf_null());
 }
 
+TEST_F(raft_test, log_store_write_at_flushed) {
+    {
+        auto log_store = cbdc::raft::log_store();
+        ASSERT_TRUE(log_store.load(m_db_dir));
+
+        for(auto& entry : m_dummy_log_entries) {
+            log_store.append(entry);
+        }
+        ASSERT_TRUE(log_store.flush());
+
+        // Truncate entries which are already on disk, then append past the
+        // truncation point before flushing again
+        log_store.write_at(3, m_dummy_log_entries[5]);
+        ASSERT_EQ(log_store.append(m_dummy_log_entries[6]), 4UL);
+        ASSERT_EQ(log_store.term_at(3), m_dummy_log_entries[5]->get_term());
+        ASSERT_TRUE(log_store.entry_at(5)->is_buf_null());
+        ASSERT_TRUE(log_store.flush());
+    }
+    {
+        auto log_store2 = cbdc::raft::log_store();
+        ASSERT_TRUE(log_store2.load(m_db_dir));
+        ASSERT_EQ(log_store2.next_slot(), 5UL);
+        ASSERT_EQ(log_store2.term_at(3), m_dummy_log_entries[5]->get_term());
+        ASSERT_EQ(log_store2.last_entry()->get_term(),
+                  m_dummy_log_entries[6]->get_term());
+        auto range = log_store2.log_entries(1, 5);
+        ASSERT_EQ(range->size(), 4UL);
+        ASSERT_EQ((*range)[1]->get_term(), m_dummy_log_entries[1]->get_term());
+    }
+}
+
+TEST_F(raft_test, log_store_cache) {
+    // Room for the three most recent entries
+    const auto entry_size = m_dummy_log_entries[0]->serialize()->size();
+    auto log_store = cbdc::raft::log_store(entry_size * 3);
+    ASSERT_TRUE(log_store.load(m_db_dir));
+
+    for(auto& entry : m_dummy_log_entries) {
+        log_store.append(entry);
+    }
+    ASSERT_TRUE(log_store.flush());
+
+    // Recent entries are served from memory, older ones from the database
+    const auto last = m_dummy_log_entries.size();
+    ASSERT_EQ(log_store.entry_at(last), m_dummy_log_entries[last - 1]);
+    ASSERT_EQ(log_store.last_entry(), m_dummy_log_entries[last - 1]);
+    ASSERT_NE(log_store.entry_at(1), m_dummy_log_entries[0]);
+    ASSERT_EQ(log_store.term_at(1), m_dummy_log_entries[0]->get_term());
+
+    auto range = log_store.log_entries(last - 4, last + 1);
+    ASSERT_EQ(range->size(), 5UL);
+    for(size_t i{0}; i < range->size(); i++) {
+        ASSERT_EQ((*range)[i]->get_term(),
+                  m_dummy_log_entries[last - 5 + i]->get_term());
+    }
+    ASSERT_EQ((*range)[4], m_dummy_log_entries[last - 1]);
+
+    log_store.write_at(last - 1, m_dummy_log_entries[0]);
+    ASSERT_EQ(log_store.next_slot(), last);
+    ASSERT_EQ(log_store.entry_at(last - 1), m_dummy_log_entries[0]);
+    ASSERT_TRUE(log_store.entry_at(last)->is_buf_null());
+
+    ASSERT_TRUE(log_store.compact(last - 1));
+    ASSERT_EQ(log_store.start_index(), last);
+    ASSERT_TRUE(log_store.entry_at(last - 1)->is_buf_null());
+}
+
 TEST_F(raft_test, log_store_pack_apply) {
     auto log_store = cbdc::raft::log_store();
     ASSERT_TRUE(log_store.load(m_db_dir));
@@ -0,0 +1,77 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/rpc/awaitable.hpp"
+#include "util/rpc/tcp_client.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
+
+#include <future>
+#include <gtest/gtest.h>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+namespace {
+    using request = int64_t;
+    using response = int64_t;
+    using client_type = cbdc::rpc::tcp_client<request, response>;
+
+    auto add_twice(client_type& client, int64_t val, cbdc::strand* s)
+        -> cbdc::rpc::task<std::optional<int64_t>> {
+        auto first = co_await cbdc::rpc::async_call(client, val, s);
+        if(!first.has_value()) {
+            co_return std::nullopt;
+        }
+        co_return co_await cbdc::rpc::async_call(client, first.value(), s);
+    }
+}
+
+TEST(rpc_awaitable_test, chained_calls_test) {
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::async_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [](request req,
+           std::function<void(std::optional<response>)> cb) -> bool {
+            std::thread([cb = std::move(cb), req]() {
+                cb(req + 1);
+            }).detach();
+            return true;
+        });
+    ASSERT_TRUE(server.init());
+
+    auto client = client_type({ep});
+    ASSERT_TRUE(client.init());
+
+    auto s = cbdc::strand();
+    for(auto* exec : {static_cast<cbdc::strand*>(nullptr), &s}) {
+        auto done = std::promise<std::optional<int64_t>>();
+        auto done_fut = done.get_future();
+        cbdc::rpc::spawn(add_twice(client, 1, exec),
+                         [&](std::optional<int64_t> res) {
+                             done.set_value(res);
+                         });
+        auto status = done_fut.wait_for(std::chrono::seconds(1));
+        ASSERT_EQ(status, std::future_status::ready);
+        auto res = done_fut.get();
+        ASSERT_TRUE(res.has_value());
+        ASSERT_EQ(res.value(), 3);
+    }
+}
+
+TEST(rpc_awaitable_test, send_fail_test) {
+    auto client = client_type({{cbdc::network::localhost, 55555},
+                               {cbdc::network::localhost, 55556}});
+    ASSERT_TRUE(client.init());
+
+    auto res = std::optional<std::optional<int64_t>>();
+    cbdc::rpc::spawn(add_twice(client, 1, nullptr),
+                     [&](std::optional<int64_t> r) {
+                         res = r;
+                     });
+    ASSERT_TRUE(res.has_value());
+    ASSERT_FALSE(res->has_value());
+}
+
+#endif
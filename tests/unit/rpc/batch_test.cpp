@@ -0,0 +1,113 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/rpc/batch.hpp"
+#include "util/rpc/batching_client.hpp"
+#include "util/rpc/format.hpp"
+#include "util/rpc/tcp_server.hpp"
+#include "util/serialization/format.hpp"
+
+#include <atomic>
+#include <gtest/gtest.h>
+
+TEST(rpc_batch_test, format_test) {
+    auto req = cbdc::rpc::batch_request<int64_t>{{1, 2, 3}};
+    auto buf = cbdc::make_buffer(req);
+    auto req2 = cbdc::from_buffer<cbdc::rpc::batch_request<int64_t>>(buf);
+    ASSERT_TRUE(req2.has_value());
+    ASSERT_EQ(req.m_requests, req2->m_requests);
+
+    auto resp = cbdc::rpc::batch_response<int64_t>{{1, std::nullopt, 3}};
+    buf = cbdc::make_buffer(resp);
+    auto resp2 = cbdc::from_buffer<cbdc::rpc::batch_response<int64_t>>(buf);
+    ASSERT_TRUE(resp2.has_value());
+    ASSERT_EQ(resp.m_responses, resp2->m_responses);
+}
+
+TEST(rpc_batch_test, blocking_handler_test) {
+    auto handler = cbdc::rpc::make_batch_handler<int64_t, int64_t>(
+        [](int64_t req) -> std::optional<int64_t> {
+            if(req < 0) {
+                return std::nullopt;
+            }
+            return req * 2;
+        });
+    auto resp = handler({{1, -1, 3}});
+    ASSERT_TRUE(resp.has_value());
+    auto expected = std::vector<std::optional<int64_t>>{2, std::nullopt, 6};
+    ASSERT_EQ(resp->m_responses, expected);
+}
+
+TEST(rpc_batch_test, async_handler_test) {
+    auto handler = cbdc::rpc::make_async_batch_handler<int64_t, int64_t>(
+        [](int64_t req,
+           std::function<void(std::optional<int64_t>)> cb) -> bool {
+            if(req < 0) {
+                return false;
+            }
+            std::thread([cb = std::move(cb), req]() {
+                cb(req * 2);
+            }).detach();
+            return true;
+        });
+
+    auto done = std::promise<cbdc::rpc::batch_response<int64_t>>();
+    auto done_fut = done.get_future();
+    auto started = handler(
+        {{1, -1, 3}},
+        [&](std::optional<cbdc::rpc::batch_response<int64_t>> resp) {
+            ASSERT_TRUE(resp.has_value());
+            done.set_value(std::move(resp.value()));
+        });
+    ASSERT_TRUE(started);
+    auto status = done_fut.wait_for(std::chrono::seconds(1));
+    ASSERT_EQ(status, std::future_status::ready);
+    auto expected = std::vector<std::optional<int64_t>>{2, std::nullopt, 6};
+    ASSERT_EQ(done_fut.get().m_responses, expected);
+}
+
+TEST(rpc_batch_test, batching_client_test) {
+    using request = cbdc::rpc::batch_request<int64_t>;
+    using response = cbdc::rpc::batch_response<int64_t>;
+
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::blocking_tcp_server<request, response>(ep);
+    auto batches = std::atomic<size_t>{0};
+    auto handler = cbdc::rpc::make_batch_handler<int64_t, int64_t>(
+        [](int64_t req) -> std::optional<int64_t> {
+            return req + 1;
+        });
+    server.register_handler_callback(
+        [&](request req) -> std::optional<response> {
+            batches++;
+            return handler(std::move(req));
+        });
+    ASSERT_TRUE(server.init());
+
+    auto opts = cbdc::rpc::batching_client_options{};
+    opts.m_max_batch_size = 8;
+    opts.m_max_delay = std::chrono::milliseconds(50);
+    auto client
+        = cbdc::rpc::batching_client<int64_t, int64_t>({ep}, opts);
+    ASSERT_TRUE(client.init());
+
+    static constexpr int64_t n_requests = 16;
+    auto remaining = std::atomic<int64_t>{n_requests};
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
+    for(int64_t i = 0; i < n_requests; i++) {
+        auto queued = client.call(i, [&, i](std::optional<int64_t> resp) {
+            ASSERT_TRUE(resp.has_value());
+            ASSERT_EQ(resp.value(), i + 1);
+            if(--remaining == 0) {
+                done.set_value();
+            }
+        });
+        ASSERT_TRUE(queued);
+    }
+    auto status = done_fut.wait_for(std::chrono::seconds(1));
+    ASSERT_EQ(status, std::future_status::ready);
+    ASSERT_LT(batches, static_cast<size_t>(n_requests));
+}
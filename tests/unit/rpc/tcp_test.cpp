@@ -9,7 +9,11 @@
 #include "util/rpc/tcp_server.hpp"
 #include "util/serialization/format.hpp"
 
+#include <atomic>
+#include <future>
 #include <gtest/gtest.h>
+#include <optional>
+#include <thread>
 #include <variant>
 
 TEST(tcp_rpc_test, echo_test) {
@@ -166,6 +170,31 @@ TEST(tcp_rpc_test, cancel_test) {
     t.join();
 }
 
+TEST(tcp_rpc_test, async_cancel_test) {
+    using request = int64_t;
+    using response = int64_t;
+
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::network::tcp_listener();
+    ASSERT_TRUE(server.listen(ep.first, ep.second));
+
+    auto client = std::make_unique<cbdc::rpc::tcp_client<request, response>>(
+        std::vector<cbdc::network::endpoint_t>{ep});
+    ASSERT_TRUE(client->init());
+
+    auto done = std::promise<std::optional<response>>();
+    auto done_fut = done.get_future();
+    ASSERT_TRUE(client->call(request{20},
+                             [&](std::optional<response> resp) {
+                                 done.set_value(resp);
+                             }));
+    // Destroying the client fails the outstanding call
+    client.reset();
+    ASSERT_EQ(done_fut.wait_for(std::chrono::seconds(1)),
+              std::future_status::ready);
+    ASSERT_FALSE(done_fut.get().has_value());
+}
+
 TEST(tcp_rpc_test, async_echo_test) {
     using request = std::variant<bool, int>;
     using response = std::variant<int, bool>;
@@ -263,3 +292,165 @@ TEST(tcp_rpc_test, async_error_test) {
     status = done_fut.wait_for(std::chrono::milliseconds(100));
     ASSERT_EQ(status, std::future_status::ready);
 }
+
+TEST(tcp_rpc_test, in_flight_window_test) {
+    using request = int64_t;
+    using response = int64_t;
+
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::blocking_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [](request req) -> std::optional<response> {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            return req;
+        });
+
+    ASSERT_TRUE(server.init());
+
+    auto opts = cbdc::rpc::tcp_client_options{};
+    opts.m_max_in_flight = 1;
+    opts.m_request_timeout = std::chrono::milliseconds(20);
+    auto client = cbdc::rpc::tcp_client<request, response>({ep}, opts);
+    ASSERT_TRUE(client.init());
+
+    auto done = std::promise<std::optional<response>>();
+    auto done_fut = done.get_future();
+    auto start = std::chrono::steady_clock::now();
+    auto success = client.call(request{1}, [&](std::optional<response> resp) {
+        done.set_value(resp);
+    });
+    ASSERT_TRUE(success);
+    ASSERT_EQ(client.in_flight(), 1UL);
+
+    // The window is full, so the second call waits until the first request
+    // expires before the server responds.
+    auto resp = client.call(request{2}, std::chrono::milliseconds(1));
+    ASSERT_FALSE(resp.has_value());
+    ASSERT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(20));
+
+    auto status = done_fut.wait_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(status, std::future_status::ready);
+    ASSERT_FALSE(done_fut.get().has_value());
+    ASSERT_EQ(client.in_flight(), 0UL);
+}
+
+TEST(tcp_rpc_test, callback_executor_test) {
+    using request = int64_t;
+    using response = int64_t;
+
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::blocking_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [](request req) -> std::optional<response> {
+            return req;
+        });
+
+    ASSERT_TRUE(server.init());
+
+    auto opts = cbdc::rpc::tcp_client_options{};
+    opts.m_max_in_flight = 4;
+    opts.m_callback_threads = 2;
+    auto client = cbdc::rpc::tcp_client<request, response>({ep}, opts);
+    ASSERT_TRUE(client.init());
+
+    static constexpr auto n_requests = 16;
+    auto remaining = std::atomic<int>{n_requests};
+    auto done = std::promise<void>();
+    auto done_fut = done.get_future();
+    for(int64_t i = 0; i < n_requests; i++) {
+        auto success
+            = client.call(request{i}, [&, i](std::optional<response> resp) {
+                  ASSERT_TRUE(resp.has_value());
+                  ASSERT_EQ(resp.value(), i);
+                  if(--remaining == 0) {
+                      done.set_value();
+                  }
+              });
+        ASSERT_TRUE(success);
+    }
+    auto status = done_fut.wait_for(std::chrono::seconds(1));
+    ASSERT_EQ(status, std::future_status::ready);
+}
+
+TEST(tcp_rpc_test, trace_propagation_test) {
+    using request = int64_t;
+    using response = std::pair<uint64_t, uint64_t>;
+
+    auto noop = [](const std::vector<cbdc::tracing::span_record>&) {};
+    ASSERT_TRUE(cbdc::tracing::tracer::global().start(1.0, 2, noop));
+
+    auto ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto server = cbdc::rpc::blocking_tcp_server<request, response>(ep);
+    server.register_handler_callback(
+        [](request /* req */) -> std::optional<response> {
+            auto ctx = cbdc::tracing::current();
+            if(!ctx.has_value()) {
+                return response{0, 0};
+            }
+            return response{ctx->m_trace_id, ctx->m_span_id};
+        });
+
+    ASSERT_TRUE(server.init());
+
+    auto client = cbdc::rpc::tcp_client<request, response>({ep});
+    ASSERT_TRUE(client.init());
+
+    auto resp = client.call(0);
+    ASSERT_TRUE(resp.has_value());
+    ASSERT_EQ(resp->first, 0);
+
+    auto root = cbdc::tracing::maybe_start_trace();
+    ASSERT_TRUE(root.has_value());
+    {
+        auto c = cbdc::tracing::scoped_context(root);
+        resp = client.call(0);
+    }
+    cbdc::tracing::tracer::global().stop();
+    ASSERT_TRUE(resp.has_value());
+    ASSERT_EQ(resp->first, root->m_trace_id);
+    ASSERT_NE(resp->second, 0);
+}
+
+TEST(tcp_rpc_test, latency_aware_test) {
+    using request = int64_t;
+    using response = int64_t;
+
+    auto slow_calls = std::atomic<size_t>();
+    auto slow_ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55555};
+    auto slow_server
+        = cbdc::rpc::blocking_tcp_server<request, response>(slow_ep);
+    slow_server.register_handler_callback(
+        [&](request req) -> std::optional<response> {
+            slow_calls++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return req;
+        });
+    ASSERT_TRUE(slow_server.init());
+
+    auto fast_ep = cbdc::network::endpoint_t{cbdc::network::localhost, 55556};
+    auto fast_server
+        = cbdc::rpc::blocking_tcp_server<request, response>(fast_ep);
+    fast_server.register_handler_callback(
+        [](request req) -> std::optional<response> {
+            return req;
+        });
+    ASSERT_TRUE(fast_server.init());
+
+    auto opts = cbdc::rpc::tcp_client_options();
+    opts.m_latency_aware = true;
+    auto client
+        = cbdc::rpc::tcp_client<request, response>({slow_ep, fast_ep}, opts);
+    ASSERT_TRUE(client.init(true));
+
+    // Each server is tried once, then requests follow the faster one
+    static constexpr auto n_calls = 20;
+    for(int64_t i = 0; i < n_calls; i++) {
+        auto resp = client.call(i);
+        ASSERT_TRUE(resp.has_value());
+        ASSERT_EQ(resp.value(), i);
+    }
+    ASSERT_EQ(slow_calls, 1UL);
+    auto latencies = client.server_latencies();
+    ASSERT_EQ(latencies.size(), 2UL);
+}
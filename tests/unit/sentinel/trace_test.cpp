@@ -0,0 +1,87 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/sentinel/trace.hpp"
+
+#include <filesystem>
+#include <gtest/gtest.h>
+
+class sentinel_trace_test : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        std::filesystem::remove(m_path);
+        for(uint64_t i = 0; i < 3; i++) {
+            auto tx = cbdc::transaction::full_tx();
+            for(uint64_t j = 0; j <= i; j++) {
+                auto inp = cbdc::transaction::input();
+                inp.m_prevout.m_tx_id[0] = static_cast<unsigned char>(i);
+                inp.m_prevout.m_index = j;
+                inp.m_prevout_data.m_value = j + 1;
+                tx.m_inputs.push_back(inp);
+                tx.m_witness.push_back({static_cast<std::byte>(j)});
+            }
+            tx.m_outputs.push_back({{}, i + 1});
+            m_txs.push_back(tx);
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(m_path);
+    }
+
+    static constexpr auto m_path = "sentinel_trace_test.bin";
+    std::vector<cbdc::transaction::full_tx> m_txs;
+};
+
+TEST_F(sentinel_trace_test, round_trip) {
+    {
+        auto writer = cbdc::sentinel::trace_writer(m_path);
+        ASSERT_TRUE(writer.good());
+        for(const auto& tx : m_txs) {
+            writer.append(tx);
+        }
+        ASSERT_TRUE(writer.good());
+    }
+
+    auto reader = cbdc::sentinel::trace_reader(m_path);
+    ASSERT_TRUE(reader.good());
+    uint64_t last_offset{0};
+    for(const auto& tx : m_txs) {
+        auto rec = reader.next();
+        ASSERT_TRUE(rec.has_value());
+        ASSERT_EQ(rec->m_tx, tx);
+        ASSERT_GE(rec->m_offset_ns, last_offset);
+        last_offset = rec->m_offset_ns;
+    }
+    ASSERT_FALSE(reader.next().has_value());
+    ASSERT_TRUE(reader.good());
+}
+
+TEST_F(sentinel_trace_test, truncated) {
+    {
+        auto writer = cbdc::sentinel::trace_writer(m_path);
+        writer.append(m_txs[0]);
+        writer.append(m_txs[1]);
+    }
+    std::filesystem::resize_file(m_path,
+                                 std::filesystem::file_size(m_path) - 1);
+
+    auto reader = cbdc::sentinel::trace_reader(m_path);
+    ASSERT_TRUE(reader.good());
+    auto rec = reader.next();
+    ASSERT_TRUE(rec.has_value());
+    ASSERT_EQ(rec->m_tx, m_txs[0]);
+    ASSERT_FALSE(reader.next().has_value());
+    ASSERT_FALSE(reader.good());
+}
+
+TEST_F(sentinel_trace_test, not_a_trace) {
+    ASSERT_FALSE(cbdc::sentinel::trace_reader(m_path).good());
+    {
+        auto out = std::ofstream(m_path);
+        out << "not a trace file";
+    }
+    ASSERT_FALSE(cbdc::sentinel::trace_reader(m_path).good());
+}
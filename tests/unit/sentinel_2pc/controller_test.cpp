@@ -59,11 +59,20 @@ class sentinel_2pc_test : public ::testing::Test {
                     cbdc::rpc::request<cbdc::coordinator::rpc::request>>(
                     *pkt.m_pkt);
                 EXPECT_TRUE(req.has_value());
+                m_coordinator_requests++;
                 std::this_thread::sleep_for(m_processing_delay);
+                auto resp = cbdc::coordinator::rpc::response{true};
+                if(auto* batch = std::get_if<
+                       cbdc::coordinator::rpc::batch_request>(
+                       &req->m_payload)) {
+                    resp = cbdc::coordinator::rpc::batch_response(
+                        batch->size(),
+                        true);
+                }
                 return cbdc::make_buffer(
                     cbdc::rpc::response<cbdc::coordinator::rpc::response>{
                         req->m_header,
-                        true});
+                        resp});
             });
 
         cbdc::transaction::wallet wallet1;
@@ -99,6 +108,7 @@ class sentinel_2pc_test : public ::testing::Test {
     std::unique_ptr<cbdc::sentinel_2pc::controller> m_ctl;
     cbdc::transaction::full_tx m_valid_tx{};
     std::shared_ptr<cbdc::logging::log> m_logger;
+    std::atomic<size_t> m_coordinator_requests{0};
 };
 
 TEST_F(sentinel_2pc_test, test_init) {
@@ -167,6 +177,35 @@ TEST_F(sentinel_2pc_test, digest_valid_transaction_network) {
     ASSERT_EQ(resp.value().m_tx_status, cbdc::sentinel::tx_status::confirmed);
 }
 
+TEST_F(sentinel_2pc_test, batched_transactions) {
+    constexpr size_t n_txs{10};
+    m_opts.m_sentinel_batch_size = n_txs;
+    m_opts.m_sentinel_batch_linger_us = 1000000;
+    m_ctl = std::make_unique<cbdc::sentinel_2pc::controller>(0,
+                                                             m_opts,
+                                                             m_logger);
+    ASSERT_TRUE(m_ctl->init());
+
+    auto confirmed = std::atomic<size_t>{0};
+    auto done = std::promise<void>();
+    for(size_t i{0}; i < n_txs; i++) {
+        auto res = m_ctl->execute_transaction(
+            m_valid_tx,
+            [&](std::optional<cbdc::sentinel::execute_response> resp) {
+                ASSERT_TRUE(resp.has_value());
+                ASSERT_EQ(resp->m_tx_status,
+                          cbdc::sentinel::tx_status::confirmed);
+                if(++confirmed == n_txs) {
+                    done.set_value();
+                }
+            });
+        ASSERT_TRUE(res);
+    }
+    auto r = done.get_future().wait_for(std::chrono::seconds(2));
+    ASSERT_EQ(r, std::future_status::ready);
+    ASSERT_EQ(m_coordinator_requests, 1UL);
+}
+
 TEST_F(sentinel_2pc_test, tx_validation_test) {
     ASSERT_TRUE(m_ctl->init());
     auto ctx = cbdc::transaction::compact_tx(m_valid_tx);
@@ -175,12 +214,19 @@ TEST_F(sentinel_2pc_test, tx_validation_test) {
         secp256k1_context_create(SECP256K1_CONTEXT_SIGN
                                  | SECP256K1_CONTEXT_VERIFY),
         &secp256k1_context_destroy};
+    using validate_result = cbdc::sentinel::async_interface::validate_result;
+    auto done = std::promise<validate_result>();
     auto res
         = m_ctl->validate_transaction(m_valid_tx, [&](auto validation_res) {
-              ASSERT_TRUE(validation_res.has_value());
-              ASSERT_TRUE(ctx.verify(secp.get(), validation_res.value()));
+              done.set_value(validation_res);
           });
     ASSERT_TRUE(res);
+    auto fut = done.get_future();
+    ASSERT_EQ(fut.wait_for(std::chrono::milliseconds(500)),
+              std::future_status::ready);
+    auto validation_res = fut.get();
+    ASSERT_TRUE(validation_res.has_value());
+    ASSERT_TRUE(ctx.verify(secp.get(), validation_res.value()));
 }
 
 TEST_F(sentinel_2pc_test, bad_coordinator_endpoint) {
@@ -221,6 +221,48 @@ TEST_F(format_test, malformed_vectors_cannot_roundtrip) {
     EXPECT_FALSE(deser);
 }
 
+TEST_F(format_test, bytewise_vectors_roundtrip) {
+    using arr_t = std::array<unsigned char, 4>;
+    static_assert(cbdc::is_bytewise_serializable_v<arr_t>);
+    static_assert(!cbdc::is_bytewise_serializable_v<bool>);
+    static_assert(cbdc::fixed_serialized_size_v<arr_t> == 4);
+    static_assert(cbdc::fixed_serialized_size_v<std::pair<arr_t, uint64_t>>
+                  == 12);
+    static_assert(cbdc::fixed_serialized_size_v<std::vector<arr_t>> == 0);
+
+    std::vector<arr_t> v0{{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}};
+    cbdc::small_vector<arr_t, 2> sv0(v0.begin(), v0.end());
+
+    // Written the same as element by element
+    ser << v0 << sv0;
+    EXPECT_TRUE(ser);
+    auto sz = cbdc::size_serializer();
+    sz << static_cast<uint64_t>(v0.size());
+    for(const auto& a : v0) {
+        sz << a;
+    }
+    EXPECT_EQ(buf.size(), sz.size() * 2);
+
+    std::vector<arr_t> r0{};
+    cbdc::small_vector<arr_t, 2> sr0{};
+    deser >> r0 >> sr0;
+    EXPECT_TRUE(deser);
+    EXPECT_EQ(r0, v0);
+    EXPECT_EQ(sr0, sv0);
+    buf.clear();
+    ser.reset();
+    deser.reset();
+
+    // A truncated vector keeps the elements that were complete
+    ser << static_cast<uint64_t>(3) << v0[0] << v0[1]
+        << static_cast<unsigned char>(0);
+    std::vector<arr_t> r1{};
+    deser >> r1;
+    EXPECT_FALSE(deser);
+    ASSERT_EQ(r1.size(), 2UL);
+    EXPECT_EQ(r1[1], v0[1]);
+}
+
 TEST_F(format_test, wellformed_unordered_maps_roundtrip) {
     std::unordered_map<int16_t, uint64_t> m0{};
     ser << m0;
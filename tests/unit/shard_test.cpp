@@ -5,9 +5,12 @@
 
 #include "uhs/atomizer/shard/shard.hpp"
 #include "uhs/transaction/wallet.hpp"
+#include "util/persistence/hash_export.hpp"
 #include "util.hpp"
 
+#include <cstring>
 #include <filesystem>
+#include <future>
 #include <gtest/gtest.h>
 
 static constexpr auto g_shard_test_dir = "test_shard_db";
@@ -149,3 +152,196 @@ TEST_F(shard_test, digest_block_valid) {
 
     ASSERT_EQ(invalid_got, invalid_want);
 }
+
+TEST_F(shard_test, digest_filtered_block) {
+    cbdc::atomizer::block b2;
+    b2.m_height = 2;
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'c'}, {{1}, {3}, {4}, {11}}, {{7}}));
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'d'}, {{2}, {22}}, {{9}}));
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'e'}, {{5}, {6}}, {{8}}));
+
+    // The second transaction has no UHS IDs in the shard's range
+    auto filtered = cbdc::atomizer::filter_block(b2, {3, 8});
+    ASSERT_EQ(filtered.m_height, b2.m_height);
+    ASSERT_EQ(filtered.m_transactions.size(), 2UL);
+    auto want_inputs = cbdc::transaction::compact_hashes{{3}, {4}};
+    ASSERT_EQ(filtered.m_transactions[0].m_inputs, want_inputs);
+    auto want_outputs = cbdc::transaction::compact_hashes{{7}};
+    ASSERT_EQ(filtered.m_transactions[0].m_uhs_outputs, want_outputs);
+    ASSERT_TRUE(filtered.m_transactions[0].m_attestations.empty());
+    ASSERT_EQ(filtered.m_transactions[1].m_id, b2.m_transactions[2].m_id);
+    ASSERT_TRUE(m_shard.digest_block(filtered));
+
+    cbdc::transaction::compact_tx ctx{};
+    ctx.m_id = {'a'};
+    ctx.m_inputs = {{7}, {8}, {3}, {5}};
+    ctx.m_uhs_outputs = {{'x'}};
+    auto res = m_shard.digest_transaction(ctx);
+    ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res));
+    cbdc::watchtower::tx_error want{
+        {'a'},
+        cbdc::watchtower::tx_error_inputs_dne{{{3}, {5}}}};
+    ASSERT_EQ(std::get<cbdc::watchtower::tx_error>(res), want);
+}
+
+TEST_F(shard_test, export_uhs) {
+    static constexpr auto export_file = "test_shard_export.uhs";
+    auto start_export = [&]() {
+        auto done = std::make_shared<std::promise<std::optional<uint64_t>>>();
+        auto ret = done->get_future();
+        EXPECT_TRUE(
+            m_shard.export_uhs(export_file, [done](auto res) {
+                done->set_value(res);
+            }));
+        return ret;
+    };
+
+    auto res = start_export();
+    // Blocks digested while the export runs are not part of it
+    cbdc::atomizer::block b2;
+    b2.m_height = 2;
+    b2.m_transactions.push_back(cbdc::test::simple_tx({'c'}, {{3}}, {{7}}));
+    ASSERT_TRUE(m_shard.digest_block(b2));
+
+    ASSERT_EQ(res.get(), 1UL);
+    auto got = cbdc::persistence::read_hash_export(export_file);
+    ASSERT_TRUE(got.has_value());
+    ASSERT_EQ(got->m_label, 1UL);
+    auto want = std::vector<cbdc::hash_t>{{3}, {4}, {5}, {6}};
+    ASSERT_EQ(got->m_hashes, want);
+
+    ASSERT_EQ(start_export().get(), 2UL);
+    got = cbdc::persistence::read_hash_export(export_file);
+    ASSERT_TRUE(got.has_value());
+    want = std::vector<cbdc::hash_t>{{4}, {5}, {6}, {7}};
+    ASSERT_EQ(got->m_hashes, want);
+    std::filesystem::remove(export_file);
+}
+
+TEST_F(shard_test, import_uhs) {
+    static constexpr auto export_file = "test_shard_import.uhs";
+    static constexpr auto import_dir = "test_shard_import_db";
+    auto done = std::make_shared<std::promise<std::optional<uint64_t>>>();
+    auto exported = done->get_future();
+    ASSERT_TRUE(m_shard.export_uhs(export_file, [done](auto res) {
+        done->set_value(res);
+    }));
+    ASSERT_EQ(exported.get(), 1UL);
+
+    std::filesystem::remove_all(import_dir);
+    auto shrd = cbdc::shard::shard{{3, 8}};
+    ASSERT_FALSE(shrd.open_db(import_dir).has_value());
+    ASSERT_EQ(shrd.import_uhs(export_file), 1UL);
+    ASSERT_EQ(shrd.best_block_height(), 1UL);
+    // The export is not newer than the imported state
+    ASSERT_FALSE(shrd.import_uhs(export_file).has_value());
+
+    cbdc::transaction::compact_tx ctx{};
+    ctx.m_id = {'c'};
+    ctx.m_inputs = {{3}, {6}};
+    ctx.m_uhs_outputs = {{'x'}};
+    auto res = shrd.digest_transaction(ctx);
+    ASSERT_TRUE(std::holds_alternative<cbdc::atomizer::tx_notify_request>(res));
+
+    ctx.m_inputs = {{7}};
+    res = shrd.digest_transaction(ctx);
+    ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res));
+
+    std::filesystem::remove_all(import_dir);
+    std::filesystem::remove(export_file);
+}
+
+TEST(shard_parallel_test, digest_large_block) {
+    std::filesystem::remove_all(g_shard_test_dir);
+    auto shrd = cbdc::shard::shard{{3, 8}, 3};
+    ASSERT_FALSE(shrd.open_db(g_shard_test_dir).has_value());
+
+    // Enough transactions to be split across threads. Each transaction
+    // after the first creates an output and spends the one created by the
+    // transaction before it, so spends cross chunk boundaries.
+    static constexpr size_t n_txs = 2000;
+    auto out_id = [](size_t i) {
+        auto id = cbdc::hash_t{4};
+        std::memcpy(&id[1], &i, sizeof(i));
+        return id;
+    };
+    cbdc::atomizer::block b1;
+    b1.m_height = 1;
+    for(size_t i{0}; i < n_txs; i++) {
+        auto inputs = std::vector<cbdc::hash_t>();
+        if(i > 0) {
+            inputs.push_back(out_id(i - 1));
+        }
+        b1.m_transactions.push_back(
+            cbdc::test::simple_tx(out_id(i), inputs, {out_id(i)}));
+    }
+    ASSERT_TRUE(shrd.digest_block(b1));
+    ASSERT_EQ(shrd.best_block_height(), 1UL);
+
+    cbdc::transaction::compact_tx ctx{};
+    ctx.m_id = {'a'};
+    ctx.m_inputs = {out_id(0), out_id(n_txs / 2), out_id(n_txs - 1)};
+    ctx.m_uhs_outputs = {{'x'}};
+    auto res = shrd.digest_transaction(ctx);
+    ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res));
+    cbdc::watchtower::tx_error want{
+        {'a'},
+        cbdc::watchtower::tx_error_inputs_dne{{out_id(0), out_id(n_txs / 2)}}};
+    ASSERT_EQ(std::get<cbdc::watchtower::tx_error>(res), want);
+
+    std::filesystem::remove_all(g_shard_test_dir);
+}
+
+TEST(shard_filter_test, digest_tx_filtered) {
+    std::filesystem::remove_all(g_shard_test_dir);
+    {
+        // Sized for fewer outputs than the first block creates, so the
+        // filter is rebuilt after it
+        auto shrd = cbdc::shard::shard{{3, 8}, 1, 4};
+        ASSERT_FALSE(shrd.open_db(g_shard_test_dir).has_value());
+
+        cbdc::atomizer::block b1;
+        b1.m_height = 1;
+        b1.m_transactions.push_back(
+            cbdc::test::simple_tx({'a'}, {}, {{3}, {4}, {5}}));
+        b1.m_transactions.push_back(
+            cbdc::test::simple_tx({'b'}, {}, {{6}, {7}, {8}}));
+        ASSERT_TRUE(shrd.digest_block(b1));
+
+        cbdc::atomizer::block b2;
+        b2.m_height = 2;
+        b2.m_transactions.push_back(
+            cbdc::test::simple_tx({'c'}, {{3}, {4}, {5}}, {{3, 1}}));
+        ASSERT_TRUE(shrd.digest_block(b2));
+
+        cbdc::transaction::compact_tx ctx{};
+        ctx.m_id = {'d'};
+        ctx.m_inputs = {{6}, {4}, {3, 1}, {9}, {3, 2}};
+        ctx.m_uhs_outputs = {{'x'}};
+        auto res = shrd.digest_transaction(ctx);
+        ASSERT_TRUE(std::holds_alternative<cbdc::watchtower::tx_error>(res));
+        cbdc::watchtower::tx_error want{
+            {'d'},
+            cbdc::watchtower::tx_error_inputs_dne{{{4}, {3, 2}}}};
+        ASSERT_EQ(std::get<cbdc::watchtower::tx_error>(res), want);
+    }
+
+    // The filter is rebuilt from the database when it is reopened
+    auto shrd = cbdc::shard::shard{{3, 8}, 1, 4};
+    ASSERT_FALSE(shrd.open_db(g_shard_test_dir).has_value());
+    cbdc::transaction::compact_tx ctx{};
+    ctx.m_id = {'e'};
+    ctx.m_inputs = {{6}, {7}, {3, 1}};
+    ctx.m_uhs_outputs = {{'x'}};
+    auto res = shrd.digest_transaction(ctx);
+    ASSERT_TRUE(
+        std::holds_alternative<cbdc::atomizer::tx_notify_request>(res));
+    auto want_attestations = std::unordered_set<uint64_t>{0, 1, 2};
+    ASSERT_EQ(std::get<cbdc::atomizer::tx_notify_request>(res).m_attestations,
+              want_attestations);
+
+    std::filesystem::remove_all(g_shard_test_dir);
+}
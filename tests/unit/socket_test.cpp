@@ -3,13 +3,17 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "util/network/io_loop.hpp"
 #include "util/network/socket_selector.hpp"
 #include "util/network/tcp_listener.hpp"
 
 #include <array>
+#include <condition_variable>
+#include <future>
 #include <gtest/gtest.h>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 class SocketTest : public ::testing::Test {};
 
@@ -42,6 +46,325 @@ TEST_F(SocketTest, ListenConnectBasic) {
     ASSERT_EQ(recv_pkt, pkt);
 }
 
+TEST_F(SocketTest, send_batch) {
+    auto listener = cbdc::network::tcp_listener();
+    static constexpr auto portno = 5555;
+    ASSERT_TRUE(listener.listen(cbdc::network::localhost, portno));
+
+    auto conn_sock = cbdc::network::tcp_socket();
+    ASSERT_TRUE(conn_sock.connect(cbdc::network::localhost, portno));
+    auto sock = cbdc::network::tcp_socket();
+    ASSERT_TRUE(listener.accept(sock));
+
+    // More packets than fit one gathered write, an empty packet, a null
+    // pointer and a packet too large to write in one call.
+    static constexpr size_t n_pkts = 40;
+    static constexpr size_t large_sz = 4 * 1024 * 1024;
+    auto pkts = std::vector<std::shared_ptr<cbdc::buffer>>();
+    for(size_t i = 0; i < n_pkts; i++) {
+        auto pkt = std::make_shared<cbdc::buffer>();
+        pkt->extend(i == 1 ? large_sz : i);
+        for(size_t j = 0; j < pkt->size(); j++) {
+            static_cast<unsigned char*>(pkt->data())[j]
+                = static_cast<unsigned char>(i + j);
+        }
+        pkts.push_back(pkt);
+    }
+    pkts.insert(pkts.begin() + 3, nullptr);
+
+    auto received = std::vector<cbdc::buffer>(n_pkts);
+    std::thread recv_thread([&]() {
+        for(auto& pkt : received) {
+            ASSERT_TRUE(sock.receive(pkt));
+        }
+    });
+    ASSERT_TRUE(conn_sock.send(pkts));
+    recv_thread.join();
+
+    pkts.erase(pkts.begin() + 3);
+    for(size_t i = 0; i < n_pkts; i++) {
+        ASSERT_EQ(received[i], *pkts[i]);
+    }
+}
+
+namespace {
+    // The helpers report failures with EXPECT and return early where
+    // carrying on would crash, so a failure fails the calling test rather
+    // than only returning from the helper.
+
+    /// Connects a socket to a listener on the given port.
+    /// \return true if both ends of the connection are open.
+    auto connect_pair(cbdc::network::tcp_listener& listener,
+                      unsigned short portno,
+                      cbdc::network::tcp_socket& conn_sock,
+                      cbdc::network::tcp_socket& sock) -> bool {
+        const auto listening
+            = listener.listen(cbdc::network::localhost, portno);
+        EXPECT_TRUE(listening);
+        const auto connected
+            = listening && conn_sock.connect(cbdc::network::localhost, portno);
+        EXPECT_TRUE(connected);
+        const auto accepted = connected && listener.accept(sock);
+        EXPECT_TRUE(accepted);
+        return accepted;
+    }
+
+    /// Whether the kernel supports io_uring, so an io_loop asked for it
+    /// uses it rather than falling back to epoll.
+    auto uring_available() -> bool {
+        auto loop = cbdc::network::io_loop(
+            1,
+            cbdc::config::network_backend::io_uring);
+        return loop.backend() == cbdc::config::network_backend::io_uring;
+    }
+
+    void check_io_loop_echo(cbdc::config::network_backend backend) {
+        auto listener = cbdc::network::tcp_listener();
+        static constexpr auto portno = 5555;
+        auto conn_sock = cbdc::network::tcp_socket();
+        auto sock = cbdc::network::tcp_socket();
+        if(!connect_pair(listener, portno, conn_sock, sock)) {
+            return;
+        }
+
+        auto loop = cbdc::network::io_loop(2, backend);
+
+        // Echo every packet back from the I/O thread
+        auto server = std::shared_ptr<cbdc::network::io_loop::connection>();
+        std::mutex server_mut;
+        std::unique_lock<std::mutex> server_lock(server_mut);
+        server = loop.add(
+            sock,
+            [&](std::shared_ptr<cbdc::buffer> pkt) {
+                std::unique_lock<std::mutex> l(server_mut);
+                server->send(pkt);
+            },
+            nullptr);
+        server_lock.unlock();
+        EXPECT_TRUE(server);
+        if(!server) {
+            return;
+        }
+
+        // Packets larger than the read buffer, empty packets, and enough small
+        // packets to need several gathered writes
+        static constexpr size_t n_pkts = 500;
+        static constexpr size_t large_sz = 1024 * 1024;
+        auto pkts = std::vector<std::shared_ptr<cbdc::buffer>>();
+        for(size_t i = 0; i < n_pkts; i++) {
+            auto pkt = std::make_shared<cbdc::buffer>();
+            pkt->extend(i % 100 == 1 ? large_sz : i % 7);
+            for(size_t j = 0; j < pkt->size(); j++) {
+                static_cast<unsigned char*>(pkt->data())[j]
+                    = static_cast<unsigned char>(i + j);
+            }
+            pkts.push_back(pkt);
+        }
+
+        std::mutex mut;
+        std::condition_variable cv;
+        auto received = std::vector<std::shared_ptr<cbdc::buffer>>();
+        auto client = loop.add(
+            conn_sock,
+            [&](std::shared_ptr<cbdc::buffer> pkt) {
+                {
+                    std::unique_lock<std::mutex> l(mut);
+                    received.push_back(std::move(pkt));
+                }
+                cv.notify_one();
+            },
+            nullptr);
+        EXPECT_TRUE(client);
+        if(!client) {
+            return;
+        }
+        for(const auto& pkt : pkts) {
+            client->send(pkt);
+        }
+
+        {
+            std::unique_lock<std::mutex> l(mut);
+            auto done = cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return received.size() == n_pkts;
+            });
+            EXPECT_TRUE(done);
+            if(!done) {
+                return;
+            }
+        }
+        for(size_t i = 0; i < n_pkts; i++) {
+            EXPECT_EQ(*received[i], *pkts[i]);
+        }
+
+        loop.remove(client);
+        loop.remove(server);
+        EXPECT_FALSE(client->open());
+        EXPECT_FALSE(server->open());
+    }
+
+    void check_io_loop_close(cbdc::config::network_backend backend) {
+        auto listener = cbdc::network::tcp_listener();
+        static constexpr auto portno = 5555;
+        auto conn_sock = cbdc::network::tcp_socket();
+        auto sock = cbdc::network::tcp_socket();
+        if(!connect_pair(listener, portno, conn_sock, sock)) {
+            return;
+        }
+
+        auto loop = cbdc::network::io_loop(1, backend);
+        auto closed = std::promise<void>();
+        auto conn = loop.add(
+            sock,
+            [](std::shared_ptr<cbdc::buffer> /* pkt */) {},
+            [&]() {
+                closed.set_value();
+            });
+        EXPECT_TRUE(conn);
+        if(!conn) {
+            return;
+        }
+
+        // The remote host disconnecting closes the connection
+        conn_sock.disconnect();
+        EXPECT_EQ(closed.get_future().wait_for(std::chrono::seconds(10)),
+                  std::future_status::ready);
+        EXPECT_FALSE(conn->open());
+
+        // Sends after closing are dropped, and removing is still allowed
+        conn->send(std::make_shared<cbdc::buffer>());
+        loop.remove(conn);
+
+        // Closed sockets are not added
+        EXPECT_FALSE(loop.add(conn_sock, nullptr, nullptr));
+    }
+
+    void check_io_loop_priority(cbdc::config::network_backend backend) {
+        auto listener = cbdc::network::tcp_listener();
+        static constexpr auto portno = 5555;
+        auto conn_sock = cbdc::network::tcp_socket();
+        auto sock = cbdc::network::tcp_socket();
+        if(!connect_pair(listener, portno, conn_sock, sock)) {
+            return;
+        }
+
+        auto loop = cbdc::network::io_loop(1, backend);
+        std::mutex mut;
+        std::condition_variable cv;
+        auto received = std::vector<std::shared_ptr<cbdc::buffer>>();
+        auto server = loop.add(
+            sock,
+            [&](std::shared_ptr<cbdc::buffer> pkt) {
+                {
+                    std::unique_lock<std::mutex> l(mut);
+                    received.push_back(std::move(pkt));
+                }
+                cv.notify_one();
+            },
+            nullptr);
+        auto client = loop.add(
+            conn_sock,
+            [](std::shared_ptr<cbdc::buffer> /* pkt */) {},
+            nullptr);
+        EXPECT_TRUE(server);
+        EXPECT_TRUE(client);
+        if(!server || !client) {
+            return;
+        }
+
+        // Far more bulk data than the socket buffers hold, so most is still
+        // queued when the control packets are sent
+        static constexpr size_t n_bulk = 128;
+        static constexpr size_t bulk_sz = 512 * 1024;
+        static constexpr size_t n_control = 3;
+        auto bulk = std::vector<std::shared_ptr<cbdc::buffer>>();
+        for(size_t i = 0; i < n_bulk; i++) {
+            auto pkt = std::make_shared<cbdc::buffer>();
+            pkt->extend(bulk_sz);
+            static_cast<unsigned char*>(pkt->data())[0]
+                = static_cast<unsigned char>(i);
+            bulk.push_back(pkt);
+        }
+        auto control = std::vector<std::shared_ptr<cbdc::buffer>>();
+        for(size_t i = 0; i < n_control; i++) {
+            auto pkt = std::make_shared<cbdc::buffer>();
+            pkt->extend(1);
+            static_cast<unsigned char*>(pkt->data())[0]
+                = static_cast<unsigned char>(i);
+            control.push_back(pkt);
+        }
+        for(const auto& pkt : bulk) {
+            client->send(pkt);
+        }
+        for(const auto& pkt : control) {
+            client->send(pkt, cbdc::network::priority::high);
+        }
+
+        {
+            std::unique_lock<std::mutex> l(mut);
+            auto done = cv.wait_for(l, std::chrono::seconds(10), [&]() {
+                return received.size() == n_bulk + n_control;
+            });
+            EXPECT_TRUE(done);
+            if(!done) {
+                return;
+            }
+        }
+
+        // Control packets overtake the queued bulk packets, and each class
+        // stays in order
+        size_t n_bulk_seen{0};
+        size_t n_control_seen{0};
+        for(const auto& pkt : received) {
+            auto idx = static_cast<unsigned char*>(pkt->data())[0];
+            if(pkt->size() == 1) {
+                EXPECT_EQ(idx, n_control_seen);
+                EXPECT_LT(n_bulk_seen, n_bulk);
+                n_control_seen++;
+            } else {
+                EXPECT_EQ(idx, static_cast<unsigned char>(n_bulk_seen));
+                n_bulk_seen++;
+            }
+        }
+        EXPECT_EQ(n_control_seen, n_control);
+
+        loop.remove(client);
+        loop.remove(server);
+    }
+}
+
+TEST_F(SocketTest, io_loop_echo) {
+    check_io_loop_echo(cbdc::config::network_backend::epoll);
+}
+
+TEST_F(SocketTest, io_loop_close) {
+    check_io_loop_close(cbdc::config::network_backend::epoll);
+}
+
+TEST_F(SocketTest, io_loop_uring_echo) {
+    if(!uring_available()) {
+        GTEST_SKIP() << "io_uring is not supported by this kernel";
+    }
+    check_io_loop_echo(cbdc::config::network_backend::io_uring);
+}
+
+TEST_F(SocketTest, io_loop_uring_close) {
+    if(!uring_available()) {
+        GTEST_SKIP() << "io_uring is not supported by this kernel";
+    }
+    check_io_loop_close(cbdc::config::network_backend::io_uring);
+}
+
+TEST_F(SocketTest, io_loop_priority) {
+    check_io_loop_priority(cbdc::config::network_backend::epoll);
+}
+
+TEST_F(SocketTest, io_loop_uring_priority) {
+    if(!uring_available()) {
+        GTEST_SKIP() << "io_uring is not supported by this kernel";
+    }
+    check_io_loop_priority(cbdc::config::network_backend::io_uring);
+}
+
 TEST_F(SocketTest, selector_connect) {
     auto s = cbdc::network::socket_selector();
     ASSERT_TRUE(s.init());
@@ -124,3 +447,50 @@ TEST_F(SocketTest, selector_unblock) {
         ASSERT_EQ(count, 1);
     }
 }
+
+TEST_F(SocketTest, local_transport) {
+    // The transport is opt-in; restore the default even if an assertion
+    // returns early.
+    struct local_transport_guard {
+        local_transport_guard() {
+            cbdc::network::set_local_transport(true);
+        }
+        ~local_transport_guard() {
+            cbdc::network::set_local_transport(false);
+        }
+        local_transport_guard(const local_transport_guard&) = delete;
+        auto operator=(const local_transport_guard&)
+            -> local_transport_guard& = delete;
+        local_transport_guard(local_transport_guard&&) = delete;
+        auto operator=(local_transport_guard&&)
+            -> local_transport_guard& = delete;
+    } guard;
+
+    auto listener = cbdc::network::tcp_listener();
+    static constexpr auto portno = 5555;
+    ASSERT_TRUE(listener.listen("0.0.0.0", portno));
+
+    // A wildcard listener is reached locally through the loopback address.
+    auto conn_sock = cbdc::network::tcp_socket();
+    ASSERT_TRUE(conn_sock.connect(cbdc::network::localhost, portno));
+    ASSERT_TRUE(conn_sock.is_local());
+    auto sock = cbdc::network::tcp_socket();
+    ASSERT_TRUE(listener.accept(sock));
+    ASSERT_TRUE(sock.is_local());
+
+    auto pkt = cbdc::buffer();
+    pkt.append("local", 5);
+    ASSERT_TRUE(conn_sock.send(pkt));
+    auto recv_pkt = cbdc::buffer();
+    ASSERT_TRUE(sock.receive(recv_pkt));
+    ASSERT_EQ(recv_pkt, pkt);
+
+    cbdc::network::set_local_transport(false);
+    auto tcp_sock = cbdc::network::tcp_socket();
+    ASSERT_TRUE(tcp_sock.connect(cbdc::network::localhost, portno));
+    cbdc::network::set_local_transport(true);
+    ASSERT_FALSE(tcp_sock.is_local());
+    auto tcp_accepted = cbdc::network::tcp_socket();
+    ASSERT_TRUE(listener.accept(tcp_accepted));
+    ASSERT_FALSE(tcp_accepted.is_local());
+}
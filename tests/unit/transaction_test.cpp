@@ -3,7 +3,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "uhs/transaction/compact_tx_view.hpp"
+#include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/transaction.hpp"
+#include "util/serialization/size_serializer.hpp"
+#include "util/serialization/util.hpp"
 
 #include <gtest/gtest.h>
 
@@ -39,3 +43,163 @@ TEST(CTransaction, input_from_output_out_of_bounds) {
     auto result = cbdc::transaction::input_from_output(tx, 1);
     ASSERT_FALSE(result);
 }
+
+TEST(CTransaction, uhs_ids_from_outputs) {
+    auto outputs = std::vector<cbdc::transaction::output>(11);
+    for(size_t i = 0; i < outputs.size(); i++) {
+        outputs[i].m_value = i + 1;
+        outputs[i].m_witness_program_commitment[0]
+            = static_cast<unsigned char>(i);
+    }
+    auto entropy = cbdc::hash_t{'e'};
+
+    auto ids = cbdc::transaction::uhs_ids_from_outputs(entropy, outputs);
+    ASSERT_EQ(ids.size(), outputs.size());
+    for(uint64_t i = 0; i < outputs.size(); i++) {
+        ASSERT_EQ(
+            ids[i],
+            cbdc::transaction::uhs_id_from_output(entropy, i, outputs[i]));
+    }
+    ASSERT_TRUE(cbdc::transaction::uhs_ids_from_outputs(entropy, {}).empty());
+}
+
+TEST(CTransaction, fixed_serialized_sizes) {
+    auto inp = cbdc::transaction::input();
+    auto sz = cbdc::size_serializer();
+    sz << inp.m_prevout;
+    ASSERT_EQ(sz.size(),
+              cbdc::fixed_serialized_size_v<cbdc::transaction::out_point>);
+    sz.reset();
+    sz << inp.m_prevout_data;
+    ASSERT_EQ(sz.size(),
+              cbdc::fixed_serialized_size_v<cbdc::transaction::output>);
+    sz.reset();
+    sz << inp;
+    ASSERT_EQ(sz.size(), cbdc::serialized_size(inp));
+}
+
+TEST(CTransaction, bytewise_vectors) {
+    static_assert(
+        cbdc::is_bytewise_serializable_v<cbdc::transaction::out_point>);
+    static_assert(cbdc::is_bytewise_serializable_v<cbdc::transaction::output>);
+    static_assert(cbdc::is_bytewise_serializable_v<cbdc::transaction::input>);
+    static_assert(
+        !cbdc::is_bytewise_serializable_v<cbdc::transaction::full_tx>);
+
+    auto inputs = std::vector<cbdc::transaction::input>(3);
+    for(size_t i = 0; i < inputs.size(); i++) {
+        inputs[i].m_prevout.m_tx_id[0] = static_cast<unsigned char>(i);
+        inputs[i].m_prevout.m_index = i + 1;
+        inputs[i].m_prevout_data.m_witness_program_commitment[1]
+            = static_cast<unsigned char>(i + 2);
+        inputs[i].m_prevout_data.m_value = i + 3;
+    }
+
+    // Written the same as member by member
+    auto buf = cbdc::make_buffer(inputs);
+    auto expected = cbdc::buffer();
+    auto ser = cbdc::buffer_serializer(expected);
+    ser << static_cast<uint64_t>(inputs.size());
+    for(const auto& inp : inputs) {
+        ser << inp.m_prevout.m_tx_id << inp.m_prevout.m_index
+            << inp.m_prevout_data.m_witness_program_commitment
+            << inp.m_prevout_data.m_value;
+    }
+    ASSERT_EQ(buf, expected);
+
+    auto maybe_inputs
+        = cbdc::from_buffer<std::vector<cbdc::transaction::input>>(buf);
+    ASSERT_TRUE(maybe_inputs.has_value());
+    ASSERT_EQ(maybe_inputs.value(), inputs);
+}
+
+TEST(CTransaction, compact_tx_hash_excludes_attestations) {
+    auto ctx = cbdc::transaction::compact_tx();
+    ctx.m_id = {'i'};
+    for(unsigned char i = 0; i < 6; i++) {
+        ctx.m_inputs.push_back({'a', i});
+        ctx.m_uhs_outputs.push_back({'b', i});
+    }
+    auto expected = [&]() {
+        auto buf = cbdc::make_buffer(ctx);
+        return cbdc::hash_data(static_cast<const std::byte*>(buf.data()),
+                               buf.size());
+    }();
+    ASSERT_EQ(ctx.hash(), expected);
+
+    ctx.m_attestations.emplace(cbdc::pubkey_t{'k'}, cbdc::signature_t{'s'});
+    ASSERT_EQ(ctx.hash(), expected);
+}
+
+TEST(CTransaction, compact_tx_view) {
+    auto ctx = cbdc::transaction::compact_tx();
+    ctx.m_id = {'i'};
+    ctx.m_inputs = {{'a'}, {'b'}};
+    ctx.m_uhs_outputs = {{'c'}};
+    ctx.m_attestations.emplace(cbdc::pubkey_t{'k'}, cbdc::signature_t{'s'});
+    auto buf = cbdc::make_buffer(ctx);
+
+    auto view = cbdc::transaction::compact_tx_view::parse(buf);
+    ASSERT_TRUE(view.has_value());
+    ASSERT_EQ(view->size(), buf.size());
+    ASSERT_EQ(view->id(), ctx.m_id);
+    ASSERT_EQ(view->input_count(), 2UL);
+    ASSERT_EQ(view->input(1), ctx.m_inputs[1]);
+    ASSERT_EQ(view->output_count(), 1UL);
+    ASSERT_EQ(view->output(0), ctx.m_uhs_outputs[0]);
+    ASSERT_EQ(view->attestation_count(), 1UL);
+    ASSERT_EQ(view->attestation(0), *ctx.m_attestations.begin());
+    ASSERT_EQ(view->hash(), ctx.hash());
+
+    auto out = view->to_compact_tx();
+    ASSERT_EQ(out.m_id, ctx.m_id);
+    ASSERT_EQ(out.m_inputs, ctx.m_inputs);
+    ASSERT_EQ(out.m_uhs_outputs, ctx.m_uhs_outputs);
+    ASSERT_EQ(out.m_attestations, ctx.m_attestations);
+
+    // Every truncation leaves a count pointing past the end.
+    for(size_t len = 0; len < buf.size(); len++) {
+        ASSERT_FALSE(
+            cbdc::transaction::compact_tx_view::parse(buf.c_ptr(), len));
+    }
+}
+
+TEST(CTransaction, compact_tx_aggregate) {
+    auto ctx = cbdc::transaction::compact_tx();
+    ctx.m_id = {'i'};
+    ctx.m_inputs = {{'a'}};
+    ctx.m_uhs_outputs = {{'c'}};
+    auto agg = cbdc::transaction::aggregate_attestation();
+    agg.m_signers = 0b101;
+    agg.m_nonces = {{'r', 0}, {'r', 2}};
+    agg.m_s = {'s'};
+    ctx.m_aggregate = agg;
+    auto buf = cbdc::make_buffer(ctx);
+
+    auto out = cbdc::from_buffer<cbdc::transaction::compact_tx>(buf);
+    ASSERT_TRUE(out.has_value());
+    ASSERT_TRUE(out->m_attestations.empty());
+    ASSERT_EQ(out->m_aggregate, ctx.m_aggregate);
+    ASSERT_EQ(out->hash(), ctx.hash());
+
+    auto view = cbdc::transaction::compact_tx_view::parse(buf);
+    ASSERT_TRUE(view.has_value());
+    ASSERT_EQ(view->size(), buf.size());
+    ASSERT_EQ(view->attestation_count(), 0UL);
+    ASSERT_EQ(view->aggregate(), ctx.m_aggregate);
+    ASSERT_EQ(view->hash(), ctx.hash());
+    ASSERT_EQ(view->to_compact_tx().m_aggregate, ctx.m_aggregate);
+
+    for(size_t len = 0; len < buf.size(); len++) {
+        ASSERT_FALSE(
+            cbdc::transaction::compact_tx_view::parse(buf.c_ptr(), len));
+    }
+
+    // Without an aggregate, the encoding is unchanged.
+    auto plain = ctx;
+    plain.m_aggregate.reset();
+    ASSERT_FALSE(cbdc::transaction::compact_tx_view::parse(
+                     cbdc::make_buffer(plain))
+                     ->aggregate()
+                     .has_value());
+}
@@ -5,10 +5,15 @@
 
 #include "uhs/twophase/coordinator/distributed_tx.hpp"
 #include "uhs/twophase/locking_shard/locking_shard.hpp"
+#include "util/persistence/hash_export.hpp"
 
+#include <atomic>
+#include <filesystem>
+#include <future>
 #include <gtest/gtest.h>
 #include <queue>
 #include <random>
+#include <thread>
 
 class TwoPhaseTest : public ::testing::Test {
   public:
@@ -17,6 +22,17 @@ class TwoPhaseTest : public ::testing::Test {
     }
 
   protected:
+    /// Routes UHS IDs to the given shards by their output ranges.
+    static auto prefix_map(
+        const std::vector<std::shared_ptr<cbdc::locking_shard::interface>>&
+            shards) -> std::shared_ptr<const cbdc::shard_prefix_map> {
+        auto ranges = std::vector<cbdc::shard_prefix_map::range_t>();
+        for(const auto& shard : shards) {
+            ranges.push_back(shard->output_range());
+        }
+        return std::make_shared<const cbdc::shard_prefix_map>(ranges);
+    }
+
     cbdc::config::options m_opts{};
 };
 
@@ -77,7 +93,10 @@ TEST_F(TwoPhaseTest, test_two_shards) {
     }
 
     auto coordinator
-        = cbdc::coordinator::distributed_tx(cbdc::hash_t(), shards, logger);
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
     for(const auto& tx : txs) {
         coordinator.add_tx(tx);
     }
@@ -211,7 +230,10 @@ TEST_F(TwoPhaseTest, test_two_shards_random) {
     }
 
     auto coordinator
-        = cbdc::coordinator::distributed_tx(cbdc::hash_t(), shards, logger);
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
     for(const auto& tx : txs) {
         coordinator.add_tx(tx);
     }
@@ -248,7 +270,10 @@ TEST_F(TwoPhaseTest, test_two_shards_random) {
     }
 
     auto coordinator2
-        = cbdc::coordinator::distributed_tx(cbdc::hash_t(), shards, logger);
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
     for(const auto& tx : txs) {
         coordinator2.add_tx(tx);
     }
@@ -307,7 +332,10 @@ TEST_F(TwoPhaseTest, test_two_shards_conflicting) {
     }
 
     auto coordinator
-        = cbdc::coordinator::distributed_tx(cbdc::hash_t(), shards, logger);
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
     for(const auto& tx : txs) {
         coordinator.add_tx(tx);
     }
@@ -349,7 +377,10 @@ TEST_F(TwoPhaseTest, test_two_shards_conflicting) {
     }
 
     auto coordinator2
-        = cbdc::coordinator::distributed_tx(cbdc::hash_t(), shards, logger);
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
     for(const auto& tx : txs) {
         coordinator2.add_tx(tx);
     }
@@ -379,3 +410,790 @@ TEST_F(TwoPhaseTest, test_two_shards_conflicting) {
         ASSERT_FALSE((*res)[i]);
     }
 }
+
+TEST_F(TwoPhaseTest, test_one_shard_concurrent_dtxs) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    m_opts.m_shard_lock_stripes = 8;
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+
+    static constexpr size_t n_threads{4};
+    static constexpr size_t n_txs{200};
+    auto make_id = [](size_t thread, size_t i, uint8_t tag) {
+        auto ret = cbdc::hash_t();
+        ret[0] = tag;
+        std::memcpy(&ret[1], &i, sizeof(i));
+        ret[cbdc::hash_size - 1] = static_cast<uint8_t>(thread);
+        return ret;
+    };
+
+    // Each thread mints outputs then spends them in its own dtxs, while
+    // one shared output is raced for by every thread.
+    auto shared_tx = cbdc::locking_shard::tx();
+    const auto shared_output = make_id(n_threads, 0, 2);
+    shared_tx.m_tx.m_uhs_outputs.push_back(shared_output);
+    auto mint = shard.lock_outputs({shared_tx}, make_id(n_threads, 0, 3));
+    ASSERT_TRUE(mint.has_value());
+    ASSERT_TRUE(
+        shard.apply_outputs(std::move(mint.value()), make_id(n_threads, 0, 3)));
+
+    auto shared_spends = std::atomic<size_t>{0};
+    auto failures = std::atomic<size_t>{0};
+    auto threads = std::vector<std::thread>();
+    for(size_t t{0}; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            auto txs = std::vector<cbdc::locking_shard::tx>();
+            for(size_t i{0}; i < n_txs; i++) {
+                auto tx = cbdc::locking_shard::tx();
+                tx.m_tx.m_uhs_outputs.push_back(make_id(t, i, 0));
+                txs.push_back(tx);
+            }
+            auto dtx_id = make_id(t, 0, 1);
+            auto res = shard.lock_outputs(std::move(txs), dtx_id);
+            if(!res.has_value()
+               || !shard.apply_outputs(std::move(res.value()), dtx_id)) {
+                failures++;
+                return;
+            }
+
+            txs = std::vector<cbdc::locking_shard::tx>();
+            for(size_t i{0}; i < n_txs; i++) {
+                auto tx = cbdc::locking_shard::tx();
+                tx.m_tx.m_inputs.push_back(make_id(t, i, 0));
+                tx.m_tx.m_uhs_outputs.push_back(make_id(t, i, 4));
+                txs.push_back(tx);
+            }
+            auto spend = cbdc::locking_shard::tx();
+            spend.m_tx.m_inputs.push_back(shared_output);
+            txs.push_back(spend);
+            dtx_id = make_id(t, 1, 1);
+            res = shard.lock_outputs(std::move(txs), dtx_id);
+            if(!res.has_value()) {
+                failures++;
+                return;
+            }
+            for(size_t i{0}; i < n_txs; i++) {
+                if(!(*res)[i]) {
+                    failures++;
+                }
+            }
+            if(res->back()) {
+                shared_spends++;
+            }
+            if(!shard.apply_outputs(std::move(res.value()), dtx_id)) {
+                failures++;
+            }
+        });
+    }
+    for(auto& th : threads) {
+        th.join();
+    }
+
+    ASSERT_EQ(failures, 0U);
+    ASSERT_EQ(shared_spends, 1U);
+    ASSERT_FALSE(shard.check_unspent(shared_output).value());
+    for(size_t t{0}; t < n_threads; t++) {
+        for(size_t i{0}; i < n_txs; i++) {
+            ASSERT_FALSE(shard.check_unspent(make_id(t, i, 0)).value());
+            ASSERT_TRUE(shard.check_unspent(make_id(t, i, 4)).value());
+        }
+    }
+}
+
+TEST_F(TwoPhaseTest, test_parallel_attestation_checks) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::error);
+    m_opts.m_shard_attestation_threads = 4;
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+
+    // Attestations from unknown sentinels fail the check, so every third
+    // tx must come back unlocked whichever thread checked it.
+    auto txs = std::vector<cbdc::locking_shard::tx>();
+    for(size_t i{0}; i < 1000; i++) {
+        auto tx = cbdc::locking_shard::tx();
+        auto uhs_id = cbdc::hash_t();
+        std::memcpy(uhs_id.data(), &i, sizeof(i));
+        tx.m_tx.m_uhs_outputs.push_back(uhs_id);
+        if(i % 3 == 0) {
+            tx.m_tx.m_attestations.insert({cbdc::pubkey_t{{1}}, {}});
+        }
+        txs.push_back(tx);
+    }
+
+    auto lock_res = shard.lock_outputs(std::move(txs), cbdc::hash_t());
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_EQ(lock_res->size(), 1000U);
+    for(size_t i{0}; i < lock_res->size(); i++) {
+        ASSERT_EQ((*lock_res)[i], i % 3 != 0);
+    }
+}
+
+TEST_F(TwoPhaseTest, test_batch_status_queries) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+
+    auto txs = std::vector<cbdc::locking_shard::tx>();
+    auto ids = std::vector<cbdc::hash_t>();
+    auto tx_ids = std::vector<cbdc::hash_t>();
+    for(size_t i{0}; i < 100; i++) {
+        auto uhs_id = cbdc::hash_t();
+        std::memcpy(&uhs_id[1], &i, sizeof(i));
+        ids.push_back(uhs_id);
+        auto tx_id = uhs_id;
+        tx_id[0] = 1;
+        tx_ids.push_back(tx_id);
+        // Mint only the even IDs.
+        if(i % 2 == 0) {
+            auto tx = cbdc::locking_shard::tx();
+            tx.m_tx.m_id = tx_id;
+            tx.m_tx.m_uhs_outputs.push_back(uhs_id);
+            txs.push_back(tx);
+        }
+    }
+    auto dtx_id = cbdc::hash_t{{2}};
+    auto lock_res = shard.lock_outputs(std::move(txs), dtx_id);
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_TRUE(shard.apply_outputs(std::move(lock_res.value()), dtx_id));
+
+    auto unspent = shard.check_unspent_batch(ids);
+    ASSERT_TRUE(unspent.has_value());
+    auto confirmed = shard.check_tx_id_batch(tx_ids);
+    ASSERT_TRUE(confirmed.has_value());
+    ASSERT_EQ(unspent->size(), ids.size());
+    ASSERT_EQ(confirmed->size(), tx_ids.size());
+    for(size_t i{0}; i < ids.size(); i++) {
+        ASSERT_EQ((*unspent)[i], i % 2 == 0);
+        ASSERT_EQ((*unspent)[i], shard.check_unspent(ids[i]).value());
+        ASSERT_EQ((*confirmed)[i], i % 2 == 0);
+    }
+}
+
+TEST_F(TwoPhaseTest, test_apply_unknown_dtx) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+    // An apply for a dtx the shard no longer remembers is acknowledged
+    // rather than stopping the shard.
+    ASSERT_TRUE(shard.apply_outputs({true}, cbdc::hash_t{{3}}));
+}
+
+TEST_F(TwoPhaseTest, test_snapshot_restore) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+    auto ids = std::vector<cbdc::hash_t>();
+    for(size_t i{0}; i < 5; i++) {
+        auto uhs_id = cbdc::hash_t();
+        std::memcpy(&uhs_id[1], &i, sizeof(i));
+        ids.push_back(uhs_id);
+    }
+    ASSERT_TRUE(shard.take_uhs_delta().m_added.empty());
+
+    auto mint = std::vector<cbdc::locking_shard::tx>();
+    for(size_t i{0}; i < 4; i++) {
+        auto tx = cbdc::locking_shard::tx();
+        tx.m_tx.m_id = ids[i];
+        tx.m_tx.m_id[0] = 1;
+        tx.m_tx.m_uhs_outputs.push_back(ids[i]);
+        mint.push_back(tx);
+    }
+    auto mint_dtx = cbdc::hash_t{{2}};
+    auto lock_res = shard.lock_outputs(std::move(mint), mint_dtx);
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_TRUE(shard.apply_outputs(std::move(lock_res.value()), mint_dtx));
+    auto delta = shard.take_uhs_delta();
+    ASSERT_EQ(delta.m_added,
+              std::vector<cbdc::hash_t>(ids.begin(), ids.begin() + 4));
+    ASSERT_TRUE(delta.m_removed.empty());
+
+    // Leave a dtx spending ids[0] into ids[4] prepared but not applied.
+    auto spend = cbdc::locking_shard::tx();
+    spend.m_tx.m_inputs.push_back(ids[0]);
+    spend.m_tx.m_uhs_outputs.push_back(ids[4]);
+    auto spend_dtx = cbdc::hash_t{{3}};
+    lock_res = shard.lock_outputs({spend}, spend_dtx);
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_TRUE(lock_res.value()[0]);
+    delta = shard.take_uhs_delta();
+    ASSERT_TRUE(delta.m_added.empty());
+    ASSERT_EQ(delta.m_removed, std::vector<cbdc::hash_t>{ids[0]});
+
+    auto restored = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                       logger,
+                                                       10000,
+                                                       "",
+                                                       m_opts);
+    ASSERT_TRUE(restored.restore(shard.uhs_image(), shard.dtx_state()));
+    ASSERT_EQ(restored.uhs_image(), shard.uhs_image());
+    ASSERT_FALSE(restored.check_unspent(ids[0]).value());
+    ASSERT_TRUE(restored.check_unspent(ids[1]).value());
+
+    // The prepared dtx survives the restore, and applying it is tracked.
+    ASSERT_TRUE(restored.apply_outputs(std::move(lock_res.value()),
+                                       spend_dtx));
+    ASSERT_TRUE(restored.check_unspent(ids[4]).value());
+    delta = restored.take_uhs_delta();
+    ASSERT_EQ(delta.m_added, std::vector<cbdc::hash_t>{ids[4]});
+    ASSERT_TRUE(delta.m_removed.empty());
+    ASSERT_TRUE(restored.discard_dtx(spend_dtx));
+}
+
+TEST_F(TwoPhaseTest, test_uhs_export) {
+    static constexpr auto export_file = "test_locking_shard_export.uhs";
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+    auto ids = std::vector<cbdc::hash_t>();
+    for(size_t i{0}; i < 5; i++) {
+        auto uhs_id = cbdc::hash_t();
+        uhs_id[1] = static_cast<unsigned char>(i);
+        ids.push_back(uhs_id);
+    }
+
+    auto mint = std::vector<cbdc::locking_shard::tx>();
+    for(size_t i{0}; i < 4; i++) {
+        auto tx = cbdc::locking_shard::tx();
+        tx.m_tx.m_id = ids[i];
+        tx.m_tx.m_id[0] = 1;
+        tx.m_tx.m_uhs_outputs.push_back(ids[i]);
+        mint.push_back(tx);
+    }
+    auto mint_dtx = cbdc::hash_t{{2}};
+    auto lock_res = shard.lock_outputs(std::move(mint), mint_dtx);
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_TRUE(shard.apply_outputs(std::move(lock_res.value()), mint_dtx));
+
+    // Lock ids[0] for a dtx spending it into ids[4]
+    auto spend = cbdc::locking_shard::tx();
+    spend.m_tx.m_inputs.push_back(ids[0]);
+    spend.m_tx.m_uhs_outputs.push_back(ids[4]);
+    auto spend_dtx = cbdc::hash_t{{3}};
+    lock_res = shard.lock_outputs({spend}, spend_dtx);
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_TRUE(lock_res.value()[0]);
+
+    auto start_export = [&](uint64_t label) {
+        auto done = std::make_shared<std::promise<bool>>();
+        auto ret = done->get_future();
+        EXPECT_TRUE(shard.export_uhs(export_file, label, [done](bool ok) {
+            done->set_value(ok);
+        }));
+        return ret;
+    };
+
+    // Locked UHS IDs are exported as unspent, and applying the dtx after
+    // the export starts does not affect it
+    auto res = start_export(7);
+    ASSERT_TRUE(shard.apply_outputs(std::move(lock_res.value()), spend_dtx));
+    ASSERT_TRUE(res.get());
+    auto got = cbdc::persistence::read_hash_export(export_file);
+    ASSERT_TRUE(got.has_value());
+    ASSERT_EQ(got->m_label, 7UL);
+    ASSERT_EQ(got->m_hashes,
+              std::vector<cbdc::hash_t>(ids.begin(), ids.begin() + 4));
+
+    ASSERT_TRUE(start_export(8).get());
+    got = cbdc::persistence::read_hash_export(export_file);
+    ASSERT_TRUE(got.has_value());
+    ASSERT_EQ(got->m_hashes,
+              std::vector<cbdc::hash_t>(ids.begin() + 1, ids.end()));
+    std::filesystem::remove(export_file);
+}
+
+TEST_F(TwoPhaseTest, test_range_move) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto src = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                  logger,
+                                                  10000,
+                                                  "",
+                                                  m_opts);
+    auto dst = cbdc::locking_shard::locking_shard(std::make_pair(128, 255),
+                                                  logger,
+                                                  10000,
+                                                  "",
+                                                  m_opts);
+    const auto range = cbdc::locking_shard::locking_shard::range_t{128, 255};
+    auto ids = std::vector<cbdc::hash_t>();
+    for(int prefix : {200, 201, 202, 10}) {
+        auto uhs_id = cbdc::hash_t();
+        uhs_id[0] = static_cast<unsigned char>(prefix);
+        ids.push_back(uhs_id);
+    }
+
+    auto mint = std::vector<cbdc::locking_shard::tx>();
+    for(size_t i{0}; i < 3; i++) {
+        auto tx = cbdc::locking_shard::tx();
+        tx.m_tx.m_id = ids[i];
+        tx.m_tx.m_id[1] = 1;
+        tx.m_tx.m_uhs_outputs.push_back(ids[i]);
+        mint.push_back(tx);
+    }
+    auto mint_dtx = cbdc::hash_t{{1}};
+    auto lock_res = src.lock_outputs(std::move(mint), mint_dtx);
+    ASSERT_TRUE(lock_res.has_value());
+    ASSERT_TRUE(src.apply_outputs(std::move(lock_res.value()), mint_dtx));
+
+    ASSERT_FALSE(dst.begin_import({0, 255}));
+    ASSERT_FALSE(dst.import_uhs({ids[0]}));
+    ASSERT_TRUE(dst.begin_import(range));
+    ASSERT_TRUE(dst.begin_import(range));
+
+    // While importing, the target accepts inputs it does not hold yet and
+    // remembers they were spent
+    auto spend = cbdc::locking_shard::tx();
+    spend.m_tx.m_id[0] = 210;
+    spend.m_tx.m_inputs.push_back(ids[0]);
+    spend.m_tx.m_uhs_outputs.push_back(ids[3]);
+    auto spend_dtx = cbdc::hash_t{{2}};
+    for(auto* shard : {&src, &dst}) {
+        lock_res = shard->lock_outputs({spend}, spend_dtx);
+        ASSERT_TRUE(lock_res.has_value());
+        ASSERT_TRUE(lock_res.value()[0]);
+        ASSERT_TRUE(shard->apply_outputs(std::move(lock_res.value()),
+                                         spend_dtx));
+    }
+
+    // A snapshot taken mid-import keeps the import going
+    auto restored = cbdc::locking_shard::locking_shard(
+        std::make_pair(128, 255),
+        logger,
+        10000,
+        "",
+        m_opts);
+    ASSERT_TRUE(restored.restore(dst.uhs_image(), dst.dtx_state()));
+
+    for(auto* shard : {&dst, &restored}) {
+        auto chunk = src.read_range(range, 0);
+        ASSERT_TRUE(chunk.has_value());
+        ASSERT_EQ(chunk.value(),
+                  std::vector<cbdc::hash_t>(ids.begin() + 1, ids.begin() + 3));
+        ASSERT_TRUE(src.read_range(range, chunk->size())->empty());
+        // The spent input arrives late and is not re-added
+        chunk->push_back(ids[0]);
+        ASSERT_TRUE(shard->import_uhs(chunk.value()));
+        ASSERT_TRUE(shard->end_import());
+        ASSERT_FALSE(shard->end_import());
+
+        ASSERT_FALSE(shard->check_unspent(ids[0]).value());
+        ASSERT_TRUE(shard->check_unspent(ids[1]).value());
+        ASSERT_TRUE(shard->check_unspent(ids[2]).value());
+    }
+
+    ASSERT_FALSE(src.read_range({5, 4}, 0).has_value());
+    ASSERT_TRUE(src.drop_range(range));
+    ASSERT_FALSE(src.check_unspent(ids[1]).value());
+    ASSERT_FALSE(src.hash_in_shard_range(ids[1]));
+    ASSERT_TRUE(src.hash_in_shard_range(ids[3]));
+    ASSERT_TRUE(src.check_unspent(ids[3]).value());
+}
+
+TEST_F(TwoPhaseTest, test_results_before_discard) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard0 = std::make_shared<cbdc::locking_shard::locking_shard>(
+        std::make_pair(0, 127),
+        logger,
+        10000,
+        "",
+        m_opts);
+    auto shard1 = std::make_shared<cbdc::locking_shard::locking_shard>(
+        std::make_pair(128, 255),
+        logger,
+        10000,
+        "",
+        m_opts);
+    auto shards = std::vector<std::shared_ptr<cbdc::locking_shard::interface>>(
+        {shard0, shard1});
+
+    auto coordinator
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
+    for(size_t i{0}; i < 10; i++) {
+        auto tx = cbdc::transaction::compact_tx();
+        tx.m_id[0] = static_cast<uint8_t>(i * 25);
+        tx.m_uhs_outputs.push_back(tx.m_id);
+        coordinator.add_tx(tx);
+    }
+
+    auto results = std::optional<std::vector<bool>>();
+    auto discarded = false;
+    coordinator.set_result_cb([&](const std::vector<bool>& res) {
+        ASSERT_FALSE(discarded);
+        results = res;
+    });
+    coordinator.set_discard_cb([&](const cbdc::hash_t& /* dtx_id */) {
+        discarded = true;
+        return true;
+    });
+    auto res = coordinator.execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_TRUE(discarded);
+    ASSERT_EQ(results, res);
+    ASSERT_EQ(res->size(), 10UL);
+}
+
+TEST_F(TwoPhaseTest, test_lock_and_apply) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    m_opts);
+
+    auto mint = cbdc::locking_shard::tx();
+    mint.m_tx.m_id = {'a'};
+    mint.m_tx.m_uhs_outputs = {{'b'}};
+    auto res = shard.lock_and_apply({mint}, {'x'});
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>({true}));
+    ASSERT_TRUE(shard.check_unspent({'b'}).value());
+    ASSERT_TRUE(shard.check_tx_id({'a'}).value());
+
+    // The second spend of the same input is cancelled.
+    auto spend = cbdc::locking_shard::tx();
+    spend.m_tx.m_id = {'c'};
+    spend.m_tx.m_inputs = {{'b'}};
+    spend.m_tx.m_uhs_outputs = {{'d'}};
+    auto double_spend = spend;
+    double_spend.m_tx.m_uhs_outputs = {{'e'}};
+    res = shard.lock_and_apply({spend, double_spend}, {'y'});
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>({true, false}));
+    ASSERT_FALSE(shard.check_unspent({'b'}).value());
+    ASSERT_TRUE(shard.check_unspent({'d'}).value());
+    ASSERT_FALSE(shard.check_unspent({'e'}).value());
+
+    // A retry returns the first result without applying the batch again.
+    res = shard.lock_and_apply({spend, double_spend}, {'y'});
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>({true, false}));
+
+    // Once discarded, the same batch is checked afresh and fails.
+    ASSERT_TRUE(shard.discard_dtx({'y'}));
+    res = shard.lock_and_apply({spend}, {'y'});
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>({false}));
+}
+
+TEST_F(TwoPhaseTest, test_lock_and_apply_results_age_out) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto opts = m_opts;
+    opts.m_shard_applied_dtx_generation_size = 2;
+    opts.m_shard_applied_dtx_generations = 1;
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    10000,
+                                                    "",
+                                                    opts);
+
+    auto mint = cbdc::locking_shard::tx();
+    mint.m_tx.m_id = {'m'};
+    auto spends = std::vector<cbdc::locking_shard::tx>();
+    for(uint8_t i{0}; i < 5; i++) {
+        mint.m_tx.m_uhs_outputs.push_back({static_cast<uint8_t>(i + 100)});
+        auto spend = cbdc::locking_shard::tx();
+        spend.m_tx.m_id = {i};
+        spend.m_tx.m_inputs = {{static_cast<uint8_t>(i + 100)}};
+        spends.push_back(spend);
+    }
+    ASSERT_TRUE(shard.lock_and_apply({mint}, {'m'}).has_value());
+    for(uint8_t i{0}; i < 5; i++) {
+        auto res = shard.lock_and_apply({spends[i]}, {i});
+        ASSERT_TRUE(res.has_value());
+        ASSERT_EQ(res.value(), std::vector<bool>({true}));
+    }
+
+    // Results whose discard never arrives are kept for one full
+    // generation besides the one being filled.
+    ASSERT_EQ(shard.memory().m_one_phase_dtxs.m_entries, 4UL);
+    auto res = shard.lock_and_apply({spends[4]}, {4});
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>({true}));
+
+    // The oldest results are forgotten, so a retry is checked afresh.
+    res = shard.lock_and_apply({spends[0]}, {0});
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>({false}));
+}
+
+TEST_F(TwoPhaseTest, test_single_shard_dtx) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard0 = std::make_shared<cbdc::locking_shard::locking_shard>(
+        std::make_pair(0, 127),
+        logger,
+        10000,
+        "",
+        m_opts);
+    auto shard1 = std::make_shared<cbdc::locking_shard::locking_shard>(
+        std::make_pair(128, 255),
+        logger,
+        10000,
+        "",
+        m_opts);
+    auto shards = std::vector<std::shared_ptr<cbdc::locking_shard::interface>>(
+        {shard0, shard1});
+
+    auto mints = std::vector<cbdc::transaction::compact_tx>();
+    auto spends = std::vector<cbdc::transaction::compact_tx>();
+    for(uint8_t i{0}; i < 10; i++) {
+        auto tx = cbdc::transaction::compact_tx();
+        tx.m_id = {i};
+        tx.m_uhs_outputs.push_back({i, 1});
+        mints.push_back(tx);
+        tx.m_id = {i, 2};
+        tx.m_inputs = tx.m_uhs_outputs;
+        tx.m_uhs_outputs = {{i, 3}};
+        spends.push_back(tx);
+    }
+
+    // Every tx maps to the first shard, so there is no commit phase.
+    auto committed = false;
+    auto commit_cb
+        = [&](const cbdc::hash_t& /* dtx_id */,
+              const std::vector<bool>& /* complete_txs */,
+              const std::vector<std::vector<uint64_t>>& /* tx_idxs */) {
+              committed = true;
+              return true;
+          };
+    auto coordinator
+        = cbdc::coordinator::distributed_tx({'a'},
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
+    for(const auto& tx : mints) {
+        coordinator.add_tx(tx);
+    }
+    coordinator.set_commit_cb(commit_cb);
+    auto res = coordinator.execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>(10, true));
+    ASSERT_FALSE(committed);
+    for(uint8_t i{0}; i < 10; i++) {
+        ASSERT_TRUE(shard0->check_unspent({i, 1}).value());
+    }
+
+    // Fail before the discard phase, leaving only the prepare record.
+    coordinator = cbdc::coordinator::distributed_tx({'b'},
+                                                    shards,
+                                                    prefix_map(shards),
+                                                    logger);
+    for(const auto& tx : spends) {
+        coordinator.add_tx(tx);
+    }
+    coordinator.set_discard_cb([](const cbdc::hash_t& /* dtx_id */) {
+        return false;
+    });
+    res = coordinator.execute();
+    ASSERT_FALSE(res.has_value());
+    for(uint8_t i{0}; i < 10; i++) {
+        ASSERT_FALSE(shard0->check_unspent({i, 1}).value());
+        ASSERT_TRUE(shard0->check_unspent({i, 3}).value());
+    }
+
+    // Recovery repeats the call and gets the first result, even though
+    // the inputs are now spent.
+    coordinator = cbdc::coordinator::distributed_tx({'b'},
+                                                    shards,
+                                                    prefix_map(shards),
+                                                    logger);
+    coordinator.recover_prepare(spends);
+    coordinator.set_commit_cb(commit_cb);
+    res = coordinator.execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>(10, true));
+    ASSERT_FALSE(committed);
+}
+
+namespace {
+    // Completes asynchronous requests from another thread, in reverse
+    // order of shard ID so results arrive out of order.
+    class async_shard final : public cbdc::locking_shard::interface {
+      public:
+        async_shard(std::shared_ptr<cbdc::locking_shard::locking_shard> shard,
+                    std::chrono::milliseconds delay)
+            : interface(shard->output_range()),
+              m_shard(std::move(shard)),
+              m_delay(delay) {}
+
+        ~async_shard() override {
+            for(auto& t : m_threads) {
+                t.join();
+            }
+        }
+
+        async_shard(const async_shard&) = delete;
+        auto operator=(const async_shard&) -> async_shard& = delete;
+        async_shard(async_shard&&) = delete;
+        auto operator=(async_shard&&) -> async_shard& = delete;
+
+        auto lock_outputs(std::vector<cbdc::locking_shard::tx>&& txs,
+                          const cbdc::hash_t& dtx_id)
+            -> std::optional<std::vector<bool>> override {
+            return m_shard->lock_outputs(std::move(txs), dtx_id);
+        }
+
+        auto apply_outputs(std::vector<bool>&& complete_txs,
+                           const cbdc::hash_t& dtx_id) -> bool override {
+            return m_shard->apply_outputs(std::move(complete_txs), dtx_id);
+        }
+
+        auto lock_and_apply(std::vector<cbdc::locking_shard::tx>&& txs,
+                            const cbdc::hash_t& dtx_id)
+            -> std::optional<std::vector<bool>> override {
+            return m_shard->lock_and_apply(std::move(txs), dtx_id);
+        }
+
+        auto discard_dtx(const cbdc::hash_t& dtx_id) -> bool override {
+            return m_shard->discard_dtx(dtx_id);
+        }
+
+        void lock_outputs_async(std::vector<cbdc::locking_shard::tx>&& txs,
+                                const cbdc::hash_t& dtx_id,
+                                lock_callback_type cb) override {
+            m_calls++;
+            m_threads.emplace_back(
+                [this, t = std::move(txs), dtx_id, cb]() mutable {
+                    std::this_thread::sleep_for(m_delay);
+                    cb(m_shard->lock_outputs(std::move(t), dtx_id));
+                });
+        }
+
+        void apply_outputs_async(std::vector<bool>&& complete_txs,
+                                 const cbdc::hash_t& dtx_id,
+                                 done_callback_type cb) override {
+            m_calls++;
+            m_threads.emplace_back(
+                [this, c = std::move(complete_txs), dtx_id, cb]() mutable {
+                    std::this_thread::sleep_for(m_delay);
+                    cb(m_shard->apply_outputs(std::move(c), dtx_id));
+                });
+        }
+
+        void discard_dtx_async(const cbdc::hash_t& dtx_id,
+                               done_callback_type cb) override {
+            m_calls++;
+            m_threads.emplace_back([this, dtx_id, cb]() {
+                std::this_thread::sleep_for(m_delay);
+                cb(m_shard->discard_dtx(dtx_id));
+            });
+        }
+
+        void stop() override {}
+
+        std::atomic<size_t> m_calls{0};
+
+      private:
+        std::shared_ptr<cbdc::locking_shard::locking_shard> m_shard;
+        std::chrono::milliseconds m_delay;
+        std::vector<std::thread> m_threads;
+    };
+}
+
+TEST_F(TwoPhaseTest, test_async_fan_out) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shards
+        = std::vector<std::shared_ptr<cbdc::locking_shard::interface>>();
+    auto async_shards = std::vector<std::shared_ptr<async_shard>>();
+    constexpr size_t n_shards{4};
+    for(size_t i{0}; i < n_shards; i++) {
+        auto shard = std::make_shared<cbdc::locking_shard::locking_shard>(
+            std::make_pair(static_cast<uint8_t>(i * 64),
+                           static_cast<uint8_t>(i * 64 + 63)),
+            logger,
+            10000,
+            "",
+            m_opts);
+        auto delay = std::chrono::milliseconds(10 * (n_shards - i));
+        async_shards.push_back(
+            std::make_shared<async_shard>(std::move(shard), delay));
+        shards.push_back(async_shards.back());
+    }
+
+    auto coordinator
+        = cbdc::coordinator::distributed_tx(cbdc::hash_t(),
+                                            shards,
+                                            prefix_map(shards),
+                                            logger);
+    for(size_t i{0}; i < 16; i++) {
+        auto tx = cbdc::transaction::compact_tx();
+        tx.m_id[0] = static_cast<uint8_t>(i * 16);
+        tx.m_uhs_outputs.push_back(tx.m_id);
+        coordinator.add_tx(tx);
+    }
+
+    auto res = coordinator.execute();
+    ASSERT_TRUE(res.has_value());
+    ASSERT_EQ(res.value(), std::vector<bool>(16, true));
+    for(const auto& shard : async_shards) {
+        // One request each for prepare, commit and discard.
+        ASSERT_EQ(shard->m_calls, 3UL);
+    }
+}
+
+TEST_F(TwoPhaseTest, test_memory_usage) {
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::warn);
+    auto shard = cbdc::locking_shard::locking_shard(std::make_pair(0, 255),
+                                                    logger,
+                                                    1000,
+                                                    "",
+                                                    m_opts);
+    auto txs = std::vector<cbdc::locking_shard::tx>();
+    for(size_t i{0}; i < 100; i++) {
+        auto tx = cbdc::locking_shard::tx();
+        auto uhs_id = cbdc::hash_t();
+        std::memcpy(uhs_id.data(), &i, sizeof(i));
+        tx.m_tx.m_id = uhs_id;
+        tx.m_tx.m_uhs_outputs.push_back(uhs_id);
+        txs.push_back(tx);
+    }
+
+    auto lock_res = shard.lock_outputs(std::move(txs), cbdc::hash_t());
+    ASSERT_TRUE(lock_res.has_value());
+    auto usage = shard.memory();
+    ASSERT_EQ(usage.m_prepared_dtxs.m_entries, 1UL);
+    ASSERT_GT(usage.m_prepared_dtxs.m_bytes,
+              100 * sizeof(cbdc::locking_shard::tx));
+    ASSERT_EQ(usage.m_uhs.m_entries, 0UL);
+    ASSERT_GT(usage.m_completed_txs.m_bytes, 0UL);
+
+    ASSERT_TRUE(shard.apply_outputs(std::move(*lock_res), cbdc::hash_t()));
+    usage = shard.memory();
+    ASSERT_EQ(usage.m_prepared_dtxs.m_entries, 0UL);
+    ASSERT_EQ(usage.m_applied_dtxs.m_entries, 1UL);
+    ASSERT_EQ(usage.m_uhs.m_entries, 100UL);
+    ASSERT_GE(usage.m_uhs.m_bytes, 100 * sizeof(cbdc::hash_t));
+    ASSERT_EQ(usage.m_completed_txs.m_entries, 100UL);
+}
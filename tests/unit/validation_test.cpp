@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "uhs/transaction/messages.hpp"
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
 
@@ -133,6 +134,29 @@ TEST_F(WalletTxValidationTest, duplicate_input) {
               cbdc::transaction::validation::input_error_code::duplicate);
 }
 
+TEST_F(WalletTxValidationTest, duplicate_input_large_tx) {
+    auto tx = cbdc::transaction::full_tx();
+    for(uint64_t i = 0; i < 40; i++) {
+        auto inp = cbdc::transaction::input();
+        inp.m_prevout.m_tx_id = m_valid_tx.m_inputs[0].m_prevout.m_tx_id;
+        inp.m_prevout.m_index = 40 - i;
+        tx.m_inputs.push_back(inp);
+    }
+    ASSERT_FALSE(
+        cbdc::transaction::validation::check_input_set(tx).has_value());
+
+    tx.m_inputs[30].m_prevout = tx.m_inputs[5].m_prevout;
+    tx.m_inputs[25].m_prevout = tx.m_inputs[20].m_prevout;
+    tx.m_inputs[35].m_prevout = tx.m_inputs[20].m_prevout;
+    auto err = cbdc::transaction::validation::check_input_set(tx);
+    ASSERT_TRUE(err.has_value());
+    auto input_err
+        = std::get<cbdc::transaction::validation::input_error>(err.value());
+    ASSERT_EQ(input_err.m_idx, uint64_t{25});
+    ASSERT_EQ(input_err.m_code,
+              cbdc::transaction::validation::input_error_code::duplicate);
+}
+
 TEST_F(WalletTxValidationTest, invalid_input_prevout) {
     m_valid_tx.m_inputs[0].m_prevout_data.m_value = 0;
     auto err = cbdc::transaction::validation::check_tx(m_valid_tx);
@@ -246,6 +270,33 @@ TEST_F(WalletTxValidationTest, witness_p2pk_invalid_signature) {
         cbdc::transaction::validation::witness_error_code::invalid_signature);
 }
 
+TEST_F(WalletTxValidationTest, shared_key_witnesses) {
+    cbdc::transaction::wallet wallet1;
+    cbdc::transaction::wallet wallet2;
+    auto mint_tx = wallet1.mint_new_coins(1, 8);
+    wallet1.confirm_transaction(mint_tx);
+    auto fan_tx = wallet1.fan(4, 2, wallet1.generate_key(), true).value();
+    wallet1.confirm_transaction(fan_tx);
+
+    // Spending outputs paid to one key gives identical witnesses.
+    auto tx = wallet1.send_to(8, wallet2.generate_key(), true).value();
+    ASSERT_EQ(tx.m_witness.size(), 4UL);
+    ASSERT_EQ(tx.m_witness[0], tx.m_witness[3]);
+    ASSERT_FALSE(cbdc::transaction::validation::check_tx(tx).has_value());
+
+    // A witness differing from the verified ones is still verified.
+    auto& wit = tx.m_witness[3];
+    wit.back() = std::byte(uint8_t(wit.back()) + 1);
+    auto err = cbdc::transaction::validation::check_tx(tx);
+    ASSERT_TRUE(err.has_value());
+    auto expected = cbdc::transaction::validation::tx_error{
+        cbdc::transaction::validation::witness_error{
+            cbdc::transaction::validation::witness_error_code::
+                invalid_signature,
+            3}};
+    ASSERT_EQ(err.value(), expected);
+}
+
 TEST_F(WalletTxValidationTest,
        check_transaction_with_unknown_witness_program_type) {
     m_valid_tx.m_witness[0][0] = std::byte(0xFF);
@@ -336,3 +387,151 @@ TEST_F(WalletTxValidationTest, sign_verify_compact) {
     ASSERT_FALSE(
         cbdc::transaction::validation::check_attestations(ctx, m_pubkeys, 2));
 }
+
+TEST_F(WalletTxValidationTest, attestation_cache) {
+    auto ctx = cbdc::transaction::compact_tx(m_valid_tx);
+    auto att0 = ctx.sign(m_secp.get(), m_priv0);
+    auto att1 = ctx.sign(m_secp.get(), m_priv1);
+    ctx.m_attestations.insert(att0);
+    ctx.m_attestations.insert(att1);
+
+    auto cache = cbdc::transaction::validation::attestation_cache(64);
+    auto key0 = cbdc::transaction::validation::attestation_cache::key(
+        ctx.hash(),
+        att0);
+    ASSERT_FALSE(cache.contains(key0));
+    ASSERT_TRUE(cbdc::transaction::validation::check_attestations(ctx,
+                                                                  m_pubkeys,
+                                                                  2,
+                                                                  cache));
+    ASSERT_TRUE(cache.contains(key0));
+
+    // A forged signature from a cached key is still rejected.
+    auto forged = ctx;
+    forged.m_attestations[att1.first][0] ^= 1;
+    ASSERT_FALSE(cbdc::transaction::validation::check_attestations(forged,
+                                                                   m_pubkeys,
+                                                                   2,
+                                                                   cache));
+
+    // So is a cached attestation attached to a different transaction.
+    auto other = ctx;
+    other.m_id[0] ^= 1;
+    ASSERT_FALSE(cbdc::transaction::validation::check_attestations(other,
+                                                                   m_pubkeys,
+                                                                   2,
+                                                                   cache));
+
+    // Keys outside the accepted set are rejected even when cached.
+    m_pubkeys.erase(att0.first);
+    ASSERT_FALSE(cbdc::transaction::validation::check_attestations(ctx,
+                                                                   m_pubkeys,
+                                                                   2,
+                                                                   cache));
+}
+
+TEST_F(WalletTxValidationTest, aggregate_attestations) {
+    auto ctx = cbdc::transaction::compact_tx(m_valid_tx);
+    ctx.m_attestations.insert(ctx.sign(m_secp.get(), m_priv0));
+    ctx.m_attestations.insert(ctx.sign(m_secp.get(), m_priv1));
+    const auto keys = cbdc::transaction::sorted_sentinel_keys(m_pubkeys);
+    auto agg = cbdc::transaction::aggregate_attestations(m_secp.get(),
+                                                         ctx.hash(),
+                                                         ctx.m_attestations,
+                                                         keys);
+    ASSERT_TRUE(agg.has_value());
+    ASSERT_EQ(agg->m_signers, 0b11U);
+    ASSERT_TRUE(cbdc::transaction::verify_aggregate(m_secp.get(),
+                                                    ctx.hash(),
+                                                    agg.value(),
+                                                    keys));
+
+    auto aggregated = ctx;
+    aggregated.m_attestations.clear();
+    aggregated.m_aggregate = agg;
+    auto cache = cbdc::transaction::validation::attestation_cache(64);
+    ASSERT_TRUE(cbdc::transaction::validation::check_attestations(aggregated,
+                                                                  m_pubkeys,
+                                                                  2,
+                                                                  cache));
+    ASSERT_FALSE(
+        cbdc::transaction::validation::check_attestations(aggregated,
+                                                          m_pubkeys,
+                                                          3,
+                                                          cache));
+    auto buf = cbdc::make_buffer(aggregated);
+    auto view = cbdc::transaction::compact_tx_view::parse(buf);
+    ASSERT_TRUE(view.has_value());
+    ASSERT_TRUE(cbdc::transaction::validation::check_attestations(view.value(),
+                                                                  m_pubkeys,
+                                                                  2,
+                                                                  cache));
+
+    // A tampered aggregate, or one claiming a signer who did not sign,
+    // fails verification.
+    auto forged = aggregated;
+    forged.m_aggregate->m_s[0] ^= 1;
+    ASSERT_FALSE(cbdc::transaction::validation::check_attestations(forged,
+                                                                   m_pubkeys,
+                                                                   2,
+                                                                   cache));
+    auto extra = agg.value();
+    extra.m_signers = 0b111;
+    extra.m_nonces.push_back(extra.m_nonces.back());
+    auto with_extra = m_pubkeys;
+    with_extra.insert(cbdc::pubkey_t{'k'});
+    ASSERT_FALSE(cbdc::transaction::verify_aggregate(
+        m_secp.get(),
+        ctx.hash(),
+        extra,
+        cbdc::transaction::sorted_sentinel_keys(with_extra)));
+
+    // So is an aggregate for another transaction.
+    auto other = aggregated;
+    other.m_id[0] ^= 1;
+    ASSERT_FALSE(cbdc::transaction::validation::check_attestations(other,
+                                                                   m_pubkeys,
+                                                                   2,
+                                                                   cache));
+}
+
+TEST_F(WalletTxValidationTest, check_attestations_view) {
+    auto ctx = cbdc::transaction::compact_tx(m_valid_tx);
+    auto att0 = ctx.sign(m_secp.get(), m_priv0);
+    auto att1 = ctx.sign(m_secp.get(), m_priv1);
+    ctx.m_attestations.insert(att0);
+    ctx.m_attestations.insert(att1);
+    auto cache = cbdc::transaction::validation::attestation_cache(64);
+
+    auto buf = cbdc::make_buffer(ctx);
+    auto view = cbdc::transaction::compact_tx_view::parse(buf);
+    ASSERT_TRUE(view.has_value());
+    ASSERT_TRUE(cbdc::transaction::validation::check_attestations(view.value(),
+                                                                  m_pubkeys,
+                                                                  2,
+                                                                  cache));
+    ASSERT_FALSE(
+        cbdc::transaction::validation::check_attestations(view.value(),
+                                                          m_pubkeys,
+                                                          3,
+                                                          cache));
+
+    // Repeating one attestation must not meet a threshold of two. Replace
+    // the empty attestation count with two copies of the same one.
+    auto unattested = ctx;
+    unattested.m_attestations.clear();
+    auto unattested_buf = cbdc::make_buffer(unattested);
+    auto atts = cbdc::make_buffer(
+        std::vector<cbdc::transaction::sentinel_attestation>{att0, att0});
+    auto dup_buf = cbdc::buffer();
+    dup_buf.append(unattested_buf.c_ptr(),
+                   unattested_buf.size() - sizeof(uint64_t));
+    dup_buf.append(atts.c_ptr(), atts.size());
+    auto dup_view = cbdc::transaction::compact_tx_view::parse(dup_buf);
+    ASSERT_TRUE(dup_view.has_value());
+    ASSERT_FALSE(
+        cbdc::transaction::validation::check_attestations(dup_view.value(),
+                                                          m_pubkeys,
+                                                          2,
+                                                          cache));
+}
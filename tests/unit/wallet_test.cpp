@@ -7,6 +7,7 @@
 #include "uhs/transaction/wallet.hpp"
 
 #include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
 
 class WalletTest : public ::testing::Test {
@@ -18,10 +19,12 @@ class WalletTest : public ::testing::Test {
 
     void TearDown() override {
         std::filesystem::remove(m_wallet_file);
+        std::filesystem::remove(m_journal_file);
     }
 
     cbdc::transaction::wallet m_wallet{};
     static constexpr auto m_wallet_file = "test_wallet.dat";
+    static constexpr auto m_journal_file = "test_wallet.dat.journal";
 };
 
 TEST_F(WalletTest, update_balance_basic) {
@@ -194,6 +197,64 @@ TEST_F(WalletTest, spend_order) {
     ASSERT_EQ(tx3->m_inputs[0], in2);
 }
 
+TEST_F(WalletTest, select_by_value) {
+    cbdc::transaction::input in0;
+    in0.m_prevout.m_tx_id = {'e'};
+    in0.m_prevout.m_index = 1;
+    in0.m_prevout_data.m_value = 14;
+    in0.m_prevout_data.m_witness_program_commitment = {'a'};
+
+    cbdc::transaction::input in1;
+    in1.m_prevout.m_tx_id = {'p'};
+    in1.m_prevout.m_index = 0;
+    in1.m_prevout_data.m_value = 22;
+    in1.m_prevout_data.m_witness_program_commitment = {'j'};
+
+    cbdc::transaction::input in2;
+    in2.m_prevout.m_tx_id = {'j'};
+    in2.m_prevout.m_index = 0;
+    in2.m_prevout_data.m_value = 33;
+    in2.m_prevout_data.m_witness_program_commitment = {'j'};
+
+    m_wallet.confirm_inputs({in0, in1, in2});
+
+    // An exact match is spent without change
+    auto pubkey = m_wallet.generate_key();
+    auto tx0 = m_wallet.send_to(22, pubkey, false);
+    ASSERT_TRUE(tx0.has_value());
+    ASSERT_EQ(tx0->m_inputs.size(), 1UL);
+    ASSERT_EQ(tx0->m_inputs[0], in1);
+    ASSERT_EQ(tx0->m_outputs.size(), 1UL);
+
+    // Otherwise the smallest UTXO covering the amount
+    auto tx1 = m_wallet.send_to(30, pubkey, false);
+    ASSERT_TRUE(tx1.has_value());
+    ASSERT_EQ(tx1->m_inputs.size(), 1UL);
+    ASSERT_EQ(tx1->m_inputs[0], in2);
+
+    // Otherwise the largest UTXOs
+    ASSERT_FALSE(m_wallet.send_to(115, pubkey, false).has_value());
+    auto tx2 = m_wallet.send_to(110, pubkey, false);
+    ASSERT_TRUE(tx2.has_value());
+    ASSERT_EQ(tx2->m_inputs.size(), 2UL);
+    ASSERT_EQ(tx2->m_inputs[1], in0);
+    ASSERT_EQ(m_wallet.balance(), 0UL);
+    ASSERT_EQ(m_wallet.count(), 0UL);
+}
+
+TEST(WalletSeedTest, seeded_uhs_ids) {
+    auto wal = cbdc::transaction::wallet();
+    wal.seed_readonly({'w'}, 10, 0, 100);
+    auto ids = wal.seeded_uhs_ids(5, 42);
+    ASSERT_EQ(ids.size(), 37UL);
+    for(size_t i = 0; i < ids.size(); i++) {
+        auto tx = wal.create_seeded_transaction(i + 5).value();
+        auto ctx = cbdc::transaction::compact_tx(tx);
+        ASSERT_EQ(ids[i], ctx.m_uhs_outputs[0]);
+    }
+    ASSERT_TRUE(wal.seeded_uhs_ids(7, 7).empty());
+}
+
 TEST_F(WalletTest, load_save) {
     m_wallet.save(m_wallet_file);
     auto new_wal = cbdc::transaction::wallet();
@@ -201,3 +262,69 @@ TEST_F(WalletTest, load_save) {
     ASSERT_EQ(m_wallet.balance(), new_wal.balance());
     ASSERT_EQ(m_wallet.count(), new_wal.count());
 }
+
+TEST_F(WalletTest, save_journal) {
+    m_wallet.save(m_wallet_file);
+    const auto base_size = std::filesystem::file_size(m_wallet_file);
+
+    // Later saves append the changes to the journal
+    auto payee = m_wallet.generate_key();
+    auto mint_tx = m_wallet.mint_new_coins(3, 10);
+    m_wallet.confirm_transaction(mint_tx);
+    auto send_tx = m_wallet.send_to(25, payee, false).value();
+    m_wallet.confirm_transaction(send_tx);
+    m_wallet.save(m_wallet_file);
+    ASSERT_EQ(std::filesystem::file_size(m_wallet_file), base_size);
+    ASSERT_GT(std::filesystem::file_size(m_journal_file), sizeof(uint64_t));
+
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(m_wallet_file);
+    ASSERT_EQ(new_wal.balance(), m_wallet.balance());
+    ASSERT_EQ(new_wal.count(), m_wallet.count());
+    ASSERT_TRUE(new_wal.send_to(m_wallet.balance(), payee, false).has_value());
+
+    // A torn final record is dropped
+    const auto journal_size = std::filesystem::file_size(m_journal_file);
+    {
+        std::ofstream journal(m_journal_file,
+                              std::ios::binary | std::ios::app);
+        journal.put(1);
+        journal.put(0);
+    }
+    auto torn_wal = cbdc::transaction::wallet();
+    torn_wal.load(m_wallet_file);
+    ASSERT_EQ(torn_wal.balance(), m_wallet.balance());
+    ASSERT_EQ(std::filesystem::file_size(m_journal_file), journal_size);
+}
+
+TEST_F(WalletTest, save_journal_other_file) {
+    static constexpr auto other_file = "test_wallet_other.dat";
+    m_wallet.save(m_wallet_file);
+    auto mint_tx = m_wallet.mint_new_coins(2, 10);
+    m_wallet.confirm_transaction(mint_tx);
+    m_wallet.save(other_file);
+
+    auto new_wal = cbdc::transaction::wallet();
+    new_wal.load(other_file);
+    ASSERT_EQ(new_wal.balance(), m_wallet.balance());
+    std::filesystem::remove(other_file);
+    std::filesystem::remove(std::string(other_file) + ".journal");
+}
+
+TEST_F(WalletTest, send_observer) {
+    cbdc::pubkey_t target_addr = {'a', 'b', 'c', 'd'};
+    auto observed = std::vector<std::pair<cbdc::hash_t, cbdc::pubkey_t>>();
+    m_wallet.set_send_observer(
+        [&](const cbdc::hash_t& tx_id, const cbdc::pubkey_t& payee) {
+            observed.emplace_back(tx_id, payee);
+        });
+
+    auto send_tx = m_wallet.send_to(25, target_addr, false).value();
+    ASSERT_EQ(observed.size(), 1UL);
+    ASSERT_EQ(observed[0].first, cbdc::transaction::tx_id(send_tx));
+    ASSERT_EQ(observed[0].second, target_addr);
+
+    m_wallet.set_send_observer({});
+    m_wallet.send_to(25, target_addr, false);
+    ASSERT_EQ(observed.size(), 1UL);
+}
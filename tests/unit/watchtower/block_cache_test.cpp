@@ -82,3 +82,40 @@ TEST_F(BlockCacheTest, add_k_plus_1) {
 
     ASSERT_EQ(m_bc.best_block_height(), 47UL);
 }
+
+TEST(BlockCacheRingTest, evicts_oldest_blocks) {
+    static constexpr size_t n_blocks = 64;
+    static constexpr size_t txs_per_block = 100;
+    auto bc = cbdc::watchtower::block_cache(4);
+    auto uhs_id = [](size_t blk, size_t tx) {
+        auto id = cbdc::hash_t{};
+        id[0] = static_cast<unsigned char>(blk);
+        id[1] = static_cast<unsigned char>(tx);
+        return id;
+    };
+
+    // Each block spends the outputs of the one before it
+    for(size_t h{1}; h <= n_blocks; h++) {
+        cbdc::atomizer::block blk;
+        blk.m_height = h;
+        for(size_t i{0}; i < txs_per_block; i++) {
+            blk.m_transactions.push_back(
+                cbdc::test::simple_tx(uhs_id(h, i),
+                                      {uhs_id(h - 1, i)},
+                                      {uhs_id(h, i)}));
+        }
+        bc.push_block(std::move(blk));
+    }
+
+    for(size_t i{0}; i < txs_per_block; i++) {
+        ASSERT_EQ(bc.check_unspent(uhs_id(n_blocks, i)).value(),
+                  std::make_pair(n_blocks, uhs_id(n_blocks, i)));
+        ASSERT_FALSE(bc.check_unspent(uhs_id(n_blocks - 1, i)).has_value());
+        ASSERT_EQ(bc.check_spent(uhs_id(n_blocks - 4, i)).value(),
+                  std::make_pair(n_blocks - 3, uhs_id(n_blocks - 3, i)));
+        // Spent by an evicted block
+        ASSERT_FALSE(bc.check_spent(uhs_id(n_blocks - 5, i)).has_value());
+        ASSERT_FALSE(bc.check_unspent(uhs_id(n_blocks - 5, i)).has_value());
+    }
+    ASSERT_EQ(bc.best_block_height(), n_blocks);
+}
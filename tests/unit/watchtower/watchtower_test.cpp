@@ -154,3 +154,127 @@ TEST_F(WatchtowerTest, best_block_height) {
               (cbdc::watchtower::response{
                   cbdc::watchtower::best_block_height_response{44}}));
 }
+
+TEST_F(WatchtowerTest, subscribe_notified_by_block) {
+    constexpr uint64_t subscriber{7};
+    auto res = m_watchtower.handle_status_subscribe_request(
+        subscriber,
+        cbdc::watchtower::status_subscribe_request{
+            {{{'E'}, {{'G'}}}, {{'N'}, {{'o'}}}}});
+
+    // Already resolved transactions are answered immediately
+    ASSERT_EQ(*res,
+              (cbdc::watchtower::response{
+                  cbdc::watchtower::status_request_check_success{
+                      {{{'E'},
+                        {cbdc::watchtower::status_update_state{
+                            cbdc::watchtower::search_status::unspent,
+                            m_best_height,
+                            {'G'}}}}}}}));
+
+    cbdc::atomizer::block b1;
+    b1.m_height = m_best_height + 1;
+    b1.m_transactions.push_back(
+        cbdc::test::simple_tx({'N'}, {{'k'}}, {{'o'}}));
+    auto notifications = m_watchtower.add_block(std::move(b1));
+
+    ASSERT_EQ(notifications.size(), 1UL);
+    ASSERT_EQ(notifications[0].m_subscriber, subscriber);
+    ASSERT_EQ(notifications[0].m_states,
+              (cbdc::watchtower::tx_id_states{
+                  {{'N'},
+                   {cbdc::watchtower::status_update_state{
+                       cbdc::watchtower::search_status::unspent,
+                       m_best_height + 1,
+                       {'o'}}}}}));
+
+    // Subscriptions are answered once
+    cbdc::atomizer::block b2;
+    b2.m_height = m_best_height + 2;
+    b2.m_transactions.push_back(
+        cbdc::test::simple_tx({'N'}, {{'k'}}, {{'o'}}));
+    ASSERT_TRUE(m_watchtower.add_block(std::move(b2)).empty());
+}
+
+TEST_F(WatchtowerTest, subscribe_notified_by_error) {
+    constexpr uint64_t subscriber{3};
+    auto res = m_watchtower.handle_status_subscribe_request(
+        subscriber,
+        cbdc::watchtower::status_subscribe_request{
+            {{{'t', 'x', 'a'}, {{'a'}}}}});
+    ASSERT_EQ(*res,
+              (cbdc::watchtower::response{
+                  cbdc::watchtower::status_request_check_success{{}}}));
+
+    auto notifications = m_watchtower.add_errors(
+        {cbdc::watchtower::tx_error{{'t', 'x', 'a'},
+                                    cbdc::watchtower::tx_error_sync{}}});
+
+    ASSERT_EQ(notifications.size(), 1UL);
+    ASSERT_EQ(notifications[0].m_subscriber, subscriber);
+    ASSERT_EQ(notifications[0].m_states,
+              (cbdc::watchtower::tx_id_states{
+                  {{'t', 'x', 'a'},
+                   {cbdc::watchtower::status_update_state{
+                       cbdc::watchtower::search_status::internal_error,
+                       m_best_height,
+                       {'a'}}}}}));
+}
+
+TEST_F(WatchtowerTest, subscription_expires) {
+    constexpr uint64_t subscriber{5};
+    auto wt = cbdc::watchtower::watchtower(0, 0, 1);
+    cbdc::atomizer::block b0;
+    b0.m_height = m_best_height;
+    wt.add_block(std::move(b0));
+
+    auto res = wt.handle_status_subscribe_request(
+        subscriber,
+        cbdc::watchtower::status_subscribe_request{{{{'N'}, {{'o'}}}}});
+    ASSERT_EQ(*res,
+              (cbdc::watchtower::response{
+                  cbdc::watchtower::status_request_check_success{{}}}));
+
+    cbdc::atomizer::block b1;
+    b1.m_height = m_best_height + 1;
+    auto notifications = wt.add_block(std::move(b1));
+
+    ASSERT_EQ(notifications.size(), 1UL);
+    ASSERT_EQ(notifications[0].m_subscriber, subscriber);
+    ASSERT_EQ(notifications[0].m_states,
+              (cbdc::watchtower::tx_id_states{
+                  {{'N'},
+                   {cbdc::watchtower::status_update_state{
+                       cbdc::watchtower::search_status::no_history,
+                       m_best_height + 1,
+                       {'o'}}}}}));
+}
+
+TEST_F(WatchtowerTest, range_indexes_only_owned_ids) {
+    auto wt = cbdc::watchtower::watchtower(0, 0, 1, {'a', 'z'});
+    cbdc::atomizer::block b0;
+    b0.m_height = m_best_height;
+    b0.m_transactions.push_back(
+        cbdc::test::simple_tx({'A'}, {{'b'}, {'C'}}, {{'d'}}));
+    b0.m_transactions.push_back(
+        cbdc::test::simple_tx({'E'}, {{'d'}, {'f'}}, {{'G'}}));
+    wt.add_block(std::move(b0));
+
+    auto res = wt.handle_status_update_request(
+        cbdc::watchtower::status_update_request{
+            {{{'A'}, {{'C'}}}, {{'E'}, {{'d'}}}}});
+
+    ASSERT_EQ(*res,
+              (cbdc::watchtower::response{
+                  cbdc::watchtower::status_request_check_success{
+                      {{{'A'},
+                        {cbdc::watchtower::status_update_state{
+                            cbdc::watchtower::search_status::no_history,
+                            m_best_height,
+                            {'C'}}}},
+                       {{'E'},
+                        {cbdc::watchtower::status_update_state{
+                            cbdc::watchtower::search_status::spent,
+                            m_best_height,
+                            {'d'}}}}}}}));
+}
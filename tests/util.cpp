@@ -43,8 +43,8 @@ namespace cbdc::test {
                    const std::vector<hash_t>& outs) -> compact_transaction {
         compact_transaction tx{};
         tx.m_id = id;
-        tx.m_inputs = ins;
-        tx.m_uhs_outputs = outs;
+        tx.m_inputs.assign(ins.begin(), ins.end());
+        tx.m_uhs_outputs.assign(outs.begin(), outs.end());
         return tx;
     }
 
@@ -13,6 +13,7 @@
 #include "uhs/transaction/wallet.hpp"
 #include "util/common/config.hpp"
 #include "util/common/logging.hpp"
+#include "util/common/metrics.hpp"
 #include "util/network/connection_manager.hpp"
 #include "util/serialization/format.hpp"
 
@@ -157,10 +158,24 @@ auto main(int argc, char** argv) -> int {
                        cbdc::hashing::const_sip_hash<cbdc::hash_t>>
         pending_txs;
     auto confirmed_txs = std::queue<cbdc::transaction::full_tx>();
+    // Time the sentinel accepted each signed TX still awaiting inclusion
+    std::unordered_map<cbdc::hash_t,
+                       int64_t,
+                       cbdc::hashing::const_sip_hash<cbdc::hash_t>>
+        accept_times;
+    // Delays from sending a TX to each stage, in nanoseconds
+    auto accept_latency = cbdc::metrics::histogram();
+    auto include_latency = cbdc::metrics::histogram();
+    auto confirm_latency = cbdc::metrics::histogram();
 
     static std::atomic_bool running = true;
     uint64_t best_watchtower_height = 0;
 
+    // One line per confirmed TX, in nanoseconds: the time the watchtower
+    // reported its block, the delay from sending it to that report, to the
+    // sentinel accepting it (-1 if unsigned), and to the wallet confirming
+    // it, then its block height. The first two columns are those of
+    // twophase-gen's samples, read by scripts/plot.py.
     std::ofstream latency_log("tx_samples_" + std::to_string(cli_id) + ".txt");
 
     assert(latency_log.good());
@@ -184,6 +199,7 @@ auto main(int argc, char** argv) -> int {
                                  .count();
             for(const auto& tx_id : states) {
                 auto invalid = true;
+                uint64_t tx_height{0};
                 for(const auto& state : tx_id.second) {
                     switch(state.status()) {
                         case cbdc::watchtower::search_status::spent:
@@ -204,6 +220,7 @@ auto main(int argc, char** argv) -> int {
                     }
                     best_watchtower_height = std::max(best_watchtower_height,
                                                       state.block_height());
+                    tx_height = std::max(tx_height, state.block_height());
                 }
                 {
                     std::lock_guard<std::mutex> lg(txs_mut);
@@ -214,9 +231,27 @@ auto main(int argc, char** argv) -> int {
                             confirmed++;
                             const auto tx_it = txs.find(tx_id.first);
                             if(tx_it != txs.end()) {
-                                const auto tx_delay
-                                    = now - tx_it->second.first;
-                                latency_log << now << " " << tx_delay << "\n";
+                                const auto sent = tx_it->second.first;
+                                const auto tx_delay = now - sent;
+                                const auto confirm_delay
+                                    = std::chrono::high_resolution_clock::now()
+                                          .time_since_epoch()
+                                          .count()
+                                    - sent;
+                                auto accept_delay = int64_t{-1};
+                                const auto acc_it
+                                    = accept_times.find(tx_id.first);
+                                if(acc_it != accept_times.end()) {
+                                    accept_delay = static_cast<int64_t>(
+                                        acc_it->second - sent);
+                                    accept_times.erase(acc_it);
+                                }
+                                latency_log << now << " " << tx_delay << " "
+                                            << accept_delay << " "
+                                            << confirm_delay << " "
+                                            << tx_height << "\n";
+                                include_latency.record(tx_delay);
+                                confirm_latency.record(confirm_delay);
                                 txs.erase(tx_it);
                             }
                             if(cfg.m_invalid_rate > 0.0
@@ -373,6 +408,8 @@ auto main(int argc, char** argv) -> int {
     std::chrono::nanoseconds add_time;
     std::chrono::nanoseconds send_time;
     uint64_t gen_avg{};
+    static constexpr size_t subscribe_batch_size = 100;
+    auto subscriptions = cbdc::watchtower::tx_id_uhs_ids();
     while(running) {
         static constexpr auto send_amount = 5;
         const auto start_time = std::chrono::high_resolution_clock::now();
@@ -498,9 +535,41 @@ auto main(int argc, char** argv) -> int {
 
         const auto add_end_time = std::chrono::high_resolution_clock::now();
 
+        if(!send_invalid) {
+            // Have the watchtower push the TX's status once its block is
+            // ingested, rather than waiting for the next status poll
+            auto ctx = cbdc::transaction::compact_tx(pay_tx);
+            subscriptions.emplace(ctx.m_id, ctx.m_uhs_outputs);
+            if(subscriptions.size() >= subscribe_batch_size) {
+                watchtower_client->subscribe_status_update(
+                    cbdc::watchtower::status_subscribe_request{
+                        std::move(subscriptions)});
+                subscriptions = {};
+            }
+        }
+
         if(sign_txs) {
-            sentinel_client->execute_transaction(std::move(pay_tx),
-                                                 [](auto /* resp */) {});
+            sentinel_client->execute_transaction(
+                std::move(pay_tx),
+                [&, tx_id = cbdc::transaction::tx_id(pay_tx)](
+                    cbdc::sentinel::rpc::client::execute_result_type resp) {
+                    if(!resp.has_value()
+                       || (resp->m_tx_status
+                               != cbdc::sentinel::tx_status::pending
+                           && resp->m_tx_status
+                                  != cbdc::sentinel::tx_status::confirmed)) {
+                        return;
+                    }
+                    const auto now = std::chrono::high_resolution_clock::now()
+                                         .time_since_epoch()
+                                         .count();
+                    std::lock_guard<std::mutex> lg(txs_mut);
+                    const auto tx_it = txs.find(tx_id);
+                    if(tx_it != txs.end()) {
+                        accept_times[tx_id] = now;
+                        accept_latency.record(now - tx_it->second.first);
+                    }
+                });
         } else {
             auto send_pkt
                 = send_tx_to_atomizer(cbdc::transaction::compact_tx(pay_tx),
@@ -587,6 +656,28 @@ auto main(int argc, char** argv) -> int {
                       send_delay,
                       "s");
 
+            static constexpr auto ns_per_ms = 1e6;
+            auto stage = [&](const std::string& name,
+                             const cbdc::metrics::histogram& hist) {
+                const auto snap = hist.snapshot();
+                log->info(name,
+                          "ms p50:",
+                          static_cast<double>(snap.quantile(0.5)) / ns_per_ms,
+                          "p99:",
+                          static_cast<double>(snap.quantile(0.99))
+                              / ns_per_ms,
+                          "p999:",
+                          static_cast<double>(snap.quantile(0.999))
+                              / ns_per_ms,
+                          "count:",
+                          snap.m_count);
+            };
+            if(sign_txs) {
+                stage("Sentinel accept", accept_latency);
+            }
+            stage("Block inclusion", include_latency);
+            stage("Confirmation", confirm_latency);
+
             count = 0;
             total_time = std::chrono::nanoseconds(0);
             check_time = std::chrono::nanoseconds(0);
@@ -22,7 +22,10 @@ auto main(int argc, char** argv) -> int {
         endpoints.push_back(url);
     }
 
-    auto c = std::make_shared<geth_client>(endpoints, 0, log);
+    auto client_opts = geth_client::options{};
+    client_opts.m_max_host_connections
+        = static_cast<long>(cfg->m_loadgen_http_connections);
+    auto c = std::make_shared<geth_client>(endpoints, 0, log, client_opts);
 
     // Determine mint depth from loadgen_accounts
     size_t mint_tree_depth = 1;
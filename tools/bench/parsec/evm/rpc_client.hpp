@@ -13,7 +13,8 @@ class geth_client : public cbdc::rpc::json_rpc_http_client {
   public:
     geth_client(std::vector<std::string> endpoints,
                 long timeout,
-                std::shared_ptr<cbdc::logging::log> log);
+                std::shared_ptr<cbdc::logging::log> log,
+                options opts = {});
 
     static constexpr auto error_key = "error";
     static constexpr auto result_key = "result";
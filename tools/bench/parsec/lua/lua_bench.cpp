@@ -66,8 +66,10 @@ auto main(int argc, char** argv) -> int {
     }
     log->trace("Connected to ticket machine");
 
-    auto directory
-        = std::make_shared<cbdc::parsec::directory::impl>(shards.size());
+    auto directory = std::make_shared<cbdc::parsec::directory::impl>(
+        cbdc::parsec::directory::make_placement(cfg->m_placement,
+                                                shards.size(),
+                                                cfg->m_placement_prefix_len));
     auto broker = std::make_shared<cbdc::parsec::broker::impl>(
         std::numeric_limits<size_t>::max(),
         shards,
@@ -91,25 +93,32 @@ auto main(int argc, char** argv) -> int {
     auto pay_keys = std::vector<cbdc::buffer>();
     auto init_count = std::atomic<size_t>();
     auto init_error = std::atomic_bool{false};
+    // Load the contracts directly into the shards in batches rather than
+    // with one ticket per wallet
+    constexpr size_t load_batch_size = 10000;
+    auto rows = cbdc::parsec::broker::state_update_type();
     for(size_t i = 0; i < n_wallets; i++) {
         auto pay_contract_key = cbdc::buffer();
         pay_contract_key.append("pay", 3);
         pay_contract_key.append(&i, sizeof(i));
         pay_keys.push_back(pay_contract_key);
+        rows.emplace(std::move(pay_contract_key), pay_contract);
+        if(rows.size() < load_batch_size && i + 1 < n_wallets) {
+            continue;
+        }
 
-        log->info("Inserting pay contract", i);
-        auto ret = cbdc::parsec::put_row(
-            broker,
-            pay_contract_key,
-            pay_contract,
-            [&](bool res) {
-                if(!res) {
-                    init_error = true;
-                } else {
-                    log->info("Inserted pay contract", i);
-                    init_count++;
-                }
-            });
+        log->info("Inserting pay contracts up to", i);
+        auto n_rows = rows.size();
+        auto ret = cbdc::parsec::put_rows(broker,
+                                          std::move(rows),
+                                          [&, n_rows](bool res) {
+                                              if(!res) {
+                                                  init_error = true;
+                                              } else {
+                                                  init_count += n_rows;
+                                              }
+                                          });
+        rows = cbdc::parsec::broker::state_update_type();
         if(!ret) {
             init_error = true;
             break;
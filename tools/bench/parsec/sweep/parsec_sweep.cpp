@@ -0,0 +1,484 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Sweeps the PArSEC ticket pipeline over shard count, agent count, key
+// contention and read/write mix, with the ticket machine, shards, directory
+// and broker running in one process. Each agent thread runs transfers
+// between random accounts through the broker. A fraction of the transfers
+// pay from a single hot account, and a fraction of the transactions only
+// read two balances with lock-free committed reads. Wounded tickets are
+// rolled back and retried with the same ticket number, as agents do.
+//
+// Usage: parsec_sweep <shards> <agents> <hot_pct> <read_pct> [seconds]
+// where each of the first four arguments is a comma-separated list of
+// values. One line is printed per combination with commits/s, wounds per
+// commit and p50/p99 latency in microseconds for the ticket, lock, execute
+// and commit stages, and for reads.
+
+#include "parsec/broker/impl.hpp"
+#include "parsec/directory/impl.hpp"
+#include "parsec/runtime_locking_shard/impl.hpp"
+#include "parsec/ticket_machine/impl.hpp"
+#include "parsec/util.hpp"
+#include "util/serialization/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+    constexpr size_t g_n_accounts = 1000;
+    constexpr uint64_t g_init_balance = 1000000;
+    constexpr cbdc::parsec::ticket_machine::ticket_number_type g_range
+        = 1000;
+    constexpr size_t g_default_seconds = 10;
+
+    using clock_type = std::chrono::steady_clock;
+    using broker_interface = cbdc::parsec::broker::interface;
+
+    /// Latency samples of one stage, in microseconds.
+    using samples_type = std::vector<double>;
+
+    /// Stages of a transfer, in the order they run.
+    enum stage : size_t {
+        ticket,
+        lock,
+        execute,
+        commit,
+        read,
+        n_stages
+    };
+
+    constexpr std::array<const char*, n_stages> g_stage_names
+        = {"ticket", "lock", "execute", "commit", "read"};
+
+    /// Results of one agent thread.
+    struct agent_results {
+        std::array<samples_type, n_stages> m_samples;
+        size_t m_commits{};
+        size_t m_reads{};
+        size_t m_wounds{};
+        size_t m_errors{};
+    };
+
+    auto micros_since(clock_type::time_point start) -> double {
+        return std::chrono::duration<double, std::micro>(clock_type::now()
+                                                         - start)
+            .count();
+    }
+
+    auto percentile(const samples_type& sorted, double p) -> double {
+        if(sorted.empty()) {
+            return 0.0;
+        }
+        auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size()
+                                                               - 1));
+        return sorted[idx];
+    }
+
+    /// Makes a broker call with a single-argument callback and blocks until
+    /// the callback runs.
+    /// \return the callback's argument, or std::nullopt if the call could
+    ///         not be initiated.
+    template<typename T, typename F>
+    auto await(F&& call) -> std::optional<T> {
+        auto done = std::promise<T>();
+        auto fut = done.get_future();
+        if(!call([&done](T res) {
+               done.set_value(std::move(res));
+           })) {
+            return std::nullopt;
+        }
+        return fut.get();
+    }
+
+    auto account_key(size_t idx) -> cbdc::buffer {
+        auto key = cbdc::buffer();
+        key.append("acct", 4);
+        key.append(&idx, sizeof(idx));
+        return key;
+    }
+
+    auto is_wounded(const cbdc::parsec::runtime_locking_shard::shard_error&
+                        err) -> bool {
+        return err.m_error_code
+            == cbdc::parsec::runtime_locking_shard::error_code::wounded;
+    }
+
+    /// Ticket machine, shards, directory and broker in one process.
+    class pipeline {
+      public:
+        explicit pipeline(size_t n_shards)
+            : m_ticketer(
+                std::make_shared<cbdc::parsec::ticket_machine::impl>(m_log,
+                                                                     g_range)),
+              m_directory(
+                  std::make_shared<cbdc::parsec::directory::impl>(n_shards)) {
+            for(size_t i{0}; i < n_shards; i++) {
+                m_shards.push_back(
+                    std::make_shared<cbdc::parsec::runtime_locking_shard::impl>(
+                        m_log));
+            }
+            m_broker = std::make_shared<cbdc::parsec::broker::impl>(
+                0,
+                m_shards,
+                m_ticketer,
+                m_directory,
+                m_log);
+        }
+
+        /// Creates the accounts with their initial balances.
+        auto init() -> bool {
+            for(size_t i{0}; i < g_n_accounts; i++) {
+                auto res = await<bool>([&](auto cb) {
+                    return cbdc::parsec::put_row(
+                        m_broker,
+                        account_key(i),
+                        cbdc::make_buffer(g_init_balance),
+                        cb);
+                });
+                if(!res.value_or(false)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// Runs transactions from one agent thread until the deadline.
+        /// \param hot fraction of transfers paying from the hot account.
+        /// \param reads fraction of transactions which only read.
+        /// \param deadline time to stop starting transactions.
+        /// \param seed random seed for choosing accounts.
+        auto run_agent(double hot,
+                       double reads,
+                       clock_type::time_point deadline,
+                       uint64_t seed) -> agent_results {
+            auto res = agent_results();
+            auto rng = std::mt19937_64(seed);
+            auto coin = std::uniform_real_distribution<double>(0.0, 1.0);
+            auto accounts
+                = std::uniform_int_distribution<size_t>(0, g_n_accounts - 1);
+            while(clock_type::now() < deadline) {
+                auto from = coin(rng) < hot ? size_t{0} : accounts(rng);
+                auto to = accounts(rng);
+                while(to == from) {
+                    to = accounts(rng);
+                }
+                auto keys = std::vector<cbdc::buffer>{account_key(from),
+                                                      account_key(to)};
+                if(coin(rng) < reads) {
+                    do_read(keys, res);
+                } else {
+                    do_transfer(keys, res);
+                }
+            }
+            return res;
+        }
+
+      private:
+        std::shared_ptr<cbdc::logging::log> m_log{
+            std::make_shared<cbdc::logging::log>(
+                cbdc::logging::log_level::error)};
+        std::shared_ptr<cbdc::parsec::ticket_machine::impl> m_ticketer;
+        std::shared_ptr<cbdc::parsec::directory::impl> m_directory;
+        std::vector<
+            std::shared_ptr<cbdc::parsec::runtime_locking_shard::interface>>
+            m_shards;
+        std::shared_ptr<cbdc::parsec::broker::impl> m_broker;
+
+        void do_read(const std::vector<cbdc::buffer>& keys,
+                     agent_results& res) {
+            auto start = clock_type::now();
+            auto read_res
+                = await<broker_interface::read_return_type>(
+                    [&](auto cb) {
+                        return m_broker->read(keys, cb);
+                    });
+            if(!read_res.has_value()
+               || !std::holds_alternative<std::vector<
+                   cbdc::parsec::runtime_locking_shard::committed_value>>(
+                   read_res.value())) {
+                res.m_errors++;
+                return;
+            }
+            res.m_samples[stage::read].push_back(micros_since(start));
+            res.m_reads++;
+        }
+
+        /// Moves one unit from the first key's balance to the second's.
+        void do_transfer(const std::vector<cbdc::buffer>& keys,
+                         agent_results& res) {
+            auto start = clock_type::now();
+            auto begin_res = await<
+                broker_interface::ticketnum_or_errcode_type>(
+                [&](auto cb) {
+                    return m_broker->begin(cb);
+                });
+            if(!begin_res.has_value()
+               || !std::holds_alternative<
+                   cbdc::parsec::ticket_machine::ticket_number_type>(
+                   begin_res.value())) {
+                res.m_errors++;
+                return;
+            }
+            auto ticket_number
+                = std::get<cbdc::parsec::ticket_machine::ticket_number_type>(
+                    begin_res.value());
+            res.m_samples[stage::ticket].push_back(micros_since(start));
+
+            auto locks = std::vector<cbdc::parsec::broker::lock_request_type>();
+            for(const auto& key : keys) {
+                locks.emplace_back(key,
+                                   cbdc::parsec::broker::lock_type::write);
+            }
+
+            for(;;) {
+                start = clock_type::now();
+                auto lock_res = await<
+                    broker_interface::try_lock_batch_return_type>(
+                    [&](auto cb) {
+                        return m_broker->try_lock_batch(ticket_number,
+                                                        locks,
+                                                        cb);
+                    });
+                if(!lock_res.has_value()) {
+                    res.m_errors++;
+                    abort(ticket_number);
+                    return;
+                }
+                if(auto* err = std::get_if<
+                       cbdc::parsec::runtime_locking_shard::shard_error>(
+                       &lock_res.value());
+                   err != nullptr && is_wounded(*err)) {
+                    res.m_wounds++;
+                    if(!rollback(ticket_number)) {
+                        res.m_errors++;
+                        return;
+                    }
+                    continue;
+                }
+                auto* vals = std::get_if<std::vector<cbdc::buffer>>(
+                    &lock_res.value());
+                if(vals == nullptr) {
+                    res.m_errors++;
+                    abort(ticket_number);
+                    return;
+                }
+                res.m_samples[stage::lock].push_back(micros_since(start));
+
+                start = clock_type::now();
+                auto from_bal = cbdc::from_buffer<uint64_t>((*vals)[0]);
+                auto to_bal = cbdc::from_buffer<uint64_t>((*vals)[1]);
+                if(!from_bal.has_value() || !to_bal.has_value()
+                   || from_bal.value() == 0) {
+                    res.m_errors++;
+                    abort(ticket_number);
+                    return;
+                }
+                auto updates = cbdc::parsec::broker::state_update_type();
+                updates[keys[0]] = cbdc::make_buffer(from_bal.value() - 1);
+                updates[keys[1]] = cbdc::make_buffer(to_bal.value() + 1);
+                res.m_samples[stage::execute].push_back(micros_since(start));
+
+                start = clock_type::now();
+                auto commit_res = await<
+                    broker_interface::commit_return_type>(
+                    [&](auto cb) {
+                        return m_broker->commit(ticket_number, updates, cb);
+                    });
+                if(!commit_res.has_value()) {
+                    res.m_errors++;
+                    abort(ticket_number);
+                    return;
+                }
+                if(commit_res.value().has_value()) {
+                    if(auto* err = std::get_if<
+                           cbdc::parsec::runtime_locking_shard::shard_error>(
+                           &commit_res.value().value());
+                       err != nullptr && is_wounded(*err)) {
+                        res.m_wounds++;
+                        if(!rollback(ticket_number)) {
+                            res.m_errors++;
+                            return;
+                        }
+                        continue;
+                    }
+                    res.m_errors++;
+                    abort(ticket_number);
+                    return;
+                }
+                if(!finish(ticket_number)) {
+                    res.m_errors++;
+                    return;
+                }
+                res.m_samples[stage::commit].push_back(micros_since(start));
+                res.m_commits++;
+                return;
+            }
+        }
+
+        auto rollback(cbdc::parsec::ticket_machine::ticket_number_type
+                          ticket_number) -> bool {
+            auto res
+                = await<broker_interface::rollback_return_type>(
+                    [&](auto cb) {
+                        return m_broker->rollback(ticket_number, cb);
+                    });
+            return res.has_value() && !res.value().has_value();
+        }
+
+        auto finish(cbdc::parsec::ticket_machine::ticket_number_type
+                        ticket_number) -> bool {
+            auto res
+                = await<broker_interface::finish_return_type>(
+                    [&](auto cb) {
+                        return m_broker->finish(ticket_number, cb);
+                    });
+            return res.has_value() && !res.value().has_value();
+        }
+
+        /// Rolls back and finishes a ticket which failed permanently.
+        void abort(
+            cbdc::parsec::ticket_machine::ticket_number_type ticket_number) {
+            if(rollback(ticket_number)) {
+                finish(ticket_number);
+            }
+        }
+    };
+
+    /// Parses a comma-separated list of numbers.
+    template<typename T>
+    auto parse_list(const std::string& arg) -> std::optional<std::vector<T>> {
+        auto ret = std::vector<T>();
+        auto ss = std::stringstream(arg);
+        auto item = std::string();
+        while(std::getline(ss, item, ',')) {
+            auto val_ss = std::stringstream(item);
+            T val{};
+            if(!(val_ss >> val)) {
+                return std::nullopt;
+            }
+            ret.push_back(val);
+        }
+        if(ret.empty()) {
+            return std::nullopt;
+        }
+        return ret;
+    }
+
+    /// Runs one combination of the sweep and prints its results.
+    auto run_point(size_t n_shards,
+                   size_t n_agents,
+                   double hot_pct,
+                   double read_pct,
+                   std::chrono::seconds duration) -> bool {
+        constexpr double pct = 100.0;
+        auto pl = pipeline(n_shards);
+        if(!pl.init()) {
+            std::cerr << "Failed to create accounts" << std::endl;
+            return false;
+        }
+
+        auto start = clock_type::now();
+        auto deadline = start + duration;
+        auto futs = std::vector<std::future<agent_results>>();
+        for(size_t i{0}; i < n_agents; i++) {
+            futs.push_back(std::async(std::launch::async, [&, i]() {
+                return pl.run_agent(hot_pct / pct, read_pct / pct, deadline, i);
+            }));
+        }
+
+        auto total = agent_results();
+        for(auto& fut : futs) {
+            auto res = fut.get();
+            for(size_t s{0}; s < n_stages; s++) {
+                total.m_samples[s].insert(total.m_samples[s].end(),
+                                          res.m_samples[s].begin(),
+                                          res.m_samples[s].end());
+            }
+            total.m_commits += res.m_commits;
+            total.m_reads += res.m_reads;
+            total.m_wounds += res.m_wounds;
+            total.m_errors += res.m_errors;
+        }
+        auto elapsed
+            = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        auto out = std::stringstream();
+        out << std::fixed << std::setprecision(1) << "shards=" << n_shards
+            << " agents=" << n_agents << " hot_pct=" << hot_pct
+            << " read_pct=" << read_pct
+            << " commits/s=" << static_cast<double>(total.m_commits) / elapsed
+            << " reads/s=" << static_cast<double>(total.m_reads) / elapsed
+            << std::setprecision(3) << " wounds/commit="
+            << (total.m_commits == 0
+                    ? 0.0
+                    : static_cast<double>(total.m_wounds)
+                          / static_cast<double>(total.m_commits))
+            << " errors=" << total.m_errors << std::setprecision(1);
+        for(size_t s{0}; s < n_stages; s++) {
+            auto& samples = total.m_samples[s];
+            std::sort(samples.begin(), samples.end());
+            out << " " << g_stage_names[s]
+                << "_p50_us=" << percentile(samples, 0.5) << " "
+                << g_stage_names[s]
+                << "_p99_us=" << percentile(samples, 0.99);
+        }
+        std::cout << out.str() << std::endl;
+        return true;
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    constexpr int min_args = 5;
+    if(argc < min_args) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <shards> <agents> <hot_pct> <read_pct> [seconds]"
+                  << std::endl;
+        return 1;
+    }
+    auto args = std::vector<std::string>(argv, argv + argc);
+    auto shard_counts = parse_list<size_t>(args[1]);
+    auto agent_counts = parse_list<size_t>(args[2]);
+    auto hot_pcts = parse_list<double>(args[3]);
+    auto read_pcts = parse_list<double>(args[4]);
+    if(!shard_counts.has_value() || !agent_counts.has_value()
+       || !hot_pcts.has_value() || !read_pcts.has_value()) {
+        std::cerr << "Arguments must be comma-separated numbers" << std::endl;
+        return 1;
+    }
+    auto seconds = g_default_seconds;
+    if(argc > min_args) {
+        seconds = std::stoull(args[min_args]);
+    }
+
+    for(auto n_shards : shard_counts.value()) {
+        for(auto n_agents : agent_counts.value()) {
+            for(auto hot_pct : hot_pcts.value()) {
+                for(auto read_pct : read_pcts.value()) {
+                    if(n_shards == 0 || n_agents == 0) {
+                        std::cerr << "Shard and agent counts must be positive"
+                                  << std::endl;
+                        return 1;
+                    }
+                    if(!run_point(n_shards,
+                                  n_agents,
+                                  hot_pct,
+                                  read_pct,
+                                  std::chrono::seconds(seconds))) {
+                        return 2;
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
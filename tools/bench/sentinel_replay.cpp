@@ -0,0 +1,168 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/sentinel/client.hpp"
+#include "uhs/sentinel/trace.hpp"
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+#include "util/common/metrics.hpp"
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+auto main(int argc, char** argv) -> int {
+    auto args = cbdc::config::get_args(argc, argv);
+    if(args.size() < 3) {
+        std::cerr << "Usage: " << args[0]
+                  << " <config file> <trace file> [rate scale]" << std::endl;
+        std::cerr << "Replays a sentinel capture against the sentinels in "
+                     "the config. A rate scale of 2 sends twice as fast as "
+                     "recorded, and 0 sends as fast as possible."
+                  << std::endl;
+        return -1;
+    }
+
+    auto cfg_or_err = cbdc::config::load_options(args[1]);
+    if(std::holds_alternative<std::string>(cfg_or_err)) {
+        std::cerr << "Error loading config file: "
+                  << std::get<std::string>(cfg_or_err) << std::endl;
+        return -1;
+    }
+    auto cfg = std::get<cbdc::config::options>(cfg_or_err);
+
+    auto scale = 1.0;
+    if(args.size() > 3) {
+        scale = std::stod(args[3]);
+        if(scale < 0.0) {
+            std::cerr << "Rate scale must not be negative" << std::endl;
+            return -1;
+        }
+    }
+
+    auto logger
+        = std::make_shared<cbdc::logging::log>(cbdc::logging::log_level::info);
+
+    auto trace = cbdc::sentinel::trace_reader(args[2]);
+    if(!trace.good()) {
+        logger->error("Failed to open trace", args[2]);
+        return -1;
+    }
+
+    auto sentinel_client
+        = cbdc::sentinel::rpc::client(cfg.m_sentinel_endpoints, logger);
+    if(!sentinel_client.init()) {
+        logger->warn("Failed to connect to sentinel");
+    }
+
+    static std::atomic_bool running{true};
+    std::signal(SIGINT, [](int /* sig */) {
+        running = false;
+    });
+
+    // Like the open-loop generator, latency is measured from when each
+    // transaction was scheduled to be sent, so a slow cluster does not
+    // hide the time transactions spend queued behind it.
+    auto send_lag = cbdc::metrics::histogram();
+    auto confirm_latency = cbdc::metrics::histogram();
+    auto n_sent = std::atomic<uint64_t>();
+    auto n_confirmed = std::atomic<uint64_t>();
+    auto n_invalid = std::atomic<uint64_t>();
+    auto n_failed = std::atomic<uint64_t>();
+    auto n_done = std::atomic<uint64_t>();
+
+    const auto start = std::chrono::steady_clock::now();
+    while(running) {
+        auto rec = trace.next();
+        if(!rec.has_value()) {
+            break;
+        }
+
+        auto scheduled = start;
+        if(scale > 0.0) {
+            scheduled += std::chrono::nanoseconds(static_cast<int64_t>(
+                static_cast<double>(rec->m_offset_ns) / scale));
+            std::this_thread::sleep_until(scheduled);
+        } else {
+            scheduled = std::chrono::steady_clock::now();
+        }
+
+        send_lag.record(std::chrono::steady_clock::now() - scheduled);
+        n_sent++;
+        auto res_cb =
+            [&, scheduled](
+                cbdc::sentinel::rpc::client::execute_result_type res) {
+                if(!res.has_value()) {
+                    n_failed++;
+                } else if(res->m_tx_status
+                          == cbdc::sentinel::tx_status::confirmed) {
+                    confirm_latency.record(std::chrono::steady_clock::now()
+                                           - scheduled);
+                    n_confirmed++;
+                } else {
+                    n_invalid++;
+                }
+                n_done++;
+            };
+        if(!sentinel_client.execute_transaction(std::move(rec->m_tx),
+                                                std::move(res_cb))) {
+            n_failed++;
+            n_done++;
+        }
+    }
+    if(!trace.good()) {
+        logger->warn("Trace ended with a truncated record");
+    }
+
+    // Waits for the outstanding transactions, giving up if no more
+    // results arrive for a while
+    static constexpr auto drain_timeout = std::chrono::seconds(30);
+    auto last_done = n_done.load();
+    auto last_progress = std::chrono::steady_clock::now();
+    while(running && n_done < n_sent) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(n_done != last_done) {
+            last_done = n_done;
+            last_progress = std::chrono::steady_clock::now();
+        } else if(std::chrono::steady_clock::now() - last_progress
+                  > drain_timeout) {
+            logger->warn("Gave up waiting for",
+                         n_sent - n_done,
+                         "transactions");
+            break;
+        }
+    }
+
+    const auto secs = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    const auto hist = confirm_latency.snapshot();
+    static constexpr auto ns_per_ms = 1e6;
+    auto ms = [&](double q) {
+        return static_cast<double>(hist.quantile(q)) / ns_per_ms;
+    };
+    logger->info("Replayed",
+                 n_sent.load(),
+                 "TXs in",
+                 secs,
+                 "s confirmed TX/s:",
+                 static_cast<double>(n_confirmed) / secs,
+                 "latency ms p50:",
+                 ms(0.5),
+                 "p99:",
+                 ms(0.99),
+                 "p999:",
+                 ms(0.999),
+                 "invalid:",
+                 n_invalid.load(),
+                 "failed:",
+                 n_failed.load(),
+                 "max send lag ms:",
+                 static_cast<double>(send_lag.snapshot().quantile(1.0))
+                     / ns_per_ms);
+
+    return 0;
+}
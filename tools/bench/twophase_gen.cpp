@@ -9,9 +9,13 @@
 #include "uhs/transaction/wallet.hpp"
 #include "uhs/twophase/coordinator/client.hpp"
 #include "uhs/twophase/locking_shard/status_client.hpp"
+#include "util/common/blocking_queue.hpp"
 #include "util/common/config.hpp"
 #include "util/common/logging.hpp"
+#include "util/common/metrics.hpp"
 #include "util/network/connection_manager.hpp"
+#include "util/persistence/factory.hpp"
+#include "util/persistence/write_behind_queue.hpp"
 #include "util/serialization/format.hpp"
 
 #include <csignal>
@@ -44,20 +48,62 @@ auto main(int argc, char** argv) -> int {
     auto invalid_dist = std::bernoulli_distribution(cfg.m_invalid_rate);
     auto fixed_dist = std::bernoulli_distribution(cfg.m_fixed_tx_rate);
 
-    auto wallet = cbdc::transaction::wallet();
+    // Open-loop generators spread the target rate over several threads,
+    // each with its own wallet
+    const auto open_loop = cfg.m_loadgen_target_rate > 0;
+    const auto n_wallets = open_loop ? cfg.m_loadgen_threads : size_t{1};
+    auto wallets
+        = std::vector<std::unique_ptr<cbdc::transaction::wallet>>(n_wallets);
+    for(auto& w : wallets) {
+        w = std::make_unique<cbdc::transaction::wallet>();
+    }
+    auto& wallet = *wallets.front();
+
+    // Optionally record generated transactions without slowing the
+    // generator down to the database's pace.
+    auto wallet_audit
+        = std::unique_ptr<cbdc::persistence::write_behind_queue>();
+    if(cfg.m_wallet_audit) {
+        wallet_audit = std::make_unique<cbdc::persistence::write_behind_queue>(
+            logger,
+            cbdc::persistence::make_sink(cfg,
+                                         logger,
+                                         "admin.wallet",
+                                         {"tx_hash", "payee"}),
+            cfg.m_oracle_queue_high_water_mark,
+            cfg.m_oracle_batch_size,
+            cbdc::persistence::make_retry_policy(cfg));
+        if(wallet_audit->start()) {
+            for(auto& w : wallets) {
+                w->set_send_observer([&](const cbdc::hash_t& tx_id,
+                                         const cbdc::pubkey_t& payee) {
+                    wallet_audit->push_row({tx_id, payee});
+                });
+            }
+        } else {
+            logger->warn("Wallet transactions will not be recorded");
+        }
+    }
 
     // Optionally Pre-seed wallet with deterministic UTXOs
     if(cfg.m_seed_from != cfg.m_seed_to) {
         auto [range_start, range_end]
             = cbdc::config::loadgen_seed_range(cfg, gen_id);
 
-        bool ret = wallet.seed(cfg.m_seed_privkey.value(),
-                               cfg.m_seed_value,
-                               range_start,
-                               range_end);
-        if(!ret) {
-            logger->error("Initial seed failed");
-            return -1;
+        // Split the range between the wallets
+        const auto per_wallet = (range_end - range_start) / n_wallets;
+        for(size_t i = 0; i < n_wallets; i++) {
+            const auto from = range_start + i * per_wallet;
+            const auto to
+                = i == n_wallets - 1 ? range_end : from + per_wallet;
+            bool ret = wallets[i]->seed(cfg.m_seed_privkey.value(),
+                                        cfg.m_seed_value,
+                                        from,
+                                        to);
+            if(!ret) {
+                logger->error("Initial seed failed");
+                return -1;
+            }
         }
         logger->info("Using pre-seeded wallet with UTXOs",
                      range_start,
@@ -73,45 +119,52 @@ auto main(int argc, char** argv) -> int {
             logger->warn("Failed to connect to coordinator");
         }
 
-        auto mint_tx = wallet.mint_new_coins(cfg.m_initial_mint_count,
-                                             cfg.m_initial_mint_value);
-
-        auto compact_mint_tx = cbdc::transaction::compact_tx(mint_tx);
         auto secp = std::unique_ptr<secp256k1_context,
                                     decltype(&secp256k1_context_destroy)>{
             secp256k1_context_create(SECP256K1_CONTEXT_SIGN),
             &secp256k1_context_destroy};
-        for(size_t i = 0; i < cfg.m_attestation_threshold; i++) {
-            auto att = compact_mint_tx.sign(secp.get(),
-                                            cfg.m_sentinel_private_keys[i]);
-            compact_mint_tx.m_attestations.insert(att);
-        }
 
-        auto mint_successful = std::promise<bool>();
-        auto mint_successful_fut = mint_successful.get_future();
-        auto send_successful = coordinator_client.execute_transaction(
-            compact_mint_tx,
-            [&](std::optional<bool> resp) {
-                if(!resp.has_value()) {
-                    mint_successful.set_value(false);
-                    return;
-                }
-                mint_successful.set_value(resp.value());
-            });
+        // Each wallet mints its share of the initial outputs
+        const auto mint_count
+            = std::max<size_t>(cfg.m_initial_mint_count / n_wallets, 1);
+        for(auto& w : wallets) {
+            auto mint_tx
+                = w->mint_new_coins(mint_count, cfg.m_initial_mint_value);
+
+            auto compact_mint_tx = cbdc::transaction::compact_tx(mint_tx);
+            for(size_t i = 0; i < cfg.m_attestation_threshold; i++) {
+                auto att = compact_mint_tx.sign(
+                    secp.get(),
+                    cfg.m_sentinel_private_keys[i]);
+                compact_mint_tx.m_attestations.insert(att);
+            }
 
-        if(!send_successful) {
-            logger->error("Failed to send mint TX to coordinator");
-            return -1;
-        }
+            auto mint_successful = std::promise<bool>();
+            auto mint_successful_fut = mint_successful.get_future();
+            auto send_successful = coordinator_client.execute_transaction(
+                compact_mint_tx,
+                [&](std::optional<bool> resp) {
+                    if(!resp.has_value()) {
+                        mint_successful.set_value(false);
+                        return;
+                    }
+                    mint_successful.set_value(resp.value());
+                });
 
-        logger->info("Waiting for mint confirmation");
-        auto mint_result = mint_successful_fut.get();
-        if(!mint_result) {
-            logger->error("Mint TX failed");
-            return -1;
-        }
+            if(!send_successful) {
+                logger->error("Failed to send mint TX to coordinator");
+                return -1;
+            }
 
-        wallet.confirm_transaction(mint_tx);
+            logger->info("Waiting for mint confirmation");
+            auto mint_result = mint_successful_fut.get();
+            if(!mint_result) {
+                logger->error("Mint TX failed");
+                return -1;
+            }
+
+            w->confirm_transaction(mint_tx);
+        }
         logger->info("Mint confirmed");
     }
 
@@ -161,8 +214,50 @@ auto main(int argc, char** argv) -> int {
 
     constexpr auto send_amt = 5;
 
+    // Generates a new (valid) transaction from the given wallet
+    auto generate_tx = [&](cbdc::transaction::wallet& w, bool send_fixed) {
+        // If we're sending fixed-size transactions, attempt to generate a
+        // fixed-size transaction.
+        if(send_fixed) {
+            return w.send_to(cfg.m_input_count,
+                             cfg.m_output_count,
+                             w.generate_key(),
+                             true);
+        }
+        // If using fixed TX mode, the fallback in/out count should be 2/2
+        if(cfg.m_fixed_tx_mode && cfg.m_fixed_tx_rate > 0.0) {
+            return w.send_to(2, 2, w.generate_key(), true);
+        }
+        // Otherwise send a regular transaction and let the wallet determine
+        // the input/output count.
+        return w.send_to(send_amt, w.generate_key(), true);
+    };
+
+    // Pops a previously confirmed transaction to re-send, which will now
+    // be a double-spend
+    auto pop_confirmed_tx = [&]() {
+        auto tx = std::optional<cbdc::transaction::full_tx>();
+        std::lock_guard<std::mutex> l(confirmed_txs_mut);
+        if(!confirmed_txs.empty()) {
+            tx = std::move(confirmed_txs.front());
+            confirmed_txs.pop();
+        }
+        return tx;
+    };
+
+    // Keeps a confirmed transaction to re-send as a double-spend later
+    auto push_confirmed_tx = [&](const cbdc::transaction::full_tx& tx) {
+        constexpr auto max_invalid = 100000;
+        if(cfg.m_invalid_rate > 0.0) {
+            std::lock_guard<std::mutex> l(confirmed_txs_mut);
+            if(confirmed_txs.size() < max_invalid) {
+                confirmed_txs.push(tx);
+            }
+        }
+    };
+
     uint64_t gen_avg{};
-    auto gen_thread = std::thread([&]() {
+    auto closed_loop_sender = [&]() {
         while(running) {
             // Determine if we should attempt to send a double-spending
             // transaction
@@ -180,39 +275,14 @@ auto main(int argc, char** argv) -> int {
             auto tx = std::optional<cbdc::transaction::full_tx>();
             // Try to send a double-spending transaction
             if(send_invalid) {
-                std::lock_guard<std::mutex> l(confirmed_txs_mut);
-                // Attempt to pop a previously confirmed transaction to re-send
-                // (will now be a double-spend)
-                if(!confirmed_txs.empty()) {
-                    tx = std::move(confirmed_txs.front());
-                    confirmed_txs.pop();
-                }
+                tx = pop_confirmed_tx();
             }
 
             // tx is empty so there wasn't a double-spend available for us to
             // send. Try to send a new (valid) transaction instead.
             if(!tx) {
-                // If we're sending fixed-size transactions, attempt to
-                // generate a fixed-size transaction.
                 auto gen_s = std::chrono::high_resolution_clock::now();
-                if(send_fixed) {
-                    tx = wallet.send_to(cfg.m_input_count,
-                                        cfg.m_output_count,
-                                        wallet.generate_key(),
-                                        true);
-                } else {
-                    // If using fixed TX mode, the fallback in/out count
-                    // should be 2/2
-                    if(cfg.m_fixed_tx_mode && cfg.m_fixed_tx_rate > 0.0) {
-                        tx = wallet.send_to(2, 2, wallet.generate_key(), true);
-                    } else {
-                        // Otherwise send a regular transaction and let the
-                        // wallet determine the input/output count.
-                        tx = wallet.send_to(send_amt,
-                                            wallet.generate_key(),
-                                            true);
-                    }
-                }
+                tx = generate_tx(wallet, send_fixed);
                 auto gen_e = std::chrono::high_resolution_clock::now();
                 auto gen_t = gen_e - gen_s;
                 static constexpr auto average_factor = 0.1;
@@ -261,13 +331,7 @@ auto main(int argc, char** argv) -> int {
                                          .count();
                           const auto tx_delay = now - send_time;
                           latency_log << now << " " << tx_delay << "\n";
-                          constexpr auto max_invalid = 100000;
-                          if(cfg.m_invalid_rate > 0.0) {
-                              std::lock_guard<std::mutex> l(confirmed_txs_mut);
-                              if(confirmed_txs.size() < max_invalid) {
-                                  confirmed_txs.push(txn);
-                              }
-                          }
+                          push_confirmed_tx(txn);
                       } else {
                           logger->warn(cbdc::to_string(tx_id), "had error");
                           wallet.confirm_inputs(txn.m_inputs);
@@ -281,17 +345,166 @@ auto main(int argc, char** argv) -> int {
                 wallet.confirm_inputs(tx.value().m_inputs);
             }
         }
-    });
+    };
+
+    // Each open-loop thread sends its share of the target rate on a fixed
+    // schedule, whether or not its earlier transactions have confirmed, and
+    // latency is measured from the scheduled send time. A closed loop sends
+    // less while the system is slow, so its samples leave out the time
+    // transactions would have spent queued (coordinated omission).
+    auto send_lag = cbdc::metrics::histogram();
+    auto confirm_latency = cbdc::metrics::histogram();
+    auto n_sent = std::atomic<uint64_t>();
+    auto n_confirmed = std::atomic<uint64_t>();
+    auto n_failed = std::atomic<uint64_t>();
+    auto n_skipped = std::atomic<uint64_t>();
+    auto open_loop_start = std::chrono::steady_clock::now();
+    auto open_loop_sender = [&](size_t thread_idx) {
+        auto& w = *wallets[thread_idx];
+        auto thread_engine = std::default_random_engine(
+            static_cast<uint32_t>(thread_idx));
+        auto thread_invalid_dist = invalid_dist;
+        auto thread_fixed_dist = fixed_dist;
+        const auto interval
+            = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<double>(
+                    static_cast<double>(n_wallets)
+                    / static_cast<double>(cfg.m_loadgen_target_rate)));
+        // Stagger the threads' schedules evenly
+        auto next_send = open_loop_start
+                       + interval * static_cast<int64_t>(thread_idx)
+                             / static_cast<int64_t>(n_wallets);
+        while(running) {
+            std::this_thread::sleep_until(next_send);
+            const auto scheduled = next_send;
+            next_send += interval;
+
+            auto tx = std::optional<cbdc::transaction::full_tx>();
+            if(cfg.m_invalid_rate > 0.0
+               && thread_invalid_dist(thread_engine)) {
+                tx = pop_confirmed_tx();
+            }
+            if(!tx) {
+                const auto send_fixed = cfg.m_fixed_tx_mode
+                                     && cfg.m_fixed_tx_rate > 0.0
+                                     && thread_fixed_dist(thread_engine);
+                tx = generate_tx(w, send_fixed);
+            }
+            if(!tx) {
+                // Out of outputs until earlier transactions confirm, so
+                // this send is skipped
+                n_skipped++;
+                continue;
+            }
+
+            send_lag.record(std::chrono::steady_clock::now() - scheduled);
+            n_sent++;
+            auto res_cb
+                = [&, txn = tx.value(), scheduled](
+                      cbdc::sentinel::rpc::client::execute_result_type res) {
+                      if(res.has_value()
+                         && res.value().m_tx_status
+                                == cbdc::sentinel::tx_status::confirmed) {
+                          confirm_latency.record(
+                              std::chrono::steady_clock::now() - scheduled);
+                          n_confirmed++;
+                          w.confirm_transaction(txn);
+                          second_conf_queue.push(
+                              cbdc::transaction::tx_id(txn));
+                          push_confirmed_tx(txn);
+                          return;
+                      }
+                      n_failed++;
+                      w.confirm_inputs(txn.m_inputs);
+                  };
+            if(!sentinel_client.execute_transaction(tx.value(),
+                                                    std::move(res_cb))) {
+                n_failed++;
+                w.confirm_inputs(tx.value().m_inputs);
+            }
+        }
+    };
+
+    auto gen_threads = std::vector<std::thread>();
+    if(open_loop) {
+        logger->info("Sending",
+                     cfg.m_loadgen_target_rate,
+                     "TX/s from",
+                     n_wallets,
+                     "threads");
+        for(size_t i = 0; i < n_wallets; i++) {
+            gen_threads.emplace_back(open_loop_sender, i);
+        }
+    } else {
+        gen_threads.emplace_back(closed_loop_sender);
+    }
 
     std::signal(SIGINT, [](int /* sig */) {
         running = false;
     });
 
+    // Reports the open-loop throughput, and the latency percentiles of the
+    // transactions confirmed since the given snapshot
+    auto report = [&](const std::string& label,
+                      const cbdc::metrics::histogram_snapshot& since,
+                      uint64_t confirmed_since,
+                      double secs) {
+        auto hist = confirm_latency.snapshot();
+        for(size_t i = 0; i < hist.m_counts.size(); i++) {
+            hist.m_counts[i] -= since.m_counts[i];
+        }
+        hist.m_count -= since.m_count;
+        static constexpr auto ns_per_ms = 1e6;
+        auto ms = [&](double q) {
+            return static_cast<double>(hist.quantile(q)) / ns_per_ms;
+        };
+        logger->info(label,
+                     "confirmed TX/s:",
+                     static_cast<double>(n_confirmed - confirmed_since)
+                         / secs,
+                     "latency ms p50:",
+                     ms(0.5),
+                     "p99:",
+                     ms(0.99),
+                     "p999:",
+                     ms(0.999),
+                     "sent:",
+                     n_sent.load(),
+                     "failed:",
+                     n_failed.load(),
+                     "skipped:",
+                     n_skipped.load(),
+                     "max send lag ms:",
+                     static_cast<double>(send_lag.snapshot().quantile(1.0))
+                         / ns_per_ms);
+    };
+
+    auto last_snapshot = confirm_latency.snapshot();
+    uint64_t last_confirmed{0};
     while(running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        if(open_loop) {
+            report("Interval", last_snapshot, last_confirmed, 1.0);
+            last_snapshot = confirm_latency.snapshot();
+            last_confirmed = n_confirmed;
+        }
     }
 
-    gen_thread.join();
+    for(auto& thr : gen_threads) {
+        thr.join();
+    }
+    if(open_loop) {
+        auto elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - open_loop_start);
+        report("Total",
+               cbdc::metrics::histogram_snapshot{
+                   std::vector<uint64_t>(
+                       cbdc::metrics::histogram::bucket_count),
+                   0,
+                   0},
+               0,
+               elapsed.count());
+    }
     second_conf_queue.clear();
     for(auto& thr : second_conf_thrs) {
         thr.join();
@@ -0,0 +1,81 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/config.hpp"
+#include "util/oracle/schema.hpp"
+
+#include <iostream>
+
+/// Prints the DDL for the locking shard Oracle tables, partitioned to match
+/// the shard ranges of the given config file.
+auto main(int argc, char** argv) -> int {
+    auto args = cbdc::config::get_args(argc, argv);
+    static constexpr auto min_arg_count = 2;
+    if(args.size() < min_arg_count) {
+        std::cerr << "Usage: oracle-schema [config file]" << std::endl;
+        return -1;
+    }
+
+    auto cfg_or_err = cbdc::config::load_options(args[1]);
+    if(std::holds_alternative<std::string>(cfg_or_err)) {
+        std::cerr << "Error loading config file: "
+                  << std::get<std::string>(cfg_or_err) << std::endl;
+        return -1;
+    }
+    auto cfg = std::get<cbdc::config::options>(cfg_or_err);
+
+    auto statements = std::vector<std::string>();
+    auto add = [&](std::vector<std::string> ddl) {
+        statements.insert(statements.end(), ddl.begin(), ddl.end());
+    };
+
+    // Spent and created UHS IDs always belong to the writing shard's range.
+    for(const auto* table : {"admin.shard_spent", "admin.shard_created"}) {
+        add(cbdc::oracle::make_partitioned_table_ddl(
+            table,
+            {"dtx_id", "tx_id", "uhs_id"},
+            "uhs_id",
+            cfg.m_shard_ranges));
+    }
+    // Shards record the TX IDs in their range, which back check_tx_id
+    // lookups that miss the completed TX cache.
+    add(cbdc::oracle::make_partitioned_table_ddl("admin.shard_txs",
+                                                 {"tx_id"},
+                                                 "tx_id",
+                                                 cfg.m_shard_ranges));
+    if(cfg.m_seed_oracle_table.has_value()) {
+        add(cbdc::oracle::make_partitioned_table_ddl(
+            cfg.m_seed_oracle_table.value(),
+            {"uhs_id"},
+            "uhs_id",
+            cfg.m_shard_ranges));
+    }
+
+    // Every shard involved in a dtx records its ID, so dtx IDs do not map
+    // onto shard ranges. Hash partitioning still spreads the inserts over
+    // independent index segments.
+    size_t partitions{1};
+    while(partitions < cfg.m_shard_ranges.size()) {
+        partitions *= 2;
+    }
+    statements.push_back("CREATE TABLE admin.shard_data (raw_data RAW(32) "
+                         "NOT NULL) PARTITION BY HASH (raw_data) PARTITIONS "
+                         + std::to_string(partitions));
+
+    if(cfg.m_coordinator_journal) {
+        // Journal rows are append-only and only read back by dtx ID.
+        statements.emplace_back("CREATE TABLE admin.coordinator_journal "
+                                "(dtx_id RAW(32) NOT NULL, phase RAW(32) "
+                                "NOT NULL)");
+        statements.emplace_back("CREATE INDEX "
+                                "admin.coordinator_journal_dtx_id_idx ON "
+                                "admin.coordinator_journal (dtx_id)");
+    }
+
+    for(const auto& stmt : statements) {
+        std::cout << stmt << ";" << std::endl;
+    }
+    return 0;
+}
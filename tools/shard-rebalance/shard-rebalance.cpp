@@ -0,0 +1,160 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "uhs/twophase/coordinator/client.hpp"
+#include "uhs/twophase/locking_shard/client.hpp"
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+
+#include <iostream>
+
+/// Range of UHS IDs left with the source shard once the target takes over
+/// its configured range, or std::nullopt if the source keeps nothing.
+/// Moved ranges must sit at one end of the source range so the rest stays
+/// contiguous.
+auto remaining_range(const cbdc::config::shard_range_t& source,
+                     const cbdc::config::shard_range_t& moved)
+    -> std::optional<std::optional<cbdc::config::shard_range_t>> {
+    if(moved.first < source.first || moved.second > source.second) {
+        return std::nullopt;
+    }
+    if(moved == source) {
+        return std::optional<cbdc::config::shard_range_t>();
+    }
+    if(moved.first == source.first) {
+        return cbdc::config::shard_range_t{
+            static_cast<uint8_t>(moved.second + 1),
+            source.second};
+    }
+    if(moved.second == source.second) {
+        return cbdc::config::shard_range_t{
+            source.first,
+            static_cast<uint8_t>(moved.first - 1)};
+    }
+    return std::nullopt;
+}
+
+/// Changes the route of a shard on every coordinator cluster, waiting for
+/// each to drain transactions routed the previous way.
+auto set_routes(const cbdc::config::options& cfg,
+                const std::shared_ptr<cbdc::logging::log>& logger,
+                uint64_t shard_id,
+                const std::optional<cbdc::config::shard_range_t>& range)
+    -> bool {
+    static constexpr auto route_timeout = std::chrono::seconds(60);
+    for(size_t i{0}; i < cfg.m_coordinator_endpoints.size(); i++) {
+        auto coord
+            = cbdc::coordinator::rpc::client(cfg.m_coordinator_endpoints[i]);
+        if(!coord.init() || !coord.set_route(shard_id, range, route_timeout)) {
+            logger->error("Coordinator", i, "failed to route shard", shard_id);
+            return false;
+        }
+        logger->info("Coordinator", i, "routed shard", shard_id);
+    }
+    return true;
+}
+
+auto main(int argc, char** argv) -> int {
+    auto args = cbdc::config::get_args(argc, argv);
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::info);
+    static constexpr auto min_arg_count = 4;
+    if(args.size() < min_arg_count) {
+        std::cout << "Usage: shard-rebalance [config file] [source shard ID] "
+                     "[target shard ID]"
+                  << std::endl;
+        return -1;
+    }
+
+    auto cfg_or_err = cbdc::config::load_options(args[1]);
+    if(std::holds_alternative<std::string>(cfg_or_err)) {
+        logger->error("Error loading config file:",
+                      std::get<std::string>(cfg_or_err));
+        return -1;
+    }
+    auto cfg = std::get<cbdc::config::options>(cfg_or_err);
+
+    const auto src_id = std::stoull(args[2]);
+    const auto dst_id = std::stoull(args[3]);
+    if(!cfg.m_twophase_mode || src_id == dst_id
+       || src_id >= cfg.m_shard_ranges.size()
+       || dst_id >= cfg.m_shard_ranges.size()) {
+        logger->error("Source and target must be distinct locking shards");
+        return -1;
+    }
+
+    // The target takes over its configured range from the source
+    const auto& src_range = cfg.m_shard_ranges[src_id];
+    const auto range = cfg.m_shard_ranges[dst_id];
+    const auto remaining = remaining_range(src_range, range);
+    if(!remaining.has_value()) {
+        logger->error("Target range must be at one end of the source range");
+        return -1;
+    }
+
+    auto src = cbdc::locking_shard::rpc::client(
+        cfg.m_locking_shard_endpoints[src_id],
+        src_range,
+        *logger);
+    auto dst = cbdc::locking_shard::rpc::client(
+        cfg.m_locking_shard_endpoints[dst_id],
+        range,
+        *logger);
+    if(!src.init() || !dst.init()) {
+        logger->error("Failed to connect to shards");
+        return -1;
+    }
+
+    // The target shadows the range, recording what it sees spent, before
+    // any transaction is routed to it.
+    if(!dst.begin_import(range)) {
+        logger->error("Target shard refused the import");
+        return -1;
+    }
+    if(!set_routes(cfg, logger, dst_id, range)) {
+        return -1;
+    }
+
+    // Every batch routed only to the source has drained, so reading the
+    // source now misses no UHS IDs the target has not seen spent.
+    uint64_t copied{0};
+    while(true) {
+        auto chunk = src.read_range(range, copied);
+        if(!chunk.has_value()) {
+            logger->error("Failed to read source range at", copied);
+            return -1;
+        }
+        if(chunk->empty()) {
+            break;
+        }
+        const auto n = chunk->size();
+        if(!dst.import_uhs(std::move(chunk.value()))) {
+            logger->error("Target shard refused UHS IDs at", copied);
+            return -1;
+        }
+        copied += n;
+        logger->info("Copied", copied, "UHS IDs");
+    }
+    if(!dst.end_import()) {
+        logger->error("Failed to end import");
+        return -1;
+    }
+
+    if(!set_routes(cfg, logger, src_id, remaining.value())) {
+        return -1;
+    }
+    if(!src.drop_range(range)) {
+        logger->error("Source shard failed to drop the range");
+        return -1;
+    }
+
+    logger->info("Moved",
+                 copied,
+                 "UHS IDs from shard",
+                 src_id,
+                 "to shard",
+                 dst_id);
+    return 0;
+}
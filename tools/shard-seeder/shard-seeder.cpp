@@ -7,21 +7,29 @@
 #include "uhs/transaction/validation.hpp"
 #include "uhs/transaction/wallet.hpp"
 #include "util/common/config.hpp"
+#include "util/common/leveldb_options.hpp"
+#include "util/common/mapped_hash_array.hpp"
+#include "util/common/thread_pool.hpp"
+#include "util/oracle/direct_path_loader.hpp"
+#include "util/oracle/schema.hpp"
+#include "util/oracle/session_pool.hpp"
 #include "util/serialization/buffer_serializer.hpp"
 #include "util/serialization/format.hpp"
-#include "util/serialization/ostream_serializer.hpp"
 
 #include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
-#include <thread>
 
 static constexpr int leveldb_buffer_size
     = 16 * 1024 * 1024; // 16MB can hold ~ 500K UHS_IDs
 static constexpr int write_batch_size
     = 450000; // well within the write buffer size
+static constexpr size_t preseed_write_buffer_size = 4 * 1024 * 1024;
+// Seeded outputs hashed at once, and per task
+static constexpr size_t seed_window_size = 1 << 20;
+static constexpr size_t seed_chunk_size = 4096;
 
 auto get_2pc_uhs_key(const cbdc::hash_t& uhs_id) -> std::string {
     auto ret = std::string();
@@ -31,9 +39,204 @@ auto get_2pc_uhs_key(const cbdc::hash_t& uhs_id) -> std::string {
     return ret;
 }
 
+/// Writes the seeded UHS IDs in one shard's range to its preseed database
+/// or file, and to Oracle if configured. Stops writing after any failure.
+class shard_sink {
+  public:
+    shard_sink(std::shared_ptr<cbdc::logging::log> logger,
+               const cbdc::config::options& cfg,
+               std::shared_ptr<cbdc::oracle::session_pool> oracle_pool,
+               size_t shard_idx,
+               size_t shard_start,
+               size_t shard_end,
+               size_t num_utxos)
+        : m_logger(std::move(logger)),
+          m_cfg(cfg),
+          m_oracle_pool(std::move(oracle_pool)),
+          m_shard_idx(shard_idx),
+          m_shard_start(shard_start),
+          m_shard_end(shard_end) {
+        std::stringstream shard_db_dir;
+        if(m_cfg.m_twophase_mode) {
+            shard_db_dir << "2pc_";
+        }
+        shard_db_dir << "shard_preseed_" << num_utxos << "_" << shard_idx;
+        m_path = shard_db_dir.str();
+    }
+
+    void open() {
+        m_logger->info("Starting seeding of shard ",
+                       m_shard_idx,
+                       " to database ",
+                       m_path);
+
+        if(m_oracle_pool) {
+            m_oracle_session = m_oracle_pool->acquire();
+            if(!m_oracle_session.has_value()) {
+                m_logger->error("Failed to acquire Oracle session for shard ",
+                                m_shard_idx);
+                return;
+            }
+            auto partition = std::optional<std::string>();
+            if(m_cfg.m_seed_oracle_partitioned) {
+                partition = cbdc::oracle::shard_partition_name(
+                    {static_cast<uint8_t>(m_shard_start),
+                     static_cast<uint8_t>(m_shard_end)});
+            }
+            m_oracle_loader
+                = std::make_unique<cbdc::oracle::direct_path_loader>(
+                    m_logger,
+                    m_oracle_session.value(),
+                    m_cfg.m_seed_oracle_table.value(),
+                    std::move(partition),
+                    std::vector<std::string>{"uhs_id"});
+            if(!m_oracle_loader->open()) {
+                return;
+            }
+        }
+
+        if(!m_cfg.m_twophase_mode) {
+            // Tables only get Bloom filters when written with the filter
+            // policy, so seed with the profile the shard reads with
+            auto profile = m_cfg.m_shard_leveldb;
+            profile.m_write_buffer_bytes
+                = std::max<size_t>(profile.m_write_buffer_bytes,
+                                   leveldb_buffer_size);
+            m_db_opts = cbdc::leveldb_options(profile);
+
+            leveldb::DB* db_ptr{};
+            const auto res
+                = leveldb::DB::Open(m_db_opts.get(), m_path, &db_ptr);
+            m_db = std::unique_ptr<leveldb::DB>(db_ptr);
+            if(!res.ok()) {
+                m_logger->error("Failed to open shard DB ",
+                                m_path,
+                                " for shard ",
+                                m_shard_idx,
+                                ": ",
+                                res.ToString());
+                return;
+            }
+        } else {
+            // Buffer the file in large blocks, the buffer must be set
+            // before opening
+            m_out_buf.resize(preseed_write_buffer_size);
+            m_out.rdbuf()->pubsetbuf(m_out_buf.data(),
+                                     static_cast<std::streamsize>(
+                                         m_out_buf.size()));
+            m_out.open(m_path, std::ios::binary);
+            // Write a placeholder header. Shards map the file and use the
+            // hashes in place, so it must stay fixed-width.
+            if(!cbdc::mapped_hash_array::write_header(m_out, 0)) {
+                m_logger->error("Failed to write preseed file ", m_path);
+                return;
+            }
+        }
+        m_ok = true;
+    }
+
+    void append(const std::vector<cbdc::hash_t>& uhs_ids) {
+        if(!m_ok) {
+            return;
+        }
+        m_ids.clear();
+        for(const auto& uhs_id : uhs_ids) {
+            if(uhs_id[0] >= m_shard_start && uhs_id[0] <= m_shard_end) {
+                m_ids.push_back(uhs_id);
+            }
+        }
+        if(m_ids.empty()) {
+            return;
+        }
+
+        if(m_oracle_loader
+           && !m_oracle_loader->append(m_ids.data(), m_ids.size())) {
+            m_ok = false;
+            return;
+        }
+
+        if(m_db) {
+            for(const auto& uhs_id : m_ids) {
+                leveldb::Slice hash_key(
+                    reinterpret_cast<const char*>(uhs_id.data()),
+                    uhs_id.size());
+                m_batch.Put(hash_key, leveldb::Slice());
+                m_batch_size++;
+                if(m_batch_size >= write_batch_size) {
+                    m_db->Write(leveldb::WriteOptions(), &m_batch);
+                    m_batch.Clear();
+                    m_batch_size = 0;
+                }
+            }
+        } else {
+            // UHS IDs are stored back to back, so write them in one go
+            m_out.write(reinterpret_cast<const char*>(m_ids.data()),
+                        static_cast<std::streamsize>(
+                            m_ids.size() * sizeof(cbdc::hash_t)));
+        }
+        m_count += m_ids.size();
+    }
+
+    void finish() {
+        if(!m_ok) {
+            return;
+        }
+        if(m_db) {
+            if(m_batch_size > 0) {
+                m_db->Write(leveldb::WriteOptions(), &m_batch);
+            }
+            m_logger->info("Shard ", m_shard_idx, " succesfully seeded");
+        } else {
+            m_out.seekp(0);
+            if(!cbdc::mapped_hash_array::write_header(m_out, m_count)) {
+                m_logger->error("Failed to write preseed file ", m_path);
+                return;
+            }
+            m_out.close();
+        }
+
+        if(m_oracle_loader) {
+            if(!m_oracle_loader->finish()) {
+                return;
+            }
+            m_logger->info("Loaded ",
+                           m_oracle_loader->rows(),
+                           " UHS IDs into Oracle for shard ",
+                           m_shard_idx);
+        }
+    }
+
+  private:
+    std::shared_ptr<cbdc::logging::log> m_logger;
+    const cbdc::config::options& m_cfg;
+    std::shared_ptr<cbdc::oracle::session_pool> m_oracle_pool;
+    size_t m_shard_idx;
+    size_t m_shard_start;
+    size_t m_shard_end;
+    std::string m_path;
+    bool m_ok{false};
+
+    std::optional<cbdc::oracle::connection> m_oracle_session;
+    std::unique_ptr<cbdc::oracle::direct_path_loader> m_oracle_loader;
+
+    /// Must outlive m_db.
+    cbdc::leveldb_options m_db_opts;
+    std::unique_ptr<leveldb::DB> m_db;
+    leveldb::WriteBatch m_batch;
+    int m_batch_size{0};
+
+    std::vector<char> m_out_buf;
+    std::ofstream m_out;
+    uint64_t m_count{0};
+
+    /// UHS IDs in the shard's range from the current window.
+    std::vector<cbdc::hash_t> m_ids;
+};
+
 auto main(int argc, char** argv) -> int {
     auto args = cbdc::config::get_args(argc, argv);
-    auto logger = cbdc::logging::log(cbdc::logging::log_level::info);
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::info);
     static constexpr auto min_arg_count = 2;
     if(args.size() < min_arg_count) {
         std::cout << "Usage: shard-seeder [config file]" << std::endl;
@@ -42,8 +245,8 @@ auto main(int argc, char** argv) -> int {
 
     auto cfg_or_err = cbdc::config::load_options(args[1]);
     if(std::holds_alternative<std::string>(cfg_or_err)) {
-        logger.error("Error loading config file:",
-                     std::get<std::string>(cfg_or_err));
+        logger->error("Error loading config file:",
+                      std::get<std::string>(cfg_or_err));
         return -1;
     }
     auto cfg = std::get<cbdc::config::options>(cfg_or_err);
@@ -59,7 +262,7 @@ auto main(int argc, char** argv) -> int {
     auto num_utxos = cfg.m_seed_to - cfg.m_seed_from;
     auto utxo_val = cfg.m_seed_value;
     if(!cfg.m_seed_privkey.has_value()) {
-        logger.error("Seed private key not specified");
+        logger->error("Seed private key not specified");
         return -1;
     }
     auto secp_context = std::unique_ptr<secp256k1_context,
@@ -78,110 +281,86 @@ auto main(int argc, char** argv) -> int {
         = (std::numeric_limits<cbdc::config::shard_range_t::first_type>::max()
            + 1)
         / num_shards;
-    auto gen_threads = std::vector<std::thread>(num_shards);
-    for(size_t i = 0; i < num_shards; i++) {
-        std::thread t(
-            [&](size_t shard_idx) {
-                auto shard_start = shard_idx * shard_range;
-                auto shard_end = (shard_idx + 1) * shard_range - 1;
-                if(shard_idx == num_shards - 1) {
-                    shard_end = std::numeric_limits<
-                        cbdc::config::shard_range_t::first_type>::max();
-                }
 
-                std::stringstream shard_db_dir;
-                if(cfg.m_twophase_mode) {
-                    shard_db_dir << "2pc_";
-                }
-
-                shard_db_dir << "shard_preseed_" << num_utxos << "_"
-                             << shard_idx;
-
-                logger.info("Starting seeding of shard ",
-                            shard_idx,
-                            " to database ",
-                            shard_db_dir.str());
-
-                if(!cfg.m_twophase_mode) {
-                    leveldb::Options opt;
-                    opt.create_if_missing = true;
-                    opt.write_buffer_size = leveldb_buffer_size;
-
-                    leveldb::WriteOptions wopt;
-
-                    leveldb::DB* db_ptr{};
-                    const auto res
-                        = leveldb::DB::Open(opt, shard_db_dir.str(), &db_ptr);
-                    auto db = std::unique_ptr<leveldb::DB>(db_ptr);
-                    if(!res.ok()) {
-                        logger.error("Failed to open shard DB ",
-                                     shard_db_dir.str(),
-                                     " for shard ",
-                                     shard_idx,
-                                     ": ",
-                                     res.ToString());
-                        return;
-                    }
-
-                    auto tx = wal.create_seeded_transaction(0).value();
-                    auto batch_size = 0;
-                    leveldb::WriteBatch batch;
-                    for(size_t tx_idx = 0; tx_idx != num_utxos; tx_idx++) {
-                        tx.m_inputs[0].m_prevout.m_index = tx_idx;
-                        cbdc::transaction::compact_tx ctx(tx);
-                        const cbdc::hash_t& output_hash = ctx.m_uhs_outputs[0];
-                        if(output_hash[0] >= shard_start
-                           && output_hash[0] <= shard_end) {
-                            std::array<char, sizeof(output_hash)> hash_arr{};
-                            std::memcpy(hash_arr.data(),
-                                        output_hash.data(),
-                                        sizeof(output_hash));
-                            leveldb::Slice hash_key(hash_arr.data(),
-                                                    output_hash.size());
-                            batch.Put(hash_key, leveldb::Slice());
-                            batch_size++;
-                            if(batch_size >= write_batch_size) {
-                                db->Write(wopt, &batch);
-                                batch.Clear();
-                                batch_size = 0;
-                            }
-                        }
-                    }
-                    if(batch_size > 0) {
-                        db->Write(wopt, &batch);
-                    }
-                    logger.info("Shard ", shard_idx, " succesfully seeded");
-                } else if(cfg.m_twophase_mode) { // 2PC Shard
-                    auto out
-                        = std::ofstream(shard_db_dir.str(), std::ios::binary);
-                    size_t count = 0;
-                    // write dummy size
-                    auto ser = cbdc::ostream_serializer(out);
-                    ser << count;
-                    auto tx = wal.create_seeded_transaction(0).value();
-                    for(size_t tx_idx = 0; tx_idx != num_utxos; tx_idx++) {
-                        tx.m_inputs[0].m_prevout.m_index = tx_idx;
-                        cbdc::transaction::compact_tx ctx(tx);
-                        const cbdc::hash_t& output_hash = ctx.m_uhs_outputs[0];
-                        if(output_hash[0] >= shard_start
-                           && output_hash[0] <= shard_end) {
-                            ser << output_hash;
-                            count++;
-                        }
-                    }
-                    ser.reset();
-                    ser << count;
-                }
-            },
-            i);
-        gen_threads[i] = std::move(t);
+    // Each shard direct path loads its UHS IDs over its own session.
+    auto oracle_pool = std::shared_ptr<cbdc::oracle::session_pool>();
+    if(cfg.m_seed_oracle_table.has_value()) {
+        oracle_pool = std::make_shared<cbdc::oracle::session_pool>(
+            logger,
+            num_shards,
+            num_shards,
+            1,
+            cfg.m_oracle_stmt_cache_size);
+        if(!oracle_pool->init()) {
+            logger->error("Failed to initialize Oracle session pool");
+            return -1;
+        }
     }
 
+    auto sinks = std::vector<std::unique_ptr<shard_sink>>();
     for(size_t i = 0; i < num_shards; i++) {
-        gen_threads[i].join();
+        auto shard_start = i * shard_range;
+        auto shard_end = (i + 1) * shard_range - 1;
+        if(i == num_shards - 1) {
+            shard_end = std::numeric_limits<
+                cbdc::config::shard_range_t::first_type>::max();
+        }
+        sinks.push_back(std::make_unique<shard_sink>(logger,
+                                                     cfg,
+                                                     oracle_pool,
+                                                     i,
+                                                     shard_start,
+                                                     shard_end,
+                                                     num_utxos));
     }
+
+    // Open the shard outputs concurrently, as each may start a direct path
+    // load
+    auto pool = std::make_unique<cbdc::thread_pool>(0);
+    cbdc::for_each_chunk(pool.get(),
+                         num_shards,
+                         1,
+                         [&](size_t begin, size_t end) {
+                             for(auto i = begin; i < end; i++) {
+                                 sinks[i]->open();
+                             }
+                         });
+
+    // Each window of seeded outputs is hashed once across all cores, then
+    // each shard appends the UHS IDs in its range concurrently
+    auto window = std::vector<cbdc::hash_t>();
+    for(size_t from = 0; from < num_utxos; from += seed_window_size) {
+        const auto to = std::min(from + seed_window_size, num_utxos);
+        window.resize(to - from);
+        cbdc::for_each_chunk(
+            pool.get(),
+            window.size(),
+            seed_chunk_size,
+            [&](size_t begin, size_t end) {
+                auto ids = wal.seeded_uhs_ids(from + begin, from + end);
+                std::copy(ids.begin(), ids.end(), window.begin() + begin);
+            });
+        cbdc::for_each_chunk(pool.get(),
+                             num_shards,
+                             1,
+                             [&](size_t begin, size_t end) {
+                                 for(auto i = begin; i < end; i++) {
+                                     sinks[i]->append(window);
+                                 }
+                             });
+    }
+
+    cbdc::for_each_chunk(pool.get(),
+                         num_shards,
+                         1,
+                         [&](size_t begin, size_t end) {
+                             for(auto i = begin; i < end; i++) {
+                                 sinks[i]->finish();
+                             }
+                         });
+
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                         std::chrono::system_clock::now() - start)
                         .count();
-    logger.info("Done in ", duration, "ms");
+    logger->info("Done in ", duration, "ms");
 }
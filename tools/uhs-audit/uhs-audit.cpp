@@ -0,0 +1,190 @@
+// Copyright (c) 2021 MIT Digital Currency Initiative,
+//                    Federal Reserve Bank of Boston
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/common/config.hpp"
+#include "util/common/logging.hpp"
+#include "util/common/thread_pool.hpp"
+#include "util/persistence/supply_audit.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+/// Finds the most recent complete UHS export of a shard. Atomizer shards
+/// name exports shard<id>_uhs_<height>, and locking shard nodes name them
+/// shard<id>_<node>_uhs_<log index>, so the export with the highest
+/// trailing number across the nodes of a shard is the most recent.
+auto latest_export(const std::string& dir, size_t shard_id)
+    -> std::optional<std::string> {
+    const auto prefix = "shard" + std::to_string(shard_id) + "_";
+    static constexpr auto infix = "_uhs_";
+    auto ret = std::optional<std::string>();
+    uint64_t latest{0};
+    auto ec = std::error_code();
+    for(const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        const auto name = entry.path().filename().string();
+        const auto pos = name.rfind(infix);
+        if(name.rfind(prefix, 0) != 0 || pos == std::string::npos) {
+            continue;
+        }
+        const auto suffix = name.substr(pos + std::strlen(infix));
+        // Skips exports still being written, which end in .tmp
+        if(suffix.empty()
+           || !std::all_of(suffix.begin(), suffix.end(), [](char c) {
+                  return c >= '0' && c <= '9';
+              })) {
+            continue;
+        }
+        const auto label = std::stoull(suffix);
+        if(!ret.has_value() || label > latest) {
+            latest = label;
+            ret = entry.path().string();
+        }
+    }
+    return ret;
+}
+
+/// Audits the latest export of each shard range and logs the results.
+/// \return true if every shard balanced.
+auto run_audit(const cbdc::config::options& cfg,
+               const std::shared_ptr<cbdc::logging::log>& logger,
+               const std::string& export_dir,
+               cbdc::thread_pool* pool) -> bool {
+    auto start = std::chrono::steady_clock::now();
+
+    // Replicated shards share a range, so only the first shard with each
+    // range is audited.
+    auto sources = std::vector<cbdc::persistence::shard_audit_source>();
+    auto shard_ids = std::vector<size_t>();
+    const auto n_seeded = cfg.m_seed_to - cfg.m_seed_from;
+    for(size_t i{0}; i < cfg.m_shard_ranges.size(); i++) {
+        const auto& range = cfg.m_shard_ranges[i];
+        if(std::any_of(sources.begin(), sources.end(), [&](const auto& s) {
+               return s.m_range == range;
+           })) {
+            continue;
+        }
+        auto path = latest_export(export_dir, i);
+        if(!path.has_value()) {
+            logger->error("No UHS export found for shard", i);
+            return false;
+        }
+        auto src = cbdc::persistence::shard_audit_source();
+        src.m_range = range;
+        src.m_export_path = std::move(path.value());
+        // Matches the preseed file read by locking shards. Atomizer
+        // shards are preseeded from a database which is not audited.
+        if(cfg.m_twophase_mode && n_seeded != 0) {
+            src.m_preseed_path = "2pc_shard_preseed_"
+                               + std::to_string(n_seeded) + "_"
+                               + std::to_string(i);
+        }
+        sources.push_back(std::move(src));
+        shard_ids.push_back(i);
+    }
+
+    auto counter = cbdc::persistence::record_counter();
+    if(cfg.m_twophase_mode) {
+        counter = cbdc::persistence::make_record_counter(cfg, logger);
+        if(!counter) {
+            logger->warn("Persisted UHS records cannot be counted with the",
+                         "configured persistence backend, only checking",
+                         "export ranges");
+        }
+    }
+
+    auto results = cbdc::persistence::audit_supply(sources, counter, pool);
+
+    auto ok = true;
+    uint64_t exported{0};
+    uint64_t seeded{0};
+    for(size_t i{0}; i < results.size(); i++) {
+        const auto& res = results[i];
+        exported += res.m_exported;
+        seeded += res.m_seeded;
+        if(res.m_error.has_value()) {
+            logger->error("Shard", shard_ids[i], res.m_error.value());
+            ok = false;
+            continue;
+        }
+        const auto balanced = res.balanced();
+        ok = ok && balanced;
+        auto msg = std::stringstream();
+        msg << "Shard " << shard_ids[i] << " at " << res.m_label << ": "
+            << res.m_exported << " unspent, " << res.m_out_of_range
+            << " out of range, " << res.m_seeded << " seeded";
+        if(res.m_created.has_value() && res.m_spent.has_value()) {
+            msg << ", " << res.m_created.value() << " created, "
+                << res.m_spent.value() << " spent";
+        }
+        if(balanced) {
+            logger->info(msg.str());
+        } else {
+            logger->error(msg.str(), "- does not balance");
+        }
+    }
+
+    if(cfg.m_twophase_mode && seeded != n_seeded) {
+        logger->error("Shards hold",
+                      seeded,
+                      "seeded outputs but",
+                      n_seeded,
+                      "were minted");
+        ok = false;
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    logger->info("Audited",
+                 exported,
+                 "unspent outputs, seeded supply",
+                 n_seeded * cfg.m_seed_value,
+                 ok ? "- balanced" : "- FAILED",
+                 "in",
+                 duration,
+                 "ms");
+    return ok;
+}
+
+auto main(int argc, char** argv) -> int {
+    auto args = cbdc::config::get_args(argc, argv);
+    auto logger = std::make_shared<cbdc::logging::log>(
+        cbdc::logging::log_level::info);
+    static constexpr auto min_arg_count = 3;
+    if(args.size() < min_arg_count) {
+        std::cout << "Usage: uhs-audit [config file] [export directory] "
+                     "[interval seconds, runs once if omitted]"
+                  << std::endl;
+        return -1;
+    }
+
+    auto cfg_or_err = cbdc::config::load_options(args[1]);
+    if(std::holds_alternative<std::string>(cfg_or_err)) {
+        logger->error("Error loading config file:",
+                      std::get<std::string>(cfg_or_err));
+        return -1;
+    }
+    auto cfg = std::get<cbdc::config::options>(cfg_or_err);
+
+    auto pool = std::make_unique<cbdc::thread_pool>(0);
+
+    static constexpr auto interval_arg = 3;
+    if(args.size() <= interval_arg) {
+        return run_audit(cfg, logger, args[2], pool.get()) ? 0 : -1;
+    }
+
+    // Service mode audits the latest exports periodically until killed
+    const auto interval = std::chrono::seconds(std::stoull(args[3]));
+    while(true) {
+        run_audit(cfg, logger, args[2], pool.get());
+        std::this_thread::sleep_for(interval);
+    }
+}